@@ -63,6 +63,8 @@
 #include <86box/pit.h>
 #include <86box/random.h>
 #include <86box/nvr.h>
+#include <86box/snapshot.h>
+#include <86box/bench.h>
 #include <86box/machine.h>
 #include <86box/bugger.h>
 #include <86box/postcard.h>
@@ -105,6 +107,11 @@
 #include <86box/apm.h>
 #include <86box/acpi.h>
 #include <86box/nv/vid_nv_rivatimer.h>
+#include <86box/perf.h>
+#include <86box/log.h>
+#include <86box/evbus.h>
+#include <86box/replay.h>
+#include <minitrace/minitrace.h>
 
 // Disable c99-designator to avoid the warnings about int ng
 #ifdef __clang__
@@ -153,6 +160,7 @@ uint64_t instru_run_ms                          = 0;
 #endif
 int      clear_flash                            = 0;
 int      auto_paused                            = 0;
+int      is_clone                               = 0;
 
 /* Configuration values. */
 int      window_remember;
@@ -172,6 +180,11 @@ int      force_43                               = 0;              /* (C) video *
 int      video_filter_method                    = 1;              /* (C) video */
 int      video_vsync                            = 0;              /* (C) video */
 int      video_framerate                        = -1;             /* (C) video */
+int      video_frame_dump                       = 0;              /* (C) dump every Nth frame, 0 = off */
+int      video_render_thread                    = 0;              /* (C) render SVGA scanlines on a per-monitor thread */
+int      video_cursor_layer                     = 0;              /* (C) let the renderer composite hardware cursors */
+int      video_batch_lines                      = 0;              /* (C) run quiet SVGA scanlines in batches */
+int      video_frame_pacing                     = 0;              /* (C) present frames at the guest's refresh rate */
 bool     serial_passthrough_enabled[SERIAL_MAX] = { 0, 0, 0, 0, 0, 0, 0 }; /* (C) activation and kind of
                                                                                   pass-through for serial ports */
 int      bugger_enabled                         = 0;              /* (C) enable ISAbugger */
@@ -184,6 +197,8 @@ int      isartc_type                            = 0;              /* (C) enable
 int      gfxcard[GFXCARD_MAX]                   = { 0, 0 };       /* (C) graphics/video card */
 int      show_second_monitors                   = 1;              /* (C) show non-primary monitors */
 int      sound_is_float                         = 1;              /* (C) sound uses FP values */
+int      sound_buffer_ms                        = 20;             /* (C) length of one output buffer in ms */
+int      cd_audio_readahead                     = 4;              /* (C) seconds of image CD audio decoded ahead */
 int      voodoo_enabled                         = 0;              /* (C) video option */
 int      lba_enhancer_enabled                   = 0;              /* (C) enable Vision Systems LBA Enhancer */
 int      ibm8514_standalone_enabled             = 0;              /* (C) video option */
@@ -192,17 +207,30 @@ int      da2_standalone_enabled                 = 0;              /* (C) video o
 uint32_t mem_size                               = 0;              /* (C) memory size (Installed on
                                                                          system board)*/
 uint32_t isa_mem_size                           = 0;              /* (C) memory size (ISA Memory Cards) */
+int      mem_huge_pages                         = 0;              /* (C) back guest RAM with host huge pages */
+int      mem_mergeable                          = 0;              /* (C) let the host merge identical guest pages */
+int      mem_zero_release                       = 0;              /* (C) give pages the guest zeroes back to the host */
+int      cpu_sched_mode                         = SCHED_FIXED;    /* (C) CPU slice scheduling mode */
 int      cpu_use_dynarec                        = 0;              /* (C) cpu uses/needs Dyna */
+int      cpu_dynarec_cache                      = 0;              /* (C) persistent dynarec block cache */
+int      cpu_use_kvm                            = 0;              /* (C) cpu runs under KVM if possible */
+int      cpu_dynarec_mmu_smc                    = 0;              /* (C) host MMU catches writes to code pages */
+int      cpu_dynarec_pool_size                  = 0;              /* (C) dynarec code pool size in MB, 0 = default */
+int      cpu_dynarec_stats                      = 0;              /* (C) dynarec statistics interval in seconds, 0 = off */
+int      cpu_dynarec_compile_budget             = 0;              /* (C) max. dynarec recompiles per time slice, 0 = unlimited */
 int      cpu                                    = 0;              /* (C) cpu type */
 int      fpu_type                               = 0;              /* (C) fpu type */
 int      fpu_softfloat                          = 0;              /* (C) fpu uses softfloat */
+int      fpu_softfloat_fast                     = 0;              /* (C) softfloat uses the host fpu when exact */
 int      time_sync                              = 0;              /* (C) enable time sync */
 int      confirm_reset                          = 1;              /* (C) enable reset confirmation */
 int      confirm_exit                           = 1;              /* (C) enable exit confirmation */
 int      confirm_save                           = 1;              /* (C) enable save confirmation */
 int      enable_discord                         = 0;              /* (C) enable Discord integration */
 int      pit_mode                               = -1;             /* (C) force setting PIT mode */
+int      acpi_host_timer                        = 0;              /* (C) ACPI PM timer follows host time in turbo */
 int      fm_driver                              = 0;              /* (C) select FM sound driver */
+int      fm_synth_thread                        = 0;              /* (C) run FM synthesis on its own thread */
 int      open_dir_usr_path                      = 0;              /* (C) default file open dialog directory
                                                                          of usr_path */
 int      video_fullscreen_scale_maximized       = 0;              /* (C) Whether fullscreen scaling settings
@@ -231,6 +259,8 @@ int framecount;
 extern int CPUID;
 extern int output;
 int        atfullspeed;
+int        turbo_mode = 0;
+static int turbo_was_on = 0;
 
 char  exe_path[2048]; /* path (dir) of executable */
 char  usr_path[1024]; /* path (dir) of user data */
@@ -242,6 +272,7 @@ int   scrnsz_y = SCREEN_RES_Y; /* current screen size, Y */
 #endif
 int config_changed; /* config has changed */
 int title_update;
+int stats_update;
 int framecountx        = 0;
 int hard_reset_pending = 0;
 
@@ -305,20 +336,45 @@ pclog_ex(UNUSED(const char *fmt), UNUSED(va_list ap))
     if (strcmp(fmt, "") == 0)
         return;
 
-    pclog_ensure_stdlog_open();
+    if (!log_rate_check(fmt))
+        return;
 
     vsprintf(temp, fmt, ap);
     if (suppr_seen && !strcmp(buff, temp))
         seen++;
     else {
-        if (suppr_seen && seen)
-            fprintf(stdlog, "*** %d repeats ***\n", seen);
+        if (suppr_seen && seen) {
+            char rep[64];
+
+            sprintf(rep, "*** %d repeats ***\n", seen);
+            log_emit(rep);
+        }
         seen = 0;
         strcpy(buff, temp);
-        fprintf(stdlog, "%s", temp);
+        log_emit(temp);
     }
+#endif
+}
 
-    fflush(stdlog);
+/*
+ * Log something from a call site that is hit often enough for the
+ * formatting to matter. In the binary log mode, the arguments are
+ * queued as they are and the writer thread does the formatting,
+ * at the cost of the repeat detection of pclog_ex().
+ */
+void
+pclog_fast_ex(UNUSED(const char *fmt), UNUSED(va_list ap))
+{
+#ifndef RELEASE_BUILD
+    if (log_mode != LOG_MODE_BINARY) {
+        pclog_ex(fmt, ap);
+        return;
+    }
+
+    if ((fmt[0] == '\0') || !log_rate_check(fmt))
+        return;
+
+    log_emit_fast(fmt, ap);
 #endif
 }
 
@@ -355,6 +411,8 @@ fatal(const char *fmt, ...)
 
     va_start(ap, fmt);
 
+    log_flush();
+
     if (stdlog == NULL) {
         if (log_path[0] != '\0') {
             stdlog = plat_fopen(log_path, "w");
@@ -400,6 +458,8 @@ fatal_ex(const char *fmt, va_list ap)
     char  temp[1024];
     char *sp;
 
+    log_flush();
+
     if (stdlog == NULL) {
         if (log_path[0] != '\0') {
             stdlog = plat_fopen(log_path, "w");
@@ -454,6 +514,33 @@ pc_log(const char *fmt, ...)
 #    define pc_log(fmt, ...)
 #endif
 
+#ifdef ENABLE_PC_LOG
+/* Logs how long each step of starting up took, up to the first hard reset. */
+static void
+pc_startup_phase(const char *phase)
+{
+    static uint64_t start = 0;
+    static uint64_t last  = 0;
+    static int      done  = 0;
+    uint64_t        now;
+
+    if (done)
+        return;
+
+    now = plat_get_ticks_us();
+    if (phase == NULL) {
+        start = last = now;
+        return;
+    }
+
+    pc_log("Startup: %-16s %7" PRIu64 " us, %7" PRIu64 " us in total\n", phase, now - last, now - start);
+    last = now;
+    done = !strcmp(phase, "hard reset");
+}
+#else
+#    define pc_startup_phase(phase)
+#endif
+
 static void
 delete_nvr_file(uint8_t flash)
 {
@@ -513,6 +600,8 @@ pc_init(int argc, char *argv[])
 #endif
     uint32_t lang_init = 0;
 
+    pc_startup_phase(NULL);
+
     /* Grab the executable's full path. */
     plat_get_exe_name(exe_path, sizeof(exe_path) - 1);
     p  = path_get_filename(exe_path);
@@ -564,6 +653,10 @@ usage:
             printf("\nUsage: 86box [options] [cfg-file]\n\n");
             printf("Valid options are:\n\n");
             printf("-? or --help            - show this information\n");
+            printf("-A or --logmode mode    - write the log in the 'mode' way (sync/async/binary)\n");
+#ifdef USE_BENCH
+            printf("-B or --bench ms        - run for 'ms' of emulated time, then print the results\n");
+#endif
             printf("-C or --config path     - set 'path' to be config file\n");
 #ifdef _WIN32
             printf("-D or --debug           - force debug output logging\n");
@@ -584,19 +677,58 @@ usage:
             printf("-L or --logfile path    - set 'path' to be the logfile\n");
             printf("-M or --missing         - dump missing machines and video cards\n");
             printf("-N or --noconfirm       - do not ask for confirmation on quit\n");
+            printf("-O or --snapshot path   - resume from the snapshot at 'path'\n");
             printf("-P or --vmpath path     - set 'path' to be root for vm\n");
+            printf("-Q or --lograte n       - log at most 'n' lines per second from any one place\n");
             printf("-R or --rompath path    - set 'path' to be ROM path\n");
 #ifndef USE_SDL_UI
             printf("-S or --settings        - show only the settings dialog\n");
 #endif
             printf("-T or --testmode        - test mode: execute the test mode entry point on init/hard reset\n");
+#ifdef USE_BENCH
+            printf("-U or --kernel spec     - run the 'spec' micro-benchmark instead of the machine (list: show them)\n");
+#endif
             printf("-V or --vmname name     - overrides the name of the running VM\n");
             printf("-W or --nohook          - disables keyboard hook (compatibility-only outside Windows)\n");
             printf("-X or --clear what      - clears the 'what' (cmos/flash/both)\n");
             printf("-Y or --donothing       - do not show any UI or run the emulation\n");
             printf("-Z or --lastvmpath      - the last parameter is VM path rather than config\n");
+            printf("--record path           - record the inputs of the run to 'path'\n");
+            printf("--replay path           - play back the run recorded to 'path'\n");
             printf("\nA config file can be specified. If none is, the default file will be used.\n");
             return 0;
+        } else if (!strcasecmp(argv[c], "--snapshot") || !strcasecmp(argv[c], "-O")) {
+            if ((c + 1) == argc)
+                goto usage;
+
+            snapshot_request_load(argv[++c]);
+#ifdef USE_BENCH
+        } else if (!strcasecmp(argv[c], "--bench") || !strcasecmp(argv[c], "-B")) {
+            if ((c + 1) == argc)
+                goto usage;
+
+            bench_run_ms = strtoull(argv[++c], NULL, 10);
+            if (bench_run_ms == 0)
+                goto usage;
+        } else if (!strcasecmp(argv[c], "--kernel") || !strcasecmp(argv[c], "-U")) {
+            if ((c + 1) == argc)
+                goto usage;
+
+            if (!strcmp(argv[++c], "list")) {
+                bench_kernels_list();
+                return 0;
+            }
+            if (bench_kernel_add(argv[c]) < 0) {
+                printf("Unknown kernel '%s', or too many of them\n", argv[c]);
+                goto usage;
+            }
+#endif
+        } else if (!strcasecmp(argv[c], "--record") || !strcasecmp(argv[c], "--replay")) {
+            if ((c + 1) == argc)
+                goto usage;
+
+            replay_request(argv[c + 1], !strcasecmp(argv[c], "--record") ? REPLAY_RECORD : REPLAY_PLAY);
+            c++;
         } else if (!strcasecmp(argv[c], "--lastvmpath") || !strcasecmp(argv[c], "-Z")) {
             lvmp = 1;
 #ifdef _WIN32
@@ -617,6 +749,25 @@ usage:
                 goto usage;
 
             strcpy(log_path, argv[++c]);
+        } else if (!strcasecmp(argv[c], "--logmode") || !strcasecmp(argv[c], "-A")) {
+            if ((c + 1) == argc)
+                goto usage;
+
+            what = argv[++c];
+
+            if (!strcasecmp(what, "sync"))
+                log_mode = LOG_MODE_SYNC;
+            else if (!strcasecmp(what, "async"))
+                log_mode = LOG_MODE_ASYNC;
+            else if (!strcasecmp(what, "binary"))
+                log_mode = LOG_MODE_BINARY;
+            else
+                goto usage;
+        } else if (!strcasecmp(argv[c], "--lograte") || !strcasecmp(argv[c], "-Q")) {
+            if ((c + 1) == argc)
+                goto usage;
+
+            log_rate_limit = atoi(argv[++c]);
         } else if (!strcasecmp(argv[c], "--vmpath") || !strcasecmp(argv[c], "-P")) {
             if ((c + 1) == argc)
                 goto usage;
@@ -873,6 +1024,7 @@ usage:
      * This is where we start outputting to the log file,
      * if there is one. Create a little info header first.
      */
+    log_async_init();
     (void) time(&now);
     info = localtime(&now);
     strftime(temp, sizeof(temp), "%Y/%m/%d %H:%M:%S", info);
@@ -899,9 +1051,13 @@ usage:
     zip_global_init();
     mo_global_init();
 
+    pc_startup_phase("init");
+
     /* Load the configuration file. */
     config_load();
 
+    pc_startup_phase("configuration");
+
     /* Clear the CMOS and/or BIOS flash file, if we were started with
        the relevant parameter(s). */
     if (clear_cmos) {
@@ -985,19 +1141,8 @@ pc_init_modules(void)
         }
     }
 
-    pc_log("Scanning for ROM images:\n");
-    c = m = 0;
-    while (machine_get_internal_name_ex(m) != NULL) {
-        c += machine_available(m);
-        m++;
-    }
-    if (c == 0) {
-        /* No usable ROMs found, aborting. */
-        return 0;
-    }
-    pc_log("A total of %d ROM sets have been loaded.\n", c);
-
-    /* Load the ROMs for the selected machine. */
+    /* Only look for the ROMs of the selected machine, probing every
+       other one is left to the settings, which list what is there. */
     if (!machine_available(machine)) {
         swprintf(temp, sizeof_w(temp), plat_get_string(STRING_HW_NOT_AVAILABLE_MACHINE), machine_getname());
         c       = 0;
@@ -1012,8 +1157,8 @@ pc_init_modules(void)
             c++;
         }
         if (machine == -1) {
-            fatal("No available machines\n");
-            exit(-1);
+            /* No usable ROMs found, aborting. */
+            return 0;
         }
     }
 
@@ -1085,6 +1230,14 @@ pc_init_modules(void)
 
     machine_status_init();
 
+    perf_init();
+
+    evbus_init();
+
+    replay_init();
+
+    pc_startup_phase("modules");
+
     if (do_nothing) {
         do_nothing = 0;
         exit(-1);
@@ -1225,6 +1378,7 @@ pc_reset_hard_init(void)
     io_init();
 
     /* Turn on and (re)initialize timer processing. */
+    replay_reset();
     timer_init();
 
     device_init();
@@ -1356,6 +1510,8 @@ pc_reset_hard_init(void)
         pc_test_mode_entry_point();
 
     ui_hard_reset_completed();
+
+    pc_startup_phase("hard reset");
 }
 
 void
@@ -1415,6 +1571,10 @@ pc_close(UNUSED(thread_t *ptr))
 
     nvr_save();
 
+    snapshot_close();
+
+    replay_close();
+
     config_save();
 
     plat_mouse_capture(0);
@@ -1425,6 +1585,9 @@ pc_close(UNUSED(thread_t *ptr))
     /* Turn off timer processing to avoid potential segmentation faults. */
     timer_close();
 
+    io_port_stats_dump();
+    pic_stats_dump();
+
     lpt_devices_close();
 
     for (uint8_t i = 0; i < FDD_NUM; i++)
@@ -1458,6 +1621,18 @@ pc_close(UNUSED(thread_t *ptr))
     scsi_disk_close();
 
     gdbstub_close();
+
+    evbus_close();
+
+    pc_trace_stop();
+
+    perf_close();
+
+#if defined(USE_DYNAREC) && defined(USE_NEW_DYNAREC)
+    codegen_close();
+#endif
+
+    log_async_close();
 }
 
 #ifdef __APPLE__
@@ -1478,12 +1653,51 @@ ack_pause(void)
     }
 }
 
-void
-pc_run(void)
+/*
+ * Pick the length of the next CPU slice, in ms of emulated time. The
+ * adaptive mode runs short slices while the user is moving the mouse or
+ * the audio output is about to run dry, so input and sound are serviced
+ * more often, and longer ones when the host is falling behind, to cut
+ * the per-slice overhead. The throughput mode always runs long slices,
+ * for unattended runs where latency does not matter.
+ */
+static int
+pc_slice_ms(int backlog)
+{
+    switch (cpu_sched_mode) {
+        case SCHED_ADAPTIVE:
+            if (mouse_moved() || sound_buffers_low)
+                return 2;
+            if (backlog >= 20)
+                return 20;
+            return 10;
+
+        case SCHED_THROUGHPUT:
+            return 50;
+
+        default:
+            return 10;
+    }
+}
+
+/*
+ * Run one slice of emulation. The backlog is how far, in ms, emulation
+ * is behind real time. Returns the length of the slice that was run, in
+ * ms of emulated time.
+ */
+int
+pc_run(int backlog)
 {
     int     mouse_msg_idx;
+    int     slice = pc_slice_ms(backlog);
     wchar_t temp[200];
 
+    /* Save or load a snapshot if one was asked for. */
+    snapshot_process();
+
+    /* Record what the host has for the slice, or play back what it had. */
+    replay_slice(&slice);
+
     /* Trigger a hard reset if one is pending. */
     if (hard_reset_pending) {
         hard_reset_pending = 0;
@@ -1491,13 +1705,29 @@ pc_run(void)
         pc_reset_hard_init();
     }
 
+    /* Coming out of turbo mode, the emulated clock has run ahead of the host.
+       A replay keeps to the clock of the recording. */
+    if (turbo_was_on != turbo_mode) {
+        turbo_was_on = turbo_mode;
+        if (!turbo_mode && (time_sync & TIME_SYNC_ENABLED) && (replay_mode == REPLAY_OFF))
+            nvr_time_sync();
+    }
+
     /* Update the guest-CPU independent timer for devices with independent clock speed */
     rivatimer_update_all();
 
+    /* Wake up network cards with pending traffic. */
+    network_poll();
+
     /* Run a block of code. */
     startblit();
-    cpu_exec((int32_t) cpu_s->rspeed / 100);
+    MTR_BEGIN("cpu", "exec");
+    perf_enter(PERF_CPU);
+    cpu_exec((int32_t) (((uint64_t) cpu_s->rspeed * slice) / 1000));
+    perf_leave(PERF_IDLE);
+    MTR_END("cpu", "exec");
     ack_pause();
+    evbus_dispatch();
 #ifdef USE_GDBSTUB /* avoid a KBC FIFO overflow when CPU emulation is stalled */
     if (gdbstub_step == GDBSTUB_EXEC) {
 #endif
@@ -1509,9 +1739,12 @@ pc_run(void)
     joystick_process();
     endblit();
 
-    /* Done with this frame, update statistics. */
-    framecount++;
-    if (++framecountx >= 100) {
+    /* Done with this frame, update statistics - in ms, so that slices of any
+       length add up to the same speed percentage. */
+    framecount += slice;
+    framecountx += slice;
+    PERF_COUNT(emu_ms, slice);
+    if (framecountx >= 1000) {
         framecountx = 0;
         frames      = 0;
     }
@@ -1527,16 +1760,94 @@ pc_run(void)
 #endif
         title_update = 0;
     }
+
+    if (stats_update) {
+        stats_update = 0;
+        perf_tick();
+#if defined(USE_DYNAREC) && defined(USE_NEW_DYNAREC)
+        codegen_stats_tick();
+#endif
+    }
+
+    return slice;
+}
+
+/*
+ * Toggle turbo mode. While it is on, the main loop no longer paces
+ * emulation against the host clock, so the guest runs as fast as the
+ * host allows. Sound output is dropped and only every few frames are
+ * blitted, as neither can keep up anyway. The speed percentage in the
+ * window title shows how far ahead of real time emulation is running.
+ */
+void
+pc_set_turbo(int on)
+{
+    turbo_mode = !!on;
+}
+
+#ifdef MTR_ENABLED
+static int trace_active = 0;
+#endif
+
+/*
+ * Starts capturing a Chrome trace of the emulator threads into fn, which
+ * can be loaded into chrome://tracing or Perfetto once it is stopped.
+ * Returns -1 if a capture is already running, or this build can not
+ * trace at all.
+ */
+int
+pc_trace_start(const char *fn)
+{
+#ifdef MTR_ENABLED
+    if (trace_active)
+        return -1;
+
+    mtr_init(fn);
+    MTR_META_PROCESS_NAME(EMU_NAME);
+    mtr_start();
+    trace_active = 1;
+
+    return 0;
+#else
+    (void) fn;
+
+    return -1;
+#endif
+}
+
+/* Stops the capture, and writes out what is left of it. */
+void
+pc_trace_stop(void)
+{
+#ifdef MTR_ENABLED
+    if (!trace_active)
+        return;
+
+    mtr_stop();
+    mtr_shutdown();
+    trace_active = 0;
+#endif
+}
+
+int
+pc_trace_active(void)
+{
+#ifdef MTR_ENABLED
+    return trace_active;
+#else
+    return 0;
+#endif
 }
 
 /* Handler for the 1-second timer to refresh the window title. */
 void
 pc_onesec(void)
 {
-    fps        = framecount;
+    fps        = framecount / 10;
     framecount = 0;
 
     title_update = 1;
+    stats_update = 1;
 }
 
 void
@@ -31,6 +31,7 @@
 #include <86box/pic.h>
 #include <86box/plat.h>
 #include <86box/timer.h>
+#include <86box/replay.h>
 #include <86box/keyboard.h>
 #include <86box/nvr.h>
 #include <86box/pit.h>
@@ -48,7 +49,16 @@ int        acpi_rtc_status     = 0;
 atomic_int acpi_pwrbut_pressed = 0;
 int        acpi_enabled        = 0;
 
-static double cpu_to_acpi;
+/*
+ * The PM timer is read back-to-back by guests using it as their clock
+ * source, so it is computed from tsc with a 32.32 fixed point multiplier
+ * instead of a double. acpi_clock_adj keeps the count continuous across
+ * CPU speed changes and switches to and from host time.
+ */
+static uint64_t cpu_to_acpi;
+static uint64_t acpi_clock_adj  = 0ULL;
+static uint64_t acpi_host_adj   = 0ULL;
+static int      acpi_host_clock = 0;
 
 static int      acpi_power_on    = 0;
 static uint64_t acpi_last_clock  = 0ULL;
@@ -72,10 +82,59 @@ acpi_log(const char *fmt, ...)
 #    define acpi_log(fmt, ...)
 #endif
 
+static uint64_t
+acpi_tsc_clock(void)
+{
+    uint64_t t = (uint64_t) tsc;
+
+    return ((t >> 32) * cpu_to_acpi) + (((t & 0xffffffffULL) * cpu_to_acpi) >> 32);
+}
+
+static uint64_t
+acpi_host_clock_get(void)
+{
+    return (replay_clock(plat_get_ticks_us()) * ACPI_TIMER_FREQ) / 1000000ULL;
+}
+
+/*
+ * In turbo mode the emulated clock runs ahead of the host, and so does a
+ * guest clock source derived from it. With acpi_host_timer set, the count
+ * follows host time instead for as long as turbo mode is on.
+ */
 static uint64_t
 acpi_clock_get(void)
 {
-    return tsc * cpu_to_acpi;
+    int host = acpi_host_timer && turbo_mode;
+
+    if (host != acpi_host_clock) {
+        if (host)
+            acpi_host_adj = (acpi_tsc_clock() + acpi_clock_adj) - acpi_host_clock_get();
+        else
+            acpi_clock_adj = (acpi_host_clock_get() + acpi_host_adj) - acpi_tsc_clock();
+        acpi_host_clock = host;
+    }
+
+    if (host)
+        return acpi_host_clock_get() + acpi_host_adj;
+
+    return acpi_tsc_clock() + acpi_clock_adj;
+}
+
+static void
+acpi_set_clock_rate(void)
+{
+    uint64_t mul = (uint64_t) ((ACPI_TIMER_FREQ * 4294967296.0) / cpuclock);
+
+    if (mul == cpu_to_acpi)
+        return;
+
+    if (cpu_to_acpi != 0ULL) {
+        uint64_t old = acpi_tsc_clock();
+
+        cpu_to_acpi = mul;
+        acpi_clock_adj += old - acpi_tsc_clock();
+    } else
+        cpu_to_acpi = mul;
 }
 
 static uint32_t
@@ -1974,11 +2033,29 @@ acpi_aux_reg_write_common(int size, uint16_t addr, uint8_t val, void *priv)
         acpi_aux_reg_write_smc(size, addr, val, priv);
 }
 
+/* PMTMR is at offset 08h on every supported chipset. */
+static uint32_t
+acpi_pmtmr_read(acpi_t *dev)
+{
+    uint32_t ret = acpi_timer_get(dev);
+
+#ifdef USE_DYNAREC
+    if (cpu_use_dynarec)
+        update_tsc();
+#endif
+
+    return ret;
+}
+
 static uint32_t
 acpi_reg_readl(uint16_t addr, void *priv)
 {
+    acpi_t  *dev = (acpi_t *) priv;
     uint32_t ret = 0x00000000;
 
+    if (addr == (dev->io_base + 0x08))
+        return acpi_pmtmr_read(dev);
+
     ret = acpi_reg_read_common(4, addr, priv);
     ret |= (acpi_reg_read_common(4, addr + 1, priv) << 8);
     ret |= (acpi_reg_read_common(4, addr + 2, priv) << 16);
@@ -1992,8 +2069,12 @@ acpi_reg_readl(uint16_t addr, void *priv)
 static uint16_t
 acpi_reg_readw(uint16_t addr, void *priv)
 {
+    acpi_t  *dev = (acpi_t *) priv;
     uint16_t ret = 0x0000;
 
+    if ((addr & ~2) == (dev->io_base + 0x08))
+        return acpi_pmtmr_read(dev) >> ((addr & 2) << 3);
+
     ret = acpi_reg_read_common(2, addr, priv);
     ret |= (acpi_reg_read_common(2, addr + 1, priv) << 8);
 
@@ -2423,7 +2504,7 @@ static void
 acpi_speed_changed(void *priv)
 {
     acpi_t *dev        = (acpi_t *) priv;
-    cpu_to_acpi        = ACPI_TIMER_FREQ / cpuclock;
+    acpi_set_clock_rate();
     bool timer_enabled = timer_is_enabled(&dev->timer);
     timer_stop(&dev->timer);
 
@@ -2483,7 +2564,7 @@ acpi_init(const device_t *info)
     if (dev == NULL)
         return NULL;
 
-    cpu_to_acpi = ACPI_TIMER_FREQ / cpuclock;
+    acpi_set_clock_rate();
     dev->vendor = info->local;
 
     dev->irq_line = 9;
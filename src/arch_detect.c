@@ -23,5 +23,7 @@
 #    error ARCH i386
 #elif defined(__x86_64) || defined(__x86_64__) || defined(__amd64) || defined(_M_X64)
 #    error ARCH x86_64
+#elif defined(__riscv) && (__riscv_xlen == 64)
+#    error ARCH riscv64
 #endif
 #error ARCH unknown
@@ -0,0 +1,195 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Headless benchmark runner.
+ *
+ *          Emulation is paced against the host clock as usual, so every
+ *          run does the same work for the same amount of emulated time.
+ *          What changes from one build to the next is how much of the
+ *          host it takes to keep up, which is reported per thread, and
+ *          how far behind it fell, if it could not.
+ */
+#ifdef __linux__
+#    define _GNU_SOURCE
+#endif
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <wchar.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+#ifdef __linux__
+#    include <dirent.h>
+#    include <unistd.h>
+#endif
+#include <cJSON.h>
+#include <86box/86box.h>
+#include "cpu.h"
+#include <86box/machine.h>
+#include <86box/plat.h>
+#include <86box/video.h>
+#include <86box/bench.h>
+#include <86box/perf.h>
+
+bench_counters_t bench_counters;
+uint64_t         bench_run_ms = BENCH_RUN_MS;
+
+static uint64_t bench_emu_ms = 0;
+static uint64_t bench_ins    = 0; /* The counters as the run started. */
+static uint32_t bench_frames = 0;
+static uint64_t bench_start  = 0; /* Host time the run started at, in us. */
+static int      bench_done   = 0;
+
+static double
+bench_timeval_ms(const struct timeval *tv)
+{
+    return (tv->tv_sec * 1000.0) + (tv->tv_usec / 1000.0);
+}
+
+#ifdef __linux__
+/* Adds up the CPU time of every thread of the process, by its name. */
+static void
+bench_add_threads(cJSON *threads)
+{
+    DIR           *dir = opendir("/proc/self/task");
+    struct dirent *ent;
+    double         tick_ms = 1000.0 / sysconf(_SC_CLK_TCK);
+
+    if (dir == NULL)
+        return;
+
+    while ((ent = readdir(dir)) != NULL) {
+        char               path[64];
+        char               name[32] = "";
+        char               stat[1024];
+        char              *p;
+        unsigned long long utime;
+        unsigned long long stime;
+        cJSON             *item;
+        FILE              *fp;
+        size_t             len;
+
+        if (ent->d_name[0] == '.')
+            continue;
+
+        snprintf(path, sizeof(path), "/proc/self/task/%s/comm", ent->d_name);
+        if ((fp = fopen(path, "r")) != NULL) {
+            if (fgets(name, sizeof(name), fp) != NULL)
+                name[strcspn(name, "\n")] = 0;
+            fclose(fp);
+        }
+
+        snprintf(path, sizeof(path), "/proc/self/task/%s/stat", ent->d_name);
+        if ((fp = fopen(path, "r")) == NULL)
+            continue;
+        len = fread(stat, 1, sizeof(stat) - 1, fp);
+        fclose(fp);
+        stat[len] = 0;
+
+        /* The name in there may hold spaces and brackets of its own,
+           utime and stime are the 12th and 13th fields after it. */
+        if (((p = strrchr(stat, ')')) == NULL) ||
+            (sscanf(p + 1, " %*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %llu %llu", &utime, &stime) != 2))
+            continue;
+
+        if (!name[0])
+            strcpy(name, "(unnamed)");
+
+        item = cJSON_GetObjectItemCaseSensitive(threads, name);
+        if (item != NULL)
+            cJSON_SetNumberValue(item, item->valuedouble + ((utime + stime) * tick_ms));
+        else
+            cJSON_AddNumberToObject(threads, name, (utime + stime) * tick_ms);
+    }
+
+    closedir(dir);
+}
+#endif
+
+static void
+bench_report(void)
+{
+    cJSON          *root    = cJSON_CreateObject();
+    cJSON          *host    = cJSON_CreateObject();
+    cJSON          *threads = cJSON_CreateObject();
+    struct rusage   ru;
+    struct timespec ts;
+    double          wall_ms = (plat_get_ticks_us() - bench_start) / 1000.0;
+    double          emu_s   = bench_emu_ms / 1000.0;
+    uint64_t        ins     = perf_counters.ins - bench_ins;
+    uint32_t        frames  = perf_frames_presented() - bench_frames;
+    char           *out;
+
+    cJSON_AddStringToObject(root, "machine", machine_get_internal_name());
+    cJSON_AddStringToObject(root, "cpu", cpu_s->name);
+    cJSON_AddStringToObject(root, "video", video_get_internal_name(gfxcard[0]));
+    cJSON_AddNumberToObject(root, "emulated_ms", (double) bench_emu_ms);
+    cJSON_AddNumberToObject(root, "wall_ms", wall_ms);
+    cJSON_AddNumberToObject(root, "speed_pct", (wall_ms > 0.0) ? ((bench_emu_ms * 100.0) / wall_ms) : 0.0);
+#ifdef USE_DYNAREC
+    cJSON_AddBoolToObject(root, "dynarec", cpu_use_dynarec);
+#endif
+
+    cJSON_AddNumberToObject(root, "guest_mips", ins / (emu_s * 1000000.0));
+    cJSON_AddNumberToObject(root, "instructions", (double) ins);
+    cJSON_AddNumberToObject(root, "frames", (double) frames);
+    cJSON_AddNumberToObject(root, "fps", frames / emu_s);
+    cJSON_AddNumberToObject(root, "timer_events", (double) bench_counters.timer_events);
+    cJSON_AddNumberToObject(root, "audio_buffers", (double) bench_counters.audio_buffers);
+
+    /* All of the host CPU times are in ms. */
+    if (getrusage(RUSAGE_SELF, &ru) == 0) {
+        cJSON_AddNumberToObject(host, "user_ms", bench_timeval_ms(&ru.ru_utime));
+        cJSON_AddNumberToObject(host, "system_ms", bench_timeval_ms(&ru.ru_stime));
+    }
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) == 0)
+        cJSON_AddNumberToObject(host, "emulation_ms", (ts.tv_sec * 1000.0) + (ts.tv_nsec / 1000000.0));
+#ifdef __linux__
+    bench_add_threads(threads);
+#endif
+    cJSON_AddItemToObject(host, "threads", threads);
+    cJSON_AddItemToObject(root, "host_cpu", host);
+
+    out = cJSON_Print(root);
+    if (out != NULL) {
+        printf("%s\n", out);
+        fflush(stdout);
+        cJSON_free(out);
+    }
+
+    cJSON_Delete(root);
+}
+
+void
+bench_init(void)
+{
+    memset(&bench_counters, 0x00, sizeof(bench_counters));
+    bench_emu_ms = 0;
+    bench_ins    = perf_counters.ins;
+    bench_frames = perf_frames_presented();
+    bench_start  = plat_get_ticks_us();
+    bench_done   = 0;
+}
+
+int
+bench_slice(int ms)
+{
+    if (bench_done)
+        return 0;
+
+    bench_emu_ms += ms;
+    if (bench_emu_ms < bench_run_ms)
+        return 0;
+
+    bench_report();
+    bench_done = 1;
+
+    return 1;
+}
@@ -0,0 +1,1336 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Micro-benchmarks of the hot emulation kernels.
+ *
+ *          Each kernel drives one piece of the emulator directly, with
+ *          no guest code (other than its own, for the recompiler) and no
+ *          pacing, so a change to that piece shows up on its own, and in
+ *          a few seconds. They run on the configured machine, as it is
+ *          after a hard reset, with its timers dropped. Devices that a
+ *          kernel adds stay there for the kernels that come after it.
+ *
+ *          Every kernel is run once to warm up, and then for as long as
+ *          asked. The results are printed as JSON.
+ */
+#ifdef __linux__
+#    define _GNU_SOURCE
+#endif
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <wchar.h>
+#include <cJSON.h>
+#include <86box/86box.h>
+#include "cpu.h"
+#include "x86seg.h"
+#include <86box/ini.h>
+#include <86box/config.h>
+#include <86box/device.h>
+#include <86box/io.h>
+#include <86box/mem.h>
+#include <86box/rom.h>
+#include <86box/timer.h>
+#include <86box/machine.h>
+#include <86box/plat.h>
+#include <86box/thread.h>
+#include <86box/video.h>
+#include <86box/vid_svga.h>
+#include <86box/vid_svga_render.h>
+#include <86box/vid_svga_render_remap.h>
+#include <86box/vid_voodoo_common.h>
+#include <86box/vid_voodoo_regs.h>
+#include <86box/vid_voodoo_render.h>
+#include <86box/vid_voodoo_texture.h>
+#include <86box/sound.h>
+#include <86box/snd_opl.h>
+#include <86box/snd_emu8k.h>
+#include <86box/bench.h>
+#include <86box/perf.h>
+
+#define BENCH_KERNELS_MAX 32
+#define BENCH_ARGS_MAX    16
+
+#define BENCH_TIME_MS        500 /* Time to measure every kernel for, by default. */
+#define BENCH_ITERATIONS_MIN 3
+
+typedef struct bench_args_t {
+    int    num;
+    char  *key[BENCH_ARGS_MAX];
+    char  *val[BENCH_ARGS_MAX];
+    int    used[BENCH_ARGS_MAX];
+    cJSON *params; /* What the kernel ran with, defaults included. */
+} bench_args_t;
+
+typedef struct bench_kernel_t {
+    const char *name;
+    const char *unit;
+    const char *params;
+    const char *desc;
+
+    /* Returns NULL, and why, if the kernel can not run here. */
+    void    *(*init)(bench_args_t *args, const char **why);
+    /* Returns the units of work done. */
+    uint64_t (*run)(void *priv);
+    void     (*close)(void *priv);
+} bench_kernel_t;
+
+typedef struct bench_request_t {
+    const bench_kernel_t *kernel;
+    char                 *spec; /* Our copy, which the arguments point into. */
+    bench_args_t          args;
+} bench_request_t;
+
+int bench_kernels_num = 0;
+
+static bench_request_t bench_requests[BENCH_KERNELS_MAX];
+
+static uint64_t
+bench_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ((uint64_t) ts.tv_sec * 1000000000ULL) + ts.tv_nsec;
+}
+
+/* The same data on every run, so runs compare. */
+static uint32_t
+bench_rand(uint32_t *state)
+{
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+
+    return *state;
+}
+
+static int
+bench_arg_find(bench_args_t *args, const char *key)
+{
+    for (int i = 0; i < args->num; i++) {
+        if (!strcmp(args->key[i], key)) {
+            args->used[i] = 1;
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+static int
+bench_arg_int(bench_args_t *args, const char *key, int def)
+{
+    int i   = bench_arg_find(args, key);
+    int val = (i < 0) ? def : (int) strtol(args->val[i], NULL, 0);
+
+    cJSON_AddNumberToObject(args->params, key, val);
+
+    return val;
+}
+
+static const char *
+bench_arg_str(bench_args_t *args, const char *key, const char *def)
+{
+    int         i   = bench_arg_find(args, key);
+    const char *val = (i < 0) ? def : args->val[i];
+
+    cJSON_AddStringToObject(args->params, key, val);
+
+    return val;
+}
+
+/* SVGA line rendering, from VRAM to the screen bitmap. */
+#define BENCH_SVGA_VRAM (8 << 20)
+
+typedef struct bench_svga_t {
+    svga_t    svga;
+    monitor_t monitor;
+    void    (*render)(svga_t *svga);
+    uint32_t  pitch;
+    int       width;
+    int       height;
+} bench_svga_t;
+
+static void *
+bench_svga_init(bench_args_t *args, const char **why)
+{
+    int           bpp    = bench_arg_int(args, "bpp", 8);
+    int           width  = bench_arg_int(args, "width", 640);
+    int           height = bench_arg_int(args, "height", 480);
+    int           remap  = bench_arg_int(args, "remap", 0);
+    uint32_t      seed   = 0x86b0c5e1;
+    bench_svga_t *dev;
+    svga_t       *svga;
+
+    if ((width < 64) || (width > 2048) || (width & 7) || (height < 1) || (height > 2048)) {
+        *why = "width must be a multiple of 8 from 64 to 2048, height from 1 to 2048";
+        return NULL;
+    }
+
+    dev = (bench_svga_t *) calloc(1, sizeof(bench_svga_t));
+
+    switch (bpp) {
+        case 4:
+            dev->render = svga_render_4bpp_highres;
+            dev->pitch  = width >> 1;
+            break;
+        case 8:
+            dev->render = svga_render_8bpp_highres;
+            dev->pitch  = width;
+            break;
+        case 15:
+            dev->render = svga_render_15bpp_highres;
+            dev->pitch  = width << 1;
+            break;
+        case 16:
+            dev->render = svga_render_16bpp_highres;
+            dev->pitch  = width << 1;
+            break;
+        case 24:
+            dev->render = svga_render_24bpp_highres;
+            dev->pitch  = width * 3;
+            break;
+        case 32:
+            dev->render = svga_render_32bpp_highres;
+            dev->pitch  = width << 2;
+            break;
+        default:
+            free(dev);
+            *why = "bpp must be 4, 8, 15, 16, 24 or 32";
+            return NULL;
+    }
+
+    dev->width  = width;
+    dev->height = height;
+
+    svga                    = &dev->svga;
+    svga->vram              = (uint8_t *) malloc(BENCH_SVGA_VRAM);
+    svga->changedvram       = (uint8_t *) calloc((BENCH_SVGA_VRAM >> 12) + 1, 1);
+    svga->vram_mask         = BENCH_SVGA_VRAM - 1;
+    svga->vram_display_mask = BENCH_SVGA_VRAM - 1;
+    for (uint32_t c = 0; c < BENCH_SVGA_VRAM; c += 4)
+        *(uint32_t *) &svga->vram[c] = bench_rand(&seed);
+
+    for (int c = 0; c < 256; c++)
+        svga->pallook[c] = bench_rand(&seed) & 0xffffff;
+    for (int c = 0; c < 16; c++)
+        svga->egapal[c] = c;
+    svga->map8           = svga->pallook;
+    svga->conv_16to32    = svga_conv_16to32;
+    svga->dac_mask       = 0xff;
+    svga->plane_mask     = 0x0f;
+    svga->attrregs[0x10] = 0x01;
+    svga->gdcreg[0x05]   = (bpp == 8) ? 0x40 : 0x00;
+    svga->packed_chain4  = (bpp == 8);
+    /* Byte mode maps addresses straight through, word mode has them remapped. */
+    svga->crtc[0x17]     = remap ? 0xa3 : 0xe3;
+    svga->hdisp          = width;
+    svga->fullchange     = 1;
+    svga_recalc_remap_func(svga);
+
+    /* The renderers may go a character past the end of the line. */
+    dev->monitor.target_buffer = create_bitmap(width + 64, height);
+    svga->monitor              = &dev->monitor;
+
+    return dev;
+}
+
+static uint64_t
+bench_svga_run(void *priv)
+{
+    bench_svga_t *dev  = (bench_svga_t *) priv;
+    svga_t       *svga = &dev->svga;
+
+    svga->firstline_draw = 2000;
+
+    for (int y = 0; y < dev->height; y++) {
+        svga->displine = y;
+        svga->sc       = 0;
+        svga->ma       = (y * dev->pitch) & svga->vram_display_mask;
+        dev->render(svga);
+    }
+
+    return (uint64_t) dev->width * dev->height;
+}
+
+static void
+bench_svga_close(void *priv)
+{
+    bench_svga_t *dev = (bench_svga_t *) priv;
+
+    destroy_bitmap(dev->monitor.target_buffer);
+    free(dev->svga.changedvram);
+    free(dev->svga.vram);
+    free(dev);
+}
+
+/* Voodoo triangle rasterisation, on the render path of the card. */
+#define BENCH_VOODOO_W      640
+#define BENCH_VOODOO_H      480
+#define BENCH_VOODOO_STRIDE 2048 /* Bytes per line, as the card has them. */
+
+#define BENCH_FBZ_DEPTH      (FBZ_DEPTH_ENABLE | FBZ_DEPTH_WMASK | (DEPTHOP_LESSTHANEQUAL << 5))
+#define BENCH_CC_COLOR1      (C_SEL_COLOR1 | (A_SEL_COLOR1 << 2))
+#define BENCH_CC_TEXTURE     (FBZCP_TEXTURE_ENABLED | C_SEL_TEX | (A_SEL_TEX << 2))
+#define BENCH_CC_TEXTURE_RGB (FBZCP_TEXTURE_ENABLED | C_SEL_TEX | (A_SEL_ITER_A << 2))
+#define BENCH_TEX_POINT      (TEXTUREMODE_LOCAL | (TEX_R5G6B5 << 8))
+#define BENCH_TEX_BILINEAR   (BENCH_TEX_POINT | 6)
+#define BENCH_ALPHA_BLEND    ((1 << 4) | (AFUNC_ASRC_ALPHA << 8) | (AFUNC_AOMSRC_ALPHA << 12))
+
+static const struct {
+    const char *name;
+    uint32_t    fbzMode;
+    uint32_t    fbzColorPath;
+    uint32_t    alphaMode;
+    uint32_t    textureMode;
+} bench_voodoo_states[] = {
+    { "flat",     0,               BENCH_CC_COLOR1,      0,                 0                  },
+    { "gouraud",  0,               0,                    0,                 0                  },
+    { "zbuffer",  BENCH_FBZ_DEPTH, 0,                    0,                 0                  },
+    { "textured", BENCH_FBZ_DEPTH, BENCH_CC_TEXTURE,     0,                 BENCH_TEX_POINT    },
+    { "bilinear", BENCH_FBZ_DEPTH, BENCH_CC_TEXTURE,     0,                 BENCH_TEX_BILINEAR },
+    { "blend",    BENCH_FBZ_DEPTH, BENCH_CC_TEXTURE_RGB, BENCH_ALPHA_BLEND, BENCH_TEX_BILINEAR },
+    { NULL,       0,               0,                    0,                 0                  }
+};
+
+typedef struct bench_vertex_t {
+    double x, y, r, g, b, a, z, s, t;
+} bench_vertex_t;
+
+typedef struct bench_voodoo_t {
+    voodoo_t *voodoo;
+    int       size;
+    int       count;
+} bench_voodoo_t;
+
+/* What the triangle setup of the Voodoo 2 does, for vertices sorted by y. */
+static void
+bench_voodoo_setup(voodoo_params_t *params, const bench_vertex_t *v)
+{
+    double dxAB = v[0].x - v[1].x;
+    double dxBC = v[1].x - v[2].x;
+    double dyAB = v[0].y - v[1].y;
+    double dyBC = v[1].y - v[2].y;
+    double area = (dxAB * dyBC) - (dxBC * dyAB);
+
+    dxAB /= area;
+    dxBC /= area;
+    dyAB /= area;
+    dyBC /= area;
+
+#define BENCH_DX(p) (((v[0].p - v[1].p) * dyBC) - ((v[1].p - v[2].p) * dyAB))
+#define BENCH_DY(p) (((v[1].p - v[2].p) * dxAB) - ((v[0].p - v[1].p) * dxBC))
+    params->vertexAx = (int32_t) (v[0].x * 16.0);
+    params->vertexAy = (int32_t) (v[0].y * 16.0);
+    params->vertexBx = (int32_t) (v[1].x * 16.0);
+    params->vertexBy = (int32_t) (v[1].y * 16.0);
+    params->vertexCx = (int32_t) (v[2].x * 16.0);
+    params->vertexCy = (int32_t) (v[2].y * 16.0);
+    params->sign     = (area < 0.0);
+
+    params->startR = (uint32_t) (v[0].r * 4096.0);
+    params->dRdX   = (int32_t) (BENCH_DX(r) * 4096.0);
+    params->dRdY   = (int32_t) (BENCH_DY(r) * 4096.0);
+    params->startG = (uint32_t) (v[0].g * 4096.0);
+    params->dGdX   = (int32_t) (BENCH_DX(g) * 4096.0);
+    params->dGdY   = (int32_t) (BENCH_DY(g) * 4096.0);
+    params->startB = (uint32_t) (v[0].b * 4096.0);
+    params->dBdX   = (int32_t) (BENCH_DX(b) * 4096.0);
+    params->dBdY   = (int32_t) (BENCH_DY(b) * 4096.0);
+    params->startA = (uint32_t) (v[0].a * 4096.0);
+    params->dAdX   = (int32_t) (BENCH_DX(a) * 4096.0);
+    params->dAdY   = (int32_t) (BENCH_DY(a) * 4096.0);
+    params->startZ = (uint32_t) (v[0].z * 4096.0);
+    params->dZdX   = (int32_t) (BENCH_DX(z) * 4096.0);
+    params->dZdY   = (int32_t) (BENCH_DY(z) * 4096.0);
+
+    /* No perspective, W is 1 all over. */
+    params->startW = (int64_t) 4294967296.0;
+    params->dWdX   = 0;
+    params->dWdY   = 0;
+
+    params->tmu[0].startS = (int64_t) (v[0].s * 4294967296.0);
+    params->tmu[0].dSdX   = (int64_t) (BENCH_DX(s) * 4294967296.0);
+    params->tmu[0].dSdY   = (int64_t) (BENCH_DY(s) * 4294967296.0);
+    params->tmu[0].startT = (int64_t) (v[0].t * 4294967296.0);
+    params->tmu[0].dTdX   = (int64_t) (BENCH_DX(t) * 4294967296.0);
+    params->tmu[0].dTdY   = (int64_t) (BENCH_DY(t) * 4294967296.0);
+    params->tmu[0].startW = params->startW;
+    params->tmu[0].dWdX   = 0;
+    params->tmu[0].dWdY   = 0;
+    params->tmu[1]        = params->tmu[0];
+#undef BENCH_DX
+#undef BENCH_DY
+}
+
+static void *
+bench_voodoo_init(bench_args_t *args, const char **why)
+{
+    const char      *state = bench_arg_str(args, "state", "gouraud");
+    int              size  = bench_arg_int(args, "size", 128);
+    int              count = bench_arg_int(args, "count", 16);
+    bench_voodoo_t  *dev;
+    voodoo_set_t    *set;
+    voodoo_t        *voodoo;
+    voodoo_params_t *params;
+    uint32_t         seed = 0x3dfc0de5;
+    int              st;
+
+    for (st = 0; bench_voodoo_states[st].name != NULL; st++) {
+        if (!strcmp(state, bench_voodoo_states[st].name))
+            break;
+    }
+
+    if (bench_voodoo_states[st].name == NULL) {
+        *why = "state must be flat, gouraud, zbuffer, textured, bilinear or blend";
+        return NULL;
+    }
+    if ((size < 8) || (size >= BENCH_VOODOO_H) || (count < 1) || (count > 4096)) {
+        *why = "size must be from 8 to 479, count from 1 to 4096";
+        return NULL;
+    }
+    if (!machine_has_bus(machine, MACHINE_BUS_PCI)) {
+        *why = "the machine has no PCI bus";
+        return NULL;
+    }
+
+    set    = (voodoo_set_t *) device_add(&voodoo_device);
+    voodoo = set->voodoos[0];
+#ifndef NO_CODEGEN
+    voodoo->use_recompiler = bench_arg_int(args, "jit", voodoo->use_recompiler);
+#endif
+
+    /* One 256x256 16-bit texture at the bottom of every TMU. */
+    for (int c = 0; c < (256 * 256); c++) {
+        uint16_t texel = (uint16_t) bench_rand(&seed);
+
+        voodoo->tex_mem_w[0][c] = texel;
+        if (voodoo->dual_tmus)
+            voodoo->tex_mem_w[1][c] = texel;
+    }
+
+    params = &voodoo->params;
+    memset(params, 0x00, sizeof(voodoo_params_t));
+    params->fbzMode       = 1 | FBZ_RGB_WMASK | bench_voodoo_states[st].fbzMode;
+    params->fbzColorPath  = bench_voodoo_states[st].fbzColorPath;
+    params->alphaMode     = bench_voodoo_states[st].alphaMode;
+    params->color1        = 0xff8040c0;
+    params->clipRight     = BENCH_VOODOO_W;
+    params->clipHighY     = BENCH_VOODOO_H;
+    params->row_width     = BENCH_VOODOO_STRIDE;
+    params->aux_row_width = BENCH_VOODOO_STRIDE;
+    params->aux_offset    = BENCH_VOODOO_STRIDE * 512;
+    for (int tmu = 0; tmu < (voodoo->dual_tmus ? 2 : 1); tmu++) {
+        params->textureMode[tmu] = bench_voodoo_states[st].textureMode;
+        params->tformat[tmu]     = TEX_R5G6B5;
+        voodoo_recalc_tex12(voodoo, tmu);
+    }
+
+    dev         = (bench_voodoo_t *) calloc(1, sizeof(bench_voodoo_t));
+    dev->voodoo = voodoo;
+    dev->size   = size;
+    dev->count  = count;
+
+    return dev;
+}
+
+static uint64_t
+bench_voodoo_run(void *priv)
+{
+    bench_voodoo_t  *dev    = (bench_voodoo_t *) priv;
+    voodoo_t        *voodoo = dev->voodoo;
+    voodoo_params_t *params = &voodoo->params;
+    uint32_t         pixels = 0;
+    double           size   = dev->size;
+    static const double corners[2][3][2] = {
+        { { 0.0, 0.0 }, { 1.0, 0.0 }, { 0.0, 1.0 } },
+        { { 1.0, 0.0 }, { 0.0, 1.0 }, { 1.0, 1.0 } }
+    };
+
+    for (int c = 0; c < voodoo->render_threads; c++)
+        pixels -= voodoo->pixel_count[c];
+
+    /* Squares across the screen, in two triangles each. */
+    for (int i = 0; i < dev->count; i++) {
+        double         x0 = ((i >> 1) * 97) % (BENCH_VOODOO_W - dev->size);
+        double         y0 = ((i >> 1) * 61) % (BENCH_VOODOO_H - dev->size);
+        bench_vertex_t v[3];
+
+        for (int c = 0; c < 3; c++) {
+            double u = corners[i & 1][c][0];
+            double w = corners[i & 1][c][1];
+
+            v[c].x = x0 + (u * size);
+            v[c].y = y0 + (w * size);
+            v[c].r = u * 255.0;
+            v[c].g = w * 255.0;
+            v[c].b = (1.0 - u) * 255.0;
+            v[c].a = 128.0;
+            v[c].z = 32768.0 + (u * 4096.0);
+            v[c].s = u * 256.0;
+            v[c].t = w * 256.0;
+        }
+
+        bench_voodoo_setup(params, v);
+
+        /* As voodoo_queue_triangle() does, but with every band rendered
+           right here, rather than on the render threads. */
+        voodoo_use_texture(voodoo, params, 0);
+        if (voodoo->dual_tmus)
+            voodoo_use_texture(voodoo, params, 1);
+        for (int c = 0; c < voodoo->render_threads; c++)
+            voodoo_triangle(voodoo, params, c);
+    }
+
+    for (int c = 0; c < voodoo->render_threads; c++)
+        pixels += voodoo->pixel_count[c];
+
+    return pixels;
+}
+
+static void
+bench_free(void *priv)
+{
+    free(priv);
+}
+
+/* The x86 recompiler, on a few small loops of guest code. */
+#ifdef USE_DYNAREC
+#    define BENCH_CODE_SEG  0x0800 /* At 0x8000, with its data right after it. */
+#    define BENCH_CODE_BASE (BENCH_CODE_SEG << 4)
+#    define BENCH_CODE(s)   (int) (sizeof(s) - 1), (const uint8_t *) s
+
+static const struct {
+    const char    *name;
+    int            fpu;
+    int            setup_len;
+    const uint8_t *setup;
+    int            body_len;
+    const uint8_t *body;
+} bench_code_streams[] = {
+  /* add ax,bx; xor cx,ax; sub dx,cx; shl ax,1; inc bx; and si,dx; or di,si; dec dx; add ax,di */
+    { "alu", 0, BENCH_CODE(""),
+      BENCH_CODE("\x01\xd8\x31\xc1\x29\xca\xd1\xe0\x43\x21\xd6\x09\xf7\x4a\x01\xf8") },
+  /* mov si,0x1000; mov di,0x1800
+     mov ax,[si]; mov [di+2],ax; add bx,[si+4]; mov [di],bx; add si,2; and si,0x13fe */
+    { "mem", 0, BENCH_CODE("\xbe\x00\x10\xbf\x00\x18"),
+      BENCH_CODE("\x8b\x04\x89\x45\x02\x03\x5c\x04\x89\x1d\x83\xc6\x02\x81\xe6\xfe\x13") },
+  /* mov sp,0x2000; xor ax,ax
+     inc ax; test al,1; jz $+3; inc bx; test al,2; jnz $+3; inc cx; call $+5; jmp $+3; ret */
+    { "branch", 0, BENCH_CODE("\xbc\x00\x20\x31\xc0"),
+      BENCH_CODE("\x40\xa8\x01\x74\x01\x43\xa8\x02\x75\x01\x41\xe8\x02\x00\xeb\x01\xc3") },
+  /* fninit; mov si,0x1000
+     fld dword [si]; fadd dword [si+4]; fmul dword [si+8]; fstp dword [si+12]; fld1; fldz; fmulp; fstp st0 */
+    { "fpu", 1, BENCH_CODE("\xdb\xe3\xbe\x00\x10"),
+      BENCH_CODE("\xd9\x04\xd8\x44\x04\xd8\x4c\x08\xd9\x5c\x0c\xd9\xe8\xd9\xee\xde\xc9\xdd\xd8") },
+    { NULL, 0, 0, NULL, 0, NULL }
+};
+
+typedef struct bench_codegen_t {
+    int translate;
+    int cycs;
+} bench_codegen_t;
+
+static void *
+bench_codegen_init(bench_args_t *args, const char **why)
+{
+    const char      *stream = bench_arg_str(args, "stream", "alu");
+    const char      *mode   = bench_arg_str(args, "mode", "execute");
+    int              cycs   = bench_arg_int(args, "cycles", 100000);
+    bench_codegen_t *dev;
+    uint32_t         addr = BENCH_CODE_BASE;
+    int              s;
+
+    for (s = 0; bench_code_streams[s].name != NULL; s++) {
+        if (!strcmp(stream, bench_code_streams[s].name))
+            break;
+    }
+
+    if (bench_code_streams[s].name == NULL) {
+        *why = "stream must be alu, mem, branch or fpu";
+        return NULL;
+    }
+    if (strcmp(mode, "execute") && strcmp(mode, "translate")) {
+        *why = "mode must be execute or translate";
+        return NULL;
+    }
+    if (cycs < 1000) {
+        *why = "cycles must be at least 1000";
+        return NULL;
+    }
+    if (!cpu_use_dynarec) {
+        *why = "the CPU does not use the recompiler";
+        return NULL;
+    }
+    if (msw & 1) {
+        *why = "the CPU is not in real mode";
+        return NULL;
+    }
+    if (bench_code_streams[s].fpu && !hasfpu) {
+        *why = "the CPU has no FPU";
+        return NULL;
+    }
+
+    /* push cs; pop ds, the setup, and then the body, looping forever. */
+    mem_writeb_phys(addr++, 0x0e);
+    mem_writeb_phys(addr++, 0x1f);
+    for (int c = 0; c < bench_code_streams[s].setup_len; c++)
+        mem_writeb_phys(addr++, bench_code_streams[s].setup[c]);
+    for (int c = 0; c < bench_code_streams[s].body_len; c++)
+        mem_writeb_phys(addr++, bench_code_streams[s].body[c]);
+    mem_writeb_phys(addr++, 0xeb);
+    mem_writeb_phys(addr++, (uint8_t) -(bench_code_streams[s].body_len + 2));
+
+    /* The data, as 1.5f, which keeps the FPU off the slow paths. */
+    for (addr = BENCH_CODE_BASE + 0x1000; addr < (BENCH_CODE_BASE + 0x2000); addr += 4)
+        mem_writel_phys(addr, 0x3fc00000);
+
+    loadcs(BENCH_CODE_SEG);
+    cpu_state.pc = 0;
+    cpu_state.flags &= ~I_FLAG;
+    codegen_reset();
+
+    dev            = (bench_codegen_t *) calloc(1, sizeof(bench_codegen_t));
+    dev->translate = !strcmp(mode, "translate");
+    dev->cycs      = cycs;
+
+    return dev;
+}
+
+static uint64_t
+bench_codegen_run(void *priv)
+{
+    bench_codegen_t *dev = (bench_codegen_t *) priv;
+    uint64_t         ins = perf_counters.ins;
+
+    /* Throwing the blocks away makes every pass translate them again. */
+    if (dev->translate)
+        codegen_reset();
+
+    cpu_exec(dev->cycs);
+
+    return perf_counters.ins - ins;
+}
+#endif
+
+/* OPL2 and OPL3 synthesis, as the music buffer asks for it. */
+typedef struct bench_opl_t {
+    fm_drv_t drv;
+} bench_opl_t;
+
+static void
+bench_opl_write(bench_opl_t *dev, uint16_t reg, uint8_t val)
+{
+    uint16_t bank = (reg & 0x100) ? 2 : 0;
+
+    dev->drv.write(bank, reg & 0xff, dev->drv.priv);
+    dev->drv.write(bank + 1, val, dev->drv.priv);
+}
+
+static void *
+bench_opl_init(bench_args_t *args, const char **why)
+{
+    const char  *chip   = bench_arg_str(args, "chip", "opl3");
+    const char  *driver = bench_arg_str(args, "driver", (fm_driver == FM_DRV_YMFM) ? "ymfm" : "nuked");
+    int          opl3   = !strcmp(chip, "opl3");
+    int          voices = bench_arg_int(args, "voices", opl3 ? 18 : 9);
+    int          old_driver = fm_driver;
+    int          old_thread = fm_synth_thread;
+    bench_opl_t *dev;
+
+    if (!opl3 && strcmp(chip, "opl2")) {
+        *why = "chip must be opl2 or opl3";
+        return NULL;
+    }
+    if (strcmp(driver, "nuked") && strcmp(driver, "ymfm")) {
+        *why = "driver must be nuked or ymfm";
+        return NULL;
+    }
+    if ((voices < 1) || (voices > (opl3 ? 18 : 9))) {
+        *why = "voices must be from 1 to 9, or to 18 on an OPL3";
+        return NULL;
+    }
+
+    dev = (bench_opl_t *) calloc(1, sizeof(bench_opl_t));
+
+    /* Synthesis has to happen in here, not on a thread of its own. */
+    fm_driver       = strcmp(driver, "ymfm") ? FM_DRV_NUKED : FM_DRV_YMFM;
+    fm_synth_thread = 0;
+    fm_driver_get(opl3 ? FM_YMF262 : FM_YM3812, &dev->drv);
+    fm_driver       = old_driver;
+    fm_synth_thread = old_thread;
+
+    music_pos_global = 0;
+
+    if (opl3)
+        bench_opl_write(dev, 0x105, 0x01);
+    else
+        bench_opl_write(dev, 0x001, 0x20);
+
+    /* Every voice sustains a tone of its own, with a waveform of its own. */
+    for (int v = 0; v < voices; v++) {
+        uint16_t bank = (v >= 9) ? 0x100 : 0x000;
+        int      ch   = v % 9;
+        int      op   = (ch % 3) + ((ch / 3) * 8);
+        uint16_t fnum = 0x200 + (v * 0x18);
+
+        for (int c = 0; c < 2; c++) {
+            bench_opl_write(dev, bank | (0x20 + op + (c * 3)), 0x21);
+            bench_opl_write(dev, bank | (0x40 + op + (c * 3)), 0x10);
+            bench_opl_write(dev, bank | (0x60 + op + (c * 3)), 0xf1);
+            bench_opl_write(dev, bank | (0x80 + op + (c * 3)), 0x0f);
+            bench_opl_write(dev, bank | (0xe0 + op + (c * 3)), (v + c) & (opl3 ? 7 : 3));
+        }
+        bench_opl_write(dev, bank | (0xc0 + ch), 0x31);
+        bench_opl_write(dev, bank | (0xa0 + ch), fnum & 0xff);
+        bench_opl_write(dev, bank | (0xb0 + ch), 0x20 | (4 << 2) | (fnum >> 8));
+    }
+
+    return dev;
+}
+
+static uint64_t
+bench_opl_run(void *priv)
+{
+    bench_opl_t *dev = (bench_opl_t *) priv;
+    int          pos = music_pos_global;
+
+    dev->drv.reset_buffer(dev->drv.priv);
+    music_pos_global = MUSICBUFLEN;
+    (void) dev->drv.update(dev->drv.priv);
+    music_pos_global = pos;
+
+    return MUSICBUFLEN;
+}
+
+/* EMU8000 synthesis, from the AWE32 sample ROM. */
+#define BENCH_EMU8K_BASE 0x680
+
+static void
+bench_emu8k_outw(int port, int reg, int voice, uint16_t val)
+{
+    outw(BENCH_EMU8K_BASE + 0x802, (reg << 5) | voice);
+    outw(BENCH_EMU8K_BASE + port, val);
+}
+
+static void
+bench_emu8k_outl(int port, int reg, int voice, uint32_t val)
+{
+    outw(BENCH_EMU8K_BASE + 0x802, (reg << 5) | voice);
+    outw(BENCH_EMU8K_BASE + port, val & 0xffff);
+    outw(BENCH_EMU8K_BASE + port + 2, val >> 16);
+}
+
+static void *
+bench_emu8k_init(bench_args_t *args, const char **why)
+{
+    int      voices = bench_arg_int(args, "voices", 32);
+    int      pos    = wavetable_pos_global;
+    emu8k_t *emu8k;
+
+    if ((voices < 1) || (voices > 32)) {
+        *why = "voices must be from 1 to 32";
+        return NULL;
+    }
+    if (!rom_present(EMU8K_ROM_PATH)) {
+        *why = "the AWE32 sample ROM is missing";
+        return NULL;
+    }
+
+    emu8k = (emu8k_t *) calloc(1, sizeof(emu8k_t));
+    emu8k_init(emu8k, BENCH_EMU8K_BASE, 512);
+
+    /* Every write brings the output up to date first, keep it empty. */
+    wavetable_pos_global = 0;
+
+    /* Every voice loops over a stretch of the ROM of its own, pitched its own. */
+    for (int v = 0; v < voices; v++) {
+        uint32_t start = 0x1000 + (v * 0x2000);
+
+        bench_emu8k_outw(0x400, 5, v, 0x0080);
+        bench_emu8k_outw(0x400, 4, v, 0x8000);
+        bench_emu8k_outw(0x400, 6, v, 0x8000);
+        bench_emu8k_outw(0x400, 7, v, 0x7f7f);
+        bench_emu8k_outw(0x402, 4, v, 0x7f7f);
+        bench_emu8k_outw(0x402, 5, v, 0x8000);
+        bench_emu8k_outw(0x402, 6, v, 0x7f7f);
+        bench_emu8k_outw(0x402, 7, v, 0x8000);
+        bench_emu8k_outw(0x800, 0, v, 0xe000 - (v * 0x40));
+        bench_emu8k_outw(0x800, 1, v, 0xff00);
+        bench_emu8k_outw(0x800, 2, v, 0x0000);
+        bench_emu8k_outw(0x800, 3, v, 0x0000);
+        bench_emu8k_outw(0x800, 4, v, 0x0010);
+        bench_emu8k_outw(0x800, 5, v, 0x0010);
+        bench_emu8k_outl(0x000, 6, v, (0x80 << 24) | (start + 0x100));
+        bench_emu8k_outl(0x000, 7, v, start + 0x1800);
+        bench_emu8k_outl(0x400, 0, v, start);
+        bench_emu8k_outl(0x000, 3, v, 0x0000ffff);
+        bench_emu8k_outl(0x000, 2, v, 0x0000ffff);
+        bench_emu8k_outl(0x000, 1, v, 0x40000000);
+        bench_emu8k_outl(0x000, 0, v, 0x40000000);
+        bench_emu8k_outw(0x400, 5, v, 0x7f7f);
+    }
+
+    wavetable_pos_global = pos;
+
+    return emu8k;
+}
+
+static uint64_t
+bench_emu8k_run(void *priv)
+{
+    emu8k_t *emu8k = (emu8k_t *) priv;
+    int      pos   = wavetable_pos_global;
+
+    emu8k->pos           = 0;
+    wavetable_pos_global = WTBUFLEN;
+    emu8k_update(emu8k);
+    wavetable_pos_global = pos;
+
+    return WTBUFLEN;
+}
+
+/* For the kernels whose handlers stay registered, so their data has to stay too. */
+static void
+bench_keep(UNUSED(void *priv))
+{
+}
+
+/* Gravis UltraSound voice mixing, one sample at a time. */
+extern void gus_poll_wave(void *priv);
+
+typedef struct bench_gus_t {
+    void *gus;
+    int   polls;
+} bench_gus_t;
+
+static void
+bench_gus_write(uint16_t base, uint8_t reg, uint16_t val)
+{
+    outb(base + 0x103, reg);
+    outb(base + 0x104, val & 0xff);
+    outb(base + 0x105, val >> 8);
+}
+
+static void
+bench_gus_write_addr(uint16_t base, uint8_t reg, uint32_t addr)
+{
+    uint32_t val = addr << 9;
+
+    bench_gus_write(base, reg, val >> 16);
+    bench_gus_write(base, reg + 1, val & 0xffff);
+}
+
+static void *
+bench_gus_init(bench_args_t *args, const char **why)
+{
+    int          voices = bench_arg_int(args, "voices", 32);
+    int          bits   = bench_arg_int(args, "bits", 8);
+    int          polls  = bench_arg_int(args, "polls", 4410);
+    uint16_t     base   = config_get_hex16((char *) gus_device.name, "base", 0x220);
+    bench_gus_t *dev;
+
+    if ((voices < 14) || (voices > 32)) {
+        *why = "voices must be from 14 to 32";
+        return NULL;
+    }
+    if ((bits != 8) && (bits != 16)) {
+        *why = "bits must be 8 or 16";
+        return NULL;
+    }
+    if (polls < 1) {
+        *why = "polls must be at least 1";
+        return NULL;
+    }
+
+    dev        = (bench_gus_t *) calloc(1, sizeof(bench_gus_t));
+    dev->gus   = device_add(&gus_device);
+    dev->polls = polls;
+
+    bench_gus_write(base, 0x4c, 0x0000);
+    bench_gus_write(base, 0x4c, 0x0707);
+    bench_gus_write(base, 0x0e, ((voices - 1) | 0xc0) << 8);
+
+    /* 64 KiB of a sine, one byte at a time. */
+    for (uint32_t a = 0; a < 0x10000; a++) {
+        bench_gus_write(base, 0x43, a & 0xffff);
+        bench_gus_write(base, 0x44, (a >> 16) << 8);
+        outb(base + 0x107, (uint8_t) (int8_t) (sin(a * (M_PI / 128.0)) * 127.0));
+    }
+
+    for (int v = 0; v < voices; v++) {
+        outb(base + 0x102, v);
+        bench_gus_write(base, 0x00, 0x0303);
+        bench_gus_write(base, 0x01, 0x0200 + (v * 8));
+        bench_gus_write_addr(base, 0x02, 0x0000);
+        bench_gus_write_addr(base, 0x04, 0x8000 + (v * 0x100));
+        bench_gus_write_addr(base, 0x0a, v * 0x40);
+        bench_gus_write(base, 0x09, 0xf000);
+        bench_gus_write(base, 0x0c, 0x0707);
+        bench_gus_write(base, 0x0d, 0x0303);
+        bench_gus_write(base, 0x00, (bits == 16) ? 0x0c0c : 0x0808);
+    }
+
+    return dev;
+}
+
+static uint64_t
+bench_gus_run(void *priv)
+{
+    bench_gus_t *dev = (bench_gus_t *) priv;
+
+    for (int c = 0; c < dev->polls; c++)
+        gus_poll_wave(dev->gus);
+
+    return dev->polls;
+}
+
+/* The main sound buffer, from the handlers to the output format. */
+#define BENCH_MIX_HANDLERS 4 /* There is no telling how many of sound.c's 8 the machine took. */
+
+typedef struct bench_mix_t {
+    int32_t table[SOUNDBUFLEN * 2];
+} bench_mix_t;
+
+static void
+bench_mix_get_buffer(int32_t *buffer, int len, void *priv)
+{
+    const bench_mix_t *mix = (bench_mix_t *) priv;
+
+    for (int c = 0; c < (len * 2); c++)
+        buffer[c] += mix->table[c];
+}
+
+static void *
+bench_mix_init(bench_args_t *args, const char **why)
+{
+    int          handlers = bench_arg_int(args, "handlers", 2);
+    uint32_t     seed     = 0x50e1d5a3;
+    bench_mix_t *mix;
+
+    if ((handlers < 0) || (handlers > BENCH_MIX_HANDLERS)) {
+        *why = "handlers must be from 0 to 4";
+        return NULL;
+    }
+
+    mix = (bench_mix_t *) calloc(1, sizeof(bench_mix_t));
+    for (int c = 0; c < (SOUNDBUFLEN * 2); c++)
+        mix->table[c] = (int32_t) (int16_t) bench_rand(&seed) >> 2;
+
+    for (int c = 0; c < handlers; c++)
+        sound_add_handler(bench_mix_get_buffer, mix);
+
+    return mix;
+}
+
+static uint64_t
+bench_mix_run(UNUSED(void *priv))
+{
+    int turbo = turbo_mode;
+
+    /* Nothing goes to the host. */
+    turbo_mode = 1;
+    for (int c = 0; c < sound_buf_len; c++)
+        sound_poll(NULL);
+    turbo_mode = turbo;
+
+    return sound_buf_len;
+}
+
+/* Guest memory accesses, through the lookup tables and mappings. */
+#define BENCH_MEM_BASE 0x20000
+
+typedef struct bench_mem_t {
+    int       write;
+    int       width;
+    uint32_t  count;
+    uint32_t *addrs;
+} bench_mem_t;
+
+static void *
+bench_mem_init(bench_args_t *args, const char **why)
+{
+    const char  *op      = bench_arg_str(args, "op", "read");
+    const char  *pattern = bench_arg_str(args, "pattern", "seq");
+    int          width   = bench_arg_int(args, "width", 32);
+    int          size    = bench_arg_int(args, "size", 256);
+    uint32_t     seed    = 0x3e3ac5e5;
+    bench_mem_t *dev;
+
+    if (strcmp(op, "read") && strcmp(op, "write")) {
+        *why = "op must be read or write";
+        return NULL;
+    }
+    if (strcmp(pattern, "seq") && strcmp(pattern, "random")) {
+        *why = "pattern must be seq or random";
+        return NULL;
+    }
+    if ((width != 8) && (width != 16) && (width != 32)) {
+        *why = "width must be 8, 16 or 32";
+        return NULL;
+    }
+    if ((size < 4) || (size > 384)) {
+        *why = "size must be from 4 to 384 KiB";
+        return NULL;
+    }
+    if (((BENCH_MEM_BASE >> 10) + size) > (int) mem_size) {
+        *why = "the machine has too little memory";
+        return NULL;
+    }
+
+    dev        = (bench_mem_t *) calloc(1, sizeof(bench_mem_t));
+    dev->write = !strcmp(op, "write");
+    dev->width = width;
+    dev->count = (size << 10) / (width >> 3);
+    dev->addrs = (uint32_t *) malloc(dev->count * sizeof(uint32_t));
+
+    for (uint32_t c = 0; c < dev->count; c++) {
+        uint32_t i = strcmp(pattern, "seq") ? (bench_rand(&seed) % dev->count) : c;
+
+        dev->addrs[c] = BENCH_MEM_BASE + (i * (width >> 3));
+    }
+
+    return dev;
+}
+
+static uint64_t
+bench_mem_run(void *priv)
+{
+    const bench_mem_t *dev = (bench_mem_t *) priv;
+    uint32_t           sum = 0;
+
+    switch ((dev->width << 1) | dev->write) {
+        case 16:
+            for (uint32_t c = 0; c < dev->count; c++)
+                sum += readmembl(dev->addrs[c]);
+            break;
+        case 17:
+            for (uint32_t c = 0; c < dev->count; c++)
+                writemembl(dev->addrs[c], c);
+            break;
+        case 32:
+            for (uint32_t c = 0; c < dev->count; c++)
+                sum += readmemwl(dev->addrs[c]);
+            break;
+        case 33:
+            for (uint32_t c = 0; c < dev->count; c++)
+                writememwl(dev->addrs[c], c);
+            break;
+        case 64:
+            for (uint32_t c = 0; c < dev->count; c++)
+                sum += readmemll(dev->addrs[c]);
+            break;
+        default:
+            for (uint32_t c = 0; c < dev->count; c++)
+                writememll(dev->addrs[c], c);
+            break;
+    }
+
+    /* Keeps the reads from being optimised away. */
+    if (sum == 0xffffffff)
+        pclog("Bench: %08X\n", sum);
+
+    return dev->count;
+}
+
+static void
+bench_mem_close(void *priv)
+{
+    bench_mem_t *dev = (bench_mem_t *) priv;
+
+    free(dev->addrs);
+    free(dev);
+}
+
+/* The timer heap, with timers that keep re-arming themselves. */
+typedef struct bench_timer_one_t {
+    pc_timer_t timer;
+    uint64_t   period;
+    uint64_t  *events;
+} bench_timer_one_t;
+
+typedef struct bench_timer_t {
+    int                num;
+    uint64_t           events;
+    bench_timer_one_t *timers;
+} bench_timer_t;
+
+static void
+bench_timer_callback(void *priv)
+{
+    bench_timer_one_t *one = (bench_timer_one_t *) priv;
+
+    (*one->events)++;
+    timer_advance_u64(&one->timer, one->period);
+}
+
+static void *
+bench_timer_init(bench_args_t *args, const char **why)
+{
+    int            num = bench_arg_int(args, "timers", 32);
+    bench_timer_t *dev;
+
+    if ((num < 1) || (num > 4096)) {
+        *why = "timers must be from 1 to 4096";
+        return NULL;
+    }
+
+    dev         = (bench_timer_t *) calloc(1, sizeof(bench_timer_t));
+    dev->num    = num;
+    dev->timers  = (bench_timer_one_t *) calloc(num, sizeof(bench_timer_one_t));
+
+    for (int i = 0; i < num; i++) {
+        dev->timers[i].period = (1 + (i % 16)) * TIMER_USEC;
+        dev->timers[i].events = &dev->events;
+        timer_add(&dev->timers[i].timer, bench_timer_callback, &dev->timers[i], 0);
+        timer_set_delay_u64(&dev->timers[i].timer, dev->timers[i].period);
+    }
+
+    return dev;
+}
+
+static uint64_t
+bench_timer_run(void *priv)
+{
+    bench_timer_t *dev    = (bench_timer_t *) priv;
+    uint64_t       events = dev->events;
+
+    /* A millisecond, a microsecond at a time, as the CPU would. */
+    for (int c = 0; c < 1000; c++) {
+        tsc += TIMER_USEC;
+        if (TIMER_VAL_LESS_THAN_VAL(timer_target, (uint32_t) tsc))
+            timer_process();
+    }
+
+    return dev->events - events;
+}
+
+static void
+bench_timer_close(void *priv)
+{
+    bench_timer_t *dev = (bench_timer_t *) priv;
+
+    for (int i = 0; i < dev->num; i++)
+        timer_disable(&dev->timers[i].timer);
+
+    free(dev->timers);
+    free(dev);
+}
+
+static const bench_kernel_t bench_kernels[] = {
+    { "svga", "pixels", "bpp=4|8|15|16|24|32 width=640 height=480 remap=0|1",
+      "SVGA line rendering into the screen bitmap",
+      bench_svga_init, bench_svga_run, bench_svga_close },
+    { "voodoo", "pixels", "state=flat|gouraud|zbuffer|textured|bilinear|blend size=128 count=16 jit=0|1",
+      "Voodoo Graphics triangle rasterisation",
+      bench_voodoo_init, bench_voodoo_run, bench_free },
+#ifdef USE_DYNAREC
+    { "codegen", "instructions", "stream=alu|mem|branch|fpu mode=execute|translate cycles=100000",
+      "x86 recompiler, running or translating a loop of guest code",
+      bench_codegen_init, bench_codegen_run, bench_free },
+#endif
+    { "opl", "samples", "chip=opl2|opl3 driver=nuked|ymfm voices=18",
+      "OPL FM synthesis of one music buffer",
+      bench_opl_init, bench_opl_run, bench_free },
+    { "emu8k", "samples", "voices=32",
+      "EMU8000 synthesis of one wavetable buffer",
+      bench_emu8k_init, bench_emu8k_run, bench_keep },
+    { "gus", "samples", "voices=32 bits=8|16 polls=4410",
+      "Gravis UltraSound voice mixing",
+      bench_gus_init, bench_gus_run, bench_free },
+    { "mix", "frames", "handlers=2",
+      "Mixing and conversion of one main sound buffer",
+      bench_mix_init, bench_mix_run, bench_keep },
+    { "mem", "accesses", "op=read|write width=8|16|32 pattern=seq|random size=256",
+      "Guest memory accesses, in KiB from 128 KiB up",
+      bench_mem_init, bench_mem_run, bench_mem_close },
+    { "timer", "events", "timers=32",
+      "Timer heap, over 1 ms of emulated time",
+      bench_timer_init, bench_timer_run, bench_timer_close },
+    { NULL, NULL, NULL, NULL, NULL, NULL, NULL }
+};
+
+void
+bench_kernels_list(void)
+{
+    printf("Kernels, as -U name[:param=value,...]. Every kernel also takes time=%i (ms)\n"
+           "and iterations=0 (as many as fit in the time).\n\n", BENCH_TIME_MS);
+
+    for (int k = 0; bench_kernels[k].name != NULL; k++)
+        printf("%-8s %s, in %s\n         %s\n", bench_kernels[k].name, bench_kernels[k].desc,
+               bench_kernels[k].unit, bench_kernels[k].params);
+}
+
+/* Returns -1 if there is no such kernel, or too many were asked for. */
+int
+bench_kernel_add(const char *spec)
+{
+    bench_request_t *req;
+    char            *p;
+    int              k;
+
+    if (bench_kernels_num >= BENCH_KERNELS_MAX)
+        return -1;
+
+    for (k = 0; bench_kernels[k].name != NULL; k++) {
+        size_t len = strlen(bench_kernels[k].name);
+
+        if (!strncmp(spec, bench_kernels[k].name, len) && ((spec[len] == '\0') || (spec[len] == ':')))
+            break;
+    }
+
+    if (bench_kernels[k].name == NULL)
+        return -1;
+
+    req = &bench_requests[bench_kernels_num];
+    memset(req, 0x00, sizeof(bench_request_t));
+    req->kernel = &bench_kernels[k];
+    req->spec   = strdup(spec);
+
+    p = strchr(req->spec, ':');
+    while ((p != NULL) && (*++p != '\0')) {
+        char *next = strchr(p, ',');
+        char *val;
+
+        if (req->args.num >= BENCH_ARGS_MAX) {
+            free(req->spec);
+            return -1;
+        }
+
+        if (next != NULL)
+            *next = '\0';
+
+        val = strchr(p, '=');
+        if (val != NULL)
+            *val++ = '\0';
+
+        req->args.key[req->args.num] = p;
+        req->args.val[req->args.num] = (val != NULL) ? val : "1";
+        req->args.num++;
+
+        p = next;
+    }
+
+    bench_kernels_num++;
+
+    return 0;
+}
+
+static void
+bench_kernel_measure(const bench_kernel_t *kernel, void *priv, int time_ms, int iterations, cJSON *item)
+{
+    uint64_t start;
+    uint64_t total = 0;
+    uint64_t best  = UINT64_MAX;
+    uint64_t units = 0;
+    int      n     = 0;
+
+    /* Warm up the caches, and whatever the kernel only does once. */
+    (void) kernel->run(priv);
+
+    start = bench_ns();
+    while (1) {
+        uint64_t t0 = bench_ns();
+        uint64_t t1;
+
+        units += kernel->run(priv);
+        t1 = bench_ns();
+
+        total += t1 - t0;
+        if ((t1 - t0) < best)
+            best = t1 - t0;
+        n++;
+
+        if (iterations ? (n >= iterations) :
+                         ((n >= BENCH_ITERATIONS_MIN) && ((t1 - start) >= ((uint64_t) time_ms * 1000000ULL))))
+            break;
+    }
+
+    cJSON_AddNumberToObject(item, "iterations", n);
+    cJSON_AddNumberToObject(item, "ns_per_iter", (double) total / n);
+    cJSON_AddNumberToObject(item, "ns_min", (double) best);
+    cJSON_AddStringToObject(item, "unit", kernel->unit);
+    cJSON_AddNumberToObject(item, "units_per_iter", (double) units / n);
+    cJSON_AddNumberToObject(item, "ns_per_unit", units ? ((double) total / units) : 0.0);
+}
+
+int
+bench_kernels_run(void)
+{
+    cJSON *root    = cJSON_CreateObject();
+    cJSON *kernels = cJSON_CreateArray();
+    char  *out;
+
+    cJSON_AddStringToObject(root, "machine", machine_get_internal_name());
+    cJSON_AddStringToObject(root, "cpu", cpu_s->name);
+#ifdef USE_DYNAREC
+    cJSON_AddBoolToObject(root, "dynarec", cpu_use_dynarec);
+#endif
+
+    for (int r = 0; r < bench_kernels_num; r++) {
+        bench_request_t      *req    = &bench_requests[r];
+        const bench_kernel_t *kernel = req->kernel;
+        bench_args_t         *args   = &req->args;
+        cJSON                *item   = cJSON_CreateObject();
+        const char           *why    = NULL;
+        char                  reason[64];
+        void                 *priv;
+        int                   time_ms;
+        int                   iterations;
+
+        cJSON_AddStringToObject(item, "kernel", kernel->name);
+        args->params = cJSON_CreateObject();
+        time_ms      = bench_arg_int(args, "time", BENCH_TIME_MS);
+        iterations   = bench_arg_int(args, "iterations", 0);
+
+        /* No timers but the kernel's own, nothing else runs them. */
+        timer_close();
+        timer_init();
+
+        priv = kernel->init(args, &why);
+
+        for (int i = 0; (priv != NULL) && (i < args->num); i++) {
+            if (!args->used[i]) {
+                snprintf(reason, sizeof(reason), "unknown parameter '%s'", args->key[i]);
+                why = reason;
+                kernel->close(priv);
+                priv = NULL;
+            }
+        }
+
+        cJSON_AddItemToObject(item, "params", args->params);
+
+        if (priv == NULL)
+            cJSON_AddStringToObject(item, "skipped", (why != NULL) ? why : "unable to set up");
+        else {
+            bench_kernel_measure(kernel, priv, time_ms, iterations, item);
+            kernel->close(priv);
+        }
+
+        cJSON_AddItemToArray(kernels, item);
+        free(req->spec);
+    }
+
+    cJSON_AddItemToObject(root, "kernels", kernels);
+
+    out = cJSON_Print(root);
+    if (out != NULL) {
+        printf("%s\n", out);
+        fflush(stdout);
+        cJSON_free(out);
+    }
+
+    cJSON_Delete(root);
+
+    return 0;
+}
@@ -37,6 +37,8 @@
 #include <86box/scsi_cdrom.h>
 #include <86box/sound.h>
 #include <86box/ui.h>
+#include <86box/io_stats.h>
+#include <86box/perf.h>
 
 #define RAW_SECTOR_SIZE    2352
 
@@ -286,7 +288,14 @@ msf_to_bcd(int *m, int *s, int *f)
 static int
 read_data(cdrom_t *dev, const uint32_t lba)
 {
-    return dev->ops->read_sector(dev->local, dev->raw_buffer, lba);
+    const int      prev  = perf_enter(PERF_IO);
+    const uint64_t start = plat_get_ticks_us();
+    const int      ret   = dev->ops->read_sector(dev->local, dev->raw_buffer, lba);
+
+    io_stats_transfer(&cdrom_io_stats[dev->id], 0, RAW_SECTOR_SIZE, plat_get_ticks_us() - start);
+    perf_leave(prev);
+
+    return ret;
 }
 
 static void
@@ -642,7 +651,10 @@ track_type_is_valid(UNUSED(const cdrom_t *dev), const int type, const int flags,
 static int
 read_audio(cdrom_t *dev, const uint32_t lba, uint8_t *b)
 {
-    const int ret = dev->ops->read_sector(dev->local, dev->raw_buffer, lba);
+    const uint64_t start = plat_get_ticks_us();
+    const int      ret   = dev->ops->read_sector(dev->local, dev->raw_buffer, lba);
+
+    io_stats_transfer(&cdrom_io_stats[dev->id], 0, RAW_SECTOR_SIZE, plat_get_ticks_us() - start);
 
     memcpy(b, dev->raw_buffer, 2352);
 
@@ -2290,6 +2302,38 @@ cdrom_readsector_raw(cdrom_t *dev, uint8_t *buffer, const int sector, const int
     return ret;
 }
 
+/*
+   Plain 2048-byte user data reads of Mode 1 sectors skip building the raw
+   sector and hand over as many sectors as the media can with one read.
+   Returns the number of sectors read, the caller reads the rest, and any
+   that need a closer look, one by one with cdrom_readsector_raw().
+ */
+int
+cdrom_read_data_sectors(cdrom_t *dev, uint8_t *buffer, const int sector, const int count,
+                        const int cdrom_sector_type, const int cdrom_sector_flags)
+{
+    int ret = 0;
+
+    if ((dev->cd_status != CD_STATUS_EMPTY) && (dev->ops != NULL) &&
+        (dev->ops->read_data_sectors != NULL) && (count > 0) && (sector >= 0) &&
+        (cdrom_sector_flags == 0x0010) && ((cdrom_sector_type == 0x00) ||
+        (cdrom_sector_type == 0x02) || (cdrom_sector_type == 0x18))) {
+        const int      prev  = perf_enter(PERF_IO);
+        const uint64_t start = plat_get_ticks_us();
+
+        ret = dev->ops->read_data_sectors(dev->local, buffer, sector, count);
+
+        if (ret > 0)
+            io_stats_transfer(&cdrom_io_stats[dev->id], 0, ret * COOKED_SECTOR_SIZE,
+                              plat_get_ticks_us() - start);
+        perf_leave(prev);
+
+        cdrom_log(dev->log, "Batched read of %i of %i sectors from %i\n", ret, count, sector);
+    }
+
+    return ret;
+}
+
 /*
    Read DVD Structure
 
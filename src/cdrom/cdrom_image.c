@@ -34,9 +34,12 @@
 #include <86box/log.h>
 #include <86box/path.h>
 #include <86box/plat.h>
+#include <86box/thread.h>
 #include <86box/cdrom.h>
 #include <86box/cdrom_image.h>
 #include <86box/cdrom_image_viso.h>
+#include <86box/cmp_image.h>
+#include <86box/io_stats.h>
 
 #include <sndfile.h>
 
@@ -115,30 +118,162 @@ static char   *cit[4]   = { "SPECIAL", "NONE", "ZERO", "NORMAL" };
 #    define image_log(priv, fmt, ...)
 #endif
 
+/* Frames decoded per step of the read-ahead thread. */
+#define AUDIO_CHUNK_FRAMES 4096
+
 typedef struct audio_file_t {
     SNDFILE *file;
     SF_INFO  info;
+    uint64_t file_pos; /* Frame the decoder is at. */
+
+    /*
+       Read-ahead, started on the first read. The ring holds the frames from
+       cache_start onwards, decoded ahead of playback by a thread of its own,
+       so compressed tracks do not decode, or seek, in the CD audio path.
+     */
+    thread_t *thread;
+    event_t  *wake;
+    mutex_t  *lock;
+    volatile int run;
+    int16_t  *cache;
+    uint64_t  cache_frames;
+    uint64_t  cache_start;
+    uint64_t  cache_fill;
 } audio_file_t;
 
 /* Audio file functions */
+static sf_count_t
+audio_decode(audio_file_t *audio, int16_t *buffer, const uint64_t frame, const sf_count_t frames)
+{
+    sf_count_t ret;
+
+    if (audio->file_pos != frame) {
+        if (sf_seek(audio->file, frame, SEEK_SET) == -1)
+            return -1;
+        audio->file_pos = frame;
+    }
+
+    ret = sf_readf_short(audio->file, (short *) buffer, frames);
+    if (ret > 0)
+        audio->file_pos += ret;
+    else
+        audio->file_pos = (uint64_t) -1;
+
+    return ret;
+}
+
+static void
+audio_prefetch_thread(void *priv)
+{
+    audio_file_t *audio = (audio_file_t *) priv;
+
+    while (audio->run) {
+        thread_wait_event(audio->wake, -1);
+        thread_reset_event(audio->wake);
+
+        thread_wait_mutex(audio->lock);
+        while (audio->run && (audio->cache_fill < audio->cache_frames)) {
+            const uint64_t next = audio->cache_start + audio->cache_fill;
+            const uint64_t ring = next % audio->cache_frames;
+            sf_count_t     n    = AUDIO_CHUNK_FRAMES;
+
+            if (next >= (uint64_t) audio->info.frames)
+                break;
+
+            n = MIN(n, (sf_count_t) (audio->cache_frames - ring));
+            n = MIN(n, (sf_count_t) (audio->cache_frames - audio->cache_fill));
+            n = audio_decode(audio, &audio->cache[ring * 2], next, n);
+            if (n <= 0)
+                break;
+            audio->cache_fill += n;
+
+            /* Let a waiting reader in between chunks. */
+            thread_release_mutex(audio->lock);
+            thread_wait_mutex(audio->lock);
+        }
+        thread_release_mutex(audio->lock);
+    }
+}
+
+static void
+audio_prefetch_start(audio_file_t *audio)
+{
+    audio->cache_frames = (uint64_t) cd_audio_readahead * 44100ULL;
+    audio->cache        = (int16_t *) malloc(audio->cache_frames * 4);
+    if (audio->cache == NULL) {
+        audio->cache_frames = 0;
+        return;
+    }
+
+    audio->lock   = thread_create_mutex();
+    audio->wake   = thread_create_event();
+    audio->run    = 1;
+    audio->thread = thread_create(audio_prefetch_thread, audio);
+}
+
+static void
+audio_prefetch_stop(audio_file_t *audio)
+{
+    if (audio->thread == NULL)
+        return;
+
+    audio->run = 0;
+    thread_set_event(audio->wake);
+    thread_wait(audio->thread);
+    audio->thread = NULL;
+
+    thread_destroy_event(audio->wake);
+    thread_close_mutex(audio->lock);
+    free(audio->cache);
+    audio->cache = NULL;
+}
+
 static int
 audio_read(void *priv, uint8_t *buffer, const uint64_t seek, const size_t count)
 {
     const track_file_t *tf            = (track_file_t *) priv;
-    const audio_file_t *audio         = (audio_file_t *) tf->priv;
+    audio_file_t       *audio         = (audio_file_t *) tf->priv;
     const uint64_t      samples_seek  = seek / 4;
     const uint64_t      samples_count = count / 4;
+    int                 ret;
 
     if ((seek & 3) || (count & 3)) {
         image_log(tf->log, "CD Audio file: Reading on non-4-aligned boundaries.\n");
     }
 
-    const sf_count_t res = sf_seek(audio->file, samples_seek, SEEK_SET);
+    if ((audio->thread == NULL) && (cd_audio_readahead > 0) && (audio->cache_frames == 0))
+        audio_prefetch_start(audio);
 
-    if (res == -1)
-        return 0;
+    if (audio->thread == NULL)
+        return audio_decode(audio, (int16_t *) buffer, samples_seek, samples_count) > 0;
+
+    thread_wait_mutex(audio->lock);
+
+    if ((samples_seek >= audio->cache_start) &&
+        ((samples_seek + samples_count) <= (audio->cache_start + audio->cache_fill))) {
+        uint64_t ring = samples_seek % audio->cache_frames;
+        uint64_t n    = MIN(samples_count, audio->cache_frames - ring);
+
+        memcpy(buffer, &audio->cache[ring * 2], n * 4);
+        if (n < samples_count)
+            memcpy(&buffer[n * 4], audio->cache, (samples_count - n) * 4);
+
+        /* Played frames are not needed again, free their room. */
+        audio->cache_fill -= (samples_seek + samples_count) - audio->cache_start;
+        audio->cache_start = samples_seek + samples_count;
+        ret                = 1;
+    } else {
+        /* A seek, or playback caught up: read this one directly and have the
+           thread carry on from right after it. */
+        ret                = audio_decode(audio, (int16_t *) buffer, samples_seek, samples_count) > 0;
+        audio->cache_start = samples_seek + samples_count;
+        audio->cache_fill  = 0;
+    }
 
-    return !!sf_readf_short(audio->file, (short *) buffer, samples_count);
+    thread_release_mutex(audio->lock);
+    thread_set_event(audio->wake);
+
+    return ret;
 }
 
 static uint64_t
@@ -158,6 +293,8 @@ audio_close(void *priv)
     audio_file_t *audio = (audio_file_t *) tf->priv;
 
     memset(tf->fn, 0x00, sizeof(tf->fn));
+    if (audio)
+        audio_prefetch_stop(audio);
     if (audio && audio->file)
         sf_close(audio->file);
     free(audio);
@@ -334,6 +471,193 @@ bin_init(const uint8_t id, const char *filename, int *error)
     return tf;
 }
 
+/* Compressed file functions. */
+static int
+cmp_read(void *priv, uint8_t *buffer, const uint64_t seek, const size_t count)
+{
+    const track_file_t *tf = (track_file_t *) priv;
+
+    image_log(tf->log, "compressed_read(pos=%" PRIu64 " count=%lu)\n", seek, count);
+
+    if ((seek + count) > cmp_image_get_header(tf->priv)->size) {
+        image_log(tf->log, "compressed_read past the end of the image!\n");
+
+        return -1;
+    }
+
+    if (cmp_image_read(tf->priv, buffer, seek, count) < 0) {
+        image_log(tf->log, "compressed_read failed during read!\n");
+
+        return -1;
+    }
+
+    if (UNLIKELY(tf->motorola)) {
+        for (uint64_t i = 0; i < count; i += 2) {
+            const uint8_t buffer0 = buffer[i];
+            const uint8_t buffer1 = buffer[i + 1];
+            buffer[i] = buffer1;
+            buffer[i + 1] = buffer0;
+        }
+    }
+
+    return 1;
+}
+
+static uint64_t
+cmp_get_length(void *priv)
+{
+    const track_file_t *tf = (track_file_t *) priv;
+
+    return cmp_image_get_header(tf->priv)->size;
+}
+
+static void
+cmp_close(void *priv)
+{
+    track_file_t *tf = (track_file_t *) priv;
+
+    if (tf == NULL)
+        return;
+
+    cmp_image_close(tf->priv);
+    free(tf);
+}
+
+static track_file_t *
+cmp_init(const uint8_t id, const char *filename, int *error)
+{
+    track_file_t *tf = (track_file_t *) calloc(1, sizeof(track_file_t));
+
+    if (tf == NULL) {
+        *error = 1;
+        return NULL;
+    }
+
+    strncpy(tf->fn, filename, sizeof(tf->fn) - 1);
+    tf->priv = cmp_image_open(tf->fn);
+    *error   = (tf->priv == NULL);
+
+    if (!*error) {
+        tf->read       = cmp_read;
+        tf->get_length = cmp_get_length;
+        tf->close      = cmp_close;
+
+        char n[1024]        = { 0 };
+
+        sprintf(n, "CD-ROM %i Cmp  ", id + 1);
+        tf->log          = log_open(n);
+    } else {
+        free(tf);
+        tf = NULL;
+    }
+
+    return tf;
+}
+
+/* Read-ahead, sitting in front of the read callback of a track file. Once
+   two reads in a row are sequential, the block from there on is read in one
+   go and the following reads are served from it. */
+typedef struct track_cache_t {
+    int      (*read)(void *priv, uint8_t *buffer, uint64_t seek, size_t count);
+    void     (*close)(void *priv);
+    uint8_t *buf;
+    uint64_t length;
+    uint64_t base;
+    uint64_t next; /* Where a sequential read would continue. */
+    size_t   size;
+    size_t   valid;
+    uint8_t  id;
+} track_cache_t;
+
+static int
+track_cache_read(void *priv, uint8_t *buffer, const uint64_t seek, const size_t count)
+{
+    const track_file_t *tf    = (track_file_t *) priv;
+    track_cache_t      *cache = (track_cache_t *) tf->cache;
+    const int           seq   = (seek == cache->next);
+    size_t              fill  = cache->size;
+
+    cache->next = seek + count;
+
+    if ((seek >= cache->base) && ((seek + count) <= (cache->base + cache->valid))) {
+        memcpy(buffer, &cache->buf[seek - cache->base], count);
+        io_stats_lookup(&cdrom_io_stats[cache->id], 1);
+        return 1;
+    }
+
+    io_stats_lookup(&cdrom_io_stats[cache->id], 0);
+
+    /* Byte swapped files are swapped from the start of each read, so they
+       always go straight to the file. */
+    if (!seq || tf->motorola || (seek >= cache->length))
+        return cache->read(priv, buffer, seek, count);
+
+    if (fill > (cache->length - seek))
+        fill = cache->length - seek;
+
+    if (fill < count)
+        return cache->read(priv, buffer, seek, count);
+
+    cache->valid = 0;
+    if (cache->read(priv, cache->buf, seek, fill) != 1)
+        return cache->read(priv, buffer, seek, count);
+
+    cache->base  = seek;
+    cache->valid = fill;
+    memcpy(buffer, cache->buf, count);
+
+    return 1;
+}
+
+static void
+track_cache_close(void *priv)
+{
+    track_file_t  *tf    = (track_file_t *) priv;
+    track_cache_t *cache = (track_cache_t *) tf->cache;
+
+    tf->read  = cache->read;
+    tf->close = cache->close;
+    tf->cache = NULL;
+
+    free(cache->buf);
+    free(cache);
+
+    if (tf->close != NULL)
+        tf->close(tf);
+}
+
+static void
+track_cache_init(track_file_t *tf, const uint8_t id, const uint32_t size_kb)
+{
+    track_cache_t *cache;
+
+    if ((tf == NULL) || (size_kb == 0) || (tf->read == NULL))
+        return;
+
+    cache = (track_cache_t *) calloc(1, sizeof(track_cache_t));
+    if (cache == NULL)
+        return;
+
+    cache->size = size_kb << 10;
+    cache->buf  = (uint8_t *) malloc(cache->size);
+    if (cache->buf == NULL) {
+        free(cache);
+        return;
+    }
+
+    cache->read   = tf->read;
+    cache->close  = tf->close;
+    cache->length = tf->get_length(tf);
+    cache->next   = (uint64_t) -1;
+    cache->id     = id;
+
+    tf->cache = cache;
+    tf->read  = track_cache_read;
+    tf->close = track_cache_close;
+
+    image_log(tf->log, "%i kB read-ahead\n", size_kb);
+}
+
 static track_file_t *
 index_file_init(const uint8_t id, const char *filename, int *error, int *is_viso)
 {
@@ -342,8 +666,11 @@ index_file_init(const uint8_t id, const char *filename, int *error, int *is_viso
     *is_viso = 0;
 
     /* Current we only support .BIN files, either combined or one per
-       track. In the future, more is planned. */
-    tf = bin_init(id, filename, error);
+       track, optionally compressed. In the future, more is planned. */
+    if (cmp_image_is_cmp(filename))
+        tf = cmp_init(id, filename, error);
+    else
+        tf = bin_init(id, filename, error);
 
     if (*error) {
         if ((tf != NULL) && (tf->close != NULL)) {
@@ -357,6 +684,9 @@ index_file_init(const uint8_t id, const char *filename, int *error, int *is_viso
             *is_viso = 1;
     }
 
+    if (!*error)
+        track_cache_init(tf, id, cdrom[id].readahead);
+
     return tf;
 }
 
@@ -1890,6 +2220,77 @@ image_read_sector(const void *local, uint8_t *buffer,
     return ret;
 }
 
+/* Batched read of the user data of the Mode 1 sectors from sector on, up to
+   the end of its index or the first bad sector. Cooked tracks are read with
+   one call to the file, which also feeds its read-ahead, raw tracks in
+   chunks that stop at the first sector whose header is not Mode 1. */
+static int
+image_read_data_sectors(const void *local, uint8_t *buffer,
+                        const uint32_t sector, const uint32_t count)
+{
+    const cd_image_t *img   = (const cd_image_t *) local;
+    uint8_t           raw[8 * 2448];
+    uint32_t          n;
+    uint32_t          done  = 0;
+    int               track;
+    int               index;
+
+    image_get_track_and_index(img, sector, &track, &index);
+
+    if ((track < 0) || (index < 0))
+        return 0;
+
+    const track_t       *trk          = &(img->tracks[track]);
+    const track_index_t *idx          = &(trk->idx[index]);
+    const int            track_is_raw = ((trk->sector_size == RAW_SECTOR_SIZE) ||
+                                         (trk->sector_size == 2448));
+
+    if ((idx->type < INDEX_NORMAL) || !(trk->attr & 0x04) || (trk->mode != 1) ||
+        (trk->form != 0) || (!track_is_raw && (trk->sector_size != COOKED_SECTOR_SIZE)))
+        return 0;
+
+    n = (uint32_t) (idx->start + idx->length - (sector + 150));
+    if (n > count)
+        n = count;
+
+    for (uint32_t i = 0; i < img->bad_sectors_num; i++)
+        if ((img->bad_sectors[i] >= sector) && ((img->bad_sectors[i] - sector) < n))
+            n = img->bad_sectors[i] - sector;
+
+    const uint64_t seek = (((uint64_t) sector + 150 - idx->start + idx->file_start) *
+                           trk->sector_size) + trk->skip;
+
+    if (!track_is_raw) {
+        if ((n == 0) || (idx->file->read(idx->file, buffer, seek, (size_t) n * COOKED_SECTOR_SIZE) <= 0))
+            return 0;
+
+        return (int) n;
+    }
+
+    while (done < n) {
+        uint32_t chunk = n - done;
+
+        if (chunk > 8)
+            chunk = 8;
+
+        if (idx->file->read(idx->file, raw, seek + ((uint64_t) done * trk->sector_size),
+                            (size_t) chunk * trk->sector_size) <= 0)
+            break;
+
+        for (uint32_t i = 0; i < chunk; i++) {
+            const uint8_t *src = &raw[i * trk->sector_size];
+
+            if (src[0x0f] != 0x01)
+                return (int) done;
+
+            memcpy(buffer + ((size_t) done * COOKED_SECTOR_SIZE), src + 16, COOKED_SECTOR_SIZE);
+            done++;
+        }
+    }
+
+    return (int) done;
+}
+
 static uint8_t
 image_get_track_type(const void *local, const uint32_t sector)
 {
@@ -1993,7 +2394,8 @@ static const cdrom_ops_t image_ops = {
     image_has_audio,
     NULL,
     image_close,
-    NULL
+    NULL,
+    image_read_data_sectors
 };
 
 /* Public functions. */
@@ -121,6 +121,21 @@ typedef struct _viso_entry_ {
     char *basename, path[];
 } viso_entry_t;
 
+/* Short names taken in the directory being listed, and the highest numeric
+   tail handed out so far for a name and extension, both hashed so a
+   directory with thousands of similar long names does not have to compare
+   every candidate against each entry before it. */
+typedef struct {
+    char key[13];
+    int  val;
+} viso_name_slot_t;
+
+typedef struct {
+    viso_name_slot_t *slots;
+    size_t            size;
+    size_t            used;
+} viso_name_set_t;
+
 typedef struct {
     uint64_t vol_size_offsets[2];
     uint64_t pt_meta_offsets[2];
@@ -321,8 +336,85 @@ viso_convert_utf8(wchar_t *dest, const char *src, ssize_t buf_size)
 VISO_WRITE_STR_FUNC(viso_write_string, uint8_t, char, , 0)
 VISO_WRITE_STR_FUNC(viso_write_wstring, uint16_t, wchar_t, cpu_to_be16, c > 0xffff)
 
+static uint32_t
+viso_name_hash(const char *s)
+{
+    uint32_t h = 2166136261U;
+
+    while (*s)
+        h = (h ^ (uint8_t) *s++) * 16777619U;
+
+    return h;
+}
+
+static viso_name_slot_t *
+viso_name_slot(const viso_name_set_t *set, const char *key)
+{
+    size_t i = viso_name_hash(key) & (set->size - 1);
+
+    while (set->slots[i].key[0] && strcmp(set->slots[i].key, key))
+        i = (i + 1) & (set->size - 1);
+
+    return &set->slots[i];
+}
+
+static const viso_name_slot_t *
+viso_name_find(const viso_name_set_t *set, const char *key)
+{
+    const viso_name_slot_t *slot;
+
+    if (set->size == 0)
+        return NULL;
+
+    slot = viso_name_slot(set, key);
+
+    return slot->key[0] ? slot : NULL;
+}
+
 static int
-viso_fill_fn_short(char *data, const viso_entry_t *entry, viso_entry_t **entries)
+viso_name_insert(viso_name_set_t *set, const char *key, int val)
+{
+    viso_name_slot_t *slot;
+
+    /* Keep the table at most half full. */
+    if (((set->used + 1) * 2) > set->size) {
+        viso_name_set_t grown = { 0 };
+
+        grown.size  = set->size ? (set->size * 2) : 64;
+        grown.slots = (viso_name_slot_t *) calloc(grown.size, sizeof(viso_name_slot_t));
+        if (grown.slots == NULL)
+            return 0;
+
+        for (size_t i = 0; i < set->size; i++) {
+            if (set->slots[i].key[0])
+                *viso_name_slot(&grown, set->slots[i].key) = set->slots[i];
+        }
+        grown.used = set->used;
+
+        free(set->slots);
+        *set = grown;
+    }
+
+    slot = viso_name_slot(set, key);
+    if (!slot->key[0]) {
+        strcpy(slot->key, key);
+        set->used++;
+    }
+    slot->val = val;
+
+    return 1;
+}
+
+static void
+viso_name_clear(viso_name_set_t *set)
+{
+    if (set->slots)
+        memset(set->slots, 0x00, set->size * sizeof(viso_name_slot_t));
+    set->used = 0;
+}
+
+static int
+viso_fill_fn_short(char *data, const viso_entry_t *entry, viso_name_set_t *taken, viso_name_set_t *tails)
 {
     /* Get name and extension length. */
     const char *ext_pos = strrchr(entry->basename, '.');
@@ -353,9 +445,20 @@ viso_fill_fn_short(char *data, const viso_entry_t *entry, viso_entry_t **entries
         viso_write_string((uint8_t *) &ext[1], &ext_pos[1], ext_len - 1, VISO_CHARSET_D);
     }
 
+    /* Tails up to the last one handed out for this name
+       and extension are known to be taken already. */
+    char key[13];
+    strcpy(key, data);
+    strcat(key, ext);
+    const viso_name_slot_t *hint = viso_name_find(tails, key);
+    int next_tail = hint ? (hint->val + 1) : 1;
+
     /* Check if this filename is unique, and add a tail if required, while also adding the extension. */
     char tail[16];
     for (int i = force_tail; i <= 999999; i++) {
+        if (i == 1)
+            i = next_tail;
+
         /* Add tail to the filename if this is not the first run. */
         int tail_len = -1;
         if (i) {
@@ -367,22 +470,38 @@ viso_fill_fn_short(char *data, const viso_entry_t *entry, viso_entry_t **entries
         if (ext[0])
             strcat(data, ext);
 
-        /* Go through files in this directory to make sure this filename is unique. */
-        for (size_t j = 0; entries[j] != entry; j++) {
-            /* Flag and stop if this filename was seen. */
-            if (!strcmp(data, entries[j]->name_short)) {
-                tail_len = 0;
-                break;
-            }
-        }
-
         /* Stop if this is an unique name. */
-        if (tail_len)
+        if (!viso_name_find(taken, data)) {
+            if (!viso_name_insert(taken, data, 0))
+                return 1;
+            if (i)
+                viso_name_insert(tails, key, i);
             return 0;
+        }
     }
     return 1;
 }
 
+static int
+viso_grow_entries(viso_entry_t ***entries, size_t *len, size_t needed)
+{
+    viso_entry_t **new_entries;
+    size_t         new_len;
+
+    if (needed <= *len)
+        return 1;
+
+    new_len     = MAX(needed, *len * 2);
+    new_entries = (viso_entry_t **) realloc(*entries, new_len * sizeof(viso_entry_t *));
+    if (new_entries == NULL)
+        return 0;
+
+    *entries = new_entries;
+    *len     = new_len;
+
+    return 1;
+}
+
 static size_t
 viso_fill_fn_rr(uint8_t *data, const viso_entry_t *entry, size_t max_len)
 {
@@ -858,33 +977,21 @@ viso_init(const uint8_t id, const char *dirname, int *error)
     image_viso_log(viso->tf.log, "[%08X] %s => [root]\n", dir, dir->path);
 
     /* Traverse directories, starting with the root. */
-    viso_entry_t **dir_entries     = NULL;
-    size_t         dir_entries_len = 0;
+    viso_entry_t  **dir_entries     = NULL;
+    size_t          dir_entries_len = 0;
+    viso_name_set_t taken_names     = { 0 };
+    viso_name_set_t name_tails      = { 0 };
     while (dir) {
         /* Open directory for listing. */
         DIR *dirp = opendir(dir->path);
 
-        /* Iterate through this directory's children to determine the entry array size. */
+        /* The directory is only listed once, with the entry array
+           growing as needed, which matters on network shares. */
         size_t children_count = 3; /* include terminator, . and .. */
-        if (dirp) {                /* create empty directory if opendir failed */
-            while ((readdir_entry = readdir(dirp))) {
-                /* Ignore . and .. pseudo-directories. */
-                if ((readdir_entry->d_name[0] == '.') && ((readdir_entry->d_name[1] == '\0') || (*((uint16_t *) &readdir_entry->d_name[1]) == '.')))
-                    continue;
-                children_count++;
-            }
-        }
-
-        /* Grow array if needed. */
-        if (children_count > dir_entries_len) {
-            viso_entry_t **new_dir_entries = (viso_entry_t **) realloc(dir_entries, children_count * sizeof(viso_entry_t *));
-            if (new_dir_entries) {
-                dir_entries     = new_dir_entries;
-                dir_entries_len = children_count;
-            } else {
-                goto next_dir;
-            }
-        }
+        if (!viso_grow_entries(&dir_entries, &dir_entries_len, children_count))
+            goto next_dir;
+        viso_name_clear(&taken_names);
+        viso_name_clear(&name_tails);
 
         /* Add . and .. pseudo-directories. */
         dir_path_len = strlen(dir->path);
@@ -909,9 +1016,8 @@ viso_init(const uint8_t id, const char *dirname, int *error)
                            dir->path, entry->name_short);
         }
 
-        /* Iterate through this directory's children again, making the entries. */
-        if (dirp) {
-            rewinddir(dirp);
+        /* Iterate through this directory's children, making the entries. */
+        if (dirp) { /* create empty directory if opendir failed */
             while ((readdir_entry = readdir(dirp))) {
                 /* Ignore . and .. pseudo-directories. */
                 if ((readdir_entry->d_name[0] == '.') &&
@@ -919,6 +1025,10 @@ viso_init(const uint8_t id, const char *dirname, int *error)
                     (*((uint16_t *) &readdir_entry->d_name[1]) == '.')))
                     continue;
 
+                /* Make room for this entry and the terminator. */
+                if (!viso_grow_entries(&dir_entries, &dir_entries_len, children_count + 2))
+                    break;
+
                 /* Add and fill entry. */
                 entry = dir_entries[children_count++] =
                     (viso_entry_t *) calloc(1, sizeof(viso_entry_t) +
@@ -987,7 +1097,7 @@ have_eltorito_entry:
                 }
 
                 /* Set short filename. */
-                if (viso_fill_fn_short(entry->name_short, entry, dir_entries)) {
+                if (viso_fill_fn_short(entry->name_short, entry, &taken_names, &name_tails)) {
                     free(entry);
                     children_count--;
                     continue;
@@ -1026,6 +1136,8 @@ next_dir:
     }
     if (dir_entries)
         free(dir_entries);
+    free(taken_names.slots);
+    free(name_tails.slots);
 
     /* Write 16 blank sectors. */
     for (int i = 0; i < 16; i++)
@@ -1553,6 +1553,21 @@ i4x0_read(int func, int addr, void *priv)
     return ret;
 }
 
+/* Aligned dwords come straight out of the register file, bar the two with
+   special read behavior. */
+static uint32_t
+i4x0_readl(int func, int addr, void *priv)
+{
+    const i4x0_t  *dev  = (i4x0_t *) priv;
+    const uint8_t *regs = (uint8_t *) dev->regs;
+
+    if ((func != 0) || ((addr & 0xfc) == 0x50) || ((addr & 0xfc) == 0x90))
+        return i4x0_read(func, addr, priv) | (i4x0_read(func, addr + 1, priv) << 8) |
+               (i4x0_read(func, addr + 2, priv) << 16) | ((uint32_t) i4x0_read(func, addr + 3, priv) << 24);
+
+    return regs[addr] | (regs[addr + 1] << 8) | (regs[addr + 2] << 16) | ((uint32_t) regs[addr + 3] << 24);
+}
+
 static void
 i4x0_reset(void *priv)
 {
@@ -1944,7 +1959,7 @@ i4x0_init(const device_t *info)
                    (dev->type >= INTEL_440BX) ? 0x38 : 0x00, dev);
     }
 
-    pci_add_card(PCI_ADD_NORTHBRIDGE, i4x0_read, i4x0_write, dev, &dev->pci_slot);
+    pci_add_card_ex(PCI_ADD_NORTHBRIDGE, i4x0_read, i4x0_write, i4x0_readl, NULL, dev, &dev->pci_slot);
 
     if ((dev->type >= INTEL_440BX) && !(regs[0x7a] & 0x02)) {
         device_add((dev->type == INTEL_440GX) ? &i440gx_agp_device : &i440bx_agp_device);
@@ -17,6 +17,7 @@
  */
 #include <stdarg.h>
 #include <stdint.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -35,6 +36,7 @@
 #include <86box/pic.h>
 #include <86box/machine.h>
 #include <86box/chipset.h>
+#include <86box/snapshot.h>
 
 typedef struct sis_85c4xx_t {
     uint8_t    cur_reg;
@@ -129,6 +131,34 @@ sis_85c4xx_recalcmapping(sis_85c4xx_t *dev)
     sis_85c4xx_recalcremap(dev);
 }
 
+static void
+sis_85c4xx_recalcsmram(sis_85c4xx_t *dev)
+{
+    uint8_t  val       = dev->regs[0x13];
+    uint32_t host_base = (val & 0x80) ? 0x00060000 : 0x000e0000;
+    uint32_t ram_base;
+
+    smram_disable(dev->smram);
+    switch ((val >> 5) & 0x03) {
+        case 0x00:
+            ram_base = 0x000a0000;
+            break;
+        case 0x01:
+            ram_base = 0x000b0000;
+            break;
+        case 0x02:
+            ram_base = (val & 0x80) ? 0x00000000 : 0x000e0000;
+            break;
+        default:
+            ram_base = 0x00000000;
+            break;
+    }
+    dev->smram_enabled = (ram_base != 0x00000000);
+    if (ram_base != 0x00000000)
+        smram_enable(dev->smram, host_base, ram_base, 0x00010000, (val & 0x10), 1);
+    sis_85c4xx_recalcremap(dev);
+}
+
 static void
 sis_85c4xx_sw_smi_out(UNUSED(uint16_t port), UNUSED(uint8_t val), void *priv)
 {
@@ -164,8 +194,6 @@ sis_85c4xx_out(uint16_t port, uint8_t val, void *priv)
     sis_85c4xx_t *dev       = (sis_85c4xx_t *) priv;
     uint8_t       rel_reg   = dev->cur_reg - dev->reg_base;
     uint8_t       valxor    = 0x00;
-    uint32_t      host_base = 0x000e0000;
-    uint32_t      ram_base  = 0x000a0000;
 
     switch (port) {
         case 0x22:
@@ -199,28 +227,8 @@ sis_85c4xx_out(uint16_t port, uint8_t val, void *priv)
                         break;
 
                     case 0x13:
-                        if (dev->is_471 && (valxor & 0xf0)) {
-                            smram_disable(dev->smram);
-                            host_base = (val & 0x80) ? 0x00060000 : 0x000e0000;
-                            switch ((val >> 5) & 0x03) {
-                                case 0x00:
-                                    ram_base = 0x000a0000;
-                                    break;
-                                case 0x01:
-                                    ram_base = 0x000b0000;
-                                    break;
-                                case 0x02:
-                                    ram_base = (val & 0x80) ? 0x00000000 : 0x000e0000;
-                                    break;
-                                default:
-                                    ram_base = 0x00000000;
-                                    break;
-                            }
-                            dev->smram_enabled = (ram_base != 0x00000000);
-                            if (ram_base != 0x00000000)
-                                smram_enable(dev->smram, host_base, ram_base, 0x00010000, (val & 0x10), 1);
-                            sis_85c4xx_recalcremap(dev);
-                        }
+                        if (dev->is_471 && (valxor & 0xf0))
+                            sis_85c4xx_recalcsmram(dev);
                         break;
 
                     case 0x14:
@@ -354,6 +362,41 @@ sis_85c4xx_reset(void *priv)
     sis_85c4xx_recalcmapping(dev);
 }
 
+/* The shadow, SMRAM, software SMI and port 92h decoding all follow from the
+   registers, so they are rebuilt from them rather than saved. */
+static void
+sis_85c4xx_save(void *priv, snapshot_t *s)
+{
+    sis_85c4xx_t *dev = (sis_85c4xx_t *) priv;
+
+    snapshot_write(s, dev, offsetof(sis_85c4xx_t, mem_state));
+}
+
+static int
+sis_85c4xx_load(void *priv, snapshot_t *s)
+{
+    sis_85c4xx_t *dev = (sis_85c4xx_t *) priv;
+
+    if (!snapshot_read(s, dev, offsetof(sis_85c4xx_t, mem_state)))
+        return 0;
+
+    cpu_cache_ext_enabled = ((dev->regs[0x01] & 0x84) == 0x84);
+    cpu_update_waitstates();
+
+    if (dev->is_471) {
+        sis_85c4xx_recalcsmram(dev);
+        sis_85c4xx_sw_smi_handler(dev);
+        port_92_remove(dev->port_92);
+        if (dev->regs[0x22] & 0x01)
+            port_92_add(dev->port_92);
+    }
+
+    dev->force_flush = 1;
+    sis_85c4xx_recalcmapping(dev);
+
+    return 1;
+}
+
 static void
 sis_85c4xx_close(void *priv)
 {
@@ -405,6 +448,8 @@ const device_t sis_85c401_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
+    .save          = sis_85c4xx_save,
+    .load          = sis_85c4xx_load,
     .config        = NULL
 };
 
@@ -419,6 +464,8 @@ const device_t sis_85c460_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
+    .save          = sis_85c4xx_save,
+    .load          = sis_85c4xx_load,
     .config        = NULL
 };
 
@@ -434,6 +481,8 @@ const device_t sis_85c461_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
+    .save          = sis_85c4xx_save,
+    .load          = sis_85c4xx_load,
     .config        = NULL
 };
 
@@ -448,5 +497,7 @@ const device_t sis_85c471_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
+    .save          = sis_85c4xx_save,
+    .load          = sis_85c4xx_load,
     .config        = NULL
 };
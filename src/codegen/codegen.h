@@ -308,6 +308,7 @@ typedef struct codegen_timing_t {
 
 extern codegen_timing_t codegen_timing_pentium;
 extern codegen_timing_t codegen_timing_686;
+extern codegen_timing_t codegen_timing_286;
 extern codegen_timing_t codegen_timing_486;
 extern codegen_timing_t codegen_timing_winchip;
 extern codegen_timing_t codegen_timing_winchip2;
@@ -57,6 +57,9 @@ int has_ea;
 
 codeblock_t *codeblock;
 uint16_t    *codeblock_hash;
+uint16_t     codeblock_lookup[CODEBLOCK_LOOKUP_SIZE];
+
+codegen_branch_profile_t codegen_branch_profile[CODEGEN_BRANCH_PROFILE_SIZE];
 
 void (*codegen_timing_start)(void);
 void (*codegen_timing_prefix)(uint8_t prefix, uint32_t fetchdat);
@@ -77,6 +80,7 @@ codegen_timing_set(codegen_timing_t *timing)
 }
 
 int codegen_in_recompile;
+int codegen_trace_branch;
 
 static int      last_op_ssegs;
 static x86seg  *last_op_ea_seg;
@@ -104,6 +108,8 @@ codegen_check_seg_read(UNUSED(codeblock_t *block), ir_data_t *ir, x86seg *seg)
         return;
     if (seg == &cpu_state.seg_ds && codegen_flat_ds && !(cpu_cur_status & CPU_STATUS_NOTFLATDS))
         return;
+    if (seg == &cpu_state.seg_es && codegen_flat_es && !(cpu_cur_status & CPU_STATUS_NOTFLATES))
+        return;
 
     uop_CMP_IMM_JZ(ir, ireg_seg_base(seg), (uint32_t) -1, codegen_gpf_rout);
 
@@ -122,6 +128,8 @@ codegen_check_seg_write(UNUSED(codeblock_t *block), ir_data_t *ir, x86seg *seg)
         return;
     if (seg == &cpu_state.seg_ds && codegen_flat_ds && !(cpu_cur_status & CPU_STATUS_NOTFLATDS))
         return;
+    if (seg == &cpu_state.seg_es && codegen_flat_es && !(cpu_cur_status & CPU_STATUS_NOTFLATES))
+        return;
 
     uop_CMP_IMM_JZ(ir, ireg_seg_base(seg), (uint32_t) -1, codegen_gpf_rout);
 
@@ -410,8 +418,13 @@ codegen_generate_call(uint8_t opcode, OpFn op, uint32_t fetchdat, uint32_t new_p
 #ifdef DEBUG_EXTRA
                 last_prefix = 0x0f;
 #endif
-                op_table        = x86_dynarec_opcodes_0f;
-                recomp_op_table = fpu_softfloat ? recomp_opcodes_0f_no_mmx : recomp_opcodes_0f;
+                op_table = x86_dynarec_opcodes_0f;
+                /*The 286 only has the system instructions here, none of which
+                  are recompiled*/
+                if (!is386)
+                    recomp_op_table = NULL;
+                else
+                    recomp_op_table = fpu_softfloat ? recomp_opcodes_0f_no_mmx : recomp_opcodes_0f;
                 over            = 1;
                 break;
 
@@ -432,18 +445,26 @@ codegen_generate_call(uint8_t opcode, OpFn op, uint32_t fetchdat, uint32_t new_p
                 op_ssegs  = 1;
                 break;
             case 0x64: /*FS:*/
+                if (!is386)
+                    goto generate_call;
                 op_ea_seg = &cpu_state.seg_fs;
                 op_ssegs  = 1;
                 break;
             case 0x65: /*GS:*/
+                if (!is386)
+                    goto generate_call;
                 op_ea_seg = &cpu_state.seg_gs;
                 op_ssegs  = 1;
                 break;
 
             case 0x66: /*Data size select*/
+                if (!is386)
+                    goto generate_call;
                 op_32 = ((use32 & 0x100) ^ 0x100) | (op_32 & 0x200);
                 break;
             case 0x67: /*Address size select*/
+                if (!is386)
+                    goto generate_call;
                 op_32 = ((use32 & 0x200) ^ 0x200) | (op_32 & 0x100);
                 break;
 
@@ -465,7 +486,7 @@ codegen_generate_call(uint8_t opcode, OpFn op, uint32_t fetchdat, uint32_t new_p
                 last_prefix = 0xd9;
 #endif
                 op_table        = (op_32 & 0x200) ? x86_dynarec_opcodes_d9_a32 : x86_dynarec_opcodes_d9_a16;
-                recomp_op_table = fpu_softfloat ? NULL : recomp_opcodes_d9;
+                recomp_op_table = fpu_softfloat ? recomp_opcodes_d9_sf : recomp_opcodes_d9;
                 opcode_mask     = 0xff;
                 over            = 1;
                 pc_off          = -1;
@@ -514,7 +535,7 @@ codegen_generate_call(uint8_t opcode, OpFn op, uint32_t fetchdat, uint32_t new_p
                 last_prefix = 0xdd;
 #endif
                 op_table        = (op_32 & 0x200) ? x86_dynarec_opcodes_dd_a32 : x86_dynarec_opcodes_dd_a16;
-                recomp_op_table = fpu_softfloat ? NULL : recomp_opcodes_dd;
+                recomp_op_table = fpu_softfloat ? recomp_opcodes_dd_sf : recomp_opcodes_dd;
                 opcode_mask     = 0xff;
                 over            = 1;
                 pc_off          = -1;
@@ -609,7 +630,7 @@ generate_call:
             codegen_accumulate(ir, ACCREG_cycles, jump_cycles);
     }
 
-    if (op_table == x86_dynarec_opcodes_0f && opcode == 0x0f) {
+    if (op_table == x86_dynarec_opcodes_0f && opcode == 0x0f && recomp_op_table) {
         /*3DNow opcodes are stored after ModR/M, SIB and any offset*/
         uint8_t  modrm     = fetchdat & 0xff;
         uint8_t  sib       = (fetchdat >> 8) & 0xff;
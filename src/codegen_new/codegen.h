@@ -4,6 +4,8 @@
 #include <86box/mem.h>
 #include <stddef.h>
 #include "x86_ops.h"
+#include "x87_sf.h"
+#include "codegen_stats.h"
 
 /*Handling self-modifying code (of which there is a lot on x86) :
 
@@ -57,6 +59,27 @@ typedef struct codeblock_t {
     /*First mem_block_t used by this block. Any subsequent mem_block_ts
       will be in the list starting at head_mem_block->next.*/
     struct mem_block_t *head_mem_block;
+
+    /*Incremented whenever the block is invalidated, deleted or recompiled, so
+      that chain links pointing at an older incarnation of the block are
+      ignored.*/
+    uint32_t epoch;
+
+    /*Successor links, used by the dispatcher to pass control directly to the
+      next recompiled block. Each link records the successor's epoch and the
+      MMU flush count at the time it was made.*/
+    uint16_t chain_block[2];
+    uint32_t chain_epoch[2];
+    int      chain_mmuflush[2];
+
+    /*Number of times the block has been entered since it was last recompiled,
+      used to select blocks for the optimising tier.*/
+    uint32_t exec_count;
+
+    /*Linear address and destination of the taken conditional branch the
+      block ends on, valid when CODEBLOCK_BRANCH_EXIT is set. The dispatcher
+      uses these to profile which way the branch goes.*/
+    uint32_t branch_pc, branch_dest;
 } codeblock_t;
 
 extern codeblock_t *codeblock;
@@ -81,6 +104,109 @@ extern uint8_t *block_write_data;
 #define CODEBLOCK_IN_DIRTY_LIST 0x40
 /*Code block is not inlining immediate parameters, parameters must be fetched from memory*/
 #define CODEBLOCK_NO_IMMEDIATES 0x80
+/*Code block is hot, and is recompiled with IR optimisation passes enabled*/
+#define CODEBLOCK_OPTIMISED 0x100
+/*Code block has been executed since the eviction clock hand last passed it*/
+#define CODEBLOCK_ACCESSED 0x200
+/*Code block ends on a taken conditional branch, branch_pc and branch_dest are valid*/
+#define CODEBLOCK_BRANCH_EXIT 0x400
+
+/*Number of executions of a recompiled block before it is recompiled again with
+  IR optimisation passes enabled*/
+#define CODEBLOCK_HOT_THRESHOLD 1000
+
+/*Adaptive self-modifying code handling. Invalidations are counted per page by
+  codegen_smc_account(), split by the granularity of the invalidated block.
+
+  Blocks using 64 byte masks are also invalidated by data writes that merely
+  share a 64 byte chunk with the code. Once a page has seen
+  CODEGEN_SMC_COARSE_THRESHOLD such invalidations, all new blocks on it are
+  compiled with byte masks straight away, instead of going through the dirty
+  list first.
+
+  Blocks using byte masks are only invalidated by writes to the code bytes
+  themselves. Once a page has seen CODEGEN_SMC_BYTE_THRESHOLD of these, it is
+  considered to contain real self-modifying code, and blocks starting in it
+  are interpreted for the next CODEGEN_SMC_COOLDOWN block executions rather
+  than being marked and recompiled over and over.*/
+#define CODEGEN_SMC_COARSE_THRESHOLD 4
+#define CODEGEN_SMC_BYTE_THRESHOLD   8
+#define CODEGEN_SMC_COOLDOWN         4096
+
+/*Branch direction profiling, used to form traces in the optimising tier.
+
+  A block compiled while a conditional branch was taken ends on that branch.
+  After each run of such a block in the first tier, the dispatcher counts the
+  exit, and whether it left through the branch, in a direct-mapped table keyed
+  on the branch's linear address. An entry is reset when another branch claims
+  its slot.
+
+  When the optimising tier meets a forward branch that is taken on at least
+  three quarters of CODEGEN_TRACE_MIN_SAMPLES or more profiled exits, it
+  compiles the not taken path as a side exit and carries on compiling at the
+  branch destination. The hot path through the branch then runs as one block,
+  and the IR passes and register allocator see all of it. Branches skipping
+  more than CODEGEN_TRACE_MAX_SKIP bytes are left alone.*/
+#define CODEGEN_BRANCH_PROFILE_SIZE 0x1000
+#define CODEGEN_BRANCH_PROFILE_MASK (CODEGEN_BRANCH_PROFILE_SIZE - 1)
+#define CODEGEN_TRACE_MIN_SAMPLES   64
+#define CODEGEN_TRACE_MAX_SKIP      256
+
+typedef struct codegen_branch_profile_t {
+    uint32_t pc;
+    uint16_t exits;
+    uint16_t taken;
+} codegen_branch_profile_t;
+
+extern codegen_branch_profile_t codegen_branch_profile[CODEGEN_BRANCH_PROFILE_SIZE];
+
+static inline codegen_branch_profile_t *
+codegen_branch_profile_get(uint32_t branch_pc)
+{
+    return &codegen_branch_profile[(branch_pc ^ (branch_pc >> 12)) & CODEGEN_BRANCH_PROFILE_MASK];
+}
+
+/*Called by the dispatcher after a block has run, with the PC it exited at*/
+static inline void
+codegen_branch_profile_exit(const codeblock_t *block, uint32_t exit_pc)
+{
+    codegen_branch_profile_t *profile;
+
+    if ((block->flags & (CODEBLOCK_BRANCH_EXIT | CODEBLOCK_OPTIMISED)) != CODEBLOCK_BRANCH_EXIT)
+        return;
+
+    profile = codegen_branch_profile_get(block->branch_pc);
+    if (profile->pc != block->branch_pc) {
+        profile->pc    = block->branch_pc;
+        profile->exits = 0;
+        profile->taken = 0;
+    } else if (profile->exits == 0xffff) {
+        profile->exits >>= 1;
+        profile->taken >>= 1;
+    }
+    profile->exits++;
+    if (exit_pc == block->branch_dest)
+        profile->taken++;
+}
+
+static inline int
+codegen_smc_use_byte_mask(const page_t *page)
+{
+    return page->smc_coarse_count >= CODEGEN_SMC_COARSE_THRESHOLD;
+}
+
+/*Returns non-zero if a block on this page should be interpreted rather than
+  marked or recompiled, and counts down the page's cooldown*/
+static inline int
+codegen_smc_interpret(page_t *page)
+{
+    if (!page->smc_cooldown)
+        return 0;
+
+    page->smc_cooldown--;
+    codegen_stats.smc_interpreted++;
+    return 1;
+}
 
 #define BLOCK_PC_INVALID        0xffffffff
 
@@ -92,11 +218,45 @@ get_block_nr(codeblock_t *block)
     return ((uintptr_t) block - (uintptr_t) codeblock) / sizeof(codeblock_t);
 }
 
+/*Direct-mapped lookup table in front of the codeblock tree, keyed on (phys, CS).
+  Entries are cleared when the block they point to is invalidated or deleted, so
+  a hit only needs to check the key and CPU status.*/
+#define CODEBLOCK_LOOKUP_SIZE 0x2000
+#define CODEBLOCK_LOOKUP_MASK (CODEBLOCK_LOOKUP_SIZE - 1)
+
+extern uint16_t codeblock_lookup[CODEBLOCK_LOOKUP_SIZE];
+
+static inline int
+codeblock_lookup_index(uint32_t phys, uint32_t _cs)
+{
+    return (phys ^ (phys >> 13) ^ (_cs >> 4)) & CODEBLOCK_LOOKUP_MASK;
+}
+
+static inline void
+codeblock_lookup_remove(codeblock_t *block)
+{
+    int idx = codeblock_lookup_index(block->phys, block->_cs);
+
+    if (codeblock_lookup[idx] == get_block_nr(block))
+        codeblock_lookup[idx] = BLOCK_INVALID;
+}
+
 static inline codeblock_t *
 codeblock_tree_find(uint32_t phys, uint32_t _cs)
 {
     codeblock_t *block;
-    uint64_t     a = _cs | ((uint64_t) phys << 32);
+    uint64_t     a   = _cs | ((uint64_t) phys << 32);
+    int          idx = codeblock_lookup_index(phys, _cs);
+
+    if (codeblock_lookup[idx]) {
+        block = &codeblock[codeblock_lookup[idx]];
+
+        if ((block->phys == phys) && (block->_cs == _cs) && !((block->status ^ cpu_cur_status) & CPU_STATUS_FLAGS) && ((block->status & cpu_cur_status & CPU_STATUS_MASK) == (cpu_cur_status & CPU_STATUS_MASK))) {
+            codegen_stats.lookup_hits++;
+            return block;
+        }
+    }
+    codegen_stats.lookup_misses++;
 
     if (!pages[phys >> 12].head)
         return NULL;
@@ -114,9 +274,89 @@ codeblock_tree_find(uint32_t phys, uint32_t _cs)
             block = block->right ? &codeblock[block->right] : NULL;
     }
 
+    if (block)
+        codeblock_lookup[idx] = get_block_nr(block);
+
     return block;
 }
 
+/*Block chaining. After a recompiled block returns, the dispatcher looks for a
+  successor in the block's chain links rather than going through the hash and
+  tree lookup. A link is only followed if the successor is still the same
+  incarnation (epoch), no MMU flush has happened since the link was made (so
+  CS:EIP still maps to the same physical address), and the successor passes
+  the same checks the dispatcher would otherwise perform.*/
+#define CODEBLOCK_CHAIN_SLOTS 2
+
+extern int mmuflush;
+
+static inline void
+codeblock_chain_link(codeblock_t *block, codeblock_t *next)
+{
+    int nr   = get_block_nr(next);
+    int slot = -1;
+
+    for (int c = 0; c < CODEBLOCK_CHAIN_SLOTS; c++) {
+        if (block->chain_block[c] == nr) {
+            slot = c;
+            break;
+        }
+    }
+    if ((slot == -1) && !block->chain_block[1])
+        slot = block->chain_block[0] ? 1 : 0;
+    if (slot == -1) {
+        /*Replace the oldest link*/
+        block->chain_block[0]    = block->chain_block[1];
+        block->chain_epoch[0]    = block->chain_epoch[1];
+        block->chain_mmuflush[0] = block->chain_mmuflush[1];
+        slot                     = 1;
+    }
+
+    block->chain_block[slot]    = nr;
+    block->chain_epoch[slot]    = next->epoch;
+    block->chain_mmuflush[slot] = mmuflush;
+}
+
+/*FPU top-of-stack the current FPU core works with. Blocks compiled with
+  CODEBLOCK_STATIC_TOP are only valid while this matches block->TOP*/
+static inline int
+codegen_fpu_top(void)
+{
+    return (fpu_softfloat ? fpu_state.tos : cpu_state.TOP) & 7;
+}
+
+static inline codeblock_t *
+codeblock_chain_find(codeblock_t *block)
+{
+    for (int c = 0; c < CODEBLOCK_CHAIN_SLOTS; c++) {
+        codeblock_t *next;
+
+        if (!block->chain_block[c] || (block->chain_mmuflush[c] != mmuflush))
+            continue;
+
+        next = &codeblock[block->chain_block[c]];
+        if ((next->epoch != block->chain_epoch[c]) || (next->pc != cs + cpu_state.pc) || (next->_cs != cs))
+            continue;
+        if (((next->status ^ cpu_cur_status) & CPU_STATUS_FLAGS) || ((next->status & cpu_cur_status & CPU_STATUS_MASK) != (cpu_cur_status & CPU_STATUS_MASK)))
+            continue;
+
+        /*Anything that would need the dispatcher's attention - not compiled,
+          pending SMC flush, or FPU top-of-stack mismatch - ends the chain*/
+        if (!(next->flags & CODEBLOCK_WAS_RECOMPILED) || (next->flags & CODEBLOCK_IN_DIRTY_LIST))
+            return NULL;
+        if (next->page_mask & *next->dirty_mask)
+            return NULL;
+        if (next->page_mask2 && (next->page_mask2 & *next->dirty_mask2))
+            return NULL;
+        if ((next->flags & CODEBLOCK_STATIC_TOP) && (next->TOP != codegen_fpu_top()))
+            return NULL;
+
+        return next;
+    }
+
+    return NULL;
+}
+
 static inline void
 codeblock_tree_add(codeblock_t *new_block)
 {
@@ -295,6 +535,9 @@ extern void codegen_block_init(uint32_t phys_addr);
 extern void codegen_block_remove(void);
 extern void codegen_block_start_recompile(codeblock_t *block);
 extern void codegen_block_end_recompile(codeblock_t *block);
+/*Discard the host code of a hot block, so the next execution recompiles it with
+  optimisation enabled*/
+extern void codegen_block_promote(codeblock_t *block);
 extern void codegen_block_end(void);
 extern void codegen_delete_block(codeblock_t *block);
 extern void codegen_generate_call(uint8_t opcode, OpFn op, uint32_t fetchdat, uint32_t new_pc, uint32_t old_pc);
@@ -308,13 +551,18 @@ extern void codegen_check_seg_read(codeblock_t *block, struct ir_data_t *ir, x86
 extern void codegen_check_seg_write(codeblock_t *block, struct ir_data_t *ir, x86seg *seg);
 
 extern int codegen_purge_purgable_list(void);
-/*Delete a random code block to free memory. This is obviously quite expensive, and
-  will only be called when the allocator is out of memory*/
-extern void codegen_delete_random_block(int required_mem_block);
+/*Delete a code block to free memory, using a clock (second chance) policy on
+  CODEBLOCK_ACCESSED. This is obviously quite expensive, and will only be called
+  when the block or memory allocator is out of space*/
+extern void codegen_evict_block(int required_mem_block);
 
 extern int      cpu_block_end;
 extern uint32_t codegen_endpc;
 
+/*Set by the recompiler when a taken conditional branch continues the block
+  along a trace, rather than ending it*/
+extern int codegen_trace_branch;
+
 extern int cpu_reps;
 extern int cpu_notreps;
 
@@ -338,6 +586,7 @@ typedef struct codegen_timing_t {
 
 extern codegen_timing_t codegen_timing_pentium;
 extern codegen_timing_t codegen_timing_686;
+extern codegen_timing_t codegen_timing_286;
 extern codegen_timing_t codegen_timing_486;
 extern codegen_timing_t codegen_timing_winchip;
 extern codegen_timing_t codegen_timing_winchip2;
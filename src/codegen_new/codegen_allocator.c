@@ -22,50 +22,135 @@
 typedef struct mem_block_t {
     uint32_t offset; /*Offset into mem_block_alloc*/
     uint32_t next;
+    uint32_t prev; /*Previous block in the free list, only valid while free*/
     uint16_t code_block;
+    uint8_t  tier;
+    uint8_t  free;
 } mem_block_t;
 
-static mem_block_t mem_blocks[MEM_BLOCK_NR];
-static uint32_t    mem_block_free_list;
-static uint8_t    *mem_block_alloc = NULL;
+static mem_block_t *mem_blocks = NULL;
+static uint32_t     mem_block_free_list[MEM_TIER_NR];
+static uint8_t     *mem_block_alloc = NULL;
 
-int codegen_allocator_usage = 0;
+int      codegen_allocator_usage      = 0;
+int      codegen_allocator_hot_usage  = 0;
+uint32_t codegen_allocator_nr_blocks  = MEM_BLOCK_NR;
+uint32_t codegen_allocator_nr_hot     = 0;
+uint64_t codegen_allocator_overflows  = 0;
+uint64_t codegen_allocator_contiguous = 0;
+
+static void
+free_list_add(uint32_t block_nr)
+{
+    mem_block_t *block = &mem_blocks[block_nr - 1];
+    uint32_t     head  = mem_block_free_list[block->tier];
+
+    block->next = head;
+    block->prev = 0;
+    block->free = 1;
+    if (head)
+        mem_blocks[head - 1].prev = block_nr;
+    mem_block_free_list[block->tier] = block_nr;
+}
+
+static void
+free_list_remove(uint32_t block_nr)
+{
+    mem_block_t *block = &mem_blocks[block_nr - 1];
+
+    if (block->prev)
+        mem_blocks[block->prev - 1].next = block->next;
+    else
+        mem_block_free_list[block->tier] = block->next;
+    if (block->next)
+        mem_blocks[block->next - 1].prev = block->prev;
+    block->free = 0;
+}
 
 void
 codegen_allocator_init(void)
 {
-    mem_block_alloc = plat_mmap(MEM_BLOCK_NR * MEM_BLOCK_SIZE, 1);
-
-    for (uint32_t c = 0; c < MEM_BLOCK_NR; c++) {
-        mem_blocks[c].offset     = c * MEM_BLOCK_SIZE;
-        mem_blocks[c].code_block = BLOCK_INVALID;
-        if (c < MEM_BLOCK_NR - 1)
-            mem_blocks[c].next = c + 2;
-        else
-            mem_blocks[c].next = 0;
+    uint32_t nr_blocks = MEM_BLOCK_NR;
+    uint8_t *pool;
+
+    if (cpu_dynarec_pool_size > 0) {
+        nr_blocks = ((uint64_t) cpu_dynarec_pool_size << 20) / MEM_BLOCK_SIZE;
+        if (nr_blocks < MEM_BLOCK_NR_MIN)
+            nr_blocks = MEM_BLOCK_NR_MIN;
+        else if (nr_blocks > MEM_BLOCK_NR_MAX)
+            nr_blocks = MEM_BLOCK_NR_MAX;
+    }
+    codegen_allocator_nr_blocks = nr_blocks;
+    codegen_allocator_nr_hot    = nr_blocks / MEM_HOT_FRACTION;
+
+    mem_blocks = calloc(nr_blocks, sizeof(mem_block_t));
+    if (mem_blocks == NULL)
+        fatal("codegen_allocator_init: out of memory\n");
+
+    /*Align the pool to a large page, so the host can back it with as few TLB
+      entries as possible*/
+    pool = plat_mmap(((size_t) nr_blocks * MEM_BLOCK_SIZE) + MEM_LARGE_PAGE_SIZE, 1);
+    if (pool == NULL)
+        fatal("codegen_allocator_init: out of memory\n");
+    mem_block_alloc = (uint8_t *) (((uintptr_t) pool + MEM_LARGE_PAGE_SIZE - 1) & ~(uintptr_t) (MEM_LARGE_PAGE_SIZE - 1));
+    plat_mmap_hint_huge(mem_block_alloc, (size_t) nr_blocks * MEM_BLOCK_SIZE);
+
+    mem_block_free_list[MEM_TIER_BASE] = 0;
+    mem_block_free_list[MEM_TIER_HOT]  = 0;
+
+    /*Build the free lists back to front, so blocks are handed out in address
+      order until the pool has been filled once*/
+    for (uint32_t c = nr_blocks; c > 0; c--) {
+        mem_blocks[c - 1].offset     = (c - 1) * MEM_BLOCK_SIZE;
+        mem_blocks[c - 1].code_block = BLOCK_INVALID;
+        mem_blocks[c - 1].tier       = ((c - 1) < codegen_allocator_nr_hot) ? MEM_TIER_HOT : MEM_TIER_BASE;
+        free_list_add(c);
     }
-    mem_block_free_list = 1;
 }
 
 mem_block_t *
 codegen_allocator_allocate(mem_block_t *parent, int code_block)
 {
     mem_block_t *block;
-    uint32_t     block_nr;
+    uint32_t     block_nr = 0;
+    int          tier;
+
+    /*The backend's shared routines (built as code block 0) and blocks that
+      have been recompiled with optimisation enabled go in the hot region,
+      everything else in the base region*/
+    if (!code_block || (codeblock[code_block].flags & CODEBLOCK_OPTIMISED))
+        tier = MEM_TIER_HOT;
+    else
+        tier = MEM_TIER_BASE;
+
+    if (parent) {
+        mem_block_t *last    = parent->next ? &mem_blocks[parent->next - 1] : parent;
+        uint32_t     last_nr = (last - mem_blocks) + 1;
+
+        /*Continue the code block in the memory block following the one it
+          currently ends in, if that is free*/
+        codegen_allocator_overflows++;
+        if ((last_nr < codegen_allocator_nr_blocks) && mem_blocks[last_nr].free) {
+            block_nr = last_nr + 1;
+            codegen_allocator_contiguous++;
+        }
+    }
 
-    while (!mem_block_free_list) {
-        /*Pick a random memory block and free the owning code block*/
-        block_nr = rand() & MEM_BLOCK_MASK;
-        block    = &mem_blocks[block_nr];
+    if (!block_nr) {
+        /*Out of memory - evict code blocks using the clock policy until a memory
+          block is free*/
+        while (!mem_block_free_list[MEM_TIER_BASE] && !mem_block_free_list[MEM_TIER_HOT])
+            codegen_evict_block(1);
 
-        if (block->code_block && block->code_block != code_block)
-            codegen_delete_block(&codeblock[block->code_block]);
+        /*Fall back to the other region when this one is full*/
+        block_nr = mem_block_free_list[tier];
+        if (!block_nr)
+            block_nr = mem_block_free_list[tier ^ 1];
     }
 
     /*Remove from free list*/
-    block_nr            = mem_block_free_list;
-    block               = &mem_blocks[block_nr - 1];
-    mem_block_free_list = block->next;
+    free_list_remove(block_nr);
+    block = &mem_blocks[block_nr - 1];
 
     block->code_block = code_block;
     if (parent) {
@@ -76,8 +161,16 @@ codegen_allocator_allocate(mem_block_t *parent, int code_block)
         block->next = 0;
 
     codegen_allocator_usage++;
+    if (block->tier == MEM_TIER_HOT)
+        codegen_allocator_hot_usage++;
     return block;
 }
+
+int
+codegen_cache_usage_pct(void)
+{
+    return (int) (((uint64_t) codegen_allocator_usage * 100) / codegen_allocator_nr_blocks);
+}
 void
 codegen_allocator_free(mem_block_t *block)
 {
@@ -86,11 +179,12 @@ codegen_allocator_free(mem_block_t *block)
     while (1) {
         int next_block_nr = block->next;
         codegen_allocator_usage--;
+        if (block->tier == MEM_TIER_HOT)
+            codegen_allocator_hot_usage--;
 
-        block->next         = mem_block_free_list;
-        block->code_block   = BLOCK_INVALID;
-        mem_block_free_list = block_nr;
-        block_nr            = next_block_nr;
+        block->code_block = BLOCK_INVALID;
+        free_list_add(block_nr);
+        block_nr = next_block_nr;
 
         if (block_nr)
             block = &mem_blocks[block_nr - 1];
@@ -108,7 +202,7 @@ codeblock_allocator_get_ptr(mem_block_t *block)
 void
 codegen_allocator_clean_blocks(UNUSED(struct mem_block_t *block))
 {
-#if defined __ARM_EABI__ || defined _ARM_ || defined __aarch64__ || defined _M_ARM || defined _M_ARM64
+#if defined __ARM_EABI__ || defined _ARM_ || defined __aarch64__ || defined _M_ARM || defined _M_ARM64 || defined __riscv
     while (1) {
 #    ifndef _MSC_VER
         __clear_cache(&mem_block_alloc[block->offset], &mem_block_alloc[block->offset + MEM_BLOCK_SIZE]);
@@ -12,15 +12,38 @@
 
   Due to the chaining, the total memory size is limited by the range of a jump
   instruction. ARMv7 is restricted to +/- 32 MB, ARMv8 to +/- 128 MB, x86 to
-  +/- 2GB. As a result, total memory size is limited to 32 MB on ARMv7*/
+  +/- 2GB. As a result, total memory size is limited to 32 MB on ARMv7.
+
+  MEM_BLOCK_NR is the default number of blocks. The pool size can be changed with
+  cpu_dynarec_pool_size (in MB), and is clamped to between MEM_BLOCK_NR_MIN and
+  MEM_BLOCK_NR_MAX blocks.
+
+  The pool is aligned to MEM_LARGE_PAGE_SIZE and the host is asked to back it with
+  large pages. The first 1/MEM_HOT_FRACTION of it is the hot region, which holds
+  the backend's shared routines and the blocks recompiled with optimisation
+  enabled, so the code that runs most is packed into a few pages. Everything else
+  is allocated from the remaining base region, and either region is used once the
+  other is full. When a block needs more memory, the memory block right after the
+  one it ends in is used if it is free.*/
 #if defined __ARM_EABI__ || defined _ARM_ || defined _M_ARM
-#    define MEM_BLOCK_NR 32768
+#    define MEM_BLOCK_NR     32768
+#    define MEM_BLOCK_NR_MAX 32768
 #else
-#    define MEM_BLOCK_NR 131072
+#    define MEM_BLOCK_NR     131072
+#    define MEM_BLOCK_NR_MAX 524288
 #endif
+#define MEM_BLOCK_NR_MIN 8192
+
+#define MEM_BLOCK_SIZE   0x3c0
+
+#define MEM_LARGE_PAGE_SIZE (2 << 20)
+#define MEM_HOT_FRACTION    4
 
-#define MEM_BLOCK_MASK (MEM_BLOCK_NR - 1)
-#define MEM_BLOCK_SIZE 0x3c0
+enum {
+    MEM_TIER_BASE = 0,
+    MEM_TIER_HOT,
+    MEM_TIER_NR
+};
 
 void codegen_allocator_init(void);
 /*Allocate a mem_block_t, and the associated backing memory.
@@ -34,6 +57,11 @@ uint8_t *codeblock_allocator_get_ptr(struct mem_block_t *block);
 /*Cache clean memory block list*/
 void codegen_allocator_clean_blocks(struct mem_block_t *block);
 
-extern int codegen_allocator_usage;
+extern int      codegen_allocator_usage;
+extern int      codegen_allocator_hot_usage;
+extern uint32_t codegen_allocator_nr_blocks;
+extern uint32_t codegen_allocator_nr_hot;
+extern uint64_t codegen_allocator_overflows;
+extern uint64_t codegen_allocator_contiguous;
 
 #endif
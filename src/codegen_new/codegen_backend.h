@@ -9,6 +9,8 @@
 #    include "codegen_backend_arm.h"
 #elif defined __aarch64__ || defined _M_ARM64
 #    include "codegen_backend_arm64.h"
+#elif defined __riscv && (__riscv_xlen == 64)
+#    include "codegen_backend_riscv64.h"
 #else
 #    error Dynamic recompiler not implemented on your platform
 #endif
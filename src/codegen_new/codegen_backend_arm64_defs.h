@@ -114,6 +114,11 @@
 #define CODEGEN_HOST_REGS    10
 #define CODEGEN_HOST_FP_REGS 8
 
+/*Number of uOPs to look ahead for register reads when choosing a host register
+  to spill. Backends with few host registers spill often and benefit from a
+  longer window*/
+#define CODEGEN_HOST_REG_LOOKAHEAD 8
+
 extern void *codegen_mem_load_byte;
 extern void *codegen_mem_load_word;
 extern void *codegen_mem_load_long;
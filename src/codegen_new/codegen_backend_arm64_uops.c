@@ -1852,7 +1852,7 @@ codegen_PFRCP(codeblock_t *block, uop_t *uop)
     int src_size_a = IREG_GET_SIZE(uop->src_reg_a_real);
 
     if (REG_IS_Q(dest_size) && REG_IS_Q(src_size_a)) {
-        /*TODO: This could be improved (use VRECPE/VRECPS)*/
+        /*VRECPE/VRECPS is not bit exact with the interpreter, so use a full divide*/
         host_arm64_FMOV_S_ONE(block, REG_V_TEMP);
         host_arm64_FDIV_S(block, dest_reg, REG_V_TEMP, src_reg_a);
         host_arm64_DUP_V2S(block, dest_reg, dest_reg, 0);
@@ -1870,9 +1870,10 @@ codegen_PFRSQRT(codeblock_t *block, uop_t *uop)
     int src_size_a = IREG_GET_SIZE(uop->src_reg_a_real);
 
     if (REG_IS_Q(dest_size) && REG_IS_Q(src_size_a)) {
-        /*TODO: This could be improved (use VRSQRTE/VRSQRTS)*/
+        /*VRSQRTE/VRSQRTS is not bit exact with the interpreter, so use a full
+          square root and divide*/
         host_arm64_FSQRT_S(block, REG_V_TEMP, src_reg_a);
-        host_arm64_FMOV_S_ONE(block, REG_V_TEMP);
+        host_arm64_FMOV_S_ONE(block, dest_reg);
         host_arm64_FDIV_S(block, dest_reg, dest_reg, REG_V_TEMP);
         host_arm64_DUP_V2S(block, dest_reg, dest_reg, 0);
     } else
@@ -3370,16 +3371,20 @@ codegen_direct_read_8(codeblock_t *block, int host_reg, void *p)
 {
     if (in_range12_b((uintptr_t) p - (uintptr_t) &cpu_state))
         host_arm64_LDRB_IMM_W(block, host_reg, REG_CPUSTATE, (uintptr_t) p - (uintptr_t) &cpu_state);
-    else
-        fatal("codegen_direct_read_8 - not in range\n");
+    else {
+        host_arm64_MOVX_IMM(block, REG_TEMP, (uint64_t) p);
+        host_arm64_LDRB_IMM_W(block, host_reg, REG_TEMP, 0);
+    }
 }
 void
 codegen_direct_read_16(codeblock_t *block, int host_reg, void *p)
 {
     if (in_range12_h((uintptr_t) p - (uintptr_t) &cpu_state))
         host_arm64_LDRH_IMM(block, host_reg, REG_CPUSTATE, (uintptr_t) p - (uintptr_t) &cpu_state);
-    else
-        fatal("codegen_direct_read_16 - not in range\n");
+    else {
+        host_arm64_MOVX_IMM(block, REG_TEMP, (uint64_t) p);
+        host_arm64_LDRH_IMM(block, host_reg, REG_TEMP, 0);
+    }
 }
 void
 codegen_direct_read_32(codeblock_t *block, int host_reg, void *p)
@@ -3394,8 +3399,10 @@ codegen_direct_read_64(codeblock_t *block, int host_reg, void *p)
 {
     if (in_range12_q((uintptr_t) p - (uintptr_t) &cpu_state))
         host_arm64_LDR_IMM_F64(block, host_reg, REG_CPUSTATE, (uintptr_t) p - (uintptr_t) &cpu_state);
-    else
-        fatal("codegen_direct_read_double - not in range\n");
+    else {
+        host_arm64_MOVX_IMM(block, REG_TEMP, (uint64_t) p);
+        host_arm64_LDR_IMM_F64(block, host_reg, REG_TEMP, 0);
+    }
 }
 void
 codegen_direct_read_pointer(codeblock_t *block, int host_reg, void *p)
@@ -3446,16 +3453,20 @@ codegen_direct_write_8(codeblock_t *block, void *p, int host_reg)
 {
     if (in_range12_b((uintptr_t) p - (uintptr_t) &cpu_state))
         host_arm64_STRB_IMM(block, host_reg, REG_CPUSTATE, (uintptr_t) p - (uintptr_t) &cpu_state);
-    else
-        fatal("codegen_direct_write_8 - not in range\n");
+    else {
+        host_arm64_MOVX_IMM(block, REG_TEMP, (uint64_t) p);
+        host_arm64_STRB_IMM(block, host_reg, REG_TEMP, 0);
+    }
 }
 void
 codegen_direct_write_16(codeblock_t *block, void *p, int host_reg)
 {
     if (in_range12_h((uintptr_t) p - (uintptr_t) &cpu_state))
         host_arm64_STRH_IMM(block, host_reg, REG_CPUSTATE, (uintptr_t) p - (uintptr_t) &cpu_state);
-    else
-        fatal("codegen_direct_write_16 - not in range\n");
+    else {
+        host_arm64_MOVX_IMM(block, REG_TEMP, (uint64_t) p);
+        host_arm64_STRH_IMM(block, host_reg, REG_TEMP, 0);
+    }
 }
 void
 codegen_direct_write_32(codeblock_t *block, void *p, int host_reg)
@@ -3470,8 +3481,10 @@ codegen_direct_write_64(codeblock_t *block, void *p, int host_reg)
 {
     if (in_range12_q((uintptr_t) p - (uintptr_t) &cpu_state))
         host_arm64_STR_IMM_F64(block, host_reg, REG_CPUSTATE, (uintptr_t) p - (uintptr_t) &cpu_state);
-    else
-        fatal("codegen_direct_write_double - not in range\n");
+    else {
+        host_arm64_MOVX_IMM(block, REG_TEMP, (uint64_t) p);
+        host_arm64_STR_IMM_F64(block, host_reg, REG_TEMP, 0);
+    }
 }
 void
 codegen_direct_write_double(codeblock_t *block, void *p, int host_reg)
@@ -66,6 +66,16 @@ in_range_h(void *addr, void *base)
     return 1;
 }
 
+static inline int
+in_range_d(void *addr, void *base)
+{
+    int diff = (uintptr_t) addr - (uintptr_t) base;
+
+    if (diff < 0 || diff > 1020 || (diff & 3))
+        return 0;
+    return 1;
+}
+
 void
 host_arm_call(codeblock_t *block, void *dst_addr)
 {
@@ -3521,8 +3531,10 @@ codegen_direct_read_8(codeblock_t *block, int host_reg, void *p)
 {
     if (in_range_h(p, &cpu_state))
         host_arm_LDRB_IMM(block, host_reg, REG_CPUSTATE, (uintptr_t) p - (uintptr_t) &cpu_state);
-    else
-        fatal("codegen_direct_read_8 - not in range\n");
+    else {
+        host_arm_MOV_IMM(block, REG_R3, (uintptr_t) p - (uintptr_t) &cpu_state);
+        host_arm_LDRB_REG_LSL(block, host_reg, REG_CPUSTATE, REG_R3, 0);
+    }
 }
 void
 codegen_direct_read_16(codeblock_t *block, int host_reg, void *p)
@@ -3550,7 +3562,12 @@ codegen_direct_read_pointer(codeblock_t *block, int host_reg, void *p)
 void
 codegen_direct_read_64(codeblock_t *block, int host_reg, void *p)
 {
-    host_arm_VLDR_D(block, host_reg, REG_CPUSTATE, (uintptr_t) p - (uintptr_t) &cpu_state);
+    if (in_range_d(p, &cpu_state))
+        host_arm_VLDR_D(block, host_reg, REG_CPUSTATE, (uintptr_t) p - (uintptr_t) &cpu_state);
+    else {
+        host_arm_MOV_IMM(block, REG_R3, (uintptr_t) p);
+        host_arm_VLDR_D(block, host_reg, REG_R3, 0);
+    }
 }
 void
 codegen_direct_read_double(codeblock_t *block, int host_reg, void *p)
@@ -3590,8 +3607,10 @@ codegen_direct_write_8(codeblock_t *block, void *p, int host_reg)
 {
     if (in_range(p, &cpu_state))
         host_arm_STRB_IMM(block, host_reg, REG_CPUSTATE, (uintptr_t) p - (uintptr_t) &cpu_state);
-    else
-        fatal("codegen_direct_write_8 - not in range\n");
+    else {
+        host_arm_MOV_IMM(block, REG_R3, (uintptr_t) p - (uintptr_t) &cpu_state);
+        host_arm_STRB_REG_LSL(block, host_reg, REG_CPUSTATE, REG_R3, 0);
+    }
 }
 void
 codegen_direct_write_16(codeblock_t *block, void *p, int host_reg)
@@ -3614,7 +3633,12 @@ codegen_direct_write_32(codeblock_t *block, void *p, int host_reg)
 void
 codegen_direct_write_64(codeblock_t *block, void *p, int host_reg)
 {
-    host_arm_VSTR_D(block, host_reg, REG_CPUSTATE, (uintptr_t) p - (uintptr_t) &cpu_state);
+    if (in_range_d(p, &cpu_state))
+        host_arm_VSTR_D(block, host_reg, REG_CPUSTATE, (uintptr_t) p - (uintptr_t) &cpu_state);
+    else {
+        host_arm_MOV_IMM(block, REG_R3, (uintptr_t) p);
+        host_arm_VSTR_D(block, host_reg, REG_R3, 0);
+    }
 }
 void
 codegen_direct_write_double(codeblock_t *block, void *p, int host_reg)
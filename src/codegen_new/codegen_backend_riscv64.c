@@ -0,0 +1,400 @@
+#if defined __riscv && (__riscv_xlen == 64)
+
+#    include <stdlib.h>
+#    include <stdint.h>
+#    include <86box/86box.h>
+#    include "cpu.h"
+#    include <86box/mem.h>
+
+#    include "codegen.h"
+#    include "codegen_allocator.h"
+#    include "codegen_backend.h"
+#    include "codegen_backend_riscv64_defs.h"
+#    include "codegen_backend_riscv64_ops.h"
+#    include "codegen_reg.h"
+#    include "x86.h"
+#    include "x86seg_common.h"
+#    include "x86seg.h"
+#    include "x87_sf.h"
+#    include "x87.h"
+
+#    if defined(__linux__) || defined(__APPLE__)
+#        include <sys/mman.h>
+#        include <unistd.h>
+#    endif
+#    include <string.h>
+
+void *codegen_mem_load_byte;
+void *codegen_mem_load_word;
+void *codegen_mem_load_long;
+void *codegen_mem_load_quad;
+void *codegen_mem_load_single;
+void *codegen_mem_load_double;
+
+void *codegen_mem_store_byte;
+void *codegen_mem_store_word;
+void *codegen_mem_store_long;
+void *codegen_mem_store_quad;
+void *codegen_mem_store_single;
+void *codegen_mem_store_double;
+
+void *codegen_fp_round;
+void *codegen_fp_round_quad;
+
+void *codegen_gpf_rout;
+void *codegen_exit_rout;
+
+host_reg_def_t codegen_host_reg_list[CODEGEN_HOST_REGS] = {
+    { REG_S1,  0},
+    { REG_S2,  0},
+    { REG_S3,  0},
+    { REG_S4,  0},
+    { REG_S5,  0},
+    { REG_S6,  0},
+    { REG_S7,  0},
+    { REG_S8,  0},
+    { REG_S9,  0},
+    { REG_S10, 0},
+    { REG_S11, 0}
+};
+
+host_reg_def_t codegen_host_fp_reg_list[CODEGEN_HOST_FP_REGS] = {
+    { REG_FS0,  0},
+    { REG_FS1,  0},
+    { REG_FS2,  0},
+    { REG_FS3,  0},
+    { REG_FS4,  0},
+    { REG_FS5,  0},
+    { REG_FS6,  0},
+    { REG_FS7,  0},
+    { REG_FS8,  0},
+    { REG_FS9,  0},
+    { REG_FS10, 0},
+    { REG_FS11, 0}
+};
+
+/*Stack frame. The bottom 64 bytes are scratch space for the register
+  allocator, followed by the saved return address and callee saved registers*/
+#    define FRAME_SIZE      272
+#    define FRAME_RA        64
+#    define FRAME_S(reg)    (72 + (reg) * 8)
+#    define FRAME_FS(reg)   (168 + (reg) * 8)
+
+/*S0-S11 and FS0-FS11 share register numbers, so a single list covers both*/
+static const int saved_regs[12] = {
+    REG_S0, REG_S1, REG_S2, REG_S3, REG_S4, REG_S5, REG_S6, REG_S7, REG_S8, REG_S9, REG_S10, REG_S11
+};
+
+static void
+build_load_routine(codeblock_t *block, int size, int is_float)
+{
+    uint32_t *branch_offset;
+    uint32_t *misaligned_offset = NULL;
+
+    /*In - A0 = address
+      Out - A0 = data, A1 = abrt*/
+    /*SRLIW A1, A0, 12
+      SLLI A1, A1, 3
+      LI A2, #readlookup2
+      ADD A1, A2, A1
+      LD A1, 0(A1)
+      LI A2, -1
+      BEQ A1, A2, +
+      ZEXT.W A2, A0
+      ADD A1, A1, A2
+      LBU A0, 0(A1)
+      LI A1, 0
+      RET
+    * ADDI SP, SP, -16
+      SD RA, 0(SP)
+      CALL readmembl
+      LBU A1, cpu_state.abrt
+      LD RA, 0(SP)
+      ADDI SP, SP, 16
+      RET
+    */
+    codegen_alloc(block, 80);
+    host_riscv64_SRLIW(block, REG_A1, REG_A0, 12);
+    host_riscv64_SLLI(block, REG_A1, REG_A1, 3);
+    host_riscv64_mov_imm64(block, REG_A2, (uint64_t) (uintptr_t) readlookup2);
+    host_riscv64_ADD(block, REG_A1, REG_A2, REG_A1);
+    host_riscv64_LD(block, REG_A1, REG_A1, 0);
+    if (size != 1) {
+        host_riscv64_ANDI(block, REG_A2, REG_A0, size - 1);
+        misaligned_offset = host_riscv64_BNE_(block, REG_A2, REG_ZERO);
+    }
+    host_riscv64_ADDI(block, REG_A2, REG_ZERO, -1);
+    branch_offset = host_riscv64_BEQ_(block, REG_A1, REG_A2);
+    host_riscv64_ZEXT_W(block, REG_A2, REG_A0);
+    host_riscv64_ADD(block, REG_A1, REG_A1, REG_A2);
+    if (size == 1 && !is_float)
+        host_riscv64_LBU(block, REG_A0, REG_A1, 0);
+    else if (size == 2 && !is_float)
+        host_riscv64_LHU(block, REG_A0, REG_A1, 0);
+    else if (size == 4 && !is_float)
+        host_riscv64_LW(block, REG_A0, REG_A1, 0);
+    else if (size == 4 && is_float)
+        host_riscv64_FLW(block, REG_V_TEMP, REG_A1, 0);
+    else if (size == 8)
+        host_riscv64_FLD(block, REG_V_TEMP, REG_A1, 0);
+    host_riscv64_mov_imm(block, REG_A1, 0);
+    host_riscv64_RET(block);
+
+    host_riscv64_branch_set_offset(branch_offset, &block_write_data[block_pos]);
+    if (size != 1)
+        host_riscv64_branch_set_offset(misaligned_offset, &block_write_data[block_pos]);
+    host_riscv64_ADDI(block, REG_XSP, REG_XSP, -16);
+    host_riscv64_SD(block, REG_RA, REG_XSP, 0);
+    if (size == 1)
+        host_riscv64_call(block, (void *) readmembl);
+    else if (size == 2)
+        host_riscv64_call(block, (void *) readmemwl);
+    else if (size == 4)
+        host_riscv64_call(block, (void *) readmemll);
+    else if (size == 8)
+        host_riscv64_call(block, (void *) readmemql);
+    else
+        fatal("build_load_routine - unknown size %i\n", size);
+    codegen_direct_read_8(block, REG_A1, &cpu_state.abrt);
+    if (size == 4 && is_float)
+        host_riscv64_FMV_W_X(block, REG_V_TEMP, REG_A0);
+    else if (size == 8)
+        host_riscv64_FMV_D_X(block, REG_V_TEMP, REG_A0);
+    host_riscv64_LD(block, REG_RA, REG_XSP, 0);
+    host_riscv64_ADDI(block, REG_XSP, REG_XSP, 16);
+    host_riscv64_RET(block);
+}
+
+static void
+build_store_routine(codeblock_t *block, int size, int is_float)
+{
+    uint32_t *branch_offset;
+    uint32_t *misaligned_offset = NULL;
+
+    /*In - A0 = address, A1 = data
+      Out - A1 = abrt*/
+    /*SRLIW A2, A0, 12
+      SLLI A2, A2, 3
+      LI A3, #writelookup2
+      ADD A2, A3, A2
+      LD A2, 0(A2)
+      LI A3, -1
+      BEQ A2, A3, +
+      ZEXT.W A3, A0
+      ADD A2, A2, A3
+      SB A1, 0(A2)
+      LI A1, 0
+      RET
+    * ADDI SP, SP, -16
+      SD RA, 0(SP)
+      CALL writemembl
+      LBU A1, cpu_state.abrt
+      LD RA, 0(SP)
+      ADDI SP, SP, 16
+      RET
+    */
+    codegen_alloc(block, 80);
+    host_riscv64_SRLIW(block, REG_A2, REG_A0, 12);
+    host_riscv64_SLLI(block, REG_A2, REG_A2, 3);
+    host_riscv64_mov_imm64(block, REG_A3, (uint64_t) (uintptr_t) writelookup2);
+    host_riscv64_ADD(block, REG_A2, REG_A3, REG_A2);
+    host_riscv64_LD(block, REG_A2, REG_A2, 0);
+    if (size != 1) {
+        host_riscv64_ANDI(block, REG_A3, REG_A0, size - 1);
+        misaligned_offset = host_riscv64_BNE_(block, REG_A3, REG_ZERO);
+    }
+    host_riscv64_ADDI(block, REG_A3, REG_ZERO, -1);
+    branch_offset = host_riscv64_BEQ_(block, REG_A2, REG_A3);
+    host_riscv64_ZEXT_W(block, REG_A3, REG_A0);
+    host_riscv64_ADD(block, REG_A2, REG_A2, REG_A3);
+    if (size == 1 && !is_float)
+        host_riscv64_SB(block, REG_A1, REG_A2, 0);
+    else if (size == 2 && !is_float)
+        host_riscv64_SH(block, REG_A1, REG_A2, 0);
+    else if (size == 4 && !is_float)
+        host_riscv64_SW(block, REG_A1, REG_A2, 0);
+    else if (size == 4 && is_float)
+        host_riscv64_FSW(block, REG_V_TEMP, REG_A2, 0);
+    else if (size == 8)
+        host_riscv64_FSD(block, REG_V_TEMP, REG_A2, 0);
+    host_riscv64_mov_imm(block, REG_A1, 0);
+    host_riscv64_RET(block);
+
+    host_riscv64_branch_set_offset(branch_offset, &block_write_data[block_pos]);
+    if (size != 1)
+        host_riscv64_branch_set_offset(misaligned_offset, &block_write_data[block_pos]);
+    host_riscv64_ADDI(block, REG_XSP, REG_XSP, -16);
+    host_riscv64_SD(block, REG_RA, REG_XSP, 0);
+    if (size == 4 && is_float)
+        host_riscv64_FMV_X_W(block, REG_A1, REG_V_TEMP);
+    else if (size == 8)
+        host_riscv64_FMV_X_D(block, REG_A1, REG_V_TEMP);
+    if (size == 1)
+        host_riscv64_call(block, (void *) writemembl);
+    else if (size == 2)
+        host_riscv64_call(block, (void *) writememwl);
+    else if (size == 4)
+        host_riscv64_call(block, (void *) writememll);
+    else if (size == 8)
+        host_riscv64_call(block, (void *) writememql);
+    else
+        fatal("build_store_routine - unknown size %i\n", size);
+    codegen_direct_read_8(block, REG_A1, &cpu_state.abrt);
+    host_riscv64_LD(block, REG_RA, REG_XSP, 0);
+    host_riscv64_ADDI(block, REG_XSP, REG_XSP, 16);
+    host_riscv64_RET(block);
+}
+
+static void
+build_loadstore_routines(codeblock_t *block)
+{
+    codegen_mem_load_byte = &block_write_data[block_pos];
+    build_load_routine(block, 1, 0);
+    codegen_mem_load_word = &block_write_data[block_pos];
+    build_load_routine(block, 2, 0);
+    codegen_mem_load_long = &block_write_data[block_pos];
+    build_load_routine(block, 4, 0);
+    codegen_mem_load_quad = &block_write_data[block_pos];
+    build_load_routine(block, 8, 0);
+    codegen_mem_load_single = &block_write_data[block_pos];
+    build_load_routine(block, 4, 1);
+    codegen_mem_load_double = &block_write_data[block_pos];
+    build_load_routine(block, 8, 1);
+
+    codegen_mem_store_byte = &block_write_data[block_pos];
+    build_store_routine(block, 1, 0);
+    codegen_mem_store_word = &block_write_data[block_pos];
+    build_store_routine(block, 2, 0);
+    codegen_mem_store_long = &block_write_data[block_pos];
+    build_store_routine(block, 4, 0);
+    codegen_mem_store_quad = &block_write_data[block_pos];
+    build_store_routine(block, 8, 0);
+    codegen_mem_store_single = &block_write_data[block_pos];
+    build_store_routine(block, 4, 1);
+    codegen_mem_store_double = &block_write_data[block_pos];
+    build_store_routine(block, 8, 1);
+}
+
+static void
+build_fp_round_routine(codeblock_t *block, int is_quad)
+{
+    /*In - FT0 = value
+      Out - T0 = rounded integer*/
+    /*new_fp_control holds the RISC-V rounding mode, so swap it into frm for
+      the conversion and restore the old mode afterwards*/
+    codegen_alloc(block, 20);
+    host_riscv64_LW(block, REG_TEMP2, REG_CPUSTATE, (uintptr_t) &cpu_state.new_fp_control - (uintptr_t) &cpu_state);
+    host_riscv64_FSRM(block, REG_TEMP2, REG_TEMP2);
+    if (is_quad)
+        host_riscv64_FCVT_L_D(block, REG_TEMP, REG_V_TEMP, RISCV64_RM_DYN);
+    else
+        host_riscv64_FCVT_W_D(block, REG_TEMP, REG_V_TEMP, RISCV64_RM_DYN);
+    host_riscv64_FSRM(block, REG_ZERO, REG_TEMP2);
+    host_riscv64_RET(block);
+}
+
+static void
+build_restore_regs(codeblock_t *block)
+{
+    host_riscv64_LD(block, REG_RA, REG_XSP, FRAME_RA);
+    for (int c = 0; c < 12; c++)
+        host_riscv64_LD(block, saved_regs[c], REG_XSP, FRAME_S(c));
+    for (int c = 0; c < 12; c++)
+        host_riscv64_FLD(block, saved_regs[c], REG_XSP, FRAME_FS(c));
+    host_riscv64_ADDI(block, REG_XSP, REG_XSP, FRAME_SIZE);
+    host_riscv64_RET(block);
+}
+
+void
+codegen_backend_init(void)
+{
+    codeblock_t *block;
+
+    codeblock      = malloc(BLOCK_SIZE * sizeof(codeblock_t));
+    codeblock_hash = malloc(HASH_SIZE * sizeof(codeblock_t *));
+
+    memset(codeblock, 0, BLOCK_SIZE * sizeof(codeblock_t));
+    memset(codeblock_hash, 0, HASH_SIZE * sizeof(codeblock_t *));
+
+    for (int c = 0; c < BLOCK_SIZE; c++) {
+        codeblock[c].pc = BLOCK_PC_INVALID;
+    }
+
+    block_current         = 0;
+    block_pos             = 0;
+    block                 = &codeblock[block_current];
+    block->head_mem_block = codegen_allocator_allocate(NULL, block_current);
+    block->data           = codeblock_allocator_get_ptr(block->head_mem_block);
+    block_write_data      = block->data;
+    build_loadstore_routines(block);
+
+    codegen_fp_round = &block_write_data[block_pos];
+    build_fp_round_routine(block, 0);
+    codegen_fp_round_quad = &block_write_data[block_pos];
+    build_fp_round_routine(block, 1);
+
+    codegen_alloc(block, 160);
+    codegen_gpf_rout = &block_write_data[block_pos];
+    host_riscv64_mov_imm(block, REG_ARG0, 0);
+    host_riscv64_mov_imm(block, REG_ARG1, 0);
+    host_riscv64_call(block, (void *) x86gpf);
+
+    codegen_exit_rout = &block_write_data[block_pos];
+    build_restore_regs(block);
+
+    block_write_data = NULL;
+
+    codegen_allocator_clean_blocks(block->head_mem_block);
+
+    asm("frrm %0\n"
+        : "=r"(cpu_state.old_fp_control));
+}
+
+void
+codegen_set_rounding_mode(int mode)
+{
+    static const int rounding_modes[4] = {
+        [X87_ROUNDING_NEAREST] = RISCV64_RM_RNE,
+        [X87_ROUNDING_DOWN]    = RISCV64_RM_RDN,
+        [X87_ROUNDING_UP]      = RISCV64_RM_RUP,
+        [X87_ROUNDING_CHOP]    = RISCV64_RM_RTZ
+    };
+
+    if (mode < 0 || mode > 3)
+        fatal("codegen_set_rounding_mode - invalid mode\n");
+    cpu_state.new_fp_control = rounding_modes[mode];
+}
+
+/*S0 - cpu_state*/
+void
+codegen_backend_prologue(codeblock_t *block)
+{
+    block_pos = BLOCK_START;
+
+    /*Entry code*/
+
+    host_riscv64_ADDI(block, REG_XSP, REG_XSP, -FRAME_SIZE);
+    host_riscv64_SD(block, REG_RA, REG_XSP, FRAME_RA);
+    for (int c = 0; c < 12; c++)
+        host_riscv64_SD(block, saved_regs[c], REG_XSP, FRAME_S(c));
+    for (int c = 0; c < 12; c++)
+        host_riscv64_FSD(block, saved_regs[c], REG_XSP, FRAME_FS(c));
+
+    host_riscv64_mov_imm64(block, REG_CPUSTATE, (uint64_t) (uintptr_t) &cpu_state);
+
+    if (block->flags & CODEBLOCK_HAS_FPU) {
+        host_riscv64_LW(block, REG_TEMP, REG_CPUSTATE, (uintptr_t) &cpu_state.TOP - (uintptr_t) &cpu_state);
+        host_riscv64_ADDIW(block, REG_TEMP, REG_TEMP, -block->TOP);
+        host_riscv64_SW(block, REG_TEMP, REG_XSP, IREG_TOP_diff_stack_offset);
+    }
+}
+
+void
+codegen_backend_epilogue(codeblock_t *block)
+{
+    build_restore_regs(block);
+
+    codegen_allocator_clean_blocks(block->head_mem_block);
+}
+
+#endif
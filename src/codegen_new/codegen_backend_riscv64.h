@@ -0,0 +1,23 @@
+#include "codegen_backend_riscv64_defs.h"
+
+#define BLOCK_SIZE  0x4000
+#define BLOCK_MASK  0x3fff
+#define BLOCK_START 0
+
+#define HASH_SIZE   0x20000
+#define HASH_MASK   0x1ffff
+
+#define HASH(l)     ((l) &0x1ffff)
+
+#define BLOCK_MAX   0x3c0
+
+void host_riscv64_JALR(codeblock_t *block, int dst_reg, int src_reg, int offset);
+void host_riscv64_LD(codeblock_t *block, int dst_reg, int base_reg, int offset);
+void host_riscv64_LW(codeblock_t *block, int dst_reg, int base_reg, int offset);
+void host_riscv64_SD(codeblock_t *block, int src_reg, int base_reg, int offset);
+void host_riscv64_SW(codeblock_t *block, int src_reg, int base_reg, int offset);
+void host_riscv64_FLD(codeblock_t *block, int dst_reg, int base_reg, int offset);
+void host_riscv64_FSD(codeblock_t *block, int src_reg, int base_reg, int offset);
+
+void host_riscv64_call(codeblock_t *block, void *dst_addr);
+void host_riscv64_mov_imm(codeblock_t *block, int reg, uint32_t imm_data);
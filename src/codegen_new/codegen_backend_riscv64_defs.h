@@ -0,0 +1,111 @@
+#define REG_ZERO             0
+#define REG_RA               1
+/*Not REG_SP, which codegen_ops.h uses for the x86 register*/
+#define REG_XSP              2
+#define REG_GP               3
+#define REG_TP               4
+#define REG_T0               5
+#define REG_T1               6
+#define REG_T2               7
+#define REG_S0               8
+#define REG_S1               9
+#define REG_A0               10
+#define REG_A1               11
+#define REG_A2               12
+#define REG_A3               13
+#define REG_A4               14
+#define REG_A5               15
+#define REG_A6               16
+#define REG_A7               17
+#define REG_S2               18
+#define REG_S3               19
+#define REG_S4               20
+#define REG_S5               21
+#define REG_S6               22
+#define REG_S7               23
+#define REG_S8               24
+#define REG_S9               25
+#define REG_S10              26
+#define REG_S11              27
+#define REG_T3               28
+#define REG_T4               29
+#define REG_T5               30
+#define REG_T6               31
+
+#define REG_FT0              0
+#define REG_FT1              1
+#define REG_FT2              2
+#define REG_FT3              3
+#define REG_FT4              4
+#define REG_FT5              5
+#define REG_FT6              6
+#define REG_FT7              7
+#define REG_FS0              8
+#define REG_FS1              9
+#define REG_FA0              10
+#define REG_FA1              11
+#define REG_FA2              12
+#define REG_FA3              13
+#define REG_FA4              14
+#define REG_FA5              15
+#define REG_FA6              16
+#define REG_FA7              17
+#define REG_FS2              18
+#define REG_FS3              19
+#define REG_FS4              20
+#define REG_FS5              21
+#define REG_FS6              22
+#define REG_FS7              23
+#define REG_FS8              24
+#define REG_FS9              25
+#define REG_FS10             26
+#define REG_FS11             27
+#define REG_FT8              28
+#define REG_FT9              29
+#define REG_FT10             30
+#define REG_FT11             31
+
+#define REG_ARG0             REG_A0
+#define REG_ARG1             REG_A1
+#define REG_ARG2             REG_A2
+#define REG_ARG3             REG_A3
+
+#define REG_CPUSTATE         REG_S0
+
+/*T4-T6 are used internally by the ops for immediates, masks and far
+  branches, and must not be passed to them*/
+#define REG_TEMP             REG_T0
+#define REG_TEMP2            REG_T1
+#define REG_TEMP3            REG_T2
+#define REG_TEMP4            REG_T3
+
+#define REG_V_TEMP           REG_FT0
+#define REG_V_TEMP2          REG_FT1
+
+#define CODEGEN_HOST_REGS    11
+#define CODEGEN_HOST_FP_REGS 12
+
+/*Number of uOPs to look ahead for register reads when choosing a host register
+  to spill. Backends with few host registers spill often and benefit from a
+  longer window*/
+#define CODEGEN_HOST_REG_LOOKAHEAD 8
+
+extern void *codegen_mem_load_byte;
+extern void *codegen_mem_load_word;
+extern void *codegen_mem_load_long;
+extern void *codegen_mem_load_quad;
+extern void *codegen_mem_load_single;
+extern void *codegen_mem_load_double;
+
+extern void *codegen_mem_store_byte;
+extern void *codegen_mem_store_word;
+extern void *codegen_mem_store_long;
+extern void *codegen_mem_store_quad;
+extern void *codegen_mem_store_single;
+extern void *codegen_mem_store_double;
+
+extern void *codegen_fp_round;
+extern void *codegen_fp_round_quad;
+
+extern void *codegen_gpf_rout;
+extern void *codegen_exit_rout;
@@ -0,0 +1,822 @@
+#if defined __riscv && (__riscv_xlen == 64)
+
+#    include <inttypes.h>
+#    include <stdint.h>
+#    include <86box/86box.h>
+#    include "cpu.h"
+#    include <86box/mem.h>
+#    include <86box/plat_unused.h>
+
+#    include "codegen.h"
+#    include "codegen_allocator.h"
+#    include "codegen_backend.h"
+#    include "codegen_backend_riscv64_defs.h"
+#    include "codegen_backend_riscv64_ops.h"
+
+#    define Rd(x)                ((x) << 7)
+#    define Rs1(x)               ((x) << 15)
+#    define Rs2(x)               ((x) << 20)
+#    define FUNCT3(x)            ((x) << 12)
+#    define FUNCT7(x)            ((x) << 25)
+
+#    define IMM_I(x)             (((x) & 0xfff) << 20)
+#    define IMM_S(x)             ((((x) & 0xfe0) << 20) | (((x) & 0x1f) << 7))
+#    define IMM_B(x)             ((((x) & 0x1000) << 19) | (((x) & 0x7e0) << 20) | (((x) & 0x1e) << 7) | (((x) & 0x800) >> 4))
+#    define IMM_U(x)             (((x) & 0xfffff) << 12)
+#    define SHAMT(x)             (((x) & 0x3f) << 20)
+#    define RM(x)                ((x) << 12)
+
+#    define OPCODE_LOAD          (0x03)
+#    define OPCODE_LOAD_FP       (0x07)
+#    define OPCODE_OP_IMM        (0x13)
+#    define OPCODE_AUIPC         (0x17)
+#    define OPCODE_OP_IMM_32     (0x1b)
+#    define OPCODE_STORE         (0x23)
+#    define OPCODE_STORE_FP      (0x27)
+#    define OPCODE_OP            (0x33)
+#    define OPCODE_LUI           (0x37)
+#    define OPCODE_OP_32         (0x3b)
+#    define OPCODE_OP_FP         (0x53)
+#    define OPCODE_BRANCH        (0x63)
+#    define OPCODE_JALR          (0x67)
+#    define OPCODE_SYSTEM        (0x73)
+
+#    define OPCODE_ADD           (OPCODE_OP | FUNCT3(0) | FUNCT7(0x00))
+#    define OPCODE_SUB           (OPCODE_OP | FUNCT3(0) | FUNCT7(0x20))
+#    define OPCODE_SLL           (OPCODE_OP | FUNCT3(1) | FUNCT7(0x00))
+#    define OPCODE_SLT           (OPCODE_OP | FUNCT3(2) | FUNCT7(0x00))
+#    define OPCODE_SLTU          (OPCODE_OP | FUNCT3(3) | FUNCT7(0x00))
+#    define OPCODE_XOR           (OPCODE_OP | FUNCT3(4) | FUNCT7(0x00))
+#    define OPCODE_SRL           (OPCODE_OP | FUNCT3(5) | FUNCT7(0x00))
+#    define OPCODE_SRA           (OPCODE_OP | FUNCT3(5) | FUNCT7(0x20))
+#    define OPCODE_OR            (OPCODE_OP | FUNCT3(6) | FUNCT7(0x00))
+#    define OPCODE_AND           (OPCODE_OP | FUNCT3(7) | FUNCT7(0x00))
+#    define OPCODE_MUL           (OPCODE_OP | FUNCT3(0) | FUNCT7(0x01))
+
+#    define OPCODE_ADDW          (OPCODE_OP_32 | FUNCT3(0) | FUNCT7(0x00))
+#    define OPCODE_SUBW          (OPCODE_OP_32 | FUNCT3(0) | FUNCT7(0x20))
+#    define OPCODE_SLLW          (OPCODE_OP_32 | FUNCT3(1) | FUNCT7(0x00))
+#    define OPCODE_SRLW          (OPCODE_OP_32 | FUNCT3(5) | FUNCT7(0x00))
+#    define OPCODE_SRAW          (OPCODE_OP_32 | FUNCT3(5) | FUNCT7(0x20))
+#    define OPCODE_MULW          (OPCODE_OP_32 | FUNCT3(0) | FUNCT7(0x01))
+
+#    define OPCODE_ADDI          (OPCODE_OP_IMM | FUNCT3(0))
+#    define OPCODE_SLLI          (OPCODE_OP_IMM | FUNCT3(1))
+#    define OPCODE_XORI          (OPCODE_OP_IMM | FUNCT3(4))
+#    define OPCODE_SRLI          (OPCODE_OP_IMM | FUNCT3(5))
+#    define OPCODE_SRAI          (OPCODE_OP_IMM | FUNCT3(5) | (0x10 << 26))
+#    define OPCODE_ORI           (OPCODE_OP_IMM | FUNCT3(6))
+#    define OPCODE_ANDI          (OPCODE_OP_IMM | FUNCT3(7))
+
+#    define OPCODE_ADDIW         (OPCODE_OP_IMM_32 | FUNCT3(0))
+#    define OPCODE_SLLIW         (OPCODE_OP_IMM_32 | FUNCT3(1))
+#    define OPCODE_SRLIW         (OPCODE_OP_IMM_32 | FUNCT3(5))
+#    define OPCODE_SRAIW         (OPCODE_OP_IMM_32 | FUNCT3(5) | (0x20 << 25))
+
+#    define OPCODE_LB            (OPCODE_LOAD | FUNCT3(0))
+#    define OPCODE_LH            (OPCODE_LOAD | FUNCT3(1))
+#    define OPCODE_LW            (OPCODE_LOAD | FUNCT3(2))
+#    define OPCODE_LD            (OPCODE_LOAD | FUNCT3(3))
+#    define OPCODE_LBU           (OPCODE_LOAD | FUNCT3(4))
+#    define OPCODE_LHU           (OPCODE_LOAD | FUNCT3(5))
+#    define OPCODE_LWU           (OPCODE_LOAD | FUNCT3(6))
+
+#    define OPCODE_SB            (OPCODE_STORE | FUNCT3(0))
+#    define OPCODE_SH            (OPCODE_STORE | FUNCT3(1))
+#    define OPCODE_SW            (OPCODE_STORE | FUNCT3(2))
+#    define OPCODE_SD            (OPCODE_STORE | FUNCT3(3))
+
+#    define OPCODE_FLW           (OPCODE_LOAD_FP | FUNCT3(2))
+#    define OPCODE_FLD           (OPCODE_LOAD_FP | FUNCT3(3))
+#    define OPCODE_FSW           (OPCODE_STORE_FP | FUNCT3(2))
+#    define OPCODE_FSD           (OPCODE_STORE_FP | FUNCT3(3))
+
+#    define OPCODE_BEQ           (OPCODE_BRANCH | FUNCT3(0))
+#    define OPCODE_BNE           (OPCODE_BRANCH | FUNCT3(1))
+#    define OPCODE_BLT           (OPCODE_BRANCH | FUNCT3(4))
+#    define OPCODE_BGE           (OPCODE_BRANCH | FUNCT3(5))
+#    define OPCODE_BLTU          (OPCODE_BRANCH | FUNCT3(6))
+#    define OPCODE_BGEU          (OPCODE_BRANCH | FUNCT3(7))
+
+#    define OPCODE_FADD_D        (OPCODE_OP_FP | FUNCT7(0x01))
+#    define OPCODE_FSUB_D        (OPCODE_OP_FP | FUNCT7(0x05))
+#    define OPCODE_FMUL_D        (OPCODE_OP_FP | FUNCT7(0x09))
+#    define OPCODE_FDIV_D        (OPCODE_OP_FP | FUNCT7(0x0d))
+#    define OPCODE_FSGNJ_D       (OPCODE_OP_FP | FUNCT7(0x11) | FUNCT3(0))
+#    define OPCODE_FSGNJN_D      (OPCODE_OP_FP | FUNCT7(0x11) | FUNCT3(1))
+#    define OPCODE_FSGNJX_D      (OPCODE_OP_FP | FUNCT7(0x11) | FUNCT3(2))
+#    define OPCODE_FCVT_S_D      (OPCODE_OP_FP | FUNCT7(0x20) | Rs2(1))
+#    define OPCODE_FCVT_D_S      (OPCODE_OP_FP | FUNCT7(0x21) | Rs2(0))
+#    define OPCODE_FSQRT_D       (OPCODE_OP_FP | FUNCT7(0x2d) | Rs2(0))
+#    define OPCODE_FLT_D         (OPCODE_OP_FP | FUNCT7(0x51) | FUNCT3(1))
+#    define OPCODE_FEQ_D         (OPCODE_OP_FP | FUNCT7(0x51) | FUNCT3(2))
+#    define OPCODE_FCVT_W_D      (OPCODE_OP_FP | FUNCT7(0x61) | Rs2(0))
+#    define OPCODE_FCVT_L_D      (OPCODE_OP_FP | FUNCT7(0x61) | Rs2(2))
+#    define OPCODE_FCVT_D_W      (OPCODE_OP_FP | FUNCT7(0x69) | Rs2(0))
+#    define OPCODE_FCVT_D_L      (OPCODE_OP_FP | FUNCT7(0x69) | Rs2(2))
+#    define OPCODE_FMV_X_W       (OPCODE_OP_FP | FUNCT7(0x70))
+#    define OPCODE_FMV_X_D       (OPCODE_OP_FP | FUNCT7(0x71))
+#    define OPCODE_FMV_W_X       (OPCODE_OP_FP | FUNCT7(0x78))
+#    define OPCODE_FMV_D_X       (OPCODE_OP_FP | FUNCT7(0x79))
+
+#    define CSR_FRM              (0x002)
+#    define OPCODE_CSRRW         (OPCODE_SYSTEM | FUNCT3(1))
+#    define OPCODE_CSRRS         (OPCODE_SYSTEM | FUNCT3(2))
+
+/*Register used internally for immediates, far jumps and block chaining. Any
+  sequence that loads it must be emitted with codegen_alloc() first, so that it
+  can not be split by the chaining jump*/
+#    define REG_SCRATCH          REG_T6
+/*Register used internally by BFI*/
+#    define REG_SCRATCH2         REG_T5
+
+/*Longest sequence host_riscv64_mov_imm64() can emit*/
+#    define MOV_IMM64_MAX_SIZE   (8 * 4)
+
+/*Returns true if imm_data fits into a signed 12 bit immediate*/
+static inline int
+imm_is_imm12(int64_t imm_data)
+{
+    return (imm_data >= -2048 && imm_data < 2048);
+}
+
+/*Returns true if offset fits into 32 bits, as reachable by AUIPC+JALR*/
+static inline int
+offset_is_32bit(int64_t offset)
+{
+    return (offset >= (-0x7fffffffLL - 1 + 0x800) && offset < (0x7fffffffLL - 0x800));
+}
+
+static void codegen_allocate_new_block(codeblock_t *block);
+
+static inline void
+codegen_addlong(codeblock_t *block, uint32_t val)
+{
+    if (block_pos >= (BLOCK_MAX - 8))
+        codegen_allocate_new_block(block);
+    *(uint32_t *) &block_write_data[block_pos] = val;
+    block_pos += 4;
+}
+
+static void
+codegen_allocate_new_block(codeblock_t *block)
+{
+    /*Current block is full. Allocate a new block*/
+    struct mem_block_t *new_block = codegen_allocator_allocate(block->head_mem_block, get_block_nr(block));
+    uint8_t            *new_ptr   = codeblock_allocator_get_ptr(new_block);
+    int64_t             offset    = (intptr_t) new_ptr - (intptr_t) &block_write_data[block_pos];
+    uint32_t           *opcode    = (uint32_t *) &block_write_data[block_pos];
+
+    if (!offset_is_32bit(offset))
+        fatal("codegen_allocate_new_block - offset out of range %" PRIx64 "\n", (uint64_t) offset);
+    /*Add a jump to the new block*/
+    opcode[0] = OPCODE_AUIPC | Rd(REG_SCRATCH) | IMM_U((offset + 0x800) >> 12);
+    opcode[1] = OPCODE_JALR | Rd(REG_ZERO) | Rs1(REG_SCRATCH) | IMM_I(offset);
+
+    /*Set write address to start of new block*/
+    block_pos        = 0;
+    block_write_data = new_ptr;
+}
+
+void
+codegen_alloc(codeblock_t *block, int size)
+{
+    if (block_pos >= (BLOCK_MAX - size - 4))
+        codegen_allocate_new_block(block);
+}
+
+static inline void
+host_riscv64_r_type(codeblock_t *block, uint32_t opcode, int dst_reg, int src_reg_a, int src_reg_b)
+{
+    codegen_addlong(block, opcode | Rd(dst_reg) | Rs1(src_reg_a) | Rs2(src_reg_b));
+}
+static inline void
+host_riscv64_i_type(codeblock_t *block, uint32_t opcode, int dst_reg, int src_reg, int imm_data)
+{
+    if (!imm_is_imm12(imm_data))
+        fatal("host_riscv64_i_type - immediate out of range %i\n", imm_data);
+    codegen_addlong(block, opcode | Rd(dst_reg) | Rs1(src_reg) | IMM_I(imm_data));
+}
+static inline void
+host_riscv64_s_type(codeblock_t *block, uint32_t opcode, int src_reg, int base_reg, int offset)
+{
+    if (!imm_is_imm12(offset))
+        fatal("host_riscv64_s_type - offset out of range %i\n", offset);
+    codegen_addlong(block, opcode | Rs1(base_reg) | Rs2(src_reg) | IMM_S(offset));
+}
+
+void
+host_riscv64_ADD(codeblock_t *block, int dst_reg, int src_reg_a, int src_reg_b)
+{
+    host_riscv64_r_type(block, OPCODE_ADD, dst_reg, src_reg_a, src_reg_b);
+}
+void
+host_riscv64_ADDW(codeblock_t *block, int dst_reg, int src_reg_a, int src_reg_b)
+{
+    host_riscv64_r_type(block, OPCODE_ADDW, dst_reg, src_reg_a, src_reg_b);
+}
+void
+host_riscv64_ADDI(codeblock_t *block, int dst_reg, int src_reg, int imm_data)
+{
+    host_riscv64_i_type(block, OPCODE_ADDI, dst_reg, src_reg, imm_data);
+}
+void
+host_riscv64_ADDIW(codeblock_t *block, int dst_reg, int src_reg, int imm_data)
+{
+    host_riscv64_i_type(block, OPCODE_ADDIW, dst_reg, src_reg, imm_data);
+}
+
+void
+host_riscv64_AND(codeblock_t *block, int dst_reg, int src_reg_a, int src_reg_b)
+{
+    host_riscv64_r_type(block, OPCODE_AND, dst_reg, src_reg_a, src_reg_b);
+}
+void
+host_riscv64_ANDI(codeblock_t *block, int dst_reg, int src_reg, int imm_data)
+{
+    host_riscv64_i_type(block, OPCODE_ANDI, dst_reg, src_reg, imm_data);
+}
+
+void
+host_riscv64_AUIPC(codeblock_t *block, int dst_reg, uint32_t imm_data)
+{
+    codegen_addlong(block, OPCODE_AUIPC | Rd(dst_reg) | IMM_U(imm_data));
+}
+void
+host_riscv64_LUI(codeblock_t *block, int dst_reg, uint32_t imm_data)
+{
+    codegen_addlong(block, OPCODE_LUI | Rd(dst_reg) | IMM_U(imm_data));
+}
+
+void
+host_riscv64_MUL(codeblock_t *block, int dst_reg, int src_reg_a, int src_reg_b)
+{
+    host_riscv64_r_type(block, OPCODE_MUL, dst_reg, src_reg_a, src_reg_b);
+}
+void
+host_riscv64_MULW(codeblock_t *block, int dst_reg, int src_reg_a, int src_reg_b)
+{
+    host_riscv64_r_type(block, OPCODE_MULW, dst_reg, src_reg_a, src_reg_b);
+}
+
+void
+host_riscv64_OR(codeblock_t *block, int dst_reg, int src_reg_a, int src_reg_b)
+{
+    host_riscv64_r_type(block, OPCODE_OR, dst_reg, src_reg_a, src_reg_b);
+}
+void
+host_riscv64_ORI(codeblock_t *block, int dst_reg, int src_reg, int imm_data)
+{
+    host_riscv64_i_type(block, OPCODE_ORI, dst_reg, src_reg, imm_data);
+}
+
+void
+host_riscv64_SLL(codeblock_t *block, int dst_reg, int src_reg, int shift_reg)
+{
+    host_riscv64_r_type(block, OPCODE_SLL, dst_reg, src_reg, shift_reg);
+}
+void
+host_riscv64_SLLI(codeblock_t *block, int dst_reg, int src_reg, int shift)
+{
+    codegen_addlong(block, OPCODE_SLLI | Rd(dst_reg) | Rs1(src_reg) | SHAMT(shift));
+}
+void
+host_riscv64_SLLIW(codeblock_t *block, int dst_reg, int src_reg, int shift)
+{
+    codegen_addlong(block, OPCODE_SLLIW | Rd(dst_reg) | Rs1(src_reg) | SHAMT(shift & 31));
+}
+void
+host_riscv64_SLLW(codeblock_t *block, int dst_reg, int src_reg, int shift_reg)
+{
+    host_riscv64_r_type(block, OPCODE_SLLW, dst_reg, src_reg, shift_reg);
+}
+
+void
+host_riscv64_SLT(codeblock_t *block, int dst_reg, int src_reg_a, int src_reg_b)
+{
+    host_riscv64_r_type(block, OPCODE_SLT, dst_reg, src_reg_a, src_reg_b);
+}
+void
+host_riscv64_SLTU(codeblock_t *block, int dst_reg, int src_reg_a, int src_reg_b)
+{
+    host_riscv64_r_type(block, OPCODE_SLTU, dst_reg, src_reg_a, src_reg_b);
+}
+
+void
+host_riscv64_SRA(codeblock_t *block, int dst_reg, int src_reg, int shift_reg)
+{
+    host_riscv64_r_type(block, OPCODE_SRA, dst_reg, src_reg, shift_reg);
+}
+void
+host_riscv64_SRAI(codeblock_t *block, int dst_reg, int src_reg, int shift)
+{
+    codegen_addlong(block, OPCODE_SRAI | Rd(dst_reg) | Rs1(src_reg) | SHAMT(shift));
+}
+void
+host_riscv64_SRAIW(codeblock_t *block, int dst_reg, int src_reg, int shift)
+{
+    codegen_addlong(block, OPCODE_SRAIW | Rd(dst_reg) | Rs1(src_reg) | SHAMT(shift & 31));
+}
+void
+host_riscv64_SRAW(codeblock_t *block, int dst_reg, int src_reg, int shift_reg)
+{
+    host_riscv64_r_type(block, OPCODE_SRAW, dst_reg, src_reg, shift_reg);
+}
+
+void
+host_riscv64_SRL(codeblock_t *block, int dst_reg, int src_reg, int shift_reg)
+{
+    host_riscv64_r_type(block, OPCODE_SRL, dst_reg, src_reg, shift_reg);
+}
+void
+host_riscv64_SRLI(codeblock_t *block, int dst_reg, int src_reg, int shift)
+{
+    codegen_addlong(block, OPCODE_SRLI | Rd(dst_reg) | Rs1(src_reg) | SHAMT(shift));
+}
+void
+host_riscv64_SRLIW(codeblock_t *block, int dst_reg, int src_reg, int shift)
+{
+    codegen_addlong(block, OPCODE_SRLIW | Rd(dst_reg) | Rs1(src_reg) | SHAMT(shift & 31));
+}
+void
+host_riscv64_SRLW(codeblock_t *block, int dst_reg, int src_reg, int shift_reg)
+{
+    host_riscv64_r_type(block, OPCODE_SRLW, dst_reg, src_reg, shift_reg);
+}
+
+void
+host_riscv64_SUB(codeblock_t *block, int dst_reg, int src_reg_a, int src_reg_b)
+{
+    host_riscv64_r_type(block, OPCODE_SUB, dst_reg, src_reg_a, src_reg_b);
+}
+void
+host_riscv64_SUBW(codeblock_t *block, int dst_reg, int src_reg_a, int src_reg_b)
+{
+    host_riscv64_r_type(block, OPCODE_SUBW, dst_reg, src_reg_a, src_reg_b);
+}
+
+void
+host_riscv64_XOR(codeblock_t *block, int dst_reg, int src_reg_a, int src_reg_b)
+{
+    host_riscv64_r_type(block, OPCODE_XOR, dst_reg, src_reg_a, src_reg_b);
+}
+void
+host_riscv64_XORI(codeblock_t *block, int dst_reg, int src_reg, int imm_data)
+{
+    host_riscv64_i_type(block, OPCODE_XORI, dst_reg, src_reg, imm_data);
+}
+
+void
+host_riscv64_LB(codeblock_t *block, int dst_reg, int base_reg, int offset)
+{
+    host_riscv64_i_type(block, OPCODE_LB, dst_reg, base_reg, offset);
+}
+void
+host_riscv64_LBU(codeblock_t *block, int dst_reg, int base_reg, int offset)
+{
+    host_riscv64_i_type(block, OPCODE_LBU, dst_reg, base_reg, offset);
+}
+void
+host_riscv64_LD(codeblock_t *block, int dst_reg, int base_reg, int offset)
+{
+    host_riscv64_i_type(block, OPCODE_LD, dst_reg, base_reg, offset);
+}
+void
+host_riscv64_LH(codeblock_t *block, int dst_reg, int base_reg, int offset)
+{
+    host_riscv64_i_type(block, OPCODE_LH, dst_reg, base_reg, offset);
+}
+void
+host_riscv64_LHU(codeblock_t *block, int dst_reg, int base_reg, int offset)
+{
+    host_riscv64_i_type(block, OPCODE_LHU, dst_reg, base_reg, offset);
+}
+void
+host_riscv64_LW(codeblock_t *block, int dst_reg, int base_reg, int offset)
+{
+    host_riscv64_i_type(block, OPCODE_LW, dst_reg, base_reg, offset);
+}
+void
+host_riscv64_LWU(codeblock_t *block, int dst_reg, int base_reg, int offset)
+{
+    host_riscv64_i_type(block, OPCODE_LWU, dst_reg, base_reg, offset);
+}
+
+void
+host_riscv64_SB(codeblock_t *block, int src_reg, int base_reg, int offset)
+{
+    host_riscv64_s_type(block, OPCODE_SB, src_reg, base_reg, offset);
+}
+void
+host_riscv64_SD(codeblock_t *block, int src_reg, int base_reg, int offset)
+{
+    host_riscv64_s_type(block, OPCODE_SD, src_reg, base_reg, offset);
+}
+void
+host_riscv64_SH(codeblock_t *block, int src_reg, int base_reg, int offset)
+{
+    host_riscv64_s_type(block, OPCODE_SH, src_reg, base_reg, offset);
+}
+void
+host_riscv64_SW(codeblock_t *block, int src_reg, int base_reg, int offset)
+{
+    host_riscv64_s_type(block, OPCODE_SW, src_reg, base_reg, offset);
+}
+
+void
+host_riscv64_FLD(codeblock_t *block, int dst_reg, int base_reg, int offset)
+{
+    host_riscv64_i_type(block, OPCODE_FLD, dst_reg, base_reg, offset);
+}
+void
+host_riscv64_FLW(codeblock_t *block, int dst_reg, int base_reg, int offset)
+{
+    host_riscv64_i_type(block, OPCODE_FLW, dst_reg, base_reg, offset);
+}
+void
+host_riscv64_FSD(codeblock_t *block, int src_reg, int base_reg, int offset)
+{
+    host_riscv64_s_type(block, OPCODE_FSD, src_reg, base_reg, offset);
+}
+void
+host_riscv64_FSW(codeblock_t *block, int src_reg, int base_reg, int offset)
+{
+    host_riscv64_s_type(block, OPCODE_FSW, src_reg, base_reg, offset);
+}
+
+void
+host_riscv64_FABS_D(codeblock_t *block, int dst_reg, int src_reg)
+{
+    host_riscv64_r_type(block, OPCODE_FSGNJX_D, dst_reg, src_reg, src_reg);
+}
+void
+host_riscv64_FADD_D(codeblock_t *block, int dst_reg, int src_reg_a, int src_reg_b)
+{
+    host_riscv64_r_type(block, OPCODE_FADD_D | RM(RISCV64_RM_DYN), dst_reg, src_reg_a, src_reg_b);
+}
+void
+host_riscv64_FCVT_D_L(codeblock_t *block, int dst_reg, int src_reg)
+{
+    codegen_addlong(block, OPCODE_FCVT_D_L | RM(RISCV64_RM_DYN) | Rd(dst_reg) | Rs1(src_reg));
+}
+void
+host_riscv64_FCVT_D_S(codeblock_t *block, int dst_reg, int src_reg)
+{
+    codegen_addlong(block, OPCODE_FCVT_D_S | Rd(dst_reg) | Rs1(src_reg));
+}
+void
+host_riscv64_FCVT_D_W(codeblock_t *block, int dst_reg, int src_reg)
+{
+    codegen_addlong(block, OPCODE_FCVT_D_W | Rd(dst_reg) | Rs1(src_reg));
+}
+void
+host_riscv64_FCVT_L_D(codeblock_t *block, int dst_reg, int src_reg, int rm)
+{
+    codegen_addlong(block, OPCODE_FCVT_L_D | RM(rm) | Rd(dst_reg) | Rs1(src_reg));
+}
+void
+host_riscv64_FCVT_S_D(codeblock_t *block, int dst_reg, int src_reg)
+{
+    codegen_addlong(block, OPCODE_FCVT_S_D | RM(RISCV64_RM_DYN) | Rd(dst_reg) | Rs1(src_reg));
+}
+void
+host_riscv64_FCVT_W_D(codeblock_t *block, int dst_reg, int src_reg, int rm)
+{
+    codegen_addlong(block, OPCODE_FCVT_W_D | RM(rm) | Rd(dst_reg) | Rs1(src_reg));
+}
+void
+host_riscv64_FDIV_D(codeblock_t *block, int dst_reg, int src_reg_a, int src_reg_b)
+{
+    host_riscv64_r_type(block, OPCODE_FDIV_D | RM(RISCV64_RM_DYN), dst_reg, src_reg_a, src_reg_b);
+}
+void
+host_riscv64_FEQ_D(codeblock_t *block, int dst_reg, int src_reg_a, int src_reg_b)
+{
+    host_riscv64_r_type(block, OPCODE_FEQ_D, dst_reg, src_reg_a, src_reg_b);
+}
+void
+host_riscv64_FLT_D(codeblock_t *block, int dst_reg, int src_reg_a, int src_reg_b)
+{
+    host_riscv64_r_type(block, OPCODE_FLT_D, dst_reg, src_reg_a, src_reg_b);
+}
+void
+host_riscv64_FMUL_D(codeblock_t *block, int dst_reg, int src_reg_a, int src_reg_b)
+{
+    host_riscv64_r_type(block, OPCODE_FMUL_D | RM(RISCV64_RM_DYN), dst_reg, src_reg_a, src_reg_b);
+}
+void
+host_riscv64_FMV_D(codeblock_t *block, int dst_reg, int src_reg)
+{
+    if (dst_reg != src_reg)
+        host_riscv64_r_type(block, OPCODE_FSGNJ_D, dst_reg, src_reg, src_reg);
+}
+void
+host_riscv64_FMV_D_X(codeblock_t *block, int dst_reg, int src_reg)
+{
+    codegen_addlong(block, OPCODE_FMV_D_X | Rd(dst_reg) | Rs1(src_reg));
+}
+void
+host_riscv64_FMV_W_X(codeblock_t *block, int dst_reg, int src_reg)
+{
+    codegen_addlong(block, OPCODE_FMV_W_X | Rd(dst_reg) | Rs1(src_reg));
+}
+void
+host_riscv64_FMV_X_D(codeblock_t *block, int dst_reg, int src_reg)
+{
+    codegen_addlong(block, OPCODE_FMV_X_D | Rd(dst_reg) | Rs1(src_reg));
+}
+void
+host_riscv64_FMV_X_W(codeblock_t *block, int dst_reg, int src_reg)
+{
+    codegen_addlong(block, OPCODE_FMV_X_W | Rd(dst_reg) | Rs1(src_reg));
+}
+void
+host_riscv64_FNEG_D(codeblock_t *block, int dst_reg, int src_reg)
+{
+    host_riscv64_r_type(block, OPCODE_FSGNJN_D, dst_reg, src_reg, src_reg);
+}
+void
+host_riscv64_FSQRT_D(codeblock_t *block, int dst_reg, int src_reg)
+{
+    codegen_addlong(block, OPCODE_FSQRT_D | RM(RISCV64_RM_DYN) | Rd(dst_reg) | Rs1(src_reg));
+}
+void
+host_riscv64_FSUB_D(codeblock_t *block, int dst_reg, int src_reg_a, int src_reg_b)
+{
+    host_riscv64_r_type(block, OPCODE_FSUB_D | RM(RISCV64_RM_DYN), dst_reg, src_reg_a, src_reg_b);
+}
+
+void
+host_riscv64_FRRM(codeblock_t *block, int dst_reg)
+{
+    codegen_addlong(block, OPCODE_CSRRS | Rd(dst_reg) | Rs1(REG_ZERO) | IMM_I(CSR_FRM));
+}
+void
+host_riscv64_FSRM(codeblock_t *block, int dst_reg, int src_reg)
+{
+    codegen_addlong(block, OPCODE_CSRRW | Rd(dst_reg) | Rs1(src_reg) | IMM_I(CSR_FRM));
+}
+
+void
+host_riscv64_JALR(codeblock_t *block, int dst_reg, int src_reg, int offset)
+{
+    host_riscv64_i_type(block, OPCODE_JALR, dst_reg, src_reg, offset);
+}
+void
+host_riscv64_RET(codeblock_t *block)
+{
+    host_riscv64_JALR(block, REG_ZERO, REG_RA, 0);
+}
+
+/*Conditional branches are emitted as the inverted condition skipping over a
+  far jump, as the target is usually outside the range of a B-type offset.
+  The returned pointer is to the jump, for host_riscv64_branch_set_offset()*/
+static uint32_t *
+host_riscv64_branch_(codeblock_t *block, uint32_t inv_opcode, int src_reg_a, int src_reg_b)
+{
+    codegen_alloc(block, 12);
+    codegen_addlong(block, inv_opcode | Rs1(src_reg_a) | Rs2(src_reg_b) | IMM_B(12));
+    codegen_addlong(block, OPCODE_AUIPC | Rd(REG_SCRATCH));
+    codegen_addlong(block, OPCODE_JALR | Rd(REG_ZERO) | Rs1(REG_SCRATCH));
+    return (uint32_t *) &block_write_data[block_pos - 8];
+}
+
+uint32_t *
+host_riscv64_BEQ_(codeblock_t *block, int src_reg_a, int src_reg_b)
+{
+    return host_riscv64_branch_(block, OPCODE_BNE, src_reg_a, src_reg_b);
+}
+uint32_t *
+host_riscv64_BGE_(codeblock_t *block, int src_reg_a, int src_reg_b)
+{
+    return host_riscv64_branch_(block, OPCODE_BLT, src_reg_a, src_reg_b);
+}
+uint32_t *
+host_riscv64_BGEU_(codeblock_t *block, int src_reg_a, int src_reg_b)
+{
+    return host_riscv64_branch_(block, OPCODE_BLTU, src_reg_a, src_reg_b);
+}
+uint32_t *
+host_riscv64_BLT_(codeblock_t *block, int src_reg_a, int src_reg_b)
+{
+    return host_riscv64_branch_(block, OPCODE_BGE, src_reg_a, src_reg_b);
+}
+uint32_t *
+host_riscv64_BLTU_(codeblock_t *block, int src_reg_a, int src_reg_b)
+{
+    return host_riscv64_branch_(block, OPCODE_BGEU, src_reg_a, src_reg_b);
+}
+uint32_t *
+host_riscv64_BNE_(codeblock_t *block, int src_reg_a, int src_reg_b)
+{
+    return host_riscv64_branch_(block, OPCODE_BEQ, src_reg_a, src_reg_b);
+}
+
+void
+host_riscv64_branch_set_offset(uint32_t *opcode, void *dest)
+{
+    int64_t offset = (intptr_t) dest - (intptr_t) opcode;
+
+    if (!offset_is_32bit(offset))
+        fatal("host_riscv64_branch_set_offset - offset out of range %" PRIx64 "\n", (uint64_t) offset);
+    opcode[0] = OPCODE_AUIPC | Rd(REG_SCRATCH) | IMM_U((offset + 0x800) >> 12);
+    opcode[1] = OPCODE_JALR | Rd(REG_ZERO) | Rs1(REG_SCRATCH) | IMM_I(offset);
+}
+
+void
+host_riscv64_BNEZ(codeblock_t *block, int reg, uintptr_t dest)
+{
+    uint32_t *opcode = host_riscv64_BNE_(block, reg, REG_ZERO);
+    host_riscv64_branch_set_offset(opcode, (void *) dest);
+}
+
+void
+host_riscv64_ADD_IMM(codeblock_t *block, int dst_reg, int src_reg, int64_t imm_data)
+{
+    if (imm_is_imm12(imm_data))
+        host_riscv64_ADDI(block, dst_reg, src_reg, imm_data);
+    else {
+        codegen_alloc(block, MOV_IMM64_MAX_SIZE + 4);
+        host_riscv64_mov_imm64(block, REG_SCRATCH, imm_data);
+        host_riscv64_ADD(block, dst_reg, src_reg, REG_SCRATCH);
+    }
+}
+void
+host_riscv64_ADDW_IMM(codeblock_t *block, int dst_reg, int src_reg, uint32_t imm_data)
+{
+    if (imm_is_imm12((int32_t) imm_data))
+        host_riscv64_ADDIW(block, dst_reg, src_reg, (int32_t) imm_data);
+    else {
+        codegen_alloc(block, 12);
+        host_riscv64_mov_imm(block, REG_SCRATCH, imm_data);
+        host_riscv64_ADDW(block, dst_reg, src_reg, REG_SCRATCH);
+    }
+}
+
+/*The logical immediates are sign extended from 32 bits, so that sign extended
+  32-bit operands give sign extended results*/
+void
+host_riscv64_AND_IMM(codeblock_t *block, int dst_reg, int src_reg, uint32_t imm_data)
+{
+    if (imm_is_imm12((int32_t) imm_data))
+        host_riscv64_ANDI(block, dst_reg, src_reg, (int32_t) imm_data);
+    else if (imm_data == 0xffff)
+        host_riscv64_UBFX(block, dst_reg, src_reg, 0, 16);
+    else {
+        codegen_alloc(block, 12);
+        host_riscv64_mov_imm(block, REG_SCRATCH, imm_data);
+        host_riscv64_AND(block, dst_reg, src_reg, REG_SCRATCH);
+    }
+}
+void
+host_riscv64_OR_IMM(codeblock_t *block, int dst_reg, int src_reg, uint32_t imm_data)
+{
+    if (imm_is_imm12((int32_t) imm_data))
+        host_riscv64_ORI(block, dst_reg, src_reg, (int32_t) imm_data);
+    else {
+        codegen_alloc(block, 12);
+        host_riscv64_mov_imm(block, REG_SCRATCH, imm_data);
+        host_riscv64_OR(block, dst_reg, src_reg, REG_SCRATCH);
+    }
+}
+void
+host_riscv64_XOR_IMM(codeblock_t *block, int dst_reg, int src_reg, uint32_t imm_data)
+{
+    if (imm_is_imm12((int32_t) imm_data))
+        host_riscv64_XORI(block, dst_reg, src_reg, (int32_t) imm_data);
+    else {
+        codegen_alloc(block, 12);
+        host_riscv64_mov_imm(block, REG_SCRATCH, imm_data);
+        host_riscv64_XOR(block, dst_reg, src_reg, REG_SCRATCH);
+    }
+}
+
+/*Inserts the low width bits of src_reg into dst_reg at lsb. Only used on
+  fields within the low 31 bits, so a sign extended dst_reg stays so*/
+void
+host_riscv64_BFI(codeblock_t *block, int dst_reg, int src_reg, int lsb, int width)
+{
+    uint64_t mask = ~(((1ULL << width) - 1) << lsb);
+
+    codegen_alloc(block, 6 * 4);
+    host_riscv64_SLLI(block, REG_SCRATCH2, src_reg, 64 - width);
+    host_riscv64_SRLI(block, REG_SCRATCH2, REG_SCRATCH2, 64 - width - lsb);
+    if (imm_is_imm12((int64_t) mask))
+        host_riscv64_ANDI(block, dst_reg, dst_reg, (int64_t) mask);
+    else {
+        host_riscv64_mov_imm64(block, REG_SCRATCH, mask);
+        host_riscv64_AND(block, dst_reg, dst_reg, REG_SCRATCH);
+    }
+    host_riscv64_OR(block, dst_reg, dst_reg, REG_SCRATCH2);
+}
+void
+host_riscv64_SBFX(codeblock_t *block, int dst_reg, int src_reg, int lsb, int width)
+{
+    host_riscv64_SLLI(block, dst_reg, src_reg, 64 - width - lsb);
+    host_riscv64_SRAI(block, dst_reg, dst_reg, 64 - width);
+}
+void
+host_riscv64_UBFX(codeblock_t *block, int dst_reg, int src_reg, int lsb, int width)
+{
+    if (!lsb && width <= 11)
+        host_riscv64_ANDI(block, dst_reg, src_reg, (1 << width) - 1);
+    else {
+        host_riscv64_SLLI(block, dst_reg, src_reg, 64 - width - lsb);
+        host_riscv64_SRLI(block, dst_reg, dst_reg, 64 - width);
+    }
+}
+
+void
+host_riscv64_MV(codeblock_t *block, int dst_reg, int src_reg)
+{
+    if (dst_reg != src_reg)
+        host_riscv64_ADDI(block, dst_reg, src_reg, 0);
+}
+void
+host_riscv64_SEXT_W(codeblock_t *block, int dst_reg, int src_reg)
+{
+    host_riscv64_ADDIW(block, dst_reg, src_reg, 0);
+}
+void
+host_riscv64_ZEXT_W(codeblock_t *block, int dst_reg, int src_reg)
+{
+    host_riscv64_SLLI(block, dst_reg, src_reg, 32);
+    host_riscv64_SRLI(block, dst_reg, dst_reg, 32);
+}
+
+void
+host_riscv64_call(codeblock_t *block, void *dst_addr)
+{
+    int64_t offset;
+
+    codegen_alloc(block, MOV_IMM64_MAX_SIZE + 4);
+    offset = (intptr_t) dst_addr - (intptr_t) &block_write_data[block_pos];
+    if (offset_is_32bit(offset)) {
+        host_riscv64_AUIPC(block, REG_RA, (offset + 0x800) >> 12);
+        host_riscv64_JALR(block, REG_RA, REG_RA, ((int32_t) (offset << 20)) >> 20);
+    } else {
+        host_riscv64_mov_imm64(block, REG_SCRATCH, (uintptr_t) dst_addr);
+        host_riscv64_JALR(block, REG_RA, REG_SCRATCH, 0);
+    }
+}
+
+void
+host_riscv64_jump(codeblock_t *block, uintptr_t dst_addr)
+{
+    int64_t offset;
+
+    codegen_alloc(block, MOV_IMM64_MAX_SIZE + 4);
+    offset = (intptr_t) dst_addr - (intptr_t) &block_write_data[block_pos];
+    if (offset_is_32bit(offset)) {
+        host_riscv64_AUIPC(block, REG_SCRATCH, (offset + 0x800) >> 12);
+        host_riscv64_JALR(block, REG_ZERO, REG_SCRATCH, ((int32_t) (offset << 20)) >> 20);
+    } else {
+        host_riscv64_mov_imm64(block, REG_SCRATCH, dst_addr);
+        host_riscv64_JALR(block, REG_ZERO, REG_SCRATCH, 0);
+    }
+}
+
+/*Loads imm_data sign extended to 64 bits, as 32-bit values are kept in host
+  registers*/
+void
+host_riscv64_mov_imm(codeblock_t *block, int reg, uint32_t imm_data)
+{
+    int32_t lo = ((int32_t) (imm_data << 20)) >> 20;
+    int32_t hi = (imm_data - lo) >> 12;
+
+    if (!hi)
+        host_riscv64_ADDI(block, reg, REG_ZERO, lo);
+    else {
+        host_riscv64_LUI(block, reg, hi);
+        if (lo)
+            host_riscv64_ADDIW(block, reg, reg, lo);
+    }
+}
+
+void
+host_riscv64_mov_imm64(codeblock_t *block, int reg, uint64_t imm_data)
+{
+    int64_t lo;
+    int64_t hi;
+    int     shift = 12;
+
+    if ((int64_t) imm_data == (int32_t) imm_data) {
+        host_riscv64_mov_imm(block, reg, (uint32_t) imm_data);
+        return;
+    }
+
+    /*Load the upper bits with the trailing zeroes stripped, then shift them
+      into place and add the low 12 bits*/
+    lo = ((int64_t) (imm_data << 52)) >> 52;
+    hi = (int64_t) (imm_data - lo) >> 12;
+    while (!(hi & 1)) {
+        hi >>= 1;
+        shift++;
+    }
+    host_riscv64_mov_imm64(block, reg, hi);
+    host_riscv64_SLLI(block, reg, reg, shift);
+    if (lo)
+        host_riscv64_ADDI(block, reg, reg, lo);
+}
+
+#endif
@@ -0,0 +1,118 @@
+#define RISCV64_RM_RNE 0
+#define RISCV64_RM_RTZ 1
+#define RISCV64_RM_RDN 2
+#define RISCV64_RM_RUP 3
+#define RISCV64_RM_DYN 7
+
+/*Signed 12 bit offset, as taken by loads, stores and ADDI*/
+#define in_range12(offset) (((offset) >= -2048) && ((offset) < 2048))
+
+void host_riscv64_ADD(codeblock_t *block, int dst_reg, int src_reg_a, int src_reg_b);
+void host_riscv64_ADDW(codeblock_t *block, int dst_reg, int src_reg_a, int src_reg_b);
+void host_riscv64_ADDI(codeblock_t *block, int dst_reg, int src_reg, int imm_data);
+void host_riscv64_ADDIW(codeblock_t *block, int dst_reg, int src_reg, int imm_data);
+void host_riscv64_AND(codeblock_t *block, int dst_reg, int src_reg_a, int src_reg_b);
+void host_riscv64_ANDI(codeblock_t *block, int dst_reg, int src_reg, int imm_data);
+void host_riscv64_AUIPC(codeblock_t *block, int dst_reg, uint32_t imm_data);
+void host_riscv64_LUI(codeblock_t *block, int dst_reg, uint32_t imm_data);
+void host_riscv64_MUL(codeblock_t *block, int dst_reg, int src_reg_a, int src_reg_b);
+void host_riscv64_MULW(codeblock_t *block, int dst_reg, int src_reg_a, int src_reg_b);
+void host_riscv64_OR(codeblock_t *block, int dst_reg, int src_reg_a, int src_reg_b);
+void host_riscv64_ORI(codeblock_t *block, int dst_reg, int src_reg, int imm_data);
+void host_riscv64_SLL(codeblock_t *block, int dst_reg, int src_reg, int shift_reg);
+void host_riscv64_SLLI(codeblock_t *block, int dst_reg, int src_reg, int shift);
+void host_riscv64_SLLIW(codeblock_t *block, int dst_reg, int src_reg, int shift);
+void host_riscv64_SLLW(codeblock_t *block, int dst_reg, int src_reg, int shift_reg);
+void host_riscv64_SLT(codeblock_t *block, int dst_reg, int src_reg_a, int src_reg_b);
+void host_riscv64_SLTU(codeblock_t *block, int dst_reg, int src_reg_a, int src_reg_b);
+void host_riscv64_SRA(codeblock_t *block, int dst_reg, int src_reg, int shift_reg);
+void host_riscv64_SRAI(codeblock_t *block, int dst_reg, int src_reg, int shift);
+void host_riscv64_SRAIW(codeblock_t *block, int dst_reg, int src_reg, int shift);
+void host_riscv64_SRAW(codeblock_t *block, int dst_reg, int src_reg, int shift_reg);
+void host_riscv64_SRL(codeblock_t *block, int dst_reg, int src_reg, int shift_reg);
+void host_riscv64_SRLI(codeblock_t *block, int dst_reg, int src_reg, int shift);
+void host_riscv64_SRLIW(codeblock_t *block, int dst_reg, int src_reg, int shift);
+void host_riscv64_SRLW(codeblock_t *block, int dst_reg, int src_reg, int shift_reg);
+void host_riscv64_SUB(codeblock_t *block, int dst_reg, int src_reg_a, int src_reg_b);
+void host_riscv64_SUBW(codeblock_t *block, int dst_reg, int src_reg_a, int src_reg_b);
+void host_riscv64_XOR(codeblock_t *block, int dst_reg, int src_reg_a, int src_reg_b);
+void host_riscv64_XORI(codeblock_t *block, int dst_reg, int src_reg, int imm_data);
+
+void host_riscv64_LB(codeblock_t *block, int dst_reg, int base_reg, int offset);
+void host_riscv64_LBU(codeblock_t *block, int dst_reg, int base_reg, int offset);
+void host_riscv64_LD(codeblock_t *block, int dst_reg, int base_reg, int offset);
+void host_riscv64_LH(codeblock_t *block, int dst_reg, int base_reg, int offset);
+void host_riscv64_LHU(codeblock_t *block, int dst_reg, int base_reg, int offset);
+void host_riscv64_LW(codeblock_t *block, int dst_reg, int base_reg, int offset);
+void host_riscv64_LWU(codeblock_t *block, int dst_reg, int base_reg, int offset);
+void host_riscv64_SB(codeblock_t *block, int src_reg, int base_reg, int offset);
+void host_riscv64_SD(codeblock_t *block, int src_reg, int base_reg, int offset);
+void host_riscv64_SH(codeblock_t *block, int src_reg, int base_reg, int offset);
+void host_riscv64_SW(codeblock_t *block, int src_reg, int base_reg, int offset);
+
+void host_riscv64_FLD(codeblock_t *block, int dst_reg, int base_reg, int offset);
+void host_riscv64_FLW(codeblock_t *block, int dst_reg, int base_reg, int offset);
+void host_riscv64_FSD(codeblock_t *block, int src_reg, int base_reg, int offset);
+void host_riscv64_FSW(codeblock_t *block, int src_reg, int base_reg, int offset);
+
+void host_riscv64_FABS_D(codeblock_t *block, int dst_reg, int src_reg);
+void host_riscv64_FADD_D(codeblock_t *block, int dst_reg, int src_reg_a, int src_reg_b);
+void host_riscv64_FCVT_D_L(codeblock_t *block, int dst_reg, int src_reg);
+void host_riscv64_FCVT_D_S(codeblock_t *block, int dst_reg, int src_reg);
+void host_riscv64_FCVT_D_W(codeblock_t *block, int dst_reg, int src_reg);
+void host_riscv64_FCVT_L_D(codeblock_t *block, int dst_reg, int src_reg, int rm);
+void host_riscv64_FCVT_S_D(codeblock_t *block, int dst_reg, int src_reg);
+void host_riscv64_FCVT_W_D(codeblock_t *block, int dst_reg, int src_reg, int rm);
+void host_riscv64_FDIV_D(codeblock_t *block, int dst_reg, int src_reg_a, int src_reg_b);
+void host_riscv64_FEQ_D(codeblock_t *block, int dst_reg, int src_reg_a, int src_reg_b);
+void host_riscv64_FLT_D(codeblock_t *block, int dst_reg, int src_reg_a, int src_reg_b);
+void host_riscv64_FMUL_D(codeblock_t *block, int dst_reg, int src_reg_a, int src_reg_b);
+void host_riscv64_FMV_D(codeblock_t *block, int dst_reg, int src_reg);
+void host_riscv64_FMV_D_X(codeblock_t *block, int dst_reg, int src_reg);
+void host_riscv64_FMV_W_X(codeblock_t *block, int dst_reg, int src_reg);
+void host_riscv64_FMV_X_D(codeblock_t *block, int dst_reg, int src_reg);
+void host_riscv64_FMV_X_W(codeblock_t *block, int dst_reg, int src_reg);
+void host_riscv64_FNEG_D(codeblock_t *block, int dst_reg, int src_reg);
+void host_riscv64_FSQRT_D(codeblock_t *block, int dst_reg, int src_reg);
+void host_riscv64_FSUB_D(codeblock_t *block, int dst_reg, int src_reg_a, int src_reg_b);
+
+void host_riscv64_FRRM(codeblock_t *block, int dst_reg);
+void host_riscv64_FSRM(codeblock_t *block, int dst_reg, int src_reg);
+
+void host_riscv64_JALR(codeblock_t *block, int dst_reg, int src_reg, int offset);
+void host_riscv64_RET(codeblock_t *block);
+
+uint32_t *host_riscv64_BEQ_(codeblock_t *block, int src_reg_a, int src_reg_b);
+uint32_t *host_riscv64_BGE_(codeblock_t *block, int src_reg_a, int src_reg_b);
+uint32_t *host_riscv64_BGEU_(codeblock_t *block, int src_reg_a, int src_reg_b);
+uint32_t *host_riscv64_BLT_(codeblock_t *block, int src_reg_a, int src_reg_b);
+uint32_t *host_riscv64_BLTU_(codeblock_t *block, int src_reg_a, int src_reg_b);
+uint32_t *host_riscv64_BNE_(codeblock_t *block, int src_reg_a, int src_reg_b);
+
+void host_riscv64_branch_set_offset(uint32_t *opcode, void *dest);
+
+void host_riscv64_BNEZ(codeblock_t *block, int reg, uintptr_t dest);
+
+/*Multi-instruction helpers*/
+void host_riscv64_ADD_IMM(codeblock_t *block, int dst_reg, int src_reg, int64_t imm_data);
+void host_riscv64_ADDW_IMM(codeblock_t *block, int dst_reg, int src_reg, uint32_t imm_data);
+void host_riscv64_AND_IMM(codeblock_t *block, int dst_reg, int src_reg, uint32_t imm_data);
+void host_riscv64_OR_IMM(codeblock_t *block, int dst_reg, int src_reg, uint32_t imm_data);
+void host_riscv64_XOR_IMM(codeblock_t *block, int dst_reg, int src_reg, uint32_t imm_data);
+
+void host_riscv64_BFI(codeblock_t *block, int dst_reg, int src_reg, int lsb, int width);
+void host_riscv64_SBFX(codeblock_t *block, int dst_reg, int src_reg, int lsb, int width);
+void host_riscv64_UBFX(codeblock_t *block, int dst_reg, int src_reg, int lsb, int width);
+
+void host_riscv64_MV(codeblock_t *block, int dst_reg, int src_reg);
+void host_riscv64_SEXT_W(codeblock_t *block, int dst_reg, int src_reg);
+void host_riscv64_ZEXT_W(codeblock_t *block, int dst_reg, int src_reg);
+
+void host_riscv64_call(codeblock_t *block, void *dst_addr);
+void host_riscv64_jump(codeblock_t *block, uintptr_t dst_addr);
+void host_riscv64_mov_imm(codeblock_t *block, int reg, uint32_t imm_data);
+void host_riscv64_mov_imm64(codeblock_t *block, int reg, uint64_t imm_data);
+
+void codegen_direct_read_8(codeblock_t *block, int host_reg, void *p);
+
+void codegen_alloc(codeblock_t *block, int size);
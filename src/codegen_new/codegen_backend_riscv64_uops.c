@@ -0,0 +1,3824 @@
+#if defined __riscv && (__riscv_xlen == 64)
+
+#    include <math.h>
+#    include <stdint.h>
+#    include <86box/86box.h>
+#    include "cpu.h"
+#    include <86box/mem.h>
+#    include <86box/plat_unused.h>
+
+#    include "x86.h"
+#    include "x86seg_common.h"
+#    include "x86seg.h"
+#    include "x87_sf.h"
+#    include "x87.h"
+#    include "386_common.h"
+#    include "codegen.h"
+#    include "codegen_backend.h"
+#    include "codegen_backend_riscv64_defs.h"
+#    include "codegen_backend_riscv64_ops.h"
+#    include "codegen_ir_defs.h"
+
+#    define HOST_REG_GET(reg) (IREG_GET_REG(reg) & 0x1f)
+
+#    define REG_IS_L(size)    (size == IREG_SIZE_L)
+#    define REG_IS_W(size)    (size == IREG_SIZE_W)
+#    define REG_IS_B(size)    (size == IREG_SIZE_B)
+#    define REG_IS_BH(size)   (size == IREG_SIZE_BH)
+#    define REG_IS_D(size)    (size == IREG_SIZE_D)
+#    define REG_IS_Q(size)    (size == IREG_SIZE_Q)
+
+#    define SSATB(val)        (((val) < -128) ? -128 : (((val) > 127) ? 127 : (val)))
+#    define SSATW(val)        (((val) < -32768) ? -32768 : (((val) > 32767) ? 32767 : (val)))
+#    define USATB(val)        (((val) < 0) ? 0 : (((val) > 255) ? 255 : (val)))
+#    define USATW(val)        (((val) < 0) ? 0 : (((val) > 65535) ? 65535 : (val)))
+
+/*32-bit values are kept sign extended to 64 bits in host registers, as the
+  RV64 W instructions produce them. 8 and 16-bit results are inserted into the
+  low bits of the register, which keeps it so*/
+
+/*The base ISA has no packed arithmetic, so most MMX and 3DNow! operations
+  are done by C helpers on the 64-bit register image. FP registers hold MMX
+  registers as their raw bit pattern*/
+static void
+codegen_mmx_call(codeblock_t *block, void *helper, int dest_reg, int src_reg_a, int src_reg_b)
+{
+    host_riscv64_FMV_X_D(block, REG_ARG0, src_reg_a);
+    host_riscv64_FMV_X_D(block, REG_ARG1, src_reg_b);
+    host_riscv64_call(block, helper);
+    host_riscv64_FMV_D_X(block, dest_reg, REG_ARG0);
+}
+static void
+codegen_mmx_call_imm(codeblock_t *block, void *helper, int dest_reg, int src_reg, uint32_t imm_data)
+{
+    host_riscv64_FMV_X_D(block, REG_ARG0, src_reg);
+    host_riscv64_mov_imm(block, REG_ARG1, imm_data);
+    host_riscv64_call(block, helper);
+    host_riscv64_FMV_D_X(block, dest_reg, REG_ARG0);
+}
+
+static int
+codegen_ADD(codeblock_t *block, uop_t *uop)
+{
+    int dest_reg   = HOST_REG_GET(uop->dest_reg_a_real);
+    int src_reg_a  = HOST_REG_GET(uop->src_reg_a_real);
+    int src_reg_b  = HOST_REG_GET(uop->src_reg_b_real);
+    int dest_size  = IREG_GET_SIZE(uop->dest_reg_a_real);
+    int src_size_a = IREG_GET_SIZE(uop->src_reg_a_real);
+    int src_size_b = IREG_GET_SIZE(uop->src_reg_b_real);
+
+    if (REG_IS_L(dest_size) && REG_IS_L(src_size_a) && REG_IS_L(src_size_b)) {
+        host_riscv64_ADDW(block, dest_reg, src_reg_a, src_reg_b);
+    } else if (REG_IS_W(dest_size) && REG_IS_W(src_size_a) && REG_IS_W(src_size_b)) {
+        host_riscv64_ADD(block, REG_TEMP, src_reg_a, src_reg_b);
+        host_riscv64_BFI(block, dest_reg, REG_TEMP, 0, 16);
+    } else if (REG_IS_B(dest_size) && REG_IS_B(src_size_a) && REG_IS_B(src_size_b)) {
+        host_riscv64_ADD(block, REG_TEMP, src_reg_a, src_reg_b);
+        host_riscv64_BFI(block, dest_reg, REG_TEMP, 0, 8);
+    } else if (REG_IS_B(dest_size) && REG_IS_B(src_size_a) && REG_IS_BH(src_size_b)) {
+        host_riscv64_SRLI(block, REG_TEMP, src_reg_b, 8);
+        host_riscv64_ADD(block, REG_TEMP, src_reg_a, REG_TEMP);
+        host_riscv64_BFI(block, dest_reg, REG_TEMP, 0, 8);
+    } else if (REG_IS_BH(dest_size) && REG_IS_BH(src_size_a) && REG_IS_B(src_size_b)) {
+        host_riscv64_SRLI(block, REG_TEMP, src_reg_a, 8);
+        host_riscv64_ADD(block, REG_TEMP, REG_TEMP, src_reg_b);
+        host_riscv64_BFI(block, dest_reg, REG_TEMP, 8, 8);
+    } else if (REG_IS_BH(dest_size) && REG_IS_BH(src_size_a) && REG_IS_BH(src_size_b)) {
+        host_riscv64_SRLI(block, REG_TEMP, src_reg_a, 8);
+        host_riscv64_SRLI(block, REG_TEMP2, src_reg_b, 8);
+        host_riscv64_ADD(block, REG_TEMP, REG_TEMP, REG_TEMP2);
+        host_riscv64_BFI(block, dest_reg, REG_TEMP, 8, 8);
+    } else
+        fatal("ADD %02x %02x %02x\n", uop->dest_reg_a_real, uop->src_reg_a_real, uop->src_reg_b_real);
+
+    return 0;
+}
+
+static int
+codegen_ADD_IMM(codeblock_t *block, uop_t *uop)
+{
+    int dest_reg  = HOST_REG_GET(uop->dest_reg_a_real);
+    int src_reg   = HOST_REG_GET(uop->src_reg_a_real);
+    int dest_size = IREG_GET_SIZE(uop->dest_reg_a_real);
+    int src_size  = IREG_GET_SIZE(uop->src_reg_a_real);
+
+    if (REG_IS_L(dest_size) && REG_IS_L(src_size)) {
+        host_riscv64_ADDW_IMM(block, dest_reg, src_reg, uop->imm_data);
+    } else if (REG_IS_W(dest_size) && REG_IS_W(src_size)) {
+        host_riscv64_ADDW_IMM(block, REG_TEMP, src_reg, uop->imm_data);
+        host_riscv64_BFI(block, dest_reg, REG_TEMP, 0, 16);
+    } else if (REG_IS_B(dest_size) && REG_IS_B(src_size)) {
+        host_riscv64_ADDW_IMM(block, REG_TEMP, src_reg, uop->imm_data);
+        host_riscv64_BFI(block, dest_reg, REG_TEMP, 0, 8);
+    } else if (REG_IS_BH(dest_size) && REG_IS_BH(src_size)) {
+        host_riscv64_SRLI(block, REG_TEMP, src_reg, 8);
+        host_riscv64_ADDW_IMM(block, REG_TEMP, REG_TEMP, uop->imm_data);
+        host_riscv64_BFI(block, dest_reg, REG_TEMP, 8, 8);
+    } else
+        fatal("ADD_IMM %x %x\n", uop->dest_reg_a_real, uop->src_reg_a_real);
+
+    return 0;
+}
+
+static int
+codegen_ADD_LSHIFT(codeblock_t *block, uop_t *uop)
+{
+    if (!uop->imm_data)
+        host_riscv64_ADDW(block, uop->dest_reg_a_real, uop->src_reg_a_real, uop->src_reg_b_real);
+    else {
+        host_riscv64_SLLI(block, REG_TEMP, uop->src_reg_b_real, uop->imm_data);
+        host_riscv64_ADDW(block, uop->dest_reg_a_real, uop->src_reg_a_real, REG_TEMP);
+    }
+    return 0;
+}
+
+static int
+codegen_AND(codeblock_t *block, uop_t *uop)
+{
+    int dest_reg   = HOST_REG_GET(uop->dest_reg_a_real);
+    int src_reg_a  = HOST_REG_GET(uop->src_reg_a_real);
+    int src_reg_b  = HOST_REG_GET(uop->src_reg_b_real);
+    int dest_size  = IREG_GET_SIZE(uop->dest_reg_a_real);
+    int src_size_a = IREG_GET_SIZE(uop->src_reg_a_real);
+    int src_size_b = IREG_GET_SIZE(uop->src_reg_b_real);
+
+    if (REG_IS_Q(dest_size) && REG_IS_Q(src_size_a) && REG_IS_Q(src_size_b)) {
+        host_riscv64_FMV_X_D(block, REG_TEMP, src_reg_a);
+        host_riscv64_FMV_X_D(block, REG_TEMP2, src_reg_b);
+        host_riscv64_AND(block, REG_TEMP, REG_TEMP, REG_TEMP2);
+        host_riscv64_FMV_D_X(block, dest_reg, REG_TEMP);
+    } else if (REG_IS_L(dest_size) && REG_IS_L(src_size_a) && REG_IS_L(src_size_b)) {
+        host_riscv64_AND(block, dest_reg, src_reg_a, src_reg_b);
+    } else if (REG_IS_B(dest_size) && REG_IS_B(src_size_a) && REG_IS_B(src_size_b) && dest_reg == src_reg_a) {
+        host_riscv64_ORI(block, REG_TEMP, src_reg_b, -0x100);
+        host_riscv64_AND(block, dest_reg, src_reg_a, REG_TEMP);
+    } else if (REG_IS_W(dest_size) && REG_IS_W(src_size_a) && REG_IS_W(src_size_b)) {
+        host_riscv64_AND(block, REG_TEMP, src_reg_a, src_reg_b);
+        host_riscv64_BFI(block, dest_reg, REG_TEMP, 0, 16);
+    } else if (REG_IS_B(dest_size) && REG_IS_B(src_size_a) && REG_IS_B(src_size_b)) {
+        host_riscv64_AND(block, REG_TEMP, src_reg_a, src_reg_b);
+        host_riscv64_BFI(block, dest_reg, REG_TEMP, 0, 8);
+    } else if (REG_IS_B(dest_size) && REG_IS_B(src_size_a) && REG_IS_BH(src_size_b)) {
+        host_riscv64_SRLI(block, REG_TEMP, src_reg_b, 8);
+        host_riscv64_AND(block, REG_TEMP, src_reg_a, REG_TEMP);
+        host_riscv64_BFI(block, dest_reg, REG_TEMP, 0, 8);
+    } else if (REG_IS_B(dest_size) && REG_IS_BH(src_size_a) && REG_IS_B(src_size_b)) {
+        host_riscv64_SRLI(block, REG_TEMP, src_reg_a, 8);
+        host_riscv64_AND(block, REG_TEMP, REG_TEMP, src_reg_b);
+        host_riscv64_BFI(block, dest_reg, REG_TEMP, 0, 8);
+    } else if (REG_IS_B(dest_size) && REG_IS_BH(src_size_a) && REG_IS_BH(src_size_b)) {
+        host_riscv64_AND(block, REG_TEMP, src_reg_a, src_reg_b);
+        host_riscv64_SRLI(block, REG_TEMP, REG_TEMP, 8);
+        host_riscv64_BFI(block, dest_reg, REG_TEMP, 0, 8);
+    } else if (REG_IS_BH(dest_size) && REG_IS_BH(src_size_a) && REG_IS_B(src_size_b)) {
+        host_riscv64_SLLI(block, REG_TEMP, src_reg_b, 8);
+        host_riscv64_AND(block, REG_TEMP, src_reg_a, REG_TEMP);
+        host_riscv64_SRLI(block, REG_TEMP, REG_TEMP, 8);
+        host_riscv64_BFI(block, dest_reg, REG_TEMP, 8, 8);
+    } else if (REG_IS_BH(dest_size) && REG_IS_BH(src_size_a) && REG_IS_BH(src_size_b)) {
+        host_riscv64_AND(block, REG_TEMP, src_reg_a, src_reg_b);
+        host_riscv64_SRLI(block, REG_TEMP, REG_TEMP, 8);
+        host_riscv64_BFI(block, dest_reg, REG_TEMP, 8, 8);
+    } else
+        fatal("AND %02x %02x %02x\n", uop->dest_reg_a_real, uop->src_reg_a_real, uop->src_reg_b_real);
+
+    return 0;
+}
+static int
+codegen_AND_IMM(codeblock_t *block, uop_t *uop)
+{
+    int dest_reg  = HOST_REG_GET(uop->dest_reg_a_real);
+    int src_reg   = HOST_REG_GET(uop->src_reg_a_real);
+    int dest_size = IREG_GET_SIZE(uop->dest_reg_a_real);
+    int src_size  = IREG_GET_SIZE(uop->src_reg_a_real);
+
+    if (REG_IS_L(dest_size) && REG_IS_L(src_size)) {
+        host_riscv64_AND_IMM(block, dest_reg, src_reg, uop->imm_data);
+    } else if (REG_IS_W(dest_size) && REG_IS_W(src_size)) {
+        host_riscv64_AND_IMM(block, dest_reg, src_reg, uop->imm_data | 0xffff0000);
+    } else if (REG_IS_B(dest_size) && REG_IS_B(src_size)) {
+        host_riscv64_AND_IMM(block, dest_reg, src_reg, uop->imm_data | 0xffffff00);
+    } else if (REG_IS_B(dest_size) && REG_IS_BH(src_size)) {
+        host_riscv64_SRLI(block, REG_TEMP, src_reg, 8);
+        host_riscv64_AND_IMM(block, REG_TEMP, REG_TEMP, uop->imm_data);
+        host_riscv64_BFI(block, dest_reg, REG_TEMP, 0, 8);
+    } else if (REG_IS_BH(dest_size) && REG_IS_BH(src_size)) {
+        host_riscv64_AND_IMM(block, dest_reg, src_reg, (uop->imm_data << 8) | 0xffff00ff);
+    } else
+        fatal("AND_IMM %x %x\n", uop->dest_reg_a_real, uop->src_reg_a_real);
+
+    return 0;
+}
+
+static int
+codegen_ANDN(codeblock_t *block, uop_t *uop)
+{
+    int dest_reg   = HOST_REG_GET(uop->dest_reg_a_real);
+    int src_reg_a  = HOST_REG_GET(uop->src_reg_a_real);
+    int src_reg_b  = HOST_REG_GET(uop->src_reg_b_real);
+    int dest_size  = IREG_GET_SIZE(uop->dest_reg_a_real);
+    int src_size_a = IREG_GET_SIZE(uop->src_reg_a_real);
+    int src_size_b = IREG_GET_SIZE(uop->src_reg_b_real);
+
+    if (REG_IS_Q(dest_size) && REG_IS_Q(src_size_a) && REG_IS_Q(src_size_b)) {
+        host_riscv64_FMV_X_D(block, REG_TEMP, src_reg_a);
+        host_riscv64_FMV_X_D(block, REG_TEMP2, src_reg_b);
+        host_riscv64_XORI(block, REG_TEMP, REG_TEMP, -1);
+        host_riscv64_AND(block, REG_TEMP, REG_TEMP, REG_TEMP2);
+        host_riscv64_FMV_D_X(block, dest_reg, REG_TEMP);
+    } else
+        fatal("ANDN %02x %02x %02x\n", uop->dest_reg_a_real, uop->src_reg_a_real, uop->src_reg_b_real);
+
+    return 0;
+}
+
+static int
+codegen_CALL_FUNC(codeblock_t *block, uop_t *uop)
+{
+    host_riscv64_call(block, uop->p);
+
+    return 0;
+}
+
+static int
+codegen_CALL_FUNC_RESULT(codeblock_t *block, uop_t *uop)
+{
+    int dest_reg  = HOST_REG_GET(uop->dest_reg_a_real);
+    int dest_size = IREG_GET_SIZE(uop->dest_reg_a_real);
+
+    if (!REG_IS_L(dest_size))
+        fatal("CALL_FUNC_RESULT %02x\n", uop->dest_reg_a_real);
+    host_riscv64_call(block, uop->p);
+    host_riscv64_MV(block, dest_reg, REG_A0);
+
+    return 0;
+}
+
+static int
+codegen_CALL_INSTRUCTION_FUNC(codeblock_t *block, uop_t *uop)
+{
+    host_riscv64_call(block, uop->p);
+    host_riscv64_BNEZ(block, REG_A0, (uintptr_t) codegen_exit_rout);
+
+    return 0;
+}
+
+/*Loads the immediate to compare against, or returns x0 if it is zero*/
+static int
+codegen_cmp_imm(codeblock_t *block, int reg, uint32_t imm_data)
+{
+    if (!imm_data)
+        return REG_ZERO;
+    host_riscv64_mov_imm(block, reg, imm_data);
+    return reg;
+}
+
+static int
+codegen_CMP_IMM_JZ(codeblock_t *block, uop_t *uop)
+{
+    int       src_reg  = HOST_REG_GET(uop->src_reg_a_real);
+    int       src_size = IREG_GET_SIZE(uop->src_reg_a_real);
+    int       imm_reg  = REG_ZERO;
+    uint32_t *jump_p;
+
+    if (REG_IS_L(src_size)) {
+        imm_reg = codegen_cmp_imm(block, REG_TEMP2, uop->imm_data);
+    } else
+        fatal("CMP_IMM_JZ %02x\n", uop->src_reg_a_real);
+    jump_p = host_riscv64_BEQ_(block, src_reg, imm_reg);
+    host_riscv64_branch_set_offset(jump_p, uop->p);
+
+    return 0;
+}
+
+static int
+codegen_CMP_IMM_JNZ_DEST(codeblock_t *block, uop_t *uop)
+{
+    int src_reg  = HOST_REG_GET(uop->src_reg_a_real);
+    int src_size = IREG_GET_SIZE(uop->src_reg_a_real);
+    int imm_reg  = REG_ZERO;
+
+    if (REG_IS_L(src_size)) {
+        imm_reg = codegen_cmp_imm(block, REG_TEMP2, uop->imm_data);
+    } else if (REG_IS_W(src_size)) {
+        host_riscv64_UBFX(block, REG_TEMP, src_reg, 0, 16);
+        imm_reg = codegen_cmp_imm(block, REG_TEMP2, uop->imm_data & 0xffff);
+        src_reg = REG_TEMP;
+    } else
+        fatal("CMP_IMM_JNZ_DEST %02x\n", uop->src_reg_a_real);
+
+    uop->p = host_riscv64_BNE_(block, src_reg, imm_reg);
+
+    return 0;
+}
+static int
+codegen_CMP_IMM_JZ_DEST(codeblock_t *block, uop_t *uop)
+{
+    int src_reg  = HOST_REG_GET(uop->src_reg_a_real);
+    int src_size = IREG_GET_SIZE(uop->src_reg_a_real);
+    int imm_reg  = REG_ZERO;
+
+    if (REG_IS_L(src_size)) {
+        imm_reg = codegen_cmp_imm(block, REG_TEMP2, uop->imm_data);
+    } else if (REG_IS_W(src_size)) {
+        host_riscv64_UBFX(block, REG_TEMP, src_reg, 0, 16);
+        imm_reg = codegen_cmp_imm(block, REG_TEMP2, uop->imm_data & 0xffff);
+        src_reg = REG_TEMP;
+    } else
+        fatal("CMP_IMM_JZ_DEST %02x\n", uop->src_reg_a_real);
+
+    uop->p = host_riscv64_BEQ_(block, src_reg, imm_reg);
+
+    return 0;
+}
+
+static int
+codegen_CMP_JB(codeblock_t *block, uop_t *uop)
+{
+    int       src_reg_a  = HOST_REG_GET(uop->src_reg_a_real);
+    int       src_reg_b  = HOST_REG_GET(uop->src_reg_b_real);
+    int       src_size_a = IREG_GET_SIZE(uop->src_reg_a_real);
+    int       src_size_b = IREG_GET_SIZE(uop->src_reg_b_real);
+    uint32_t *jump_p;
+
+    if (!REG_IS_L(src_size_a) || !REG_IS_L(src_size_b))
+        fatal("CMP_JB %02x\n", uop->src_reg_a_real);
+
+    jump_p = host_riscv64_BLTU_(block, src_reg_a, src_reg_b);
+    host_riscv64_branch_set_offset(jump_p, uop->p);
+
+    return 0;
+}
+static int
+codegen_CMP_JNBE(codeblock_t *block, uop_t *uop)
+{
+    int       src_reg_a  = HOST_REG_GET(uop->src_reg_a_real);
+    int       src_reg_b  = HOST_REG_GET(uop->src_reg_b_real);
+    int       src_size_a = IREG_GET_SIZE(uop->src_reg_a_real);
+    int       src_size_b = IREG_GET_SIZE(uop->src_reg_b_real);
+    uint32_t *jump_p;
+
+    if (!REG_IS_L(src_size_a) || !REG_IS_L(src_size_b))
+        fatal("CMP_JNBE %02x\n", uop->src_reg_a_real);
+
+    jump_p = host_riscv64_BLTU_(block, src_reg_b, src_reg_a);
+    host_riscv64_branch_set_offset(jump_p, uop->p);
+
+    return 0;
+}
+
+/*Sets up the operands of a CMP_*_DEST. 16 and 8-bit operands are extracted
+  into REG_TEMP and REG_TEMP2, sign extended for signed conditions, so the
+  64-bit branches compare them correctly. Returns 0 if the sizes are not
+  supported*/
+static int
+codegen_cmp_operands(codeblock_t *block, uop_t *uop, int is_signed, int *reg_a, int *reg_b)
+{
+    int src_reg_a  = HOST_REG_GET(uop->src_reg_a_real);
+    int src_reg_b  = HOST_REG_GET(uop->src_reg_b_real);
+    int src_size_a = IREG_GET_SIZE(uop->src_reg_a_real);
+    int src_size_b = IREG_GET_SIZE(uop->src_reg_b_real);
+    int width;
+
+    if (REG_IS_L(src_size_a) && REG_IS_L(src_size_b)) {
+        *reg_a = src_reg_a;
+        *reg_b = src_reg_b;
+        return 1;
+    } else if (REG_IS_W(src_size_a) && REG_IS_W(src_size_b))
+        width = 16;
+    else if (REG_IS_B(src_size_a) && REG_IS_B(src_size_b))
+        width = 8;
+    else
+        return 0;
+
+    if (is_signed) {
+        host_riscv64_SBFX(block, REG_TEMP, src_reg_a, 0, width);
+        host_riscv64_SBFX(block, REG_TEMP2, src_reg_b, 0, width);
+    } else {
+        host_riscv64_UBFX(block, REG_TEMP, src_reg_a, 0, width);
+        host_riscv64_UBFX(block, REG_TEMP2, src_reg_b, 0, width);
+    }
+    *reg_a = REG_TEMP;
+    *reg_b = REG_TEMP2;
+    return 1;
+}
+
+static int
+codegen_CMP_JNB_DEST(codeblock_t *block, uop_t *uop)
+{
+    int reg_a;
+    int reg_b;
+
+    if (!codegen_cmp_operands(block, uop, 0, &reg_a, &reg_b))
+        fatal("CMP_JNB_DEST %02x\n", uop->src_reg_a_real);
+
+    uop->p = host_riscv64_BGEU_(block, reg_a, reg_b);
+
+    return 0;
+}
+static int
+codegen_CMP_JNBE_DEST(codeblock_t *block, uop_t *uop)
+{
+    int reg_a;
+    int reg_b;
+
+    if (!codegen_cmp_operands(block, uop, 0, &reg_a, &reg_b))
+        fatal("CMP_JNBE_DEST %02x\n", uop->src_reg_a_real);
+
+    uop->p = host_riscv64_BLTU_(block, reg_b, reg_a);
+
+    return 0;
+}
+static int
+codegen_CMP_JNL_DEST(codeblock_t *block, uop_t *uop)
+{
+    int reg_a;
+    int reg_b;
+
+    if (!codegen_cmp_operands(block, uop, 1, &reg_a, &reg_b))
+        fatal("CMP_JNL_DEST %02x\n", uop->src_reg_a_real);
+
+    uop->p = host_riscv64_BGE_(block, reg_a, reg_b);
+
+    return 0;
+}
+static int
+codegen_CMP_JNLE_DEST(codeblock_t *block, uop_t *uop)
+{
+    int reg_a;
+    int reg_b;
+
+    if (!codegen_cmp_operands(block, uop, 1, &reg_a, &reg_b))
+        fatal("CMP_JNLE_DEST %02x\n", uop->src_reg_a_real);
+
+    uop->p = host_riscv64_BLT_(block, reg_b, reg_a);
+
+    return 0;
+}
+
+/*Signed overflow of a subtraction. The operands are sign extended, so the
+  64-bit difference is exact, and it overflowed if it does not survive being
+  sign extended from the operand width*/
+static int
+codegen_cmp_overflow(codeblock_t *block, uop_t *uop)
+{
+    int src_reg_a  = HOST_REG_GET(uop->src_reg_a_real);
+    int src_reg_b  = HOST_REG_GET(uop->src_reg_b_real);
+    int src_size_a = IREG_GET_SIZE(uop->src_reg_a_real);
+    int src_size_b = IREG_GET_SIZE(uop->src_reg_b_real);
+
+    if (REG_IS_L(src_size_a) && REG_IS_L(src_size_b)) {
+        host_riscv64_SUB(block, REG_TEMP, src_reg_a, src_reg_b);
+        host_riscv64_SEXT_W(block, REG_TEMP2, REG_TEMP);
+    } else if (REG_IS_W(src_size_a) && REG_IS_W(src_size_b)) {
+        host_riscv64_SBFX(block, REG_TEMP, src_reg_a, 0, 16);
+        host_riscv64_SBFX(block, REG_TEMP2, src_reg_b, 0, 16);
+        host_riscv64_SUB(block, REG_TEMP, REG_TEMP, REG_TEMP2);
+        host_riscv64_SBFX(block, REG_TEMP2, REG_TEMP, 0, 16);
+    } else if (REG_IS_B(src_size_a) && REG_IS_B(src_size_b)) {
+        host_riscv64_SBFX(block, REG_TEMP, src_reg_a, 0, 8);
+        host_riscv64_SBFX(block, REG_TEMP2, src_reg_b, 0, 8);
+        host_riscv64_SUB(block, REG_TEMP, REG_TEMP, REG_TEMP2);
+        host_riscv64_SBFX(block, REG_TEMP2, REG_TEMP, 0, 8);
+    } else
+        return 0;
+
+    return 1;
+}
+
+static int
+codegen_CMP_JNO_DEST(codeblock_t *block, uop_t *uop)
+{
+    if (!codegen_cmp_overflow(block, uop))
+        fatal("CMP_JNO_DEST %02x\n", uop->src_reg_a_real);
+
+    uop->p = host_riscv64_BEQ_(block, REG_TEMP, REG_TEMP2);
+
+    return 0;
+}
+static int
+codegen_CMP_JNZ_DEST(codeblock_t *block, uop_t *uop)
+{
+    int reg_a;
+    int reg_b;
+
+    if (!codegen_cmp_operands(block, uop, 0, &reg_a, &reg_b))
+        fatal("CMP_JNZ_DEST %02x\n", uop->src_reg_a_real);
+
+    uop->p = host_riscv64_BNE_(block, reg_a, reg_b);
+
+    return 0;
+}
+static int
+codegen_CMP_JB_DEST(codeblock_t *block, uop_t *uop)
+{
+    int reg_a;
+    int reg_b;
+
+    if (!codegen_cmp_operands(block, uop, 0, &reg_a, &reg_b))
+        fatal("CMP_JB_DEST %02x\n", uop->src_reg_a_real);
+
+    uop->p = host_riscv64_BLTU_(block, reg_a, reg_b);
+
+    return 0;
+}
+static int
+codegen_CMP_JBE_DEST(codeblock_t *block, uop_t *uop)
+{
+    int reg_a;
+    int reg_b;
+
+    if (!codegen_cmp_operands(block, uop, 0, &reg_a, &reg_b))
+        fatal("CMP_JBE_DEST %02x\n", uop->src_reg_a_real);
+
+    uop->p = host_riscv64_BGEU_(block, reg_b, reg_a);
+
+    return 0;
+}
+static int
+codegen_CMP_JL_DEST(codeblock_t *block, uop_t *uop)
+{
+    int reg_a;
+    int reg_b;
+
+    if (!codegen_cmp_operands(block, uop, 1, &reg_a, &reg_b))
+        fatal("CMP_JL_DEST %02x\n", uop->src_reg_a_real);
+
+    uop->p = host_riscv64_BLT_(block, reg_a, reg_b);
+
+    return 0;
+}
+static int
+codegen_CMP_JLE_DEST(codeblock_t *block, uop_t *uop)
+{
+    int reg_a;
+    int reg_b;
+
+    if (!codegen_cmp_operands(block, uop, 1, &reg_a, &reg_b))
+        fatal("CMP_JLE_DEST %02x\n", uop->src_reg_a_real);
+
+    uop->p = host_riscv64_BGE_(block, reg_b, reg_a);
+
+    return 0;
+}
+static int
+codegen_CMP_JO_DEST(codeblock_t *block, uop_t *uop)
+{
+    if (!codegen_cmp_overflow(block, uop))
+        fatal("CMP_JO_DEST %02x\n", uop->src_reg_a_real);
+
+    uop->p = host_riscv64_BNE_(block, REG_TEMP, REG_TEMP2);
+
+    return 0;
+}
+static int
+codegen_CMP_JZ_DEST(codeblock_t *block, uop_t *uop)
+{
+    int reg_a;
+    int reg_b;
+
+    if (!codegen_cmp_operands(block, uop, 0, &reg_a, &reg_b))
+        fatal("CMP_JZ_DEST %02x\n", uop->src_reg_a_real);
+
+    uop->p = host_riscv64_BEQ_(block, reg_a, reg_b);
+
+    return 0;
+}
+
+static int
+codegen_FABS(codeblock_t *block, uop_t *uop)
+{
+    int dest_reg   = HOST_REG_GET(uop->dest_reg_a_real);
+    int src_reg_a  = HOST_REG_GET(uop->src_reg_a_real);
+    int dest_size  = IREG_GET_SIZE(uop->dest_reg_a_real);
+    int src_size_a = IREG_GET_SIZE(uop->src_reg_a_real);
+
+    if (REG_IS_D(dest_size) && REG_IS_D(src_size_a)) {
+        host_riscv64_FABS_D(block, dest_reg, src_reg_a);
+    } else
+        fatal("codegen_FABS %02x %02x\n", uop->dest_reg_a_real, uop->src_reg_a_real);
+
+    return 0;
+}
+static int
+codegen_FCHS(codeblock_t *block, uop_t *uop)
+{
+    int dest_reg   = HOST_REG_GET(uop->dest_reg_a_real);
+    int src_reg_a  = HOST_REG_GET(uop->src_reg_a_real);
+    int dest_size  = IREG_GET_SIZE(uop->dest_reg_a_real);
+    int src_size_a = IREG_GET_SIZE(uop->src_reg_a_real);
+
+    if (REG_IS_D(dest_size) && REG_IS_D(src_size_a)) {
+        host_riscv64_FNEG_D(block, dest_reg, src_reg_a);
+    } else
+        fatal("codegen_FCHS %02x %02x\n", uop->dest_reg_a_real, uop->src_reg_a_real);
+
+    return 0;
+}
+static int
+codegen_FSQRT(codeblock_t *block, uop_t *uop)
+{
+    int dest_reg   = HOST_REG_GET(uop->dest_reg_a_real);
+    int src_reg_a  = HOST_REG_GET(uop->src_reg_a_real);
+    int dest_size  = IREG_GET_SIZE(uop->dest_reg_a_real);
+    int src_size_a = IREG_GET_SIZE(uop->src_reg_a_real);
+
+    if (REG_IS_D(dest_size) && REG_IS_D(src_size_a)) {
+        host_riscv64_FSQRT_D(block, dest_reg, src_reg_a);
+    } else
+        fatal("codegen_FSQRT %02x %02x\n", uop->dest_reg_a_real, uop->src_reg_a_real);
+
+    return 0;
+}
+
+/*Builds the x87 condition codes of comparing src_reg_a with src_reg_b into
+  dest_reg. FLT and FEQ give 0 for unordered operands, which are detected by
+  comparing each operand with itself*/
+static void
+codegen_fcom(codeblock_t *block, int dest_reg, int src_reg_a, int src_reg_b)
+{
+    host_riscv64_FLT_D(block, REG_TEMP, src_reg_a, src_reg_b);
+    host_riscv64_FEQ_D(block, REG_TEMP2, src_reg_a, src_reg_b);
+    host_riscv64_SLLI(block, REG_TEMP, REG_TEMP, 8);     /*C0*/
+    host_riscv64_SLLI(block, REG_TEMP2, REG_TEMP2, 14);  /*C3*/
+    host_riscv64_OR(block, REG_TEMP, REG_TEMP, REG_TEMP2);
+    host_riscv64_FEQ_D(block, REG_TEMP2, src_reg_a, src_reg_a);
+    host_riscv64_FEQ_D(block, REG_TEMP3, src_reg_b, src_reg_b);
+    host_riscv64_AND(block, REG_TEMP2, REG_TEMP2, REG_TEMP3);
+    host_riscv64_ADDI(block, REG_TEMP2, REG_TEMP2, -1);
+    host_riscv64_mov_imm(block, REG_TEMP3, FPU_SW_C0 | FPU_SW_C2 | FPU_SW_C3);
+    host_riscv64_AND(block, REG_TEMP2, REG_TEMP2, REG_TEMP3);
+    host_riscv64_OR(block, dest_reg, REG_TEMP, REG_TEMP2);
+}
+
+static int
+codegen_FTST(codeblock_t *block, uop_t *uop)
+{
+    int dest_reg   = HOST_REG_GET(uop->dest_reg_a_real);
+    int src_reg_a  = HOST_REG_GET(uop->src_reg_a_real);
+    int dest_size  = IREG_GET_SIZE(uop->dest_reg_a_real);
+    int src_size_a = IREG_GET_SIZE(uop->src_reg_a_real);
+
+    if (REG_IS_W(dest_size) && REG_IS_D(src_size_a)) {
+        host_riscv64_FMV_D_X(block, REG_V_TEMP, REG_ZERO);
+        codegen_fcom(block, dest_reg, src_reg_a, REG_V_TEMP);
+    } else
+        fatal("codegen_FTST %02x %02x %02x\n", uop->dest_reg_a_real, uop->src_reg_a_real, uop->src_reg_b_real);
+
+    return 0;
+}
+
+static int
+codegen_FADD(codeblock_t *block, uop_t *uop)
+{
+    int dest_reg   = HOST_REG_GET(uop->dest_reg_a_real);
+    int src_reg_a  = HOST_REG_GET(uop->src_reg_a_real);
+    int src_reg_b  = HOST_REG_GET(uop->src_reg_b_real);
+    int dest_size  = IREG_GET_SIZE(uop->dest_reg_a_real);
+    int src_size_a = IREG_GET_SIZE(uop->src_reg_a_real);
+    int src_size_b = IREG_GET_SIZE(uop->src_reg_b_real);
+
+    if (REG_IS_D(dest_size) && REG_IS_D(src_size_a) && REG_IS_D(src_size_b)) {
+        host_riscv64_FADD_D(block, dest_reg, src_reg_a, src_reg_b);
+    } else
+        fatal("codegen_FADD %02x %02x %02x\n", uop->dest_reg_a_real, uop->src_reg_a_real, uop->src_reg_b_real);
+
+    return 0;
+}
+static int
+codegen_FCOM(codeblock_t *block, uop_t *uop)
+{
+    int dest_reg   = HOST_REG_GET(uop->dest_reg_a_real);
+    int src_reg_a  = HOST_REG_GET(uop->src_reg_a_real);
+    int src_reg_b  = HOST_REG_GET(uop->src_reg_b_real);
+    int dest_size  = IREG_GET_SIZE(uop->dest_reg_a_real);
+    int src_size_a = IREG_GET_SIZE(uop->src_reg_a_real);
+    int src_size_b = IREG_GET_SIZE(uop->src_reg_b_real);
+
+    if (REG_IS_W(dest_size) && REG_IS_D(src_size_a) && REG_IS_D(src_size_b)) {
+        codegen_fcom(block, dest_reg, src_reg_a, src_reg_b);
+    } else
+        fatal("codegen_FCOM %02x %02x %02x\n", uop->dest_reg_a_real, uop->src_reg_a_real, uop->src_reg_b_real);
+
+    return 0;
+}
+static int
+codegen_FDIV(codeblock_t *block, uop_t *uop)
+{
+    int dest_reg   = HOST_REG_GET(uop->dest_reg_a_real);
+    int src_reg_a  = HOST_REG_GET(uop->src_reg_a_real);
+    int src_reg_b  = HOST_REG_GET(uop->src_reg_b_real);
+    int dest_size  = IREG_GET_SIZE(uop->dest_reg_a_real);
+    int src_size_a = IREG_GET_SIZE(uop->src_reg_a_real);
+    int src_size_b = IREG_GET_SIZE(uop->src_reg_b_real);
+
+    if (REG_IS_D(dest_size) && REG_IS_D(src_size_a) && REG_IS_D(src_size_b)) {
+        host_riscv64_FDIV_D(block, dest_reg, src_reg_a, src_reg_b);
+    } else
+        fatal("codegen_FDIV %02x %02x %02x\n", uop->dest_reg_a_real, uop->src_reg_a_real, uop->src_reg_b_real);
+
+    return 0;
+}
+static int
+codegen_FMUL(codeblock_t *block, uop_t *uop)
+{
+    int dest_reg   = HOST_REG_GET(uop->dest_reg_a_real);
+    int src_reg_a  = HOST_REG_GET(uop->src_reg_a_real);
+    int src_reg_b  = HOST_REG_GET(uop->src_reg_b_real);
+    int dest_size  = IREG_GET_SIZE(uop->dest_reg_a_real);
+    int src_size_a = IREG_GET_SIZE(uop->src_reg_a_real);
+    int src_size_b = IREG_GET_SIZE(uop->src_reg_b_real);
+
+    if (REG_IS_D(dest_size) && REG_IS_D(src_size_a) && REG_IS_D(src_size_b)) {
+        host_riscv64_FMUL_D(block, dest_reg, src_reg_a, src_reg_b);
+    } else
+        fatal("codegen_FMUL %02x %02x %02x\n", uop->dest_reg_a_real, uop->src_reg_a_real, uop->src_reg_b_real);
+
+    return 0;
+}
+static int
+codegen_FSUB(codeblock_t *block, uop_t *uop)
+{
+    int dest_reg   = HOST_REG_GET(uop->dest_reg_a_real);
+    int src_reg_a  = HOST_REG_GET(uop->src_reg_a_real);
+    int src_reg_b  = HOST_REG_GET(uop->src_reg_b_real);
+    int dest_size  = IREG_GET_SIZE(uop->dest_reg_a_real);
+    int src_size_a = IREG_GET_SIZE(uop->src_reg_a_real);
+    int src_size_b = IREG_GET_SIZE(uop->src_reg_b_real);
+
+    if (REG_IS_D(dest_size) && REG_IS_D(src_size_a) && REG_IS_D(src_size_b)) {
+        host_riscv64_FSUB_D(block, dest_reg, src_reg_a, src_reg_b);
+    } else
+        fatal("codegen_FSUB %02x %02x %02x\n", uop->dest_reg_a_real, uop->src_reg_a_real, uop->src_reg_b_real);
+
+    return 0;
+}
+
+static int
+codegen_FP_ENTER(codeblock_t *block, uop_t *uop)
+{
+    uint32_t *branch_ptr;
+
+    if (!in_range12((intptr_t) &cr0 - (intptr_t) &cpu_state))
+        fatal("codegen_FP_ENTER - out of range\n");
+
+    host_riscv64_LW(block, REG_TEMP, REG_CPUSTATE, (intptr_t) &cr0 - (intptr_t) &cpu_state);
+    host_riscv64_ANDI(block, REG_TEMP, REG_TEMP, 0xc);
+    branch_ptr = host_riscv64_BEQ_(block, REG_TEMP, REG_ZERO);
+
+    host_riscv64_mov_imm(block, REG_TEMP, uop->imm_data);
+    host_riscv64_SW(block, REG_TEMP, REG_CPUSTATE, (intptr_t) &cpu_state.oldpc - (intptr_t) &cpu_state);
+    host_riscv64_mov_imm(block, REG_ARG0, 7);
+    host_riscv64_call(block, x86_int);
+    host_riscv64_jump(block, (uintptr_t) codegen_exit_rout);
+
+    host_riscv64_branch_set_offset(branch_ptr, &block_write_data[block_pos]);
+
+    return 0;
+}
+static int
+codegen_MMX_ENTER(codeblock_t *block, uop_t *uop)
+{
+    uint32_t *branch_ptr;
+
+    if (!in_range12((intptr_t) &cr0 - (intptr_t) &cpu_state))
+        fatal("codegen_MMX_ENTER - out of range\n");
+
+    host_riscv64_LW(block, REG_TEMP, REG_CPUSTATE, (intptr_t) &cr0 - (intptr_t) &cpu_state);
+    host_riscv64_ANDI(block, REG_TEMP, REG_TEMP, 0xc);
+    branch_ptr = host_riscv64_BEQ_(block, REG_TEMP, REG_ZERO);
+
+    host_riscv64_mov_imm(block, REG_TEMP, uop->imm_data);
+    host_riscv64_SW(block, REG_TEMP, REG_CPUSTATE, (intptr_t) &cpu_state.oldpc - (intptr_t) &cpu_state);
+    host_riscv64_mov_imm(block, REG_ARG0, 7);
+    host_riscv64_call(block, x86_int);
+    host_riscv64_jump(block, (uintptr_t) codegen_exit_rout);
+
+    host_riscv64_branch_set_offset(branch_ptr, &block_write_data[block_pos]);
+
+    host_riscv64_mov_imm(block, REG_TEMP, 0x01010101);
+    host_riscv64_SW(block, REG_TEMP, REG_CPUSTATE, (intptr_t) &cpu_state.tag[0] - (intptr_t) &cpu_state);
+    host_riscv64_SW(block, REG_TEMP, REG_CPUSTATE, (intptr_t) &cpu_state.tag[4] - (intptr_t) &cpu_state);
+    host_riscv64_SW(block, REG_ZERO, REG_CPUSTATE, (intptr_t) &cpu_state.TOP - (intptr_t) &cpu_state);
+    host_riscv64_SB(block, REG_ZERO, REG_CPUSTATE, (intptr_t) &cpu_state.ismmx - (intptr_t) &cpu_state);
+
+    return 0;
+}
+
+static int
+codegen_JMP(codeblock_t *block, uop_t *uop)
+{
+    host_riscv64_jump(block, (uintptr_t) uop->p);
+
+    return 0;
+}
+
+static int
+codegen_LOAD_FUNC_ARG0(codeblock_t *block, uop_t *uop)
+{
+    int src_reg  = HOST_REG_GET(uop->src_reg_a_real);
+    int src_size = IREG_GET_SIZE(uop->src_reg_a_real);
+
+    if (REG_IS_W(src_size)) {
+        host_riscv64_UBFX(block, REG_ARG0, src_reg, 0, 16);
+    } else
+        fatal("codegen_LOAD_FUNC_ARG0 %02x\n", uop->src_reg_a_real);
+
+    return 0;
+}
+static int
+codegen_LOAD_FUNC_ARG1(codeblock_t *block, uop_t *uop)
+{
+    fatal("codegen_LOAD_FUNC_ARG1 %02x\n", uop->src_reg_a_real);
+    return 0;
+}
+static int
+codegen_LOAD_FUNC_ARG2(codeblock_t *block, uop_t *uop)
+{
+    fatal("codegen_LOAD_FUNC_ARG2 %02x\n", uop->src_reg_a_real);
+    return 0;
+}
+static int
+codegen_LOAD_FUNC_ARG3(codeblock_t *block, uop_t *uop)
+{
+    fatal("codegen_LOAD_FUNC_ARG3 %02x\n", uop->src_reg_a_real);
+    return 0;
+}
+
+static int
+codegen_LOAD_FUNC_ARG0_IMM(codeblock_t *block, uop_t *uop)
+{
+    host_riscv64_mov_imm(block, REG_ARG0, uop->imm_data);
+
+    return 0;
+}
+static int
+codegen_LOAD_FUNC_ARG1_IMM(codeblock_t *block, uop_t *uop)
+{
+    host_riscv64_mov_imm(block, REG_ARG1, uop->imm_data);
+
+    return 0;
+}
+static int
+codegen_LOAD_FUNC_ARG2_IMM(codeblock_t *block, uop_t *uop)
+{
+    host_riscv64_mov_imm(block, REG_ARG2, uop->imm_data);
+
+    return 0;
+}
+static int
+codegen_LOAD_FUNC_ARG3_IMM(codeblock_t *block, uop_t *uop)
+{
+    host_riscv64_mov_imm(block, REG_ARG3, uop->imm_data);
+
+    return 0;
+}
+
+static int
+codegen_LOAD_SEG(codeblock_t *block, uop_t *uop)
+{
+    int src_reg  = HOST_REG_GET(uop->src_reg_a_real);
+    int src_size = IREG_GET_SIZE(uop->src_reg_a_real);
+
+    if (!REG_IS_W(src_size))
+        fatal("LOAD_SEG %02x %p\n", uop->src_reg_a_real, uop->p);
+
+    host_riscv64_mov_imm64(block, REG_ARG1, (uintptr_t) uop->p);
+    host_riscv64_UBFX(block, REG_ARG0, src_reg, 0, 16);
+    host_riscv64_call(block, (void *) loadseg);
+    host_riscv64_BNEZ(block, REG_A0, (uintptr_t) codegen_exit_rout);
+
+    return 0;
+}
+
+static int
+codegen_MEM_LOAD_ABS(codeblock_t *block, uop_t *uop)
+{
+    int dest_reg  = HOST_REG_GET(uop->dest_reg_a_real);
+    int seg_reg   = HOST_REG_GET(uop->src_reg_a_real);
+    int dest_size = IREG_GET_SIZE(uop->dest_reg_a_real);
+
+    host_riscv64_ADDW_IMM(block, REG_A0, seg_reg, uop->imm_data);
+    if (REG_IS_B(dest_size) || REG_IS_BH(dest_size)) {
+        host_riscv64_call(block, codegen_mem_load_byte);
+    } else if (REG_IS_W(dest_size)) {
+        host_riscv64_call(block, codegen_mem_load_word);
+    } else if (REG_IS_L(dest_size)) {
+        host_riscv64_call(block, codegen_mem_load_long);
+    } else
+        fatal("MEM_LOAD_ABS - %02x\n", uop->dest_reg_a_real);
+    host_riscv64_BNEZ(block, REG_A1, (uintptr_t) codegen_exit_rout);
+    if (REG_IS_B(dest_size)) {
+        host_riscv64_BFI(block, dest_reg, REG_A0, 0, 8);
+    } else if (REG_IS_BH(dest_size)) {
+        host_riscv64_BFI(block, dest_reg, REG_A0, 8, 8);
+    } else if (REG_IS_W(dest_size)) {
+        host_riscv64_BFI(block, dest_reg, REG_A0, 0, 16);
+    } else if (REG_IS_L(dest_size)) {
+        host_riscv64_MV(block, dest_reg, REG_A0);
+    }
+
+    return 0;
+}
+static int
+codegen_MEM_LOAD_REG(codeblock_t *block, uop_t *uop)
+{
+    int dest_reg  = HOST_REG_GET(uop->dest_reg_a_real);
+    int seg_reg   = HOST_REG_GET(uop->src_reg_a_real);
+    int addr_reg  = HOST_REG_GET(uop->src_reg_b_real);
+    int dest_size = IREG_GET_SIZE(uop->dest_reg_a_real);
+
+    host_riscv64_ADDW(block, REG_A0, seg_reg, addr_reg);
+    if (uop->imm_data)
+        host_riscv64_ADDW_IMM(block, REG_A0, REG_A0, uop->imm_data);
+    if (REG_IS_B(dest_size) || REG_IS_BH(dest_size)) {
+        host_riscv64_call(block, codegen_mem_load_byte);
+    } else if (REG_IS_W(dest_size)) {
+        host_riscv64_call(block, codegen_mem_load_word);
+    } else if (REG_IS_L(dest_size)) {
+        host_riscv64_call(block, codegen_mem_load_long);
+    } else if (REG_IS_Q(dest_size)) {
+        host_riscv64_call(block, codegen_mem_load_quad);
+    } else
+        fatal("MEM_LOAD_REG - %02x\n", uop->dest_reg_a_real);
+    host_riscv64_BNEZ(block, REG_A1, (uintptr_t) codegen_exit_rout);
+    if (REG_IS_B(dest_size)) {
+        host_riscv64_BFI(block, dest_reg, REG_A0, 0, 8);
+    } else if (REG_IS_BH(dest_size)) {
+        host_riscv64_BFI(block, dest_reg, REG_A0, 8, 8);
+    } else if (REG_IS_W(dest_size)) {
+        host_riscv64_BFI(block, dest_reg, REG_A0, 0, 16);
+    } else if (REG_IS_L(dest_size)) {
+        host_riscv64_MV(block, dest_reg, REG_A0);
+    } else if (REG_IS_Q(dest_size)) {
+        host_riscv64_FMV_D(block, dest_reg, REG_V_TEMP);
+    }
+
+    return 0;
+}
+static int
+codegen_MEM_LOAD_DOUBLE(codeblock_t *block, uop_t *uop)
+{
+    int dest_reg  = HOST_REG_GET(uop->dest_reg_a_real);
+    int seg_reg   = HOST_REG_GET(uop->src_reg_a_real);
+    int addr_reg  = HOST_REG_GET(uop->src_reg_b_real);
+    int dest_size = IREG_GET_SIZE(uop->dest_reg_a_real);
+
+    if (!REG_IS_D(dest_size))
+        fatal("MEM_LOAD_DOUBLE - %02x\n", uop->dest_reg_a_real);
+
+    host_riscv64_ADDW(block, REG_A0, seg_reg, addr_reg);
+    if (uop->imm_data)
+        host_riscv64_ADDW_IMM(block, REG_A0, REG_A0, uop->imm_data);
+    host_riscv64_call(block, codegen_mem_load_double);
+    host_riscv64_BNEZ(block, REG_A1, (uintptr_t) codegen_exit_rout);
+    host_riscv64_FMV_D(block, dest_reg, REG_V_TEMP);
+
+    return 0;
+}
+static int
+codegen_MEM_LOAD_SINGLE(codeblock_t *block, uop_t *uop)
+{
+    int dest_reg  = HOST_REG_GET(uop->dest_reg_a_real);
+    int seg_reg   = HOST_REG_GET(uop->src_reg_a_real);
+    int addr_reg  = HOST_REG_GET(uop->src_reg_b_real);
+    int dest_size = IREG_GET_SIZE(uop->dest_reg_a_real);
+
+    if (!REG_IS_D(dest_size))
+        fatal("MEM_LOAD_DOUBLE - %02x\n", uop->dest_reg_a_real);
+
+    host_riscv64_ADDW(block, REG_A0, seg_reg, addr_reg);
+    if (uop->imm_data)
+        host_riscv64_ADDW_IMM(block, REG_A0, REG_A0, uop->imm_data);
+    host_riscv64_call(block, codegen_mem_load_single);
+    host_riscv64_BNEZ(block, REG_A1, (uintptr_t) codegen_exit_rout);
+    host_riscv64_FCVT_D_S(block, dest_reg, REG_V_TEMP);
+
+    return 0;
+}
+
+static int
+codegen_MEM_STORE_ABS(codeblock_t *block, uop_t *uop)
+{
+    int seg_reg  = HOST_REG_GET(uop->src_reg_a_real);
+    int src_reg  = HOST_REG_GET(uop->src_reg_b_real);
+    int src_size = IREG_GET_SIZE(uop->src_reg_b_real);
+
+    host_riscv64_ADDW_IMM(block, REG_A0, seg_reg, uop->imm_data);
+    if (REG_IS_B(src_size)) {
+        host_riscv64_ANDI(block, REG_A1, src_reg, 0xff);
+        host_riscv64_call(block, codegen_mem_store_byte);
+    } else if (REG_IS_BH(src_size)) {
+        host_riscv64_UBFX(block, REG_A1, src_reg, 8, 8);
+        host_riscv64_call(block, codegen_mem_store_byte);
+    } else if (REG_IS_W(src_size)) {
+        host_riscv64_UBFX(block, REG_A1, src_reg, 0, 16);
+        host_riscv64_call(block, codegen_mem_store_word);
+    } else if (REG_IS_L(src_size)) {
+        host_riscv64_MV(block, REG_A1, src_reg);
+        host_riscv64_call(block, codegen_mem_store_long);
+    } else
+        fatal("MEM_STORE_ABS - %02x\n", uop->dest_reg_a_real);
+    host_riscv64_BNEZ(block, REG_A1, (uintptr_t) codegen_exit_rout);
+
+    return 0;
+}
+static int
+codegen_MEM_STORE_REG(codeblock_t *block, uop_t *uop)
+{
+    int seg_reg  = HOST_REG_GET(uop->src_reg_a_real);
+    int addr_reg = HOST_REG_GET(uop->src_reg_b_real);
+    int src_reg  = HOST_REG_GET(uop->src_reg_c_real);
+    int src_size = IREG_GET_SIZE(uop->src_reg_c_real);
+
+    host_riscv64_ADDW(block, REG_A0, seg_reg, addr_reg);
+    if (uop->imm_data)
+        host_riscv64_ADDW_IMM(block, REG_A0, REG_A0, uop->imm_data);
+    if (REG_IS_B(src_size)) {
+        host_riscv64_ANDI(block, REG_A1, src_reg, 0xff);
+        host_riscv64_call(block, codegen_mem_store_byte);
+    } else if (REG_IS_BH(src_size)) {
+        host_riscv64_UBFX(block, REG_A1, src_reg, 8, 8);
+        host_riscv64_call(block, codegen_mem_store_byte);
+    } else if (REG_IS_W(src_size)) {
+        host_riscv64_UBFX(block, REG_A1, src_reg, 0, 16);
+        host_riscv64_call(block, codegen_mem_store_word);
+    } else if (REG_IS_L(src_size)) {
+        host_riscv64_MV(block, REG_A1, src_reg);
+        host_riscv64_call(block, codegen_mem_store_long);
+    } else if (REG_IS_Q(src_size)) {
+        host_riscv64_FMV_D(block, REG_V_TEMP, src_reg);
+        host_riscv64_call(block, codegen_mem_store_quad);
+    } else
+        fatal("MEM_STORE_REG - %02x\n", uop->src_reg_c_real);
+    host_riscv64_BNEZ(block, REG_A1, (uintptr_t) codegen_exit_rout);
+
+    return 0;
+}
+
+static int
+codegen_MEM_STORE_IMM_8(codeblock_t *block, uop_t *uop)
+{
+    int seg_reg  = HOST_REG_GET(uop->src_reg_a_real);
+    int addr_reg = HOST_REG_GET(uop->src_reg_b_real);
+
+    host_riscv64_ADDW(block, REG_A0, seg_reg, addr_reg);
+    host_riscv64_mov_imm(block, REG_A1, uop->imm_data);
+    host_riscv64_call(block, codegen_mem_store_byte);
+    host_riscv64_BNEZ(block, REG_A1, (uintptr_t) codegen_exit_rout);
+
+    return 0;
+}
+static int
+codegen_MEM_STORE_IMM_16(codeblock_t *block, uop_t *uop)
+{
+    int seg_reg  = HOST_REG_GET(uop->src_reg_a_real);
+    int addr_reg = HOST_REG_GET(uop->src_reg_b_real);
+
+    host_riscv64_ADDW(block, REG_A0, seg_reg, addr_reg);
+    host_riscv64_mov_imm(block, REG_A1, uop->imm_data);
+    host_riscv64_call(block, codegen_mem_store_word);
+    host_riscv64_BNEZ(block, REG_A1, (uintptr_t) codegen_exit_rout);
+
+    return 0;
+}
+static int
+codegen_MEM_STORE_IMM_32(codeblock_t *block, uop_t *uop)
+{
+    int seg_reg  = HOST_REG_GET(uop->src_reg_a_real);
+    int addr_reg = HOST_REG_GET(uop->src_reg_b_real);
+
+    host_riscv64_ADDW(block, REG_A0, seg_reg, addr_reg);
+    host_riscv64_mov_imm(block, REG_A1, uop->imm_data);
+    host_riscv64_call(block, codegen_mem_store_long);
+    host_riscv64_BNEZ(block, REG_A1, (uintptr_t) codegen_exit_rout);
+
+    return 0;
+}
+
+static int
+codegen_MEM_STORE_SINGLE(codeblock_t *block, uop_t *uop)
+{
+    int seg_reg  = HOST_REG_GET(uop->src_reg_a_real);
+    int addr_reg = HOST_REG_GET(uop->src_reg_b_real);
+    int src_reg  = HOST_REG_GET(uop->src_reg_c_real);
+    int src_size = IREG_GET_SIZE(uop->src_reg_c_real);
+
+    if (!REG_IS_D(src_size))
+        fatal("MEM_STORE_REG - %02x\n", uop->dest_reg_a_real);
+
+    host_riscv64_ADDW(block, REG_A0, seg_reg, addr_reg);
+    if (uop->imm_data)
+        host_riscv64_ADDW_IMM(block, REG_A0, REG_A0, uop->imm_data);
+    host_riscv64_FCVT_S_D(block, REG_V_TEMP, src_reg);
+    host_riscv64_call(block, codegen_mem_store_single);
+    host_riscv64_BNEZ(block, REG_A1, (uintptr_t) codegen_exit_rout);
+
+    return 0;
+}
+static int
+codegen_MEM_STORE_DOUBLE(codeblock_t *block, uop_t *uop)
+{
+    int seg_reg  = HOST_REG_GET(uop->src_reg_a_real);
+    int addr_reg = HOST_REG_GET(uop->src_reg_b_real);
+    int src_reg  = HOST_REG_GET(uop->src_reg_c_real);
+    int src_size = IREG_GET_SIZE(uop->src_reg_c_real);
+
+    if (!REG_IS_D(src_size))
+        fatal("MEM_STORE_REG - %02x\n", uop->dest_reg_a_real);
+
+    host_riscv64_ADDW(block, REG_A0, seg_reg, addr_reg);
+    if (uop->imm_data)
+        host_riscv64_ADDW_IMM(block, REG_A0, REG_A0, uop->imm_data);
+    host_riscv64_FMV_D(block, REG_V_TEMP, src_reg);
+    host_riscv64_call(block, codegen_mem_store_double);
+    host_riscv64_BNEZ(block, REG_A1, (uintptr_t) codegen_exit_rout);
+
+    return 0;
+}
+
+static int
+codegen_MOV(codeblock_t *block, uop_t *uop)
+{
+    int dest_reg  = HOST_REG_GET(uop->dest_reg_a_real);
+    int src_reg   = HOST_REG_GET(uop->src_reg_a_real);
+    int dest_size = IREG_GET_SIZE(uop->dest_reg_a_real);
+    int src_size  = IREG_GET_SIZE(uop->src_reg_a_real);
+
+    if (REG_IS_L(dest_size) && REG_IS_L(src_size)) {
+        host_riscv64_MV(block, dest_reg, src_reg);
+    } else if (REG_IS_W(dest_size) && REG_IS_W(src_size)) {
+        host_riscv64_BFI(block, dest_reg, src_reg, 0, 16);
+    } else if (REG_IS_B(dest_size) && REG_IS_B(src_size)) {
+        host_riscv64_BFI(block, dest_reg, src_reg, 0, 8);
+    } else if (REG_IS_B(dest_size) && REG_IS_BH(src_size)) {
+        host_riscv64_SRLI(block, REG_TEMP, src_reg, 8);
+        host_riscv64_BFI(block, dest_reg, REG_TEMP, 0, 8);
+    } else if (REG_IS_BH(dest_size) && REG_IS_B(src_size)) {
+        host_riscv64_BFI(block, dest_reg, src_reg, 8, 8);
+    } else if (REG_IS_BH(dest_size) && REG_IS_BH(src_size)) {
+        host_riscv64_SRLI(block, REG_TEMP, src_reg, 8);
+        host_riscv64_BFI(block, dest_reg, REG_TEMP, 8, 8);
+    } else if (REG_IS_D(dest_size) && REG_IS_D(src_size)) {
+        host_riscv64_FMV_D(block, dest_reg, src_reg);
+    } else if (REG_IS_Q(dest_size) && REG_IS_Q(src_size)) {
+        host_riscv64_FMV_D(block, dest_reg, src_reg);
+    } else
+        fatal("MOV %x %x\n", uop->dest_reg_a_real, uop->src_reg_a_real);
+
+    return 0;
+}
+static int
+codegen_MOV_IMM(codeblock_t *block, uop_t *uop)
+{
+    int dest_reg  = HOST_REG_GET(uop->dest_reg_a_real);
+    int dest_size = IREG_GET_SIZE(uop->dest_reg_a_real);
+
+    if (REG_IS_L(dest_size)) {
+        host_riscv64_mov_imm(block, dest_reg, uop->imm_data);
+    } else if (REG_IS_W(dest_size)) {
+        host_riscv64_mov_imm(block, REG_TEMP, uop->imm_data & 0xffff);
+        host_riscv64_BFI(block, dest_reg, REG_TEMP, 0, 16);
+    } else if (REG_IS_B(dest_size)) {
+        host_riscv64_mov_imm(block, REG_TEMP, uop->imm_data & 0xff);
+        host_riscv64_BFI(block, dest_reg, REG_TEMP, 0, 8);
+    } else if (REG_IS_BH(dest_size)) {
+        host_riscv64_mov_imm(block, REG_TEMP, uop->imm_data & 0xff);
+        host_riscv64_BFI(block, dest_reg, REG_TEMP, 8, 8);
+    } else
+        fatal("MOV_IMM %x\n", uop->dest_reg_a_real);
+
+    return 0;
+}
+static int
+codegen_MOV_PTR(codeblock_t *block, uop_t *uop)
+{
+    host_riscv64_mov_imm64(block, HOST_REG_GET(uop->dest_reg_a_real), (uintptr_t) uop->p);
+
+    return 0;
+}
+
+static int
+codegen_MOVSX(codeblock_t *block, uop_t *uop)
+{
+    int dest_reg  = HOST_REG_GET(uop->dest_reg_a_real);
+    int src_reg   = HOST_REG_GET(uop->src_reg_a_real);
+    int dest_size = IREG_GET_SIZE(uop->dest_reg_a_real);
+    int src_size  = IREG_GET_SIZE(uop->src_reg_a_real);
+
+    if (REG_IS_L(dest_size) && REG_IS_B(src_size)) {
+        host_riscv64_SBFX(block, dest_reg, src_reg, 0, 8);
+    } else if (REG_IS_L(dest_size) && REG_IS_BH(src_size)) {
+        host_riscv64_SBFX(block, dest_reg, src_reg, 8, 8);
+    } else if (REG_IS_L(dest_size) && REG_IS_W(src_size)) {
+        host_riscv64_SBFX(block, dest_reg, src_reg, 0, 16);
+    } else if (REG_IS_W(dest_size) && REG_IS_B(src_size)) {
+        host_riscv64_SBFX(block, REG_TEMP, src_reg, 0, 8);
+        host_riscv64_BFI(block, dest_reg, REG_TEMP, 0, 16);
+    } else if (REG_IS_W(dest_size) && REG_IS_BH(src_size)) {
+        host_riscv64_SBFX(block, REG_TEMP, src_reg, 8, 8);
+        host_riscv64_BFI(block, dest_reg, REG_TEMP, 0, 16);
+    } else
+        fatal("MOVSX %02x %02x\n", uop->dest_reg_a_real, uop->src_reg_a_real);
+
+    return 0;
+}
+static int
+codegen_MOVZX(codeblock_t *block, uop_t *uop)
+{
+    int dest_reg  = HOST_REG_GET(uop->dest_reg_a_real);
+    int src_reg   = HOST_REG_GET(uop->src_reg_a_real);
+    int dest_size = IREG_GET_SIZE(uop->dest_reg_a_real);
+    int src_size  = IREG_GET_SIZE(uop->src_reg_a_real);
+
+    if (REG_IS_Q(dest_size) && REG_IS_L(src_size)) {
+        host_riscv64_ZEXT_W(block, REG_TEMP, src_reg);
+        host_riscv64_FMV_D_X(block, dest_reg, REG_TEMP);
+    } else if (REG_IS_L(dest_size) && REG_IS_Q(src_size)) {
+        host_riscv64_FMV_X_W(block, dest_reg, src_reg);
+    } else if (REG_IS_L(dest_size) && REG_IS_B(src_size)) {
+        host_riscv64_ANDI(block, dest_reg, src_reg, 0xff);
+    } else if (REG_IS_L(dest_size) && REG_IS_BH(src_size)) {
+        host_riscv64_UBFX(block, dest_reg, src_reg, 8, 8);
+    } else if (REG_IS_L(dest_size) && REG_IS_W(src_size)) {
+        host_riscv64_UBFX(block, dest_reg, src_reg, 0, 16);
+    } else if (REG_IS_W(dest_size) && REG_IS_B(src_size)) {
+        host_riscv64_ANDI(block, REG_TEMP, src_reg, 0xff);
+        host_riscv64_BFI(block, dest_reg, REG_TEMP, 0, 16);
+    } else if (REG_IS_W(dest_size) && REG_IS_BH(src_size)) {
+        host_riscv64_UBFX(block, REG_TEMP, src_reg, 8, 8);
+        host_riscv64_BFI(block, dest_reg, REG_TEMP, 0, 16);
+    } else
+        fatal("MOVZX %02x %02x\n", uop->dest_reg_a_real, uop->src_reg_a_real);
+
+    return 0;
+}
+
+static int
+codegen_MOV_DOUBLE_INT(codeblock_t *block, uop_t *uop)
+{
+    int dest_reg  = HOST_REG_GET(uop->dest_reg_a_real);
+    int src_reg   = HOST_REG_GET(uop->src_reg_a_real);
+    int dest_size = IREG_GET_SIZE(uop->dest_reg_a_real);
+    int src_size  = IREG_GET_SIZE(uop->src_reg_a_real);
+
+    if (REG_IS_D(dest_size) && REG_IS_L(src_size)) {
+        host_riscv64_FCVT_D_W(block, dest_reg, src_reg);
+    } else if (REG_IS_D(dest_size) && REG_IS_W(src_size)) {
+        host_riscv64_SBFX(block, REG_TEMP, src_reg, 0, 16);
+        host_riscv64_FCVT_D_W(block, dest_reg, REG_TEMP);
+    } else if (REG_IS_D(dest_size) && REG_IS_Q(src_size)) {
+        host_riscv64_FMV_X_D(block, REG_TEMP, src_reg);
+        host_riscv64_FCVT_D_L(block, dest_reg, REG_TEMP);
+    } else
+        fatal("MOV_DOUBLE_INT %02x %02x\n", uop->dest_reg_a_real, uop->src_reg_a_real);
+
+    return 0;
+}
+static int
+codegen_MOV_INT_DOUBLE(codeblock_t *block, uop_t *uop)
+{
+    int dest_reg  = HOST_REG_GET(uop->dest_reg_a_real);
+    int src_reg   = HOST_REG_GET(uop->src_reg_a_real);
+    int dest_size = IREG_GET_SIZE(uop->dest_reg_a_real);
+    int src_size  = IREG_GET_SIZE(uop->src_reg_a_real);
+
+    if (REG_IS_L(dest_size) && REG_IS_D(src_size)) {
+        host_riscv64_FMV_D(block, REG_V_TEMP, src_reg);
+        host_riscv64_call(block, codegen_fp_round);
+        host_riscv64_MV(block, dest_reg, REG_TEMP);
+    } else if (REG_IS_W(dest_size) && REG_IS_D(src_size)) {
+        host_riscv64_FMV_D(block, REG_V_TEMP, src_reg);
+        host_riscv64_call(block, codegen_fp_round);
+        host_riscv64_BFI(block, dest_reg, REG_TEMP, 0, 16);
+    } else
+        fatal("MOV_INT_DOUBLE %02x %02x\n", uop->dest_reg_a_real, uop->src_reg_a_real);
+
+    return 0;
+}
+static int
+codegen_MOV_INT_DOUBLE_64(codeblock_t *block, uop_t *uop)
+{
+    int dest_reg    = HOST_REG_GET(uop->dest_reg_a_real);
+    int src_reg     = HOST_REG_GET(uop->src_reg_a_real);
+    int src_64_reg  = HOST_REG_GET(uop->src_reg_b_real);
+    int tag_reg     = HOST_REG_GET(uop->src_reg_c_real);
+    int dest_size   = IREG_GET_SIZE(uop->dest_reg_a_real);
+    int src_size    = IREG_GET_SIZE(uop->src_reg_a_real);
+    int src_64_size = IREG_GET_SIZE(uop->src_reg_b_real);
+
+    if (REG_IS_Q(dest_size) && REG_IS_D(src_size) && REG_IS_Q(src_64_size)) {
+        uint32_t *branch_offset;
+
+        /*If TAG_UINT64 is set then the source is MM[]. Otherwise it is a double in ST()*/
+        host_riscv64_FMV_D(block, dest_reg, src_64_reg);
+        host_riscv64_ANDI(block, REG_TEMP, tag_reg, TAG_UINT64);
+        branch_offset = host_riscv64_BNE_(block, REG_TEMP, REG_ZERO);
+
+        host_riscv64_FMV_D(block, REG_V_TEMP, src_reg);
+        host_riscv64_call(block, codegen_fp_round_quad);
+        host_riscv64_FMV_D_X(block, dest_reg, REG_TEMP);
+
+        host_riscv64_branch_set_offset(branch_offset, &block_write_data[block_pos]);
+    } else
+        fatal("MOV_INT_DOUBLE_64 %02x %02x\n", uop->dest_reg_a_real, uop->src_reg_a_real);
+
+    return 0;
+}
+static int
+codegen_MOV_REG_PTR(codeblock_t *block, uop_t *uop)
+{
+    int dest_reg  = HOST_REG_GET(uop->dest_reg_a_real);
+    int dest_size = IREG_GET_SIZE(uop->dest_reg_a_real);
+
+    host_riscv64_mov_imm64(block, REG_TEMP, (uintptr_t) uop->p);
+    if (REG_IS_L(dest_size)) {
+        host_riscv64_LW(block, dest_reg, REG_TEMP, 0);
+    } else
+        fatal("MOV_REG_PTR %02x\n", uop->dest_reg_a_real);
+
+    return 0;
+}
+static int
+codegen_MOVZX_REG_PTR_8(codeblock_t *block, uop_t *uop)
+{
+    int dest_reg  = HOST_REG_GET(uop->dest_reg_a_real);
+    int dest_size = IREG_GET_SIZE(uop->dest_reg_a_real);
+
+    host_riscv64_mov_imm64(block, REG_TEMP, (uintptr_t) uop->p);
+    if (REG_IS_L(dest_size)) {
+        host_riscv64_LBU(block, dest_reg, REG_TEMP, 0);
+    } else if (REG_IS_W(dest_size)) {
+        host_riscv64_LBU(block, REG_TEMP, REG_TEMP, 0);
+        host_riscv64_BFI(block, dest_reg, REG_TEMP, 0, 16);
+    } else if (REG_IS_B(dest_size)) {
+        host_riscv64_LBU(block, REG_TEMP, REG_TEMP, 0);
+        host_riscv64_BFI(block, dest_reg, REG_TEMP, 0, 8);
+    } else
+        fatal("MOVZX_REG_PTR_8 %02x\n", uop->dest_reg_a_real);
+
+    return 0;
+}
+static int
+codegen_MOVZX_REG_PTR_16(codeblock_t *block, uop_t *uop)
+{
+    int dest_reg  = HOST_REG_GET(uop->dest_reg_a_real);
+    int dest_size = IREG_GET_SIZE(uop->dest_reg_a_real);
+
+    host_riscv64_mov_imm64(block, REG_TEMP, (uintptr_t) uop->p);
+    if (REG_IS_L(dest_size)) {
+        host_riscv64_LHU(block, dest_reg, REG_TEMP, 0);
+    } else if (REG_IS_W(dest_size)) {
+        host_riscv64_LHU(block, REG_TEMP, REG_TEMP, 0);
+        host_riscv64_BFI(block, dest_reg, REG_TEMP, 0, 16);
+    } else
+        fatal("MOVZX_REG_PTR_16 %02x\n", uop->dest_reg_a_real);
+
+    return 0;
+}
+
+static int
+codegen_NOP(UNUSED(codeblock_t *block), UNUSED(uop_t *uop))
+{
+    return 0;
+}
+
+static int
+codegen_OR(codeblock_t *block, uop_t *uop)
+{
+    int dest_reg   = HOST_REG_GET(uop->dest_reg_a_real);
+    int src_reg_a  = HOST_REG_GET(uop->src_reg_a_real);
+    int src_reg_b  = HOST_REG_GET(uop->src_reg_b_real);
+    int dest_size  = IREG_GET_SIZE(uop->dest_reg_a_real);
+    int src_size_a = IREG_GET_SIZE(uop->src_reg_a_real);
+    int src_size_b = IREG_GET_SIZE(uop->src_reg_b_real);
+
+    if (REG_IS_Q(dest_size) && REG_IS_Q(src_size_a) && REG_IS_Q(src_size_b)) {
+        host_riscv64_FMV_X_D(block, REG_TEMP, src_reg_a);
+        host_riscv64_FMV_X_D(block, REG_TEMP2, src_reg_b);
+        host_riscv64_OR(block, REG_TEMP, REG_TEMP, REG_TEMP2);
+        host_riscv64_FMV_D_X(block, dest_reg, REG_TEMP);
+    } else if (REG_IS_L(dest_size) && REG_IS_L(src_size_a) && REG_IS_L(src_size_b)) {
+        host_riscv64_OR(block, dest_reg, src_reg_a, src_reg_b);
+    } else if (REG_IS_W(dest_size) && REG_IS_W(src_size_a) && REG_IS_W(src_size_b)) {
+        host_riscv64_OR(block, REG_TEMP, src_reg_a, src_reg_b);
+        host_riscv64_BFI(block, dest_reg, REG_TEMP, 0, 16);
+    } else if (REG_IS_B(dest_size) && REG_IS_B(src_size_a) && REG_IS_B(src_size_b) && dest_reg == src_reg_a) {
+        host_riscv64_ANDI(block, REG_TEMP, src_reg_b, 0xff);
+        host_riscv64_OR(block, dest_reg, src_reg_a, REG_TEMP);
+    } else if (REG_IS_B(dest_size) && REG_IS_B(src_size_a) && REG_IS_BH(src_size_b) && dest_reg == src_reg_a) {
+        host_riscv64_UBFX(block, REG_TEMP, src_reg_b, 8, 8);
+        host_riscv64_OR(block, dest_reg, src_reg_a, REG_TEMP);
+    } else if (REG_IS_BH(dest_size) && REG_IS_BH(src_size_a) && REG_IS_B(src_size_b) && dest_reg == src_reg_a) {
+        host_riscv64_ANDI(block, REG_TEMP, src_reg_b, 0xff);
+        host_riscv64_SLLI(block, REG_TEMP, REG_TEMP, 8);
+        host_riscv64_OR(block, dest_reg, src_reg_a, REG_TEMP);
+    } else if (REG_IS_BH(dest_size) && REG_IS_BH(src_size_a) && REG_IS_BH(src_size_b) && dest_reg == src_reg_a) {
+        host_riscv64_UBFX(block, REG_TEMP, src_reg_b, 8, 8);
+        host_riscv64_SLLI(block, REG_TEMP, REG_TEMP, 8);
+        host_riscv64_OR(block, dest_reg, src_reg_a, REG_TEMP);
+    } else
+        fatal("OR %02x %02x %02x\n", uop->dest_reg_a_real, uop->src_reg_a_real, uop->src_reg_b_real);
+
+    return 0;
+}
+static int
+codegen_OR_IMM(codeblock_t *block, uop_t *uop)
+{
+    int dest_reg  = HOST_REG_GET(uop->dest_reg_a_real);
+    int src_reg   = HOST_REG_GET(uop->src_reg_a_real);
+    int dest_size = IREG_GET_SIZE(uop->dest_reg_a_real);
+    int src_size  = IREG_GET_SIZE(uop->src_reg_a_real);
+
+    if (REG_IS_L(dest_size) && REG_IS_L(src_size)) {
+        host_riscv64_OR_IMM(block, dest_reg, src_reg, uop->imm_data);
+    } else if (REG_IS_W(dest_size) && REG_IS_W(src_size) && dest_reg == src_reg) {
+        host_riscv64_OR_IMM(block, dest_reg, src_reg, uop->imm_data & 0xffff);
+    } else if (REG_IS_B(dest_size) && REG_IS_B(src_size) && dest_reg == src_reg) {
+        host_riscv64_OR_IMM(block, dest_reg, src_reg, uop->imm_data & 0xff);
+    } else if (REG_IS_BH(dest_size) && REG_IS_BH(src_size) && dest_reg == src_reg) {
+        host_riscv64_OR_IMM(block, dest_reg, src_reg, (uop->imm_data & 0xff) << 8);
+    } else
+        fatal("OR_IMM %x %x\n", uop->dest_reg_a_real, uop->src_reg_a_real);
+
+    return 0;
+}
+
+
+#    include "x86_ops_mmx_simd.h"
+
+#    define MMX_HELPER(name)                            \
+        static uint64_t                                 \
+        codegen_##name(uint64_t a, uint64_t b)          \
+        {                                               \
+            MMX_REG dst;                                \
+            MMX_REG src;                                \
+                                                        \
+            dst.q = a;                                  \
+            src.q = b;                                  \
+            name(&dst, &src);                           \
+            return dst.q;                               \
+        }
+MMX_HELPER(mmx_packsswb)
+MMX_HELPER(mmx_packssdw)
+MMX_HELPER(mmx_packuswb)
+MMX_HELPER(mmx_paddb)
+MMX_HELPER(mmx_paddw)
+MMX_HELPER(mmx_paddd)
+MMX_HELPER(mmx_paddsb)
+MMX_HELPER(mmx_paddsw)
+MMX_HELPER(mmx_paddusb)
+MMX_HELPER(mmx_paddusw)
+MMX_HELPER(mmx_pcmpeqb)
+MMX_HELPER(mmx_pcmpeqw)
+MMX_HELPER(mmx_pcmpeqd)
+MMX_HELPER(mmx_pcmpgtb)
+MMX_HELPER(mmx_pcmpgtw)
+MMX_HELPER(mmx_pcmpgtd)
+MMX_HELPER(mmx_pmaddwd)
+MMX_HELPER(mmx_pmulhw)
+MMX_HELPER(mmx_pmullw)
+MMX_HELPER(mmx_psubb)
+MMX_HELPER(mmx_psubw)
+MMX_HELPER(mmx_psubd)
+MMX_HELPER(mmx_psubsb)
+MMX_HELPER(mmx_psubsw)
+MMX_HELPER(mmx_psubusb)
+MMX_HELPER(mmx_psubusw)
+MMX_HELPER(mmx_punpckhbw)
+MMX_HELPER(mmx_punpckhwd)
+MMX_HELPER(mmx_punpcklbw)
+MMX_HELPER(mmx_punpcklwd)
+
+#    undef MMX_HELPER
+
+/*3DNow! helpers, matching the interpreter in x86_ops_3dnow.h*/
+static uint64_t
+codegen_mmx_pf2id(uint64_t a, UNUSED(uint64_t b))
+{
+    MMX_REG src;
+    MMX_REG dst;
+
+    src.q = a;
+    for (int c = 0; c < 2; c++) {
+        /*Saturate out of range values rather than leave them to the C
+          conversion, which is undefined for them. NaN gives 0x80000000*/
+        if (src.f[c] >= 2147483648.0f)
+            dst.sl[c] = 0x7fffffff;
+        else if (src.f[c] > -2147483648.0f)
+            dst.sl[c] = (int32_t) src.f[c];
+        else
+            dst.l[c] = 0x80000000;
+    }
+    return dst.q;
+}
+static uint64_t
+codegen_mmx_pi2fd(uint64_t a, UNUSED(uint64_t b))
+{
+    MMX_REG src;
+    MMX_REG dst;
+
+    src.q    = a;
+    dst.f[0] = (float) src.sl[0];
+    dst.f[1] = (float) src.sl[1];
+    return dst.q;
+}
+static uint64_t
+codegen_mmx_pfrcp(uint64_t a, UNUSED(uint64_t b))
+{
+    MMX_REG src;
+    MMX_REG dst;
+
+    src.q    = a;
+    dst.f[0] = 1.0f / src.f[0];
+    dst.f[1] = dst.f[0];
+    return dst.q;
+}
+static uint64_t
+codegen_mmx_pfrsqrt(uint64_t a, UNUSED(uint64_t b))
+{
+    MMX_REG src;
+    MMX_REG dst;
+
+    src.q    = a;
+    dst.f[0] = 1.0 / sqrt(src.f[0]);
+    dst.f[1] = dst.f[0];
+    return dst.q;
+}
+
+#    define PF_HELPER(name, op)                         \
+        static uint64_t                                 \
+        codegen_mmx_##name(uint64_t a, uint64_t b)      \
+        {                                               \
+            MMX_REG dst;                                \
+            MMX_REG src;                                \
+                                                        \
+            dst.q = a;                                  \
+            src.q = b;                                  \
+            for (int c = 0; c < 2; c++)                 \
+                op;                                     \
+            return dst.q;                               \
+        }
+
+PF_HELPER(pfadd, dst.f[c] += src.f[c])
+PF_HELPER(pfsub, dst.f[c] -= src.f[c])
+PF_HELPER(pfmul, dst.f[c] *= src.f[c])
+PF_HELPER(pfcmpeq, dst.l[c] = (dst.f[c] == src.f[c]) ? 0xffffffff : 0)
+PF_HELPER(pfcmpge, dst.l[c] = (dst.f[c] >= src.f[c]) ? 0xffffffff : 0)
+PF_HELPER(pfcmpgt, dst.l[c] = (dst.f[c] > src.f[c]) ? 0xffffffff : 0)
+PF_HELPER(pfmax, if (src.f[c] > dst.f[c]) dst.f[c] = src.f[c])
+PF_HELPER(pfmin, if (src.f[c] < dst.f[c]) dst.f[c] = src.f[c])
+
+#    undef PF_HELPER
+
+/*MMX shifts by an immediate count. Counts past the element width clear the
+  element, or fill it with the sign bit for arithmetic shifts*/
+static uint64_t
+codegen_mmx_psllw(uint64_t a, uint64_t shift)
+{
+    MMX_REG dst;
+
+    dst.q = a;
+    for (int c = 0; c < 4; c++)
+        dst.w[c] <<= shift;
+    return dst.q;
+}
+static uint64_t
+codegen_mmx_pslld(uint64_t a, uint64_t shift)
+{
+    MMX_REG dst;
+
+    dst.q = a;
+    for (int c = 0; c < 2; c++)
+        dst.l[c] <<= shift;
+    return dst.q;
+}
+static uint64_t
+codegen_mmx_psraw(uint64_t a, uint64_t shift)
+{
+    MMX_REG dst;
+
+    dst.q = a;
+    for (int c = 0; c < 4; c++)
+        dst.sw[c] >>= shift;
+    return dst.q;
+}
+static uint64_t
+codegen_mmx_psrad(uint64_t a, uint64_t shift)
+{
+    MMX_REG dst;
+
+    dst.q = a;
+    for (int c = 0; c < 2; c++)
+        dst.sl[c] >>= shift;
+    return dst.q;
+}
+static uint64_t
+codegen_mmx_psrlw(uint64_t a, uint64_t shift)
+{
+    MMX_REG dst;
+
+    dst.q = a;
+    for (int c = 0; c < 4; c++)
+        dst.w[c] >>= shift;
+    return dst.q;
+}
+static uint64_t
+codegen_mmx_psrld(uint64_t a, uint64_t shift)
+{
+    MMX_REG dst;
+
+    dst.q = a;
+    for (int c = 0; c < 2; c++)
+        dst.l[c] >>= shift;
+    return dst.q;
+}
+
+static int
+codegen_PACKSSWB(codeblock_t *block, uop_t *uop)
+{
+    int dest_reg   = HOST_REG_GET(uop->dest_reg_a_real);
+    int src_reg_b  = HOST_REG_GET(uop->src_reg_b_real);
+    int dest_size  = IREG_GET_SIZE(uop->dest_reg_a_real);
+    int src_size_b = IREG_GET_SIZE(uop->src_reg_b_real);
+
+    if (REG_IS_Q(dest_size) && REG_IS_Q(src_size_b) && uop->dest_reg_a_real == uop->src_reg_a_real) {
+        codegen_mmx_call(block, codegen_mmx_packsswb, dest_reg, dest_reg, src_reg_b);
+    } else
+        fatal("PACKSSWB %02x %02x %02x\n", uop->dest_reg_a_real, uop->src_reg_a_real, uop->src_reg_b_real);
+
+    return 0;
+}
+static int
+codegen_PACKSSDW(codeblock_t *block, uop_t *uop)
+{
+    int dest_reg   = HOST_REG_GET(uop->dest_reg_a_real);
+    int src_reg_b  = HOST_REG_GET(uop->src_reg_b_real);
+    int dest_size  = IREG_GET_SIZE(uop->dest_reg_a_real);
+    int src_size_b = IREG_GET_SIZE(uop->src_reg_b_real);
+
+    if (REG_IS_Q(dest_size) && REG_IS_Q(src_size_b) && uop->dest_reg_a_real == uop->src_reg_a_real) {
+        codegen_mmx_call(block, codegen_mmx_packssdw, dest_reg, dest_reg, src_reg_b);
+    } else
+        fatal("PACKSSDW %02x %02x %02x\n", uop->dest_reg_a_real, uop->src_reg_a_real, uop->src_reg_b_real);
+
+    return 0;
+}
+static int
+codegen_PACKUSWB(codeblock_t *block, uop_t *uop)
+{
+    int dest_reg   = HOST_REG_GET(uop->dest_reg_a_real);
+    int src_reg_b  = HOST_REG_GET(uop->src_reg_b_real);
+    int dest_size  = IREG_GET_SIZE(uop->dest_reg_a_real);
+    int src_size_b = IREG_GET_SIZE(uop->src_reg_b_real);
+
+    if (REG_IS_Q(dest_size) && REG_IS_Q(src_size_b) && uop->dest_reg_a_real == uop->src_reg_a_real) {
+        codegen_mmx_call(block, codegen_mmx_packuswb, dest_reg, dest_reg, src_reg_b);
+    } else
+        fatal("PACKUSWB %02x %02x %02x\n", uop->dest_reg_a_real, uop->src_reg_a_real, uop->src_reg_b_real);
+
+    return 0;
+}
+
+static int
+codegen_PADDB(codeblock_t *block, uop_t *uop)
+{
+    int dest_reg   = HOST_REG_GET(uop->dest_reg_a_real);
+    int src_reg_a  = HOST_REG_GET(uop->src_reg_a_real);
+    int src_reg_b  = HOST_REG_GET(uop->src_reg_b_real);
+    int dest_size  = IREG_GET_SIZE(uop->dest_reg_a_real);
+    int src_size_a = IREG_GET_SIZE(uop->src_reg_a_real);
+    int src_size_b = IREG_GET_SIZE(uop->src_reg_b_real);
+
+    if (REG_IS_Q(dest_size) && REG_IS_Q(src_size_a) && REG_IS_Q(src_size_b)) {
+        codegen_mmx_call(block, codegen_mmx_paddb, dest_reg, src_reg_a, src_reg_b);
+    } else
+        fatal("PADDB %02x %02x %02x\n", uop->dest_reg_a_real, uop->src_reg_a_real, uop->src_reg_b_real);
+
+    return 0;
+}
+static int
+codegen_PADDW(codeblock_t *block, uop_t *uop)
+{
+    int dest_reg   = HOST_REG_GET(uop->dest_reg_a_real);
+    int src_reg_a  = HOST_REG_GET(uop->src_reg_a_real);
+    int src_reg_b  = HOST_REG_GET(uop->src_reg_b_real);
+    int dest_size  = IREG_GET_SIZE(uop->dest_reg_a_real);
+    int src_size_a = IREG_GET_SIZE(uop->src_reg_a_real);
+    int src_size_b = IREG_GET_SIZE(uop->src_reg_b_real);
+
+    if (REG_IS_Q(dest_size) && REG_IS_Q(src_size_a) && REG_IS_Q(src_size_b)) {
+        codegen_mmx_call(block, codegen_mmx_paddw, dest_reg, src_reg_a, src_reg_b);
+    } else
+        fatal("PADDW %02x %02x %02x\n", uop->dest_reg_a_real, uop->src_reg_a_real, uop->src_reg_b_real);
+
+    return 0;
+}
+static int
+codegen_PADDD(codeblock_t *block, uop_t *uop)
+{
+    int dest_reg   = HOST_REG_GET(uop->dest_reg_a_real);
+    int src_reg_a  = HOST_REG_GET(uop->src_reg_a_real);
+    int src_reg_b  = HOST_REG_GET(uop->src_reg_b_real);
+    int dest_size  = IREG_GET_SIZE(uop->dest_reg_a_real);
+    int src_size_a = IREG_GET_SIZE(uop->src_reg_a_real);
+    int src_size_b = IREG_GET_SIZE(uop->src_reg_b_real);
+
+    if (REG_IS_Q(dest_size) && REG_IS_Q(src_size_a) && REG_IS_Q(src_size_b)) {
+        codegen_mmx_call(block, codegen_mmx_paddd, dest_reg, src_reg_a, src_reg_b);
+    } else
+        fatal("PADDD %02x %02x %02x\n", uop->dest_reg_a_real, uop->src_reg_a_real, uop->src_reg_b_real);
+
+    return 0;
+}
+static int
+codegen_PADDSB(codeblock_t *block, uop_t *uop)
+{
+    int dest_reg   = HOST_REG_GET(uop->dest_reg_a_real);
+    int src_reg_a  = HOST_REG_GET(uop->src_reg_a_real);
+    int src_reg_b  = HOST_REG_GET(uop->src_reg_b_real);
+    int dest_size  = IREG_GET_SIZE(uop->dest_reg_a_real);
+    int src_size_a = IREG_GET_SIZE(uop->src_reg_a_real);
+    int src_size_b = IREG_GET_SIZE(uop->src_reg_b_real);
+
+    if (REG_IS_Q(dest_size) && REG_IS_Q(src_size_a) && REG_IS_Q(src_size_b)) {
+        codegen_mmx_call(block, codegen_mmx_paddsb, dest_reg, src_reg_a, src_reg_b);
+    } else
+        fatal("PADDSB %02x %02x %02x\n", uop->dest_reg_a_real, uop->src_reg_a_real, uop->src_reg_b_real);
+
+    return 0;
+}
+static int
+codegen_PADDSW(codeblock_t *block, uop_t *uop)
+{
+    int dest_reg   = HOST_REG_GET(uop->dest_reg_a_real);
+    int src_reg_a  = HOST_REG_GET(uop->src_reg_a_real);
+    int src_reg_b  = HOST_REG_GET(uop->src_reg_b_real);
+    int dest_size  = IREG_GET_SIZE(uop->dest_reg_a_real);
+    int src_size_a = IREG_GET_SIZE(uop->src_reg_a_real);
+    int src_size_b = IREG_GET_SIZE(uop->src_reg_b_real);
+
+    if (REG_IS_Q(dest_size) && REG_IS_Q(src_size_a) && REG_IS_Q(src_size_b)) {
+        codegen_mmx_call(block, codegen_mmx_paddsw, dest_reg, src_reg_a, src_reg_b);
+    } else
+        fatal("PADDSW %02x %02x %02x\n", uop->dest_reg_a_real, uop->src_reg_a_real, uop->src_reg_b_real);
+
+    return 0;
+}
+static int
+codegen_PADDUSB(codeblock_t *block, uop_t *uop)
+{
+    int dest_reg   = HOST_REG_GET(uop->dest_reg_a_real);
+    int src_reg_a  = HOST_REG_GET(uop->src_reg_a_real);
+    int src_reg_b  = HOST_REG_GET(uop->src_reg_b_real);
+    int dest_size  = IREG_GET_SIZE(uop->dest_reg_a_real);
+    int src_size_a = IREG_GET_SIZE(uop->src_reg_a_real);
+    int src_size_b = IREG_GET_SIZE(uop->src_reg_b_real);
+
+    if (REG_IS_Q(dest_size) && REG_IS_Q(src_size_a) && REG_IS_Q(src_size_b)) {
+        codegen_mmx_call(block, codegen_mmx_paddusb, dest_reg, src_reg_a, src_reg_b);
+    } else
+        fatal("PADDUSB %02x %02x %02x\n", uop->dest_reg_a_real, uop->src_reg_a_real, uop->src_reg_b_real);
+
+    return 0;
+}
+static int
+codegen_PADDUSW(codeblock_t *block, uop_t *uop)
+{
+    int dest_reg   = HOST_REG_GET(uop->dest_reg_a_real);
+    int src_reg_a  = HOST_REG_GET(uop->src_reg_a_real);
+    int src_reg_b  = HOST_REG_GET(uop->src_reg_b_real);
+    int dest_size  = IREG_GET_SIZE(uop->dest_reg_a_real);
+    int src_size_a = IREG_GET_SIZE(uop->src_reg_a_real);
+    int src_size_b = IREG_GET_SIZE(uop->src_reg_b_real);
+
+    if (REG_IS_Q(dest_size) && REG_IS_Q(src_size_a) && REG_IS_Q(src_size_b)) {
+        codegen_mmx_call(block, codegen_mmx_paddusw, dest_reg, src_reg_a, src_reg_b);
+    } else
+        fatal("PADDUSW %02x %02x %02x\n", uop->dest_reg_a_real, uop->src_reg_a_real, uop->src_reg_b_real);
+
+    return 0;
+}
+
+static int
+codegen_PCMPEQB(codeblock_t *block, uop_t *uop)
+{
+    int dest_reg   = HOST_REG_GET(uop->dest_reg_a_real);
+    int src_reg_a  = HOST_REG_GET(uop->src_reg_a_real);
+    int src_reg_b  = HOST_REG_GET(uop->src_reg_b_real);
+    int dest_size  = IREG_GET_SIZE(uop->dest_reg_a_real);
+    int src_size_a = IREG_GET_SIZE(uop->src_reg_a_real);
+    int src_size_b = IREG_GET_SIZE(uop->src_reg_b_real);
+
+    if (REG_IS_Q(dest_size) && REG_IS_Q(src_size_a) && REG_IS_Q(src_size_b)) {
+        codegen_mmx_call(block, codegen_mmx_pcmpeqb, dest_reg, src_reg_a, src_reg_b);
+    } else
+        fatal("PCMPEQB %02x %02x %02x\n", uop->dest_reg_a_real, uop->src_reg_a_real, uop->src_reg_b_real);
+
+    return 0;
+}
+static int
+codegen_PCMPEQW(codeblock_t *block, uop_t *uop)
+{
+    int dest_reg   = HOST_REG_GET(uop->dest_reg_a_real);
+    int src_reg_a  = HOST_REG_GET(uop->src_reg_a_real);
+    int src_reg_b  = HOST_REG_GET(uop->src_reg_b_real);
+    int dest_size  = IREG_GET_SIZE(uop->dest_reg_a_real);
+    int src_size_a = IREG_GET_SIZE(uop->src_reg_a_real);
+    int src_size_b = IREG_GET_SIZE(uop->src_reg_b_real);
+
+    if (REG_IS_Q(dest_size) && REG_IS_Q(src_size_a) && REG_IS_Q(src_size_b)) {
+        codegen_mmx_call(block, codegen_mmx_pcmpeqw, dest_reg, src_reg_a, src_reg_b);
+    } else
+        fatal("PCMPEQW %02x %02x %02x\n", uop->dest_reg_a_real, uop->src_reg_a_real, uop->src_reg_b_real);
+
+    return 0;
+}
+static int
+codegen_PCMPEQD(codeblock_t *block, uop_t *uop)
+{
+    int dest_reg   = HOST_REG_GET(uop->dest_reg_a_real);
+    int src_reg_a  = HOST_REG_GET(uop->src_reg_a_real);
+    int src_reg_b  = HOST_REG_GET(uop->src_reg_b_real);
+    int dest_size  = IREG_GET_SIZE(uop->dest_reg_a_real);
+    int src_size_a = IREG_GET_SIZE(uop->src_reg_a_real);
+    int src_size_b = IREG_GET_SIZE(uop->src_reg_b_real);
+
+    if (REG_IS_Q(dest_size) && REG_IS_Q(src_size_a) && REG_IS_Q(src_size_b)) {
+        codegen_mmx_call(block, codegen_mmx_pcmpeqd, dest_reg, src_reg_a, src_reg_b);
+    } else
+        fatal("PCMPEQD %02x %02x %02x\n", uop->dest_reg_a_real, uop->src_reg_a_real, uop->src_reg_b_real);
+
+    return 0;
+}
+static int
+codegen_PCMPGTB(codeblock_t *block, uop_t *uop)
+{
+    int dest_reg   = HOST_REG_GET(uop->dest_reg_a_real);
+    int src_reg_a  = HOST_REG_GET(uop->src_reg_a_real);
+    int src_reg_b  = HOST_REG_GET(uop->src_reg_b_real);
+    int dest_size  = IREG_GET_SIZE(uop->dest_reg_a_real);
+    int src_size_a = IREG_GET_SIZE(uop->src_reg_a_real);
+    int src_size_b = IREG_GET_SIZE(uop->src_reg_b_real);
+
+    if (REG_IS_Q(dest_size) && REG_IS_Q(src_size_a) && REG_IS_Q(src_size_b)) {
+        codegen_mmx_call(block, codegen_mmx_pcmpgtb, dest_reg, src_reg_a, src_reg_b);
+    } else
+        fatal("PCMPGTB %02x %02x %02x\n", uop->dest_reg_a_real, uop->src_reg_a_real, uop->src_reg_b_real);
+
+    return 0;
+}
+static int
+codegen_PCMPGTW(codeblock_t *block, uop_t *uop)
+{
+    int dest_reg   = HOST_REG_GET(uop->dest_reg_a_real);
+    int src_reg_a  = HOST_REG_GET(uop->src_reg_a_real);
+    int src_reg_b  = HOST_REG_GET(uop->src_reg_b_real);
+    int dest_size  = IREG_GET_SIZE(uop->dest_reg_a_real);
+    int src_size_a = IREG_GET_SIZE(uop->src_reg_a_real);
+    int src_size_b = IREG_GET_SIZE(uop->src_reg_b_real);
+
+    if (REG_IS_Q(dest_size) && REG_IS_Q(src_size_a) && REG_IS_Q(src_size_b)) {
+        codegen_mmx_call(block, codegen_mmx_pcmpgtw, dest_reg, src_reg_a, src_reg_b);
+    } else
+        fatal("PCMPGTW %02x %02x %02x\n", uop->dest_reg_a_real, uop->src_reg_a_real, uop->src_reg_b_real);
+
+    return 0;
+}
+static int
+codegen_PCMPGTD(codeblock_t *block, uop_t *uop)
+{
+    int dest_reg   = HOST_REG_GET(uop->dest_reg_a_real);
+    int src_reg_a  = HOST_REG_GET(uop->src_reg_a_real);
+    int src_reg_b  = HOST_REG_GET(uop->src_reg_b_real);
+    int dest_size  = IREG_GET_SIZE(uop->dest_reg_a_real);
+    int src_size_a = IREG_GET_SIZE(uop->src_reg_a_real);
+    int src_size_b = IREG_GET_SIZE(uop->src_reg_b_real);
+
+    if (REG_IS_Q(dest_size) && REG_IS_Q(src_size_a) && REG_IS_Q(src_size_b)) {
+        codegen_mmx_call(block, codegen_mmx_pcmpgtd, dest_reg, src_reg_a, src_reg_b);
+    } else
+        fatal("PCMPGTD %02x %02x %02x\n", uop->dest_reg_a_real, uop->src_reg_a_real, uop->src_reg_b_real);
+
+    return 0;
+}
+
+static int
+codegen_PF2ID(codeblock_t *block, uop_t *uop)
+{
+    int dest_reg   = HOST_REG_GET(uop->dest_reg_a_real);
+    int src_reg_a  = HOST_REG_GET(uop->src_reg_a_real);
+    int dest_size  = IREG_GET_SIZE(uop->dest_reg_a_real);
+    int src_size_a = IREG_GET_SIZE(uop->src_reg_a_real);
+
+    if (REG_IS_Q(dest_size) && REG_IS_Q(src_size_a)) {
+        codegen_mmx_call(block, codegen_mmx_pf2id, dest_reg, src_reg_a, src_reg_a);
+    } else
+        fatal("PF2ID %02x\n", uop->dest_reg_a_real);
+
+    return 0;
+}
+static int
+codegen_PFADD(codeblock_t *block, uop_t *uop)
+{
+    int dest_reg   = HOST_REG_GET(uop->dest_reg_a_real);
+    int src_reg_a  = HOST_REG_GET(uop->src_reg_a_real);
+    int src_reg_b  = HOST_REG_GET(uop->src_reg_b_real);
+    int dest_size  = IREG_GET_SIZE(uop->dest_reg_a_real);
+    int src_size_a = IREG_GET_SIZE(uop->src_reg_a_real);
+    int src_size_b = IREG_GET_SIZE(uop->src_reg_b_real);
+
+    if (REG_IS_Q(dest_size) && REG_IS_Q(src_size_a) && REG_IS_Q(src_size_b)) {
+        codegen_mmx_call(block, codegen_mmx_pfadd, dest_reg, src_reg_a, src_reg_b);
+    } else
+        fatal("PFADD %02x %02x %02x\n", uop->dest_reg_a_real, uop->src_reg_a_real, uop->src_reg_b_real);
+
+    return 0;
+}
+static int
+codegen_PFCMPEQ(codeblock_t *block, uop_t *uop)
+{
+    int dest_reg   = HOST_REG_GET(uop->dest_reg_a_real);
+    int src_reg_a  = HOST_REG_GET(uop->src_reg_a_real);
+    int src_reg_b  = HOST_REG_GET(uop->src_reg_b_real);
+    int dest_size  = IREG_GET_SIZE(uop->dest_reg_a_real);
+    int src_size_a = IREG_GET_SIZE(uop->src_reg_a_real);
+    int src_size_b = IREG_GET_SIZE(uop->src_reg_b_real);
+
+    if (REG_IS_Q(dest_size) && REG_IS_Q(src_size_a) && REG_IS_Q(src_size_b)) {
+        codegen_mmx_call(block, codegen_mmx_pfcmpeq, dest_reg, src_reg_a, src_reg_b);
+    } else
+        fatal("PFCMPEQ %02x %02x %02x\n", uop->dest_reg_a_real, uop->src_reg_a_real, uop->src_reg_b_real);
+
+    return 0;
+}
+static int
+codegen_PFCMPGE(codeblock_t *block, uop_t *uop)
+{
+    int dest_reg   = HOST_REG_GET(uop->dest_reg_a_real);
+    int src_reg_a  = HOST_REG_GET(uop->src_reg_a_real);
+    int src_reg_b  = HOST_REG_GET(uop->src_reg_b_real);
+    int dest_size  = IREG_GET_SIZE(uop->dest_reg_a_real);
+    int src_size_a = IREG_GET_SIZE(uop->src_reg_a_real);
+    int src_size_b = IREG_GET_SIZE(uop->src_reg_b_real);
+
+    if (REG_IS_Q(dest_size) && REG_IS_Q(src_size_a) && REG_IS_Q(src_size_b)) {
+        codegen_mmx_call(block, codegen_mmx_pfcmpge, dest_reg, src_reg_a, src_reg_b);
+    } else
+        fatal("PFCMPGE %02x %02x %02x\n", uop->dest_reg_a_real, uop->src_reg_a_real, uop->src_reg_b_real);
+
+    return 0;
+}
+static int
+codegen_PFCMPGT(codeblock_t *block, uop_t *uop)
+{
+    int dest_reg   = HOST_REG_GET(uop->dest_reg_a_real);
+    int src_reg_a  = HOST_REG_GET(uop->src_reg_a_real);
+    int src_reg_b  = HOST_REG_GET(uop->src_reg_b_real);
+    int dest_size  = IREG_GET_SIZE(uop->dest_reg_a_real);
+    int src_size_a = IREG_GET_SIZE(uop->src_reg_a_real);
+    int src_size_b = IREG_GET_SIZE(uop->src_reg_b_real);
+
+    if (REG_IS_Q(dest_size) && REG_IS_Q(src_size_a) && REG_IS_Q(src_size_b)) {
+        codegen_mmx_call(block, codegen_mmx_pfcmpgt, dest_reg, src_reg_a, src_reg_b);
+    } else
+        fatal("PFCMPGT %02x %02x %02x\n", uop->dest_reg_a_real, uop->src_reg_a_real, uop->src_reg_b_real);
+
+    return 0;
+}
+static int
+codegen_PFMAX(codeblock_t *block, uop_t *uop)
+{
+    int dest_reg   = HOST_REG_GET(uop->dest_reg_a_real);
+    int src_reg_a  = HOST_REG_GET(uop->src_reg_a_real);
+    int src_reg_b  = HOST_REG_GET(uop->src_reg_b_real);
+    int dest_size  = IREG_GET_SIZE(uop->dest_reg_a_real);
+    int src_size_a = IREG_GET_SIZE(uop->src_reg_a_real);
+    int src_size_b = IREG_GET_SIZE(uop->src_reg_b_real);
+
+    if (REG_IS_Q(dest_size) && REG_IS_Q(src_size_a) && REG_IS_Q(src_size_b)) {
+        codegen_mmx_call(block, codegen_mmx_pfmax, dest_reg, src_reg_a, src_reg_b);
+    } else
+        fatal("PFMAX %02x %02x %02x\n", uop->dest_reg_a_real, uop->src_reg_a_real, uop->src_reg_b_real);
+
+    return 0;
+}
+static int
+codegen_PFMIN(codeblock_t *block, uop_t *uop)
+{
+    int dest_reg   = HOST_REG_GET(uop->dest_reg_a_real);
+    int src_reg_a  = HOST_REG_GET(uop->src_reg_a_real);
+    int src_reg_b  = HOST_REG_GET(uop->src_reg_b_real);
+    int dest_size  = IREG_GET_SIZE(uop->dest_reg_a_real);
+    int src_size_a = IREG_GET_SIZE(uop->src_reg_a_real);
+    int src_size_b = IREG_GET_SIZE(uop->src_reg_b_real);
+
+    if (REG_IS_Q(dest_size) && REG_IS_Q(src_size_a) && REG_IS_Q(src_size_b)) {
+        codegen_mmx_call(block, codegen_mmx_pfmin, dest_reg, src_reg_a, src_reg_b);
+    } else
+        fatal("PFMIN %02x %02x %02x\n", uop->dest_reg_a_real, uop->src_reg_a_real, uop->src_reg_b_real);
+
+    return 0;
+}
+static int
+codegen_PFMUL(codeblock_t *block, uop_t *uop)
+{
+    int dest_reg   = HOST_REG_GET(uop->dest_reg_a_real);
+    int src_reg_a  = HOST_REG_GET(uop->src_reg_a_real);
+    int src_reg_b  = HOST_REG_GET(uop->src_reg_b_real);
+    int dest_size  = IREG_GET_SIZE(uop->dest_reg_a_real);
+    int src_size_a = IREG_GET_SIZE(uop->src_reg_a_real);
+    int src_size_b = IREG_GET_SIZE(uop->src_reg_b_real);
+
+    if (REG_IS_Q(dest_size) && REG_IS_Q(src_size_a) && REG_IS_Q(src_size_b)) {
+        codegen_mmx_call(block, codegen_mmx_pfmul, dest_reg, src_reg_a, src_reg_b);
+    } else
+        fatal("PFMUL %02x %02x %02x\n", uop->dest_reg_a_real, uop->src_reg_a_real, uop->src_reg_b_real);
+
+    return 0;
+}
+static int
+codegen_PFRCP(codeblock_t *block, uop_t *uop)
+{
+    int dest_reg   = HOST_REG_GET(uop->dest_reg_a_real);
+    int src_reg_a  = HOST_REG_GET(uop->src_reg_a_real);
+    int dest_size  = IREG_GET_SIZE(uop->dest_reg_a_real);
+    int src_size_a = IREG_GET_SIZE(uop->src_reg_a_real);
+
+    if (REG_IS_Q(dest_size) && REG_IS_Q(src_size_a)) {
+        codegen_mmx_call(block, codegen_mmx_pfrcp, dest_reg, src_reg_a, src_reg_a);
+    } else
+        fatal("PFRCP %02x\n", uop->dest_reg_a_real);
+
+    return 0;
+}
+static int
+codegen_PFRSQRT(codeblock_t *block, uop_t *uop)
+{
+    int dest_reg   = HOST_REG_GET(uop->dest_reg_a_real);
+    int src_reg_a  = HOST_REG_GET(uop->src_reg_a_real);
+    int dest_size  = IREG_GET_SIZE(uop->dest_reg_a_real);
+    int src_size_a = IREG_GET_SIZE(uop->src_reg_a_real);
+
+    if (REG_IS_Q(dest_size) && REG_IS_Q(src_size_a)) {
+        codegen_mmx_call(block, codegen_mmx_pfrsqrt, dest_reg, src_reg_a, src_reg_a);
+    } else
+        fatal("PFRSQRT %02x\n", uop->dest_reg_a_real);
+
+    return 0;
+}
+static int
+codegen_PFSUB(codeblock_t *block, uop_t *uop)
+{
+    int dest_reg   = HOST_REG_GET(uop->dest_reg_a_real);
+    int src_reg_a  = HOST_REG_GET(uop->src_reg_a_real);
+    int src_reg_b  = HOST_REG_GET(uop->src_reg_b_real);
+    int dest_size  = IREG_GET_SIZE(uop->dest_reg_a_real);
+    int src_size_a = IREG_GET_SIZE(uop->src_reg_a_real);
+    int src_size_b = IREG_GET_SIZE(uop->src_reg_b_real);
+
+    if (REG_IS_Q(dest_size) && REG_IS_Q(src_size_a) && REG_IS_Q(src_size_b)) {
+        codegen_mmx_call(block, codegen_mmx_pfsub, dest_reg, src_reg_a, src_reg_b);
+    } else
+        fatal("PFSUB %02x %02x %02x\n", uop->dest_reg_a_real, uop->src_reg_a_real, uop->src_reg_b_real);
+
+    return 0;
+}
+static int
+codegen_PI2FD(codeblock_t *block, uop_t *uop)
+{
+    int dest_reg   = HOST_REG_GET(uop->dest_reg_a_real);
+    int src_reg_a  = HOST_REG_GET(uop->src_reg_a_real);
+    int dest_size  = IREG_GET_SIZE(uop->dest_reg_a_real);
+    int src_size_a = IREG_GET_SIZE(uop->src_reg_a_real);
+
+    if (REG_IS_Q(dest_size) && REG_IS_Q(src_size_a)) {
+        codegen_mmx_call(block, codegen_mmx_pi2fd, dest_reg, src_reg_a, src_reg_a);
+    } else
+        fatal("PI2FD %02x\n", uop->dest_reg_a_real);
+
+    return 0;
+}
+
+static int
+codegen_PMADDWD(codeblock_t *block, uop_t *uop)
+{
+    int dest_reg   = HOST_REG_GET(uop->dest_reg_a_real);
+    int src_reg_a  = HOST_REG_GET(uop->src_reg_a_real);
+    int src_reg_b  = HOST_REG_GET(uop->src_reg_b_real);
+    int dest_size  = IREG_GET_SIZE(uop->dest_reg_a_real);
+    int src_size_a = IREG_GET_SIZE(uop->src_reg_a_real);
+    int src_size_b = IREG_GET_SIZE(uop->src_reg_b_real);
+
+    if (REG_IS_Q(dest_size) && REG_IS_Q(src_size_a) && REG_IS_Q(src_size_b)) {
+        codegen_mmx_call(block, codegen_mmx_pmaddwd, dest_reg, src_reg_a, src_reg_b);
+    } else
+        fatal("PMADDWD %02x %02x %02x\n", uop->dest_reg_a_real, uop->src_reg_a_real, uop->src_reg_b_real);
+
+    return 0;
+}
+static int
+codegen_PMULHW(codeblock_t *block, uop_t *uop)
+{
+    int dest_reg   = HOST_REG_GET(uop->dest_reg_a_real);
+    int src_reg_a  = HOST_REG_GET(uop->src_reg_a_real);
+    int src_reg_b  = HOST_REG_GET(uop->src_reg_b_real);
+    int dest_size  = IREG_GET_SIZE(uop->dest_reg_a_real);
+    int src_size_a = IREG_GET_SIZE(uop->src_reg_a_real);
+    int src_size_b = IREG_GET_SIZE(uop->src_reg_b_real);
+
+    if (REG_IS_Q(dest_size) && REG_IS_Q(src_size_a) && REG_IS_Q(src_size_b)) {
+        codegen_mmx_call(block, codegen_mmx_pmulhw, dest_reg, src_reg_a, src_reg_b);
+    } else
+        fatal("PMULHW %02x %02x %02x\n", uop->dest_reg_a_real, uop->src_reg_a_real, uop->src_reg_b_real);
+
+    return 0;
+}
+static int
+codegen_PMULLW(codeblock_t *block, uop_t *uop)
+{
+    int dest_reg   = HOST_REG_GET(uop->dest_reg_a_real);
+    int src_reg_a  = HOST_REG_GET(uop->src_reg_a_real);
+    int src_reg_b  = HOST_REG_GET(uop->src_reg_b_real);
+    int dest_size  = IREG_GET_SIZE(uop->dest_reg_a_real);
+    int src_size_a = IREG_GET_SIZE(uop->src_reg_a_real);
+    int src_size_b = IREG_GET_SIZE(uop->src_reg_b_real);
+
+    if (REG_IS_Q(dest_size) && REG_IS_Q(src_size_a) && REG_IS_Q(src_size_b)) {
+        codegen_mmx_call(block, codegen_mmx_pmullw, dest_reg, src_reg_a, src_reg_b);
+    } else
+        fatal("PMULLW %02x %02x %02x\n", uop->dest_reg_a_real, uop->src_reg_a_real, uop->src_reg_b_real);
+
+    return 0;
+}
+
+static int
+codegen_PSLLW_IMM(codeblock_t *block, uop_t *uop)
+{
+    int dest_reg  = HOST_REG_GET(uop->dest_reg_a_real);
+    int src_reg   = HOST_REG_GET(uop->src_reg_a_real);
+    int dest_size = IREG_GET_SIZE(uop->dest_reg_a_real);
+    int src_size  = IREG_GET_SIZE(uop->src_reg_a_real);
+
+    if (REG_IS_Q(dest_size) && REG_IS_Q(src_size)) {
+        if (uop->imm_data == 0)
+            host_riscv64_FMV_D(block, dest_reg, src_reg);
+        else if (uop->imm_data > 15)
+            host_riscv64_FMV_D_X(block, dest_reg, REG_ZERO);
+        else
+            codegen_mmx_call_imm(block, codegen_mmx_psllw, dest_reg, src_reg, uop->imm_data);
+    } else
+        fatal("PSLLW_IMM %02x %02x\n", uop->dest_reg_a_real, uop->src_reg_a_real);
+
+    return 0;
+}
+static int
+codegen_PSLLD_IMM(codeblock_t *block, uop_t *uop)
+{
+    int dest_reg  = HOST_REG_GET(uop->dest_reg_a_real);
+    int src_reg   = HOST_REG_GET(uop->src_reg_a_real);
+    int dest_size = IREG_GET_SIZE(uop->dest_reg_a_real);
+    int src_size  = IREG_GET_SIZE(uop->src_reg_a_real);
+
+    if (REG_IS_Q(dest_size) && REG_IS_Q(src_size)) {
+        if (uop->imm_data == 0)
+            host_riscv64_FMV_D(block, dest_reg, src_reg);
+        else if (uop->imm_data > 31)
+            host_riscv64_FMV_D_X(block, dest_reg, REG_ZERO);
+        else
+            codegen_mmx_call_imm(block, codegen_mmx_pslld, dest_reg, src_reg, uop->imm_data);
+    } else
+        fatal("PSLLD_IMM %02x %02x\n", uop->dest_reg_a_real, uop->src_reg_a_real);
+
+    return 0;
+}
+static int
+codegen_PSLLQ_IMM(codeblock_t *block, uop_t *uop)
+{
+    int dest_reg  = HOST_REG_GET(uop->dest_reg_a_real);
+    int src_reg   = HOST_REG_GET(uop->src_reg_a_real);
+    int dest_size = IREG_GET_SIZE(uop->dest_reg_a_real);
+    int src_size  = IREG_GET_SIZE(uop->src_reg_a_real);
+
+    if (REG_IS_Q(dest_size) && REG_IS_Q(src_size)) {
+        if (uop->imm_data == 0)
+            host_riscv64_FMV_D(block, dest_reg, src_reg);
+        else if (uop->imm_data > 63)
+            host_riscv64_FMV_D_X(block, dest_reg, REG_ZERO);
+        else {
+            host_riscv64_FMV_X_D(block, REG_TEMP, src_reg);
+            host_riscv64_SLLI(block, REG_TEMP, REG_TEMP, uop->imm_data);
+            host_riscv64_FMV_D_X(block, dest_reg, REG_TEMP);
+        }
+    } else
+        fatal("PSLLQ_IMM %02x %02x\n", uop->dest_reg_a_real, uop->src_reg_a_real);
+
+    return 0;
+}
+static int
+codegen_PSRAW_IMM(codeblock_t *block, uop_t *uop)
+{
+    int dest_reg  = HOST_REG_GET(uop->dest_reg_a_real);
+    int src_reg   = HOST_REG_GET(uop->src_reg_a_real);
+    int dest_size = IREG_GET_SIZE(uop->dest_reg_a_real);
+    int src_size  = IREG_GET_SIZE(uop->src_reg_a_real);
+
+    if (REG_IS_Q(dest_size) && REG_IS_Q(src_size)) {
+        if (uop->imm_data == 0)
+            host_riscv64_FMV_D(block, dest_reg, src_reg);
+        else if (uop->imm_data > 15)
+            codegen_mmx_call_imm(block, codegen_mmx_psraw, dest_reg, src_reg, 15);
+        else
+            codegen_mmx_call_imm(block, codegen_mmx_psraw, dest_reg, src_reg, uop->imm_data);
+    } else
+        fatal("PSRAW_IMM %02x %02x\n", uop->dest_reg_a_real, uop->src_reg_a_real);
+
+    return 0;
+}
+static int
+codegen_PSRAD_IMM(codeblock_t *block, uop_t *uop)
+{
+    int dest_reg  = HOST_REG_GET(uop->dest_reg_a_real);
+    int src_reg   = HOST_REG_GET(uop->src_reg_a_real);
+    int dest_size = IREG_GET_SIZE(uop->dest_reg_a_real);
+    int src_size  = IREG_GET_SIZE(uop->src_reg_a_real);
+
+    if (REG_IS_Q(dest_size) && REG_IS_Q(src_size)) {
+        if (uop->imm_data == 0)
+            host_riscv64_FMV_D(block, dest_reg, src_reg);
+        else if (uop->imm_data > 31)
+            codegen_mmx_call_imm(block, codegen_mmx_psrad, dest_reg, src_reg, 31);
+        else
+            codegen_mmx_call_imm(block, codegen_mmx_psrad, dest_reg, src_reg, uop->imm_data);
+    } else
+        fatal("PSRAD_IMM %02x %02x\n", uop->dest_reg_a_real, uop->src_reg_a_real);
+
+    return 0;
+}
+static int
+codegen_PSRAQ_IMM(codeblock_t *block, uop_t *uop)
+{
+    int dest_reg  = HOST_REG_GET(uop->dest_reg_a_real);
+    int src_reg   = HOST_REG_GET(uop->src_reg_a_real);
+    int dest_size = IREG_GET_SIZE(uop->dest_reg_a_real);
+    int src_size  = IREG_GET_SIZE(uop->src_reg_a_real);
+
+    if (REG_IS_Q(dest_size) && REG_IS_Q(src_size)) {
+        if (uop->imm_data == 0)
+            host_riscv64_FMV_D(block, dest_reg, src_reg);
+        else if (uop->imm_data > 63)
+            {
+            host_riscv64_FMV_X_D(block, REG_TEMP, src_reg);
+            host_riscv64_SRAI(block, REG_TEMP, REG_TEMP, 63);
+            host_riscv64_FMV_D_X(block, dest_reg, REG_TEMP);
+        }
+        else {
+            host_riscv64_FMV_X_D(block, REG_TEMP, src_reg);
+            host_riscv64_SRAI(block, REG_TEMP, REG_TEMP, uop->imm_data);
+            host_riscv64_FMV_D_X(block, dest_reg, REG_TEMP);
+        }
+    } else
+        fatal("PSRAQ_IMM %02x %02x\n", uop->dest_reg_a_real, uop->src_reg_a_real);
+
+    return 0;
+}
+static int
+codegen_PSRLW_IMM(codeblock_t *block, uop_t *uop)
+{
+    int dest_reg  = HOST_REG_GET(uop->dest_reg_a_real);
+    int src_reg   = HOST_REG_GET(uop->src_reg_a_real);
+    int dest_size = IREG_GET_SIZE(uop->dest_reg_a_real);
+    int src_size  = IREG_GET_SIZE(uop->src_reg_a_real);
+
+    if (REG_IS_Q(dest_size) && REG_IS_Q(src_size)) {
+        if (uop->imm_data == 0)
+            host_riscv64_FMV_D(block, dest_reg, src_reg);
+        else if (uop->imm_data > 15)
+            host_riscv64_FMV_D_X(block, dest_reg, REG_ZERO);
+        else
+            codegen_mmx_call_imm(block, codegen_mmx_psrlw, dest_reg, src_reg, uop->imm_data);
+    } else
+        fatal("PSRLW_IMM %02x %02x\n", uop->dest_reg_a_real, uop->src_reg_a_real);
+
+    return 0;
+}
+static int
+codegen_PSRLD_IMM(codeblock_t *block, uop_t *uop)
+{
+    int dest_reg  = HOST_REG_GET(uop->dest_reg_a_real);
+    int src_reg   = HOST_REG_GET(uop->src_reg_a_real);
+    int dest_size = IREG_GET_SIZE(uop->dest_reg_a_real);
+    int src_size  = IREG_GET_SIZE(uop->src_reg_a_real);
+
+    if (REG_IS_Q(dest_size) && REG_IS_Q(src_size)) {
+        if (uop->imm_data == 0)
+            host_riscv64_FMV_D(block, dest_reg, src_reg);
+        else if (uop->imm_data > 31)
+            host_riscv64_FMV_D_X(block, dest_reg, REG_ZERO);
+        else
+            codegen_mmx_call_imm(block, codegen_mmx_psrld, dest_reg, src_reg, uop->imm_data);
+    } else
+        fatal("PSRLD_IMM %02x %02x\n", uop->dest_reg_a_real, uop->src_reg_a_real);
+
+    return 0;
+}
+static int
+codegen_PSRLQ_IMM(codeblock_t *block, uop_t *uop)
+{
+    int dest_reg  = HOST_REG_GET(uop->dest_reg_a_real);
+    int src_reg   = HOST_REG_GET(uop->src_reg_a_real);
+    int dest_size = IREG_GET_SIZE(uop->dest_reg_a_real);
+    int src_size  = IREG_GET_SIZE(uop->src_reg_a_real);
+
+    if (REG_IS_Q(dest_size) && REG_IS_Q(src_size)) {
+        if (uop->imm_data == 0)
+            host_riscv64_FMV_D(block, dest_reg, src_reg);
+        else if (uop->imm_data > 63)
+            host_riscv64_FMV_D_X(block, dest_reg, REG_ZERO);
+        else {
+            host_riscv64_FMV_X_D(block, REG_TEMP, src_reg);
+            host_riscv64_SRLI(block, REG_TEMP, REG_TEMP, uop->imm_data);
+            host_riscv64_FMV_D_X(block, dest_reg, REG_TEMP);
+        }
+    } else
+        fatal("PSRLQ_IMM %02x %02x\n", uop->dest_reg_a_real, uop->src_reg_a_real);
+
+    return 0;
+}
+
+static int
+codegen_PSUBB(codeblock_t *block, uop_t *uop)
+{
+    int dest_reg   = HOST_REG_GET(uop->dest_reg_a_real);
+    int src_reg_a  = HOST_REG_GET(uop->src_reg_a_real);
+    int src_reg_b  = HOST_REG_GET(uop->src_reg_b_real);
+    int dest_size  = IREG_GET_SIZE(uop->dest_reg_a_real);
+    int src_size_a = IREG_GET_SIZE(uop->src_reg_a_real);
+    int src_size_b = IREG_GET_SIZE(uop->src_reg_b_real);
+
+    if (REG_IS_Q(dest_size) && REG_IS_Q(src_size_a) && REG_IS_Q(src_size_b)) {
+        codegen_mmx_call(block, codegen_mmx_psubb, dest_reg, src_reg_a, src_reg_b);
+    } else
+        fatal("PSUBB %02x %02x %02x\n", uop->dest_reg_a_real, uop->src_reg_a_real, uop->src_reg_b_real);
+
+    return 0;
+}
+static int
+codegen_PSUBW(codeblock_t *block, uop_t *uop)
+{
+    int dest_reg   = HOST_REG_GET(uop->dest_reg_a_real);
+    int src_reg_a  = HOST_REG_GET(uop->src_reg_a_real);
+    int src_reg_b  = HOST_REG_GET(uop->src_reg_b_real);
+    int dest_size  = IREG_GET_SIZE(uop->dest_reg_a_real);
+    int src_size_a = IREG_GET_SIZE(uop->src_reg_a_real);
+    int src_size_b = IREG_GET_SIZE(uop->src_reg_b_real);
+
+    if (REG_IS_Q(dest_size) && REG_IS_Q(src_size_a) && REG_IS_Q(src_size_b)) {
+        codegen_mmx_call(block, codegen_mmx_psubw, dest_reg, src_reg_a, src_reg_b);
+    } else
+        fatal("PSUBW %02x %02x %02x\n", uop->dest_reg_a_real, uop->src_reg_a_real, uop->src_reg_b_real);
+
+    return 0;
+}
+static int
+codegen_PSUBD(codeblock_t *block, uop_t *uop)
+{
+    int dest_reg   = HOST_REG_GET(uop->dest_reg_a_real);
+    int src_reg_a  = HOST_REG_GET(uop->src_reg_a_real);
+    int src_reg_b  = HOST_REG_GET(uop->src_reg_b_real);
+    int dest_size  = IREG_GET_SIZE(uop->dest_reg_a_real);
+    int src_size_a = IREG_GET_SIZE(uop->src_reg_a_real);
+    int src_size_b = IREG_GET_SIZE(uop->src_reg_b_real);
+
+    if (REG_IS_Q(dest_size) && REG_IS_Q(src_size_a) && REG_IS_Q(src_size_b)) {
+        codegen_mmx_call(block, codegen_mmx_psubd, dest_reg, src_reg_a, src_reg_b);
+    } else
+        fatal("PSUBD %02x %02x %02x\n", uop->dest_reg_a_real, uop->src_reg_a_real, uop->src_reg_b_real);
+
+    return 0;
+}
+static int
+codegen_PSUBSB(codeblock_t *block, uop_t *uop)
+{
+    int dest_reg   = HOST_REG_GET(uop->dest_reg_a_real);
+    int src_reg_a  = HOST_REG_GET(uop->src_reg_a_real);
+    int src_reg_b  = HOST_REG_GET(uop->src_reg_b_real);
+    int dest_size  = IREG_GET_SIZE(uop->dest_reg_a_real);
+    int src_size_a = IREG_GET_SIZE(uop->src_reg_a_real);
+    int src_size_b = IREG_GET_SIZE(uop->src_reg_b_real);
+
+    if (REG_IS_Q(dest_size) && REG_IS_Q(src_size_a) && REG_IS_Q(src_size_b)) {
+        codegen_mmx_call(block, codegen_mmx_psubsb, dest_reg, src_reg_a, src_reg_b);
+    } else
+        fatal("PSUBSB %02x %02x %02x\n", uop->dest_reg_a_real, uop->src_reg_a_real, uop->src_reg_b_real);
+
+    return 0;
+}
+static int
+codegen_PSUBSW(codeblock_t *block, uop_t *uop)
+{
+    int dest_reg   = HOST_REG_GET(uop->dest_reg_a_real);
+    int src_reg_a  = HOST_REG_GET(uop->src_reg_a_real);
+    int src_reg_b  = HOST_REG_GET(uop->src_reg_b_real);
+    int dest_size  = IREG_GET_SIZE(uop->dest_reg_a_real);
+    int src_size_a = IREG_GET_SIZE(uop->src_reg_a_real);
+    int src_size_b = IREG_GET_SIZE(uop->src_reg_b_real);
+
+    if (REG_IS_Q(dest_size) && REG_IS_Q(src_size_a) && REG_IS_Q(src_size_b)) {
+        codegen_mmx_call(block, codegen_mmx_psubsw, dest_reg, src_reg_a, src_reg_b);
+    } else
+        fatal("PSUBSW %02x %02x %02x\n", uop->dest_reg_a_real, uop->src_reg_a_real, uop->src_reg_b_real);
+
+    return 0;
+}
+static int
+codegen_PSUBUSB(codeblock_t *block, uop_t *uop)
+{
+    int dest_reg   = HOST_REG_GET(uop->dest_reg_a_real);
+    int src_reg_a  = HOST_REG_GET(uop->src_reg_a_real);
+    int src_reg_b  = HOST_REG_GET(uop->src_reg_b_real);
+    int dest_size  = IREG_GET_SIZE(uop->dest_reg_a_real);
+    int src_size_a = IREG_GET_SIZE(uop->src_reg_a_real);
+    int src_size_b = IREG_GET_SIZE(uop->src_reg_b_real);
+
+    if (REG_IS_Q(dest_size) && REG_IS_Q(src_size_a) && REG_IS_Q(src_size_b)) {
+        codegen_mmx_call(block, codegen_mmx_psubusb, dest_reg, src_reg_a, src_reg_b);
+    } else
+        fatal("PSUBUSB %02x %02x %02x\n", uop->dest_reg_a_real, uop->src_reg_a_real, uop->src_reg_b_real);
+
+    return 0;
+}
+static int
+codegen_PSUBUSW(codeblock_t *block, uop_t *uop)
+{
+    int dest_reg   = HOST_REG_GET(uop->dest_reg_a_real);
+    int src_reg_a  = HOST_REG_GET(uop->src_reg_a_real);
+    int src_reg_b  = HOST_REG_GET(uop->src_reg_b_real);
+    int dest_size  = IREG_GET_SIZE(uop->dest_reg_a_real);
+    int src_size_a = IREG_GET_SIZE(uop->src_reg_a_real);
+    int src_size_b = IREG_GET_SIZE(uop->src_reg_b_real);
+
+    if (REG_IS_Q(dest_size) && REG_IS_Q(src_size_a) && REG_IS_Q(src_size_b)) {
+        codegen_mmx_call(block, codegen_mmx_psubusw, dest_reg, src_reg_a, src_reg_b);
+    } else
+        fatal("PSUBUSW %02x %02x %02x\n", uop->dest_reg_a_real, uop->src_reg_a_real, uop->src_reg_b_real);
+
+    return 0;
+}
+
+static int
+codegen_PUNPCKHBW(codeblock_t *block, uop_t *uop)
+{
+    int dest_reg   = HOST_REG_GET(uop->dest_reg_a_real);
+    int src_reg_a  = HOST_REG_GET(uop->src_reg_a_real);
+    int src_reg_b  = HOST_REG_GET(uop->src_reg_b_real);
+    int dest_size  = IREG_GET_SIZE(uop->dest_reg_a_real);
+    int src_size_a = IREG_GET_SIZE(uop->src_reg_a_real);
+    int src_size_b = IREG_GET_SIZE(uop->src_reg_b_real);
+
+    if (REG_IS_Q(dest_size) && REG_IS_Q(src_size_a) && REG_IS_Q(src_size_b)) {
+        codegen_mmx_call(block, codegen_mmx_punpckhbw, dest_reg, src_reg_a, src_reg_b);
+    } else
+        fatal("PUNPCKHBW %02x %02x %02x\n", uop->dest_reg_a_real, uop->src_reg_a_real, uop->src_reg_b_real);
+
+    return 0;
+}
+static int
+codegen_PUNPCKHWD(codeblock_t *block, uop_t *uop)
+{
+    int dest_reg   = HOST_REG_GET(uop->dest_reg_a_real);
+    int src_reg_a  = HOST_REG_GET(uop->src_reg_a_real);
+    int src_reg_b  = HOST_REG_GET(uop->src_reg_b_real);
+    int dest_size  = IREG_GET_SIZE(uop->dest_reg_a_real);
+    int src_size_a = IREG_GET_SIZE(uop->src_reg_a_real);
+    int src_size_b = IREG_GET_SIZE(uop->src_reg_b_real);
+
+    if (REG_IS_Q(dest_size) && REG_IS_Q(src_size_a) && REG_IS_Q(src_size_b)) {
+        codegen_mmx_call(block, codegen_mmx_punpckhwd, dest_reg, src_reg_a, src_reg_b);
+    } else
+        fatal("PUNPCKHWD %02x %02x %02x\n", uop->dest_reg_a_real, uop->src_reg_a_real, uop->src_reg_b_real);
+
+    return 0;
+}
+static int
+codegen_PUNPCKHDQ(codeblock_t *block, uop_t *uop)
+{
+    int dest_reg   = HOST_REG_GET(uop->dest_reg_a_real);
+    int src_reg_a  = HOST_REG_GET(uop->src_reg_a_real);
+    int src_reg_b  = HOST_REG_GET(uop->src_reg_b_real);
+    int dest_size  = IREG_GET_SIZE(uop->dest_reg_a_real);
+    int src_size_a = IREG_GET_SIZE(uop->src_reg_a_real);
+    int src_size_b = IREG_GET_SIZE(uop->src_reg_b_real);
+
+    if (REG_IS_Q(dest_size) && REG_IS_Q(src_size_a) && REG_IS_Q(src_size_b)) {
+        host_riscv64_FMV_X_D(block, REG_TEMP, src_reg_a);
+        host_riscv64_FMV_X_D(block, REG_TEMP2, src_reg_b);
+        host_riscv64_SRLI(block, REG_TEMP, REG_TEMP, 32);
+        host_riscv64_SRLI(block, REG_TEMP2, REG_TEMP2, 32);
+        host_riscv64_SLLI(block, REG_TEMP2, REG_TEMP2, 32);
+        host_riscv64_OR(block, REG_TEMP, REG_TEMP, REG_TEMP2);
+        host_riscv64_FMV_D_X(block, dest_reg, REG_TEMP);
+    } else
+        fatal("PUNPCKHDQ %02x %02x %02x\n", uop->dest_reg_a_real, uop->src_reg_a_real, uop->src_reg_b_real);
+
+    return 0;
+}
+static int
+codegen_PUNPCKLBW(codeblock_t *block, uop_t *uop)
+{
+    int dest_reg   = HOST_REG_GET(uop->dest_reg_a_real);
+    int src_reg_a  = HOST_REG_GET(uop->src_reg_a_real);
+    int src_reg_b  = HOST_REG_GET(uop->src_reg_b_real);
+    int dest_size  = IREG_GET_SIZE(uop->dest_reg_a_real);
+    int src_size_a = IREG_GET_SIZE(uop->src_reg_a_real);
+    int src_size_b = IREG_GET_SIZE(uop->src_reg_b_real);
+
+    if (REG_IS_Q(dest_size) && REG_IS_Q(src_size_a) && REG_IS_Q(src_size_b)) {
+        codegen_mmx_call(block, codegen_mmx_punpcklbw, dest_reg, src_reg_a, src_reg_b);
+    } else
+        fatal("PUNPCKLBW %02x %02x %02x\n", uop->dest_reg_a_real, uop->src_reg_a_real, uop->src_reg_b_real);
+
+    return 0;
+}
+static int
+codegen_PUNPCKLWD(codeblock_t *block, uop_t *uop)
+{
+    int dest_reg   = HOST_REG_GET(uop->dest_reg_a_real);
+    int src_reg_a  = HOST_REG_GET(uop->src_reg_a_real);
+    int src_reg_b  = HOST_REG_GET(uop->src_reg_b_real);
+    int dest_size  = IREG_GET_SIZE(uop->dest_reg_a_real);
+    int src_size_a = IREG_GET_SIZE(uop->src_reg_a_real);
+    int src_size_b = IREG_GET_SIZE(uop->src_reg_b_real);
+
+    if (REG_IS_Q(dest_size) && REG_IS_Q(src_size_a) && REG_IS_Q(src_size_b)) {
+        codegen_mmx_call(block, codegen_mmx_punpcklwd, dest_reg, src_reg_a, src_reg_b);
+    } else
+        fatal("PUNPCKLWD %02x %02x %02x\n", uop->dest_reg_a_real, uop->src_reg_a_real, uop->src_reg_b_real);
+
+    return 0;
+}
+static int
+codegen_PUNPCKLDQ(codeblock_t *block, uop_t *uop)
+{
+    int dest_reg   = HOST_REG_GET(uop->dest_reg_a_real);
+    int src_reg_a  = HOST_REG_GET(uop->src_reg_a_real);
+    int src_reg_b  = HOST_REG_GET(uop->src_reg_b_real);
+    int dest_size  = IREG_GET_SIZE(uop->dest_reg_a_real);
+    int src_size_a = IREG_GET_SIZE(uop->src_reg_a_real);
+    int src_size_b = IREG_GET_SIZE(uop->src_reg_b_real);
+
+    if (REG_IS_Q(dest_size) && REG_IS_Q(src_size_a) && REG_IS_Q(src_size_b)) {
+        host_riscv64_FMV_X_D(block, REG_TEMP, src_reg_a);
+        host_riscv64_FMV_X_D(block, REG_TEMP2, src_reg_b);
+        host_riscv64_ZEXT_W(block, REG_TEMP, REG_TEMP);
+        host_riscv64_SLLI(block, REG_TEMP2, REG_TEMP2, 32);
+        host_riscv64_OR(block, REG_TEMP, REG_TEMP, REG_TEMP2);
+        host_riscv64_FMV_D_X(block, dest_reg, REG_TEMP);
+    } else
+        fatal("PUNPCKLDQ %02x %02x %02x\n", uop->dest_reg_a_real, uop->src_reg_a_real, uop->src_reg_b_real);
+
+    return 0;
+}
+
+/*The base ISA has no rotates. 32-bit rotates are built from a pair of W
+  shifts, while 8 and 16-bit rotates shift a doubled copy of the operand*/
+static int
+codegen_ROL(codeblock_t *block, uop_t *uop)
+{
+    int dest_reg  = HOST_REG_GET(uop->dest_reg_a_real);
+    int src_reg   = HOST_REG_GET(uop->src_reg_a_real);
+    int shift_reg = HOST_REG_GET(uop->src_reg_b_real);
+    int dest_size = IREG_GET_SIZE(uop->dest_reg_a_real);
+    int src_size  = IREG_GET_SIZE(uop->src_reg_a_real);
+
+    if (REG_IS_L(dest_size) && REG_IS_L(src_size)) {
+        host_riscv64_SUBW(block, REG_TEMP2, REG_ZERO, shift_reg);
+        host_riscv64_SLLW(block, REG_TEMP, src_reg, shift_reg);
+        host_riscv64_SRLW(block, REG_TEMP2, src_reg, REG_TEMP2);
+        host_riscv64_OR(block, dest_reg, REG_TEMP, REG_TEMP2);
+    } else if (REG_IS_W(dest_size) && REG_IS_W(src_size)) {
+        host_riscv64_SUBW(block, REG_TEMP2, REG_ZERO, shift_reg);
+        host_riscv64_UBFX(block, REG_TEMP, src_reg, 0, 16);
+        host_riscv64_ANDI(block, REG_TEMP2, REG_TEMP2, 15);
+        host_riscv64_SLLI(block, REG_TEMP3, REG_TEMP, 16);
+        host_riscv64_OR(block, REG_TEMP, REG_TEMP, REG_TEMP3);
+        host_riscv64_SRL(block, REG_TEMP, REG_TEMP, REG_TEMP2);
+        host_riscv64_BFI(block, dest_reg, REG_TEMP, 0, 16);
+    } else if (REG_IS_B(dest_size) && REG_IS_B(src_size)) {
+        host_riscv64_SUBW(block, REG_TEMP2, REG_ZERO, shift_reg);
+        host_riscv64_ANDI(block, REG_TEMP, src_reg, 0xff);
+        host_riscv64_ANDI(block, REG_TEMP2, REG_TEMP2, 7);
+        host_riscv64_SLLI(block, REG_TEMP3, REG_TEMP, 8);
+        host_riscv64_OR(block, REG_TEMP, REG_TEMP, REG_TEMP3);
+        host_riscv64_SRL(block, REG_TEMP, REG_TEMP, REG_TEMP2);
+        host_riscv64_BFI(block, dest_reg, REG_TEMP, 0, 8);
+    } else if (REG_IS_BH(dest_size) && REG_IS_BH(src_size)) {
+        host_riscv64_SUBW(block, REG_TEMP2, REG_ZERO, shift_reg);
+        host_riscv64_UBFX(block, REG_TEMP, src_reg, 8, 8);
+        host_riscv64_ANDI(block, REG_TEMP2, REG_TEMP2, 7);
+        host_riscv64_SLLI(block, REG_TEMP3, REG_TEMP, 8);
+        host_riscv64_OR(block, REG_TEMP, REG_TEMP, REG_TEMP3);
+        host_riscv64_SRL(block, REG_TEMP, REG_TEMP, REG_TEMP2);
+        host_riscv64_BFI(block, dest_reg, REG_TEMP, 8, 8);
+    } else
+        fatal("ROL %02x %02x\n", uop->dest_reg_a_real, uop->src_reg_a_real);
+
+    return 0;
+}
+static int
+codegen_ROL_IMM(codeblock_t *block, uop_t *uop)
+{
+    int dest_reg  = HOST_REG_GET(uop->dest_reg_a_real);
+    int src_reg   = HOST_REG_GET(uop->src_reg_a_real);
+    int dest_size = IREG_GET_SIZE(uop->dest_reg_a_real);
+    int src_size  = IREG_GET_SIZE(uop->src_reg_a_real);
+
+    if (REG_IS_L(dest_size) && REG_IS_L(src_size)) {
+        if (!(uop->imm_data & 31)) {
+            host_riscv64_MV(block, dest_reg, src_reg);
+        } else {
+            host_riscv64_SLLIW(block, REG_TEMP, src_reg, uop->imm_data & 31);
+            host_riscv64_SRLIW(block, REG_TEMP2, src_reg, 32 - (uop->imm_data & 31));
+            host_riscv64_OR(block, dest_reg, REG_TEMP, REG_TEMP2);
+        }
+    } else if (REG_IS_W(dest_size) && REG_IS_W(src_size)) {
+        if ((uop->imm_data & 15) == 0) {
+            if (src_reg != dest_reg)
+                host_riscv64_BFI(block, dest_reg, src_reg, 0, 16);
+        } else {
+            host_riscv64_UBFX(block, REG_TEMP, src_reg, 0, 16);
+            host_riscv64_SLLI(block, REG_TEMP2, REG_TEMP, 16);
+            host_riscv64_OR(block, REG_TEMP, REG_TEMP, REG_TEMP2);
+            host_riscv64_SRLI(block, REG_TEMP, REG_TEMP, 16 - (uop->imm_data & 15));
+            host_riscv64_BFI(block, dest_reg, REG_TEMP, 0, 16);
+        }
+    } else if (REG_IS_B(dest_size) && REG_IS_B(src_size)) {
+        if ((uop->imm_data & 7) == 0) {
+            if (src_reg != dest_reg)
+                host_riscv64_BFI(block, dest_reg, src_reg, 0, 8);
+        } else {
+            host_riscv64_ANDI(block, REG_TEMP, src_reg, 0xff);
+            host_riscv64_SLLI(block, REG_TEMP2, REG_TEMP, 8);
+            host_riscv64_OR(block, REG_TEMP, REG_TEMP, REG_TEMP2);
+            host_riscv64_SRLI(block, REG_TEMP, REG_TEMP, 8 - (uop->imm_data & 7));
+            host_riscv64_BFI(block, dest_reg, REG_TEMP, 0, 8);
+        }
+    } else if (REG_IS_BH(dest_size) && REG_IS_BH(src_size)) {
+        if ((uop->imm_data & 7) == 0) {
+            if (src_reg != dest_reg)
+                fatal("ROL_IMM %02x %02x\n", uop->dest_reg_a_real, uop->src_reg_a_real);
+        } else {
+            host_riscv64_UBFX(block, REG_TEMP, src_reg, 8, 8);
+            host_riscv64_SLLI(block, REG_TEMP2, REG_TEMP, 8);
+            host_riscv64_OR(block, REG_TEMP, REG_TEMP, REG_TEMP2);
+            host_riscv64_SRLI(block, REG_TEMP, REG_TEMP, 8 - (uop->imm_data & 7));
+            host_riscv64_BFI(block, dest_reg, REG_TEMP, 8, 8);
+        }
+    } else
+        fatal("ROL_IMM %02x %02x\n", uop->dest_reg_a_real, uop->src_reg_a_real);
+
+    return 0;
+}
+static int
+codegen_ROR(codeblock_t *block, uop_t *uop)
+{
+    int dest_reg  = HOST_REG_GET(uop->dest_reg_a_real);
+    int src_reg   = HOST_REG_GET(uop->src_reg_a_real);
+    int shift_reg = HOST_REG_GET(uop->src_reg_b_real);
+    int dest_size = IREG_GET_SIZE(uop->dest_reg_a_real);
+    int src_size  = IREG_GET_SIZE(uop->src_reg_a_real);
+
+    if (REG_IS_L(dest_size) && REG_IS_L(src_size)) {
+        host_riscv64_SUBW(block, REG_TEMP2, REG_ZERO, shift_reg);
+        host_riscv64_SRLW(block, REG_TEMP, src_reg, shift_reg);
+        host_riscv64_SLLW(block, REG_TEMP2, src_reg, REG_TEMP2);
+        host_riscv64_OR(block, dest_reg, REG_TEMP, REG_TEMP2);
+    } else if (REG_IS_W(dest_size) && REG_IS_W(src_size)) {
+        host_riscv64_UBFX(block, REG_TEMP, src_reg, 0, 16);
+        host_riscv64_ANDI(block, REG_TEMP2, shift_reg, 15);
+        host_riscv64_SLLI(block, REG_TEMP3, REG_TEMP, 16);
+        host_riscv64_OR(block, REG_TEMP, REG_TEMP, REG_TEMP3);
+        host_riscv64_SRL(block, REG_TEMP, REG_TEMP, REG_TEMP2);
+        host_riscv64_BFI(block, dest_reg, REG_TEMP, 0, 16);
+    } else if (REG_IS_B(dest_size) && REG_IS_B(src_size)) {
+        host_riscv64_ANDI(block, REG_TEMP, src_reg, 0xff);
+        host_riscv64_ANDI(block, REG_TEMP2, shift_reg, 7);
+        host_riscv64_SLLI(block, REG_TEMP3, REG_TEMP, 8);
+        host_riscv64_OR(block, REG_TEMP, REG_TEMP, REG_TEMP3);
+        host_riscv64_SRL(block, REG_TEMP, REG_TEMP, REG_TEMP2);
+        host_riscv64_BFI(block, dest_reg, REG_TEMP, 0, 8);
+    } else if (REG_IS_BH(dest_size) && REG_IS_BH(src_size)) {
+        host_riscv64_UBFX(block, REG_TEMP, src_reg, 8, 8);
+        host_riscv64_ANDI(block, REG_TEMP2, shift_reg, 7);
+        host_riscv64_SLLI(block, REG_TEMP3, REG_TEMP, 8);
+        host_riscv64_OR(block, REG_TEMP, REG_TEMP, REG_TEMP3);
+        host_riscv64_SRL(block, REG_TEMP, REG_TEMP, REG_TEMP2);
+        host_riscv64_BFI(block, dest_reg, REG_TEMP, 8, 8);
+    } else
+        fatal("ROR %02x %02x\n", uop->dest_reg_a_real, uop->src_reg_a_real);
+
+    return 0;
+}
+static int
+codegen_ROR_IMM(codeblock_t *block, uop_t *uop)
+{
+    int dest_reg  = HOST_REG_GET(uop->dest_reg_a_real);
+    int src_reg   = HOST_REG_GET(uop->src_reg_a_real);
+    int dest_size = IREG_GET_SIZE(uop->dest_reg_a_real);
+    int src_size  = IREG_GET_SIZE(uop->src_reg_a_real);
+
+    if (REG_IS_L(dest_size) && REG_IS_L(src_size)) {
+        if (!(uop->imm_data & 31)) {
+            host_riscv64_MV(block, dest_reg, src_reg);
+        } else {
+            host_riscv64_SRLIW(block, REG_TEMP, src_reg, uop->imm_data & 31);
+            host_riscv64_SLLIW(block, REG_TEMP2, src_reg, 32 - (uop->imm_data & 31));
+            host_riscv64_OR(block, dest_reg, REG_TEMP, REG_TEMP2);
+        }
+    } else if (REG_IS_W(dest_size) && REG_IS_W(src_size)) {
+        if ((uop->imm_data & 15) == 0) {
+            if (src_reg != dest_reg)
+                fatal("ROR_IMM %02x %02x\n", uop->dest_reg_a_real, uop->src_reg_a_real);
+        } else {
+            host_riscv64_UBFX(block, REG_TEMP, src_reg, 0, 16);
+            host_riscv64_SLLI(block, REG_TEMP2, REG_TEMP, 16);
+            host_riscv64_OR(block, REG_TEMP, REG_TEMP, REG_TEMP2);
+            host_riscv64_SRLI(block, REG_TEMP, REG_TEMP, uop->imm_data & 15);
+            host_riscv64_BFI(block, dest_reg, REG_TEMP, 0, 16);
+        }
+    } else if (REG_IS_B(dest_size) && REG_IS_B(src_size)) {
+        if ((uop->imm_data & 7) == 0) {
+            if (src_reg != dest_reg)
+                fatal("ROR_IMM %02x %02x\n", uop->dest_reg_a_real, uop->src_reg_a_real);
+        } else {
+            host_riscv64_ANDI(block, REG_TEMP, src_reg, 0xff);
+            host_riscv64_SLLI(block, REG_TEMP2, REG_TEMP, 8);
+            host_riscv64_OR(block, REG_TEMP, REG_TEMP, REG_TEMP2);
+            host_riscv64_SRLI(block, REG_TEMP, REG_TEMP, uop->imm_data & 7);
+            host_riscv64_BFI(block, dest_reg, REG_TEMP, 0, 8);
+        }
+    } else if (REG_IS_BH(dest_size) && REG_IS_BH(src_size)) {
+        if ((uop->imm_data & 7) == 0) {
+            if (src_reg != dest_reg)
+                fatal("ROR_IMM %02x %02x\n", uop->dest_reg_a_real, uop->src_reg_a_real);
+        } else {
+            host_riscv64_UBFX(block, REG_TEMP, src_reg, 8, 8);
+            host_riscv64_SLLI(block, REG_TEMP2, REG_TEMP, 8);
+            host_riscv64_OR(block, REG_TEMP, REG_TEMP, REG_TEMP2);
+            host_riscv64_SRLI(block, REG_TEMP, REG_TEMP, uop->imm_data & 7);
+            host_riscv64_BFI(block, dest_reg, REG_TEMP, 8, 8);
+        }
+    } else
+        fatal("ROR_IMM %02x %02x\n", uop->dest_reg_a_real, uop->src_reg_a_real);
+
+    return 0;
+}
+
+static int
+codegen_SAR(codeblock_t *block, uop_t *uop)
+{
+    int dest_reg  = HOST_REG_GET(uop->dest_reg_a_real);
+    int src_reg   = HOST_REG_GET(uop->src_reg_a_real);
+    int shift_reg = HOST_REG_GET(uop->src_reg_b_real);
+    int dest_size = IREG_GET_SIZE(uop->dest_reg_a_real);
+    int src_size  = IREG_GET_SIZE(uop->src_reg_a_real);
+
+    if (REG_IS_L(dest_size) && REG_IS_L(src_size)) {
+        host_riscv64_SRAW(block, dest_reg, src_reg, shift_reg);
+    } else if (REG_IS_W(dest_size) && REG_IS_W(src_size)) {
+        host_riscv64_SBFX(block, REG_TEMP, src_reg, 0, 16);
+        host_riscv64_SRAW(block, REG_TEMP, REG_TEMP, shift_reg);
+        host_riscv64_BFI(block, dest_reg, REG_TEMP, 0, 16);
+    } else if (REG_IS_B(dest_size) && REG_IS_B(src_size)) {
+        host_riscv64_SBFX(block, REG_TEMP, src_reg, 0, 8);
+        host_riscv64_SRAW(block, REG_TEMP, REG_TEMP, shift_reg);
+        host_riscv64_BFI(block, dest_reg, REG_TEMP, 0, 8);
+    } else if (REG_IS_BH(dest_size) && REG_IS_BH(src_size)) {
+        host_riscv64_SBFX(block, REG_TEMP, src_reg, 8, 8);
+        host_riscv64_SRAW(block, REG_TEMP, REG_TEMP, shift_reg);
+        host_riscv64_BFI(block, dest_reg, REG_TEMP, 8, 8);
+    } else
+        fatal("SAR %02x %02x\n", uop->dest_reg_a_real, uop->src_reg_a_real);
+
+    return 0;
+}
+static int
+codegen_SAR_IMM(codeblock_t *block, uop_t *uop)
+{
+    int dest_reg  = HOST_REG_GET(uop->dest_reg_a_real);
+    int src_reg   = HOST_REG_GET(uop->src_reg_a_real);
+    int dest_size = IREG_GET_SIZE(uop->dest_reg_a_real);
+    int src_size  = IREG_GET_SIZE(uop->src_reg_a_real);
+
+    if (REG_IS_L(dest_size) && REG_IS_L(src_size)) {
+        host_riscv64_SRAIW(block, dest_reg, src_reg, uop->imm_data & 31);
+    } else if (REG_IS_W(dest_size) && REG_IS_W(src_size)) {
+        host_riscv64_SBFX(block, REG_TEMP, src_reg, 0, 16);
+        host_riscv64_SRAIW(block, REG_TEMP, REG_TEMP, uop->imm_data & 31);
+        host_riscv64_BFI(block, dest_reg, REG_TEMP, 0, 16);
+    } else if (REG_IS_B(dest_size) && REG_IS_B(src_size)) {
+        host_riscv64_SBFX(block, REG_TEMP, src_reg, 0, 8);
+        host_riscv64_SRAIW(block, REG_TEMP, REG_TEMP, uop->imm_data & 31);
+        host_riscv64_BFI(block, dest_reg, REG_TEMP, 0, 8);
+    } else if (REG_IS_BH(dest_size) && REG_IS_BH(src_size)) {
+        host_riscv64_SBFX(block, REG_TEMP, src_reg, 8, 8);
+        host_riscv64_SRAIW(block, REG_TEMP, REG_TEMP, uop->imm_data & 31);
+        host_riscv64_BFI(block, dest_reg, REG_TEMP, 8, 8);
+    } else
+        fatal("SAR_IMM %02x %02x\n", uop->dest_reg_a_real, uop->src_reg_a_real);
+
+    return 0;
+}
+static int
+codegen_SHL(codeblock_t *block, uop_t *uop)
+{
+    int dest_reg  = HOST_REG_GET(uop->dest_reg_a_real);
+    int src_reg   = HOST_REG_GET(uop->src_reg_a_real);
+    int shift_reg = HOST_REG_GET(uop->src_reg_b_real);
+    int dest_size = IREG_GET_SIZE(uop->dest_reg_a_real);
+    int src_size  = IREG_GET_SIZE(uop->src_reg_a_real);
+
+    if (REG_IS_L(dest_size) && REG_IS_L(src_size)) {
+        host_riscv64_SLLW(block, dest_reg, src_reg, shift_reg);
+    } else if (REG_IS_W(dest_size) && REG_IS_W(src_size)) {
+        host_riscv64_SLLW(block, REG_TEMP, src_reg, shift_reg);
+        host_riscv64_BFI(block, dest_reg, REG_TEMP, 0, 16);
+    } else if (REG_IS_B(dest_size) && REG_IS_B(src_size)) {
+        host_riscv64_SLLW(block, REG_TEMP, src_reg, shift_reg);
+        host_riscv64_BFI(block, dest_reg, REG_TEMP, 0, 8);
+    } else if (REG_IS_BH(dest_size) && REG_IS_BH(src_size)) {
+        host_riscv64_UBFX(block, REG_TEMP, src_reg, 8, 8);
+        host_riscv64_SLLW(block, REG_TEMP, REG_TEMP, shift_reg);
+        host_riscv64_BFI(block, dest_reg, REG_TEMP, 8, 8);
+    } else
+        fatal("SHL %02x %02x\n", uop->dest_reg_a_real, uop->src_reg_a_real);
+
+    return 0;
+}
+static int
+codegen_SHL_IMM(codeblock_t *block, uop_t *uop)
+{
+    int dest_reg  = HOST_REG_GET(uop->dest_reg_a_real);
+    int src_reg   = HOST_REG_GET(uop->src_reg_a_real);
+    int dest_size = IREG_GET_SIZE(uop->dest_reg_a_real);
+    int src_size  = IREG_GET_SIZE(uop->src_reg_a_real);
+
+    if (REG_IS_L(dest_size) && REG_IS_L(src_size)) {
+        host_riscv64_SLLIW(block, dest_reg, src_reg, uop->imm_data & 31);
+    } else if (REG_IS_W(dest_size) && REG_IS_W(src_size)) {
+        host_riscv64_SLLIW(block, REG_TEMP, src_reg, uop->imm_data & 31);
+        host_riscv64_BFI(block, dest_reg, REG_TEMP, 0, 16);
+    } else if (REG_IS_B(dest_size) && REG_IS_B(src_size)) {
+        host_riscv64_SLLIW(block, REG_TEMP, src_reg, uop->imm_data & 31);
+        host_riscv64_BFI(block, dest_reg, REG_TEMP, 0, 8);
+    } else if (REG_IS_BH(dest_size) && REG_IS_BH(src_size)) {
+        host_riscv64_UBFX(block, REG_TEMP, src_reg, 8, 8);
+        host_riscv64_SLLIW(block, REG_TEMP, REG_TEMP, uop->imm_data & 31);
+        host_riscv64_BFI(block, dest_reg, REG_TEMP, 8, 8);
+    } else
+        fatal("SHL_IMM %02x %02x\n", uop->dest_reg_a_real, uop->src_reg_a_real);
+
+    return 0;
+}
+static int
+codegen_SHR(codeblock_t *block, uop_t *uop)
+{
+    int dest_reg  = HOST_REG_GET(uop->dest_reg_a_real);
+    int src_reg   = HOST_REG_GET(uop->src_reg_a_real);
+    int shift_reg = HOST_REG_GET(uop->src_reg_b_real);
+    int dest_size = IREG_GET_SIZE(uop->dest_reg_a_real);
+    int src_size  = IREG_GET_SIZE(uop->src_reg_a_real);
+
+    if (REG_IS_L(dest_size) && REG_IS_L(src_size)) {
+        host_riscv64_SRLW(block, dest_reg, src_reg, shift_reg);
+    } else if (REG_IS_W(dest_size) && REG_IS_W(src_size)) {
+        host_riscv64_UBFX(block, REG_TEMP, src_reg, 0, 16);
+        host_riscv64_SRLW(block, REG_TEMP, REG_TEMP, shift_reg);
+        host_riscv64_BFI(block, dest_reg, REG_TEMP, 0, 16);
+    } else if (REG_IS_B(dest_size) && REG_IS_B(src_size)) {
+        host_riscv64_ANDI(block, REG_TEMP, src_reg, 0xff);
+        host_riscv64_SRLW(block, REG_TEMP, REG_TEMP, shift_reg);
+        host_riscv64_BFI(block, dest_reg, REG_TEMP, 0, 8);
+    } else if (REG_IS_BH(dest_size) && REG_IS_BH(src_size)) {
+        host_riscv64_UBFX(block, REG_TEMP, src_reg, 8, 8);
+        host_riscv64_SRLW(block, REG_TEMP, REG_TEMP, shift_reg);
+        host_riscv64_BFI(block, dest_reg, REG_TEMP, 8, 8);
+    } else
+        fatal("SHR %02x %02x\n", uop->dest_reg_a_real, uop->src_reg_a_real);
+
+    return 0;
+}
+static int
+codegen_SHR_IMM(codeblock_t *block, uop_t *uop)
+{
+    int dest_reg  = HOST_REG_GET(uop->dest_reg_a_real);
+    int src_reg   = HOST_REG_GET(uop->src_reg_a_real);
+    int dest_size = IREG_GET_SIZE(uop->dest_reg_a_real);
+    int src_size  = IREG_GET_SIZE(uop->src_reg_a_real);
+
+    if (REG_IS_L(dest_size) && REG_IS_L(src_size)) {
+        host_riscv64_SRLIW(block, dest_reg, src_reg, uop->imm_data & 31);
+    } else if (REG_IS_W(dest_size) && REG_IS_W(src_size)) {
+        host_riscv64_UBFX(block, REG_TEMP, src_reg, 0, 16);
+        host_riscv64_SRLIW(block, REG_TEMP, REG_TEMP, uop->imm_data & 31);
+        host_riscv64_BFI(block, dest_reg, REG_TEMP, 0, 16);
+    } else if (REG_IS_B(dest_size) && REG_IS_B(src_size)) {
+        host_riscv64_ANDI(block, REG_TEMP, src_reg, 0xff);
+        host_riscv64_SRLIW(block, REG_TEMP, REG_TEMP, uop->imm_data & 31);
+        host_riscv64_BFI(block, dest_reg, REG_TEMP, 0, 8);
+    } else if (REG_IS_BH(dest_size) && REG_IS_BH(src_size)) {
+        host_riscv64_UBFX(block, REG_TEMP, src_reg, 8, 8);
+        host_riscv64_SRLIW(block, REG_TEMP, REG_TEMP, uop->imm_data & 31);
+        host_riscv64_BFI(block, dest_reg, REG_TEMP, 8, 8);
+    } else
+        fatal("SHR_IMM %02x %02x\n", uop->dest_reg_a_real, uop->src_reg_a_real);
+
+    return 0;
+}
+
+static int
+codegen_STORE_PTR_IMM(codeblock_t *block, uop_t *uop)
+{
+    host_riscv64_mov_imm(block, REG_TEMP, uop->imm_data);
+
+    if (in_range12((uintptr_t) uop->p - (uintptr_t) &cpu_state))
+        host_riscv64_SW(block, REG_TEMP, REG_CPUSTATE, (uintptr_t) uop->p - (uintptr_t) &cpu_state);
+    else
+        fatal("codegen_STORE_PTR_IMM - not in range\n");
+
+    return 0;
+}
+static int
+codegen_STORE_PTR_IMM_8(codeblock_t *block, uop_t *uop)
+{
+    host_riscv64_mov_imm(block, REG_TEMP, uop->imm_data);
+
+    if (in_range12((uintptr_t) uop->p - (uintptr_t) &cpu_state))
+        host_riscv64_SB(block, REG_TEMP, REG_CPUSTATE, (uintptr_t) uop->p - (uintptr_t) &cpu_state);
+    else
+        fatal("codegen_STORE_PTR_IMM - not in range\n");
+
+    return 0;
+}
+
+static int
+codegen_SUB(codeblock_t *block, uop_t *uop)
+{
+    int dest_reg   = HOST_REG_GET(uop->dest_reg_a_real);
+    int src_reg_a  = HOST_REG_GET(uop->src_reg_a_real);
+    int src_reg_b  = HOST_REG_GET(uop->src_reg_b_real);
+    int dest_size  = IREG_GET_SIZE(uop->dest_reg_a_real);
+    int src_size_a = IREG_GET_SIZE(uop->src_reg_a_real);
+    int src_size_b = IREG_GET_SIZE(uop->src_reg_b_real);
+
+    if (REG_IS_L(dest_size) && REG_IS_L(src_size_a) && REG_IS_L(src_size_b)) {
+        host_riscv64_SUBW(block, dest_reg, src_reg_a, src_reg_b);
+    } else if (REG_IS_W(dest_size) && REG_IS_W(src_size_a) && REG_IS_W(src_size_b)) {
+        host_riscv64_SUB(block, REG_TEMP, src_reg_a, src_reg_b);
+        host_riscv64_BFI(block, dest_reg, REG_TEMP, 0, 16);
+    } else if (REG_IS_B(dest_size) && REG_IS_B(src_size_a) && REG_IS_B(src_size_b)) {
+        host_riscv64_SUB(block, REG_TEMP, src_reg_a, src_reg_b);
+        host_riscv64_BFI(block, dest_reg, REG_TEMP, 0, 8);
+    } else if (REG_IS_B(dest_size) && REG_IS_B(src_size_a) && REG_IS_BH(src_size_b)) {
+        host_riscv64_SRLI(block, REG_TEMP, src_reg_b, 8);
+        host_riscv64_SUB(block, REG_TEMP, src_reg_a, REG_TEMP);
+        host_riscv64_BFI(block, dest_reg, REG_TEMP, 0, 8);
+    } else if (REG_IS_B(dest_size) && REG_IS_BH(src_size_a) && REG_IS_B(src_size_b)) {
+        host_riscv64_SRLI(block, REG_TEMP, src_reg_a, 8);
+        host_riscv64_SUB(block, REG_TEMP, REG_TEMP, src_reg_b);
+        host_riscv64_BFI(block, dest_reg, REG_TEMP, 0, 8);
+    } else if (REG_IS_B(dest_size) && REG_IS_BH(src_size_a) && REG_IS_BH(src_size_b)) {
+        host_riscv64_SRLI(block, REG_TEMP, src_reg_a, 8);
+        host_riscv64_SRLI(block, REG_TEMP2, src_reg_b, 8);
+        host_riscv64_SUB(block, REG_TEMP, REG_TEMP, REG_TEMP2);
+        host_riscv64_BFI(block, dest_reg, REG_TEMP, 0, 8);
+    } else if (REG_IS_BH(dest_size) && REG_IS_BH(src_size_a) && REG_IS_B(src_size_b)) {
+        host_riscv64_SRLI(block, REG_TEMP, src_reg_a, 8);
+        host_riscv64_SUB(block, REG_TEMP, REG_TEMP, src_reg_b);
+        host_riscv64_BFI(block, dest_reg, REG_TEMP, 8, 8);
+    } else if (REG_IS_BH(dest_size) && REG_IS_BH(src_size_a) && REG_IS_BH(src_size_b)) {
+        host_riscv64_SRLI(block, REG_TEMP, src_reg_a, 8);
+        host_riscv64_SRLI(block, REG_TEMP2, src_reg_b, 8);
+        host_riscv64_SUB(block, REG_TEMP, REG_TEMP, REG_TEMP2);
+        host_riscv64_BFI(block, dest_reg, REG_TEMP, 8, 8);
+    } else
+        fatal("SUB %02x %02x %02x\n", uop->dest_reg_a_real, uop->src_reg_a_real, uop->src_reg_b_real);
+
+    return 0;
+}
+static int
+codegen_SUB_IMM(codeblock_t *block, uop_t *uop)
+{
+    int dest_reg  = HOST_REG_GET(uop->dest_reg_a_real);
+    int src_reg   = HOST_REG_GET(uop->src_reg_a_real);
+    int dest_size = IREG_GET_SIZE(uop->dest_reg_a_real);
+    int src_size  = IREG_GET_SIZE(uop->src_reg_a_real);
+
+    if (REG_IS_L(dest_size) && REG_IS_L(src_size)) {
+        host_riscv64_ADDW_IMM(block, dest_reg, src_reg, -uop->imm_data);
+    } else if (REG_IS_W(dest_size) && REG_IS_W(src_size)) {
+        host_riscv64_ADDW_IMM(block, REG_TEMP, src_reg, -uop->imm_data);
+        host_riscv64_BFI(block, dest_reg, REG_TEMP, 0, 16);
+    } else if (REG_IS_B(dest_size) && REG_IS_B(src_size)) {
+        host_riscv64_ADDW_IMM(block, REG_TEMP, src_reg, -uop->imm_data);
+        host_riscv64_BFI(block, dest_reg, REG_TEMP, 0, 8);
+    } else if (REG_IS_B(dest_size) && REG_IS_BH(src_size)) {
+        host_riscv64_SRLI(block, REG_TEMP, src_reg, 8);
+        host_riscv64_ADDW_IMM(block, REG_TEMP, REG_TEMP, -uop->imm_data);
+        host_riscv64_BFI(block, dest_reg, REG_TEMP, 0, 8);
+    } else if (REG_IS_BH(dest_size) && REG_IS_BH(src_size)) {
+        host_riscv64_SRLI(block, REG_TEMP, src_reg, 8);
+        host_riscv64_ADDW_IMM(block, REG_TEMP, REG_TEMP, -uop->imm_data);
+        host_riscv64_BFI(block, dest_reg, REG_TEMP, 8, 8);
+    } else
+        fatal("SUB_IMM %x %x\n", uop->dest_reg_a_real, uop->src_reg_a_real);
+
+    return 0;
+}
+
+static int
+codegen_TEST_JNS_DEST(codeblock_t *block, uop_t *uop)
+{
+    int src_reg  = HOST_REG_GET(uop->src_reg_a_real);
+    int src_size = IREG_GET_SIZE(uop->src_reg_a_real);
+
+    if (REG_IS_L(src_size)) {
+        uop->p = host_riscv64_BGE_(block, src_reg, REG_ZERO);
+    } else if (REG_IS_W(src_size)) {
+        host_riscv64_SLLI(block, REG_TEMP, src_reg, 48);
+        uop->p = host_riscv64_BGE_(block, REG_TEMP, REG_ZERO);
+    } else if (REG_IS_B(src_size)) {
+        host_riscv64_SLLI(block, REG_TEMP, src_reg, 56);
+        uop->p = host_riscv64_BGE_(block, REG_TEMP, REG_ZERO);
+    } else
+        fatal("TEST_JNS_DEST %02x\n", uop->src_reg_a_real);
+
+    return 0;
+}
+static int
+codegen_TEST_JS_DEST(codeblock_t *block, uop_t *uop)
+{
+    int src_reg  = HOST_REG_GET(uop->src_reg_a_real);
+    int src_size = IREG_GET_SIZE(uop->src_reg_a_real);
+
+    if (REG_IS_L(src_size)) {
+        uop->p = host_riscv64_BLT_(block, src_reg, REG_ZERO);
+    } else if (REG_IS_W(src_size)) {
+        host_riscv64_SLLI(block, REG_TEMP, src_reg, 48);
+        uop->p = host_riscv64_BLT_(block, REG_TEMP, REG_ZERO);
+    } else if (REG_IS_B(src_size)) {
+        host_riscv64_SLLI(block, REG_TEMP, src_reg, 56);
+        uop->p = host_riscv64_BLT_(block, REG_TEMP, REG_ZERO);
+    } else
+        fatal("TEST_JS_DEST %02x\n", uop->src_reg_a_real);
+
+    return 0;
+}
+
+static int
+codegen_XOR(codeblock_t *block, uop_t *uop)
+{
+    int dest_reg   = HOST_REG_GET(uop->dest_reg_a_real);
+    int src_reg_a  = HOST_REG_GET(uop->src_reg_a_real);
+    int src_reg_b  = HOST_REG_GET(uop->src_reg_b_real);
+    int dest_size  = IREG_GET_SIZE(uop->dest_reg_a_real);
+    int src_size_a = IREG_GET_SIZE(uop->src_reg_a_real);
+    int src_size_b = IREG_GET_SIZE(uop->src_reg_b_real);
+
+    if (REG_IS_Q(dest_size) && REG_IS_Q(src_size_a) && REG_IS_Q(src_size_b)) {
+        host_riscv64_FMV_X_D(block, REG_TEMP, src_reg_a);
+        host_riscv64_FMV_X_D(block, REG_TEMP2, src_reg_b);
+        host_riscv64_XOR(block, REG_TEMP, REG_TEMP, REG_TEMP2);
+        host_riscv64_FMV_D_X(block, dest_reg, REG_TEMP);
+    } else if (REG_IS_L(dest_size) && REG_IS_L(src_size_a) && REG_IS_L(src_size_b)) {
+        host_riscv64_XOR(block, dest_reg, src_reg_a, src_reg_b);
+    } else if (REG_IS_W(dest_size) && REG_IS_W(src_size_a) && REG_IS_W(src_size_b) && dest_reg == src_reg_a) {
+        host_riscv64_UBFX(block, REG_TEMP, src_reg_b, 0, 16);
+        host_riscv64_XOR(block, dest_reg, src_reg_a, REG_TEMP);
+    } else if (REG_IS_B(dest_size) && REG_IS_B(src_size_a) && REG_IS_B(src_size_b) && dest_reg == src_reg_a) {
+        host_riscv64_ANDI(block, REG_TEMP, src_reg_b, 0xff);
+        host_riscv64_XOR(block, dest_reg, src_reg_a, REG_TEMP);
+    } else if (REG_IS_B(dest_size) && REG_IS_B(src_size_a) && REG_IS_BH(src_size_b) && dest_reg == src_reg_a) {
+        host_riscv64_UBFX(block, REG_TEMP, src_reg_b, 8, 8);
+        host_riscv64_XOR(block, dest_reg, src_reg_a, REG_TEMP);
+    } else if (REG_IS_BH(dest_size) && REG_IS_BH(src_size_a) && REG_IS_B(src_size_b) && dest_reg == src_reg_a) {
+        host_riscv64_ANDI(block, REG_TEMP, src_reg_b, 0xff);
+        host_riscv64_SLLI(block, REG_TEMP, REG_TEMP, 8);
+        host_riscv64_XOR(block, dest_reg, src_reg_a, REG_TEMP);
+    } else if (REG_IS_BH(dest_size) && REG_IS_BH(src_size_a) && REG_IS_BH(src_size_b) && dest_reg == src_reg_a) {
+        host_riscv64_UBFX(block, REG_TEMP, src_reg_b, 8, 8);
+        host_riscv64_SLLI(block, REG_TEMP, REG_TEMP, 8);
+        host_riscv64_XOR(block, dest_reg, src_reg_a, REG_TEMP);
+    } else
+        fatal("XOR %02x %02x %02x\n", uop->dest_reg_a_real, uop->src_reg_a_real, uop->src_reg_b_real);
+
+    return 0;
+}
+static int
+codegen_XOR_IMM(codeblock_t *block, uop_t *uop)
+{
+    int dest_reg  = HOST_REG_GET(uop->dest_reg_a_real);
+    int src_reg   = HOST_REG_GET(uop->src_reg_a_real);
+    int dest_size = IREG_GET_SIZE(uop->dest_reg_a_real);
+    int src_size  = IREG_GET_SIZE(uop->src_reg_a_real);
+
+    if (REG_IS_L(dest_size) && REG_IS_L(src_size)) {
+        host_riscv64_XOR_IMM(block, dest_reg, src_reg, uop->imm_data);
+    } else if (REG_IS_W(dest_size) && REG_IS_W(src_size) && dest_reg == src_reg) {
+        host_riscv64_XOR_IMM(block, dest_reg, src_reg, uop->imm_data & 0xffff);
+    } else if (REG_IS_B(dest_size) && REG_IS_B(src_size) && dest_reg == src_reg) {
+        host_riscv64_XOR_IMM(block, dest_reg, src_reg, uop->imm_data & 0xff);
+    } else if (REG_IS_BH(dest_size) && REG_IS_BH(src_size) && dest_reg == src_reg) {
+        host_riscv64_XOR_IMM(block, dest_reg, src_reg, (uop->imm_data & 0xff) << 8);
+    } else
+        fatal("XOR_IMM %x %x\n", uop->dest_reg_a_real, uop->src_reg_a_real);
+
+    return 0;
+}
+
+const uOpFn uop_handlers[UOP_MAX] = {
+    [UOP_CALL_FUNC & UOP_MASK] = codegen_CALL_FUNC,
+    [UOP_CALL_FUNC_RESULT &
+        UOP_MASK]
+    = codegen_CALL_FUNC_RESULT,
+    [UOP_CALL_INSTRUCTION_FUNC &
+        UOP_MASK]
+    = codegen_CALL_INSTRUCTION_FUNC,
+
+    [UOP_JMP &
+        UOP_MASK]
+    = codegen_JMP,
+
+    [UOP_LOAD_SEG &
+        UOP_MASK]
+    = codegen_LOAD_SEG,
+
+    [UOP_LOAD_FUNC_ARG_0 &
+        UOP_MASK]
+    = codegen_LOAD_FUNC_ARG0,
+    [UOP_LOAD_FUNC_ARG_1 &
+        UOP_MASK]
+    = codegen_LOAD_FUNC_ARG1,
+    [UOP_LOAD_FUNC_ARG_2 &
+        UOP_MASK]
+    = codegen_LOAD_FUNC_ARG2,
+    [UOP_LOAD_FUNC_ARG_3 &
+        UOP_MASK]
+    = codegen_LOAD_FUNC_ARG3,
+
+    [UOP_LOAD_FUNC_ARG_0_IMM &
+        UOP_MASK]
+    = codegen_LOAD_FUNC_ARG0_IMM,
+    [UOP_LOAD_FUNC_ARG_1_IMM &
+        UOP_MASK]
+    = codegen_LOAD_FUNC_ARG1_IMM,
+    [UOP_LOAD_FUNC_ARG_2_IMM &
+        UOP_MASK]
+    = codegen_LOAD_FUNC_ARG2_IMM,
+    [UOP_LOAD_FUNC_ARG_3_IMM &
+        UOP_MASK]
+    = codegen_LOAD_FUNC_ARG3_IMM,
+
+    [UOP_STORE_P_IMM &
+        UOP_MASK]
+    = codegen_STORE_PTR_IMM,
+    [UOP_STORE_P_IMM_8 &
+        UOP_MASK]
+    = codegen_STORE_PTR_IMM_8,
+
+    [UOP_MEM_LOAD_ABS &
+        UOP_MASK]
+    = codegen_MEM_LOAD_ABS,
+    [UOP_MEM_LOAD_REG &
+        UOP_MASK]
+    = codegen_MEM_LOAD_REG,
+    [UOP_MEM_LOAD_SINGLE &
+        UOP_MASK]
+    = codegen_MEM_LOAD_SINGLE,
+    [UOP_MEM_LOAD_DOUBLE &
+        UOP_MASK]
+    = codegen_MEM_LOAD_DOUBLE,
+
+    [UOP_MEM_STORE_ABS &
+        UOP_MASK]
+    = codegen_MEM_STORE_ABS,
+    [UOP_MEM_STORE_REG &
+        UOP_MASK]
+    = codegen_MEM_STORE_REG,
+    [UOP_MEM_STORE_IMM_8 &
+        UOP_MASK]
+    = codegen_MEM_STORE_IMM_8,
+    [UOP_MEM_STORE_IMM_16 &
+        UOP_MASK]
+    = codegen_MEM_STORE_IMM_16,
+    [UOP_MEM_STORE_IMM_32 &
+        UOP_MASK]
+    = codegen_MEM_STORE_IMM_32,
+    [UOP_MEM_STORE_SINGLE &
+        UOP_MASK]
+    = codegen_MEM_STORE_SINGLE,
+    [UOP_MEM_STORE_DOUBLE &
+        UOP_MASK]
+    = codegen_MEM_STORE_DOUBLE,
+
+    [UOP_MOV &
+        UOP_MASK]
+    = codegen_MOV,
+    [UOP_MOV_PTR &
+        UOP_MASK]
+    = codegen_MOV_PTR,
+    [UOP_MOV_IMM &
+        UOP_MASK]
+    = codegen_MOV_IMM,
+    [UOP_MOVSX &
+        UOP_MASK]
+    = codegen_MOVSX,
+    [UOP_MOVZX &
+        UOP_MASK]
+    = codegen_MOVZX,
+    [UOP_MOV_DOUBLE_INT &
+        UOP_MASK]
+    = codegen_MOV_DOUBLE_INT,
+    [UOP_MOV_INT_DOUBLE &
+        UOP_MASK]
+    = codegen_MOV_INT_DOUBLE,
+    [UOP_MOV_INT_DOUBLE_64 &
+        UOP_MASK]
+    = codegen_MOV_INT_DOUBLE_64,
+    [UOP_MOV_REG_PTR &
+        UOP_MASK]
+    = codegen_MOV_REG_PTR,
+    [UOP_MOVZX_REG_PTR_8 &
+        UOP_MASK]
+    = codegen_MOVZX_REG_PTR_8,
+    [UOP_MOVZX_REG_PTR_16 &
+        UOP_MASK]
+    = codegen_MOVZX_REG_PTR_16,
+
+    [UOP_ADD &
+        UOP_MASK]
+    = codegen_ADD,
+    [UOP_ADD_IMM &
+        UOP_MASK]
+    = codegen_ADD_IMM,
+    [UOP_ADD_LSHIFT &
+        UOP_MASK]
+    = codegen_ADD_LSHIFT,
+    [UOP_AND &
+        UOP_MASK]
+    = codegen_AND,
+    [UOP_AND_IMM &
+        UOP_MASK]
+    = codegen_AND_IMM,
+    [UOP_ANDN &
+        UOP_MASK]
+    = codegen_ANDN,
+    [UOP_OR &
+        UOP_MASK]
+    = codegen_OR,
+    [UOP_OR_IMM &
+        UOP_MASK]
+    = codegen_OR_IMM,
+    [UOP_SUB &
+        UOP_MASK]
+    = codegen_SUB,
+    [UOP_SUB_IMM &
+        UOP_MASK]
+    = codegen_SUB_IMM,
+    [UOP_XOR &
+        UOP_MASK]
+    = codegen_XOR,
+    [UOP_XOR_IMM &
+        UOP_MASK]
+    = codegen_XOR_IMM,
+
+    [UOP_SAR &
+        UOP_MASK]
+    = codegen_SAR,
+    [UOP_SAR_IMM &
+        UOP_MASK]
+    = codegen_SAR_IMM,
+    [UOP_SHL &
+        UOP_MASK]
+    = codegen_SHL,
+    [UOP_SHL_IMM &
+        UOP_MASK]
+    = codegen_SHL_IMM,
+    [UOP_SHR &
+        UOP_MASK]
+    = codegen_SHR,
+    [UOP_SHR_IMM &
+        UOP_MASK]
+    = codegen_SHR_IMM,
+    [UOP_ROL &
+        UOP_MASK]
+    = codegen_ROL,
+    [UOP_ROL_IMM &
+        UOP_MASK]
+    = codegen_ROL_IMM,
+    [UOP_ROR &
+        UOP_MASK]
+    = codegen_ROR,
+    [UOP_ROR_IMM &
+        UOP_MASK]
+    = codegen_ROR_IMM,
+
+    [UOP_CMP_IMM_JZ &
+        UOP_MASK]
+    = codegen_CMP_IMM_JZ,
+
+    [UOP_CMP_JB &
+        UOP_MASK]
+    = codegen_CMP_JB,
+    [UOP_CMP_JNBE &
+        UOP_MASK]
+    = codegen_CMP_JNBE,
+
+    [UOP_CMP_JNB_DEST &
+        UOP_MASK]
+    = codegen_CMP_JNB_DEST,
+    [UOP_CMP_JNBE_DEST &
+        UOP_MASK]
+    = codegen_CMP_JNBE_DEST,
+    [UOP_CMP_JNL_DEST &
+        UOP_MASK]
+    = codegen_CMP_JNL_DEST,
+    [UOP_CMP_JNLE_DEST &
+        UOP_MASK]
+    = codegen_CMP_JNLE_DEST,
+    [UOP_CMP_JNO_DEST &
+        UOP_MASK]
+    = codegen_CMP_JNO_DEST,
+    [UOP_CMP_JNZ_DEST &
+        UOP_MASK]
+    = codegen_CMP_JNZ_DEST,
+    [UOP_CMP_JB_DEST &
+        UOP_MASK]
+    = codegen_CMP_JB_DEST,
+    [UOP_CMP_JBE_DEST &
+        UOP_MASK]
+    = codegen_CMP_JBE_DEST,
+    [UOP_CMP_JL_DEST &
+        UOP_MASK]
+    = codegen_CMP_JL_DEST,
+    [UOP_CMP_JLE_DEST &
+        UOP_MASK]
+    = codegen_CMP_JLE_DEST,
+    [UOP_CMP_JO_DEST &
+        UOP_MASK]
+    = codegen_CMP_JO_DEST,
+    [UOP_CMP_JZ_DEST &
+        UOP_MASK]
+    = codegen_CMP_JZ_DEST,
+
+    [UOP_CMP_IMM_JNZ_DEST &
+        UOP_MASK]
+    = codegen_CMP_IMM_JNZ_DEST,
+    [UOP_CMP_IMM_JZ_DEST &
+        UOP_MASK]
+    = codegen_CMP_IMM_JZ_DEST,
+
+    [UOP_TEST_JNS_DEST &
+        UOP_MASK]
+    = codegen_TEST_JNS_DEST,
+    [UOP_TEST_JS_DEST &
+        UOP_MASK]
+    = codegen_TEST_JS_DEST,
+
+    [UOP_FP_ENTER &
+        UOP_MASK]
+    = codegen_FP_ENTER,
+    [UOP_MMX_ENTER &
+        UOP_MASK]
+    = codegen_MMX_ENTER,
+
+    [UOP_FADD &
+        UOP_MASK]
+    = codegen_FADD,
+    [UOP_FCOM &
+        UOP_MASK]
+    = codegen_FCOM,
+    [UOP_FDIV &
+        UOP_MASK]
+    = codegen_FDIV,
+    [UOP_FMUL &
+        UOP_MASK]
+    = codegen_FMUL,
+    [UOP_FSUB &
+        UOP_MASK]
+    = codegen_FSUB,
+
+    [UOP_FABS &
+        UOP_MASK]
+    = codegen_FABS,
+    [UOP_FCHS &
+        UOP_MASK]
+    = codegen_FCHS,
+    [UOP_FSQRT &
+        UOP_MASK]
+    = codegen_FSQRT,
+    [UOP_FTST &
+        UOP_MASK]
+    = codegen_FTST,
+
+    [UOP_PACKSSWB &
+        UOP_MASK]
+    = codegen_PACKSSWB,
+    [UOP_PACKSSDW &
+        UOP_MASK]
+    = codegen_PACKSSDW,
+    [UOP_PACKUSWB &
+        UOP_MASK]
+    = codegen_PACKUSWB,
+
+    [UOP_PADDB &
+        UOP_MASK]
+    = codegen_PADDB,
+    [UOP_PADDW &
+        UOP_MASK]
+    = codegen_PADDW,
+    [UOP_PADDD &
+        UOP_MASK]
+    = codegen_PADDD,
+    [UOP_PADDSB &
+        UOP_MASK]
+    = codegen_PADDSB,
+    [UOP_PADDSW &
+        UOP_MASK]
+    = codegen_PADDSW,
+    [UOP_PADDUSB &
+        UOP_MASK]
+    = codegen_PADDUSB,
+    [UOP_PADDUSW &
+        UOP_MASK]
+    = codegen_PADDUSW,
+
+    [UOP_PCMPEQB &
+        UOP_MASK]
+    = codegen_PCMPEQB,
+    [UOP_PCMPEQW &
+        UOP_MASK]
+    = codegen_PCMPEQW,
+    [UOP_PCMPEQD &
+        UOP_MASK]
+    = codegen_PCMPEQD,
+    [UOP_PCMPGTB &
+        UOP_MASK]
+    = codegen_PCMPGTB,
+    [UOP_PCMPGTW &
+        UOP_MASK]
+    = codegen_PCMPGTW,
+    [UOP_PCMPGTD &
+        UOP_MASK]
+    = codegen_PCMPGTD,
+
+    [UOP_PF2ID &
+        UOP_MASK]
+    = codegen_PF2ID,
+    [UOP_PFADD &
+        UOP_MASK]
+    = codegen_PFADD,
+    [UOP_PFCMPEQ &
+        UOP_MASK]
+    = codegen_PFCMPEQ,
+    [UOP_PFCMPGE &
+        UOP_MASK]
+    = codegen_PFCMPGE,
+    [UOP_PFCMPGT &
+        UOP_MASK]
+    = codegen_PFCMPGT,
+    [UOP_PFMAX &
+        UOP_MASK]
+    = codegen_PFMAX,
+    [UOP_PFMIN &
+        UOP_MASK]
+    = codegen_PFMIN,
+    [UOP_PFMUL &
+        UOP_MASK]
+    = codegen_PFMUL,
+    [UOP_PFRCP &
+        UOP_MASK]
+    = codegen_PFRCP,
+    [UOP_PFRSQRT &
+        UOP_MASK]
+    = codegen_PFRSQRT,
+    [UOP_PFSUB &
+        UOP_MASK]
+    = codegen_PFSUB,
+    [UOP_PI2FD &
+        UOP_MASK]
+    = codegen_PI2FD,
+
+    [UOP_PMADDWD &
+        UOP_MASK]
+    = codegen_PMADDWD,
+    [UOP_PMULHW &
+        UOP_MASK]
+    = codegen_PMULHW,
+    [UOP_PMULLW &
+        UOP_MASK]
+    = codegen_PMULLW,
+
+    [UOP_PSLLW_IMM &
+        UOP_MASK]
+    = codegen_PSLLW_IMM,
+    [UOP_PSLLD_IMM &
+        UOP_MASK]
+    = codegen_PSLLD_IMM,
+    [UOP_PSLLQ_IMM &
+        UOP_MASK]
+    = codegen_PSLLQ_IMM,
+    [UOP_PSRAW_IMM &
+        UOP_MASK]
+    = codegen_PSRAW_IMM,
+    [UOP_PSRAD_IMM &
+        UOP_MASK]
+    = codegen_PSRAD_IMM,
+    [UOP_PSRAQ_IMM &
+        UOP_MASK]
+    = codegen_PSRAQ_IMM,
+    [UOP_PSRLW_IMM &
+        UOP_MASK]
+    = codegen_PSRLW_IMM,
+    [UOP_PSRLD_IMM &
+        UOP_MASK]
+    = codegen_PSRLD_IMM,
+    [UOP_PSRLQ_IMM &
+        UOP_MASK]
+    = codegen_PSRLQ_IMM,
+
+    [UOP_PSUBB &
+        UOP_MASK]
+    = codegen_PSUBB,
+    [UOP_PSUBW &
+        UOP_MASK]
+    = codegen_PSUBW,
+    [UOP_PSUBD &
+        UOP_MASK]
+    = codegen_PSUBD,
+    [UOP_PSUBSB &
+        UOP_MASK]
+    = codegen_PSUBSB,
+    [UOP_PSUBSW &
+        UOP_MASK]
+    = codegen_PSUBSW,
+    [UOP_PSUBUSB &
+        UOP_MASK]
+    = codegen_PSUBUSB,
+    [UOP_PSUBUSW &
+        UOP_MASK]
+    = codegen_PSUBUSW,
+
+    [UOP_PUNPCKHBW &
+        UOP_MASK]
+    = codegen_PUNPCKHBW,
+    [UOP_PUNPCKHWD &
+        UOP_MASK]
+    = codegen_PUNPCKHWD,
+    [UOP_PUNPCKHDQ &
+        UOP_MASK]
+    = codegen_PUNPCKHDQ,
+    [UOP_PUNPCKLBW &
+        UOP_MASK]
+    = codegen_PUNPCKLBW,
+    [UOP_PUNPCKLWD &
+        UOP_MASK]
+    = codegen_PUNPCKLWD,
+    [UOP_PUNPCKLDQ &
+        UOP_MASK]
+    = codegen_PUNPCKLDQ,
+
+    [UOP_NOP_BARRIER &
+        UOP_MASK]
+    = codegen_NOP
+};
+
+void
+codegen_direct_read_8(codeblock_t *block, int host_reg, void *p)
+{
+    if (in_range12((uintptr_t) p - (uintptr_t) &cpu_state))
+        host_riscv64_LBU(block, host_reg, REG_CPUSTATE, (uintptr_t) p - (uintptr_t) &cpu_state);
+    else {
+        host_riscv64_mov_imm64(block, REG_TEMP, (uint64_t) p);
+        host_riscv64_LBU(block, host_reg, REG_TEMP, 0);
+    }
+}
+void
+codegen_direct_read_16(codeblock_t *block, int host_reg, void *p)
+{
+    if (in_range12((uintptr_t) p - (uintptr_t) &cpu_state))
+        host_riscv64_LHU(block, host_reg, REG_CPUSTATE, (uintptr_t) p - (uintptr_t) &cpu_state);
+    else {
+        host_riscv64_mov_imm64(block, REG_TEMP, (uint64_t) p);
+        host_riscv64_LHU(block, host_reg, REG_TEMP, 0);
+    }
+}
+void
+codegen_direct_read_32(codeblock_t *block, int host_reg, void *p)
+{
+    if (in_range12((uintptr_t) p - (uintptr_t) &cpu_state))
+        host_riscv64_LW(block, host_reg, REG_CPUSTATE, (uintptr_t) p - (uintptr_t) &cpu_state);
+    else
+        fatal("codegen_direct_read_32 - not in range\n");
+}
+void
+codegen_direct_read_64(codeblock_t *block, int host_reg, void *p)
+{
+    if (in_range12((uintptr_t) p - (uintptr_t) &cpu_state))
+        host_riscv64_FLD(block, host_reg, REG_CPUSTATE, (uintptr_t) p - (uintptr_t) &cpu_state);
+    else {
+        host_riscv64_mov_imm64(block, REG_TEMP, (uint64_t) p);
+        host_riscv64_FLD(block, host_reg, REG_TEMP, 0);
+    }
+}
+void
+codegen_direct_read_pointer(codeblock_t *block, int host_reg, void *p)
+{
+    if (in_range12((uintptr_t) p - (uintptr_t) &cpu_state))
+        host_riscv64_LD(block, host_reg, REG_CPUSTATE, (uintptr_t) p - (uintptr_t) &cpu_state);
+    else
+        fatal("codegen_direct_read_pointer - not in range\n");
+}
+void
+codegen_direct_read_double(codeblock_t *block, int host_reg, void *p)
+{
+    if (in_range12((uintptr_t) p - (uintptr_t) &cpu_state))
+        host_riscv64_FLD(block, host_reg, REG_CPUSTATE, (uintptr_t) p - (uintptr_t) &cpu_state);
+    else
+        fatal("codegen_direct_read_double - not in range\n");
+}
+void
+codegen_direct_read_st_8(codeblock_t *block, int host_reg, void *base, int reg_idx)
+{
+    host_riscv64_LW(block, REG_TEMP, REG_XSP, IREG_TOP_diff_stack_offset);
+    host_riscv64_ADDI(block, REG_TEMP, REG_TEMP, reg_idx);
+    host_riscv64_ANDI(block, REG_TEMP, REG_TEMP, 7);
+    host_riscv64_ADD(block, REG_TEMP, REG_CPUSTATE, REG_TEMP);
+    host_riscv64_LBU(block, host_reg, REG_TEMP, (uintptr_t) base - (uintptr_t) &cpu_state);
+}
+void
+codegen_direct_read_st_64(codeblock_t *block, int host_reg, void *base, int reg_idx)
+{
+    host_riscv64_LW(block, REG_TEMP, REG_XSP, IREG_TOP_diff_stack_offset);
+    host_riscv64_ADDI(block, REG_TEMP, REG_TEMP, reg_idx);
+    host_riscv64_ANDI(block, REG_TEMP, REG_TEMP, 7);
+    host_riscv64_SLLI(block, REG_TEMP, REG_TEMP, 3);
+    host_riscv64_ADD(block, REG_TEMP, REG_CPUSTATE, REG_TEMP);
+    host_riscv64_FLD(block, host_reg, REG_TEMP, (uintptr_t) base - (uintptr_t) &cpu_state);
+}
+void
+codegen_direct_read_st_double(codeblock_t *block, int host_reg, void *base, int reg_idx)
+{
+    host_riscv64_LW(block, REG_TEMP, REG_XSP, IREG_TOP_diff_stack_offset);
+    host_riscv64_ADDI(block, REG_TEMP, REG_TEMP, reg_idx);
+    host_riscv64_ANDI(block, REG_TEMP, REG_TEMP, 7);
+    host_riscv64_SLLI(block, REG_TEMP, REG_TEMP, 3);
+    host_riscv64_ADD(block, REG_TEMP, REG_CPUSTATE, REG_TEMP);
+    host_riscv64_FLD(block, host_reg, REG_TEMP, (uintptr_t) base - (uintptr_t) &cpu_state);
+}
+
+void
+codegen_direct_write_8(codeblock_t *block, void *p, int host_reg)
+{
+    if (in_range12((uintptr_t) p - (uintptr_t) &cpu_state))
+        host_riscv64_SB(block, host_reg, REG_CPUSTATE, (uintptr_t) p - (uintptr_t) &cpu_state);
+    else {
+        host_riscv64_mov_imm64(block, REG_TEMP, (uint64_t) p);
+        host_riscv64_SB(block, host_reg, REG_TEMP, 0);
+    }
+}
+void
+codegen_direct_write_16(codeblock_t *block, void *p, int host_reg)
+{
+    if (in_range12((uintptr_t) p - (uintptr_t) &cpu_state))
+        host_riscv64_SH(block, host_reg, REG_CPUSTATE, (uintptr_t) p - (uintptr_t) &cpu_state);
+    else {
+        host_riscv64_mov_imm64(block, REG_TEMP, (uint64_t) p);
+        host_riscv64_SH(block, host_reg, REG_TEMP, 0);
+    }
+}
+void
+codegen_direct_write_32(codeblock_t *block, void *p, int host_reg)
+{
+    if (in_range12((uintptr_t) p - (uintptr_t) &cpu_state))
+        host_riscv64_SW(block, host_reg, REG_CPUSTATE, (uintptr_t) p - (uintptr_t) &cpu_state);
+    else
+        fatal("codegen_direct_write_32 - not in range\n");
+}
+void
+codegen_direct_write_64(codeblock_t *block, void *p, int host_reg)
+{
+    if (in_range12((uintptr_t) p - (uintptr_t) &cpu_state))
+        host_riscv64_FSD(block, host_reg, REG_CPUSTATE, (uintptr_t) p - (uintptr_t) &cpu_state);
+    else {
+        host_riscv64_mov_imm64(block, REG_TEMP, (uint64_t) p);
+        host_riscv64_FSD(block, host_reg, REG_TEMP, 0);
+    }
+}
+void
+codegen_direct_write_double(codeblock_t *block, void *p, int host_reg)
+{
+    if (in_range12((uintptr_t) p - (uintptr_t) &cpu_state))
+        host_riscv64_FSD(block, host_reg, REG_CPUSTATE, (uintptr_t) p - (uintptr_t) &cpu_state);
+    else
+        fatal("codegen_direct_write_double - not in range\n");
+}
+void
+codegen_direct_write_st_8(codeblock_t *block, void *base, int reg_idx, int host_reg)
+{
+    host_riscv64_LW(block, REG_TEMP, REG_XSP, IREG_TOP_diff_stack_offset);
+    host_riscv64_ADDI(block, REG_TEMP, REG_TEMP, reg_idx);
+    host_riscv64_ANDI(block, REG_TEMP, REG_TEMP, 7);
+    host_riscv64_ADD(block, REG_TEMP, REG_CPUSTATE, REG_TEMP);
+    host_riscv64_SB(block, host_reg, REG_TEMP, (uintptr_t) base - (uintptr_t) &cpu_state);
+}
+void
+codegen_direct_write_st_64(codeblock_t *block, void *base, int reg_idx, int host_reg)
+{
+    host_riscv64_LW(block, REG_TEMP, REG_XSP, IREG_TOP_diff_stack_offset);
+    host_riscv64_ADDI(block, REG_TEMP, REG_TEMP, reg_idx);
+    host_riscv64_ANDI(block, REG_TEMP, REG_TEMP, 7);
+    host_riscv64_SLLI(block, REG_TEMP, REG_TEMP, 3);
+    host_riscv64_ADD(block, REG_TEMP, REG_CPUSTATE, REG_TEMP);
+    host_riscv64_FSD(block, host_reg, REG_TEMP, (uintptr_t) base - (uintptr_t) &cpu_state);
+}
+void
+codegen_direct_write_st_double(codeblock_t *block, void *base, int reg_idx, int host_reg)
+{
+    host_riscv64_LW(block, REG_TEMP, REG_XSP, IREG_TOP_diff_stack_offset);
+    host_riscv64_ADDI(block, REG_TEMP, REG_TEMP, reg_idx);
+    host_riscv64_ANDI(block, REG_TEMP, REG_TEMP, 7);
+    host_riscv64_SLLI(block, REG_TEMP, REG_TEMP, 3);
+    host_riscv64_ADD(block, REG_TEMP, REG_CPUSTATE, REG_TEMP);
+    host_riscv64_FSD(block, host_reg, REG_TEMP, (uintptr_t) base - (uintptr_t) &cpu_state);
+}
+
+void
+codegen_direct_write_ptr(codeblock_t *block, void *p, int host_reg)
+{
+    if (in_range12((uintptr_t) p - (uintptr_t) &cpu_state))
+        host_riscv64_SD(block, host_reg, REG_CPUSTATE, (uintptr_t) p - (uintptr_t) &cpu_state);
+    else
+        fatal("codegen_direct_write_ptr - not in range\n");
+}
+
+void
+codegen_direct_read_16_stack(codeblock_t *block, int host_reg, int stack_offset)
+{
+    if (in_range12(stack_offset))
+        host_riscv64_LHU(block, host_reg, REG_XSP, stack_offset);
+    else
+        fatal("codegen_direct_read_32_stack - not in range\n");
+}
+void
+codegen_direct_read_32_stack(codeblock_t *block, int host_reg, int stack_offset)
+{
+    if (in_range12(stack_offset))
+        host_riscv64_LW(block, host_reg, REG_XSP, stack_offset);
+    else
+        fatal("codegen_direct_read_32_stack - not in range\n");
+}
+void
+codegen_direct_read_pointer_stack(codeblock_t *block, int host_reg, int stack_offset)
+{
+    if (in_range12(stack_offset))
+        host_riscv64_LD(block, host_reg, REG_XSP, stack_offset);
+    else
+        fatal("codegen_direct_read_pointer_stack - not in range\n");
+}
+void
+codegen_direct_read_64_stack(codeblock_t *block, int host_reg, int stack_offset)
+{
+    host_riscv64_FLD(block, host_reg, REG_XSP, stack_offset);
+}
+void
+codegen_direct_read_double_stack(codeblock_t *block, int host_reg, int stack_offset)
+{
+    host_riscv64_FLD(block, host_reg, REG_XSP, stack_offset);
+}
+
+void
+codegen_direct_write_32_stack(codeblock_t *block, int stack_offset, int host_reg)
+{
+    if (in_range12(stack_offset))
+        host_riscv64_SW(block, host_reg, REG_XSP, stack_offset);
+    else
+        fatal("codegen_direct_write_32_stack - not in range\n");
+}
+void
+codegen_direct_write_64_stack(codeblock_t *block, int stack_offset, int host_reg)
+{
+    host_riscv64_FSD(block, host_reg, REG_XSP, stack_offset);
+}
+void
+codegen_direct_write_double_stack(codeblock_t *block, int stack_offset, int host_reg)
+{
+    host_riscv64_FSD(block, host_reg, REG_XSP, stack_offset);
+}
+
+void
+codegen_set_jump_dest(codeblock_t *block, void *p)
+{
+    host_riscv64_branch_set_offset(p, &block_write_data[block_pos]);
+}
+#endif
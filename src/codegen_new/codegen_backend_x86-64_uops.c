@@ -1923,10 +1923,12 @@ codegen_PFRCP(codeblock_t *block, uop_t *uop)
     int src_size_a = IREG_GET_SIZE(uop->src_reg_a_real);
 
     if (REG_IS_Q(dest_size) && REG_IS_Q(src_size_a)) {
-        /*TODO: This could be improved (use RCPSS + iteration)*/
-        host_x86_MOV32_REG_IMM(block, REG_ECX, 1);
+        /*RCPSS + iteration is not bit exact with the interpreter, so stick with a
+          full divide. 1.0 is loaded with MOVD rather than CVTSI2SS, which avoids
+          the conversion latency and the false dependency on dest_reg*/
+        host_x86_MOV32_REG_IMM(block, REG_ECX, 0x3f800000);
         host_x86_MOVQ_XREG_XREG(block, REG_XMM_TEMP, src_reg_a);
-        host_x86_CVTSI2SS_XREG_REG(block, dest_reg, REG_ECX);
+        host_x86_MOVD_XREG_REG(block, dest_reg, REG_ECX);
         host_x86_DIVSS_XREG_XREG(block, dest_reg, REG_XMM_TEMP);
         host_x86_UNPCKLPS_XREG_XREG(block, dest_reg, dest_reg);
     }
@@ -1945,10 +1947,10 @@ codegen_PFRSQRT(codeblock_t *block, uop_t *uop)
     int src_size_a = IREG_GET_SIZE(uop->src_reg_a_real);
 
     if (REG_IS_Q(dest_size) && REG_IS_Q(src_size_a)) {
-        /*TODO: This could be improved (use RSQRTSS + iteration)*/
+        /*See PFRCP above*/
         host_x86_SQRTSS_XREG_XREG(block, REG_XMM_TEMP, src_reg_a);
-        host_x86_MOV32_REG_IMM(block, REG_ECX, 1);
-        host_x86_CVTSI2SS_XREG_REG(block, dest_reg, REG_ECX);
+        host_x86_MOV32_REG_IMM(block, REG_ECX, 0x3f800000);
+        host_x86_MOVD_XREG_REG(block, dest_reg, REG_ECX);
         host_x86_DIVSS_XREG_XREG(block, dest_reg, REG_XMM_TEMP);
         host_x86_UNPCKLPS_XREG_XREG(block, dest_reg, dest_reg);
     }
@@ -25,6 +25,11 @@
 #define CODEGEN_HOST_REGS    3
 #define CODEGEN_HOST_FP_REGS 6
 
+/*Number of uOPs to look ahead for register reads when choosing a host register
+  to spill. Backends with few host registers spill often and benefit from a
+  longer window*/
+#define CODEGEN_HOST_REG_LOOKAHEAD 32
+
 extern void *codegen_mem_load_byte;
 extern void *codegen_mem_load_word;
 extern void *codegen_mem_load_long;
@@ -6,6 +6,7 @@
 #include "cpu.h"
 #include <86box/mem.h>
 #include <86box/plat_unused.h>
+#include <minitrace/minitrace.h>
 
 #include "x86.h"
 #include "x86_flags.h"
@@ -21,6 +22,7 @@
 #include "codegen_accumulate.h"
 #include "codegen_allocator.h"
 #include "codegen_backend.h"
+#include "codegen_cache.h"
 #include "codegen_ir.h"
 #include "codegen_reg.h"
 
@@ -28,6 +30,7 @@ uint8_t *block_write_data = NULL;
 
 int      codegen_flat_ds;
 int      codegen_flat_ss;
+int      codegen_flat_es;
 int      mmx_ebx_ecx_loaded;
 int      codegen_flags_changed = 0;
 int      codegen_fpu_entered   = 0;
@@ -58,6 +61,7 @@ uint32_t instr_counts[256 * 256];
 #endif
 
 static uint16_t block_free_list;
+static int      evict_clock_hand = 0;
 static void     delete_block(codeblock_t *block);
 static void     delete_dirty_block(codeblock_t *block);
 
@@ -168,6 +172,7 @@ codegen_purge_purgable_list(void)
 
         if (page->code_present_mask & page->dirty_mask) {
             codegen_check_flush(page, page->dirty_mask, purgable_page_list_head << 12);
+            codegen_stats.pages_purged++;
 
             if (block_free_list)
                 return 1;
@@ -199,12 +204,13 @@ block_free_list_get(void)
             dirty_list_size--;
             block->flags &= ~CODEBLOCK_IN_DIRTY_LIST;
             delete_dirty_block(block);
+            codegen_stats.dirty_reused++;
             block_free_list = get_block_nr(block);
             break;
         }
         /*Free list is empty - free up a block*/
         if (!codegen_purge_purgable_list())
-            codegen_delete_random_block(0);
+            codegen_evict_block(0);
     }
 
     block           = &codeblock[block_free_list];
@@ -220,6 +226,8 @@ codegen_init(void)
     codegen_allocator_init();
 
     codegen_backend_init();
+    codegen_cache_init();
+    codegen_stats_reset();
     block_free_list = 0;
     for (uint32_t c = 0; c < BLOCK_SIZE; c++)
         block_free_list_add(&codeblock[c]);
@@ -230,11 +238,21 @@ codegen_init(void)
 #endif
 }
 
+void
+codegen_close(void)
+{
+    if (cpu_dynarec_stats)
+        codegen_stats_dump(16);
+
+    codegen_cache_close();
+}
+
 void
 codegen_reset(void)
 {
     int c;
 
+    MTR_BEGIN("codegen", "flush");
     for (c = 1; c < BLOCK_SIZE; c++) {
         codeblock_t *block = &codeblock[c];
 
@@ -247,6 +265,8 @@ codegen_reset(void)
 
     memset(codeblock, 0, BLOCK_SIZE * sizeof(codeblock_t));
     memset(codeblock_hash, 0, HASH_SIZE * sizeof(uint16_t));
+    memset(codeblock_lookup, 0, sizeof(codeblock_lookup));
+    memset(codegen_branch_profile, 0, sizeof(codegen_branch_profile));
     mem_reset_page_blocks();
 
     block_free_list = 0;
@@ -254,6 +274,7 @@ codegen_reset(void)
         codeblock[c].pc = BLOCK_PC_INVALID;
         block_free_list_add(&codeblock[c]);
     }
+    MTR_END("codegen", "flush");
 }
 
 void
@@ -376,6 +397,10 @@ invalidate_block(codeblock_t *block)
     if (block->pc == BLOCK_PC_INVALID)
         fatal("Invalidating deleted block\n");
 #endif
+    codegen_cache_remove(block);
+    codeblock_lookup_remove(block);
+    block->epoch++;
+    codegen_stats.blocks_invalidated++;
     remove_from_block_list(block, old_pc);
     block_dirty_list_add(block);
     if (block->head_mem_block)
@@ -396,6 +421,9 @@ delete_block(codeblock_t *block)
         fatal("Deleting deleted block\n");
 #endif
     block->pc = BLOCK_PC_INVALID;
+    block->epoch++;
+
+    codeblock_lookup_remove(block);
 
     codeblock_tree_delete(block);
     if (block->flags & CODEBLOCK_IN_DIRTY_LIST)
@@ -419,6 +447,9 @@ delete_dirty_block(codeblock_t *block)
         fatal("Deleting deleted block\n");
 #endif
     block->pc = BLOCK_PC_INVALID;
+    block->epoch++;
+
+    codeblock_lookup_remove(block);
 
     codeblock_tree_delete(block);
     block_free_list_add(block);
@@ -432,20 +463,53 @@ codegen_delete_block(codeblock_t *block)
 }
 
 void
-codegen_delete_random_block(int required_mem_block)
+codegen_evict_block(int required_mem_block)
 {
-    int block_nr = rand() & BLOCK_MASK;
+    /*Blocks that have been executed since the last pass get a second chance.
+      After two full sweeps every access bit has been cleared, so a victim is
+      always found unless no block is eligible at all*/
+    for (int c = 0; c < BLOCK_SIZE * 2; c++) {
+        codeblock_t *block;
+
+        evict_clock_hand = (evict_clock_hand + 1) & BLOCK_MASK;
+        if (!evict_clock_hand || evict_clock_hand == block_current)
+            continue;
+
+        block = &codeblock[evict_clock_hand];
+        if (block->pc == BLOCK_PC_INVALID || (required_mem_block && !block->head_mem_block))
+            continue;
+
+        if (block->flags & CODEBLOCK_ACCESSED) {
+            block->flags &= ~CODEBLOCK_ACCESSED;
+            continue;
+        }
 
-    while (1) {
-        if (block_nr && block_nr != block_current) {
-            codeblock_t *block = &codeblock[block_nr];
+        codegen_stats.blocks_evicted++;
+        delete_block(block);
+        return;
+    }
 
-            if (block->pc != BLOCK_PC_INVALID && (!required_mem_block || block->head_mem_block)) {
-                delete_block(block);
-                return;
-            }
+    fatal("codegen_evict_block: no block to evict\n");
+}
+
+/*Classify an invalidation of a block on this page. See CODEGEN_SMC_COARSE_THRESHOLD
+  in codegen.h*/
+static void
+codegen_smc_account(page_t *page, const codeblock_t *block)
+{
+    if (block->flags & CODEBLOCK_BYTE_MASK) {
+        codegen_stats.smc_byte++;
+        if (++page->smc_byte_count >= CODEGEN_SMC_BYTE_THRESHOLD) {
+            page->smc_byte_count = 0;
+            page->smc_cooldown   = CODEGEN_SMC_COOLDOWN;
+            codegen_stats.smc_cooldowns++;
+        }
+    } else {
+        codegen_stats.smc_coarse++;
+        if (page->smc_coarse_count < CODEGEN_SMC_COARSE_THRESHOLD) {
+            if (++page->smc_coarse_count == CODEGEN_SMC_COARSE_THRESHOLD)
+                codegen_stats.smc_byte_mask_pages++;
         }
-        block_nr = (block_nr + 1) & BLOCK_MASK;
     }
 }
 
@@ -460,6 +524,7 @@ codegen_check_flush(page_t *page, UNUSED(uint64_t mask), UNUSED(uint32_t phys_ad
         uint16_t     next_block = block->next;
 
         if (*block->dirty_mask & block->page_mask) {
+            codegen_smc_account(page, block);
             invalidate_block(block);
         }
 #ifndef RELEASE_BUILD
@@ -476,6 +541,7 @@ codegen_check_flush(page_t *page, UNUSED(uint64_t mask), UNUSED(uint32_t phys_ad
         uint16_t     next_block = block->next_2;
 
         if (*block->dirty_mask2 & block->page_mask2) {
+            codegen_smc_account(page, block);
             invalidate_block(block);
         }
 #ifndef RELEASE_BUILD
@@ -529,6 +595,10 @@ codegen_block_init(uint32_t phys_addr)
     block->page_mask = block->page_mask2 = 0;
     block->flags                         = CODEBLOCK_STATIC_TOP;
     block->status                        = cpu_cur_status;
+    block->epoch++;
+    block->exec_count = 0;
+    memset(block->chain_block, 0, sizeof(block->chain_block));
+    codegen_stats.blocks_marked++;
 
     recomp_page = block->phys & ~0xfff;
     codeblock_tree_add(block);
@@ -562,6 +632,9 @@ codegen_block_start_recompile(codeblock_t *block)
     block->data           = codeblock_allocator_get_ptr(block->head_mem_block);
 
     block->status = cpu_cur_status;
+    block->epoch++;
+    block->exec_count = 0;
+    memset(block->chain_block, 0, sizeof(block->chain_block));
 
     block->page_mask = block->page_mask2 = 0;
     block->ins                           = 0;
@@ -583,16 +656,18 @@ codegen_block_start_recompile(codeblock_t *block)
     codegen_flags_changed = 0;
     codegen_fpu_entered   = 0;
     codegen_mmx_entered   = 0;
+    codegen_trace_branch  = 0;
 
     codegen_fpu_loaded_iq[0] = codegen_fpu_loaded_iq[1] = codegen_fpu_loaded_iq[2] = codegen_fpu_loaded_iq[3] = codegen_fpu_loaded_iq[4] = codegen_fpu_loaded_iq[5] = codegen_fpu_loaded_iq[6] = codegen_fpu_loaded_iq[7] = 0;
 
     cpu_state.seg_ds.checked = cpu_state.seg_es.checked = cpu_state.seg_fs.checked = cpu_state.seg_gs.checked = (cr0 & 1) ? 0 : 1;
 
-    block->TOP = cpu_state.TOP & 7;
-    block->flags |= CODEBLOCK_WAS_RECOMPILED;
+    block->TOP = codegen_fpu_top();
+    block->flags = (block->flags & ~CODEBLOCK_BRANCH_EXIT) | CODEBLOCK_WAS_RECOMPILED;
 
     codegen_flat_ds = !(cpu_cur_status & CPU_STATUS_NOTFLATDS);
     codegen_flat_ss = !(cpu_cur_status & CPU_STATUS_NOTFLATSS);
+    codegen_flat_es = !(cpu_cur_status & CPU_STATUS_NOTFLATES);
 
     if (block->flags & CODEBLOCK_BYTE_MASK) {
         block->dirty_mask  = &page->byte_dirty_mask[(block->phys >> PAGE_BYTE_MASK_SHIFT) & PAGE_BYTE_MASK_OFFSET_MASK];
@@ -632,6 +707,7 @@ codegen_block_generate_end_mask_recompile(void)
 
     if ((*(block->dirty_mask) & block->page_mask) && !page_in_evict_list(p))
         page_add_to_evict_list(p);
+    mem_smc_protect(block->phys);
 
     block->phys_2 = -1;
     block->next_2 = block->prev_2 = BLOCK_INVALID;
@@ -651,6 +727,7 @@ codegen_block_generate_end_mask_recompile(void)
             }
             if (((*block->dirty_mask2) & block->page_mask2) && !page_in_evict_list(page_2))
                 page_add_to_evict_list(page_2);
+            mem_smc_protect(block->phys_2);
 
             if (!pages[block->phys_2 >> 12].block_2)
                 mem_flush_write_page(block->phys_2, codegen_endpc);
@@ -706,6 +783,7 @@ codegen_block_generate_end_mask_mark(void)
     p->code_present_mask |= block->page_mask;
     if ((p->dirty_mask & block->page_mask) && !page_in_evict_list(p))
         page_add_to_evict_list(p);
+    mem_smc_protect(block->phys);
 
     block->phys_2     = -1;
     block->page_mask2 = 0;
@@ -723,6 +801,7 @@ codegen_block_generate_end_mask_mark(void)
             page_2->code_present_mask |= block->page_mask2;
             if ((page_2->dirty_mask & block->page_mask2) && !page_in_evict_list(page_2))
                 page_add_to_evict_list(page_2);
+            mem_smc_protect(block->phys_2);
 
             if (!pages[block->phys_2 >> 12].block_2)
                 mem_flush_write_page(block->phys_2, codegen_endpc);
@@ -776,6 +855,23 @@ codegen_block_end_recompile(codeblock_t *block)
 
     codegen_accumulate_flush(ir_data);
     codegen_ir_compile(ir_data, block);
+
+    codegen_stats.blocks_recompiled++;
+    if (block->flags & CODEBLOCK_OPTIMISED)
+        codegen_stats.blocks_optimised++;
+
+    codegen_cache_add(block);
+}
+
+void
+codegen_block_promote(codeblock_t *block)
+{
+    if (block->head_mem_block)
+        codegen_allocator_free(block->head_mem_block);
+    block->head_mem_block = NULL;
+
+    block->flags = (block->flags & ~CODEBLOCK_WAS_RECOMPILED) | CODEBLOCK_OPTIMISED;
+    block->epoch++;
 }
 
 void
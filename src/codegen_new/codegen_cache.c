@@ -0,0 +1,302 @@
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#define HAVE_STDARG_H
+#include <86box/86box.h>
+#include "cpu.h"
+#include <86box/mem.h>
+#include <86box/nvr.h>
+
+#include "codegen.h"
+#include "codegen_cache.h"
+
+#define CODEGEN_CACHE_SIZE    0x10000
+#define CODEGEN_CACHE_MASK    (CODEGEN_CACHE_SIZE - 1)
+#define CODEGEN_CACHE_PROBE   8
+
+#define CODEGEN_CACHE_MAGIC   0x43445842 /*"BXDC"*/
+#define CODEGEN_CACHE_VERSION 1
+
+#define CODEGEN_CACHE_FILE    "dynarec_cache.bin"
+
+typedef struct codegen_cache_entry_t {
+    uint32_t phys;
+    uint32_t pc;
+    uint32_t _cs;
+    uint32_t hash;
+    uint64_t page_mask;
+    uint16_t status;
+    uint16_t valid;
+} codegen_cache_entry_t;
+
+typedef struct codegen_cache_header_t {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t entry_size;
+    uint32_t nr_entries;
+    uint64_t cpu_type;
+    uint32_t rspeed;
+    uint32_t softfloat;
+    char     family[64];
+} codegen_cache_header_t;
+
+static codegen_cache_entry_t *cache_entries = NULL;
+
+#ifdef ENABLE_CODEGEN_CACHE_LOG
+int codegen_cache_do_log = ENABLE_CODEGEN_CACHE_LOG;
+
+static void
+codegen_cache_log(const char *fmt, ...)
+{
+    va_list ap;
+
+    if (codegen_cache_do_log) {
+        va_start(ap, fmt);
+        pclog_ex(fmt, ap);
+        va_end(ap);
+    }
+}
+#else
+#    define codegen_cache_log(fmt, ...)
+#endif
+
+static inline int
+cache_slot(uint32_t phys, uint32_t _cs)
+{
+    uint32_t h = phys ^ (_cs * 0x9e3779b1);
+
+    return (h ^ (h >> 16)) & CODEGEN_CACHE_MASK;
+}
+
+/*FNV-1a over every 64 byte chunk of the page covered by the code mask*/
+static uint32_t
+cache_hash_code(const page_t *page, uint64_t page_mask)
+{
+    uint32_t hash = 0x811c9dc5;
+
+    for (int c = 0; c < 64; c++) {
+        if (page_mask & ((uint64_t) 1 << c)) {
+            const uint8_t *p = &page->mem[c << PAGE_MASK_SHIFT];
+
+            for (int d = 0; d < (1 << PAGE_MASK_SHIFT); d++) {
+                hash ^= p[d];
+                hash *= 0x01000193;
+            }
+        }
+    }
+
+    return hash;
+}
+
+static void
+cache_make_header(codegen_cache_header_t *header, uint32_t nr_entries)
+{
+    memset(header, 0, sizeof(codegen_cache_header_t));
+    header->magic      = CODEGEN_CACHE_MAGIC;
+    header->version    = CODEGEN_CACHE_VERSION;
+    header->entry_size = sizeof(codegen_cache_entry_t);
+    header->nr_entries = nr_entries;
+    header->cpu_type   = cpu_s->cpu_type;
+    header->rspeed     = cpu_s->rspeed;
+    header->softfloat  = fpu_softfloat;
+    strncpy(header->family, cpu_f->internal_name, sizeof(header->family) - 1);
+}
+
+static codegen_cache_entry_t *
+cache_find(uint32_t phys, uint32_t pc, uint32_t _cs, uint16_t status)
+{
+    int idx = cache_slot(phys, _cs);
+
+    for (int c = 0; c < CODEGEN_CACHE_PROBE; c++) {
+        codegen_cache_entry_t *entry = &cache_entries[(idx + c) & CODEGEN_CACHE_MASK];
+
+        if (entry->valid && (entry->phys == phys) && (entry->pc == pc) && (entry->_cs == _cs) &&
+            !((entry->status ^ status) & CPU_STATUS_FLAGS) &&
+            ((entry->status & status & CPU_STATUS_MASK) == (status & CPU_STATUS_MASK)))
+            return entry;
+    }
+
+    return NULL;
+}
+
+static void
+cache_insert(const codegen_cache_entry_t *new_entry)
+{
+    int                    idx    = cache_slot(new_entry->phys, new_entry->_cs);
+    codegen_cache_entry_t *victim = &cache_entries[idx];
+
+    for (int c = 0; c < CODEGEN_CACHE_PROBE; c++) {
+        codegen_cache_entry_t *entry = &cache_entries[(idx + c) & CODEGEN_CACHE_MASK];
+
+        if (!entry->valid || ((entry->phys == new_entry->phys) && (entry->pc == new_entry->pc) &&
+                              (entry->_cs == new_entry->_cs) && (entry->status == new_entry->status))) {
+            victim = entry;
+            break;
+        }
+    }
+
+    /*If all probe slots are taken, the entry at the home slot is replaced*/
+    *victim       = *new_entry;
+    victim->valid = 1;
+}
+
+static void
+cache_load(void)
+{
+    codegen_cache_header_t header;
+    codegen_cache_header_t expected;
+    codegen_cache_entry_t  entry;
+    FILE                  *fp = nvr_fopen(CODEGEN_CACHE_FILE, "rb");
+
+    if (fp == NULL)
+        return;
+
+    if (fread(&header, sizeof(header), 1, fp) != 1) {
+        fclose(fp);
+        return;
+    }
+
+    cache_make_header(&expected, header.nr_entries);
+    if (memcmp(&header, &expected, sizeof(header))) {
+        codegen_cache_log("CODEGEN: Translation cache does not match current CPU, discarding\n");
+        fclose(fp);
+        return;
+    }
+
+    for (uint32_t c = 0; c < header.nr_entries; c++) {
+        if (fread(&entry, sizeof(entry), 1, fp) != 1)
+            break;
+        cache_insert(&entry);
+    }
+
+    codegen_cache_log("CODEGEN: Loaded %u translation cache entries\n", header.nr_entries);
+    fclose(fp);
+}
+
+static void
+cache_save(void)
+{
+    codegen_cache_header_t header;
+    uint32_t               nr_entries = 0;
+    FILE                  *fp;
+
+    for (int c = 0; c < CODEGEN_CACHE_SIZE; c++) {
+        if (cache_entries[c].valid)
+            nr_entries++;
+    }
+
+    fp = nvr_fopen(CODEGEN_CACHE_FILE, "wb");
+    if (fp == NULL)
+        return;
+
+    cache_make_header(&header, nr_entries);
+    (void) fwrite(&header, sizeof(header), 1, fp);
+
+    for (int c = 0; c < CODEGEN_CACHE_SIZE; c++) {
+        if (cache_entries[c].valid)
+            (void) fwrite(&cache_entries[c], sizeof(codegen_cache_entry_t), 1, fp);
+    }
+
+    codegen_cache_log("CODEGEN: Saved %u translation cache entries\n", nr_entries);
+    fclose(fp);
+}
+
+void
+codegen_cache_init(void)
+{
+    if (!cpu_dynarec_cache)
+        return;
+
+    if (cache_entries == NULL)
+        cache_entries = calloc(CODEGEN_CACHE_SIZE, sizeof(codegen_cache_entry_t));
+    else
+        memset(cache_entries, 0, CODEGEN_CACHE_SIZE * sizeof(codegen_cache_entry_t));
+
+    cache_load();
+}
+
+void
+codegen_cache_close(void)
+{
+    if (cache_entries == NULL)
+        return;
+
+    cache_save();
+
+    free(cache_entries);
+    cache_entries = NULL;
+}
+
+void
+codegen_cache_add(codeblock_t *block)
+{
+    codegen_cache_entry_t entry;
+    const page_t         *page;
+
+    if (cache_entries == NULL)
+        return;
+
+    /*Only plain single page blocks are recorded. Blocks using byte masks or
+      without inlined immediates have already been hit by self-modifying code,
+      and are not worth keeping across runs*/
+    if (block->flags & (CODEBLOCK_BYTE_MASK | CODEBLOCK_NO_IMMEDIATES | CODEBLOCK_HAS_PAGE2))
+        return;
+
+    page = &pages[block->phys >> 12];
+    if ((page->mem == NULL) || (page->mem == page_ff) || !block->page_mask)
+        return;
+
+    memset(&entry, 0, sizeof(entry));
+    entry.phys      = block->phys;
+    entry.pc        = block->pc;
+    entry._cs       = block->_cs;
+    entry.status    = block->status;
+    entry.page_mask = block->page_mask;
+    entry.hash      = cache_hash_code(page, block->page_mask);
+
+    cache_insert(&entry);
+}
+
+void
+codegen_cache_remove(codeblock_t *block)
+{
+    codegen_cache_entry_t *entry;
+
+    if (cache_entries == NULL)
+        return;
+
+    entry = cache_find(block->phys, block->pc, block->_cs, block->status);
+    if (entry)
+        entry->valid = 0;
+}
+
+int
+codegen_cache_lookup(uint32_t phys_addr)
+{
+    codegen_cache_entry_t *entry;
+    const page_t          *page;
+
+    if (cache_entries == NULL)
+        return 0;
+
+    entry = cache_find(phys_addr, cs + cpu_state.pc, cs, cpu_cur_status);
+    if (entry == NULL)
+        return 0;
+
+    page = &pages[phys_addr >> 12];
+    if ((page->mem == NULL) || (page->mem == page_ff))
+        return 0;
+
+    /*Code written since the page was last flushed - let the normal path handle it*/
+    if (page->dirty_mask & entry->page_mask)
+        return 0;
+
+    if (cache_hash_code(page, entry->page_mask) != entry->hash) {
+        entry->valid = 0;
+        return 0;
+    }
+
+    return 1;
+}
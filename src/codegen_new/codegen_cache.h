@@ -0,0 +1,37 @@
+#ifndef _CODEGEN_CACHE_H_
+#define _CODEGEN_CACHE_H_
+
+/*Persistent translation cache.
+
+  Host code generated by the recompiler embeds absolute host addresses (cpu_state,
+  helper functions, lookup tables), so it can not be safely reused by another
+  process. Instead, the cache records which guest blocks ended up being fully
+  recompiled, keyed by physical address, CS, CPU status and a hash of the guest
+  code bytes covered by the block's code mask. On the next run, a block that
+  matches a cache entry skips the interpreted mark pass and is recompiled on first
+  execution.
+
+  A false positive is harmless - the recompile pass always generates code from the
+  current guest bytes, so the worst case is that a block is recompiled one
+  execution earlier than it would otherwise have been. Entries are dropped when
+  codegen_check_flush() invalidates the block, and are rejected on lookup if the
+  page dirty mask intersects the recorded code mask or the content hash no longer
+  matches.
+
+  The cache file lives in the machine's NVR directory and is tagged with the CPU
+  model and FPU mode; a mismatching file is discarded on load. The cache is only
+  active when cpu_dynarec_cache is set.*/
+
+struct codeblock_t;
+
+void codegen_cache_init(void);
+void codegen_cache_close(void);
+/*Record a block after recompilation has completed*/
+void codegen_cache_add(struct codeblock_t *block);
+/*Remove any entry for this block, called when the block is invalidated by SMC*/
+void codegen_cache_remove(struct codeblock_t *block);
+/*Returns non-zero if a block starting at the current CS:EIP at the given physical
+  address was recompiled in a previous run, and its code bytes are unchanged*/
+int codegen_cache_lookup(uint32_t phys_addr);
+
+#endif
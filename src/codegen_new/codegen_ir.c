@@ -1,4 +1,5 @@
 #include <stdint.h>
+#include <string.h>
 #include <86box/86box.h>
 #include "cpu.h"
 #include <86box/mem.h>
@@ -59,6 +60,137 @@ duplicate_uop(ir_data_t *ir, uop_t *uop, int offset)
     }
 }
 
+static uint8_t ir_jump_dest[UOP_NR_MAX];
+
+/*Returns non-zero if ir_reg is a 32-bit register version produced by UOP_MOV_IMM,
+  with the immediate in *imm. The definition must be at or after fence (so that it
+  is not skipped by a jump, and the register is not modified by a helper function
+  called between the definition and the read).*/
+static int
+ir_reg_get_const(ir_data_t *ir, ir_reg_t ir_reg, int fence, int uop_nr, uint32_t *imm)
+{
+    const reg_version_t *regv;
+    const uop_t         *def;
+
+    if (ir_reg_is_invalid(ir_reg) || !ir_reg.version || IREG_GET_SIZE(ir_reg.reg) != IREG_SIZE_L || !reg_is_native_size(ir_reg))
+        return 0;
+
+    regv = &reg_version[IREG_GET_REG(ir_reg.reg)][ir_reg.version];
+    if ((regv->flags & REG_FLAGS_DEAD) || regv->parent_uop < fence || regv->parent_uop >= uop_nr)
+        return 0;
+
+    def = &ir->uops[regv->parent_uop];
+    if ((def->type & UOP_MASK) != (UOP_MOV_IMM & UOP_MASK) || def->dest_reg_a.reg != ir_reg.reg || def->dest_reg_a.version != ir_reg.version)
+        return 0;
+
+    *imm = def->imm_data;
+    return 1;
+}
+
+/*Drop a read of a constant register version. If nothing else reads it, queue it
+  on the dead list, using the same rules as codegen_reg_write()*/
+static void
+ir_reg_drop_read(ir_data_t *ir, ir_reg_t ir_reg)
+{
+    int            reg  = IREG_GET_REG(ir_reg.reg);
+    reg_version_t *regv = &reg_version[reg][ir_reg.version];
+
+    regv->refcount--;
+    if (!regv->refcount && reg > IREG_EBX && ir_reg.version < reg_last_version[reg] && !(regv->flags & REG_FLAGS_REQUIRED)) {
+        /*Non-native size writes of the next version have an implicit dependency
+          on this one*/
+        const uop_t *next_def = &ir->uops[reg_version[reg][ir_reg.version + 1].parent_uop];
+
+        if (reg_is_native_size(next_def->dest_reg_a))
+            add_to_dead_list(regv, reg, ir_reg.version);
+    }
+}
+
+static int
+ir_uop_to_imm(uint32_t type)
+{
+    switch (type & UOP_MASK) {
+        case (UOP_ADD & UOP_MASK):
+            return UOP_ADD_IMM;
+        case (UOP_SUB & UOP_MASK):
+            return UOP_SUB_IMM;
+        case (UOP_AND & UOP_MASK):
+            return UOP_AND_IMM;
+        case (UOP_OR & UOP_MASK):
+            return UOP_OR_IMM;
+        case (UOP_XOR & UOP_MASK):
+            return UOP_XOR_IMM;
+
+        default:
+            return 0;
+    }
+}
+
+/*Constant propagation, only run on hot blocks. Reads of 32-bit register versions
+  produced by UOP_MOV_IMM are replaced with the immediate, converting moves to
+  UOP_MOV_IMM and ALU uOPs to their immediate forms. The UOP_MOV_IMM itself is
+  then removed by codegen_reg_process_dead_list() if no other reads remain.
+
+  Dead flag computations and redundant loads/stores of cpu_state are already
+  handled for every block by the dead register list and the register allocator,
+  so are not repeated here.*/
+static void
+codegen_ir_optimise(ir_data_t *ir)
+{
+    int fence = 0;
+    int c;
+
+    memset(ir_jump_dest, 0, ir->wr_pos);
+    for (c = 0; c < ir->wr_pos; c++) {
+        const uop_t *uop = &ir->uops[c];
+
+        if ((uop->type & UOP_TYPE_JUMP) && uop->jump_dest_uop >= 0 && uop->jump_dest_uop < ir->wr_pos)
+            ir_jump_dest[uop->jump_dest_uop] = 1;
+    }
+
+    for (c = 0; c < ir->wr_pos; c++) {
+        uop_t   *uop = &ir->uops[c];
+        uint32_t imm;
+        int      imm_type;
+
+        if (ir_jump_dest[c])
+            fence = c;
+
+        if ((uop->type & UOP_MASK) == (UOP_MOV & UOP_MASK)) {
+            if (IREG_GET_SIZE(uop->dest_reg_a.reg) == IREG_SIZE_L && reg_is_native_size(uop->dest_reg_a) &&
+                IREG_GET_REG(uop->dest_reg_a.reg) != IREG_GET_REG(uop->src_reg_a.reg) &&
+                ir_reg_get_const(ir, uop->src_reg_a, fence, c, &imm)) {
+                ir_reg_drop_read(ir, uop->src_reg_a);
+                uop->type      = UOP_MOV_IMM;
+                uop->src_reg_a = invalid_ir_reg;
+                uop->imm_data  = imm;
+            }
+        } else if ((imm_type = ir_uop_to_imm(uop->type)) != 0) {
+            if (IREG_GET_SIZE(uop->dest_reg_a.reg) == IREG_SIZE_L && IREG_GET_SIZE(uop->src_reg_a.reg) == IREG_SIZE_L) {
+                /*AND/OR/XOR/ADD are commutative, so a constant in either operand
+                  can be folded*/
+                if (imm_type != UOP_SUB_IMM && IREG_GET_REG(uop->dest_reg_a.reg) != IREG_GET_REG(uop->src_reg_a.reg) &&
+                    ir_reg_get_const(ir, uop->src_reg_a, fence, c, &imm) && !ir_reg_is_invalid(uop->src_reg_b) &&
+                    IREG_GET_SIZE(uop->src_reg_b.reg) == IREG_SIZE_L) {
+                    ir_reg_t tmp   = uop->src_reg_a;
+                    uop->src_reg_a = uop->src_reg_b;
+                    uop->src_reg_b = tmp;
+                }
+                if (IREG_GET_REG(uop->dest_reg_a.reg) != IREG_GET_REG(uop->src_reg_b.reg) &&
+                    ir_reg_get_const(ir, uop->src_reg_b, fence, c, &imm)) {
+                    ir_reg_drop_read(ir, uop->src_reg_b);
+                    uop->type      = imm_type;
+                    uop->src_reg_b = invalid_ir_reg;
+                    uop->imm_data  = imm;
+                }
+            }
+        }
+
+        if (uop->type & (UOP_TYPE_BARRIER | UOP_TYPE_JUMP))
+            fence = c + 1;
+    }
+}
+
 void
 codegen_ir_compile(ir_data_t *ir, codeblock_t *block)
 {
@@ -82,6 +214,8 @@ codegen_ir_compile(ir_data_t *ir, codeblock_t *block)
     }
 
     codegen_reg_mark_as_required();
+    if (block->flags & CODEBLOCK_OPTIMISED)
+        codegen_ir_optimise(ir);
     codegen_reg_process_dead_list(ir);
     block_write_data = codeblock_allocator_get_ptr(block->head_mem_block);
     block_pos        = 0;
@@ -92,6 +226,8 @@ codegen_ir_compile(ir_data_t *ir, codeblock_t *block)
 
         //                pclog("uOP %i : %08x\n", c, uop->type);
 
+        codegen_reg_set_uop(ir, c);
+
         if (uop->type & UOP_TYPE_BARRIER)
             codegen_reg_flush_invalidate(ir, block);
 
@@ -176,6 +312,7 @@ codegen_ir_compile(ir_data_t *ir, codeblock_t *block)
     }
 
     codegen_reg_flush_invalidate(ir, block);
+    codegen_reg_set_uop(NULL, 0);
 
     if (jump_target_at_end != -1) {
         uop_t *uop_dest = &ir->uops[jump_target_at_end];
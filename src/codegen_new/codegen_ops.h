@@ -19,6 +19,8 @@ extern RecompOpFn recomp_opcodes_dc[512];
 extern RecompOpFn recomp_opcodes_dd[512];
 extern RecompOpFn recomp_opcodes_de[512];
 extern RecompOpFn recomp_opcodes_df[512];
+extern RecompOpFn recomp_opcodes_d9_sf[512];
+extern RecompOpFn recomp_opcodes_dd_sf[512];
 #if 0
 extern RecompOpFn recomp_opcodes_REPE[512];
 extern RecompOpFn recomp_opcodes_REPNE[512];
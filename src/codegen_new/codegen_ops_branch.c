@@ -110,7 +110,7 @@ static int
 ropJB_common(codeblock_t *block, ir_data_t *ir, uint32_t dest_addr, uint32_t next_pc)
 {
     int jump_uop;
-    int do_unroll = (CF_SET() && codegen_can_unroll(block, ir, next_pc, dest_addr));
+    int do_unroll = (CF_SET() && codegen_can_follow_branch(block, ir, next_pc, dest_addr));
 
     switch (codegen_flags_changed ? cpu_state.flags_op : FLAGS_UNKNOWN) {
         case FLAGS_ZN8:
@@ -158,7 +158,7 @@ static int
 ropJNB_common(codeblock_t *block, ir_data_t *ir, uint32_t dest_addr, uint32_t next_pc)
 {
     int jump_uop;
-    int do_unroll = (!CF_SET() && codegen_can_unroll(block, ir, next_pc, dest_addr));
+    int do_unroll = (!CF_SET() && codegen_can_follow_branch(block, ir, next_pc, dest_addr));
 
     switch (codegen_flags_changed ? cpu_state.flags_op : FLAGS_UNKNOWN) {
         case FLAGS_ZN8:
@@ -210,7 +210,7 @@ ropJE_common(codeblock_t *block, ir_data_t *ir, uint32_t dest_addr, uint32_t nex
 {
     int jump_uop;
 
-    if (ZF_SET() && codegen_can_unroll(block, ir, next_pc, dest_addr)) {
+    if (ZF_SET() && codegen_can_follow_branch(block, ir, next_pc, dest_addr)) {
         if (!codegen_flags_changed || !flags_res_valid()) {
             uop_CALL_FUNC_RESULT(ir, IREG_temp0, ZF_SET);
             jump_uop = uop_CMP_IMM_JNZ_DEST(ir, IREG_temp0, 0);
@@ -239,7 +239,7 @@ ropJNE_common(codeblock_t *block, ir_data_t *ir, uint32_t dest_addr, uint32_t ne
 {
     int jump_uop;
 
-    if (!ZF_SET() && codegen_can_unroll(block, ir, next_pc, dest_addr)) {
+    if (!ZF_SET() && codegen_can_follow_branch(block, ir, next_pc, dest_addr)) {
         if (!codegen_flags_changed || !flags_res_valid()) {
             uop_CALL_FUNC_RESULT(ir, IREG_temp0, ZF_SET);
             jump_uop = uop_CMP_IMM_JZ_DEST(ir, IREG_temp0, 0);
@@ -269,7 +269,7 @@ ropJBE_common(codeblock_t *block, ir_data_t *ir, uint32_t dest_addr, uint32_t ne
 {
     int jump_uop;
     int jump_uop2 = -1;
-    int do_unroll = ((CF_SET() || ZF_SET()) && codegen_can_unroll(block, ir, next_pc, dest_addr));
+    int do_unroll = ((CF_SET() || ZF_SET()) && codegen_can_follow_branch(block, ir, next_pc, dest_addr));
 
     switch (codegen_flags_changed ? cpu_state.flags_op : FLAGS_UNKNOWN) {
         case FLAGS_ZN8:
@@ -337,7 +337,7 @@ ropJNBE_common(codeblock_t *block, ir_data_t *ir, uint32_t dest_addr, uint32_t n
 {
     int jump_uop;
     int jump_uop2 = -1;
-    int do_unroll = ((!CF_SET() && !ZF_SET()) && codegen_can_unroll(block, ir, next_pc, dest_addr));
+    int do_unroll = ((!CF_SET() && !ZF_SET()) && codegen_can_follow_branch(block, ir, next_pc, dest_addr));
 
     switch (codegen_flags_changed ? cpu_state.flags_op : FLAGS_UNKNOWN) {
         case FLAGS_ZN8:
@@ -405,7 +405,7 @@ static int
 ropJS_common(codeblock_t *block, ir_data_t *ir, uint32_t dest_addr, uint32_t next_pc)
 {
     int jump_uop;
-    int do_unroll = (NF_SET() && codegen_can_unroll(block, ir, next_pc, dest_addr));
+    int do_unroll = (NF_SET() && codegen_can_follow_branch(block, ir, next_pc, dest_addr));
 
     switch (codegen_flags_changed ? cpu_state.flags_op : FLAGS_UNKNOWN) {
         case FLAGS_ZN8:
@@ -468,7 +468,7 @@ static int
 ropJNS_common(codeblock_t *block, ir_data_t *ir, uint32_t dest_addr, uint32_t next_pc)
 {
     int jump_uop;
-    int do_unroll = (!NF_SET() && codegen_can_unroll(block, ir, next_pc, dest_addr));
+    int do_unroll = (!NF_SET() && codegen_can_follow_branch(block, ir, next_pc, dest_addr));
 
     switch (codegen_flags_changed ? cpu_state.flags_op : FLAGS_UNKNOWN) {
         case FLAGS_ZN8:
@@ -557,7 +557,7 @@ static int
 ropJL_common(codeblock_t *block, ir_data_t *ir, uint32_t dest_addr, uint32_t next_pc)
 {
     int jump_uop;
-    int do_unroll = ((NF_SET() ? 1 : 0) != (VF_SET() ? 1 : 0) && codegen_can_unroll(block, ir, next_pc, dest_addr));
+    int do_unroll = ((NF_SET() ? 1 : 0) != (VF_SET() ? 1 : 0) && codegen_can_follow_branch(block, ir, next_pc, dest_addr));
 
     switch (codegen_flags_changed ? cpu_state.flags_op : FLAGS_UNKNOWN) {
         case FLAGS_ZN8:
@@ -624,7 +624,7 @@ static int
 ropJNL_common(codeblock_t *block, ir_data_t *ir, uint32_t dest_addr, uint32_t next_pc)
 {
     int jump_uop;
-    int do_unroll = ((NF_SET() ? 1 : 0) == (VF_SET() ? 1 : 0) && codegen_can_unroll(block, ir, next_pc, dest_addr));
+    int do_unroll = ((NF_SET() ? 1 : 0) == (VF_SET() ? 1 : 0) && codegen_can_follow_branch(block, ir, next_pc, dest_addr));
 
     switch (codegen_flags_changed ? cpu_state.flags_op : FLAGS_UNKNOWN) {
         case FLAGS_ZN8:
@@ -693,7 +693,7 @@ ropJLE_common(codeblock_t *block, ir_data_t *ir, uint32_t dest_addr, uint32_t ne
 {
     int jump_uop;
     int jump_uop2 = -1;
-    int do_unroll = (((NF_SET() ? 1 : 0) != (VF_SET() ? 1 : 0) || ZF_SET()) && codegen_can_unroll(block, ir, next_pc, dest_addr));
+    int do_unroll = (((NF_SET() ? 1 : 0) != (VF_SET() ? 1 : 0) || ZF_SET()) && codegen_can_follow_branch(block, ir, next_pc, dest_addr));
 
     switch (codegen_flags_changed ? cpu_state.flags_op : FLAGS_UNKNOWN) {
         case FLAGS_SUB8:
@@ -756,7 +756,7 @@ ropJNLE_common(codeblock_t *block, ir_data_t *ir, uint32_t dest_addr, uint32_t n
 {
     int jump_uop;
     int jump_uop2 = -1;
-    int do_unroll = ((NF_SET() ? 1 : 0) == (VF_SET() ? 1 : 0) && !ZF_SET() && codegen_can_unroll(block, ir, next_pc, dest_addr));
+    int do_unroll = ((NF_SET() ? 1 : 0) == (VF_SET() ? 1 : 0) && !ZF_SET() && codegen_can_follow_branch(block, ir, next_pc, dest_addr));
 
     switch (codegen_flags_changed ? cpu_state.flags_op : FLAGS_UNKNOWN) {
         case FLAGS_SUB8:
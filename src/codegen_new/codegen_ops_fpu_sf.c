@@ -0,0 +1,313 @@
+#include <stdint.h>
+#include <86box/86box.h>
+#include "cpu.h"
+#include <86box/mem.h>
+#include <86box/plat_unused.h>
+
+#include "x86.h"
+#include "x86_ops.h"
+#include "x86_flags.h"
+#include "x86seg_common.h"
+#include "x86seg.h"
+#include "386_common.h"
+#include "x87_sf.h"
+#include "x87.h"
+#include "codegen.h"
+#include "codegen_ir.h"
+#include "codegen_ops.h"
+#include "codegen_ops_fpu_sf.h"
+#include "codegen_ops_helpers.h"
+
+/*SoftFloat x87 register moves.
+
+  These only cover instructions that move 80-bit values around the stack
+  without rounding, so the register can be copied as a 64-bit significand and
+  a 16-bit sign/exponent. They are only compiled for blocks with a static
+  top-of-stack, in which case the physical registers are known at compile
+  time.
+
+  The common case is generated inline. Anything that would raise an exception
+  - a pending exception, a stack overflow or a stack underflow - branches to a
+  call to the interpreter handler, which deals with it exactly as it would
+  outside of the recompiler.*/
+
+#define SF_MAX_JUMPS 3
+
+typedef struct sf_slow_path_t {
+    int jumps[SF_MAX_JUMPS];
+    int nr_jumps;
+} sf_slow_path_t;
+
+static inline int
+sf_phys(int r)
+{
+    return (fpu_state.tos + r) & 7;
+}
+
+static inline int
+sf_tag_mask(int r)
+{
+    return 3 << (sf_phys(r) * 2);
+}
+
+static void
+sf_enter(ir_data_t *ir, sf_slow_path_t *slow)
+{
+    uop_FP_ENTER(ir);
+    slow->nr_jumps = 0;
+
+    uop_MOVZX(ir, IREG_temp0, IREG_SF_swd);
+    uop_AND_IMM(ir, IREG_temp0, IREG_temp0, FPU_SW_Summary);
+    slow->jumps[slow->nr_jumps++] = uop_CMP_IMM_JNZ_DEST(ir, IREG_temp0, 0);
+}
+
+static void
+sf_check_empty(ir_data_t *ir, sf_slow_path_t *slow, int r)
+{
+    uop_MOVZX(ir, IREG_temp0, IREG_SF_tag);
+    uop_AND_IMM(ir, IREG_temp0, IREG_temp0, sf_tag_mask(r));
+    slow->jumps[slow->nr_jumps++] = uop_CMP_IMM_JZ_DEST(ir, IREG_temp0, sf_tag_mask(r));
+}
+
+static void
+sf_check_not_empty(ir_data_t *ir, sf_slow_path_t *slow, int r)
+{
+    uop_MOVZX(ir, IREG_temp0, IREG_SF_tag);
+    uop_AND_IMM(ir, IREG_temp0, IREG_temp0, sf_tag_mask(r));
+    slow->jumps[slow->nr_jumps++] = uop_CMP_IMM_JNZ_DEST(ir, IREG_temp0, sf_tag_mask(r));
+}
+
+static void
+sf_clear_C1(ir_data_t *ir)
+{
+    uop_MOVZX(ir, IREG_temp0, IREG_SF_swd);
+    uop_AND_IMM(ir, IREG_temp0, IREG_temp0, ~FPU_SW_C1);
+    uop_MOV(ir, IREG_SF_swd, IREG_temp0_W);
+}
+
+/*Clear the tags in clear_mask (FPU_save_regi always tags a register as valid),
+  then set the tags in empty_mask*/
+static void
+sf_set_tags(ir_data_t *ir, int clear_mask, int empty_mask)
+{
+    uop_MOVZX(ir, IREG_temp0, IREG_SF_tag);
+    if (clear_mask)
+        uop_AND_IMM(ir, IREG_temp0, IREG_temp0, ~clear_mask);
+    if (empty_mask)
+        uop_OR_IMM(ir, IREG_temp0, IREG_temp0, empty_mask);
+    uop_MOV(ir, IREG_SF_tag, IREG_temp0_W);
+}
+
+static void
+sf_copy_reg(ir_data_t *ir, int dest, int src)
+{
+    uop_MOV(ir, IREG_SF_sig(dest), IREG_SF_sig(src));
+    uop_MOV(ir, IREG_SF_exp(dest), IREG_SF_exp(src));
+}
+
+static uint32_t
+sf_finish(ir_data_t *ir, sf_slow_path_t *slow, const OpFn *op_table, uint8_t opcode, uint32_t fetchdat, uint32_t op_pc)
+{
+    int done = uop_JMP_DEST(ir);
+
+    for (int c = 0; c < slow->nr_jumps; c++)
+        uop_set_jump_dest(ir, slow->jumps[c]);
+
+    /*Interpreter handlers are entered with PC pointing at the ModR/M byte*/
+    uop_MOV_IMM(ir, IREG_pc, op_pc - 1);
+    uop_MOV_IMM(ir, IREG_oldpc, cpu_state.oldpc);
+    uop_LOAD_FUNC_ARG_IMM(ir, 0, fetchdat);
+    uop_CALL_INSTRUCTION_FUNC(ir, op_table[opcode]);
+
+    uop_set_jump_dest(ir, done);
+
+    return op_pc;
+}
+
+#define SF_D9_TABLE ((op_32 & 0x200) ? x86_dynarec_opcodes_d9_a32 : x86_dynarec_opcodes_d9_a16)
+#define SF_DD_TABLE ((op_32 & 0x200) ? x86_dynarec_opcodes_dd_a32 : x86_dynarec_opcodes_dd_a16)
+
+uint32_t
+ropFLD_sf(codeblock_t *block, ir_data_t *ir, uint8_t opcode, uint32_t fetchdat, uint32_t op_32, uint32_t op_pc)
+{
+    sf_slow_path_t slow;
+    int            src_reg = fetchdat & 7;
+
+    if (!(block->flags & CODEBLOCK_STATIC_TOP))
+        return 0;
+
+    sf_enter(ir, &slow);
+    sf_check_not_empty(ir, &slow, -1);
+    sf_check_empty(ir, &slow, src_reg);
+    sf_clear_C1(ir);
+    sf_copy_reg(ir, -1, src_reg);
+    sf_set_tags(ir, sf_tag_mask(-1), 0);
+    uop_MOV_IMM(ir, IREG_SF_tos, sf_phys(-1));
+
+    return sf_finish(ir, &slow, SF_D9_TABLE, opcode, fetchdat, op_pc);
+}
+
+uint32_t
+ropFST_sf(codeblock_t *block, ir_data_t *ir, uint8_t opcode, uint32_t fetchdat, uint32_t op_32, uint32_t op_pc)
+{
+    sf_slow_path_t slow;
+    int            dest_reg = fetchdat & 7;
+
+    if (!(block->flags & CODEBLOCK_STATIC_TOP))
+        return 0;
+
+    sf_enter(ir, &slow);
+    sf_check_empty(ir, &slow, 0);
+    sf_clear_C1(ir);
+    sf_copy_reg(ir, dest_reg, 0);
+    sf_set_tags(ir, sf_tag_mask(dest_reg), 0);
+
+    return sf_finish(ir, &slow, SF_DD_TABLE, opcode, fetchdat, op_pc);
+}
+
+static uint32_t
+ropFSTP_sf_common(codeblock_t *block, ir_data_t *ir, const OpFn *op_table, uint8_t opcode, uint32_t fetchdat, uint32_t op_pc)
+{
+    sf_slow_path_t slow;
+    int            dest_reg = fetchdat & 7;
+
+    if (!(block->flags & CODEBLOCK_STATIC_TOP))
+        return 0;
+
+    sf_enter(ir, &slow);
+    sf_check_empty(ir, &slow, 0);
+    sf_clear_C1(ir);
+    sf_copy_reg(ir, dest_reg, 0);
+    sf_set_tags(ir, sf_tag_mask(dest_reg), sf_tag_mask(0));
+    uop_MOV_IMM(ir, IREG_SF_tos, sf_phys(1));
+
+    return sf_finish(ir, &slow, op_table, opcode, fetchdat, op_pc);
+}
+uint32_t
+ropFSTP_sf(codeblock_t *block, ir_data_t *ir, uint8_t opcode, uint32_t fetchdat, uint32_t op_32, uint32_t op_pc)
+{
+    return ropFSTP_sf_common(block, ir, SF_DD_TABLE, opcode, fetchdat, op_pc);
+}
+uint32_t
+ropFSTP_d9_sf(codeblock_t *block, ir_data_t *ir, uint8_t opcode, uint32_t fetchdat, uint32_t op_32, uint32_t op_pc)
+{
+    return ropFSTP_sf_common(block, ir, SF_D9_TABLE, opcode, fetchdat, op_pc);
+}
+
+uint32_t
+ropFXCH_sf(codeblock_t *block, ir_data_t *ir, uint8_t opcode, uint32_t fetchdat, uint32_t op_32, uint32_t op_pc)
+{
+    sf_slow_path_t slow;
+    int            dest_reg = fetchdat & 7;
+
+    if (!(block->flags & CODEBLOCK_STATIC_TOP))
+        return 0;
+
+    sf_enter(ir, &slow);
+    sf_check_empty(ir, &slow, 0);
+    sf_check_empty(ir, &slow, dest_reg);
+    sf_clear_C1(ir);
+    uop_MOV(ir, IREG_temp0_Q, IREG_SF_sig(0));
+    uop_MOV(ir, IREG_temp1_W, IREG_SF_exp(0));
+    sf_copy_reg(ir, 0, dest_reg);
+    uop_MOV(ir, IREG_SF_sig(dest_reg), IREG_temp0_Q);
+    uop_MOV(ir, IREG_SF_exp(dest_reg), IREG_temp1_W);
+    sf_set_tags(ir, sf_tag_mask(0) | sf_tag_mask(dest_reg), 0);
+
+    return sf_finish(ir, &slow, SF_D9_TABLE, opcode, fetchdat, op_pc);
+}
+
+uint32_t
+ropFFREE_sf(codeblock_t *block, ir_data_t *ir, uint8_t opcode, uint32_t fetchdat, uint32_t op_32, uint32_t op_pc)
+{
+    sf_slow_path_t slow;
+    int            dest_reg = fetchdat & 7;
+
+    if (!(block->flags & CODEBLOCK_STATIC_TOP))
+        return 0;
+
+    sf_enter(ir, &slow);
+    sf_clear_C1(ir);
+    sf_set_tags(ir, 0, sf_tag_mask(dest_reg));
+
+    return sf_finish(ir, &slow, SF_DD_TABLE, opcode, fetchdat, op_pc);
+}
+
+uint32_t
+ropFNOP_sf(codeblock_t *block, ir_data_t *ir, uint8_t opcode, uint32_t fetchdat, uint32_t op_32, uint32_t op_pc)
+{
+    sf_slow_path_t slow;
+
+    if (!(block->flags & CODEBLOCK_STATIC_TOP))
+        return 0;
+
+    sf_enter(ir, &slow);
+
+    return sf_finish(ir, &slow, SF_D9_TABLE, opcode, fetchdat, op_pc);
+}
+
+uint32_t
+ropFCHS_sf(codeblock_t *block, ir_data_t *ir, uint8_t opcode, uint32_t fetchdat, uint32_t op_32, uint32_t op_pc)
+{
+    sf_slow_path_t slow;
+
+    if (!(block->flags & CODEBLOCK_STATIC_TOP))
+        return 0;
+
+    sf_enter(ir, &slow);
+    sf_check_empty(ir, &slow, 0);
+    sf_clear_C1(ir);
+    uop_MOVZX(ir, IREG_temp0, IREG_SF_exp(0));
+    uop_XOR_IMM(ir, IREG_temp0, IREG_temp0, 0x8000);
+    uop_MOV(ir, IREG_SF_exp(0), IREG_temp0_W);
+    sf_set_tags(ir, sf_tag_mask(0), 0);
+
+    return sf_finish(ir, &slow, SF_D9_TABLE, opcode, fetchdat, op_pc);
+}
+uint32_t
+ropFABS_sf(codeblock_t *block, ir_data_t *ir, uint8_t opcode, uint32_t fetchdat, uint32_t op_32, uint32_t op_pc)
+{
+    sf_slow_path_t slow;
+
+    if (!(block->flags & CODEBLOCK_STATIC_TOP))
+        return 0;
+
+    sf_enter(ir, &slow);
+    sf_check_empty(ir, &slow, 0);
+    sf_clear_C1(ir);
+    uop_MOVZX(ir, IREG_temp0, IREG_SF_exp(0));
+    uop_AND_IMM(ir, IREG_temp0, IREG_temp0, 0x7fff);
+    uop_MOV(ir, IREG_SF_exp(0), IREG_temp0_W);
+    sf_set_tags(ir, sf_tag_mask(0), 0);
+
+    return sf_finish(ir, &slow, SF_D9_TABLE, opcode, fetchdat, op_pc);
+}
+
+uint32_t
+ropFDECSTP_sf(codeblock_t *block, ir_data_t *ir, uint8_t opcode, uint32_t fetchdat, uint32_t op_32, uint32_t op_pc)
+{
+    sf_slow_path_t slow;
+
+    if (!(block->flags & CODEBLOCK_STATIC_TOP))
+        return 0;
+
+    sf_enter(ir, &slow);
+    sf_clear_C1(ir);
+    uop_MOV_IMM(ir, IREG_SF_tos, sf_phys(-1));
+
+    return sf_finish(ir, &slow, SF_D9_TABLE, opcode, fetchdat, op_pc);
+}
+uint32_t
+ropFINCSTP_sf(codeblock_t *block, ir_data_t *ir, uint8_t opcode, uint32_t fetchdat, uint32_t op_32, uint32_t op_pc)
+{
+    sf_slow_path_t slow;
+
+    if (!(block->flags & CODEBLOCK_STATIC_TOP))
+        return 0;
+
+    sf_enter(ir, &slow);
+    sf_clear_C1(ir);
+    uop_MOV_IMM(ir, IREG_SF_tos, sf_phys(1));
+
+    return sf_finish(ir, &slow, SF_D9_TABLE, opcode, fetchdat, op_pc);
+}
@@ -75,3 +75,25 @@ codegen_can_unroll_full(codeblock_t *block, ir_data_t *ir, UNUSED(uint32_t next_
 
     return 1;
 }
+
+int
+codegen_can_trace(codeblock_t *block, uint32_t next_pc, uint32_t dest_addr)
+{
+    uint32_t                        branch_pc = cs + cpu_state.oldpc;
+    const codegen_branch_profile_t *profile   = codegen_branch_profile_get(branch_pc);
+
+    if ((block->flags & CODEBLOCK_OPTIMISED) && (dest_addr > next_pc) && ((dest_addr - next_pc) <= CODEGEN_TRACE_MAX_SKIP) &&
+        (profile->pc == branch_pc) && (profile->exits >= CODEGEN_TRACE_MIN_SAMPLES) &&
+        (profile->taken >= (profile->exits - (profile->exits >> 2)))) {
+        /*Stop the interpreter's taken branch from ending the block*/
+        codegen_trace_branch = 1;
+        codegen_stats.branches_traced++;
+        return 1;
+    }
+
+    /*The block ends on this branch, let the dispatcher profile it*/
+    block->flags |= CODEBLOCK_BRANCH_EXIT;
+    block->branch_pc   = branch_pc;
+    block->branch_dest = dest_addr;
+    return 0;
+}
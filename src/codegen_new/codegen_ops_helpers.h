@@ -73,7 +73,7 @@ fpu_PUSH(codeblock_t *block, ir_data_t *ir)
 static inline void
 CHECK_SEG_LIMITS(UNUSED(codeblock_t *block), ir_data_t *ir, x86seg *seg, int addr_reg, int end_offset)
 {
-    if ((seg == &cpu_state.seg_ds && codegen_flat_ds && !(cpu_cur_status & CPU_STATUS_NOTFLATDS)) || (seg == &cpu_state.seg_ss && codegen_flat_ss && !(cpu_cur_status & CPU_STATUS_NOTFLATSS)))
+    if ((seg == &cpu_state.seg_ds && codegen_flat_ds && !(cpu_cur_status & CPU_STATUS_NOTFLATDS)) || (seg == &cpu_state.seg_ss && codegen_flat_ss && !(cpu_cur_status & CPU_STATUS_NOTFLATSS)) || (seg == &cpu_state.seg_es && codegen_flat_es && !(cpu_cur_status & CPU_STATUS_NOTFLATES)))
         return;
 
     uop_CMP_JB(ir, addr_reg, ireg_seg_limit_low(seg), codegen_gpf_rout);
@@ -125,3 +125,14 @@ codegen_can_unroll(codeblock_t *block, ir_data_t *ir, uint32_t next_pc, uint32_t
 
     return codegen_can_unroll_full(block, ir, next_pc, dest_addr);
 }
+
+int codegen_can_trace(codeblock_t *block, uint32_t next_pc, uint32_t dest_addr);
+/*Called for a conditional branch that is taken at the time of recompilation.
+  Returns non-zero if the block should carry on at dest_addr rather than end
+  here, either because the branch loops back within the block and is being
+  unrolled, or because it is mostly taken and is followed as a trace*/
+static inline int
+codegen_can_follow_branch(codeblock_t *block, ir_data_t *ir, uint32_t next_pc, uint32_t dest_addr)
+{
+    return codegen_can_unroll(block, ir, next_pc, dest_addr) || codegen_can_trace(block, next_pc, dest_addr);
+}
@@ -3,6 +3,7 @@
 #include "cpu.h"
 #include <86box/mem.h>
 #include <86box/plat_unused.h>
+#include "x87_sf.h"
 
 #include "codegen.h"
 #include "codegen_backend.h"
@@ -34,6 +35,9 @@ typedef struct host_reg_set_t {
 static host_reg_set_t host_reg_set;
 static host_reg_set_t host_fp_reg_set;
 
+static struct ir_data_t *reg_ir;
+static int               reg_uop_nr;
+
 enum {
     REG_BYTE,
     REG_WORD,
@@ -169,6 +173,28 @@ struct
     [IREG_GS_limit_high] = { REG_DWORD,         &cpu_state.seg_gs.limit_high,       REG_INTEGER, REG_PERMANENT},
     [IREG_SS_limit_high] = { REG_DWORD,         &cpu_state.seg_ss.limit_high,       REG_INTEGER, REG_PERMANENT},
 
+    [IREG_SF_ST0_sig] = { REG_QWORD,         &fpu_state.st_space[0].signif,     REG_FP,      REG_PERMANENT},
+    [IREG_SF_ST1_sig] = { REG_QWORD,         &fpu_state.st_space[1].signif,     REG_FP,      REG_PERMANENT},
+    [IREG_SF_ST2_sig] = { REG_QWORD,         &fpu_state.st_space[2].signif,     REG_FP,      REG_PERMANENT},
+    [IREG_SF_ST3_sig] = { REG_QWORD,         &fpu_state.st_space[3].signif,     REG_FP,      REG_PERMANENT},
+    [IREG_SF_ST4_sig] = { REG_QWORD,         &fpu_state.st_space[4].signif,     REG_FP,      REG_PERMANENT},
+    [IREG_SF_ST5_sig] = { REG_QWORD,         &fpu_state.st_space[5].signif,     REG_FP,      REG_PERMANENT},
+    [IREG_SF_ST6_sig] = { REG_QWORD,         &fpu_state.st_space[6].signif,     REG_FP,      REG_PERMANENT},
+    [IREG_SF_ST7_sig] = { REG_QWORD,         &fpu_state.st_space[7].signif,     REG_FP,      REG_PERMANENT},
+
+    [IREG_SF_ST0_exp] = { REG_WORD,          &fpu_state.st_space[0].signExp,    REG_INTEGER, REG_PERMANENT},
+    [IREG_SF_ST1_exp] = { REG_WORD,          &fpu_state.st_space[1].signExp,    REG_INTEGER, REG_PERMANENT},
+    [IREG_SF_ST2_exp] = { REG_WORD,          &fpu_state.st_space[2].signExp,    REG_INTEGER, REG_PERMANENT},
+    [IREG_SF_ST3_exp] = { REG_WORD,          &fpu_state.st_space[3].signExp,    REG_INTEGER, REG_PERMANENT},
+    [IREG_SF_ST4_exp] = { REG_WORD,          &fpu_state.st_space[4].signExp,    REG_INTEGER, REG_PERMANENT},
+    [IREG_SF_ST5_exp] = { REG_WORD,          &fpu_state.st_space[5].signExp,    REG_INTEGER, REG_PERMANENT},
+    [IREG_SF_ST6_exp] = { REG_WORD,          &fpu_state.st_space[6].signExp,    REG_INTEGER, REG_PERMANENT},
+    [IREG_SF_ST7_exp] = { REG_WORD,          &fpu_state.st_space[7].signExp,    REG_INTEGER, REG_PERMANENT},
+
+    [IREG_SF_tagx] = { REG_WORD,          &fpu_state.tag,                     REG_INTEGER, REG_PERMANENT},
+    [IREG_SF_swdx] = { REG_WORD,          &fpu_state.swd,                     REG_INTEGER, REG_PERMANENT},
+    [IREG_SF_tosx] = { REG_BYTE,          &fpu_state.tos,                     REG_INTEGER, REG_PERMANENT},
+
  /*Temporary registers are stored on the stack, and are not guaranteed to
   be preserved across uOPs. They will not be written back if they will
   not be read again.*/
@@ -603,6 +629,70 @@ codegen_reg_alloc_register(ir_reg_t dest_reg_a, ir_reg_t src_reg_a, ir_reg_t src
         alloc_dest_reg(dest_reg_a, dest_reference);
 }
 
+void
+codegen_reg_set_uop(struct ir_data_t *ir, int uop_nr)
+{
+    reg_ir     = ir;
+    reg_uop_nr = uop_nr;
+}
+
+/*Returns the number of uOPs until the next read of ir_reg, or
+  CODEGEN_HOST_REG_LOOKAHEAD + 1 if it is not read within the lookahead window.
+  Registers are invalidated at barriers, so the search stops there.*/
+static int
+codegen_reg_next_read(ir_reg_t ir_reg)
+{
+    int reg     = IREG_GET_REG(ir_reg.reg);
+    int nr_uops = reg_ir ? reg_ir->wr_pos : 0;
+
+    for (int c = 1; c <= CODEGEN_HOST_REG_LOOKAHEAD && (reg_uop_nr + c) < nr_uops; c++) {
+        const uop_t *uop = &reg_ir->uops[reg_uop_nr + c];
+
+        if ((uop->type & UOP_MASK) == UOP_INVALID)
+            continue;
+        if (uop->type & UOP_TYPE_BARRIER)
+            break;
+        if ((IREG_GET_REG(uop->src_reg_a.reg) == reg && uop->src_reg_a.version == ir_reg.version) ||
+            (IREG_GET_REG(uop->src_reg_b.reg) == reg && uop->src_reg_b.version == ir_reg.version) ||
+            (IREG_GET_REG(uop->src_reg_c.reg) == reg && uop->src_reg_c.version == ir_reg.version))
+            return c;
+    }
+
+    return CODEGEN_HOST_REG_LOOKAHEAD + 1;
+}
+
+/*Choose an unlocked host register to evict. Registers with no pending reads are
+  preferred, clean ones first as they don't need to be written back. Otherwise
+  the register whose next read is furthest away is chosen. Returns
+  reg_set->nr_regs if all registers are locked.*/
+static int
+codegen_reg_pick_victim(host_reg_set_t *reg_set)
+{
+    int victim      = reg_set->nr_regs;
+    int victim_dist = -1;
+
+    for (int c = 0; c < reg_set->nr_regs; c++) {
+        int dist;
+
+        if (reg_set->locked & (1 << c))
+            continue;
+        if (ir_reg_is_invalid(reg_set->regs[c]))
+            return c;
+
+        if (!ir_get_refcount(reg_set->regs[c]))
+            dist = (CODEGEN_HOST_REG_LOOKAHEAD + 3) - reg_set->dirty[c];
+        else
+            dist = codegen_reg_next_read(reg_set->regs[c]);
+
+        if (dist > victim_dist) {
+            victim      = c;
+            victim_dist = dist;
+        }
+    }
+
+    return victim;
+}
+
 ir_host_reg_t
 codegen_reg_alloc_read_reg(codeblock_t *block, ir_reg_t ir_reg, int *host_reg_idx)
 {
@@ -626,22 +716,12 @@ codegen_reg_alloc_read_reg(codeblock_t *block, ir_reg_t ir_reg, int *host_reg_id
     }
 
     if (c == reg_set->nr_regs) {
-        /*No unused registers. Search for an unlocked register with no pending reads*/
-        for (c = 0; c < reg_set->nr_regs; c++) {
-            if (!(reg_set->locked & (1 << c)) && IREG_GET_REG(reg_set->regs[c].reg) != IREG_INVALID && !ir_get_refcount(reg_set->regs[c]))
-                break;
-        }
-        if (c == reg_set->nr_regs) {
-            /*Search for any unlocked register*/
-            for (c = 0; c < reg_set->nr_regs; c++) {
-                if (!(reg_set->locked & (1 << c)))
-                    break;
-            }
+        /*No unused registers*/
+        c = codegen_reg_pick_victim(reg_set);
 #ifndef RELEASE_BUILD
-            if (c == reg_set->nr_regs)
-                fatal("codegen_reg_alloc_read_reg - out of registers\n");
+        if (c == reg_set->nr_regs)
+            fatal("codegen_reg_alloc_read_reg - out of registers\n");
 #endif
-        }
         if (reg_set->dirty[c])
             codegen_reg_writeback(reg_set, block, c, 1);
         codegen_reg_load(reg_set, block, c, ir_reg);
@@ -710,11 +790,8 @@ codegen_reg_alloc_write_reg(codeblock_t *block, ir_reg_t ir_reg)
         }
 
         if (c == reg_set->nr_regs) {
-            /*No unused registers. Search for an unlocked register*/
-            for (c = 0; c < reg_set->nr_regs; c++) {
-                if (!(reg_set->locked & (1 << c)))
-                    break;
-            }
+            /*No unused registers*/
+            c = codegen_reg_pick_victim(reg_set);
 #ifndef RELEASE_BUILD
             if (c == reg_set->nr_regs)
                 fatal("codegen_reg_alloc_write_reg - out of registers\n");
@@ -132,7 +132,32 @@ enum {
     IREG_GS_limit_high = 86,
     IREG_SS_limit_high = 87,
 
-    IREG_COUNT = 88,
+    /*SoftFloat FPU registers. These live in fpu_state rather than cpu_state,
+      and are only used by blocks compiled with CODEBLOCK_STATIC_TOP. Use
+      IREG_SF_sig() / IREG_SF_exp() to access the stack.*/
+    IREG_SF_ST0_sig = 88,
+    IREG_SF_ST1_sig = 89,
+    IREG_SF_ST2_sig = 90,
+    IREG_SF_ST3_sig = 91,
+    IREG_SF_ST4_sig = 92,
+    IREG_SF_ST5_sig = 93,
+    IREG_SF_ST6_sig = 94,
+    IREG_SF_ST7_sig = 95,
+
+    IREG_SF_ST0_exp = 96,
+    IREG_SF_ST1_exp = 97,
+    IREG_SF_ST2_exp = 98,
+    IREG_SF_ST3_exp = 99,
+    IREG_SF_ST4_exp = 100,
+    IREG_SF_ST5_exp = 101,
+    IREG_SF_ST6_exp = 102,
+    IREG_SF_ST7_exp = 103,
+
+    IREG_SF_tagx = 104,
+    IREG_SF_swdx = 105,
+    IREG_SF_tosx = 106,
+
+    IREG_COUNT = 107,
 
     IREG_INVALID = 255,
 
@@ -203,7 +228,11 @@ enum {
     IREG_ssegs = IREG_ssegsx + IREG_SIZE_B,
 
     IREG_flags  = IREG_flagsx + IREG_SIZE_W,
-    IREG_eflags = IREG_eflagsx + IREG_SIZE_W
+    IREG_eflags = IREG_eflagsx + IREG_SIZE_W,
+
+    IREG_SF_tag = IREG_SF_tagx + IREG_SIZE_W,
+    IREG_SF_swd = IREG_SF_swdx + IREG_SIZE_W,
+    IREG_SF_tos = IREG_SF_tosx + IREG_SIZE_B
 };
 
 #define IREG_8(reg)                (((reg) &4) ? (((reg) &3) + IREG_AH) : ((reg) + IREG_AL))
@@ -215,6 +244,9 @@ enum {
 #define IREG_tag(r)                (IREG_tag0 + ((cpu_state.TOP + (r)) & 7))
 #define IREG_tag_B(r)              (IREG_tag0 + ((cpu_state.TOP + (r)) & 7) + IREG_SIZE_B)
 
+#define IREG_SF_sig(r)             (IREG_SF_ST0_sig + ((fpu_state.tos + (r)) & 7) + IREG_SIZE_Q)
+#define IREG_SF_exp(r)             (IREG_SF_ST0_exp + ((fpu_state.tos + (r)) & 7) + IREG_SIZE_W)
+
 #define IREG_MM(reg)               ((reg) + IREG_MM0)
 
 #define IREG_TOP_diff_stack_offset 32
@@ -420,6 +452,10 @@ ir_host_reg_t codegen_reg_alloc_write_reg(codeblock_t *block, ir_reg_t ir_reg);
 
 void codegen_reg_rename(codeblock_t *block, ir_reg_t src, ir_reg_t dst);
 
+/*Set the uOP currently being compiled, used to look ahead for upcoming register
+  reads when choosing a host register to spill*/
+void codegen_reg_set_uop(struct ir_data_t *ir, int uop_nr);
+
 void codegen_reg_mark_as_required(void);
 void codegen_reg_process_dead_list(struct ir_data_t *ir);
 #endif
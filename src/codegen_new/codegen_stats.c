@@ -0,0 +1,115 @@
+#include <stdarg.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#define HAVE_STDARG_H
+#include <86box/86box.h>
+#include "cpu.h"
+#include <86box/mem.h>
+#include <minitrace/minitrace.h>
+
+#include "codegen.h"
+#include "codegen_allocator.h"
+#include "codegen_backend.h"
+#include "codegen_stats.h"
+#include "codegen_public.h"
+
+#define CODEGEN_STATS_TOP_MAX 32
+
+codegen_stats_t codegen_stats;
+
+void
+codegen_stats_reset(void)
+{
+    memset(&codegen_stats, 0, sizeof(codegen_stats));
+}
+
+static void
+codegen_stats_dump_top(int top_blocks)
+{
+    uint16_t top[CODEGEN_STATS_TOP_MAX];
+    int      nr_top = 0;
+
+    if (top_blocks > CODEGEN_STATS_TOP_MAX)
+        top_blocks = CODEGEN_STATS_TOP_MAX;
+
+    /*Simple insertion into a sorted list, this is only run on demand*/
+    for (int c = 1; c < BLOCK_SIZE; c++) {
+        const codeblock_t *block = &codeblock[c];
+        int                d;
+
+        if ((block->pc == BLOCK_PC_INVALID) || !(block->flags & CODEBLOCK_WAS_RECOMPILED) || !block->exec_count)
+            continue;
+        if ((nr_top == top_blocks) && (block->exec_count <= codeblock[top[nr_top - 1]].exec_count))
+            continue;
+
+        if (nr_top < top_blocks)
+            nr_top++;
+        for (d = nr_top - 1; d > 0 && codeblock[top[d - 1]].exec_count < block->exec_count; d--)
+            top[d] = top[d - 1];
+        top[d] = c;
+    }
+
+    for (int c = 0; c < nr_top; c++) {
+        const codeblock_t *block = &codeblock[top[c]];
+
+        pclog("  %04x:%08x phys=%08x exec=%u flags=%04x\n", block->_cs >> 4, block->pc - block->_cs,
+              block->phys, block->exec_count, block->flags);
+    }
+}
+
+void
+codegen_stats_dump(int top_blocks)
+{
+    uint64_t lookups = codegen_stats.lookup_hits + codegen_stats.lookup_misses;
+
+    pclog("CODEGEN: marked=%" PRIu64 " recompiled=%" PRIu64 " optimised=%" PRIu64 " deferred=%" PRIu64 "\n",
+          codegen_stats.blocks_marked, codegen_stats.blocks_recompiled, codegen_stats.blocks_optimised,
+          codegen_stats.blocks_deferred);
+    pclog("CODEGEN: invalidated=%" PRIu64 " evicted=%" PRIu64 " purged=%" PRIu64 " dirty_reused=%" PRIu64 "\n",
+          codegen_stats.blocks_invalidated, codegen_stats.blocks_evicted, codegen_stats.pages_purged,
+          codegen_stats.dirty_reused);
+    pclog("CODEGEN: smc coarse=%" PRIu64 " byte=%" PRIu64 " byte mask pages=%" PRIu64 " cooldowns=%" PRIu64 " interpreted=%" PRIu64 "\n",
+          codegen_stats.smc_coarse, codegen_stats.smc_byte, codegen_stats.smc_byte_mask_pages,
+          codegen_stats.smc_cooldowns, codegen_stats.smc_interpreted);
+    pclog("CODEGEN: lookup hits=%" PRIu64 " misses=%" PRIu64 " (%i%%) chain hits=%" PRIu64 " traced branches=%" PRIu64 "\n",
+          codegen_stats.lookup_hits, codegen_stats.lookup_misses,
+          lookups ? (int) ((codegen_stats.lookup_hits * 100) / lookups) : 0, codegen_stats.chain_hits,
+          codegen_stats.branches_traced);
+    pclog("CODEGEN: memory blocks in use=%i/%u hot=%i/%u overflows=%" PRIu64 " contiguous=%" PRIu64 "\n",
+          codegen_allocator_usage, codegen_allocator_nr_blocks, codegen_allocator_hot_usage, codegen_allocator_nr_hot,
+          codegen_allocator_overflows, codegen_allocator_contiguous);
+
+    if (top_blocks) {
+        pclog("CODEGEN: hottest blocks:\n");
+        codegen_stats_dump_top(top_blocks);
+    }
+}
+
+void
+codegen_stats_tick(void)
+{
+    static int seconds = 0;
+
+    codegen_stats_trace();
+
+    if (cpu_dynarec_stats && (++seconds >= cpu_dynarec_stats)) {
+        seconds = 0;
+        codegen_stats_dump(0);
+    }
+}
+
+void
+codegen_stats_trace(void)
+{
+    MTR_COUNTER("codegen", "marked", codegen_stats.blocks_marked);
+    MTR_COUNTER("codegen", "recompiled", codegen_stats.blocks_recompiled);
+    MTR_COUNTER("codegen", "invalidated", codegen_stats.blocks_invalidated);
+    MTR_COUNTER("codegen", "evicted", codegen_stats.blocks_evicted);
+    MTR_COUNTER("codegen", "smc_coarse", codegen_stats.smc_coarse);
+    MTR_COUNTER("codegen", "smc_byte", codegen_stats.smc_byte);
+    MTR_COUNTER("codegen", "purged", codegen_stats.pages_purged);
+    MTR_COUNTER("codegen", "chain_hits", codegen_stats.chain_hits);
+    MTR_COUNTER("codegen", "allocator_usage", codegen_allocator_usage);
+}
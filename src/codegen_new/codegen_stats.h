@@ -0,0 +1,65 @@
+#ifndef _CODEGEN_STATS_H_
+#define _CODEGEN_STATS_H_
+
+/*Dynarec statistics.
+
+  Counters are updated unconditionally, as they are only incremented on paths
+  that are already expensive (translation, invalidation, eviction) or are a
+  single increment in the dispatcher. codegen_stats_dump() writes the counters
+  to the log, optionally followed by the hottest blocks currently in the block
+  table, as counted by codeblock_t::exec_count. When built with minitrace,
+  codegen_stats_trace() emits the counters as trace counters.
+
+  Dumping is enabled with cpu_dynarec_stats; stats are then written to the log
+  every cpu_dynarec_stats seconds, and when the emulator is closed.*/
+
+typedef struct codegen_stats_t {
+    /*Blocks created by the mark pass*/
+    uint64_t blocks_marked;
+    /*Blocks compiled to host code, including recompiles*/
+    uint64_t blocks_recompiled;
+    /*Blocks recompiled in the optimising tier*/
+    uint64_t blocks_optimised;
+    /*Blocks invalidated by writes to their code (self-modifying code)*/
+    uint64_t blocks_invalidated;
+    /*Blocks deleted by the eviction policy to free memory or block slots*/
+    uint64_t blocks_evicted;
+    /*Dirty pages flushed by codegen_purge_purgable_list()*/
+    uint64_t pages_purged;
+    /*Dirty list blocks reused for new translations*/
+    uint64_t dirty_reused;
+    /*Block executions interpreted because the recompile budget was used up*/
+    uint64_t blocks_deferred;
+
+    /*Invalidations of blocks using 64 byte masks, some of which will have been
+      caused by data writes near the code rather than to it*/
+    uint64_t smc_coarse;
+    /*Invalidations of blocks using byte masks, ie writes to the code itself*/
+    uint64_t smc_byte;
+    /*Pages switched to byte masks, and pages put into interpret-only cooldown*/
+    uint64_t smc_byte_mask_pages;
+    uint64_t smc_cooldowns;
+    /*Block executions interpreted because their page was in cooldown*/
+    uint64_t smc_interpreted;
+
+    /*Direct-mapped lookup table in front of the codeblock tree*/
+    uint64_t lookup_hits;
+    uint64_t lookup_misses;
+
+    /*Blocks entered through a chain link rather than a lookup*/
+    uint64_t chain_hits;
+
+    /*Taken conditional branches followed as a trace by the optimising tier*/
+    uint64_t branches_traced;
+} codegen_stats_t;
+
+extern codegen_stats_t codegen_stats;
+
+void codegen_stats_reset(void);
+/*Write statistics to the log. If top_blocks is non-zero, also list up to that
+  many of the most executed blocks*/
+void codegen_stats_dump(int top_blocks);
+/*Emit statistics as minitrace counters. Does nothing if minitrace is not enabled*/
+void codegen_stats_trace(void);
+
+#endif
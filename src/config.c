@@ -76,6 +76,7 @@
 #include <86box/ui.h>
 #include <86box/snd_opl.h>
 #include <86box/version.h>
+#include <86box/perf.h>
 
 #ifndef USE_SDL_UI
 /* Deliberate to not make the 86box.h header kitchen-sink. */
@@ -174,6 +175,7 @@ load_general(void)
     kbd_req_capture = ini_section_get_int(cat, "kbd_req_capture", 0);
     hide_status_bar = ini_section_get_int(cat, "hide_status_bar", 0);
     hide_tool_bar   = ini_section_get_int(cat, "hide_tool_bar", 0);
+    perf_panel      = ini_section_get_int(cat, "perf_panel", 0);
     sound_muted     = ini_section_get_int(cat, "sound_muted", 0);
 
     confirm_reset = ini_section_get_int(cat, "confirm_reset", 1);
@@ -203,6 +205,18 @@ load_general(void)
     video_framerate = ini_section_get_int(cat, "video_gl_framerate", -1);
     video_vsync     = ini_section_get_int(cat, "video_gl_vsync", 0);
 
+    video_frame_dump = ini_section_get_int(cat, "video_frame_dump", 0);
+    if (video_frame_dump < 0)
+        video_frame_dump = 0;
+
+    video_render_thread = !!ini_section_get_int(cat, "video_render_thread", 0);
+
+    video_cursor_layer = !!ini_section_get_int(cat, "video_cursor_layer", 0);
+
+    video_batch_lines = !!ini_section_get_int(cat, "video_batch_lines", 0);
+
+    video_frame_pacing = !!ini_section_get_int(cat, "video_frame_pacing", 0);
+
     window_remember = ini_section_get_int(cat, "window_remember", 0);
     if (window_remember) {
         p = ini_section_get_string(cat, "window_coordinates", NULL);
@@ -216,6 +230,10 @@ load_general(void)
 
     do_auto_pause = ini_section_get_int(cat, "do_auto_pause", 0);
 
+    cpu_sched_mode = ini_section_get_int(cat, "sched_mode", SCHED_FIXED);
+    if ((cpu_sched_mode < SCHED_FIXED) || (cpu_sched_mode > SCHED_THROUGHPUT))
+        cpu_sched_mode = SCHED_FIXED;
+
     p = ini_section_get_string(cat, "uuid", NULL);
     if (p != NULL)
         strncpy(uuid, p, sizeof(uuid) - 1);
@@ -393,10 +411,21 @@ load_machine(void)
     if (mem_size > machine_get_max_ram(machine))
         mem_size = machine_get_max_ram(machine);
 
+    mem_huge_pages   = !!ini_section_get_int(cat, "mem_huge_pages", 0);
+    mem_mergeable    = !!ini_section_get_int(cat, "mem_mergeable", 0);
+    mem_zero_release = !!ini_section_get_int(cat, "mem_zero_release", 0);
+
     cpu_use_dynarec = !!ini_section_get_int(cat, "cpu_use_dynarec", 0);
+    cpu_dynarec_cache = !!ini_section_get_int(cat, "cpu_dynarec_cache", 0);
+    cpu_use_kvm = !!ini_section_get_int(cat, "cpu_use_kvm", 0);
+    cpu_dynarec_mmu_smc = !!ini_section_get_int(cat, "cpu_dynarec_mmu_smc", 0);
+    cpu_dynarec_pool_size = ini_section_get_int(cat, "cpu_dynarec_pool_size", 0);
+    cpu_dynarec_stats = ini_section_get_int(cat, "cpu_dynarec_stats", 0);
+    cpu_dynarec_compile_budget = ini_section_get_int(cat, "cpu_dynarec_compile_budget", 0);
     fpu_softfloat = !!ini_section_get_int(cat, "fpu_softfloat", 0);
     if ((fpu_type != FPU_NONE) && machine_has_flags(machine, MACHINE_SOFTFLOAT_ONLY))
         fpu_softfloat = 1;
+    fpu_softfloat_fast = !!ini_section_get_int(cat, "fpu_softfloat_fast", 0);
 
     p = ini_section_get_string(cat, "time_sync", NULL);
     if (p != NULL) {
@@ -412,6 +441,8 @@ load_machine(void)
         time_sync = TIME_SYNC_ENABLED;
 
     pit_mode = ini_section_get_int(cat, "pit_mode", -1);
+
+    acpi_host_timer = !!ini_section_get_int(cat, "acpi_host_timer", 0);
 }
 
 /* Load "Video" section. */
@@ -630,12 +661,26 @@ load_sound(void)
     else
         sound_is_float = 0;
 
+    sound_buffer_ms = ini_section_get_int(cat, "sound_buffer_ms", 20);
+    if (sound_buffer_ms < 5)
+        sound_buffer_ms = 5;
+    else if (sound_buffer_ms > 20)
+        sound_buffer_ms = 20;
+
+    cd_audio_readahead = ini_section_get_int(cat, "cd_audio_readahead", 4);
+    if (cd_audio_readahead < 0)
+        cd_audio_readahead = 0;
+    else if (cd_audio_readahead > 30)
+        cd_audio_readahead = 30;
+
     p = ini_section_get_string(cat, "fm_driver", "nuked");
     if (!strcmp(p, "ymfm")) {
         fm_driver = FM_DRV_YMFM;
     } else {
         fm_driver = FM_DRV_NUKED;
     }
+
+    fm_synth_thread = !!ini_section_get_int(cat, "fm_synth_thread", 0);
 }
 
 /* Load "Network" section. */
@@ -708,6 +753,8 @@ load_network(void)
                 nc->net_type = NET_TYPE_SLIRP;
             else if (!strcmp(p, "vde") || !strcmp(p, "2"))
                 nc->net_type = NET_TYPE_VDE;
+            else if (!strcmp(p, "tap"))
+                nc->net_type = NET_TYPE_TAP;
             else
                 nc->net_type = NET_TYPE_NONE;
         } else
@@ -735,7 +782,18 @@ load_network(void)
                                              (NET_LINK_10_HD | NET_LINK_10_FD |
                                               NET_LINK_100_HD | NET_LINK_100_FD |
                                               NET_LINK_1000_HD | NET_LINK_1000_FD));
+
+        sprintf(temp, "net_%02i_queue", c + 1);
+        nc->queue_len = ini_section_get_int(cat, temp, NET_QUEUE_LEN);
+        if (nc->queue_len < NET_QUEUE_LEN_MIN)
+            nc->queue_len = NET_QUEUE_LEN_MIN;
+        else if (nc->queue_len > NET_QUEUE_LEN_MAX)
+            nc->queue_len = NET_QUEUE_LEN_MAX;
     }
+
+    net_stats_interval = ini_section_get_int(cat, "stats_interval", 0);
+    if (net_stats_interval < 0)
+        net_stats_interval = 0;
 }
 
 /* Load "Ports" section. */
@@ -1168,10 +1226,38 @@ load_hard_disks(void)
         sprintf(temp, "hdd_%02i_vhd_blocksize", c + 1);
         hdd[c].vhd_blocksize = ini_section_get_int(cat, temp, 0);
 
+        sprintf(temp, "hdd_%02i_vhd_sparse_alloc", c + 1);
+        hdd[c].vhd_sparse_alloc = !!ini_section_get_int(cat, temp, 0);
+
+        sprintf(temp, "hdd_%02i_image_cache", c + 1);
+        hdd[c].image_cache_size = ini_section_get_int(cat, temp, 0);
+        if (hdd[c].image_cache_size > 256)
+            hdd[c].image_cache_size = 256;
+
         sprintf(temp, "hdd_%02i_vhd_parent", c + 1);
         p = ini_section_get_string(cat, temp, "");
         strncpy(hdd[c].vhd_parent, p, sizeof(hdd[c].vhd_parent) - 1);
 
+        memset(hdd[c].overlay_fn, 0x00, sizeof(hdd[c].overlay_fn));
+        sprintf(temp, "hdd_%02i_overlay", c + 1);
+        p = ini_section_get_string(cat, temp, "");
+        if (p[0] != 0x00) {
+            if (path_abs(p))
+                strncpy(hdd[c].overlay_fn, p, sizeof(hdd[c].overlay_fn) - 1);
+            else
+                path_append_filename(hdd[c].overlay_fn, usr_path, p);
+            path_normalize(hdd[c].overlay_fn);
+        }
+
+        sprintf(temp, "hdd_%02i_overlay_discard", c + 1);
+        hdd[c].overlay_discard = !!ini_section_get_int(cat, temp, 0);
+
+        sprintf(temp, "hdd_%02i_tcq", c + 1);
+        hdd[c].tcq = !!ini_section_get_int(cat, temp, 0);
+
+        sprintf(temp, "hdd_%02i_trim", c + 1);
+        hdd[c].trim = !!ini_section_get_int(cat, temp, 0);
+
         /* If disk is empty or invalid, mark it for deletion. */
         if (!hdd_is_valid(c)) {
             sprintf(temp, "hdd_%02i_parameters", c + 1);
@@ -1310,6 +1396,14 @@ load_floppy_and_cdrom_drives(void)
         sprintf(temp, "cdrom_%02i_speed", c + 1);
         cdrom[c].speed = ini_section_get_int(cat, temp, 8);
 
+        sprintf(temp, "cdrom_%02i_instant", c + 1);
+        cdrom[c].instant = !!ini_section_get_int(cat, temp, 0);
+
+        sprintf(temp, "cdrom_%02i_readahead", c + 1);
+        cdrom[c].readahead = ini_section_get_int(cat, temp, 64);
+        if (cdrom[c].readahead > 4096)
+            cdrom[c].readahead = 4096;
+
         sprintf(temp, "cdrom_%02i_type", c + 1);
         p = ini_section_get_string(cat, temp, "86cd");
         /* TODO: Configuration migration, remove when no longer needed. */
@@ -1416,6 +1510,12 @@ load_floppy_and_cdrom_drives(void)
             sprintf(temp, "cdrom_%02i_speed", c + 1);
             ini_section_delete_var(cat, temp);
 
+            sprintf(temp, "cdrom_%02i_instant", c + 1);
+            ini_section_delete_var(cat, temp);
+
+            sprintf(temp, "cdrom_%02i_readahead", c + 1);
+            ini_section_delete_var(cat, temp);
+
             sprintf(temp, "cdrom_%02i_type", c + 1);
             ini_section_delete_var(cat, temp);
 
@@ -1508,6 +1608,9 @@ load_other_removable_devices(void)
         sprintf(temp, "zip_%02i_scsi_id", c + 1);
         ini_section_delete_var(cat, temp);
 
+        sprintf(temp, "zip_%02i_instant", c + 1);
+        zip_drives[c].instant = !!ini_section_get_int(cat, temp, 0);
+
         sprintf(temp, "zip_%02i_image_path", c + 1);
         p = ini_section_get_string(cat, temp, "");
 
@@ -1554,6 +1657,9 @@ load_other_removable_devices(void)
             sprintf(temp, "zip_%02i_scsi_location", c + 1);
             ini_section_delete_var(cat, temp);
 
+            sprintf(temp, "zip_%02i_instant", c + 1);
+            ini_section_delete_var(cat, temp);
+
             sprintf(temp, "zip_%02i_image_path", c + 1);
             ini_section_delete_var(cat, temp);
 
@@ -1620,6 +1726,9 @@ load_other_removable_devices(void)
         sprintf(temp, "mo_%02i_scsi_id", c + 1);
         ini_section_delete_var(cat, temp);
 
+        sprintf(temp, "mo_%02i_instant", c + 1);
+        mo_drives[c].instant = !!ini_section_get_int(cat, temp, 0);
+
         sprintf(temp, "mo_%02i_image_path", c + 1);
         p = ini_section_get_string(cat, temp, "");
 
@@ -1666,6 +1775,9 @@ load_other_removable_devices(void)
             sprintf(temp, "mo_%02i_scsi_location", c + 1);
             ini_section_delete_var(cat, temp);
 
+            sprintf(temp, "mo_%02i_instant", c + 1);
+            ini_section_delete_var(cat, temp);
+
             sprintf(temp, "mo_%02i_image_path", c + 1);
             ini_section_delete_var(cat, temp);
 
@@ -1719,6 +1831,29 @@ load_other_peripherals(void)
         ini_section_delete_var(cat, temp);
 }
 
+/* Load "Threads" section. */
+static void
+load_threads(void)
+{
+    ini_section_t cat = ini_find_section(config, "Threads");
+    char          temp[512];
+    char         *p;
+
+    for (int i = THREAD_ROLE_NONE + 1; i < THREAD_ROLE_MAX; i++) {
+        sprintf(temp, "%s_cpus", thread_role_get_name(i));
+        p = ini_section_get_string(cat, temp, "");
+        strncpy(thread_role_cpus[i], p, THREAD_CPUS_LEN - 1);
+        thread_role_cpus[i][THREAD_CPUS_LEN - 1] = '\0';
+        if (!thread_role_cpus[i][0])
+            ini_section_delete_var(cat, temp);
+
+        sprintf(temp, "%s_priority", thread_role_get_name(i));
+        thread_role_priority[i] = thread_priority_get_from_name(ini_section_get_string(cat, temp, "default"));
+        if (thread_role_priority[i] == THREAD_PRIO_DEFAULT)
+            ini_section_delete_var(cat, temp);
+    }
+}
+
 #ifndef USE_SDL_UI
 /* Load OpenGL 3.0 renderer options. */
 static void
@@ -1792,10 +1927,12 @@ config_load(void)
         kbd_req_capture = 0;
         hide_status_bar = 0;
         hide_tool_bar   = 0;
+        perf_panel      = 0;
         scale           = 1;
         machine         = machine_get_machine_from_internal_name("ibmpc");
         dpi_scale       = 1;
         do_auto_pause   = 0;
+        cpu_sched_mode  = SCHED_FIXED;
 
         cpu_override_interpreter = 0;
 
@@ -1860,6 +1997,7 @@ config_load(void)
         load_floppy_and_cdrom_drives(); /* Floppy and CD-ROM drives */
         load_other_removable_devices(); /* Other removable devices */
         load_other_peripherals();       /* Other peripherals */
+        load_threads();                 /* Threads */
 #ifndef USE_SDL_UI
         load_gl3_shaders();             /* GL3 Shaders */
 #endif
@@ -2005,6 +2143,11 @@ save_general(void)
     else
         ini_section_delete_var(cat, "hide_tool_bar");
 
+    if (perf_panel != 0)
+        ini_section_set_int(cat, "perf_panel", perf_panel);
+    else
+        ini_section_delete_var(cat, "perf_panel");
+
     if (confirm_reset != 1)
         ini_section_set_int(cat, "confirm_reset", confirm_reset);
     else
@@ -2056,11 +2199,41 @@ save_general(void)
     else
         ini_section_delete_var(cat, "video_gl_vsync");
 
+    if (video_frame_dump > 0)
+        ini_section_set_int(cat, "video_frame_dump", video_frame_dump);
+    else
+        ini_section_delete_var(cat, "video_frame_dump");
+
+    if (video_render_thread)
+        ini_section_set_int(cat, "video_render_thread", video_render_thread);
+    else
+        ini_section_delete_var(cat, "video_render_thread");
+
+    if (video_cursor_layer)
+        ini_section_set_int(cat, "video_cursor_layer", video_cursor_layer);
+    else
+        ini_section_delete_var(cat, "video_cursor_layer");
+
+    if (video_batch_lines)
+        ini_section_set_int(cat, "video_batch_lines", video_batch_lines);
+    else
+        ini_section_delete_var(cat, "video_batch_lines");
+
+    if (video_frame_pacing)
+        ini_section_set_int(cat, "video_frame_pacing", video_frame_pacing);
+    else
+        ini_section_delete_var(cat, "video_frame_pacing");
+
     if (do_auto_pause)
         ini_section_set_int(cat, "do_auto_pause", do_auto_pause);
     else
         ini_section_delete_var(cat, "do_auto_pause");
 
+    if (cpu_sched_mode != SCHED_FIXED)
+        ini_section_set_int(cat, "sched_mode", cpu_sched_mode);
+    else
+        ini_section_delete_var(cat, "sched_mode");
+
     char cpu_buf[128] = { 0 };
     plat_get_cpu_string(cpu_buf, 128);
     ini_section_set_string(cat, "host_cpu", cpu_buf);
@@ -2147,13 +2320,63 @@ save_machine(void)
        to display it without having the actual machine table. */
     ini_section_set_int(cat, "mem_size", mem_size);
 
+    if (mem_huge_pages == 0)
+        ini_section_delete_var(cat, "mem_huge_pages");
+    else
+        ini_section_set_int(cat, "mem_huge_pages", mem_huge_pages);
+
+    if (mem_mergeable == 0)
+        ini_section_delete_var(cat, "mem_mergeable");
+    else
+        ini_section_set_int(cat, "mem_mergeable", mem_mergeable);
+
+    if (mem_zero_release == 0)
+        ini_section_delete_var(cat, "mem_zero_release");
+    else
+        ini_section_set_int(cat, "mem_zero_release", mem_zero_release);
+
     ini_section_set_int(cat, "cpu_use_dynarec", cpu_use_dynarec);
 
+    if (cpu_dynarec_cache == 0)
+        ini_section_delete_var(cat, "cpu_dynarec_cache");
+    else
+        ini_section_set_int(cat, "cpu_dynarec_cache", cpu_dynarec_cache);
+
+    if (cpu_use_kvm == 0)
+        ini_section_delete_var(cat, "cpu_use_kvm");
+    else
+        ini_section_set_int(cat, "cpu_use_kvm", cpu_use_kvm);
+
+    if (cpu_dynarec_mmu_smc == 0)
+        ini_section_delete_var(cat, "cpu_dynarec_mmu_smc");
+    else
+        ini_section_set_int(cat, "cpu_dynarec_mmu_smc", cpu_dynarec_mmu_smc);
+
+    if (cpu_dynarec_pool_size == 0)
+        ini_section_delete_var(cat, "cpu_dynarec_pool_size");
+    else
+        ini_section_set_int(cat, "cpu_dynarec_pool_size", cpu_dynarec_pool_size);
+
+    if (cpu_dynarec_stats == 0)
+        ini_section_delete_var(cat, "cpu_dynarec_stats");
+    else
+        ini_section_set_int(cat, "cpu_dynarec_stats", cpu_dynarec_stats);
+
+    if (cpu_dynarec_compile_budget == 0)
+        ini_section_delete_var(cat, "cpu_dynarec_compile_budget");
+    else
+        ini_section_set_int(cat, "cpu_dynarec_compile_budget", cpu_dynarec_compile_budget);
+
     if (fpu_softfloat == 0)
         ini_section_delete_var(cat, "fpu_softfloat");
     else
         ini_section_set_int(cat, "fpu_softfloat", fpu_softfloat);
 
+    if (fpu_softfloat_fast == 0)
+        ini_section_delete_var(cat, "fpu_softfloat_fast");
+    else
+        ini_section_set_int(cat, "fpu_softfloat_fast", fpu_softfloat_fast);
+
     if (time_sync & TIME_SYNC_ENABLED)
         if (time_sync & TIME_SYNC_UTC)
             ini_section_set_string(cat, "time_sync", "utc");
@@ -2167,6 +2390,11 @@ save_machine(void)
     else
         ini_section_set_int(cat, "pit_mode", pit_mode);
 
+    if (acpi_host_timer == 0)
+        ini_section_delete_var(cat, "acpi_host_timer");
+    else
+        ini_section_set_int(cat, "acpi_host_timer", acpi_host_timer);
+
     ini_delete_section_if_empty(config, cat);
 }
 
@@ -2352,11 +2580,26 @@ save_sound(void)
     else
         ini_section_set_string(cat, "sound_type", (sound_is_float == 1) ? "float" : "int16");
 
+    if (sound_buffer_ms == 20)
+        ini_section_delete_var(cat, "sound_buffer_ms");
+    else
+        ini_section_set_int(cat, "sound_buffer_ms", sound_buffer_ms);
+
+    if (cd_audio_readahead == 4)
+        ini_section_delete_var(cat, "cd_audio_readahead");
+    else
+        ini_section_set_int(cat, "cd_audio_readahead", cd_audio_readahead);
+
     if (fm_driver == FM_DRV_NUKED)
         ini_section_delete_var(cat, "fm_driver");
     else
         ini_section_set_string(cat, "fm_driver", "ymfm");
 
+    if (fm_synth_thread)
+        ini_section_set_int(cat, "fm_synth_thread", fm_synth_thread);
+    else
+        ini_section_delete_var(cat, "fm_synth_thread");
+
     ini_delete_section_if_empty(config, cat);
 }
 
@@ -2395,6 +2638,9 @@ save_network(void)
             case NET_TYPE_VDE:
                 ini_section_set_string(cat, temp, "vde");
                 break;
+            case NET_TYPE_TAP:
+                ini_section_set_string(cat, temp, "tap");
+                break;
 
             default:
                 break;
@@ -2416,8 +2662,19 @@ save_network(void)
             ini_section_delete_var(cat, temp);
         else
             ini_section_set_int(cat, temp, nc->link_state);
+
+        sprintf(temp, "net_%02i_queue", c + 1);
+        if (nc->queue_len == NET_QUEUE_LEN)
+            ini_section_delete_var(cat, temp);
+        else
+            ini_section_set_int(cat, temp, nc->queue_len);
     }
 
+    if (net_stats_interval == 0)
+        ini_section_delete_var(cat, "stats_interval");
+    else
+        ini_section_set_int(cat, "stats_interval", net_stats_interval);
+
     ini_delete_section_if_empty(config, cat);
 }
 
@@ -2681,6 +2938,30 @@ save_other_peripherals(void)
     ini_delete_section_if_empty(config, cat);
 }
 
+/* Save "Threads" section. */
+static void
+save_threads(void)
+{
+    ini_section_t cat = ini_find_or_create_section(config, "Threads");
+    char          temp[512];
+
+    for (int i = THREAD_ROLE_NONE + 1; i < THREAD_ROLE_MAX; i++) {
+        sprintf(temp, "%s_cpus", thread_role_get_name(i));
+        if (!thread_role_cpus[i][0])
+            ini_section_delete_var(cat, temp);
+        else
+            ini_section_set_string(cat, temp, thread_role_cpus[i]);
+
+        sprintf(temp, "%s_priority", thread_role_get_name(i));
+        if (thread_role_priority[i] == THREAD_PRIO_DEFAULT)
+            ini_section_delete_var(cat, temp);
+        else
+            ini_section_set_string(cat, temp, thread_priority_get_name(thread_role_priority[i]));
+    }
+
+    ini_delete_section_if_empty(config, cat);
+}
+
 #ifndef USE_SDL_UI
 /* Save "GL3 Shaders" section. */
 static void
@@ -2790,6 +3071,18 @@ save_hard_disks(void)
         else
             ini_section_delete_var(cat, temp);
 
+        sprintf(temp, "hdd_%02i_vhd_sparse_alloc", c + 1);
+        if (hdd_is_valid(c) && hdd[c].vhd_sparse_alloc)
+            ini_section_set_int(cat, temp, hdd[c].vhd_sparse_alloc);
+        else
+            ini_section_delete_var(cat, temp);
+
+        sprintf(temp, "hdd_%02i_image_cache", c + 1);
+        if (hdd_is_valid(c) && (hdd[c].image_cache_size > 0))
+            ini_section_set_int(cat, temp, hdd[c].image_cache_size);
+        else
+            ini_section_delete_var(cat, temp);
+
         sprintf(temp, "hdd_%02i_vhd_parent", c + 1);
         if (hdd_is_valid(c) && hdd[c].vhd_parent[0]) {
             path_normalize(hdd[c].vhd_parent);
@@ -2797,6 +3090,34 @@ save_hard_disks(void)
         } else
             ini_section_delete_var(cat, temp);
 
+        sprintf(temp, "hdd_%02i_overlay", c + 1);
+        if (hdd_is_valid(c) && hdd[c].overlay_fn[0]) {
+            path_normalize(hdd[c].overlay_fn);
+            if (!strnicmp(hdd[c].overlay_fn, usr_path, strlen(usr_path)))
+                ini_section_set_string(cat, temp, &hdd[c].overlay_fn[strlen(usr_path)]);
+            else
+                ini_section_set_string(cat, temp, hdd[c].overlay_fn);
+        } else
+            ini_section_delete_var(cat, temp);
+
+        sprintf(temp, "hdd_%02i_overlay_discard", c + 1);
+        if (hdd_is_valid(c) && hdd[c].overlay_discard)
+            ini_section_set_int(cat, temp, hdd[c].overlay_discard);
+        else
+            ini_section_delete_var(cat, temp);
+
+        sprintf(temp, "hdd_%02i_tcq", c + 1);
+        if (hdd_is_valid(c) && (hdd[c].bus_type == HDD_BUS_SCSI) && hdd[c].tcq)
+            ini_section_set_int(cat, temp, hdd[c].tcq);
+        else
+            ini_section_delete_var(cat, temp);
+
+        sprintf(temp, "hdd_%02i_trim", c + 1);
+        if (hdd_is_valid(c) && hdd[c].trim)
+            ini_section_set_int(cat, temp, hdd[c].trim);
+        else
+            ini_section_delete_var(cat, temp);
+
         sprintf(temp, "hdd_%02i_speed", c + 1);
         if (!hdd_is_valid(c) ||
             ((hdd[c].bus_type != HDD_BUS_ESDI) && (hdd[c].bus_type != HDD_BUS_IDE) &&
@@ -2884,6 +3205,18 @@ save_floppy_and_cdrom_drives(void)
         else
             ini_section_set_int(cat, temp, cdrom[c].speed);
 
+        sprintf(temp, "cdrom_%02i_instant", c + 1);
+        if ((cdrom[c].bus_type == 0) || !cdrom[c].instant)
+            ini_section_delete_var(cat, temp);
+        else
+            ini_section_set_int(cat, temp, cdrom[c].instant);
+
+        sprintf(temp, "cdrom_%02i_readahead", c + 1);
+        if ((cdrom[c].bus_type == 0) || (cdrom[c].readahead == 64))
+            ini_section_delete_var(cat, temp);
+        else
+            ini_section_set_int(cat, temp, cdrom[c].readahead);
+
         sprintf(temp, "cdrom_%02i_type", c + 1);
         char *tn = cdrom_get_internal_name(cdrom_get_type(c));
         if ((cdrom[c].bus_type == 0) || (cdrom[c].bus_type == CDROM_BUS_MITSUMI) ||
@@ -2995,6 +3328,12 @@ save_other_removable_devices(void)
             ini_section_set_string(cat, temp, tmp2);
         }
 
+        sprintf(temp, "zip_%02i_instant", c + 1);
+        if ((zip_drives[c].bus_type == 0) || !zip_drives[c].instant)
+            ini_section_delete_var(cat, temp);
+        else
+            ini_section_set_int(cat, temp, zip_drives[c].instant);
+
         sprintf(temp, "zip_%02i_image_path", c + 1);
         if ((zip_drives[c].bus_type == 0) || (strlen(zip_drives[c].image_path) == 0))
             ini_section_delete_var(cat, temp);
@@ -3038,6 +3377,12 @@ save_other_removable_devices(void)
             ini_section_set_string(cat, temp, tmp2);
         }
 
+        sprintf(temp, "mo_%02i_instant", c + 1);
+        if ((mo_drives[c].bus_type == 0) || !mo_drives[c].instant)
+            ini_section_delete_var(cat, temp);
+        else
+            ini_section_set_int(cat, temp, mo_drives[c].instant);
+
         sprintf(temp, "mo_%02i_image_path", c + 1);
         if ((mo_drives[c].bus_type == 0) || (strlen(mo_drives[c].image_path) == 0))
             ini_section_delete_var(cat, temp);
@@ -3056,6 +3401,10 @@ save_other_removable_devices(void)
 void
 config_save(void)
 {
+    /* A clone runs off the configuration of the machine it was cloned from. */
+    if (is_clone)
+        return;
+
     save_general();                 /* General */
     for (uint8_t i = 0; i < MONITORS_NUM; i++)
         save_monitor(i);            /* Monitors */
@@ -3070,6 +3419,7 @@ config_save(void)
     save_floppy_and_cdrom_drives(); /* Floppy and CD-ROM drives */
     save_other_removable_devices(); /* Other removable devices */
     save_other_peripherals();       /* Other peripherals */
+    save_threads();                 /* Threads */
 #ifndef USE_SDL_UI
     save_gl3_shaders();             /* GL3 Shaders */
 #endif
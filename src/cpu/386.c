@@ -29,6 +29,7 @@
 #include <86box/plat_fallthrough.h>
 #include <86box/plat_unused.h>
 #include <86box/gdbstub.h>
+#include <86box/perf.h>
 #ifndef OPS_286_386
 #    define OPS_286_386
 #endif
@@ -269,7 +270,9 @@ exec386_2386(int32_t cycs)
             } else {
                 CHECK_READ_CS(MIN(ol, 4));
             }
-            if (is386)
+            /* Only call out to the breakpoint check if a breakpoint is actually
+               enabled, this is run for every instruction */
+            if (is386 && UNLIKELY(dr[7] & 0xff))
                 ins_fetch_fault = cpu_386_check_instruction_fault();
 
             /* Breakpoint fault has priority over other faults. */
@@ -291,6 +294,7 @@ exec386_2386(int32_t cycs)
                 cpu_state.eflags &= ~(RF_FLAG);
                 if (opcode == 0xf0)
                     in_lock = 1;
+                PERF_COUNT(ins, 1);
                 x86_2386_opcodes[(opcode | cpu_state.op32) & 0x3ff](fetchdat);
                 in_lock = 0;
                 if (x86_was_reset)
@@ -316,7 +320,7 @@ exec386_2386(int32_t cycs)
             if (cpu_end_block_after_ins)
                 cpu_end_block_after_ins--;
 
-            if (cpu_state.abrt) {
+            if (UNLIKELY(cpu_state.abrt)) {
                 flags_rebuild();
                 tempi          = cpu_state.abrt & ABRT_MASK;
                 cpu_state.abrt = 0;
@@ -338,7 +342,7 @@ exec386_2386(int32_t cycs)
 #endif
                     }
                 }
-            } else if (new_ne) {
+            } else if (UNLIKELY(new_ne)) {
                 flags_rebuild();
                 new_ne = 0;
 #ifndef USE_NEW_DYNAREC
@@ -346,7 +350,7 @@ exec386_2386(int32_t cycs)
 #endif
                 cpu_state.oldpc = cpu_state.pc;
                 x86_int(16);
-            } else if (trap) {
+            } else if (UNLIKELY(trap)) {
                 flags_rebuild();
                 if (trap & 2) dr[6] |= 0x8000;
                 if (trap & 1) dr[6] |= 0x4000;
@@ -358,9 +362,9 @@ exec386_2386(int32_t cycs)
                 x86_int(1);
             }
 
-            if (smi_line)
+            if (UNLIKELY(smi_line))
                 enter_smm_check(0);
-            else if (nmi && nmi_enable && nmi_mask) {
+            else if (UNLIKELY(nmi) && nmi_enable && nmi_mask) {
 #ifndef USE_NEW_DYNAREC
                 oldcs = CS;
 #endif
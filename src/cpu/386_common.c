@@ -18,6 +18,7 @@
 #include "x87.h"
 #include <86box/nmi.h>
 #include <86box/mem.h>
+#include <86box/io.h>
 #include <86box/smram.h>
 #include <86box/pic.h>
 #include <86box/pit.h>
@@ -2153,6 +2154,182 @@ nmi_raise(void)
     nmi = 1;
 }
 
+/* Number of forward REP string elements starting at off that stay within the
+   page and do not wrap the index register. */
+static __inline uint32_t
+rep_fast_span(const x86seg *seg, uint32_t off, uint32_t off_mask, uint32_t count, int size)
+{
+    uint32_t lin  = seg->base + off;
+    uint32_t n    = (0x1000 - (lin & 0xfff)) / size;
+    uint64_t wrap = (((uint64_t) off_mask) + 1 - off) / size;
+
+    if (n > wrap)
+        n = (uint32_t) wrap;
+    if (n > count)
+        n = count;
+
+    return n;
+}
+
+/* The CHECK_READ_REP/CHECK_WRITE_REP tests for a whole span. Anything that
+   would fault is left to the normal path, so the fault is raised on the
+   right element. */
+static __inline int
+rep_fast_seg_ok(const x86seg *seg, uint32_t off, uint32_t n, int size)
+{
+    if (seg->base == 0xffffffff)
+        return 0;
+    if ((off < seg->limit_low) || ((off + (n * size) - 1) > seg->limit_high))
+        return 0;
+    if ((msw & 1) && !(cpu_state.eflags & VM_FLAG) && !(seg->access & 0x80))
+        return 0;
+
+    return 1;
+}
+
+/* The host pages of translated code are read-only with
+   cpu_dynarec_mmu_smc, and faulting on the first store of a run does not
+   mark the rest of it dirty, so those are left to the normal path. */
+static __inline int
+rep_fast_dest_ok(const uint8_t *p)
+{
+#ifdef USE_NEW_DYNAREC
+    return !mem_smc_host_protected(p);
+#else
+    (void) p;
+    return 1;
+#endif
+}
+
+/* REP STOS and REP MOVS store straight through writelookup2 once a page has a
+   direct lookup (see the writememl() macros), which by construction means the
+   page is plain RAM with no recompiled code on it, other than on the read-only
+   pages rep_fast_dest_ok() turns away. These do the same for a
+   whole page-bounded run of elements at once. They only handle the forward
+   direction, aligned elements and spans of at least two elements, and return
+   the number of elements done - 0 means the caller takes the normal path. The
+   caller accounts cycles and advances the registers. */
+uint32_t
+rep_stos_fast(x86seg *dseg, uint32_t doff, uint32_t off_mask, uint32_t count, uint32_t max, uint32_t val, int size)
+{
+    uint32_t dlin = dseg->base + doff;
+    uint32_t n;
+    uint8_t *p;
+
+    if ((dr[7] & 0xff) || (dlin & (size - 1)))
+        return 0;
+
+    n = rep_fast_span(dseg, doff, off_mask, count, size);
+    if (n > max)
+        n = max;
+    if ((n < 2) || !rep_fast_seg_ok(dseg, doff, n, size) || (writelookup2[dlin >> 12] == (uintptr_t) LOOKUP_INV))
+        return 0;
+
+    p = (uint8_t *) (writelookup2[dlin >> 12] + (uintptr_t) dlin);
+    if (!rep_fast_dest_ok(p))
+        return 0;
+
+    /* A whole page of zeroes may just be given back to the host. */
+    if (!val && ((n * size) == 0x1000) && mem_zero_page(p))
+        return n;
+
+    switch (size) {
+        case 1:
+            memset(p, val, n);
+            break;
+        case 2:
+            for (uint32_t c = 0; c < n; c++)
+                ((uint16_t *) p)[c] = val;
+            break;
+        default:
+            for (uint32_t c = 0; c < n; c++)
+                ((uint32_t *) p)[c] = val;
+            break;
+    }
+
+    return n;
+}
+
+uint32_t
+rep_movs_fast(x86seg *sseg, uint32_t soff, x86seg *dseg, uint32_t doff, uint32_t off_mask, uint32_t count, uint32_t max, int size)
+{
+    uint32_t slin = sseg->base + soff;
+    uint32_t dlin = dseg->base + doff;
+    uint32_t n;
+    uint32_t sn;
+    uint8_t *s;
+    uint8_t *d;
+
+    if ((dr[7] & 0xff) || (slin & (size - 1)) || (dlin & (size - 1)))
+        return 0;
+
+    n  = rep_fast_span(dseg, doff, off_mask, count, size);
+    sn = rep_fast_span(sseg, soff, off_mask, count, size);
+    if (n > sn)
+        n = sn;
+    if (n > max)
+        n = max;
+    if ((n < 2) || (readlookup2[slin >> 12] == (uintptr_t) LOOKUP_INV) || (writelookup2[dlin >> 12] == (uintptr_t) LOOKUP_INV))
+        return 0;
+
+    s = (uint8_t *) (readlookup2[slin >> 12] + (uintptr_t) slin);
+    d = (uint8_t *) (writelookup2[dlin >> 12] + (uintptr_t) dlin);
+    if (!rep_fast_dest_ok(d))
+        return 0;
+
+    /* An element by element forward copy onto a destination just above the
+       source replicates data, which memmove() would not - stop short of the
+       overlap. */
+    if ((d > s) && (d < (s + (n * size))))
+        n = (uint32_t) (d - s) / size;
+    if ((n < 2) || !rep_fast_seg_ok(sseg, soff, n, size) || !rep_fast_seg_ok(dseg, doff, n, size))
+        return 0;
+
+    memmove(d, s, n * size);
+
+    return n;
+}
+
+/* The same for REP INSW and REP OUTSW on a port with a bulk handler (see
+   io_handler_rep()), which moves the words straight between the device and
+   guest RAM. The I/O permission check has already been done by the caller. */
+uint32_t
+rep_insw_fast(uint16_t port, x86seg *dseg, uint32_t doff, uint32_t off_mask, uint32_t count, uint32_t max)
+{
+    uint32_t dlin = dseg->base + doff;
+    uint32_t n;
+
+    if ((dr[7] & 0xff) || (dlin & 1))
+        return 0;
+
+    n = rep_fast_span(dseg, doff, off_mask, count, 2);
+    if (n > max)
+        n = max;
+    if ((n < 2) || !rep_fast_seg_ok(dseg, doff, n, 2) || (writelookup2[dlin >> 12] == (uintptr_t) LOOKUP_INV) ||
+        !rep_fast_dest_ok((uint8_t *) (writelookup2[dlin >> 12] + (uintptr_t) dlin)))
+        return 0;
+
+    return inw_rep(port, (uint16_t *) (writelookup2[dlin >> 12] + (uintptr_t) dlin), n);
+}
+
+uint32_t
+rep_outsw_fast(uint16_t port, x86seg *sseg, uint32_t soff, uint32_t off_mask, uint32_t count, uint32_t max)
+{
+    uint32_t slin = sseg->base + soff;
+    uint32_t n;
+
+    if ((dr[7] & 0xff) || (slin & 1))
+        return 0;
+
+    n = rep_fast_span(sseg, soff, off_mask, count, 2);
+    if (n > max)
+        n = max;
+    if ((n < 2) || !rep_fast_seg_ok(sseg, soff, n, 2) || (readlookup2[slin >> 12] == (uintptr_t) LOOKUP_INV))
+        return 0;
+
+    return outw_rep(port, (const uint16_t *) (readlookup2[slin >> 12] + (uintptr_t) slin), n);
+}
+
 #ifndef USE_DYNAREC
 /* This is for compatibility with new x87 code. */
 void
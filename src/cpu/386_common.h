@@ -345,7 +345,7 @@ fastreadb(uint32_t a)
     read_type = 4;
 #    endif
     if ((a >> 12) == pccache)
-#    if (defined __amd64__ || defined _M_X64 || defined __aarch64__ || defined _M_ARM64)
+#    if (defined __amd64__ || defined _M_X64 || defined __aarch64__ || defined _M_ARM64 || (defined __riscv && __riscv_xlen == 64))
         return *((uint8_t *) (((uintptr_t) &pccache2[a] & 0x00000000ffffffffULL) | ((uintptr_t) &pccache2[0] & 0xffffffff00000000ULL)));
 #    else
         return *((uint8_t *) &pccache2[a]);
@@ -355,7 +355,7 @@ fastreadb(uint32_t a)
         return 0;
     pccache  = a >> 12;
     pccache2 = t;
-#    if (defined __amd64__ || defined _M_X64 || defined __aarch64__ || defined _M_ARM64)
+#    if (defined __amd64__ || defined _M_X64 || defined __aarch64__ || defined _M_ARM64 || (defined __riscv && __riscv_xlen == 64))
     return *((uint8_t *) (((uintptr_t) &pccache2[a] & 0x00000000ffffffffULL) | ((uintptr_t) &pccache2[0] & 0xffffffff00000000ULL)));
 #    else
     return *((uint8_t *) &pccache2[a]);
@@ -379,7 +379,7 @@ fastreadw(uint32_t a)
         return val;
     }
     if ((a >> 12) == pccache)
-#    if (defined __amd64__ || defined _M_X64 || defined __aarch64__ || defined _M_ARM64)
+#    if (defined __amd64__ || defined _M_X64 || defined __aarch64__ || defined _M_ARM64 || (defined __riscv && __riscv_xlen == 64))
         return *((uint16_t *) (((uintptr_t) &pccache2[a] & 0x00000000ffffffffULL) | ((uintptr_t) &pccache2[0] & 0xffffffff00000000ULL)));
 #    else
         return *((uint16_t *) &pccache2[a]);
@@ -390,7 +390,7 @@ fastreadw(uint32_t a)
 
     pccache  = a >> 12;
     pccache2 = t;
-#    if (defined __amd64__ || defined _M_X64 || defined __aarch64__ || defined _M_ARM64)
+#    if (defined __amd64__ || defined _M_X64 || defined __aarch64__ || defined _M_ARM64 || (defined __riscv && __riscv_xlen == 64))
     return *((uint16_t *) (((uintptr_t) &pccache2[a] & 0x00000000ffffffffULL) | ((uintptr_t) &pccache2[0] & 0xffffffff00000000ULL)));
 #    else
     return *((uint16_t *) &pccache2[a]);
@@ -418,7 +418,7 @@ fastreadl(uint32_t a)
             pccache2 = t;
             pccache  = a >> 12;
         }
-#    if (defined __amd64__ || defined _M_X64 || defined __aarch64__ || defined _M_ARM64)
+#    if (defined __amd64__ || defined _M_X64 || defined __aarch64__ || defined _M_ARM64 || (defined __riscv && __riscv_xlen == 64))
         return *((uint32_t *) (((uintptr_t) &pccache2[a] & 0x00000000ffffffffULL) | ((uintptr_t) &pccache2[0] & 0xffffffff00000000ULL)));
 #    else
         return *((uint32_t *) &pccache2[a]);
@@ -434,14 +434,14 @@ static __inline void *
 get_ram_ptr(uint32_t a)
 {
     if ((a >> 12) == pccache)
-#if (defined __amd64__ || defined _M_X64 || defined __aarch64__ || defined _M_ARM64)
+#if (defined __amd64__ || defined _M_X64 || defined __aarch64__ || defined _M_ARM64 || (defined __riscv && __riscv_xlen == 64))
         return (void *) (((uintptr_t) &pccache2[a] & 0x00000000ffffffffULL) | ((uintptr_t) &pccache2[0] & 0xffffffff00000000ULL));
 #else
         return &pccache2[a];
 #endif
     else {
         uint8_t *t = getpccache(a);
-#if (defined __amd64__ || defined _M_X64 || defined __aarch64__ || defined _M_ARM64)
+#if (defined __amd64__ || defined _M_X64 || defined __aarch64__ || defined _M_ARM64 || (defined __riscv && __riscv_xlen == 64))
         return (void *) (((uintptr_t) &t[a] & 0x00000000ffffffffULL) | ((uintptr_t) &t[0] & 0xffffffff00000000ULL));
 #else
         return &t[a];
@@ -515,7 +515,7 @@ fastreadw_fetch(uint32_t a)
         return val;
     }
     if ((a >> 12) == pccache)
-#    if (defined __amd64__ || defined _M_X64 || defined __aarch64__ || defined _M_ARM64)
+#    if (defined __amd64__ || defined _M_X64 || defined __aarch64__ || defined _M_ARM64 || (defined __riscv && __riscv_xlen == 64))
         return *((uint16_t *) (((uintptr_t) &pccache2[a] & 0x00000000ffffffffULL) | ((uintptr_t) &pccache2[0] & 0xffffffff00000000ULL)));
 #    else
         return *((uint16_t *) &pccache2[a]);
@@ -526,7 +526,7 @@ fastreadw_fetch(uint32_t a)
 
     pccache  = a >> 12;
     pccache2 = t;
-#    if (defined __amd64__ || defined _M_X64 || defined __aarch64__ || defined _M_ARM64)
+#    if (defined __amd64__ || defined _M_X64 || defined __aarch64__ || defined _M_ARM64 || (defined __riscv && __riscv_xlen == 64))
     return *((uint16_t *) (((uintptr_t) &pccache2[a] & 0x00000000ffffffffULL) | ((uintptr_t) &pccache2[0] & 0xffffffff00000000ULL)));
 #    else
     return *((uint16_t *) &pccache2[a]);
@@ -554,7 +554,7 @@ fastreadl_fetch(uint32_t a)
             pccache2 = t;
             pccache  = a >> 12;
         }
-#    if (defined __amd64__ || defined _M_X64 || defined __aarch64__ || defined _M_ARM64)
+#    if (defined __amd64__ || defined _M_X64 || defined __aarch64__ || defined _M_ARM64 || (defined __riscv && __riscv_xlen == 64))
         return *((uint32_t *) (((uintptr_t) &pccache2[a] & 0x00000000ffffffffULL) | ((uintptr_t) &pccache2[0] & 0xffffffff00000000ULL)));
 #    else
         return *((uint32_t *) &pccache2[a]);
@@ -865,4 +865,10 @@ seteaq(uint64_t v)
 /* Resume Flag handling. */
 extern int rf_flag_no_clear;
 
-int cpu_386_check_instruction_fault(void);
\ No newline at end of file
+int cpu_386_check_instruction_fault(void);
+
+/* Bulk REP STOS/MOVS/INSW/OUTSW over directly mapped RAM. */
+uint32_t rep_stos_fast(x86seg *dseg, uint32_t doff, uint32_t off_mask, uint32_t count, uint32_t max, uint32_t val, int size);
+uint32_t rep_movs_fast(x86seg *sseg, uint32_t soff, x86seg *dseg, uint32_t doff, uint32_t off_mask, uint32_t count, uint32_t max, int size);
+uint32_t rep_insw_fast(uint16_t port, x86seg *dseg, uint32_t doff, uint32_t off_mask, uint32_t count, uint32_t max);
+uint32_t rep_outsw_fast(uint16_t port, x86seg *sseg, uint32_t soff, uint32_t off_mask, uint32_t count, uint32_t max);
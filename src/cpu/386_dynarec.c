@@ -32,10 +32,13 @@
 #include <86box/plat_fallthrough.h>
 #include <86box/plat_unused.h>
 #include <86box/gdbstub.h>
+#include <86box/perf.h>
+#include <minitrace/minitrace.h>
 #ifdef USE_DYNAREC
 #    include "codegen.h"
 #    ifdef USE_NEW_DYNAREC
 #        include "codegen_backend.h"
+#        include "codegen_cache.h"
 #    endif
 #endif
 
@@ -298,7 +301,7 @@ exec386_dynarec_int(void)
         cpu_state.ssegs  = 0;
 
 #    ifdef USE_DEBUG_REGS_486
-        if (UNLIKELY(cpu_386_check_instruction_fault())) {
+        if (UNLIKELY(dr[7] & 0xff) && cpu_386_check_instruction_fault()) {
             x86gen();
             goto block_ended;
         }
@@ -324,6 +327,7 @@ exec386_dynarec_int(void)
 #    ifdef USE_DEBUG_REGS_486
             cpu_state.eflags &= ~(RF_FLAG);
 #    endif
+            PERF_COUNT(ins, 1);
             x86_opcodes[(opcode | cpu_state.op32) & 0x3ff](fetchdat);
         }
 
@@ -389,6 +393,61 @@ block_ended:
     cpu_end_block_after_ins = 0;
 }
 
+#    ifdef USE_NEW_DYNAREC
+/* Number of blocks recompiled during the current exec386_dynarec() call */
+static int recompiles_this_slice = 0;
+
+static __inline int
+exec386_dynarec_budget_used(void)
+{
+    return cpu_dynarec_compile_budget && (recompiles_this_slice >= cpu_dynarec_compile_budget);
+}
+#    endif
+
+#    ifdef USE_NEW_DYNAREC
+/* ES is changed by too many paths to track through every segment load like DS
+   and SS, so its flatness is sampled whenever a block is about to be looked up.
+   Blocks recompiled with a flat ES omit its segment checks, and are only matched
+   while CPU_STATUS_NOTFLATES is clear */
+static __inline void
+exec386_dynarec_update_flat_es(void)
+{
+    if ((cpu_state.seg_es.base == 0) && (cpu_state.seg_es.limit_low == 0) && (cpu_state.seg_es.limit_high == 0xffffffff))
+        cpu_cur_status &= ~CPU_STATUS_NOTFLATES;
+    else
+        cpu_cur_status |= CPU_STATUS_NOTFLATES;
+}
+#    endif
+
+#    if defined(USE_NEW_DYNAREC) && !defined(USE_GDBSTUB)
+static codeblock_t *chain_prev       = NULL;
+static uint32_t     chain_prev_epoch = 0;
+
+/* Returns non-zero if control can pass straight from one recompiled block to
+   the next, ie. none of the events handled by exec386_dynarec() are pending */
+static __inline int
+exec386_dynarec_can_chain(void)
+{
+    int32_t cycdiff;
+
+    if ((cycles <= 0) || cpu_state.abrt || cpu_init || new_ne || smi_line || x86_was_reset)
+        return 0;
+    if ((nmi && nmi_enable && nmi_mask) || ((cpu_state.flags & I_FLAG) && pic.int_pending))
+        return 0;
+    if (!CACHE_ON() || cpu_override_dynarec || cpu_end_block_after_ins || trap)
+        return 0;
+
+    /* Stop if a timer is due, using the same TSC update as exec386_dynarec() */
+    cycdiff = cycles_old - cycles;
+    if (tsc != tsc_old)
+        cycdiff -= (int32_t) (tsc - tsc_old);
+    if ((cycdiff > 0) && TIMER_VAL_LESS_THAN_VAL(timer_target, (uint32_t) (tsc + cycdiff)))
+        return 0;
+
+    return 1;
+}
+#    endif
+
 #if defined(__linux__) && !defined(__clang__) && defined(USE_NEW_DYNAREC)
 static inline void __attribute__((optimize("O2")))
 #else
@@ -400,7 +459,10 @@ exec386_dynarec_dyn(void)
     uint32_t phys_addr = get_phys(cs + cpu_state.pc);
     int      hash      = HASH(phys_addr);
 #    ifdef USE_NEW_DYNAREC
-    codeblock_t *block = &codeblock[codeblock_hash[hash]];
+    codeblock_t *block;
+
+    exec386_dynarec_update_flat_es();
+    block = &codeblock[codeblock_hash[hash]];
 #    else
     codeblock_t *block = codeblock_hash[hash];
 #    endif
@@ -497,8 +559,14 @@ exec386_dynarec_dyn(void)
                 block->flags |= CODEBLOCK_NO_IMMEDIATES;
             else
                 block->flags |= CODEBLOCK_BYTE_MASK;
+        } else if (valid_block && !(block->flags & (CODEBLOCK_WAS_RECOMPILED | CODEBLOCK_BYTE_MASK)) &&
+                   codegen_smc_use_byte_mask(page)) {
+            /* Page keeps having blocks invalidated by nearby data writes, go
+               straight to byte masks rather than waiting for this block to be
+               invalidated too */
+            block->flags |= CODEBLOCK_BYTE_MASK;
         }
-        if (valid_block && (block->flags & CODEBLOCK_WAS_RECOMPILED) && (block->flags & CODEBLOCK_STATIC_TOP) && block->TOP != (cpu_state.TOP & 7))
+        if (valid_block && (block->flags & CODEBLOCK_WAS_RECOMPILED) && (block->flags & CODEBLOCK_STATIC_TOP) && block->TOP != codegen_fpu_top())
 #    else
         if (valid_block && block->was_recompiled && (block->flags & CODEBLOCK_STATIC_TOP) && block->TOP != cpu_state.TOP)
 #    endif
@@ -515,6 +583,28 @@ exec386_dynarec_dyn(void)
     }
 
 #    ifdef USE_NEW_DYNAREC
+    /* Hot block, recompile it with IR optimisation enabled */
+    if (valid_block && (block->flags & CODEBLOCK_WAS_RECOMPILED) && !(block->flags & CODEBLOCK_OPTIMISED) &&
+        (++block->exec_count >= CODEBLOCK_HOT_THRESHOLD))
+        codegen_block_promote(block);
+#    endif
+
+#    if defined(USE_NEW_DYNAREC) && !defined(USE_GDBSTUB)
+    /* Only a compiled block that runs straight after another one gets linked */
+    if (!valid_block || !(block->flags & CODEBLOCK_WAS_RECOMPILED))
+        chain_prev = NULL;
+#    endif
+
+#    ifdef USE_NEW_DYNAREC
+    /* Block was recompiled in a previous run and its code is unchanged,
+       skip the mark pass and recompile it straight away */
+    if (!valid_block && !cpu_state.abrt && !exec386_dynarec_budget_used() && !pages[phys_addr >> 12].smc_cooldown &&
+        codegen_cache_lookup(phys_addr)) {
+        codegen_block_init(phys_addr);
+        block       = &codeblock[block_current];
+        valid_block = 1;
+    }
+
     if (valid_block && (block->flags & CODEBLOCK_WAS_RECOMPILED))
 #    else
     if (valid_block && block->was_recompiled)
@@ -524,9 +614,20 @@ exec386_dynarec_dyn(void)
 
 #    ifndef USE_NEW_DYNAREC
         codeblock_hash[hash] = block;
+#    endif
+#    ifdef USE_NEW_DYNAREC
+        block->flags |= CODEBLOCK_ACCESSED;
+#    endif
+#    if defined(USE_NEW_DYNAREC) && !defined(USE_GDBSTUB)
+        if (chain_prev && (chain_prev->epoch == chain_prev_epoch))
+            codeblock_chain_link(chain_prev, block);
 #    endif
         inrecomp = 1;
         code();
+        PERF_COUNT(ins, block->ins);
+#    ifdef USE_NEW_DYNAREC
+        codegen_branch_profile_exit(block, cpu_state.pc);
+#    endif
 #    ifdef USE_ACYCS
         acycs = 0;
 #    endif
@@ -536,9 +637,60 @@ exec386_dynarec_dyn(void)
         if (!use32)
             cpu_state.pc &= 0xffff;
 #    endif
-    } else if (valid_block && !cpu_state.abrt) {
+#    if defined(USE_NEW_DYNAREC) && !defined(USE_GDBSTUB)
+        /* Run linked successor blocks for as long as nothing needs the
+           attention of the main loop */
+        while (exec386_dynarec_can_chain()) {
+            codeblock_t *next;
+
+            exec386_dynarec_update_flat_es();
+            next = codeblock_chain_find(block);
+
+            if (!next)
+                break;
+            /* Let the dispatcher promote blocks that have become hot */
+            if (!(next->flags & CODEBLOCK_OPTIMISED) && (++next->exec_count >= CODEBLOCK_HOT_THRESHOLD))
+                break;
+
+            block = next;
+            code  = (void *) &block->data[BLOCK_START];
+            block->flags |= CODEBLOCK_ACCESSED;
+            codegen_stats.chain_hits++;
+
+            inrecomp = 1;
+            code();
+            PERF_COUNT(ins, block->ins);
+            codegen_branch_profile_exit(block, cpu_state.pc);
+#        ifdef USE_ACYCS
+            acycs = 0;
+#        endif
+            inrecomp = 0;
+        }
+
+        if (cpu_state.abrt)
+            chain_prev = NULL;
+        else {
+            chain_prev       = block;
+            chain_prev_epoch = block->epoch;
+        }
+#    endif
+    }
+#    ifdef USE_NEW_DYNAREC
+    /* Page contains code that keeps modifying itself - interpret it until the
+       cooldown runs out */
+    else if (!cpu_state.abrt && codegen_smc_interpret(&pages[phys_addr >> 12]))
+        exec386_dynarec_int();
+    /* Recompile budget for this time slice is used up - interpret the block for
+       now, it will be recompiled when it is next executed in a later slice */
+    else if (valid_block && !cpu_state.abrt && exec386_dynarec_budget_used()) {
+        codegen_stats.blocks_deferred++;
+        exec386_dynarec_int();
+    }
+#    endif
+    else if (valid_block && !cpu_state.abrt) {
 #    ifdef USE_NEW_DYNAREC
         start_pc                 = cs + cpu_state.pc;
+        recompiles_this_slice++;
         const int max_block_size = (block->flags & CODEBLOCK_BYTE_MASK) ? ((128 - 25) - (start_pc & 0x3f)) : 1000;
 #    else
         start_pc = cpu_state.pc;
@@ -552,6 +704,7 @@ exec386_dynarec_dyn(void)
             pthread_jit_write_protect_np(0);
         }
 #    endif
+        MTR_BEGIN("codegen", "recompile");
         codegen_block_start_recompile(block);
         codegen_in_recompile = 1;
 
@@ -580,12 +733,22 @@ exec386_dynarec_dyn(void)
 
                 codegen_generate_call(opcode, x86_opcodes[(opcode | cpu_state.op32) & 0x3ff], fetchdat, cpu_state.pc, cpu_state.pc - 1);
 
+                PERF_COUNT(ins, 1);
                 x86_opcodes[(opcode | cpu_state.op32) & 0x3ff](fetchdat);
 
                 if (x86_was_reset)
                     break;
             }
 
+#    ifdef USE_NEW_DYNAREC
+            /* Branch was compiled as the start of a trace, keep compiling at
+               its destination */
+            if (codegen_trace_branch) {
+                codegen_trace_branch = 0;
+                if (!cpu_state.abrt)
+                    cpu_block_end = 0;
+            }
+#    endif
 #    ifndef USE_NEW_DYNAREC
             if (!use32)
                 cpu_state.pc &= 0xffff;
@@ -638,6 +801,7 @@ exec386_dynarec_dyn(void)
             codegen_reset();
 
         codegen_in_recompile = 0;
+        MTR_END("codegen", "recompile");
 #    if defined(__APPLE__) && defined(__aarch64__)
         if (__builtin_available(macOS 11.0, *)) {
             pthread_jit_write_protect_np(1);
@@ -682,6 +846,7 @@ exec386_dynarec_dyn(void)
 
                 cpu_state.pc++;
 
+                PERF_COUNT(ins, 1);
                 x86_opcodes[(opcode | cpu_state.op32) & 0x3ff](fetchdat);
 
                 if (x86_was_reset)
@@ -760,6 +925,9 @@ exec386_dynarec(int32_t cycs)
 
 #    ifdef USE_ACYCS
     acycs = 0;
+#    endif
+#    ifdef USE_NEW_DYNAREC
+    recompiles_this_slice = 0;
 #    endif
     cycles_main += cycs;
     while (cycles_main > 0) {
@@ -919,7 +1087,7 @@ exec386(int32_t cycs)
             cpu_state.ssegs  = 0;
 
 #ifdef USE_DEBUG_REGS_486
-            if (UNLIKELY(cpu_386_check_instruction_fault())) {
+            if (UNLIKELY(dr[7] & 0xff) && cpu_386_check_instruction_fault()) {
                 x86gen();
                 goto block_ended;
             }
@@ -944,6 +1112,7 @@ exec386(int32_t cycs)
 #ifdef USE_DEBUG_REGS_486
                 cpu_state.eflags &= ~(RF_FLAG);
 #endif
+                PERF_COUNT(ins, 1);
                 x86_opcodes[(opcode | cpu_state.op32) & 0x3ff](fetchdat);
                 if (x86_was_reset)
                     break;
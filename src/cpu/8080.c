@@ -71,7 +71,7 @@ readmemb(uint32_t a)
     uint8_t ret;
 
     i8080_wait(4, 1);
-    ret = read_mem_b(a);
+    ret = read_mem_b_fast(a);
 
     return ret;
 }
@@ -35,6 +35,7 @@
 #include <86box/ppi.h>
 #include <86box/timer.h>
 #include <86box/gdbstub.h>
+#include <86box/perf.h>
 #include <86box/plat_unused.h>
 
 /* Is the CPU 8088 or 8086. */
@@ -326,7 +327,7 @@ readmemb(uint32_t a)
     uint8_t ret;
 
     wait(4, 1);
-    ret = read_mem_b(a);
+    ret = read_mem_b_fast(a);
 
     return ret;
 }
@@ -338,7 +339,7 @@ readmembf(uint32_t a)
     uint8_t ret;
 
     a   = cs + (a & 0xffff);
-    ret = read_mem_b(a);
+    ret = read_mem_b_fast(a);
 
     return ret;
 }
@@ -351,11 +352,11 @@ readmemw(uint32_t s, uint16_t a)
 
     wait(4, 1);
     if (is8086 && !(a & 1))
-        ret = read_mem_w(s + a);
+        ret = read_mem_w_fast(s + a);
     else {
         wait(4, 1);
-        ret = read_mem_b(s + a);
-        ret |= read_mem_b(s + ((is186 && !is_nec) ? (a + 1) : (a + 1) & 0xffff)) << 8;
+        ret = read_mem_b_fast(s + a);
+        ret |= read_mem_b_fast(s + ((is186 && !is_nec) ? (a + 1) : (a + 1) & 0xffff)) << 8;
     }
 
     return ret;
@@ -366,7 +367,7 @@ readmemwf(uint16_t a)
 {
     uint16_t ret;
 
-    ret = read_mem_w(cs + (a & 0xffff));
+    ret = read_mem_w_fast(cs + (a & 0xffff));
 
     return ret;
 }
@@ -409,7 +410,7 @@ writememb(uint32_t s, uint32_t a, uint8_t v)
     uint32_t addr = s + a;
 
     wait(4, 1);
-    write_mem_b(addr, v);
+    write_mem_b_fast(addr, v);
 
     if ((addr >= 0xf0000) && (addr <= 0xfffff))
         last_addr = addr & 0xffff;
@@ -423,12 +424,12 @@ writememw(uint32_t s, uint32_t a, uint16_t v)
 
     wait(4, 1);
     if (is8086 && !(a & 1))
-        write_mem_w(addr, v);
+        write_mem_w_fast(addr, v);
     else {
-        write_mem_b(addr, v & 0xff);
+        write_mem_b_fast(addr, v & 0xff);
         wait(4, 1);
         addr = s + ((is186 && !is_nec) ? (a + 1) : ((a + 1) & 0xffff));
-        write_mem_b(addr, v >> 8);
+        write_mem_b_fast(addr, v >> 8);
     }
 
     if ((addr >= 0xf0000) && (addr <= 0xfffff))
@@ -544,20 +545,34 @@ pfq_fetch(void)
         return (uint16_t) pfq_fetchb();
 }
 
-/* Adds bytes to the prefetch queue based on the instruction's cycle count. */
+/* Adds bytes to the prefetch queue based on the instruction's cycle count.
+
+   This is called for almost every cycle the CPU spends, so rather than stepping
+   the BIU one cycle at a time, work out how many times it reaches the end of a
+   bus cycle in the next c cycles and only do the fetches. */
 static void
 pfq_add(int c, int add)
 {
-    int d;
+    int first;
+    int fetches;
 
     if ((c <= 0) || (pfq_pos >= pfq_size))
         return;
 
-    for (d = 0; d < c; d++) {
-        biu_cycles = (biu_cycles + 1) & 0x03;
-        if (prefetching && add && (biu_cycles == 0x00))
-            pfq_write();
+    if (prefetching && add) {
+        /* Number of cycles until the BIU next wraps around to 0. */
+        first = ((3 - biu_cycles) & 0x03) + 1;
+
+        if (c >= first) {
+            fetches = ((c - first) >> 2) + 1;
+
+            /* pfq_write() does nothing once the queue is full. */
+            while (fetches-- && (pfq_pos < pfq_size))
+                pfq_write();
+        }
     }
+
+    biu_cycles = (biu_cycles + c) & 0x03;
 }
 
 /* Clear the prefetch queue - called on reset and on anything that affects either CS or IP. */
@@ -1775,6 +1790,7 @@ execx86(int cycs)
             cpu_state.oldpc = cpu_state.pc;
             opcode          = pfq_fetchb();
             handled         = 0;
+            PERF_COUNT(ins, 1);
             oldc            = cpu_state.flags & C_FLAG;
             if (clear_lock) {
                 in_lock    = 0;
@@ -2191,10 +2207,10 @@ execx86(int cycs)
                                 wait(5, 0);
                                 for (i = 0; i < ((nibbles_count / 2) + odd); i++) {
                                     wait(19, 0);
-                                    destcmp = read_mem_b((es) + DI + i);
+                                    destcmp = read_mem_b_fast((es) + DI + i);
                                     for (nibble = 0; nibble < 2; nibble++) {
                                         destbyte = destcmp >> (nibble ? 4 : 0);
-                                        srcbyte  = read_mem_b(srcseg + SI + i) >> (nibble ? 4 : 0);
+                                        srcbyte  = read_mem_b_fast(srcseg + SI + i) >> (nibble ? 4 : 0);
                                         destbyte &= 0xF;
                                         srcbyte &= 0xF;
                                         nibble_result = (i == (nibbles_count / 2) && nibble == 1) ? (destbyte + carry) : ((uint8_t) (destbyte)) + ((uint8_t) (srcbyte)) + ((uint32_t) carry);
@@ -2207,7 +2223,7 @@ execx86(int cycs)
                                             zero = (nibble_result == 0);
                                         destcmp = ((destcmp & (nibble ? 0x0F : 0xF0)) | (nibble_result << (4 * nibble)));
                                     }
-                                    write_mem_b(es + DI + i, destcmp);
+                                    write_mem_b_fast(es + DI + i, destcmp);
                                 }
                                 set_cf(!!carry);
                                 set_zf(!!zero);
@@ -2226,10 +2242,10 @@ execx86(int cycs)
                                 wait(5, 0);
                                 for (i = 0; i < ((nibbles_count / 2) + odd); i++) {
                                     wait(19, 0);
-                                    destcmp = read_mem_b((es) + DI + i);
+                                    destcmp = read_mem_b_fast((es) + DI + i);
                                     for (nibble = 0; nibble < 2; nibble++) {
                                         destbyte = destcmp >> (nibble ? 4 : 0);
-                                        srcbyte  = read_mem_b(srcseg + SI + i) >> (nibble ? 4 : 0);
+                                        srcbyte  = read_mem_b_fast(srcseg + SI + i) >> (nibble ? 4 : 0);
                                         destbyte &= 0xF;
                                         srcbyte &= 0xF;
                                         nibble_result_s = (i == (nibbles_count / 2) && nibble == 1) ? ((int8_t) destbyte - (int8_t) carry) : ((int8_t) (destbyte)) - ((int8_t) (srcbyte)) - ((int8_t) carry);
@@ -2242,7 +2258,7 @@ execx86(int cycs)
                                             zero = (nibble_result_s == 0);
                                         destcmp = ((destcmp & (nibble ? 0x0F : 0xF0)) | (nibble_result_s << (4 * nibble)));
                                     }
-                                    write_mem_b(es + DI + i, destcmp);
+                                    write_mem_b_fast(es + DI + i, destcmp);
                                 }
                                 set_cf(!!carry);
                                 set_zf(!!zero);
@@ -2261,10 +2277,10 @@ execx86(int cycs)
                                 wait(5, 0);
                                 for (i = 0; i < ((nibbles_count / 2) + odd); i++) {
                                     wait(19, 0);
-                                    destcmp = read_mem_b((es) + DI + i);
+                                    destcmp = read_mem_b_fast((es) + DI + i);
                                     for (nibble = 0; nibble < 2; nibble++) {
                                         destbyte = destcmp >> (nibble ? 4 : 0);
-                                        srcbyte  = read_mem_b(srcseg + SI + i) >> (nibble ? 4 : 0);
+                                        srcbyte  = read_mem_b_fast(srcseg + SI + i) >> (nibble ? 4 : 0);
                                         destbyte &= 0xF;
                                         srcbyte &= 0xF;
                                         nibble_result_s = ((int8_t) (destbyte)) - ((int8_t) (srcbyte)) - ((int8_t) carry);
@@ -2300,7 +2316,7 @@ execx86(int cycs)
                                 }
                                 for (i = 0; i < bit_length; i++) {
                                     byteaddr = (es) + DI;
-                                    writememb(es, DI, (read_mem_b(byteaddr) & ~(1 << (bit_offset))) | ((!!(AX & (1 << i))) << bit_offset));
+                                    writememb(es, DI, (read_mem_b_fast(byteaddr) & ~(1 << (bit_offset))) | ((!!(AX & (1 << i))) << bit_offset));
                                     bit_offset++;
                                     if (bit_offset == 8) {
                                         DI++;
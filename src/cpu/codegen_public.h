@@ -50,6 +50,13 @@
 #endif
 
 extern void codegen_init(void);
+#ifdef USE_NEW_DYNAREC
+extern void codegen_close(void);
+/*Called once a second from the CPU thread, dumps statistics if enabled*/
+extern void codegen_stats_tick(void);
+/*Percentage of the code cache in use*/
+extern int codegen_cache_usage_pct(void);
+#endif
 extern void codegen_flush(void);
 
 /*Current physical page of block being recompiled. -1 if no recompilation taking place */
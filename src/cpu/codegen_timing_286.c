@@ -0,0 +1,408 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <wchar.h>
+#include <86box/86box.h>
+#include "cpu.h"
+#include <86box/mem.h>
+#include <86box/plat_unused.h>
+
+#include "x86.h"
+#include "x86_ops.h"
+#include "x87_sf.h"
+#include "x87.h"
+#include "codegen.h"
+#include "codegen_ops.h"
+#include "codegen_timing_common.h"
+
+/*286 timings, with a 287 FPU. The 286 is not pipelined beyond its prefetch
+  queue, so unlike the 486 model there are no AGI stalls - instead, effective
+  addresses with a base, an index and a displacement take one extra cycle.
+  Shifts and rotates by more than one bit are counted as if the count were 0*/
+
+#define CYCLES(c) (int *) c
+
+static int *opcode_timings_286[256] = {
+    // clang-format off
+/*00*/  &timing_mr,     &timing_mr,     &timing_rm,     &timing_rm,     CYCLES(3),      CYCLES(3),      CYCLES(3),      CYCLES(5),      &timing_mr,     &timing_mr,     &timing_rm,     &timing_rm,     CYCLES(3),      CYCLES(3),      CYCLES(3),      NULL,
+/*10*/  &timing_mr,     &timing_mr,     &timing_rm,     &timing_rm,     CYCLES(3),      CYCLES(3),      CYCLES(3),      CYCLES(5),      &timing_mr,     &timing_mr,     &timing_rm,     &timing_rm,     CYCLES(3),      CYCLES(3),      CYCLES(3),      CYCLES(5),
+/*20*/  &timing_mr,     &timing_mr,     &timing_rm,     &timing_rm,     CYCLES(3),      CYCLES(3),      CYCLES(0),      CYCLES(3),      &timing_mr,     &timing_mr,     &timing_rm,     &timing_rm,     CYCLES(3),      CYCLES(3),      CYCLES(0),      CYCLES(3),
+/*30*/  &timing_mr,     &timing_mr,     &timing_rm,     &timing_rm,     CYCLES(3),      CYCLES(3),      CYCLES(0),      CYCLES(3),      &timing_mr,     &timing_mr,     &timing_rm,     &timing_rm,     CYCLES(3),      CYCLES(3),      CYCLES(0),      CYCLES(3),
+
+/*40*/  &timing_rr,     &timing_rr,     &timing_rr,     &timing_rr,     &timing_rr,     &timing_rr,     &timing_rr,     &timing_rr,     &timing_rr,     &timing_rr,     &timing_rr,     &timing_rr,     &timing_rr,     &timing_rr,     &timing_rr,     &timing_rr,
+/*50*/  CYCLES(3),      CYCLES(3),      CYCLES(3),      CYCLES(3),      CYCLES(3),      CYCLES(3),      CYCLES(3),      CYCLES(3),      CYCLES(5),      CYCLES(5),      CYCLES(5),      CYCLES(5),      CYCLES(5),      CYCLES(5),      CYCLES(5),      CYCLES(5),
+/*60*/  CYCLES(17),     CYCLES(19),     CYCLES(13),     CYCLES(11),     NULL,           NULL,           NULL,           NULL,           CYCLES(3),      CYCLES(24),     CYCLES(3),      CYCLES(24),     CYCLES(5),      CYCLES(5),      CYCLES(5),      CYCLES(5),
+/*70*/  &timing_bnt,    &timing_bnt,    &timing_bnt,    &timing_bnt,    &timing_bnt,    &timing_bnt,    &timing_bnt,    &timing_bnt,    &timing_bnt,    &timing_bnt,    &timing_bnt,    &timing_bnt,    &timing_bnt,    &timing_bnt,    &timing_bnt,    &timing_bnt,
+
+/*80*/  NULL,           NULL,           NULL,           NULL,           &timing_rm,     &timing_rm,     CYCLES(5),      CYCLES(5),      CYCLES(3),      CYCLES(3),      CYCLES(5),      CYCLES(5),      CYCLES(3),      CYCLES(3),      CYCLES(5),      CYCLES(5),
+/*90*/  CYCLES(3),      CYCLES(3),      CYCLES(3),      CYCLES(3),      CYCLES(3),      CYCLES(3),      CYCLES(3),      CYCLES(3),      CYCLES(2),      CYCLES(2),      CYCLES(13),     CYCLES(3),      CYCLES(3),      CYCLES(5),      CYCLES(2),      CYCLES(2),
+/*a0*/  CYCLES(5),      CYCLES(5),      CYCLES(3),      CYCLES(3),      CYCLES(5),      CYCLES(5),      CYCLES(8),      CYCLES(8),      CYCLES(3),      CYCLES(3),      CYCLES(3),      CYCLES(3),      CYCLES(5),      CYCLES(5),      CYCLES(7),      CYCLES(7),
+/*b0*/  &timing_rr,     &timing_rr,     &timing_rr,     &timing_rr,     &timing_rr,     &timing_rr,     &timing_rr,     &timing_rr,     &timing_rr,     &timing_rr,     &timing_rr,     &timing_rr,     &timing_rr,     &timing_rr,     &timing_rr,     &timing_rr,
+
+/*c0*/  NULL,           NULL,           CYCLES(11),     CYCLES(11),     CYCLES(7),      CYCLES(7),      CYCLES(3),      CYCLES(3),      CYCLES(11),     CYCLES(5),      CYCLES(15),     CYCLES(15),     CYCLES(23),     CYCLES(23),     CYCLES(3),      CYCLES(17),
+/*d0*/  NULL,           NULL,           NULL,           NULL,           CYCLES(16),     CYCLES(14),     CYCLES(2),      CYCLES(5),      NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,
+/*e0*/  CYCLES(8),      CYCLES(8),      CYCLES(8),      CYCLES(8),      CYCLES(5),      CYCLES(5),      CYCLES(3),      CYCLES(3),      CYCLES(7),      CYCLES(7),      CYCLES(11),     CYCLES(7),      CYCLES(5),      CYCLES(5),      CYCLES(3),      CYCLES(3),
+/*f0*/  CYCLES(0),      NULL,           CYCLES(0),      CYCLES(0),      CYCLES(2),      CYCLES(2),      NULL,           NULL,           CYCLES(2),      CYCLES(2),      CYCLES(2),      CYCLES(2),      CYCLES(2),      CYCLES(2),      CYCLES(7),      NULL
+    // clang-format on
+};
+
+static int *opcode_timings_286_mod3[256] = {
+    // clang-format off
+/*00*/  &timing_rr,     &timing_rr,     &timing_rr,     &timing_rr,     CYCLES(3),      CYCLES(3),      CYCLES(3),      CYCLES(5),      &timing_rr,     &timing_rr,     &timing_rr,     &timing_rr,     CYCLES(3),      CYCLES(3),      CYCLES(3),      NULL,
+/*10*/  &timing_rr,     &timing_rr,     &timing_rr,     &timing_rr,     CYCLES(3),      CYCLES(3),      CYCLES(3),      CYCLES(5),      &timing_rr,     &timing_rr,     &timing_rr,     &timing_rr,     CYCLES(3),      CYCLES(3),      CYCLES(3),      CYCLES(5),
+/*20*/  &timing_rr,     &timing_rr,     &timing_rr,     &timing_rr,     CYCLES(3),      CYCLES(3),      CYCLES(0),      CYCLES(3),      &timing_rr,     &timing_rr,     &timing_rr,     &timing_rr,     CYCLES(3),      CYCLES(3),      CYCLES(0),      CYCLES(3),
+/*30*/  &timing_rr,     &timing_rr,     &timing_rr,     &timing_rr,     CYCLES(3),      CYCLES(3),      CYCLES(0),      CYCLES(3),      &timing_rr,     &timing_rr,     &timing_rr,     &timing_rr,     CYCLES(3),      CYCLES(3),      CYCLES(0),      CYCLES(3),
+
+/*40*/  &timing_rr,     &timing_rr,     &timing_rr,     &timing_rr,     &timing_rr,     &timing_rr,     &timing_rr,     &timing_rr,     &timing_rr,     &timing_rr,     &timing_rr,     &timing_rr,     &timing_rr,     &timing_rr,     &timing_rr,     &timing_rr,
+/*50*/  CYCLES(3),      CYCLES(3),      CYCLES(3),      CYCLES(3),      CYCLES(3),      CYCLES(3),      CYCLES(3),      CYCLES(3),      CYCLES(5),      CYCLES(5),      CYCLES(5),      CYCLES(5),      CYCLES(5),      CYCLES(5),      CYCLES(5),      CYCLES(5),
+/*60*/  CYCLES(17),     CYCLES(19),     CYCLES(13),     CYCLES(10),     NULL,           NULL,           NULL,           NULL,           CYCLES(3),      CYCLES(21),     CYCLES(3),      CYCLES(21),     CYCLES(5),      CYCLES(5),      CYCLES(5),      CYCLES(5),
+/*70*/  &timing_bnt,    &timing_bnt,    &timing_bnt,    &timing_bnt,    &timing_bnt,    &timing_bnt,    &timing_bnt,    &timing_bnt,    &timing_bnt,    &timing_bnt,    &timing_bnt,    &timing_bnt,    &timing_bnt,    &timing_bnt,    &timing_bnt,    &timing_bnt,
+
+/*80*/  NULL,           NULL,           NULL,           NULL,           &timing_rr,     &timing_rr,     CYCLES(3),      CYCLES(3),      &timing_rr,     &timing_rr,     &timing_rr,     &timing_rr,     &timing_rr,     CYCLES(3),      &timing_rr,     CYCLES(5),
+/*90*/  CYCLES(3),      CYCLES(3),      CYCLES(3),      CYCLES(3),      CYCLES(3),      CYCLES(3),      CYCLES(3),      CYCLES(3),      CYCLES(2),      CYCLES(2),      CYCLES(13),     CYCLES(3),      CYCLES(3),      CYCLES(5),      CYCLES(2),      CYCLES(2),
+/*a0*/  CYCLES(5),      CYCLES(5),      CYCLES(3),      CYCLES(3),      CYCLES(5),      CYCLES(5),      CYCLES(8),      CYCLES(8),      CYCLES(3),      CYCLES(3),      CYCLES(3),      CYCLES(3),      CYCLES(5),      CYCLES(5),      CYCLES(7),      CYCLES(7),
+/*b0*/  &timing_rr,     &timing_rr,     &timing_rr,     &timing_rr,     &timing_rr,     &timing_rr,     &timing_rr,     &timing_rr,     &timing_rr,     &timing_rr,     &timing_rr,     &timing_rr,     &timing_rr,     &timing_rr,     &timing_rr,     &timing_rr,
+
+/*c0*/  NULL,           NULL,           CYCLES(11),     CYCLES(11),     CYCLES(7),      CYCLES(7),      CYCLES(2),      CYCLES(2),      CYCLES(11),     CYCLES(5),      CYCLES(15),     CYCLES(15),     CYCLES(23),     CYCLES(23),     CYCLES(3),      CYCLES(17),
+/*d0*/  NULL,           NULL,           NULL,           NULL,           CYCLES(16),     CYCLES(14),     CYCLES(2),      CYCLES(5),      NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,
+/*e0*/  CYCLES(8),      CYCLES(8),      CYCLES(8),      CYCLES(8),      CYCLES(5),      CYCLES(5),      CYCLES(3),      CYCLES(3),      CYCLES(7),      CYCLES(7),      CYCLES(11),     CYCLES(7),      CYCLES(5),      CYCLES(5),      CYCLES(3),      CYCLES(3),
+/*f0*/  CYCLES(0),      NULL,           CYCLES(0),      CYCLES(0),      CYCLES(2),      CYCLES(2),      NULL,           NULL,           CYCLES(2),      CYCLES(2),      CYCLES(2),      CYCLES(2),      CYCLES(2),      CYCLES(2),      CYCLES(2),      NULL
+    // clang-format on
+};
+
+static int *opcode_timings_286_0f[256] = {
+    // clang-format off
+/*00*/  CYCLES(17),     CYCLES(11),     CYCLES(16),     CYCLES(16),     NULL,           CYCLES(195),    CYCLES(2),      NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,
+/*10*/  NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,
+/*20*/  NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,
+/*30*/  NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,
+
+/*40*/  NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,
+/*50*/  NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,
+/*60*/  NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,
+/*70*/  NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,
+
+/*80*/  NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,
+/*90*/  NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,
+/*a0*/  NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,
+/*b0*/  NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,
+
+/*c0*/  NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,
+/*d0*/  NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,
+/*e0*/  NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,
+/*f0*/  NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,
+    // clang-format on
+};
+static int *opcode_timings_286_0f_mod3[256] = {
+    // clang-format off
+/*00*/  CYCLES(17),     CYCLES(11),     CYCLES(14),     CYCLES(14),     NULL,           CYCLES(195),    CYCLES(2),      NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,
+/*10*/  NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,
+/*20*/  NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,
+/*30*/  NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,
+
+/*40*/  NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,
+/*50*/  NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,
+/*60*/  NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,
+/*70*/  NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,
+
+/*80*/  NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,
+/*90*/  NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,
+/*a0*/  NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,
+/*b0*/  NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,
+
+/*c0*/  NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,
+/*d0*/  NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,
+/*e0*/  NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,
+/*f0*/  NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,
+    // clang-format on
+};
+
+static int *opcode_timings_286_shift[8] = {
+    // clang-format off
+        CYCLES(8),      CYCLES(8),      CYCLES(8),      CYCLES(8),      CYCLES(8),      CYCLES(8),      CYCLES(8),      CYCLES(8)
+    // clang-format on
+};
+static int *opcode_timings_286_shift_mod3[8] = {
+    // clang-format off
+        CYCLES(5),      CYCLES(5),      CYCLES(5),      CYCLES(5),      CYCLES(5),      CYCLES(5),      CYCLES(5),      CYCLES(5)
+    // clang-format on
+};
+static int *opcode_timings_286_shift_1[8] = {
+    // clang-format off
+        CYCLES(7),      CYCLES(7),      CYCLES(7),      CYCLES(7),      CYCLES(7),      CYCLES(7),      CYCLES(7),      CYCLES(7)
+    // clang-format on
+};
+static int *opcode_timings_286_shift_1_mod3[8] = {
+    // clang-format off
+        &timing_rr,     &timing_rr,     &timing_rr,     &timing_rr,     &timing_rr,     &timing_rr,     &timing_rr,     &timing_rr
+    // clang-format on
+};
+
+static int *opcode_timings_286_f6[8] = {
+    // clang-format off
+        CYCLES(6),      NULL,           &timing_mm,     &timing_mm,     CYCLES(16),     CYCLES(16),     CYCLES(17),     CYCLES(20)
+    // clang-format on
+};
+static int *opcode_timings_286_f6_mod3[8] = {
+    // clang-format off
+        CYCLES(3),      NULL,           &timing_rr,     &timing_rr,     CYCLES(13),     CYCLES(13),     CYCLES(14),     CYCLES(17)
+    // clang-format on
+};
+static int *opcode_timings_286_f7[8] = {
+    // clang-format off
+        CYCLES(6),      NULL,           &timing_mm,     &timing_mm,     CYCLES(24),     CYCLES(24),     CYCLES(25),     CYCLES(28)
+    // clang-format on
+};
+static int *opcode_timings_286_f7_mod3[8] = {
+    // clang-format off
+        CYCLES(3),      NULL,           &timing_rr,     &timing_rr,     CYCLES(21),     CYCLES(21),     CYCLES(22),     CYCLES(25)
+    // clang-format on
+};
+static int *opcode_timings_286_ff[8] = {
+    // clang-format off
+        &timing_mm,     &timing_mm,     CYCLES(11),     CYCLES(16),     CYCLES(11),     CYCLES(15),     CYCLES(5),      NULL
+    // clang-format on
+};
+static int *opcode_timings_286_ff_mod3[8] = {
+    // clang-format off
+        &timing_rr,     &timing_rr,     CYCLES(7),      CYCLES(16),     CYCLES(7),      CYCLES(15),     CYCLES(3),      NULL
+    // clang-format on
+};
+
+static int *opcode_timings_286_d8[8] = {
+    // clang-format off
+/*      FADDs           FMULs           FCOMs           FCOMPs          FSUBs           FSUBRs          FDIVs           FDIVRs*/
+        CYCLES(105),    CYCLES(118),    CYCLES(65),     CYCLES(67),     CYCLES(105),    CYCLES(105),    CYCLES(220),    CYCLES(221)
+    // clang-format on
+};
+static int *opcode_timings_286_d8_mod3[8] = {
+    // clang-format off
+/*      FADD            FMUL            FCOM            FCOMP           FSUB            FSUBR           FDIV            FDIVR*/
+        CYCLES(85),     CYCLES(130),    CYCLES(45),     CYCLES(47),     CYCLES(85),     CYCLES(87),     CYCLES(198),    CYCLES(199)
+    // clang-format on
+};
+
+static int *opcode_timings_286_d9[8] = {
+    // clang-format off
+/*      FLDs                            FSTs            FSTPs           FLDENV          FLDCW           FSTENV          FSTCW*/
+        CYCLES(40),     NULL,           CYCLES(87),     CYCLES(89),     CYCLES(40),     CYCLES(10),     CYCLES(45),     CYCLES(15)
+    // clang-format on
+};
+static int *opcode_timings_286_d9_mod3[64] = {
+    // clang-format off
+        /*FLD*/
+        CYCLES(20),     CYCLES(20),     CYCLES(20),     CYCLES(20),     CYCLES(20),     CYCLES(20),     CYCLES(20),     CYCLES(20),
+        /*FXCH*/
+        CYCLES(12),     CYCLES(12),     CYCLES(12),     CYCLES(12),     CYCLES(12),     CYCLES(12),     CYCLES(12),     CYCLES(12),
+        /*FNOP*/
+        CYCLES(13),     NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,
+        /*FSTP*/
+        CYCLES(20),     CYCLES(20),     CYCLES(20),     CYCLES(20),     CYCLES(20),     CYCLES(20),     CYCLES(20),     CYCLES(20),
+/*      opFCHS          opFABS                                          opFTST          opFXAM*/
+        CYCLES(15),     CYCLES(14),     NULL,           NULL,           CYCLES(42),     CYCLES(17),     NULL,           NULL,
+/*      opFLD1          opFLDL2T        opFLDL2E        opFLDPI         opFLDEG2        opFLDLN2        opFLDZ*/
+        CYCLES(18),     CYCLES(19),     CYCLES(18),     CYCLES(19),     CYCLES(21),     CYCLES(20),     CYCLES(14),     NULL,
+/*      opF2XM1         opFYL2X         opFPTAN         opFPATAN        opFXTRACT                       opFDECSTP       opFINCSTP*/
+        CYCLES(500),    CYCLES(950),    CYCLES(450),    CYCLES(650),    CYCLES(50),     NULL,           CYCLES(9),      CYCLES(9),
+/*      opFPREM         opFYL2XP1       opFSQRT                         opFRNDINT       opFSCALE*/
+        CYCLES(125),    CYCLES(850),    CYCLES(183),    NULL,           CYCLES(45),     CYCLES(35),     NULL,           NULL
+    // clang-format on
+};
+
+static int *opcode_timings_286_da[8] = {
+    // clang-format off
+/*      FIADDl          FIMULl          FICOMl          FICOMPl         FISUBl          FISUBRl         FIDIVl          FIDIVRl*/
+        CYCLES(125),    CYCLES(136),    CYCLES(85),     CYCLES(87),     CYCLES(125),    CYCLES(125),    CYCLES(236),    CYCLES(237)
+    // clang-format on
+};
+static int *opcode_timings_286_da_mod3[8] = {
+    // clang-format off
+        NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL
+    // clang-format on
+};
+
+static int *opcode_timings_286_db[8] = {
+    // clang-format off
+/*      FILDl                           FISTl           FISTPl                          FLDe                            FSTPe*/
+        CYCLES(56),     NULL,           CYCLES(88),     CYCLES(90),     NULL,           CYCLES(57),     NULL,           CYCLES(55)
+    // clang-format on
+};
+static int *opcode_timings_286_db_mod3[64] = {
+    // clang-format off
+        NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,
+        NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,
+        NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,
+        NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,
+/*      opFENI          opFDISI         opFCLEX         opFINIT         opFSETPM*/
+        CYCLES(5),      CYCLES(5),      CYCLES(5),      CYCLES(5),      CYCLES(5),      NULL,           NULL,           NULL,
+        NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,
+        NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,
+        NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL,           NULL
+    // clang-format on
+};
+
+static int *opcode_timings_286_dc[8] = {
+    // clang-format off
+/*      FADDd           FMULd           FCOMd           FCOMPd          FSUBd           FSUBRd          FDIVd           FDIVRd*/
+        CYCLES(110),    CYCLES(140),    CYCLES(70),     CYCLES(72),     CYCLES(110),    CYCLES(110),    CYCLES(225),    CYCLES(226)
+    // clang-format on
+};
+static int *opcode_timings_286_dc_mod3[8] = {
+    // clang-format off
+/*      opFADDr         opFMULr                                         opFSUBRr        opFSUBr         opFDIVRr        opFDIVr*/
+        CYCLES(85),     CYCLES(130),    NULL,           NULL,           CYCLES(87),     CYCLES(85),     CYCLES(199),    CYCLES(198)
+    // clang-format on
+};
+
+static int *opcode_timings_286_dd[8] = {
+    // clang-format off
+/*      FLDd                            FSTd            FSTPd           FRSTOR                          FSAVE           FSTSW*/
+        CYCLES(48),     NULL,           CYCLES(100),    CYCLES(102),    CYCLES(200),    NULL,           CYCLES(200),    CYCLES(15)
+    // clang-format on
+};
+static int *opcode_timings_286_dd_mod3[8] = {
+    // clang-format off
+/*      FFREE                           FST             FSTP*/
+        CYCLES(12),     NULL,           CYCLES(18),     CYCLES(20),     NULL,           NULL,           NULL,           NULL
+    // clang-format on
+};
+
+static int *opcode_timings_286_de[8] = {
+    // clang-format off
+/*      FIADDw          FIMULw          FICOMw          FICOMPw         FISUBw          FISUBRw         FIDIVw          FIDIVRw*/
+        CYCLES(120),    CYCLES(130),    CYCLES(80),     CYCLES(82),     CYCLES(120),    CYCLES(120),    CYCLES(230),    CYCLES(230)
+    // clang-format on
+};
+static int *opcode_timings_286_de_mod3[8] = {
+    // clang-format off
+/*      FADDP           FMULP                           FCOMPP          FSUBRP          FSUBP           FDIVRP          FDIVP*/
+        CYCLES(90),     CYCLES(134),    NULL,           CYCLES(50),     CYCLES(90),     CYCLES(90),     CYCLES(202),    CYCLES(202)
+    // clang-format on
+};
+
+static int *opcode_timings_286_df[8] = {
+    // clang-format off
+/*      FILDw                           FISTw           FISTPw          FBLD            FILDq           FBSTP           FISTPq*/
+        CYCLES(50),     NULL,           CYCLES(86),     CYCLES(88),     CYCLES(300),    CYCLES(64),     CYCLES(530),    CYCLES(100)
+    // clang-format on
+};
+static int *opcode_timings_286_df_mod3[8] = {
+    // clang-format off
+/*                                                                      FSTSW AX*/
+        NULL,           NULL,           NULL,           NULL,           CYCLES(13),     NULL,           NULL,           NULL
+    // clang-format on
+};
+
+static int *opcode_timings_286_8x[8] = {
+    // clang-format off
+        &timing_mr,     &timing_mr,     &timing_mr,     &timing_mr,     &timing_mr,     &timing_mr,     &timing_mr,     CYCLES(6)
+    // clang-format on
+};
+static int *opcode_timings_286_8x_mod3[8] = {
+    // clang-format off
+        CYCLES(3),      CYCLES(3),      CYCLES(3),      CYCLES(3),      CYCLES(3),      CYCLES(3),      CYCLES(3),      CYCLES(3)
+    // clang-format on
+};
+
+static int timing_count;
+static uint8_t last_prefix;
+
+static inline int
+COUNT(int *c)
+{
+    if ((uintptr_t) c <= 10000)
+        return (int) (uintptr_t) c;
+    return *c;
+}
+
+void
+codegen_timing_286_block_start(void)
+{
+    //
+}
+
+static codegen_timing_map_t opcode_map;
+static int                  opcode_map_built = 0;
+
+static void
+codegen_timing_286_map_init(void)
+{
+    codegen_timing_map_init(&opcode_map, opcode_timings_286, opcode_timings_286_mod3, opcode_deps, opcode_deps_mod3);
+
+    codegen_timing_map_prefix(&opcode_map, 0x0f, opcode_timings_286_0f, opcode_timings_286_0f_mod3, opcode_deps_0f, opcode_deps_0f_mod3, CODEGEN_TIMING_IDX_OPCODE, CODEGEN_TIMING_IDX_OPCODE);
+    codegen_timing_map_prefix(&opcode_map, 0xd8, opcode_timings_286_d8, opcode_timings_286_d8_mod3, opcode_deps_d8, opcode_deps_d8_mod3, CODEGEN_TIMING_IDX_REG, CODEGEN_TIMING_IDX_REG);
+    codegen_timing_map_prefix(&opcode_map, 0xd9, opcode_timings_286_d9, opcode_timings_286_d9_mod3, opcode_deps_d9, opcode_deps_d9_mod3, CODEGEN_TIMING_IDX_REG, CODEGEN_TIMING_IDX_LOW6);
+    codegen_timing_map_prefix(&opcode_map, 0xda, opcode_timings_286_da, opcode_timings_286_da_mod3, opcode_deps_da, opcode_deps_da_mod3, CODEGEN_TIMING_IDX_REG, CODEGEN_TIMING_IDX_REG);
+    codegen_timing_map_prefix(&opcode_map, 0xdb, opcode_timings_286_db, opcode_timings_286_db_mod3, opcode_deps_db, opcode_deps_db_mod3, CODEGEN_TIMING_IDX_REG, CODEGEN_TIMING_IDX_LOW6);
+    codegen_timing_map_prefix(&opcode_map, 0xdc, opcode_timings_286_dc, opcode_timings_286_dc_mod3, opcode_deps_dc, opcode_deps_dc_mod3, CODEGEN_TIMING_IDX_REG, CODEGEN_TIMING_IDX_REG);
+    codegen_timing_map_prefix(&opcode_map, 0xdd, opcode_timings_286_dd, opcode_timings_286_dd_mod3, opcode_deps_dd, opcode_deps_dd_mod3, CODEGEN_TIMING_IDX_REG, CODEGEN_TIMING_IDX_REG);
+    codegen_timing_map_prefix(&opcode_map, 0xde, opcode_timings_286_de, opcode_timings_286_de_mod3, opcode_deps_de, opcode_deps_de_mod3, CODEGEN_TIMING_IDX_REG, CODEGEN_TIMING_IDX_REG);
+    codegen_timing_map_prefix(&opcode_map, 0xdf, opcode_timings_286_df, opcode_timings_286_df_mod3, opcode_deps_df, opcode_deps_df_mod3, CODEGEN_TIMING_IDX_REG, CODEGEN_TIMING_IDX_REG);
+
+    codegen_timing_map_group(&opcode_map, 0x80, opcode_timings_286_8x, opcode_timings_286_8x_mod3, opcode_deps_8x, opcode_deps_8x_mod3);
+    codegen_timing_map_group(&opcode_map, 0x81, opcode_timings_286_8x, opcode_timings_286_8x_mod3, opcode_deps_81, opcode_deps_81_mod3);
+    codegen_timing_map_group(&opcode_map, 0x82, opcode_timings_286_8x, opcode_timings_286_8x_mod3, opcode_deps_8x, opcode_deps_8x_mod3);
+    codegen_timing_map_group(&opcode_map, 0x83, opcode_timings_286_8x, opcode_timings_286_8x_mod3, opcode_deps_8x, opcode_deps_8x_mod3);
+    codegen_timing_map_group(&opcode_map, 0xc0, opcode_timings_286_shift, opcode_timings_286_shift_mod3, opcode_deps_shift, opcode_deps_shift_mod3);
+    codegen_timing_map_group(&opcode_map, 0xc1, opcode_timings_286_shift, opcode_timings_286_shift_mod3, opcode_deps_shift, opcode_deps_shift_mod3);
+    codegen_timing_map_group(&opcode_map, 0xd0, opcode_timings_286_shift_1, opcode_timings_286_shift_1_mod3, opcode_deps_shift, opcode_deps_shift_mod3);
+    codegen_timing_map_group(&opcode_map, 0xd1, opcode_timings_286_shift_1, opcode_timings_286_shift_1_mod3, opcode_deps_shift, opcode_deps_shift_mod3);
+    codegen_timing_map_group(&opcode_map, 0xd2, opcode_timings_286_shift, opcode_timings_286_shift_mod3, opcode_deps_shift_cl, opcode_deps_shift_cl_mod3);
+    codegen_timing_map_group(&opcode_map, 0xd3, opcode_timings_286_shift, opcode_timings_286_shift_mod3, opcode_deps_shift_cl, opcode_deps_shift_cl_mod3);
+    codegen_timing_map_group(&opcode_map, 0xf6, opcode_timings_286_f6, opcode_timings_286_f6_mod3, opcode_deps_f6, opcode_deps_f6_mod3);
+    codegen_timing_map_group(&opcode_map, 0xf7, opcode_timings_286_f7, opcode_timings_286_f7_mod3, opcode_deps_f7, opcode_deps_f7_mod3);
+    codegen_timing_map_group(&opcode_map, 0xff, opcode_timings_286_ff, opcode_timings_286_ff_mod3, opcode_deps_ff, opcode_deps_ff_mod3);
+
+    opcode_map_built = 1;
+}
+
+void
+codegen_timing_286_start(void)
+{
+    if (!opcode_map_built)
+        codegen_timing_286_map_init();
+
+    timing_count = 0;
+    last_prefix  = 0;
+}
+
+void
+codegen_timing_286_prefix(uint8_t prefix, UNUSED(uint32_t fetchdat))
+{
+    timing_count += COUNT(opcode_timings_286[prefix]);
+    last_prefix = prefix;
+}
+
+void
+codegen_timing_286_opcode(uint8_t opcode, uint32_t fetchdat, UNUSED(int op_32), UNUSED(uint32_t op_pc))
+{
+    int                       **timings;
+    const uint64_t             *deps;
+    const codegen_timing_sel_t *sel;
+    uint8_t                     modrm = fetchdat & 0xff;
+
+    sel     = codegen_timing_lookup(&opcode_map, last_prefix, fetchdat, &opcode);
+    timings = (int **) sel->timings;
+    deps    = sel->deps;
+
+    timing_count += COUNT(timings[opcode]);
+    /*[BX+SI+disp] and friends*/
+    if ((deps[opcode] & MODRM) && ((modrm & 0xc0) == 0x40 || (modrm & 0xc0) == 0x80) && (modrm & 7) < 4)
+        timing_count++;
+    codegen_block_cycles += timing_count;
+}
+
+void
+codegen_timing_286_block_end(void)
+{
+    //
+}
+
+codegen_timing_t codegen_timing_286 = {
+    codegen_timing_286_start,
+    codegen_timing_286_prefix,
+    codegen_timing_286_opcode,
+    codegen_timing_286_block_start,
+    codegen_timing_286_block_end,
+    NULL
+};
@@ -818,9 +818,47 @@ codegen_timing_686_block_start(void)
     regmask_modified = last_regmask_modified = 0;
 }
 
+static codegen_timing_map_t opcode_map;
+static int                  opcode_map_built = 0;
+
+static void
+codegen_timing_686_map_init(void)
+{
+    codegen_timing_map_init(&opcode_map, opcode_timings_686, opcode_timings_686_mod3, opcode_deps, opcode_deps_mod3);
+
+    codegen_timing_map_prefix(&opcode_map, 0x0f, opcode_timings_686_0f, opcode_timings_686_0f_mod3, opcode_deps_0f, opcode_deps_0f_mod3, CODEGEN_TIMING_IDX_OPCODE, CODEGEN_TIMING_IDX_OPCODE);
+    codegen_timing_map_prefix(&opcode_map, 0xd8, opcode_timings_686_d8, opcode_timings_686_d8_mod3, opcode_deps_d8, opcode_deps_d8_mod3, CODEGEN_TIMING_IDX_REG, CODEGEN_TIMING_IDX_REG);
+    codegen_timing_map_prefix(&opcode_map, 0xd9, opcode_timings_686_d9, opcode_timings_686_d9_mod3, opcode_deps_d9, opcode_deps_d9_mod3, CODEGEN_TIMING_IDX_REG, CODEGEN_TIMING_IDX_LOW6);
+    codegen_timing_map_prefix(&opcode_map, 0xda, opcode_timings_686_da, opcode_timings_686_da_mod3, opcode_deps_da, opcode_deps_da_mod3, CODEGEN_TIMING_IDX_REG, CODEGEN_TIMING_IDX_REG);
+    codegen_timing_map_prefix(&opcode_map, 0xdb, opcode_timings_686_db, opcode_timings_686_db_mod3, opcode_deps_db, opcode_deps_db_mod3, CODEGEN_TIMING_IDX_REG, CODEGEN_TIMING_IDX_LOW6);
+    codegen_timing_map_prefix(&opcode_map, 0xdc, opcode_timings_686_dc, opcode_timings_686_dc_mod3, opcode_deps_dc, opcode_deps_dc_mod3, CODEGEN_TIMING_IDX_REG, CODEGEN_TIMING_IDX_REG);
+    codegen_timing_map_prefix(&opcode_map, 0xdd, opcode_timings_686_dd, opcode_timings_686_dd_mod3, opcode_deps_dd, opcode_deps_dd_mod3, CODEGEN_TIMING_IDX_REG, CODEGEN_TIMING_IDX_REG);
+    codegen_timing_map_prefix(&opcode_map, 0xde, opcode_timings_686_de, opcode_timings_686_de_mod3, opcode_deps_de, opcode_deps_de_mod3, CODEGEN_TIMING_IDX_REG, CODEGEN_TIMING_IDX_REG);
+    codegen_timing_map_prefix(&opcode_map, 0xdf, opcode_timings_686_df, opcode_timings_686_df_mod3, opcode_deps_df, opcode_deps_df_mod3, CODEGEN_TIMING_IDX_REG, CODEGEN_TIMING_IDX_REG);
+
+    codegen_timing_map_group(&opcode_map, 0x80, opcode_timings_686_8x, opcode_timings_686_8x_mod3, opcode_deps_8x, opcode_deps_8x_mod3);
+    codegen_timing_map_group(&opcode_map, 0x82, opcode_timings_686_8x, opcode_timings_686_8x_mod3, opcode_deps_8x, opcode_deps_8x_mod3);
+    codegen_timing_map_group(&opcode_map, 0x83, opcode_timings_686_8x, opcode_timings_686_8x_mod3, opcode_deps_8x, opcode_deps_8x_mod3);
+    codegen_timing_map_group(&opcode_map, 0x81, opcode_timings_686_81, opcode_timings_686_81_mod3, opcode_deps_81, opcode_deps_81_mod3);
+    codegen_timing_map_group(&opcode_map, 0xc0, opcode_timings_686_shift_imm, opcode_timings_686_shift_imm_mod3, opcode_deps_shift, opcode_deps_shift_mod3);
+    codegen_timing_map_group(&opcode_map, 0xc1, opcode_timings_686_shift_imm, opcode_timings_686_shift_imm_mod3, opcode_deps_shift, opcode_deps_shift_mod3);
+    codegen_timing_map_group(&opcode_map, 0xd0, opcode_timings_686_shift, opcode_timings_686_shift_mod3, opcode_deps_shift, opcode_deps_shift_mod3);
+    codegen_timing_map_group(&opcode_map, 0xd1, opcode_timings_686_shift, opcode_timings_686_shift_mod3, opcode_deps_shift, opcode_deps_shift_mod3);
+    codegen_timing_map_group(&opcode_map, 0xd2, opcode_timings_686_shift_cl, opcode_timings_686_shift_cl_mod3, opcode_deps_shift_cl, opcode_deps_shift_cl_mod3);
+    codegen_timing_map_group(&opcode_map, 0xd3, opcode_timings_686_shift_cl, opcode_timings_686_shift_cl_mod3, opcode_deps_shift_cl, opcode_deps_shift_cl_mod3);
+    codegen_timing_map_group(&opcode_map, 0xf6, opcode_timings_686_f6, opcode_timings_686_f6_mod3, opcode_deps_f6, opcode_deps_f6_mod3);
+    codegen_timing_map_group(&opcode_map, 0xf7, opcode_timings_686_f7, opcode_timings_686_f7_mod3, opcode_deps_f7, opcode_deps_f7_mod3);
+    codegen_timing_map_group(&opcode_map, 0xff, opcode_timings_686_ff, opcode_timings_686_ff_mod3, opcode_deps_ff, opcode_deps_ff_mod3);
+
+    opcode_map_built = 1;
+}
+
 void
 codegen_timing_686_start(void)
 {
+    if (!opcode_map_built)
+        codegen_timing_686_map_init();
+
     decode_delay = 0;
     last_prefix  = 0;
 }
@@ -867,116 +905,14 @@ check_agi(uint64_t *deps, uint8_t opcode, uint32_t fetchdat, int op_32)
 void
 codegen_timing_686_opcode(uint8_t opcode, uint32_t fetchdat, int op_32, UNUSED(uint32_t op_pc))
 {
-    uint32_t *timings;
-    uint64_t *deps;
-    int       mod3 = ((fetchdat & 0xc0) == 0xc0);
-    int       bit8 = !(opcode & 1);
-
-    switch (last_prefix) {
-        case 0x0f:
-            timings = mod3 ? opcode_timings_686_0f_mod3 : opcode_timings_686_0f;
-            deps    = mod3 ? opcode_deps_0f_mod3 : opcode_deps_0f;
-            break;
-
-        case 0xd8:
-            timings = mod3 ? opcode_timings_686_d8_mod3 : opcode_timings_686_d8;
-            deps    = mod3 ? opcode_deps_d8_mod3 : opcode_deps_d8;
-            opcode  = (opcode >> 3) & 7;
-            break;
-        case 0xd9:
-            timings = mod3 ? opcode_timings_686_d9_mod3 : opcode_timings_686_d9;
-            deps    = mod3 ? opcode_deps_d9_mod3 : opcode_deps_d9;
-            opcode  = mod3 ? opcode & 0x3f : (opcode >> 3) & 7;
-            break;
-        case 0xda:
-            timings = mod3 ? opcode_timings_686_da_mod3 : opcode_timings_686_da;
-            deps    = mod3 ? opcode_deps_da_mod3 : opcode_deps_da;
-            opcode  = (opcode >> 3) & 7;
-            break;
-        case 0xdb:
-            timings = mod3 ? opcode_timings_686_db_mod3 : opcode_timings_686_db;
-            deps    = mod3 ? opcode_deps_db_mod3 : opcode_deps_db;
-            opcode  = mod3 ? opcode & 0x3f : (opcode >> 3) & 7;
-            break;
-        case 0xdc:
-            timings = mod3 ? opcode_timings_686_dc_mod3 : opcode_timings_686_dc;
-            deps    = mod3 ? opcode_deps_dc_mod3 : opcode_deps_dc;
-            opcode  = (opcode >> 3) & 7;
-            break;
-        case 0xdd:
-            timings = mod3 ? opcode_timings_686_dd_mod3 : opcode_timings_686_dd;
-            deps    = mod3 ? opcode_deps_dd_mod3 : opcode_deps_dd;
-            opcode  = (opcode >> 3) & 7;
-            break;
-        case 0xde:
-            timings = mod3 ? opcode_timings_686_de_mod3 : opcode_timings_686_de;
-            deps    = mod3 ? opcode_deps_de_mod3 : opcode_deps_de;
-            opcode  = (opcode >> 3) & 7;
-            break;
-        case 0xdf:
-            timings = mod3 ? opcode_timings_686_df_mod3 : opcode_timings_686_df;
-            deps    = mod3 ? opcode_deps_df_mod3 : opcode_deps_df;
-            opcode  = (opcode >> 3) & 7;
-            break;
-
-        default:
-            switch (opcode) {
-                case 0x80:
-                case 0x82:
-                case 0x83:
-                    timings = mod3 ? opcode_timings_686_8x_mod3 : opcode_timings_686_8x;
-                    deps    = mod3 ? opcode_deps_8x_mod3 : opcode_deps_8x;
-                    opcode  = (fetchdat >> 3) & 7;
-                    break;
-                case 0x81:
-                    timings = mod3 ? opcode_timings_686_81_mod3 : opcode_timings_686_81;
-                    deps    = mod3 ? opcode_deps_81_mod3 : opcode_deps_81;
-                    opcode  = (fetchdat >> 3) & 7;
-                    break;
-
-                case 0xc0:
-                case 0xc1:
-                    timings = mod3 ? opcode_timings_686_shift_imm_mod3 : opcode_timings_686_shift_imm;
-                    deps    = mod3 ? opcode_deps_shift_mod3 : opcode_deps_shift;
-                    opcode  = (fetchdat >> 3) & 7;
-                    break;
-
-                case 0xd0:
-                case 0xd1:
-                    timings = mod3 ? opcode_timings_686_shift_mod3 : opcode_timings_686_shift;
-                    deps    = mod3 ? opcode_deps_shift_mod3 : opcode_deps_shift;
-                    opcode  = (fetchdat >> 3) & 7;
-                    break;
-
-                case 0xd2:
-                case 0xd3:
-                    timings = mod3 ? opcode_timings_686_shift_cl_mod3 : opcode_timings_686_shift_cl;
-                    deps    = mod3 ? opcode_deps_shift_cl_mod3 : opcode_deps_shift_cl;
-                    opcode  = (fetchdat >> 3) & 7;
-                    break;
-
-                case 0xf6:
-                    timings = mod3 ? opcode_timings_686_f6_mod3 : opcode_timings_686_f6;
-                    deps    = mod3 ? opcode_deps_f6_mod3 : opcode_deps_f6;
-                    opcode  = (fetchdat >> 3) & 7;
-                    break;
-                case 0xf7:
-                    timings = mod3 ? opcode_timings_686_f7_mod3 : opcode_timings_686_f7;
-                    deps    = mod3 ? opcode_deps_f7_mod3 : opcode_deps_f7;
-                    opcode  = (fetchdat >> 3) & 7;
-                    break;
-                case 0xff:
-                    timings = mod3 ? opcode_timings_686_ff_mod3 : opcode_timings_686_ff;
-                    deps    = mod3 ? opcode_deps_ff_mod3 : opcode_deps_ff;
-                    opcode  = (fetchdat >> 3) & 7;
-                    break;
-
-                default:
-                    timings = mod3 ? opcode_timings_686_mod3 : opcode_timings_686;
-                    deps    = mod3 ? opcode_deps_mod3 : opcode_deps;
-                    break;
-            }
-    }
+    uint32_t                   *timings;
+    uint64_t                   *deps;
+    const codegen_timing_sel_t *sel;
+    int                         bit8 = !(opcode & 1);
+
+    sel     = codegen_timing_lookup(&opcode_map, last_prefix, fetchdat, &opcode);
+    timings = (uint32_t *) sel->timings;
+    deps    = (uint64_t *) sel->deps;
 
     /*One prefix per instruction is free*/
     decode_delay--;
@@ -883,3 +883,87 @@ uint64_t opcode_deps_8x_mod3[8] = {
         SRCDEP_RM | DSTDEP_RM | MODRM | HAS_IMM8,  SRCDEP_RM | DSTDEP_RM | MODRM | HAS_IMM8,  SRCDEP_RM | DSTDEP_RM | MODRM | HAS_IMM8,  SRCDEP_RM | MODRM | HAS_IMM8
     // clang-format on
 };
+
+const uint8_t codegen_timing_prefix_class[256] = {
+    [0x0f] = 1,
+    [0xd8] = 2,
+    [0xd9] = 3,
+    [0xda] = 4,
+    [0xdb] = 5,
+    [0xdc] = 6,
+    [0xdd] = 7,
+    [0xde] = 8,
+    [0xdf] = 9
+};
+
+static const struct {
+    uint8_t from_fetchdat;
+    uint8_t shift;
+    uint8_t mask;
+} codegen_timing_idx[4] = {
+    { 0, 0, 0xff }, /* CODEGEN_TIMING_IDX_OPCODE */
+    { 0, 3, 0x07 }, /* CODEGEN_TIMING_IDX_REG */
+    { 0, 0, 0x3f }, /* CODEGEN_TIMING_IDX_LOW6 */
+    { 1, 3, 0x07 }  /* CODEGEN_TIMING_IDX_GROUP */
+};
+
+static uint8_t
+codegen_timing_map_sel(codegen_timing_map_t *map, const void *timings, const uint64_t *deps, int idx)
+{
+    codegen_timing_sel_t *sel;
+
+    for (int c = 0; c < map->sels_num; c++) {
+        sel = &map->sel[c];
+        if ((sel->timings == timings) && (sel->deps == deps) &&
+            (sel->from_fetchdat == codegen_timing_idx[idx].from_fetchdat) &&
+            (sel->shift == codegen_timing_idx[idx].shift) && (sel->mask == codegen_timing_idx[idx].mask))
+            return c;
+    }
+
+    if (map->sels_num >= CODEGEN_TIMING_SELS)
+        fatal("codegen_timing_map_sel(): too many timing tables\n");
+
+    sel                = &map->sel[map->sels_num];
+    sel->timings       = timings;
+    sel->deps          = deps;
+    sel->from_fetchdat = codegen_timing_idx[idx].from_fetchdat;
+    sel->shift         = codegen_timing_idx[idx].shift;
+    sel->mask          = codegen_timing_idx[idx].mask;
+
+    return map->sels_num++;
+}
+
+void
+codegen_timing_map_init(codegen_timing_map_t *map, const void *timings, const void *timings_mod3,
+                        const uint64_t *deps, const uint64_t *deps_mod3)
+{
+    uint8_t sel;
+    uint8_t sel_mod3;
+
+    map->sels_num = 0;
+    sel           = codegen_timing_map_sel(map, timings, deps, CODEGEN_TIMING_IDX_OPCODE);
+    sel_mod3      = codegen_timing_map_sel(map, timings_mod3, deps_mod3, CODEGEN_TIMING_IDX_OPCODE);
+
+    for (int c = 0; c < CODEGEN_TIMING_CLASSES; c++) {
+        memset(map->op[c][0], sel, 256);
+        memset(map->op[c][1], sel_mod3, 256);
+    }
+}
+
+void
+codegen_timing_map_prefix(codegen_timing_map_t *map, uint8_t prefix, const void *timings, const void *timings_mod3,
+                          const uint64_t *deps, const uint64_t *deps_mod3, int idx, int idx_mod3)
+{
+    int c = codegen_timing_prefix_class[prefix];
+
+    memset(map->op[c][0], codegen_timing_map_sel(map, timings, deps, idx), 256);
+    memset(map->op[c][1], codegen_timing_map_sel(map, timings_mod3, deps_mod3, idx_mod3), 256);
+}
+
+void
+codegen_timing_map_group(codegen_timing_map_t *map, uint8_t opcode, const void *timings, const void *timings_mod3,
+                         const uint64_t *deps, const uint64_t *deps_mod3)
+{
+    map->op[0][0][opcode] = codegen_timing_map_sel(map, timings, deps, CODEGEN_TIMING_IDX_GROUP);
+    map->op[0][1][opcode] = codegen_timing_map_sel(map, timings_mod3, deps_mod3, CODEGEN_TIMING_IDX_GROUP);
+}
@@ -116,6 +116,57 @@ extern uint64_t opcode_deps_81_mod3[8];
 extern uint64_t opcode_deps_8x[8];
 extern uint64_t opcode_deps_8x_mod3[8];
 
+/*
+ * Which of a model's tables the timing of an instruction is in, and how
+ * it is indexed, going by the prefix before it, the opcode, and whether
+ * its ModR/M byte names a register. Each model fills in its map once, so
+ * looking an instruction up is a few loads rather than a pass through a
+ * switch for every instruction a block is compiled from.
+ */
+#define CODEGEN_TIMING_IDX_OPCODE 0 /* By the opcode. */
+#define CODEGEN_TIMING_IDX_REG    1 /* By bits 5:3 of the opcode, the ModR/M byte of an FPU escape. */
+#define CODEGEN_TIMING_IDX_LOW6   2 /* By bits 5:0 of the opcode. */
+#define CODEGEN_TIMING_IDX_GROUP  3 /* By the reg field of the ModR/M byte after the opcode. */
+
+#define CODEGEN_TIMING_CLASSES    10 /* No prefix, 0F, and D8 to DF. */
+#define CODEGEN_TIMING_SELS       48
+
+typedef struct codegen_timing_sel_t {
+    const void     *timings;
+    const uint64_t *deps;
+    uint8_t         from_fetchdat;
+    uint8_t         shift;
+    uint8_t         mask;
+} codegen_timing_sel_t;
+
+typedef struct codegen_timing_map_t {
+    uint8_t              op[CODEGEN_TIMING_CLASSES][2][256]; /* By class, mod3 and opcode. */
+    codegen_timing_sel_t sel[CODEGEN_TIMING_SELS];
+    int                  sels_num;
+} codegen_timing_map_t;
+
+extern const uint8_t codegen_timing_prefix_class[256];
+
+/* Starts the map over with every opcode on the tables of unprefixed ones. */
+extern void codegen_timing_map_init(codegen_timing_map_t *map, const void *timings, const void *timings_mod3,
+                                    const uint64_t *deps, const uint64_t *deps_mod3);
+extern void codegen_timing_map_prefix(codegen_timing_map_t *map, uint8_t prefix, const void *timings, const void *timings_mod3,
+                                      const uint64_t *deps, const uint64_t *deps_mod3, int idx, int idx_mod3);
+extern void codegen_timing_map_group(codegen_timing_map_t *map, uint8_t opcode, const void *timings, const void *timings_mod3,
+                                     const uint64_t *deps, const uint64_t *deps_mod3);
+
+/* Returns the tables of the instruction, and turns opcode into the index into them. */
+static inline const codegen_timing_sel_t *
+codegen_timing_lookup(const codegen_timing_map_t *map, uint8_t prefix, uint32_t fetchdat, uint8_t *opcode)
+{
+    int                         mod3 = ((fetchdat & 0xc0) == 0xc0);
+    const codegen_timing_sel_t *sel  = &map->sel[map->op[codegen_timing_prefix_class[prefix]][mod3][*opcode]];
+
+    *opcode = ((sel->from_fetchdat ? fetchdat : *opcode) >> sel->shift) & sel->mask;
+
+    return sel;
+}
+
 static inline uint32_t
 get_addr_regmask(uint64_t data, uint32_t fetchdat, int op_32)
 {
@@ -2023,9 +2023,47 @@ codegen_timing_k6_block_start(void)
         fpu_st_timestamp[c] = 0;
 }
 
+static codegen_timing_map_t opcode_map;
+static int                  opcode_map_built = 0;
+
+static void
+codegen_timing_k6_map_init(void)
+{
+    codegen_timing_map_init(&opcode_map, opcode_timings_k6, opcode_timings_k6_mod3, opcode_deps, opcode_deps_mod3);
+
+    codegen_timing_map_prefix(&opcode_map, 0x0f, opcode_timings_k6_0f, opcode_timings_k6_0f_mod3, opcode_deps_0f, opcode_deps_0f_mod3, CODEGEN_TIMING_IDX_OPCODE, CODEGEN_TIMING_IDX_OPCODE);
+    codegen_timing_map_prefix(&opcode_map, 0xd8, opcode_timings_k6_d8, opcode_timings_k6_d8_mod3, opcode_deps_d8, opcode_deps_d8_mod3, CODEGEN_TIMING_IDX_REG, CODEGEN_TIMING_IDX_REG);
+    codegen_timing_map_prefix(&opcode_map, 0xd9, opcode_timings_k6_d9, opcode_timings_k6_d9_mod3, opcode_deps_d9, opcode_deps_d9_mod3, CODEGEN_TIMING_IDX_REG, CODEGEN_TIMING_IDX_LOW6);
+    codegen_timing_map_prefix(&opcode_map, 0xda, opcode_timings_k6_da, opcode_timings_k6_da_mod3, opcode_deps_da, opcode_deps_da_mod3, CODEGEN_TIMING_IDX_REG, CODEGEN_TIMING_IDX_REG);
+    codegen_timing_map_prefix(&opcode_map, 0xdb, opcode_timings_k6_db, opcode_timings_k6_db_mod3, opcode_deps_db, opcode_deps_db_mod3, CODEGEN_TIMING_IDX_REG, CODEGEN_TIMING_IDX_LOW6);
+    codegen_timing_map_prefix(&opcode_map, 0xdc, opcode_timings_k6_dc, opcode_timings_k6_dc_mod3, opcode_deps_dc, opcode_deps_dc_mod3, CODEGEN_TIMING_IDX_REG, CODEGEN_TIMING_IDX_REG);
+    codegen_timing_map_prefix(&opcode_map, 0xdd, opcode_timings_k6_dd, opcode_timings_k6_dd_mod3, opcode_deps_dd, opcode_deps_dd_mod3, CODEGEN_TIMING_IDX_REG, CODEGEN_TIMING_IDX_REG);
+    codegen_timing_map_prefix(&opcode_map, 0xde, opcode_timings_k6_de, opcode_timings_k6_de_mod3, opcode_deps_de, opcode_deps_de_mod3, CODEGEN_TIMING_IDX_REG, CODEGEN_TIMING_IDX_REG);
+    codegen_timing_map_prefix(&opcode_map, 0xdf, opcode_timings_k6_df, opcode_timings_k6_df_mod3, opcode_deps_df, opcode_deps_df_mod3, CODEGEN_TIMING_IDX_REG, CODEGEN_TIMING_IDX_REG);
+
+    codegen_timing_map_group(&opcode_map, 0x80, opcode_timings_k6_80, opcode_timings_k6_80_mod3, opcode_deps_8x, opcode_deps_8x_mod3);
+    codegen_timing_map_group(&opcode_map, 0x82, opcode_timings_k6_80, opcode_timings_k6_80_mod3, opcode_deps_8x, opcode_deps_8x_mod3);
+    codegen_timing_map_group(&opcode_map, 0x81, opcode_timings_k6_8x, opcode_timings_k6_8x_mod3, opcode_deps_8x, opcode_deps_8x_mod3);
+    codegen_timing_map_group(&opcode_map, 0x83, opcode_timings_k6_8x, opcode_timings_k6_8x_mod3, opcode_deps_8x, opcode_deps_8x_mod3);
+    codegen_timing_map_group(&opcode_map, 0xc0, opcode_timings_k6_shift_b, opcode_timings_k6_shift_b_mod3, opcode_deps_shift, opcode_deps_shift_mod3);
+    codegen_timing_map_group(&opcode_map, 0xd0, opcode_timings_k6_shift_b, opcode_timings_k6_shift_b_mod3, opcode_deps_shift, opcode_deps_shift_mod3);
+    codegen_timing_map_group(&opcode_map, 0xd2, opcode_timings_k6_shift_b, opcode_timings_k6_shift_b_mod3, opcode_deps_shift, opcode_deps_shift_mod3);
+    codegen_timing_map_group(&opcode_map, 0xc1, opcode_timings_k6_shift, opcode_timings_k6_shift_mod3, opcode_deps_shift, opcode_deps_shift_mod3);
+    codegen_timing_map_group(&opcode_map, 0xd1, opcode_timings_k6_shift, opcode_timings_k6_shift_mod3, opcode_deps_shift, opcode_deps_shift_mod3);
+    codegen_timing_map_group(&opcode_map, 0xd3, opcode_timings_k6_shift, opcode_timings_k6_shift_mod3, opcode_deps_shift, opcode_deps_shift_mod3);
+    codegen_timing_map_group(&opcode_map, 0xf6, opcode_timings_k6_f6, opcode_timings_k6_f6_mod3, opcode_deps_f6, opcode_deps_f6_mod3);
+    codegen_timing_map_group(&opcode_map, 0xf7, opcode_timings_k6_f7, opcode_timings_k6_f7_mod3, opcode_deps_f7, opcode_deps_f7_mod3);
+    codegen_timing_map_group(&opcode_map, 0xff, opcode_timings_k6_ff, opcode_timings_k6_ff_mod3, opcode_deps_ff, opcode_deps_ff_mod3);
+
+    opcode_map_built = 1;
+}
+
 void
 codegen_timing_k6_start(void)
 {
+    if (!opcode_map_built)
+        codegen_timing_k6_map_init();
+
     if (cpu_s->cpu_type == CPU_K6) {
         units    = k6_units;
         nr_units = NR_K6_UNITS;
@@ -2052,150 +2090,54 @@ codegen_timing_k6_opcode(uint8_t opcode, UNUSED(uint32_t fetchdat), int op_32, u
 {
     const risc86_instruction_t **ins_table;
     const uint64_t              *deps;
+    const codegen_timing_sel_t  *sel;
     int                          mod3                        = ((fetchdat & 0xc0) == 0xc0);
     int                          old_last_complete_timestamp = last_complete_timestamp;
     int                          bit8                        = !(opcode & 1);
 
-    switch (last_prefix) {
-        case 0x0f:
-            if (opcode == 0x0f) {
-                /*3DNow has the actual opcode after ModR/M, SIB and any offset*/
-                uint32_t opcode_pc = op_pc + 1; /*Byte after ModR/M*/
-                uint8_t  modrm     = fetchdat & 0xff;
-                uint8_t  sib       = (fetchdat >> 8) & 0xff;
-
-                if ((modrm & 0xc0) != 0xc0) {
-                    if (op_32 & 0x200) {
-                        if ((modrm & 7) == 4) {
-                            /* Has SIB*/
-                            opcode_pc++;
-                            if ((modrm & 0xc0) == 0x40)
-                                opcode_pc++;
-                            else if ((modrm & 0xc0) == 0x80)
-                                opcode_pc += 4;
-                            else if ((sib & 0x07) == 0x05)
-                                opcode_pc += 4;
-                        } else {
-                            if ((modrm & 0xc0) == 0x40)
-                                opcode_pc++;
-                            else if ((modrm & 0xc0) == 0x80)
-                                opcode_pc += 4;
-                            else if ((modrm & 0xc7) == 0x05)
-                                opcode_pc += 4;
-                        }
-                    } else {
-                        if ((modrm & 0xc0) == 0x40)
-                            opcode_pc++;
-                        else if ((modrm & 0xc0) == 0x80)
-                            opcode_pc += 2;
-                        else if ((modrm & 0xc7) == 0x06)
-                            opcode_pc += 2;
-                    }
+    if ((last_prefix == 0x0f) && (opcode == 0x0f)) {
+        /*3DNow has the actual opcode after ModR/M, SIB and any offset*/
+        uint32_t opcode_pc = op_pc + 1; /*Byte after ModR/M*/
+        uint8_t  modrm     = fetchdat & 0xff;
+        uint8_t  sib       = (fetchdat >> 8) & 0xff;
+
+        if ((modrm & 0xc0) != 0xc0) {
+            if (op_32 & 0x200) {
+                if ((modrm & 7) == 4) {
+                    /* Has SIB*/
+                    opcode_pc++;
+                    if ((modrm & 0xc0) == 0x40)
+                        opcode_pc++;
+                    else if ((modrm & 0xc0) == 0x80)
+                        opcode_pc += 4;
+                    else if ((sib & 0x07) == 0x05)
+                        opcode_pc += 4;
+                } else {
+                    if ((modrm & 0xc0) == 0x40)
+                        opcode_pc++;
+                    else if ((modrm & 0xc0) == 0x80)
+                        opcode_pc += 4;
+                    else if ((modrm & 0xc7) == 0x05)
+                        opcode_pc += 4;
                 }
-
-                opcode = fastreadb(cs + opcode_pc);
-
-                ins_table = mod3 ? opcode_timings_k6_0f0f_mod3 : opcode_timings_k6_0f0f;
-                deps      = mod3 ? opcode_deps_0f0f_mod3 : opcode_deps_0f0f;
             } else {
-                ins_table = mod3 ? opcode_timings_k6_0f_mod3 : opcode_timings_k6_0f;
-                deps      = mod3 ? opcode_deps_0f_mod3 : opcode_deps_0f;
+                if ((modrm & 0xc0) == 0x40)
+                    opcode_pc++;
+                else if ((modrm & 0xc0) == 0x80)
+                    opcode_pc += 2;
+                else if ((modrm & 0xc7) == 0x06)
+                    opcode_pc += 2;
             }
-            break;
+        }
 
-        case 0xd8:
-            ins_table = mod3 ? opcode_timings_k6_d8_mod3 : opcode_timings_k6_d8;
-            deps      = mod3 ? opcode_deps_d8_mod3 : opcode_deps_d8;
-            opcode    = (opcode >> 3) & 7;
-            break;
-        case 0xd9:
-            ins_table = mod3 ? opcode_timings_k6_d9_mod3 : opcode_timings_k6_d9;
-            deps      = mod3 ? opcode_deps_d9_mod3 : opcode_deps_d9;
-            opcode    = mod3 ? opcode & 0x3f : (opcode >> 3) & 7;
-            break;
-        case 0xda:
-            ins_table = mod3 ? opcode_timings_k6_da_mod3 : opcode_timings_k6_da;
-            deps      = mod3 ? opcode_deps_da_mod3 : opcode_deps_da;
-            opcode    = (opcode >> 3) & 7;
-            break;
-        case 0xdb:
-            ins_table = mod3 ? opcode_timings_k6_db_mod3 : opcode_timings_k6_db;
-            deps      = mod3 ? opcode_deps_db_mod3 : opcode_deps_db;
-            opcode    = mod3 ? opcode & 0x3f : (opcode >> 3) & 7;
-            break;
-        case 0xdc:
-            ins_table = mod3 ? opcode_timings_k6_dc_mod3 : opcode_timings_k6_dc;
-            deps      = mod3 ? opcode_deps_dc_mod3 : opcode_deps_dc;
-            opcode    = (opcode >> 3) & 7;
-            break;
-        case 0xdd:
-            ins_table = mod3 ? opcode_timings_k6_dd_mod3 : opcode_timings_k6_dd;
-            deps      = mod3 ? opcode_deps_dd_mod3 : opcode_deps_dd;
-            opcode    = (opcode >> 3) & 7;
-            break;
-        case 0xde:
-            ins_table = mod3 ? opcode_timings_k6_de_mod3 : opcode_timings_k6_de;
-            deps      = mod3 ? opcode_deps_de_mod3 : opcode_deps_de;
-            opcode    = (opcode >> 3) & 7;
-            break;
-        case 0xdf:
-            ins_table = mod3 ? opcode_timings_k6_df_mod3 : opcode_timings_k6_df;
-            deps      = mod3 ? opcode_deps_df_mod3 : opcode_deps_df;
-            opcode    = (opcode >> 3) & 7;
-            break;
+        opcode = fastreadb(cs + opcode_pc);
 
-        default:
-            switch (opcode) {
-                case 0x80:
-                case 0x82:
-                    ins_table = mod3 ? opcode_timings_k6_80_mod3 : opcode_timings_k6_80;
-                    deps      = mod3 ? opcode_deps_8x_mod3 : opcode_deps_8x;
-                    opcode    = (fetchdat >> 3) & 7;
-                    break;
-                case 0x81:
-                case 0x83:
-                    ins_table = mod3 ? opcode_timings_k6_8x_mod3 : opcode_timings_k6_8x;
-                    deps      = mod3 ? opcode_deps_8x_mod3 : opcode_deps_8x;
-                    opcode    = (fetchdat >> 3) & 7;
-                    break;
-
-                case 0xc0:
-                case 0xd0:
-                case 0xd2:
-                    ins_table = mod3 ? opcode_timings_k6_shift_b_mod3 : opcode_timings_k6_shift_b;
-                    deps      = mod3 ? opcode_deps_shift_mod3 : opcode_deps_shift;
-                    opcode    = (fetchdat >> 3) & 7;
-                    break;
-
-                case 0xc1:
-                case 0xd1:
-                case 0xd3:
-                    ins_table = mod3 ? opcode_timings_k6_shift_mod3 : opcode_timings_k6_shift;
-                    deps      = mod3 ? opcode_deps_shift_mod3 : opcode_deps_shift;
-                    opcode    = (fetchdat >> 3) & 7;
-                    break;
-
-                case 0xf6:
-                    ins_table = mod3 ? opcode_timings_k6_f6_mod3 : opcode_timings_k6_f6;
-                    deps      = mod3 ? opcode_deps_f6_mod3 : opcode_deps_f6;
-                    opcode    = (fetchdat >> 3) & 7;
-                    break;
-                case 0xf7:
-                    ins_table = mod3 ? opcode_timings_k6_f7_mod3 : opcode_timings_k6_f7;
-                    deps      = mod3 ? opcode_deps_f7_mod3 : opcode_deps_f7;
-                    opcode    = (fetchdat >> 3) & 7;
-                    break;
-                case 0xff:
-                    ins_table = mod3 ? opcode_timings_k6_ff_mod3 : opcode_timings_k6_ff;
-                    deps      = mod3 ? opcode_deps_ff_mod3 : opcode_deps_ff;
-                    opcode    = (fetchdat >> 3) & 7;
-                    break;
-
-                default:
-                    ins_table = mod3 ? opcode_timings_k6_mod3 : opcode_timings_k6;
-                    deps      = mod3 ? opcode_deps_mod3 : opcode_deps;
-                    break;
-            }
+        ins_table = mod3 ? opcode_timings_k6_0f0f_mod3 : opcode_timings_k6_0f0f;
+        deps      = mod3 ? opcode_deps_0f0f_mod3 : opcode_deps_0f0f;
+    } else {
+        sel       = codegen_timing_lookup(&opcode_map, last_prefix, fetchdat, &opcode);
+        ins_table = (const risc86_instruction_t **) sel->timings;
+        deps      = sel->deps;
     }
 
     if (ins_table[opcode])
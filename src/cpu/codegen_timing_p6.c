@@ -1830,9 +1830,47 @@ codegen_timing_p6_block_start(void)
         fpu_st_timestamp[c] = 0;
 }
 
+static codegen_timing_map_t opcode_map;
+static int                  opcode_map_built = 0;
+
+static void
+codegen_timing_p6_map_init(void)
+{
+    codegen_timing_map_init(&opcode_map, opcode_timings_p6, opcode_timings_p6_mod3, opcode_deps, opcode_deps_mod3);
+
+    codegen_timing_map_prefix(&opcode_map, 0x0f, opcode_timings_p6_0f, opcode_timings_p6_0f_mod3, opcode_deps_0f, opcode_deps_0f_mod3, CODEGEN_TIMING_IDX_OPCODE, CODEGEN_TIMING_IDX_OPCODE);
+    codegen_timing_map_prefix(&opcode_map, 0xd8, opcode_timings_p6_d8, opcode_timings_p6_d8_mod3, opcode_deps_d8, opcode_deps_d8_mod3, CODEGEN_TIMING_IDX_REG, CODEGEN_TIMING_IDX_REG);
+    codegen_timing_map_prefix(&opcode_map, 0xd9, opcode_timings_p6_d9, opcode_timings_p6_d9_mod3, opcode_deps_d9, opcode_deps_d9_mod3, CODEGEN_TIMING_IDX_REG, CODEGEN_TIMING_IDX_LOW6);
+    codegen_timing_map_prefix(&opcode_map, 0xda, opcode_timings_p6_da, opcode_timings_p6_da_mod3, opcode_deps_da, opcode_deps_da_mod3, CODEGEN_TIMING_IDX_REG, CODEGEN_TIMING_IDX_REG);
+    codegen_timing_map_prefix(&opcode_map, 0xdb, opcode_timings_p6_db, opcode_timings_p6_db_mod3, opcode_deps_db, opcode_deps_db_mod3, CODEGEN_TIMING_IDX_REG, CODEGEN_TIMING_IDX_LOW6);
+    codegen_timing_map_prefix(&opcode_map, 0xdc, opcode_timings_p6_dc, opcode_timings_p6_dc_mod3, opcode_deps_dc, opcode_deps_dc_mod3, CODEGEN_TIMING_IDX_REG, CODEGEN_TIMING_IDX_REG);
+    codegen_timing_map_prefix(&opcode_map, 0xdd, opcode_timings_p6_dd, opcode_timings_p6_dd_mod3, opcode_deps_dd, opcode_deps_dd_mod3, CODEGEN_TIMING_IDX_REG, CODEGEN_TIMING_IDX_REG);
+    codegen_timing_map_prefix(&opcode_map, 0xde, opcode_timings_p6_de, opcode_timings_p6_de_mod3, opcode_deps_de, opcode_deps_de_mod3, CODEGEN_TIMING_IDX_REG, CODEGEN_TIMING_IDX_REG);
+    codegen_timing_map_prefix(&opcode_map, 0xdf, opcode_timings_p6_df, opcode_timings_p6_df_mod3, opcode_deps_df, opcode_deps_df_mod3, CODEGEN_TIMING_IDX_REG, CODEGEN_TIMING_IDX_REG);
+
+    codegen_timing_map_group(&opcode_map, 0x80, opcode_timings_p6_80, opcode_timings_p6_80_mod3, opcode_deps_8x, opcode_deps_8x_mod3);
+    codegen_timing_map_group(&opcode_map, 0x82, opcode_timings_p6_80, opcode_timings_p6_80_mod3, opcode_deps_8x, opcode_deps_8x_mod3);
+    codegen_timing_map_group(&opcode_map, 0x81, opcode_timings_p6_8x, opcode_timings_p6_8x_mod3, opcode_deps_8x, opcode_deps_8x_mod3);
+    codegen_timing_map_group(&opcode_map, 0x83, opcode_timings_p6_8x, opcode_timings_p6_8x_mod3, opcode_deps_8x, opcode_deps_8x_mod3);
+    codegen_timing_map_group(&opcode_map, 0xc0, opcode_timings_p6_shift_b, opcode_timings_p6_shift_b_mod3, opcode_deps_shift, opcode_deps_shift_mod3);
+    codegen_timing_map_group(&opcode_map, 0xd0, opcode_timings_p6_shift_b, opcode_timings_p6_shift_b_mod3, opcode_deps_shift, opcode_deps_shift_mod3);
+    codegen_timing_map_group(&opcode_map, 0xd2, opcode_timings_p6_shift_b, opcode_timings_p6_shift_b_mod3, opcode_deps_shift, opcode_deps_shift_mod3);
+    codegen_timing_map_group(&opcode_map, 0xc1, opcode_timings_p6_shift, opcode_timings_p6_shift_mod3, opcode_deps_shift, opcode_deps_shift_mod3);
+    codegen_timing_map_group(&opcode_map, 0xd1, opcode_timings_p6_shift, opcode_timings_p6_shift_mod3, opcode_deps_shift, opcode_deps_shift_mod3);
+    codegen_timing_map_group(&opcode_map, 0xd3, opcode_timings_p6_shift, opcode_timings_p6_shift_mod3, opcode_deps_shift, opcode_deps_shift_mod3);
+    codegen_timing_map_group(&opcode_map, 0xf6, opcode_timings_p6_f6, opcode_timings_p6_f6_mod3, opcode_deps_f6, opcode_deps_f6_mod3);
+    codegen_timing_map_group(&opcode_map, 0xf7, opcode_timings_p6_f7, opcode_timings_p6_f7_mod3, opcode_deps_f7, opcode_deps_f7_mod3);
+    codegen_timing_map_group(&opcode_map, 0xff, opcode_timings_p6_ff, opcode_timings_p6_ff_mod3, opcode_deps_ff, opcode_deps_ff_mod3);
+
+    opcode_map_built = 1;
+}
+
 void
 codegen_timing_p6_start(void)
 {
+    if (!opcode_map_built)
+        codegen_timing_p6_map_init();
+
     if (cpu_s->cpu_type == CPU_PENTIUMPRO) {
         units    = ppro_units;
         nr_units = NR_PPRO_UNITS;
@@ -1857,112 +1895,15 @@ codegen_timing_p6_prefix(uint8_t prefix, UNUSED(uint32_t fetchdat))
 void
 codegen_timing_p6_opcode(uint8_t opcode, UNUSED(uint32_t fetchdat), int op_32, UNUSED(uint32_t op_pc))
 {
-    const macro_op_t **ins_table;
-    const uint64_t    *deps;
-    int                mod3                        = ((fetchdat & 0xc0) == 0xc0);
-    int                old_last_complete_timestamp = last_complete_timestamp;
-    int                bit8                        = !(opcode & 1);
-
-    switch (last_prefix) {
-        case 0x0f:
-            ins_table = mod3 ? opcode_timings_p6_0f_mod3 : opcode_timings_p6_0f;
-            deps      = mod3 ? opcode_deps_0f_mod3 : opcode_deps_0f;
-            break;
-
-        case 0xd8:
-            ins_table = mod3 ? opcode_timings_p6_d8_mod3 : opcode_timings_p6_d8;
-            deps      = mod3 ? opcode_deps_d8_mod3 : opcode_deps_d8;
-            opcode    = (opcode >> 3) & 7;
-            break;
-        case 0xd9:
-            ins_table = mod3 ? opcode_timings_p6_d9_mod3 : opcode_timings_p6_d9;
-            deps      = mod3 ? opcode_deps_d9_mod3 : opcode_deps_d9;
-            opcode    = mod3 ? opcode & 0x3f : (opcode >> 3) & 7;
-            break;
-        case 0xda:
-            ins_table = mod3 ? opcode_timings_p6_da_mod3 : opcode_timings_p6_da;
-            deps      = mod3 ? opcode_deps_da_mod3 : opcode_deps_da;
-            opcode    = (opcode >> 3) & 7;
-            break;
-        case 0xdb:
-            ins_table = mod3 ? opcode_timings_p6_db_mod3 : opcode_timings_p6_db;
-            deps      = mod3 ? opcode_deps_db_mod3 : opcode_deps_db;
-            opcode    = mod3 ? opcode & 0x3f : (opcode >> 3) & 7;
-            break;
-        case 0xdc:
-            ins_table = mod3 ? opcode_timings_p6_dc_mod3 : opcode_timings_p6_dc;
-            deps      = mod3 ? opcode_deps_dc_mod3 : opcode_deps_dc;
-            opcode    = (opcode >> 3) & 7;
-            break;
-        case 0xdd:
-            ins_table = mod3 ? opcode_timings_p6_dd_mod3 : opcode_timings_p6_dd;
-            deps      = mod3 ? opcode_deps_dd_mod3 : opcode_deps_dd;
-            opcode    = (opcode >> 3) & 7;
-            break;
-        case 0xde:
-            ins_table = mod3 ? opcode_timings_p6_de_mod3 : opcode_timings_p6_de;
-            deps      = mod3 ? opcode_deps_de_mod3 : opcode_deps_de;
-            opcode    = (opcode >> 3) & 7;
-            break;
-        case 0xdf:
-            ins_table = mod3 ? opcode_timings_p6_df_mod3 : opcode_timings_p6_df;
-            deps      = mod3 ? opcode_deps_df_mod3 : opcode_deps_df;
-            opcode    = (opcode >> 3) & 7;
-            break;
-
-        default:
-            switch (opcode) {
-                case 0x80:
-                case 0x82:
-                    ins_table = mod3 ? opcode_timings_p6_80_mod3 : opcode_timings_p6_80;
-                    deps      = mod3 ? opcode_deps_8x_mod3 : opcode_deps_8x;
-                    opcode    = (fetchdat >> 3) & 7;
-                    break;
-                case 0x81:
-                case 0x83:
-                    ins_table = mod3 ? opcode_timings_p6_8x_mod3 : opcode_timings_p6_8x;
-                    deps      = mod3 ? opcode_deps_8x_mod3 : opcode_deps_8x;
-                    opcode    = (fetchdat >> 3) & 7;
-                    break;
-
-                case 0xc0:
-                case 0xd0:
-                case 0xd2:
-                    ins_table = mod3 ? opcode_timings_p6_shift_b_mod3 : opcode_timings_p6_shift_b;
-                    deps      = mod3 ? opcode_deps_shift_mod3 : opcode_deps_shift;
-                    opcode    = (fetchdat >> 3) & 7;
-                    break;
-
-                case 0xc1:
-                case 0xd1:
-                case 0xd3:
-                    ins_table = mod3 ? opcode_timings_p6_shift_mod3 : opcode_timings_p6_shift;
-                    deps      = mod3 ? opcode_deps_shift_mod3 : opcode_deps_shift;
-                    opcode    = (fetchdat >> 3) & 7;
-                    break;
-
-                case 0xf6:
-                    ins_table = mod3 ? opcode_timings_p6_f6_mod3 : opcode_timings_p6_f6;
-                    deps      = mod3 ? opcode_deps_f6_mod3 : opcode_deps_f6;
-                    opcode    = (fetchdat >> 3) & 7;
-                    break;
-                case 0xf7:
-                    ins_table = mod3 ? opcode_timings_p6_f7_mod3 : opcode_timings_p6_f7;
-                    deps      = mod3 ? opcode_deps_f7_mod3 : opcode_deps_f7;
-                    opcode    = (fetchdat >> 3) & 7;
-                    break;
-                case 0xff:
-                    ins_table = mod3 ? opcode_timings_p6_ff_mod3 : opcode_timings_p6_ff;
-                    deps      = mod3 ? opcode_deps_ff_mod3 : opcode_deps_ff;
-                    opcode    = (fetchdat >> 3) & 7;
-                    break;
-
-                default:
-                    ins_table = mod3 ? opcode_timings_p6_mod3 : opcode_timings_p6;
-                    deps      = mod3 ? opcode_deps_mod3 : opcode_deps;
-                    break;
-            }
-    }
+    const macro_op_t          **ins_table;
+    const uint64_t             *deps;
+    const codegen_timing_sel_t *sel;
+    int                         old_last_complete_timestamp = last_complete_timestamp;
+    int                         bit8                        = !(opcode & 1);
+
+    sel       = codegen_timing_lookup(&opcode_map, last_prefix, fetchdat, &opcode);
+    ins_table = (const macro_op_t **) sel->timings;
+    deps      = sel->deps;
 
     if (ins_table[opcode])
         decode_instruction(ins_table[opcode], deps[opcode], fetchdat, op_32, bit8);
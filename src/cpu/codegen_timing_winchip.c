@@ -320,9 +320,47 @@ codegen_timing_winchip_block_start(void)
     regmask_modified = 0;
 }
 
+static codegen_timing_map_t opcode_map;
+static int                  opcode_map_built = 0;
+
+static void
+codegen_timing_winchip_map_init(void)
+{
+    codegen_timing_map_init(&opcode_map, opcode_timings_winchip, opcode_timings_winchip_mod3, opcode_deps, opcode_deps_mod3);
+
+    codegen_timing_map_prefix(&opcode_map, 0x0f, opcode_timings_winchip_0f, opcode_timings_winchip_0f_mod3, opcode_deps_0f, opcode_deps_0f_mod3, CODEGEN_TIMING_IDX_OPCODE, CODEGEN_TIMING_IDX_OPCODE);
+    codegen_timing_map_prefix(&opcode_map, 0xd8, opcode_timings_winchip_d8, opcode_timings_winchip_d8_mod3, opcode_deps_d8, opcode_deps_d8_mod3, CODEGEN_TIMING_IDX_REG, CODEGEN_TIMING_IDX_REG);
+    codegen_timing_map_prefix(&opcode_map, 0xd9, opcode_timings_winchip_d9, opcode_timings_winchip_d9_mod3, opcode_deps_d9, opcode_deps_d9_mod3, CODEGEN_TIMING_IDX_REG, CODEGEN_TIMING_IDX_LOW6);
+    codegen_timing_map_prefix(&opcode_map, 0xda, opcode_timings_winchip_da, opcode_timings_winchip_da_mod3, opcode_deps_da, opcode_deps_da_mod3, CODEGEN_TIMING_IDX_REG, CODEGEN_TIMING_IDX_REG);
+    codegen_timing_map_prefix(&opcode_map, 0xdb, opcode_timings_winchip_db, opcode_timings_winchip_db_mod3, opcode_deps_db, opcode_deps_db_mod3, CODEGEN_TIMING_IDX_REG, CODEGEN_TIMING_IDX_LOW6);
+    codegen_timing_map_prefix(&opcode_map, 0xdc, opcode_timings_winchip_dc, opcode_timings_winchip_dc_mod3, opcode_deps_dc, opcode_deps_dc_mod3, CODEGEN_TIMING_IDX_REG, CODEGEN_TIMING_IDX_REG);
+    codegen_timing_map_prefix(&opcode_map, 0xdd, opcode_timings_winchip_dd, opcode_timings_winchip_dd_mod3, opcode_deps_dd, opcode_deps_dd_mod3, CODEGEN_TIMING_IDX_REG, CODEGEN_TIMING_IDX_REG);
+    codegen_timing_map_prefix(&opcode_map, 0xde, opcode_timings_winchip_de, opcode_timings_winchip_de_mod3, opcode_deps_de, opcode_deps_de_mod3, CODEGEN_TIMING_IDX_REG, CODEGEN_TIMING_IDX_REG);
+    codegen_timing_map_prefix(&opcode_map, 0xdf, opcode_timings_winchip_df, opcode_timings_winchip_df_mod3, opcode_deps_df, opcode_deps_df_mod3, CODEGEN_TIMING_IDX_REG, CODEGEN_TIMING_IDX_REG);
+
+    codegen_timing_map_group(&opcode_map, 0x80, opcode_timings_winchip_8x, opcode_timings_winchip_8x_mod3, opcode_deps_8x, opcode_deps_8x_mod3);
+    codegen_timing_map_group(&opcode_map, 0x82, opcode_timings_winchip_8x, opcode_timings_winchip_8x_mod3, opcode_deps_8x, opcode_deps_8x_mod3);
+    codegen_timing_map_group(&opcode_map, 0x83, opcode_timings_winchip_8x, opcode_timings_winchip_8x_mod3, opcode_deps_8x, opcode_deps_8x_mod3);
+    codegen_timing_map_group(&opcode_map, 0x81, opcode_timings_winchip_81, opcode_timings_winchip_81_mod3, opcode_deps_81, opcode_deps_81_mod3);
+    codegen_timing_map_group(&opcode_map, 0xc0, opcode_timings_winchip_shift, opcode_timings_winchip_shift_mod3, opcode_deps_shift, opcode_deps_shift_mod3);
+    codegen_timing_map_group(&opcode_map, 0xc1, opcode_timings_winchip_shift, opcode_timings_winchip_shift_mod3, opcode_deps_shift, opcode_deps_shift_mod3);
+    codegen_timing_map_group(&opcode_map, 0xd0, opcode_timings_winchip_shift, opcode_timings_winchip_shift_mod3, opcode_deps_shift, opcode_deps_shift_mod3);
+    codegen_timing_map_group(&opcode_map, 0xd1, opcode_timings_winchip_shift, opcode_timings_winchip_shift_mod3, opcode_deps_shift, opcode_deps_shift_mod3);
+    codegen_timing_map_group(&opcode_map, 0xd2, opcode_timings_winchip_shift, opcode_timings_winchip_shift_mod3, opcode_deps_shift, opcode_deps_shift_mod3);
+    codegen_timing_map_group(&opcode_map, 0xd3, opcode_timings_winchip_shift, opcode_timings_winchip_shift_mod3, opcode_deps_shift, opcode_deps_shift_mod3);
+    codegen_timing_map_group(&opcode_map, 0xf6, opcode_timings_winchip_f6, opcode_timings_winchip_f6_mod3, opcode_deps_f6, opcode_deps_f6_mod3);
+    codegen_timing_map_group(&opcode_map, 0xf7, opcode_timings_winchip_f7, opcode_timings_winchip_f7_mod3, opcode_deps_f7, opcode_deps_f7_mod3);
+    codegen_timing_map_group(&opcode_map, 0xff, opcode_timings_winchip_ff, opcode_timings_winchip_ff_mod3, opcode_deps_ff, opcode_deps_ff_mod3);
+
+    opcode_map_built = 1;
+}
+
 void
 codegen_timing_winchip_start(void)
 {
+    if (!opcode_map_built)
+        codegen_timing_winchip_map_init();
+
     timing_count = 0;
     last_prefix  = 0;
 }
@@ -337,106 +375,14 @@ codegen_timing_winchip_prefix(uint8_t prefix, UNUSED(uint32_t fetchdat))
 void
 codegen_timing_winchip_opcode(uint8_t opcode, uint32_t fetchdat, int op_32, UNUSED(uint32_t op_pc))
 {
-    int           **timings;
-    const uint64_t *deps;
-    int             mod3 = ((fetchdat & 0xc0) == 0xc0);
-    int             bit8 = !(opcode & 1);
-
-    switch (last_prefix) {
-        case 0x0f:
-            timings = mod3 ? opcode_timings_winchip_0f_mod3 : opcode_timings_winchip_0f;
-            deps    = mod3 ? opcode_deps_0f_mod3 : opcode_deps_0f;
-            break;
-
-        case 0xd8:
-            timings = mod3 ? opcode_timings_winchip_d8_mod3 : opcode_timings_winchip_d8;
-            deps    = mod3 ? opcode_deps_d8_mod3 : opcode_deps_d8;
-            opcode  = (opcode >> 3) & 7;
-            break;
-        case 0xd9:
-            timings = mod3 ? opcode_timings_winchip_d9_mod3 : opcode_timings_winchip_d9;
-            deps    = mod3 ? opcode_deps_d9_mod3 : opcode_deps_d9;
-            opcode  = mod3 ? opcode & 0x3f : (opcode >> 3) & 7;
-            break;
-        case 0xda:
-            timings = mod3 ? opcode_timings_winchip_da_mod3 : opcode_timings_winchip_da;
-            deps    = mod3 ? opcode_deps_da_mod3 : opcode_deps_da;
-            opcode  = (opcode >> 3) & 7;
-            break;
-        case 0xdb:
-            timings = mod3 ? opcode_timings_winchip_db_mod3 : opcode_timings_winchip_db;
-            deps    = mod3 ? opcode_deps_db_mod3 : opcode_deps_db;
-            opcode  = mod3 ? opcode & 0x3f : (opcode >> 3) & 7;
-            break;
-        case 0xdc:
-            timings = mod3 ? opcode_timings_winchip_dc_mod3 : opcode_timings_winchip_dc;
-            deps    = mod3 ? opcode_deps_dc_mod3 : opcode_deps_dc;
-            opcode  = (opcode >> 3) & 7;
-            break;
-        case 0xdd:
-            timings = mod3 ? opcode_timings_winchip_dd_mod3 : opcode_timings_winchip_dd;
-            deps    = mod3 ? opcode_deps_dd_mod3 : opcode_deps_dd;
-            opcode  = (opcode >> 3) & 7;
-            break;
-        case 0xde:
-            timings = mod3 ? opcode_timings_winchip_de_mod3 : opcode_timings_winchip_de;
-            deps    = mod3 ? opcode_deps_de_mod3 : opcode_deps_de;
-            opcode  = (opcode >> 3) & 7;
-            break;
-        case 0xdf:
-            timings = mod3 ? opcode_timings_winchip_df_mod3 : opcode_timings_winchip_df;
-            deps    = mod3 ? opcode_deps_df_mod3 : opcode_deps_df;
-            opcode  = (opcode >> 3) & 7;
-            break;
-
-        default:
-            switch (opcode) {
-                case 0x80:
-                case 0x82:
-                case 0x83:
-                    timings = mod3 ? opcode_timings_winchip_8x_mod3 : opcode_timings_winchip_8x;
-                    deps    = mod3 ? opcode_deps_8x_mod3 : opcode_deps_8x;
-                    opcode  = (fetchdat >> 3) & 7;
-                    break;
-                case 0x81:
-                    timings = mod3 ? opcode_timings_winchip_81_mod3 : opcode_timings_winchip_81;
-                    deps    = mod3 ? opcode_deps_81_mod3 : opcode_deps_81;
-                    opcode  = (fetchdat >> 3) & 7;
-                    break;
-
-                case 0xc0:
-                case 0xc1:
-                case 0xd0:
-                case 0xd1:
-                case 0xd2:
-                case 0xd3:
-                    timings = mod3 ? opcode_timings_winchip_shift_mod3 : opcode_timings_winchip_shift;
-                    deps    = mod3 ? opcode_deps_shift_mod3 : opcode_deps_shift;
-                    opcode  = (fetchdat >> 3) & 7;
-                    break;
-
-                case 0xf6:
-                    timings = mod3 ? opcode_timings_winchip_f6_mod3 : opcode_timings_winchip_f6;
-                    deps    = mod3 ? opcode_deps_f6_mod3 : opcode_deps_f6;
-                    opcode  = (fetchdat >> 3) & 7;
-                    break;
-                case 0xf7:
-                    timings = mod3 ? opcode_timings_winchip_f7_mod3 : opcode_timings_winchip_f7;
-                    deps    = mod3 ? opcode_deps_f7_mod3 : opcode_deps_f7;
-                    opcode  = (fetchdat >> 3) & 7;
-                    break;
-                case 0xff:
-                    timings = mod3 ? opcode_timings_winchip_ff_mod3 : opcode_timings_winchip_ff;
-                    deps    = mod3 ? opcode_deps_ff_mod3 : opcode_deps_ff;
-                    opcode  = (fetchdat >> 3) & 7;
-                    break;
-
-                default:
-                    timings = mod3 ? opcode_timings_winchip_mod3 : opcode_timings_winchip;
-                    deps    = mod3 ? opcode_deps_mod3 : opcode_deps;
-                    break;
-            }
-    }
+    int                       **timings;
+    const uint64_t             *deps;
+    const codegen_timing_sel_t *sel;
+    int                         bit8 = !(opcode & 1);
+
+    sel     = codegen_timing_lookup(&opcode_map, last_prefix, fetchdat, &opcode);
+    timings = (int **) sel->timings;
+    deps    = sel->deps;
 
     timing_count += COUNT(timings[opcode], op_32);
     if (regmask_modified & get_addr_regmask(deps[opcode], fetchdat, op_32))
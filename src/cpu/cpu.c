@@ -42,6 +42,8 @@
 #include <86box/pci.h>
 #include <86box/timer.h>
 #include <86box/gdbstub.h>
+#include <86box/kvm.h>
+#include <86box/name_index.h>
 #include <86box/plat_fallthrough.h>
 #include <86box/plat_unused.h>
 
@@ -340,18 +342,20 @@ cpu_set_edx(void)
         SF_FPU_reset();
 }
 
+static const char *
+cpu_family_index_name(int c)
+{
+    return cpu_families[c].package ? cpu_families[c].internal_name : NULL;
+}
+
+static name_index_t cpu_family_index = NAME_INDEX_INIT(cpu_family_index_name);
+
 cpu_family_t *
 cpu_get_family(const char *internal_name)
 {
-    int c = 0;
-
-    while (cpu_families[c].package) {
-        if (!strcmp(internal_name, cpu_families[c].internal_name))
-            return (cpu_family_t *) &cpu_families[c];
-        c++;
-    }
+    int c = name_index_find(&cpu_family_index, internal_name);
 
-    return NULL;
+    return (c >= 0) ? (cpu_family_t *) &cpu_families[c] : NULL;
 }
 
 uint8_t
@@ -789,6 +793,7 @@ cpu_set(void)
         case CPU_286:
 #ifdef USE_DYNAREC
             x86_setopcodes(ops_286, ops_286_0f, dynarec_ops_286, dynarec_ops_286_0f);
+            codegen_timing_set(&codegen_timing_286);
 #else
             x86_setopcodes(ops_286, ops_286_0f);
 #endif /* USE_DYNAREC */
@@ -1837,6 +1842,11 @@ cpu_set(void)
     cpu_use_exec = 0;
 
     if (is386) {
+#if defined(USE_KVM) && !defined(USE_GDBSTUB)
+        if (cpu_use_kvm && kvm_init())
+            cpu_exec = kvm_exec;
+        else
+#endif /* defined(USE_KVM) && !defined(USE_GDBSTUB) */
 #if defined(USE_DYNAREC) && !defined(USE_GDBSTUB)
         if (cpu_use_dynarec) {
             cpu_exec = exec386_dynarec;
@@ -1850,9 +1860,15 @@ cpu_set(void)
                 cpu_use_exec = 1;
             } else
                 cpu_exec = exec386_2386;
-    } else if (cpu_s->cpu_type >= CPU_286)
-        cpu_exec = exec386_2386;
-    else
+    } else if (cpu_s->cpu_type >= CPU_286) {
+#if defined(USE_NEW_DYNAREC) && !defined(USE_GDBSTUB)
+        if (cpu_use_dynarec) {
+            cpu_exec = exec386_dynarec;
+            cpu_use_exec = 1;
+        } else
+#endif /* defined(USE_NEW_DYNAREC) && !defined(USE_GDBSTUB) */
+            cpu_exec = exec386_2386;
+    } else
         cpu_exec = execx86;
     mmx_init();
     gdbstub_cpu_init();
@@ -1862,6 +1878,10 @@ void
 cpu_close(void)
 {
     cpu_inited = 0;
+
+#ifdef USE_KVM
+    kvm_close();
+#endif
 }
 
 void
@@ -1014,7 +1014,7 @@ const cpu_family_t cpu_families[] = {
                 .edx_reset          = 0,
                 .cpuid_model        = 0,
                 .cyrix_id           = 0,
-                .cpu_flags          = 0,
+                .cpu_flags          = CPU_SUPPORTS_DYNAREC,
                 .mem_read_cycles    = 2,
                 .mem_write_cycles   = 2,
                 .cache_read_cycles  = 2,
@@ -1031,7 +1031,7 @@ const cpu_family_t cpu_families[] = {
                 .edx_reset          = 0,
                 .cpuid_model        = 0,
                 .cyrix_id           = 0,
-                .cpu_flags          = 0,
+                .cpu_flags          = CPU_SUPPORTS_DYNAREC,
                 .mem_read_cycles    = 2,
                 .mem_write_cycles   = 2,
                 .cache_read_cycles  = 2,
@@ -1048,7 +1048,7 @@ const cpu_family_t cpu_families[] = {
                 .edx_reset          = 0,
                 .cpuid_model        = 0,
                 .cyrix_id           = 0,
-                .cpu_flags          = 0,
+                .cpu_flags          = CPU_SUPPORTS_DYNAREC,
                 .mem_read_cycles    = 2,
                 .mem_write_cycles   = 2,
                 .cache_read_cycles  = 2,
@@ -1065,7 +1065,7 @@ const cpu_family_t cpu_families[] = {
                 .edx_reset          = 0,
                 .cpuid_model        = 0,
                 .cyrix_id           = 0,
-                .cpu_flags          = 0,
+                .cpu_flags          = CPU_SUPPORTS_DYNAREC,
                 .mem_read_cycles    = 3,
                 .mem_write_cycles   = 3,
                 .cache_read_cycles  = 3,
@@ -1082,7 +1082,7 @@ const cpu_family_t cpu_families[] = {
                 .edx_reset          = 0,
                 .cpuid_model        = 0,
                 .cyrix_id           = 0,
-                .cpu_flags          = 0,
+                .cpu_flags          = CPU_SUPPORTS_DYNAREC,
                 .mem_read_cycles    = 3,
                 .mem_write_cycles   = 3,
                 .cache_read_cycles  = 3,
@@ -1099,7 +1099,7 @@ const cpu_family_t cpu_families[] = {
                 .edx_reset          = 0,
                 .cpuid_model        = 0,
                 .cyrix_id           = 0,
-                .cpu_flags          = 0,
+                .cpu_flags          = CPU_SUPPORTS_DYNAREC,
                 .mem_read_cycles    = 4,
                 .mem_write_cycles   = 4,
                 .cache_read_cycles  = 4,
@@ -1116,7 +1116,7 @@ const cpu_family_t cpu_families[] = {
                 .edx_reset          = 0,
                 .cpuid_model        = 0,
                 .cyrix_id           = 0,
-                .cpu_flags          = 0,
+                .cpu_flags          = CPU_SUPPORTS_DYNAREC,
                 .mem_read_cycles    = 4,
                 .mem_write_cycles   = 4,
                 .cache_read_cycles  = 4,
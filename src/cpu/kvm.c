@@ -0,0 +1,1017 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          KVM execution backend.
+ *
+ *          The guest runs on a single virtual CPU, without an in-kernel
+ *          interrupt controller. Every 4K chunk of the memory map that
+ *          is plain RAM is handed to the VM as writable memory, chunks
+ *          the CPU can execute from but not write as read-only memory
+ *          (ROMs that are not page aligned in the host go through a
+ *          page aligned copy), and everything else is left out, so that
+ *          accessing it exits back here and goes through the mappings
+ *          much like the interpreter would. Port I/O exits the same way.
+ *
+ *          Emulated time follows the host clock while the guest runs,
+ *          and skips ahead to the next timer while it is halted. A host
+ *          timer ends the run when the slice is over or the next timer
+ *          is due, whichever comes first, and interrupts raised by the
+ *          timers and devices are injected from the emulated PIC when
+ *          the guest can take them.
+ *
+ *          The virtual CPU owns the CPU state while the guest runs. It
+ *          is loaded from cpu_state after a reset or a snapshot load,
+ *          and cpu_state is brought up to date from it at the end of
+ *          every slice.
+ *
+ *          Not handled: SMM, the emulated MSRs (the guest gets those of
+ *          KVM), and the local APIC, which is hidden from CPUID.
+ */
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <wchar.h>
+#include <pthread.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/kvm.h>
+#define HAVE_STDARG_H
+#include <86box/86box.h>
+#include "cpu.h"
+#include "x86.h"
+#include "x86_flags.h"
+#include "x87_sf.h"
+#include "x87.h"
+#include "x87_ops_conv.h"
+#include <86box/io.h>
+#include <86box/mem.h>
+#include <86box/nmi.h>
+#include <86box/pic.h>
+#include <86box/timer.h>
+#include <86box/plat_unused.h>
+#include <86box/kvm.h>
+
+/* The names of these are taken by fields of struct kvm_sregs. */
+#undef cs
+#undef ds
+#undef es
+#undef ss
+#undef gs
+#undef cr0
+
+#ifndef sigev_notify_thread_id
+#    define sigev_notify_thread_id _sigev_un._tid
+#endif
+
+#define KVM_KICK_SIGNAL SIGUSR2
+#define KVM_MIN_RUN_NS  20000 /* So a timer that is already due does not end every run straight away. */
+#define KVM_MAX_SLOTS   256
+#define KVM_MAX_SHADOW  512   /* Pages of unaligned ROM that can be mapped, 2 MB. */
+#define KVM_MAX_CPUID   64
+
+/* Guest physical pages KVM needs for itself on VMX hosts, out of the way
+   of RAM and of the BIOS at the top of memory. */
+#define KVM_IDENTITY_MAP_ADDR 0xfeffc000
+#define KVM_TSS_ADDR          0xfeffd000
+#define KVM_RAM_LIMIT         0xfeffc000
+
+typedef struct kvm_slot_t {
+    uint64_t gpa;
+    uint64_t size;
+    uint8_t *host;
+    uint32_t flags;
+} kvm_slot_t;
+
+typedef struct kvm_shadow_t {
+    uint32_t gpa;
+    uint8_t *src;
+} kvm_shadow_t;
+
+static int             kvm_fd      = -1;
+static int             kvm_vm_fd   = -1;
+static int             kvm_vcpu_fd = -1;
+static struct kvm_run *kvm_run;
+static size_t          kvm_run_size;
+static timer_t         kvm_kick_timer;
+static int             kvm_kick_init_done;
+
+static kvm_slot_t   kvm_slots[KVM_MAX_SLOTS];
+static int          kvm_nr_slots;
+static int          kvm_max_slots;
+static uint8_t     *kvm_shadow_mem;
+static kvm_shadow_t kvm_shadow[KVM_MAX_SHADOW];
+static int          kvm_nr_shadow;
+
+static int kvm_mem_dirty   = 1;
+static int kvm_state_dirty = 1;
+static int kvm_exit_pending;
+static int kvm_halted;
+
+#ifdef ENABLE_KVM_LOG
+int kvm_do_log = ENABLE_KVM_LOG;
+
+static void
+kvm_log(const char *fmt, ...)
+{
+    va_list ap;
+
+    if (kvm_do_log) {
+        va_start(ap, fmt);
+        pclog_ex(fmt, ap);
+        va_end(ap);
+    }
+}
+#else
+#    define kvm_log(fmt, ...)
+#endif
+
+static uint64_t
+kvm_host_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t) ts.tv_sec * 1000000000ULL) + ts.tv_nsec;
+}
+
+/* Memory. */
+static void
+kvm_mem_add_page(uint32_t gpa, uint8_t *host, uint32_t flags)
+{
+    kvm_slot_t *slot = &kvm_slots[kvm_nr_slots - 1];
+
+    if (kvm_nr_slots && (slot->flags == flags) && ((slot->gpa + slot->size) == gpa) &&
+        ((slot->host + slot->size) == host)) {
+        slot->size += MEM_GRANULARITY_SIZE;
+        return;
+    }
+
+    /* Out of slots, the rest is accessed through exits. */
+    if (kvm_nr_slots >= kvm_max_slots)
+        return;
+
+    slot        = &kvm_slots[kvm_nr_slots++];
+    slot->gpa   = gpa;
+    slot->size  = MEM_GRANULARITY_SIZE;
+    slot->host  = host;
+    slot->flags = flags;
+}
+
+static void
+kvm_mem_scan(uint32_t start, uint32_t end)
+{
+    for (uint64_t gpa = start; gpa < end; gpa += MEM_GRANULARITY_SIZE) {
+        uint32_t             addr  = (uint32_t) gpa & rammask;
+        uint8_t             *host  = _mem_exec[addr >> MEM_GRANULARITY_BITS];
+        const mem_mapping_t *map   = write_mapping[addr >> MEM_GRANULARITY_BITS];
+        uint32_t             flags = KVM_MEM_READONLY;
+
+        if (host == NULL)
+            continue;
+
+        if (map && (map->write_b == mem_write_ram) && (map->write_w == mem_write_ramw) &&
+            (map->write_l == mem_write_raml) && (host == &ram[addr]))
+            flags = 0;
+
+        if (((uintptr_t) host) & (MEM_GRANULARITY_SIZE - 1)) {
+            uint8_t *page;
+
+            if (!flags || (kvm_nr_shadow >= KVM_MAX_SHADOW))
+                continue;
+
+            page = &kvm_shadow_mem[kvm_nr_shadow << MEM_GRANULARITY_BITS];
+            memcpy(page, host, MEM_GRANULARITY_SIZE);
+            kvm_shadow[kvm_nr_shadow].gpa = (uint32_t) gpa;
+            kvm_shadow[kvm_nr_shadow].src = host;
+            kvm_nr_shadow++;
+            host = page;
+        }
+
+        kvm_mem_add_page((uint32_t) gpa, host, flags);
+    }
+}
+
+static void
+kvm_mem_update(void)
+{
+    struct kvm_userspace_memory_region region;
+    uint64_t                           ram_top = (uint64_t) mem_size << 10;
+    int                                old_slots = kvm_nr_slots;
+
+    memset(&region, 0x00, sizeof(region));
+    for (int i = 0; i < old_slots; i++) {
+        region.slot = i;
+        ioctl(kvm_vm_fd, KVM_SET_USER_MEMORY_REGION, &region);
+    }
+
+    kvm_nr_slots  = 0;
+    kvm_nr_shadow = 0;
+
+    if (ram_top < 0x100000)
+        ram_top = 0x100000;
+    if (ram_top > KVM_RAM_LIMIT)
+        ram_top = KVM_RAM_LIMIT;
+    kvm_mem_scan(0x00000000, (uint32_t) ram_top);
+    kvm_mem_scan(0xfff00000, 0xffffffff);
+
+    for (int i = 0; i < kvm_nr_slots; i++) {
+        region.slot            = i;
+        region.flags           = kvm_slots[i].flags;
+        region.guest_phys_addr = kvm_slots[i].gpa;
+        region.memory_size     = kvm_slots[i].size;
+        region.userspace_addr  = (uintptr_t) kvm_slots[i].host;
+        if (ioctl(kvm_vm_fd, KVM_SET_USER_MEMORY_REGION, &region) < 0)
+            fatal("KVM: unable to map %08X-%08X: %s\n", (uint32_t) kvm_slots[i].gpa,
+                  (uint32_t) (kvm_slots[i].gpa + kvm_slots[i].size - 1), strerror(errno));
+    }
+
+    kvm_log("KVM: %i slots, %i shadowed ROM pages\n", kvm_nr_slots, kvm_nr_shadow);
+    kvm_mem_dirty = 0;
+}
+
+/* A write that went through the mappings may have changed a ROM the guest
+   sees through a copy, at this address and at any alias of it. */
+static void
+kvm_shadow_refresh(uint32_t addr)
+{
+    uint8_t *src = NULL;
+
+    addr &= ~(MEM_GRANULARITY_SIZE - 1);
+    for (int i = 0; i < kvm_nr_shadow; i++) {
+        if (kvm_shadow[i].gpa == addr) {
+            src = kvm_shadow[i].src;
+            break;
+        }
+    }
+    if (src == NULL)
+        return;
+
+    for (int i = 0; i < kvm_nr_shadow; i++) {
+        if (kvm_shadow[i].src == src)
+            memcpy(&kvm_shadow_mem[i << MEM_GRANULARITY_BITS], src, MEM_GRANULARITY_SIZE);
+    }
+}
+
+/* Exits. */
+static uint32_t
+kvm_mmio_read(uint32_t addr, int len)
+{
+    const mem_mapping_t *map = read_mapping[addr >> MEM_GRANULARITY_BITS];
+    uint32_t             ret = 0;
+
+    if (map && (len == 4) && map->read_l && ((addr & MEM_GRANULARITY_MASK) <= (MEM_GRANULARITY_MASK - 3)))
+        return map->read_l(addr, map->priv);
+    if (map && (len == 2) && map->read_w && ((addr & MEM_GRANULARITY_MASK) != MEM_GRANULARITY_MASK))
+        return map->read_w(addr, map->priv);
+
+    for (int i = 0; i < len; i++) {
+        map = read_mapping[(addr + i) >> MEM_GRANULARITY_BITS];
+        ret |= ((map && map->read_b) ? map->read_b(addr + i, map->priv) : 0xff) << (i << 3);
+    }
+
+    return ret;
+}
+
+static void
+kvm_mmio_write(uint32_t addr, uint32_t val, int len)
+{
+    const mem_mapping_t *map = write_mapping[addr >> MEM_GRANULARITY_BITS];
+
+    if (map && (len == 4) && map->write_l && ((addr & MEM_GRANULARITY_MASK) <= (MEM_GRANULARITY_MASK - 3))) {
+        map->write_l(addr, val, map->priv);
+        return;
+    }
+    if (map && (len == 2) && map->write_w && ((addr & MEM_GRANULARITY_MASK) != MEM_GRANULARITY_MASK)) {
+        map->write_w(addr, val, map->priv);
+        return;
+    }
+
+    for (int i = 0; i < len; i++) {
+        map = write_mapping[(addr + i) >> MEM_GRANULARITY_BITS];
+        if (map && map->write_b)
+            map->write_b(addr + i, val >> (i << 3), map->priv);
+    }
+}
+
+static void
+kvm_handle_mmio(void)
+{
+    uint32_t addr = (uint32_t) kvm_run->mmio.phys_addr & rammask;
+    uint8_t *data = kvm_run->mmio.data;
+    uint32_t len  = kvm_run->mmio.len;
+    uint32_t val;
+    int      chunk;
+
+    for (uint32_t i = 0; i < len; i += chunk) {
+        chunk = ((len - i) >= 4) ? 4 : ((len - i) >= 2) ? 2 : 1;
+
+        if (kvm_run->mmio.is_write) {
+            memcpy(&val, &data[i], chunk);
+            kvm_mmio_write(addr + i, val, chunk);
+        } else {
+            val = kvm_mmio_read(addr + i, chunk);
+            memcpy(&data[i], &val, chunk);
+        }
+    }
+
+    if (kvm_run->mmio.is_write && kvm_nr_shadow) {
+        kvm_shadow_refresh(addr);
+        kvm_shadow_refresh(addr + len - 1);
+    }
+}
+
+static void
+kvm_handle_io(void)
+{
+    uint8_t *data = (uint8_t *) kvm_run + kvm_run->io.data_offset;
+    uint16_t port = kvm_run->io.port;
+    uint16_t valw;
+    uint32_t vall;
+
+    for (uint32_t i = 0; i < kvm_run->io.count; i++, data += kvm_run->io.size) {
+        if (kvm_run->io.direction == KVM_EXIT_IO_OUT) {
+            switch (kvm_run->io.size) {
+                case 1:
+                    outb(port, data[0]);
+                    break;
+                case 2:
+                    memcpy(&valw, data, 2);
+                    outw(port, valw);
+                    break;
+                default:
+                    memcpy(&vall, data, 4);
+                    outl(port, vall);
+                    break;
+            }
+        } else {
+            switch (kvm_run->io.size) {
+                case 1:
+                    data[0] = inb(port);
+                    break;
+                case 2:
+                    valw = inw(port);
+                    memcpy(data, &valw, 2);
+                    break;
+                default:
+                    vall = inl(port);
+                    memcpy(data, &vall, 4);
+                    break;
+            }
+        }
+    }
+}
+
+/* KVM only finishes an I/O or MMIO instruction on the next KVM_RUN, it has
+   to get there before the state is read or written. */
+static void
+kvm_finish_exit(void)
+{
+    if (!kvm_exit_pending)
+        return;
+
+    kvm_run->immediate_exit = 1;
+    ioctl(kvm_vcpu_fd, KVM_RUN, 0);
+    kvm_run->immediate_exit = 0;
+    kvm_exit_pending        = 0;
+}
+
+/* State. */
+static void
+kvm_seg_to_kvm(const x86seg *seg, struct kvm_segment *k, int code)
+{
+    memset(k, 0x00, sizeof(struct kvm_segment));
+    k->selector = seg->seg;
+
+    if (!(cpu_state.CR0.l & 1) || (cpu_state.eflags & VM_FLAG)) {
+        k->base    = (cpu_state.eflags & VM_FLAG) ? (seg->seg << 4) : seg->base;
+        k->limit   = (cpu_state.eflags & VM_FLAG) ? 0xffff : seg->limit;
+        k->type    = code ? 0x0b : 0x03;
+        k->s       = 1;
+        k->present = 1;
+        k->dpl     = (cpu_state.eflags & VM_FLAG) ? 3 : 0;
+        return;
+    }
+
+    k->base     = seg->base;
+    k->limit    = seg->limit;
+    k->type     = seg->access & 0x0f;
+    k->s        = (seg->access >> 4) & 1;
+    k->dpl      = (seg->access >> 5) & 3;
+    k->present  = (seg->access >> 7) & 1;
+    k->avl      = (seg->ar_high >> 4) & 1;
+    k->db       = (seg->ar_high >> 6) & 1;
+    k->g        = (seg->ar_high >> 7) & 1;
+    k->unusable = !k->present || (!code && !(seg->seg & ~3));
+}
+
+static void
+kvm_seg_from_kvm(x86seg *seg, const struct kvm_segment *k)
+{
+    uint32_t limit_high = (k->g ? (k->limit >> 28) : (k->limit >> 16)) & 0x0f;
+
+    seg->seg     = k->selector;
+    seg->base    = (uint32_t) k->base;
+    seg->limit   = k->limit;
+    seg->access  = k->type | (k->s << 4) | (k->dpl << 5) | (k->present << 7);
+    seg->ar_high = (k->g << 7) | (k->db << 6) | (k->avl << 4) | limit_high;
+    seg->checked = 0;
+
+    if (k->s && ((k->type & 0x0c) == 0x04)) {
+        seg->limit_low  = seg->limit + 1;
+        seg->limit_high = k->db ? 0xffffffff : 0xffff;
+    } else {
+        seg->limit_low  = 0;
+        seg->limit_high = seg->limit;
+    }
+}
+
+static void
+kvm_set_fpu(void)
+{
+    struct kvm_fpu fpu;
+    uint16_t       tag;
+    int            top;
+
+    memset(&fpu, 0x00, sizeof(fpu));
+
+    if (fpu_softfloat) {
+        fpu.fcw = fpu_state.cwd;
+        fpu.fsw = fpu_state.swd;
+        tag     = fpu_state.tag;
+        top     = fpu_state.tos & 7;
+    } else {
+        fpu.fcw = cpu_state.npxc;
+        fpu.fsw = (cpu_state.npxs & ~0x3800) | ((cpu_state.TOP & 7) << 11);
+        tag     = x87_gettag();
+        top     = cpu_state.TOP & 7;
+    }
+
+    /* The abridged tag word, one bit per physical register. */
+    for (int i = 0; i < 8; i++) {
+        if (((tag >> (i << 1)) & 3) != 3)
+            fpu.ftwx |= 1 << i;
+    }
+
+    /* fpr[] is in stack order. */
+    for (int i = 0; i < 8; i++) {
+        int        reg = (top + i) & 7;
+        x87_conv_t conv;
+
+        if (fpu_softfloat) {
+            memcpy(fpu.fpr[i], &fpu_state.st_space[reg].signif, 8);
+            memcpy(&fpu.fpr[i][8], &fpu_state.st_space[reg].signExp, 2);
+        } else if (cpu_state.ismmx) {
+            memcpy(fpu.fpr[i], &cpu_state.MM[reg].q, 8);
+            fpu.fpr[i][8] = fpu.fpr[i][9] = 0xff;
+        } else {
+            x87_to80(cpu_state.ST[reg], &conv);
+            memcpy(fpu.fpr[i], &conv.eind.ll, 8);
+            memcpy(&fpu.fpr[i][8], &conv.begin, 2);
+        }
+    }
+
+    fpu.mxcsr = 0x1f80;
+    ioctl(kvm_vcpu_fd, KVM_SET_FPU, &fpu);
+}
+
+static void
+kvm_get_fpu(void)
+{
+    struct kvm_fpu fpu;
+    uint16_t       tag = 0;
+    int            top;
+
+    if (ioctl(kvm_vcpu_fd, KVM_GET_FPU, &fpu) < 0)
+        return;
+
+    top = (fpu.fsw >> 11) & 7;
+
+    /* Rebuild the full tag word from the abridged one and the values. */
+    for (int i = 0; i < 8; i++) {
+        const uint8_t *r = fpu.fpr[(i - top) & 7];
+        uint16_t       exp;
+        uint64_t       signif;
+
+        memcpy(&signif, r, 8);
+        memcpy(&exp, &r[8], 2);
+        exp &= 0x7fff;
+        if (!(fpu.ftwx & (1 << i)))
+            tag |= 3 << (i << 1);
+        else if ((exp == 0x7fff) || (exp && !(signif >> 63)) || (!exp && signif))
+            tag |= 2 << (i << 1);
+        else if (!exp && !signif)
+            tag |= 1 << (i << 1);
+    }
+
+    if (fpu_softfloat) {
+        fpu_state.cwd = fpu.fcw;
+        fpu_state.swd = fpu.fsw;
+        fpu_state.tag = tag;
+        fpu_state.tos = top;
+        for (int i = 0; i < 8; i++) {
+            const uint8_t *r = fpu.fpr[(i - top) & 7];
+
+            memcpy(&fpu_state.st_space[i].signif, r, 8);
+            memcpy(&fpu_state.st_space[i].signExp, &r[8], 2);
+        }
+    } else {
+        cpu_state.npxc = fpu.fcw;
+        cpu_state.npxs = fpu.fsw;
+        cpu_state.TOP  = top;
+        x87_settag(tag);
+    }
+
+    /* Whether the guest was last using the registers as MMX or as x87 is
+       not known, so both views are filled in. */
+    for (int i = 0; i < 8; i++) {
+        const uint8_t *r = fpu.fpr[(i - top) & 7];
+        x87_conv_t     conv;
+
+        memcpy(&cpu_state.MM[i].q, r, 8);
+        memcpy(&cpu_state.MM_w4[i], &r[8], 2);
+        if (!fpu_softfloat) {
+            memcpy(&conv.eind.ll, r, 8);
+            memcpy(&conv.begin, &r[8], 2);
+            cpu_state.ST[i] = x87_from80(&conv);
+        }
+    }
+    cpu_state.ismmx = 0;
+}
+
+static void
+kvm_set_cpuid(void)
+{
+    struct {
+        struct kvm_cpuid2       hdr;
+        struct kvm_cpuid_entry2 entries[KVM_MAX_CPUID];
+    } cpuid;
+    uint32_t saved[4];
+    uint32_t base[2] = { 0x00000000, 0x80000000 };
+
+    for (int i = 0; i < 4; i++)
+        saved[i] = cpu_state.regs[i].l;
+
+    memset(&cpuid, 0x00, sizeof(cpuid));
+    for (int j = 0; j < 2; j++) {
+        uint32_t max;
+
+        EAX = base[j];
+        ECX = 0;
+        cpu_CPUID();
+        max = EAX;
+        if ((max < base[j]) || (max > (base[j] + 0x1f)))
+            continue;
+
+        for (uint32_t leaf = base[j]; (leaf <= max) && (cpuid.hdr.nent < KVM_MAX_CPUID); leaf++) {
+            struct kvm_cpuid_entry2 *e = &cpuid.entries[cpuid.hdr.nent++];
+
+            EAX = leaf;
+            ECX = 0;
+            cpu_CPUID();
+            e->function = leaf;
+            e->eax      = EAX;
+            e->ebx      = EBX;
+            e->ecx      = ECX;
+            e->edx      = EDX;
+            /* There is no local APIC in the VM. */
+            if (leaf == 1)
+                e->edx &= ~(1 << 9);
+        }
+    }
+
+    for (int i = 0; i < 4; i++)
+        cpu_state.regs[i].l = saved[i];
+
+    if (ioctl(kvm_vcpu_fd, KVM_SET_CPUID2, &cpuid) < 0)
+        kvm_log("KVM: unable to set CPUID: %s\n", strerror(errno));
+}
+
+static void
+kvm_set_state(void)
+{
+    struct kvm_regs  regs;
+    struct kvm_sregs sregs;
+
+    kvm_finish_exit();
+
+    memset(&regs, 0x00, sizeof(regs));
+    regs.rax    = EAX;
+    regs.rcx    = ECX;
+    regs.rdx    = EDX;
+    regs.rbx    = EBX;
+    regs.rsp    = ESP;
+    regs.rbp    = EBP;
+    regs.rsi    = ESI;
+    regs.rdi    = EDI;
+    regs.rip    = cpu_state.pc;
+    flags_rebuild();
+    regs.rflags = cpu_state.flags | (cpu_state.eflags << 16) | 2;
+    ioctl(kvm_vcpu_fd, KVM_SET_REGS, &regs);
+
+    ioctl(kvm_vcpu_fd, KVM_GET_SREGS, &sregs);
+    kvm_seg_to_kvm(&cpu_state.seg_cs, &sregs.cs, 1);
+    kvm_seg_to_kvm(&cpu_state.seg_ds, &sregs.ds, 0);
+    kvm_seg_to_kvm(&cpu_state.seg_es, &sregs.es, 0);
+    kvm_seg_to_kvm(&cpu_state.seg_fs, &sregs.fs, 0);
+    kvm_seg_to_kvm(&cpu_state.seg_gs, &sregs.gs, 0);
+    kvm_seg_to_kvm(&cpu_state.seg_ss, &sregs.ss, 0);
+    sregs.ss.unusable = 0;
+
+    memset(&sregs.ldt, 0x00, sizeof(struct kvm_segment));
+    sregs.ldt.selector = ldt.seg;
+    sregs.ldt.base     = ldt.base;
+    sregs.ldt.limit    = ldt.limit;
+    sregs.ldt.type     = 0x02;
+    sregs.ldt.present  = 1;
+    sregs.ldt.unusable = !(ldt.seg & ~3);
+
+    memset(&sregs.tr, 0x00, sizeof(struct kvm_segment));
+    sregs.tr.selector = tr.seg;
+    sregs.tr.base     = tr.base;
+    sregs.tr.limit    = tr.limit ? tr.limit : 0xffff;
+    sregs.tr.type     = ((tr.access & 0x0f) == 0x03) ? 0x03 : 0x0b;
+    sregs.tr.present  = 1;
+
+    sregs.gdt.base  = gdt.base;
+    sregs.gdt.limit = gdt.limit;
+    sregs.idt.base  = idt.base;
+    sregs.idt.limit = idt.limit;
+    sregs.cr0       = cpu_state.CR0.l;
+    sregs.cr2       = cr2;
+    sregs.cr3       = cr3;
+    sregs.cr4       = cr4;
+    sregs.efer      = 0;
+    memset(sregs.interrupt_bitmap, 0x00, sizeof(sregs.interrupt_bitmap));
+    if (ioctl(kvm_vcpu_fd, KVM_SET_SREGS, &sregs) < 0)
+        fatal("KVM: unable to load the CPU state: %s\n", strerror(errno));
+
+    kvm_set_fpu();
+
+    kvm_state_dirty = 0;
+    kvm_halted      = 0;
+}
+
+static void
+kvm_get_state(void)
+{
+    struct kvm_regs  regs;
+    struct kvm_sregs sregs;
+
+    kvm_finish_exit();
+
+    if ((ioctl(kvm_vcpu_fd, KVM_GET_REGS, &regs) < 0) || (ioctl(kvm_vcpu_fd, KVM_GET_SREGS, &sregs) < 0))
+        return;
+
+    EAX                = regs.rax;
+    ECX                = regs.rcx;
+    EDX                = regs.rdx;
+    EBX                = regs.rbx;
+    ESP                = regs.rsp;
+    EBP                = regs.rbp;
+    ESI                = regs.rsi;
+    EDI                = regs.rdi;
+    cpu_state.pc       = regs.rip;
+    cpu_state.flags    = regs.rflags & 0xffff;
+    cpu_state.eflags   = (regs.rflags >> 16) & 0xffff;
+    cpu_state.flags_op = FLAGS_UNKNOWN;
+
+    kvm_seg_from_kvm(&cpu_state.seg_cs, &sregs.cs);
+    kvm_seg_from_kvm(&cpu_state.seg_ds, &sregs.ds);
+    kvm_seg_from_kvm(&cpu_state.seg_es, &sregs.es);
+    kvm_seg_from_kvm(&cpu_state.seg_fs, &sregs.fs);
+    kvm_seg_from_kvm(&cpu_state.seg_gs, &sregs.gs);
+    kvm_seg_from_kvm(&cpu_state.seg_ss, &sregs.ss);
+    kvm_seg_from_kvm(&ldt, &sregs.ldt);
+    kvm_seg_from_kvm(&tr, &sregs.tr);
+
+    gdt.base        = sregs.gdt.base;
+    gdt.limit       = sregs.gdt.limit;
+    idt.base        = sregs.idt.base;
+    idt.limit       = sregs.idt.limit;
+    cpu_state.CR0.l = sregs.cr0;
+    cr2             = sregs.cr2;
+    cr3             = sregs.cr3;
+    cr4             = sregs.cr4;
+
+    use32          = (cpu_state.seg_cs.ar_high & 0x40) ? 0x300 : 0;
+    stack32        = (cpu_state.seg_ss.ar_high & 0x40) ? 1 : 0;
+    cpu_cur_status = (use32 ? CPU_STATUS_USE32 : 0) | (stack32 ? CPU_STATUS_STACK32 : 0);
+    if (cpu_state.CR0.l & 1)
+        cpu_cur_status |= CPU_STATUS_PMODE;
+    if (cpu_state.eflags & VM_FLAG)
+        cpu_cur_status |= CPU_STATUS_V86;
+
+    kvm_get_fpu();
+}
+
+/* Interrupts. */
+static void
+kvm_deliver_interrupts(void)
+{
+    /* KVM keeps NMIs blocked until the handler's IRET by itself. */
+    if (nmi && nmi_mask) {
+        ioctl(kvm_vcpu_fd, KVM_NMI);
+        nmi        = 0;
+        kvm_halted = 0;
+    }
+
+    if (pic.int_pending && kvm_run->ready_for_interrupt_injection) {
+        int vector = picinterrupt();
+
+        if (vector != -1) {
+            struct kvm_interrupt irq = { .irq = vector };
+
+            ioctl(kvm_vcpu_fd, KVM_INTERRUPT, &irq);
+            kvm_halted = 0;
+        }
+    }
+
+    /* Come back as soon as the guest can take the next one. */
+    kvm_run->request_interrupt_window = !!pic.int_pending;
+}
+
+static void
+kvm_kick_handler(UNUSED(int sig))
+{
+    /* Only here to make KVM_RUN return. */
+}
+
+/* The kick signal is blocked in the CPU thread except while the guest
+   runs, so it can only ever interrupt KVM_RUN. */
+static void
+kvm_kick_init(void)
+{
+    struct sigaction        sa;
+    struct sigevent         sev;
+    sigset_t                set;
+    struct kvm_signal_mask *mask;
+
+    memset(&sa, 0x00, sizeof(sa));
+    sa.sa_handler = kvm_kick_handler;
+    sigemptyset(&sa.sa_mask);
+    sigaction(KVM_KICK_SIGNAL, &sa, NULL);
+
+    sigemptyset(&set);
+    sigaddset(&set, KVM_KICK_SIGNAL);
+    pthread_sigmask(SIG_BLOCK, &set, NULL);
+
+    pthread_sigmask(SIG_BLOCK, NULL, &set);
+    sigdelset(&set, KVM_KICK_SIGNAL);
+    mask      = calloc(1, sizeof(struct kvm_signal_mask) + 8);
+    mask->len = 8; /* The kernel's sigset_t. */
+    memcpy(mask->sigset, &set, 8);
+    if (ioctl(kvm_vcpu_fd, KVM_SET_SIGNAL_MASK, mask) < 0)
+        fatal("KVM: unable to set the signal mask: %s\n", strerror(errno));
+    free(mask);
+
+    memset(&sev, 0x00, sizeof(sev));
+    sev.sigev_notify           = SIGEV_THREAD_ID;
+    sev.sigev_signo            = KVM_KICK_SIGNAL;
+    sev.sigev_notify_thread_id = syscall(SYS_gettid);
+    if (timer_create(CLOCK_MONOTONIC, &sev, &kvm_kick_timer) < 0)
+        fatal("KVM: unable to create the kick timer: %s\n", strerror(errno));
+
+    kvm_kick_init_done = 1;
+}
+
+static void
+kvm_handle_exit(void)
+{
+    switch (kvm_run->exit_reason) {
+        case KVM_EXIT_IO:
+            kvm_handle_io();
+            kvm_exit_pending = 1;
+            break;
+
+        case KVM_EXIT_MMIO:
+            kvm_handle_mmio();
+            kvm_exit_pending = 1;
+            break;
+
+        case KVM_EXIT_HLT:
+            kvm_halted = 1;
+            break;
+
+        case KVM_EXIT_IRQ_WINDOW_OPEN:
+        case KVM_EXIT_INTR:
+            break;
+
+        case KVM_EXIT_SHUTDOWN:
+            /* Triple fault. */
+            kvm_log("KVM: triple fault, resetting\n");
+            softresetx86();
+            cpu_set_edx();
+            break;
+
+        case KVM_EXIT_FAIL_ENTRY:
+            fatal("KVM: VM entry failed, reason %016" PRIX64 "\n",
+                  (uint64_t) kvm_run->fail_entry.hardware_entry_failure_reason);
+            break;
+
+        case KVM_EXIT_INTERNAL_ERROR:
+            fatal("KVM: internal error %u\n", kvm_run->internal.suberror);
+            break;
+
+        default:
+            fatal("KVM: unhandled exit %u\n", kvm_run->exit_reason);
+            break;
+    }
+}
+
+void
+kvm_exec(int32_t cycs)
+{
+    uint64_t end = tsc + cycs;
+
+    if (!kvm_kick_init_done)
+        kvm_kick_init();
+
+    while ((int64_t) (end - tsc) > 0) {
+        int64_t run = end - tsc;
+        int32_t due = (int32_t) (timer_target - (uint32_t) tsc);
+
+        if (cpu_init) {
+            cpu_init = 0;
+            resetx86();
+        }
+
+        if (kvm_mem_dirty)
+            kvm_mem_update();
+        if (kvm_state_dirty)
+            kvm_set_state();
+
+        kvm_deliver_interrupts();
+
+        if (due < run)
+            run = (due > 0) ? due : 1;
+
+        if (kvm_halted) {
+            /* Nothing happens until an interrupt arrives. */
+            tsc += run;
+        } else {
+            struct itimerspec its;
+            uint64_t          ns = (run * 1000000000ULL) / cpu_s->rspeed;
+            uint64_t          start;
+            uint64_t          ran;
+            int               ret;
+
+            if (ns < KVM_MIN_RUN_NS)
+                ns = KVM_MIN_RUN_NS;
+            memset(&its, 0x00, sizeof(its));
+            its.it_value.tv_sec  = ns / 1000000000ULL;
+            its.it_value.tv_nsec = ns % 1000000000ULL;
+            timer_settime(kvm_kick_timer, 0, &its, NULL);
+
+            cycles           = 0;
+            kvm_exit_pending = 0;
+            start            = kvm_host_ns();
+            ret              = ioctl(kvm_vcpu_fd, KVM_RUN, 0);
+            ran              = ((kvm_host_ns() - start) * cpu_s->rspeed) / 1000000000ULL;
+
+            if (ret < 0) {
+                if ((errno != EINTR) && (errno != EAGAIN))
+                    fatal("KVM: KVM_RUN failed: %s\n", strerror(errno));
+            } else
+                kvm_handle_exit();
+
+            /* Wait states the devices charged for the access. */
+            if (cycles < 0)
+                ran += -cycles;
+            tsc += ran ? ran : 1;
+        }
+
+        if (TIMER_VAL_LESS_THAN_VAL(timer_target, (uint32_t) tsc))
+            timer_process();
+    }
+
+    cycles = 0;
+    kvm_get_state();
+}
+
+void
+kvm_mem_changed(void)
+{
+    kvm_mem_dirty = 1;
+}
+
+void
+kvm_state_changed(void)
+{
+    kvm_state_dirty = 1;
+}
+
+void
+kvm_close(void)
+{
+    if (kvm_kick_init_done) {
+        timer_delete(kvm_kick_timer);
+        kvm_kick_init_done = 0;
+    }
+    if (kvm_run != NULL) {
+        munmap(kvm_run, kvm_run_size);
+        kvm_run = NULL;
+    }
+    if (kvm_shadow_mem != NULL) {
+        munmap(kvm_shadow_mem, KVM_MAX_SHADOW << MEM_GRANULARITY_BITS);
+        kvm_shadow_mem = NULL;
+    }
+    if (kvm_vcpu_fd != -1)
+        close(kvm_vcpu_fd);
+    if (kvm_vm_fd != -1)
+        close(kvm_vm_fd);
+    if (kvm_fd != -1)
+        close(kvm_fd);
+
+    kvm_fd = kvm_vm_fd = kvm_vcpu_fd = -1;
+    kvm_nr_slots = kvm_nr_shadow = 0;
+}
+
+int
+kvm_init(void)
+{
+    int ret;
+
+    /* A new CPU can not be given to a VM that has already run. */
+    kvm_close();
+
+    if (!is_p6) {
+        pclog("KVM: only P6-class CPUs can be run under KVM\n");
+        return 0;
+    }
+
+    kvm_fd = open("/dev/kvm", O_RDWR | O_CLOEXEC);
+    if (kvm_fd < 0) {
+        pclog("KVM: unable to open /dev/kvm: %s\n", strerror(errno));
+        return 0;
+    }
+
+    if ((ioctl(kvm_fd, KVM_GET_API_VERSION, 0) != KVM_API_VERSION) ||
+        (ioctl(kvm_fd, KVM_CHECK_EXTENSION, KVM_CAP_READONLY_MEM) <= 0) ||
+        (ioctl(kvm_fd, KVM_CHECK_EXTENSION, KVM_CAP_IMMEDIATE_EXIT) <= 0)) {
+        pclog("KVM: the host kernel is too old\n");
+        kvm_close();
+        return 0;
+    }
+
+    ret           = ioctl(kvm_fd, KVM_CHECK_EXTENSION, KVM_CAP_NR_MEMSLOTS);
+    kvm_max_slots = (ret > 0) ? ret : 32;
+    if (kvm_max_slots > KVM_MAX_SLOTS)
+        kvm_max_slots = KVM_MAX_SLOTS;
+
+    kvm_vm_fd = ioctl(kvm_fd, KVM_CREATE_VM, 0);
+    if (kvm_vm_fd < 0) {
+        pclog("KVM: unable to create the VM: %s\n", strerror(errno));
+        kvm_close();
+        return 0;
+    }
+
+    /* Real mode on VMX hosts without unrestricted guests needs both, they
+       are not used on SVM hosts. */
+    if (ioctl(kvm_fd, KVM_CHECK_EXTENSION, KVM_CAP_SET_IDENTITY_MAP_ADDR) > 0) {
+        uint64_t addr = KVM_IDENTITY_MAP_ADDR;
+
+        ioctl(kvm_vm_fd, KVM_SET_IDENTITY_MAP_ADDR, &addr);
+    }
+    ioctl(kvm_vm_fd, KVM_SET_TSS_ADDR, KVM_TSS_ADDR);
+
+    kvm_vcpu_fd  = ioctl(kvm_vm_fd, KVM_CREATE_VCPU, 0);
+    kvm_run_size = ioctl(kvm_fd, KVM_GET_VCPU_MMAP_SIZE, 0);
+    if (kvm_vcpu_fd >= 0)
+        kvm_run = mmap(NULL, kvm_run_size, PROT_READ | PROT_WRITE, MAP_SHARED, kvm_vcpu_fd, 0);
+    kvm_shadow_mem = mmap(NULL, KVM_MAX_SHADOW << MEM_GRANULARITY_BITS, PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if ((kvm_vcpu_fd < 0) || (kvm_run == MAP_FAILED) || (kvm_shadow_mem == MAP_FAILED)) {
+        pclog("KVM: unable to create the virtual CPU\n");
+        if (kvm_run == MAP_FAILED)
+            kvm_run = NULL;
+        if (kvm_shadow_mem == MAP_FAILED)
+            kvm_shadow_mem = NULL;
+        kvm_close();
+        return 0;
+    }
+
+    kvm_set_cpuid();
+
+    kvm_mem_dirty    = 1;
+    kvm_state_dirty  = 1;
+    kvm_exit_pending = 0;
+    kvm_halted       = 0;
+
+    pclog("KVM: running %s under KVM\n", cpu_s->name);
+
+    return 1;
+}
@@ -32,6 +32,7 @@
 #include <86box/dma.h>
 #include <86box/io.h>
 #include <86box/keyboard.h>
+#include <86box/kvm.h>
 #include <86box/mem.h>
 #include <86box/rom.h>
 #include <86box/nmi.h>
@@ -373,6 +374,10 @@ reset_common(int hard)
     in_lock    = 0;
 
     cpu_cpurst_on_sr = 0;
+
+#ifdef USE_KVM
+    kvm_state_changed();
+#endif
 }
 
 /* Hard reset. */
@@ -48,6 +48,9 @@ extern int x86_was_reset;
 extern int trap;
 extern int codegen_flat_ss;
 extern int codegen_flat_ds;
+#ifdef USE_NEW_DYNAREC
+extern int codegen_flat_es;
+#endif
 extern int timetolive;
 extern int keyboardtimer;
 extern int trap;
@@ -700,6 +700,26 @@ opF7_l_a32(uint32_t fetchdat)
     return 0;
 }
 
+/* While halted, nothing but a timer can raise an interrupt before the end of
+   the current slice, so skip straight ahead to the next timer deadline. The
+   slice then ends early and the main loop idles for the rest of it. */
+static __inline int32_t
+hlt_idle_cycles(void)
+{
+    int32_t until;
+
+#ifdef USE_DYNAREC
+    if (cpu_use_dynarec)
+        update_tsc();
+#endif
+
+    until = (int32_t) (timer_target - (uint32_t) tsc);
+    if (until > cycles)
+        until = cycles;
+
+    return (until > 100) ? until : 100;
+}
+
 static int
 opHLT(UNUSED(uint32_t fetchdat))
 {
@@ -710,7 +730,7 @@ opHLT(UNUSED(uint32_t fetchdat))
     if (smi_line)
         enter_smm_check(1);
     else if (!((cpu_state.flags & I_FLAG) && pic.int_pending)) {
-        CLOCK_CYCLES_ALWAYS(100);
+        CLOCK_CYCLES_ALWAYS(hlt_idle_cycles());
         if (!((cpu_state.flags & I_FLAG) && pic.int_pending))
             cpu_state.pc--;
     } else {
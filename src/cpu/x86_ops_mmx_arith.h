@@ -11,14 +11,7 @@ opPADDB_a16(uint32_t fetchdat)
 
     MMX_GETSRC();
 
-    dst->b[0] += src.b[0];
-    dst->b[1] += src.b[1];
-    dst->b[2] += src.b[2];
-    dst->b[3] += src.b[3];
-    dst->b[4] += src.b[4];
-    dst->b[5] += src.b[5];
-    dst->b[6] += src.b[6];
-    dst->b[7] += src.b[7];
+    mmx_paddb(dst, &src);
 
     MMX_SETEXP(cpu_reg);
 
@@ -37,14 +30,7 @@ opPADDB_a32(uint32_t fetchdat)
 
     MMX_GETSRC();
 
-    dst->b[0] += src.b[0];
-    dst->b[1] += src.b[1];
-    dst->b[2] += src.b[2];
-    dst->b[3] += src.b[3];
-    dst->b[4] += src.b[4];
-    dst->b[5] += src.b[5];
-    dst->b[6] += src.b[6];
-    dst->b[7] += src.b[7];
+    mmx_paddb(dst, &src);
 
     MMX_SETEXP(cpu_reg);
 
@@ -64,10 +50,7 @@ opPADDW_a16(uint32_t fetchdat)
 
     MMX_GETSRC();
 
-    dst->w[0] += src.w[0];
-    dst->w[1] += src.w[1];
-    dst->w[2] += src.w[2];
-    dst->w[3] += src.w[3];
+    mmx_paddw(dst, &src);
 
     MMX_SETEXP(cpu_reg);
 
@@ -86,10 +69,7 @@ opPADDW_a32(uint32_t fetchdat)
 
     MMX_GETSRC();
 
-    dst->w[0] += src.w[0];
-    dst->w[1] += src.w[1];
-    dst->w[2] += src.w[2];
-    dst->w[3] += src.w[3];
+    mmx_paddw(dst, &src);
 
     MMX_SETEXP(cpu_reg);
 
@@ -109,8 +89,7 @@ opPADDD_a16(uint32_t fetchdat)
 
     MMX_GETSRC();
 
-    dst->l[0] += src.l[0];
-    dst->l[1] += src.l[1];
+    mmx_paddd(dst, &src);
 
     MMX_SETEXP(cpu_reg);
 
@@ -129,8 +108,7 @@ opPADDD_a32(uint32_t fetchdat)
 
     MMX_GETSRC();
 
-    dst->l[0] += src.l[0];
-    dst->l[1] += src.l[1];
+    mmx_paddd(dst, &src);
 
     MMX_SETEXP(cpu_reg);
 
@@ -150,14 +128,7 @@ opPADDSB_a16(uint32_t fetchdat)
 
     MMX_GETSRC();
 
-    dst->sb[0] = SSATB(dst->sb[0] + src.sb[0]);
-    dst->sb[1] = SSATB(dst->sb[1] + src.sb[1]);
-    dst->sb[2] = SSATB(dst->sb[2] + src.sb[2]);
-    dst->sb[3] = SSATB(dst->sb[3] + src.sb[3]);
-    dst->sb[4] = SSATB(dst->sb[4] + src.sb[4]);
-    dst->sb[5] = SSATB(dst->sb[5] + src.sb[5]);
-    dst->sb[6] = SSATB(dst->sb[6] + src.sb[6]);
-    dst->sb[7] = SSATB(dst->sb[7] + src.sb[7]);
+    mmx_paddsb(dst, &src);
 
     MMX_SETEXP(cpu_reg);
 
@@ -176,14 +147,7 @@ opPADDSB_a32(uint32_t fetchdat)
 
     MMX_GETSRC();
 
-    dst->sb[0] = SSATB(dst->sb[0] + src.sb[0]);
-    dst->sb[1] = SSATB(dst->sb[1] + src.sb[1]);
-    dst->sb[2] = SSATB(dst->sb[2] + src.sb[2]);
-    dst->sb[3] = SSATB(dst->sb[3] + src.sb[3]);
-    dst->sb[4] = SSATB(dst->sb[4] + src.sb[4]);
-    dst->sb[5] = SSATB(dst->sb[5] + src.sb[5]);
-    dst->sb[6] = SSATB(dst->sb[6] + src.sb[6]);
-    dst->sb[7] = SSATB(dst->sb[7] + src.sb[7]);
+    mmx_paddsb(dst, &src);
 
     MMX_SETEXP(cpu_reg);
 
@@ -203,14 +167,7 @@ opPADDUSB_a16(uint32_t fetchdat)
 
     MMX_GETSRC();
 
-    dst->b[0] = USATB(dst->b[0] + src.b[0]);
-    dst->b[1] = USATB(dst->b[1] + src.b[1]);
-    dst->b[2] = USATB(dst->b[2] + src.b[2]);
-    dst->b[3] = USATB(dst->b[3] + src.b[3]);
-    dst->b[4] = USATB(dst->b[4] + src.b[4]);
-    dst->b[5] = USATB(dst->b[5] + src.b[5]);
-    dst->b[6] = USATB(dst->b[6] + src.b[6]);
-    dst->b[7] = USATB(dst->b[7] + src.b[7]);
+    mmx_paddusb(dst, &src);
 
     MMX_SETEXP(cpu_reg);
 
@@ -229,14 +186,7 @@ opPADDUSB_a32(uint32_t fetchdat)
 
     MMX_GETSRC();
 
-    dst->b[0] = USATB(dst->b[0] + src.b[0]);
-    dst->b[1] = USATB(dst->b[1] + src.b[1]);
-    dst->b[2] = USATB(dst->b[2] + src.b[2]);
-    dst->b[3] = USATB(dst->b[3] + src.b[3]);
-    dst->b[4] = USATB(dst->b[4] + src.b[4]);
-    dst->b[5] = USATB(dst->b[5] + src.b[5]);
-    dst->b[6] = USATB(dst->b[6] + src.b[6]);
-    dst->b[7] = USATB(dst->b[7] + src.b[7]);
+    mmx_paddusb(dst, &src);
 
     MMX_SETEXP(cpu_reg);
 
@@ -256,10 +206,7 @@ opPADDSW_a16(uint32_t fetchdat)
 
     MMX_GETSRC();
 
-    dst->sw[0] = SSATW(dst->sw[0] + src.sw[0]);
-    dst->sw[1] = SSATW(dst->sw[1] + src.sw[1]);
-    dst->sw[2] = SSATW(dst->sw[2] + src.sw[2]);
-    dst->sw[3] = SSATW(dst->sw[3] + src.sw[3]);
+    mmx_paddsw(dst, &src);
 
     MMX_SETEXP(cpu_reg);
 
@@ -278,10 +225,7 @@ opPADDSW_a32(uint32_t fetchdat)
 
     MMX_GETSRC();
 
-    dst->sw[0] = SSATW(dst->sw[0] + src.sw[0]);
-    dst->sw[1] = SSATW(dst->sw[1] + src.sw[1]);
-    dst->sw[2] = SSATW(dst->sw[2] + src.sw[2]);
-    dst->sw[3] = SSATW(dst->sw[3] + src.sw[3]);
+    mmx_paddsw(dst, &src);
 
     MMX_SETEXP(cpu_reg);
 
@@ -301,10 +245,7 @@ opPADDUSW_a16(uint32_t fetchdat)
 
     MMX_GETSRC();
 
-    dst->w[0] = USATW(dst->w[0] + src.w[0]);
-    dst->w[1] = USATW(dst->w[1] + src.w[1]);
-    dst->w[2] = USATW(dst->w[2] + src.w[2]);
-    dst->w[3] = USATW(dst->w[3] + src.w[3]);
+    mmx_paddusw(dst, &src);
 
     MMX_SETEXP(cpu_reg);
 
@@ -323,10 +264,7 @@ opPADDUSW_a32(uint32_t fetchdat)
 
     MMX_GETSRC();
 
-    dst->w[0] = USATW(dst->w[0] + src.w[0]);
-    dst->w[1] = USATW(dst->w[1] + src.w[1]);
-    dst->w[2] = USATW(dst->w[2] + src.w[2]);
-    dst->w[3] = USATW(dst->w[3] + src.w[3]);
+    mmx_paddusw(dst, &src);
 
     MMX_SETEXP(cpu_reg);
 
@@ -346,15 +284,7 @@ opPMADDWD_a16(uint32_t fetchdat)
 
     MMX_GETSRC();
 
-    if (dst->l[0] == 0x80008000 && src.l[0] == 0x80008000)
-        dst->l[0] = 0x80000000;
-    else
-        dst->sl[0] = ((int32_t) dst->sw[0] * (int32_t) src.sw[0]) + ((int32_t) dst->sw[1] * (int32_t) src.sw[1]);
-
-    if (dst->l[1] == 0x80008000 && src.l[1] == 0x80008000)
-        dst->l[1] = 0x80000000;
-    else
-        dst->sl[1] = ((int32_t) dst->sw[2] * (int32_t) src.sw[2]) + ((int32_t) dst->sw[3] * (int32_t) src.sw[3]);
+    mmx_pmaddwd(dst, &src);
 
     MMX_SETEXP(cpu_reg);
 
@@ -373,15 +303,7 @@ opPMADDWD_a32(uint32_t fetchdat)
 
     MMX_GETSRC();
 
-    if (dst->l[0] == 0x80008000 && src.l[0] == 0x80008000)
-        dst->l[0] = 0x80000000;
-    else
-        dst->sl[0] = ((int32_t) dst->sw[0] * (int32_t) src.sw[0]) + ((int32_t) dst->sw[1] * (int32_t) src.sw[1]);
-
-    if (dst->l[1] == 0x80008000 && src.l[1] == 0x80008000)
-        dst->l[1] = 0x80000000;
-    else
-        dst->sl[1] = ((int32_t) dst->sw[2] * (int32_t) src.sw[2]) + ((int32_t) dst->sw[3] * (int32_t) src.sw[3]);
+    mmx_pmaddwd(dst, &src);
 
     MMX_SETEXP(cpu_reg);
 
@@ -409,10 +331,7 @@ opPMULLW_a16(uint32_t fetchdat)
             return 0;
         CLOCK_CYCLES(1);
     }
-    dst->w[0] *= src.w[0];
-    dst->w[1] *= src.w[1];
-    dst->w[2] *= src.w[2];
-    dst->w[3] *= src.w[3];
+    mmx_pmullw(dst, &src);
     CLOCK_CYCLES(1);
 
     MMX_SETEXP(cpu_reg);
@@ -440,10 +359,7 @@ opPMULLW_a32(uint32_t fetchdat)
             return 0;
         CLOCK_CYCLES(1);
     }
-    dst->w[0] *= src.w[0];
-    dst->w[1] *= src.w[1];
-    dst->w[2] *= src.w[2];
-    dst->w[3] *= src.w[3];
+    mmx_pmullw(dst, &src);
     CLOCK_CYCLES(1);
 
     MMX_SETEXP(cpu_reg);
@@ -472,10 +388,7 @@ opPMULHW_a16(uint32_t fetchdat)
             return 0;
         CLOCK_CYCLES(1);
     }
-    dst->w[0] = ((int32_t) dst->sw[0] * (int32_t) src.sw[0]) >> 16;
-    dst->w[1] = ((int32_t) dst->sw[1] * (int32_t) src.sw[1]) >> 16;
-    dst->w[2] = ((int32_t) dst->sw[2] * (int32_t) src.sw[2]) >> 16;
-    dst->w[3] = ((int32_t) dst->sw[3] * (int32_t) src.sw[3]) >> 16;
+    mmx_pmulhw(dst, &src);
     CLOCK_CYCLES(1);
 
     MMX_SETEXP(cpu_reg);
@@ -503,10 +416,7 @@ opPMULHW_a32(uint32_t fetchdat)
             return 0;
         CLOCK_CYCLES(1);
     }
-    dst->w[0] = ((int32_t) dst->sw[0] * (int32_t) src.sw[0]) >> 16;
-    dst->w[1] = ((int32_t) dst->sw[1] * (int32_t) src.sw[1]) >> 16;
-    dst->w[2] = ((int32_t) dst->sw[2] * (int32_t) src.sw[2]) >> 16;
-    dst->w[3] = ((int32_t) dst->sw[3] * (int32_t) src.sw[3]) >> 16;
+    mmx_pmulhw(dst, &src);
     CLOCK_CYCLES(1);
 
     MMX_SETEXP(cpu_reg);
@@ -527,14 +437,7 @@ opPSUBB_a16(uint32_t fetchdat)
 
     MMX_GETSRC();
 
-    dst->b[0] -= src.b[0];
-    dst->b[1] -= src.b[1];
-    dst->b[2] -= src.b[2];
-    dst->b[3] -= src.b[3];
-    dst->b[4] -= src.b[4];
-    dst->b[5] -= src.b[5];
-    dst->b[6] -= src.b[6];
-    dst->b[7] -= src.b[7];
+    mmx_psubb(dst, &src);
 
     MMX_SETEXP(cpu_reg);
 
@@ -553,14 +456,7 @@ opPSUBB_a32(uint32_t fetchdat)
 
     MMX_GETSRC();
 
-    dst->b[0] -= src.b[0];
-    dst->b[1] -= src.b[1];
-    dst->b[2] -= src.b[2];
-    dst->b[3] -= src.b[3];
-    dst->b[4] -= src.b[4];
-    dst->b[5] -= src.b[5];
-    dst->b[6] -= src.b[6];
-    dst->b[7] -= src.b[7];
+    mmx_psubb(dst, &src);
 
     MMX_SETEXP(cpu_reg);
 
@@ -580,10 +476,7 @@ opPSUBW_a16(uint32_t fetchdat)
 
     MMX_GETSRC();
 
-    dst->w[0] -= src.w[0];
-    dst->w[1] -= src.w[1];
-    dst->w[2] -= src.w[2];
-    dst->w[3] -= src.w[3];
+    mmx_psubw(dst, &src);
 
     MMX_SETEXP(cpu_reg);
 
@@ -602,10 +495,7 @@ opPSUBW_a32(uint32_t fetchdat)
 
     MMX_GETSRC();
 
-    dst->w[0] -= src.w[0];
-    dst->w[1] -= src.w[1];
-    dst->w[2] -= src.w[2];
-    dst->w[3] -= src.w[3];
+    mmx_psubw(dst, &src);
 
     MMX_SETEXP(cpu_reg);
 
@@ -625,8 +515,7 @@ opPSUBD_a16(uint32_t fetchdat)
 
     MMX_GETSRC();
 
-    dst->l[0] -= src.l[0];
-    dst->l[1] -= src.l[1];
+    mmx_psubd(dst, &src);
 
     MMX_SETEXP(cpu_reg);
 
@@ -645,8 +534,7 @@ opPSUBD_a32(uint32_t fetchdat)
 
     MMX_GETSRC();
 
-    dst->l[0] -= src.l[0];
-    dst->l[1] -= src.l[1];
+    mmx_psubd(dst, &src);
 
     MMX_SETEXP(cpu_reg);
 
@@ -666,14 +554,7 @@ opPSUBSB_a16(uint32_t fetchdat)
 
     MMX_GETSRC();
 
-    dst->sb[0] = SSATB(dst->sb[0] - src.sb[0]);
-    dst->sb[1] = SSATB(dst->sb[1] - src.sb[1]);
-    dst->sb[2] = SSATB(dst->sb[2] - src.sb[2]);
-    dst->sb[3] = SSATB(dst->sb[3] - src.sb[3]);
-    dst->sb[4] = SSATB(dst->sb[4] - src.sb[4]);
-    dst->sb[5] = SSATB(dst->sb[5] - src.sb[5]);
-    dst->sb[6] = SSATB(dst->sb[6] - src.sb[6]);
-    dst->sb[7] = SSATB(dst->sb[7] - src.sb[7]);
+    mmx_psubsb(dst, &src);
 
     MMX_SETEXP(cpu_reg);
 
@@ -692,14 +573,7 @@ opPSUBSB_a32(uint32_t fetchdat)
 
     MMX_GETSRC();
 
-    dst->sb[0] = SSATB(dst->sb[0] - src.sb[0]);
-    dst->sb[1] = SSATB(dst->sb[1] - src.sb[1]);
-    dst->sb[2] = SSATB(dst->sb[2] - src.sb[2]);
-    dst->sb[3] = SSATB(dst->sb[3] - src.sb[3]);
-    dst->sb[4] = SSATB(dst->sb[4] - src.sb[4]);
-    dst->sb[5] = SSATB(dst->sb[5] - src.sb[5]);
-    dst->sb[6] = SSATB(dst->sb[6] - src.sb[6]);
-    dst->sb[7] = SSATB(dst->sb[7] - src.sb[7]);
+    mmx_psubsb(dst, &src);
 
     MMX_SETEXP(cpu_reg);
 
@@ -719,14 +593,7 @@ opPSUBUSB_a16(uint32_t fetchdat)
 
     MMX_GETSRC();
 
-    dst->b[0] = USATB(dst->b[0] - src.b[0]);
-    dst->b[1] = USATB(dst->b[1] - src.b[1]);
-    dst->b[2] = USATB(dst->b[2] - src.b[2]);
-    dst->b[3] = USATB(dst->b[3] - src.b[3]);
-    dst->b[4] = USATB(dst->b[4] - src.b[4]);
-    dst->b[5] = USATB(dst->b[5] - src.b[5]);
-    dst->b[6] = USATB(dst->b[6] - src.b[6]);
-    dst->b[7] = USATB(dst->b[7] - src.b[7]);
+    mmx_psubusb(dst, &src);
 
     MMX_SETEXP(cpu_reg);
 
@@ -745,14 +612,7 @@ opPSUBUSB_a32(uint32_t fetchdat)
 
     MMX_GETSRC();
 
-    dst->b[0] = USATB(dst->b[0] - src.b[0]);
-    dst->b[1] = USATB(dst->b[1] - src.b[1]);
-    dst->b[2] = USATB(dst->b[2] - src.b[2]);
-    dst->b[3] = USATB(dst->b[3] - src.b[3]);
-    dst->b[4] = USATB(dst->b[4] - src.b[4]);
-    dst->b[5] = USATB(dst->b[5] - src.b[5]);
-    dst->b[6] = USATB(dst->b[6] - src.b[6]);
-    dst->b[7] = USATB(dst->b[7] - src.b[7]);
+    mmx_psubusb(dst, &src);
 
     MMX_SETEXP(cpu_reg);
 
@@ -772,10 +632,7 @@ opPSUBSW_a16(uint32_t fetchdat)
 
     MMX_GETSRC();
 
-    dst->sw[0] = SSATW(dst->sw[0] - src.sw[0]);
-    dst->sw[1] = SSATW(dst->sw[1] - src.sw[1]);
-    dst->sw[2] = SSATW(dst->sw[2] - src.sw[2]);
-    dst->sw[3] = SSATW(dst->sw[3] - src.sw[3]);
+    mmx_psubsw(dst, &src);
 
     MMX_SETEXP(cpu_reg);
 
@@ -794,10 +651,7 @@ opPSUBSW_a32(uint32_t fetchdat)
 
     MMX_GETSRC();
 
-    dst->sw[0] = SSATW(dst->sw[0] - src.sw[0]);
-    dst->sw[1] = SSATW(dst->sw[1] - src.sw[1]);
-    dst->sw[2] = SSATW(dst->sw[2] - src.sw[2]);
-    dst->sw[3] = SSATW(dst->sw[3] - src.sw[3]);
+    mmx_psubsw(dst, &src);
 
     MMX_SETEXP(cpu_reg);
 
@@ -817,10 +671,7 @@ opPSUBUSW_a16(uint32_t fetchdat)
 
     MMX_GETSRC();
 
-    dst->w[0] = USATW(dst->w[0] - src.w[0]);
-    dst->w[1] = USATW(dst->w[1] - src.w[1]);
-    dst->w[2] = USATW(dst->w[2] - src.w[2]);
-    dst->w[3] = USATW(dst->w[3] - src.w[3]);
+    mmx_psubusw(dst, &src);
 
     MMX_SETEXP(cpu_reg);
 
@@ -839,10 +690,7 @@ opPSUBUSW_a32(uint32_t fetchdat)
 
     MMX_GETSRC();
 
-    dst->w[0] = USATW(dst->w[0] - src.w[0]);
-    dst->w[1] = USATW(dst->w[1] - src.w[1]);
-    dst->w[2] = USATW(dst->w[2] - src.w[2]);
-    dst->w[3] = USATW(dst->w[3] - src.w[3]);
+    mmx_psubusw(dst, &src);
 
     MMX_SETEXP(cpu_reg);
 
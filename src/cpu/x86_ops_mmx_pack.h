@@ -113,14 +113,7 @@ opPUNPCKLBW_a16(uint32_t fetchdat)
 
     MMX_GETSRC();
 
-    dst->b[7] = src.b[3];
-    dst->b[6] = dst->b[3];
-    dst->b[5] = src.b[2];
-    dst->b[4] = dst->b[2];
-    dst->b[3] = src.b[1];
-    dst->b[2] = dst->b[1];
-    dst->b[1] = src.b[0];
-    dst->b[0] = dst->b[0];
+    mmx_punpcklbw(dst, &src);
 
     MMX_SETEXP(cpu_reg);
 
@@ -139,14 +132,7 @@ opPUNPCKLBW_a32(uint32_t fetchdat)
 
     MMX_GETSRC();
 
-    dst->b[7] = src.b[3];
-    dst->b[6] = dst->b[3];
-    dst->b[5] = src.b[2];
-    dst->b[4] = dst->b[2];
-    dst->b[3] = src.b[1];
-    dst->b[2] = dst->b[1];
-    dst->b[1] = src.b[0];
-    dst->b[0] = dst->b[0];
+    mmx_punpcklbw(dst, &src);
 
     MMX_SETEXP(cpu_reg);
 
@@ -166,14 +152,7 @@ opPUNPCKHBW_a16(uint32_t fetchdat)
 
     MMX_GETSRC();
 
-    dst->b[0] = dst->b[4];
-    dst->b[1] = src.b[4];
-    dst->b[2] = dst->b[5];
-    dst->b[3] = src.b[5];
-    dst->b[4] = dst->b[6];
-    dst->b[5] = src.b[6];
-    dst->b[6] = dst->b[7];
-    dst->b[7] = src.b[7];
+    mmx_punpckhbw(dst, &src);
 
     MMX_SETEXP(cpu_reg);
 
@@ -192,14 +171,7 @@ opPUNPCKHBW_a32(uint32_t fetchdat)
 
     MMX_GETSRC();
 
-    dst->b[0] = dst->b[4];
-    dst->b[1] = src.b[4];
-    dst->b[2] = dst->b[5];
-    dst->b[3] = src.b[5];
-    dst->b[4] = dst->b[6];
-    dst->b[5] = src.b[6];
-    dst->b[6] = dst->b[7];
-    dst->b[7] = src.b[7];
+    mmx_punpckhbw(dst, &src);
 
     MMX_SETEXP(cpu_reg);
 
@@ -219,10 +191,7 @@ opPUNPCKLWD_a16(uint32_t fetchdat)
 
     MMX_GETSRC();
 
-    dst->w[3] = src.w[1];
-    dst->w[2] = dst->w[1];
-    dst->w[1] = src.w[0];
-    dst->w[0] = dst->w[0];
+    mmx_punpcklwd(dst, &src);
 
     MMX_SETEXP(cpu_reg);
 
@@ -241,10 +210,7 @@ opPUNPCKLWD_a32(uint32_t fetchdat)
 
     MMX_GETSRC();
 
-    dst->w[3] = src.w[1];
-    dst->w[2] = dst->w[1];
-    dst->w[1] = src.w[0];
-    dst->w[0] = dst->w[0];
+    mmx_punpcklwd(dst, &src);
 
     MMX_SETEXP(cpu_reg);
 
@@ -264,10 +230,7 @@ opPUNPCKHWD_a16(uint32_t fetchdat)
 
     MMX_GETSRC();
 
-    dst->w[0] = dst->w[2];
-    dst->w[1] = src.w[2];
-    dst->w[2] = dst->w[3];
-    dst->w[3] = src.w[3];
+    mmx_punpckhwd(dst, &src);
 
     MMX_SETEXP(cpu_reg);
 
@@ -286,10 +249,7 @@ opPUNPCKHWD_a32(uint32_t fetchdat)
 
     MMX_GETSRC();
 
-    dst->w[0] = dst->w[2];
-    dst->w[1] = src.w[2];
-    dst->w[2] = dst->w[3];
-    dst->w[3] = src.w[3];
+    mmx_punpckhwd(dst, &src);
 
     MMX_SETEXP(cpu_reg);
 
@@ -309,14 +269,7 @@ opPACKSSWB_a16(uint32_t fetchdat)
 
     MMX_GETSRC();
 
-    dst->sb[0] = SSATB(dst->sw[0]);
-    dst->sb[1] = SSATB(dst->sw[1]);
-    dst->sb[2] = SSATB(dst->sw[2]);
-    dst->sb[3] = SSATB(dst->sw[3]);
-    dst->sb[4] = SSATB(src.sw[0]);
-    dst->sb[5] = SSATB(src.sw[1]);
-    dst->sb[6] = SSATB(src.sw[2]);
-    dst->sb[7] = SSATB(src.sw[3]);
+    mmx_packsswb(dst, &src);
 
     MMX_SETEXP(cpu_reg);
 
@@ -335,14 +288,7 @@ opPACKSSWB_a32(uint32_t fetchdat)
 
     MMX_GETSRC();
 
-    dst->sb[0] = SSATB(dst->sw[0]);
-    dst->sb[1] = SSATB(dst->sw[1]);
-    dst->sb[2] = SSATB(dst->sw[2]);
-    dst->sb[3] = SSATB(dst->sw[3]);
-    dst->sb[4] = SSATB(src.sw[0]);
-    dst->sb[5] = SSATB(src.sw[1]);
-    dst->sb[6] = SSATB(src.sw[2]);
-    dst->sb[7] = SSATB(src.sw[3]);
+    mmx_packsswb(dst, &src);
 
     MMX_SETEXP(cpu_reg);
 
@@ -362,14 +308,7 @@ opPACKUSWB_a16(uint32_t fetchdat)
 
     MMX_GETSRC();
 
-    dst->b[0] = USATB(dst->sw[0]);
-    dst->b[1] = USATB(dst->sw[1]);
-    dst->b[2] = USATB(dst->sw[2]);
-    dst->b[3] = USATB(dst->sw[3]);
-    dst->b[4] = USATB(src.sw[0]);
-    dst->b[5] = USATB(src.sw[1]);
-    dst->b[6] = USATB(src.sw[2]);
-    dst->b[7] = USATB(src.sw[3]);
+    mmx_packuswb(dst, &src);
 
     MMX_SETEXP(cpu_reg);
 
@@ -388,14 +327,7 @@ opPACKUSWB_a32(uint32_t fetchdat)
 
     MMX_GETSRC();
 
-    dst->b[0] = USATB(dst->sw[0]);
-    dst->b[1] = USATB(dst->sw[1]);
-    dst->b[2] = USATB(dst->sw[2]);
-    dst->b[3] = USATB(dst->sw[3]);
-    dst->b[4] = USATB(src.sw[0]);
-    dst->b[5] = USATB(src.sw[1]);
-    dst->b[6] = USATB(src.sw[2]);
-    dst->b[7] = USATB(src.sw[3]);
+    mmx_packuswb(dst, &src);
 
     MMX_SETEXP(cpu_reg);
 
@@ -407,20 +339,15 @@ opPACKSSDW_a16(uint32_t fetchdat)
 {
     MMX_REG  src;
     MMX_REG *dst;
-    MMX_REG  dst2;
     MMX_ENTER();
 
     fetch_ea_16(fetchdat);
 
-    dst  = MMX_GETREGP(cpu_reg);
-    dst2 = *dst;
+    dst = MMX_GETREGP(cpu_reg);
 
     MMX_GETSRC();
 
-    dst->sw[0] = SSATW(dst2.sl[0]);
-    dst->sw[1] = SSATW(dst2.sl[1]);
-    dst->sw[2] = SSATW(src.sl[0]);
-    dst->sw[3] = SSATW(src.sl[1]);
+    mmx_packssdw(dst, &src);
 
     MMX_SETEXP(cpu_reg);
 
@@ -431,20 +358,15 @@ opPACKSSDW_a32(uint32_t fetchdat)
 {
     MMX_REG  src;
     MMX_REG *dst;
-    MMX_REG  dst2;
     MMX_ENTER();
 
     fetch_ea_32(fetchdat);
 
-    dst  = MMX_GETREGP(cpu_reg);
-    dst2 = *dst;
+    dst = MMX_GETREGP(cpu_reg);
 
     MMX_GETSRC();
 
-    dst->sw[0] = SSATW(dst2.sl[0]);
-    dst->sw[1] = SSATW(dst2.sl[1]);
-    dst->sw[2] = SSATW(src.sl[0]);
-    dst->sw[3] = SSATW(src.sl[1]);
+    mmx_packssdw(dst, &src);
 
     MMX_SETEXP(cpu_reg);
 
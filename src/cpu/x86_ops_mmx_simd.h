@@ -0,0 +1,319 @@
+/* Packed MMX arithmetic, compare and pack/unpack helpers.
+
+   Each helper computes dst = dst OP src for a single 64-bit MMX register. On
+   hosts with SSE2 or NEON, the operation is done with the equivalent host
+   vector instruction on the low 64 bits of a vector register; otherwise the
+   lanes are processed one at a time. The host instructions have the same
+   wrapping and saturation behaviour as their MMX counterparts, so all three
+   variants give bit-identical results. */
+#ifndef EMU_X86_OPS_MMX_SIMD_H
+#define EMU_X86_OPS_MMX_SIMD_H
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#    define MMX_SIMD_SSE2
+#    include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#    define MMX_SIMD_NEON
+#    include <arm_neon.h>
+#endif
+
+#if defined(MMX_SIMD_SSE2)
+#    define MMX_SIMD_OP(name, expr)                                        \
+        static __inline void                                               \
+        name(MMX_REG *dst, const MMX_REG *src)                             \
+        {                                                                  \
+            const __m128i d = _mm_loadl_epi64((const __m128i *) &dst->q); \
+            const __m128i s = _mm_loadl_epi64((const __m128i *) &src->q); \
+                                                                           \
+            _mm_storel_epi64((__m128i *) &dst->q, expr);                   \
+        }
+
+MMX_SIMD_OP(mmx_paddb, _mm_add_epi8(d, s))
+MMX_SIMD_OP(mmx_paddw, _mm_add_epi16(d, s))
+MMX_SIMD_OP(mmx_paddd, _mm_add_epi32(d, s))
+MMX_SIMD_OP(mmx_paddsb, _mm_adds_epi8(d, s))
+MMX_SIMD_OP(mmx_paddsw, _mm_adds_epi16(d, s))
+MMX_SIMD_OP(mmx_paddusb, _mm_adds_epu8(d, s))
+MMX_SIMD_OP(mmx_paddusw, _mm_adds_epu16(d, s))
+MMX_SIMD_OP(mmx_psubb, _mm_sub_epi8(d, s))
+MMX_SIMD_OP(mmx_psubw, _mm_sub_epi16(d, s))
+MMX_SIMD_OP(mmx_psubd, _mm_sub_epi32(d, s))
+MMX_SIMD_OP(mmx_psubsb, _mm_subs_epi8(d, s))
+MMX_SIMD_OP(mmx_psubsw, _mm_subs_epi16(d, s))
+MMX_SIMD_OP(mmx_psubusb, _mm_subs_epu8(d, s))
+MMX_SIMD_OP(mmx_psubusw, _mm_subs_epu16(d, s))
+MMX_SIMD_OP(mmx_pmullw, _mm_mullo_epi16(d, s))
+MMX_SIMD_OP(mmx_pmulhw, _mm_mulhi_epi16(d, s))
+MMX_SIMD_OP(mmx_pmaddwd, _mm_madd_epi16(d, s))
+MMX_SIMD_OP(mmx_pcmpeqb, _mm_cmpeq_epi8(d, s))
+MMX_SIMD_OP(mmx_pcmpeqw, _mm_cmpeq_epi16(d, s))
+MMX_SIMD_OP(mmx_pcmpeqd, _mm_cmpeq_epi32(d, s))
+MMX_SIMD_OP(mmx_pcmpgtb, _mm_cmpgt_epi8(d, s))
+MMX_SIMD_OP(mmx_pcmpgtw, _mm_cmpgt_epi16(d, s))
+MMX_SIMD_OP(mmx_pcmpgtd, _mm_cmpgt_epi32(d, s))
+/* The packs saturate dst into the low half and src into the high half. */
+MMX_SIMD_OP(mmx_packsswb, _mm_shuffle_epi32(_mm_packs_epi16(d, s), 0x08))
+MMX_SIMD_OP(mmx_packuswb, _mm_shuffle_epi32(_mm_packus_epi16(d, s), 0x08))
+MMX_SIMD_OP(mmx_packssdw, _mm_shuffle_epi32(_mm_packs_epi32(d, s), 0x08))
+/* Interleaving the low 64 bits gives the low unpack in the low half of the
+   result, and the high unpack in the high half. */
+MMX_SIMD_OP(mmx_punpcklbw, _mm_unpacklo_epi8(d, s))
+MMX_SIMD_OP(mmx_punpckhbw, _mm_srli_si128(_mm_unpacklo_epi8(d, s), 8))
+MMX_SIMD_OP(mmx_punpcklwd, _mm_unpacklo_epi16(d, s))
+MMX_SIMD_OP(mmx_punpckhwd, _mm_srli_si128(_mm_unpacklo_epi16(d, s), 8))
+
+#    undef MMX_SIMD_OP
+#elif defined(MMX_SIMD_NEON)
+#    define MMX_SIMD_OP(name, type, load, store, expr)            \
+        static __inline void                                      \
+        name(MMX_REG *dst, const MMX_REG *src)                    \
+        {                                                         \
+            const type d = load((const void *) &dst->q);          \
+            const type s = load((const void *) &src->q);          \
+                                                                  \
+            store((void *) &dst->q, expr);                        \
+        }
+
+static __inline uint8x8_t
+mmx_neon_ld_u8(const void *p)
+{
+    return vld1_u8((const uint8_t *) p);
+}
+static __inline int8x8_t
+mmx_neon_ld_s8(const void *p)
+{
+    return vld1_s8((const int8_t *) p);
+}
+static __inline uint16x4_t
+mmx_neon_ld_u16(const void *p)
+{
+    return vld1_u16((const uint16_t *) p);
+}
+static __inline int16x4_t
+mmx_neon_ld_s16(const void *p)
+{
+    return vld1_s16((const int16_t *) p);
+}
+static __inline uint32x2_t
+mmx_neon_ld_u32(const void *p)
+{
+    return vld1_u32((const uint32_t *) p);
+}
+static __inline int32x2_t
+mmx_neon_ld_s32(const void *p)
+{
+    return vld1_s32((const int32_t *) p);
+}
+static __inline void
+mmx_neon_st_u8(void *p, uint8x8_t v)
+{
+    vst1_u8((uint8_t *) p, v);
+}
+static __inline void
+mmx_neon_st_s8(void *p, int8x8_t v)
+{
+    vst1_s8((int8_t *) p, v);
+}
+static __inline void
+mmx_neon_st_u16(void *p, uint16x4_t v)
+{
+    vst1_u16((uint16_t *) p, v);
+}
+static __inline void
+mmx_neon_st_s16(void *p, int16x4_t v)
+{
+    vst1_s16((int16_t *) p, v);
+}
+static __inline void
+mmx_neon_st_u32(void *p, uint32x2_t v)
+{
+    vst1_u32((uint32_t *) p, v);
+}
+static __inline void
+mmx_neon_st_s32(void *p, int32x2_t v)
+{
+    vst1_s32((int32_t *) p, v);
+}
+
+/* Vector type, load and store for each lane layout */
+#    define MMX_U8  uint8x8_t, mmx_neon_ld_u8, mmx_neon_st_u8
+#    define MMX_S8  int8x8_t, mmx_neon_ld_s8, mmx_neon_st_s8
+#    define MMX_U16 uint16x4_t, mmx_neon_ld_u16, mmx_neon_st_u16
+#    define MMX_S16 int16x4_t, mmx_neon_ld_s16, mmx_neon_st_s16
+#    define MMX_U32 uint32x2_t, mmx_neon_ld_u32, mmx_neon_st_u32
+#    define MMX_S32 int32x2_t, mmx_neon_ld_s32, mmx_neon_st_s32
+#    define MMX_SIMD_OP_(...) MMX_SIMD_OP(__VA_ARGS__)
+
+MMX_SIMD_OP_(mmx_paddb, MMX_U8, vadd_u8(d, s))
+MMX_SIMD_OP_(mmx_paddw, MMX_U16, vadd_u16(d, s))
+MMX_SIMD_OP_(mmx_paddd, MMX_U32, vadd_u32(d, s))
+MMX_SIMD_OP_(mmx_paddsb, MMX_S8, vqadd_s8(d, s))
+MMX_SIMD_OP_(mmx_paddsw, MMX_S16, vqadd_s16(d, s))
+MMX_SIMD_OP_(mmx_paddusb, MMX_U8, vqadd_u8(d, s))
+MMX_SIMD_OP_(mmx_paddusw, MMX_U16, vqadd_u16(d, s))
+MMX_SIMD_OP_(mmx_psubb, MMX_U8, vsub_u8(d, s))
+MMX_SIMD_OP_(mmx_psubw, MMX_U16, vsub_u16(d, s))
+MMX_SIMD_OP_(mmx_psubd, MMX_U32, vsub_u32(d, s))
+MMX_SIMD_OP_(mmx_psubsb, MMX_S8, vqsub_s8(d, s))
+MMX_SIMD_OP_(mmx_psubsw, MMX_S16, vqsub_s16(d, s))
+MMX_SIMD_OP_(mmx_psubusb, MMX_U8, vqsub_u8(d, s))
+MMX_SIMD_OP_(mmx_psubusw, MMX_U16, vqsub_u16(d, s))
+MMX_SIMD_OP_(mmx_pmullw, MMX_S16, vmul_s16(d, s))
+MMX_SIMD_OP_(mmx_pmulhw, MMX_S16, vshrn_n_s32(vmull_s16(d, s), 16))
+MMX_SIMD_OP_(mmx_pcmpeqb, MMX_U8, vceq_u8(d, s))
+MMX_SIMD_OP_(mmx_pcmpeqw, MMX_U16, vceq_u16(d, s))
+MMX_SIMD_OP_(mmx_pcmpeqd, MMX_U32, vceq_u32(d, s))
+MMX_SIMD_OP_(mmx_pcmpgtb, MMX_S8, vreinterpret_s8_u8(vcgt_s8(d, s)))
+MMX_SIMD_OP_(mmx_pcmpgtw, MMX_S16, vreinterpret_s16_u16(vcgt_s16(d, s)))
+MMX_SIMD_OP_(mmx_pcmpgtd, MMX_S32, vreinterpret_s32_u32(vcgt_s32(d, s)))
+MMX_SIMD_OP_(mmx_packsswb, MMX_S16, vreinterpret_s16_s8(vqmovn_s16(vcombine_s16(d, s))))
+MMX_SIMD_OP_(mmx_packuswb, MMX_S16, vreinterpret_s16_u8(vqmovun_s16(vcombine_s16(d, s))))
+MMX_SIMD_OP_(mmx_packssdw, MMX_S32, vreinterpret_s32_s16(vqmovn_s32(vcombine_s32(d, s))))
+MMX_SIMD_OP_(mmx_punpcklbw, MMX_U8, vzip_u8(d, s).val[0])
+MMX_SIMD_OP_(mmx_punpckhbw, MMX_U8, vzip_u8(d, s).val[1])
+MMX_SIMD_OP_(mmx_punpcklwd, MMX_U16, vzip_u16(d, s).val[0])
+MMX_SIMD_OP_(mmx_punpckhwd, MMX_U16, vzip_u16(d, s).val[1])
+
+#    undef MMX_SIMD_OP_
+#    undef MMX_SIMD_OP
+
+static __inline void
+mmx_pmaddwd(MMX_REG *dst, const MMX_REG *src)
+{
+    const int32x4_t p = vmull_s16(vld1_s16(dst->sw), vld1_s16(src->sw));
+
+    /* The pairwise add wraps, giving 0x80000000 for 0x8000 * 0x8000 * 2 as on
+       real hardware. */
+    vst1_s32(dst->sl, vpadd_s32(vget_low_s32(p), vget_high_s32(p)));
+}
+#    undef MMX_U8
+#    undef MMX_S8
+#    undef MMX_U16
+#    undef MMX_S16
+#    undef MMX_U32
+#    undef MMX_S32
+#else
+#    define MMX_SIMD_LANES(name, lanes, op)                \
+        static __inline void                               \
+        name(MMX_REG *dst, const MMX_REG *src)             \
+        {                                                  \
+            for (int c = 0; c < lanes; c++)                \
+                op;                                        \
+        }
+
+MMX_SIMD_LANES(mmx_paddb, 8, dst->b[c] += src->b[c])
+MMX_SIMD_LANES(mmx_paddw, 4, dst->w[c] += src->w[c])
+MMX_SIMD_LANES(mmx_paddd, 2, dst->l[c] += src->l[c])
+MMX_SIMD_LANES(mmx_paddsb, 8, dst->sb[c] = SSATB(dst->sb[c] + src->sb[c]))
+MMX_SIMD_LANES(mmx_paddsw, 4, dst->sw[c] = SSATW(dst->sw[c] + src->sw[c]))
+MMX_SIMD_LANES(mmx_paddusb, 8, dst->b[c] = USATB(dst->b[c] + src->b[c]))
+MMX_SIMD_LANES(mmx_paddusw, 4, dst->w[c] = USATW(dst->w[c] + src->w[c]))
+MMX_SIMD_LANES(mmx_psubb, 8, dst->b[c] -= src->b[c])
+MMX_SIMD_LANES(mmx_psubw, 4, dst->w[c] -= src->w[c])
+MMX_SIMD_LANES(mmx_psubd, 2, dst->l[c] -= src->l[c])
+MMX_SIMD_LANES(mmx_psubsb, 8, dst->sb[c] = SSATB(dst->sb[c] - src->sb[c]))
+MMX_SIMD_LANES(mmx_psubsw, 4, dst->sw[c] = SSATW(dst->sw[c] - src->sw[c]))
+MMX_SIMD_LANES(mmx_psubusb, 8, dst->b[c] = USATB(dst->b[c] - src->b[c]))
+MMX_SIMD_LANES(mmx_psubusw, 4, dst->w[c] = USATW(dst->w[c] - src->w[c]))
+MMX_SIMD_LANES(mmx_pmullw, 4, dst->w[c] *= src->w[c])
+MMX_SIMD_LANES(mmx_pmulhw, 4, dst->w[c] = ((int32_t) dst->sw[c] * (int32_t) src->sw[c]) >> 16)
+MMX_SIMD_LANES(mmx_pcmpeqb, 8, dst->b[c] = (dst->b[c] == src->b[c]) ? 0xff : 0)
+MMX_SIMD_LANES(mmx_pcmpeqw, 4, dst->w[c] = (dst->w[c] == src->w[c]) ? 0xffff : 0)
+MMX_SIMD_LANES(mmx_pcmpeqd, 2, dst->l[c] = (dst->l[c] == src->l[c]) ? 0xffffffff : 0)
+MMX_SIMD_LANES(mmx_pcmpgtb, 8, dst->b[c] = (dst->sb[c] > src->sb[c]) ? 0xff : 0)
+MMX_SIMD_LANES(mmx_pcmpgtw, 4, dst->w[c] = (dst->sw[c] > src->sw[c]) ? 0xffff : 0)
+MMX_SIMD_LANES(mmx_pcmpgtd, 2, dst->l[c] = (dst->sl[c] > src->sl[c]) ? 0xffffffff : 0)
+
+#    undef MMX_SIMD_LANES
+
+static __inline void
+mmx_pmaddwd(MMX_REG *dst, const MMX_REG *src)
+{
+    for (int c = 0; c < 2; c++) {
+        if ((dst->l[c] == 0x80008000) && (src->l[c] == 0x80008000))
+            dst->l[c] = 0x80000000;
+        else
+            dst->sl[c] = ((int32_t) dst->sw[c * 2] * (int32_t) src->sw[c * 2]) +
+                         ((int32_t) dst->sw[c * 2 + 1] * (int32_t) src->sw[c * 2 + 1]);
+    }
+}
+
+static __inline void
+mmx_packsswb(MMX_REG *dst, const MMX_REG *src)
+{
+    const MMX_REG d = *dst;
+
+    for (int c = 0; c < 4; c++) {
+        dst->sb[c]     = SSATB(d.sw[c]);
+        dst->sb[c + 4] = SSATB(src->sw[c]);
+    }
+}
+
+static __inline void
+mmx_packuswb(MMX_REG *dst, const MMX_REG *src)
+{
+    const MMX_REG d = *dst;
+
+    for (int c = 0; c < 4; c++) {
+        dst->b[c]     = USATB(d.sw[c]);
+        dst->b[c + 4] = USATB(src->sw[c]);
+    }
+}
+
+static __inline void
+mmx_packssdw(MMX_REG *dst, const MMX_REG *src)
+{
+    const MMX_REG d = *dst;
+
+    for (int c = 0; c < 2; c++) {
+        dst->sw[c]     = SSATW(d.sl[c]);
+        dst->sw[c + 2] = SSATW(src->sl[c]);
+    }
+}
+
+static __inline void
+mmx_punpcklbw(MMX_REG *dst, const MMX_REG *src)
+{
+    const MMX_REG d = *dst;
+
+    for (int c = 0; c < 4; c++) {
+        dst->b[c * 2]     = d.b[c];
+        dst->b[c * 2 + 1] = src->b[c];
+    }
+}
+
+static __inline void
+mmx_punpckhbw(MMX_REG *dst, const MMX_REG *src)
+{
+    const MMX_REG d = *dst;
+
+    for (int c = 0; c < 4; c++) {
+        dst->b[c * 2]     = d.b[c + 4];
+        dst->b[c * 2 + 1] = src->b[c + 4];
+    }
+}
+
+static __inline void
+mmx_punpcklwd(MMX_REG *dst, const MMX_REG *src)
+{
+    const MMX_REG d = *dst;
+
+    for (int c = 0; c < 2; c++) {
+        dst->w[c * 2]     = d.w[c];
+        dst->w[c * 2 + 1] = src->w[c];
+    }
+}
+
+static __inline void
+mmx_punpckhwd(MMX_REG *dst, const MMX_REG *src)
+{
+    const MMX_REG d = *dst;
+
+    for (int c = 0; c < 2; c++) {
+        dst->w[c * 2]     = d.w[c + 2];
+        dst->w[c * 2 + 1] = src->w[c + 2];
+    }
+}
+#endif
+
+#endif /*EMU_X86_OPS_MMX_SIMD_H*/
@@ -38,25 +38,37 @@
                                                                                                                   \
         if (CNT_REG > 0) {                                                                                        \
             uint16_t temp;                                                                                        \
+            uint32_t n = 0;                                                                                       \
                                                                                                                   \
             SEG_CHECK_WRITE(&cpu_state.seg_es);                                                                   \
             check_io_perm(DX, 2);                                                                                 \
-            CHECK_WRITE(&cpu_state.seg_es, DEST_REG, DEST_REG + 1UL);                                             \
-            high_page = 0;                                                                                        \
-            do_mmut_ww(es, DEST_REG, addr64a);                                                                    \
-            if (cpu_state.abrt)                                                                                   \
-                return 1;                                                                                         \
-            temp = inw(DX);                                                                                       \
-            writememw_n(es, DEST_REG, addr64a, temp);                                                             \
-            if (cpu_state.abrt)                                                                                   \
-                return 1;                                                                                         \
+            if (!(cpu_state.flags & D_FLAG) && !trap) {                                                           \
+                uint32_t off_mask = (sizeof(DEST_REG) == 2) ? 0xffff : 0xffffffff;                                \
+                n = rep_insw_fast(DX, &cpu_state.seg_es, DEST_REG, off_mask, CNT_REG,                             \
+                                  (cycles > 15) ? (cycles / 15) : 1);                                             \
+            }                                                                                                     \
+            if (n) {                                                                                              \
+                DEST_REG += n * 2;                                                                                \
+                CNT_REG -= n;                                                                                     \
+                cycles -= n * 15;                                                                                 \
+            } else {                                                                                              \
+                CHECK_WRITE(&cpu_state.seg_es, DEST_REG, DEST_REG + 1UL);                                         \
+                high_page = 0;                                                                                    \
+                do_mmut_ww(es, DEST_REG, addr64a);                                                                \
+                if (cpu_state.abrt)                                                                               \
+                    return 1;                                                                                     \
+                temp = inw(DX);                                                                                   \
+                writememw_n(es, DEST_REG, addr64a, temp);                                                         \
+                if (cpu_state.abrt)                                                                               \
+                    return 1;                                                                                     \
                                                                                                                   \
-            if (cpu_state.flags & D_FLAG)                                                                         \
-                DEST_REG -= 2;                                                                                    \
-            else                                                                                                  \
-                DEST_REG += 2;                                                                                    \
-            CNT_REG--;                                                                                            \
-            cycles -= 15;                                                                                         \
+                if (cpu_state.flags & D_FLAG)                                                                     \
+                    DEST_REG -= 2;                                                                                \
+                else                                                                                              \
+                    DEST_REG += 2;                                                                                \
+                CNT_REG--;                                                                                        \
+                cycles -= 15;                                                                                     \
+            }                                                                                                     \
         }                                                                                                         \
         if (CNT_REG > 0) {                                                                                        \
             CPU_BLOCK_END();                                                                                      \
@@ -128,19 +140,34 @@
     {                                                                                                             \
         if (CNT_REG > 0) {                                                                                        \
             uint16_t temp;                                                                                        \
+            uint32_t n = 0;                                                                                       \
+                                                                                                                  \
             SEG_CHECK_READ(cpu_state.ea_seg);                                                                     \
-            CHECK_READ(cpu_state.ea_seg, SRC_REG, SRC_REG + 1UL);                                                 \
-            temp = readmemw(cpu_state.ea_seg->base, SRC_REG);                                                     \
-            if (cpu_state.abrt)                                                                                   \
-                return 1;                                                                                         \
-            check_io_perm(DX, 2);                                                                                 \
-            outw(DX, temp);                                                                                       \
-            if (cpu_state.flags & D_FLAG)                                                                         \
-                SRC_REG -= 2;                                                                                     \
-            else                                                                                                  \
-                SRC_REG += 2;                                                                                     \
-            CNT_REG--;                                                                                            \
-            cycles -= 14;                                                                                         \
+            if (!(cpu_state.flags & D_FLAG) && !trap) {                                                           \
+                uint32_t off_mask = (sizeof(SRC_REG) == 2) ? 0xffff : 0xffffffff;                                 \
+                                                                                                                  \
+                check_io_perm(DX, 2);                                                                             \
+                n = rep_outsw_fast(DX, cpu_state.ea_seg, SRC_REG, off_mask, CNT_REG,                              \
+                                   (cycles > 14) ? (cycles / 14) : 1);                                            \
+            }                                                                                                     \
+            if (n) {                                                                                              \
+                SRC_REG += n * 2;                                                                                 \
+                CNT_REG -= n;                                                                                     \
+                cycles -= n * 14;                                                                                 \
+            } else {                                                                                              \
+                CHECK_READ(cpu_state.ea_seg, SRC_REG, SRC_REG + 1UL);                                             \
+                temp = readmemw(cpu_state.ea_seg->base, SRC_REG);                                                 \
+                if (cpu_state.abrt)                                                                               \
+                    return 1;                                                                                     \
+                check_io_perm(DX, 2);                                                                             \
+                outw(DX, temp);                                                                                   \
+                if (cpu_state.flags & D_FLAG)                                                                     \
+                    SRC_REG -= 2;                                                                                 \
+                else                                                                                              \
+                    SRC_REG += 2;                                                                                 \
+                CNT_REG--;                                                                                        \
+                cycles -= 14;                                                                                     \
+            }                                                                                                     \
         }                                                                                                         \
         if (CNT_REG > 0) {                                                                                        \
             CPU_BLOCK_END();                                                                                      \
@@ -186,6 +213,22 @@
             SEG_CHECK_WRITE(&cpu_state.seg_es);                                                                   \
         }                                                                                                         \
         while (CNT_REG > 0) {                                                                                     \
+            if (!(cpu_state.flags & D_FLAG)) {                                                                    \
+                int      c        = is486 ? 3 : 4;                                                                \
+                uint32_t off_mask = (sizeof(DEST_REG) == 2) ? 0xffff : 0xffffffff;                                \
+                uint32_t max      = (cycles >= cycles_end) ? ((cycles - cycles_end) / c) + 1 : 1;                 \
+                uint32_t n        = rep_movs_fast(cpu_state.ea_seg, SRC_REG, &cpu_state.seg_es, DEST_REG,         \
+                                                  off_mask, CNT_REG, max, 1);                                     \
+                if (n) {                                                                                          \
+                    DEST_REG += n;                                                                                \
+                    SRC_REG += n;                                                                                 \
+                    CNT_REG -= n;                                                                                 \
+                    cycles -= n * c;                                                                              \
+                    if (cycles < cycles_end)                                                                      \
+                        break;                                                                                    \
+                    continue;                                                                                     \
+                }                                                                                                 \
+            }                                                                                                     \
             uint8_t temp;                                                                                         \
                                                                                                                   \
             CHECK_READ_REP(cpu_state.ea_seg, SRC_REG, SRC_REG);                                                   \
@@ -235,6 +278,22 @@
             SEG_CHECK_WRITE(&cpu_state.seg_es);                                                                   \
         }                                                                                                         \
         while (CNT_REG > 0) {                                                                                     \
+            if (!(cpu_state.flags & D_FLAG)) {                                                                    \
+                int      c        = is486 ? 3 : 4;                                                                \
+                uint32_t off_mask = (sizeof(DEST_REG) == 2) ? 0xffff : 0xffffffff;                                \
+                uint32_t max      = (cycles >= cycles_end) ? ((cycles - cycles_end) / c) + 1 : 1;                 \
+                uint32_t n        = rep_movs_fast(cpu_state.ea_seg, SRC_REG, &cpu_state.seg_es, DEST_REG,         \
+                                                  off_mask, CNT_REG, max, 2);                                     \
+                if (n) {                                                                                          \
+                    DEST_REG += n * 2;                                                                            \
+                    SRC_REG += n * 2;                                                                             \
+                    CNT_REG -= n;                                                                                 \
+                    cycles -= n * c;                                                                              \
+                    if (cycles < cycles_end)                                                                      \
+                        break;                                                                                    \
+                    continue;                                                                                     \
+                }                                                                                                 \
+            }                                                                                                     \
             uint16_t temp;                                                                                        \
                                                                                                                   \
             CHECK_READ_REP(cpu_state.ea_seg, SRC_REG, SRC_REG + 1UL);                                             \
@@ -284,6 +343,22 @@
             SEG_CHECK_WRITE(&cpu_state.seg_es);                                                                   \
         }                                                                                                         \
         while (CNT_REG > 0) {                                                                                     \
+            if (!(cpu_state.flags & D_FLAG)) {                                                                    \
+                int      c        = is486 ? 3 : 4;                                                                \
+                uint32_t off_mask = (sizeof(DEST_REG) == 2) ? 0xffff : 0xffffffff;                                \
+                uint32_t max      = (cycles >= cycles_end) ? ((cycles - cycles_end) / c) + 1 : 1;                 \
+                uint32_t n        = rep_movs_fast(cpu_state.ea_seg, SRC_REG, &cpu_state.seg_es, DEST_REG,         \
+                                                  off_mask, CNT_REG, max, 4);                                     \
+                if (n) {                                                                                          \
+                    DEST_REG += n * 4;                                                                            \
+                    SRC_REG += n * 4;                                                                             \
+                    CNT_REG -= n;                                                                                 \
+                    cycles -= n * c;                                                                              \
+                    if (cycles < cycles_end)                                                                      \
+                        break;                                                                                    \
+                    continue;                                                                                     \
+                }                                                                                                 \
+            }                                                                                                     \
             uint32_t temp;                                                                                        \
                                                                                                                   \
             CHECK_READ_REP(cpu_state.ea_seg, SRC_REG, SRC_REG + 3UL);                                             \
@@ -330,6 +405,20 @@
         if (CNT_REG > 0)                                                                                          \
             SEG_CHECK_WRITE(&cpu_state.seg_es);                                                                   \
         while (CNT_REG > 0) {                                                                                     \
+            if (!(cpu_state.flags & D_FLAG)) {                                                                    \
+                int      c        = is486 ? 4 : 5;                                                                \
+                uint32_t off_mask = (sizeof(DEST_REG) == 2) ? 0xffff : 0xffffffff;                                \
+                uint32_t max      = (cycles >= cycles_end) ? ((cycles - cycles_end) / c) + 1 : 1;                 \
+                uint32_t n        = rep_stos_fast(&cpu_state.seg_es, DEST_REG, off_mask, CNT_REG, max, AL, 1);    \
+                if (n) {                                                                                          \
+                    DEST_REG += n;                                                                                \
+                    CNT_REG -= n;                                                                                 \
+                    cycles -= n * c;                                                                              \
+                    if (cycles < cycles_end)                                                                      \
+                        break;                                                                                    \
+                    continue;                                                                                     \
+                }                                                                                                 \
+            }                                                                                                     \
             CHECK_WRITE_REP(&cpu_state.seg_es, DEST_REG, DEST_REG);                                               \
             writememb(es, DEST_REG, AL);                                                                          \
             if (cpu_state.abrt)                                                                                   \
@@ -358,6 +447,20 @@
         if (CNT_REG > 0)                                                                                          \
             SEG_CHECK_WRITE(&cpu_state.seg_es);                                                                   \
         while (CNT_REG > 0) {                                                                                     \
+            if (!(cpu_state.flags & D_FLAG)) {                                                                    \
+                int      c        = is486 ? 4 : 5;                                                                \
+                uint32_t off_mask = (sizeof(DEST_REG) == 2) ? 0xffff : 0xffffffff;                                \
+                uint32_t max      = (cycles >= cycles_end) ? ((cycles - cycles_end) / c) + 1 : 1;                 \
+                uint32_t n        = rep_stos_fast(&cpu_state.seg_es, DEST_REG, off_mask, CNT_REG, max, AX, 2);    \
+                if (n) {                                                                                          \
+                    DEST_REG += n * 2;                                                                            \
+                    CNT_REG -= n;                                                                                 \
+                    cycles -= n * c;                                                                              \
+                    if (cycles < cycles_end)                                                                      \
+                        break;                                                                                    \
+                    continue;                                                                                     \
+                }                                                                                                 \
+            }                                                                                                     \
             CHECK_WRITE_REP(&cpu_state.seg_es, DEST_REG, DEST_REG + 1UL);                                         \
             writememw(es, DEST_REG, AX);                                                                          \
             if (cpu_state.abrt)                                                                                   \
@@ -386,6 +489,20 @@
         if (CNT_REG > 0)                                                                                          \
             SEG_CHECK_WRITE(&cpu_state.seg_es);                                                                   \
         while (CNT_REG > 0) {                                                                                     \
+            if (!(cpu_state.flags & D_FLAG)) {                                                                    \
+                int      c        = is486 ? 4 : 5;                                                                \
+                uint32_t off_mask = (sizeof(DEST_REG) == 2) ? 0xffff : 0xffffffff;                                \
+                uint32_t max      = (cycles >= cycles_end) ? ((cycles - cycles_end) / c) + 1 : 1;                 \
+                uint32_t n        = rep_stos_fast(&cpu_state.seg_es, DEST_REG, off_mask, CNT_REG, max, EAX, 4);   \
+                if (n) {                                                                                          \
+                    DEST_REG += n * 4;                                                                            \
+                    CNT_REG -= n;                                                                                 \
+                    cycles -= n * c;                                                                              \
+                    if (cycles < cycles_end)                                                                      \
+                        break;                                                                                    \
+                    continue;                                                                                     \
+                }                                                                                                 \
+            }                                                                                                     \
             CHECK_WRITE_REP(&cpu_state.seg_es, DEST_REG, DEST_REG + 3UL);                                         \
             writememl(es, DEST_REG, EAX);                                                                         \
             if (cpu_state.abrt)                                                                                   \
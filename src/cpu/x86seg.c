@@ -285,6 +285,7 @@ loadseg(uint16_t seg, x86seg *s)
     uint32_t      addr;
     uint32_t     *segdat32 = (uint32_t *) segdat;
     int           dpl;
+    int           cached;
     const x86seg *dt;
 
     if ((msw & 1) && !(cpu_state.eflags & VM_FLAG)) {
@@ -320,13 +321,16 @@ loadseg(uint16_t seg, x86seg *s)
 #endif
         }
         addr += dt->base;
-        read_descriptor(addr, segdat, segdat32, 1);
-        if (cpu_state.abrt)
+        cached = x86seg_desc_cache_lookup(addr, segdat);
+        if (!cached) {
+            read_descriptor(addr, segdat, segdat32, 1);
+            if (cpu_state.abrt)
 #ifdef USE_NEW_DYNAREC
-            return 1;
+                return 1;
 #else
-            return;
+                return;
 #endif
+        }
         dpl = (segdat[2] >> 13) & 3;
         if (s == &cpu_state.seg_ss) {
             if (!(seg & 0xfffc)) {
@@ -432,15 +436,25 @@ loadseg(uint16_t seg, x86seg *s)
         s->seg = seg;
         do_seg_load(s, segdat);
 
-        cpl_override = 1;
-        writememw(0, addr + 4, segdat[2] | 0x100); /* Set accessed bit */
-        cpl_override = 0;
-        s->checked   = 0;
+        /* Like the real CPU, only write the accessed bit back if it is clear. */
+        if (!(segdat[2] & 0x100)) {
+            segdat[2] |= 0x100;
+            cpl_override = 1;
+            writememw(0, addr + 4, segdat[2]); /* Set accessed bit */
+            cpl_override = 0;
+        }
+        if (!cached && !cpu_state.abrt)
+            x86seg_desc_cache_add(addr, segdat);
+        s->checked = 0;
 #ifdef USE_DYNAREC
         if (s == &cpu_state.seg_ds)
             codegen_flat_ds = 0;
         if (s == &cpu_state.seg_ss)
             codegen_flat_ss = 0;
+#    ifdef USE_NEW_DYNAREC
+        if (s == &cpu_state.seg_es)
+            codegen_flat_es = 0;
+#    endif
 #endif
     } else {
         s->access  = 0xe2;
@@ -453,6 +467,10 @@ loadseg(uint16_t seg, x86seg *s)
             codegen_flat_ds = 0;
         if (s == &cpu_state.seg_ss)
             codegen_flat_ss = 0;
+#    ifdef USE_NEW_DYNAREC
+        if (s == &cpu_state.seg_es)
+            codegen_flat_es = 0;
+#    endif
 #endif
         if (s == &cpu_state.seg_ss && (cpu_state.eflags & VM_FLAG))
             set_stack32(0);
@@ -2255,7 +2273,7 @@ taskswitch286(uint16_t seg, uint16_t *segdat, int is32)
         cr0 |= 8;
 
         cr3 = new_cr3;
-        flushmmucache();
+        flushmmucache_cr3();
 
         cpu_state.pc     = new_pc;
         cpu_state.flags  = new_flags;
@@ -2588,5 +2606,9 @@ cyrix_load_seg_descriptor(uint32_t addr, x86seg *seg)
             codegen_flat_ss = 0;
 #endif
         }
+#ifdef USE_NEW_DYNAREC
+        if (seg == &cpu_state.seg_es)
+            codegen_flat_es = 0;
+#endif
     }
 }
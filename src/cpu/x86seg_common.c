@@ -43,6 +43,25 @@ int cgate32;
 
 int intgatesize;
 
+/*Segment descriptor cache.
+
+  Entries are keyed on the linear address of the descriptor, so LGDT and LLDT do
+  not need to invalidate anything - the table limit checks are still done by the
+  caller on every load. Pages holding cached descriptors are flagged, which keeps
+  writes to them off the direct write lookup path, and any write that changes
+  such a page drops the whole cache. TLB flushes and memory map changes do the
+  same, as the linear to physical mapping may have changed.*/
+#define SEG_DESC_CACHE_SIZE 64
+
+typedef struct seg_desc_cache_t {
+    uint32_t addr;
+    uint32_t gen;
+    uint16_t segdat[4];
+} seg_desc_cache_t;
+
+static seg_desc_cache_t seg_desc_cache[SEG_DESC_CACHE_SIZE];
+static uint32_t         seg_desc_gen = 1;
+
 static void
 seg_reset(x86seg *s)
 {
@@ -65,9 +84,61 @@ seg_reset(x86seg *s)
     }
 }
 
+void
+x86seg_desc_cache_flush(void)
+{
+    if (!++seg_desc_gen) {
+        memset(seg_desc_cache, 0, sizeof(seg_desc_cache));
+        seg_desc_gen = 1;
+    }
+}
+
+int
+x86seg_desc_cache_lookup(uint32_t addr, uint16_t *segdat)
+{
+    const seg_desc_cache_t *entry = &seg_desc_cache[(addr >> 3) & (SEG_DESC_CACHE_SIZE - 1)];
+
+    if ((entry->gen != seg_desc_gen) || (entry->addr != addr))
+        return 0;
+
+    memcpy(segdat, entry->segdat, sizeof(entry->segdat));
+    return 1;
+}
+
+void
+x86seg_desc_cache_add(uint32_t addr, const uint16_t *segdat)
+{
+    seg_desc_cache_t *entry = &seg_desc_cache[(addr >> 3) & (SEG_DESC_CACHE_SIZE - 1)];
+    page_t           *page;
+    uint32_t          phys;
+
+    /*Without exec, RAM writes do not go through the page write functions*/
+    if (!cpu_use_exec || ((addr & 0xfff) > 0xff8))
+        return;
+
+    phys = get_phys_noabrt(addr);
+    if ((phys == 0xffffffff) || ((uint64_t) phys >= ((uint64_t) mem_size << 10)) || ((phys >= 0xa0000) && (phys < 0x100000)) ||
+        !mem_addr_is_ram(phys))
+        return;
+
+    page = &pages[phys >> 12];
+    if (!page->desc_cached) {
+        /*Drop any direct write lookups to this page, so that writes to it are
+          seen. This also flushes the cache, so do it before adding the entry*/
+        page->desc_cached = 1;
+        flushmmucache_nopc();
+    }
+
+    entry->addr = addr;
+    entry->gen  = seg_desc_gen;
+    memcpy(entry->segdat, segdat, sizeof(entry->segdat));
+}
+
 void
 x86seg_reset(void)
 {
+    x86seg_desc_cache_flush();
+
     seg_reset(&cpu_state.seg_cs);
     seg_reset(&cpu_state.seg_ds);
     seg_reset(&cpu_state.seg_es);
@@ -50,4 +50,8 @@ extern void    x86ss(char *s, uint16_t error);
 extern void    x86ts(char *s, uint16_t error);
 extern void    do_seg_load(x86seg *s, uint16_t *segdat);
 
+extern void    x86seg_desc_cache_flush(void);
+extern int     x86seg_desc_cache_lookup(uint32_t addr, uint16_t *segdat);
+extern void    x86seg_desc_cache_add(uint32_t addr, const uint16_t *segdat);
+
 #endif /*EMU_X86SEG_COMMON_H*/
@@ -5,6 +5,7 @@
 #include <wchar.h>
 #define fplog 0
 #include <math.h>
+#include <float.h>
 #define HAVE_STDARG_H
 #include <86box/86box.h>
 #include "cpu.h"
@@ -265,6 +266,110 @@ i387cw_to_softfloat_status_word(uint16_t control_word)
     return status;
 }
 
+/* Host FPU fast path for FADD/FSUB/FMUL/FDIV in SoftFloat mode.
+
+   With precision control set to 53 bits and rounding to nearest, an x87
+   operation on two double precision values gives the same result as the
+   host's double precision operation, as long as neither the operands nor the
+   result come close to the edges of the double exponent range - the x87 keeps
+   its full exponent range even at reduced precision. The inexact flag and the
+   C1 round-up indication are recovered exactly from the rounding error, which
+   is computed with error-free transformations (Knuth's two-sum, and fma() for
+   products and quotients).
+
+   Anything else - other precision or rounding control, unmasked exceptions,
+   zeroes, denormals, infinities, NaNs, or values with more than 53 significant
+   bits - returns 0, and the caller falls back to SoftFloat. */
+#define FPU_HOST_EXP_LIMIT 900
+
+static __inline int
+FPU_to_host(const floatx80 a, double *d)
+{
+    int32_t  exp = (int32_t) (a.signExp & 0x7fff) - 0x3fff;
+    uint64_t bits;
+
+    if (!(a.signif & 0x8000000000000000ULL) || (a.signif & 0x7ff) ||
+        (exp < -FPU_HOST_EXP_LIMIT) || (exp > FPU_HOST_EXP_LIMIT))
+        return 0;
+
+    bits = ((uint64_t) (a.signExp & 0x8000) << 48) | ((uint64_t) (exp + 1023) << 52) |
+           ((a.signif >> 11) & 0x000fffffffffffffULL);
+    memcpy(d, &bits, sizeof(double));
+    return 1;
+}
+
+static __inline int
+FPU_from_host(double d, floatx80 *r)
+{
+    uint64_t bits;
+    int32_t  exp;
+
+    memcpy(&bits, &d, sizeof(double));
+    exp = (int32_t) ((bits >> 52) & 0x7ff) - 1023;
+    if ((exp < -FPU_HOST_EXP_LIMIT) || (exp > FPU_HOST_EXP_LIMIT))
+        return 0;
+
+    r->signExp = (uint16_t) (((bits >> 48) & 0x8000) | (uint64_t) (exp + 0x3fff));
+    r->signif  = 0x8000000000000000ULL | ((bits & 0x000fffffffffffffULL) << 11);
+    return 1;
+}
+
+int
+FPU_host_arith(int op, const floatx80 a, const floatx80 b, floatx80 *r, struct softfloat_status_t *status)
+{
+#if defined(FLT_EVAL_METHOD) && (FLT_EVAL_METHOD == 0)
+    double x;
+    double y;
+    double res;
+    double err;
+    double t;
+    int    up;
+
+    if ((status->extF80_roundingPrecision != 64) || (status->softfloat_roundingMode != softfloat_round_near_even) ||
+        (status->softfloat_exceptionMasks != FPU_CW_Exceptions_Mask))
+        return 0;
+    if (!FPU_to_host(a, &x) || !FPU_to_host(b, &y))
+        return 0;
+
+    switch (op) {
+        case FPU_HOST_SUB:
+            y = -y;
+            /* Fall through. */
+        case FPU_HOST_ADD:
+            res = x + y;
+            t   = res - x;
+            err = (x - (res - t)) + (y - t);
+            up  = (err != 0.0) && ((err < 0.0) != (res < 0.0));
+            break;
+        case FPU_HOST_MUL:
+            res = x * y;
+            err = fma(x, y, -res);
+            up  = (err != 0.0) && ((err < 0.0) != (res < 0.0));
+            break;
+        case FPU_HOST_DIV:
+            res = x / y;
+            /* Sign and zeroness of the remainder are all that is needed. */
+            err = fma(-res, y, x);
+            up  = (err != 0.0) && (((err < 0.0) ^ (y < 0.0) ^ (res < 0.0)) != 0);
+            break;
+        default:
+            return 0;
+    }
+
+    if (!FPU_from_host(res, r))
+        return 0;
+
+    if (err != 0.0) {
+        status->softfloat_exceptionFlags |= softfloat_flag_inexact;
+        if (up)
+            softfloat_setRoundingUp(status);
+    }
+    return 1;
+#else
+    return 0;
+#endif
+}
+
 int
 FPU_status_word_flags_fpu_compare(int float_relation)
 {
@@ -153,6 +153,55 @@ int                   FPU_tagof(const extFloat80_t reg);
 uint8_t               pack_FPU_TW(uint16_t twd);
 uint16_t              unpack_FPU_TW(uint16_t tag_byte);
 
+#define FPU_HOST_ADD 0
+#define FPU_HOST_SUB 1
+#define FPU_HOST_MUL 2
+#define FPU_HOST_DIV 3
+
+int FPU_host_arith(int op, const extFloat80_t a, const extFloat80_t b, extFloat80_t *r, struct softfloat_status_t *status);
+
+/* SoftFloat arithmetic, using the host FPU instead when fpu_softfloat_fast is
+   set and the result is known to be identical. */
+static __inline extFloat80_t
+FPU_add(const extFloat80_t a, const extFloat80_t b, struct softfloat_status_t *status)
+{
+    extFloat80_t r;
+
+    if (fpu_softfloat_fast && FPU_host_arith(FPU_HOST_ADD, a, b, &r, status))
+        return r;
+    return extF80_add(a, b, status);
+}
+
+static __inline extFloat80_t
+FPU_sub(const extFloat80_t a, const extFloat80_t b, struct softfloat_status_t *status)
+{
+    extFloat80_t r;
+
+    if (fpu_softfloat_fast && FPU_host_arith(FPU_HOST_SUB, a, b, &r, status))
+        return r;
+    return extF80_sub(a, b, status);
+}
+
+static __inline extFloat80_t
+FPU_mul(const extFloat80_t a, const extFloat80_t b, struct softfloat_status_t *status)
+{
+    extFloat80_t r;
+
+    if (fpu_softfloat_fast && FPU_host_arith(FPU_HOST_MUL, a, b, &r, status))
+        return r;
+    return extF80_mul(a, b, status);
+}
+
+static __inline extFloat80_t
+FPU_div(const extFloat80_t a, const extFloat80_t b, struct softfloat_status_t *status)
+{
+    extFloat80_t r;
+
+    if (fpu_softfloat_fast && FPU_host_arith(FPU_HOST_DIV, a, b, &r, status))
+        return r;
+    return extF80_div(a, b, status);
+}
+
 static __inline uint16_t
 i387_get_control_word(void)
 {
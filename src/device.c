@@ -340,6 +340,20 @@ device_close_all(void)
     }
 }
 
+/* Slot c of the device list, in the order the devices were added. Returns
+   0 past the end of the list, the device is NULL for an empty slot. */
+int
+device_get_attached(int c, const device_t **dev, void **priv)
+{
+    if ((c < 0) || (c >= DEVICE_MAX))
+        return 0;
+
+    *dev  = devices[c];
+    *priv = device_priv[c];
+
+    return 1;
+}
+
 void
 device_reset_all(uint32_t match_flags)
 {
@@ -740,6 +754,13 @@ device_get_instance(void)
     return device_current.instance;
 }
 
+/* Name of the device currently being initialized, if any. */
+const char *
+device_get_current_name(void)
+{
+    return (device_current.dev != NULL) ? device_current.dev->name : NULL;
+}
+
 const char *
 device_get_config_string(const char *str)
 {
@@ -16,6 +16,8 @@
  *          Copyright 2023 Miran Grca.
  *          Copyright 2023 EngiNerd.
  */
+#include <inttypes.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
@@ -43,6 +45,7 @@
 #include <86box/snd_speaker.h>
 #include <86box/video.h>
 #include <86box/keyboard.h>
+#include <86box/snapshot.h>
 
 #include <86box/dma.h>
 #include <86box/pci.h>
@@ -98,6 +101,13 @@
 #define FLAG_PS2           0x04
 #define FLAG_PCI           0x08
 
+/* The controller polls every 100 us while something is going on and stops
+   once it is only waiting for the host or a device. The devices can be fed
+   from the UI thread, where the timers must not be touched, so while they
+   are idle they are polled at a slower rate instead of not at all. */
+#define KBC_POLL_US        100ULL
+#define KBC_DEV_IDLE_US    1000ULL
+
 enum {
     STATE_RESET = 0,       /* KBC reset state, only accepts command AA. */
     STATE_KBC_DELAY_OUT,   /* KBC is sending one single byte. */
@@ -151,6 +161,16 @@ typedef struct atkbc_t {
     pc_timer_t kbc_poll_timer;
     pc_timer_t kbc_dev_poll_timer;
 
+    uint8_t    dev_idle;
+
+#ifdef USE_KBC_STATS
+    uint64_t   polls;
+    uint64_t   wasted_polls; /* Polls that changed nothing. */
+    uint64_t   stops;
+    uint64_t   dev_polls;
+    uint64_t   dev_idle_polls;
+#endif
+
     /* P2 pulse callback timer. */
     pc_timer_t pulse_cb;
 
@@ -749,29 +769,110 @@ kbc_at_poll_ps2(atkbc_t *dev)
     }
 }
 
+/* Whether the controller has nothing to do until the host accesses it or
+   a device has a byte for it. */
+static int
+kbc_at_is_idle(atkbc_t *dev)
+{
+    if ((dev->status & STAT_IFULL) || dev->do_irq || dev->pending)
+        return 0;
+
+    switch (dev->state) {
+        case STATE_RESET:
+        case STATE_KBC_PARAM:
+            return 1;
+        case STATE_KBC_OUT:
+        case STATE_KBC_AMI_OUT:
+            return !!(dev->status & STAT_OFULL);
+        case STATE_MAIN_IBF:
+        case STATE_MAIN_KBD:
+        case STATE_MAIN_AUX:
+        case STATE_MAIN_BOTH:
+            if (dev->status & STAT_OFULL)
+                return 1;
+            for (int i = 0; i < 2; i++) {
+                if ((dev->ports[i] != NULL) && (dev->ports[i]->out_new != -1))
+                    return 0;
+            }
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+static void
+kbc_at_wake(atkbc_t *dev)
+{
+    if (!timer_is_enabled(&dev->kbc_poll_timer))
+        timer_set_delay_u64(&dev->kbc_poll_timer, KBC_POLL_US * TIMER_USEC);
+}
+
+static void
+kbc_at_dev_wake(atkbc_t *dev)
+{
+    if (dev->dev_idle) {
+        dev->dev_idle = 0;
+        timer_set_delay_u64(&dev->kbc_dev_poll_timer, KBC_POLL_US * TIMER_USEC);
+    }
+}
+
 static void
 kbc_at_poll(void *priv)
 {
     atkbc_t *dev = (atkbc_t *) priv;
+#ifdef USE_KBC_STATS
+    uint8_t  old_state  = dev->state;
+    uint8_t  old_status = dev->status;
 
-    timer_advance_u64(&dev->kbc_poll_timer, (100ULL * TIMER_USEC));
+    dev->polls++;
+#endif
 
     /* TODO: Implement the password security state. */
     kbc_at_do_poll(dev);
+
+#ifdef USE_KBC_STATS
+    if ((dev->state == old_state) && (dev->status == old_status))
+        dev->wasted_polls++;
+#endif
+
+    /* A command was handed to a device, make sure it sees it promptly. */
+    if (((dev->ports[0] != NULL) && dev->ports[0]->wantcmd) ||
+        ((dev->ports[1] != NULL) && dev->ports[1]->wantcmd))
+        kbc_at_dev_wake(dev);
+
+    if (kbc_at_is_idle(dev)) {
+#ifdef USE_KBC_STATS
+        dev->stops++;
+#endif
+        return;
+    }
+
+    timer_advance_u64(&dev->kbc_poll_timer, KBC_POLL_US * TIMER_USEC);
 }
 
 static void
 kbc_at_dev_poll(void *priv)
 {
-    atkbc_t *dev = (atkbc_t *) priv;
+    atkbc_t *dev  = (atkbc_t *) priv;
+    int      busy = 0;
+
+    for (int i = 0; i < 2; i++) {
+        if ((kbc_at_ports[i] != NULL) && (kbc_at_ports[i]->priv != NULL)) {
+            busy |= kbc_at_ports[i]->poll(kbc_at_ports[i]->priv);
 
-    timer_advance_u64(&dev->kbc_dev_poll_timer, (100ULL * TIMER_USEC));
+            if (kbc_at_ports[i]->out_new != -1)
+                kbc_at_wake(dev);
+        }
+    }
 
-    if ((kbc_at_ports[0] != NULL) && (kbc_at_ports[0]->priv != NULL))
-        kbc_at_ports[0]->poll(kbc_at_ports[0]->priv);
+#ifdef USE_KBC_STATS
+    dev->dev_polls++;
+    if (!busy)
+        dev->dev_idle_polls++;
+#endif
 
-    if ((kbc_at_ports[1] != NULL) && (kbc_at_ports[1]->priv != NULL))
-        kbc_at_ports[1]->poll(kbc_at_ports[1]->priv);
+    dev->dev_idle = !busy;
+    timer_advance_u64(&dev->kbc_dev_poll_timer, (busy ? KBC_POLL_US : KBC_DEV_IDLE_US) * TIMER_USEC);
 }
 
 static void
@@ -2136,6 +2237,8 @@ kbc_at_write(uint16_t port, uint8_t val, void *priv)
 
     dev->ib = val;
     dev->status |= STAT_IFULL;
+
+    kbc_at_wake(dev);
 }
 
 static uint8_t
@@ -2157,6 +2260,8 @@ kbc_at_read(uint16_t port, void *priv)
                 picintclevel(1 << 1, &dev->irq_state);
             if ((strstr(machine_get_internal_name(), "pb41") != NULL) && (cpu_override_dynarec == 1))
                 cpu_override_dynarec = 0;
+            /* The next byte can go out now. */
+            kbc_at_wake(dev);
             break;
 
         case 0x64:
@@ -2225,6 +2330,9 @@ kbc_at_reset(void *priv)
 
     /* Stage 1. */
     dev->status = (dev->status & 0x0f) | (dev->p1 & 0xf0);
+
+    kbc_at_wake(dev);
+    kbc_at_dev_wake(dev);
 }
 
 static void
@@ -2241,6 +2349,12 @@ kbc_at_close(void *priv)
     timer_disable(&dev->kbc_dev_poll_timer);
     timer_disable(&dev->kbc_poll_timer);
 
+#ifdef USE_KBC_STATS
+    pclog("ATkbc: %" PRIu64 " polls, %" PRIu64 " changed nothing, stopped %" PRIu64 " times\n",
+          dev->polls, dev->wasted_polls, dev->stops);
+    pclog("ATkbc: %" PRIu64 " device polls, %" PRIu64 " idle\n", dev->dev_polls, dev->dev_idle_polls);
+#endif
+
     for (int i = 0; i < max_ports; i++) {
         if (kbc_at_ports[i] != NULL) {
             free(kbc_at_ports[i]);
@@ -2251,6 +2365,49 @@ kbc_at_close(void *priv)
     free(dev);
 }
 
+/* Which KBC ports are decoded is up to the chipset. The devices on the ports
+   save their own state; only what is in flight on the wire is taken here. */
+static void
+kbc_at_save(void *priv, snapshot_t *s)
+{
+    atkbc_t *dev     = (atkbc_t *) priv;
+    uint8_t  swapped = (dev->ports[0] != kbc_at_ports[0]);
+
+    snapshot_write(s, dev, offsetof(atkbc_t, flags));
+    snapshot_write_timer(s, &dev->kbc_poll_timer);
+    snapshot_write_timer(s, &dev->kbc_dev_poll_timer);
+    snapshot_write(s, &dev->dev_idle, sizeof(dev->dev_idle));
+    snapshot_write_timer(s, &dev->pulse_cb);
+    snapshot_write(s, &swapped, sizeof(swapped));
+    for (int i = 0; i < 2; i++)
+        snapshot_write(s, kbc_at_ports[i], offsetof(kbc_at_port_t, priv));
+}
+
+static int
+kbc_at_load(void *priv, snapshot_t *s)
+{
+    atkbc_t *dev = (atkbc_t *) priv;
+    uint8_t  swapped;
+
+    if (!snapshot_read(s, dev, offsetof(atkbc_t, flags)) ||
+        !snapshot_read_timer(s, &dev->kbc_poll_timer) ||
+        !snapshot_read_timer(s, &dev->kbc_dev_poll_timer) ||
+        !snapshot_read(s, &dev->dev_idle, sizeof(dev->dev_idle)) ||
+        !snapshot_read_timer(s, &dev->pulse_cb) ||
+        !snapshot_read(s, &swapped, sizeof(swapped)))
+        return 0;
+
+    for (int i = 0; i < 2; i++) {
+        if (!snapshot_read(s, kbc_at_ports[i], offsetof(kbc_at_port_t, priv)))
+            return 0;
+    }
+
+    dev->ports[0] = kbc_at_ports[!!swapped];
+    dev->ports[1] = kbc_at_ports[!swapped];
+
+    return 1;
+}
+
 void
 kbc_at_handler(int set, void *priv)
 {
@@ -2279,6 +2436,11 @@ kbc_at_init(const device_t *info)
 
     dev->is_asic = !!(info->local & KBC_FLAG_IS_ASIC);
 
+    timer_add(&dev->kbc_poll_timer, kbc_at_poll, dev, 1);
+    timer_add(&dev->pulse_cb, pulse_poll, dev, 0);
+
+    timer_add(&dev->kbc_dev_poll_timer, kbc_at_dev_poll, dev, 1);
+
     video_reset(gfxcard[0]);
     kbc_at_reset(dev);
 
@@ -2288,11 +2450,6 @@ kbc_at_init(const device_t *info)
     kbc_handler_set = 0;
     kbc_at_handler(1, dev);
 
-    timer_add(&dev->kbc_poll_timer, kbc_at_poll, dev, 1);
-    timer_add(&dev->pulse_cb, pulse_poll, dev, 0);
-
-    timer_add(&dev->kbc_dev_poll_timer, kbc_at_dev_poll, dev, 1);
-
     dev->write60_ven = NULL;
     dev->write64_ven = NULL;
 
@@ -2409,6 +2566,8 @@ const device_t keyboard_at_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
+    .save          = kbc_at_save,
+    .load          = kbc_at_load,
     .config        = NULL
 };
 
@@ -2423,6 +2582,8 @@ const device_t keyboard_at_siemens_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
+    .save          = kbc_at_save,
+    .load          = kbc_at_load,
     .config        = NULL
 };
 
@@ -2437,6 +2598,8 @@ const device_t keyboard_at_ami_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
+    .save          = kbc_at_save,
+    .load          = kbc_at_load,
     .config        = NULL
 };
 
@@ -2451,6 +2614,8 @@ const device_t keyboard_at_tg_ami_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
+    .save          = kbc_at_save,
+    .load          = kbc_at_load,
     .config        = NULL
 };
 
@@ -2465,6 +2630,8 @@ const device_t keyboard_at_toshiba_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
+    .save          = kbc_at_save,
+    .load          = kbc_at_load,
     .config        = NULL
 };
 
@@ -2479,6 +2646,8 @@ const device_t keyboard_at_olivetti_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
+    .save          = kbc_at_save,
+    .load          = kbc_at_load,
     .config        = NULL
 };
 
@@ -2493,6 +2662,8 @@ const device_t keyboard_at_ncr_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
+    .save          = kbc_at_save,
+    .load          = kbc_at_load,
     .config        = NULL
 };
 
@@ -2507,6 +2678,8 @@ const device_t keyboard_at_compaq_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
+    .save          = kbc_at_save,
+    .load          = kbc_at_load,
     .config        = NULL
 };
 
@@ -2521,6 +2694,8 @@ const device_t keyboard_ps2_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
+    .save          = kbc_at_save,
+    .load          = kbc_at_load,
     .config        = NULL
 };
 
@@ -2535,6 +2710,8 @@ const device_t keyboard_ps2_ps1_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
+    .save          = kbc_at_save,
+    .load          = kbc_at_load,
     .config        = NULL
 };
 
@@ -2549,6 +2726,8 @@ const device_t keyboard_ps2_ps1_pci_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
+    .save          = kbc_at_save,
+    .load          = kbc_at_load,
     .config        = NULL
 };
 
@@ -2563,6 +2742,8 @@ const device_t keyboard_ps2_xi8088_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
+    .save          = kbc_at_save,
+    .load          = kbc_at_load,
     .config        = NULL
 };
 
@@ -2577,6 +2758,8 @@ const device_t keyboard_ps2_ami_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
+    .save          = kbc_at_save,
+    .load          = kbc_at_load,
     .config        = NULL
 };
 
@@ -2591,6 +2774,8 @@ const device_t keyboard_ps2_holtek_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
+    .save          = kbc_at_save,
+    .load          = kbc_at_load,
     .config        = NULL
 };
 
@@ -2605,6 +2790,8 @@ const device_t keyboard_ps2_phoenix_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
+    .save          = kbc_at_save,
+    .load          = kbc_at_load,
     .config        = NULL
 };
 
@@ -2619,6 +2806,8 @@ const device_t keyboard_ps2_tg_ami_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
+    .save          = kbc_at_save,
+    .load          = kbc_at_load,
     .config        = NULL
 };
 
@@ -2633,6 +2822,8 @@ const device_t keyboard_ps2_mca_1_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
+    .save          = kbc_at_save,
+    .load          = kbc_at_load,
     .config        = NULL
 };
 
@@ -2647,6 +2838,8 @@ const device_t keyboard_ps2_mca_2_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
+    .save          = kbc_at_save,
+    .load          = kbc_at_load,
     .config        = NULL
 };
 
@@ -2661,6 +2854,8 @@ const device_t keyboard_ps2_quadtel_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
+    .save          = kbc_at_save,
+    .load          = kbc_at_load,
     .config        = NULL
 };
 
@@ -2675,6 +2870,8 @@ const device_t keyboard_ps2_pci_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
+    .save          = kbc_at_save,
+    .load          = kbc_at_load,
     .config        = NULL
 };
 
@@ -2689,6 +2886,8 @@ const device_t keyboard_ps2_ami_pci_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
+    .save          = kbc_at_save,
+    .load          = kbc_at_load,
     .config        = NULL
 };
 
@@ -2703,6 +2902,8 @@ const device_t keyboard_ps2_ali_pci_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
+    .save          = kbc_at_save,
+    .load          = kbc_at_load,
     .config        = NULL
 };
 
@@ -2717,6 +2918,8 @@ const device_t keyboard_ps2_intel_ami_pci_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
+    .save          = kbc_at_save,
+    .load          = kbc_at_load,
     .config        = NULL
 };
 
@@ -2731,6 +2934,8 @@ const device_t keyboard_ps2_tg_ami_pci_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
+    .save          = kbc_at_save,
+    .load          = kbc_at_load,
     .config        = NULL
 };
 
@@ -2745,5 +2950,7 @@ const device_t keyboard_ps2_acer_pci_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
+    .save          = kbc_at_save,
+    .load          = kbc_at_load,
     .config        = NULL
 };
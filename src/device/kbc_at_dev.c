@@ -101,7 +101,7 @@ kbc_at_dev_queue_add(atkbc_dev_t *dev, uint8_t val, uint8_t main)
         dev->last_scan_code = val;
 }
 
-static void
+static int
 kbc_at_dev_poll(void *priv)
 {
     atkbc_dev_t *dev = (atkbc_dev_t *) priv;
@@ -174,6 +174,20 @@ kbc_at_dev_poll(void *priv)
         default:
             break;
     }
+
+    /* Idle means waiting for either the host or something to scan. */
+    if (dev->port->wantcmd || (dev->cmd_queue_start != dev->cmd_queue_end))
+        return 1;
+
+    switch (dev->state) {
+        case DEV_STATE_MAIN_1:
+        case DEV_STATE_MAIN_2:
+            return !dev->ignore && *dev->scan && (dev->queue_start != dev->queue_end);
+        case DEV_STATE_MAIN_IN:
+            return 0;
+        default:
+            return 1;
+    }
 }
 
 void
@@ -29,6 +29,8 @@
 #include <86box/machine.h>
 #include <86box/keyboard.h>
 #include <86box/plat.h>
+#include <86box/perf.h>
+#include <86box/replay.h>
 
 #include "cpu.h"
 
@@ -233,6 +235,19 @@ key_process(uint16_t scan, int down)
 /* Handle a keystroke event from the UI layer. */
 void
 keyboard_input(int down, uint16_t scan)
+{
+    int captured = mouse_capture || !kbd_req_capture || video_fullscreen;
+
+    perf_input_event();
+
+    if (replay_mode != REPLAY_OFF)
+        replay_key(down, scan, captured);
+    else
+        keyboard_input_emu(down, scan, captured);
+}
+
+void
+keyboard_input_emu(int down, uint16_t scan, int captured)
 {
     /* Special case for E1 1D, translate it to 0100 - special case. */
     if ((scan >> 8) == 0xe1) {
@@ -326,7 +341,7 @@ keyboard_input(int down, uint16_t scan)
     /* kbc_at_log("Received scan code: %03X (%s)\n", scan & 0x1ff, down ? "down" : "up"); */
     recv_key_ui[scan & 0x1ff] = down;
 
-    if (mouse_capture || !kbd_req_capture || video_fullscreen) {
+    if (captured) {
         recv_key[scan & 0x1ff] = down;
         key_process(scan & 0x1ff, down);
     }
@@ -334,6 +349,15 @@ keyboard_input(int down, uint16_t scan)
 
 void
 keyboard_all_up(void)
+{
+    if (replay_mode != REPLAY_OFF)
+        replay_key(0, REPLAY_KEY_ALL_UP, 0);
+    else
+        keyboard_all_up_emu();
+}
+
+void
+keyboard_all_up_emu(void)
 {
     for (unsigned short i = 0; i < 0x200; i++) {
         if (recv_key_ui[i]) {
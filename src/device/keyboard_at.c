@@ -15,6 +15,7 @@
  *          Copyright 2017-2023 Fred N. van Kempen.
  */
 #include <stdarg.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdint.h>
 #include <string.h>
@@ -22,10 +23,12 @@
 #include <wchar.h>
 #define HAVE_STDARG_H
 #include <86box/86box.h>
+#include <86box/timer.h>
 #include <86box/device.h>
 #include <86box/keyboard.h>
 #include <86box/mouse.h>
 #include <86box/machine.h>
+#include <86box/snapshot.h>
 
 #define FLAG_PS2       0x08  /* dev is AT or PS/2 */
 #define FLAG_AT        0x00  /* dev is AT or PS/2 */
@@ -3790,6 +3793,40 @@ keyboard_at_close(void *priv)
     free(dev);
 }
 
+/* The scan code tables follow from the mode and the set 3 flags. */
+static void
+keyboard_at_save(void *priv, snapshot_t *s)
+{
+    atkbc_dev_t *dev = (atkbc_dev_t *) priv;
+
+    snapshot_write(s, &dev->type, offsetof(atkbc_dev_t, scan) - offsetof(atkbc_dev_t, type));
+    snapshot_write(s, &keyboard_mode, sizeof(keyboard_mode));
+    snapshot_write(s, &keyboard_scan, sizeof(keyboard_scan));
+    snapshot_write(s, &bat_counter, sizeof(bat_counter));
+    snapshot_write(s, keyboard_set3_flags, sizeof(keyboard_set3_flags));
+    snapshot_write(s, &keyboard_set3_all_repeat, sizeof(keyboard_set3_all_repeat));
+    snapshot_write(s, &keyboard_set3_all_break, sizeof(keyboard_set3_all_break));
+}
+
+static int
+keyboard_at_load(void *priv, snapshot_t *s)
+{
+    atkbc_dev_t *dev = (atkbc_dev_t *) priv;
+
+    if (!snapshot_read(s, &dev->type, offsetof(atkbc_dev_t, scan) - offsetof(atkbc_dev_t, type)) ||
+        !snapshot_read(s, &keyboard_mode, sizeof(keyboard_mode)) ||
+        !snapshot_read(s, &keyboard_scan, sizeof(keyboard_scan)) ||
+        !snapshot_read(s, &bat_counter, sizeof(bat_counter)) ||
+        !snapshot_read(s, keyboard_set3_flags, sizeof(keyboard_set3_flags)) ||
+        !snapshot_read(s, &keyboard_set3_all_repeat, sizeof(keyboard_set3_all_repeat)) ||
+        !snapshot_read(s, &keyboard_set3_all_break, sizeof(keyboard_set3_all_break)))
+        return 0;
+
+    keyboard_at_set_scancode_set();
+
+    return 1;
+}
+
 static const device_config_t keyboard_at_config[] = {
   // clang-format off
     {
@@ -3830,5 +3867,7 @@ const device_t keyboard_at_generic_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
+    .save          = keyboard_at_save,
+    .load          = keyboard_at_load,
     .config        = keyboard_at_config
 };
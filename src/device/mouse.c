@@ -35,6 +35,8 @@
 #include <86box/video.h>
 #include <86box/plat.h>
 #include <86box/plat_unused.h>
+#include <86box/perf.h>
+#include <86box/replay.h>
 
 typedef struct mouse_t {
     const device_t *device;
@@ -107,6 +109,20 @@ static _Atomic double  mouse_x;
 static _Atomic double  mouse_y;
 static atomic_int      mouse_z;
 static atomic_int      mouse_buttons;
+static atomic_int      mouse_pressed; /* Presses not reported yet. */
+
+/* While a replay is recorded or played back, the host's input collects
+   here, and the replay hands it to the emulated mouse between slices. */
+static _Atomic double  mouse_host_x;
+static _Atomic double  mouse_host_y;
+static atomic_int      mouse_host_z;
+static atomic_int      mouse_host_buttons;
+static atomic_int      mouse_host_pressed;
+static int             mouse_replay_buttons;
+static double          mouse_replay_x_abs;
+static double          mouse_replay_y_abs;
+
+#define MOUSE_HOST(var) ((replay_mode != REPLAY_OFF) ? &mouse_host_##var : &mouse_##var)
 
 static int             mouse_delta_b;
 static int             mouse_old_b;
@@ -162,6 +178,7 @@ void
 mouse_clear_buttons(void)
 {
     mouse_buttons  = 0x00;
+    mouse_pressed  = 0x00;
     mouse_old_b    = 0x00;
 
     mouse_delta_b  = 0x00;
@@ -199,10 +216,26 @@ mouse_scale_coord_y(double y, int mul)
     return y;
 }
 
+static void
+atomic_double_add(_Atomic double *var, double val)
+{
+    double temp = atomic_load(var);
+
+    while (!atomic_compare_exchange_weak(var, &temp, temp + val))
+        ;
+}
+
+/*
+ * The host side keeps adding to the coordinates from its own threads while
+ * a report is being put together, so what a report consumed is taken off
+ * the totals at the end, rather than storing back what was left of them.
+ * Motion that arrives in between is kept for the next report.
+ */
 void
 mouse_subtract_x(int *delta_x, int *o_x, int min, int max, int abs)
 {
-    double real_x = atomic_load(&mouse_x);
+    double start_x = atomic_load(&mouse_x);
+    double real_x  = start_x;
     double smax_x;
     double rsmin_x;
     double smin_x;
@@ -260,7 +293,7 @@ mouse_subtract_x(int *delta_x, int *o_x, int min, int max, int abs)
     if (abs)
         real_x -= rsmin_x;
 
-    atomic_store(&mouse_x, real_x);
+    atomic_double_add(&mouse_x, real_x - start_x);
 }
 
 /* It appears all host platforms give us y in the Microsoft format
@@ -269,7 +302,8 @@ mouse_subtract_x(int *delta_x, int *o_x, int min, int max, int abs)
 void
 mouse_subtract_y(int *delta_y, int *o_y, int min, int max, int invert, int abs)
 {
-    double real_y = atomic_load(&mouse_y);
+    double start_y = atomic_load(&mouse_y);
+    double real_y  = start_y;
     double smax_y;
     double rsmin_y;
     double smin_y;
@@ -333,7 +367,7 @@ mouse_subtract_y(int *delta_y, int *o_y, int min, int max, int invert, int abs)
     if (invert)
         real_y = -real_y;
 
-    atomic_store(&mouse_y, real_y);
+    atomic_double_add(&mouse_y, real_y - start_y);
 }
 
 /* It appears all host platforms give us y in the Microsoft format
@@ -375,7 +409,7 @@ mouse_state_changed(void)
     int wheel     = (mouse_nbut >= 4);
     int ret;
 
-    b = atomic_load(&mouse_buttons);
+    b = mouse_get_buttons_ex();
     mouse_delta_b = (b ^ mouse_old_b);
     mouse_old_b   = b;
 
@@ -406,38 +440,32 @@ mouse_timer_poll(UNUSED(void *priv))
 #endif
 }
 
-static void
-atomic_double_add(_Atomic double *var, double val)
-{
-    double temp = atomic_load(var);
-
-    temp += val;
-
-    atomic_store(var, temp);
-}
-
 void
 mouse_scale_fx(double x)
 {
-    atomic_double_add(&mouse_x, ((double) x) * mouse_sensitivity);
+    perf_input_event();
+    atomic_double_add(MOUSE_HOST(x), ((double) x) * mouse_sensitivity);
 }
 
 void
 mouse_scale_fy(double y)
 {
-    atomic_double_add(&mouse_y, ((double) y) * mouse_sensitivity);
+    perf_input_event();
+    atomic_double_add(MOUSE_HOST(y), ((double) y) * mouse_sensitivity);
 }
 
 void
 mouse_scale_x(int x)
 {
-    atomic_double_add(&mouse_x, ((double) x) * mouse_sensitivity);
+    perf_input_event();
+    atomic_double_add(MOUSE_HOST(x), ((double) x) * mouse_sensitivity);
 }
 
 void
 mouse_scale_y(int y)
 {
-    atomic_double_add(&mouse_y, ((double) y) * mouse_sensitivity);
+    perf_input_event();
+    atomic_double_add(MOUSE_HOST(y), ((double) y) * mouse_sensitivity);
 }
 
 void
@@ -466,7 +494,8 @@ mouse_scale_axis(int axis, int val)
 void
 mouse_set_z(int z)
 {
-    atomic_fetch_add(&mouse_z, z);
+    perf_input_event();
+    atomic_fetch_add(MOUSE_HOST(z), z);
 }
 
 void
@@ -492,19 +521,43 @@ mouse_subtract_z(int *delta_z, int min, int max, int invert)
         real_z = 0;
     }
 
-    atomic_store(&mouse_z, invert ? -real_z : real_z);
+    atomic_fetch_add(&mouse_z, (invert ? -real_z : real_z) - z);
 }
 
+/*
+ * Presses are latched until the emulated device has sent a report, so a
+ * click that is over before the next report is still seen by the guest, as
+ * a press followed by a release in the report after.
+ */
 void
 mouse_set_buttons_ex(int b)
 {
-    atomic_store(&mouse_buttons, b);
+    int old = atomic_exchange(MOUSE_HOST(buttons), b);
+
+    perf_input_event();
+    atomic_fetch_or(MOUSE_HOST(pressed), b & ~old);
+}
+
+/* For the host side, safe against other host threads changing other buttons. */
+void
+mouse_press_buttons(int mask)
+{
+    int old = atomic_fetch_or(MOUSE_HOST(buttons), mask);
+
+    perf_input_event();
+    atomic_fetch_or(MOUSE_HOST(pressed), mask & ~old);
+}
+
+void
+mouse_release_buttons(int mask)
+{
+    atomic_fetch_and(MOUSE_HOST(buttons), ~mask);
 }
 
 int
 mouse_get_buttons_ex(void)
 {
-    return atomic_load(&mouse_buttons);
+    return atomic_load(&mouse_buttons) | atomic_load(&mouse_pressed);
 }
 
 void
@@ -529,17 +582,65 @@ mouse_set_buttons(int buttons)
 void
 mouse_get_abs_coords(double *x_abs, double *y_abs)
 {
-    *x_abs = mouse_x_abs;
-    *y_abs = mouse_y_abs;
+    if (replay_mode != REPLAY_OFF) {
+        *x_abs = mouse_replay_x_abs;
+        *y_abs = mouse_replay_y_abs;
+    } else {
+        *x_abs = mouse_x_abs;
+        *y_abs = mouse_y_abs;
+    }
+}
+
+/* Takes what the host did to the mouse since the last slice. */
+void
+mouse_replay_take(mouse_replay_t *ev)
+{
+    memset(ev, 0x00, sizeof(mouse_replay_t));
+
+    ev->x       = atomic_exchange(&mouse_host_x, 0.0);
+    ev->y       = atomic_exchange(&mouse_host_y, 0.0);
+    ev->z       = atomic_exchange(&mouse_host_z, 0);
+    ev->buttons = atomic_load(&mouse_host_buttons);
+    ev->pressed = atomic_exchange(&mouse_host_pressed, 0);
+    ev->x_abs   = mouse_x_abs;
+    ev->y_abs   = mouse_y_abs;
+}
+
+void
+mouse_replay_apply(const mouse_replay_t *ev)
+{
+    if ((ev->x != 0.0) || (ev->y != 0.0)) {
+        atomic_double_add(&mouse_x, ev->x);
+        atomic_double_add(&mouse_y, ev->y);
+    }
+    if (ev->z)
+        atomic_fetch_add(&mouse_z, ev->z);
+
+    /* Like the host would, only changes are passed on. */
+    if (ev->buttons != mouse_replay_buttons) {
+        atomic_store(&mouse_buttons, ev->buttons);
+        mouse_replay_buttons = ev->buttons;
+    }
+    if (ev->pressed)
+        atomic_fetch_or(&mouse_pressed, ev->pressed);
+
+    mouse_replay_x_abs = ev->x_abs;
+    mouse_replay_y_abs = ev->y_abs;
 }
 
 void
 mouse_process(void)
 {
+    int pressed = atomic_load(&mouse_pressed);
+
     if ((mouse_input_mode >= 1) && mouse_poll_ex)
         mouse_poll_ex();
     else if ((mouse_input_mode == 0) && (mouse_dev_poll != NULL))
         mouse_dev_poll(mouse_priv);
+
+    /* The device had its chance to report the latched presses. */
+    if (pressed)
+        atomic_fetch_and(&mouse_pressed, ~pressed);
 }
 
 void
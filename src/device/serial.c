@@ -19,6 +19,7 @@
  *          Copyright 2017-2020 Fred N. van Kempen.
  */
 #include <stdarg.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
@@ -37,6 +38,7 @@
 #include <86box/fifo.h>
 #include <86box/serial.h>
 #include <86box/mouse.h>
+#include <86box/snapshot.h>
 
 serial_port_t com_ports[SERIAL_MAX];
 
@@ -91,6 +93,7 @@ serial_reset_port(serial_t *dev)
     dev->fifo_enabled                         = 0;
     dev->baud_cycles                          = 0;
     dev->out_new                              = 0xffff;
+    dev->rx_burst_pos = dev->rx_burst_len     = 0;
 
     dev->txsr_empty = 1;
     dev->thr_empty  = 1;
@@ -155,6 +158,16 @@ serial_clear_timeout(serial_t *dev)
     serial_update_ints(dev);
 }
 
+/* Load the next byte of a pending burst into the RSR. */
+static void
+serial_next_burst(serial_t *dev)
+{
+    if (dev->rx_burst_pos < dev->rx_burst_len)
+        dev->out_new = dev->rx_burst[dev->rx_burst_pos++];
+    else
+        dev->rx_burst_pos = dev->rx_burst_len = 0;
+}
+
 static void
 serial_receive_timer(void *priv)
 {
@@ -174,6 +187,7 @@ serial_receive_timer(void *priv)
 
             fifo_write_evt((uint8_t) (dev->out_new & 0xff), dev->rcvr_fifo);
             dev->out_new = 0xffff;
+            serial_next_burst(dev);
 
 #if 0
             pclog("serial_receive_timer(): lsr = %02X, ier = %02X, iir = %02X, int_status = %02X\n",
@@ -194,6 +208,7 @@ serial_receive_timer(void *priv)
 
             dev->dat = (uint8_t) (dev->out_new & 0xff);
             dev->out_new = 0xffff;
+            serial_next_burst(dev);
 
             /* Raise Data Ready interrupt. */
             dev->lsr |= 0x01;
@@ -230,6 +245,50 @@ serial_write_fifo(serial_t *dev, uint8_t dat)
         write_fifo(dev, dat);
 }
 
+/* How many bytes serial_write_fifo_block() would take right now: whatever
+   still fits in the receive FIFO, or a single byte in non-FIFO mode once
+   the guest has read the previous one. */
+int
+serial_rx_space(serial_t *dev)
+{
+    int space;
+
+    if ((dev == NULL) || (dev->mctrl & 0x10) || (dev->out_new != 0xffff))
+        return 0;
+
+    if ((dev->type >= SERIAL_16550) && dev->fifo_enabled) {
+        space = SERIAL_FIFO_SIZE - fifo_get_count(dev->rcvr_fifo);
+        return (space > 0) ? space : 0;
+    }
+
+    return !(dev->lsr & 0x01);
+}
+
+/* Hand a burst of received bytes to the port in one call. The receiver
+   still takes them in at one per character time, so the guest sees the
+   same pacing as with serial_write_fifo(). Returns the number of bytes
+   taken, the caller keeps the rest for later. */
+int
+serial_write_fifo_block(serial_t *dev, const uint8_t *buf, int len)
+{
+    int n = serial_rx_space(dev);
+
+    if (len < n)
+        n = len;
+    if (n <= 0)
+        return 0;
+
+    serial_log("serial_write_fifo_block(%08X, %i)\n", dev, n);
+
+    write_fifo(dev, buf[0]);
+    if (n > 1)
+        memcpy(dev->rx_burst, &buf[1], n - 1);
+    dev->rx_burst_pos = 0;
+    dev->rx_burst_len = n - 1;
+
+    return n;
+}
+
 void
 serial_transmit(serial_t *dev, uint8_t val)
 {
@@ -536,9 +595,11 @@ serial_write(uint16_t addr, uint8_t val, void *priv)
                 if (!dev->fifo_enabled) {
                     fifo_reset(dev->xmit_fifo);
                     fifo_reset(dev->rcvr_fifo);
+                    dev->rx_burst_pos = dev->rx_burst_len = 0;
                     break;
                 }
                 if (val & 0x02) {
+                    dev->rx_burst_pos = dev->rx_burst_len = 0;
                     if (dev->fifo_enabled)
                         fifo_reset_evt(dev->rcvr_fifo);
                     else
@@ -926,6 +987,72 @@ serial_reset(void *priv)
     }
 }
 
+/* Whatever is attached to the port keeps its own state; only the UART side is
+   taken here. */
+static void
+serial_save_fifo(snapshot_t *s, fifo64_t *fifo)
+{
+    snapshot_write(s, fifo, offsetof(fifo64_t, priv));
+    snapshot_write(s, fifo->tag, sizeof(fifo->tag));
+    snapshot_write(s, fifo->buf, sizeof(fifo->buf));
+}
+
+static int
+serial_load_fifo(snapshot_t *s, fifo64_t *fifo)
+{
+    return snapshot_read(s, fifo, offsetof(fifo64_t, priv)) &&
+           snapshot_read(s, fifo->tag, sizeof(fifo->tag)) &&
+           snapshot_read(s, fifo->buf, sizeof(fifo->buf));
+}
+
+static void
+serial_save(void *priv, snapshot_t *s)
+{
+    serial_t *dev = (serial_t *) priv;
+
+    if (!com_ports[dev->inst].enabled)
+        return;
+
+    snapshot_write(s, dev, offsetof(serial_t, rcvr_fifo));
+    serial_save_fifo(s, (fifo64_t *) dev->rcvr_fifo);
+    serial_save_fifo(s, (fifo64_t *) dev->xmit_fifo);
+    snapshot_write_timer(s, &dev->transmit_timer);
+    snapshot_write_timer(s, &dev->timeout_timer);
+    snapshot_write_timer(s, &dev->receive_timer);
+    snapshot_write(s, &dev->clock_src, sizeof(dev->clock_src));
+    snapshot_write(s, &dev->transmit_period, sizeof(dev->transmit_period));
+}
+
+static int
+serial_load(void *priv, snapshot_t *s)
+{
+    serial_t *dev  = (serial_t *) priv;
+    uint16_t  addr = dev->base_address;
+
+    if (!com_ports[dev->inst].enabled)
+        return 1;
+
+    if (!snapshot_read(s, dev, offsetof(serial_t, rcvr_fifo)) ||
+        !serial_load_fifo(s, (fifo64_t *) dev->rcvr_fifo) ||
+        !serial_load_fifo(s, (fifo64_t *) dev->xmit_fifo) ||
+        !snapshot_read_timer(s, &dev->transmit_timer) ||
+        !snapshot_read_timer(s, &dev->timeout_timer) ||
+        !snapshot_read_timer(s, &dev->receive_timer) ||
+        !snapshot_read(s, &dev->clock_src, sizeof(dev->clock_src)) ||
+        !snapshot_read(s, &dev->transmit_period, sizeof(dev->transmit_period)))
+        return 0;
+
+    /* The I/O handler is still where the reset put it. */
+    if (dev->base_address != addr) {
+        uint16_t new_addr = dev->base_address;
+
+        dev->base_address = addr;
+        serial_setup(dev, new_addr, dev->irq);
+    }
+
+    return 1;
+}
+
 static void *
 serial_init(const device_t *info)
 {
@@ -1013,6 +1140,8 @@ const device_t ns8250_device = {
     .available     = NULL,
     .speed_changed = serial_speed_changed,
     .force_redraw  = NULL,
+    .save          = serial_save,
+    .load          = serial_load,
     .config        = NULL
 };
 
@@ -1027,6 +1156,8 @@ const device_t ns8250_pcjr_device = {
     .available     = NULL,
     .speed_changed = serial_speed_changed,
     .force_redraw  = NULL,
+    .save          = serial_save,
+    .load          = serial_load,
     .config        = NULL
 };
 
@@ -1041,6 +1172,8 @@ const device_t ns16450_device = {
     .available     = NULL,
     .speed_changed = serial_speed_changed,
     .force_redraw  = NULL,
+    .save          = serial_save,
+    .load          = serial_load,
     .config        = NULL
 };
 
@@ -1055,6 +1188,8 @@ const device_t ns16550_device = {
     .available     = NULL,
     .speed_changed = serial_speed_changed,
     .force_redraw  = NULL,
+    .save          = serial_save,
+    .load          = serial_load,
     .config        = NULL
 };
 
@@ -1069,6 +1204,8 @@ const device_t ns16650_device = {
     .available     = NULL,
     .speed_changed = serial_speed_changed,
     .force_redraw  = NULL,
+    .save          = serial_save,
+    .load          = serial_load,
     .config        = NULL
 };
 
@@ -1083,6 +1220,8 @@ const device_t ns16750_device = {
     .available     = NULL,
     .speed_changed = serial_speed_changed,
     .force_redraw  = NULL,
+    .save          = serial_save,
+    .load          = serial_load,
     .config        = NULL
 };
 
@@ -1097,6 +1236,8 @@ const device_t ns16850_device = {
     .available     = NULL,
     .speed_changed = serial_speed_changed,
     .force_redraw  = NULL,
+    .save          = serial_save,
+    .load          = serial_load,
     .config        = NULL
 };
 
@@ -1111,5 +1252,7 @@ const device_t ns16950_device = {
     .available     = NULL,
     .speed_changed = serial_speed_changed,
     .force_redraw  = NULL,
+    .save          = serial_save,
+    .load          = serial_load,
     .config        = NULL
 };
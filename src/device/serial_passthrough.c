@@ -51,6 +51,10 @@ serial_passthrough_log(const char *fmt, ...)
 #    define serial_passthrough_log(fmt, ...)
 #endif
 
+/* Guest output is collected and written to the host at most this long
+   after the first byte, or as soon as the buffer fills up. */
+#define SERPT_TX_FLUSH_US 1000.0
+
 void
 serial_passthrough_init(void)
 {
@@ -62,45 +66,74 @@ serial_passthrough_init(void)
     }
 }
 
+/* Time it takes to move one character at the current settings. */
+static double
+serial_passthrough_char_us(const serial_passthrough_t *dev)
+{
+    return (1000000.0 / dev->baudrate) * (double) dev->bits;
+}
+
 static void
-serial_passthrough_write(UNUSED(serial_t *s), void *priv, uint8_t val)
+serial_passthrough_flush(serial_passthrough_t *dev)
 {
-    plat_serpt_write(priv, val);
+    timer_disable(&dev->serial_to_host_timer);
+
+    if (dev->tx_len) {
+        plat_serpt_write(dev, dev->tx_buf, dev->tx_len);
+        dev->tx_len = 0;
+    }
 }
 
 static void
-host_to_serial_cb(void *priv)
+serial_to_host_cb(void *priv)
+{
+    serial_passthrough_flush((serial_passthrough_t *) priv);
+}
+
+static void
+serial_passthrough_write(UNUSED(serial_t *s), void *priv, uint8_t val)
 {
     serial_passthrough_t *dev = (serial_passthrough_t *) priv;
 
-    uint8_t byte;
+    dev->tx_buf[dev->tx_len++] = val;
 
-    /* write_fifo has no failure indication, but if we write to fast, the host
-     * can never fetch the bytes in time, so check if the fifo is full if in
-     * fifo mode or if lsr has bit 0 set if not in fifo mode */
-    if ((dev->serial->type >= SERIAL_16550) && dev->serial->fifo_enabled) {
-        if (fifo_get_full(dev->serial->rcvr_fifo)) {
-            goto no_write_to_machine;
-        }
-    } else {
-        if (dev->serial->lsr & 1) {
-            goto no_write_to_machine;
-        }
+    if (dev->tx_len == SERPT_BUF_SIZE)
+        serial_passthrough_flush(dev);
+    else if (!timer_is_enabled(&dev->serial_to_host_timer))
+        timer_on_auto(&dev->serial_to_host_timer, SERPT_TX_FLUSH_US);
+}
+
+static void
+host_to_serial_cb(void *priv)
+{
+    serial_passthrough_t *dev     = (serial_passthrough_t *) priv;
+    double                char_us = serial_passthrough_char_us(dev);
+    double                next_us = char_us;
+    int                   taken;
+
+    /* Refill from the host a block at a time, rather than a syscall per
+       character time. */
+    if (dev->rx_pos == dev->rx_len) {
+        dev->rx_pos = 0;
+        dev->rx_len = plat_serpt_read(dev, dev->rx_buf, SERPT_BUF_SIZE);
     }
-    if (plat_serpt_read(dev, &byte)) {
-#if 0
-        printf("got byte %02X\n", byte);
-#endif
-        serial_write_fifo(dev->serial, byte);
-#if 0
-        serial_set_dsr(dev->serial, 1);
-#endif
+
+    if (dev->rx_pos == dev->rx_len) {
+        /* Nothing pending, the host buffers anything arriving meanwhile and
+           it is handed over as a burst on the next poll. */
+        next_us = MIN(SERIAL_FIFO_SIZE * char_us, MAX(char_us, SERPT_TX_FLUSH_US));
+    } else {
+        /* Give the port as much as its receive FIFO can take, it clocks the
+           bytes in at the baud rate by itself. Once the burst is through,
+           come back for more; if the guest has not made any room yet, check
+           again in a character time. */
+        taken = serial_write_fifo_block(dev->serial, &dev->rx_buf[dev->rx_pos], dev->rx_len - dev->rx_pos);
+        dev->rx_pos += taken;
+        if (taken > 1)
+            next_us = taken * char_us;
     }
-no_write_to_machine:
-#if 0
-    serial_device_timeout(dev->serial);
-#endif
-    timer_on_auto(&dev->host_to_serial_timer, (1000000.0 / dev->baudrate) * (double) dev->bits);
+
+    timer_on_auto(&dev->host_to_serial_timer, next_us);
 }
 
 static void
@@ -110,7 +143,7 @@ serial_passthrough_rcr_cb(UNUSED(struct serial_s *serial), void *priv)
 
     timer_stop(&dev->host_to_serial_timer);
     /* FIXME: do something to dev->baudrate */
-    timer_on_auto(&dev->host_to_serial_timer, (1000000.0 / dev->baudrate) * (double) dev->bits);
+    timer_on_auto(&dev->host_to_serial_timer, serial_passthrough_char_us(dev));
 #if 0
     serial_clear_fifo(dev->serial);
 #endif
@@ -125,7 +158,7 @@ serial_passthrough_speed_changed(void *priv)
 
     timer_stop(&dev->host_to_serial_timer);
     /* FIXME: do something to dev->baudrate */
-    timer_on_auto(&dev->host_to_serial_timer, (1000000.0 / dev->baudrate) * (double) dev->bits);
+    timer_on_auto(&dev->host_to_serial_timer, serial_passthrough_char_us(dev));
 #if 0
     serial_clear_fifo(dev->serial);
 #endif
@@ -142,6 +175,7 @@ serial_passthrough_dev_close(void *priv)
     if (dev->serial && dev->serial->sd)
         memset(dev->serial->sd, 0, sizeof(serial_device_t));
 
+    serial_passthrough_flush(dev);
     plat_serpt_close(dev);
     free(dev);
 }
@@ -210,6 +244,8 @@ serial_passthrough_dev_init(const device_t *info)
 
     memset(&dev->host_to_serial_timer, 0, sizeof(pc_timer_t));
     timer_add(&dev->host_to_serial_timer, host_to_serial_cb, dev, 1);
+    memset(&dev->serial_to_host_timer, 0, sizeof(pc_timer_t));
+    timer_add(&dev->serial_to_host_timer, serial_to_host_cb, dev, 0);
     serial_set_cts(dev->serial, 1);
     serial_set_dsr(dev->serial, 1);
     serial_set_dcd(dev->serial, 1);
@@ -0,0 +1,454 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Read support for chunked compressed images.
+ *
+ *          Decompressed chunks are kept in a small LRU cache. Once the
+ *          reads turn sequential, the chunks that follow are queued to
+ *          a few worker threads, so they are usually ready by the time
+ *          the guest gets to them.
+ */
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <wchar.h>
+#include <zlib.h>
+#define HAVE_STDARG_H
+#include <86box/86box.h>
+#include <86box/plat.h>
+#include <86box/thread.h>
+#include <86box/cmp_image.h>
+
+#define CMP_IMAGE_SLOTS   16 /* Decompressed chunks kept around. */
+#define CMP_IMAGE_THREADS 2
+#define CMP_IMAGE_AHEAD   4  /* Chunks decompressed ahead of a sequential read. */
+
+enum {
+    CMP_SLOT_FREE = 0,
+    CMP_SLOT_QUEUED, /* Waiting for a worker. */
+    CMP_SLOT_BUSY,   /* Being decompressed, must not be touched. */
+    CMP_SLOT_READY
+};
+
+typedef struct cmp_slot_t {
+    uint32_t chunk;
+    int      state;
+    uint32_t used;
+    uint8_t *data;
+} cmp_slot_t;
+
+typedef struct cmp_worker_t {
+    cmp_image_t *img;
+    thread_t    *thread;
+    event_t     *wake;
+    uint8_t     *cbuf;
+} cmp_worker_t;
+
+struct cmp_image_t {
+    FILE               *fp;
+    mutex_t            *file_lock;
+    cmp_image_header_t  hdr;
+    cmp_image_entry_t  *index;
+
+    /* Everything below is protected by lock. */
+    mutex_t   *lock;
+    event_t   *done;
+    int        run;
+    uint32_t   tick;
+    uint32_t   next_chunk; /* Where a sequential read would continue. */
+    cmp_slot_t slots[CMP_IMAGE_SLOTS];
+
+    uint8_t     *cbuf; /* For chunks decompressed by the reading thread. */
+    cmp_worker_t workers[CMP_IMAGE_THREADS];
+};
+
+#ifdef ENABLE_CMP_IMAGE_LOG
+int cmp_image_do_log = ENABLE_CMP_IMAGE_LOG;
+
+static void
+cmp_image_log(const char *fmt, ...)
+{
+    va_list ap;
+
+    if (cmp_image_do_log) {
+        va_start(ap, fmt);
+        pclog_ex(fmt, ap);
+        va_end(ap);
+    }
+}
+#else
+#    define cmp_image_log(fmt, ...)
+#endif
+
+static uint32_t
+cmp_image_chunk_length(const cmp_image_t *img, uint32_t chunk)
+{
+    uint64_t start = (uint64_t) chunk * img->hdr.chunk_size;
+
+    return (uint32_t) MIN((uint64_t) img->hdr.chunk_size, img->hdr.size - start);
+}
+
+/* Called without the lock held, the slot is owned by the caller. */
+static int
+cmp_image_decode(cmp_image_t *img, uint32_t chunk, uint8_t *cbuf, uint8_t *dst)
+{
+    const cmp_image_entry_t *e   = &img->index[chunk];
+    uint32_t                 len = cmp_image_chunk_length(img, chunk);
+    uLongf                   out = len;
+    int                      ret = 0;
+
+    if (e->length == 0) {
+        memset(dst, 0x00, len);
+        return 0;
+    }
+
+    thread_wait_mutex(img->file_lock);
+    if ((fseeko64(img->fp, e->offset, SEEK_SET) == -1) ||
+        (fread((e->length == len) ? dst : cbuf, 1, e->length, img->fp) != e->length))
+        ret = -1;
+    thread_release_mutex(img->file_lock);
+
+    if ((ret == 0) && (e->length != len) &&
+        ((uncompress(dst, &out, cbuf, e->length) != Z_OK) || (out != len)))
+        ret = -1;
+
+    if (ret < 0)
+        cmp_image_log("Compressed image: Error reading chunk %i\n", chunk);
+
+    return ret;
+}
+
+static cmp_slot_t *
+cmp_image_find(cmp_image_t *img, uint32_t chunk)
+{
+    for (int i = 0; i < CMP_IMAGE_SLOTS; i++) {
+        if ((img->slots[i].state != CMP_SLOT_FREE) && (img->slots[i].chunk == chunk))
+            return &img->slots[i];
+    }
+
+    return NULL;
+}
+
+/* Picks a free slot, or the least recently used chunk that is ready. */
+static cmp_slot_t *
+cmp_image_victim(cmp_image_t *img)
+{
+    cmp_slot_t *victim = NULL;
+
+    for (int i = 0; i < CMP_IMAGE_SLOTS; i++) {
+        cmp_slot_t *slot = &img->slots[i];
+
+        if (slot->state == CMP_SLOT_FREE)
+            return slot;
+        if ((slot->state == CMP_SLOT_READY) && ((victim == NULL) || ((int32_t) (slot->used - victim->used) < 0)))
+            victim = slot;
+    }
+
+    return victim;
+}
+
+static void
+cmp_image_thread(void *priv)
+{
+    cmp_worker_t *w   = (cmp_worker_t *) priv;
+    cmp_image_t  *img = w->img;
+
+    while (1) {
+        thread_wait_event(w->wake, -1);
+        thread_reset_event(w->wake);
+
+        while (1) {
+            cmp_slot_t *slot = NULL;
+            int         ret;
+
+            thread_wait_mutex(img->lock);
+            if (!img->run) {
+                thread_release_mutex(img->lock);
+                return;
+            }
+            for (int i = 0; i < CMP_IMAGE_SLOTS; i++) {
+                if ((img->slots[i].state == CMP_SLOT_QUEUED) &&
+                    ((slot == NULL) || (img->slots[i].chunk < slot->chunk)))
+                    slot = &img->slots[i];
+            }
+            if (slot != NULL)
+                slot->state = CMP_SLOT_BUSY;
+            thread_release_mutex(img->lock);
+
+            if (slot == NULL)
+                break;
+
+            ret = cmp_image_decode(img, slot->chunk, w->cbuf, slot->data);
+
+            thread_wait_mutex(img->lock);
+            slot->state = (ret < 0) ? CMP_SLOT_FREE : CMP_SLOT_READY;
+            slot->used  = img->tick;
+            thread_release_mutex(img->lock);
+
+            thread_set_event(img->done);
+        }
+    }
+}
+
+static void
+cmp_image_wake(cmp_image_t *img)
+{
+    for (int i = 0; i < CMP_IMAGE_THREADS; i++)
+        thread_set_event(img->workers[i].wake);
+}
+
+/* Queues the chunks after a sequential read, called with the lock held. */
+static void
+cmp_image_read_ahead(cmp_image_t *img, uint32_t chunk)
+{
+    int queued   = 0;
+    int inflight = 0;
+
+    for (int i = 0; i < CMP_IMAGE_SLOTS; i++)
+        inflight += (img->slots[i].state == CMP_SLOT_QUEUED) || (img->slots[i].state == CMP_SLOT_BUSY);
+
+    /* Never let the queue take over the slots the reader needs. */
+    for (uint32_t c = chunk + 1; (c <= (chunk + CMP_IMAGE_AHEAD)) && (c < img->hdr.chunks) &&
+                                 (inflight < (CMP_IMAGE_AHEAD + CMP_IMAGE_THREADS)); c++) {
+        cmp_slot_t *slot;
+
+        if (cmp_image_find(img, c) != NULL)
+            continue;
+
+        slot = cmp_image_victim(img);
+        if (slot == NULL)
+            break;
+
+        slot->chunk = c;
+        slot->state = CMP_SLOT_QUEUED;
+        slot->used  = img->tick;
+        queued      = 1;
+        inflight++;
+    }
+
+    if (queued)
+        cmp_image_wake(img);
+}
+
+/* Copies part of a chunk, decompressing it first if it is not cached. */
+static int
+cmp_image_read_chunk(cmp_image_t *img, uint32_t chunk, uint32_t off, uint32_t n, uint8_t *buffer)
+{
+    cmp_slot_t *slot;
+    int         seq;
+    int         ret;
+
+    thread_wait_mutex(img->lock);
+
+    while (1) {
+        slot = cmp_image_find(img, chunk);
+
+        if ((slot == NULL) || (slot->state != CMP_SLOT_BUSY))
+            break;
+
+        /* A worker is on it, wait for it to finish. */
+        thread_reset_event(img->done);
+        thread_release_mutex(img->lock);
+        thread_wait_event(img->done, -1);
+        thread_wait_mutex(img->lock);
+    }
+
+    img->tick++;
+    seq             = (chunk == img->next_chunk);
+    img->next_chunk = chunk + 1;
+
+    if ((slot != NULL) && (slot->state == CMP_SLOT_READY)) {
+        slot->used = img->tick;
+        memcpy(buffer, slot->data + off, n);
+        if (seq)
+            cmp_image_read_ahead(img, chunk);
+        thread_release_mutex(img->lock);
+        return 0;
+    }
+
+    /* Either not cached at all or still queued, in which case we take it over. */
+    if (slot == NULL) {
+        slot = cmp_image_victim(img);
+        if (slot == NULL) {
+            /* Cannot happen as long as there are more slots than chunks in flight. */
+            thread_release_mutex(img->lock);
+            return -1;
+        }
+        slot->chunk = chunk;
+    }
+    slot->state = CMP_SLOT_BUSY;
+    if (seq)
+        cmp_image_read_ahead(img, chunk);
+    thread_release_mutex(img->lock);
+
+    ret = cmp_image_decode(img, chunk, img->cbuf, slot->data);
+    if (ret == 0)
+        memcpy(buffer, slot->data + off, n);
+
+    thread_wait_mutex(img->lock);
+    slot->state = (ret < 0) ? CMP_SLOT_FREE : CMP_SLOT_READY;
+    slot->used  = img->tick;
+    thread_release_mutex(img->lock);
+
+    return ret;
+}
+
+int
+cmp_image_is_cmp(const char *fn)
+{
+    FILE *fp = plat_fopen(fn, "rb");
+    char  magic[8];
+    int   ret;
+
+    if (fp == NULL)
+        return 0;
+
+    ret = (fread(magic, 1, sizeof(magic), fp) == sizeof(magic)) && !memcmp(magic, CMP_IMAGE_MAGIC, sizeof(magic));
+    fclose(fp);
+
+    return ret;
+}
+
+cmp_image_t *
+cmp_image_open(const char *fn)
+{
+    cmp_image_t *img = (cmp_image_t *) calloc(1, sizeof(cmp_image_t));
+    uint64_t     chunks;
+
+    if (img == NULL)
+        return NULL;
+
+    img->fp = plat_fopen(fn, "rb");
+    if ((img->fp == NULL) || (fread(&img->hdr, 1, sizeof(img->hdr), img->fp) != sizeof(img->hdr)))
+        goto fail;
+
+    chunks = (img->hdr.size + img->hdr.chunk_size - 1) / MAX(img->hdr.chunk_size, 1);
+    if (memcmp(img->hdr.magic, CMP_IMAGE_MAGIC, sizeof(img->hdr.magic)) || (img->hdr.version != CMP_IMAGE_VERSION) ||
+        (img->hdr.chunk_size < 4096) || (img->hdr.chunk_size > (1 << 20)) ||
+        (img->hdr.chunk_size & (img->hdr.chunk_size - 1)) || (chunks != img->hdr.chunks)) {
+        cmp_image_log("Compressed image: '%s' has an invalid header\n", fn);
+        goto fail;
+    }
+
+    img->index = (cmp_image_entry_t *) calloc(MAX(img->hdr.chunks, 1), sizeof(cmp_image_entry_t));
+    if ((img->index == NULL) || (fseeko64(img->fp, img->hdr.index_offset, SEEK_SET) == -1) ||
+        (fread(img->index, sizeof(cmp_image_entry_t), img->hdr.chunks, img->fp) != img->hdr.chunks))
+        goto fail;
+
+    for (uint32_t i = 0; i < img->hdr.chunks; i++) {
+        /* A zlib stream that does not shrink the chunk is stored as is. */
+        if (img->index[i].length > cmp_image_chunk_length(img, i)) {
+            cmp_image_log("Compressed image: '%s' has an invalid chunk index\n", fn);
+            goto fail;
+        }
+    }
+
+    for (int i = 0; i < CMP_IMAGE_SLOTS; i++) {
+        img->slots[i].data = (uint8_t *) malloc(img->hdr.chunk_size);
+        if (img->slots[i].data == NULL)
+            goto fail;
+    }
+
+    img->cbuf = (uint8_t *) malloc(img->hdr.chunk_size);
+    if (img->cbuf == NULL)
+        goto fail;
+    for (int i = 0; i < CMP_IMAGE_THREADS; i++) {
+        img->workers[i].img  = img;
+        img->workers[i].cbuf = (uint8_t *) malloc(img->hdr.chunk_size);
+        if (img->workers[i].cbuf == NULL)
+            goto fail;
+    }
+
+    img->file_lock  = thread_create_mutex();
+    img->lock       = thread_create_mutex();
+    img->done       = thread_create_event();
+    img->next_chunk = 0xffffffff;
+    img->run        = 1;
+    for (int i = 0; i < CMP_IMAGE_THREADS; i++) {
+        img->workers[i].wake   = thread_create_event();
+        img->workers[i].thread = thread_create_named(cmp_image_thread, &img->workers[i], "Image decompression", THREAD_ROLE_NONE);
+    }
+
+    cmp_image_log("Compressed image: '%s', %" PRIu64 " bytes in %i chunks of %i bytes\n",
+                  fn, img->hdr.size, img->hdr.chunks, img->hdr.chunk_size);
+
+    return img;
+
+fail:
+    cmp_image_close(img);
+    return NULL;
+}
+
+void
+cmp_image_close(cmp_image_t *img)
+{
+    if (img == NULL)
+        return;
+
+    if (img->lock != NULL) {
+        thread_wait_mutex(img->lock);
+        img->run = 0;
+        thread_release_mutex(img->lock);
+        cmp_image_wake(img);
+
+        for (int i = 0; i < CMP_IMAGE_THREADS; i++) {
+            thread_wait(img->workers[i].thread);
+            thread_destroy_event(img->workers[i].wake);
+        }
+
+        thread_destroy_event(img->done);
+        thread_close_mutex(img->lock);
+        thread_close_mutex(img->file_lock);
+    }
+
+    for (int i = 0; i < CMP_IMAGE_THREADS; i++)
+        free(img->workers[i].cbuf);
+    for (int i = 0; i < CMP_IMAGE_SLOTS; i++)
+        free(img->slots[i].data);
+    free(img->cbuf);
+    free(img->index);
+
+    if (img->fp != NULL)
+        fclose(img->fp);
+
+    free(img);
+}
+
+const cmp_image_header_t *
+cmp_image_get_header(const cmp_image_t *img)
+{
+    return &img->hdr;
+}
+
+/* Anything past the end of the image reads as zeroes. */
+int
+cmp_image_read(cmp_image_t *img, uint8_t *buffer, uint64_t offset, size_t count)
+{
+    while (count) {
+        uint32_t chunk = (uint32_t) (offset / img->hdr.chunk_size);
+        uint32_t off   = (uint32_t) (offset % img->hdr.chunk_size);
+        uint32_t n     = (uint32_t) MIN((uint64_t) count, (uint64_t) (img->hdr.chunk_size - off));
+
+        if (offset >= img->hdr.size)
+            memset(buffer, 0x00, n);
+        else {
+            n = MIN(n, cmp_image_chunk_length(img, chunk) - off);
+            if (cmp_image_read_chunk(img, chunk, off, n, buffer) < 0)
+                return -1;
+        }
+
+        buffer += n;
+        offset += n;
+        count -= n;
+    }
+
+    return 0;
+}
@@ -19,6 +19,7 @@
  */
 #include <stdarg.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
@@ -48,6 +49,7 @@
 #include <86box/hdd.h>
 #include <86box/zip.h>
 #include <86box/version.h>
+#include <86box/snapshot.h>
 
 /* Bits of 'atastat' */
 #define ERR_STAT     0x01 /* Error */
@@ -72,6 +74,7 @@
 
 /* ATA Commands */
 #define WIN_NOP                        0x00
+#define WIN_DSM                        0x06 /* Data Set Management (TRIM) */
 #define WIN_SRST                       0x08 /* ATAPI Device Reset */
 #define WIN_RECAL                      0x10
 #define WIN_READ                       0x20 /* 28-Bit Read */
@@ -98,6 +101,7 @@
 #define WIN_SETIDLE1                   0xe3
 #define WIN_CHECKPOWERMODE1            0xe5
 #define WIN_SLEEP1                     0xe6
+#define WIN_FLUSH_CACHE                0xe7
 #define WIN_IDENTIFY                   0xec /* Ask drive to identify itself */
 #define WIN_SET_FEATURES               0xef
 #define WIN_READ_NATIVE_MAX            0xf8
@@ -251,7 +255,7 @@ ide_log(const char *fmt, ...)
 
     if (ide_do_log) {
         va_start(ap, fmt);
-        pclog_ex(fmt, ap);
+        pclog_fast_ex(fmt, ap);
         va_end(ap);
     }
 }
@@ -279,6 +283,10 @@ ide_get_xfer_time(ide_t *ide, int size)
 {
     double period = (10.0 / 3.0);
 
+    /* Instant storage, the data is there as soon as it is asked for. */
+    if ((ide->type == IDE_HDD) && hdd[ide->hdd_num].instant)
+        return 0.0;
+
     /* We assume that 1 MB = 1000000 B in this case, so we have as
        many B/us as there are MB/s because 1 s = 1000000 us. */
     switch (ide->mdma_mode & 0x300) {
@@ -511,6 +519,19 @@ ide_get_timings(const ide_t *ide, const int type)
 /**
  * Fill in ide->buffer with the output of the "IDENTIFY DEVICE" command
  */
+/* Maximum number of 512-byte blocks of ranges in one DSM command. */
+#define IDE_DSM_MAX_BLOCKS 8
+
+/* TRIM is only reported along with DMA, as DSM is a DMA command. */
+static int
+ide_hd_trim(const ide_t *ide)
+{
+    const ide_bm_t *bm = ide_boards[ide->board]->bm;
+
+    return (ide->type == IDE_HDD) && hdd[ide->hdd_num].trim &&
+           !ide_boards[ide->board]->force_ata3 && (bm != NULL);
+}
+
 static void
 ide_hd_identify(const ide_t *ide)
 {
@@ -624,6 +645,13 @@ ide_hd_identify(const ide_t *ide)
     ide->buffer[83] = ide->buffer[84] = 0x4000;
     ide->buffer[86] = 0x0000;
     ide->buffer[87] = 0x4000;
+
+    if (ide_hd_trim(ide)) {
+        ide->buffer[69] |= (1 << 14) | (1 << 5); /*Deterministic zeroes after TRIM*/
+        ide->buffer[80] |= 0x80;                 /*Guests only look for TRIM on ATA-7 and later*/
+        ide->buffer[105] = IDE_DSM_MAX_BLOCKS;
+        ide->buffer[169] = 0x0001;               /*DSM TRIM supported*/
+    }
 }
 
 static void
@@ -1258,7 +1286,7 @@ ide_write_data(ide_t *ide, const uint16_t val)
                 const double xfer_time = ide_get_xfer_time(ide, 512);
                 const double wait_time = seek_time + xfer_time;
                 if (ide->command == WIN_WRITE_MULTIPLE) {
-                    if (hdd[ide->hdd_num].speed_preset == 0) {
+                    if ((hdd[ide->hdd_num].speed_preset == 0) || hdd[ide->hdd_num].instant) {
                         ide->pending_delay = 0;
                         ide_callback(ide);
                     } else if ((ide->blockcount + 1) >= ide->blocksize || ide->tf->secount == 1) {
@@ -1309,6 +1337,31 @@ ide_writew(uint16_t addr, uint16_t val, void *priv)
     }
 }
 
+/* REP OUTSW to the data port, straight into the sector buffer. The last word
+   of a sector goes through ide_write_data() so the command moves on. */
+static int
+ide_writew_rep(uint16_t addr, const uint16_t *buf, int count, void *priv)
+{
+    const ide_board_t *dev = (ide_board_t *) priv;
+    ide_t             *ide = ide_drives[dev->cur_dev];
+    uint16_t          *idebufferw;
+    int                n;
+
+    if (((addr & 0x7) != 0x0) || (ide->type == IDE_NONE) || (ide->type & IDE_SHADOW) ||
+        (ide->buffer == NULL) || (ide->command == WIN_PACKETCMD) || (ide->tf->pos >= 512))
+        return 0;
+
+    idebufferw = ide->buffer;
+    n          = MIN(count, ((512 - ide->tf->pos) >> 1) - 1);
+    memcpy(&idebufferw[ide->tf->pos >> 1], buf, n << 1);
+    ide->tf->pos += (n << 1);
+
+    if (n < count)
+        ide_write_data(ide, buf[n++]);
+
+    return n;
+}
+
 static void
 ide_writel(uint16_t addr, uint32_t val, void *priv)
 {
@@ -1708,6 +1761,7 @@ ide_writeb(uint16_t addr, uint8_t val, void *priv)
 
                 case WIN_WRITE_DMA:
                 case WIN_WRITE_DMA_ALT:
+                case WIN_DSM:
                 case WIN_VERIFY:
                 case WIN_VERIFY_ONCE:
                 case WIN_IDENTIFY:     /* Identify Device */
@@ -1788,6 +1842,7 @@ ide_writeb(uint16_t addr, uint8_t val, void *priv)
                 case WIN_SETIDLE1:          /* Idle */
                 case WIN_CHECKPOWERMODE1:
                 case WIN_SLEEP1:
+                case WIN_FLUSH_CACHE:
                     ide->tf->atastat = BSY_STAT;
                     ide_callback(ide);
                     break;
@@ -1865,7 +1920,7 @@ ide_read_data(ide_t *ide)
                     ide_next_sector(ide);
                     ide->tf->atastat = BSY_STAT | READY_STAT | DSC_STAT;
                     if (ide->command == WIN_READ_MULTIPLE) {
-                        if (hdd[ide->hdd_num].speed_preset == 0)
+                        if ((hdd[ide->hdd_num].speed_preset == 0) || hdd[ide->hdd_num].instant)
                             ide_callback(ide);
                         else if (!ide->blockcount) {
                             uint32_t cnt = ide->tf->secount ?
@@ -2058,6 +2113,30 @@ ide_readw(uint16_t addr, void *priv)
     return ret;
 }
 
+/* REP INSW from the data port, the counterpart of ide_writew_rep(). */
+static int
+ide_readw_rep(uint16_t addr, uint16_t *buf, int count, void *priv)
+{
+    const ide_board_t *dev = (ide_board_t *) priv;
+    ide_t             *ide = ide_drives[dev->cur_dev];
+    const uint16_t    *idebufferw;
+    int                n;
+
+    if (((addr & 0x7) != 0x0) || (ide->type == IDE_NONE) || (ide->type & IDE_SHADOW) ||
+        (ide->buffer == NULL) || (ide->command == WIN_PACKETCMD) || (ide->tf->pos >= 512))
+        return 0;
+
+    idebufferw = ide->buffer;
+    n          = MIN(count, ((512 - ide->tf->pos) >> 1) - 1);
+    memcpy(buf, &idebufferw[ide->tf->pos >> 1], n << 1);
+    ide->tf->pos += (n << 1);
+
+    if (n < count)
+        buf[n++] = ide_read_data(ide);
+
+    return n;
+}
+
 static uint32_t
 ide_readl(uint16_t addr, void *priv)
 {
@@ -2209,6 +2288,17 @@ ide_callback(void *priv)
             ide_irq_raise(ide);
             break;
 
+        case WIN_FLUSH_CACHE:
+            if (ide->type == IDE_ATAPI) {
+                ide_set_signature(ide);
+                err = ABRT_ERR;
+            } else {
+                hdd_image_flush(ide->hdd_num);
+                ide->tf->atastat = DRDY_STAT | DSC_STAT;
+                ide_irq_raise(ide);
+            }
+            break;
+
         case WIN_READ:
         case WIN_READ_NORETRY:
             if (ide->type == IDE_ATAPI) {
@@ -2259,12 +2349,15 @@ ide_callback(void *priv)
 
                 ide->tf->pos = 0;
 
-                if (hdd_image_read(ide->hdd_num, ide_get_sector(ide), ide->sector_pos, ide->sector_buffer) < 0) {
+                /* A memory mapped image is transferred straight from the mapping. */
+                uint8_t *src = hdd_image_get_span(ide->hdd_num, ide_get_sector(ide), ide->sector_pos);
+
+                if ((src == NULL) && (hdd_image_read(ide->hdd_num, ide_get_sector(ide), ide->sector_pos, ide->sector_buffer) < 0)) {
                     ide_log("IDE %i: DMA read aborted (image read error)\n", ide->channel);
                     err = UNC_ERR;
                 } else if (!ide_boards[ide->board]->force_ata3 && bm->dma) {
                     /* We should not abort - we should simply wait for the host to start DMA. */
-                    ret = bm->dma(ide->sector_buffer, ide->sector_pos * 512, 0, bm->priv);
+                    ret = bm->dma((src != NULL) ? src : ide->sector_buffer, ide->sector_pos * 512, 0, bm->priv);
                     if (ret == 2) {
                         /* Bus master DMA disabled, simply wait for the host to enable DMA. */
                         ide->tf->atastat = DRQ_STAT | DRDY_STAT | DSC_STAT;
@@ -2404,6 +2497,51 @@ ide_callback(void *priv)
             }
             break;
 
+        case WIN_DSM:
+            if (!ide_hd_trim(ide) || !(ide->tf->features & 0x01) || !ide->tf->secount ||
+                (ide->tf->secount > IDE_DSM_MAX_BLOCKS) || !bm->dma) {
+                ide_log("IDE %i: DSM aborted (TRIM not supported or bad block count)\n", ide->channel);
+                err = ABRT_ERR;
+            } else {
+                ide->sector_pos = ide->tf->secount;
+
+                ret = bm->dma(ide->sector_buffer, ide->sector_pos * 512, 1, bm->priv);
+
+                if (ret == 2) {
+                    /* Bus master DMA disabled, simply wait for the host to enable DMA. */
+                    ide->tf->atastat = DRQ_STAT | DRDY_STAT | DSC_STAT;
+                    ide_set_callback(ide, 6.0 * IDE_TIME);
+                    return;
+                } else if (ret == 1) {
+                    const uint32_t last_sector = hdd_image_get_last_sector(ide->hdd_num);
+
+                    /* Each range is a 48-bit LBA followed by a 16-bit sector count. */
+                    for (uint32_t i = 0; i < (ide->sector_pos * 64); i++) {
+                        const uint8_t *p     = &ide->sector_buffer[i << 3];
+                        uint64_t       lba   = p[0] | (p[1] << 8) | (p[2] << 16) | ((uint64_t) p[3] << 24) |
+                                               ((uint64_t) p[4] << 32) | ((uint64_t) p[5] << 40);
+                        uint32_t       count = p[6] | (p[7] << 8);
+
+                        if (!count || (lba > last_sector))
+                            continue;
+
+                        if (hdd_image_zero_ex(ide->hdd_num, (uint32_t) lba, count) < 0)
+                            err = UNC_ERR;
+                    }
+
+                    ide_log("IDE %i: DSM of %i blocks of ranges done\n", ide->channel, ide->sector_pos);
+
+                    ide->tf->atastat = DRDY_STAT | DSC_STAT;
+                    ide_irq_raise(ide);
+                    ui_sb_update_icon(SB_HDD | hdd[ide->hdd_num].bus_type, 0);
+                } else {
+                    /* Bus master DMA error, abort the command. */
+                    ide_log("IDE %i: DSM aborted (failed)\n", ide->channel);
+                    err = ABRT_ERR;
+                }
+            }
+            break;
+
         case WIN_WRITE_MULTIPLE:
             /* According to the official ATA reference:
 
@@ -2634,6 +2772,8 @@ ide_handlers(uint8_t board, int set)
                        ide_readb, ide_readw, ide_readl,
                        ide_writeb, ide_writew, ide_writel,
                        ide_boards[board]);
+            io_handler_rep(set, ide_boards[board]->base[0], 1,
+                           ide_readw_rep, ide_writew_rep, ide_boards[board]);
         }
 
         if (ide_boards[board]->base[1]) {
@@ -3112,6 +3252,73 @@ ide_reset(UNUSED(void *priv))
     }
 }
 
+/* The task files, the PIO and sector buffers and the command timers of the
+   standalone unit's boards, the same ones ide_reset() takes care of. The disk
+   images are not part of the snapshot, and neither is the packet state of
+   ATAPI devices. */
+static void
+ide_save(UNUSED(void *priv), snapshot_t *s)
+{
+    for (uint8_t i = 0; i < 2; i++) {
+        if (ide_boards[i] == NULL)
+            continue;
+
+        snapshot_write(s, ide_boards[i], offsetof(ide_board_t, timer));
+        snapshot_write_timer(s, &ide_boards[i]->timer);
+
+        for (uint8_t d = (i << 1); d < ((i << 1) + 2); d++) {
+            ide_t *ide = ide_drives[d];
+
+            if (ide == NULL)
+                continue;
+
+            snapshot_write(s, ide, offsetof(ide_t, buffer));
+            if (ide->buffer != NULL)
+                snapshot_write(s, ide->buffer, 65536 * sizeof(uint16_t));
+            if (ide->sector_buffer != NULL)
+                snapshot_write(s, ide->sector_buffer, 256 * 512);
+            snapshot_write_timer(s, &ide->timer);
+            snapshot_write(s, ide->tf, sizeof(ide_tf_t));
+            snapshot_write(s, &ide->interrupt_drq, sizeof(ide->interrupt_drq));
+            snapshot_write(s, &ide->pending_delay, sizeof(ide->pending_delay));
+        }
+    }
+}
+
+static int
+ide_load(UNUSED(void *priv), snapshot_t *s)
+{
+    for (uint8_t i = 0; i < 2; i++) {
+        if (ide_boards[i] == NULL)
+            continue;
+
+        /* The bases come back with the board, so move the handlers along. */
+        ide_handlers(i, 0);
+        if (!snapshot_read(s, ide_boards[i], offsetof(ide_board_t, timer)) ||
+            !snapshot_read_timer(s, &ide_boards[i]->timer))
+            return 0;
+        ide_handlers(i, 1);
+
+        for (uint8_t d = (i << 1); d < ((i << 1) + 2); d++) {
+            ide_t *ide = ide_drives[d];
+
+            if (ide == NULL)
+                continue;
+
+            if (!snapshot_read(s, ide, offsetof(ide_t, buffer)) ||
+                ((ide->buffer != NULL) && !snapshot_read(s, ide->buffer, 65536 * sizeof(uint16_t))) ||
+                ((ide->sector_buffer != NULL) && !snapshot_read(s, ide->sector_buffer, 256 * 512)) ||
+                !snapshot_read_timer(s, &ide->timer) ||
+                !snapshot_read(s, ide->tf, sizeof(ide_tf_t)) ||
+                !snapshot_read(s, &ide->interrupt_drq, sizeof(ide->interrupt_drq)) ||
+                !snapshot_read(s, &ide->pending_delay, sizeof(ide->pending_delay)))
+                return 0;
+        }
+    }
+
+    return 1;
+}
+
 /* Close a standalone IDE unit. */
 static void
 ide_close(UNUSED(void *priv))
@@ -3290,6 +3497,8 @@ const device_t ide_isa_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
+    .save          = ide_save,
+    .load          = ide_load,
     .config        = NULL
 };
 
@@ -3318,6 +3527,8 @@ const device_t ide_isa_2ch_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
+    .save          = ide_save,
+    .load          = ide_load,
     .config        = NULL
 };
 
@@ -3332,6 +3543,8 @@ const device_t ide_vlb_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
+    .save          = ide_save,
+    .load          = ide_load,
     .config        = NULL
 };
 
@@ -3360,6 +3573,8 @@ const device_t ide_vlb_2ch_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
+    .save          = ide_save,
+    .load          = ide_load,
     .config        = NULL
 };
 
@@ -3374,6 +3589,8 @@ const device_t ide_pci_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
+    .save          = ide_save,
+    .load          = ide_load,
     .config        = NULL
 };
 
@@ -3402,6 +3619,8 @@ const device_t ide_pci_2ch_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
+    .save          = ide_save,
+    .load          = ide_load,
     .config        = NULL
 };
 
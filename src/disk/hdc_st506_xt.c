@@ -1837,10 +1837,7 @@ st506_close(void *priv)
         hdd_image_close(drive->hdd_num);
     }
 
-    if (dev->bios_rom.rom != NULL) {
-        free(dev->bios_rom.rom);
-        dev->bios_rom.rom = NULL;
-    }
+    rom_free(&dev->bios_rom);
 
     free(dev);
 }
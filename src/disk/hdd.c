@@ -32,6 +32,7 @@
 #include "cpu.h"
 
 #define HDD_OVERHEAD_TIME 50.0
+#define HDD_INSTANT_TIME  1.0
 
 hard_disk_t hdd[HDD_NUM];
 
@@ -138,6 +139,9 @@ hdd_is_valid(int c)
 double
 hdd_seek_get_time(hard_disk_t *hdd, uint32_t dst_addr, uint8_t operation, uint8_t continuous, double max_seek_time)
 {
+    if (hdd->instant)
+        return HDD_INSTANT_TIME;
+
     if (!hdd->speed_preset)
         return HDD_OVERHEAD_TIME;
 
@@ -263,6 +267,9 @@ hdd_timing_write(hard_disk_t *hdd, uint32_t addr, uint32_t len)
     double   seek_time = 0.0;
     uint32_t flush_needed;
 
+    if (hdd->instant)
+        return HDD_INSTANT_TIME;
+
     if (!hdd->speed_preset)
         return HDD_OVERHEAD_TIME;
 
@@ -301,6 +308,9 @@ hdd_timing_read(hard_disk_t *hdd, uint32_t addr, uint32_t len)
 {
     double seek_time = 0.0;
 
+    if (hdd->instant)
+        return HDD_INSTANT_TIME;
+
     if (!hdd->speed_preset)
         return HDD_OVERHEAD_TIME;
 
@@ -408,6 +418,7 @@ hdd_zones_init(hard_disk_t *hdd)
 static hdd_preset_t hdd_speed_presets[] = {
   // clang-format off
     { .name = "RAM Disk (max. speed)",                            .internal_name = "ramdisk",                                                                                                        .rcache_num_seg = 16, .rcache_seg_size = 128, .max_multiple = 32 },
+    { .name = "Instant (no timing)",                              .internal_name = "instant",                                                                                                        .rcache_num_seg = 16, .rcache_seg_size = 128, .max_multiple = 32, .instant = 1 },
     { .name = "[1989] 3500 RPM",                                  .internal_name = "1989_3500rpm", .zones =  1,  .avg_spt = 35, .heads = 2, .rpm = 3500, .full_stroke_ms = 40, .track_seek_ms = 8,   .rcache_num_seg =  1, .rcache_seg_size =  16, .max_multiple =  8 },
     { .name = "[1992] 3600 RPM",                                  .internal_name = "1992_3600rpm", .zones =  1,  .avg_spt = 45, .heads = 2, .rpm = 3600, .full_stroke_ms = 30, .track_seek_ms = 6,   .rcache_num_seg =  4, .rcache_seg_size =  16, .max_multiple =  8 },
     { .name = "[1994] 4500 RPM",                                  .internal_name = "1994_4500rpm", .zones =  8,  .avg_spt = 80, .heads = 4, .rpm = 4500, .full_stroke_ms = 26, .track_seek_ms = 5,   .rcache_num_seg =  4, .rcache_seg_size =  32, .max_multiple = 16 },
@@ -601,8 +612,9 @@ hdd_preset_apply(int hdd_id)
     hd->max_multiple_block = preset->max_multiple;
     if (preset->model)
         hd->model = preset->model;
+    hd->instant = preset->instant;
 
-    if (!hd->speed_preset)
+    if (!hd->speed_preset || hd->instant)
         return;
 
     hd->phy_heads = preset->heads;
@@ -18,6 +18,8 @@
  */
 #define _GNU_SOURCE
 #include <stdarg.h>
+#include <inttypes.h>
+#include <stdatomic.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
@@ -29,12 +31,29 @@
 #ifdef __unix__
 #include <unistd.h>
 #endif
+#ifdef _WIN32
+#    include <windows.h>
+#    include <io.h>
+#else
+#    include <sys/mman.h>
+#    include <unistd.h>
+#endif
+#ifdef __linux__
+#    include <sys/ioctl.h>
+#    include <linux/fs.h>
+#endif
 #define HAVE_STDARG_H
 #include <86box/86box.h>
 #include <86box/path.h>
 #include <86box/plat.h>
 #include <86box/random.h>
+#include <86box/thread.h>
+#include <86box/timer.h>
 #include <86box/hdd.h>
+#include <86box/cmp_image.h>
+#include <86box/io_stats.h>
+#include <86box/perf.h>
+#include <minitrace/minitrace.h>
 #include "minivhd/minivhd.h"
 #include "minivhd/internal.h"
 
@@ -42,15 +61,130 @@
 #define HDD_IMAGE_HDI 1
 #define HDD_IMAGE_HDX 2
 #define HDD_IMAGE_VHD 3
+#define HDD_IMAGE_CMP 4
+
+/*
+ * Writes to file based images are handed to a per-image thread, so a slow
+ * host disk does not stall the CPU thread. Reads of sectors that still have
+ * a write queued wait for the queue to drain, everything else goes straight
+ * to the file. VHD images stay synchronous as MiniVHD is not thread safe.
+ */
+#define HDD_WRITE_QUEUE_MAX (4 << 20)
+
+/*
+ * Where the host allows it, RAW, HDI, and HDX images are instead mapped into
+ * memory whole. Transfers become plain copies to and from the page cache, no
+ * write thread is needed, and controllers can use hdd_image_get_span() to DMA
+ * straight out of the mapping. The mapping is synced on flush and on close.
+ */
+
+/*
+ * Images that are not mapped can have a sector cache in front of them, sized
+ * per drive. It works on 64 kB lines, fetches the following line as well on a
+ * miss in a sequential stream, and holds writes back until a flush, an
+ * eviction, or one second after the first write to a clean cache.
+ */
+#define HDD_CACHE_LINE_SECTORS 128
+#define HDD_CACHE_FLUSH_US     1000000.0
+
+typedef struct hdd_cache_line_t {
+    uint32_t tag;  /* Sector / HDD_CACHE_LINE_SECTORS. */
+    uint32_t used; /* LRU stamp, 0 if the line is free. */
+    uint64_t valid[2];
+    uint64_t dirty[2];
+    uint8_t *data;
+} hdd_cache_line_t;
+
+typedef struct hdd_image_cache_t {
+    uint8_t           id;
+    int               dirty;
+    uint32_t          num_lines;
+    uint32_t          stamp;
+    uint32_t          next_sector; /* Sector following the previous read. */
+    uint32_t          stream;      /* Sequential reads in a row. */
+    hdd_cache_line_t *lines;
+    hdd_cache_line_t *last;        /* Most recently found line. */
+    uint8_t          *fill;        /* Two lines, for fills with read-ahead. */
+    pc_timer_t        flush_timer;
+
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t read_ahead;
+} hdd_image_cache_t;
+
+typedef struct hdd_write_t {
+    struct hdd_write_t *next;
+    uint32_t            sector;
+    uint32_t            count;
+    uint8_t             data[];
+} hdd_write_t;
+
+/*
+ * An overlay keeps every change to an image in a separate delta file, so the
+ * base image is only ever read and can be shared. The delta file starts with
+ * a header and a block map holding, for each 64 kB block of the image, the
+ * number of the delta block with its data plus one, or 0 while the block is
+ * unchanged. Blocks are copied up from the base on their first write.
+ */
+#define HDD_OVL_MAGIC         "86BOXOVL"
+#define HDD_OVL_VERSION       1
+#define HDD_OVL_BLOCK_SECTORS 128
+
+typedef struct hdd_overlay_header_t {
+    char     magic[8];
+    uint32_t version;
+    uint32_t block_sectors;
+    uint32_t blocks;
+    uint32_t used;
+} hdd_overlay_header_t;
+
+typedef struct hdd_overlay_t {
+    FILE     *file;
+    uint32_t  blocks;
+    uint32_t  used; /* Delta blocks in use. */
+    uint32_t *map;
+    uint64_t  data_offset;
+    int       dirty;
+    uint32_t  dirty_first;
+    uint32_t  dirty_last;
+    uint8_t   buf[HDD_OVL_BLOCK_SECTORS << 9];
+} hdd_overlay_t;
 
 typedef struct hdd_image_t {
-    FILE     *file; /* Used for HDD_IMAGE_RAW, HDD_IMAGE_HDI, and HDD_IMAGE_HDX. */
-    MVHDMeta *vhd;  /* Used for HDD_IMAGE_VHD. */
-    uint32_t  base;
-    uint32_t  pos;
-    uint32_t  last_sector;
-    uint8_t   type; /* HDD_IMAGE_RAW, HDD_IMAGE_HDI, HDD_IMAGE_HDX, or HDD_IMAGE_VHD */
+    FILE        *file; /* Used for HDD_IMAGE_RAW, HDD_IMAGE_HDI, and HDD_IMAGE_HDX. */
+    MVHDMeta    *vhd;  /* Used for HDD_IMAGE_VHD. */
+    cmp_image_t *cmp;  /* Used for HDD_IMAGE_CMP. */
+    uint32_t     base;
+    uint32_t     pos;
+    uint32_t     last_sector;
+    uint8_t      type; /* HDD_IMAGE_RAW, HDD_IMAGE_HDI, HDD_IMAGE_HDX, HDD_IMAGE_VHD, or HDD_IMAGE_CMP */
     uint8_t   loaded;
+
+    /* Write-behind, started on the first write. */
+    thread_t    *thread;
+    event_t     *wake;
+    event_t     *idle;
+    mutex_t     *file_lock;  /* Held around every seek and transfer. */
+    mutex_t     *queue_lock;
+    hdd_write_t *head;
+    hdd_write_t *tail;
+    atomic_uint  queued;     /* Bytes waiting to be written. */
+    atomic_int   run;
+    atomic_int   error;      /* A queued write failed, reported on the next access. */
+
+    /* Memory mapped image, NULL if the file is accessed through stdio. */
+    uint8_t *map;
+    uint64_t map_size;
+#ifdef _WIN32
+    HANDLE   map_handle;
+#endif
+
+    hdd_image_cache_t *cache;   /* NULL if the drive has no sector cache. */
+    hdd_overlay_t     *overlay; /* NULL if changes go to the image itself. */
+
+    /* MiniVHD and overlays keep block map changes in memory until flushed. */
+    pc_timer_t meta_flush_timer;
+    int        meta_dirty;
 } hdd_image_t;
 
 hdd_image_t hdd_images[HDD_NUM];
@@ -241,6 +375,90 @@ prepare_new_hard_disk(uint8_t id, uint64_t full_size)
     return 1;
 }
 
+static void
+hdd_image_map(hdd_image_t *img)
+{
+    uint64_t size = ((uint64_t) (img->last_sector + 1) << 9LL) + img->base;
+
+    /* Leave images a 32-bit host cannot comfortably map on stdio. */
+    if ((img->file == NULL) || (img->type == HDD_IMAGE_VHD) || (size > (SIZE_MAX >> 1)))
+        return;
+
+    fflush(img->file);
+
+#ifdef _WIN32
+    HANDLE mh = CreateFileMappingA((HANDLE) _get_osfhandle(fileno(img->file)), NULL, PAGE_READWRITE,
+                                   (DWORD) (size >> 32), (DWORD) size, NULL);
+    if (mh == NULL) {
+        hdd_image_log("Hard disk image: Unable to create file mapping\n");
+        return;
+    }
+
+    img->map = (uint8_t *) MapViewOfFile(mh, FILE_MAP_WRITE, 0, 0, (SIZE_T) size);
+    if (img->map == NULL) {
+        hdd_image_log("Hard disk image: Unable to map view of file\n");
+        CloseHandle(mh);
+        return;
+    }
+    img->map_handle = mh;
+#else
+    void *p = mmap(NULL, (size_t) size, PROT_READ | PROT_WRITE, MAP_SHARED, fileno(img->file), 0);
+    if (p == MAP_FAILED) {
+        hdd_image_log("Hard disk image: Unable to map file: %s\n", strerror(errno));
+        return;
+    }
+    img->map = (uint8_t *) p;
+#endif
+
+    img->map_size = size;
+}
+
+static void
+hdd_image_map_sync(hdd_image_t *img)
+{
+#ifdef _WIN32
+    FlushViewOfFile(img->map, 0);
+#else
+    msync(img->map, (size_t) img->map_size, MS_SYNC);
+#endif
+}
+
+static void
+hdd_image_unmap(hdd_image_t *img)
+{
+    if (img->map == NULL)
+        return;
+
+    hdd_image_map_sync(img);
+#ifdef _WIN32
+    UnmapViewOfFile(img->map);
+    CloseHandle(img->map_handle);
+    img->map_handle = NULL;
+#else
+    munmap(img->map, (size_t) img->map_size);
+#endif
+
+    img->map      = NULL;
+    img->map_size = 0;
+}
+
+/* Number of sectors from sector on that lie within the image. */
+static uint32_t
+hdd_image_range_count(const hdd_image_t *img, uint32_t sector, uint32_t count)
+{
+    if (sector > img->last_sector)
+        return 0;
+
+    return MIN(count, img->last_sector - sector + 1);
+}
+
+static void hdd_image_write_stop(hdd_image_t *img);
+static void hdd_image_cache_close(hdd_image_t *img);
+static int  hdd_image_cache_open(uint8_t id, uint32_t size_mb);
+static void hdd_image_overlay_open(uint8_t id);
+static void hdd_image_overlay_close(hdd_image_t *img);
+static int  hdd_overlay_flush(hdd_overlay_t *ovl);
+
 void
 hdd_image_init(void)
 {
@@ -248,8 +466,8 @@ hdd_image_init(void)
         memset(&hdd_images[i], 0, sizeof(hdd_image_t));
 }
 
-int
-hdd_image_load(int id)
+static int
+hdd_image_open(int id)
 {
     uint32_t sector_size = 512;
     uint32_t zero        = 0;
@@ -273,12 +491,21 @@ hdd_image_load(int id)
     hdd_images[id].base = 0;
 
     if (hdd_images[id].loaded) {
+        hdd_image_cache_close(&hdd_images[id]);
+        hdd_image_overlay_close(&hdd_images[id]);
+        hdd_image_write_stop(&hdd_images[id]);
+        hdd_image_unmap(&hdd_images[id]);
+
         if (hdd_images[id].file) {
             fclose(hdd_images[id].file);
             hdd_images[id].file = NULL;
         } else if (hdd_images[id].vhd) {
+            timer_stop(&hdd_images[id].meta_flush_timer);
             mvhd_close(hdd_images[id].vhd);
             hdd_images[id].vhd = NULL;
+        } else if (hdd_images[id].cmp != NULL) {
+            cmp_image_close(hdd_images[id].cmp);
+            hdd_images[id].cmp = NULL;
         }
         hdd_images[id].loaded = 0;
     }
@@ -297,10 +524,35 @@ hdd_image_load(int id)
         memset(hdd[id].fn, 0, sizeof(hdd[id].fn));
         goto fail_raw;
     }
-    hdd_images[id].file = plat_fopen(fn, "rb+");
+    /* Compressed images are read-only, so they only work as the base of an overlay. */
+    if (cmp_image_is_cmp(fn)) {
+        const cmp_image_header_t *hdr;
+
+        if (!hdd[id].overlay_fn[0])
+            fatal("hdd_image_load(): Compressed image '%s' can only be used with an overlay\n", fn);
+
+        hdd_images[id].cmp = cmp_image_open(fn);
+        if (hdd_images[id].cmp == NULL)
+            fatal("hdd_image_load(): Error opening compressed image '%s'\n", fn);
+
+        hdr = cmp_image_get_header(hdd_images[id].cmp);
+        if (hdr->spt && hdr->hpc && hdr->tracks) {
+            hdd[id].spt    = hdr->spt;
+            hdd[id].hpc    = hdr->hpc;
+            hdd[id].tracks = hdr->tracks;
+        }
+        full_size                  = ((uint64_t) hdd[id].spt) * ((uint64_t) hdd[id].hpc) * ((uint64_t) hdd[id].tracks) << 9LL;
+        hdd_images[id].type        = HDD_IMAGE_CMP;
+        hdd_images[id].last_sector = (uint32_t) (full_size >> 9) - 1;
+        hdd_images[id].loaded      = 1;
+        return 1;
+    }
+
+    /* The base of an overlay is never written to. */
+    hdd_images[id].file = plat_fopen(fn, hdd[id].overlay_fn[0] ? "rb" : "rb+");
     if (hdd_images[id].file == NULL) {
         /* Failed to open existing hard disk image */
-        if (errno == ENOENT) {
+        if ((errno == ENOENT) && !hdd[id].overlay_fn[0]) {
             /* Failed because it does not exist,
                so try to create new file */
             if (hdd[id].wp) {
@@ -464,7 +716,7 @@ fail_raw:
         } else if (is_vhd[1]) {
             fclose(hdd_images[id].file);
             hdd_images[id].file = NULL;
-            hdd_images[id].vhd  = mvhd_open(fn, (bool) 0, &vhd_error);
+            hdd_images[id].vhd  = mvhd_open(fn, (bool) !!hdd[id].overlay_fn[0], &vhd_error);
             if (hdd_images[id].vhd == NULL) {
                 if (vhd_error == MVHD_ERR_FILE)
                     fatal("hdd_image_load(): VHD: Error opening VHD file '%s': %s\n", fn, strerror(mvhd_errno));
@@ -497,7 +749,7 @@ fail_raw:
     if (fseeko64(hdd_images[id].file, 0, SEEK_END) == -1)
         fatal("hdd_image_load(): Error seeking to the end of file\n");
     s = ftello64(hdd_images[id].file);
-    if (s < (full_size + hdd_images[id].base))
+    if ((s < (full_size + hdd_images[id].base)) && !hdd[id].overlay_fn[0])
         ret = prepare_new_hard_disk(id, full_size);
     else {
         hdd_images[id].last_sector = (uint32_t) (full_size >> 9) - 1;
@@ -508,6 +760,165 @@ fail_raw:
     return ret;
 }
 
+static void
+hdd_image_meta_flush_timer(void *priv)
+{
+    hdd_image_t *img = (hdd_image_t *) priv;
+
+    img->meta_dirty = 0;
+
+    if (img->overlay != NULL) {
+        if (hdd_overlay_flush(img->overlay) < 0)
+            hdd_image_log("Hard disk image: Error writing the overlay block map\n");
+    } else if (img->vhd != NULL)
+        mvhd_flush(img->vhd);
+}
+
+static void
+hdd_image_meta_mark_dirty(hdd_image_t *img)
+{
+    if (!img->meta_dirty) {
+        img->meta_dirty = 1;
+        timer_on_auto(&img->meta_flush_timer, HDD_CACHE_FLUSH_US);
+    }
+}
+
+int
+hdd_image_load(int id)
+{
+    hdd_image_t *img = &hdd_images[id];
+    int          ret = hdd_image_open(id);
+
+    if ((ret > 0) && ((img->file != NULL) || (img->vhd != NULL) || (img->cmp != NULL))) {
+        img->meta_dirty = 0;
+        timer_add(&img->meta_flush_timer, hdd_image_meta_flush_timer, img, 0);
+
+        if (img->vhd != NULL)
+            mvhd_set_sparse_alloc(img->vhd, hdd[id].vhd_sparse_alloc);
+
+        if (hdd[id].overlay_fn[0])
+            hdd_image_overlay_open(id);
+        else
+            hdd_image_map(img);
+
+        /* A mapped image already goes through the host page cache. */
+        if ((img->map == NULL) && hdd[id].image_cache_size)
+            hdd_image_cache_open(id, hdd[id].image_cache_size);
+    }
+
+    return ret;
+}
+
+static void
+hdd_image_write_thread(void *priv)
+{
+    hdd_image_t *img = (hdd_image_t *) priv;
+
+    while (atomic_load(&img->run) || atomic_load(&img->queued)) {
+        thread_wait_event(img->wake, -1);
+        thread_reset_event(img->wake);
+
+        while (1) {
+            thread_wait_mutex(img->queue_lock);
+            hdd_write_t *w = img->head;
+            thread_release_mutex(img->queue_lock);
+
+            if (w == NULL)
+                break;
+
+            thread_wait_mutex(img->file_lock);
+            if ((fseeko64(img->file, ((uint64_t) w->sector << 9LL) + img->base, SEEK_SET) == -1) ||
+                (fwrite(w->data, 512, w->count, img->file) < w->count)) {
+                hdd_image_log("Hard disk image: Queued write error at sector %08X\n", w->sector);
+                atomic_store(&img->error, 1);
+            }
+            thread_release_mutex(img->file_lock);
+
+            thread_wait_mutex(img->queue_lock);
+            img->head = w->next;
+            if (img->head == NULL)
+                img->tail = NULL;
+            thread_release_mutex(img->queue_lock);
+
+            atomic_fetch_sub(&img->queued, w->count << 9);
+            free(w);
+        }
+
+        MTR_BEGIN("disk", "flush");
+        thread_wait_mutex(img->file_lock);
+        fflush(img->file);
+        thread_release_mutex(img->file_lock);
+        MTR_END("disk", "flush");
+
+        thread_set_event(img->idle);
+    }
+}
+
+static void
+hdd_image_write_start(hdd_image_t *img)
+{
+    img->wake       = thread_create_event();
+    img->idle       = thread_create_event();
+    img->file_lock  = thread_create_mutex();
+    img->queue_lock = thread_create_mutex();
+    img->head = img->tail = NULL;
+    atomic_store(&img->queued, 0);
+    atomic_store(&img->error, 0);
+    atomic_store(&img->run, 1);
+    img->thread = thread_create(hdd_image_write_thread, img);
+}
+
+/* Waits until the queued writes drop to at most limit bytes. */
+static void
+hdd_image_write_wait(hdd_image_t *img, uint32_t limit)
+{
+    while (atomic_load(&img->queued) > limit) {
+        thread_reset_event(img->idle);
+        thread_set_event(img->wake);
+        thread_wait_event(img->idle, 1);
+    }
+}
+
+static void
+hdd_image_write_stop(hdd_image_t *img)
+{
+    if (img->thread == NULL)
+        return;
+
+    atomic_store(&img->run, 0);
+    thread_set_event(img->wake);
+    thread_wait(img->thread);
+    img->thread = NULL;
+
+    thread_destroy_event(img->wake);
+    thread_destroy_event(img->idle);
+    thread_close_mutex(img->file_lock);
+    thread_close_mutex(img->queue_lock);
+    img->file_lock = img->queue_lock = NULL;
+}
+
+/* Makes the file consistent for a synchronous access of the given range. */
+static void
+hdd_image_write_sync(hdd_image_t *img, uint32_t sector, uint32_t count)
+{
+    int overlap = 0;
+
+    if (img->thread == NULL)
+        return;
+
+    thread_wait_mutex(img->queue_lock);
+    for (hdd_write_t *w = img->head; w != NULL; w = w->next) {
+        if ((sector < (w->sector + w->count)) && (w->sector < (sector + count))) {
+            overlap = 1;
+            break;
+        }
+    }
+    thread_release_mutex(img->queue_lock);
+
+    if (overlap)
+        hdd_image_write_wait(img, 0);
+}
+
 int
 hdd_image_seek(uint8_t id, uint32_t sector)
 {
@@ -515,8 +926,16 @@ hdd_image_seek(uint8_t id, uint32_t sector)
     addr         = (uint64_t) sector << 9LL;
 
     hdd_images[id].pos = sector;
-    if (hdd_images[id].type != HDD_IMAGE_VHD) {
-        if (!hdd_images[id].file || (fseeko64(hdd_images[id].file, addr + hdd_images[id].base, SEEK_SET) == -1)) {
+    if ((hdd_images[id].type != HDD_IMAGE_VHD) && (hdd_images[id].type != HDD_IMAGE_CMP)) {
+        int ret;
+
+        if (hdd_images[id].thread)
+            thread_wait_mutex(hdd_images[id].file_lock);
+        ret = !hdd_images[id].file || (fseeko64(hdd_images[id].file, addr + hdd_images[id].base, SEEK_SET) == -1);
+        if (hdd_images[id].thread)
+            thread_release_mutex(hdd_images[id].file_lock);
+
+        if (ret) {
             hdd_image_log("hdd_image_seek(): Error seeking\n");
             return -1;
         }
@@ -525,8 +944,8 @@ hdd_image_seek(uint8_t id, uint32_t sector)
     return 0;
 }
 
-int
-hdd_image_read(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer)
+static int
+hdd_image_read_direct(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer)
 {
     int    non_transferred_sectors;
     size_t num_read;
@@ -537,15 +956,43 @@ hdd_image_read(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer)
         hdd_images[id].pos        = sector + count - non_transferred_sectors - 1;
         if (hdd_images[id].vhd->error)
             return -1;
+    } else if (hdd_images[id].type == HDD_IMAGE_CMP) {
+        hdd_images[id].pos = sector + count;
+        if (cmp_image_read(hdd_images[id].cmp, buffer, (uint64_t) sector << 9LL, count << 9) < 0)
+            return -1;
+    } else if (hdd_images[id].map != NULL) {
+        hdd_image_t *img = &hdd_images[id];
+        uint32_t     n   = hdd_image_range_count(img, sector, count);
+
+        /* Sectors past the end read as they would at the end of the file. */
+        if (n)
+            memcpy(buffer, hdd_image_get_span(id, sector, n), n << 9);
+        img->pos = sector + n;
     } else {
-        if (!hdd_images[id].file || (fseeko64(hdd_images[id].file, ((uint64_t) (sector) << 9LL) + hdd_images[id].base, SEEK_SET) == -1)) {
+        hdd_image_t *img = &hdd_images[id];
+        int          eof;
+
+        if (img->thread) {
+            if (atomic_exchange(&img->error, 0))
+                return -1;
+            hdd_image_write_sync(img, sector, count);
+            thread_wait_mutex(img->file_lock);
+        }
+
+        if (!img->file || (fseeko64(img->file, ((uint64_t) (sector) << 9LL) + img->base, SEEK_SET) == -1)) {
+            if (img->thread)
+                thread_release_mutex(img->file_lock);
             hdd_image_log("Hard disk image %i: Read error during seek\n", id);
             return -1;
         }
 
-        num_read           = fread(buffer, 512, count, hdd_images[id].file);
-        hdd_images[id].pos = sector + num_read;
-        if ((num_read < count) && !feof(hdd_images[id].file))
+        num_read = fread(buffer, 512, count, img->file);
+        eof      = feof(img->file);
+        if (img->thread)
+            thread_release_mutex(img->file_lock);
+
+        img->pos = sector + num_read;
+        if ((num_read < count) && !eof)
             return -1;
     }
 
@@ -581,29 +1028,70 @@ hdd_image_read_ex(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer)
     return 0;
 }
 
-int
-hdd_image_write(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer)
+static int
+hdd_image_write_direct(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer)
 {
-    int    non_transferred_sectors;
-    size_t num_write;
+    int non_transferred_sectors;
 
     if (hdd_images[id].type == HDD_IMAGE_VHD) {
         hdd_images[id].vhd->error = 0;
         non_transferred_sectors   = mvhd_write_sectors(hdd_images[id].vhd, sector, count, buffer);
         hdd_images[id].pos        = sector + count - non_transferred_sectors - 1;
+        hdd_image_meta_mark_dirty(&hdd_images[id]);
         if (hdd_images[id].vhd->error)
             return -1;
-    } else {
-        if (!hdd_images[id].file || (fseeko64(hdd_images[id].file, ((uint64_t) (sector) << 9LL) + hdd_images[id].base, SEEK_SET) == -1)) {
-            hdd_image_log("Hard disk image %i: Write error during seek\n", id);
+    } else if (hdd_images[id].type == HDD_IMAGE_CMP) {
+        hdd_image_log("Hard disk image %i: Write to a compressed image\n", id);
+        return -1;
+    } else if (hdd_images[id].map != NULL) {
+        hdd_image_t *img = &hdd_images[id];
+        uint32_t     n   = hdd_image_range_count(img, sector, count);
+
+        if (n)
+            memcpy(hdd_image_get_span(id, sector, n), buffer, n << 9);
+        img->pos = sector + n;
+
+        /* A mapped image cannot grow. */
+        if (n < count) {
+            hdd_image_log("Hard disk image %i: Write past the end of the image\n", id);
             return -1;
         }
+    } else if (hdd_images[id].file && count) {
+        hdd_image_t *img = &hdd_images[id];
+        hdd_write_t *w   = (hdd_write_t *) malloc(sizeof(hdd_write_t) + (count << 9));
 
-        num_write          = fwrite(buffer, 512, count, hdd_images[id].file);
-        hdd_images[id].pos = sector + num_write;
-        fflush(hdd_images[id].file);
-        if (num_write < count)
+        if (w == NULL)
+            fatal("hdd_image_write(): Out of memory\n");
+
+        if (img->thread == NULL)
+            hdd_image_write_start(img);
+        else if (atomic_exchange(&img->error, 0)) {
+            free(w);
             return -1;
+        }
+
+        w->next   = NULL;
+        w->sector = sector;
+        w->count  = count;
+        memcpy(w->data, buffer, count << 9);
+
+        /* Only wait on the host when it is far behind. */
+        hdd_image_write_wait(img, ((count << 9) < HDD_WRITE_QUEUE_MAX) ? (HDD_WRITE_QUEUE_MAX - (count << 9)) : 0);
+
+        atomic_fetch_add(&img->queued, count << 9);
+        thread_wait_mutex(img->queue_lock);
+        if (img->tail)
+            img->tail->next = w;
+        else
+            img->head = w;
+        img->tail = w;
+        thread_release_mutex(img->queue_lock);
+        thread_set_event(img->wake);
+
+        img->pos = sector + count;
+    } else if (!hdd_images[id].file) {
+        hdd_image_log("Hard disk image %i: Write error during seek\n", id);
+        return -1;
     }
 
     return 0;
@@ -626,102 +1114,1007 @@ hdd_image_write_ex(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer)
     return 0;
 }
 
-int
-hdd_image_zero(uint8_t id, uint32_t sector, uint32_t count)
+static int
+hdd_image_zero_file(uint8_t id, uint32_t sector, uint32_t count)
+{
+    if (!hdd_images[id].file || (fseeko64(hdd_images[id].file, ((uint64_t) (sector) << 9LL) + hdd_images[id].base, SEEK_SET) == -1)) {
+        hdd_image_log("Hard disk image %i: Zero error during seek\n", id);
+        return -1;
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        if (feof(hdd_images[id].file))
+            break;
+
+        hdd_images[id].pos = sector + i;
+        if (!fwrite(empty_sector, 512, 1, hdd_images[id].file))
+            return -1;
+    }
+
+    fflush(hdd_images[id].file);
+
+    return 0;
+}
+
+static int
+hdd_image_zero_direct(uint8_t id, uint32_t sector, uint32_t count)
 {
+    int ret = 0;
+
     if (hdd_images[id].type == HDD_IMAGE_VHD) {
         hdd_images[id].vhd->error   = 0;
-        int non_transferred_sectors = mvhd_format_sectors(hdd_images[id].vhd, sector, count);
+        int non_transferred_sectors = mvhd_discard_sectors(hdd_images[id].vhd, sector, count);
         hdd_images[id].pos          = sector + count - non_transferred_sectors - 1;
+        hdd_image_meta_mark_dirty(&hdd_images[id]);
         if (hdd_images[id].vhd->error)
             return -1;
+    } else if (hdd_images[id].type == HDD_IMAGE_CMP) {
+        hdd_image_log("Hard disk image %i: Write to a compressed image\n", id);
+        return -1;
+    } else if (hdd_images[id].map != NULL) {
+        uint32_t n = hdd_image_range_count(&hdd_images[id], sector, count);
+
+        /* Punching through the file also drops the pages from the map. */
+        if (n && (mvhd_punch_hole(hdd_images[id].file, hdd_images[id].base + ((uint64_t) sector << 9),
+                                  (uint64_t) n << 9) < 0))
+            memset(hdd_image_get_span(id, sector, n), 0x00, n << 9);
+        hdd_images[id].pos = sector + n;
     } else {
+        uint32_t n = hdd_image_range_count(&hdd_images[id], sector, count);
+
         memset(empty_sector, 0, 512);
 
-        if (!hdd_images[id].file || (fseeko64(hdd_images[id].file, ((uint64_t) (sector) << 9LL) + hdd_images[id].base, SEEK_SET) == -1)) {
-            hdd_image_log("Hard disk image %i: Zero error during seek\n", id);
-            return -1;
+        /* Rare enough to just let queued writes land first. */
+        if (hdd_images[id].thread) {
+            hdd_image_write_wait(&hdd_images[id], 0);
+            thread_wait_mutex(hdd_images[id].file_lock);
         }
 
-        for (uint32_t i = 0; i < count; i++) {
-            if (feof(hdd_images[id].file))
-                break;
+        /* Give the space back to the host where it can, write zeroes otherwise. */
+        if (hdd_images[id].file)
+            fflush(hdd_images[id].file);
+        if (n && hdd_images[id].file &&
+            (mvhd_punch_hole(hdd_images[id].file, hdd_images[id].base + ((uint64_t) sector << 9),
+                             (uint64_t) n << 9) == 0))
+            hdd_images[id].pos = sector + n - 1;
+        else
+            ret = hdd_image_zero_file(id, sector, count);
+
+        if (hdd_images[id].thread)
+            thread_release_mutex(hdd_images[id].file_lock);
+    }
 
-            hdd_images[id].pos = sector + i;
-            if (!fwrite(empty_sector, 512, 1, hdd_images[id].file))
-                return -1;
-        }
+    return ret;
+}
 
-        fflush(hdd_images[id].file);
-    }
+static int
+hdd_image_truncate(FILE *fp, uint64_t size)
+{
+    fflush(fp);
+#ifdef _WIN32
+    return _chsize_s(_fileno(fp), size) ? -1 : 0;
+#else
+    return ftruncate(fileno(fp), (off_t) size) ? -1 : 0;
+#endif
+}
 
-    return 0;
+static uint64_t
+hdd_overlay_data_offset(uint32_t blocks)
+{
+    return (sizeof(hdd_overlay_header_t) + ((uint64_t) blocks * sizeof(uint32_t)) + 511) & ~511ULL;
 }
 
-int
-hdd_image_zero_ex(uint8_t id, uint32_t sector, uint32_t count)
+static int
+hdd_overlay_seek(hdd_overlay_t *ovl, uint32_t idx, uint32_t off)
 {
-    uint32_t transfer_sectors = count;
-    uint32_t sectors          = hdd_sectors(id);
+    return fseeko64(ovl->file, ovl->data_offset + ((((uint64_t) idx * HDD_OVL_BLOCK_SECTORS) + off) << 9LL), SEEK_SET);
+}
 
-    if ((sectors - sector) < transfer_sectors)
-        transfer_sectors = sectors - sector;
+static void
+hdd_overlay_mark_dirty(hdd_overlay_t *ovl, uint32_t blk)
+{
+    if (!ovl->dirty) {
+        ovl->dirty       = 1;
+        ovl->dirty_first = ovl->dirty_last = blk;
+    } else if (blk < ovl->dirty_first)
+        ovl->dirty_first = blk;
+    else if (blk > ovl->dirty_last)
+        ovl->dirty_last = blk;
+}
 
-    hdd_image_zero(id, sector, transfer_sectors);
+/* Writes the header and the changed part of the block map. */
+static int
+hdd_overlay_flush(hdd_overlay_t *ovl)
+{
+    hdd_overlay_header_t hdr = { 0 };
+
+    memcpy(hdr.magic, HDD_OVL_MAGIC, sizeof(hdr.magic));
+    hdr.version       = HDD_OVL_VERSION;
+    hdr.block_sectors = HDD_OVL_BLOCK_SECTORS;
+    hdr.blocks        = ovl->blocks;
+    hdr.used          = ovl->used;
+
+    if ((fseeko64(ovl->file, 0, SEEK_SET) == -1) || (fwrite(&hdr, 1, sizeof(hdr), ovl->file) != sizeof(hdr)))
+        return -1;
+
+    if (ovl->dirty) {
+        uint32_t n = ovl->dirty_last - ovl->dirty_first + 1;
+
+        if ((fseeko64(ovl->file, sizeof(hdr) + ((uint64_t) ovl->dirty_first * sizeof(uint32_t)), SEEK_SET) == -1) ||
+            (fwrite(&ovl->map[ovl->dirty_first], sizeof(uint32_t), n, ovl->file) != n))
+            return -1;
+        ovl->dirty = 0;
+    }
+
+    fflush(ovl->file);
 
-    if (count != transfer_sectors)
-        return 1;
     return 0;
 }
 
-uint32_t
-hdd_image_get_pos(uint8_t id)
+/* Drops every change, which returns the image to the state of the base. */
+static int
+hdd_overlay_reset(hdd_overlay_t *ovl)
 {
-    return hdd_images[id].pos;
+    memset(ovl->map, 0x00, ovl->blocks * sizeof(uint32_t));
+    ovl->used        = 0;
+    ovl->dirty       = 1;
+    ovl->dirty_first = 0;
+    ovl->dirty_last  = ovl->blocks - 1;
+
+    if (hdd_overlay_flush(ovl) < 0)
+        return -1;
+
+    /* The space is reused either way, so failing to give it back is harmless. */
+    (void) hdd_image_truncate(ovl->file, ovl->data_offset);
+
+    return 0;
 }
 
-uint8_t
-hdd_image_get_type(uint8_t id)
+static void
+hdd_image_overlay_open(uint8_t id)
 {
-    return hdd_images[id].type;
+    hdd_image_t          *img = &hdd_images[id];
+    hdd_overlay_t        *ovl = (hdd_overlay_t *) calloc(1, sizeof(hdd_overlay_t));
+    hdd_overlay_header_t  hdr;
+    const char           *fn  = hdd[id].overlay_fn;
+
+    if (ovl == NULL)
+        fatal("hdd_image_load(): Overlay: Out of memory\n");
+
+    ovl->blocks      = (img->last_sector / HDD_OVL_BLOCK_SECTORS) + 1;
+    ovl->data_offset = hdd_overlay_data_offset(ovl->blocks);
+    ovl->map         = (uint32_t *) calloc(ovl->blocks, sizeof(uint32_t));
+    if (ovl->map == NULL)
+        fatal("hdd_image_load(): Overlay: Out of memory\n");
+
+    ovl->file = plat_fopen(fn, "rb+");
+    if (ovl->file == NULL) {
+        ovl->file = plat_fopen(fn, "wb+");
+        if ((ovl->file == NULL) || (hdd_overlay_reset(ovl) < 0))
+            fatal("hdd_image_load(): Overlay: Unable to create '%s'\n", fn);
+    } else {
+        if ((fread(&hdr, 1, sizeof(hdr), ovl->file) != sizeof(hdr)) ||
+            memcmp(hdr.magic, HDD_OVL_MAGIC, sizeof(hdr.magic)) || (hdr.version != HDD_OVL_VERSION) ||
+            (hdr.block_sectors != HDD_OVL_BLOCK_SECTORS) || (hdr.blocks != ovl->blocks))
+            fatal("hdd_image_load(): Overlay: '%s' does not belong to an image of this size\n", fn);
+
+        if (fread(ovl->map, sizeof(uint32_t), ovl->blocks, ovl->file) != ovl->blocks)
+            fatal("hdd_image_load(): Overlay: Error reading the block map of '%s'\n", fn);
+
+        ovl->used = hdr.used;
+        for (uint32_t i = 0; i < ovl->blocks; i++) {
+            if (ovl->map[i] > ovl->used)
+                fatal("hdd_image_load(): Overlay: Block map of '%s' is corrupt\n", fn);
+        }
+
+        if (hdd[id].overlay_discard && (hdd_overlay_reset(ovl) < 0))
+            fatal("hdd_image_load(): Overlay: Unable to discard '%s'\n", fn);
+    }
+
+    hdd_image_log("Hard disk image %i: Overlay '%s' with %i changed blocks\n", id, fn, ovl->used);
+
+    img->overlay = ovl;
 }
 
-void
-hdd_image_unload(uint8_t id, UNUSED(int fn_preserve))
+static void
+hdd_image_overlay_close(hdd_image_t *img)
 {
-    if (strlen(hdd[id].fn) == 0)
+    hdd_overlay_t *ovl = img->overlay;
+
+    if (ovl == NULL)
         return;
 
-    if (hdd_images[id].loaded) {
-        if (hdd_images[id].file != NULL) {
-            fclose(hdd_images[id].file);
-            hdd_images[id].file = NULL;
-        } else if (hdd_images[id].vhd != NULL) {
-            mvhd_close(hdd_images[id].vhd);
-            hdd_images[id].vhd = NULL;
-        }
-        hdd_images[id].loaded = 0;
-    }
+    timer_stop(&img->meta_flush_timer);
+    img->meta_dirty = 0;
 
-    hdd_images[id].last_sector = -1;
+    if (hdd_overlay_flush(ovl) < 0)
+        hdd_image_log("Hard disk image: Error writing the overlay block map\n");
 
-    memset(hdd[id].fn, 0, sizeof(hdd[id].fn));
+    fclose(ovl->file);
+    free(ovl->map);
+    free(ovl);
+    img->overlay = NULL;
 }
 
-void
-hdd_image_close(uint8_t id)
+static int
+hdd_image_overlay_read(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer)
 {
-    hdd_image_log("hdd_image_close(%i)\n", id);
+    hdd_overlay_t *ovl = hdd_images[id].overlay;
 
-    if (!hdd_images[id].loaded)
-        return;
+    while (count) {
+        uint32_t blk = sector / HDD_OVL_BLOCK_SECTORS;
+        uint32_t off = sector % HDD_OVL_BLOCK_SECTORS;
+        uint32_t n   = MIN(count, HDD_OVL_BLOCK_SECTORS - off);
+
+        if ((blk < ovl->blocks) && ovl->map[blk]) {
+            if (hdd_overlay_seek(ovl, ovl->map[blk] - 1, off) || (fread(buffer, 512, n, ovl->file) < n))
+                return -1;
+        } else {
+            /* Runs of blocks that are still in the base are read in one go. */
+            for (blk++; (n < count) && ((blk >= ovl->blocks) || !ovl->map[blk]); blk++)
+                n += MIN(count - n, HDD_OVL_BLOCK_SECTORS);
+
+            if (hdd_image_read_direct(id, sector, n, buffer) < 0)
+                return -1;
+        }
+
+        buffer += (n << 9);
+        sector += n;
+        count -= n;
+    }
+
+    return 0;
+}
+
+static int
+hdd_image_overlay_write(uint8_t id, uint32_t sector, uint32_t count, const uint8_t *buffer)
+{
+    hdd_image_t   *img = &hdd_images[id];
+    hdd_overlay_t *ovl = img->overlay;
+
+    while (count) {
+        uint32_t blk = sector / HDD_OVL_BLOCK_SECTORS;
+        uint32_t off = sector % HDD_OVL_BLOCK_SECTORS;
+        uint32_t n   = MIN(count, HDD_OVL_BLOCK_SECTORS - off);
+
+        if (blk >= ovl->blocks)
+            return -1;
+
+        if (!ovl->map[blk]) {
+            uint32_t first = blk * HDD_OVL_BLOCK_SECTORS;
+            uint32_t in    = hdd_image_range_count(img, first, HDD_OVL_BLOCK_SECTORS);
+
+            /* Copy the block up from the base, unless all of it is overwritten. */
+            memset(ovl->buf, 0x00, sizeof(ovl->buf));
+            if ((n < HDD_OVL_BLOCK_SECTORS) && in && (hdd_image_read_direct(id, first, in, ovl->buf) < 0))
+                return -1;
+            memcpy(ovl->buf + (off << 9), buffer, n << 9);
+
+            if (hdd_overlay_seek(ovl, ovl->used, 0) ||
+                (fwrite(ovl->buf, 512, HDD_OVL_BLOCK_SECTORS, ovl->file) < HDD_OVL_BLOCK_SECTORS))
+                return -1;
+
+            ovl->map[blk] = ++ovl->used;
+            hdd_overlay_mark_dirty(ovl, blk);
+        } else if (hdd_overlay_seek(ovl, ovl->map[blk] - 1, off) || (fwrite(buffer, 512, n, ovl->file) < n))
+            return -1;
+
+        buffer += (n << 9);
+        sector += n;
+        count -= n;
+    }
+
+    hdd_image_meta_mark_dirty(img);
+
+    return 0;
+}
+
+static int
+hdd_image_overlay_zero(uint8_t id, uint32_t sector, uint32_t count)
+{
+    static const uint8_t zero_block[HDD_OVL_BLOCK_SECTORS << 9];
+
+    while (count) {
+        uint32_t n = MIN(count, HDD_OVL_BLOCK_SECTORS);
+
+        if (hdd_image_overlay_write(id, sector, n, zero_block) < 0)
+            return -1;
+
+        sector += n;
+        count -= n;
+    }
+
+    return 0;
+}
+
+static int
+hdd_image_read_backend(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer)
+{
+    if (hdd_images[id].overlay != NULL)
+        return hdd_image_overlay_read(id, sector, count, buffer);
+
+    return hdd_image_read_direct(id, sector, count, buffer);
+}
+
+static int
+hdd_image_write_backend(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer)
+{
+    if (hdd_images[id].overlay != NULL) {
+        if (hdd_image_overlay_write(id, sector, count, buffer) < 0)
+            return -1;
+        hdd_images[id].pos = sector + count;
+        return 0;
+    }
+
+    return hdd_image_write_direct(id, sector, count, buffer);
+}
+
+static int
+hdd_image_zero_backend(uint8_t id, uint32_t sector, uint32_t count)
+{
+    if (hdd_images[id].overlay != NULL)
+        return hdd_image_overlay_zero(id, sector, count);
+
+    return hdd_image_zero_direct(id, sector, count);
+}
+
+static int
+hdd_cache_bits_all(const uint64_t *bits, uint32_t first, uint32_t n)
+{
+    for (uint32_t i = first; i < (first + n); i++) {
+        if (!(bits[i >> 6] & (1ULL << (i & 63))))
+            return 0;
+    }
+
+    return 1;
+}
+
+static void
+hdd_cache_bits_set(uint64_t *bits, uint32_t first, uint32_t n)
+{
+    for (uint32_t i = first; i < (first + n); i++)
+        bits[i >> 6] |= (1ULL << (i & 63));
+}
+
+static void
+hdd_cache_bits_clear(uint64_t *bits, uint32_t first, uint32_t n)
+{
+    for (uint32_t i = first; i < (first + n); i++)
+        bits[i >> 6] &= ~(1ULL << (i & 63));
+}
+
+static void
+hdd_cache_touch(hdd_image_cache_t *cache, hdd_cache_line_t *line)
+{
+    /* On wrap-around, restart the ages without freeing any line. */
+    if (++cache->stamp == 0) {
+        for (uint32_t i = 0; i < cache->num_lines; i++) {
+            if (cache->lines[i].used)
+                cache->lines[i].used = 1;
+        }
+        cache->stamp = 2;
+    }
+
+    line->used = cache->stamp;
+}
+
+static hdd_cache_line_t *
+hdd_cache_find(hdd_image_cache_t *cache, uint32_t tag)
+{
+    /* Small transfers mostly hit the same line again. */
+    if ((cache->last != NULL) && cache->last->used && (cache->last->tag == tag))
+        return cache->last;
+
+    for (uint32_t i = 0; i < cache->num_lines; i++) {
+        if (cache->lines[i].used && (cache->lines[i].tag == tag)) {
+            cache->last = &cache->lines[i];
+            return cache->last;
+        }
+    }
+
+    return NULL;
+}
+
+/* Writes the dirty sectors of a line back, in runs. */
+static int
+hdd_cache_line_flush(hdd_image_cache_t *cache, hdd_cache_line_t *line)
+{
+    uint32_t i   = 0;
+    int      ret = 0;
+
+    while (i < HDD_CACHE_LINE_SECTORS) {
+        uint32_t n = 0;
+
+        while (((i + n) < HDD_CACHE_LINE_SECTORS) && hdd_cache_bits_all(line->dirty, i + n, 1))
+            n++;
+
+        if (n == 0) {
+            i++;
+            continue;
+        }
+
+        if (hdd_image_write_backend(cache->id, (line->tag * HDD_CACHE_LINE_SECTORS) + i, n, line->data + (i << 9)) < 0)
+            ret = -1;
+        i += n;
+    }
+
+    line->dirty[0] = line->dirty[1] = 0;
+
+    return ret;
+}
+
+/* Returns the line for tag, taking over the least recently used one if it is
+   not cached. An error writing back a dirty victim is returned in ret. */
+static hdd_cache_line_t *
+hdd_cache_get(hdd_image_cache_t *cache, uint32_t tag, int *ret)
+{
+    hdd_cache_line_t *line = hdd_cache_find(cache, tag);
+
+    if (line == NULL) {
+        line = &cache->lines[0];
+        for (uint32_t i = 0; i < cache->num_lines; i++) {
+            if (!cache->lines[i].used) {
+                line = &cache->lines[i];
+                break;
+            } else if (cache->lines[i].used < line->used)
+                line = &cache->lines[i];
+        }
+
+        if (line->used && (hdd_cache_line_flush(cache, line) < 0))
+            *ret = -1;
+
+        line->tag      = tag;
+        line->valid[0] = line->valid[1] = 0;
+    }
+
+    hdd_cache_touch(cache, line);
+
+    return line;
+}
+
+/* Reads the sectors of lines starting at tag that are not valid yet. */
+static int
+hdd_cache_fill(hdd_image_cache_t *cache, uint32_t tag, uint32_t lines)
+{
+    const hdd_image_t *img   = &hdd_images[cache->id];
+    uint32_t           first = tag * HDD_CACHE_LINE_SECTORS;
+    uint32_t           n     = hdd_image_range_count(img, first, lines * HDD_CACHE_LINE_SECTORS);
+    int                ret   = 0;
+
+    memset(cache->fill, 0x00, (lines * HDD_CACHE_LINE_SECTORS) << 9);
+    if (n && (hdd_image_read_backend(cache->id, first, n, cache->fill) < 0))
+        return -1;
+
+    for (uint32_t l = 0; l < lines; l++) {
+        hdd_cache_line_t *line = hdd_cache_get(cache, tag + l, &ret);
+        const uint8_t    *src  = cache->fill + ((l * HDD_CACHE_LINE_SECTORS) << 9);
+
+        for (uint32_t i = 0; i < HDD_CACHE_LINE_SECTORS; i++) {
+            if (!hdd_cache_bits_all(line->valid, i, 1))
+                memcpy(line->data + (i << 9), src + (i << 9), 512);
+        }
+        line->valid[0] = line->valid[1] = 0xffffffffffffffffULL;
+    }
+
+    return ret;
+}
+
+static int
+hdd_image_cache_flush(hdd_image_cache_t *cache)
+{
+    int ret = 0;
+
+    if (!cache->dirty)
+        return 0;
+
+    for (uint32_t i = 0; i < cache->num_lines; i++) {
+        hdd_cache_line_t *line = &cache->lines[i];
+
+        if (line->used && (line->dirty[0] | line->dirty[1]) && (hdd_cache_line_flush(cache, line) < 0))
+            ret = -1;
+    }
+
+    cache->dirty = 0;
+    timer_stop(&cache->flush_timer);
+
+    return ret;
+}
+
+static void
+hdd_image_cache_flush_timer(void *priv)
+{
+    hdd_image_cache_t *cache = (hdd_image_cache_t *) priv;
+
+    if (hdd_image_cache_flush(cache) < 0)
+        hdd_image_log("Hard disk image %i: Cache write back error\n", cache->id);
+}
+
+static int
+hdd_image_cache_read(hdd_image_cache_t *cache, uint32_t sector, uint32_t count, uint8_t *buffer)
+{
+    const hdd_image_t *img = &hdd_images[cache->id];
+
+    if (sector == cache->next_sector)
+        cache->stream++;
+    else
+        cache->stream = 0;
+    cache->next_sector = sector + count;
+
+    while (count) {
+        uint32_t          tag  = sector / HDD_CACHE_LINE_SECTORS;
+        uint32_t          off  = sector % HDD_CACHE_LINE_SECTORS;
+        uint32_t          n    = MIN(count, HDD_CACHE_LINE_SECTORS - off);
+        hdd_cache_line_t *line = hdd_cache_find(cache, tag);
+
+        if ((line == NULL) || !hdd_cache_bits_all(line->valid, off, n)) {
+            uint32_t lines = 1;
+
+            /* A sequential stream fetches the following line along. */
+            if (cache->stream && (((tag + 1) * HDD_CACHE_LINE_SECTORS) <= img->last_sector) &&
+                (hdd_cache_find(cache, tag + 1) == NULL)) {
+                cache->read_ahead++;
+                lines = 2;
+            }
+
+            cache->misses++;
+            io_stats_lookup(&hdd_io_stats[cache->id], 0);
+            if (hdd_cache_fill(cache, tag, lines) < 0)
+                return -1;
+            line = hdd_cache_find(cache, tag);
+        } else {
+            cache->hits++;
+            io_stats_lookup(&hdd_io_stats[cache->id], 1);
+            hdd_cache_touch(cache, line);
+        }
+
+        memcpy(buffer, line->data + (off << 9), n << 9);
+
+        buffer += (n << 9);
+        sector += n;
+        count -= n;
+    }
+
+    return 0;
+}
+
+static int
+hdd_image_cache_write(hdd_image_cache_t *cache, uint32_t sector, uint32_t count, const uint8_t *buffer)
+{
+    int ret = 0;
+
+    while (count) {
+        uint32_t          tag  = sector / HDD_CACHE_LINE_SECTORS;
+        uint32_t          off  = sector % HDD_CACHE_LINE_SECTORS;
+        uint32_t          n    = MIN(count, HDD_CACHE_LINE_SECTORS - off);
+        hdd_cache_line_t *line = hdd_cache_get(cache, tag, &ret);
+
+        memcpy(line->data + (off << 9), buffer, n << 9);
+        hdd_cache_bits_set(line->valid, off, n);
+        hdd_cache_bits_set(line->dirty, off, n);
+
+        buffer += (n << 9);
+        sector += n;
+        count -= n;
+    }
+
+    if (!cache->dirty) {
+        cache->dirty = 1;
+        timer_on_auto(&cache->flush_timer, HDD_CACHE_FLUSH_US);
+    }
+
+    return ret;
+}
+
+/* Drops the given sectors from the cache, dirty or not. */
+static void
+hdd_image_cache_invalidate(hdd_image_cache_t *cache, uint32_t sector, uint32_t count)
+{
+    uint64_t end = (uint64_t) sector + count;
+
+    for (uint32_t i = 0; i < cache->num_lines; i++) {
+        hdd_cache_line_t *line  = &cache->lines[i];
+        uint64_t          first = (uint64_t) line->tag * HDD_CACHE_LINE_SECTORS;
+        uint64_t          from;
+        uint64_t          to;
+
+        if (!line->used)
+            continue;
+
+        from = MAX(first, sector);
+        to   = MIN(first + HDD_CACHE_LINE_SECTORS, end);
+        if (from < to) {
+            hdd_cache_bits_clear(line->valid, (uint32_t) (from - first), (uint32_t) (to - from));
+            hdd_cache_bits_clear(line->dirty, (uint32_t) (from - first), (uint32_t) (to - from));
+        }
+    }
+}
+
+static int
+hdd_image_cache_open(uint8_t id, uint32_t size_mb)
+{
+    hdd_image_cache_t *cache = (hdd_image_cache_t *) calloc(1, sizeof(hdd_image_cache_t));
+    uint8_t           *data;
+
+    if (cache == NULL)
+        return 0;
+
+    cache->id        = id;
+    cache->num_lines = (size_mb << 20) / (HDD_CACHE_LINE_SECTORS << 9);
+    cache->lines     = (hdd_cache_line_t *) calloc(cache->num_lines, sizeof(hdd_cache_line_t));
+    cache->fill      = (uint8_t *) malloc((2 * HDD_CACHE_LINE_SECTORS) << 9);
+    data             = (uint8_t *) malloc((size_t) size_mb << 20);
+    if ((cache->lines == NULL) || (cache->fill == NULL) || (data == NULL)) {
+        hdd_image_log("Hard disk image %i: Unable to allocate a %i MB cache\n", id, size_mb);
+        free(cache->lines);
+        free(cache->fill);
+        free(data);
+        free(cache);
+        return 0;
+    }
+
+    for (uint32_t i = 0; i < cache->num_lines; i++)
+        cache->lines[i].data = data + ((size_t) i * (HDD_CACHE_LINE_SECTORS << 9));
+
+    cache->next_sector = 0xffffffff;
+    timer_add(&cache->flush_timer, hdd_image_cache_flush_timer, cache, 0);
+
+    hdd_images[id].cache = cache;
+
+    return 1;
+}
+
+static void
+hdd_image_cache_close(hdd_image_t *img)
+{
+    hdd_image_cache_t *cache = img->cache;
+
+    if (cache == NULL)
+        return;
+
+    if (hdd_image_cache_flush(cache) < 0)
+        hdd_image_log("Hard disk image %i: Cache write back error\n", cache->id);
+    timer_stop(&cache->flush_timer);
+
+    hdd_image_log("Hard disk image %i: Cache: %" PRIu64 " hits, %" PRIu64 " misses, %" PRIu64 " read-aheads\n",
+                  cache->id, cache->hits, cache->misses, cache->read_ahead);
+
+    free(cache->lines[0].data);
+    free(cache->lines);
+    free(cache->fill);
+    free(cache);
+    img->cache = NULL;
+}
+
+int
+hdd_image_read(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer)
+{
+    hdd_image_t *img   = &hdd_images[id];
+    uint64_t     start = plat_get_ticks_us();
+    int          ret   = 0;
+    int          prev  = perf_enter(PERF_IO);
+
+    MTR_BEGIN("disk", "read");
+    if (img->cache == NULL)
+        ret = hdd_image_read_backend(id, sector, count, buffer);
+    else if (hdd_image_cache_read(img->cache, sector, count, buffer) < 0)
+        ret = -1;
+    else
+        img->pos = sector + count;
+
+    io_stats_transfer(&hdd_io_stats[id], 0, count << 9, plat_get_ticks_us() - start);
+    io_stats_queue(&hdd_io_stats[id], atomic_load(&img->queued));
+    MTR_END("disk", "read");
+    perf_leave(prev);
+
+    return ret;
+}
+
+int
+hdd_image_write(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer)
+{
+    hdd_image_t *img   = &hdd_images[id];
+    uint64_t     start = plat_get_ticks_us();
+    int          ret   = 0;
+    int          prev  = perf_enter(PERF_IO);
+
+    MTR_BEGIN("disk", "write");
+    if (img->cache == NULL)
+        ret = hdd_image_write_backend(id, sector, count, buffer);
+    else if (hdd_image_cache_write(img->cache, sector, count, buffer) < 0)
+        ret = -1;
+    else
+        img->pos = sector + count;
+
+    io_stats_transfer(&hdd_io_stats[id], 1, count << 9, plat_get_ticks_us() - start);
+    io_stats_queue(&hdd_io_stats[id], atomic_load(&img->queued));
+    MTR_END("disk", "write");
+    perf_leave(prev);
+
+    return ret;
+}
+
+int
+hdd_image_zero(uint8_t id, uint32_t sector, uint32_t count)
+{
+    if (hdd_images[id].cache != NULL)
+        hdd_image_cache_invalidate(hdd_images[id].cache, sector, count);
+
+    return hdd_image_zero_backend(id, sector, count);
+}
+
+int
+hdd_image_zero_ex(uint8_t id, uint32_t sector, uint32_t count)
+{
+    uint32_t transfer_sectors = count;
+    uint32_t sectors          = hdd_sectors(id);
+
+    if ((sectors - sector) < transfer_sectors)
+        transfer_sectors = sectors - sector;
+
+    hdd_image_zero(id, sector, transfer_sectors);
+
+    if (count != transfer_sectors)
+        return 1;
+    return 0;
+}
+
+/* Returns a host pointer to the given sectors of a memory mapped image, or NULL
+   if the image is not mapped or the range does not lie within it. */
+uint8_t *
+hdd_image_get_span(uint8_t id, uint32_t sector, uint32_t count)
+{
+    const hdd_image_t *img = &hdd_images[id];
+
+    if ((img->map == NULL) || !count || (hdd_image_range_count(img, sector, count) < count))
+        return NULL;
+
+    return img->map + img->base + ((uint64_t) sector << 9LL);
+}
+
+/* Makes everything the guest wrote so far reach the host file. */
+void
+hdd_image_flush(uint8_t id)
+{
+    hdd_image_t *img = &hdd_images[id];
+
+    if (img->cache != NULL)
+        hdd_image_cache_flush(img->cache);
+
+    if ((img->overlay != NULL) || (img->vhd != NULL)) {
+        if (img->meta_dirty) {
+            timer_stop(&img->meta_flush_timer);
+            hdd_image_meta_flush_timer(img);
+        }
+        if (img->overlay != NULL)
+            fflush(img->overlay->file);
+    } else if (img->map != NULL)
+        hdd_image_map_sync(img);
+    else if (img->file != NULL) {
+        if (img->thread) {
+            hdd_image_write_wait(img, 0);
+            thread_wait_mutex(img->file_lock);
+        }
+
+        fflush(img->file);
+
+        if (img->thread)
+            thread_release_mutex(img->file_lock);
+    }
+}
+
+/* Throws away everything written since the overlay was created. */
+int
+hdd_image_overlay_discard(uint8_t id)
+{
+    hdd_image_t *img = &hdd_images[id];
+
+    if (img->overlay == NULL)
+        return -1;
+
+    if (img->cache != NULL)
+        hdd_image_cache_invalidate(img->cache, 0, img->last_sector + 1);
+
+    timer_stop(&img->meta_flush_timer);
+    img->meta_dirty = 0;
+
+    return hdd_overlay_reset(img->overlay);
+}
+
+/* Reopens the base of an overlay for writing or back as read-only. */
+static int
+hdd_image_base_reopen(uint8_t id, int writable)
+{
+    hdd_image_t *img = &hdd_images[id];
+    int          vhd_error;
+
+    if (img->vhd != NULL) {
+        mvhd_close(img->vhd);
+        img->vhd = mvhd_open(hdd[id].fn, (bool) !writable, &vhd_error);
+        return (img->vhd != NULL) ? 0 : -1;
+    }
+
+    hdd_image_write_stop(img);
+    fclose(img->file);
+    img->file = plat_fopen(hdd[id].fn, writable ? "rb+" : "rb");
+
+    return (img->file != NULL) ? 0 : -1;
+}
+
+/* Writes the changes in the overlay to the base and empties the overlay. */
+int
+hdd_image_overlay_merge(uint8_t id)
+{
+    hdd_image_t   *img = &hdd_images[id];
+    hdd_overlay_t *ovl = img->overlay;
+    int            ret = 0;
+
+    /* There is no way to write to a compressed base. */
+    if ((ovl == NULL) || (img->cmp != NULL))
+        return -1;
+
+    if ((img->cache != NULL) && (hdd_image_cache_flush(img->cache) < 0))
+        return -1;
+
+    if (hdd_image_base_reopen(id, 1) < 0) {
+        if (hdd_image_base_reopen(id, 0) < 0)
+            fatal("hdd_image_overlay_merge(): Unable to reopen '%s'\n", hdd[id].fn);
+        hdd_image_log("Hard disk image %i: Base image '%s' is not writable\n", id, hdd[id].fn);
+        return -1;
+    }
+
+    for (uint32_t blk = 0; (blk < ovl->blocks) && (ret == 0); blk++) {
+        uint32_t first = blk * HDD_OVL_BLOCK_SECTORS;
+        uint32_t n     = hdd_image_range_count(img, first, HDD_OVL_BLOCK_SECTORS);
+
+        if (!ovl->map[blk] || !n)
+            continue;
+
+        if (hdd_overlay_seek(ovl, ovl->map[blk] - 1, 0) || (fread(ovl->buf, 512, n, ovl->file) < n) ||
+            (hdd_image_write_direct(id, first, n, ovl->buf) < 0))
+            ret = -1;
+    }
+
+    if (img->vhd != NULL)
+        mvhd_flush(img->vhd);
+    else
+        hdd_image_write_stop(img);
+
+    if (hdd_image_base_reopen(id, 0) < 0)
+        fatal("hdd_image_overlay_merge(): Unable to reopen '%s'\n", hdd[id].fn);
+    if (img->vhd != NULL)
+        mvhd_set_sparse_alloc(img->vhd, hdd[id].vhd_sparse_alloc);
+
+    /* Keep the overlay if the base did not take all of it. */
+    if (ret == 0)
+        ret = hdd_overlay_reset(ovl);
+    else
+        hdd_image_log("Hard disk image %i: Error merging the overlay\n", id);
+
+    return ret;
+}
+
+static int
+hdd_overlay_copy(hdd_overlay_t *ovl, FILE *fp)
+{
+    size_t n;
+
+    fflush(ovl->file);
+#ifdef FICLONE
+    /* Shares the blocks of the file where the host file system can. */
+    if (ioctl(fileno(fp), FICLONE, fileno(ovl->file)) == 0)
+        return 0;
+#endif
+
+    if (fseeko64(ovl->file, 0, SEEK_SET) == -1)
+        return -1;
+
+    while ((n = fread(ovl->buf, 1, sizeof(ovl->buf), ovl->file)) > 0) {
+        if (fwrite(ovl->buf, 1, n, fp) != n)
+            return -1;
+    }
+
+    return ferror(ovl->file) ? -1 : 0;
+}
+
+/* Moves the overlay over to a copy of itself at fn, so that two processes
+   sharing the base can each go their own way. */
+int
+hdd_image_overlay_clone(uint8_t id, const char *fn)
+{
+    hdd_image_t   *img = &hdd_images[id];
+    hdd_overlay_t *ovl = img->overlay;
+    FILE          *fp;
+
+    if (ovl == NULL)
+        return -1;
+
+    hdd_image_flush(id);
+
+    fp = plat_fopen(fn, "wb+");
+    if (fp == NULL)
+        return -1;
+
+    if ((hdd_overlay_copy(ovl, fp) < 0) || (fflush(fp) != 0)) {
+        fclose(fp);
+        plat_remove((char *) fn);
+        return -1;
+    }
+
+    fclose(ovl->file);
+    ovl->file = fp;
+    snprintf(hdd[id].overlay_fn, sizeof(hdd[id].overlay_fn), "%s", fn);
+
+    hdd_image_log("Hard disk image %i: Overlay cloned to '%s'\n", id, fn);
+
+    return 0;
+}
+
+uint32_t
+hdd_image_get_pos(uint8_t id)
+{
+    return hdd_images[id].pos;
+}
+
+uint8_t
+hdd_image_get_type(uint8_t id)
+{
+    return hdd_images[id].type;
+}
+
+void
+hdd_image_unload(uint8_t id, UNUSED(int fn_preserve))
+{
+    if (strlen(hdd[id].fn) == 0)
+        return;
+
+    if (hdd_images[id].loaded) {
+        hdd_image_cache_close(&hdd_images[id]);
+        hdd_image_overlay_close(&hdd_images[id]);
+        hdd_image_write_stop(&hdd_images[id]);
+        hdd_image_unmap(&hdd_images[id]);
+
+        if (hdd_images[id].file != NULL) {
+            fclose(hdd_images[id].file);
+            hdd_images[id].file = NULL;
+        } else if (hdd_images[id].vhd != NULL) {
+            timer_stop(&hdd_images[id].meta_flush_timer);
+            mvhd_close(hdd_images[id].vhd);
+            hdd_images[id].vhd = NULL;
+        } else if (hdd_images[id].cmp != NULL) {
+            cmp_image_close(hdd_images[id].cmp);
+            hdd_images[id].cmp = NULL;
+        }
+        hdd_images[id].loaded = 0;
+    }
+
+    hdd_images[id].last_sector = -1;
+
+    memset(hdd[id].fn, 0, sizeof(hdd[id].fn));
+}
+
+void
+hdd_image_close(uint8_t id)
+{
+    hdd_image_log("hdd_image_close(%i)\n", id);
+
+    if (!hdd_images[id].loaded)
+        return;
+
+    hdd_image_cache_close(&hdd_images[id]);
+    hdd_image_overlay_close(&hdd_images[id]);
+    hdd_image_write_stop(&hdd_images[id]);
+    hdd_image_unmap(&hdd_images[id]);
 
     if (hdd_images[id].file != NULL) {
         fclose(hdd_images[id].file);
         hdd_images[id].file = NULL;
     } else if (hdd_images[id].vhd != NULL) {
+        timer_stop(&hdd_images[id].meta_flush_timer);
         mvhd_close(hdd_images[id].vhd);
         hdd_images[id].vhd = NULL;
+    } else if (hdd_images[id].cmp != NULL) {
+        cmp_image_close(hdd_images[id].cmp);
+        hdd_images[id].cmp = NULL;
     }
 
     memset(&hdd_images[id], 0, sizeof(hdd_image_t));
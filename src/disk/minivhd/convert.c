@@ -117,8 +117,25 @@ mvhd_convert_to_vhd_sparse(const char* utf8_raw_path, const char* utf8_vhd_path,
     uint8_t empty_buff[4096] = {0};
     int total_sectors = mvhd_calc_size_sectors(&geom);
     int copy_sect = 0;
+    int64_t data_start = 0;
+    int64_t data_end = 0;
 
     for (int i = 0; i < total_sectors; i += 8) {
+        /* Holes in the raw image are skipped without reading them. */
+        if (((int64_t) i * MVHD_SECTOR_SIZE) >= data_end) {
+            data_start = mvhd_next_data(raw_img, (int64_t) i * MVHD_SECTOR_SIZE, &data_end);
+            if (data_start < 0) {
+                data_start = (int64_t) i * MVHD_SECTOR_SIZE;
+                data_end = (int64_t) total_sectors * MVHD_SECTOR_SIZE;
+            }
+            if (data_end <= ((int64_t) i * MVHD_SECTOR_SIZE))
+                break;
+            i = (int) (data_start / MVHD_SECTOR_SIZE) & ~7;
+            if (i >= total_sectors)
+                break;
+            mvhd_fseeko64(raw_img, (int64_t) i * MVHD_SECTOR_SIZE, SEEK_SET);
+        }
+
         copy_sect = 8;
         if ((i + 8) >= total_sectors) {
             copy_sect = total_sectors - i;
@@ -153,15 +170,31 @@ mvhd_convert_to_raw(const char* utf8_vhd_path, const char* utf8_raw_path, int *e
     }
 
     uint8_t buff[4096] = {0}; // 8 sectors
+    uint8_t empty_buff[4096] = {0};
     int total_sectors = mvhd_calc_size_sectors((MVHDGeom*)&vhdm->footer.geom);
     int copy_sect = 0;
+
+    /* Extend the raw image up front, then only write what is not zero, so
+       the unused parts of the disk stay unallocated on the host. */
+    mvhd_set_sparse(raw_img);
+    if (mvhd_ftruncate64(raw_img, (int64_t) total_sectors * MVHD_SECTOR_SIZE) != 0) {
+        *err = MVHD_ERR_FILE;
+        mvhd_close(vhdm);
+        fclose(raw_img);
+        return NULL;
+    }
+
     for (int i = 0; i < total_sectors; i += 8) {
         copy_sect = 8;
         if ((i + 8) >= total_sectors) {
             copy_sect = total_sectors - i;
+            memset(buff, 0, sizeof buff);
         }
         mvhd_read_sectors(vhdm, i, copy_sect, buff);
-        fwrite(buff, MVHD_SECTOR_SIZE, copy_sect, raw_img);
+        if (memcmp(buff, empty_buff, sizeof buff) != 0) {
+            mvhd_fseeko64(raw_img, (int64_t) i * MVHD_SECTOR_SIZE, SEEK_SET);
+            fwrite(buff, MVHD_SECTOR_SIZE, copy_sect, raw_img);
+        }
     }
     mvhd_close(vhdm);
     mvhd_fseeko64(raw_img, 0, SEEK_SET);
@@ -220,6 +220,90 @@ mvhd_create_fixed(const char* path, MVHDGeom geom, int* err, mvhd_progress_callb
 }
 
 
+#define COPY_CHUNK_SIZE (1024 * 1024)
+#define COPY_ZERO_SIZE  4096
+
+
+/**
+ * \brief Copy the data of a raw disk image into an already extended file
+ *
+ * Holes in the raw image are not read at all, and runs of zeroes are not
+ * written, so they stay unallocated in the new image.
+ *
+ * \return 0 on success, -1 if the copy buffer could not be allocated
+ */
+static int
+copy_raw_data(FILE* fp, FILE* raw_img, uint64_t size_in_bytes, mvhd_progress_callback progress_callback)
+{
+    uint8_t* buff = malloc(COPY_CHUNK_SIZE);
+    int64_t  pos = 0;
+    int64_t  data_end;
+    int64_t  start;
+
+    if (buff == NULL)
+        return -1;
+
+    while (pos < (int64_t) size_in_bytes) {
+        start = mvhd_next_data(raw_img, pos, &data_end);
+        if (start < 0) {
+            /* The host can not tell, copy everything. */
+            start = pos;
+            data_end = (int64_t) size_in_bytes;
+        }
+        if (data_end > (int64_t) size_in_bytes)
+            data_end = (int64_t) size_in_bytes;
+        if (start >= data_end)
+            break;
+
+        mvhd_fseeko64(raw_img, start, SEEK_SET);
+        for (pos = start; pos < data_end; ) {
+            size_t len = (size_t) (((data_end - pos) > COPY_CHUNK_SIZE) ? COPY_CHUNK_SIZE : (data_end - pos));
+            size_t got = fread(buff, 1, len, raw_img);
+            if (got < len)
+                memset(buff + got, 0, len - got);
+
+            /* Write the runs of blocks that are not all zeroes. */
+            size_t run = len;
+            for (size_t off = 0; ; off += COPY_ZERO_SIZE) {
+                size_t n = 0;
+                size_t i = 0;
+
+                if (off < len) {
+                    n = ((len - off) > COPY_ZERO_SIZE) ? COPY_ZERO_SIZE : (len - off);
+                    for (i = 0; (i < n) && !buff[off + i]; i++)
+                        ;
+                }
+
+                if (i < n) {
+                    if (run == len)
+                        run = off;
+                    continue;
+                }
+
+                if (run < len) {
+                    size_t run_end = (off < len) ? off : len;
+
+                    mvhd_fseeko64(fp, pos + (int64_t) run, SEEK_SET);
+                    fwrite(buff + run, 1, run_end - run, fp);
+                    run = len;
+                }
+
+                if (off >= len)
+                    break;
+            }
+
+            pos += (int64_t) len;
+            if (progress_callback)
+                progress_callback((uint32_t) (pos / MVHD_SECTOR_SIZE), (uint32_t) (size_in_bytes / MVHD_SECTOR_SIZE));
+        }
+    }
+
+    free(buff);
+
+    return 0;
+}
+
+
 /**
  * \brief internal function that implements public mvhd_create_fixed() functionality
  *
@@ -231,7 +315,6 @@ mvhd_create_fixed(const char* path, MVHDGeom geom, int* err, mvhd_progress_callb
 MVHDMeta*
 mvhd_create_fixed_raw(const char* path, FILE* raw_img, uint64_t size_in_bytes, MVHDGeom* geom, int* err, mvhd_progress_callback progress_callback)
 {
-    uint8_t img_data[MVHD_SECTOR_SIZE] = {0};
     uint8_t footer_buff[MVHD_FOOTER_SIZE] = {0};
 
     if (geom == NULL || (geom->cyl == 0 || geom->heads == 0 || geom->spt == 0)) {
@@ -252,35 +335,47 @@ mvhd_create_fixed_raw(const char* path, FILE* raw_img, uint64_t size_in_bytes, M
     mvhd_fseeko64(fp, 0, SEEK_SET);
 
     uint32_t size_sectors = (uint32_t)(size_in_bytes / MVHD_SECTOR_SIZE);
-    uint32_t s;
 
     if (progress_callback)
         progress_callback(0, size_sectors);
 
+    /* The data area is created by extending the file, rather than by writing
+       zeroes over it, so it is left unallocated wherever the host allows. */
+    mvhd_set_sparse(fp);
+
     if (raw_img != NULL) {
         mvhd_fseeko64(raw_img, 0, SEEK_END);
         uint64_t raw_size = (uint64_t)mvhd_ftello64(raw_img);
         MVHDGeom raw_geom = mvhd_calculate_geometry(raw_size);
         if (mvhd_calc_size_bytes(&raw_geom) != raw_size) {
             *err = MVHD_ERR_CONV_SIZE;
+            fclose(fp);
             goto cleanup_vhdm;
         }
         gen_footer(&vhdm->footer, raw_size, geom, MVHD_TYPE_FIXED, 0);
-        mvhd_fseeko64(raw_img, 0, SEEK_SET);
-        for (s = 0; s < size_sectors; s++) {
-            (void) !fread(img_data, sizeof img_data, 1, raw_img);
-            fwrite(img_data, sizeof img_data, 1, fp);
-            if (progress_callback)
-                progress_callback(s + 1, size_sectors);
+        if (mvhd_ftruncate64(fp, (int64_t) size_in_bytes) != 0) {
+            *err = MVHD_ERR_FILE;
+            fclose(fp);
+            goto cleanup_vhdm;
+        }
+        if (copy_raw_data(fp, raw_img, size_in_bytes, progress_callback) != 0) {
+            *err = MVHD_ERR_MEM;
+            fclose(fp);
+            goto cleanup_vhdm;
         }
     } else {
         gen_footer(&vhdm->footer, size_in_bytes, geom, MVHD_TYPE_FIXED, 0);
-        for (s = 0; s < size_sectors; s++) {
-            fwrite(img_data, sizeof img_data, 1, fp);
-            if (progress_callback)
-                progress_callback(s + 1, size_sectors);
+        if (mvhd_ftruncate64(fp, (int64_t) size_in_bytes) != 0) {
+            *err = MVHD_ERR_FILE;
+            fclose(fp);
+            goto cleanup_vhdm;
         }
     }
+
+    if (progress_callback)
+        progress_callback(size_sectors, size_sectors);
+
+    mvhd_fseeko64(fp, (int64_t) size_in_bytes, SEEK_SET);
     mvhd_footer_to_buffer(&vhdm->footer, footer_buff);
     fwrite(footer_buff, sizeof footer_buff, 1, fp);
     fclose(fp);
@@ -48,6 +48,9 @@
 
 #define MVHD_SPARSE_BLK        0xffffffff
 
+/* Number of blocks a sparse image grows by at a time. */
+#define MVHD_PREALLOC_BLOCKS   8
+
 /* For simplicity, we don't handle paths longer than this
  * Note, this is the max path in characters, as that is what
  * Windows uses
@@ -62,9 +65,12 @@
 
 
 typedef struct MVHDSectorBitmap {
-    uint8_t* curr_bitmap;
-    int      sector_count;
-    int      curr_block;
+    uint8_t*  curr_bitmap;
+    int       sector_count;
+    int       curr_block;
+    uint8_t** blocks;    /* Bitmaps read so far, indexed by block. */
+    uint8_t*  dirty;     /* Bitmaps not written to the file yet. */
+    uint32_t  num_dirty;
 } MVHDSectorBitmap;
 
 typedef struct MVHDFooter {
@@ -123,6 +129,16 @@ struct MVHDMeta {
     uint32_t*        block_offset;
     int              sect_per_block;
     MVHDSectorBitmap bitmap;
+    struct {
+        bool     dirty;
+        uint32_t first;
+        uint32_t last;
+    } bat_dirty;
+    struct {
+        uint32_t next; /* Sector offset of the next free preallocated block. */
+        uint32_t end;  /* Sector offset of the end of the extent. */
+    } prealloc;
+    bool             sparse_alloc;
     int (*read_sectors)(struct MVHDMeta*, uint32_t, int, void*);
     int (*write_sectors)(struct MVHDMeta*, uint32_t, int, void*);
     struct {
@@ -236,6 +252,48 @@ int64_t mvhd_ftello64(FILE* stream);
  */
 int mvhd_fseeko64(FILE* stream, int64_t offset, int origin);
 
+/**
+ * \brief Truncate or extend a file to the given size
+ * 
+ * This is a portable version of the POSIX ftruncate(). The stream should be
+ * flushed first.
+ * 
+ * \return 0 on success, -1 on error
+ */
+int mvhd_ftruncate64(FILE* stream, int64_t size);
+
+/**
+ * \brief Deallocate a range of a file on the host
+ * 
+ * The range reads back as zeroes afterwards, and the file keeps its size.
+ * Only some hosts and file systems support this. The stream should be
+ * flushed first.
+ * 
+ * \return 0 on success, -1 if the range was left untouched
+ */
+int mvhd_punch_hole(FILE* stream, int64_t offset, int64_t len);
+
+/**
+ * \brief Mark a file as sparse on hosts that need it
+ * 
+ * Ranges that are never written to after extending the file with
+ * mvhd_ftruncate64() are then left unallocated. Files are sparse by default
+ * on other hosts.
+ */
+void mvhd_set_sparse(FILE* stream);
+
+/**
+ * \brief Find the next range of a file that is allocated on the host
+ * 
+ * \param [in] offset to start looking from
+ * \param [out] data_end is the end of the range
+ * 
+ * \return the start of the range, the file size if only a hole follows, or
+ * -1 if the host can not tell, in which case everything should be taken to
+ * be data
+ */
+int64_t mvhd_next_data(FILE* stream, int64_t offset, int64_t* data_end);
+
 /**
  * \brief Calculate the CRC32 of a data buffer.
  * 
@@ -334,6 +392,22 @@ int mvhd_sparse_read(struct MVHDMeta* vhdm, uint32_t offset, int num_sectors, vo
  */
 int mvhd_diff_read(struct MVHDMeta* vhdm, uint32_t offset, int num_sectors, void* out_buff);
 
+/**
+ * \brief Write the changed sector bitmaps and BAT entries to file
+ * 
+ * Writes to sparse and differencing images only update these in memory.
+ * 
+ * \param [in] vhdm MiniVHD data structure
+ */
+void mvhd_flush_metadata(struct MVHDMeta* vhdm);
+
+/**
+ * \brief Trim the unused part of the preallocated extent off the file
+ * 
+ * \param [in] vhdm MiniVHD data structure
+ */
+void mvhd_release_prealloc(struct MVHDMeta* vhdm);
+
 /**
  * \brief Write to a fixed VHD image
  * 
@@ -376,6 +450,22 @@ int mvhd_fixed_write(struct MVHDMeta* vhdm, uint32_t offset, int num_sectors, vo
  */
 int mvhd_sparse_diff_write(struct MVHDMeta* vhdm, uint32_t offset, int num_sectors, void* in_buff);
 
+/**
+ * \brief Discard sectors of a dynamic VHD image
+ * 
+ * The sectors are marked as not present in their sector bitmaps, so they
+ * read back as zeroes, and their data is punched out of the host file where
+ * possible. Blocks stay allocated.
+ * 
+ * \param [in] vhdm MiniVHD data structure
+ * \param [in] offset Sector offset to discard from
+ * \param [in] num_sectors The desired number of sectors to discard
+ * 
+ * \retval 0 num_sectors were discarded
+ * \retval >0 < num_sectors were discarded
+ */
+int mvhd_sparse_discard(struct MVHDMeta* vhdm, uint32_t offset, int num_sectors);
+
 /**
  * \brief A no-op function to "write" to read-only VHD images
  * 
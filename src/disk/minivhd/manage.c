@@ -194,18 +194,47 @@ calc_sparse_values(MVHDMeta* vhdm)
 static int
 init_sector_bitmap(MVHDMeta* vhdm, MVHDError* err)
 {
-    vhdm->bitmap.curr_bitmap = calloc(vhdm->bitmap.sector_count, MVHD_SECTOR_SIZE);
-    if (vhdm->bitmap.curr_bitmap == NULL) {
+    vhdm->bitmap.blocks = calloc(vhdm->sparse.max_bat_ent, sizeof *vhdm->bitmap.blocks);
+    vhdm->bitmap.dirty = calloc(vhdm->sparse.max_bat_ent, 1);
+    if ((vhdm->bitmap.blocks == NULL) || (vhdm->bitmap.dirty == NULL)) {
+        free(vhdm->bitmap.blocks);
+        free(vhdm->bitmap.dirty);
+        vhdm->bitmap.blocks = NULL;
+        vhdm->bitmap.dirty = NULL;
         *err = MVHD_ERR_MEM;
         return -1;
     }
 
+    vhdm->bitmap.curr_bitmap = NULL;
     vhdm->bitmap.curr_block = -1;
+    vhdm->bitmap.num_dirty = 0;
 
     return 0;
 }
 
 
+/**
+ * \brief Free the sector bitmaps held in memory
+ *
+ * \param [in] vhdm MiniVHD data structure
+ */
+static void
+free_sector_bitmaps(MVHDMeta* vhdm)
+{
+    if (vhdm->bitmap.blocks != NULL) {
+        for (uint32_t i = 0; i < vhdm->sparse.max_bat_ent; i++)
+            free(vhdm->bitmap.blocks[i]);
+        free(vhdm->bitmap.blocks);
+        vhdm->bitmap.blocks = NULL;
+    }
+    if (vhdm->bitmap.dirty != NULL) {
+        free(vhdm->bitmap.dirty);
+        vhdm->bitmap.dirty = NULL;
+    }
+    vhdm->bitmap.curr_bitmap = NULL;
+}
+
+
 /**
  * \brief Check if the path for a given platform code exists
  *
@@ -595,8 +624,7 @@ cleanup_format_buff:
     vhdm->format_buffer.zero_data = NULL;
 
 cleanup_bitmap:
-    free(vhdm->bitmap.curr_bitmap);
-    vhdm->bitmap.curr_bitmap = NULL;
+    free_sector_bitmaps(vhdm);
 
 cleanup_bat:
     free(vhdm->block_offset);
@@ -624,16 +652,18 @@ mvhd_close(MVHDMeta* vhdm)
     if (vhdm->parent != NULL)
         mvhd_close(vhdm->parent);
 
+    if (!vhdm->readonly) {
+        mvhd_flush(vhdm);
+        mvhd_release_prealloc(vhdm);
+    }
+
     fclose(vhdm->f);
 
+    free_sector_bitmaps(vhdm);
     if (vhdm->block_offset != NULL) {
         free(vhdm->block_offset);
         vhdm->block_offset = NULL;
     }
-    if (vhdm->bitmap.curr_bitmap != NULL) {
-        free(vhdm->bitmap.curr_bitmap);
-        vhdm->bitmap.curr_bitmap = NULL;
-    }
     if (vhdm->format_buffer.zero_data != NULL) {
         free(vhdm->format_buffer.zero_data);
         vhdm->format_buffer.zero_data = NULL;
@@ -643,6 +673,24 @@ mvhd_close(MVHDMeta* vhdm)
 }
 
 
+MVHDAPI void
+mvhd_flush(MVHDMeta* vhdm)
+{
+    if (vhdm->readonly)
+        return;
+
+    mvhd_flush_metadata(vhdm);
+    fflush(vhdm->f);
+}
+
+
+MVHDAPI void
+mvhd_set_sparse_alloc(MVHDMeta* vhdm, int enable)
+{
+    vhdm->sparse_alloc = !!enable;
+}
+
+
 MVHDAPI int
 mvhd_diff_update_par_timestamp(MVHDMeta* vhdm, int* err)
 {
@@ -709,6 +757,17 @@ mvhd_format_sectors(MVHDMeta* vhdm, uint32_t offset, int num_sectors)
 }
 
 
+MVHDAPI int
+mvhd_discard_sectors(MVHDMeta* vhdm, uint32_t offset, int num_sectors)
+{
+    /* Cleared sectors of a differencing image would show the parent again. */
+    if ((vhdm->footer.disk_type == MVHD_TYPE_DYNAMIC) && (vhdm->write_sectors != mvhd_noop_write))
+        return mvhd_sparse_discard(vhdm, offset, num_sectors);
+
+    return mvhd_format_sectors(vhdm, offset, num_sectors);
+}
+
+
 MVHDAPI MVHDType
 mvhd_get_type(MVHDMeta* vhdm)
 {
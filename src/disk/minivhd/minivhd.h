@@ -259,6 +259,27 @@ MVHDAPI MVHDMeta* mvhd_create_ex(MVHDCreationOptions options, int* err);
  */
 MVHDAPI void mvhd_close(MVHDMeta* vhdm);
 
+/**
+ * \brief Write everything held in memory to the VHD file
+ *
+ * Sector bitmaps and BAT entries of sparse and differencing images are only
+ * written on a flush, or when the image is closed.
+ *
+ * \param [in] vhdm MiniVHD data structure
+ */
+MVHDAPI void mvhd_flush(MVHDMeta* vhdm);
+
+/**
+ * \brief Choose how a sparse or differencing image grows
+ *
+ * With sparse allocation, new blocks are not zero filled in the file, which
+ * leaves holes on host file systems that support sparse files.
+ *
+ * \param [in] vhdm MiniVHD data structure
+ * \param [in] enable Non-zero to enable sparse allocation
+ */
+MVHDAPI void mvhd_set_sparse_alloc(MVHDMeta* vhdm, int enable);
+
 /**
  * \brief Calculate hard disk geometry from a provided size
  *
@@ -395,6 +416,21 @@ MVHDAPI int mvhd_write_sectors(MVHDMeta* vhdm, uint32_t offset, int num_sectors,
  */
 MVHDAPI int mvhd_format_sectors(MVHDMeta* vhdm, uint32_t offset, int num_sectors);
 
+/**
+ * \brief Discard sectors of a VHD file
+ *
+ * Sectors of a dynamic VHD are marked as unused and their space is given
+ * back to the host where it supports that. Other VHD types get zeroed
+ * sectors written instead, as with mvhd_format_sectors().
+ *
+ * \param [in] vhdm MiniVHD data structure
+ * \param [in] offset the sector offset from which to start discarding
+ * \param [in] num_sectors the number of sectors to discard
+ *
+ * \return the number of sectors that were not discarded, or zero
+ */
+MVHDAPI int mvhd_discard_sectors(MVHDMeta* vhdm, uint32_t offset, int num_sectors);
+
 #ifdef __cplusplus
 }
 #endif
@@ -97,91 +97,140 @@ mvhd_write_empty_sectors(FILE *f, int sector_count)
 }
 
 /**
- * \brief Read the sector bitmap for a block.
+ * \brief Make the sector bitmap of a block the current one.
  *
- * If the block is sparse, the sector bitmap in memory will be
- * zeroed. Otherwise, the sector bitmap is read from the VHD file.
+ * Sector bitmaps are kept in memory once they have been read. If the block
+ * is sparse, its bitmap starts out zeroed. Otherwise, it is read from the
+ * VHD file.
  *
  * \param [in] vhdm MiniVHD data structure
  * \param [in] blk The block for which to read the sector bitmap from
+ *
+ * \return true if the bitmap is available, false if it could not be allocated
  */
-static void
+static bool
 read_sect_bitmap(MVHDMeta *vhdm, int blk)
 {
-    if (vhdm->block_offset[blk] != MVHD_SPARSE_BLK) {
-        mvhd_fseeko64(vhdm->f, (uint64_t)vhdm->block_offset[blk] * MVHD_SECTOR_SIZE, SEEK_SET);
-        if (!fread(vhdm->bitmap.curr_bitmap, vhdm->bitmap.sector_count * MVHD_SECTOR_SIZE, 1, vhdm->f))
+    uint8_t *bitmap = vhdm->bitmap.blocks[blk];
+
+    if (bitmap == NULL) {
+        bitmap = calloc(vhdm->bitmap.sector_count, MVHD_SECTOR_SIZE);
+        if (bitmap == NULL) {
             vhdm->error = 1;
-    } else
-        memset(vhdm->bitmap.curr_bitmap, 0, vhdm->bitmap.sector_count * MVHD_SECTOR_SIZE);
+            return false;
+        }
+
+        if (vhdm->block_offset[blk] != MVHD_SPARSE_BLK) {
+            mvhd_fseeko64(vhdm->f, (uint64_t)vhdm->block_offset[blk] * MVHD_SECTOR_SIZE, SEEK_SET);
+            if (!fread(bitmap, vhdm->bitmap.sector_count * MVHD_SECTOR_SIZE, 1, vhdm->f))
+                vhdm->error = 1;
+        }
 
+        vhdm->bitmap.blocks[blk] = bitmap;
+    }
+
+    vhdm->bitmap.curr_bitmap = bitmap;
     vhdm->bitmap.curr_block = blk;
+
+    return true;
 }
 
 /**
- * \brief Write the current sector bitmap in memory to file
+ * \brief Mark the sector bitmap of a block as needing to be written
  *
  * \param [in] vhdm MiniVHD data structure
+ * \param [in] blk The block whose bitmap was changed
  */
 static void
-write_curr_sect_bitmap(MVHDMeta* vhdm)
+mark_bitmap_dirty(MVHDMeta *vhdm, int blk)
 {
-    if (vhdm->bitmap.curr_block >= 0) {
-        int64_t abs_offset = (int64_t)vhdm->block_offset[vhdm->bitmap.curr_block] * MVHD_SECTOR_SIZE;
-        if (mvhd_fseeko64(vhdm->f, abs_offset, SEEK_SET) == -1)
-            vhdm->error = 1;
-        if (!fwrite(vhdm->bitmap.curr_bitmap, MVHD_SECTOR_SIZE, vhdm->bitmap.sector_count, vhdm->f))
-            vhdm->error = 1;
+    if (!vhdm->bitmap.dirty[blk]) {
+        vhdm->bitmap.dirty[blk] = 1;
+        vhdm->bitmap.num_dirty++;
     }
 }
 
 /**
- * \brief Write block offset from memory into file
+ * \brief Mark the BAT entry of a block as needing to be written
  *
  * \param [in] vhdm MiniVHD data structure
- * \param [in] blk The block for which to write the offset for
+ * \param [in] blk The block whose offset was changed
  */
 static void
-write_bat_entry(MVHDMeta *vhdm, int blk)
+mark_bat_dirty(MVHDMeta *vhdm, int blk)
 {
-    uint64_t table_offset = vhdm->sparse.bat_offset + ((uint64_t)blk * sizeof *vhdm->block_offset);
-    uint32_t offset = mvhd_to_be32(vhdm->block_offset[blk]);
+    if (!vhdm->bat_dirty.dirty) {
+        vhdm->bat_dirty.dirty = true;
+        vhdm->bat_dirty.first = vhdm->bat_dirty.last = blk;
+    } else if ((uint32_t) blk < vhdm->bat_dirty.first)
+        vhdm->bat_dirty.first = blk;
+    else if ((uint32_t) blk > vhdm->bat_dirty.last)
+        vhdm->bat_dirty.last = blk;
+}
 
-    if (mvhd_fseeko64(vhdm->f, table_offset, SEEK_SET) == -1)
-        vhdm->error = 1;
-    if (!fwrite(&offset, sizeof offset, 1, vhdm->f))
-        vhdm->error = 1;
-    fflush(vhdm->f);
+void
+mvhd_flush_metadata(MVHDMeta *vhdm)
+{
+    if (vhdm->block_offset == NULL)
+        return;
+
+    for (uint32_t i = 0; (i < vhdm->sparse.max_bat_ent) && (vhdm->bitmap.num_dirty > 0); i++) {
+        if (!vhdm->bitmap.dirty[i])
+            continue;
+
+        int64_t abs_offset = (int64_t)vhdm->block_offset[i] * MVHD_SECTOR_SIZE;
+        if (mvhd_fseeko64(vhdm->f, abs_offset, SEEK_SET) == -1)
+            vhdm->error = 1;
+        if (!fwrite(vhdm->bitmap.blocks[i], MVHD_SECTOR_SIZE, vhdm->bitmap.sector_count, vhdm->f))
+            vhdm->error = 1;
+
+        vhdm->bitmap.dirty[i] = 0;
+        vhdm->bitmap.num_dirty--;
+    }
+
+    if (vhdm->bat_dirty.dirty) {
+        uint32_t  count = vhdm->bat_dirty.last - vhdm->bat_dirty.first + 1;
+        uint32_t *entries = malloc(count * sizeof *entries);
+
+        if (entries == NULL) {
+            vhdm->error = 1;
+            return;
+        }
+
+        for (uint32_t i = 0; i < count; i++)
+            entries[i] = mvhd_to_be32(vhdm->block_offset[vhdm->bat_dirty.first + i]);
+
+        uint64_t table_offset = vhdm->sparse.bat_offset + ((uint64_t)vhdm->bat_dirty.first * sizeof *entries);
+        if (mvhd_fseeko64(vhdm->f, table_offset, SEEK_SET) == -1)
+            vhdm->error = 1;
+        if (!fwrite(entries, count * sizeof *entries, 1, vhdm->f))
+            vhdm->error = 1;
+
+        free(entries);
+        vhdm->bat_dirty.dirty = false;
+    }
 }
 
 /**
- * \brief Create an empty block in a sparse or differencing VHD image
- *
- * VHD images store data in blocks, which are typically 4096 sectors in size
- * (~2MB). These blocks may be stored on disk in any order. Blocks are created
- * on demand when required.
- *
- * This function creates new, empty blocks, by replacing the footer at the end of the file
- * and then re-inserting the footer at the new file end. The BAT table entry for the
- * new block is updated with the new offset.
+ * \brief Find the footer at the end of the file, and position the file where it starts
  *
  * \param [in] vhdm MiniVHD data structure
- * \param [in] blk The block number to create
+ * \param [out] footer Buffer to hold the footer
+ *
+ * \return The sector aligned offset of the footer
  */
-static void
-create_block(MVHDMeta *vhdm, int blk)
+static int64_t
+seek_footer(MVHDMeta *vhdm, uint8_t *footer)
 {
-    uint8_t footer[MVHD_FOOTER_SIZE] = { 0 };
-
     /* Seek to where the footer SHOULD be */
     mvhd_fseeko64(vhdm->f, -MVHD_FOOTER_SIZE, SEEK_END);
-    (void) !fread(footer, sizeof footer, 1, vhdm->f);
+    (void) !fread(footer, MVHD_FOOTER_SIZE, 1, vhdm->f);
     mvhd_fseeko64(vhdm->f, -MVHD_FOOTER_SIZE, SEEK_END);
 
     if (!mvhd_is_conectix_str(footer)) {
         /* Oh dear. We use the header instead, since something has gone wrong at the footer */
         mvhd_fseeko64(vhdm->f, 0, SEEK_SET);
-        if (!fread(footer, sizeof footer, 1, vhdm->f))
+        if (!fread(footer, MVHD_FOOTER_SIZE, 1, vhdm->f))
             vhdm->error = 1;
         mvhd_fseeko64(vhdm->f, 0, SEEK_END);
     }
@@ -198,24 +247,108 @@ create_block(MVHDMeta *vhdm, int blk)
         abs_offset += padding_amount;
     }
 
+    return abs_offset;
+}
+
+/**
+ * \brief Grow a sparse or differencing VHD image by an extent of empty blocks
+ *
+ * The extent of MVHD_PREALLOC_BLOCKS blocks takes the place of the footer,
+ * and the footer is re-inserted at the new file end. New blocks are then
+ * handed out from the extent, and whatever is left of it is trimmed off again
+ * when the image is closed.
+ *
+ * In sparse allocation mode the extent is skipped over rather than zero filled,
+ * which leaves a hole on host file systems that support sparse files.
+ *
+ * \param [in] vhdm MiniVHD data structure
+ *
+ * \return true if the extent was added
+ */
+static bool
+grow_file(MVHDMeta *vhdm)
+{
+    uint8_t footer[MVHD_FOOTER_SIZE] = { 0 };
+    int64_t abs_offset = seek_footer(vhdm, footer);
     uint32_t sect_offset = (uint32_t)(abs_offset / MVHD_SECTOR_SIZE);
-    int blk_size_sectors = vhdm->sparse.block_sz / MVHD_SECTOR_SIZE;
-    if (!mvhd_write_empty_sectors(vhdm->f, vhdm->bitmap.sector_count + blk_size_sectors))
-        vhdm->error = 1;
+    uint32_t extent = (vhdm->bitmap.sector_count + vhdm->sect_per_block) * MVHD_PREALLOC_BLOCKS;
 
-    /* Add a bit of padding. That's what Windows appears to do, although it's not strictly necessary... */
-    if (!mvhd_write_empty_sectors(vhdm->f, 5))
-        vhdm->error = 1;
+    if (vhdm->sparse_alloc) {
+        if (mvhd_fseeko64(vhdm->f, (int64_t)extent * MVHD_SECTOR_SIZE, SEEK_CUR) == -1)
+            vhdm->error = 1;
+    } else {
+        for (uint32_t i = 0; i < extent; i += vhdm->format_buffer.sector_count) {
+            uint32_t n = MIN(extent - i, (uint32_t) vhdm->format_buffer.sector_count);
+
+            if (!fwrite(vhdm->format_buffer.zero_data, MVHD_SECTOR_SIZE, n, vhdm->f))
+                vhdm->error = 1;
+        }
+    }
 
     /* And we finish with the footer */
     if (!fwrite(footer, sizeof footer, 1, vhdm->f))
         vhdm->error = 1;
 
+    if (vhdm->error)
+        return false;
+
+    vhdm->prealloc.next = sect_offset;
+    vhdm->prealloc.end = sect_offset + extent;
+
+    return true;
+}
+
+/**
+ * \brief Create an empty block in a sparse or differencing VHD image
+ *
+ * VHD images store data in blocks, which are typically 4096 sectors in size
+ * (~2MB). These blocks may be stored on disk in any order. Blocks are created
+ * on demand when required.
+ *
+ * This function hands out the next empty block of the current extent, growing
+ * the file first if the extent is used up. The BAT entry for the new block is
+ * written on the next metadata flush.
+ *
+ * \param [in] vhdm MiniVHD data structure
+ * \param [in] blk The block number to create
+ */
+static void
+create_block(MVHDMeta *vhdm, int blk)
+{
+    uint32_t blk_sectors = vhdm->bitmap.sector_count + vhdm->sect_per_block;
+
+    if (((vhdm->prealloc.end - vhdm->prealloc.next) < blk_sectors) && !grow_file(vhdm))
+        return;
+
     /* We no longer have a sparse block. Update that BAT! */
-    vhdm->block_offset[blk] = sect_offset;
-    write_bat_entry(vhdm, blk);
+    vhdm->block_offset[blk] = vhdm->prealloc.next;
+    vhdm->prealloc.next += blk_sectors;
+    mark_bat_dirty(vhdm, blk);
+}
+
+void
+mvhd_release_prealloc(MVHDMeta *vhdm)
+{
+    uint8_t footer[MVHD_FOOTER_SIZE] = { 0 };
+
+    if (vhdm->prealloc.next >= vhdm->prealloc.end)
+        return;
+
+    /* Move the footer back to the end of the last block handed out. */
+    if ((mvhd_fseeko64(vhdm->f, (int64_t)vhdm->prealloc.end * MVHD_SECTOR_SIZE, SEEK_SET) == -1) ||
+        !fread(footer, sizeof footer, 1, vhdm->f) || !mvhd_is_conectix_str(footer))
+        return;
+
+    int64_t new_end = (int64_t)vhdm->prealloc.next * MVHD_SECTOR_SIZE;
+    if ((mvhd_fseeko64(vhdm->f, new_end, SEEK_SET) == -1) || !fwrite(footer, sizeof footer, 1, vhdm->f))
+        return;
 
     fflush(vhdm->f);
+
+    /* If this fails, the old footer is still at the end of the file. */
+    (void) mvhd_ftruncate64(vhdm->f, new_end + MVHD_FOOTER_SIZE);
+
+    vhdm->prealloc.end = vhdm->prealloc.next;
 }
 
 int
@@ -247,38 +380,49 @@ mvhd_sparse_read(MVHDMeta *vhdm, uint32_t offset, int num_sectors, void *out_buf
 
     uint8_t* buff = (uint8_t*)out_buff;
     int64_t addr = 0ULL;
-    uint32_t s = 0;
-    uint32_t ls = 0;
-    int blk = 0;
-    int prev_blk = -1;
-    int sib = 0;
-    ls = offset + transfer_sectors;
+    uint32_t s = offset;
+    uint32_t ls = offset + transfer_sectors;
+
+    while (s < ls) {
+        int blk = s / vhdm->sect_per_block;
+        uint32_t sib = s % vhdm->sect_per_block;
+        uint32_t n = MIN(ls - s, vhdm->sect_per_block - sib);
+
+        if ((vhdm->block_offset[blk] == MVHD_SPARSE_BLK) || !read_sect_bitmap(vhdm, blk)) {
+            memset(buff, 0, n * MVHD_SECTOR_SIZE);
+            buff += n * MVHD_SECTOR_SIZE;
+            s += n;
+            continue;
+        }
 
-    for (s = offset; s < ls; s++) {
-        blk = s / vhdm->sect_per_block;
-        sib = s % vhdm->sect_per_block;
-        if (blk != prev_blk) {
-            prev_blk = blk;
-            if (vhdm->bitmap.curr_block != blk) {
-                read_sect_bitmap(vhdm, blk);
-                if (mvhd_fseeko64(vhdm->f, (uint64_t)sib * MVHD_SECTOR_SIZE, SEEK_CUR) == -1)
-                    vhdm->error = 1;
-            } else {
+        /* Runs of sectors that are present in the block are read in one go. */
+        while (n > 0) {
+            bool present = VHD_TESTBIT(vhdm->bitmap.curr_bitmap, sib);
+            uint32_t run = 1;
+
+            while (run < n) {
+                uint32_t k = sib + run;
+
+                if (!VHD_TESTBIT(vhdm->bitmap.curr_bitmap, k) != !present)
+                    break;
+                run++;
+            }
+
+            if (present) {
                 addr = (((int64_t) vhdm->block_offset[blk]) + vhdm->bitmap.sector_count + sib) *
                        MVHD_SECTOR_SIZE;
                 if (mvhd_fseeko64(vhdm->f, addr, SEEK_SET) == -1)
                     vhdm->error = 1;
-            }
-        }
+                if (!fread(buff, run * MVHD_SECTOR_SIZE, 1, vhdm->f) && !feof(vhdm->f))
+                    vhdm->error = 1;
+            } else
+                memset(buff, 0, run * MVHD_SECTOR_SIZE);
 
-        if (VHD_TESTBIT(vhdm->bitmap.curr_bitmap, sib)) {
-            if (!fread(buff, MVHD_SECTOR_SIZE, 1, vhdm->f) && !feof(vhdm->f))
-                vhdm->error = 1;
-        } else {
-            memset(buff, 0, MVHD_SECTOR_SIZE);
-            mvhd_fseeko64(vhdm->f, MVHD_SECTOR_SIZE, SEEK_CUR);
+            buff += run * MVHD_SECTOR_SIZE;
+            s += run;
+            sib += run;
+            n -= run;
         }
-        buff += MVHD_SECTOR_SIZE;
     }
 
     return truncated_sectors;
@@ -305,8 +449,9 @@ mvhd_diff_read(MVHDMeta *vhdm, uint32_t offset, int num_sectors, void *out_buff)
         while (curr_vhdm->footer.disk_type == MVHD_TYPE_DIFF) {
             blk = s / curr_vhdm->sect_per_block;
             sib = s % curr_vhdm->sect_per_block;
-            if (curr_vhdm->bitmap.curr_block != blk) {
-                read_sect_bitmap(curr_vhdm, blk);
+            if ((curr_vhdm->bitmap.curr_block != blk) && !read_sect_bitmap(curr_vhdm, blk)) {
+                curr_vhdm = curr_vhdm->parent;
+                continue;
             }
             if (!VHD_TESTBIT(curr_vhdm->bitmap.curr_bitmap, sib)) {
                 curr_vhdm = curr_vhdm->parent;
@@ -347,7 +492,6 @@ mvhd_fixed_write(MVHDMeta *vhdm, uint32_t offset, int num_sectors, void *in_buff
         vhdm->error = 1;
     if (!fwrite(in_buff, transfer_sectors * MVHD_SECTOR_SIZE, 1, vhdm->f))
         vhdm->error = 1;
-    fflush(vhdm->f);
 
     return truncated_sectors;
 }
@@ -363,55 +507,92 @@ mvhd_sparse_diff_write(MVHDMeta *vhdm, uint32_t offset, int num_sectors, void *i
 
     uint8_t* buff = (uint8_t *) in_buff;
     int64_t addr = 0ULL;
-    uint32_t s = 0;
-    uint32_t ls = 0;
-    int blk = 0;
-    int prev_blk = -1;
-    int sib = 0;
-    ls = offset + transfer_sectors;
+    uint32_t s = offset;
+    uint32_t ls = offset + transfer_sectors;
 
-    if (offset < total_sectors) {
-        for (s = offset; s < ls; s++) {
-            blk = s / vhdm->sect_per_block;
-            sib = s % vhdm->sect_per_block;
-            if (vhdm->bitmap.curr_block != blk && prev_blk >= 0) {
-                /* Write the sector bitmap for the previous block, before we replace it. */
-                write_curr_sect_bitmap(vhdm);
-            }
+    if (offset >= total_sectors)
+        return truncated_sectors;
 
+    /* The data of each block is written in one go, the sector bitmaps and
+       BAT entries only on the next metadata flush. */
+    while (s < ls) {
+        int blk = s / vhdm->sect_per_block;
+        uint32_t sib = s % vhdm->sect_per_block;
+        uint32_t n = MIN(ls - s, vhdm->sect_per_block - sib);
+
+        if (!read_sect_bitmap(vhdm, blk))
+            break;
+
+        if (vhdm->block_offset[blk] == MVHD_SPARSE_BLK) {
+            create_block(vhdm, blk);
             if (vhdm->block_offset[blk] == MVHD_SPARSE_BLK) {
-                /* "read" the sector bitmap first, before creating a new block, as the bitmap will be
-                   zero either way */
-                read_sect_bitmap(vhdm, blk);
-                create_block(vhdm, blk);
+                vhdm->error = 1;
+                break;
             }
+        }
 
-            if (blk != prev_blk) {
-                if (vhdm->bitmap.curr_block != blk) {
-                    read_sect_bitmap(vhdm, blk);
-                    if (mvhd_fseeko64(vhdm->f, (uint64_t)sib * MVHD_SECTOR_SIZE, SEEK_CUR) == -1)
-                        vhdm->error = 1;
-                } else {
-                    addr = (((int64_t) vhdm->block_offset[blk]) + vhdm->bitmap.sector_count + sib) *
-                           MVHD_SECTOR_SIZE;
-                    if (mvhd_fseeko64(vhdm->f, addr, SEEK_SET) == -1)
-                        vhdm->error = 1;
-                }
-                prev_blk = blk;
-            }
+        addr = (((int64_t) vhdm->block_offset[blk]) + vhdm->bitmap.sector_count + sib) *
+               MVHD_SECTOR_SIZE;
+        if (mvhd_fseeko64(vhdm->f, addr, SEEK_SET) == -1)
+            vhdm->error = 1;
+        if (!fwrite(buff, n * MVHD_SECTOR_SIZE, 1, vhdm->f))
+            vhdm->error = 1;
 
-            if (!fwrite(buff, MVHD_SECTOR_SIZE, 1, vhdm->f))
-                vhdm->error = 1;
-            VHD_SETBIT(vhdm->bitmap.curr_bitmap, sib);
-            buff += MVHD_SECTOR_SIZE;
+        for (uint32_t i = 0; i < n; i++) {
+            uint32_t k = sib + i;
+
+            VHD_SETBIT(vhdm->bitmap.curr_bitmap, k);
         }
+        mark_bitmap_dirty(vhdm, blk);
+
+        buff += n * MVHD_SECTOR_SIZE;
+        s += n;
     }
 
-    /* And write the sector bitmap for the last block we visited to disk */
-    write_curr_sect_bitmap(vhdm);
+    return truncated_sectors;
+}
+
+int
+mvhd_sparse_discard(MVHDMeta *vhdm, uint32_t offset, int num_sectors)
+{
+    int transfer_sectors = 0;
+    int truncated_sectors = 0;
+    uint32_t total_sectors = (uint32_t)(vhdm->footer.curr_sz / MVHD_SECTOR_SIZE);
+
+    if (offset >= total_sectors)
+        return num_sectors;
+
+    check_sectors(offset, num_sectors, total_sectors, &transfer_sectors, &truncated_sectors);
+
+    uint32_t s = offset;
+    uint32_t ls = offset + transfer_sectors;
 
     fflush(vhdm->f);
 
+    while (s < ls) {
+        int blk = s / vhdm->sect_per_block;
+        uint32_t sib = s % vhdm->sect_per_block;
+        uint32_t n = MIN(ls - s, vhdm->sect_per_block - sib);
+
+        /* Sparse blocks already read back as zeroes. */
+        if ((vhdm->block_offset[blk] != MVHD_SPARSE_BLK) && read_sect_bitmap(vhdm, blk)) {
+            int64_t addr = (((int64_t) vhdm->block_offset[blk]) + vhdm->bitmap.sector_count + sib) *
+                           MVHD_SECTOR_SIZE;
+
+            for (uint32_t i = 0; i < n; i++) {
+                uint32_t k = sib + i;
+
+                VHD_CLEARBIT(vhdm->bitmap.curr_bitmap, k);
+            }
+            mark_bitmap_dirty(vhdm, blk);
+
+            /* The bitmap alone is enough, this only gives the space back. */
+            (void) mvhd_punch_hole(vhdm->f, addr, (int64_t) n * MVHD_SECTOR_SIZE);
+        }
+
+        s += n;
+    }
+
     return truncated_sectors;
 }
 
@@ -46,6 +46,17 @@
 #include <time.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#ifdef _WIN32
+#    include <windows.h>
+#    include <winioctl.h>
+#    include <io.h>
+#else
+#    include <fcntl.h>
+#    include <unistd.h>
+#    ifdef __linux__
+#        include <linux/falloc.h>
+#    endif
+#endif
 #include "minivhd.h"
 #include "internal.h"
 #include "xml2_encoding.h"
@@ -417,6 +428,133 @@ mvhd_ftello64(FILE* stream)
 }
 
 
+int
+mvhd_ftruncate64(FILE* stream, int64_t size)
+{
+#ifdef _WIN32
+    return _chsize_s(_fileno(stream), size) ? -1 : 0;
+#else
+    return ftruncate(fileno(stream), (off_t) size);
+#endif
+}
+
+
+int
+mvhd_punch_hole(FILE* stream, int64_t offset, int64_t len)
+{
+#ifdef _WIN32
+    HANDLE                     h = (HANDLE) _get_osfhandle(_fileno(stream));
+    FILE_ZERO_DATA_INFORMATION zd;
+    DWORD                      ret;
+
+    if (h == INVALID_HANDLE_VALUE)
+        return -1;
+
+    if (!DeviceIoControl(h, FSCTL_SET_SPARSE, NULL, 0, NULL, 0, &ret, NULL))
+        return -1;
+
+    zd.FileOffset.QuadPart      = offset;
+    zd.BeyondFinalZero.QuadPart = offset + len;
+
+    return DeviceIoControl(h, FSCTL_SET_ZERO_DATA, &zd, sizeof(zd), NULL, 0, &ret, NULL) ? 0 : -1;
+#elif defined(FALLOC_FL_PUNCH_HOLE) && defined(FALLOC_FL_KEEP_SIZE)
+    return fallocate(fileno(stream), FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, (off_t) offset, (off_t) len);
+#else
+    (void) stream;
+    (void) offset;
+    (void) len;
+
+    return -1;
+#endif
+}
+
+
+void
+mvhd_set_sparse(FILE* stream)
+{
+#ifdef _WIN32
+    HANDLE h = (HANDLE) _get_osfhandle(_fileno(stream));
+    DWORD  ret;
+
+    if (h != INVALID_HANDLE_VALUE)
+        (void) DeviceIoControl(h, FSCTL_SET_SPARSE, NULL, 0, NULL, 0, &ret, NULL);
+#else
+    (void) stream;
+#endif
+}
+
+
+int64_t
+mvhd_next_data(FILE* stream, int64_t offset, int64_t* data_end)
+{
+#ifdef _WIN32
+    HANDLE                         h = (HANDLE) _get_osfhandle(_fileno(stream));
+    FILE_ALLOCATED_RANGE_BUFFER    query;
+    FILE_ALLOCATED_RANGE_BUFFER    range;
+    LARGE_INTEGER                  size;
+    DWORD                          ret;
+
+    if ((h == INVALID_HANDLE_VALUE) || !GetFileSizeEx(h, &size))
+        return -1;
+
+    if (offset >= size.QuadPart) {
+        *data_end = size.QuadPart;
+        return size.QuadPart;
+    }
+
+    query.FileOffset.QuadPart = offset;
+    query.Length.QuadPart     = size.QuadPart - offset;
+
+    /* Only the first range is needed, ERROR_MORE_DATA just says there are more. */
+    if (!DeviceIoControl(h, FSCTL_QUERY_ALLOCATED_RANGES, &query, sizeof(query), &range, sizeof(range), &ret, NULL) &&
+        (GetLastError() != ERROR_MORE_DATA))
+        return -1;
+
+    if (ret < sizeof(range)) {
+        *data_end = size.QuadPart;
+        return size.QuadPart;
+    }
+
+    if (range.FileOffset.QuadPart < offset) {
+        range.Length.QuadPart -= offset - range.FileOffset.QuadPart;
+        range.FileOffset.QuadPart = offset;
+    }
+    *data_end = range.FileOffset.QuadPart + range.Length.QuadPart;
+
+    return range.FileOffset.QuadPart;
+#elif defined(SEEK_DATA) && defined(SEEK_HOLE)
+    int   fd = fileno(stream);
+    off_t start;
+    off_t end;
+
+    start = lseek(fd, (off_t) offset, SEEK_DATA);
+    if (start < 0) {
+        /* ENXIO means there is no data past the offset. */
+        if (errno != ENXIO)
+            return -1;
+        end = lseek(fd, 0, SEEK_END);
+        if (end < 0)
+            return -1;
+        *data_end = (int64_t) end;
+        return (int64_t) end;
+    }
+
+    end = lseek(fd, start, SEEK_HOLE);
+    if (end < 0)
+        return -1;
+    *data_end = (int64_t) end;
+
+    return (int64_t) start;
+#else
+    (void) stream;
+    (void) offset;
+    (void) data_end;
+
+    return -1;
+#endif
+}
+
+
 int
 mvhd_fseeko64(FILE* stream, int64_t offset, int origin)
 {
@@ -36,6 +36,7 @@
 #include <86box/ui.h>
 #include <86box/hdc_ide.h>
 #include <86box/mo.h>
+#include <86box/io_stats.h>
 #include <86box/version.h>
 
 #ifdef _WIN32
@@ -249,8 +250,11 @@ mo_disk_close(const mo_t *dev)
 }
 
 static void
-mo_set_callback(const mo_t *dev)
+mo_set_callback(mo_t *dev)
 {
+    if (dev->drv->instant && (dev->callback > SCSI_INSTANT_TIME))
+        dev->callback = SCSI_INSTANT_TIME;
+
     if (dev->drv->bus_type != MO_BUS_SCSI)
         ide_set_callback(ide_drives[dev->drv->ide_channel], dev->callback);
 }
@@ -795,7 +799,8 @@ mo_invalid_field_pl(mo_t *dev, const uint32_t field)
 static int
 mo_blocks(mo_t *dev, int32_t *len, int out)
 {
-    int ret = 0;
+    uint64_t start;
+    int      ret = 0;
 
     *len    = 0;
 
@@ -809,8 +814,9 @@ mo_blocks(mo_t *dev, int32_t *len, int out)
             mo_log(dev->log, "Trying to %s beyond the end of disk\n", out ? "write" : "read");
             mo_lba_out_of_range(dev);
         } else {
-            *len = dev->requested_blocks * dev->drv->sector_size;
-            ret  = 1;
+            *len  = dev->requested_blocks * dev->drv->sector_size;
+            ret   = 1;
+            start = plat_get_ticks_us();
 
             for (int i = 0; i < dev->requested_blocks; i++) {
                 if (fseek(dev->drv->fp, dev->drv->base + (dev->sector_pos * dev->drv->sector_size) + (i * dev->drv->sector_size), SEEK_SET) == -1) {
@@ -851,6 +857,8 @@ mo_blocks(mo_t *dev, int32_t *len, int out)
             if (ret == 1) {
                 mo_log(dev->log, "%s %i bytes of blocks...\n", out ? "Written" : "Read", *len);
 
+                io_stats_transfer(&mo_io_stats[dev->id], out, *len, plat_get_ticks_us() - start);
+
                 dev->sector_len -= dev->requested_blocks;
             }
         }
@@ -32,6 +32,7 @@
 #include <86box/ui.h>
 #include <86box/hdc_ide.h>
 #include <86box/zip.h>
+#include <86box/io_stats.h>
 
 #define IDE_ATAPI_IS_EARLY             id->sc->pad0
 
@@ -306,8 +307,11 @@ zip_disk_close(const zip_t *dev)
 }
 
 static void
-zip_set_callback(const zip_t *dev)
+zip_set_callback(zip_t *dev)
 {
+    if (dev->drv->instant && (dev->callback > SCSI_INSTANT_TIME))
+        dev->callback = SCSI_INSTANT_TIME;
+
     if (dev->drv->bus_type != ZIP_BUS_SCSI)
         ide_set_callback(ide_drives[dev->drv->ide_channel], dev->callback);
 }
@@ -895,8 +899,9 @@ zip_data_phase_error(zip_t *dev, const uint32_t info)
 static int
 zip_blocks(zip_t *dev, int32_t *len, const int out)
 {
-    int ret = 1;
-    *len    = 0;
+    uint64_t start;
+    int      ret = 1;
+    *len         = 0;
 
     if (!dev->sector_len)
         zip_command_complete(dev);
@@ -910,6 +915,7 @@ zip_blocks(zip_t *dev, int32_t *len, const int out)
             zip_lba_out_of_range(dev);
         } else {
             *len    = dev->requested_blocks << 9;
+            start   = plat_get_ticks_us();
 
             for (int i = 0; i < dev->requested_blocks; i++) {
                 if (fseek(dev->drv->fp, dev->drv->base + (dev->sector_pos << 9) +
@@ -949,6 +955,8 @@ zip_blocks(zip_t *dev, int32_t *len, const int out)
                 zip_log(dev->log, "%s %i bytes of blocks...\n", out ? "Written" :
                         "Read", *len);
 
+                io_stats_transfer(&zip_io_stats[dev->id], out, *len, plat_get_ticks_us() - start);
+
                 dev->sector_len -= dev->requested_blocks;
             }
         }
@@ -34,6 +34,8 @@
 #include <86box/pic.h>
 #include <86box/dma.h>
 #include <86box/plat_unused.h>
+#include <86box/timer.h>
+#include <86box/snapshot.h>
 
 dma_t   dma[8];
 uint8_t dma_e;
@@ -80,7 +82,7 @@ dma_log(const char *fmt, ...)
 
     if (dma_do_log) {
         va_start(ap, fmt);
-        pclog_ex(fmt, ap);
+        pclog_fast_ex(fmt, ap);
         va_end(ap);
     }
 }
@@ -1153,6 +1155,40 @@ dma_reset(void)
     dma_at = is286;
 }
 
+void
+dma_snapshot_save(snapshot_t *s)
+{
+    snapshot_write(s, dma, sizeof(dma));
+    snapshot_write(s, &dma_e, sizeof(dma_e));
+    snapshot_write(s, &dma_m, sizeof(dma_m));
+    snapshot_write(s, dmaregs, sizeof(dmaregs));
+    snapshot_write(s, dma_wp, sizeof(dma_wp));
+    snapshot_write(s, &dma_stat, sizeof(dma_stat));
+    snapshot_write(s, &dma_stat_rq, sizeof(dma_stat_rq));
+    snapshot_write(s, &dma_stat_rq_pc, sizeof(dma_stat_rq_pc));
+    snapshot_write(s, &dma_stat_adv_pend, sizeof(dma_stat_adv_pend));
+    snapshot_write(s, dma_command, sizeof(dma_command));
+    snapshot_write(s, &dma_req_is_soft, sizeof(dma_req_is_soft));
+    snapshot_write(s, &dma_ps2, sizeof(dma_ps2));
+}
+
+int
+dma_snapshot_load(snapshot_t *s)
+{
+    return snapshot_read(s, dma, sizeof(dma)) &&
+           snapshot_read(s, &dma_e, sizeof(dma_e)) &&
+           snapshot_read(s, &dma_m, sizeof(dma_m)) &&
+           snapshot_read(s, dmaregs, sizeof(dmaregs)) &&
+           snapshot_read(s, dma_wp, sizeof(dma_wp)) &&
+           snapshot_read(s, &dma_stat, sizeof(dma_stat)) &&
+           snapshot_read(s, &dma_stat_rq, sizeof(dma_stat_rq)) &&
+           snapshot_read(s, &dma_stat_rq_pc, sizeof(dma_stat_rq_pc)) &&
+           snapshot_read(s, &dma_stat_adv_pend, sizeof(dma_stat_adv_pend)) &&
+           snapshot_read(s, dma_command, sizeof(dma_command)) &&
+           snapshot_read(s, &dma_req_is_soft, sizeof(dma_req_is_soft)) &&
+           snapshot_read(s, &dma_ps2, sizeof(dma_ps2));
+}
+
 void
 dma_remove_sg(void)
 {
@@ -1587,27 +1623,37 @@ dma_channel_advance(int channel)
     return tc;
 }
 
-int
-dma_channel_read(int channel)
+/* Checks whether the channel would accept a memory to device transfer. */
+static int
+dma_channel_can_read(int channel)
 {
-    dma_t   *dma_c = &dma[channel];
-    uint16_t temp;
-    int      tc = 0;
+    const dma_t *dma_c = &dma[channel];
 
     if (channel < 4) {
         if (dma_command[0] & 0x04)
-            return (DMA_NODATA);
+            return 0;
     } else {
         if (dma_command[1] & 0x04)
-            return (DMA_NODATA);
+            return 0;
     }
 
     if (!(dma_e & (1 << channel)))
-        return (DMA_NODATA);
+        return 0;
     if ((dma_m & (1 << channel)) && !dma_req_is_soft)
-        return (DMA_NODATA);
+        return 0;
     if ((dma_c->mode & 0xC) != 8)
-        return (DMA_NODATA);
+        return 0;
+
+    return 1;
+}
+
+/* Transfers one unit, the caller has already checked the channel state. */
+static int
+dma_channel_read_unit(int channel)
+{
+    dma_t   *dma_c = &dma[channel];
+    uint16_t temp;
+    int      tc = 0;
 
     if (dma_stat_adv_pend & (1 << channel))
         dma_channel_advance(channel);
@@ -1682,6 +1728,41 @@ dma_channel_read(int channel)
     return temp;
 }
 
+int
+dma_channel_read(int channel)
+{
+    if (!dma_channel_can_read(channel))
+        return (DMA_NODATA);
+
+    return dma_channel_read_unit(channel);
+}
+
+/*
+ * Reads up to n units in one go, for devices that consume more than one
+ * unit per sample. Every unit still goes through the address and count
+ * registers, so what the guest sees is the same as for n separate reads.
+ * Stops after the unit that reaches terminal count, returns the number of
+ * units read with DMA_OVER set in that case, or DMA_NODATA.
+ */
+int
+dma_channel_read_n(int channel, uint16_t *buf, int n)
+{
+    int i;
+
+    if (!dma_channel_can_read(channel))
+        return (DMA_NODATA);
+
+    for (i = 0; i < n; i++) {
+        int temp = dma_channel_read_unit(channel);
+
+        buf[i] = temp & 0xffff;
+        if (temp & DMA_OVER)
+            return ((i + 1) | DMA_OVER);
+    }
+
+    return i;
+}
+
 int
 dma_channel_write(int channel, uint16_t val)
 {
@@ -1877,8 +1958,20 @@ dma_bm_read(uint32_t PhysAddress, uint8_t *DataRead, uint32_t TotalSize, int Tra
     n2 = TotalSize - n;
 
     /* Do the divisible block, if there is one. */
-    if (n) {
-        for (uint32_t i = 0; i < n; i += TransferSize)
+    for (uint32_t i = 0; i < n;) {
+        uint32_t span;
+        uint8_t *p = mem_span_map(PhysAddress + i, n - i, &span, 0);
+
+        if (p != NULL) {
+            span &= ~(TransferSize - 1);
+            if (span) {
+                memcpy(&(DataRead[i]), p, span);
+                i += span;
+                continue;
+            }
+            span = TransferSize;
+        }
+        for (uint32_t end = i + span; i < end; i += TransferSize)
             mem_read_phys((void *) &(DataRead[i]), PhysAddress + i, TransferSize);
     }
 
@@ -1900,8 +1993,21 @@ dma_bm_write(uint32_t PhysAddress, const uint8_t *DataWrite, uint32_t TotalSize,
     n2 = TotalSize - n;
 
     /* Do the divisible block, if there is one. */
-    if (n) {
-        for (uint32_t i = 0; i < n; i += TransferSize)
+    for (uint32_t i = 0; i < n;) {
+        uint32_t span;
+        uint8_t *p = mem_span_map(PhysAddress + i, n - i, &span, 1);
+
+        if (p != NULL) {
+            span &= ~(TransferSize - 1);
+            if (span) {
+                memcpy(p, &(DataWrite[i]), span);
+                mem_span_written(PhysAddress + i, span);
+                i += span;
+                continue;
+            }
+            span = TransferSize;
+        }
+        for (uint32_t end = i + span; i < end; i += TransferSize)
             mem_write_phys((void *) &(DataWrite[i]), PhysAddress + i, TransferSize);
     }
 
@@ -1915,3 +2021,18 @@ dma_bm_write(uint32_t PhysAddress, const uint8_t *DataWrite, uint32_t TotalSize,
     if (dma_at)
         mem_invalidate_range(PhysAddress, PhysAddress + TotalSize - 1);
 }
+
+/*
+ * Reads into a power of two sized ring buffer, such as a sound card FIFO,
+ * starting at ring offset pos and wrapping around its end.
+ */
+void
+dma_bm_read_ring(uint32_t PhysAddress, uint8_t *ring, uint32_t ring_size, uint32_t pos, uint32_t TotalSize, int TransferSize)
+{
+    uint32_t off   = pos & (ring_size - 1);
+    uint32_t first = MIN(TotalSize, ring_size - off);
+
+    dma_bm_read(PhysAddress, &ring[off], first, TransferSize);
+    if (TotalSize > first)
+        dma_bm_read(PhysAddress + first, ring, TotalSize - first, TransferSize);
+}
@@ -0,0 +1,304 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Device event bus.
+ *
+ *          The jobs are coarse, a page or a run of sectors at a time,
+ *          so a single lock over the queues costs next to nothing next
+ *          to the work itself. The completions are kept in the order
+ *          they are due in, and ties go in the order they were posted,
+ *          so they always run in the same order.
+ */
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <wchar.h>
+#include <86box/86box.h>
+#include <86box/plat_unused.h>
+#include <86box/thread.h>
+#include <86box/timer.h>
+#include <86box/evbus.h>
+
+typedef struct evbus_job_t {
+    void (*work)(void *priv);
+    void (*done)(void *priv);
+    void         *priv;
+    uint64_t      when; /* TSC the completion is due at. */
+    int           finished;
+    evbus_chan_t *ch;
+
+    struct evbus_job_t *next;      /* In the channel's queue. */
+    struct evbus_job_t *next_done; /* In the completion list. */
+} evbus_job_t;
+
+struct evbus_chan_t {
+    evbus_job_t *head; /* Queued, and not started yet. */
+    evbus_job_t *tail;
+    int          jobs; /* Not finished yet. */
+    int          running;
+    int          ready;
+
+    struct evbus_chan_t *next_ready;
+};
+
+static mutex_t      *evbus_lock = NULL;
+static event_t      *evbus_wake = NULL;
+static event_t      *evbus_idle = NULL;
+static thread_t     *evbus_workers[EVBUS_WORKERS];
+static atomic_int    evbus_run;
+static evbus_chan_t *evbus_ready_head = NULL;
+static evbus_chan_t *evbus_ready_tail = NULL;
+static evbus_job_t  *evbus_done_head  = NULL;
+static atomic_int    evbus_done_num;
+
+/* Hands the channel to the workers if it has something to run, and is
+   not already running or waiting to. Called with the lock held. */
+static void
+evbus_chan_ready(evbus_chan_t *ch)
+{
+    if (ch->ready || ch->running || (ch->head == NULL))
+        return;
+
+    ch->ready      = 1;
+    ch->next_ready = NULL;
+    if (evbus_ready_tail != NULL)
+        evbus_ready_tail->next_ready = ch;
+    else
+        evbus_ready_head = ch;
+    evbus_ready_tail = ch;
+
+    thread_set_event(evbus_wake);
+}
+
+static void
+evbus_worker_thread(UNUSED(void *priv))
+{
+    evbus_chan_t *ch;
+    evbus_job_t  *job = NULL;
+
+    while (1) {
+        thread_wait_mutex(evbus_lock);
+        if ((ch = evbus_ready_head) != NULL) {
+            evbus_ready_head = ch->next_ready;
+            if (evbus_ready_head == NULL)
+                evbus_ready_tail = NULL;
+            ch->ready = 0;
+
+            job      = ch->head;
+            ch->head = job->next;
+            if (ch->head == NULL)
+                ch->tail = NULL;
+            ch->running = 1;
+        }
+        thread_release_mutex(evbus_lock);
+
+        if (ch == NULL) {
+            if (!atomic_load(&evbus_run))
+                break;
+            thread_wait_event(evbus_wake, -1);
+            thread_reset_event(evbus_wake);
+            continue;
+        }
+
+        job->work(job->priv);
+
+        thread_wait_mutex(evbus_lock);
+        ch->running = 0;
+        ch->jobs--;
+        evbus_chan_ready(ch);
+        /* A job with a completion is freed once that has run. */
+        job->finished = 1;
+        if (job->done == NULL)
+            free(job);
+        thread_release_mutex(evbus_lock);
+
+        thread_set_event(evbus_idle);
+    }
+}
+
+evbus_chan_t *
+evbus_chan_create(void)
+{
+    return (evbus_chan_t *) calloc(1, sizeof(evbus_chan_t));
+}
+
+int
+evbus_chan_jobs(evbus_chan_t *ch)
+{
+    int jobs;
+
+    if (evbus_lock == NULL)
+        return 0;
+
+    thread_wait_mutex(evbus_lock);
+    jobs = ch->jobs;
+    thread_release_mutex(evbus_lock);
+
+    return jobs;
+}
+
+void
+evbus_chan_wait(evbus_chan_t *ch, int limit)
+{
+    if (evbus_lock == NULL)
+        return;
+
+    while (1) {
+        thread_reset_event(evbus_idle);
+        if (evbus_chan_jobs(ch) <= limit)
+            break;
+        thread_wait_event(evbus_idle, 1);
+    }
+}
+
+void
+evbus_chan_destroy(evbus_chan_t *ch)
+{
+    evbus_job_t **p;
+    evbus_job_t  *job;
+
+    if (ch == NULL)
+        return;
+
+    evbus_chan_wait(ch, 0);
+
+    if (evbus_lock != NULL) {
+        thread_wait_mutex(evbus_lock);
+        p = &evbus_done_head;
+        while ((job = *p) != NULL) {
+            if (job->ch == ch) {
+                *p = job->next_done;
+                atomic_fetch_sub(&evbus_done_num, 1);
+                free(job);
+            } else
+                p = &job->next_done;
+        }
+        thread_release_mutex(evbus_lock);
+    }
+
+    free(ch);
+}
+
+void
+evbus_post(evbus_chan_t *ch, void (*work)(void *priv), void (*done)(void *priv), void *priv, double delay_us)
+{
+    evbus_job_t  *job;
+    evbus_job_t **p;
+
+    /* No workers, so there is no one to hand the work to. */
+    if (evbus_lock == NULL) {
+        work(priv);
+        if (done != NULL)
+            done(priv);
+        return;
+    }
+
+    job       = (evbus_job_t *) calloc(1, sizeof(evbus_job_t));
+    job->work = work;
+    job->done = done;
+    job->priv = priv;
+    job->when = tsc + (((uint64_t) (delay_us * (double) TIMER_USEC)) >> 32);
+    job->ch   = ch;
+
+    thread_wait_mutex(evbus_lock);
+
+    if (ch->tail != NULL)
+        ch->tail->next = job;
+    else
+        ch->head = job;
+    ch->tail = job;
+    ch->jobs++;
+
+    if (done != NULL) {
+        /* After everything due at the same time or earlier. */
+        p = &evbus_done_head;
+        while ((*p != NULL) && ((int64_t) ((*p)->when - job->when) <= 0))
+            p = &(*p)->next_done;
+        job->next_done = *p;
+        *p             = job;
+        atomic_fetch_add(&evbus_done_num, 1);
+    }
+
+    evbus_chan_ready(ch);
+
+    thread_release_mutex(evbus_lock);
+}
+
+void
+evbus_dispatch(void)
+{
+    evbus_job_t *job;
+    int          finished;
+
+    if (!atomic_load_explicit(&evbus_done_num, memory_order_relaxed))
+        return;
+
+    while (1) {
+        thread_wait_mutex(evbus_lock);
+        job = evbus_done_head;
+        if ((job == NULL) || ((int64_t) (job->when - tsc) > 0)) {
+            thread_release_mutex(evbus_lock);
+            break;
+        }
+        thread_release_mutex(evbus_lock);
+
+        /* Due, so the guest has to see it now, whatever the host is up to. */
+        while (1) {
+            thread_reset_event(evbus_idle);
+            thread_wait_mutex(evbus_lock);
+            finished = job->finished;
+            thread_release_mutex(evbus_lock);
+            if (finished)
+                break;
+            thread_wait_event(evbus_idle, 1);
+        }
+
+        thread_wait_mutex(evbus_lock);
+        evbus_done_head = job->next_done;
+        thread_release_mutex(evbus_lock);
+        atomic_fetch_sub(&evbus_done_num, 1);
+
+        job->done(job->priv);
+        free(job);
+    }
+}
+
+void
+evbus_init(void)
+{
+    if (evbus_lock != NULL)
+        return;
+
+    evbus_lock = thread_create_mutex();
+    evbus_wake = thread_create_event();
+    evbus_idle = thread_create_event();
+    atomic_store(&evbus_done_num, 0);
+    atomic_store(&evbus_run, 1);
+
+    for (int i = 0; i < EVBUS_WORKERS; i++)
+        evbus_workers[i] = thread_create_role(evbus_worker_thread, NULL, THREAD_ROLE_WORKER);
+}
+
+/* The channels are all expected to be gone by now. */
+void
+evbus_close(void)
+{
+    if (evbus_lock == NULL)
+        return;
+
+    atomic_store(&evbus_run, 0);
+    thread_set_event(evbus_wake);
+    for (int i = 0; i < EVBUS_WORKERS; i++)
+        thread_wait(evbus_workers[i]);
+
+    thread_destroy_event(evbus_wake);
+    thread_destroy_event(evbus_idle);
+    thread_close_mutex(evbus_lock);
+    evbus_lock = NULL;
+}
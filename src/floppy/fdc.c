@@ -17,6 +17,7 @@
  *          Copyright 2008-2020 Sarah Walker.
  *          Copyright 2016-2020 Miran Grca.
  */
+#include <stddef.h>
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
@@ -39,6 +40,7 @@
 #include <86box/plat_fallthrough.h>
 #include <86box/plat_unused.h>
 #include <86box/fifo.h>
+#include <86box/snapshot.h>
 
 extern uint64_t motoron[FDD_NUM];
 
@@ -1898,6 +1900,12 @@ fdc_is_verify(fdc_t *fdc)
     return (fdc->deleted & 2) ? 1 : 0;
 }
 
+int
+fdc_is_dma(fdc_t *fdc)
+{
+    return !(fdc->flags & FDC_FLAG_PCJR) && fdc->dma;
+}
+
 int
 fdc_data(fdc_t *fdc, uint8_t data, int last)
 {
@@ -2338,6 +2346,58 @@ fdc_close(void *priv)
     free(fdc);
 }
 
+static void
+fdc_save(void *priv, snapshot_t *s)
+{
+    fdc_t    *fdc  = (fdc_t *) priv;
+    fifo16_t *fifo = (fifo16_t *) fdc->fifo_p;
+
+    snapshot_write(s, fdc, offsetof(fdc_t, fifo_p));
+    snapshot_write(s, &fdc->fifointest, sizeof(fdc->fifointest));
+    snapshot_write(s, &fdc->read_track_sector, sizeof(fdc->read_track_sector));
+    snapshot_write(s, &fdc->format_sector_id, sizeof(fdc->format_sector_id));
+    snapshot_write(s, &fdc->watchdog_count, sizeof(fdc->watchdog_count));
+    snapshot_write(s, fifo, offsetof(fifo16_t, priv));
+    snapshot_write(s, fifo->buf, sizeof(fifo->buf));
+    snapshot_write_timer(s, &fdc->timer);
+    snapshot_write_timer(s, &fdc->watchdog_timer);
+    snapshot_write(s, &current_drive, sizeof(current_drive));
+
+    fdd_snapshot_save(s);
+}
+
+static int
+fdc_load(void *priv, snapshot_t *s)
+{
+    fdc_t    *fdc  = (fdc_t *) priv;
+    fifo16_t *fifo = (fifo16_t *) fdc->fifo_p;
+    uint16_t  base = fdc->base_address;
+
+    if (!snapshot_read(s, fdc, offsetof(fdc_t, fifo_p)) ||
+        !snapshot_read(s, &fdc->fifointest, sizeof(fdc->fifointest)) ||
+        !snapshot_read(s, &fdc->read_track_sector, sizeof(fdc->read_track_sector)) ||
+        !snapshot_read(s, &fdc->format_sector_id, sizeof(fdc->format_sector_id)) ||
+        !snapshot_read(s, &fdc->watchdog_count, sizeof(fdc->watchdog_count)) ||
+        !snapshot_read(s, fifo, offsetof(fifo16_t, priv)) ||
+        !snapshot_read(s, fifo->buf, sizeof(fifo->buf)) ||
+        !snapshot_read_timer(s, &fdc->timer) ||
+        !snapshot_read_timer(s, &fdc->watchdog_timer) ||
+        !snapshot_read(s, &current_drive, sizeof(current_drive)))
+        return 0;
+
+    /* The I/O handlers are still where the reset put them. */
+    if (fdc->base_address != base) {
+        uint16_t new_base = fdc->base_address;
+
+        fdc->base_address = base;
+        fdc_remove(fdc);
+        if (new_base != 0x0000)
+            fdc_set_base(fdc, new_base);
+    }
+
+    return fdd_snapshot_load(s);
+}
+
 static void *
 fdc_init(const device_t *info)
 {
@@ -2400,6 +2460,8 @@ const device_t fdc_xt_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
+    .save          = fdc_save,
+    .load          = fdc_load,
     .config        = NULL
 };
 
@@ -2414,6 +2476,8 @@ const device_t fdc_xt_sec_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
+    .save          = fdc_save,
+    .load          = fdc_load,
     .config        = NULL
 };
 
@@ -2428,6 +2492,8 @@ const device_t fdc_xt_ter_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
+    .save          = fdc_save,
+    .load          = fdc_load,
     .config        = NULL
 };
 
@@ -2442,6 +2508,8 @@ const device_t fdc_xt_qua_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
+    .save          = fdc_save,
+    .load          = fdc_load,
     .config        = NULL
 };
 
@@ -2456,6 +2524,8 @@ const device_t fdc_xt_t1x00_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
+    .save          = fdc_save,
+    .load          = fdc_load,
     .config        = NULL
 };
 
@@ -2470,6 +2540,8 @@ const device_t fdc_xt_amstrad_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
+    .save          = fdc_save,
+    .load          = fdc_load,
     .config        = NULL
 };
 
@@ -2484,6 +2556,8 @@ const device_t fdc_xt_tandy_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
+    .save          = fdc_save,
+    .load          = fdc_load,
     .config        = NULL
 };
 
@@ -2498,6 +2572,8 @@ const device_t fdc_xt_umc_um8398_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
+    .save          = fdc_save,
+    .load          = fdc_load,
     .config        = NULL
 };
 
@@ -2512,6 +2588,8 @@ const device_t fdc_pcjr_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
+    .save          = fdc_save,
+    .load          = fdc_load,
     .config        = NULL
 };
 
@@ -2526,6 +2604,8 @@ const device_t fdc_at_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
+    .save          = fdc_save,
+    .load          = fdc_load,
     .config        = NULL
 };
 
@@ -2540,6 +2620,8 @@ const device_t fdc_at_sec_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
+    .save          = fdc_save,
+    .load          = fdc_load,
     .config        = NULL
 };
 
@@ -2554,6 +2636,8 @@ const device_t fdc_at_ter_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
+    .save          = fdc_save,
+    .load          = fdc_load,
     .config        = NULL
 };
 
@@ -2568,6 +2652,8 @@ const device_t fdc_at_qua_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
+    .save          = fdc_save,
+    .load          = fdc_load,
     .config        = NULL
 };
 
@@ -2582,6 +2668,8 @@ const device_t fdc_at_actlow_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
+    .save          = fdc_save,
+    .load          = fdc_load,
     .config        = NULL
 };
 
@@ -2596,6 +2684,8 @@ const device_t fdc_at_smc_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
+    .save          = fdc_save,
+    .load          = fdc_load,
     .config        = NULL
 };
 
@@ -2610,6 +2700,8 @@ const device_t fdc_at_ali_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
+    .save          = fdc_save,
+    .load          = fdc_load,
     .config        = NULL
 };
 
@@ -2624,6 +2716,8 @@ const device_t fdc_at_winbond_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
+    .save          = fdc_save,
+    .load          = fdc_load,
     .config        = NULL
 };
 
@@ -2638,6 +2732,8 @@ const device_t fdc_at_nsc_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
+    .save          = fdc_save,
+    .load          = fdc_load,
     .config        = NULL
 };
 
@@ -2652,6 +2748,8 @@ const device_t fdc_at_nsc_dp8473_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
+    .save          = fdc_save,
+    .load          = fdc_load,
     .config        = NULL
 };
 
@@ -2667,6 +2765,8 @@ const device_t fdc_ps2_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
+    .save          = fdc_save,
+    .load          = fdc_load,
     .config        = NULL
 };
 
@@ -2682,5 +2782,7 @@ const device_t fdc_ps2_mca_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
+    .save          = fdc_save,
+    .load          = fdc_load,
     .config        = NULL
 };
@@ -39,6 +39,7 @@
 #include <86box/fdd_mfm.h>
 #include <86box/fdd_td0.h>
 #include <86box/fdc.h>
+#include <86box/snapshot.h>
 
 /* Flags:
    Bit  0:  300 rpm supported;
@@ -616,6 +617,39 @@ fdd_reset(void)
     }
 }
 
+/* The drives belong to the controller's snapshot. The image itself is not
+   part of it, and neither is a transfer the image backend has in flight. */
+void
+fdd_snapshot_save(snapshot_t *s)
+{
+    for (int i = 0; i < FDD_NUM; i++) {
+        snapshot_write(s, &fdd[i].track, sizeof(fdd[i].track));
+        snapshot_write(s, &fdd[i].densel, sizeof(fdd[i].densel));
+        snapshot_write(s, &fdd[i].head, sizeof(fdd[i].head));
+        snapshot_write(s, &motoron[i], sizeof(motoron[i]));
+        snapshot_write(s, &fdd_changed[i], sizeof(fdd_changed[i]));
+        snapshot_write_timer(s, &fdd_poll_time[i]);
+    }
+}
+
+int
+fdd_snapshot_load(snapshot_t *s)
+{
+    for (int i = 0; i < FDD_NUM; i++) {
+        if (!snapshot_read(s, &fdd[i].track, sizeof(fdd[i].track)) ||
+            !snapshot_read(s, &fdd[i].densel, sizeof(fdd[i].densel)) ||
+            !snapshot_read(s, &fdd[i].head, sizeof(fdd[i].head)) ||
+            !snapshot_read(s, &motoron[i], sizeof(motoron[i])) ||
+            !snapshot_read(s, &fdd_changed[i], sizeof(fdd_changed[i])) ||
+            !snapshot_read_timer(s, &fdd_poll_time[i]))
+            return 0;
+
+        fdd_do_seek(i, fdd[i].track);
+    }
+
+    return 1;
+}
+
 void
 fdd_readsector(int drive, int sector, int track, int side, int density, int sector_size)
 {
@@ -160,6 +160,22 @@ typedef struct sector_t {
     void   *prev;
 } sector_t;
 
+/*
+ * Encoded tracks of sector image formats, kept so that seeking back to a
+ * track does not have to encode it again. They are dropped as soon as a
+ * WRITE DATA or FORMAT TRACK is started, as those change the encoded track
+ * behind the cache's back.
+ */
+#define D86F_CACHE_SIZE 64
+
+typedef struct d86f_cache_t {
+    int       track;
+    int       side;
+    uint32_t  words;
+    uint32_t  stamp;
+    uint16_t *data;
+} d86f_cache_t;
+
 /* Disk flags:
  *  Bit 0   Has surface data (1 = yes, 0 = no)
  *  Bits 2, 1   Hole (3 = ED + 2000 kbps, 2 = ED, 1 = HD, 0 = DD)
@@ -223,6 +239,8 @@ typedef struct d86f_t {
     uint8_t    *filebuf;
     uint8_t    *outbuf;
     sector_t   *last_side_sector[2];
+    uint32_t     cache_stamp;
+    d86f_cache_t cache[D86F_CACHE_SIZE];
 } d86f_t;
 
 static const uint8_t encoded_fm[64] = {
@@ -247,7 +265,7 @@ static const uint8_t encoded_mfm[64] = {
 };
 
 static d86f_t  *d86f[FDD_NUM];
-static uint16_t CRCTable[256];
+static uint16_t CRCTable[8][256]; /* [n] is a byte followed by n zero bytes. */
 static fdc_t   *d86f_fdc;
 uint64_t        poly = 0x42F0E1EBA9EA3693LL; /* ECMA normal */
 
@@ -293,9 +311,15 @@ setup_crc(uint16_t poly)
             else
                 temp <<= 1;
 
-            CRCTable[c] = temp;
+            CRCTable[0][c] = temp;
         }
     }
+
+    /* Tables for eight bytes at a time in fdd_calccrc_buf(). */
+    for (c = 0; c < 256; c++) {
+        for (bc = 1; bc < 8; bc++)
+            CRCTable[bc][c] = (CRCTable[bc - 1][c] << 8) ^ CRCTable[0][CRCTable[bc - 1][c] >> 8];
+    }
 }
 
 void
@@ -328,6 +352,113 @@ d86f_has_surface_desc(int drive)
     return (d86f_handler[drive].disk_flags(drive) & 1);
 }
 
+static uint32_t
+d86f_cache_words(int drive, int side)
+{
+    uint32_t raw_size = d86f_handler[drive].get_raw_size(drive, side);
+
+    if (raw_size & 15)
+        return (raw_size >> 4) + 1;
+
+    return raw_size >> 4;
+}
+
+/* Turbo mode needs the sector lists d86f_prepare_sector() builds. */
+static int
+d86f_cache_usable(int drive)
+{
+    const d86f_t *dev = d86f[drive];
+
+    return (dev != NULL) && (dev->version == 0x0063) && !fdd_get_turbo(drive) && !d86f_has_surface_desc(drive);
+}
+
+/* Returns 1 and restores the encoded track if it was cached. */
+int
+d86f_cache_load(int drive, int side, int track)
+{
+    d86f_t       *dev = d86f[drive];
+    uint32_t      words;
+    d86f_cache_t *c;
+
+    if (!d86f_cache_usable(drive))
+        return 0;
+
+    words = d86f_cache_words(drive, side);
+
+    for (int i = 0; i < D86F_CACHE_SIZE; i++) {
+        c = &dev->cache[i];
+        if ((c->data != NULL) && c->stamp && (c->track == track) && (c->side == side) && (c->words == words)) {
+            memcpy(dev->track_encoded_data[side], c->data, words << 1);
+            c->stamp = ++dev->cache_stamp;
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/* Keeps the track that was just encoded, replacing the least recently used one. */
+void
+d86f_cache_store(int drive, int side, int track)
+{
+    d86f_t       *dev = d86f[drive];
+    d86f_cache_t *c   = NULL;
+    uint32_t      words;
+
+    if (!d86f_cache_usable(drive))
+        return;
+
+    words = d86f_cache_words(drive, side);
+
+    for (int i = 0; i < D86F_CACHE_SIZE; i++) {
+        if ((c == NULL) || (dev->cache[i].stamp < c->stamp))
+            c = &dev->cache[i];
+        if (!c->stamp)
+            break;
+    }
+
+    if ((c->data == NULL) || (c->words < words)) {
+        free(c->data);
+        c->data = (uint16_t *) malloc(words << 1);
+        if (c->data == NULL) {
+            c->stamp = 0;
+            return;
+        }
+    }
+
+    memcpy(c->data, dev->track_encoded_data[side], words << 1);
+    c->track = track;
+    c->side  = side;
+    c->words = words;
+    c->stamp = ++dev->cache_stamp;
+}
+
+void
+d86f_cache_flush(int drive)
+{
+    d86f_t *dev = d86f[drive];
+
+    if (dev == NULL)
+        return;
+
+    for (int i = 0; i < D86F_CACHE_SIZE; i++)
+        dev->cache[i].stamp = 0;
+    dev->cache_stamp = 0;
+}
+
+static void
+d86f_cache_free(int drive)
+{
+    d86f_t *dev = d86f[drive];
+
+    for (int i = 0; i < D86F_CACHE_SIZE; i++) {
+        free(dev->cache[i].data);
+        dev->cache[i].data  = NULL;
+        dev->cache[i].stamp = 0;
+    }
+    dev->cache_stamp = 0;
+}
+
 int
 d86f_get_sides(int drive)
 {
@@ -601,6 +732,8 @@ d86f_unregister(int drive)
     d86f_handler[drive].get_raw_size      = common_get_raw_size;
     d86f_handler[drive].check_crc         = 0;
 
+    d86f_cache_flush(drive);
+
     dev->version = 0x0063; /* Proxied formats report as version 0.99. */
 }
 
@@ -1240,7 +1373,26 @@ decodefm(UNUSED(int drive), uint16_t dat)
 void
 fdd_calccrc(uint8_t byte, crc_t *crc_var)
 {
-    crc_var->word = (crc_var->word << 8) ^ CRCTable[(crc_var->word >> 8) ^ byte];
+    crc_var->word = (crc_var->word << 8) ^ CRCTable[0][(crc_var->word >> 8) ^ byte];
+}
+
+void
+fdd_calccrc_buf(const uint8_t *buf, uint32_t len, crc_t *crc_var)
+{
+    uint16_t crc = crc_var->word;
+
+    while (len >= 8) {
+        crc ^= (buf[0] << 8) | buf[1];
+        crc = CRCTable[7][crc >> 8] ^ CRCTable[6][crc & 0xff] ^ CRCTable[5][buf[2]] ^ CRCTable[4][buf[3]] ^
+              CRCTable[3][buf[4]] ^ CRCTable[2][buf[5]] ^ CRCTable[1][buf[6]] ^ CRCTable[0][buf[7]];
+        buf += 8;
+        len -= 8;
+    }
+
+    while (len--)
+        crc = (crc << 8) ^ CRCTable[0][(crc >> 8) ^ *(buf++)];
+
+    crc_var->word = crc;
 }
 
 static void
@@ -2334,6 +2486,7 @@ void
 d86f_turbo_poll(int drive, int side)
 {
     d86f_t *dev = d86f[drive];
+    uint8_t state;
 
     if ((dev->state != STATE_IDLE) && (dev->state != STATE_SECTOR_NOT_FOUND) && ((dev->state & 0xF8) != 0xE8)) {
         if (!d86f_can_read_address(drive)) {
@@ -2426,17 +2579,28 @@ d86f_turbo_poll(int drive, int side)
             dev->state++;
             break;
 
+        /*
+         * With DMA, or with VERIFY which transfers nothing, the guest does
+         * not have to see the sector go by byte by byte, so move all of it
+         * in one poll.
+         */
         case STATE_02_READ_DATA:
         case STATE_06_READ_DATA:
         case STATE_0C_READ_DATA:
         case STATE_11_SCAN_DATA:
         case STATE_16_VERIFY_DATA:
-            d86f_turbo_read(drive, side);
+            state = dev->state;
+            do {
+                d86f_turbo_read(drive, side);
+            } while ((dev->state == state) && (fdc_is_dma(d86f_fdc) || (state == STATE_16_VERIFY_DATA)));
             break;
 
         case STATE_05_WRITE_DATA:
         case STATE_09_WRITE_DATA:
-            d86f_turbo_write(drive, side);
+            state = dev->state;
+            do {
+                d86f_turbo_write(drive, side);
+            } while ((dev->state == state) && fdc_is_dma(d86f_fdc));
             break;
 
         case STATE_0D_FORMAT_TRACK:
@@ -2807,8 +2971,8 @@ d86f_prepare_sector(int drive, int side, int prev_pos, uint8_t *id_buf, uint8_t
             for (i = 0; i < data_len; i++) {
                 d86f_write_direct_common(drive, side, data_buf[i], 0, pos);
                 pos = (pos + 1) % raw_size;
-                d86f_calccrc(dev, data_buf[i]);
             }
+            fdd_calccrc_buf(data_buf, data_len, &(dev->calc_crc));
             if (!(flags & SECTOR_CRC_ERROR)) {
                 for (i = 1; i >= 0; i--) {
                     d86f_write_direct_common(drive, side, dev->calc_crc.bytes[i], 0, pos);
@@ -3307,6 +3471,8 @@ d86f_writesector(int drive, int sector, int track, int side, int rate, int secto
     if (!ret)
         return;
 
+    d86f_cache_flush(drive);
+
     dev->state = fdc_is_deleted(d86f_fdc) ? STATE_09_FIND_ID : STATE_05_FIND_ID;
 }
 
@@ -3395,6 +3561,8 @@ d86f_common_format(int drive, int side, UNUSED(int rate), uint8_t fill, int prox
         return;
     }
 
+    d86f_cache_flush(drive);
+
     if (!side || (d86f_get_sides(drive) == 2)) {
         if (!proxy) {
             d86f_reset_index_hole_pos(drive, side);
@@ -3903,6 +4071,8 @@ d86f_close(int drive)
         }
     }
 
+    d86f_cache_free(drive);
+
     if (dev->fp) {
         fclose(dev->fp);
         dev->fp = NULL;
@@ -3960,6 +4130,8 @@ d86f_destroy(int drive)
     d86f_destroy_linked_lists(drive, 0);
     d86f_destroy_linked_lists(drive, 1);
 
+    d86f_cache_free(drive);
+
     free(d86f[drive]);
     d86f[drive] = NULL;
 
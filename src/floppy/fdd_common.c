@@ -435,3 +435,84 @@ fdd_interleave(int sector, int skew, int spt)
 
     return adjusted_r;
 }
+
+/*
+ * Decoded contents of compressed images, kept after the images are closed,
+ * so mounting one again, as when swapping between the disks of a set, does
+ * not decode it all over again. The images are told apart by a hash of the
+ * whole file, the oldest entry makes way for a new one.
+ */
+#define FDD_DECODED_ENTRIES 8
+
+typedef struct fdd_decoded_t {
+    uint64_t hash;
+    uint32_t size;
+    uint32_t used;
+    uint8_t *data;
+} fdd_decoded_t;
+
+static fdd_decoded_t fdd_decoded[FDD_DECODED_ENTRIES];
+static uint32_t      fdd_decoded_clock;
+
+uint64_t
+fdd_image_hash(FILE *fp)
+{
+    uint8_t  buf[65536];
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    size_t   len;
+
+    if (fseek(fp, 0, SEEK_SET) == -1)
+        return 0;
+
+    while ((len = fread(buf, 1, sizeof(buf), fp)) > 0) {
+        for (size_t i = 0; i < len; i++)
+            hash = (hash ^ buf[i]) * 0x100000001b3ULL;
+    }
+
+    (void) fseek(fp, 0, SEEK_SET);
+
+    return hash;
+}
+
+const uint8_t *
+fdd_decoded_find(uint64_t hash, uint32_t *size)
+{
+    for (int i = 0; i < FDD_DECODED_ENTRIES; i++) {
+        fdd_decoded_t *dec = &fdd_decoded[i];
+
+        if ((dec->data != NULL) && (dec->hash == hash)) {
+            dec->used = ++fdd_decoded_clock;
+            *size     = dec->size;
+            return dec->data;
+        }
+    }
+
+    return NULL;
+}
+
+void
+fdd_decoded_add(uint64_t hash, const uint8_t *data, uint32_t size)
+{
+    fdd_decoded_t *dec = &fdd_decoded[0];
+    uint8_t       *copy;
+
+    for (int i = 0; i < FDD_DECODED_ENTRIES; i++) {
+        if (fdd_decoded[i].data == NULL) {
+            dec = &fdd_decoded[i];
+            break;
+        }
+        if (fdd_decoded[i].used < dec->used)
+            dec = &fdd_decoded[i];
+    }
+
+    copy = (uint8_t *) malloc(size ? size : 1);
+    if (copy == NULL)
+        return;
+    memcpy(copy, data, size);
+
+    free(dec->data);
+    dec->hash = hash;
+    dec->size = size;
+    dec->used = ++fdd_decoded_clock;
+    dec->data = copy;
+}
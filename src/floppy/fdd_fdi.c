@@ -36,6 +36,15 @@
 #include <86box/fdc.h>
 #include <fdi2raw.h>
 
+/* A track decoded for one density, kept for as long as the image is mounted. */
+typedef struct fdi_track_t {
+    uint16_t *data;
+    int       size; /* In bytes. */
+    int       len;
+    int       index;
+    int       bit_rate;
+} fdi_track_t;
+
 typedef struct fdi_t {
     FILE *fp;
     FDI  *h;
@@ -43,8 +52,12 @@ typedef struct fdi_t {
     int lasttrack;
     int sides;
     int track;
+    int bit_rate;
     int tracklen[2][4];
     int trackindex[2][4];
+    int decoded[2][4]; /* What of the current track is in track_data. */
+
+    fdi_track_t *tracks;
 
     uint8_t track_data[2][4][256 * 1024];
     uint8_t track_timing[2][4][256 * 1024];
@@ -77,7 +90,7 @@ disk_flags(int drive)
     fdi_t   *dev             = fdi[drive];
     uint16_t temp_disk_flags = 0x80; /* We ALWAYS claim to have extra bit cells, even if the actual amount is 0. */
 
-    switch (fdi2raw_get_bit_rate(dev->h)) {
+    switch (dev->bit_rate) {
         case 500:
             temp_disk_flags |= 2;
             break;
@@ -113,7 +126,7 @@ side_flags(int drive)
     fdi_t   *dev             = fdi[drive];
     uint16_t temp_side_flags = 0;
 
-    switch (fdi2raw_get_bit_rate(dev->h)) {
+    switch (dev->bit_rate) {
         case 500:
             temp_side_flags = 0;
             break;
@@ -173,15 +186,62 @@ fdi_density(void)
     return 1;
 }
 
+/*
+ * Tracks are only decoded for the densities the FDC actually reads them
+ * with, and the first time they are needed, as decoding is slow and every
+ * seek would otherwise decode the track for all four.
+ */
+static void
+fdi_decode(fdi_t *dev, int side, int den)
+{
+    fdi_track_t *t;
+    int          c;
+
+    if (dev->decoded[side][den])
+        return;
+    dev->decoded[side][den] = 1;
+
+    t = &dev->tracks[(((dev->track * dev->sides) + side) * 4) + den];
+    if (t->data != NULL) {
+        memcpy(dev->track_data[side][den], t->data, t->size);
+        dev->tracklen[side][den]   = t->len;
+        dev->trackindex[side][den] = t->index;
+        dev->bit_rate              = t->bit_rate;
+        return;
+    }
+
+    c = fdi2raw_loadtrack(dev->h,
+                          (uint16_t *) dev->track_data[side][den],
+                          (uint16_t *) dev->track_timing[side][den],
+                          (dev->track * dev->sides) + side,
+                          &dev->tracklen[side][den],
+                          &dev->trackindex[side][den], NULL, den);
+    dev->bit_rate = fdi2raw_get_bit_rate(dev->h);
+    if (!c) {
+        memset(dev->track_data[side][den], 0, dev->tracklen[side][den]);
+        return;
+    }
+
+    t->size = MIN(((dev->tracklen[side][den] + 15) >> 4) << 1, (int) sizeof(dev->track_data[side][den]));
+    t->data = (uint16_t *) malloc(t->size);
+    if (t->data == NULL)
+        return;
+    memcpy(t->data, dev->track_data[side][den], t->size);
+    t->len      = dev->tracklen[side][den];
+    t->index    = dev->trackindex[side][den];
+    t->bit_rate = dev->bit_rate;
+}
+
 static int32_t
 extra_bit_cells(int drive, int side)
 {
-    const fdi_t *dev        = fdi[drive];
-    int          density    = 0;
-    int          raw_size   = 0;
-    int          is_300_rpm = 0;
+    fdi_t *dev        = fdi[drive];
+    int    density    = 0;
+    int    raw_size   = 0;
+    int    is_300_rpm = 0;
 
     density = fdi_density();
+    fdi_decode(dev, side, density);
 
     is_300_rpm = (fdd_getrpm(drive) == 300);
 
@@ -213,46 +273,44 @@ extra_bit_cells(int drive, int side)
 static void
 read_revolution(int drive)
 {
-    fdi_t *dev = fdi[drive];
-    int    c;
+    fdi_t *dev   = fdi[drive];
     int    den;
     int    track = dev->track;
 
+    memset(dev->decoded, 0, sizeof(dev->decoded));
+
     if (track > dev->lasttrack) {
         for (den = 0; den < 4; den++) {
             memset(dev->track_data[0][den], 0, 106096);
             memset(dev->track_data[1][den], 0, 106096);
             dev->tracklen[0][den] = dev->tracklen[1][den] = 100000;
+            dev->decoded[0][den] = dev->decoded[1][den] = 1;
         }
         return;
     }
 
-    for (den = 0; den < 4; den++) {
-        for (int side = 0; side < dev->sides; side++) {
-            c = fdi2raw_loadtrack(dev->h,
-                                  (uint16_t *) dev->track_data[side][den],
-                                  (uint16_t *) dev->track_timing[side][den],
-                                  (track * dev->sides) + side,
-                                  &dev->tracklen[side][den],
-                                  &dev->trackindex[side][den], NULL, den);
-            if (!c)
-                memset(dev->track_data[side][den], 0, dev->tracklen[side][den]);
-        }
-
-        if (dev->sides == 1) {
+    if (dev->sides == 1) {
+        for (den = 0; den < 4; den++) {
             memset(dev->track_data[1][den], 0, 106096);
             dev->tracklen[1][den] = 100000;
+            dev->decoded[1][den]  = 1;
         }
     }
+
+    /* Decode the density in use right away, which also gets the bit rate of the track. */
+    den = fdi_density();
+    for (int side = 0; side < dev->sides; side++)
+        fdi_decode(dev, side, den);
 }
 
 static uint32_t
 index_hole_pos(int drive, int side)
 {
-    const fdi_t *dev = fdi[drive];
-    int          density;
+    fdi_t *dev = fdi[drive];
+    int    density;
 
     density = fdi_density();
+    fdi_decode(dev, side, density);
 
     return (dev->trackindex[side][density]);
 }
@@ -260,10 +318,11 @@ index_hole_pos(int drive, int side)
 static uint32_t
 get_raw_size(int drive, int side)
 {
-    const fdi_t *dev = fdi[drive];
-    int          density;
+    fdi_t *dev = fdi[drive];
+    int    density;
 
     density = fdi_density();
+    fdi_decode(dev, side, density);
 
     return (dev->tracklen[side][density]);
 }
@@ -275,6 +334,7 @@ encoded_data(int drive, int side)
     int    density = 0;
 
     density = fdi_density();
+    fdi_decode(dev, side, density);
 
     return ((uint16_t *) dev->track_data[side][density]);
 }
@@ -346,6 +406,10 @@ fdi_load(int drive, char *fn)
     dev->h         = fdi2raw_header(dev->fp);
     dev->lasttrack = fdi2raw_get_last_track(dev->h);
     dev->sides     = fdi2raw_get_last_head(dev->h) + 1;
+    dev->bit_rate  = fdi2raw_get_bit_rate(dev->h);
+    dev->tracks    = (fdi_track_t *) calloc((dev->lasttrack + 1) * dev->sides * 4, sizeof(fdi_track_t));
+    if (dev->tracks == NULL)
+        fatal("fdi_load(): Error allocating the track cache\n");
 
     /* Attach this format to the D86F engine. */
     d86f_handler[drive].disk_flags        = disk_flags;
@@ -384,6 +448,12 @@ fdi_close(int drive)
     if (dev->h)
         fdi2raw_header_free(dev->h);
 
+    if (dev->tracks) {
+        for (int i = 0; i < ((dev->lasttrack + 1) * dev->sides * 4); i++)
+            free(dev->tracks[i].data);
+        free(dev->tracks);
+    }
+
     if (dev->fp)
         fclose(dev->fp);
 
@@ -309,6 +309,7 @@ imd_seek(int drive, int track)
     const char *n_map = NULL;
     uint8_t    *data;
     int         flags = 0x00;
+    int         cached;
 
     if (dev->fp == NULL)
         return;
@@ -371,7 +372,9 @@ imd_seek(int drive, int track)
 
         interleave_type = track_is_interleave(drive, side, track);
 
-        current_pos = d86f_prepare_pretrack(drive, side, 0);
+        cached = d86f_cache_load(drive, side, track);
+        if (!cached)
+            current_pos = d86f_prepare_pretrack(drive, side, 0);
 
         if (!xdf_type) {
             for (sector = 0; sector < dev->tracks[track][side].params[3]; sector++) {
@@ -402,7 +405,8 @@ imd_seek(int drive, int track)
 
                 sector_to_buffer(drive, track, side, data, actual_sector, ssize);
 
-                current_pos = d86f_prepare_sector(drive, side, current_pos, id, data, ssize, 22, track_gap3, flags);
+                if (!cached)
+                    current_pos = d86f_prepare_sector(drive, side, current_pos, id, data, ssize, 22, track_gap3, flags);
                 track_buf_pos[side] += ssize;
 
                 if (sector == 0)
@@ -435,10 +439,12 @@ imd_seek(int drive, int track)
 
                 sector_to_buffer(drive, track, side, data, ordered_pos, ssize);
 
-                if (is_trackx)
-                    current_pos = d86f_prepare_sector(drive, side, xdf_trackx_spos[xdf_type][xdf_sector], id, data, ssize, track_gap2, xdf_gap3_sizes[xdf_type][is_trackx], flags);
-                else
-                    current_pos = d86f_prepare_sector(drive, side, current_pos, id, data, ssize, track_gap2, xdf_gap3_sizes[xdf_type][is_trackx], flags);
+                if (!cached) {
+                    if (is_trackx)
+                        current_pos = d86f_prepare_sector(drive, side, xdf_trackx_spos[xdf_type][xdf_sector], id, data, ssize, track_gap2, xdf_gap3_sizes[xdf_type][is_trackx], flags);
+                    else
+                        current_pos = d86f_prepare_sector(drive, side, current_pos, id, data, ssize, track_gap2, xdf_gap3_sizes[xdf_type][is_trackx], flags);
+                }
 
                 track_buf_pos[side] += ssize;
 
@@ -446,6 +452,9 @@ imd_seek(int drive, int track)
                     d86f_initialize_last_sector_id(drive, id[0], id[1], id[2], id[3]);
             }
         }
+
+        if (!cached)
+            d86f_cache_store(drive, side, track);
     }
 }
 
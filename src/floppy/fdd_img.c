@@ -508,6 +508,7 @@ img_seek(int drive, int track)
     int      buf_pos;
     int      ssize   = 128 << ((int) dev->sector_size);
     uint32_t cur_pos = 0;
+    int      cached  = 0;
 
     if (dev->fp == NULL)
         return;
@@ -549,7 +550,9 @@ img_seek(int drive, int track)
 
     if (!dev->xdf_type || dev->is_cqm) {
         for (side = 0; side < dev->sides; side++) {
-            current_pos = d86f_prepare_pretrack(drive, side, 0);
+            cached = d86f_cache_load(drive, side, track);
+            if (!cached)
+                current_pos = d86f_prepare_pretrack(drive, side, 0);
 
             for (sector = 0; sector < dev->sectors; sector++) {
                 if (dev->is_cqm) {
@@ -573,11 +576,15 @@ img_seek(int drive, int track)
                 id[3]                          = dev->sector_size;
                 dev->sector_pos_side[side][sr] = side;
                 dev->sector_pos[side][sr]      = (sr - 1) * ssize;
-                current_pos                    = d86f_prepare_sector(drive, side, current_pos, id, &dev->track_data[side][(sr - 1) * ssize], ssize, dev->gap2_size, dev->gap3_size, 0);
+                if (!cached)
+                    current_pos = d86f_prepare_sector(drive, side, current_pos, id, &dev->track_data[side][(sr - 1) * ssize], ssize, dev->gap2_size, dev->gap3_size, 0);
 
                 if (sector == 0)
                     d86f_initialize_last_sector_id(drive, id[0], id[1], id[2], id[3]);
             }
+
+            if (!cached)
+                d86f_cache_store(drive, side, track);
         }
     } else {
         total   = dev->sectors;
@@ -606,7 +613,9 @@ img_seek(int drive, int track)
 
         /* Pass 2, prepare the actual track. */
         for (side = 0; side < dev->sides; side++) {
-            current_pos = d86f_prepare_pretrack(drive, side, 0);
+            cached = d86f_cache_load(drive, side, track);
+            if (!cached)
+                current_pos = d86f_prepare_pretrack(drive, side, 0);
 
             for (sector = 0; sector < xdf_physical_sectors[current_xdft][!is_t0]; sector++) {
                 array_sector = (side * xdf_physical_sectors[current_xdft][!is_t0]) + sector;
@@ -618,17 +627,22 @@ img_seek(int drive, int track)
                 id[2] = xdf_disk_sector.id.r;
 
                 if (is_t0) {
-                    id[3]       = 2;
-                    current_pos = d86f_prepare_sector(drive, side, current_pos, id, &dev->track_data[buf_side][buf_pos], ssize, dev->gap2_size, xdf_gap3_sizes[current_xdft][!is_t0], 0);
+                    id[3] = 2;
+                    if (!cached)
+                        current_pos = d86f_prepare_sector(drive, side, current_pos, id, &dev->track_data[buf_side][buf_pos], ssize, dev->gap2_size, xdf_gap3_sizes[current_xdft][!is_t0], 0);
                 } else {
-                    id[3]       = id[2] & 7;
-                    ssize       = (128 << id[3]);
-                    current_pos = d86f_prepare_sector(drive, side, xdf_trackx_spos[current_xdft][array_sector], id, &dev->track_data[buf_side][buf_pos], ssize, dev->gap2_size, xdf_gap3_sizes[current_xdft][!is_t0], 0);
+                    id[3] = id[2] & 7;
+                    ssize = (128 << id[3]);
+                    if (!cached)
+                        current_pos = d86f_prepare_sector(drive, side, xdf_trackx_spos[current_xdft][array_sector], id, &dev->track_data[buf_side][buf_pos], ssize, dev->gap2_size, xdf_gap3_sizes[current_xdft][!is_t0], 0);
                 }
 
                 if (sector == 0)
                     d86f_initialize_last_sector_id(drive, id[0], id[1], id[2], id[3]);
             }
+
+            if (!cached)
+                d86f_cache_store(drive, side, track);
         }
     }
 }
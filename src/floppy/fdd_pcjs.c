@@ -518,6 +518,7 @@ pcjs_seek(int drive, int track)
     int     ssize;
     int     rsec;
     int     asec;
+    int     cached;
 
     if (dev->fp == NULL) {
         pcjs_log("pcjs_seek: no file loaded\n");
@@ -560,7 +561,9 @@ pcjs_seek(int drive, int track)
         /* Get correct GAP2 value for this side. */
         gap2 = ((dev->track_flags & 0x07) >= 3) ? 41 : 22;
 
-        pos = d86f_prepare_pretrack(drive, side, 0);
+        cached = d86f_cache_load(drive, side, track);
+        if (!cached)
+            pos = d86f_prepare_pretrack(drive, side, 0);
 
         for (uint8_t sector = 0; sector < dev->spt[track][side]; sector++) {
             rsec = dev->sectors[track][side][sector].sector;
@@ -574,16 +577,20 @@ pcjs_seek(int drive, int track)
             id[3] = dev->sectors[track][side][asec].encoded_size & 0xff;
             ssize = fdd_sector_code_size(dev->sectors[track][side][asec].encoded_size & 0xff);
 
-            pos = d86f_prepare_sector(
-                drive, side, pos, id,
-                dev->sectors[track][side][asec].data,
-                ssize, gap2, gap3,
-                0
-            );
+            if (!cached)
+                pos = d86f_prepare_sector(
+                    drive, side, pos, id,
+                    dev->sectors[track][side][asec].data,
+                    ssize, gap2, gap3,
+                    0
+                );
 
             if (sector == 0)
                 d86f_initialize_last_sector_id(drive, id[0], id[1], id[2], id[3]);
         }
+
+        if (!cached)
+            d86f_cache_store(drive, side, track);
     }
 }
 
@@ -40,6 +40,7 @@
 #include <86box/plat.h>
 #include <86box/fdd.h>
 #include <86box/fdd_86f.h>
+#include <86box/fdd_common.h>
 #include <86box/fdd_td0.h>
 #include <86box/fdc.h>
 #include "lzw/lzw.h"
@@ -653,19 +654,32 @@ td0_initialize(int drive)
     head_count = header[9];
 
     if (header[0] == 't') {
-        if (((header[4] / 10) % 10) == 2) {
+        const uint8_t *decoded;
+        uint32_t       decoded_size;
+        uint64_t       hash = fdd_image_hash(dev->fp);
+
+        decoded = fdd_decoded_find(hash, &decoded_size);
+        if (decoded != NULL) {
+            td0_log("TD0: File is compressed, using the previously decoded contents\n");
+            memcpy(dev->imagebuf, decoded, decoded_size);
+        } else if (((header[4] / 10) % 10) == 2) {
             td0_log("TD0: File is compressed (TeleDisk 2.x, LZHUF)\n");
             disk_decode.fdd_file = dev->fp;
             state_init_Decode(&disk_decode);
             disk_decode.fdd_file_offset = 12;
-            state_Decode(&disk_decode, dev->imagebuf, TD0_MAX_BUFSZ);
+            decoded_size = (uint32_t) state_Decode(&disk_decode, dev->imagebuf, TD0_MAX_BUFSZ);
+            fdd_decoded_add(hash, dev->imagebuf, decoded_size);
         } else {
+            uint64_t lzw_size = 0;
+
             td0_log("TD0: File is compressed (TeleDisk 1.x, LZW)\n");
             if (fseek(dev->fp, 12, SEEK_SET) == -1)
                 fatal("td0_initialize(): Error seeking to offet 12\n");
             if (fread(dev->lzw_buf, 1, file_size - 12, dev->fp) != (file_size - 12))
                 fatal("td0_initialize(): Error reading LZW-encoded buffer\n");
-            LZWDecodeFile((char *) dev->imagebuf, (char *) dev->lzw_buf, NULL, file_size - 12);
+            LZWDecodeFile((char *) dev->imagebuf, (char *) dev->lzw_buf, &lzw_size, file_size - 12);
+            decoded_size = (uint32_t) MIN(lzw_size, TD0_MAX_BUFSZ);
+            fdd_decoded_add(hash, dev->imagebuf, decoded_size);
         }
     } else {
         td0_log("TD0: File is uncompressed\n");
@@ -1078,6 +1092,7 @@ td0_seek(int drive, int track)
     int     actual_sector   = 0;
     int     fm;
     int     sector_adjusted;
+    int     cached;
 
     if (dev->fp == NULL)
         return;
@@ -1121,7 +1136,9 @@ td0_seek(int drive, int track)
 
         interleave_type = track_is_interleave(drive, side, track);
 
-        current_pos     = d86f_prepare_pretrack(drive, side, 0);
+        cached = d86f_cache_load(drive, side, track);
+        if (!cached)
+            current_pos = d86f_prepare_pretrack(drive, side, 0);
         sector_adjusted = 0;
 
         if (!xdf_type) {
@@ -1144,7 +1161,8 @@ td0_seek(int drive, int track)
                     ssize = 3;
                 else
                     ssize = 128 << ((uint32_t) id[3]);
-                current_pos = d86f_prepare_sector(drive, side, current_pos, id, dev->sects[track][side][actual_sector].data, ssize, track_gap2, track_gap3, dev->sects[track][side][actual_sector].flags);
+                if (!cached)
+                    current_pos = d86f_prepare_sector(drive, side, current_pos, id, dev->sects[track][side][actual_sector].data, ssize, track_gap2, track_gap3, dev->sects[track][side][actual_sector].flags);
 
                 if (sector_adjusted == 0)
                     d86f_initialize_last_sector_id(drive, id[0], id[1], id[2], id[3]);
@@ -1167,10 +1185,12 @@ td0_seek(int drive, int track)
                     ssize = 3;
                 else
                     ssize = 128 << ((uint32_t) id[3]);
-                if (is_trackx)
-                    current_pos = d86f_prepare_sector(drive, side, xdf_trackx_spos[xdf_type][xdf_sector], id, dev->sects[track][side][ordered_pos].data, ssize, track_gap2, xdf_gap3_sizes[xdf_type][is_trackx], dev->sects[track][side][ordered_pos].flags);
-                else
-                    current_pos = d86f_prepare_sector(drive, side, current_pos, id, dev->sects[track][side][ordered_pos].data, ssize, track_gap2, xdf_gap3_sizes[xdf_type][is_trackx], dev->sects[track][side][ordered_pos].flags);
+                if (!cached) {
+                    if (is_trackx)
+                        current_pos = d86f_prepare_sector(drive, side, xdf_trackx_spos[xdf_type][xdf_sector], id, dev->sects[track][side][ordered_pos].data, ssize, track_gap2, xdf_gap3_sizes[xdf_type][is_trackx], dev->sects[track][side][ordered_pos].flags);
+                    else
+                        current_pos = d86f_prepare_sector(drive, side, current_pos, id, dev->sects[track][side][ordered_pos].data, ssize, track_gap2, xdf_gap3_sizes[xdf_type][is_trackx], dev->sects[track][side][ordered_pos].flags);
+                }
 
                 if (sector_adjusted == 0)
                     d86f_initialize_last_sector_id(drive, id[0], id[1], id[2], id[3]);
@@ -1179,6 +1199,9 @@ td0_seek(int drive, int track)
                     sector_adjusted++;
             }
         }
+
+        if (!cached)
+            d86f_cache_store(drive, side, track);
     }
 }
 
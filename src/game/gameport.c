@@ -40,9 +40,7 @@ typedef struct {
 } GAMEPORT;
 
 typedef struct g_axis_t {
-    pc_timer_t                  timer;
-    int                         axis_nr;
-    struct _joystick_instance_ *joystick;
+    uint64_t delay; /* One-shot period in timer units, UINT64_MAX if the axis is not present */
 } g_axis_t;
 
 typedef struct _gameport_ {
@@ -58,8 +56,10 @@ typedef struct _tmacm_ {
 } tmacm_t;
 
 typedef struct _joystick_instance_ {
-    uint8_t  state;
-    g_axis_t axis[4];
+    uint8_t    state;
+    uint64_t   start; /* Time of the last write, the axis one-shots run from there */
+    g_axis_t   axis[4];
+    pc_timer_t a0_timer;
 
     const joystick_if_t *intf;
     void                *dat;
@@ -212,16 +212,38 @@ static void
 gameport_time(joystick_instance_t *joystick, int nr, int axis)
 {
     if (axis == AXIS_NOT_PRESENT)
-        timer_disable(&joystick->axis[nr].timer);
+        joystick->axis[nr].delay = UINT64_MAX;
     else {
         /* Convert axis value to 555 timing. */
         axis += 32768;
         axis = (axis * 100) / 65; /* axis now in ohms */
         axis = (axis * 11) / 1000;
-        timer_set_delay_u64(&joystick->axis[nr].timer, TIMER_USEC * (axis + 24)); /* max = 11.115 ms */
+        joystick->axis[nr].delay = TIMER_USEC * (axis + 24); /* max = 11.115 ms */
     }
 }
 
+/* The axis bits are not cleared by timers, but worked out from the time
+   elapsed since the last write whenever the port is read, as programs poll
+   the port in tight loops to measure the one-shot periods. */
+static uint8_t
+gameport_axis_state(joystick_instance_t *joystick)
+{
+    int64_t elapsed;
+
+    if (!(joystick->state & 0x0f))
+        return joystick->state;
+
+    elapsed = (int64_t) ((tsc << 32) - joystick->start);
+
+    for (int nr = 0; nr < 4; nr++) {
+        /* A TSC moved backwards ends all periods. */
+        if ((joystick->state & (1 << nr)) && ((elapsed < 0) || ((uint64_t) elapsed >= joystick->axis[nr].delay)))
+            joystick->state &= ~(1 << nr);
+    }
+
+    return joystick->state;
+}
+
 static void
 gameport_write(UNUSED(uint16_t addr), UNUSED(uint8_t val), void *priv)
 {
@@ -234,12 +256,19 @@ gameport_write(UNUSED(uint16_t addr), UNUSED(uint8_t val), void *priv)
 
     /* Read all axes. */
     joystick->state |= 0x0f;
+    joystick->start = tsc << 32;
 
     gameport_time(joystick, 0, joystick->intf->read_axis(joystick->dat, 0));
     gameport_time(joystick, 1, joystick->intf->read_axis(joystick->dat, 1));
     gameport_time(joystick, 2, joystick->intf->read_axis(joystick->dat, 2));
     gameport_time(joystick, 3, joystick->intf->read_axis(joystick->dat, 3));
 
+    /* The joystick still gets notified when the first axis' period is finished. */
+    if (joystick->axis[0].delay == UINT64_MAX)
+        timer_disable(&joystick->a0_timer);
+    else
+        timer_set_delay_u64(&joystick->a0_timer, joystick->axis[0].delay);
+
     /* Notify the interface. */
     joystick->intf->write(joystick->dat);
 
@@ -257,7 +286,7 @@ gameport_read(UNUSED(uint16_t addr), void *priv)
         return 0xff;
 
     /* Merge axis state with button state. */
-    uint8_t ret = joystick->state | joystick->intf->read(joystick->dat);
+    uint8_t ret = gameport_axis_state(joystick) | joystick->intf->read(joystick->dat);
 
     cycles -= ISA_CYCLES(8);
 
@@ -267,13 +296,12 @@ gameport_read(UNUSED(uint16_t addr), void *priv)
 static void
 timer_over(void *priv)
 {
-    g_axis_t *axis = (g_axis_t *) priv;
+    joystick_instance_t *joystick = (joystick_instance_t *) priv;
 
-    axis->joystick->state &= ~(1 << axis->axis_nr);
+    joystick->state &= ~0x01;
 
     /* Notify the joystick when the first axis' period is finished. */
-    if (axis == &axis->joystick->axis[0])
-        axis->joystick->intf->a0_over(axis->joystick->dat);
+    joystick->intf->a0_over(joystick->dat);
 }
 
 void
@@ -372,20 +400,7 @@ gameport_init(const device_t *info)
     if (!joystick_instance[0] && joystick_type) {
         joystick_instance[0] = calloc(1, sizeof(joystick_instance_t));
 
-        joystick_instance[0]->axis[0].joystick = joystick_instance[0];
-        joystick_instance[0]->axis[1].joystick = joystick_instance[0];
-        joystick_instance[0]->axis[2].joystick = joystick_instance[0];
-        joystick_instance[0]->axis[3].joystick = joystick_instance[0];
-
-        joystick_instance[0]->axis[0].axis_nr = 0;
-        joystick_instance[0]->axis[1].axis_nr = 1;
-        joystick_instance[0]->axis[2].axis_nr = 2;
-        joystick_instance[0]->axis[3].axis_nr = 3;
-
-        timer_add(&joystick_instance[0]->axis[0].timer, timer_over, &joystick_instance[0]->axis[0], 0);
-        timer_add(&joystick_instance[0]->axis[1].timer, timer_over, &joystick_instance[0]->axis[1], 0);
-        timer_add(&joystick_instance[0]->axis[2].timer, timer_over, &joystick_instance[0]->axis[2], 0);
-        timer_add(&joystick_instance[0]->axis[3].timer, timer_over, &joystick_instance[0]->axis[3], 0);
+        timer_add(&joystick_instance[0]->a0_timer, timer_over, joystick_instance[0], 0);
 
         joystick_instance[0]->intf = joysticks[joystick_type].joystick;
         joystick_instance[0]->dat  = joystick_instance[0]->intf->init();
@@ -462,6 +477,7 @@ gameport_close(void *priv)
     /* Free the global instance here, if it wasn't already freed. */
     if (joystick_instance[0]) {
         joystick_instance[0]->intf->close(joystick_instance[0]->dat);
+        timer_disable(&joystick_instance[0]->a0_timer);
 
         free(joystick_instance[0]);
         joystick_instance[0] = NULL;
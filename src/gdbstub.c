@@ -128,6 +128,7 @@ typedef struct _gdbstub_client_ {
     uint8_t first_packet_received : 1;
     uint8_t ida_mode : 1;
     uint8_t waiting_stop : 1;
+    uint8_t phys_mode : 1; /* memory packets take physical addresses */
     int     packet_pos;
     int     response_pos;
 
@@ -353,7 +354,12 @@ static gdbstub_breakpoint_t *first_awatch = NULL;
 
 int      gdbstub_step = 0;
 int      gdbstub_next_asap = 0;
-uint64_t gdbstub_watch_pages[(((uint32_t) -1) >> (MEM_GRANULARITY_BITS + 6)) + 1];
+uint64_t             gdbstub_watch_pages[(((uint32_t) -1) >> (MEM_GRANULARITY_BITS + 6)) + 1];
+int                  gdbstub_watch_page_num = 0;
+gdbstub_watch_page_t gdbstub_watch_page_list[GDBSTUB_WATCH_PAGES];
+
+static const char gdbstub_hex_digits[] = "0123456789abcdef";
+static uint8_t    gdbstub_mem_buf[8192];
 
 static void
 gdbstub_break(void)
@@ -651,9 +657,178 @@ gdbstub_client_respond_partial(gdbstub_client_t *client)
 static void
 gdbstub_client_respond_hex(gdbstub_client_t *client, uint8_t *buf, int size)
 {
+    char *p = &client->response[client->response_pos];
+
+    /* Clamp to the space left. */
+    if (size > ((int) (sizeof(client->response) - 1 - client->response_pos) >> 1))
+        size = (int) (sizeof(client->response) - 1 - client->response_pos) >> 1;
+    if (size <= 0)
+        return;
+
+    client->response_pos += size << 1;
+    while (size--) {
+        *p++ = gdbstub_hex_digits[(*buf) >> 4];
+        *p++ = gdbstub_hex_digits[(*buf++) & 0x0f];
+    }
+}
+
+static void
+gdbstub_client_respond_binary(gdbstub_client_t *client, uint8_t *buf, int size)
+{
+    uint8_t c;
+
     while (size-- && (client->response_pos < (sizeof(client->response) - 2))) {
-        client->response[client->response_pos++] = gdbstub_hex_encode((*buf) >> 4);
-        client->response[client->response_pos++] = gdbstub_hex_encode((*buf++) & 0x0f);
+        c = *buf++;
+        if ((c == '#') || (c == '$') || (c == '*') || (c == '}')) {
+            client->response[client->response_pos++] = '}';
+            client->response[client->response_pos++] = c ^ 0x20;
+        } else {
+            client->response[client->response_pos++] = c;
+        }
+    }
+}
+
+/* Translates an address from the client without faulting the guest, and
+   ignoring the privilege level it is at, as a debugger would. */
+static int
+gdbstub_mem_translate(gdbstub_client_t *client, uint32_t addr, int write, uint32_t *phys)
+{
+    uint64_t pa;
+    int      old_cpl_override;
+
+    if (client->phys_mode) {
+        *phys = addr;
+        return 1;
+    }
+
+    if (!(cr0 >> 31)) {
+        *phys = addr & rammask;
+        return 1;
+    }
+
+    old_cpl_override = cpl_override;
+    cpl_override     = 1;
+    pa               = mmutranslate_noabrt(addr, write);
+    cpl_override     = old_cpl_override;
+    if (pa > 0xffffffffULL)
+        return 0;
+
+    *phys = ((uint32_t) pa) & rammask;
+    return 1;
+}
+
+/* Reads or writes guest memory a page at a time, copying whatever is
+   backed by host memory in one go. Stops at the first address that does
+   not translate, and returns how many bytes were done. */
+static int
+gdbstub_mem_rw(gdbstub_client_t *client, uint32_t addr, uint8_t *buf, int len, int write)
+{
+    uint32_t phys;
+    uint32_t span;
+    uint32_t n;
+    uint8_t *p;
+    int      done = 0;
+
+    while (done < len) {
+        n = 0x1000 - (addr & 0xfff);
+        if (n > (uint32_t) (len - done))
+            n = len - done;
+
+        if (!gdbstub_mem_translate(client, addr, write, &phys))
+            break;
+
+        addr += n;
+        done += n;
+        while (n) {
+            p = mem_span_map(phys, n, &span, write);
+            if (p != NULL) {
+                if (write) {
+                    memcpy(p, buf, span);
+                    mem_span_written(phys, span);
+                } else {
+                    memcpy(buf, p, span);
+                }
+            } else {
+                for (uint32_t i = 0; i < span; i++) {
+                    if (write)
+                        mem_writeb_phys(phys + i, buf[i]);
+                    else
+                        buf[i] = mem_readb_phys(phys + i);
+                }
+            }
+
+            phys += span;
+            buf += span;
+            n -= span;
+        }
+    }
+
+    return done;
+}
+
+/* Rebuilds the page map, and the byte maps of the watched pages. */
+static void
+gdbstub_watch_update(void)
+{
+    gdbstub_breakpoint_t *watchpoint;
+    gdbstub_watch_page_t *wp;
+    uint32_t              addr;
+    uint32_t              page;
+    uint32_t              n;
+    int                   l = 0;
+    int                   j;
+
+    memset(gdbstub_watch_pages, 0, sizeof(gdbstub_watch_pages));
+    gdbstub_watch_page_num = 0;
+
+    /* Go through all watchpoint lists. */
+    watchpoint = first_rwatch;
+    while (1) {
+        if (watchpoint) {
+            /* Go through the watchpoint's range a page at a time. */
+            for (addr = watchpoint->addr; addr != watchpoint->end; addr += n) {
+                page = addr >> MEM_GRANULARITY_BITS;
+                n    = MEM_GRANULARITY_SIZE - (addr & MEM_GRANULARITY_MASK);
+                if (n > (watchpoint->end - addr))
+                    n = watchpoint->end - addr;
+
+                for (j = 0; j < gdbstub_watch_page_num; j++) {
+                    if (gdbstub_watch_page_list[j].page == page)
+                        break;
+                }
+
+                if (j < gdbstub_watch_page_num) {
+                    wp = &gdbstub_watch_page_list[j];
+                } else if (gdbstub_watch_pages[page >> 6] & (1ULL << (page & 63))) {
+                    /* Already watched whole. */
+                    continue;
+                } else {
+                    gdbstub_watch_pages[page >> 6] |= (1ULL << (page & 63));
+
+                    /* Out of byte maps, so watch this one whole. */
+                    if (gdbstub_watch_page_num == GDBSTUB_WATCH_PAGES)
+                        continue;
+
+                    wp = &gdbstub_watch_page_list[gdbstub_watch_page_num++];
+                    memset(wp, 0, sizeof(gdbstub_watch_page_t));
+                    wp->page = page;
+                }
+
+                for (uint32_t i = 0; i < n; i++)
+                    wp->bytes[((addr + i) & MEM_GRANULARITY_MASK) >> 6] |= (1ULL << ((addr + i) & 63));
+            }
+
+            watchpoint = watchpoint->next;
+        } else {
+            /* Jump from list to list as a shortcut. */
+            if (l == 0)
+                watchpoint = first_wwatch;
+            else if (l == 1)
+                watchpoint = first_awatch;
+            else
+                break;
+            l++;
+        }
     }
 }
 
@@ -867,40 +1042,33 @@ e22:
                 goto e22;
 
         case 'm': /* read memory */
+        case 'x': /* read memory binary */
             /* Read address and length. */
             if (!(i = gdbstub_client_read_word(client, &j)))
                 goto e22;
             client->packet_pos += i + 1;
             gdbstub_client_read_word(client, &k);
-            if (!k)
+            if (!k) {
+                /* GDB probes for binary read support this way. */
+                if (client->packet[0] == 'x') {
+                    FAST_RESPONSE("b");
+                    break;
+                }
                 goto e22;
+            }
 
             /* Clamp length. */
             if (k >= (sizeof(client->response) >> 1))
                 k = (sizeof(client->response) >> 1) - 1;
 
-            /* Read by qwords, then by dwords, then by words, then by bytes. */
-            i = 0;
-            if (is386) {
-                for (; i < (k & ~7); i += 8) {
-                    *((uint64_t *) buf) = readmemql(j);
-                    j += 8;
-                    gdbstub_client_respond_hex(client, buf, 8);
-                }
-                for (; i < (k & ~3); i += 4) {
-                    *((uint32_t *) buf) = readmemll(j);
-                    j += 4;
-                    gdbstub_client_respond_hex(client, buf, 4);
-                }
-            }
-            for (; i < (k & ~1); i += 2) {
-                *((uint16_t *) buf) = readmemwl(j);
-                j += 2;
-                gdbstub_client_respond_hex(client, buf, 2);
-            }
-            for (; i < k; i++) {
-                buf[0] = readmembl(j++);
-                gdbstub_client_respond_hex(client, buf, 1);
+            /* Read everything that can be read, and return what we got. */
+            if (!(k = gdbstub_mem_rw(client, j, gdbstub_mem_buf, k, 0)))
+                goto e14;
+            if (client->packet[0] == 'x') {
+                client->response[client->response_pos++] = 'b';
+                gdbstub_client_respond_binary(client, gdbstub_mem_buf, k);
+            } else {
+                gdbstub_client_respond_hex(client, gdbstub_mem_buf, k);
             }
             break;
 
@@ -911,8 +1079,12 @@ e22:
                 goto e22;
             client->packet_pos += i + 1;
             client->packet_pos += gdbstub_client_read_word(client, &k) + 1;
-            if (!k)
+            if (!k) {
+                /* GDB probes for binary write support this way. */
+                if (client->packet[0] == 'X')
+                    goto ok;
                 goto e22;
+            }
 
             /* Clamp length. */
             if (k >= ((sizeof(client->response) >> 1) - client->packet_pos))
@@ -933,30 +1105,9 @@ e22:
                 }
             }
 
-            /* Write by qwords, then by dwords, then by words, then by bytes. */
-            p = client->packet;
-            i = 0;
-            if (is386) {
-                for (; i < (k & ~7); i += 8) {
-                    writememql(j, *((uint64_t *) p));
-                    j += 8;
-                    p += 8;
-                }
-                for (; i < (k & ~3); i += 4) {
-                    writememll(j, *((uint32_t *) p));
-                    j += 4;
-                    p += 4;
-                }
-            }
-            for (; i < (k & ~1); i += 2) {
-                writememwl(j, *((uint16_t *) p));
-                j += 2;
-                p += 2;
-            }
-            for (; i < k; i++) {
-                writemembl(j++, p[0]);
-                p++;
-            }
+            /* Write everything, failing if any of it did not translate. */
+            if (gdbstub_mem_rw(client, j, (uint8_t *) client->packet, k, 1) != k)
+                goto e14;
 
             /* Respond positively. */
             goto ok;
@@ -1006,7 +1157,7 @@ e14:
                 /* Go through the feature list and negate ones we don't support. */
                 while ((client->response_pos < (sizeof(client->response) - 1)) && (i = gdbstub_client_read_string(client, &client->response[client->response_pos], sizeof(client->response) - client->response_pos - 1, ';'))) {
                     client->packet_pos += i + 1;
-                    if (strncmp(&client->response[client->response_pos], "PacketSize", 10) && strcmp(&client->response[client->response_pos], "swbreak") && strcmp(&client->response[client->response_pos], "hwbreak") && strncmp(&client->response[client->response_pos], "xmlRegisters", 12) && strcmp(&client->response[client->response_pos], "qXfer:features:read")) {
+                    if (strncmp(&client->response[client->response_pos], "PacketSize", 10) && strcmp(&client->response[client->response_pos], "swbreak") && strcmp(&client->response[client->response_pos], "hwbreak") && strncmp(&client->response[client->response_pos], "xmlRegisters", 12) && strcmp(&client->response[client->response_pos], "qXfer:features:read") && strncmp(&client->response[client->response_pos], "binary-upload", 13)) {
                         gdbstub_log("GDB Stub: Feature \"%s\" is not supported\n", &client->response[client->response_pos]);
                         client->response_pos += i;
                         client->response[client->response_pos++] = '-';
@@ -1019,7 +1170,7 @@ e14:
                 /* Add our supported features to the end. */
                 if (client->response_pos < (sizeof(client->response) - 1))
                     client->response_pos += snprintf(&client->response[client->response_pos], sizeof(client->response) - client->response_pos,
-                                                     "PacketSize=%X;swbreak+;hwbreak+;qXfer:features:read+", (int) (sizeof(client->packet) - 1));
+                                                     "PacketSize=%X;swbreak+;hwbreak+;qXfer:features:read+;binary-upload+", (int) (sizeof(client->packet) - 1));
                 break;
             } else if (!strcmp(client->response, "Xfer")) {
                 /* Read the transfer object. */
@@ -1090,6 +1241,12 @@ e00:
                         break;
                     }
                 }
+            } else if (!strcmp(client->response, "qemu.PhyMemMode")) {
+                if (client->phys_mode) {
+                    FAST_RESPONSE("1");
+                } else {
+                    FAST_RESPONSE("0");
+                }
             } else if (!strncmp(client->response, "Attached", 8)) {
                 FAST_RESPONSE("1");
             } else if (!strcmp(client->response, "C")) {
@@ -1239,6 +1396,15 @@ unknown:
             }
             break;
 
+        case 'Q': /* set */
+            /* Switch the memory packets between linear and physical addresses,
+               the way QEMU does with "maintenance packet Qqemu.PhyMemMode:1". */
+            if (!strncmp(&client->packet[1], "qemu.PhyMemMode:", 16)) {
+                client->phys_mode = (client->packet[17] == '1');
+                goto ok;
+            }
+            break;
+
         case 'z': /* remove break/watchpoint */
         case 'Z': /* insert break/watchpoint */
 
@@ -1328,36 +1494,9 @@ unknown:
                 free(breakpoint);
             }
 
-            /* Update the page watchpoint map if we're dealing with a watchpoint. */
-            if (client->packet[1] >= '2') {
-                /* Clear this watchpoint's corresponding page map groups,
-                   as everything is going to be recomputed soon anyway. */
-                memset(&gdbstub_watch_pages[j >> (MEM_GRANULARITY_BITS + 6)], 0,
-                       (((k - 1) >> (MEM_GRANULARITY_BITS + 6)) + 1) * sizeof(gdbstub_watch_pages[0]));
-
-                /* Go through all watchpoint lists. */
-                l          = 0;
-                breakpoint = first_rwatch;
-                while (1) {
-                    if (breakpoint) {
-                        /* Flag this watchpoint's corresponding pages as having a watchpoint. */
-                        k = (breakpoint->end - 1) >> MEM_GRANULARITY_BITS;
-                        for (i = breakpoint->addr >> MEM_GRANULARITY_BITS; i <= k; i++)
-                            gdbstub_watch_pages[i >> 6] |= (1ULL << (i & 63));
-
-                        breakpoint = breakpoint->next;
-                    } else {
-                        /* Jump from list to list as a shortcut. */
-                        if (l == 0)
-                            breakpoint = first_wwatch;
-                        else if (l == 1)
-                            breakpoint = first_awatch;
-                        else
-                            break;
-                        l++;
-                    }
-                }
-            }
+            /* Update the watchpoint maps if we're dealing with a watchpoint. */
+            if (client->packet[1] >= '2')
+                gdbstub_watch_update();
 
             /* Respond positively. */
             goto ok;
@@ -1813,8 +1952,9 @@ gdbstub_init(void)
     /* Create client list mutex. */
     client_list_mutex = thread_create_mutex();
 
-    /* Clear watchpoint page map. */
+    /* Clear watchpoint maps. */
     memset(gdbstub_watch_pages, 0, sizeof(gdbstub_watch_pages));
+    gdbstub_watch_page_num = 0;
 
     /* Start server thread. */
     pclog("GDB Stub: Listening on port %d\n", port);
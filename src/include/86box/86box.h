@@ -45,6 +45,11 @@
 #define POSTCARDS_NUM 4
 #define POSTCARD_MASK (POSTCARDS_NUM - 1)
 
+/* CPU slice scheduling modes, see pc_run(). */
+#define SCHED_FIXED      0 /* 10 ms slices */
+#define SCHED_ADAPTIVE   1 /* shorter on input, longer when behind */
+#define SCHED_THROUGHPUT 2 /* long slices for headless runs */
+
 #ifdef MIN
 #    undef MIN
 #endif
@@ -125,6 +130,11 @@ extern int      force_43;                   /* (C) video */
 extern int      video_filter_method;        /* (C) video */
 extern int      video_vsync;                /* (C) video */
 extern int      video_framerate;            /* (C) video */
+extern int      video_frame_dump;           /* (C) dump every Nth frame, 0 = off */
+extern int      video_render_thread;        /* (C) render SVGA scanlines on a per-monitor thread */
+extern int      video_cursor_layer;         /* (C) let the renderer composite hardware cursors */
+extern int      video_batch_lines;          /* (C) run quiet SVGA scanlines in batches */
+extern int      video_frame_pacing;         /* (C) present frames at the guest's refresh rate */
 extern int      gfxcard[GFXCARD_MAX];       /* (C) graphics/video card */
 extern int      bugger_enabled;             /* (C) enable ISAbugger */
 extern int      novell_keycard_enabled;     /* (C) enable Novell NetWare 2.x key card emulation. */
@@ -134,16 +144,30 @@ extern int      gameport_type[];            /* (C) enable gameports */
 extern int      isamem_type[];              /* (C) enable ISA mem cards */
 extern int      isartc_type;                /* (C) enable ISA RTC card */
 extern int      sound_is_float;             /* (C) sound uses FP values */
+extern int      sound_buffer_ms;            /* (C) length of one output buffer in ms */
+extern int      cd_audio_readahead;         /* (C) seconds of image CD audio decoded ahead */
 extern int      voodoo_enabled;             /* (C) video option */
 extern int      ibm8514_standalone_enabled; /* (C) video option */
 extern int      xga_standalone_enabled;     /* (C) video option */
 extern int      da2_standalone_enabled;     /* (C) video option */
 extern uint32_t mem_size;                   /* (C) memory size (Installed on system board) */
 extern uint32_t isa_mem_size;               /* (C) memory size (ISA Memory Cards) */
+extern int      mem_huge_pages;             /* (C) back guest RAM with host huge pages */
+extern int      mem_mergeable;              /* (C) let the host merge identical guest pages */
+extern int      mem_zero_release;           /* (C) give pages the guest zeroes back to the host */
+extern int      cpu_sched_mode;             /* (C) CPU slice scheduling mode */
+extern int      turbo_mode;                 /* unthrottled emulation, toggled at run time */
 extern int      cpu;                        /* (C) cpu type */
 extern int      cpu_use_dynarec;            /* (C) cpu uses/needs Dyna */
+extern int      cpu_dynarec_cache;          /* (C) persistent dynarec block cache */
+extern int      cpu_use_kvm;                /* (C) cpu runs under KVM if possible */
+extern int      cpu_dynarec_mmu_smc;        /* (C) host MMU catches writes to code pages */
+extern int      cpu_dynarec_pool_size;      /* (C) dynarec code pool size in MB, 0 = default */
+extern int      cpu_dynarec_stats;          /* (C) dynarec statistics interval in seconds, 0 = off */
+extern int      cpu_dynarec_compile_budget; /* (C) max. dynarec recompiles per time slice, 0 = unlimited */
 extern int      fpu_type;                   /* (C) fpu type */
 extern int      fpu_softfloat;              /* (C) fpu uses softfloat */
+extern int      fpu_softfloat_fast;         /* (C) softfloat uses the host fpu when exact */
 extern int      time_sync;                  /* (C) enable time sync */
 extern int      hdd_format_type;            /* (C) hard disk file format */
 extern int      lba_enhancer_enabled;       /* (C) enable Vision Systems LBA Enhancer */
@@ -160,13 +184,16 @@ extern int    fixed_size_y;
 extern int    sound_muted;                  /* (C) Is sound muted? */
 extern int    do_auto_pause;                /* (C) Auto-pause the emulator on focus loss */
 extern int    auto_paused;
+extern int    is_clone;                     /* Running as a fork()ed clone of another machine */
 extern double mouse_sensitivity;            /* (C) Mouse sensitivity scale */
 #ifdef _Atomic
 extern _Atomic double mouse_x_error;        /* Mouse error accumulator - Y */
 extern _Atomic double mouse_y_error;        /* Mouse error accumulator - Y */
 #endif
 extern int    pit_mode;                     /* (C) force setting PIT mode */
+extern int    acpi_host_timer;              /* (C) ACPI PM timer follows host time in turbo */
 extern int    fm_driver;                    /* (C) select FM sound driver */
+extern int    fm_synth_thread;              /* (C) run FM synthesis on its own thread */
 extern int    hook_enabled;                 /* (C) Keyboard hook is enabled */
 
 /* Keyboard variables for future key combination redefinition. */
@@ -192,6 +219,7 @@ extern __thread int is_cpu_thread; /* Is this the CPU thread? */
 /* Function prototypes. */
 #ifdef HAVE_STDARG_H
 extern void pclog_ex(const char *fmt, va_list ap);
+extern void pclog_fast_ex(const char *fmt, va_list ap);
 extern void fatal_ex(const char *fmt, va_list ap);
 #endif
 extern void pclog_toggle_suppr(void);
@@ -219,10 +247,14 @@ extern void pc_reset_hard_init(void);
 extern void pc_reset_hard(void);
 extern void pc_full_speed(void);
 extern void pc_speed_changed(void);
+extern void pc_set_turbo(int on);
+extern int  pc_trace_start(const char *fn);
+extern void pc_trace_stop(void);
+extern int  pc_trace_active(void);
 extern void pc_send_cad(void);
 extern void pc_send_cae(void);
 extern void pc_send_cab(void);
-extern void pc_run(void);
+extern int  pc_run(int backlog);
 extern void pc_start(void);
 extern void pc_onesec(void);
 
@@ -0,0 +1,50 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Headless benchmark runner.
+ *
+ *          The 86Box-bench build runs the machine for a fixed amount of
+ *          emulated time, and then prints what it got done in that time
+ *          as JSON. The counters of its own are only kept in that build,
+ *          elsewhere BENCH_COUNT() compiles to nothing. Instructions and
+ *          frames come from the performance counters, which always are.
+ */
+#ifndef EMU_BENCH_H
+#define EMU_BENCH_H
+
+#define BENCH_RUN_MS 10000 /* Emulated time to run for, unless told otherwise. */
+
+typedef struct bench_counters_t {
+    uint64_t timer_events;  /* Timer callbacks run. */
+    uint64_t audio_buffers; /* Main sound output buffers generated. */
+} bench_counters_t;
+
+#ifdef USE_BENCH
+extern bench_counters_t bench_counters;
+extern uint64_t         bench_run_ms;
+
+#    define BENCH_COUNT(counter, n) bench_counters.counter += (n)
+#else
+#    define BENCH_COUNT(counter, n)
+#endif
+
+/* Called by the emulation thread as it starts, and then with the length
+   of every slice it ran. Returns 1 once the run is done, and the results
+   are printed. */
+extern void bench_init(void);
+extern int  bench_slice(int ms);
+
+/* The micro-benchmarks, which are run instead of the machine once any is
+   asked for. bench_kernel_add() takes "name[:param=value,...]", and
+   returns -1 if there is no such kernel. */
+extern int  bench_kernels_num;
+extern int  bench_kernel_add(const char *spec);
+extern void bench_kernels_list(void);
+extern int  bench_kernels_run(void);
+
+#endif /*EMU_BENCH_H*/
@@ -274,6 +274,10 @@ typedef struct cdrom_ops_t {
     int      (*is_empty)(const void *local);
     void     (*close)(void *local);
     void     (*load)(const void *local);
+    /* Optional: the 2048-byte user data of up to count Mode 1 sectors,
+       returns how many of them were read. */
+    int      (*read_data_sectors)(const void *local, uint8_t *buffer,
+                                  const uint32_t sector, const uint32_t count);
 } cdrom_ops_t;
 
 typedef struct cdrom {
@@ -303,6 +307,8 @@ typedef struct cdrom {
     char *             image_history[CD_IMAGE_HISTORY];
 
     uint32_t           sound_on;
+    uint32_t           instant;   /* Skip seek and transfer timing. */
+    uint32_t           readahead; /* Image read-ahead in kB, 0 = none. */
     uint32_t           cdrom_capacity;
     uint32_t           seek_pos;
     uint32_t           seek_diff;
@@ -420,6 +426,8 @@ extern uint8_t         cdrom_read_disc_info_toc(cdrom_t *dev, uint8_t *b,
 extern int             cdrom_readsector_raw(cdrom_t *dev, uint8_t *buffer, const int sector, const int ismsf,
                                             int cdrom_sector_type, const int cdrom_sector_flags,
                                             int *len, const uint8_t vendor_type);
+extern int             cdrom_read_data_sectors(cdrom_t *dev, uint8_t *buffer, const int sector, const int count,
+                                               const int cdrom_sector_type, const int cdrom_sector_flags);
 extern int             cdrom_read_dvd_structure(const cdrom_t *dev, const uint8_t layer, const uint8_t format,
                                                 uint8_t *buffer, uint32_t *info);
 extern void            cdrom_read_disc_information(const cdrom_t *dev, uint8_t *buffer);
@@ -29,6 +29,7 @@ typedef struct track_file_t {
     FILE *fp;
     void *priv;
     void *log;
+    void *cache;
 
     int motorola;
 } track_file_t;
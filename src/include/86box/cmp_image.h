@@ -0,0 +1,55 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Chunked compressed image header.
+ *
+ *          The image is split into chunks of a fixed power of two size,
+ *          each compressed on its own with zlib so any one of them can
+ *          be read without touching the others. The file starts with
+ *          the header below, and the chunk index it points to holds an
+ *          entry per chunk, in order. An entry with a length of 0 is a
+ *          chunk of zeroes, one with a length equal to the size of the
+ *          chunk is stored uncompressed, anything else is a zlib stream.
+ *          All fields are little endian.
+ *
+ *          The same format holds hard disk images, which may carry their
+ *          geometry in the header, and CD-ROM ISO or BIN images.
+ */
+#ifndef CMP_IMAGE_H
+#define CMP_IMAGE_H
+
+#define CMP_IMAGE_MAGIC   "86BOXCMP"
+#define CMP_IMAGE_VERSION 1
+
+typedef struct cmp_image_header_t {
+    char     magic[8];
+    uint32_t version;
+    uint32_t chunk_size;   /* 4 kB to 1 MB. */
+    uint64_t size;         /* Uncompressed size in bytes. */
+    uint64_t index_offset;
+    uint32_t chunks;
+    uint32_t spt;          /* Hard disk geometry, 0 if unknown. */
+    uint32_t hpc;
+    uint32_t tracks;
+} cmp_image_header_t;
+
+typedef struct cmp_image_entry_t {
+    uint64_t offset;
+    uint32_t length;
+    uint32_t reserved;
+} cmp_image_entry_t;
+
+typedef struct cmp_image_t cmp_image_t;
+
+extern int          cmp_image_is_cmp(const char *fn);
+extern cmp_image_t *cmp_image_open(const char *fn);
+extern void         cmp_image_close(cmp_image_t *img);
+extern const cmp_image_header_t *cmp_image_get_header(const cmp_image_t *img);
+extern int          cmp_image_read(cmp_image_t *img, uint8_t *buffer, uint64_t offset, size_t count);
+
+#endif /*CMP_IMAGE_H*/
@@ -157,6 +157,8 @@ typedef struct _device_config_ {
     const device_config_bios_t       bios[32];
 } device_config_t;
 
+struct snapshot_t;
+
 typedef struct _device_ {
     const char *name;
     const char *internal_name;
@@ -174,6 +176,10 @@ typedef struct _device_ {
     void (*force_redraw)(void *priv);
 
     const device_config_t *config;
+
+    /* Machine snapshots, see snapshot.h. */
+    void (*save)(void *priv, struct snapshot_t *s);
+    int  (*load)(void *priv, struct snapshot_t *s);
 } device_t;
 
 typedef struct device_context_t {
@@ -204,6 +210,7 @@ extern void *device_get_common_priv(void);
 extern void  device_close_all(void);
 extern void  device_reset_all(uint32_t match_flags);
 extern void *device_find_first_priv(uint32_t match_flags);
+extern int   device_get_attached(int c, const device_t **dev, void **priv);
 extern void *device_get_priv(const device_t *dev);
 extern int   device_available(const device_t *dev);
 extern void  device_speed_changed(void);
@@ -232,6 +239,7 @@ extern void        device_set_config_hex20(const char *str, int val);
 extern void        device_set_config_mac(const char *str, int val);
 extern const char *device_get_config_string(const char *name);
 extern int         device_get_instance(void);
+extern const char *device_get_current_name(void);
 #define device_get_config_bios device_get_config_string
 
 extern const char *device_get_internal_name(const device_t *dev);
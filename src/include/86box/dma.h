@@ -99,6 +99,7 @@ extern void dma_set_drq(int channel, int set);
 extern int dma_channel_read_only(int channel);
 extern int dma_channel_advance(int channel);
 extern int dma_channel_read(int channel);
+extern int dma_channel_read_n(int channel, uint16_t *buf, int n);
 extern int dma_channel_write(int channel, uint16_t val);
 
 extern void dma_alias_set(void);
@@ -108,6 +109,7 @@ extern void dma_alias_remove_piix(void);
 
 extern void dma_bm_read(uint32_t PhysAddress, uint8_t *DataRead, uint32_t TotalSize, int TransferSize);
 extern void dma_bm_write(uint32_t PhysAddress, const uint8_t *DataWrite, uint32_t TotalSize, int TransferSize);
+extern void dma_bm_read_ring(uint32_t PhysAddress, uint8_t *ring, uint32_t ring_size, uint32_t pos, uint32_t TotalSize, int TransferSize);
 
 void dma_set_params(uint8_t advanced, uint32_t mask);
 void dma_set_mask(uint32_t mask);
@@ -122,4 +124,8 @@ void dma_set_sg_base(uint8_t sg_base);
 
 extern int dma_channel_readable(int channel);
 
+struct snapshot_t;
+extern void dma_snapshot_save(struct snapshot_t *s);
+extern int  dma_snapshot_load(struct snapshot_t *s);
+
 #endif /*EMU_DMA_H*/
@@ -0,0 +1,62 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Device event bus.
+ *
+ *          Work a device can do without looking at the rest of the
+ *          machine, such as rendering a page or reading ahead from an
+ *          image, is posted to a channel. The channels' jobs run on a
+ *          small pool of worker threads, one job of a channel at a time
+ *          and in the order they were posted, so what a channel does
+ *          needs no locking of its own.
+ *
+ *          A job may also have a completion, which is what the guest
+ *          gets to see of it. Completions run on the emulation thread,
+ *          between two slices of CPU time, once the emulated time the
+ *          job was due at has passed. If the job is not done by then,
+ *          the emulation thread waits for it, so the guest sees the
+ *          result at the same point however fast the host is.
+ */
+#ifndef EMU_EVBUS_H
+#define EMU_EVBUS_H
+
+#define EVBUS_WORKERS 2
+
+typedef struct evbus_chan_t evbus_chan_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern void evbus_init(void);
+extern void evbus_close(void);
+
+/* Waits for the jobs still queued to it, and drops their completions. */
+extern evbus_chan_t *evbus_chan_create(void);
+extern void          evbus_chan_destroy(evbus_chan_t *ch);
+
+/* Queues work(priv) on the channel. If done is set, done(priv) is run by
+   the emulation thread delay_us of emulated time from now, or as soon as
+   work is done if that is later; either way work is done by then. Only
+   the emulation thread may post. */
+extern void evbus_post(evbus_chan_t *ch, void (*work)(void *priv),
+                       void (*done)(void *priv), void *priv, double delay_us);
+
+/* Jobs of the channel that have not finished yet. */
+extern int  evbus_chan_jobs(evbus_chan_t *ch);
+/* Waits until at most limit jobs of the channel are left. */
+extern void evbus_chan_wait(evbus_chan_t *ch, int limit);
+
+/* Called by the emulation thread after every slice. */
+extern void evbus_dispatch(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /*EMU_EVBUS_H*/
@@ -25,6 +25,8 @@
 #define FLOPPY_IMAGE_HISTORY 10
 #define SEEK_RECALIBRATE     -999
 
+struct snapshot_t;
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -58,6 +60,9 @@ extern int  fdd_get_type(int drive);
 extern int fdd_get_flags(int drive);
 extern int fdd_get_densel(int drive);
 
+extern void fdd_snapshot_save(struct snapshot_t *s);
+extern int  fdd_snapshot_load(struct snapshot_t *s);
+
 extern char *fdd_getname(int type);
 
 extern char *fdd_get_internal_name(int type);
@@ -135,6 +140,7 @@ typedef union {
 } crc_t;
 
 void fdd_calccrc(uint8_t byte, crc_t *crc_var);
+void fdd_calccrc_buf(const uint8_t *buf, uint32_t len, crc_t *crc_var);
 
 typedef struct d86f_handler_t {
     uint16_t (*disk_flags)(int drive);
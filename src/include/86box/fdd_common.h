@@ -29,4 +29,10 @@ extern int     fdd_sector_code_size(uint8_t code);
 extern int     fdd_bps_valid(uint16_t bps);
 extern int     fdd_interleave(int sector, int skew, int spt);
 
+/* Hash of a whole image file, which is left at its start. */
+extern uint64_t       fdd_image_hash(FILE *fp);
+/* Decoded contents of the image with the hash, if they were kept. */
+extern const uint8_t *fdd_decoded_find(uint64_t hash, uint32_t *size);
+extern void           fdd_decoded_add(uint64_t hash, const uint8_t *data, uint32_t size);
+
 #endif /*FDD_COMMON_H*/
@@ -319,40 +319,6 @@ high_cut_iir(int c, int i, double NewSample)
     return y[c][i][0];
 }
 
-/* fc=5.283kHz, gain=-9.477dB, width=0.4845 */
-static inline double
-deemph_iir(int i, double NewSample)
-{
-    double ACoef[NCoef + 1] = {
-        0.46035077886318842566,
-        -0.28440821191249848754,
-        0.03388877229118691936
-    };
-
-    double BCoef[NCoef + 1] = {
-        1.00000000000000000000,
-        -1.05429146278569141337,
-        0.26412280202756849290
-    };
-    static double y[5][NCoef + 1]; /* output samples */
-    static double x[5][NCoef + 1]; /* input samples */
-    int           n;
-
-    /* shift the old samples */
-    for (n = NCoef; n > 0; n--) {
-        x[i][n] = x[i][n - 1];
-        y[i][n] = y[i][n - 1];
-    }
-
-    /* Calculate the new output */
-    x[i][0] = NewSample;
-    y[i][0] = ACoef[0] * x[i][0];
-    for (n = 1; n <= NCoef; n++)
-        y[i][0] += ACoef[n] * x[i][n] - BCoef[n] * y[i][n];
-
-    return y[i][0];
-}
-
 #undef NCoef
 #define NCoef 2
 
@@ -449,4 +415,129 @@ low_fir_pas16(const int i, const double NewSample)
     return out;
 }
 
+/*
+ * Block oriented biquad in transposed direct form II. Both channels of an
+ * interleaved stereo buffer are filtered at once, which maps directly onto
+ * a pair of doubles in an SSE2 or AArch64 NEON register.
+ */
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#    define FILTERS_SSE2
+#    include <emmintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#    define FILTERS_NEON
+#    include <arm_neon.h>
+#endif
+
+typedef struct biquad_t {
+    double b0;
+    double b1;
+    double b2;
+    double a1;
+    double a2;
+
+    double z1[2];
+    double z2[2];
+} biquad_t;
+
+static inline void
+biquad_reset(biquad_t *bq)
+{
+    bq->z1[0] = bq->z1[1] = 0.0;
+    bq->z2[0] = bq->z2[1] = 0.0;
+}
+
+/* Takes the same ACoef/BCoef tables as the filters above, BCoef[0] being 1. */
+static inline void
+biquad_init(biquad_t *bq, const double *ACoef, const double *BCoef)
+{
+    bq->b0 = ACoef[0];
+    bq->b1 = ACoef[1];
+    bq->b2 = ACoef[2];
+    bq->a1 = BCoef[1];
+    bq->a2 = BCoef[2];
+
+    biquad_reset(bq);
+}
+
+static inline double
+biquad_tick(biquad_t *bq, int i, double NewSample)
+{
+    double out = (bq->b0 * NewSample) + bq->z1[i];
+
+    bq->z1[i] = (bq->b1 * NewSample) - (bq->a1 * out) + bq->z2[i];
+    bq->z2[i] = (bq->b2 * NewSample) - (bq->a2 * out);
+
+    return out;
+}
+
+static inline void
+biquad_process_stereo(biquad_t *bq, double *buf, int frames)
+{
+#if defined(FILTERS_SSE2)
+    const __m128d b0 = _mm_set1_pd(bq->b0);
+    const __m128d b1 = _mm_set1_pd(bq->b1);
+    const __m128d b2 = _mm_set1_pd(bq->b2);
+    const __m128d a1 = _mm_set1_pd(bq->a1);
+    const __m128d a2 = _mm_set1_pd(bq->a2);
+    __m128d       z1 = _mm_loadu_pd(bq->z1);
+    __m128d       z2 = _mm_loadu_pd(bq->z2);
+
+    for (int c = 0; c < frames; c++) {
+        __m128d in  = _mm_loadu_pd(&buf[c * 2]);
+        __m128d out = _mm_add_pd(_mm_mul_pd(b0, in), z1);
+
+        z1 = _mm_add_pd(_mm_sub_pd(_mm_mul_pd(b1, in), _mm_mul_pd(a1, out)), z2);
+        z2 = _mm_sub_pd(_mm_mul_pd(b2, in), _mm_mul_pd(a2, out));
+        _mm_storeu_pd(&buf[c * 2], out);
+    }
+
+    _mm_storeu_pd(bq->z1, z1);
+    _mm_storeu_pd(bq->z2, z2);
+#elif defined(FILTERS_NEON)
+    const float64x2_t b0 = vdupq_n_f64(bq->b0);
+    const float64x2_t b1 = vdupq_n_f64(bq->b1);
+    const float64x2_t b2 = vdupq_n_f64(bq->b2);
+    const float64x2_t a1 = vdupq_n_f64(bq->a1);
+    const float64x2_t a2 = vdupq_n_f64(bq->a2);
+    float64x2_t       z1 = vld1q_f64(bq->z1);
+    float64x2_t       z2 = vld1q_f64(bq->z2);
+
+    for (int c = 0; c < frames; c++) {
+        float64x2_t in  = vld1q_f64(&buf[c * 2]);
+        float64x2_t out = vaddq_f64(vmulq_f64(b0, in), z1);
+
+        z1 = vaddq_f64(vsubq_f64(vmulq_f64(b1, in), vmulq_f64(a1, out)), z2);
+        z2 = vsubq_f64(vmulq_f64(b2, in), vmulq_f64(a2, out));
+        vst1q_f64(&buf[c * 2], out);
+    }
+
+    vst1q_f64(bq->z1, z1);
+    vst1q_f64(bq->z2, z2);
+#else
+    for (int c = 0; c < frames; c++) {
+        buf[c * 2]       = biquad_tick(bq, 0, buf[c * 2]);
+        buf[(c * 2) + 1] = biquad_tick(bq, 1, buf[(c * 2) + 1]);
+    }
+#endif
+}
+
+/* CD de-emphasis, fc=5.283kHz, gain=-9.477dB, width=0.4845 */
+static inline void
+deemph_biquad_init(biquad_t *bq)
+{
+    const double ACoef[3] = {
+        0.46035077886318842566,
+        -0.28440821191249848754,
+        0.03388877229118691936
+    };
+
+    const double BCoef[3] = {
+        1.00000000000000000000,
+        -1.05429146278569141337,
+        0.26412280202756849290
+    };
+
+    biquad_init(bq, ACoef, BCoef);
+}
+
 #endif /*EMU_FILTERS_H*/
@@ -23,6 +23,8 @@
 #define GDBSTUB_MEM_WRITE  16
 #define GDBSTUB_MEM_AWATCH 32
 
+#define GDBSTUB_WATCH_PAGES 16 /* Pages watched down to the byte, any others are watched whole. */
+
 enum {
     GDBSTUB_EXEC         = 0,
     GDBSTUB_SSTEP        = 1,
@@ -36,22 +38,65 @@ enum {
 
 #ifdef USE_GDBSTUB
 
-#    define GDBSTUB_MEM_ACCESS(addr, access, width)                                   \
-        uint32_t gdbstub_page = (addr) >> MEM_GRANULARITY_BITS;                       \
-        if (gdbstub_watch_pages[gdbstub_page >> 6] & (1ULL << (gdbstub_page & 63))) { \
-            uint32_t gdbstub_addrs[(width)];                                          \
-            for (int gdbstub_i = 0; gdbstub_i < (width); gdbstub_i++)                 \
-                gdbstub_addrs[gdbstub_i] = (addr) + gdbstub_i;                        \
-            gdbstub_mem_access(gdbstub_addrs, (access) | (width));                    \
+#    define GDBSTUB_MEM_ACCESS(addr, access, width)                                      \
+        uint32_t gdbstub_page = (addr) >> MEM_GRANULARITY_BITS;                          \
+        if ((gdbstub_watch_pages[gdbstub_page >> 6] & (1ULL << (gdbstub_page & 63))) &&  \
+            gdbstub_watch_hit((addr), (width))) {                                        \
+            uint32_t gdbstub_addrs[(width)];                                             \
+            for (int gdbstub_i = 0; gdbstub_i < (width); gdbstub_i++)                    \
+                gdbstub_addrs[gdbstub_i] = (addr) + gdbstub_i;                           \
+            gdbstub_mem_access(gdbstub_addrs, (access) | (width));                       \
+        }
+
+#    define GDBSTUB_MEM_ACCESS_FAST(addrs, access, width)                                \
+        uint32_t gdbstub_page = (addrs)[0] >> MEM_GRANULARITY_BITS;                      \
+        if (gdbstub_watch_pages[gdbstub_page >> 6] & (1ULL << (gdbstub_page & 63))) {    \
+            for (int gdbstub_i = 0; gdbstub_i < (width); gdbstub_i++) {                  \
+                if (gdbstub_watch_hit((addrs)[gdbstub_i], 1)) {                          \
+                    gdbstub_mem_access((addrs), (access) | (width));                     \
+                    break;                                                               \
+                }                                                                        \
+            }                                                                            \
+        }
+
+/* Which bytes of a watched page are covered by a watchpoint. */
+typedef struct gdbstub_watch_page_t {
+    uint32_t page;
+    uint64_t bytes[MEM_GRANULARITY_SIZE >> 6];
+} gdbstub_watch_page_t;
+
+extern int                  gdbstub_step, gdbstub_next_asap;
+extern uint64_t             gdbstub_watch_pages[(((uint32_t) -1) >> (MEM_GRANULARITY_BITS + 6)) + 1];
+extern int                  gdbstub_watch_page_num;
+extern gdbstub_watch_page_t gdbstub_watch_page_list[GDBSTUB_WATCH_PAGES];
+
+/* Returns whether any of the bytes accessed is watched, only to be asked
+   once the page map says a watchpoint is somewhere near. */
+static inline int
+gdbstub_watch_hit(uint32_t addr, int width)
+{
+    for (int i = 0; i < width; i++, addr++) {
+        uint32_t page = addr >> MEM_GRANULARITY_BITS;
+        int      j;
+
+        if (!(gdbstub_watch_pages[page >> 6] & (1ULL << (page & 63))))
+            continue;
+
+        for (j = 0; j < gdbstub_watch_page_num; j++) {
+            if (gdbstub_watch_page_list[j].page == page)
+                break;
         }
 
-#    define GDBSTUB_MEM_ACCESS_FAST(addrs, access, width)                           \
-        uint32_t gdbstub_page = (addrs)[0] >> MEM_GRANULARITY_BITS;                 \
-        if (gdbstub_watch_pages[gdbstub_page >> 6] & (1ULL << (gdbstub_page & 63))) \
-            gdbstub_mem_access((addrs), (access) | (width));
+        /* Watched whole, as there was no room to keep track of it. */
+        if (j == gdbstub_watch_page_num)
+            return 1;
+
+        if (gdbstub_watch_page_list[j].bytes[(addr & MEM_GRANULARITY_MASK) >> 6] & (1ULL << (addr & 63)))
+            return 1;
+    }
 
-extern int      gdbstub_step, gdbstub_next_asap;
-extern uint64_t gdbstub_watch_pages[(((uint32_t) -1) >> (MEM_GRANULARITY_BITS + 6)) + 1];
+    return 0;
+}
 
 extern void gdbstub_cpu_init(void);
 extern int  gdbstub_instruction(void);
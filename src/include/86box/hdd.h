@@ -100,6 +100,7 @@ typedef struct hdd_preset_t {
     uint32_t    max_multiple;
     double      full_stroke_ms;
     double      track_seek_ms;
+    uint32_t    instant;
 } hdd_preset_t;
 
 typedef struct hdd_cache_seg_t {
@@ -159,6 +160,7 @@ typedef struct hard_disk_t {
 
     char fn[1024];         /* Name of current image file */
     char vhd_parent[1041]; /* Differential VHD parent file */
+    char overlay_fn[1024]; /* Copy-on-write overlay, fn is then read-only */
 
     uint32_t seek_pos;
     uint32_t seek_len;
@@ -182,6 +184,12 @@ typedef struct hard_disk_t {
 
     uint32_t speed_preset;
     uint32_t vhd_blocksize;
+    uint32_t image_cache_size; /* Host sector cache in MB, 0 = none. */
+    uint32_t vhd_sparse_alloc; /* Leave new VHD blocks as holes in the file. */
+    uint32_t overlay_discard;  /* Empty the overlay on every load. */
+    uint32_t instant;          /* No timing model, set by the preset. */
+    uint32_t tcq;              /* Report tagged command queuing on SCSI. */
+    uint32_t trim;             /* Report TRIM on IDE and UNMAP on SCSI. */
 
     double avg_rotation_lat_usec;
     double full_stroke_usec;
@@ -206,6 +214,11 @@ extern int      hdd_image_write(uint8_t id, uint32_t sector, uint32_t count, uin
 extern int      hdd_image_write_ex(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer);
 extern int      hdd_image_zero(uint8_t id, uint32_t sector, uint32_t count);
 extern int      hdd_image_zero_ex(uint8_t id, uint32_t sector, uint32_t count);
+extern uint8_t *hdd_image_get_span(uint8_t id, uint32_t sector, uint32_t count);
+extern void     hdd_image_flush(uint8_t id);
+extern int      hdd_image_overlay_discard(uint8_t id);
+extern int      hdd_image_overlay_merge(uint8_t id);
+extern int      hdd_image_overlay_clone(uint8_t id, const char *fn);
 extern uint32_t hdd_image_get_last_sector(uint8_t id);
 extern uint32_t hdd_image_get_pos(uint8_t id);
 extern uint8_t  hdd_image_get_type(uint8_t id);
@@ -103,16 +103,27 @@ extern void io_handler_interleaved(int set, uint16_t base, int size,
                                    void (*outl)(uint16_t addr, uint32_t val, void *priv),
                                    void *priv);
 
+extern void io_handler_rep(int set, uint16_t base, int size,
+                           int (*inw_rep)(uint16_t addr, uint16_t *buf, int count, void *priv),
+                           int (*outw_rep)(uint16_t addr, const uint16_t *buf, int count, void *priv),
+                           void *priv);
+
 extern uint8_t  inb(uint16_t port);
 extern void     outb(uint16_t port, uint8_t val);
 extern uint16_t inw(uint16_t port);
 extern void     outw(uint16_t port, uint16_t val);
 extern uint32_t inl(uint16_t port);
 extern void     outl(uint16_t port, uint32_t val);
+extern int      inw_rep(uint16_t port, uint16_t *buf, int count);
+extern int      outw_rep(uint16_t port, const uint16_t *buf, int count);
 
 extern void *io_trap_add(void (*func)(int size, uint16_t addr, uint8_t write, uint8_t val, void *priv),
                          void *priv);
 extern void  io_trap_remap(void *handle, int enable, uint16_t addr, uint16_t size);
 extern void  io_trap_remove(void *handle);
 
+/* Log the most accessed ports since the last dump and reset the counters,
+   only active in builds with USE_IO_STATS. Also done on every hard reset. */
+extern void io_port_stats_dump(void);
+
 #endif /*EMU_IO_H*/
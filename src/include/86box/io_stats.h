@@ -0,0 +1,88 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Per-drive storage I/O counters.
+ *
+ *          The totals are bumped by the emulation thread as images are
+ *          accessed. About once a second, io_stats_update() turns them
+ *          into rates for the status bar, and into counter tracks when
+ *          built with minitrace.
+ */
+#ifndef EMU_IO_STATS_H
+#define EMU_IO_STATS_H
+
+typedef struct io_stats_t {
+    /* Totals since the emulator was started. */
+    uint64_t reads;
+    uint64_t writes;
+    uint64_t read_bytes;
+    uint64_t write_bytes;
+    uint64_t host_us;    /* Host time spent in the transfers. */
+    uint64_t hits;       /* Host side cache or read-ahead lookups. */
+    uint64_t misses;
+    uint32_t queued;     /* Bytes waiting in a write-behind queue. */
+    uint32_t queued_max;
+
+    /* Rates over the last update interval. */
+    uint32_t iops;
+    uint32_t kbps;
+    uint32_t avg_us;     /* Average host time per transfer. */
+    int      hit_pct;    /* -1 if there were no lookups. */
+
+    /* Totals at the last update. */
+    uint64_t last_ops;
+    uint64_t last_bytes;
+    uint64_t last_us;
+    uint64_t last_hits;
+    uint64_t last_misses;
+
+    char     name[16];   /* Trace category, "HDD 01" and such. */
+} io_stats_t;
+
+extern io_stats_t hdd_io_stats[];
+extern io_stats_t cdrom_io_stats[];
+extern io_stats_t zip_io_stats[];
+extern io_stats_t mo_io_stats[];
+
+extern uint32_t io_stats_seq; /* Bumped on every update. */
+
+static inline void
+io_stats_transfer(io_stats_t *s, int write, uint32_t bytes, uint64_t us)
+{
+    if (write) {
+        s->writes++;
+        s->write_bytes += bytes;
+    } else {
+        s->reads++;
+        s->read_bytes += bytes;
+    }
+    s->host_us += us;
+}
+
+static inline void
+io_stats_lookup(io_stats_t *s, int hit)
+{
+    if (hit)
+        s->hits++;
+    else
+        s->misses++;
+}
+
+static inline void
+io_stats_queue(io_stats_t *s, uint32_t queued)
+{
+    s->queued = queued;
+    if (queued > s->queued_max)
+        s->queued_max = queued;
+}
+
+extern void io_stats_reset(io_stats_t *s);
+extern void io_stats_init(void);
+extern void io_stats_update(void);
+
+#endif /*EMU_IO_STATS_H*/
@@ -47,7 +47,8 @@ typedef struct kbc_at_port_t {
 
     void *priv;
 
-    void (*poll)(void *priv);
+    /* Returns non-zero while the device still has work in progress. */
+    int (*poll)(void *priv);
 } kbc_at_port_t;
 
 /* Used by the AT / PS/2 common device, keyboard, and mouse. */
@@ -270,6 +271,9 @@ extern void     keyboard_process(void);
 extern uint16_t keyboard_convert(int ch);
 extern void     keyboard_input(int down, uint16_t scan);
 extern void     keyboard_all_up(void);
+/* The same, once any recording or playback has had its say. */
+extern void     keyboard_input_emu(int down, uint16_t scan, int captured);
+extern void     keyboard_all_up_emu(void);
 extern void     keyboard_update_states(uint8_t cl, uint8_t nl, uint8_t sl);
 extern uint8_t  keyboard_get_shift(void);
 extern void     keyboard_get_states(uint8_t *cl, uint8_t *nl, uint8_t *sl);
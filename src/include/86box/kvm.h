@@ -0,0 +1,35 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Definitions for the KVM execution backend.
+ *
+ *          On a Linux host with KVM, a P6-class machine can run its
+ *          guest code on the host CPU instead of the recompiler. Only
+ *          the CPU moves into the kernel: memory that is not plain RAM
+ *          or ROM, every I/O port and every interrupt still goes through
+ *          the emulated chipset and devices.
+ */
+#ifndef EMU_KVM_H
+#define EMU_KVM_H
+
+/* Opens /dev/kvm and sets up the virtual machine, returns 0 if the
+   current CPU can not be run under KVM on this host. */
+extern int  kvm_init(void);
+extern void kvm_close(void);
+
+/* The cpu_exec of the backend. */
+extern void kvm_exec(int32_t cycs);
+
+/* The memory map has changed, the guest memory is laid out again before
+   the guest next runs. */
+extern void kvm_mem_changed(void);
+/* cpu_state has been changed behind the guest's back, it is loaded into
+   the virtual CPU before the guest next runs. */
+extern void kvm_state_changed(void);
+
+#endif /*EMU_KVM_H*/
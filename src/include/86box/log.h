@@ -28,6 +28,15 @@ extern "C" {
 #define LOG_SIZE_BUFFER_CYCLIC_LINES    32              /* Cyclic log size buffer (number of lines that should be cehcked) */
 #define LOG_MINIMUM_REPEAT_ORDER        4               /* Minimum repeat size */
 
+enum {
+    LOG_MODE_SYNC = 0,  /* Every line is written out before the call returns. */
+    LOG_MODE_ASYNC,     /* Lines are queued, and a writer thread writes them out. */
+    LOG_MODE_BINARY     /* As above, and pclog_fast_ex() leaves the formatting to the writer. */
+};
+
+extern int log_mode;       /* (O) how log lines get to the log file */
+extern int log_rate_limit; /* (O) lines per second per call site, 0 for no limit */
+
 /* Function prototypes. */
 extern void log_set_suppr_seen(void *priv, int suppr_seen);
 extern void log_set_dev_name(void *priv, char *dev_name);
@@ -40,6 +49,18 @@ extern void *log_open(const char *dev_name);
 extern void *log_open_cyclic(const char *dev_name);
 extern void  log_close(void *priv);
 
+/* Asynchronous log writer. */
+#ifndef RELEASE_BUILD
+extern void log_emit(const char *s);
+extern void log_emit_fast(const char *fmt, va_list);
+extern int  log_rate_check(const char *fmt);
+#endif /*RELEASE_BUILD*/
+extern void log_flush(void);
+extern void log_thread_exit(void);
+extern void log_async_init(void);
+extern void log_async_close(void);
+extern void log_clone_child(void);
+
 #    ifdef __cplusplus
 }
 #    endif
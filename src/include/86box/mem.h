@@ -219,6 +219,14 @@ typedef struct page_t {
     /*Head of codeblock tree associated with this page*/
     uint16_t head;
 
+    /*Self-modifying code tracking, see codegen_smc_account()*/
+    uint8_t  smc_coarse_count;
+    uint8_t  smc_byte_count;
+    uint16_t smc_cooldown;
+
+    /*Page holds descriptors in the segment descriptor cache*/
+    uint8_t desc_cached;
+
     uint64_t code_present_mask;
     uint64_t dirty_mask;
 
@@ -253,6 +261,9 @@ typedef struct _page_ {
 
     /*Head of codeblock tree associated with this page*/
     struct codeblock_t *head;
+
+    /*Page holds descriptors in the segment descriptor cache*/
+    uint8_t desc_cached;
 } page_t;
 #endif
 
@@ -301,6 +312,28 @@ extern int writelnum;
 extern int memspeed[11];
 
 extern int     mmu_perm;
+
+typedef struct mmu_tlb_stats_t {
+    uint64_t read_misses;
+    uint64_t write_misses;
+    uint64_t flushes;
+    uint64_t partial_flushes;
+    uint64_t global_kept;
+    uint64_t walk_cache_hits; /* TLB misses that found their directory entry cached */
+} mmu_tlb_stats_t;
+
+extern mmu_tlb_stats_t mmu_tlb_stats;
+
+typedef struct mem_recalc_stats_t {
+    uint64_t count;
+    uint64_t skipped_flushes;
+    uint64_t smm_views_reused; /* SMI/RSM switches served from a precomputed view */
+    uint64_t time_last_second; /* in plat_timer_read() units */
+} mem_recalc_stats_t;
+
+extern mem_recalc_stats_t mem_recalc_stats;
+
+typedef struct mem_dirty_t mem_dirty_t;
 extern uint8_t high_page; /* if a high (> 4 gb) page was detected */
 
 extern uint8_t *_mem_exec[MEM_MAPPINGS_NO];
@@ -317,6 +350,64 @@ extern uint16_t read_mem_w(uint32_t addr);
 extern void     write_mem_b(uint32_t addr, uint8_t val);
 extern void     write_mem_w(uint32_t addr, uint16_t val);
 
+/*
+ * Direct pointers into RAM for the first megabyte, by MEM_GRANULARITY
+ * block, for the cores that address memory physically through the
+ * functions above. A block has one while the mapping the CPU sees there
+ * is plain RAM, and a write pointer only once dirty tracking has the
+ * page dirty, so the first write to a clean page still goes through the
+ * handlers and marks it. Everything else takes the full path.
+ */
+#define MEM_FAST_SIZE   0x100000
+#define MEM_FAST_BLOCKS (MEM_FAST_SIZE >> MEM_GRANULARITY_BITS)
+
+extern uint8_t *mem_fast_read[MEM_FAST_BLOCKS];
+extern uint8_t *mem_fast_write[MEM_FAST_BLOCKS];
+
+static __inline uint8_t
+read_mem_b_fast(uint32_t addr)
+{
+    uint32_t a = addr & rammask;
+
+    if ((a < MEM_FAST_SIZE) && (mem_fast_read[a >> MEM_GRANULARITY_BITS]))
+        return mem_fast_read[a >> MEM_GRANULARITY_BITS][a & MEM_GRANULARITY_MASK];
+
+    return read_mem_b(addr);
+}
+
+static __inline uint16_t
+read_mem_w_fast(uint32_t addr)
+{
+    uint32_t a = addr & rammask;
+
+    if (!(a & 1) && (a < MEM_FAST_SIZE) && (mem_fast_read[a >> MEM_GRANULARITY_BITS]))
+        return *(uint16_t *) &mem_fast_read[a >> MEM_GRANULARITY_BITS][a & MEM_GRANULARITY_MASK];
+
+    return read_mem_w(addr);
+}
+
+static __inline void
+write_mem_b_fast(uint32_t addr, uint8_t val)
+{
+    uint32_t a = addr & rammask;
+
+    if ((a < MEM_FAST_SIZE) && (mem_fast_write[a >> MEM_GRANULARITY_BITS]))
+        mem_fast_write[a >> MEM_GRANULARITY_BITS][a & MEM_GRANULARITY_MASK] = val;
+    else
+        write_mem_b(addr, val);
+}
+
+static __inline void
+write_mem_w_fast(uint32_t addr, uint16_t val)
+{
+    uint32_t a = addr & rammask;
+
+    if (!(a & 1) && (a < MEM_FAST_SIZE) && (mem_fast_write[a >> MEM_GRANULARITY_BITS]))
+        *(uint16_t *) &mem_fast_write[a >> MEM_GRANULARITY_BITS][a & MEM_GRANULARITY_MASK] = val;
+    else
+        write_mem_w(addr, val);
+}
+
 extern uint8_t  readmembl(uint32_t addr);
 extern void     writemembl(uint32_t addr, uint8_t val);
 extern uint16_t readmemwl(uint32_t addr);
@@ -407,6 +498,8 @@ extern void mem_mapping_set_mask(mem_mapping_t *, uint32_t mask);
 extern void mem_mapping_disable(mem_mapping_t *);
 extern void mem_mapping_enable(mem_mapping_t *);
 extern void mem_mapping_recalc(uint64_t base, uint64_t size);
+extern int  mem_mapping_recalc_state(uint64_t base, uint64_t size);
+extern int  mem_mapping_recalc_smm(uint64_t base, uint64_t size);
 
 extern void mem_set_wp(uint64_t base, uint64_t size, uint8_t flags, uint8_t wp);
 extern void mem_set_access(uint8_t bitmap, int mode, uint32_t base, uint32_t size, uint16_t access);
@@ -419,6 +512,9 @@ extern void     mem_writeb_phys(uint32_t addr, uint8_t val);
 extern void     mem_writew_phys(uint32_t addr, uint16_t val);
 extern void     mem_writel_phys(uint32_t addr, uint32_t val);
 extern void     mem_write_phys(void *src, uint32_t addr, int tranfer_size);
+extern uint8_t *mem_span_map(uint32_t addr, uint32_t len, uint32_t *span, int write);
+extern void     mem_span_written(uint32_t addr, uint32_t len);
+extern int      mem_zero_page(uint8_t *p);
 
 extern uint8_t  mem_read_ram(uint32_t addr, void *priv);
 extern uint16_t mem_read_ramw(uint32_t addr, void *priv);
@@ -439,6 +535,10 @@ extern int mem_addr_is_ram(uint32_t addr);
 extern uint64_t mmutranslate_noabrt(uint32_t addr, int rw);
 
 extern void mem_invalidate_range(uint32_t start_addr, uint32_t end_addr);
+#ifdef USE_NEW_DYNAREC
+extern int  mem_smc_host_protected(const uint8_t *p);
+extern void mem_smc_protect(uint32_t phys);
+#endif
 
 extern void mem_write_ramb_page(uint32_t addr, uint8_t val, page_t *page);
 extern void mem_write_ramw_page(uint32_t addr, uint16_t val, page_t *page);
@@ -448,6 +548,7 @@ extern void mem_flush_write_page(uint32_t addr, uint32_t virt);
 extern void mem_reset_page_blocks(void);
 
 extern void flushmmucache(void);
+extern void flushmmucache_cr3(void);
 extern void flushmmucache_pc(void);
 extern void flushmmucache_nopc(void);
 
@@ -464,6 +565,13 @@ extern void mem_remap_top_ex_nomid(int kb, uint32_t start);
 extern void mem_remap_top(int kb);
 extern void mem_remap_top_nomid(int kb);
 
+extern mem_dirty_t    *mem_dirty_register(void);
+extern void            mem_dirty_unregister(mem_dirty_t *d);
+extern uint32_t        mem_dirty_page_count(void);
+extern const uint32_t *mem_dirty_get(mem_dirty_t *d);
+extern int             mem_dirty_test(mem_dirty_t *d, uint32_t addr);
+extern void            mem_dirty_clear(mem_dirty_t *d);
+
 extern void umc_smram_recalc(uint32_t start, int set);
 
 extern mem_mapping_t *read_mapping[MEM_MAPPINGS_NO];
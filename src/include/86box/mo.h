@@ -122,6 +122,7 @@ typedef struct mo_drive_t {
     uint32_t           medium_size;
     uint32_t           base;
     uint16_t           sector_size;
+    uint32_t           instant;   /* Skip transfer timing. */
 } mo_drive_t;
 
 typedef struct mo_t {
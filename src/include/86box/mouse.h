@@ -44,6 +44,17 @@
 
 #define MOUSE_TYPE_ONBOARD   0x80 /* Mouse is an on-board version of one of the above. */
 
+/* What the host did to the mouse over a slice, as a replay records it. */
+typedef struct mouse_replay_t {
+    double x;
+    double y;
+    double x_abs;
+    double y_abs;
+    int    z;
+    int    buttons;
+    int    pressed; /* Presses that may be over already. */
+    int    pad;
+} mouse_replay_t;
 
 #ifdef __cplusplus
 extern "C" {
@@ -101,10 +112,14 @@ extern void            mouse_set_z(int z);
 extern void            mouse_clear_z(void);
 extern void            mouse_subtract_z(int *delta_z, int min, int max, int invert);
 extern void            mouse_set_buttons_ex(int b);
+extern void            mouse_press_buttons(int mask);
+extern void            mouse_release_buttons(int mask);
 extern int             mouse_get_buttons_ex(void);
 extern void            mouse_set_sample_rate(double new_rate);
 extern void            mouse_set_buttons(int buttons);
 extern void            mouse_get_abs_coords(double *x_abs, double *y_abs);
+extern void            mouse_replay_take(mouse_replay_t *ev);
+extern void            mouse_replay_apply(const mouse_replay_t *ev);
 extern void            mouse_process(void);
 extern void            mouse_set_poll_ex(void (*poll_ex)(void));
 extern void            mouse_set_poll(int (*f)(void *), void *);
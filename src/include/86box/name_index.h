@@ -0,0 +1,37 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Hashed lookup of table entries by internal name header.
+ *
+ *          The machine, CPU family and video card tables are looked up
+ *          by internal name when the configuration is loaded, and they
+ *          run to hundreds of entries. An index is built the first time
+ *          it is used, from a callback that returns the name of entry i
+ *          and NULL past the end of the table. Where a name appears
+ *          twice, the first entry wins, as with a linear search.
+ *
+ *          The tables are constant, so an index never has to be rebuilt.
+ *          It is first used while the emulator starts up, before there
+ *          is more than one thread to race for it.
+ */
+#ifndef NAME_INDEX_H
+#define NAME_INDEX_H
+
+typedef struct name_index_t {
+    const char *(*get_name)(int i);
+
+    int  size; /* Slots, a power of two, 0 until built. */
+    int *slot; /* Entry + 1, or 0 for an empty slot. */
+} name_index_t;
+
+#define NAME_INDEX_INIT(get_name) { (get_name), 0, NULL }
+
+/* Returns the entry named name, or -1 if there is none. */
+extern int name_index_find(name_index_t *idx, const char *name);
+
+#endif /*NAME_INDEX_H*/
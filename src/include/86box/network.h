@@ -52,12 +52,16 @@
 #define NET_TYPE_SLIRP 1 /* use the SLiRP port forwarder */
 #define NET_TYPE_PCAP  2 /* use the (Win)Pcap API */
 #define NET_TYPE_VDE   3 /* use the VDE plug API */
+#define NET_TYPE_TAP   4 /* use a Linux TAP interface */
 
 #define NET_MAX_FRAME  1518
-/* Queue size must be a power of 2 */
-#define NET_QUEUE_LEN      16
-#define NET_QUEUE_LEN_MASK (NET_QUEUE_LEN - 1)
+/* Queue sizes must be a power of 2 */
+#define NET_QUEUE_LEN      256
+#define NET_QUEUE_LEN_MIN  16
+#define NET_QUEUE_LEN_MAX  4096
 #define NET_QUEUE_COUNT    4
+/* Packets moved per call by the host drivers */
+#define NET_QUEUE_BATCH    32
 #define NET_CARD_MAX       4
 #define NET_HOST_INTF_MAX  64
 
@@ -95,6 +99,7 @@ typedef struct netcard_conf_t {
     int      net_type;
     char     host_dev_name[128];
     uint32_t link_state;
+    uint32_t queue_len;
 } netcard_conf_t;
 
 extern netcard_conf_t net_cards_conf[NET_CARD_MAX];
@@ -108,11 +113,44 @@ typedef struct netpkt {
     int      len;
 } netpkt_t;
 
-typedef struct netqueue_t {
-    netpkt_t packets[NET_QUEUE_LEN];
-    int      head;
-    int      tail;
-} netqueue_t;
+/* A lock-free single producer, single consumer ring of packets, private to
+   network.c. */
+typedef struct netqueue_t netqueue_t;
+
+typedef struct netqueue_stats_t {
+    uint32_t size;
+    uint32_t used;
+    uint32_t max_used; /* Highest occupancy seen. */
+    uint32_t drops;    /* Packets dropped because the ring was full. */
+    uint32_t wait_us;  /* Running totals of the time packets waited in */
+    uint32_t waited;   /* the ring, for the rings between threads. */
+} netqueue_stats_t;
+
+typedef struct netcard_stats_t {
+    /* Totals since the card was attached. */
+    uint64_t rx_packets;
+    uint64_t rx_bytes;
+    uint64_t tx_packets;
+    uint64_t tx_bytes;
+    uint32_t drops;      /* Packets lost to full rings. */
+    uint32_t errors;     /* Packets the host driver failed to send. */
+
+    /* Rates over the last update interval. */
+    uint32_t rx_pps;
+    uint32_t tx_pps;
+    uint32_t rx_kbps;
+    uint32_t tx_kbps;
+    uint32_t rx_wait_us; /* Average time spent in the receive ring. */
+    uint32_t tx_wait_us; /* Average time waiting for the host driver. */
+
+    /* Totals at the last update. */
+    uint64_t last_rx_packets;
+    uint64_t last_rx_bytes;
+    uint64_t last_tx_packets;
+    uint64_t last_tx_bytes;
+    uint32_t last_wait_us[2];
+    uint32_t last_waited[2];
+} netcard_stats_t;
 
 typedef struct _netcard_t netcard_t;
 
@@ -126,6 +164,7 @@ typedef struct netdrv_t {
 extern const netdrv_t net_pcap_drv;
 extern const netdrv_t net_slirp_drv;
 extern const netdrv_t net_vde_drv;
+extern const netdrv_t net_tap_drv;
 extern const netdrv_t net_null_drv;
 
 struct _netcard_t {
@@ -134,16 +173,20 @@ struct _netcard_t {
     struct netdrv_t host_drv;
     NETRXCB         rx;
     NETSETLINKSTATE set_link_state;
-    netqueue_t      queues[NET_QUEUE_COUNT];
+    netqueue_t     *queues[NET_QUEUE_COUNT];
     netpkt_t        queued_pkt;
-    mutex_t        *tx_mutex;
-    mutex_t        *rx_mutex;
+    mutex_t        *rx_mutex; /* Only held by producers, a loopback can add a second one. */
     pc_timer_t      timer;
     uint16_t        card_num;
     double          byte_period;
-    uint32_t        led_timer;
-    uint32_t        led_state;
+    uint32_t        idle_polls; /* Timer runs since the last packet. */
     uint32_t        link_state;
+    uint32_t        queue_len; /* Slots in each ring, a power of 2. */
+    netcard_stats_t stats;     /* Only updated by the emulation thread. */
+    int             net_type;  /* Host driver in use, after any fallbacks. */
+    uint8_t         mac[6];    /* As seen by the guest. */
+    uint8_t         host_mac[6];
+    int             mac_translate; /* The host side sees host_mac instead of mac. */
 };
 
 typedef struct {
@@ -155,10 +198,11 @@ typedef struct {
     int has_slirp;
     int has_pcap;
     int has_vde;
+    int has_tap;
 } network_devmap_t;
 
 
-#define HAS_NOSLIRP_NET(x)  (x.has_pcap || x.has_vde)
+#define HAS_NOSLIRP_NET(x)  (x.has_pcap || x.has_vde || x.has_tap)
 
 #ifdef __cplusplus
 extern "C" {
@@ -170,6 +214,8 @@ extern network_devmap_t network_devmap;
 extern int              network_ndev;   // Number of pcap devices
 extern network_devmap_t network_devmap; // Bitmap of available network types
 extern netdev_t         network_devs[NET_HOST_INTF_MAX];
+extern int              net_stats_interval; /* Seconds between statistics log lines, 0 for none. */
+extern uint32_t         network_stats_seq;  /* Bumped on every statistics update. */
 
 
 /* Function prototypes. */
@@ -180,9 +226,12 @@ extern void       network_close(void);
 extern void       network_reset(void);
 extern int        network_available(void);
 extern void       network_tx(netcard_t *card, uint8_t *, int);
+extern void       network_poll(void);
+extern void       network_clone_child(uint32_t seed);
 
 extern int net_pcap_prepare(netdev_t *);
 extern int net_vde_prepare(void);
+extern int net_tap_prepare(void);
 
 
 extern void            network_connect(int id, int connect);
@@ -205,6 +254,16 @@ extern int network_rx_on_tx_put(netcard_t *card, uint8_t *bufp, int len);
 extern int network_rx_put_pkt(netcard_t *card, netpkt_t *pkt);
 extern int network_rx_on_tx_put_pkt(netcard_t *card, netpkt_t *pkt);
 
+/* Zero-copy receive: fill in the data of the returned slot, then hand it over
+   with network_rx_commit(), a length of 0 gives it back unused. NULL if the
+   ring is full, in which case network_rx_commit() must not be called. */
+extern netpkt_t *network_rx_reserve(netcard_t *card);
+extern void      network_rx_commit(netcard_t *card, int len);
+
+extern void network_queue_stats(const netcard_t *card, int queue, netqueue_stats_t *stats);
+extern void network_tx_failed(netcard_t *card, int packets);
+extern int  network_get_stats(int card_num, netcard_stats_t *stats);
+
 #ifdef EMU_DEVICE_H
 /* 3Com Etherlink */
 extern const device_t threec501_device;
@@ -64,11 +64,9 @@ typedef struct rivatimer_s
     bool                    running;        // Is this RivaTimer running?
     struct rivatimer_s*     next;           // Next RivaTimer
     void                    (*callback)(double real_time);  // Callback to call on fire
-    #ifdef _WIN32
-    LARGE_INTEGER           starting_time;  // Starting time.
-    #else
-    struct timespec         starting_time;  // Starting time.
-    #endif
+    double                  start_time;     // Host time in uS at the last start or fire.
+    double                  deadline;       // Host time in uS of the next fire.
+    int                     heap_index;     // Position in the heap of running rivatimers, -1 if stopped.
     double                  time;           // Accumulated time in uS.
 } rivatimer_t;
 
@@ -77,6 +75,7 @@ rivatimer_t* rivatimer_create(double period, void (*callback)(double real_time))
 void rivatimer_destroy(rivatimer_t* rivatimer_ptr);
 
 void rivatimer_update_all(void);
+double rivatimer_get_host_time(void);                                   // Host time in uS at the start of the slice.
 void rivatimer_start(rivatimer_t* rivatimer_ptr);
 void rivatimer_stop(rivatimer_t* rivatimer_ptr);
 double rivatimer_get_time(rivatimer_t* rivatimer_ptr);
@@ -133,7 +133,15 @@ extern uint8_t nvr_smi_status(nvr_t *nvr);
 extern void nvr_smi_status_clear(nvr_t *nvr);
 #endif
 
+typedef struct nvr_image_t nvr_image_t;
+
 extern char *nvr_path(char *str);
 extern FILE *nvr_fopen(char *str, char *mode);
+extern int   nvr_write_file(const char *fn, void (*write)(void *priv, FILE *fp), void *priv);
+extern void  nvr_save_pending(void);
+
+extern nvr_image_t *nvr_image_add(const char *fn, void (*write)(void *priv, FILE *fp), void *priv);
+extern void         nvr_image_dirty(nvr_image_t *img);
+extern void         nvr_image_remove(nvr_image_t *img);
 
 #endif /*EMU_NVR_H*/
@@ -270,6 +270,13 @@ extern void        pci_register_bus_slot(int bus, int card, int type, int inta,
 /* Add a PCI card. */
 extern void        pci_add_card(uint8_t add_type, uint8_t (*read)(int func, int addr, void *priv),
                                 void (*write)(int func, int addr, uint8_t val, void *priv), void *priv, uint8_t *slot);
+/* Add a PCI card that also handles aligned dword accesses in one go, either
+   dword handler may be NULL. */
+extern void        pci_add_card_ex(uint8_t add_type, uint8_t (*read)(int func, int addr, void *priv),
+                                   void (*write)(int func, int addr, uint8_t val, void *priv),
+                                   uint32_t (*readl)(int func, int addr, void *priv),
+                                   void (*writel)(int func, int addr, uint32_t val, void *priv),
+                                   void *priv, uint8_t *slot);
 
 /* Add an instance of the PCI bridge. */
 extern void        pci_add_bridge(uint8_t agp, uint8_t (*read)(int func, int addr, void *priv),
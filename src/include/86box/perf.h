@@ -0,0 +1,104 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Performance counters and host time accounting.
+ *
+ *          The emulation thread notes which subsystem it is in with a
+ *          single store as it goes in and out of it. While the panel is
+ *          shown, a sampler thread looks at that about a thousand times
+ *          a second, so how the host time is split up costs the thread
+ *          being measured nothing more than those stores. About once a
+ *          second, the emulation thread turns the counters into rates,
+ *          which the UI can read at any time without taking a lock.
+ *
+ *          While the panel is shown, the first host input event after
+ *          a present is also timestamped, and the time until the next
+ *          frame is handed to the renderer is the input latency.
+ */
+#ifndef EMU_PERF_H
+#define EMU_PERF_H
+
+enum {
+    PERF_IDLE = 0, /* In the main loop, or waiting for the host to catch up. */
+    PERF_CPU,
+    PERF_VIDEO,
+    PERF_SOUND,
+    PERF_TIMERS, /* Timer callbacks not accounted to any of the others. */
+    PERF_IO,     /* Disk images and network. */
+    PERF_MAX
+};
+
+typedef struct perf_counters_t {
+    uint64_t ins;             /* Guest instructions executed. */
+    uint64_t frames_rendered; /* Frames finished by the video cards. */
+    uint64_t emu_ms;          /* Emulated time. */
+} perf_counters_t;
+
+typedef struct perf_stats_t {
+    int      speed_pct;        /* Emulated time over host time. */
+    double   mips;             /* Guest instructions per host second. */
+    uint32_t fps_rendered;
+    uint32_t fps_presented;    /* Frames the blitter actually put on screen. */
+    int      host_pct[PERF_MAX]; /* Of the emulation thread, all -1 when not sampled. */
+    int      cache_pct;        /* Of the code cache in use, -1 without the new recompiler. */
+    uint32_t fps_dropped;      /* Frames the presenter skipped for a newer one. */
+    int      latency_us;       /* Average input to present time, -1 without input. */
+    int      latency_max_us;
+} perf_stats_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern int perf_panel; /* (C) show the performance panel */
+
+extern perf_counters_t  perf_counters;
+extern volatile uint8_t perf_subsys;
+
+#define PERF_COUNT(counter, n) perf_counters.counter += (n)
+
+/* Returns the subsystem the emulation thread was in, to be handed back
+   to perf_leave() on the way out. Only the emulation thread may use it. */
+static inline int
+perf_enter(int subsys)
+{
+    int prev = perf_subsys;
+
+    perf_subsys = subsys;
+
+    return prev;
+}
+
+static inline void
+perf_leave(int prev)
+{
+    perf_subsys = prev;
+}
+
+extern void     perf_frame_presented(void);
+extern void     perf_frame_dropped(void);
+extern uint32_t perf_frames_presented(void);
+
+/* Called by the host side of the keyboard and mouse, from any thread. */
+extern void perf_input_event(void);
+
+extern void perf_init(void);
+extern void perf_close(void);
+extern void perf_clone_child(void);
+extern void perf_sampling(int on);
+extern void perf_tick(void);
+
+/* Copies the latest rates into stats, and returns a number that changes
+   on every update. */
+extern uint32_t perf_get_stats(perf_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /*EMU_PERF_H*/
@@ -102,4 +102,12 @@ extern int     picinterrupt(void);
 
 extern uint8_t pic_irq_ack(void);
 
+/* Log the request to acknowledge latency of each IRQ and reset it, only
+   active in builds with USE_PIC_STATS. Also done on every hard reset. */
+extern void pic_stats_dump(void);
+
+struct snapshot_t;
+extern void pic_snapshot_save(struct snapshot_t *s);
+extern int  pic_snapshot_load(struct snapshot_t *s);
+
 #endif /*EMU_PIC_H*/
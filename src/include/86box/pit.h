@@ -60,6 +60,7 @@ typedef struct ctr_t {
     uint32_t l;
     uint32_t lback;
     uint32_t lback2;
+    uint32_t edges;
 
     void (*load_func)(uint8_t new_m, int new_count);
     void (*out_func)(int new_out, int old_out, void *priv);
@@ -103,6 +104,9 @@ typedef struct pit_intf_t {
     void (*set_load_func)(void *data, int counter_id, void (*func)(uint8_t new_m, int new_count));
     void (*ctr_clock)(void *data, int counter_id);
     void (*set_pit_const)(void *data, uint64_t pit_const);
+    /* Gets how many times a counter's OUT has gone high, for consumers that
+       only look at it on demand instead of installing an OUT handler. */
+    uint32_t (*get_edges)(void *data, int counter_id);
     void *data;
 } pit_intf_t;
 
@@ -151,7 +155,11 @@ extern void   pit_reset(pit_t *dev);
 extern void pit_irq0_timer_ps2(int new_out, int old_out, void *priv);
 
 extern void pit_refresh_timer_xt(int new_out, int old_out, void *priv);
-extern void pit_refresh_timer_at(int new_out, int old_out, void *priv);
+
+/* The AT refresh toggle in port 61h bit 4, worked out from the rising
+   edges of OUT 1 when read rather than flipped on every one of them. */
+extern void    pit_refresh_at_init(void);
+extern uint8_t pit_refresh_at_get(void);
 
 extern void pit_speaker_timer(int new_out, int old_out, void *priv);
 
@@ -43,6 +43,12 @@ typedef struct ctrf_t {
     int thit;
     int running;
     int rereadlatch;
+    int lazy;
+
+    uint32_t lazy_m;
+    uint32_t lazy_l;
+    uint32_t lazy_n;
+    uint32_t edges;
 
     union {
         int32_t count;
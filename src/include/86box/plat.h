@@ -139,6 +139,7 @@ extern int hide_tool_bar;
 extern FILE    *plat_fopen(const char *path, const char *mode);
 extern FILE    *plat_fopen64(const char *path, const char *mode);
 extern void     plat_remove(char *path);
+extern int      plat_rename(const char *from, const char *to);
 extern int      plat_getcwd(char *bufp, int max);
 extern int      plat_chdir(char *path);
 extern void     plat_tempfile(char *bufp, char *prefix, char *suffix);
@@ -151,8 +152,15 @@ extern int      plat_dir_check(char *path);
 extern int      plat_dir_create(char *path);
 extern void    *plat_mmap(size_t size, uint8_t executable);
 extern void     plat_munmap(void *ptr, size_t size);
+extern void     plat_mmap_hint_huge(void *ptr, size_t size);
+extern void     plat_mmap_hint_mergeable(void *ptr, size_t size);
+extern int      plat_mmap_discard(void *ptr, size_t size);
+extern size_t   plat_mmap_page_size(void);
+extern int      plat_mmap_protect(void *ptr, size_t size, int writable);
+extern int      plat_mmap_fault_handler(int (*handler)(void *addr));
 extern uint64_t plat_timer_read(void);
 extern uint32_t plat_get_ticks(void);
+extern uint64_t plat_get_ticks_us(void);
 extern void     plat_delay_ms(uint32_t count);
 extern void     plat_pause(int p);
 extern void     plat_mouse_capture(int on);
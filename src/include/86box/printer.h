@@ -59,4 +59,11 @@
 extern void
 select_codepage(uint16_t code, uint16_t *curmap);
 
+typedef struct prt_queue_t prt_queue_t;
+
+extern prt_queue_t *prt_queue_init(int max_jobs);
+extern void         prt_queue_push(prt_queue_t *q, void (*func)(void *priv), void *priv);
+extern void         prt_queue_flush(prt_queue_t *q);
+extern void         prt_queue_close(prt_queue_t *q);
+
 #endif /*PRINTER_H*/
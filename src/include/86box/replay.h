@@ -0,0 +1,85 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Deterministic record and replay.
+ *
+ *          Recording writes down everything that reaches the machine
+ *          from the host, stamped with the emulated time it did: the
+ *          keyboard and the mouse, frames received by the network
+ *          cards, reads of the host clock, hard resets, and the length
+ *          of every slice, which is where the pacing against the host
+ *          and the sound backend shows up. Playing the recording back
+ *          feeds the same things in at the same points instead of what
+ *          the host has to offer, so the machine goes through the same
+ *          states again, however fast or slow the host runs it.
+ *
+ *          The host's own input only reaches the machine between two
+ *          slices while a recording is made, so it can be stamped and
+ *          played back at the same point.
+ *
+ *          A snapshot saved or loaded while recording leaves a mark in
+ *          the recording, and loading that snapshot while playing it
+ *          back continues from the mark on, so a long recording can be
+ *          entered anywhere a snapshot was taken.
+ */
+#ifndef EMU_REPLAY_H
+#define EMU_REPLAY_H
+
+enum {
+    REPLAY_OFF = 0,
+    REPLAY_RECORD,
+    REPLAY_PLAY
+};
+
+/* What a record holds. The network ones are per card, card number added. */
+#define REPLAY_SLICE    0x01 /* A slice of a different length than the last. */
+#define REPLAY_RESET    0x02
+#define REPLAY_KEY      0x03
+#define REPLAY_MOUSE    0x04
+#define REPLAY_CHECK    0x05 /* A hash of the CPU state, to catch divergence. */
+#define REPLAY_MARK     0x06 /* A snapshot was saved or loaded here. */
+#define REPLAY_CLOCK    0x07
+#define REPLAY_NET_KICK 0x10
+#define REPLAY_NET_RX   0x20
+
+/* Stands in for a scan code, for the UI letting go of all the keys. */
+#define REPLAY_KEY_ALL_UP 0xffff
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern int replay_mode;
+
+/* From the command line, then opened once the machine is configured. */
+extern void replay_request(const char *fn, int mode);
+extern void replay_init(void);
+extern void replay_close(void);
+
+/* Called before a hard reset starts the TSC over. */
+extern void replay_reset(void);
+/* Called by pc_run() before every slice, may change its length. */
+extern void replay_slice(int *slice);
+extern void replay_snapshot(uint64_t id, int load);
+
+/* Records a keystroke from the UI, to be handed over before the next slice. */
+extern void replay_key(int down, uint16_t scan, int captured);
+
+/* Returns the host clock value that is to be used in its place. */
+extern uint64_t replay_clock(uint64_t host);
+
+/* Recording writes a record, playing returns the next one if it is of
+   that type and due now, or -1 if it is not. */
+extern void replay_put(int type, const void *data, int len);
+extern int  replay_get(int type, void *data, int len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /*EMU_REPLAY_H*/
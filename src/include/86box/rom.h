@@ -35,6 +35,7 @@
 typedef struct rom_t {
     uint8_t      *rom;
     int           sz;
+    int           mapped; /* rom is a view of the image file, see rom_map(). */
     uint32_t      mask;
     mem_mapping_t mapping;
 } rom_t;
@@ -62,6 +63,9 @@ extern FILE *rom_fopen(const char *fn, char *mode);
 extern int   rom_getfile(char *fn, char *s, int size);
 extern int   rom_present(const char *fn);
 
+extern uint8_t *rom_map(const char *fn, int off, int sz);
+extern void     rom_unmap(uint8_t *ptr, int sz);
+
 extern int rom_load_linear_oddeven(const char *fn, uint32_t addr, int sz,
                                    int off, uint8_t *ptr);
 extern int rom_load_linear(const char *fn, uint32_t addr, int sz,
@@ -92,5 +96,6 @@ extern int rom_init_interleaved(rom_t *rom, const char *fn_low,
                                 const char *fn_high, uint32_t address,
                                 int size, int mask, int file_offset,
                                 uint32_t flags);
+extern void rom_free(rom_t *rom);
 
 #endif /*EMU_ROM_H*/
@@ -31,6 +31,9 @@
 #    define SCSI_TIME 500.0
 #endif
 
+/* What any command is cut down to on a drive set to instant storage. */
+#define SCSI_INSTANT_TIME 1.0
+
 /* Bits of 'status' */
 #define ERR_STAT     0x01
 #define DRQ_STAT     0x08 /* Data request */
@@ -78,6 +81,7 @@
 #define GPCMD_READ_BUFFER                             0x3c
 #define GPCMD_WRITE_SAME_10                           0x41
 #define GPCMD_READ_SUBCHANNEL                         0x42
+#define GPCMD_UNMAP                                   0x42 /* Direct access devices only. */
 #define GPCMD_READ_TOC_PMA_ATIP                       0x43
 #define GPCMD_READ_HEADER                             0x44
 #define GPCMD_PLAY_AUDIO_10                           0x45
@@ -92,6 +96,7 @@
 #define GPCMD_READ_TRACK_INFORMATION                  0x52
 #define GPCMD_MODE_SELECT_10                          0x55
 #define GPCMD_MODE_SENSE_10                           0x5a
+#define GPCMD_SERVICE_ACTION_IN_16                    0x9e
 #define GPCMD_PLAY_AUDIO_12                           0xa5
 #define GPCMD_READ_12                                 0xa8
 #define GPCMD_PLAY_AUDIO_TRACK_RELATIVE_12            0xa9
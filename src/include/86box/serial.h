@@ -90,6 +90,12 @@ typedef struct serial_s {
     uint16_t out_new;
     uint16_t thr_empty;
 
+    /* Rest of a burst handed over by serial_write_fifo_block(), moved into
+       the RSR one character time at a time. */
+    uint8_t rx_burst[SERIAL_FIFO_SIZE];
+    uint8_t rx_burst_pos;
+    uint8_t rx_burst_len;
+
     void *rcvr_fifo;
     void *xmit_fifo;
 
@@ -140,6 +146,8 @@ extern void      serial_setup(serial_t *dev, uint16_t addr, uint8_t irq);
 extern void      serial_irq(serial_t *dev, uint8_t irq);
 extern void      serial_clear_fifo(serial_t *dev);
 extern void      serial_write_fifo(serial_t *dev, uint8_t dat);
+extern int       serial_rx_space(serial_t *dev);
+extern int       serial_write_fifo_block(serial_t *dev, const uint8_t *buf, int len);
 extern void      serial_set_next_inst(int ni);
 extern void      serial_standalone_init(void);
 extern void      serial_set_clock_src(serial_t *dev, double clock_src);
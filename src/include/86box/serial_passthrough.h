@@ -35,6 +35,9 @@ enum serial_passthrough_mode {
     SERPT_MODES_MAX,
 };
 
+/* Host side buffer, so the backends can move data a block per syscall. */
+#define SERPT_BUF_SIZE 256
+
 extern const char *serpt_mode_names[SERPT_MODES_MAX];
 
 typedef struct serial_passthrough_s {
@@ -53,6 +56,12 @@ typedef struct serial_passthrough_s {
     char  host_serial_path[1024];              /* Path to TTY/host serial port on the host */
     char  named_pipe[1024];                    /* (Windows only) Name of the pipe. */
     void *backend_priv;                        /* Private platform backend data */
+
+    uint8_t rx_buf[SERPT_BUF_SIZE];            /* Read from the host, not yet taken by the port. */
+    int     rx_pos;
+    int     rx_len;
+    uint8_t tx_buf[SERPT_BUF_SIZE];            /* Sent by the guest, not yet written to the host. */
+    int     tx_len;
 } serial_passthrough_t;
 
 extern bool           serial_passthrough_enabled[SERIAL_MAX];
@@ -0,0 +1,53 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Machine snapshots.
+ *
+ *          A snapshot holds the CPU, RAM, the interrupt and DMA
+ *          controllers, and the state of every device, as saved by the
+ *          save hook in its device_t. It can only be loaded into a
+ *          machine with the same configuration it was saved from, as
+ *          the devices themselves are not created from it.
+ *
+ *          Devices without a save hook have no way to be brought back,
+ *          so a machine with any of them attached refuses to be saved.
+ *
+ *          Timers are stored as the time left on them, relative to the
+ *          TSC, so they can be restored into a machine whose TSC has
+ *          moved on since it was reset.
+ *
+ *          An incremental snapshot holds only the RAM written since the
+ *          snapshot saved or loaded before it, and needs that one to be
+ *          left where it was to be loaded.
+ */
+#ifndef EMU_SNAPSHOT_H
+#define EMU_SNAPSHOT_H
+
+#define SNAPSHOT_VERSION 2
+
+typedef struct snapshot_t snapshot_t;
+
+/* For the save hooks. */
+extern void snapshot_write(snapshot_t *s, const void *data, uint32_t len);
+extern void snapshot_write_timer(snapshot_t *s, pc_timer_t *timer);
+
+/* For the load hooks, these return 0 once the chunk runs out. */
+extern int snapshot_read(snapshot_t *s, void *data, uint32_t len);
+extern int snapshot_read_timer(snapshot_t *s, pc_timer_t *timer);
+
+/* Saves or loads from the emulation thread, at the end of the next slice. */
+extern void snapshot_request_save(const char *fn, int incremental);
+extern void snapshot_request_load(const char *fn);
+extern void snapshot_process(void);
+
+/* Saving returns once the state is copied, the file is written later. */
+extern int  snapshot_save(const char *fn, int incremental);
+extern int  snapshot_load(const char *fn);
+extern void snapshot_close(void);
+
+#endif /*EMU_SNAPSHOT_H*/
@@ -144,10 +144,21 @@ struct _opl3_chip {
     opl3_writebuf writebuf[OPL_WRITEBUF_SIZE];
 };
 
+struct nuked_thread_t;
+
+/* Register writes held back until the samples before them are generated. */
+#define NUKED_BATCH_SIZE 256
+
+typedef struct nuked_write_t {
+    uint16_t pos;
+    uint16_t reg;
+    uint8_t  val;
+} nuked_write_t;
+
 typedef struct {
     opl3_chip opl;
     int8_t    flags;
-    int8_t    pad;
+    uint8_t   newm;
 
     uint16_t port;
     uint8_t  status;
@@ -159,9 +170,16 @@ typedef struct {
 
     int     pos;
     int32_t buffer[MUSICBUFLEN * 2];
+
+    int           queued;
+    nuked_write_t batch[NUKED_BATCH_SIZE];
+
+    /* Only set when synthesis runs on its own thread, see fm_synth_thread. */
+    struct nuked_thread_t *thread;
 } nuked_drv_t;
 
 enum {
+    FLAG_THREAD = 0x04,
     FLAG_CYCLES = 0x02,
     FLAG_OPL3   = 0x01
 };
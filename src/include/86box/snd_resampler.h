@@ -0,0 +1,32 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Definitions for the shared polyphase resampler.
+ */
+#ifndef SOUND_RESAMPLER_H
+#define SOUND_RESAMPLER_H
+
+typedef struct resampler_t resampler_t;
+
+/* Create a stereo resampler from in_freq to out_freq. max_in is the largest
+   number of input frames that will be passed to one resampler_process() call. */
+extern resampler_t *resampler_init(int in_freq, int out_freq, int max_in);
+extern void         resampler_close(resampler_t *rs);
+
+/* Drop all buffered input. */
+extern void resampler_reset(resampler_t *rs);
+
+/* Largest number of frames resampler_process() can return for in_frames. */
+extern int resampler_max_out(const resampler_t *rs, int in_frames);
+
+/* Resample in_frames interleaved stereo frames from in into out, which must
+   have room for resampler_max_out(rs, in_frames) frames. Returns the number
+   of frames written. */
+extern int resampler_process(resampler_t *rs, const int32_t *in, int in_frames, int32_t *out);
+
+#endif /*SOUND_RESAMPLER_H*/
@@ -4,12 +4,14 @@
 #ifdef __cplusplus
 extern "C" {
 #endif
-void   *sid_init(uint8_t type);
+void   *sid_init(uint8_t type, int decimate, int filter, int threaded);
 void    sid_close(void *priv);
 void    sid_reset(void *priv);
 uint8_t sid_read(uint16_t addr, void *priv);
 void    sid_write(uint16_t addr, uint8_t val, void *priv);
 void    sid_fillbuf(int16_t *buf, int len, void *priv);
+/* Copy the previous buffer from the SID thread into buf, nothing otherwise. */
+void    sid_end_buffer(int16_t *buf, int len, void *priv);
 #ifdef __cplusplus
 }
 #endif
@@ -32,6 +32,8 @@ extern int sound_gain;
 
 #define SOUND_FREQ  FREQ_48000
 #define SOUNDBUFLEN (SOUND_FREQ / 50)
+/* Shortest output buffer the low-latency mode allows, 5 ms. */
+#define SOUNDBUFLEN_MIN (SOUND_FREQ / 200)
 
 #define MUSIC_FREQ  FREQ_49716
 #define MUSICBUFLEN (MUSIC_FREQ / 36)
@@ -95,14 +97,43 @@ extern void sound_speed_changed(void);
 
 extern void sound_init(void);
 extern void sound_reset(void);
+extern void sound_poll(void *priv);
 
 extern void sound_card_reset(void);
 
 extern void sound_cd_thread_end(void);
 extern void sound_cd_thread_reset(void);
+extern void sound_clone_child(void);
 
 extern void closeal(void);
+extern void forgetal(void);
 extern void inital(void);
+extern int sound_buffers_low;
+/* Frames per output buffer, between SOUNDBUFLEN_MIN and SOUNDBUFLEN. */
+extern int sound_buf_len;
+
+#define SOUND_STATS_HANDLERS 24
+
+/* Audio pipeline counters, published about once a second. */
+typedef struct sound_stats_t {
+    uint32_t seq;       /* Bumped on every update. */
+    uint32_t buffers;   /* Main output buffers produced over the last second. */
+    int      queued;    /* Main output buffers queued at the backend. */
+    uint32_t underruns; /* Times the backend ran dry, since the last reset. */
+    uint32_t overruns;  /* Buffers dropped because the backend was full. */
+
+    int handlers_num;
+    struct {
+        const char *name;
+        uint32_t    us; /* Host time spent in the handler over the last second. */
+    } handlers[SOUND_STATS_HANDLERS];
+} sound_stats_t;
+
+extern sound_stats_t sound_stats;
+
+/* Called by the backend for every main output buffer it is given. */
+extern void sound_stats_backend(int queued, int underrun, int overrun);
+
 extern void givealbuffer(const void *buf);
 extern void givealbuffer_music(const void *buf);
 extern void givealbuffer_wt(const void *buf);
@@ -0,0 +1,108 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Single producer/single consumer ring buffer header.
+ *
+ *          The ring only manages the read and write indices and the
+ *          wakeup protocol between one producer (normally the CPU
+ *          thread) and one consumer thread. The entries themselves
+ *          live in an array owned by the device, indexed with
+ *          spsc_write_pos() and spsc_read_pos().
+ *
+ *          Both sides only touch the events when the other side is
+ *          actually asleep: the producer wakes the consumer through
+ *          spsc_wake() only if it is parked in spsc_park(), and the
+ *          consumer signals the "not full" event from spsc_pop() only
+ *          if the producer is blocked in spsc_wait_below().
+ */
+#ifndef SPSC_H
+#define SPSC_H
+
+#include <stdatomic.h>
+
+#define SPSC_CACHE_LINE 64
+/*Default number of polls before a blocked producer parks on the "not full" event*/
+#define SPSC_SPIN       256
+
+typedef struct spsc_t {
+    /*Written by the producer only*/
+    atomic_uint write_idx;
+    uint8_t     pad_write[SPSC_CACHE_LINE - sizeof(atomic_uint)];
+    /*Written by the consumer only*/
+    atomic_uint read_idx;
+    uint8_t     pad_read[SPSC_CACHE_LINE - sizeof(atomic_uint)];
+
+    atomic_int consumer_parked;
+    atomic_int producer_waiting;
+
+    uint32_t size;
+    int      spin;
+    event_t *wake_event;
+    event_t *not_full_event;
+} spsc_t;
+
+/*size must be a power of two. The events are owned by the caller, which may
+  also set them directly, e.g. to make the consumer look at its run flag*/
+extern void spsc_init(spsc_t *q, uint32_t size, int spin, event_t *wake_event, event_t *not_full_event);
+extern void spsc_clear(spsc_t *q);
+/*Block the producer until fewer than limit entries are queued*/
+extern void spsc_wait_below(spsc_t *q, uint32_t limit);
+/*Put the consumer to sleep until an entry is queued or the wake event is set*/
+extern void spsc_park(spsc_t *q);
+
+static __inline uint32_t
+spsc_entries(spsc_t *q)
+{
+    return atomic_load(&q->write_idx) - atomic_load(&q->read_idx);
+}
+
+static __inline int
+spsc_empty(spsc_t *q)
+{
+    return atomic_load(&q->read_idx) == atomic_load(&q->write_idx);
+}
+
+static __inline uint32_t
+spsc_write_pos(spsc_t *q)
+{
+    return atomic_load_explicit(&q->write_idx, memory_order_relaxed) & (q->size - 1);
+}
+
+static __inline uint32_t
+spsc_read_pos(spsc_t *q)
+{
+    return atomic_load_explicit(&q->read_idx, memory_order_relaxed) & (q->size - 1);
+}
+
+/*Wake the consumer if it is parked. Only valid for consumers that sleep in
+  spsc_park(), as it relies on the parked flag*/
+static __inline void
+spsc_wake(spsc_t *q)
+{
+    if (atomic_load(&q->consumer_parked))
+        thread_set_event(q->wake_event);
+}
+
+/*Publish the entry at spsc_write_pos()*/
+static __inline void
+spsc_push(spsc_t *q)
+{
+    atomic_fetch_add(&q->write_idx, 1);
+}
+
+/*Release the entry at spsc_read_pos()*/
+static __inline void
+spsc_pop(spsc_t *q)
+{
+    atomic_fetch_add(&q->read_idx, 1);
+
+    if (atomic_load(&q->producer_waiting) && atomic_exchange(&q->producer_waiting, 0))
+        thread_set_event(q->not_full_event);
+}
+
+#endif /*SPSC_H*/
@@ -30,6 +30,7 @@ extern "C" {
 
 #    define thread_create_named                 plat_thread_create_named
 #    define thread_wait                         plat_thread_wait
+#    define thread_enum                         plat_thread_enum
 #    define thread_create_event                 plat_thread_create_event
 #    define thread_set_event                    plat_thread_set_event
 #    define thread_reset_event                  plat_thread_reset_event
@@ -48,9 +49,42 @@ typedef void thread_t;
 typedef void event_t;
 typedef void mutex_t;
 
-#define thread_create(thread_func, param) thread_create_named((thread_func), (param), #thread_func)
-extern thread_t *thread_create_named(void (*thread_func)(void *param), void *param, const char *name);
+/* What a thread is for, each role can be given CPUs and a priority of its own. */
+enum {
+    THREAD_ROLE_NONE = 0, /* Left to the host. */
+    THREAD_ROLE_CPU,
+    THREAD_ROLE_BLIT,
+    THREAD_ROLE_VIDEO,    /* FIFO and render threads of the video cards. */
+    THREAD_ROLE_AUDIO,
+    THREAD_ROLE_NETWORK,
+    THREAD_ROLE_WORKER,   /* The device event bus workers. */
+    THREAD_ROLE_MAX
+};
+
+enum {
+    THREAD_PRIO_DEFAULT = 0,
+    THREAD_PRIO_LOW,
+    THREAD_PRIO_HIGH,
+    THREAD_PRIO_REALTIME /* SCHED_FIFO, or time critical on Windows. */
+};
+
+#define THREAD_CPUS_LEN 256
+
+extern char thread_role_cpus[THREAD_ROLE_MAX][THREAD_CPUS_LEN]; /* (C) As in "0-3,8", empty for any. */
+extern int  thread_role_priority[THREAD_ROLE_MAX];              /* (C) */
+
+extern const char *thread_role_get_name(int role);
+extern const char *thread_priority_get_name(int priority);
+extern int         thread_priority_get_from_name(const char *s);
+/* Moves the calling thread to the CPUs and priority of role. */
+extern void thread_role_apply(int role);
+
+#define thread_create(thread_func, param)            thread_create_named((thread_func), (param), #thread_func, THREAD_ROLE_NONE)
+#define thread_create_role(thread_func, param, role) thread_create_named((thread_func), (param), #thread_func, (role))
+extern thread_t *thread_create_named(void (*thread_func)(void *param), void *param, const char *name, int role);
 extern int       thread_wait(thread_t *arg);
+/* Calls func with the name of every thread started by thread_create() that is still running. */
+extern void      thread_enum(void (*func)(const char *name, void *priv), void *priv);
 extern event_t  *thread_create_event(void);
 extern void      thread_set_event(event_t *arg);
 extern void      thread_reset_event(event_t *arg);
@@ -50,8 +50,12 @@ typedef struct pc_timer_t {
     void (*callback)(void *priv);
     void *priv;
 
-    struct pc_timer_t *prev;
-    struct pc_timer_t *next;
+    int      heap_idx; /* Position in the timer heap while enabled. */
+    uint32_t seq;      /* Enable order, breaks ties between equal timestamps. */
+
+#ifdef USE_TIMER_STATS
+    struct timer_stats_t *stats;
+#endif
 } pc_timer_t;
 
 #ifdef __cplusplus
@@ -188,6 +192,15 @@ extern void timer_on_auto(pc_timer_t *timer, double period);
 /* Change TSC, taking into account the timers. */
 extern void timer_set_new_tsc(uint64_t new_tsc);
 
+/* Timer accounting, only active in builds with USE_TIMER_STATS. Timers are
+   named after the device being initialized when they are added; this sets a
+   more specific name. The name must stay valid for the life of the process. */
+extern void timer_set_name(pc_timer_t *timer, const char *name);
+/* Log the fire and re-arm rates and the host time (in plat_timer_read()
+   units) of every timer since the last dump, and reset the counters. This is
+   also done on timer_close(). */
+extern void timer_stats_dump(void);
+
 #ifdef __cplusplus
 }
 #endif
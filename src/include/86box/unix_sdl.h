@@ -5,10 +5,16 @@ extern void sdl_close(void);
 extern int  sdl_inits(void);
 extern int  sdl_inith(void);
 extern int  sdl_initho(void);
+extern int  sdl_initnull(void);
 extern int  sdl_pause(void);
 extern void sdl_resize(int x, int y);
 extern void sdl_enable(int enable);
 extern void sdl_set_fs(int fs);
 extern void sdl_reload(void);
+extern void sdl_clone_child(void);
+
+extern void unix_clone_init(void);
+extern void unix_clone_request(int count);
+extern void unix_clone_process(void);
 
 #endif /*_UNIX_SDL_H*/
@@ -30,6 +30,11 @@ typedef struct usb_t {
     int           ohci_enable;
     uint32_t      ohci_mem_base;
     mem_mapping_t ohci_mmio_mapping;
+
+    /* The frame counters are worked out from the TSC when read. */
+    double        cycles_us;      /* CPU cycles per microsecond. */
+    uint64_t      uhci_frame_tsc; /* Start of the current UHCI frame. */
+    uint64_t      ohci_frame_tsc; /* Start of the current OHCI frame. */
 } usb_t;
 
 /* Global variables. */
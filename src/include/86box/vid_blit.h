@@ -0,0 +1,44 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Shared span helpers for the 2D accelerators.
+ *
+ *          These operate on whole rows of pixels at 8, 16, 24 and
+ *          32 bits per pixel and are meant for the simple cases the
+ *          blitters spend most of their time in (plain copies, solid
+ *          fills and monochrome expansion). The callers are expected
+ *          to have checked that the row does not wrap around video
+ *          memory, and that no ROP, plane mask or clipping applies
+ *          inside the span.
+ */
+#ifndef VIDEO_BLIT_H
+#define VIDEO_BLIT_H
+
+/*Fill len bytes at dst with a bytes_pp (1-4) byte colour*/
+extern void video_blit_fill(uint8_t *dst, uint32_t color, int bytes_pp, uint32_t len);
+
+/*Copy len bytes from src to dst within vram. xdir is the direction the
+  blitter walks the row in; overlapping copies against that direction will
+  smear the same way the per pixel loop does*/
+extern void video_blit_copy(uint8_t *vram, uint32_t dst, uint32_t src, uint32_t len, int bytes_pp, int xdir);
+
+/*As video_blit_copy(), but pixels for which ((src & mask) == key) equals
+  skip_match are not written*/
+extern void video_blit_copy_key(uint8_t *vram, uint32_t dst, uint32_t src, uint32_t len, int bytes_pp, int xdir,
+                                uint32_t key, uint32_t mask, int skip_match);
+
+/*Expand count pixels of monochrome data to dst, starting at bit number bit
+  of src. Set bits are drawn in fg, clear bits in bg or not at all if
+  transparent is set*/
+extern void video_blit_mono(uint8_t *dst, const uint8_t *src, uint32_t bit, int lsb_first, uint32_t fg, uint32_t bg,
+                            int transparent, int bytes_pp, int count);
+
+/*Mark the 4k pages covered by [addr, addr + len) as changed*/
+extern void video_blit_mark_changed(uint8_t *changedvram, uint32_t addr, uint32_t len, int frame);
+
+#endif /*VIDEO_BLIT_H*/
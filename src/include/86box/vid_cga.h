@@ -69,6 +69,8 @@ typedef struct cga_t {
     int snow_enabled;
     int rgb_type;
     int double_type;
+
+    struct line_cache_t *line_cache;
 } cga_t;
 
 void    cga_init(cga_t *cga);
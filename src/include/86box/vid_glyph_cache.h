@@ -0,0 +1,85 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Cache of text mode character rows expanded to pixels.
+ *
+ *          Entries are keyed by the nine dot pattern of the row (the
+ *          font byte plus the ninth column) and the resolved foreground
+ *          and background colours, which already fold in the font bank,
+ *          character, scanline, attribute, cursor and blink state. As
+ *          the font data and palette are part of the key, font RAM
+ *          writes and palette changes can never leave a stale entry
+ *          behind, and no explicit invalidation is needed.
+ *
+ *          The wide variant does the same for characters up to sixteen
+ *          dots wide, such as the 13 dot cells, and the halves of the
+ *          double byte Kanji characters, of the PS/55 display adapter.
+ */
+#ifndef VIDEO_GLYPH_CACHE_H
+#define VIDEO_GLYPH_CACHE_H
+
+#define GLYPH_CACHE_SIZE  2048
+#define GLYPH_CACHE_VALID 0x200
+
+typedef struct glyph_row_t {
+    uint32_t fg;
+    uint32_t bg;
+    uint32_t bits; /*Dot pattern in bits 8-0, GLYPH_CACHE_VALID once filled in*/
+    uint32_t pix[9];
+} glyph_row_t;
+
+/*Returns the nine pixels for a character row. Bit 8 of bits is the leftmost
+  dot*/
+static __inline uint32_t *
+glyph_cache_lookup(glyph_row_t *cache, uint32_t bits, uint32_t fg, uint32_t bg)
+{
+    uint32_t     hash = (bits * 0x27d4eb2f) ^ (fg * 0x9e3779b1) ^ (bg * 0x85ebca6b);
+    glyph_row_t *row  = &cache[(hash >> 16) & (GLYPH_CACHE_SIZE - 1)];
+
+    bits |= GLYPH_CACHE_VALID;
+    if ((row->bits != bits) || (row->fg != fg) || (row->bg != bg)) {
+        row->bits = bits;
+        row->fg   = fg;
+        row->bg   = bg;
+        for (int c = 0; c < 9; c++)
+            row->pix[c] = (bits & (0x100 >> c)) ? fg : bg;
+    }
+
+    return row->pix;
+}
+
+#define GLYPH_CACHE_WIDE_VALID 0x10000
+
+typedef struct glyph_row_wide_t {
+    uint32_t fg;
+    uint32_t bg;
+    uint32_t bits; /*Dot pattern in bits 15-0, GLYPH_CACHE_WIDE_VALID once filled in*/
+    uint32_t pix[16];
+} glyph_row_wide_t;
+
+/*Returns the sixteen pixels for a character row. Bit 15 of bits is the
+  leftmost dot*/
+static __inline uint32_t *
+glyph_cache_lookup_wide(glyph_row_wide_t *cache, uint32_t bits, uint32_t fg, uint32_t bg)
+{
+    uint32_t          hash = (bits * 0x27d4eb2f) ^ (fg * 0x9e3779b1) ^ (bg * 0x85ebca6b);
+    glyph_row_wide_t *row  = &cache[(hash >> 16) & (GLYPH_CACHE_SIZE - 1)];
+
+    bits |= GLYPH_CACHE_WIDE_VALID;
+    if ((row->bits != bits) || (row->fg != fg) || (row->bg != bg)) {
+        row->bits = bits;
+        row->fg   = fg;
+        row->bg   = bg;
+        for (int c = 0; c < 16; c++)
+            row->pix[c] = (bits & (0x8000 >> c)) ? fg : bg;
+    }
+
+    return row->pix;
+}
+
+#endif /*VIDEO_GLYPH_CACHE_H*/
@@ -62,6 +62,8 @@ typedef struct {
     uint8_t *vram;
     int      monitor_index;
     int      prev_monitor_index;
+
+    struct line_cache_t *line_cache;
 } hercules_t;
 
 #define VIDEO_MONITOR_PROLOGUE()                        \
@@ -0,0 +1,98 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Cache of the lines last drawn by the simple text and graphics
+ *          adapters.
+ *
+ *          For every line of the target buffer, a 64-bit signature of
+ *          everything the line was drawn from is kept: the VRAM bytes
+ *          and the mode, colour, cursor and blink state the adapter
+ *          folds in, as well as the palette generation of the monitor.
+ *          A line whose signature did not change since the previous
+ *          frame is left alone in the target buffer, and is not part
+ *          of the damage reported for the blit.
+ */
+#ifndef VIDEO_LINE_CACHE_H
+#define VIDEO_LINE_CACHE_H
+
+#define LINE_CACHE_LINES 1024
+
+typedef struct line_cache_t {
+    uint64_t sig[LINE_CACHE_LINES];
+    int      damage_y1; /*Lines redrawn since the previous blit*/
+    int      damage_y2;
+    int      full; /*Something other than the cached lines changed*/
+} line_cache_t;
+
+static __inline uint64_t
+line_cache_mix(uint64_t sig, uint64_t val)
+{
+    sig = (sig ^ val) * 0x9e3779b97f4a7c15ULL;
+    return sig ^ (sig >> 32);
+}
+
+/*Start of the signature of a line, changes whenever the palette the 8-bit
+  lines are converted with does*/
+static __inline uint64_t
+line_cache_seed(int monitor_index)
+{
+    return line_cache_mix((uintptr_t) monitors[monitor_index].target_buffer,
+                          monitors[monitor_index].mon_pal_generation);
+}
+
+static __inline void
+line_cache_invalidate(line_cache_t *cache)
+{
+    memset(cache->sig, 0x00, sizeof(cache->sig));
+    cache->damage_y1 = LINE_CACHE_LINES;
+    cache->damage_y2 = 0;
+    cache->full      = 1;
+}
+
+/*Returns 1 if the line, which covers rows lines of the target buffer from
+  line on, was last drawn from the same inputs, otherwise records the new
+  signature and that the line has to be drawn*/
+static __inline int
+line_cache_hit(line_cache_t *cache, int line, int rows, uint64_t sig)
+{
+    if ((line < 0) || (line >= LINE_CACHE_LINES)) {
+        cache->full = 1;
+        return 0;
+    }
+
+    sig |= 1; /*0 marks a line that was never drawn*/
+    if (cache->sig[line] == sig)
+        return 1;
+
+    cache->sig[line] = sig;
+    if (line < cache->damage_y1)
+        cache->damage_y1 = line;
+    if ((line + rows) > cache->damage_y2)
+        cache->damage_y2 = line + rows;
+
+    return 0;
+}
+
+/*Report the redrawn lines, extended by extra lines above them for adapters
+  that derive other lines from them, ahead of the blit of a frame*/
+static __inline void
+line_cache_blit(line_cache_t *cache, int extra, int monitor_index)
+{
+    if (!cache->full) {
+        if (cache->damage_y1 < cache->damage_y2)
+            video_blit_damage_monitor(cache->damage_y1 - extra, cache->damage_y2, monitor_index);
+        else
+            video_blit_damage_monitor(0, 0, monitor_index);
+    }
+
+    cache->damage_y1 = LINE_CACHE_LINES;
+    cache->damage_y2 = 0;
+    cache->full      = 0;
+}
+
+#endif /*VIDEO_LINE_CACHE_H*/
@@ -39,6 +39,8 @@ typedef struct mda_t {
     int      prev_monitor_index;
 
     uint8_t *vram;
+
+    struct line_cache_t *line_cache;
 } mda_t;
 
 #define VIDEO_MONITOR_PROLOGUE()                        \
@@ -0,0 +1,37 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Shared helpers for the video overlays.
+ *
+ *          The YUV converters reproduce the integer arithmetic the
+ *          overlay code has always used, including its clamping and
+ *          the wrap around of studio range luma below 16 or above 235,
+ *          so the chips keep producing exactly the same pixels. Which
+ *          byte order, range and output channel order a chip uses is
+ *          selected with the OVERLAY_YUV_* flags.
+ */
+#ifndef VIDEO_OVERLAY_H
+#define VIDEO_OVERLAY_H
+
+#define OVERLAY_YUV_Y_ODD   (1 << 0) /*Luma in the odd bytes (UYVY), otherwise in the even bytes (YUYV)*/
+#define OVERLAY_YUV_V_FIRST (1 << 1) /*The first chroma byte of each pair is V/Cr, otherwise U/Cb*/
+#define OVERLAY_YUV_STUDIO  (1 << 2) /*16-235 luma with the matching coefficients, otherwise full range*/
+#define OVERLAY_YUV_BGR     (1 << 3) /*Red in the low byte of the output pixels, otherwise blue*/
+
+/*Convert pairs * 2 pixels of packed 4:2:2 YUV, 4 bytes per pair*/
+extern void video_overlay_yuv422(uint32_t *dst, const uint8_t *src, int pairs, int flags);
+
+/*Convert groups * 4 pixels of the 6 byte U Y Y V Y Y format*/
+extern void video_overlay_yuv211(uint32_t *dst, const uint8_t *src, int groups, int flags);
+
+/*Nearest neighbour scaling of a line, dst[x] = src[pos >> shift] with pos
+  advancing by step for every pixel. The source index is limited to max_idx*/
+extern void video_overlay_scale(uint32_t *dst, const uint32_t *src, int count, uint32_t pos, uint32_t step, int shift,
+                                uint32_t max_idx);
+
+#endif /*VIDEO_OVERLAY_H*/
@@ -0,0 +1,62 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Planar to packed pixel conversion for the 16 colour modes.
+ *
+ *          planar_spread[] spreads the eight bits of a plane byte to
+ *          bit 0 of eight nibbles, so the four planes of a character
+ *          clock combine into eight 4bpp pixels with three shifts and
+ *          ORs, instead of gathering one bit from each plane per pixel.
+ *          The pixels then go through a 16 entry palette the renderer
+ *          builds once per line.
+ */
+#ifndef VIDEO_PLANAR_H
+#define VIDEO_PLANAR_H
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#    define VIDEO_PLANAR_SSE2
+#    include <emmintrin.h>
+#endif
+
+extern uint32_t planar_spread[256];
+
+/*Nibble n of the result is the nth pixel from the left*/
+static __inline uint32_t
+planar_to_chunky(const uint8_t *edat)
+{
+    return planar_spread[edat[0]] | (planar_spread[edat[1]] << 1) | (planar_spread[edat[2]] << 2) | (planar_spread[edat[3]] << 3);
+}
+
+/*Write the eight pixels of a chunky dword, each dotwidth pixels wide*/
+static __inline void
+planar_write8(uint32_t *p, uint32_t dat, const uint32_t *pal, int dotwidth)
+{
+#ifdef VIDEO_PLANAR_SSE2
+    const __m128i lo = _mm_set_epi32(pal[(dat >> 12) & 0xf], pal[(dat >> 8) & 0xf], pal[(dat >> 4) & 0xf], pal[dat & 0xf]);
+    const __m128i hi = _mm_set_epi32(pal[dat >> 28], pal[(dat >> 24) & 0xf], pal[(dat >> 20) & 0xf], pal[(dat >> 16) & 0xf]);
+
+    if (dotwidth == 2) {
+        _mm_storeu_si128((__m128i *) &p[0], _mm_unpacklo_epi32(lo, lo));
+        _mm_storeu_si128((__m128i *) &p[4], _mm_unpackhi_epi32(lo, lo));
+        _mm_storeu_si128((__m128i *) &p[8], _mm_unpacklo_epi32(hi, hi));
+        _mm_storeu_si128((__m128i *) &p[12], _mm_unpackhi_epi32(hi, hi));
+    } else {
+        _mm_storeu_si128((__m128i *) &p[0], lo);
+        _mm_storeu_si128((__m128i *) &p[4], hi);
+    }
+#else
+    for (int x = 0; x < 8; x++) {
+        uint32_t c = pal[(dat >> (x << 2)) & 0xf];
+
+        for (int subx = 0; subx < dotwidth; subx++)
+            p[(x * dotwidth) + subx] = c;
+    }
+#endif
+}
+
+#endif /*VIDEO_PLANAR_H*/
@@ -0,0 +1,37 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Software scaler for the renderers without a GPU.
+ *
+ *          Scales a 32 bits per pixel frame to the size of the window,
+ *          with either nearest neighbour or bilinear filtering. The
+ *          scaler keeps a copy of the last frame it was given, and only
+ *          redraws the rows of the output whose source rows changed,
+ *          which on most frames is none or very few of them.
+ */
+#ifndef VIDEO_SCALE_H
+#define VIDEO_SCALE_H
+
+#define VIDEO_SCALE_NEAREST 0
+#define VIDEO_SCALE_LINEAR  1
+
+typedef struct video_scaler_t video_scaler_t;
+
+extern video_scaler_t *video_scaler_init(void);
+extern void            video_scaler_close(video_scaler_t *s);
+
+/*Make the next video_scale() redraw the whole output, for when dst was
+  changed behind the scaler's back*/
+extern void video_scaler_invalidate(video_scaler_t *s);
+
+/*Scale the sw x sh frame at src to dw x dh at dst. Pitches are in pixels.
+  Returns the number of output rows that were redrawn*/
+extern int video_scale(video_scaler_t *s, uint32_t *dst, int dst_pitch, int dw, int dh,
+                       const uint32_t *src, int src_pitch, int sw, int sh, int method);
+
+#endif /*VIDEO_SCALE_H*/
@@ -31,6 +31,7 @@
 #    define FLAG_512K_MASK    512
 #    define FLAG_NO_SHIFT3    1024 /* Needed for Bochs VBE. */
 struct monitor_t;
+struct snapshot_t;
 
 typedef struct hwcursor_t {
     int      ena;
@@ -310,6 +311,26 @@ typedef struct svga_t {
     void *  ext8514;
     void *  clock_gen8514;
     void *  xga;
+
+    /* Deferred scanline rendering, NULL when lines are rendered inline. */
+    struct svga_render_queue_t *render_queue;
+
+    /* Expanded text mode glyph rows. One per card, as each card's lines are
+       rendered by its own worker when render_queue is set. */
+    struct glyph_row_t *glyph_cache;
+
+    /* Hardware cursors captured for the presenter instead of being drawn
+       into the frame, see svga_cursor_capture(). */
+    struct cursor_layer_t *cursor_layer;
+    uint32_t              *cursor_lines;
+    int                    cursor_layer_on;
+    int                    cursor_layer_overflow;
+
+    /* Scanline batching, poll_ts is when the next CRTC phase is due. */
+    uint64_t               poll_ts;
+    int                    poll_batch;
+    int                    poll_running;
+    int                    poll_quiet;
 } svga_t;
 
 extern void     ibm8514_set_poll(svga_t *svga);
@@ -351,6 +372,8 @@ extern int  svga_init(const device_t *info, svga_t *svga, void *priv, int memsiz
                       void (*overlay_draw)(struct svga_t *svga, int displine));
 extern void svga_recalctimings(svga_t *svga);
 extern void svga_close(svga_t *svga);
+extern void svga_save(svga_t *svga, struct snapshot_t *s);
+extern int  svga_load(svga_t *svga, struct snapshot_t *s);
 
 uint8_t  svga_read(uint32_t addr, void *priv);
 uint16_t svga_readw(uint32_t addr, void *priv);
@@ -385,6 +408,7 @@ uint32_t svga_mask_changedaddr(uint32_t addr, svga_t *svga);
 
 void svga_doblit(int wx, int wy, svga_t *svga);
 void svga_set_poll(svga_t *svga);
+void svga_poll_sync(svga_t *svga);
 void svga_poll(void *priv);
 
 enum {
@@ -393,6 +417,7 @@ enum {
 };
 
 uint32_t svga_lookup_lut_ram(svga_t* svga, uint32_t val);
+uint32_t svga_conv_16to32(struct svga_t *svga, uint16_t color, uint8_t bpp);
 
 /* We need a way to add a device with a pointer to a parent device so it can attach itself to it, and
    possibly also a second ATi 68860 RAM DAC type that auto-sets SVGA render on RAM DAC render change. */
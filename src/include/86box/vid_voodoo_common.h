@@ -30,7 +30,11 @@
 
 #define TEX_DIRTY_SHIFT 10
 
-#define TEX_CACHE_MAX   64
+#define TEX_CACHE_MAX   128
+#define TEX_HASH_SIZE   256
+#define TEX_PAGES       16384
+
+#define TEX_CACHE_ENTRY_SIZE ((256 * 256 + 256 * 256 + 128 * 128 + 64 * 64 + 32 * 32 + 16 * 16 + 8 * 8 + 4 * 4 + 2 * 2) * 4)
 
 #ifdef __cplusplus
 #    include <atomic>
@@ -38,6 +42,7 @@ using atomic_int = std::atomic<int>;
 #else
 #    include <stdatomic.h>
 #endif
+#include <86box/spsc.h>
 
 enum {
     VOODOO_1 = 0,
@@ -80,9 +85,9 @@ typedef union rgba_u {
 #define FIFO_MASK       (FIFO_SIZE - 1)
 #define FIFO_ENTRY_SIZE (1 << 31)
 
-#define FIFO_ENTRIES    (voodoo->fifo_write_idx - voodoo->fifo_read_idx)
-#define FIFO_FULL       ((voodoo->fifo_write_idx - voodoo->fifo_read_idx) >= FIFO_SIZE - 4)
-#define FIFO_EMPTY      (voodoo->fifo_read_idx == voodoo->fifo_write_idx)
+#define FIFO_ENTRIES    spsc_entries(&voodoo->fifo_ring)
+#define FIFO_FULL       (spsc_entries(&voodoo->fifo_ring) >= FIFO_SIZE - 4)
+#define FIFO_EMPTY      spsc_empty(&voodoo->fifo_ring)
 
 #define FIFO_TYPE       0xff000000
 #define FIFO_ADDR       0x00ffffff
@@ -96,6 +101,10 @@ enum {
     FIFO_WRITEL_2DREG = (0x05 << 24)
 };
 
+/*Render threads own interleaved bands of (1 << VOODOO_RENDER_BAND_SHIFT) lines*/
+#define VOODOO_MAX_RENDER_THREADS 16
+#define VOODOO_RENDER_BAND_SHIFT  3
+
 #define PARAM_SIZE       1024
 #define PARAM_MASK       (PARAM_SIZE - 1)
 #define PARAM_ENTRY_SIZE (1 << 31)
@@ -104,6 +113,15 @@ enum {
 #define PARAM_FULL(x)    ((voodoo->params_write_idx - voodoo->params_read_idx[x]) >= PARAM_SIZE)
 #define PARAM_EMPTY(x)   (voodoo->params_read_idx[x] == voodoo->params_write_idx)
 
+/*voodoo_params_t::command*/
+enum {
+    PARAMS_TRIANGLE = 0,
+    PARAMS_LFB_SPAN
+};
+
+/*Longest run of consecutive LFB writes carried by one span*/
+#define VOODOO_LFB_SPAN_MAX 256
+
 typedef struct
 {
     uint32_t addr_type;
@@ -111,7 +129,7 @@ typedef struct
 } fifo_entry_t;
 
 typedef struct voodoo_params_t {
-    int command;
+    int command; /*PARAMS_TRIANGLE or PARAMS_LFB_SPAN*/
 
     int32_t vertexAx;
     int32_t vertexAy;
@@ -228,18 +246,46 @@ typedef struct voodoo_params_t {
     int aux_tiled;
     int row_width;
     int aux_row_width;
+
+    /*Render threads that own at least one line of this triangle*/
+    uint32_t render_mask;
 } voodoo_params_t;
 
+/*LFB state that framebuffer writes depend on besides voodoo_params_t*/
+typedef struct voodoo_lfb_state_t {
+    uint32_t lfbMode;
+    uint32_t fb_write_offset;
+    int      row_width;
+    int      col_tiled;
+    int      aux_tiled;
+} voodoo_lfb_state_t;
+
+/*A run of LFB writes to consecutive addresses on one line, executed by the
+  render thread that owns the line*/
+typedef struct voodoo_lfb_span_t {
+    voodoo_lfb_state_t state;
+    uint32_t           addr;
+    int                writel;
+    int                y; /*Line in this card's framebuffer, -1 if the writes belong to the other SLI card*/
+    int                count;
+    uint32_t           data[VOODOO_LFB_SPAN_MAX];
+} voodoo_lfb_span_t;
+
 typedef struct texture_t {
     uint32_t   base;
     uint32_t   tLOD;
     atomic_int refcount;
-    atomic_int refcount_r[4];
+    atomic_int refcount_r[VOODOO_MAX_RENDER_THREADS];
     int        is16;
     uint32_t   palette_checksum;
     uint32_t   addr_start[4];
     uint32_t   addr_end[4];
     uint32_t  *data;
+    uint32_t   lru;
+    int        hash_next;
+    /*Mipmap levels decoded so far, the rest are decoded when a triangle
+      first needs them*/
+    uint16_t   lod_valid;
 } texture_t;
 
 typedef struct vert_t {
@@ -266,6 +312,11 @@ typedef struct clip_t {
     int y_max;
 } clip_t;
 
+typedef struct voodoo_render_param_t {
+    struct voodoo_t *voodoo;
+    int              odd_even;
+} voodoo_render_param_t;
+
 typedef struct voodoo_t {
     mem_mapping_t mapping;
 
@@ -362,25 +413,27 @@ typedef struct voodoo_t {
     int    ncc_dirty[2];
 
     thread_t *fifo_thread;
-    thread_t *render_thread[4];
+    thread_t *render_thread[VOODOO_MAX_RENDER_THREADS];
     event_t  *wake_fifo_thread;
     event_t  *wake_main_thread;
     event_t  *fifo_not_full_event;
-    event_t  *render_not_full_event[4];
-    event_t  *wake_render_thread[4];
+    event_t  *render_not_full_event[VOODOO_MAX_RENDER_THREADS];
+    event_t  *wake_render_thread[VOODOO_MAX_RENDER_THREADS];
 
     int voodoo_busy;
-    int render_voodoo_busy[4];
+    int render_voodoo_busy[VOODOO_MAX_RENDER_THREADS];
 
     int render_threads;
     int odd_even_mask;
 
-    int pixel_count[4];
-    int texel_count[4];
+    voodoo_render_param_t render_param[VOODOO_MAX_RENDER_THREADS];
+
+    int pixel_count[VOODOO_MAX_RENDER_THREADS];
+    int texel_count[VOODOO_MAX_RENDER_THREADS];
     int tri_count;
     int frame_count;
-    int pixel_count_old[4];
-    int texel_count_old[4];
+    int pixel_count_old[VOODOO_MAX_RENDER_THREADS];
+    int texel_count_old[VOODOO_MAX_RENDER_THREADS];
     int wr_count;
     int rd_count;
     int tex_count;
@@ -403,16 +456,19 @@ typedef struct voodoo_t {
     int type;
 
     fifo_entry_t fifo[FIFO_SIZE];
-    atomic_int   fifo_read_idx;
-    atomic_int   fifo_write_idx;
+    spsc_t       fifo_ring;
     atomic_int   cmd_read;
     atomic_int   cmd_written;
     atomic_int   cmd_written_fifo;
     atomic_int   cmd_written_fifo_2;
 
     voodoo_params_t params_buffer[PARAM_SIZE];
-    atomic_int      params_read_idx[4];
+    atomic_int      params_read_idx[VOODOO_MAX_RENDER_THREADS];
     atomic_int      params_write_idx;
+    /*Data of PARAMS_LFB_SPAN entries, indexed like params_buffer*/
+    voodoo_lfb_span_t lfb_spans[PARAM_SIZE];
+    /*Span being collected by the FIFO thread*/
+    voodoo_lfb_span_t fifo_lfb_span;
 
     uint32_t   cmdfifo_base;
     uint32_t   cmdfifo_end;
@@ -442,6 +498,11 @@ typedef struct voodoo_t {
     uint32_t   cmdfifo_amax_2;
     int        cmdfifo_holecount_2;
 
+    /*Packets and words the CMDFIFOs were parsed into, logged once a second*/
+    uint32_t cmdfifo_packets;
+    uint32_t cmdfifo_words;
+    uint32_t cmdfifo_stats_time;
+
     atomic_uint cmd_status, cmd_status_2;
 
     uint32_t     sSetupMode;
@@ -657,16 +718,22 @@ typedef struct voodoo_t {
     uint8_t  thefilterg[256][256];
     uint8_t  thefilterb[256][256];
     uint16_t purpleline[256][3];
+    int      filter_cap[3]; /*Blue, green and red thresholds the tables were built with*/
 
     texture_t texture_cache[2][TEX_CACHE_MAX];
-    uint8_t   texture_present[2][16384];
-    int       texture_last_removed;
+    uint8_t   texture_present[2][TEX_PAGES];
+    int       texture_hash[2][TEX_HASH_SIZE];
+    /*Reverse index - which cache entries cover each TEX_DIRTY_SHIFT sized page*/
+    uint64_t  texture_pages[2][TEX_PAGES][TEX_CACHE_MAX / 64];
+    uint32_t  texture_lru;
+    int       tex_cache_hits[2];
+    int       tex_cache_misses[2];
 
     uint32_t palette_checksum[2];
     int      palette_dirty[2];
 
     uint64_t time;
-    int      render_time[4];
+    int      render_time[VOODOO_MAX_RENDER_THREADS];
 
     int      force_blit_count;
     int      can_blit;
@@ -678,7 +745,7 @@ typedef struct voodoo_t {
     struct voodoo_set_t *set;
 
     uint8_t fifo_thread_run;
-    uint8_t render_thread_run[4];
+    uint8_t render_thread_run[VOODOO_MAX_RENDER_THREADS];
 
     uint8_t *vram;
     uint8_t *changedvram;
@@ -24,4 +24,12 @@ uint32_t voodoo_fb_readl(uint32_t addr, void *priv);
 void     voodoo_fb_writew(uint32_t addr, uint16_t val, void *priv);
 void     voodoo_fb_writel(uint32_t addr, uint32_t val, void *priv);
 
+/* Write combining for LFB writes coming from the FIFOs. Writes are collected
+   into spans with voodoo_fb_span_write() and executed on the render threads,
+   in order with the triangles. */
+void voodoo_fb_span_init(voodoo_lfb_span_t *span, int writel);
+void voodoo_fb_span_write(voodoo_t *voodoo, voodoo_lfb_span_t *span, uint32_t addr, uint32_t val);
+void voodoo_fb_span_flush(voodoo_t *voodoo, voodoo_lfb_span_t *span);
+void voodoo_fb_span(voodoo_t *voodoo, const voodoo_params_t *params, const voodoo_lfb_span_t *span);
+
 #endif /*VIDEO_VOODOO_FB_H*/
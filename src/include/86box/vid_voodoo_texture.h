@@ -33,6 +33,7 @@ static const uint32_t texture_offset[LOD_MAX + 3] = {
     256 * 256 + 128 * 128 + 64 * 64 + 32 * 32 + 16 * 16 + 8 * 8 + 4 * 4 + 2 * 2 + 1 * 1 + 1
 };
 
+void voodoo_texture_cache_init(voodoo_t *voodoo);
 void voodoo_recalc_tex12(voodoo_t *voodoo, int tmu);
 void voodoo_recalc_tex3(voodoo_t *voodoo, int tmu);
 void voodoo_use_texture(voodoo_t *voodoo, voodoo_params_t *params, int tmu);
@@ -88,6 +88,23 @@ typedef struct bitmap_t {
     uint32_t *line[2112];
 } bitmap_t;
 
+/* Hardware cursor image handed to the presenter instead of being drawn into
+   the frame. Every pixel of the frame under it becomes
+   (pixel & and_mask) ^ xor_mask, which covers the opaque, transparent and
+   inverting pixels the cursor hardware produces. Both masks have a stride
+   of CURSOR_LAYER_MAX pixels and w is 0 while no cursor is shown. */
+#define CURSOR_LAYER_MAX 128
+
+typedef struct cursor_layer_t {
+    int      x;
+    int      y;
+    int      w;
+    int      h;
+    uint32_t generation;
+    uint32_t and_mask[CURSOR_LAYER_MAX * CURSOR_LAYER_MAX];
+    uint32_t xor_mask[CURSOR_LAYER_MAX * CURSOR_LAYER_MAX];
+} cursor_layer_t;
+
 typedef struct rgb_t {
     uint8_t r;
     uint8_t g;
@@ -129,6 +146,7 @@ typedef struct monitor_t {
     int                     *mon_cga_palette;
     int                      mon_pal_lookup_static;  /* Whether it should not be freed by the API. */
     int                      mon_cga_palette_static; /* Whether it should not be freed by the API. */
+    uint32_t                 mon_pal_generation;     /* Bumped whenever mon_pal_lookup is rebuilt. */
     const video_timings_t   *mon_vid_timings;
     int                      mon_vid_type;
     struct blit_data_struct *mon_blit_data_ptr;
@@ -255,9 +273,16 @@ extern void video_blit_memtoscreen_8(int x, int y, int w, int h);
 extern void video_blend_monitor(int x, int y, int monitor_index);
 extern void video_process_8_monitor(int x, int y, int monitor_index);
 extern void video_blit_memtoscreen_monitor(int x, int y, int w, int h, int monitor_index);
+extern void video_blit_damage_monitor(int y1, int y2, int monitor_index);
+extern void video_blit_get_damage_monitor(int monitor_index, int *y1, int *y2);
+extern int  video_blit_pace_monitor(int monitor_index);
 extern void video_blit_complete_monitor(int monitor_index);
 extern void video_wait_for_blit_monitor(int monitor_index);
 extern void video_wait_for_buffer_monitor(int monitor_index);
+extern int  video_cursor_layer_active(int monitor_index);
+extern void video_cursor_layer_presenter(int monitor_index, int supported);
+extern void video_cursor_layer_update(int monitor_index, const cursor_layer_t *layer);
+extern int  video_cursor_layer_get(int monitor_index, cursor_layer_t *layer, uint32_t generation);
 
 extern bitmap_t *create_bitmap(int w, int h);
 extern void      destroy_bitmap(bitmap_t *b);
@@ -269,6 +294,7 @@ extern void    video_monitor_init(int);
 extern void    video_monitor_close(int);
 extern void    video_init(void);
 extern void    video_close(void);
+extern void    video_clone_child(void);
 extern void    video_reset_close(void);
 extern void    video_pre_reset(int card);
 extern void    video_reset(int card);
@@ -279,6 +305,7 @@ extern void    video_force_resize_set_monitor(uint8_t res, int monitor_index);
 extern void    video_update_timing(void);
 
 extern void loadfont_ex(char *s, int format, int offset);
+extern void video_free_ksc5601(void);
 extern void loadfont(char *s, int format);
 
 extern int get_actual_size_x(void);
@@ -69,6 +69,7 @@ typedef struct zip_drive_t {
     uint32_t           is_250;
     uint32_t           medium_size;
     uint32_t           base;
+    uint32_t           instant;   /* Skip transfer timing. */
 } zip_drive_t;
 
 typedef struct zip_t {
@@ -42,6 +42,10 @@ typedef struct _io_ {
     void (*outw)(uint16_t addr, uint16_t val, void *priv);
     void (*outl)(uint16_t addr, uint32_t val, void *priv);
 
+    /* Optional, move a run of words and return how many were moved. */
+    int (*inw_rep)(uint16_t addr, uint16_t *buf, int count, void *priv);
+    int (*outw_rep)(uint16_t addr, const uint16_t *buf, int count, void *priv);
+
     void *priv;
 
     struct _io_ *prev, *next;
@@ -55,9 +59,40 @@ typedef struct {
     void     *priv;
 } io_trap_t;
 
-int   initialized = 0;
-io_t *io[NPORTS];
-io_t *io_last[NPORTS];
+/*
+ * Summary of the handler chain of each port, rebuilt whenever the chain
+ * changes, so the accessors can skip the walks that would not call anything.
+ * A wide access also runs the narrower handlers of the ports it covers that
+ * have no handler of its own size, hence the _W and _WL flags.
+ */
+#define IO_INB     0x0001
+#define IO_INW     0x0002
+#define IO_INL     0x0004
+#define IO_INB_W   0x0008 /* inb without inw. */
+#define IO_INB_WL  0x0010 /* inb without inw or inl. */
+#define IO_INW_L   0x0020 /* inw without inl. */
+#define IO_OUTB    0x0040
+#define IO_OUTW    0x0080
+#define IO_OUTL    0x0100
+#define IO_OUTB_W  0x0200
+#define IO_OUTB_WL 0x0400
+#define IO_OUTW_L  0x0800
+#define IO_SINGLE  0x1000 /* A lone handler, called without walking. */
+
+int             initialized = 0;
+io_t           *io[NPORTS];
+io_t           *io_last[NPORTS];
+static uint16_t io_flags[NPORTS];
+
+#ifdef USE_IO_STATS
+/* Accesses of any size since the last dump. */
+static uint32_t io_port_reads[NPORTS];
+static uint32_t io_port_writes[NPORTS];
+
+#    define io_count(counts, port) counts[port]++
+#else
+#    define io_count(counts, port)
+#endif
 
 #ifdef ENABLE_IO_LOG
 int io_do_log = ENABLE_IO_LOG;
@@ -69,7 +104,7 @@ io_log(const char *fmt, ...)
 
     if (io_do_log) {
         va_start(ap, fmt);
-        pclog_ex(fmt, ap);
+        pclog_fast_ex(fmt, ap);
         va_end(ap);
     }
 }
@@ -77,6 +112,77 @@ io_log(const char *fmt, ...)
 #    define io_log(fmt, ...)
 #endif
 
+static void
+io_update_flags(uint16_t port)
+{
+    uint16_t flags = 0;
+
+    for (io_t *p = io[port]; p; p = p->next) {
+        if (p->inb)
+            flags |= IO_INB | (p->inw ? 0 : IO_INB_W) | ((p->inw || p->inl) ? 0 : IO_INB_WL);
+        if (p->inw)
+            flags |= IO_INW | (p->inl ? 0 : IO_INW_L);
+        if (p->inl)
+            flags |= IO_INL;
+        if (p->outb)
+            flags |= IO_OUTB | (p->outw ? 0 : IO_OUTB_W) | ((p->outw || p->outl) ? 0 : IO_OUTB_WL);
+        if (p->outw)
+            flags |= IO_OUTW | (p->outl ? 0 : IO_OUTW_L);
+        if (p->outl)
+            flags |= IO_OUTL;
+    }
+
+    if (io[port] && !io[port]->next)
+        flags |= IO_SINGLE;
+
+    io_flags[port] = flags;
+}
+
+#ifdef USE_IO_STATS
+static int
+io_port_stats_compare(const void *a, const void *b)
+{
+    uint16_t pa = *(const uint16_t *) a;
+    uint16_t pb = *(const uint16_t *) b;
+    uint64_t ca = (uint64_t) io_port_reads[pa] + io_port_writes[pa];
+    uint64_t cb = (uint64_t) io_port_reads[pb] + io_port_writes[pb];
+
+    return (ca < cb) - (ca > cb);
+}
+#endif
+
+void
+io_port_stats_dump(void)
+{
+#ifdef USE_IO_STATS
+    uint16_t *ports = (uint16_t *) malloc(NPORTS * sizeof(uint16_t));
+    int       num   = 0;
+
+    for (int c = 0; c < NPORTS; c++) {
+        if (io_port_reads[c] || io_port_writes[c])
+            ports[num++] = c;
+    }
+
+    if (num) {
+        qsort(ports, num, sizeof(uint16_t), io_port_stats_compare);
+
+        pclog("I/O port statistics, %i ports accessed:\n", num);
+        pclog("%-6s %12s %12s %-18s\n", "Port", "Reads", "Writes", "Handler");
+
+        for (int c = 0; c < MIN(num, 32); c++) {
+            io_t *p = io[ports[c]];
+
+            pclog("%04X   %12u %12u %-18p\n", ports[c], io_port_reads[ports[c]], io_port_writes[ports[c]],
+                  p ? p->priv : NULL);
+        }
+    }
+
+    free(ports);
+    memset(io_port_reads, 0x00, sizeof(io_port_reads));
+    memset(io_port_writes, 0x00, sizeof(io_port_writes));
+#endif
+}
+
 void
 io_init(void)
 {
@@ -84,6 +190,8 @@ io_init(void)
     io_t *p;
     io_t *q;
 
+    io_port_stats_dump();
+
     if (!initialized) {
         for (c = 0; c < NPORTS; c++)
             io[c] = io_last[c] = NULL;
@@ -105,6 +213,7 @@ io_init(void)
 
         /* io[c] should be NULL. */
         io[c] = io_last[c] = NULL;
+        io_flags[c]        = 0;
     }
 }
 
@@ -147,6 +256,8 @@ io_sethandler_common(uint16_t base, int size,
         io_last[base + c] = q;
 
         q = NULL;
+
+        io_update_flags(base + c);
     }
 }
 
@@ -184,6 +295,8 @@ io_removehandler_common(uint16_t base, int size,
             }
             p = q;
         }
+
+        io_update_flags(base + c);
     }
 }
 
@@ -281,6 +394,71 @@ io_handler_interleaved(int set, uint16_t base, int size,
     io_handler_common(set, base, size, inb, inw, inl, outb, outw, outl, priv, 2);
 }
 
+/* Attaches bulk word handlers to the handlers already set up with the same priv. */
+void
+io_handler_rep(int set, uint16_t base, int size,
+               int (*inw_rep)(uint16_t addr, uint16_t *buf, int count, void *priv),
+               int (*outw_rep)(uint16_t addr, const uint16_t *buf, int count, void *priv),
+               void *priv)
+{
+    for (int c = 0; c < size; c++) {
+        for (io_t *p = io[(base + c) & 0xffff]; p; p = p->next) {
+            if (p->priv == priv) {
+                p->inw_rep  = (set && p->inw) ? inw_rep : NULL;
+                p->outw_rep = (set && p->outw) ? outw_rep : NULL;
+            }
+        }
+    }
+}
+
+/* Only a port with a lone handler can hand over a whole run at once,
+   anything else goes through inw() and outw() a word at a time. */
+static io_t *
+io_rep_handler(uint16_t port, int write)
+{
+    io_t *p = io[port];
+
+    if ((p == NULL) || (p->next != NULL) || (write ? (p->outw_rep == NULL) : (p->inw_rep == NULL)) ||
+        (amstrad_latch & 0x80000000) ||
+        ((pci_flags & FLAG_CONFIG_IO_ON) && (port >= pci_base) && (port < (pci_base + pci_size))) ||
+        ((pci_flags & FLAG_CONFIG_DEV0_IO_ON) && (port >= 0xc000) && (port < 0xc100)))
+        return NULL;
+
+    /* Byte handlers on the upper half would see every access too. */
+    for (io_t *q = io[(port + 1) & 0xffff]; q; q = q->next) {
+        if (write ? (q->outb && !q->outw) : (q->inb && !q->inw))
+            return NULL;
+    }
+
+    return p;
+}
+
+int
+inw_rep(uint16_t port, uint16_t *buf, int count)
+{
+    io_t *p = io_rep_handler(port, 0);
+
+    if (p == NULL)
+        return 0;
+
+    io_log("[%04X:%08X] (%i) in w(%04X) x %i\n", CS, cpu_state.pc, in_smm, port, count);
+
+    return p->inw_rep(port, buf, count, p->priv);
+}
+
+int
+outw_rep(uint16_t port, const uint16_t *buf, int count)
+{
+    io_t *p = io_rep_handler(port, 1);
+
+    if (p == NULL)
+        return 0;
+
+    io_log("[%04X:%08X] (%i) outw(%04X) x %i\n", CS, cpu_state.pc, in_smm, port, count);
+
+    return p->outw_rep(port, buf, count, p->priv);
+}
+
 #ifdef USE_DEBUG_REGS_486
 extern int trap;
 /* Set trap for I/O address breakpoints. */
@@ -336,18 +514,21 @@ io_debug_check_addr(uint16_t addr)
 uint8_t
 inb(uint16_t port)
 {
-    uint8_t ret = 0xff;
-    io_t   *p;
-    io_t   *q;
-    int     found  = 0;
+    uint8_t  ret = 0xff;
+    uint16_t flags;
+    io_t    *p;
+    io_t    *q;
+    int      found  = 0;
 #ifdef ENABLE_IO_LOG
-    int     qfound = 0;
+    int      qfound = 0;
 #endif
 
 #ifdef USE_DEBUG_REGS_486
     io_debug_check_addr(port);
 #endif
 
+    io_count(io_port_reads, port);
+
     if ((pci_flags & FLAG_CONFIG_IO_ON) && (port >= pci_base) && (port < (pci_base + pci_size))) {
         ret = pci_read(port, NULL);
         found = 1;
@@ -360,18 +541,26 @@ inb(uint16_t port)
 #ifdef ENABLE_IO_LOG
         qfound = 1;
 #endif
-    } else {
+    } else if ((flags = io_flags[port]) & IO_INB) {
         p = io[port];
-        while (p) {
-            q = p->next;
-            if (p->inb) {
-                ret &= p->inb(port, p->priv);
-                found |= 1;
+        if (flags & IO_SINGLE) {
+            ret   = p->inb(port, p->priv);
+            found = 1;
+#ifdef ENABLE_IO_LOG
+            qfound = 1;
+#endif
+        } else {
+            while (p) {
+                q = p->next;
+                if (p->inb) {
+                    ret &= p->inb(port, p->priv);
+                    found |= 1;
 #ifdef ENABLE_IO_LOG
-                qfound++;
+                    qfound++;
 #endif
+                }
+                p = q;
             }
-            p = q;
         }
     }
 
@@ -401,17 +590,20 @@ inb(uint16_t port)
 void
 outb(uint16_t port, uint8_t val)
 {
-    io_t *p;
-    io_t *q;
-    int   found  = 0;
+    uint16_t flags;
+    io_t    *p;
+    io_t    *q;
+    int      found  = 0;
 #ifdef ENABLE_IO_LOG
-    int   qfound = 0;
+    int      qfound = 0;
 #endif
 
 #ifdef USE_DEBUG_REGS_486
     io_debug_check_addr(port);
 #endif
 
+    io_count(io_port_writes, port);
+
     if ((pci_flags & FLAG_CONFIG_IO_ON) && (port >= pci_base) && (port < (pci_base + pci_size))) {
         pci_write(port, val, NULL);
         found = 1;
@@ -424,18 +616,26 @@ outb(uint16_t port, uint8_t val)
 #ifdef ENABLE_IO_LOG
         qfound = 1;
 #endif
-    } else {
+    } else if ((flags = io_flags[port]) & IO_OUTB) {
         p = io[port];
-        while (p) {
-            q = p->next;
-            if (p->outb) {
-                p->outb(port, val, p->priv);
-                found |= 1;
+        if (flags & IO_SINGLE) {
+            p->outb(port, val, p->priv);
+            found = 1;
+#ifdef ENABLE_IO_LOG
+            qfound = 1;
+#endif
+        } else {
+            while (p) {
+                q = p->next;
+                if (p->outb) {
+                    p->outb(port, val, p->priv);
+                    found |= 1;
 #ifdef ENABLE_IO_LOG
-                qfound++;
+                    qfound++;
 #endif
+                }
+                p = q;
             }
-            p = q;
         }
     }
 
@@ -468,6 +668,8 @@ inw(uint16_t port)
     io_debug_check_addr(port);
 #endif
 
+    io_count(io_port_reads, port);
+
     if ((pci_flags & FLAG_CONFIG_IO_ON) && (port >= pci_base) && (port < (pci_base + pci_size))) {
         ret = pci_readw(port, NULL);
         found = 2;
@@ -481,36 +683,40 @@ inw(uint16_t port)
         qfound = 1;
 #endif
     } else {
-        p = io[port];
-        while (p) {
-            q = p->next;
-            if (p->inw) {
-                ret &= p->inw(port, p->priv);
-                found |= 2;
+        if (io_flags[port] & IO_INW) {
+            p = io[port];
+            while (p) {
+                q = p->next;
+                if (p->inw) {
+                    ret &= p->inw(port, p->priv);
+                    found |= 2;
 #ifdef ENABLE_IO_LOG
-                qfound++;
+                    qfound++;
 #endif
+                }
+                p = q;
             }
-            p = q;
         }
 
-        ret8[0] = ret & 0xff;
-        ret8[1] = (ret >> 8) & 0xff;
-        for (uint8_t i = 0; i < 2; i++) {
-            p = io[(port + i) & 0xffff];
-            while (p) {
-                q = p->next;
-                if (p->inb && !p->inw) {
-                    ret8[i] &= p->inb(port + i, p->priv);
-                    found |= 1;
+        if ((io_flags[port] | io_flags[(port + 1) & 0xffff]) & IO_INB_W) {
+            ret8[0] = ret & 0xff;
+            ret8[1] = (ret >> 8) & 0xff;
+            for (uint8_t i = 0; i < 2; i++) {
+                p = io[(port + i) & 0xffff];
+                while (p) {
+                    q = p->next;
+                    if (p->inb && !p->inw) {
+                        ret8[i] &= p->inb(port + i, p->priv);
+                        found |= 1;
 #ifdef ENABLE_IO_LOG
-                    qfound++;
+                        qfound++;
 #endif
+                    }
+                    p = q;
                 }
-                p = q;
             }
+            ret = (ret8[1] << 8) | ret8[0];
         }
-        ret = (ret8[1] << 8) | ret8[0];
     }
 
     if (amstrad_latch & 0x80000000) {
@@ -544,6 +750,8 @@ outw(uint16_t port, uint16_t val)
     io_debug_check_addr(port);
 #endif
 
+    io_count(io_port_writes, port);
+
     if ((pci_flags & FLAG_CONFIG_IO_ON) && (port >= pci_base) && (port < (pci_base + pci_size))) {
         pci_writew(port, val, NULL);
         found = 2;
@@ -557,20 +765,24 @@ outw(uint16_t port, uint16_t val)
         qfound = 1;
 #endif
     } else {
-        p = io[port];
-        while (p) {
-            q = p->next;
-            if (p->outw) {
-                p->outw(port, val, p->priv);
-                found |= 2;
+        if (io_flags[port] & IO_OUTW) {
+            p = io[port];
+            while (p) {
+                q = p->next;
+                if (p->outw) {
+                    p->outw(port, val, p->priv);
+                    found |= 2;
 #ifdef ENABLE_IO_LOG
-                qfound++;
+                    qfound++;
 #endif
+                }
+                p = q;
             }
-            p = q;
         }
 
         for (uint8_t i = 0; i < 2; i++) {
+            if (!(io_flags[(port + i) & 0xffff] & IO_OUTB_W))
+                continue;
             p = io[(port + i) & 0xffff];
             while (p) {
                 q = p->next;
@@ -616,6 +828,8 @@ inl(uint16_t port)
     io_debug_check_addr(port);
 #endif
 
+    io_count(io_port_reads, port);
+
     if ((pci_flags & FLAG_CONFIG_IO_ON) && (port >= pci_base) && (port < (pci_base + pci_size))) {
         ret = pci_readl(port, NULL);
         found = 4;
@@ -629,67 +843,63 @@ inl(uint16_t port)
         qfound = 1;
 #endif
     } else {
-        p = io[port];
-        while (p) {
-            q = p->next;
-            if (p->inl) {
-                ret &= p->inl(port, p->priv);
-                found |= 4;
-#ifdef ENABLE_IO_LOG
-                qfound++;
-#endif
-            }
-            p = q;
-        }
-
-        ret16[0] = ret & 0xffff;
-        ret16[1] = (ret >> 16) & 0xffff;
-        p        = io[port & 0xffff];
-        while (p) {
-            q = p->next;
-            if (p->inw && !p->inl) {
-                ret16[0] &= p->inw(port, p->priv);
-                found |= 2;
+        if (io_flags[port] & IO_INL) {
+            p = io[port];
+            while (p) {
+                q = p->next;
+                if (p->inl) {
+                    ret &= p->inl(port, p->priv);
+                    found |= 4;
 #ifdef ENABLE_IO_LOG
-                qfound++;
+                    qfound++;
 #endif
+                }
+                p = q;
             }
-            p = q;
         }
 
-        p = io[(port + 2) & 0xffff];
-        while (p) {
-            q = p->next;
-            if (p->inw && !p->inl) {
-                ret16[1] &= p->inw(port + 2, p->priv);
-                found |= 2;
+        if ((io_flags[port] | io_flags[(port + 2) & 0xffff]) & IO_INW_L) {
+            ret16[0] = ret & 0xffff;
+            ret16[1] = (ret >> 16) & 0xffff;
+            for (uint8_t i = 0; i < 2; i++) {
+                p = io[(port + (i << 1)) & 0xffff];
+                while (p) {
+                    q = p->next;
+                    if (p->inw && !p->inl) {
+                        ret16[i] &= p->inw(port + (i << 1), p->priv);
+                        found |= 2;
 #ifdef ENABLE_IO_LOG
-                qfound++;
+                        qfound++;
 #endif
+                    }
+                    p = q;
+                }
             }
-            p = q;
+            ret = (ret16[1] << 16) | ret16[0];
         }
-        ret = (ret16[1] << 16) | ret16[0];
 
-        ret8[0] = ret & 0xff;
-        ret8[1] = (ret >> 8) & 0xff;
-        ret8[2] = (ret >> 16) & 0xff;
-        ret8[3] = (ret >> 24) & 0xff;
-        for (uint8_t i = 0; i < 4; i++) {
-            p = io[(port + i) & 0xffff];
-            while (p) {
-                q = p->next;
-                if (p->inb && !p->inw && !p->inl) {
-                    ret8[i] &= p->inb(port + i, p->priv);
-                    found |= 1;
+        if ((io_flags[port] | io_flags[(port + 1) & 0xffff] |
+             io_flags[(port + 2) & 0xffff] | io_flags[(port + 3) & 0xffff]) & IO_INB_WL) {
+            ret8[0] = ret & 0xff;
+            ret8[1] = (ret >> 8) & 0xff;
+            ret8[2] = (ret >> 16) & 0xff;
+            ret8[3] = (ret >> 24) & 0xff;
+            for (uint8_t i = 0; i < 4; i++) {
+                p = io[(port + i) & 0xffff];
+                while (p) {
+                    q = p->next;
+                    if (p->inb && !p->inw && !p->inl) {
+                        ret8[i] &= p->inb(port + i, p->priv);
+                        found |= 1;
 #ifdef ENABLE_IO_LOG
-                    qfound++;
+                        qfound++;
 #endif
+                    }
+                    p = q;
                 }
-                p = q;
             }
+            ret = (ret8[3] << 24) | (ret8[2] << 16) | (ret8[1] << 8) | ret8[0];
         }
-        ret = (ret8[3] << 24) | (ret8[2] << 16) | (ret8[1] << 8) | ret8[0];
     }
 
     if (amstrad_latch & 0x80000000) {
@@ -724,6 +934,8 @@ outl(uint16_t port, uint32_t val)
     io_debug_check_addr(port);
 #endif
 
+    io_count(io_port_writes, port);
+
     if ((pci_flags & FLAG_CONFIG_IO_ON) && (port >= pci_base) && (port < (pci_base + pci_size))) {
         pci_writel(port, val, NULL);
         found = 4;
@@ -737,8 +949,8 @@ outl(uint16_t port, uint32_t val)
         qfound = 1;
 #endif
     } else {
-        p = io[port];
-        if (p) {
+        if (io_flags[port] & IO_OUTL) {
+            p = io[port];
             while (p) {
                 q = p->next;
                 if (p->outl) {
@@ -753,6 +965,8 @@ outl(uint16_t port, uint32_t val)
         }
 
         for (i = 0; i < 4; i += 2) {
+            if (!(io_flags[(port + i) & 0xffff] & IO_OUTW_L))
+                continue;
             p = io[(port + i) & 0xffff];
             while (p) {
                 q = p->next;
@@ -768,6 +982,8 @@ outl(uint16_t port, uint32_t val)
         }
 
         for (i = 0; i < 4; i++) {
+            if (!(io_flags[(port + i) & 0xffff] & IO_OUTB_WL))
+                continue;
             p = io[(port + i) & 0xffff];
             while (p) {
                 q = p->next;
@@ -51,6 +51,15 @@ ioapic_log(const char *fmt, ...)
 #    define ioapic_log(fmt, ...)
 #endif
 
+/*
+ * There is only ever one processor, and no local APIC, so the MPS tables
+ * are hidden from the operating system, which then boots a uniprocessor
+ * kernel with the 8259 PICs. Showing them would take a second CPU, which
+ * the emulator can not provide: cpu_state, the segment and paging state,
+ * the TLB lookup tables and the recompiler's code cache are all global,
+ * and are only ever touched by the emulation thread, which also runs all
+ * of the devices without any locking.
+ */
 static void
 ioapic_write(UNUSED(uint16_t port), uint8_t val, UNUSED(void *priv))
 {
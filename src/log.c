@@ -107,29 +107,27 @@ log_out(void *priv, const char *fmt, va_list ap)
     log_t *log = (log_t *) priv;
     char   temp[1024];
     char   fmt2[1024];
+    char   rep[1024];
 
     if (log == NULL)
         pclog("WARNING: Logging called with a NULL log pointer\n");
     else if (fmt == NULL)
         pclog("WARNING: Logging called with a NULL format pointer\n");
-    else if (fmt[0] != '\0') {
-        log_ensure_stdlog_open();
-
+    else if ((fmt[0] != '\0') && log_rate_check(fmt)) {
         vsprintf(temp, fmt, ap);
         if (log->suppr_seen && !strcmp(log->buff, temp))
             log->seen++;
         else {
             if (log->suppr_seen && log->seen) {
                 log_copy(log, fmt2, "*** %d repeats ***\n", 1024);
-                fprintf(stdlog, fmt2, log->seen);
+                snprintf(rep, sizeof(rep), fmt2, log->seen);
+                log_emit(rep);
             }
             log->seen = 0;
             strcpy(log->buff, temp);
             log_copy(log, fmt2, temp, 1024);
-            fprintf(stdlog, fmt2, ap);
+            log_emit(fmt2);
         }
-
-        fflush(stdlog);
     }
 }
 
@@ -156,10 +154,7 @@ log_out_cyclic(void* priv, const char* fmt, va_list ap)
     else if (fmt == NULL)
         pclog("WARNING: Cyclical logging called with a NULL format pointer\n");
     /* Is the string empty? */
-    else if (fmt[0] != '\0') {
-        /* Ensure stdlog is open. */
-        log_ensure_stdlog_open();
-
+    else if ((fmt[0] != '\0') && log_rate_check(fmt)) {
         char temp[LOG_SIZE_BUFFER] = {0};
 
         log->cyclic_last_line %= LOG_SIZE_BUFFER_CYCLIC_LINES;
@@ -239,7 +234,7 @@ log_out_cyclic(void* priv, const char* fmt, va_list ap)
                         log_copy(log, temp, log->cyclic_buff[real_index],
                                  LOG_SIZE_BUFFER);
 
-                        fprintf(stdlog, "%s", log->cyclic_buff[real_index]);
+                        log_emit(log->cyclic_buff[real_index]);
                     }
 
                     /* Restore the original line. */
@@ -248,19 +243,20 @@ log_out_cyclic(void* priv, const char* fmt, va_list ap)
                              LOG_SIZE_BUFFER);
 
                     /* Allow normal logging. */
-                    fprintf(stdlog, "%s", temp);
+                    log_emit(temp);
                 }
 
-                if (log->log_cycles > 1 && log->log_cycles < 100)
-                    fprintf(stdlog, "***** Cyclical Log Repeat of Order %d "
-                            "#%d *****\n", repeat_order, log->log_cycles);
-                else if (log->log_cycles == 100)
-                    fprintf(stdlog, "Logged the same cycle 100 times... "
-                            "Silence until something interesting happens\n");
+                if (log->log_cycles > 1 && log->log_cycles < 100) {
+                    snprintf(temp, sizeof(temp), "***** Cyclical Log Repeat of Order %d "
+                             "#%d *****\n", repeat_order, log->log_cycles);
+                    log_emit(temp);
+                } else if (log->log_cycles == 100)
+                    log_emit("Logged the same cycle 100 times... "
+                             "Silence until something interesting happens\n");
             }
         } else {
             log->log_cycles = 0;
-            fprintf(stdlog, "%s", temp);
+            log_emit(temp);
         }
 
         log->cyclic_last_line++;
@@ -0,0 +1,739 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Asynchronous log writer.
+ *
+ *          Every thread that logs gets a ring of its own, so putting a
+ *          line in never takes a lock. The lines are numbered as they
+ *          go in, and the writer thread puts them back in that order
+ *          as it empties the rings into the log file. A thread that
+ *          finds its ring full drops the line rather than wait, and
+ *          the writer says how many went missing.
+ *
+ *          In the binary mode, the hottest call sites leave the
+ *          formatting to the writer as well, and only copy the format
+ *          pointer and the raw arguments into the ring.
+ */
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <wchar.h>
+#define HAVE_STDARG_H
+#include <86box/86box.h>
+#include <86box/plat.h>
+#include <86box/thread.h>
+#include <86box/spsc.h>
+#include <86box/log.h>
+
+int log_mode       = LOG_MODE_ASYNC;
+int log_rate_limit = 0;
+
+extern FILE *stdlog;
+
+#ifndef RELEASE_BUILD
+#    define LOG_RING_ENTRIES 1024 /* Per thread, must be a power of two. */
+#    define LOG_RINGS_MAX    64   /* Threads past that write synchronously. */
+#    define LOG_ENTRY_DATA   232
+#    define LOG_FAST_ARGS    16
+#    define LOG_FAST_SPEC    16   /* Longest conversion the writer will redo. */
+#    define LOG_RATE_SITES   256  /* Must be a power of two. */
+#    define LOG_WRITER_MS    20
+
+enum {
+    LOG_ARG_LITERAL = -1, /* "%%" */
+    LOG_ARG_INT     = 0,
+    LOG_ARG_LONG,
+    LOG_ARG_LLONG,
+    LOG_ARG_SIZE,
+    LOG_ARG_PTRDIFF,
+    LOG_ARG_INTMAX,
+    LOG_ARG_DOUBLE,
+    LOG_ARG_PTR,
+    LOG_ARG_STR
+};
+
+typedef struct log_entry_t {
+    uint64_t    seq;
+    const char *fmt;    /* Set when the formatting was left to the writer. */
+    uint16_t    len;    /* Of the text in this entry. */
+    uint8_t     chunks; /* Entries the line takes up, kept in the first one. */
+    char        data[LOG_ENTRY_DATA];
+} log_entry_t;
+
+typedef struct log_ring_t {
+    spsc_t      q;
+    atomic_int  owned;
+    atomic_uint dropped;
+    log_entry_t entries[LOG_RING_ENTRIES];
+} log_ring_t;
+
+typedef struct log_site_t {
+    const char *fmt;
+    uint32_t    start; /* Tick the current second started at. */
+    uint32_t    lines;
+    uint32_t    suppressed;
+} log_site_t;
+
+extern void log_ensure_stdlog_open(void);
+
+static _Atomic(log_ring_t *) log_rings[LOG_RINGS_MAX];
+static atomic_int            log_rings_num;
+static atomic_ullong         log_seq;
+static atomic_int            log_running;
+static thread_t             *log_writer    = NULL;
+static event_t              *log_wake      = NULL;
+static mutex_t              *log_sync_lock = NULL;
+
+static __thread log_ring_t *log_ring_self = NULL;
+static __thread int         log_ring_none = 0; /* All of the rings were taken. */
+static __thread log_site_t  log_sites[LOG_RATE_SITES];
+
+/* Parses the conversion starting just past a '%'. Returns its length and
+   the type of argument it takes, or 0 if the writer could not redo it
+   with the same result, so the line has to be formatted right away. */
+static int
+log_parse_spec(const char *fmt, int *type)
+{
+    const char *p   = fmt;
+    int         mod = 0;
+
+    if (*p == '%') {
+        *type = LOG_ARG_LITERAL;
+        return 1;
+    }
+
+    while ((*p == '-') || (*p == '+') || (*p == ' ') || (*p == '#') || (*p == '0'))
+        p++;
+    while ((*p >= '0') && (*p <= '9'))
+        p++;
+    if (*p == '.') {
+        p++;
+        while ((*p >= '0') && (*p <= '9'))
+            p++;
+    }
+
+    switch (*p) {
+        case 'h':
+            p += (p[1] == 'h') ? 2 : 1;
+            mod = LOG_ARG_INT;
+            break;
+        case 'l':
+            if (p[1] == 'l') {
+                p += 2;
+                mod = LOG_ARG_LLONG;
+            } else {
+                p++;
+                mod = LOG_ARG_LONG;
+            }
+            break;
+        case 'z':
+            p++;
+            mod = LOG_ARG_SIZE;
+            break;
+        case 't':
+            p++;
+            mod = LOG_ARG_PTRDIFF;
+            break;
+        case 'j':
+            p++;
+            mod = LOG_ARG_INTMAX;
+            break;
+        default:
+            mod = LOG_ARG_INT;
+            break;
+    }
+
+    switch (*p) {
+        case 'd':
+        case 'i':
+        case 'u':
+        case 'x':
+        case 'X':
+        case 'o':
+            *type = mod;
+            break;
+        case 'c':
+            if (mod != LOG_ARG_INT)
+                return 0;
+            *type = LOG_ARG_INT;
+            break;
+        case 'f':
+        case 'F':
+        case 'e':
+        case 'E':
+        case 'g':
+        case 'G':
+        case 'a':
+        case 'A':
+            *type = LOG_ARG_DOUBLE;
+            break;
+        case 'p':
+            *type = LOG_ARG_PTR;
+            break;
+        case 's':
+            /* Wide strings are left to vsnprintf(). */
+            if ((mod != LOG_ARG_INT) || (p[-1] == 'h'))
+                return 0;
+            *type = LOG_ARG_STR;
+            break;
+        default:
+            /* "*" widths, %n, long doubles and anything unknown. */
+            return 0;
+    }
+
+    if ((p - fmt + 2) > LOG_FAST_SPEC)
+        return 0;
+
+    return (int) (p - fmt + 1);
+}
+
+static void
+log_write(const char *s, size_t len)
+{
+    log_ensure_stdlog_open();
+    fwrite(s, 1, len, stdlog);
+}
+
+/* Redoes the formatting of a line the producer left to us. */
+static void
+log_write_deferred(const log_entry_t *entry)
+{
+    char        out[LOG_SIZE_BUFFER];
+    char        spec[LOG_FAST_SPEC];
+    const char *p     = entry->fmt;
+    size_t      pos   = 0;
+    int         nargs = 0;
+    int         type;
+    int         len;
+    int         ret;
+    uint64_t    v;
+    double      d;
+
+    while (*p && (pos < (sizeof(out) - 1))) {
+        if (*p != '%') {
+            out[pos++] = *p++;
+            continue;
+        }
+
+        len = log_parse_spec(p + 1, &type);
+        if (type == LOG_ARG_LITERAL) {
+            out[pos++] = '%';
+            p += 2;
+            continue;
+        }
+
+        memcpy(spec, p, len + 1);
+        spec[len + 1] = '\0';
+        p += len + 1;
+
+        memcpy(&v, &entry->data[nargs++ * sizeof(uint64_t)], sizeof(uint64_t));
+        switch (type) {
+            default:
+            case LOG_ARG_INT:
+                ret = snprintf(&out[pos], sizeof(out) - pos, spec, (int) v);
+                break;
+            case LOG_ARG_LONG:
+                ret = snprintf(&out[pos], sizeof(out) - pos, spec, (long) v);
+                break;
+            case LOG_ARG_LLONG:
+                ret = snprintf(&out[pos], sizeof(out) - pos, spec, (long long) v);
+                break;
+            case LOG_ARG_SIZE:
+                ret = snprintf(&out[pos], sizeof(out) - pos, spec, (size_t) v);
+                break;
+            case LOG_ARG_PTRDIFF:
+                ret = snprintf(&out[pos], sizeof(out) - pos, spec, (ptrdiff_t) v);
+                break;
+            case LOG_ARG_INTMAX:
+                ret = snprintf(&out[pos], sizeof(out) - pos, spec, (intmax_t) v);
+                break;
+            case LOG_ARG_DOUBLE:
+                memcpy(&d, &v, sizeof(double));
+                ret = snprintf(&out[pos], sizeof(out) - pos, spec, d);
+                break;
+            case LOG_ARG_PTR:
+                ret = snprintf(&out[pos], sizeof(out) - pos, spec, (void *) (uintptr_t) v);
+                break;
+            case LOG_ARG_STR:
+                ret = snprintf(&out[pos], sizeof(out) - pos, spec, &entry->data[v]);
+                break;
+        }
+
+        if (ret < 0)
+            break;
+        pos += ret;
+        if (pos > (sizeof(out) - 1))
+            pos = sizeof(out) - 1;
+    }
+
+    log_write(out, pos);
+}
+
+/* Writes out everything queued so far, oldest first. Only the writer
+   thread may call this while it is running. */
+static int
+log_drain(void)
+{
+    int num     = atomic_load(&log_rings_num);
+    int written = 0;
+
+    for (;;) {
+        log_ring_t  *ring = NULL;
+        log_entry_t *head = NULL;
+        log_entry_t *entry;
+
+        for (int i = 0; i < num; i++) {
+            log_ring_t  *r = atomic_load(&log_rings[i]);
+            log_entry_t *e;
+
+            if ((r == NULL) || spsc_empty(&r->q))
+                continue;
+            e = &r->entries[spsc_read_pos(&r->q)];
+            /* Wait for the rest of a line that spans several entries. */
+            if (spsc_entries(&r->q) < e->chunks)
+                continue;
+            if ((head == NULL) || (e->seq < head->seq)) {
+                ring = r;
+                head = e;
+            }
+        }
+
+        if (ring == NULL)
+            break;
+
+        if (head->fmt != NULL) {
+            log_write_deferred(head);
+            spsc_pop(&ring->q);
+        } else {
+            for (int c = head->chunks; c > 0; c--) {
+                entry = &ring->entries[spsc_read_pos(&ring->q)];
+                log_write(entry->data, entry->len);
+                spsc_pop(&ring->q);
+            }
+        }
+        written = 1;
+    }
+
+    /* The lines were dropped after the ones still in the ring, which have
+       all been written out by now. */
+    for (int i = 0; i < num; i++) {
+        log_ring_t *r = atomic_load(&log_rings[i]);
+        unsigned    dropped;
+
+        if ((r != NULL) && ((dropped = atomic_exchange(&r->dropped, 0)) != 0)) {
+            char temp[64];
+
+            snprintf(temp, sizeof(temp), "*** %u lines dropped, the log could not keep up ***\n", dropped);
+            log_write(temp, strlen(temp));
+            written = 1;
+        }
+    }
+
+    if (written)
+        fflush(stdlog);
+
+    return written;
+}
+
+static void
+log_writer_thread(UNUSED(void *priv))
+{
+    while (atomic_load(&log_running)) {
+        thread_wait_event(log_wake, LOG_WRITER_MS);
+        thread_reset_event(log_wake);
+        log_drain();
+    }
+}
+
+static log_ring_t *
+log_ring_get(void)
+{
+    log_ring_t *ring;
+    int         expected;
+
+    if ((log_ring_self != NULL) || log_ring_none)
+        return log_ring_self;
+
+    for (int i = 0; i < LOG_RINGS_MAX; i++) {
+        ring = atomic_load(&log_rings[i]);
+
+        if (ring == NULL) {
+            log_ring_t *none = NULL;
+
+            ring = calloc(1, sizeof(log_ring_t));
+            spsc_init(&ring->q, LOG_RING_ENTRIES, 0, NULL, NULL);
+            atomic_store(&ring->owned, 1);
+            if (!atomic_compare_exchange_strong(&log_rings[i], &none, ring)) {
+                /* Someone else got that slot first. */
+                free(ring);
+                ring = none;
+            } else {
+                expected = atomic_load(&log_rings_num);
+                while ((expected < (i + 1)) && !atomic_compare_exchange_weak(&log_rings_num, &expected, i + 1))
+                    ;
+                log_ring_self = ring;
+                return ring;
+            }
+        }
+
+        /* One left behind by a thread that is gone. */
+        expected = 0;
+        if (atomic_compare_exchange_strong(&ring->owned, &expected, 1)) {
+            log_ring_self = ring;
+            return ring;
+        }
+    }
+
+    log_ring_none = 1;
+    return NULL;
+}
+
+/* Reserves n entries of the ring, or counts the line as dropped. */
+static log_entry_t *
+log_reserve(log_ring_t *ring, int n)
+{
+    uint32_t queued = spsc_entries(&ring->q);
+
+    if ((queued + n) > LOG_RING_ENTRIES) {
+        atomic_fetch_add_explicit(&ring->dropped, 1, memory_order_relaxed);
+        thread_set_event(log_wake);
+        return NULL;
+    }
+
+    /* The writer looks in on its own every so often, so there is no need
+       to wake it on every line. */
+    if ((queued + n) >= (LOG_RING_ENTRIES / 2))
+        thread_set_event(log_wake);
+
+    return &ring->entries[spsc_write_pos(&ring->q)];
+}
+
+static void
+log_emit_sync(const char *s)
+{
+    if (log_sync_lock != NULL)
+        thread_wait_mutex(log_sync_lock);
+    log_ensure_stdlog_open();
+    fputs(s, stdlog);
+    fflush(stdlog);
+    if (log_sync_lock != NULL)
+        thread_release_mutex(log_sync_lock);
+}
+
+void
+log_emit(const char *s)
+{
+    log_ring_t  *ring;
+    log_entry_t *entry;
+    size_t       len;
+    int          chunks;
+    uint64_t     seq;
+
+    if (!atomic_load_explicit(&log_running, memory_order_relaxed) || ((ring = log_ring_get()) == NULL)) {
+        log_emit_sync(s);
+        return;
+    }
+
+    len    = strlen(s);
+    chunks = (int) ((len + LOG_ENTRY_DATA - 1) / LOG_ENTRY_DATA);
+    if (chunks == 0)
+        return;
+
+    if ((entry = log_reserve(ring, chunks)) == NULL)
+        return;
+
+    seq = atomic_fetch_add_explicit(&log_seq, 1, memory_order_relaxed);
+    entry->chunks = chunks;
+    for (int c = 0; c < chunks; c++) {
+        size_t n = (len > LOG_ENTRY_DATA) ? LOG_ENTRY_DATA : len;
+
+        entry      = &ring->entries[(spsc_write_pos(&ring->q) + c) & (LOG_RING_ENTRIES - 1)];
+        entry->seq = seq;
+        entry->fmt = NULL;
+        entry->len = (uint16_t) n;
+        memcpy(entry->data, s, n);
+        s += n;
+        len -= n;
+    }
+
+    /* The writer leaves a line alone until all of it is in. */
+    for (int c = 0; c < chunks; c++)
+        spsc_push(&ring->q);
+}
+
+void
+log_emit_fast(const char *fmt, va_list ap)
+{
+    log_ring_t  *ring;
+    log_entry_t *entry;
+    const char  *p;
+    char         temp[LOG_SIZE_BUFFER];
+    uint64_t     args[LOG_FAST_ARGS];
+    size_t       str_pos;
+    int          nargs = 0;
+    int          type;
+    int          len;
+    va_list      ap2;
+
+    if ((log_mode != LOG_MODE_BINARY) || !atomic_load_explicit(&log_running, memory_order_relaxed) ||
+        ((ring = log_ring_get()) == NULL))
+        goto format;
+
+    if ((entry = log_reserve(ring, 1)) == NULL)
+        return;
+
+    /* The strings go after the arguments, once we know how many there are. */
+    for (p = fmt; *p; p++) {
+        if ((*p == '%') && (p[1] != '%') && (p[1] != '\0') && (++nargs > LOG_FAST_ARGS))
+            goto format;
+        if ((*p == '%') && (p[1] == '%'))
+            p++;
+    }
+    str_pos = nargs * sizeof(uint64_t);
+    nargs   = 0;
+
+    va_copy(ap2, ap);
+    for (p = fmt; *p; p++) {
+        if (*p != '%')
+            continue;
+        if ((len = log_parse_spec(p + 1, &type)) == 0) {
+            va_end(ap2);
+            goto format;
+        }
+        p += len;
+
+        switch (type) {
+            case LOG_ARG_LITERAL:
+                continue;
+            case LOG_ARG_INT:
+                args[nargs] = (uint64_t) va_arg(ap2, int);
+                break;
+            case LOG_ARG_LONG:
+                args[nargs] = (uint64_t) va_arg(ap2, long);
+                break;
+            case LOG_ARG_LLONG:
+                args[nargs] = (uint64_t) va_arg(ap2, long long);
+                break;
+            case LOG_ARG_SIZE:
+                args[nargs] = (uint64_t) va_arg(ap2, size_t);
+                break;
+            case LOG_ARG_PTRDIFF:
+                args[nargs] = (uint64_t) va_arg(ap2, ptrdiff_t);
+                break;
+            case LOG_ARG_INTMAX:
+                args[nargs] = (uint64_t) va_arg(ap2, intmax_t);
+                break;
+            case LOG_ARG_DOUBLE:
+                {
+                    double d = va_arg(ap2, double);
+
+                    memcpy(&args[nargs], &d, sizeof(double));
+                }
+                break;
+            case LOG_ARG_PTR:
+                args[nargs] = (uint64_t) (uintptr_t) va_arg(ap2, void *);
+                break;
+            case LOG_ARG_STR:
+                {
+                    const char *s = va_arg(ap2, const char *);
+                    size_t      n;
+
+                    if (s == NULL)
+                        s = "(null)";
+                    n = strlen(s) + 1;
+                    /* Would not fit, so it is not worth deferring. */
+                    if ((str_pos + n) > LOG_ENTRY_DATA) {
+                        va_end(ap2);
+                        goto format;
+                    }
+                    memcpy(&entry->data[str_pos], s, n);
+                    args[nargs] = str_pos;
+                    str_pos += n;
+                }
+                break;
+            default:
+                break;
+        }
+        nargs++;
+    }
+    va_end(ap2);
+
+    memcpy(entry->data, args, nargs * sizeof(uint64_t));
+    entry->seq    = atomic_fetch_add_explicit(&log_seq, 1, memory_order_relaxed);
+    entry->fmt    = fmt;
+    entry->len    = 0;
+    entry->chunks = 1;
+    spsc_push(&ring->q);
+    return;
+
+format:
+    vsnprintf(temp, sizeof(temp), fmt, ap);
+    log_emit(temp);
+}
+
+int
+log_rate_check(const char *fmt)
+{
+    log_site_t *site;
+    uint32_t    now;
+
+    if (log_rate_limit <= 0)
+        return 1;
+
+    site = &log_sites[(((uintptr_t) fmt >> 2) * 2654435761u) & (LOG_RATE_SITES - 1)];
+    now  = plat_get_ticks();
+
+    if ((site->fmt != fmt) || ((now - site->start) >= 1000)) {
+        if (site->suppressed) {
+            char temp[64];
+
+            snprintf(temp, sizeof(temp), "*** %u lines suppressed by the rate limit ***\n", site->suppressed);
+            log_emit(temp);
+        }
+        site->fmt        = fmt;
+        site->start      = now;
+        site->lines      = 0;
+        site->suppressed = 0;
+    }
+
+    if (site->lines < (uint32_t) log_rate_limit) {
+        site->lines++;
+        return 1;
+    }
+
+    site->suppressed++;
+    return 0;
+}
+
+void
+log_flush(void)
+{
+    int num = atomic_load(&log_rings_num);
+    int waited;
+
+    if (atomic_load(&log_running)) {
+        /* Give the writer up to a second, it may be the one that is stuck. */
+        for (waited = 0; waited < 1000; waited++) {
+            int empty = 1;
+
+            for (int i = 0; i < num; i++) {
+                log_ring_t *r = atomic_load(&log_rings[i]);
+
+                if ((r != NULL) && (!spsc_empty(&r->q) || atomic_load(&r->dropped)))
+                    empty = 0;
+            }
+            if (empty)
+                break;
+
+            thread_set_event(log_wake);
+            plat_delay_ms(1);
+        }
+    }
+
+    if (stdlog != NULL)
+        fflush(stdlog);
+}
+
+void
+log_thread_exit(void)
+{
+    if (log_ring_self != NULL) {
+        atomic_store(&log_ring_self->owned, 0);
+        log_ring_self = NULL;
+    }
+}
+
+void
+log_async_init(void)
+{
+    if ((log_mode == LOG_MODE_SYNC) || (log_writer != NULL))
+        return;
+
+    if (log_wake == NULL)
+        log_wake = thread_create_event();
+    if (log_sync_lock == NULL)
+        log_sync_lock = thread_create_mutex();
+
+    atomic_store(&log_running, 1);
+    log_writer = thread_create(log_writer_thread, NULL);
+}
+
+void
+log_async_close(void)
+{
+    if (log_writer == NULL)
+        return;
+
+    atomic_store(&log_running, 0);
+    thread_set_event(log_wake);
+    thread_wait(log_writer);
+    log_writer = NULL;
+
+    /* Whatever got in while the writer was on its way out. */
+    log_drain();
+}
+
+/* Only the thread that forked made it across, so the rings of all of the
+   others are free to be taken, and the writer has to be started anew. */
+void
+log_clone_child(void)
+{
+    int num = atomic_load(&log_rings_num);
+
+    for (int i = 0; i < num; i++) {
+        log_ring_t *r = atomic_load(&log_rings[i]);
+
+        if ((r != NULL) && (r != log_ring_self)) {
+            spsc_clear(&r->q);
+            atomic_store(&r->owned, 0);
+        }
+    }
+
+    if (log_writer != NULL) {
+        log_writer    = NULL;
+        log_wake      = thread_create_event();
+        log_sync_lock = thread_create_mutex();
+        log_writer    = thread_create(log_writer_thread, NULL);
+    }
+}
+#else
+void
+log_flush(void)
+{
+    if (stdlog != NULL)
+        fflush(stdlog);
+}
+
+void
+log_thread_exit(void)
+{
+    //
+}
+
+void
+log_async_init(void)
+{
+    //
+}
+
+void
+log_async_close(void)
+{
+    //
+}
+
+void
+log_clone_child(void)
+{
+    //
+}
+#endif
@@ -388,8 +388,7 @@ ps1_common_init(const machine_t *model)
 {
     machine_common_init(model);
 
-    refresh_at_enable = 1;
-    pit_devs[0].set_out_func(pit_devs[0].data, 1, pit_refresh_timer_at);
+    pit_refresh_at_init();
 
     dma16_init();
     pic2_init();
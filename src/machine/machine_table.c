@@ -40,6 +40,7 @@
 #include <86box/plat_unused.h>
 #include <86box/thread.h>
 #include <86box/network.h>
+#include <86box/name_index.h>
 
 // Temporarily here till we move everything out into the right files
 extern const device_t pcjr_device;
@@ -16631,7 +16632,7 @@ machine_get_min_ram(int m)
 int
 machine_get_max_ram(int m)
 {
-#if (!(defined __amd64__ || defined _M_X64 || defined __aarch64__ || defined _M_ARM64))
+#if (!(defined __amd64__ || defined _M_X64 || defined __aarch64__ || defined _M_ARM64 || (defined __riscv && __riscv_xlen == 64)))
     return MIN(((int) machines[m].ram.max), 2097152);
 #else
     return MIN(((int) machines[m].ram.max), 3145728);
@@ -16650,18 +16651,20 @@ machine_get_type(int m)
     return (machines[m].type);
 }
 
+static const char *
+machine_index_name(int m)
+{
+    return (machines[m].init != NULL) ? machines[m].internal_name : NULL;
+}
+
+static name_index_t machine_index = NAME_INDEX_INIT(machine_index_name);
+
 int
 machine_get_machine_from_internal_name(const char *s)
 {
-    int c = 0;
-
-    while (machines[c].init != NULL) {
-        if (!strcmp(machines[c].internal_name, s))
-            return c;
-        c++;
-    }
+    int c = name_index_find(&machine_index, s);
 
-    return 0;
+    return (c >= 0) ? c : 0;
 }
 
 int
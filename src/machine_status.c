@@ -22,9 +22,103 @@
 #include <86box/thread.h>
 #include <86box/network.h>
 #include <86box/machine_status.h>
+#include <86box/io_stats.h>
+#include <minitrace/minitrace.h>
 
 machine_status_t machine_status;
 
+io_stats_t hdd_io_stats[HDD_NUM];
+io_stats_t cdrom_io_stats[CDROM_NUM];
+io_stats_t zip_io_stats[ZIP_NUM];
+io_stats_t mo_io_stats[MO_NUM];
+uint32_t   io_stats_seq;
+
+static uint32_t io_stats_ticks;
+
+void
+io_stats_reset(io_stats_t *s)
+{
+    char name[sizeof(s->name)];
+
+    memcpy(name, s->name, sizeof(name));
+    memset(s, 0x00, sizeof(io_stats_t));
+    memcpy(s->name, name, sizeof(name));
+    s->hit_pct = -1;
+}
+
+void
+io_stats_init(void)
+{
+    for (size_t i = 0; i < HDD_NUM; i++) {
+        snprintf(hdd_io_stats[i].name, sizeof(hdd_io_stats[i].name), "HDD %02i", (int) i + 1);
+        io_stats_reset(&hdd_io_stats[i]);
+    }
+    for (size_t i = 0; i < CDROM_NUM; i++) {
+        snprintf(cdrom_io_stats[i].name, sizeof(cdrom_io_stats[i].name), "CD-ROM %i", (int) i + 1);
+        io_stats_reset(&cdrom_io_stats[i]);
+    }
+    for (size_t i = 0; i < ZIP_NUM; i++) {
+        snprintf(zip_io_stats[i].name, sizeof(zip_io_stats[i].name), "ZIP %i", (int) i + 1);
+        io_stats_reset(&zip_io_stats[i]);
+    }
+    for (size_t i = 0; i < MO_NUM; i++) {
+        snprintf(mo_io_stats[i].name, sizeof(mo_io_stats[i].name), "MO %i", (int) i + 1);
+        io_stats_reset(&mo_io_stats[i]);
+    }
+
+    io_stats_ticks = plat_get_ticks();
+}
+
+static void
+io_stats_rate(io_stats_t *s, uint32_t ms)
+{
+    uint64_t ops    = s->reads + s->writes;
+    uint64_t bytes  = s->read_bytes + s->write_bytes;
+    uint64_t hits   = s->hits - s->last_hits;
+    uint64_t lookup = hits + (s->misses - s->last_misses);
+
+    s->iops    = (uint32_t) (((ops - s->last_ops) * 1000) / ms);
+    s->kbps    = (uint32_t) ((((bytes - s->last_bytes) >> 10) * 1000) / ms);
+    s->avg_us  = (ops > s->last_ops) ? (uint32_t) ((s->host_us - s->last_us) / (ops - s->last_ops)) : 0;
+    s->hit_pct = lookup ? (int) ((hits * 100) / lookup) : -1;
+
+    s->last_ops    = ops;
+    s->last_bytes  = bytes;
+    s->last_us     = s->host_us;
+    s->last_hits   = s->hits;
+    s->last_misses = s->misses;
+
+    if (ops) {
+        MTR_COUNTER(s->name, "iops", s->iops);
+        MTR_COUNTER(s->name, "kbps", s->kbps);
+        MTR_COUNTER(s->name, "avg_us", s->avg_us);
+        MTR_COUNTER(s->name, "queued", s->queued);
+    }
+}
+
+/* Publishes the rates once a second of host time has passed. */
+void
+io_stats_update(void)
+{
+    uint32_t ticks = plat_get_ticks();
+    uint32_t ms    = ticks - io_stats_ticks;
+
+    if (ms < 1000)
+        return;
+
+    for (size_t i = 0; i < HDD_NUM; i++)
+        io_stats_rate(&hdd_io_stats[i], ms);
+    for (size_t i = 0; i < CDROM_NUM; i++)
+        io_stats_rate(&cdrom_io_stats[i], ms);
+    for (size_t i = 0; i < ZIP_NUM; i++)
+        io_stats_rate(&zip_io_stats[i], ms);
+    for (size_t i = 0; i < MO_NUM; i++)
+        io_stats_rate(&mo_io_stats[i], ms);
+
+    io_stats_seq++;
+    io_stats_ticks = ticks;
+}
+
 void
 machine_status_init(void)
 {
@@ -57,4 +151,6 @@ machine_status_init(void)
         machine_status.net[i].active = false;
         machine_status.net[i].empty  = !network_is_connected(i);
     }
+
+    io_stats_init();
 }
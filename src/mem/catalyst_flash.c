@@ -63,6 +63,8 @@ typedef struct flash_t {
 
     mem_mapping_t mapping;
     mem_mapping_t mapping_h[2];
+
+    nvr_image_t *image;
 } flash_t;
 
 static char flash_path[1024];
@@ -132,12 +134,15 @@ flash_write(uint32_t addr, uint8_t val, void *priv)
 
     switch (dev->command) {
         case CMD_ERASE:
-            if (val == CMD_ERASE_CONFIRM)
+            if (val == CMD_ERASE_CONFIRM) {
                 memset(dev->array, 0xff, biosmask + 1);
+                nvr_image_dirty(dev->image);
+            }
             break;
 
         case CMD_PROGRAM:
             dev->array[addr] = val;
+            nvr_image_dirty(dev->image);
             break;
 
         default:
@@ -178,6 +183,14 @@ catalyst_flash_add_mappings(flash_t *dev)
                     dev->array, MEM_MAPPING_EXTERNAL | MEM_MAPPING_ROM | MEM_MAPPING_ROMCS, (void *) dev);
 }
 
+static void
+catalyst_flash_write_image(void *priv, FILE *fp)
+{
+    const flash_t *dev = (flash_t *) priv;
+
+    fwrite(dev->array, 0x20000, 1, fp);
+}
+
 static void
 catalyst_flash_reset(void *priv)
 {
@@ -206,11 +219,14 @@ catalyst_flash_init(UNUSED(const device_t *info))
 
     dev->command = CMD_RESET;
 
+    dev->image = nvr_image_add(flash_path, catalyst_flash_write_image, dev);
+
     fp = nvr_fopen(flash_path, "rb");
     if (fp) {
         (void) !fread(dev->array, 0x20000, 1, fp);
         fclose(fp);
-    }
+    } else
+        nvr_image_dirty(dev->image);
 
     return dev;
 }
@@ -218,12 +234,10 @@ catalyst_flash_init(UNUSED(const device_t *info))
 static void
 catalyst_flash_close(void *priv)
 {
-    FILE    *fp;
     flash_t *dev = (flash_t *) priv;
 
-    fp = nvr_fopen(flash_path, "wb");
-    fwrite(dev->array, 0x20000, 1, fp);
-    fclose(fp);
+    /* Saves the image if it was changed. */
+    nvr_image_remove(dev->image);
 
     free(dev->array);
     dev->array = NULL;
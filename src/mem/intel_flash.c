@@ -74,6 +74,8 @@ typedef struct flash_t {
 
     mem_mapping_t mapping[4];
     mem_mapping_t mapping_h[16];
+
+    nvr_image_t *image;
 } flash_t;
 
 static char flash_path[1024];
@@ -183,6 +185,7 @@ flash_write(uint32_t addr, uint8_t val, void *priv)
                     if ((i == dev->program_addr) && (addr >= dev->block_start[i]) && (addr <= dev->block_end[i]))
                         memset(&(dev->array[dev->block_start[i]]), 0xff, dev->block_len[i]);
                 }
+                nvr_image_dirty(dev->image);
 
                 dev->status = 0x80;
             }
@@ -191,8 +194,10 @@ flash_write(uint32_t addr, uint8_t val, void *priv)
 
         case CMD_PROGRAM_SETUP:
         case CMD_PROGRAM_SETUP_ALT:
-            if (((addr & bb_mask) != (dev->block_start[6] & bb_mask)) && (addr == dev->program_addr))
+            if (((addr & bb_mask) != (dev->block_start[6] & bb_mask)) && (addr == dev->program_addr)) {
                 dev->array[addr] = val;
+                nvr_image_dirty(dev->image);
+            }
             dev->command = CMD_READ_STATUS;
             dev->status  = 0x80;
             break;
@@ -242,6 +247,7 @@ flash_writew(uint32_t addr, uint16_t val, void *priv)
                         if ((i == dev->program_addr) && (addr >= dev->block_start[i]) && (addr <= dev->block_end[i]))
                             memset(&(dev->array[dev->block_start[i]]), 0xff, dev->block_len[i]);
                     }
+                    nvr_image_dirty(dev->image);
 
                     dev->status = 0x80;
                 }
@@ -250,8 +256,10 @@ flash_writew(uint32_t addr, uint16_t val, void *priv)
 
             case CMD_PROGRAM_SETUP:
             case CMD_PROGRAM_SETUP_ALT:
-                if (((addr & bb_mask) != (dev->block_start[6] & bb_mask)) && (addr == dev->program_addr))
+                if (((addr & bb_mask) != (dev->block_start[6] & bb_mask)) && (addr == dev->program_addr)) {
                     *(uint16_t *) (&dev->array[addr]) = val;
+                    nvr_image_dirty(dev->image);
+                }
                 dev->command = CMD_READ_STATUS;
                 dev->status  = 0x80;
                 break;
@@ -335,6 +343,23 @@ intel_flash_add_mappings(flash_t *dev)
     }
 }
 
+static void
+intel_flash_write_image(void *priv, FILE *fp)
+{
+    const flash_t *dev = (flash_t *) priv;
+
+    fwrite(&(dev->array[dev->block_start[BLOCK_MAIN1]]), dev->block_len[BLOCK_MAIN1], 1, fp);
+    if (dev->block_len[BLOCK_MAIN2])
+        fwrite(&(dev->array[dev->block_start[BLOCK_MAIN2]]), dev->block_len[BLOCK_MAIN2], 1, fp);
+    if (dev->block_len[BLOCK_MAIN3])
+        fwrite(&(dev->array[dev->block_start[BLOCK_MAIN3]]), dev->block_len[BLOCK_MAIN3], 1, fp);
+    if (dev->block_len[BLOCK_MAIN4])
+        fwrite(&(dev->array[dev->block_start[BLOCK_MAIN4]]), dev->block_len[BLOCK_MAIN4], 1, fp);
+
+    fwrite(&(dev->array[dev->block_start[BLOCK_DATA1]]), dev->block_len[BLOCK_DATA1], 1, fp);
+    fwrite(&(dev->array[dev->block_start[BLOCK_DATA2]]), dev->block_len[BLOCK_DATA2], 1, fp);
+}
+
 static void
 intel_flash_reset(void *priv)
 {
@@ -511,6 +536,8 @@ intel_flash_init(const device_t *info)
     dev->command = CMD_READ_ARRAY;
     dev->status  = 0;
 
+    dev->image = nvr_image_add(flash_path, intel_flash_write_image, dev);
+
     fp = nvr_fopen(flash_path, "rb");
     if (fp) {
         (void) !fread(&(dev->array[dev->block_start[BLOCK_MAIN1]]), dev->block_len[BLOCK_MAIN1], 1, fp);
@@ -524,7 +551,8 @@ intel_flash_init(const device_t *info)
         (void) !fread(&(dev->array[dev->block_start[BLOCK_DATA1]]), dev->block_len[BLOCK_DATA1], 1, fp);
         (void) !fread(&(dev->array[dev->block_start[BLOCK_DATA2]]), dev->block_len[BLOCK_DATA2], 1, fp);
         fclose(fp);
-    }
+    } else
+        nvr_image_dirty(dev->image);
 
     return dev;
 }
@@ -532,21 +560,10 @@ intel_flash_init(const device_t *info)
 static void
 intel_flash_close(void *priv)
 {
-    FILE    *fp;
     flash_t *dev = (flash_t *) priv;
 
-    fp = nvr_fopen(flash_path, "wb");
-    fwrite(&(dev->array[dev->block_start[BLOCK_MAIN1]]), dev->block_len[BLOCK_MAIN1], 1, fp);
-    if (dev->block_len[BLOCK_MAIN2])
-        fwrite(&(dev->array[dev->block_start[BLOCK_MAIN2]]), dev->block_len[BLOCK_MAIN2], 1, fp);
-    if (dev->block_len[BLOCK_MAIN3])
-        fwrite(&(dev->array[dev->block_start[BLOCK_MAIN3]]), dev->block_len[BLOCK_MAIN3], 1, fp);
-    if (dev->block_len[BLOCK_MAIN4])
-        fwrite(&(dev->array[dev->block_start[BLOCK_MAIN4]]), dev->block_len[BLOCK_MAIN4], 1, fp);
-
-    fwrite(&(dev->array[dev->block_start[BLOCK_DATA1]]), dev->block_len[BLOCK_DATA1], 1, fp);
-    fwrite(&(dev->array[dev->block_start[BLOCK_DATA2]]), dev->block_len[BLOCK_DATA2], 1, fp);
-    fclose(fp);
+    /* Saves the image if it was changed. */
+    nvr_image_remove(dev->image);
 
     free(dev->array);
     dev->array = NULL;
@@ -38,6 +38,7 @@
 #include <86box/plat.h>
 #include <86box/rom.h>
 #include <86box/gdbstub.h>
+#include <86box/kvm.h>
 #ifdef USE_DYNAREC
 #    include "codegen_public.h"
 #else
@@ -110,6 +111,43 @@ int mem_a20_state = 0;
 int mmuflush = 0;
 int mmu_perm = 4;
 
+mmu_tlb_stats_t mmu_tlb_stats;
+
+struct mem_dirty_t {
+    uint32_t           *bits;
+    struct mem_dirty_t *next;
+};
+
+#define MEM_RECALC_SNAPSHOT 256 /* granules compared by mem_mapping_recalc() */
+#define MEM_SMM_VIEWS       4   /* SMRAM ranges whose SMM and non-SMM lookups are kept */
+
+/*
+ * The CPU and bus lookups of an SMRAM range, as resolved in and out of SMM.
+ * A view is valid as long as nothing was recalculated since it was taken,
+ * so SMI and RSM only have to copy the precomputed one back in place.
+ */
+typedef struct mem_smm_view_t {
+    uint64_t        base;
+    uint64_t        size;
+    uint32_t        nr;
+    uint32_t        gen[2]; /* mem_map_gen the view was taken at, 0 = none */
+    uint8_t       **exec[2];
+    mem_mapping_t **maps[2]; /* write, read, write bus, read bus */
+} mem_smm_view_t;
+
+mem_recalc_stats_t mem_recalc_stats;
+
+static uint32_t       mem_map_gen = 1;
+static int            mem_recalc_aliased;
+static mem_smm_view_t mem_smm_views[MEM_SMM_VIEWS];
+
+static uint32_t mem_recalc_second = 0;
+static uint64_t mem_recalc_acc    = 0;
+
+static mem_dirty_t *mem_dirty_list  = NULL;
+static uint32_t    *mem_dirty_bits  = NULL; /* pages written since the last sync, NULL if untracked */
+static uint32_t     mem_dirty_pages = 0;
+
 #ifdef USE_NEW_DYNAREC
 uint64_t *byte_dirty_mask;
 uint64_t *byte_code_present_mask;
@@ -125,8 +163,14 @@ mem_mapping_t        *write_mapping[MEM_MAPPINGS_NO];
 
 uint8_t              *_mem_exec[MEM_MAPPINGS_NO];
 
+uint8_t              *mem_fast_read[MEM_FAST_BLOCKS];
+uint8_t              *mem_fast_write[MEM_FAST_BLOCKS];
+
 /* FIXME: re-do this with a 'mem_ops' struct. */
 static uint8_t       *page_lookupp; /* pagetable mmu_perm lookup */
+static uint8_t        readlookupg[256]; /* lookup entry maps a global page */
+static uint8_t        writelookupg[256];
+static uint8_t        mmu_global; /* last translation was for a global page */
 static uint8_t       *readlookupp;
 static uint8_t       *writelookupp;
 static mem_mapping_t *base_mapping;
@@ -139,7 +183,7 @@ static uint8_t        ff_pccache[4] = { 0xff, 0xff, 0xff, 0xff };
 static mem_state_t    _mem_state[MEM_MAPPINGS_NO];
 static uint32_t       remap_start_addr;
 static uint32_t       remap_start_addr2;
-#if (!(defined __amd64__ || defined _M_X64 || defined __aarch64__ || defined _M_ARM64))
+#if (!(defined __amd64__ || defined _M_X64 || defined __aarch64__ || defined _M_ARM64 || (defined __riscv && __riscv_xlen == 64)))
 static size_t ram_size = 0;
 static size_t ram2_size = 0;
 #else
@@ -198,9 +242,125 @@ resetreadlookup(void)
     high_page  = 0;
 }
 
+/*
+ * Dirty page tracking for consumers registered with mem_dirty_register().
+ * While nothing is registered, mem_dirty_bits is NULL and the write paths
+ * only test that pointer. Once tracking is on, a page that is still clean
+ * never gets a direct writelookup2 mapping, so its first write goes through
+ * mem_write_ram*_page() and marks it. After that the page may be mapped
+ * directly again until the next sync clears its bit and flushes the
+ * lookups.
+ */
+static __inline void
+mem_dirty_mark(uint32_t addr)
+{
+    if (mem_dirty_bits && ((addr >> 12) < mem_dirty_pages))
+        mem_dirty_bits[addr >> 17] |= (1U << ((addr >> 12) & 31));
+}
+
+static __inline int
+mem_dirty_clean(uint32_t addr)
+{
+    if (!mem_dirty_bits || ((addr >> 12) >= mem_dirty_pages))
+        return 0;
+
+    return !(mem_dirty_bits[addr >> 17] & (1U << ((addr >> 12) & 31)));
+}
+
+/* Points the fast tables at RAM wherever the range is plain RAM to the CPU. */
+static void
+mem_fast_update(uint64_t base, uint64_t size)
+{
+    const mem_mapping_t *map;
+    uint64_t             end = base + size;
+
+    if (end > MEM_FAST_SIZE)
+        end = MEM_FAST_SIZE;
+
+    for (uint64_t c = base & MEM_GRANULARITY_BASE; c < end; c += MEM_GRANULARITY_SIZE) {
+        map = read_mapping[c >> MEM_GRANULARITY_BITS];
+        if (map && (map->read_b == mem_read_ram) && (map->read_w == mem_read_ramw))
+            mem_fast_read[c >> MEM_GRANULARITY_BITS] = &ram[c];
+        else
+            mem_fast_read[c >> MEM_GRANULARITY_BITS] = NULL;
+
+        map = write_mapping[c >> MEM_GRANULARITY_BITS];
+        if (map && (map->write_b == mem_write_ram) && (map->write_w == mem_write_ramw) && !mem_dirty_clean((uint32_t) c))
+            mem_fast_write[c >> MEM_GRANULARITY_BITS] = &ram[c];
+        else
+            mem_fast_write[c >> MEM_GRANULARITY_BITS] = NULL;
+    }
+}
+
+/*
+ * Paging-structure cache. The page directory entries of the latest walks,
+ * and in PAE mode the page directory pointers, are kept by the upper bits
+ * of the linear address, so a TLB miss mostly only has to read the page
+ * table entry. Like the equivalent caches of the real processors, it stays
+ * valid until a CR3 load, an INVLPG or any other MMU flush, which are what
+ * a guest has to do after changing a present entry anyway. Only directory
+ * entries that already have their accessed bit set are kept, so there is
+ * no update of them left to do on a hit.
+ */
+#define MMU_PWC_SIZE 64
+
+typedef struct mmu_pwc_t {
+    uint32_t cr3;
+    uint32_t cr4;
+    uint8_t  pdpte_valid; /* one bit per PAE page directory pointer */
+    uint64_t pdpte[4];
+    uint32_t tag[MMU_PWC_SIZE]; /* upper linear address bits + 1, 0 = empty */
+    uint64_t pde[MMU_PWC_SIZE];
+} mmu_pwc_t;
+
+static mmu_pwc_t mmu_pwc;
+
+static void
+mmu_pwc_flush(void)
+{
+    mmu_pwc.pdpte_valid = 0;
+    memset(mmu_pwc.tag, 0x00, sizeof(mmu_pwc.tag));
+}
+
+/* Drop everything if the walk would start from a different CR3 or mode. */
+static __inline void
+mmu_pwc_check(void)
+{
+    if ((mmu_pwc.cr3 != cr3) || (mmu_pwc.cr4 != (cr4 & (CR4_PSE | CR4_PAE)))) {
+        mmu_pwc_flush();
+        mmu_pwc.cr3 = cr3;
+        mmu_pwc.cr4 = cr4 & (CR4_PSE | CR4_PAE);
+    }
+}
+
+static __inline int
+mmu_pwc_lookup(uint32_t key, uint64_t *entry)
+{
+    const uint32_t i = key & (MMU_PWC_SIZE - 1);
+
+    if (mmu_pwc.tag[i] != (key + 1))
+        return 0;
+
+    *entry = mmu_pwc.pde[i];
+    mmu_tlb_stats.walk_cache_hits++;
+
+    return 1;
+}
+
+static __inline void
+mmu_pwc_insert(uint32_t key, uint64_t entry)
+{
+    const uint32_t i = key & (MMU_PWC_SIZE - 1);
+
+    mmu_pwc.tag[i] = key + 1;
+    mmu_pwc.pde[i] = entry;
+}
+
 void
 flushmmucache(void)
 {
+    mmu_pwc_flush();
+
     for (uint16_t c = 0; c < 256; c++) {
         if (readlookup[c] != (int) 0xffffffff) {
             readlookup2[readlookup[c]] = LOOKUP_INV;
@@ -216,6 +376,60 @@ flushmmucache(void)
         }
     }
     mmuflush++;
+    mmu_tlb_stats.flushes++;
+
+    x86seg_desc_cache_flush();
+
+    pccache  = (uint32_t) 0xffffffff;
+    pccache2 = (uint8_t *) 0xffffffff;
+
+#ifdef USE_DYNAREC
+    codegen_flush();
+#endif
+
+#ifdef USE_KVM
+    kvm_mem_changed();
+#endif
+}
+
+/* Flush for a CR3 load. With CR4.PGE set, entries for global pages survive,
+   everything else goes exactly like flushmmucache(). */
+void
+flushmmucache_cr3(void)
+{
+    if (!(cr4 & CR4_PGE)) {
+        flushmmucache();
+        return;
+    }
+
+    mmu_pwc_flush();
+
+    for (uint16_t c = 0; c < 256; c++) {
+        if (readlookup[c] != (int) 0xffffffff) {
+            if (readlookupg[c])
+                mmu_tlb_stats.global_kept++;
+            else {
+                readlookup2[readlookup[c]] = LOOKUP_INV;
+                readlookupp[readlookup[c]] = 4;
+                readlookup[c]              = 0xffffffff;
+            }
+        }
+        if (writelookup[c] != (int) 0xffffffff) {
+            if (writelookupg[c])
+                mmu_tlb_stats.global_kept++;
+            else {
+                page_lookup[writelookup[c]]  = NULL;
+                page_lookupp[writelookup[c]] = 4;
+                writelookup2[writelookup[c]] = LOOKUP_INV;
+                writelookupp[writelookup[c]] = 4;
+                writelookup[c]               = 0xffffffff;
+            }
+        }
+    }
+    mmuflush++;
+    mmu_tlb_stats.partial_flushes++;
+
+    x86seg_desc_cache_flush();
 
     pccache  = (uint32_t) 0xffffffff;
     pccache2 = (uint8_t *) 0xffffffff;
@@ -241,6 +455,8 @@ flushmmucache_pc(void)
 void
 flushmmucache_nopc(void)
 {
+    mmu_pwc_flush();
+
     for (uint16_t c = 0; c < 256; c++) {
         if (readlookup[c] != (int) 0xffffffff) {
             readlookup2[readlookup[c]] = LOOKUP_INV;
@@ -255,19 +471,29 @@ flushmmucache_nopc(void)
             writelookup[c]               = 0xffffffff;
         }
     }
+
+    x86seg_desc_cache_flush();
+
+    /* INVLPG and mapping changes land here, and the new dynarec's block
+       chains only stay valid for as long as the translations do. */
+    mmuflush++;
+
+#ifdef USE_KVM
+    kvm_mem_changed();
+#endif
 }
 
 void
 mem_flush_write_page(uint32_t addr, uint32_t virt)
 {
     const page_t *page_target = &pages[addr >> 12];
-#if (!(defined __amd64__ || defined _M_X64 || defined __aarch64__ || defined _M_ARM64))
+#if (!(defined __amd64__ || defined _M_X64 || defined __aarch64__ || defined _M_ARM64 || (defined __riscv && __riscv_xlen == 64)))
     uint32_t a;
 #endif
 
     for (uint16_t c = 0; c < 256; c++) {
         if (writelookup[c] != (int) 0xffffffff) {
-#if (defined __amd64__ || defined _M_X64 || defined __aarch64__ || defined _M_ARM64)
+#if (defined __amd64__ || defined _M_X64 || defined __aarch64__ || defined _M_ARM64 || (defined __riscv && __riscv_xlen == 64))
             uintptr_t target = (uintptr_t) &ram[(uintptr_t) (addr & ~0xfff) - (virt & ~0xfff)];
 #else
             a = (uintptr_t) (addr & ~0xfff) - (virt & ~0xfff);
@@ -300,12 +526,17 @@ mmutranslatereal_normal(uint32_t addr, int rw)
     uint32_t temp2;
     uint32_t temp3;
     uint32_t addr2;
+    uint64_t cached;
+    int      hit;
 
     if (cpu_state.abrt)
         return 0xffffffffffffffffULL;
 
+    mmu_pwc_check();
+
     addr2 = ((cr3 & ~0xfff) + ((addr >> 20) & 0xffc));
-    temp = temp2 = rammap(addr2);
+    hit   = mmu_pwc_lookup(addr >> 22, &cached);
+    temp = temp2 = hit ? (uint32_t) cached : rammap(addr2);
     if (!(temp & 1)) {
         cr2 = addr;
         temp &= 1;
@@ -333,7 +564,8 @@ mmutranslatereal_normal(uint32_t addr, int rw)
             return 0xffffffffffffffffULL;
         }
 
-        mmu_perm = temp & 4;
+        mmu_perm   = temp & 4;
+        mmu_global = (cr4 & CR4_PGE) ? ((temp >> 8) & 1) : 0;
         rammap(addr2) |= (rw ? 0x60 : 0x20);
 
         uint64_t page = temp & ~0x3fffff;
@@ -356,8 +588,12 @@ mmutranslatereal_normal(uint32_t addr, int rw)
         return 0xffffffffffffffffULL;
     }
 
-    mmu_perm = temp & 4;
-    rammap(addr2) |= 0x20;
+    mmu_perm   = temp & 4;
+    mmu_global = (cr4 & CR4_PGE) ? ((temp >> 8) & 1) : 0;
+    if (!hit) {
+        rammap(addr2) |= 0x20;
+        mmu_pwc_insert(addr >> 22, temp2 | 0x20);
+    }
     rammap((temp2 & ~0xfff) + ((addr >> 10) & 0xffc)) |= (rw ? 0x60 : 0x20);
 
     return (uint64_t) ((temp & ~0xfff) + (addr & 0xfff));
@@ -373,12 +609,23 @@ mmutranslatereal_pae(uint32_t addr, int rw)
     uint64_t addr2;
     uint64_t addr3;
     uint64_t addr4;
+    int      hit;
 
     if (cpu_state.abrt)
         return 0xffffffffffffffffULL;
 
-    addr2 = (cr3 & ~0x1f) + ((addr >> 27) & 0x18);
-    temp = temp2 = rammap64(addr2) & 0x000000ffffffffffULL;
+    mmu_pwc_check();
+
+    if (mmu_pwc.pdpte_valid & (1 << (addr >> 30)))
+        temp = temp2 = mmu_pwc.pdpte[addr >> 30];
+    else {
+        addr2 = (cr3 & ~0x1f) + ((addr >> 27) & 0x18);
+        temp = temp2 = rammap64(addr2) & 0x000000ffffffffffULL;
+        if (temp & 1) {
+            mmu_pwc.pdpte[addr >> 30] = temp;
+            mmu_pwc.pdpte_valid |= (1 << (addr >> 30));
+        }
+    }
     if (!(temp & 1)) {
         cr2 = addr;
         temp &= 1;
@@ -392,8 +639,11 @@ mmutranslatereal_pae(uint32_t addr, int rw)
     }
 
     addr3 = (temp & ~0xfffULL) + ((addr >> 18) & 0xff8);
-    temp = temp4 = rammap64(addr3) & 0x000000ffffffffffULL;
-    temp3        = temp & temp2;
+    hit   = mmu_pwc_lookup(addr >> 21, &temp);
+    if (!hit)
+        temp = rammap64(addr3) & 0x000000ffffffffffULL;
+    temp4 = temp;
+    temp3 = temp & temp2;
     if (!(temp & 1)) {
         cr2 = addr;
         temp &= 1;
@@ -420,7 +670,8 @@ mmutranslatereal_pae(uint32_t addr, int rw)
 
             return 0xffffffffffffffffULL;
         }
-        mmu_perm = temp & 4;
+        mmu_perm   = temp & 4;
+        mmu_global = (cr4 & CR4_PGE) ? ((temp >> 8) & 1) : 0;
         rammap64(addr3) |= (rw ? 0x60 : 0x20);
 
         return ((temp & ~0x1fffffULL) + (addr & 0x1fffffULL)) & 0x000000ffffffffffULL;
@@ -441,8 +692,12 @@ mmutranslatereal_pae(uint32_t addr, int rw)
         return 0xffffffffffffffffULL;
     }
 
-    mmu_perm = temp & 4;
-    rammap64(addr3) |= 0x20;
+    mmu_perm   = temp & 4;
+    mmu_global = (cr4 & CR4_PGE) ? ((temp >> 8) & 1) : 0;
+    if (!hit) {
+        rammap64(addr3) |= 0x20;
+        mmu_pwc_insert(addr >> 21, temp4 | 0x20);
+    }
     rammap64(addr4) |= (rw ? 0x60 : 0x20);
 
     return ((temp & ~0xfffULL) + ((uint64_t) (addr & 0xfff))) & 0x000000ffffffffffULL;
@@ -497,6 +752,7 @@ mmutranslate_noabrt_normal(uint32_t addr, int rw)
         uint64_t page = temp & ~0x3fffff;
         if (cpu_features & CPU_FEATURE_PSE36)
             page |= (uint64_t) (temp & 0x1e000) << 19;
+        mmu_global = (cr4 & CR4_PGE) ? ((temp >> 8) & 1) : 0;
         return page + (addr & 0x3fffff);
     }
 
@@ -506,6 +762,7 @@ mmutranslate_noabrt_normal(uint32_t addr, int rw)
     if (!(temp & 1) || ((CPL == 3) && !(temp3 & 4) && !cpl_override) || (rw && !cpl_override && !(temp3 & 2) && ((CPL == 3) || (cr0 & WP_FLAG))))
         return 0xffffffffffffffffULL;
 
+    mmu_global = (cr4 & CR4_PGE) ? ((temp >> 8) & 1) : 0;
     return (uint64_t) ((temp & ~0xfff) + (addr & 0xfff));
 }
 
@@ -541,6 +798,7 @@ mmutranslate_noabrt_pae(uint32_t addr, int rw)
         if (((CPL == 3) && !(temp & 4) && !cpl_override) || (rw && !cpl_override && !(temp & 2) && ((CPL == 3) || (cr0 & WP_FLAG))))
             return 0xffffffffffffffffULL;
 
+        mmu_global = (cr4 & CR4_PGE) ? ((temp >> 8) & 1) : 0;
         return ((temp & ~0x1fffffULL) + (addr & 0x1fffff)) & 0x000000ffffffffffULL;
     }
 
@@ -552,6 +810,7 @@ mmutranslate_noabrt_pae(uint32_t addr, int rw)
     if (!(temp & 1) || ((CPL == 3) && !(temp3 & 4) && !cpl_override) || (rw && !cpl_override && !(temp3 & 2) && ((CPL == 3) || (cr0 & WP_FLAG))))
         return 0xffffffffffffffffULL;
 
+    mmu_global = (cr4 & CR4_PGE) ? ((temp >> 8) & 1) : 0;
     return ((temp & ~0xfffULL) + ((uint64_t) (addr & 0xfff))) & 0x000000ffffffffffULL;
 }
 
@@ -590,15 +849,17 @@ mem_addr_translate(uint32_t addr, uint32_t chunk_start, uint32_t len)
 void
 addreadlookup(uint32_t virt, uint32_t phys)
 {
-#if (!(defined __amd64__ || defined _M_X64 || defined __aarch64__ || defined _M_ARM64))
+#if (!(defined __amd64__ || defined _M_X64 || defined __aarch64__ || defined _M_ARM64 || (defined __riscv && __riscv_xlen == 64)))
     uint32_t a;
 #endif
 
     if (virt == 0xffffffff)
         return;
 
-    if (readlookup2[virt >> 12] != (uintptr_t) LOOKUP_INV)
+    if (readlookup2[virt >> 12] != (uintptr_t) LOOKUP_INV) {
+        mmu_global = 0;
         return;
+    }
 
     if (readlookup[readlnext] != (int) 0xffffffff) {
         if ((readlookup[readlnext] == ((es + DI) >> 12)) || (readlookup[readlnext] == ((es + EDI) >> 12)))
@@ -606,7 +867,7 @@ addreadlookup(uint32_t virt, uint32_t phys)
         readlookup2[readlookup[readlnext]] = LOOKUP_INV;
     }
 
-#if (defined __amd64__ || defined _M_X64 || defined __aarch64__ || defined _M_ARM64)
+#if (defined __amd64__ || defined _M_X64 || defined __aarch64__ || defined _M_ARM64 || (defined __riscv && __riscv_xlen == 64))
     readlookup2[virt >> 12] = (uintptr_t) &ram[(uintptr_t) (phys & ~0xFFF) - (uintptr_t) (virt & ~0xfff)];
 #else
     a = ((uint32_t) (phys & ~0xfff) - (uint32_t) (virt & ~0xfff));
@@ -618,24 +879,219 @@ addreadlookup(uint32_t virt, uint32_t phys)
 #endif
     readlookupp[virt >> 12] = mmu_perm;
 
+    readlookupg[readlnext]  = mmu_global;
     readlookup[readlnext++] = virt >> 12;
     readlnext &= (cachesize - 1);
+    mmu_global = 0;
+    mmu_tlb_stats.read_misses++;
 
     cycles -= 9;
 }
 
+#ifdef USE_NEW_DYNAREC
+/*
+ * Self-modifying code detection through the host MMU.
+ *
+ * With cpu_dynarec_mmu_smc, the host pages holding guest pages that code
+ * has been translated from are made read-only, and those guest pages are
+ * then written like any other, with plain stores through the TLB instead
+ * of through the dirty masks. The first write faults, marks the bytes it
+ * may touch dirty and makes the page writable again, and from then on the
+ * page goes through the dirty masks until code is next translated from it.
+ *
+ * Only the first block of RAM is covered, so on 32-bit hosts RAM above
+ * 1 GB keeps going through the dirty masks.
+ */
+static uint32_t *mem_smc_bits;
+static uint32_t *mem_smc_base; /* Guest address of each protected host page. */
+static int       mem_smc_shift;
+
+/* Returns the host page of the RAM behind a guest page, or -1. */
+static __inline int64_t
+mem_smc_host_page(uint32_t phys)
+{
+    const uint8_t *mem;
+
+    if ((mem_smc_bits == NULL) || ((phys >> 12) >= pages_sz))
+        return -1;
+
+    mem = pages[phys >> 12].mem;
+    if ((mem == NULL) || (mem < ram) || (mem >= (ram + ram_size)))
+        return -1;
+
+    return (mem - ram) >> mem_smc_shift;
+}
+
+static __inline int
+mem_smc_protected(uint32_t phys)
+{
+    int64_t  idx = mem_smc_host_page(phys);
+    uint32_t base;
+
+    if ((idx == -1) || !(mem_smc_bits[idx >> 5] & (1 << (idx & 31))))
+        return 0;
+
+    base = (phys & ~0xfff) - ((pages[phys >> 12].mem - ram) & ((1 << mem_smc_shift) - 1));
+    return mem_smc_base[idx] == base;
+}
+
+/*
+ * Returns 1 if the RAM at p is write protected. Bulk writes through
+ * writelookup2 must not go there: only their first store would fault,
+ * and the rest of the run would bypass the dirty masks.
+ */
+int
+mem_smc_host_protected(const uint8_t *p)
+{
+    size_t idx;
+
+    if ((mem_smc_bits == NULL) || (p < ram) || (p >= (ram + ram_size)))
+        return 0;
+
+    idx = (size_t) (p - ram) >> mem_smc_shift;
+    return !!(mem_smc_bits[idx >> 5] & (1 << (idx & 31)));
+}
+
+void
+mem_smc_protect(uint32_t phys)
+{
+    int64_t idx = mem_smc_host_page(phys);
+
+    if ((idx == -1) || (mem_smc_bits[idx >> 5] & (1 << (idx & 31))))
+        return;
+
+    if (plat_mmap_protect(&ram[(size_t) idx << mem_smc_shift], (size_t) 1 << mem_smc_shift, 0)) {
+        mem_smc_bits[idx >> 5] |= (1 << (idx & 31));
+        mem_smc_base[idx] = (phys & ~0xfff) - ((pages[phys >> 12].mem - ram) & ((1 << mem_smc_shift) - 1));
+    }
+}
+
+static void
+mem_smc_mark_dirty(uint32_t addr)
+{
+    page_t  *page        = &pages[addr >> 12];
+    uint64_t mask        = (uint64_t) 1 << ((addr >> PAGE_MASK_SHIFT) & PAGE_MASK_MASK);
+    int      byte_offset = (addr >> PAGE_BYTE_MASK_SHIFT) & PAGE_BYTE_MASK_OFFSET_MASK;
+    uint64_t byte_mask   = (uint64_t) 1 << (addr & PAGE_BYTE_MASK_MASK);
+
+    mem_dirty_mark(addr);
+    if (page->desc_cached)
+        x86seg_desc_cache_flush();
+    page->dirty_mask |= mask;
+    page->byte_dirty_mask[byte_offset] |= byte_mask;
+    if (!page_in_evict_list(page) && ((page->code_present_mask & mask) || (page->byte_code_present_mask[byte_offset] & byte_mask)))
+        page_add_to_evict_list(page);
+}
+
+/* Drop the TLB entries that write straight to this host memory. */
+static void
+mem_smc_flush_write_lookup(const uint8_t *mem)
+{
+    for (uint16_t c = 0; c < 256; c++) {
+        if (writelookup[c] != (int) 0xffffffff) {
+            uintptr_t virt = (uintptr_t) writelookup[c] << 12;
+
+            if (writelookup2[writelookup[c]] == ((uintptr_t) mem - virt)) {
+                writelookup2[writelookup[c]] = LOOKUP_INV;
+                page_lookup[writelookup[c]]  = NULL;
+                writelookup[c]               = 0xffffffff;
+            }
+        }
+    }
+}
+
+/* Called by the host on a write to a read-only page, possibly from generated
+   code. Guest RAM is only ever written by the emulation thread. */
+static int
+mem_smc_fault(void *addr)
+{
+    uint8_t *p = (uint8_t *) addr;
+    uint8_t *host;
+    size_t   idx;
+    size_t   size;
+    uint32_t phys;
+    uint32_t start;
+    uint32_t end;
+
+    if ((mem_smc_bits == NULL) || (p < ram) || (p >= (ram + ram_size)))
+        return 0;
+
+    idx  = (size_t) (p - ram) >> mem_smc_shift;
+    size = (size_t) 1 << mem_smc_shift;
+    host = &ram[idx << mem_smc_shift];
+    if (!(mem_smc_bits[idx >> 5] & (1 << (idx & 31))) || !plat_mmap_protect(host, size, 1))
+        return 0;
+    mem_smc_bits[idx >> 5] &= ~(1 << (idx & 31));
+
+    /* The write is retried straight to RAM. For one that crosses into this
+       page, the host may give the start of the page as the address. */
+    phys  = mem_smc_base[idx] + (uint32_t) (p - host);
+    start = ((p - host) >= 7) ? (phys - 7) : mem_smc_base[idx];
+    end   = ((size_t) (p - host) < (size - 8)) ? (phys + 8) : (mem_smc_base[idx] + (uint32_t) size);
+    for (uint32_t a = start; a < end; a++) {
+        if ((a >> 12) < pages_sz)
+            mem_smc_mark_dirty(a);
+    }
+
+    for (size_t c = 0; c < size; c += 0x1000)
+        mem_smc_flush_write_lookup(&host[c]);
+
+    return 1;
+}
+
+static void
+mem_smc_unprotect_all(void)
+{
+    if (mem_smc_bits == NULL)
+        return;
+
+    for (size_t idx = 0; idx < ((ram_size + (1 << mem_smc_shift) - 1) >> mem_smc_shift); idx++) {
+        if (mem_smc_bits[idx >> 5] & (1 << (idx & 31))) {
+            plat_mmap_protect(&ram[idx << mem_smc_shift], (size_t) 1 << mem_smc_shift, 1);
+            mem_smc_bits[idx >> 5] &= ~(1 << (idx & 31));
+        }
+    }
+}
+
+/* The RAM has just been allocated again, so nothing is protected. */
+static void
+mem_smc_init(void)
+{
+    size_t host_page = plat_mmap_page_size();
+    size_t host_pages;
+
+    free(mem_smc_bits);
+    free(mem_smc_base);
+    mem_smc_bits = NULL;
+    mem_smc_base = NULL;
+
+    if (!cpu_dynarec_mmu_smc || (host_page < 0x1000) || (host_page > 0x10000) || (host_page & (host_page - 1)))
+        return;
+    if (!plat_mmap_fault_handler(mem_smc_fault))
+        return;
+
+    for (mem_smc_shift = 12; ((size_t) 1 << mem_smc_shift) < host_page; mem_smc_shift++)
+        ;
+    host_pages   = (ram_size + host_page - 1) >> mem_smc_shift;
+    mem_smc_base = calloc(host_pages, sizeof(uint32_t));
+    mem_smc_bits = calloc((host_pages + 31) >> 5, sizeof(uint32_t));
+}
+#endif
+
 void
 addwritelookup(uint32_t virt, uint32_t phys)
 {
-#if (!(defined __amd64__ || defined _M_X64 || defined __aarch64__ || defined _M_ARM64))
+#if (!(defined __amd64__ || defined _M_X64 || defined __aarch64__ || defined _M_ARM64 || (defined __riscv && __riscv_xlen == 64)))
     uint32_t a;
 #endif
 
     if (virt == 0xffffffff)
         return;
 
-    if (page_lookup[virt >> 12])
+    if (page_lookup[virt >> 12]) {
+        mmu_global = 0;
         return;
+    }
 
     if (writelookup[writelnext] != -1) {
         page_lookup[writelookup[writelnext]]  = NULL;
@@ -644,21 +1100,21 @@ addwritelookup(uint32_t virt, uint32_t phys)
 
 #ifdef USE_NEW_DYNAREC
 #    ifdef USE_DYNAREC
-    if (pages[phys >> 12].block || (phys & ~0xfff) == recomp_page) {
+    if ((pages[phys >> 12].block && !mem_smc_protected(phys)) || pages[phys >> 12].desc_cached || mem_dirty_clean(phys) || (phys & ~0xfff) == recomp_page) {
 #    else
-    if (pages[phys >> 12].block) {
+    if (pages[phys >> 12].block || pages[phys >> 12].desc_cached || mem_dirty_clean(phys)) {
 #    endif
 #else
 #    ifdef USE_DYNAREC
-    if (pages[phys >> 12].block[0] || pages[phys >> 12].block[1] || pages[phys >> 12].block[2] || pages[phys >> 12].block[3] || (phys & ~0xfff) == recomp_page) {
+    if (pages[phys >> 12].block[0] || pages[phys >> 12].block[1] || pages[phys >> 12].block[2] || pages[phys >> 12].block[3] || pages[phys >> 12].desc_cached || mem_dirty_clean(phys) || (phys & ~0xfff) == recomp_page) {
 #    else
-    if (pages[phys >> 12].block[0] || pages[phys >> 12].block[1] || pages[phys >> 12].block[2] || pages[phys >> 12].block[3]) {
+    if (pages[phys >> 12].block[0] || pages[phys >> 12].block[1] || pages[phys >> 12].block[2] || pages[phys >> 12].block[3] || pages[phys >> 12].desc_cached || mem_dirty_clean(phys)) {
 #    endif
 #endif
         page_lookup[virt >> 12]  = &pages[phys >> 12];
         page_lookupp[virt >> 12] = mmu_perm;
     } else {
-#if (defined __amd64__ || defined _M_X64 || defined __aarch64__ || defined _M_ARM64)
+#if (defined __amd64__ || defined _M_X64 || defined __aarch64__ || defined _M_ARM64 || (defined __riscv && __riscv_xlen == 64))
         writelookup2[virt >> 12] = (uintptr_t) &ram[(uintptr_t) (phys & ~0xFFF) - (uintptr_t) (virt & ~0xfff)];
 #else
         a = ((uint32_t) (phys & ~0xfff) - (uint32_t) (virt & ~0xfff));
@@ -671,8 +1127,11 @@ addwritelookup(uint32_t virt, uint32_t phys)
     }
     writelookupp[virt >> 12] = mmu_perm;
 
+    writelookupg[writelnext]  = mmu_global;
     writelookup[writelnext++] = virt >> 12;
     writelnext &= (cachesize - 1);
+    mmu_global = 0;
+    mmu_tlb_stats.write_misses++;
 
     cycles -= 9;
 }
@@ -681,7 +1140,7 @@ uint8_t *
 getpccache(uint32_t a)
 {
     uint64_t a64 = (uint64_t) a;
-#if (defined __amd64__ || defined _M_X64 || defined __aarch64__ || defined _M_ARM64)
+#if (defined __amd64__ || defined _M_X64 || defined __aarch64__ || defined _M_ARM64 || (defined __riscv && __riscv_xlen == 64))
     uint8_t *p;
 #endif
     uint32_t a2;
@@ -704,7 +1163,7 @@ getpccache(uint32_t a)
                 cpu_prefetch_cycles = cpu_mem_prefetch_cycles;
         }
 
-#if (defined __amd64__ || defined _M_X64 || defined __aarch64__ || defined _M_ARM64)
+#if (defined __amd64__ || defined _M_X64 || defined __aarch64__ || defined _M_ARM64 || (defined __riscv && __riscv_xlen == 64))
         p = &_mem_exec[a64 >> MEM_GRANULARITY_BITS][(uintptr_t) (a64 & MEM_GRANULARITY_PAGE) - (uintptr_t) (a2 & ~0xfff)];
         return (uint8_t *) (((uintptr_t) p & 0x00000000ffffffffULL) | ((uintptr_t) &_mem_exec[a64 >> MEM_GRANULARITY_BITS][0] & 0xffffffff00000000ULL));
 #else
@@ -775,6 +1234,10 @@ write_mem_b(uint32_t addr, uint8_t val)
     if (map && map->write_b)
         map->write_b(addr, val, map->priv);
 
+    /* The page may be dirty now, and so writable directly. */
+    if (mem_dirty_bits && (addr < MEM_FAST_SIZE) && !mem_fast_write[addr >> MEM_GRANULARITY_BITS])
+        mem_fast_update(addr, 1);
+
     resub_cycles(old_cycles);
 }
 
@@ -800,6 +1263,9 @@ write_mem_w(uint32_t addr, uint16_t val)
                 map->write_b(addr + 1, val >> 8, map->priv);
             }
         }
+
+        if (mem_dirty_bits && (addr < MEM_FAST_SIZE) && !mem_fast_write[addr >> MEM_GRANULARITY_BITS])
+            mem_fast_update(addr, 1);
     }
 
     resub_cycles(old_cycles);
@@ -1765,9 +2231,10 @@ mem_writeb_phys(uint32_t addr, uint8_t val)
     mem_logical_addr = 0xffffffff;
 
     if (map) {
-        if (cpu_use_exec && map->exec)
+        if (cpu_use_exec && map->exec) {
             map->exec[(addr - map->base) & map->mask] = val;
-        else if (map->write_b)
+            mem_dirty_mark(addr);
+        } else if (map->write_b)
             map->write_b(addr, val, map->priv);
     }
 }
@@ -1783,6 +2250,7 @@ mem_writew_phys(uint32_t addr, uint16_t val)
     if (cpu_use_exec && ((addr & MEM_GRANULARITY_MASK) <= MEM_GRANULARITY_HBOUND) && (map && map->exec)) {
         p  = (uint16_t *) &(map->exec[(addr - map->base) & map->mask]);
         *p = val;
+        mem_dirty_mark(addr);
     } else if (((addr & MEM_GRANULARITY_MASK) <= MEM_GRANULARITY_HBOUND) && (map && map->write_w))
         map->write_w(addr, val, map->priv);
     else {
@@ -1802,6 +2270,7 @@ mem_writel_phys(uint32_t addr, uint32_t val)
     if (cpu_use_exec && ((addr & MEM_GRANULARITY_MASK) <= MEM_GRANULARITY_QBOUND) && (map && map->exec)) {
         p  = (uint32_t *) &(map->exec[(addr - map->base) & map->mask]);
         *p = val;
+        mem_dirty_mark(addr);
     } else if (((addr & MEM_GRANULARITY_MASK) <= MEM_GRANULARITY_QBOUND) && (map && map->write_l))
         map->write_l(addr, val, map->priv);
     else {
@@ -1829,6 +2298,89 @@ mem_write_phys(void *src, uint32_t addr, int transfer_size)
     }
 }
 
+static __inline uint8_t *
+mem_span_host(uint32_t addr, int write)
+{
+    mem_mapping_t *map = write ? write_mapping_bus[addr >> MEM_GRANULARITY_BITS] :
+                                 read_mapping_bus[addr >> MEM_GRANULARITY_BITS];
+
+    if (!cpu_use_exec || (map == NULL) || (map->exec == NULL))
+        return NULL;
+
+    return &(map->exec[(addr - map->base) & map->mask]);
+}
+
+/*
+ * Return a host pointer for a bus master access at physical address addr,
+ * covering the same memory mem_read_phys()/mem_write_phys() would access
+ * directly. *span is set to how many of the len bytes are contiguous in
+ * host memory. If addr is not directly backed, NULL is returned and *span
+ * is the number of bytes up to the next granule, which have to go through
+ * the per-unit path. After writing through the pointer, the caller must
+ * call mem_span_written() for the range.
+ */
+uint8_t *
+mem_span_map(uint32_t addr, uint32_t len, uint32_t *span, int write)
+{
+    uint8_t *p = mem_span_host(addr, write);
+    uint32_t n = MEM_GRANULARITY_SIZE - (addr & MEM_GRANULARITY_MASK);
+
+    if (p != NULL) {
+        while ((n < len) && (mem_span_host(addr + n, write) == (p + n)))
+            n += MEM_GRANULARITY_SIZE;
+    }
+
+    *span = (n < len) ? n : len;
+
+    return p;
+}
+
+/*
+ * Gives a whole page of RAM the guest is about to zero back to the host,
+ * which then has it read as zeroes until it is written again. Returns 1
+ * if it did, and the page needs no clearing. Guests clear pages as they
+ * free them as often as they do before they use them, and a page that
+ * stays free costs the host nothing this way.
+ */
+int
+mem_zero_page(uint8_t *p)
+{
+    /* The host discards whole pages of its own, which on a host with pages
+       larger than 4K would take the guest pages next to this one along. */
+    if (!mem_zero_release || ((uintptr_t) p & 0xfff) || (plat_mmap_page_size() != 0x1000))
+        return 0;
+#ifdef USE_NEW_DYNAREC
+    /* Discarding a read-only page raises no fault, so code translated from
+       it would never be invalidated. */
+    if (mem_smc_host_protected(p))
+        return 0;
+#endif
+
+    if ((p >= ram) && ((p + 0x1000) <= (ram + ram_size)))
+        return plat_mmap_discard(p, 0x1000);
+#if (!(defined __amd64__ || defined _M_X64 || defined __aarch64__ || defined _M_ARM64 || (defined __riscv && __riscv_xlen == 64)))
+    if ((ram2 != NULL) && (p >= ram2) && ((p + 0x1000) <= (ram2 + ram2_size)))
+        return plat_mmap_discard(p, 0x1000);
+#endif
+
+    return 0;
+}
+
+void
+mem_span_written(uint32_t addr, uint32_t len)
+{
+    uint32_t end = addr + len - 1;
+
+    if (!len)
+        return;
+
+    for (uint32_t c = (addr >> 12); c <= (end >> 12); c++) {
+        mem_dirty_mark(c << 12);
+        if ((c < pages_sz) && pages[c].desc_cached)
+            x86seg_desc_cache_flush();
+    }
+}
+
 uint8_t
 mem_read_ram(uint32_t addr, UNUSED(void *priv))
 {
@@ -1958,6 +2510,9 @@ mem_write_ramb_page(uint32_t addr, uint8_t val, page_t *page)
         uint64_t byte_mask   = (uint64_t) 1 << (addr & PAGE_BYTE_MASK_MASK);
 
         page->mem[addr & 0xfff] = val;
+        mem_dirty_mark(addr);
+        if (page->desc_cached)
+            x86seg_desc_cache_flush();
         page->dirty_mask |= mask;
         if ((page->code_present_mask & mask) && !page_in_evict_list(page))
             page_add_to_evict_list(page);
@@ -1985,6 +2540,9 @@ mem_write_ramw_page(uint32_t addr, uint16_t val, page_t *page)
         if ((addr & 0xf) == 0xf)
             mask |= (mask << 1);
         *(uint16_t *) &page->mem[addr & 0xfff] = val;
+        mem_dirty_mark(addr);
+        if (page->desc_cached)
+            x86seg_desc_cache_flush();
         page->dirty_mask |= mask;
         if ((page->code_present_mask & mask) && !page_in_evict_list(page))
             page_add_to_evict_list(page);
@@ -2020,6 +2578,9 @@ mem_write_raml_page(uint32_t addr, uint32_t val, page_t *page)
         if ((addr & 0xf) >= 0xd)
             mask |= (mask << 1);
         *(uint32_t *) &page->mem[addr & 0xfff] = val;
+        mem_dirty_mark(addr);
+        if (page->desc_cached)
+            x86seg_desc_cache_flush();
         page->dirty_mask |= mask;
         page->byte_dirty_mask[byte_offset] |= byte_mask;
         if (!page_in_evict_list(page) && ((page->code_present_mask & mask) || (page->byte_code_present_mask[byte_offset] & byte_mask)))
@@ -2048,6 +2609,9 @@ mem_write_ramb_page(uint32_t addr, uint8_t val, page_t *page)
         uint64_t mask = (uint64_t) 1 << ((addr >> PAGE_MASK_SHIFT) & PAGE_MASK_MASK);
         page->dirty_mask[(addr >> PAGE_MASK_INDEX_SHIFT) & PAGE_MASK_INDEX_MASK] |= mask;
         page->mem[addr & 0xfff] = val;
+        mem_dirty_mark(addr);
+        if (page->desc_cached)
+            x86seg_desc_cache_flush();
     }
 }
 
@@ -2067,6 +2631,9 @@ mem_write_ramw_page(uint32_t addr, uint16_t val, page_t *page)
             mask |= (mask << 1);
         page->dirty_mask[(addr >> PAGE_MASK_INDEX_SHIFT) & PAGE_MASK_INDEX_MASK] |= mask;
         *(uint16_t *) &page->mem[addr & 0xfff] = val;
+        mem_dirty_mark(addr);
+        if (page->desc_cached)
+            x86seg_desc_cache_flush();
     }
 }
 
@@ -2086,6 +2653,9 @@ mem_write_raml_page(uint32_t addr, uint32_t val, page_t *page)
             mask |= (mask << 1);
         page->dirty_mask[(addr >> PAGE_MASK_INDEX_SHIFT) & PAGE_MASK_INDEX_MASK] |= mask;
         *(uint32_t *) &page->mem[addr & 0xfff] = val;
+        mem_dirty_mark(addr);
+        if (page->desc_cached)
+            x86seg_desc_cache_flush();
     }
 }
 #endif
@@ -2100,8 +2670,10 @@ mem_write_ram(uint32_t addr, uint8_t val, UNUSED(void *priv))
     if (cpu_use_exec) {
         addwritelookup(mem_logical_addr, addr);
         mem_write_ramb_page(addr, val, &pages[addr >> 12]);
-    } else
+    } else {
         ram[addr] = val;
+        mem_dirty_mark(addr);
+    }
 }
 
 void
@@ -2114,8 +2686,10 @@ mem_write_ramw(uint32_t addr, uint16_t val, UNUSED(void *priv))
     if (cpu_use_exec) {
         addwritelookup(mem_logical_addr, addr);
         mem_write_ramw_page(addr, val, &pages[addr >> 12]);
-    } else
+    } else {
         *(uint16_t *) &ram[addr] = val;
+        mem_dirty_mark(addr);
+    }
 }
 
 void
@@ -2128,8 +2702,142 @@ mem_write_raml(uint32_t addr, uint32_t val, UNUSED(void *priv))
     if (cpu_use_exec) {
         addwritelookup(mem_logical_addr, addr);
         mem_write_raml_page(addr, val, &pages[addr >> 12]);
-    } else
+    } else {
         *(uint32_t *) &ram[addr] = val;
+        mem_dirty_mark(addr);
+    }
+}
+
+static size_t
+mem_dirty_size(void)
+{
+    return ((mem_dirty_pages + 31) >> 5) * sizeof(uint32_t);
+}
+
+/* Fold the pages written since the last sync into every consumer. */
+static void
+mem_dirty_sync(void)
+{
+    uint32_t words = (mem_dirty_pages + 31) >> 5;
+    int      any   = 0;
+
+    for (uint32_t c = 0; c < words; c++) {
+        if (mem_dirty_bits[c]) {
+            for (mem_dirty_t *d = mem_dirty_list; d != NULL; d = d->next)
+                d->bits[c] |= mem_dirty_bits[c];
+            mem_dirty_bits[c] = 0;
+            any               = 1;
+        }
+    }
+
+    /* The pages just cleared may still be mapped directly. */
+    if (any) {
+        flushmmucache_nopc();
+        mem_fast_update(0, MEM_FAST_SIZE);
+    }
+}
+
+/* Size the maps for the current RAM amount, with every page dirty. */
+static void
+mem_dirty_reset(void)
+{
+    if (mem_dirty_bits == NULL)
+        return;
+
+    mem_dirty_pages = mem_size >> 2;
+
+    free(mem_dirty_bits);
+    mem_dirty_bits = (uint32_t *) calloc(1, mem_dirty_size() + sizeof(uint32_t));
+    for (mem_dirty_t *d = mem_dirty_list; d != NULL; d = d->next) {
+        free(d->bits);
+        d->bits = (uint32_t *) malloc(mem_dirty_size() + sizeof(uint32_t));
+        memset(d->bits, 0xff, mem_dirty_size());
+    }
+
+    mem_fast_update(0, MEM_FAST_SIZE);
+}
+
+/*
+ * Register a dirty page consumer. Every page starts out dirty. The
+ * consumer calls mem_dirty_get() to see which pages were written since
+ * it last called mem_dirty_clear(). All of these must be called from
+ * the emulation thread.
+ */
+mem_dirty_t *
+mem_dirty_register(void)
+{
+    mem_dirty_t *d = (mem_dirty_t *) calloc(1, sizeof(mem_dirty_t));
+
+    if (mem_dirty_bits == NULL) {
+        mem_dirty_pages = mem_size >> 2;
+        mem_dirty_bits  = (uint32_t *) calloc(1, mem_dirty_size() + sizeof(uint32_t));
+        /* Drop direct mappings of pages that are now considered clean. */
+        flushmmucache_nopc();
+        mem_fast_update(0, MEM_FAST_SIZE);
+    } else
+        mem_dirty_sync();
+
+    d->bits = (uint32_t *) malloc(mem_dirty_size() + sizeof(uint32_t));
+    memset(d->bits, 0xff, mem_dirty_size());
+    d->next        = mem_dirty_list;
+    mem_dirty_list = d;
+
+    return d;
+}
+
+void
+mem_dirty_unregister(mem_dirty_t *d)
+{
+    for (mem_dirty_t **p = &mem_dirty_list; *p != NULL; p = &(*p)->next) {
+        if (*p == d) {
+            *p = d->next;
+            break;
+        }
+    }
+
+    free(d->bits);
+    free(d);
+
+    if (mem_dirty_list == NULL) {
+        free(mem_dirty_bits);
+        mem_dirty_bits  = NULL;
+        mem_dirty_pages = 0;
+    }
+}
+
+/* Number of pages covered by the map returned by mem_dirty_get(). */
+uint32_t
+mem_dirty_page_count(void)
+{
+    return mem_dirty_pages;
+}
+
+/* Bit n of the returned map is set if RAM page n was written. */
+const uint32_t *
+mem_dirty_get(mem_dirty_t *d)
+{
+    mem_dirty_sync();
+
+    return d->bits;
+}
+
+int
+mem_dirty_test(mem_dirty_t *d, uint32_t addr)
+{
+    if ((addr >> 12) >= mem_dirty_pages)
+        return 0;
+
+    mem_dirty_sync();
+
+    return !!(d->bits[addr >> 17] & (1U << ((addr >> 12) & 31)));
+}
+
+void
+mem_dirty_clear(mem_dirty_t *d)
+{
+    mem_dirty_sync();
+
+    memset(d->bits, 0x00, mem_dirty_size());
 }
 
 static uint8_t
@@ -2194,8 +2902,10 @@ mem_write_remapped(uint32_t addr, uint8_t val, UNUSED(void *priv))
     if (cpu_use_exec) {
         addwritelookup(mem_logical_addr, addr);
         mem_write_ramb_page(addr, val, &pages[oldaddr >> 12]);
-    } else
+    } else {
         ram[addr] = val;
+        mem_dirty_mark(addr);
+    }
 }
 
 static void
@@ -2206,8 +2916,10 @@ mem_write_remappedw(uint32_t addr, uint16_t val, UNUSED(void *priv))
     if (cpu_use_exec) {
         addwritelookup(mem_logical_addr, addr);
         mem_write_ramw_page(addr, val, &pages[oldaddr >> 12]);
-    } else
+    } else {
         *(uint16_t *) &ram[addr] = val;
+        mem_dirty_mark(addr);
+    }
 }
 
 static void
@@ -2218,8 +2930,10 @@ mem_write_remappedl(uint32_t addr, uint32_t val, UNUSED(void *priv))
     if (cpu_use_exec) {
         addwritelookup(mem_logical_addr, addr);
         mem_write_raml_page(addr, val, &pages[oldaddr >> 12]);
-    } else
+    } else {
         *(uint32_t *) &ram[addr] = val;
+        mem_dirty_mark(addr);
+    }
 }
 
 static void
@@ -2230,8 +2944,10 @@ mem_write_remapped2(uint32_t addr, uint8_t val, UNUSED(void *priv))
     if (cpu_use_exec) {
         addwritelookup(mem_logical_addr, addr);
         mem_write_ramb_page(addr, val, &pages[oldaddr >> 12]);
-    } else
+    } else {
         ram[addr] = val;
+        mem_dirty_mark(addr);
+    }
 }
 
 static void
@@ -2242,8 +2958,10 @@ mem_write_remappedw2(uint32_t addr, uint16_t val, UNUSED(void *priv))
     if (cpu_use_exec) {
         addwritelookup(mem_logical_addr, addr);
         mem_write_ramw_page(addr, val, &pages[oldaddr >> 12]);
-    } else
+    } else {
         *(uint16_t *) &ram[addr] = val;
+        mem_dirty_mark(addr);
+    }
 }
 
 static void
@@ -2254,8 +2972,10 @@ mem_write_remappedl2(uint32_t addr, uint32_t val, UNUSED(void *priv))
     if (cpu_use_exec) {
         addwritelookup(mem_logical_addr, addr);
         mem_write_raml_page(addr, val, &pages[oldaddr >> 12]);
-    } else
+    } else {
         *(uint32_t *) &ram[addr] = val;
+        mem_dirty_mark(addr);
+    }
 }
 
 void
@@ -2330,19 +3050,60 @@ mem_mapping_access_allowed(uint32_t flags, uint16_t access)
     return ret;
 }
 
-void
-mem_mapping_recalc(uint64_t base, uint64_t size)
+/* Add the time spent in a recalc and roll the per-second total over. */
+static void
+mem_recalc_account(uint64_t start_time)
+{
+    uint32_t now = plat_get_ticks();
+
+    mem_recalc_acc += plat_timer_read() - start_time;
+    mem_recalc_stats.count++;
+
+    if ((now - mem_recalc_second) >= 1000) {
+        mem_recalc_stats.time_last_second = mem_recalc_acc;
+        mem_recalc_acc                    = 0;
+        mem_recalc_second                 = now;
+    }
+}
+
+static int
+mem_mapping_recalc_ex(uint64_t base, uint64_t size, int compare)
 {
     mem_mapping_t *map;
     int            n;
     uint64_t       c;
     uint8_t        wp;
+    uint64_t       start_time;
+    uint32_t       nr;
+    int            changed;
+    uint8_t       *old_exec[MEM_RECALC_SNAPSHOT];
+    mem_mapping_t *old_maps[4][MEM_RECALC_SNAPSHOT];
 
     if (!size || (base_mapping == NULL))
-        return;
+        return 0;
+
+    start_time = plat_timer_read();
 
     map = base_mapping;
 
+    /*
+     * When only the access state changed (PAM and SMRAM toggles), small
+     * ranges are snapshotted so the MMU lookups only need to be flushed if
+     * the winning mappings actually differ. A mapping whose handlers or
+     * mask changed always flushes, as the pointers alone do not show it.
+     */
+    nr      = (uint32_t) (((base & MEM_GRANULARITY_MASK) + size + MEM_GRANULARITY_MASK) >> MEM_GRANULARITY_BITS);
+    changed = !compare || (nr > MEM_RECALC_SNAPSHOT);
+    if (!changed) {
+        uint32_t first = (uint32_t) (base >> MEM_GRANULARITY_BITS);
+
+        memcpy(old_exec, &_mem_exec[first], nr * sizeof(uint8_t *));
+        memcpy(old_maps[0], &write_mapping[first], nr * sizeof(mem_mapping_t *));
+        memcpy(old_maps[1], &read_mapping[first], nr * sizeof(mem_mapping_t *));
+        memcpy(old_maps[2], &write_mapping_bus[first], nr * sizeof(mem_mapping_t *));
+        memcpy(old_maps[3], &read_mapping_bus[first], nr * sizeof(mem_mapping_t *));
+    }
+
     /* Clear out old mappings. */
     for (c = base; c < base + size; c += MEM_GRANULARITY_SIZE) {
         _mem_exec[c >> MEM_GRANULARITY_BITS]         = NULL;
@@ -2367,6 +3128,12 @@ mem_mapping_recalc(uint64_t base, uint64_t size)
             if (start < map->base)
                 start = map->base;
 
+            /* Aliases land outside the snapshotted range. */
+            if (i_e) {
+                changed            = 1;
+                mem_recalc_aliased = 1;
+            }
+
             for (i_c = i_s; i_c <= i_e; i_c += i_a) {
                 for (c = (start + i_c); c < (end + i_c); c += MEM_GRANULARITY_SIZE) {
                     /* CPU */
@@ -2403,7 +3170,24 @@ mem_mapping_recalc(uint64_t base, uint64_t size)
         map = map->next;
     }
 
-    flushmmucache_nopc();
+    if (!changed) {
+        uint32_t first = (uint32_t) (base >> MEM_GRANULARITY_BITS);
+
+        changed = memcmp(old_exec, &_mem_exec[first], nr * sizeof(uint8_t *)) ||
+                  memcmp(old_maps[0], &write_mapping[first], nr * sizeof(mem_mapping_t *)) ||
+                  memcmp(old_maps[1], &read_mapping[first], nr * sizeof(mem_mapping_t *)) ||
+                  memcmp(old_maps[2], &write_mapping_bus[first], nr * sizeof(mem_mapping_t *)) ||
+                  memcmp(old_maps[3], &read_mapping_bus[first], nr * sizeof(mem_mapping_t *));
+    }
+
+    mem_fast_update(base, size);
+
+    if (changed)
+        flushmmucache_nopc();
+    else
+        mem_recalc_stats.skipped_flushes++;
+
+    mem_recalc_account(start_time);
 
 #ifdef ENABLE_MEM_LOG
     pclog("\nMemory map:\n");
@@ -2454,6 +3238,130 @@ mem_mapping_recalc(uint64_t base, uint64_t size)
     }
     pclog("\n");
 #endif
+
+    return changed;
+}
+
+/* Something the lookups are resolved from changed, drop the SMM views. */
+static void
+mem_map_changed(void)
+{
+    if (++mem_map_gen == 0)
+        mem_map_gen = 1;
+}
+
+void
+mem_mapping_recalc(uint64_t base, uint64_t size)
+{
+    mem_map_changed();
+
+    (void) mem_mapping_recalc_ex(base, size, 0);
+}
+
+/*
+ * Recalculate after a change to the memory access state only. Returns
+ * non-zero if any page ended up with a different mapping.
+ */
+int
+mem_mapping_recalc_state(uint64_t base, uint64_t size)
+{
+    mem_map_changed();
+
+    return mem_mapping_recalc_ex(base, size, 1);
+}
+
+static mem_smm_view_t *
+mem_smm_view_get(uint64_t base, uint64_t size, uint32_t nr)
+{
+    mem_smm_view_t *view = NULL;
+
+    for (int i = 0; i < MEM_SMM_VIEWS; i++) {
+        if ((mem_smm_views[i].base == base) && (mem_smm_views[i].size == size) &&
+            (mem_smm_views[i].nr == nr))
+            return &mem_smm_views[i];
+        if ((view == NULL) && (mem_smm_views[i].gen[0] != mem_map_gen) &&
+            (mem_smm_views[i].gen[1] != mem_map_gen))
+            view = &mem_smm_views[i];
+    }
+
+    /* All views are current, replace the first one. */
+    if (view == NULL)
+        view = &mem_smm_views[0];
+
+    if (view->nr != nr) {
+        for (int n = 0; n < 2; n++) {
+            free(view->exec[n]);
+            free(view->maps[n]);
+            view->exec[n] = (uint8_t **) malloc(nr * sizeof(uint8_t *));
+            view->maps[n] = (mem_mapping_t **) malloc(4 * nr * sizeof(mem_mapping_t *));
+        }
+        view->nr = nr;
+    }
+
+    view->base   = base;
+    view->size   = size;
+    view->gen[0] = view->gen[1] = 0;
+
+    return view;
+}
+
+/*
+ * Recalculate an SMRAM range after entering or leaving SMM. The lookups of
+ * either side are computed once and then swapped in on every further SMI or
+ * RSM, until a mapping or the memory state changes. Returns non-zero if any
+ * page ended up with a different mapping.
+ */
+int
+mem_mapping_recalc_smm(uint64_t base, uint64_t size)
+{
+    mem_smm_view_t *view;
+    const int       n     = !!in_smm;
+    const uint32_t  first = (uint32_t) (base >> MEM_GRANULARITY_BITS);
+    const uint32_t  nr    = (uint32_t) (((base & MEM_GRANULARITY_MASK) + size + MEM_GRANULARITY_MASK) >> MEM_GRANULARITY_BITS);
+    mem_mapping_t **maps[4] = { &write_mapping[first], &read_mapping[first],
+                                &write_mapping_bus[first], &read_mapping_bus[first] };
+    int             changed;
+
+    if (!size || (base_mapping == NULL))
+        return 0;
+
+    view = mem_smm_view_get(base, size, nr);
+    if ((view->exec[n] == NULL) || (view->maps[n] == NULL))
+        return mem_mapping_recalc_ex(base, size, 1);
+
+    if (view->gen[n] == mem_map_gen) {
+        changed = !!memcmp(&_mem_exec[first], view->exec[n], nr * sizeof(uint8_t *));
+        memcpy(&_mem_exec[first], view->exec[n], nr * sizeof(uint8_t *));
+        for (int i = 0; i < 4; i++) {
+            changed |= !!memcmp(maps[i], &view->maps[n][i * nr], nr * sizeof(mem_mapping_t *));
+            memcpy(maps[i], &view->maps[n][i * nr], nr * sizeof(mem_mapping_t *));
+        }
+
+        mem_fast_update(base, size);
+
+        if (changed)
+            flushmmucache_nopc();
+        else
+            mem_recalc_stats.skipped_flushes++;
+
+        mem_recalc_stats.smm_views_reused++;
+
+        return changed;
+    }
+
+    mem_recalc_aliased = 0;
+    changed            = mem_mapping_recalc_ex(base, size, 1);
+
+    /* Aliases resolve pages outside the range, which the view would miss. */
+    if (mem_recalc_aliased)
+        return changed;
+
+    memcpy(view->exec[n], &_mem_exec[first], nr * sizeof(uint8_t *));
+    for (int i = 0; i < 4; i++)
+        memcpy(&view->maps[n][i * nr], maps[i], nr * sizeof(mem_mapping_t *));
+    view->gen[n] = mem_map_gen;
+
+    return changed;
 }
 
 void
@@ -2705,7 +3613,7 @@ mem_set_access(uint8_t bitmap, int mode, uint32_t base, uint32_t size, uint16_t
 #endif
     }
 
-    mem_mapping_recalc(base, size);
+    (void) mem_mapping_recalc_state(base, size);
 }
 
 void
@@ -2765,6 +3673,8 @@ mem_reset(void)
 {
     size_t m;
 
+    mem_map_changed();
+
     memset(page_ff, 0xff, sizeof(page_ff));
 
 #ifdef USE_NEW_DYNAREC
@@ -2790,7 +3700,7 @@ mem_reset(void)
         ram      = NULL;
         ram_size = 0;
     }
-#if (!(defined __amd64__ || defined _M_X64 || defined __aarch64__ || defined _M_ARM64))
+#if (!(defined __amd64__ || defined _M_X64 || defined __aarch64__ || defined _M_ARM64 || (defined __riscv && __riscv_xlen == 64)))
     if (ram2 != NULL) {
         plat_munmap(ram2, ram2_size);
         ram2      = NULL;
@@ -2803,18 +3713,31 @@ mem_reset(void)
 
     m = 1024UL * (size_t) mem_size;
 
-#if (!(defined __amd64__ || defined _M_X64 || defined __aarch64__ || defined _M_ARM64))
+    /*
+     * Anonymous mappings come back zero-filled and the host only backs
+     * them with memory on first touch, so the RAM is deliberately not
+     * cleared here - that would commit the whole block up front.
+     *
+     * With mem_mergeable, the blocks are offered to the host for merging
+     * of identical pages (KSM on Linux), which pays off with many guests
+     * running the same OS. Huge pages are only merged once the host has
+     * split them, so the two do not go well together.
+     */
+#if (!(defined __amd64__ || defined _M_X64 || defined __aarch64__ || defined _M_ARM64 || (defined __riscv && __riscv_xlen == 64)))
     if (mem_size > 1048576) {
         ram_size = 1 << 30;
-        ram      = (uint8_t *) plat_mmap(ram_size, 0); /* allocate and clear the RAM block of the first 1 GB */
+        ram      = (uint8_t *) plat_mmap(ram_size, 0); /* allocate the RAM block of the first 1 GB */
         if (ram == NULL) {
             fatal("Failed to allocate primary RAM block. Make sure you have enough RAM available.\n");
             return;
         }
-        memset(ram, 0x00, ram_size);
+        if (mem_huge_pages)
+            plat_mmap_hint_huge(ram, ram_size);
+        if (mem_mergeable)
+            plat_mmap_hint_mergeable(ram, ram_size);
         ram2_size = m - (1 << 30);
         /* Allocate 16 extra bytes of RAM to mitigate some dynarec recompiler memory access quirks. */
-        ram2      = (uint8_t *) plat_mmap(ram2_size + 16, 0); /* allocate and clear the RAM block above 1 GB */
+        ram2      = (uint8_t *) plat_mmap(ram2_size + 16, 0); /* allocate the RAM block above 1 GB */
         if (ram2 == NULL) {
             if (config_changed == 2)
                 fatal(EMU_NAME " must be restarted for the memory amount change to be applied.\n");
@@ -2822,18 +3745,24 @@ mem_reset(void)
                 fatal("Failed to allocate secondary RAM block. Make sure you have enough RAM available.\n");
             return;
         }
-        memset(ram2, 0x00, ram2_size + 16);
+        if (mem_huge_pages)
+            plat_mmap_hint_huge(ram2, ram2_size + 16);
+        if (mem_mergeable)
+            plat_mmap_hint_mergeable(ram2, ram2_size + 16);
     } else
 #endif
     {
         ram_size = m;
         /* Allocate 16 extra bytes of RAM to mitigate some dynarec recompiler memory access quirks. */
-        ram      = (uint8_t *) plat_mmap(ram_size + 16, 0); /* allocate and clear the RAM block */
+        ram      = (uint8_t *) plat_mmap(ram_size + 16, 0); /* allocate the RAM block */
         if (ram == NULL) {
             fatal("Failed to allocate RAM block. Make sure you have enough RAM available.\n");
             return;
         }
-        memset(ram, 0x00, ram_size + 16);
+        if (mem_huge_pages)
+            plat_mmap_hint_huge(ram, ram_size + 16);
+        if (mem_mergeable)
+            plat_mmap_hint_mergeable(ram, ram_size + 16);
         if (mem_size > 1048576)
             ram2 = &(ram[1 << 30]);
     }
@@ -2884,7 +3813,7 @@ mem_reset(void)
         if ((c << 12) >= (mem_size << 10))
             pages[c].mem = page_ff;
         else {
-#if (!(defined __amd64__ || defined _M_X64 || defined __aarch64__ || defined _M_ARM64))
+#if (!(defined __amd64__ || defined _M_X64 || defined __aarch64__ || defined _M_ARM64 || (defined __riscv && __riscv_xlen == 64)))
             if (mem_size > 1048576) {
                 if ((c << 12) < (1 << 30))
                     pages[c].mem = &ram[c << 12];
@@ -2908,7 +3837,13 @@ mem_reset(void)
 #endif
     }
 
+#ifdef USE_NEW_DYNAREC
+    mem_smc_init();
+#endif
+
     memset(_mem_exec, 0x00, sizeof(_mem_exec));
+    memset(mem_fast_read, 0x00, sizeof(mem_fast_read));
+    memset(mem_fast_write, 0x00, sizeof(mem_fast_write));
     memset(_mem_wp, 0x00, sizeof(_mem_wp));
     memset(_mem_wp_bus, 0x00, sizeof(_mem_wp_bus));
     memset(write_mapping, 0x00, sizeof(write_mapping));
@@ -2971,6 +3906,8 @@ mem_reset(void)
     purgable_page_list_head = 0;
     purgeable_page_count    = 0;
 #endif
+
+    mem_dirty_reset();
 }
 
 void
@@ -3088,7 +4025,7 @@ mem_remap_top_ex_common(int kb, uint32_t start, int mid)
         if (sis_mode || ((c << 12) >= (mem_size << 10)))
             pages[c].mem = page_ff;
         else {
-#if (!(defined __amd64__ || defined _M_X64 || defined __aarch64__ || defined _M_ARM64))
+#if (!(defined __amd64__ || defined _M_X64 || defined __aarch64__ || defined _M_ARM64 || (defined __riscv && __riscv_xlen == 64)))
             if (mem_size > 1048576) {
                 if ((c << 12) < (1 << 30))
                     pages[c].mem = &ram[c << 12];
@@ -3198,6 +4135,11 @@ mem_reset_page_blocks(void)
         pages[c].head                                                                         = NULL;
 #endif
     }
+
+#ifdef USE_NEW_DYNAREC
+    /* There is no code left to protect. */
+    mem_smc_unprotect_all();
+#endif
 }
 
 void
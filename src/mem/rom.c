@@ -28,6 +28,12 @@
 #include <string.h>
 #include <stdlib.h>
 #include <wchar.h>
+#ifdef _WIN32
+#    include <windows.h>
+#    include <io.h>
+#else
+#    include <sys/mman.h>
+#endif
 #define HAVE_STDARG_H
 #include <86box/86box.h>
 #include "cpu.h"
@@ -38,6 +44,10 @@
 #include <86box/machine.h>
 #include <86box/m_xt_xi8088.h>
 
+/* Offsets that can be mapped on every host, Windows only maps at
+   multiples of its 64 KB allocation granularity. */
+#define ROM_MAP_ALIGN 0x10000
+
 #ifdef ENABLE_ROM_LOG
 int rom_do_log = ENABLE_ROM_LOG;
 
@@ -193,6 +203,80 @@ rom_present(const char *fn)
     return 0;
 }
 
+/* Maps sz bytes of an image from off, copy-on-write, so that every instance
+   of the emulator running the same ROM shares its pages in the page cache
+   until one of them patches it. Returns NULL if the image can not be
+   mapped, the caller then reads it in as usual. */
+uint8_t *
+rom_map(const char *fn, int off, int sz)
+{
+    FILE    *fp;
+    uint8_t *ptr = NULL;
+
+    if ((off % ROM_MAP_ALIGN) || (sz <= 0))
+        return NULL;
+
+    fp = rom_fopen(fn, "rb");
+    if (fp == NULL)
+        return NULL;
+
+    /* Past the end of the file, there is nothing to map the pages to. */
+    if (fseeko64(fp, 0, SEEK_END) || (ftello64(fp) < ((int64_t) off + sz))) {
+        (void) fclose(fp);
+        return NULL;
+    }
+
+#ifdef _WIN32
+    HANDLE mh = CreateFileMappingA((HANDLE) _get_osfhandle(fileno(fp)), NULL, PAGE_WRITECOPY, 0, 0, NULL);
+    if (mh != NULL) {
+        ptr = (uint8_t *) MapViewOfFile(mh, FILE_MAP_COPY, 0, (DWORD) off, (SIZE_T) sz);
+        CloseHandle(mh);
+    }
+#else
+    void *p = mmap(NULL, (size_t) sz, PROT_READ | PROT_WRITE, MAP_PRIVATE, fileno(fp), (off_t) off);
+    if (p != MAP_FAILED)
+        ptr = (uint8_t *) p;
+#endif
+
+    /* The mapping holds on to the file by itself. */
+    (void) fclose(fp);
+
+    if (ptr == NULL)
+        rom_log("ROM: unable to map image '%s'\n", fn);
+
+    return ptr;
+}
+
+void
+rom_unmap(uint8_t *ptr, int sz)
+{
+    if (ptr == NULL)
+        return;
+
+#ifdef _WIN32
+    (void) sz;
+    UnmapViewOfFile(ptr);
+#else
+    munmap(ptr, (size_t) sz);
+#endif
+}
+
+/* Frees the image of a ROM set up by rom_init() and friends. */
+void
+rom_free(rom_t *rom)
+{
+    if (rom->rom == NULL)
+        return;
+
+    if (rom->mapped)
+        rom_unmap(rom->rom, rom->sz);
+    else
+        free(rom->rom);
+
+    rom->rom    = NULL;
+    rom->mapped = 0;
+}
+
 uint8_t
 rom_read(uint32_t addr, void *priv)
 {
@@ -667,16 +751,22 @@ rom_init(rom_t *rom, const char *fn, uint32_t addr, int sz, int mask, int off, u
 {
     rom_log("rom_init(%08X, %s, %08X, %08X, %08X, %08X, %08X)\n", rom, fn, addr, sz, mask, off, flags);
 
-    /* Allocate a buffer for the image. */
-    rom->rom = malloc(sz);
-    memset(rom->rom, 0xff, sz);
-
-    /* Load the image file into the buffer. */
-    if (!rom_load_linear(fn, addr, sz, off, rom->rom)) {
-        /* Nope.. clean up. */
-        free(rom->rom);
-        rom->rom = NULL;
-        return (-1);
+    /* Where the image lands at the start of the buffer, use it in place. */
+    rom->rom    = (((addr >= 0x40000) || !(addr & 0x03ffff)) ? rom_map(fn, off, sz) : NULL);
+    rom->mapped = (rom->rom != NULL);
+
+    if (!rom->mapped) {
+        /* Allocate a buffer for the image. */
+        rom->rom = malloc(sz);
+        memset(rom->rom, 0xff, sz);
+
+        /* Load the image file into the buffer. */
+        if (!rom_load_linear(fn, addr, sz, off, rom->rom)) {
+            /* Nope.. clean up. */
+            free(rom->rom);
+            rom->rom = NULL;
+            return (-1);
+        }
     }
 
     rom->sz   = sz;
@@ -697,7 +787,8 @@ rom_init_oddeven(rom_t *rom, const char *fn, uint32_t addr, int sz, int mask, in
     rom_log("rom_init(%08X, %08X, %08X, %08X, %08X, %08X, %08X)\n", rom, fn, addr, sz, mask, off, flags);
 
     /* Allocate a buffer for the image. */
-    rom->rom = malloc(sz);
+    rom->mapped = 0;
+    rom->rom    = malloc(sz);
     memset(rom->rom, 0xff, sz);
 
     /* Load the image file into the buffer. */
@@ -724,7 +815,8 @@ int
 rom_init_interleaved(rom_t *rom, const char *fnl, const char *fnh, uint32_t addr, int sz, int mask, int off, uint32_t flags)
 {
     /* Allocate a buffer for the image. */
-    rom->rom = malloc(sz);
+    rom->mapped = 0;
+    rom->rom    = malloc(sz);
     memset(rom->rom, 0xff, sz);
 
     /* Load the image file into the buffer. */
@@ -161,7 +161,7 @@ smram_recalc_all(int ret)
     if (ret) {
         while (temp_smram != NULL) {
             if (temp_smram->old_size != 0x00000000)
-                mem_mapping_recalc(temp_smram->old_host_base, temp_smram->old_size);
+                (void) mem_mapping_recalc_smm(temp_smram->old_host_base, temp_smram->old_size);
             temp_smram->old_host_base = temp_smram->old_size = 0x00000000;
 
             next       = temp_smram->next;
@@ -173,12 +173,16 @@ smram_recalc_all(int ret)
 
     while (temp_smram != NULL) {
         if (temp_smram->size != 0x00000000)
-            mem_mapping_recalc(temp_smram->host_base, temp_smram->size);
+            (void) mem_mapping_recalc_smm(temp_smram->host_base, temp_smram->size);
 
         next       = temp_smram->next;
         temp_smram = next;
     }
 
+    /*
+     * Always flushed, even if the SMRAM ranges resolve as before - SMM entry
+     * and RSM also rely on this for the paging state they change.
+     */
     flushmmucache();
 }
 
@@ -43,7 +43,6 @@ typedef struct sst_t {
 
     int command_state;
     int id_mode;
-    int dirty;
 
     uint32_t size;
     uint32_t mask;
@@ -59,6 +58,8 @@ typedef struct sst_t {
     mem_mapping_t mapping_h[8];
 
     pc_timer_t page_write_timer;
+
+    nvr_image_t *image;
 } sst_t;
 
 static char flash_path[1024];
@@ -174,7 +175,7 @@ sst_sector_erase(sst_t *dev, uint32_t addr)
         memset(&dev->array[base], 0xff, 4096);
     }
 
-    dev->dirty = 1;
+    nvr_image_dirty(dev->image);
 }
 
 static void
@@ -195,6 +196,7 @@ sst_new_command(sst_t *dev, uint32_t addr, uint8_t val)
                     size -= 0x2000;
 
                 memset(&(dev->array[base]), 0xff, size);
+                nvr_image_dirty(dev->image);
                 dev->command_state = 0;
                 break;
 
@@ -272,7 +274,7 @@ sst_page_write(void *priv)
                     continue;
 
                 dev->array[dev->page_base + i] = dev->page_buffer[i];
-                dev->dirty |= 1;
+                nvr_image_dirty(dev->image);
             }
         }
     }
@@ -388,7 +390,7 @@ sst_write(uint32_t addr, uint8_t val, void *priv)
                 dev->command_state = 0;
 
                 dev->array[addr & dev->mask] = val;
-                dev->dirty                   = 1;
+                nvr_image_dirty(dev->image);
             } else {
                 dev->command_state++;
                 sst_buf_write(dev, addr, val);
@@ -502,6 +504,14 @@ sst_add_mappings(sst_t *dev)
     }
 }
 
+static void
+sst_write_image(void *priv, FILE *fp)
+{
+    const sst_t *dev = (sst_t *) priv;
+
+    fwrite(&(dev->array[0x00000]), dev->size, 1, fp);
+}
+
 static void *
 sst_init(const device_t *info)
 {
@@ -534,13 +544,15 @@ sst_init(const device_t *info)
 
     sst_add_mappings(dev);
 
+    dev->image = nvr_image_add(flash_path, sst_write_image, dev);
+
     fp = nvr_fopen(flash_path, "rb");
     if (fp) {
         if (fread(&(dev->array[0x00000]), 1, dev->size, fp) != dev->size)
             pclog("Less than %i bytes read from the SST Flash ROM file\n", dev->size);
         fclose(fp);
     } else
-        dev->dirty = 1; /* It is by definition dirty on creation. */
+        nvr_image_dirty(dev->image); /* It is by definition dirty on creation. */
 
     if (!dev->is_39)
         timer_add(&dev->page_write_timer, sst_page_write, dev, 0);
@@ -551,16 +563,10 @@ sst_init(const device_t *info)
 static void
 sst_close(void *priv)
 {
-    FILE  *fp;
     sst_t *dev = (sst_t *) priv;
 
-    if (dev->dirty) {
-        fp = nvr_fopen(flash_path, "wb");
-        if (fp != NULL) {
-            fwrite(&(dev->array[0x00000]), dev->size, 1, fp);
-            fclose(fp);
-        }
-    }
+    /* Saves the image if it is dirty. */
+    nvr_image_remove(dev->image);
 
     free(dev->array);
     dev->array = NULL;
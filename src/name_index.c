@@ -0,0 +1,79 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Hashed lookup of table entries by internal name.
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <wchar.h>
+#include <86box/86box.h>
+#include <86box/name_index.h>
+
+/*FNV-1a*/
+static uint32_t
+name_index_hash(const char *name)
+{
+    uint32_t hash = 0x811c9dc5;
+
+    while (*name) {
+        hash ^= (uint8_t) *name++;
+        hash *= 0x01000193;
+    }
+
+    return hash;
+}
+
+static void
+name_index_build(name_index_t *idx)
+{
+    const char *name;
+    int         count = 0;
+    int         size  = 16;
+    uint32_t    h;
+
+    while (idx->get_name(count) != NULL)
+        count++;
+
+    /* Keep the table at most half full. */
+    while (size < (count * 2))
+        size <<= 1;
+
+    idx->slot = (int *) calloc(size, sizeof(int));
+    if (idx->slot == NULL)
+        fatal("name_index_build(): Out of memory\n");
+
+    for (int i = 0; i < count; i++) {
+        name = idx->get_name(i);
+
+        for (h = name_index_hash(name) & (size - 1); idx->slot[h]; h = (h + 1) & (size - 1)) {
+            if (!strcmp(idx->get_name(idx->slot[h] - 1), name))
+                break;
+        }
+
+        if (!idx->slot[h])
+            idx->slot[h] = i + 1;
+    }
+
+    idx->size = size;
+}
+
+int
+name_index_find(name_index_t *idx, const char *name)
+{
+    if (!idx->size)
+        name_index_build(idx);
+
+    for (uint32_t h = name_index_hash(name) & (idx->size - 1); idx->slot[h]; h = (h + 1) & (idx->size - 1)) {
+        if (!strcmp(idx->get_name(idx->slot[h] - 1), name))
+            return idx->slot[h] - 1;
+    }
+
+    return -1;
+}
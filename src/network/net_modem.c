@@ -429,32 +429,39 @@ modem_data_mode_process_byte(modem_t *modem, uint8_t data)
     }
 }
 
+/* Hand the port as much of a buffer as its receive FIFO can take. */
+static int
+modem_to_serial(modem_t *modem, Fifo8 *fifo)
+{
+    uint32_t       num;
+    const uint8_t *buf   = fifo8_peek_bufptr(fifo, MIN(SERIAL_FIFO_SIZE, fifo8_num_used(fifo)), &num);
+    int            taken = serial_write_fifo_block(modem->serial, buf, (int) num);
+
+    fifo8_drop(fifo, taken);
+
+    return taken;
+}
+
 static void
 host_to_modem_cb(void *priv)
 {
-    modem_t *modem = (modem_t *) priv;
+    modem_t *modem   = (modem_t *) priv;
+    double   char_us = (1000000.0 / (double) modem->baudrate) * (double) 9;
+    int      taken   = 0;
 
     if (modem->in_warmup || (modem->serial == NULL))
         goto no_write_to_machine;
 
-    if ((modem->serial->type >= SERIAL_16550) && modem->serial->fifo_enabled) {
-        if (fifo_get_full(modem->serial->rcvr_fifo)) {
-            goto no_write_to_machine;
-        }
-    } else {
-        if (modem->serial->lsr & 1) {
-            goto no_write_to_machine;
-        }
-    }
+    if (!serial_rx_space(modem->serial))
+        goto no_write_to_machine;
 
     if (!((modem->serial->mctrl & 2) || modem->flowcontrol != 3))
         goto no_write_to_machine;
 
     if (modem->mode == MODEM_MODE_DATA && fifo8_num_used(&modem->rx_data) && !modem->cooldown) {
-        serial_write_fifo(modem->serial, fifo8_pop(&modem->rx_data));
+        taken = modem_to_serial(modem, &modem->rx_data);
     } else if (fifo8_num_used(&modem->data_pending)) {
-        uint8_t val = fifo8_pop(&modem->data_pending);
-        serial_write_fifo(modem->serial, val);
+        taken = modem_to_serial(modem, &modem->data_pending);
     }
 
     if (fifo8_num_used(&modem->data_pending) == 0) {
@@ -462,7 +469,8 @@ host_to_modem_cb(void *priv)
     }
 
 no_write_to_machine:
-    timer_on_auto(&modem->host_to_serial_timer, (1000000.0 / (double) modem->baudrate) * (double) 9);
+    /* The port clocks a burst in at the baud rate, come back once it is through. */
+    timer_on_auto(&modem->host_to_serial_timer, (taken > 1) ? (taken * char_us) : char_us);
 }
 
 static void
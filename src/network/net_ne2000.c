@@ -486,6 +486,67 @@ nic_writel(uint16_t addr, uint32_t val, void *priv)
     nic_write((nic_t *) priv, addr, val, 4);
 }
 
+/* REP INSW and OUTSW on the data port in word mode. Words are moved directly
+   to and from the packet memory, leaving the last word of the transfer and
+   the one at the end of the ring to nic_read() and nic_write(), which take
+   care of the wrap around and the remote DMA completion interrupt. */
+static int
+nic_dma_word_ok(const dp8390_t *dp)
+{
+    return (dp->remote_bytes > 2) && !(dp->remote_dma & 1) &&
+           (dp->remote_dma >= dp->mem_start) && ((dp->remote_dma + 2) <= dp->mem_end) &&
+           ((dp->remote_dma + 2) != (dp->page_stop << 8));
+}
+
+static int
+nic_readw_rep(uint16_t addr, uint16_t *buf, int count, void *priv)
+{
+    nic_t    *dev = (nic_t *) priv;
+    dp8390_t *dp  = dev->dp8390;
+    int       n   = 0;
+
+    if (((addr - dev->base_address) != 0x10) || !dp->DCR.wdsize)
+        return 0;
+
+    while ((n < count) && nic_dma_word_ok(dp)) {
+        const uint8_t *p = &dp->mem[dp->remote_dma - dp->mem_start];
+
+        buf[n++] = p[0] | (p[1] << 8);
+        dp->remote_dma += 2;
+        dp->remote_bytes -= 2;
+    }
+
+    if (n < count)
+        buf[n++] = nic_read(dev, addr, 2);
+
+    return n;
+}
+
+static int
+nic_writew_rep(uint16_t addr, const uint16_t *buf, int count, void *priv)
+{
+    nic_t    *dev = (nic_t *) priv;
+    dp8390_t *dp  = dev->dp8390;
+    int       n   = 0;
+
+    if (((addr - dev->base_address) != 0x10) || !dp->DCR.wdsize)
+        return 0;
+
+    while ((n < count) && nic_dma_word_ok(dp)) {
+        uint8_t *p = &dp->mem[dp->remote_dma - dp->mem_start];
+
+        p[0] = buf[n] & 0xff;
+        p[1] = buf[n++] >> 8;
+        dp->remote_dma += 2;
+        dp->remote_bytes -= 2;
+    }
+
+    if (n < count)
+        nic_write(dev, addr, buf[n++], 2);
+
+    return n;
+}
+
 static void nic_ioset(nic_t *dev, uint16_t addr);
 static void nic_ioremove(nic_t *dev, uint16_t addr);
 
@@ -564,6 +625,7 @@ nic_ioset(nic_t *dev, uint16_t addr)
         io_sethandler(addr, 32,
                       nic_readb, nic_readw, nic_readl,
                       nic_writeb, nic_writew, nic_writel, dev);
+        io_handler_rep(1, addr + 16, 1, nic_readw_rep, nic_writew_rep, dev);
     } else {
         io_sethandler(addr, 16,
                       nic_readb, NULL, NULL,
@@ -576,6 +638,7 @@ nic_ioset(nic_t *dev, uint16_t addr)
             io_sethandler(addr + 16, 16,
                           nic_readb, nic_readw, NULL,
                           nic_writeb, nic_writew, NULL, dev);
+            io_handler_rep(1, addr + 16, 1, nic_readw_rep, nic_writew_rep, dev);
         }
     }
 }
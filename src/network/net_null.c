@@ -52,7 +52,7 @@ enum {
  * excluding NET_EVENT_RX. */
 #define NET_EVENT_TX_MAX NET_EVENT_RX
 
-#define NULL_PKT_BATCH NET_QUEUE_LEN
+#define NULL_PKT_BATCH NET_QUEUE_BATCH
 
 typedef struct net_null_t {
     uint8_t    mac_addr[6];
@@ -174,7 +174,7 @@ net_null_init(const netcard_t *card, const uint8_t *mac_addr, UNUSED(void *priv)
 
     net_event_init(&net_null->tx_event);
     net_event_init(&net_null->stop_event);
-    net_null->poll_tid = thread_create(net_null_thread, net_null);
+    net_null->poll_tid = thread_create_role(net_null_thread, net_null, THREAD_ROLE_NETWORK);
 
     return net_null;
 }
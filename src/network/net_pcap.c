@@ -42,6 +42,9 @@
  * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING  IN ANY  WAY OUT OF THE USE
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
+#if defined __linux__ && !defined _GNU_SOURCE
+#    define _GNU_SOURCE /* sendmmsg() */
+#endif
 #include <stdarg.h>
 #include <stdint.h>
 #include <stdio.h>
@@ -58,6 +61,12 @@
 #    include <unistd.h>
 #    include <fcntl.h>
 #    include <sys/select.h>
+#    ifdef __linux__
+#        include <sys/socket.h>
+#        include <sys/uio.h>
+#        include <net/if.h>
+#        include <linux/if_packet.h>
+#    endif
 #endif
 
 #define HAVE_STDARG_H
@@ -70,7 +79,10 @@
 #include <86box/network.h>
 #include <86box/net_event.h>
 
-#define PCAP_PKT_BATCH NET_QUEUE_LEN
+#define PCAP_PKT_BATCH NET_QUEUE_BATCH
+
+/* Kernel capture buffer, big enough to hold a burst at 100 Mbit. */
+#define PCAP_BUFFER_SIZE (2 << 20)
 
 enum {
     NET_EVENT_STOP = 0,
@@ -144,6 +156,10 @@ typedef struct {
     uint8_t    mac_addr[6];
 #ifdef _WIN32
     struct pcap_send_queue *pcap_queue;
+#elif defined __linux__
+    int            tx_fd; /* Raw socket for sendmmsg(), -1 if unavailable. */
+    struct mmsghdr tx_msgs[PCAP_PKT_BATCH];
+    struct iovec   tx_iovs[PCAP_PKT_BATCH];
 #endif
 } net_pcap_t;
 
@@ -169,6 +185,7 @@ static int (*f_pcap_setnonblock)(void *, int, char *);
 static int (*f_pcap_set_immediate_mode)(void *, int);
 static int (*f_pcap_set_promisc)(void *, int);
 static int (*f_pcap_set_snaplen)(void *, int);
+static int (*f_pcap_set_buffer_size)(void *, int);
 static int (*f_pcap_dispatch)(void *, int, pcap_handler callback, unsigned char *user);
 static void *(*f_pcap_create)(const char *, char *);
 static int (*f_pcap_activate)(void *);
@@ -197,6 +214,7 @@ static dllimp_t pcap_imports[] = {
     { "pcap_set_immediate_mode", &f_pcap_set_immediate_mode},
     { "pcap_set_promisc",        &f_pcap_set_promisc       },
     { "pcap_set_snaplen",        &f_pcap_set_snaplen       },
+    { "pcap_set_buffer_size",    &f_pcap_set_buffer_size   },
     { "pcap_dispatch",           &f_pcap_dispatch          },
     { "pcap_create",             &f_pcap_create            },
     { "pcap_activate",           &f_pcap_activate          },
@@ -235,19 +253,28 @@ static void
 net_pcap_rx_handler(uint8_t *user, const struct pcap_pkthdr *h, const uint8_t *bytes)
 {
     net_pcap_t *pcap = (net_pcap_t *) user;
-    memcpy(pcap->pkt.data, bytes, h->caplen);
-    pcap->pkt.len = h->caplen;
-    network_rx_put_pkt(pcap->card, &pcap->pkt);
+    netpkt_t   *slot;
+
+    if (h->caplen > NET_MAX_FRAME)
+        return;
+
+    /* Copy straight into the ring, a full ring drops the packet. */
+    slot = network_rx_reserve(pcap->card);
+    if (slot == NULL)
+        return;
+
+    memcpy(slot->data, bytes, h->caplen);
+    network_rx_commit(pcap->card, h->caplen);
 }
 
-/* Send a packet to the Pcap interface. */
-void
+/* Send a packet to the Pcap interface, 0 if it failed. */
+int
 net_pcap_in(void *pcap, uint8_t *bufp, int len)
 {
     if (pcap == NULL)
-        return;
+        return 0;
 
-    f_pcap_sendpacket(pcap, bufp, len);
+    return f_pcap_sendpacket(pcap, bufp, len) == 0;
 }
 
 void
@@ -257,6 +284,14 @@ net_pcap_in_available(void *priv)
     net_event_set(&pcap->tx_event);
 }
 
+/* Drain everything the capture buffer holds, a batch at a time. */
+static void
+net_pcap_rx(net_pcap_t *pcap)
+{
+    while (f_pcap_dispatch(pcap->pcap, PCAP_PKT_BATCH, net_pcap_rx_handler, (unsigned char *) pcap) == PCAP_PKT_BATCH)
+        ;
+}
+
 #ifdef _WIN32
 static void
 net_pcap_thread(void *priv)
@@ -284,17 +319,23 @@ net_pcap_thread(void *priv)
 
             case NET_EVENT_TX:
                 net_event_clear(&pcap->tx_event);
-                int packets = network_tx_popv(pcap->card, pcap->pktv, PCAP_PKT_BATCH);
-                for (int i = 0; i < packets; i++) {
-                    h.caplen = pcap->pktv[i].len;
-                    f_pcap_sendqueue_queue(pcap->pcap_queue, &h, pcap->pktv[i].data);
+                int packets;
+                while ((packets = network_tx_popv(pcap->card, pcap->pktv, PCAP_PKT_BATCH)) > 0) {
+                    for (int i = 0; i < packets; i++) {
+                        h.caplen = pcap->pktv[i].len;
+                        h.len    = pcap->pktv[i].len;
+                        f_pcap_sendqueue_queue(pcap->pcap_queue, &h, pcap->pktv[i].data);
+                    }
+                    if (f_pcap_sendqueue_transmit(pcap->pcap, pcap->pcap_queue, 0) < pcap->pcap_queue->len)
+                        network_tx_failed(pcap->card, packets);
+                    pcap->pcap_queue->len = 0;
+                    if (packets < PCAP_PKT_BATCH)
+                        break;
                 }
-                f_pcap_sendqueue_transmit(pcap->pcap, pcap->pcap_queue, 0);
-                pcap->pcap_queue->len = 0;
                 break;
 
             case NET_EVENT_RX:
-                f_pcap_dispatch(pcap->pcap, PCAP_PKT_BATCH, net_pcap_rx_handler, (unsigned char *) pcap);
+                net_pcap_rx(pcap);
                 break;
 
             default:
@@ -305,6 +346,73 @@ net_pcap_thread(void *priv)
     pcap_log("PCAP: polling stopped.\n");
 }
 #else
+/* Send a batch popped off the transmit ring, with one system call on Linux. */
+static void
+net_pcap_tx(net_pcap_t *pcap, int packets)
+{
+#    ifdef __linux__
+    if (pcap->tx_fd != -1) {
+        int sent = 0;
+
+        for (int i = 0; i < packets; i++) {
+            pcap->tx_iovs[i].iov_base = pcap->pktv[i].data;
+            pcap->tx_iovs[i].iov_len  = pcap->pktv[i].len;
+        }
+
+        while (sent < packets) {
+            int ret = sendmmsg(pcap->tx_fd, &pcap->tx_msgs[sent], packets - sent, 0);
+
+            if (ret <= 0) {
+                pcap_log("PCAP: sendmmsg failed, %i packets dropped\n", packets - sent);
+                network_tx_failed(pcap->card, packets - sent);
+                break;
+            }
+            sent += ret;
+        }
+        return;
+    }
+#    endif
+
+    for (int i = 0; i < packets; i++) {
+        if (!net_pcap_in(pcap->pcap, pcap->pktv[i].data, pcap->pktv[i].len))
+            network_tx_failed(pcap->card, 1);
+    }
+}
+
+#    ifdef __linux__
+/* Open a raw socket on the capture interface for batched transmits. */
+static void
+net_pcap_tx_init(net_pcap_t *pcap, const char *intf_name)
+{
+    struct sockaddr_ll sll = { 0 };
+
+    pcap->tx_fd = -1;
+
+    sll.sll_family  = AF_PACKET;
+    sll.sll_ifindex = if_nametoindex(intf_name);
+    if (sll.sll_ifindex == 0)
+        return;
+
+    /* Protocol 0, the socket only sends and never receives. */
+    pcap->tx_fd = socket(AF_PACKET, SOCK_RAW, 0);
+    if (pcap->tx_fd == -1)
+        return;
+
+    if (bind(pcap->tx_fd, (struct sockaddr *) &sll, sizeof(sll)) != 0) {
+        close(pcap->tx_fd);
+        pcap->tx_fd = -1;
+        return;
+    }
+
+    for (int i = 0; i < PCAP_PKT_BATCH; i++) {
+        pcap->tx_msgs[i].msg_hdr.msg_iov    = &pcap->tx_iovs[i];
+        pcap->tx_msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    pcap_log("PCAP: using sendmmsg() on %s\n", intf_name);
+}
+#    endif
+
 static void
 net_pcap_thread(void *priv)
 {
@@ -334,14 +442,16 @@ net_pcap_thread(void *priv)
         if (pfd[NET_EVENT_TX].revents & POLLIN) {
             net_event_clear(&pcap->tx_event);
 
-            int packets = network_tx_popv(pcap->card, pcap->pktv, PCAP_PKT_BATCH);
-            for (int i = 0; i < packets; i++) {
-                net_pcap_in(pcap->pcap, pcap->pktv[i].data, pcap->pktv[i].len);
+            int packets;
+            while ((packets = network_tx_popv(pcap->card, pcap->pktv, PCAP_PKT_BATCH)) > 0) {
+                net_pcap_tx(pcap, packets);
+                if (packets < PCAP_PKT_BATCH)
+                    break;
             }
         }
 
         if (pfd[NET_EVENT_RX].revents & POLLIN) {
-            f_pcap_dispatch(pcap->pcap, PCAP_PKT_BATCH, net_pcap_rx_handler, (unsigned char *) pcap);
+            net_pcap_rx(pcap);
         }
     }
 
@@ -488,6 +598,9 @@ net_pcap_init(const netcard_t *card, const uint8_t *mac_addr, void *priv, char *
     if (f_pcap_set_snaplen(pcap->pcap, NET_MAX_FRAME) != 0)
         pcap_log("PCAP: error setting snaplen\n");
 
+    if (f_pcap_set_buffer_size(pcap->pcap, PCAP_BUFFER_SIZE) != 0)
+        pcap_log("PCAP: error setting buffer size\n");
+
     if (f_pcap_activate(pcap->pcap) != 0) {
         snprintf(errbuf_prep, NET_DRV_ERRBUF_SIZE, "%s", (char *)f_pcap_geterr(pcap->pcap));
         net_pcap_error(netdrv_errbuf, errbuf_prep);
@@ -520,7 +633,10 @@ net_pcap_init(const netcard_t *card, const uint8_t *mac_addr, void *priv, char *
     }
 
 #ifdef _WIN32
-    pcap->pcap_queue = f_pcap_sendqueue_alloc(PCAP_PKT_BATCH * NET_MAX_FRAME);
+    /* Every queued packet is preceded by its header. */
+    pcap->pcap_queue = f_pcap_sendqueue_alloc(PCAP_PKT_BATCH * (NET_MAX_FRAME + sizeof(struct pcap_pkthdr)));
+#elif defined __linux__
+    net_pcap_tx_init(pcap, intf_name);
 #endif
 
     for (int i = 0; i < PCAP_PKT_BATCH; i++) {
@@ -530,7 +646,7 @@ net_pcap_init(const netcard_t *card, const uint8_t *mac_addr, void *priv, char *
 
     net_event_init(&pcap->tx_event);
     net_event_init(&pcap->stop_event);
-    pcap->poll_tid = thread_create(net_pcap_thread, pcap);
+    pcap->poll_tid = thread_create_role(net_pcap_thread, pcap, THREAD_ROLE_NETWORK);
 
     return pcap;
 }
@@ -561,6 +677,9 @@ net_pcap_close(void *priv)
 
 #ifdef _WIN32
     f_pcap_sendqueue_destroy((void *) pcap->pcap_queue);
+#elif defined __linux__
+    if (pcap->tx_fd != -1)
+        close(pcap->tx_fd);
 #endif
     /* OK, now shut down Pcap itself. */
     f_pcap_close(pcap->pcap);
@@ -146,8 +146,8 @@ typedef struct RTNETETHERHDR {
 #define CSR_LTINTEN(S)   !!((S)->aCSR[5] & 0x4000) /**< Last Transmit Interrupt Enable */
 #define CSR_TOKINTD(S)   !!((S)->aCSR[5] & 0x8000) /**< Transmit OK Interrupt Disable */
 
-#define CSR_STINT        !!((S)->aCSR[7] & 0x0800) /**< Software Timer Interrupt */
-#define CSR_STINTE       !!((S)->aCSR[7] & 0x0400) /**< Software Timer Interrupt Enable */
+#define CSR_STINT(S)     !!((S)->aCSR[7] & 0x0800) /**< Software Timer Interrupt */
+#define CSR_STINTE(S)    !!((S)->aCSR[7] & 0x0400) /**< Software Timer Interrupt Enable */
 
 #define CSR_DRX(S)       !!((S)->aCSR[15] & 0x0001) /**< Disable Receiver */
 #define CSR_DTX(S)       !!((S)->aCSR[15] & 0x0002) /**< Disable Transmit */
@@ -387,6 +387,7 @@ static uint8_t pcnet_pci_regs[PCI_REGSIZE];
 static void     pcnetAsyncTransmit(nic_t *dev);
 static void     pcnetPollRxTx(nic_t *dev);
 static void     pcnetUpdateIrq(nic_t *dev);
+static void     pcnetSoftIntArm(nic_t *dev);
 static uint16_t pcnet_bcr_readw(nic_t *dev, uint16_t rap);
 static void     pcnet_bcr_writew(nic_t *dev, uint16_t rap, uint16_t val);
 static void     pcnet_csr_writew(nic_t *dev, uint16_t rap, uint16_t val);
@@ -1736,6 +1737,10 @@ pcnetHardReset(nic_t *dev)
     dev->aBCR[BCR_PCISID]              = 0x0020;
     dev->aBCR[BCR_PCISVID]             = 0x1022;
 
+    /* Clear STINT and STINTE, which stops the software timer. */
+    dev->aCSR[7] = 0x0000;
+    pcnetSoftIntArm(dev);
+
     /* Reset the error counter. */
     dev->uCntBadRMD = 0;
 
@@ -1847,7 +1852,13 @@ pcnet_csr_writew(nic_t *dev, uint16_t rap, uint16_t val)
                 csr7 &= ~0x0400;
                 csr7 &= ~(val & 0x0800);
                 csr7 |= (val & 0x0400);
-                dev->aCSR[7] = csr7;
+                if ((csr7 ^ dev->aCSR[7]) & 0x0400) {
+                    dev->aCSR[7] = csr7;
+                    pcnetSoftIntArm(dev);
+                } else
+                    dev->aCSR[7] = csr7;
+                /* Acknowledging STINT drops the interrupt. */
+                pcnetUpdateIrq(dev);
             }
             return;
         case 15: /* Mode */
@@ -2022,8 +2033,7 @@ pcnet_bcr_writew(nic_t *dev, uint16_t rap, uint16_t val)
         case BCR_STVAL:
             val &= 0xffff;
             dev->aBCR[BCR_STVAL] = val;
-            if (dev->board == DEV_AM79C973)
-                timer_set_delay_u64(&dev->timer_soft_int, (12.8 * val) * TIMER_USEC);
+            pcnetSoftIntArm(dev);
             break;
 
         case BCR_MIIMDR:
@@ -2883,11 +2893,28 @@ pcnetSetLinkState(void *priv, uint32_t link_state)
     return 0;
 }
 
+/*
+ * The software timer lets a driver take one interrupt for a batch of frames
+ * instead of one per frame. It only runs while STINTE is set, so an idle
+ * driver does not wake the emulator every 12.8 * STVAL microseconds.
+ */
+static void
+pcnetSoftIntArm(nic_t *dev)
+{
+    if ((dev->board == DEV_AM79C973) && CSR_STINTE(dev) && (dev->aBCR[BCR_STVAL] & 0xffff))
+        timer_set_delay_u64(&dev->timer_soft_int, (12.8 * (dev->aBCR[BCR_STVAL] & 0xffff)) * TIMER_USEC);
+    else
+        timer_disable(&dev->timer_soft_int);
+}
+
 static void
 pcnetTimerSoftInt(void *priv)
 {
     nic_t *dev = (nic_t *) priv;
 
+    if (!CSR_STINTE(dev) || !(dev->aBCR[BCR_STVAL] & 0xffff))
+        return;
+
     dev->aCSR[7] |= 0x0800; /* STINT */
     pcnetUpdateIrq(dev);
     timer_advance_u64(&dev->timer_soft_int, (12.8 * (dev->aBCR[BCR_STVAL] & 0xffff)) * TIMER_USEC);
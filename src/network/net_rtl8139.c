@@ -45,6 +45,7 @@
 #include <86box/network.h>
 #include <86box/net_eeprom_nmc93cxx.h>
 #include <86box/nvr.h>
+#include <86box/video.h>
 #include "cpu.h"
 #include <86box/plat_unused.h>
 #include <86box/bswap.h>
@@ -447,7 +448,8 @@ struct RTL8139State {
 
     uint32_t TCTR;
     uint32_t TimerInt;
-    int64_t  TCTR_base;
+    uint64_t TCTR_base;   /* TSC at which TCTR held its stored value. */
+    uint64_t TimerInt_tsc; /* TSC at which TCTR reaches TimerInt. */
 
     /* Tally counters */
     RTL8139TallyCounters tally_counters;
@@ -800,19 +802,18 @@ rtl8139_do_receive(void *priv, uint8_t *buf, int size_)
                 s->RxRingAddrLO, cplus_rx_ring_desc);
 
         uint32_t val;
+        uint32_t desc[4];
         uint32_t rxdw0;
         uint32_t rxdw1;
         uint32_t rxbufLO;
         uint32_t rxbufHI;
 
-        dma_bm_read(cplus_rx_ring_desc, (uint8_t *) &val, 4, 4);
-        rxdw0 = val;
-        dma_bm_read(cplus_rx_ring_desc + 4, (uint8_t *) &val, 4, 4);
-        rxdw1 = val;
-        dma_bm_read(cplus_rx_ring_desc + 8, (uint8_t *) &val, 4, 4);
-        rxbufLO = val;
-        dma_bm_read(cplus_rx_ring_desc + 12, (uint8_t *) &val, 4, 4);
-        rxbufHI = val;
+        /* The whole descriptor in one bus master transfer. */
+        dma_bm_read(cplus_rx_ring_desc, (uint8_t *) desc, sizeof(desc), 4);
+        rxdw0   = le32_to_cpu(desc[0]);
+        rxdw1   = le32_to_cpu(desc[1]);
+        rxbufLO = le32_to_cpu(desc[2]);
+        rxbufHI = le32_to_cpu(desc[3]);
 
         rtl8139_log("+++ C+ mode RX descriptor %d %08x %08x %08x %08x\n",
                     descriptor, rxdw0, rxdw1, rxbufLO, rxbufHI);
@@ -935,10 +936,9 @@ rtl8139_do_receive(void *priv, uint8_t *buf, int size_)
         rxdw0 |= (size + 4);
 
         /* update ring data */
-        val = rxdw0;
-        dma_bm_write(cplus_rx_ring_desc, (uint8_t *) &val, 4, 4);
-        val = rxdw1;
-        dma_bm_write(cplus_rx_ring_desc + 4, (uint8_t *) &val, 4, 4);
+        desc[0] = cpu_to_le32(rxdw0);
+        desc[1] = cpu_to_le32(rxdw1);
+        dma_bm_write(cplus_rx_ring_desc, (uint8_t *) desc, 8, 4);
 
         /* update tally counter */
         ++s->tally_counters.RxOk;
@@ -1014,6 +1014,50 @@ rtl8139_reset_rxring(RTL8139State *s, uint32_t bufferSize)
     s->RxBufAddr    = 0;
 }
 
+/*
+ * TCTR counts PCI clocks. Rather than ticking it from a timer every clock,
+ * it is worked out from the TSC when read, and the timer only runs while
+ * TimerInt is set, to raise PCSTimeout when TCTR gets there.
+ */
+static uint32_t
+rtl8139_tctr(RTL8139State *s)
+{
+    if (!s->clock_enabled)
+        return s->TCTR;
+
+    return s->TCTR + (uint32_t) ((double) (tsc - s->TCTR_base) * (double) cpu_pci_speed / cpuclock);
+}
+
+static void
+rtl8139_arm_timer(RTL8139State *s)
+{
+    double us = (double) (int64_t) (s->TimerInt_tsc - tsc) * 1000000.0 / cpuclock;
+
+    /* Keep the delay well within range of the timer. */
+    if (us > 1000000.0)
+        us = 1000000.0;
+    else if (us < 1.0)
+        us = 1.0;
+
+    timer_set_delay_u64(&s->timer, us * TIMER_USEC);
+}
+
+static void
+rtl8139_set_next_tctr_time(RTL8139State *s)
+{
+    uint32_t clocks;
+
+    timer_disable(&s->timer);
+
+    if (!s->TimerInt || !s->clock_enabled)
+        return;
+
+    /* A TimerInt at or behind TCTR is only reached after a wrap. */
+    clocks = s->TimerInt - rtl8139_tctr(s);
+    s->TimerInt_tsc = tsc + (uint64_t) ((clocks ? (double) clocks : 4294967296.0) * cpuclock / (double) cpu_pci_speed);
+    rtl8139_arm_timer(s);
+}
+
 static void
 rtl8139_reset_phy(RTL8139State *s)
 {
@@ -1090,10 +1134,8 @@ rtl8139_reset(void *priv)
     /* also reset timer and disable timer interrupt */
     s->TCTR      = 0;
     s->TimerInt  = 0;
-    s->TCTR_base = 0;
-#if 0
+    s->TCTR_base = tsc;
     rtl8139_set_next_tctr_time(s);
-#endif
 
     /* reset tally counters */
     RTL8139TallyCounters_clear(&s->tally_counters);
@@ -1716,19 +1758,18 @@ rtl8139_cplus_transmit_one(RTL8139State *s)
                 s->TxAddr[0], cplus_tx_ring_desc);
 
     uint32_t val;
+    uint32_t desc[4];
     uint32_t txdw0;
     uint32_t txdw1;
     uint32_t txbufLO;
     uint32_t txbufHI;
 
-    dma_bm_read(cplus_tx_ring_desc, (uint8_t *) &val, 4, 4);
-    txdw0 = le32_to_cpu(val);
-    dma_bm_read(cplus_tx_ring_desc + 4, (uint8_t *) &val, 4, 4);
-    txdw1 = le32_to_cpu(val);
-    dma_bm_read(cplus_tx_ring_desc + 8, (uint8_t *) &val, 4, 4);
-    txbufLO = le32_to_cpu(val);
-    dma_bm_read(cplus_tx_ring_desc + 12, (uint8_t *) &val, 4, 4);
-    txbufHI = le32_to_cpu(val);
+    /* The whole descriptor in one bus master transfer. */
+    dma_bm_read(cplus_tx_ring_desc, (uint8_t *) desc, sizeof(desc), 4);
+    txdw0   = le32_to_cpu(desc[0]);
+    txdw1   = le32_to_cpu(desc[1]);
+    txbufLO = le32_to_cpu(desc[2]);
+    txbufHI = le32_to_cpu(desc[3]);
 
     rtl8139_log("+++ C+ mode TX descriptor %d %08x %08x %08x %08x\n", descriptor,
                 txdw0, txdw1, txbufLO, txbufHI);
@@ -2171,10 +2212,11 @@ rtl8139_transmit(RTL8139State *s)
     int descriptor = s->currTxDesc;
     int txcount    = 0;
 
-    /*while*/
-    if (rtl8139_transmit_one(s, descriptor)) {
+    /* Send every descriptor handed over so far, in order. */
+    while ((txcount < 4) && rtl8139_transmit_one(s, descriptor)) {
         ++s->currTxDesc;
         s->currTxDesc %= 4;
+        descriptor = s->currTxDesc;
         ++txcount;
     }
 
@@ -2521,11 +2563,15 @@ rtl8139_io_writeb(uint32_t addr, uint8_t val, void *priv)
 
         case HltClk:
             rtl8139_log("HltClk write val=0x%08x\n", val);
+            /* Freeze or restart TCTR where it is. */
+            s->TCTR      = rtl8139_tctr(s);
+            s->TCTR_base = tsc;
             if (val == 'R') {
                 s->clock_enabled = 1;
             } else if (val == 'H') {
                 s->clock_enabled = 0;
             }
+            rtl8139_set_next_tctr_time(s);
             break;
 
         case TxThresh:
@@ -2614,8 +2660,6 @@ rtl8139_io_writew(uint32_t addr, uint16_t val, void *priv)
     }
 }
 
-/* TODO: Implement timer. */
-
 static void
 rtl8139_io_writel(uint32_t addr, uint32_t val, void *priv)
 {
@@ -2660,17 +2704,17 @@ rtl8139_io_writel(uint32_t addr, uint32_t val, void *priv)
 
         case Timer:
             rtl8139_log("TCTR Timer reset on write\n");
-            s->TCTR = 0;
-#if 0
-            s->TCTR_base = qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL);
+            s->TCTR      = 0;
+            s->TCTR_base = tsc;
             rtl8139_set_next_tctr_time(s);
-#endif
             break;
 
         case FlashReg:
             rtl8139_log("FlashReg TimerInt write val=0x%08x\n", val);
-            if (s->TimerInt != val)
+            if (s->TimerInt != val) {
                 s->TimerInt = val;
+                rtl8139_set_next_tctr_time(s);
+            }
             break;
 
         default:
@@ -2894,11 +2938,7 @@ rtl8139_io_readl(uint32_t addr, void *priv)
             break;
 
         case Timer:
-#if 0
-            ret = (qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL) - s->TCTR_base) /
-                  PCI_PERIOD;
-#endif
-            ret = s->TCTR;
+            ret = rtl8139_tctr(s);
             rtl8139_log("TCTR Timer read val=0x%08x\n", ret);
             break;
 
@@ -3078,19 +3118,18 @@ rtl8139_timer(void *priv)
 {
     RTL8139State *s = priv;
 
-    timer_on_auto(&s->timer, 1000000.0 / ((double) cpu_pci_speed));
-
-    if (!s->clock_enabled) {
-        rtl8139_log(">>> timer: clock is not running\n");
+    /* Long intervals are waited out in steps. */
+    if ((int64_t) (tsc - s->TimerInt_tsc) < 0) {
+        rtl8139_arm_timer(s);
         return;
     }
 
-    s->TCTR++;
+    s->IntrStatus |= PCSTimeout;
+    rtl8139_update_irq(s);
 
-    if (s->TCTR == s->TimerInt && s->TimerInt != 0) {
-        s->IntrStatus |= PCSTimeout;
-        rtl8139_update_irq(s);
-    }
+    /* TCTR keeps counting and comes around again after a wrap. */
+    s->TimerInt_tsc += (uint64_t) (4294967296.0 * cpuclock / (double) cpu_pci_speed);
+    rtl8139_arm_timer(s);
 }
 
 static uint8_t
@@ -3297,7 +3336,6 @@ nic_init(const device_t *info)
 
     s->nic = network_attach(s, (uint8_t *) &s->phys[MAC0], rtl8139_do_receive, rtl8139_set_link_status);
     timer_add(&s->timer, rtl8139_timer, s, 0);
-    timer_on_auto(&s->timer, 1000000.0 / cpu_pci_speed);
 
     s->cplus_txbuffer        = NULL;
     s->cplus_txbuffer_len    = 0;
@@ -3309,6 +3347,9 @@ nic_init(const device_t *info)
 static void
 nic_close(void *priv)
 {
+    RTL8139State *s = (RTL8139State *) priv;
+
+    timer_disable(&s->timer);
     free(priv);
 }
 
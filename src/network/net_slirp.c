@@ -47,10 +47,15 @@
 #    include <windows.h>
 #else
 #    include <poll.h>
+#    include <sys/socket.h>
 #endif
 #include <86box/net_event.h>
 
-#define SLIRP_PKT_BATCH NET_QUEUE_LEN
+#define SLIRP_PKT_BATCH NET_QUEUE_BATCH
+
+/* Host socket buffer size, large enough for a few hundred kB in flight per
+   connection instead of the OS default. */
+#define SLIRP_SOCK_BUF (256 * 1024)
 
 enum {
     NET_EVENT_STOP = 0,
@@ -161,8 +166,14 @@ net_slirp_register_poll_socket(slirp_os_socket fd, void *opaque)
 net_slirp_register_poll_fd(int fd, void *opaque)
 #endif
 {
-    (void) fd;
+    int size = SLIRP_SOCK_BUF;
+
     (void) opaque;
+
+    /* Called for every socket libslirp creates, including the ones
+       accepted on forwarded ports. */
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, (const char *) &size, sizeof(size));
+    setsockopt(fd, SOL_SOCKET, SO_SNDBUF, (const char *) &size, sizeof(size));
 }
 
 static void
@@ -190,16 +201,22 @@ ssize_t
 net_slirp_send_packet(const void *qp, size_t pkt_len, void *opaque)
 {
     net_slirp_t *slirp = (net_slirp_t *) opaque;
+    netpkt_t    *slot;
 
     slirp_log("SLiRP: received %d-byte packet\n", pkt_len);
 
-    memcpy(slirp->pkt.data, (uint8_t *) qp, pkt_len);
-    slirp->pkt.len = pkt_len;
+    if (pkt_len > NET_MAX_FRAME)
+        return pkt_len;
+
     if (slirp->during_tx) {
+        memcpy(slirp->pkt.data, (uint8_t *) qp, pkt_len);
+        slirp->pkt.len = pkt_len;
         network_rx_on_tx_put_pkt(slirp->card, &slirp->pkt);
         slirp->recv_on_tx = 1;
-    } else
-        network_rx_put_pkt(slirp->card, &slirp->pkt);
+    } else if ((slot = network_rx_reserve(slirp->card)) != NULL) {
+        memcpy(slot->data, (uint8_t *) qp, pkt_len);
+        network_rx_commit(slirp->card, (int) pkt_len);
+    }
 
     return pkt_len;
 }
@@ -367,6 +384,26 @@ net_slirp_rx_deferred_packets(net_slirp_t *slirp)
     }
 }
 
+/* Feed everything the card has queued to the stack, not just one batch,
+   so a burst from the guest costs a single wakeup. */
+static void
+net_slirp_tx(net_slirp_t *slirp)
+{
+    int packets;
+
+    slirp->during_tx = 1;
+    while ((packets = network_tx_popv(slirp->card, slirp->pkt_tx_v, SLIRP_PKT_BATCH)) > 0) {
+        for (int i = 0; i < packets; i++)
+            net_slirp_in(slirp, slirp->pkt_tx_v[i].data, slirp->pkt_tx_v[i].len);
+
+        if (packets < SLIRP_PKT_BATCH)
+            break;
+    }
+    slirp->during_tx = 0;
+
+    net_slirp_rx_deferred_packets(slirp);
+}
+
 #ifdef _WIN32
 static void
 net_slirp_thread(void *priv)
@@ -398,15 +435,7 @@ net_slirp_thread(void *priv)
                 break;
 
             case NET_EVENT_TX:
-                {
-                    slirp->during_tx = 1;
-                    int packets = network_tx_popv(slirp->card, slirp->pkt_tx_v, SLIRP_PKT_BATCH);
-                    for (int i = 0; i < packets; i++)
-                        net_slirp_in(slirp, slirp->pkt_tx_v[i].data, slirp->pkt_tx_v[i].len);
-                    slirp->during_tx = 0;
-
-                    net_slirp_rx_deferred_packets(slirp);
-                }
+                net_slirp_tx(slirp);
                 break;
 
             default:
@@ -451,14 +480,7 @@ net_slirp_thread(void *priv)
 
         if (slirp->pfd[NET_EVENT_TX].revents & POLLIN) {
             net_event_clear(&slirp->tx_event);
-
-            slirp->during_tx = 1;
-            int packets = network_tx_popv(slirp->card, slirp->pkt_tx_v, SLIRP_PKT_BATCH);
-            for (int i = 0; i < packets; i++)
-                net_slirp_in(slirp, slirp->pkt_tx_v[i].data, slirp->pkt_tx_v[i].len);
-            slirp->during_tx = 0;
-
-            net_slirp_rx_deferred_packets(slirp);
+            net_slirp_tx(slirp);
         }
     }
 
@@ -604,7 +626,7 @@ net_slirp_init(const netcard_t *card, const uint8_t *mac_addr, UNUSED(void *priv
     }
 
     slirp_log("SLiRP: creating thread...\n");
-    slirp->poll_tid = thread_create(net_slirp_thread, slirp);
+    slirp->poll_tid = thread_create_role(net_slirp_thread, slirp, THREAD_ROLE_NETWORK);
 
     slirp_card_num++;
     return slirp;
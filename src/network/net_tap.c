@@ -0,0 +1,259 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Linux TAP network provider.
+ *
+ *          Attaches a card to a TAP interface, which can then be added
+ *          to a bridge on the host. The interface is best created ahead
+ *          of time and owned by the user running the emulator, as with
+ *          "ip tuntap add dev tap0 mode tap user $USER", in which case
+ *          no extra privileges are needed.
+ *
+ *          The kernel hands out one frame per read(), so received frames
+ *          are read straight into the receive ring until the interface
+ *          runs dry, and transmits are written out a batch per wakeup.
+ */
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <net/if.h>
+#include <linux/if_tun.h>
+
+#define HAVE_STDARG_H
+#include <86box/86box.h>
+#include <86box/device.h>
+#include <86box/plat.h>
+#include <86box/thread.h>
+#include <86box/timer.h>
+#include <86box/network.h>
+#include <86box/net_event.h>
+
+#define TAP_PKT_BATCH NET_QUEUE_BATCH
+
+enum {
+    NET_EVENT_STOP = 0,
+    NET_EVENT_TX,
+    NET_EVENT_RX,
+    NET_EVENT_MAX
+};
+
+typedef struct net_tap_t {
+    int        fd;
+    netcard_t *card;
+    thread_t  *poll_tid;
+    net_evt_t  tx_event;
+    net_evt_t  stop_event;
+    netpkt_t   pkt; /* Drains frames while the receive ring is full. */
+    netpkt_t   pktv[TAP_PKT_BATCH];
+} net_tap_t;
+
+#ifdef ENABLE_TAP_LOG
+int tap_do_log = ENABLE_TAP_LOG;
+
+static void
+tap_log(const char *fmt, ...)
+{
+    va_list ap;
+
+    if (tap_do_log) {
+        va_start(ap, fmt);
+        pclog_ex(fmt, ap);
+        va_end(ap);
+    }
+}
+#else
+#    define tap_log(fmt, ...)
+#endif
+
+static void
+net_tap_rx(net_tap_t *tap)
+{
+    while (1) {
+        netpkt_t *slot = network_rx_reserve(tap->card);
+        ssize_t   len;
+
+        if (slot != NULL) {
+            len = read(tap->fd, slot->data, NET_MAX_FRAME);
+            network_rx_commit(tap->card, (int) len);
+        } else
+            len = read(tap->fd, tap->pkt.data, NET_MAX_FRAME);
+
+        if (len <= 0)
+            break;
+    }
+}
+
+static void
+net_tap_tx(net_tap_t *tap)
+{
+    int packets;
+
+    while ((packets = network_tx_popv(tap->card, tap->pktv, TAP_PKT_BATCH)) > 0) {
+        for (int i = 0; i < packets; i++) {
+            if (write(tap->fd, tap->pktv[i].data, tap->pktv[i].len) < 0) {
+                tap_log("TAP: write failed (%s)\n", strerror(errno));
+                network_tx_failed(tap->card, 1);
+            }
+        }
+
+        if (packets < TAP_PKT_BATCH)
+            break;
+    }
+}
+
+static void
+net_tap_thread(void *priv)
+{
+    net_tap_t *tap = (net_tap_t *) priv;
+
+    tap_log("TAP: polling started.\n");
+
+    struct pollfd pfd[NET_EVENT_MAX];
+    pfd[NET_EVENT_STOP].fd     = net_event_get_fd(&tap->stop_event);
+    pfd[NET_EVENT_STOP].events = POLLIN | POLLPRI;
+
+    pfd[NET_EVENT_TX].fd     = net_event_get_fd(&tap->tx_event);
+    pfd[NET_EVENT_TX].events = POLLIN | POLLPRI;
+
+    pfd[NET_EVENT_RX].fd     = tap->fd;
+    pfd[NET_EVENT_RX].events = POLLIN;
+
+    while (1) {
+        poll(pfd, NET_EVENT_MAX, -1);
+
+        if (pfd[NET_EVENT_STOP].revents & POLLIN) {
+            net_event_clear(&tap->stop_event);
+            break;
+        }
+
+        if (pfd[NET_EVENT_TX].revents & POLLIN) {
+            net_event_clear(&tap->tx_event);
+            net_tap_tx(tap);
+        }
+
+        if (pfd[NET_EVENT_RX].revents & POLLIN)
+            net_tap_rx(tap);
+
+        /* The interface was deleted from under us. */
+        if (pfd[NET_EVENT_RX].revents & (POLLERR | POLLHUP | POLLNVAL)) {
+            tap_log("TAP: interface gone\n");
+            break;
+        }
+    }
+
+    tap_log("TAP: polling stopped.\n");
+}
+
+int
+net_tap_prepare(void)
+{
+    if (access("/dev/net/tun", R_OK | W_OK) != 0) {
+        tap_log("TAP: /dev/net/tun is not available\n");
+        return -1;
+    }
+
+    return 0;
+}
+
+static void
+net_tap_error(char *errbuf, const char *message)
+{
+    strncpy(errbuf, message, NET_DRV_ERRBUF_SIZE);
+    tap_log("TAP: %s\n", message);
+}
+
+static void *
+net_tap_init(const netcard_t *card, UNUSED(const uint8_t *mac_addr), void *priv, char *netdrv_errbuf)
+{
+    char        *intf_name = (char *) priv;
+    char         buf[NET_DRV_ERRBUF_SIZE];
+    struct ifreq ifr;
+
+    if ((intf_name[0] == '\0') || !strcmp(intf_name, "none")) {
+        net_tap_error(netdrv_errbuf, "No interface configured");
+        return NULL;
+    }
+
+    net_tap_t *tap = calloc(1, sizeof(net_tap_t));
+    tap->card      = (netcard_t *) card;
+
+    if ((tap->fd = open("/dev/net/tun", O_RDWR | O_NONBLOCK | O_CLOEXEC)) < 0) {
+        snprintf(buf, NET_DRV_ERRBUF_SIZE, "Unable to open /dev/net/tun (%s)", strerror(errno));
+        net_tap_error(netdrv_errbuf, buf);
+        free(tap);
+        return NULL;
+    }
+
+    memset(&ifr, 0x00, sizeof(ifr));
+    ifr.ifr_flags = IFF_TAP | IFF_NO_PI;
+    strncpy(ifr.ifr_name, intf_name, IFNAMSIZ - 1);
+    if (ioctl(tap->fd, TUNSETIFF, &ifr) < 0) {
+        snprintf(buf, NET_DRV_ERRBUF_SIZE, "Unable to attach to %s (%s)", intf_name, strerror(errno));
+        net_tap_error(netdrv_errbuf, buf);
+        close(tap->fd);
+        free(tap);
+        return NULL;
+    }
+    tap_log("TAP: attached to %s\n", ifr.ifr_name);
+
+    for (int i = 0; i < TAP_PKT_BATCH; i++)
+        tap->pktv[i].data = calloc(1, NET_MAX_FRAME);
+    tap->pkt.data = calloc(1, NET_MAX_FRAME);
+
+    net_event_init(&tap->tx_event);
+    net_event_init(&tap->stop_event);
+    tap->poll_tid = thread_create_role(net_tap_thread, tap, THREAD_ROLE_NETWORK);
+
+    return tap;
+}
+
+static void
+net_tap_in_available(void *priv)
+{
+    net_tap_t *tap = (net_tap_t *) priv;
+
+    net_event_set(&tap->tx_event);
+}
+
+static void
+net_tap_close(void *priv)
+{
+    if (!priv)
+        return;
+
+    net_tap_t *tap = (net_tap_t *) priv;
+
+    tap_log("TAP: closing.\n");
+
+    net_event_set(&tap->stop_event);
+    thread_wait(tap->poll_tid);
+
+    for (int i = 0; i < TAP_PKT_BATCH; i++)
+        free(tap->pktv[i].data);
+    free(tap->pkt.data);
+
+    close(tap->fd);
+    net_event_close(&tap->tx_event);
+    net_event_close(&tap->stop_event);
+
+    free(tap);
+}
+
+const netdrv_t net_tap_drv = {
+    .notify_in = &net_tap_in_available,
+    .init      = &net_tap_init,
+    .close     = &net_tap_close,
+    .priv      = NULL
+};
@@ -175,6 +175,15 @@
 
 #define CSR11_CON                    BIT(16)
 #define CSR11_TIMER_MASK             0xffff
+#define CSR11_NRP_SHIFT              17
+#define CSR11_NRP_MASK               7
+#define CSR11_RT_SHIFT               20
+#define CSR11_RT_MASK                0xf
+#define CSR11_NTP_SHIFT              24
+#define CSR11_NTP_MASK               7
+#define CSR11_TT_SHIFT               27
+#define CSR11_TT_MASK                0xf
+#define CSR11_CS                     BIT(31)
 
 #define CSR12_MRA                    BIT(0)
 #define CSR12_LS100                  BIT(1)
@@ -338,6 +347,13 @@ struct TULIPState {
     uint32_t bios_addr;
     uint8_t  filter[16][6];
     int      has_bios;
+
+    /* 21143 interrupt mitigation, see tulip_mit_frame(). */
+    int        mit_enabled;
+    uint8_t    rx_mit_count;
+    uint8_t    tx_mit_count;
+    pc_timer_t rx_mit_timer;
+    pc_timer_t tx_mit_timer;
 };
 
 typedef struct TULIPState TULIPState;
@@ -346,10 +362,8 @@ static void
 tulip_desc_read(TULIPState *s, uint32_t p,
                 struct tulip_descriptor *desc)
 {
-    desc->status    = mem_readl_phys(p);
-    desc->control   = mem_readl_phys(p + 4);
-    desc->buf_addr1 = mem_readl_phys(p + 8);
-    desc->buf_addr2 = mem_readl_phys(p + 12);
+    /* The whole descriptor in one bus master transfer. */
+    dma_bm_read(p, (uint8_t *) desc, sizeof(struct tulip_descriptor), 4);
 
     if (s->csr[0] & CSR0_DBO) {
         bswap32s(&desc->status);
@@ -363,17 +377,16 @@ static void
 tulip_desc_write(TULIPState *s, uint32_t p,
                  struct tulip_descriptor *desc)
 {
+    struct tulip_descriptor out = *desc;
+
     if (s->csr[0] & CSR0_DBO) {
-        mem_writel_phys(p, bswap32(desc->status));
-        mem_writel_phys(p + 4, bswap32(desc->control));
-        mem_writel_phys(p + 8, bswap32(desc->buf_addr1));
-        mem_writel_phys(p + 12, bswap32(desc->buf_addr2));
-    } else {
-        mem_writel_phys(p, desc->status);
-        mem_writel_phys(p + 4, desc->control);
-        mem_writel_phys(p + 8, desc->buf_addr1);
-        mem_writel_phys(p + 12, desc->buf_addr2);
+        bswap32s(&out.status);
+        bswap32s(&out.control);
+        bswap32s(&out.buf_addr1);
+        bswap32s(&out.buf_addr2);
     }
+
+    dma_bm_write(p, (uint8_t *) &out, sizeof(struct tulip_descriptor), 4);
 }
 
 static void
@@ -399,6 +412,85 @@ tulip_update_int(TULIPState *s)
         pci_set_irq(s->pci_slot, PCI_INTA, &s->irq_state);
 }
 
+/*
+ * With mitigation programmed into CSR11, RI and TI are held back until
+ * either the packet count or the timer for that direction runs out. The
+ * timers count in cycles of 81.92 us, or 5.12 us with the cycle size bit
+ * set, and the transmit one in units of 16 cycles. A timer of 0 turns
+ * mitigation off for its direction.
+ */
+static void
+tulip_mit_frame(TULIPState *s, int tx)
+{
+    double      cycle = (s->csr[11] & CSR11_CS) ? 5.12 : 81.92;
+    uint32_t    status = tx ? CSR5_TI : CSR5_RI;
+    uint32_t    timer;
+    uint32_t    limit;
+    uint8_t    *count;
+    pc_timer_t *t;
+
+    if (tx) {
+        timer = ((s->csr[11] >> CSR11_TT_SHIFT) & CSR11_TT_MASK) * 16;
+        limit = (s->csr[11] >> CSR11_NTP_SHIFT) & CSR11_NTP_MASK;
+        count = &s->tx_mit_count;
+        t     = &s->tx_mit_timer;
+    } else {
+        timer = (s->csr[11] >> CSR11_RT_SHIFT) & CSR11_RT_MASK;
+        limit = (s->csr[11] >> CSR11_NRP_SHIFT) & CSR11_NRP_MASK;
+        count = &s->rx_mit_count;
+        t     = &s->rx_mit_timer;
+    }
+
+    if (s->mit_enabled && timer) {
+        if (!limit || (++(*count) < limit)) {
+            if (!timer_is_on(t))
+                timer_set_delay_u64(t, (cycle * timer) * TIMER_USEC);
+            return;
+        }
+
+        timer_disable(t);
+    }
+
+    *count = 0;
+    s->csr[5] |= status;
+    tulip_update_int(s);
+}
+
+static void
+tulip_rx_mit_timer(void *priv)
+{
+    TULIPState *s = (TULIPState *) priv;
+
+    s->rx_mit_count = 0;
+    s->csr[5] |= CSR5_RI;
+    tulip_update_int(s);
+}
+
+static void
+tulip_tx_mit_timer(void *priv)
+{
+    TULIPState *s = (TULIPState *) priv;
+
+    s->tx_mit_count = 0;
+    s->csr[5] |= CSR5_TI;
+    tulip_update_int(s);
+}
+
+/* Raise whatever the mitigation timers are still holding back. */
+static void
+tulip_mit_flush(TULIPState *s)
+{
+    if (timer_is_on(&s->rx_mit_timer)) {
+        timer_disable(&s->rx_mit_timer);
+        tulip_rx_mit_timer(s);
+    }
+
+    if (timer_is_on(&s->tx_mit_timer)) {
+        timer_disable(&s->tx_mit_timer);
+        tulip_tx_mit_timer(s);
+    }
+}
+
 static bool
 tulip_rx_stopped(TULIPState *s)
 {
@@ -532,12 +624,11 @@ tulip_receive(void *priv, uint8_t *buf, int size)
 
         tulip_copy_rx_bytes(s, &desc);
 
-        if (!s->rx_frame_len) {
+        if (!s->rx_frame_len)
             desc.status |= s->rx_status;
-            s->csr[5] |= CSR5_RI;
-            tulip_update_int(s);
-        }
         tulip_desc_write(s, s->current_rx_desc, &desc);
+        if (!s->rx_frame_len)
+            tulip_mit_frame(s, 0);
         tulip_next_rx_descriptor(s, &desc);
         first = 0;
     } while (s->rx_frame_len);
@@ -747,10 +838,8 @@ tulip_tx(TULIPState *s, struct tulip_descriptor *desc)
         }
     }
 
-    if (desc->control & TDES1_IC) {
-        s->csr[5] |= CSR5_TI;
-        tulip_update_int(s);
-    }
+    if (desc->control & TDES1_IC)
+        tulip_mit_frame(s, 1);
 }
 
 static int
@@ -906,6 +995,15 @@ tulip_reset(void *priv)
     s->csr[13]                  = 0xffff0000;
     s->csr[14]                  = 0xffffffff;
     s->csr[15]                  = 0x8ff00000;
+
+    /* The reset value of CSR11 has every mitigation field set, so only
+       honour them once the driver has programmed the register. */
+    s->mit_enabled  = 0;
+    s->rx_mit_count = 0;
+    s->tx_mit_count = 0;
+    timer_disable(&s->rx_mit_timer);
+    timer_disable(&s->tx_mit_timer);
+
     if (s->device_info->local != 3) {
         s->subsys_id                = eeprom_data[1];
         s->subsys_ven_id            = eeprom_data[0];
@@ -997,6 +1095,11 @@ tulip_write(uint32_t addr, uint32_t data, void *opaque)
 
         case CSR(11):
             s->csr[11] = data;
+            /* Only the 21143 has interrupt mitigation. */
+            if (s->device_info->local == 0) {
+                tulip_mit_flush(s);
+                s->mit_enabled = 1;
+            }
             break;
 
         case CSR(12):
@@ -1650,6 +1753,8 @@ nic_init(const device_t *info)
     //pclog("EEPROM Data Format=%02x, Count=%02x, MAC=%02x:%02x:%02x:%02x:%02x:%02x.\n", eeprom_data[0x12], eeprom_data[0x13], eeprom_data[0x14], eeprom_data[0x15], eeprom_data[0x16], eeprom_data[0x17], eeprom_data[0x18], eeprom_data[0x19]);
     memcpy(s->mii_regs, tulip_mdi_default, sizeof(tulip_mdi_default));
     s->nic = network_attach(s, &eeprom_data[(info->local == 3) ? 0 : 20], tulip_receive, NULL);
+    timer_add(&s->rx_mit_timer, tulip_rx_mit_timer, s, 0);
+    timer_add(&s->tx_mit_timer, tulip_tx_mit_timer, s, 0);
     pci_add_card(PCI_ADD_NORMAL, tulip_pci_read, tulip_pci_write, s, &s->pci_slot);
     tulip_reset(s);
     return s;
@@ -1658,6 +1763,10 @@ nic_init(const device_t *info)
 static void
 nic_close(void *priv)
 {
+    TULIPState *s = (TULIPState *) priv;
+
+    timer_disable(&s->rx_mit_timer);
+    timer_disable(&s->tx_mit_timer);
     free(priv);
 }
 
@@ -46,7 +46,7 @@
 #include <86box/network.h>
 #include <86box/net_event.h>
 
-#define VDE_PKT_BATCH NET_QUEUE_LEN
+#define VDE_PKT_BATCH NET_QUEUE_BATCH
 #define VDE_DESCRIPTION "86Box virtual card"
 
 enum {
@@ -153,17 +153,23 @@ static void net_vde_thread(void *priv) {
             int packets = network_tx_popv(vde->card, vde->pktv, VDE_PKT_BATCH);
             for (int i=0; i<packets; i++) {
                 int nc = f_vde_send(vde->vdeconn, vde->pktv[i].data,vde->pktv[i].len, 0 );
-                if (nc == 0) {
+                if (nc <= 0) {
                     vde_log("VDE: Problem, no bytes sent.\n");
+                    network_tx_failed(vde->card, 1);
                 }
             }
         }
 
         // Packets are available for reading. Read packet and queue it
         if (pfd[NET_EVENT_RX].revents & POLLIN) {
-            int nc = f_vde_recv(vde->vdeconn, vde->pkt.data, NET_MAX_FRAME, 0);
-            vde->pkt.len = nc;
-            network_rx_put_pkt(vde->card, &vde->pkt);
+            netpkt_t *slot = network_rx_reserve(vde->card);
+
+            /* Receive straight into the ring, or drain the packet if it is full. */
+            if (slot != NULL) {
+                int nc = f_vde_recv(vde->vdeconn, slot->data, NET_MAX_FRAME, 0);
+                network_rx_commit(vde->card, nc);
+            } else
+                (void) f_vde_recv(vde->vdeconn, vde->pkt.data, NET_MAX_FRAME, 0);
         }
 
         // We have been told to close
@@ -293,7 +299,7 @@ void *net_vde_init(const netcard_t *card, const uint8_t *mac_addr, void *priv, c
     vde->pkt.data = calloc(1,NET_MAX_FRAME);
     net_event_init(&vde->tx_event);
     net_event_init(&vde->stop_event);
-    vde->poll_tid = thread_create(net_vde_thread, vde);     // Fire up the read-write thread!
+    vde->poll_tid = thread_create_role(net_vde_thread, vde, THREAD_ROLE_NETWORK);     // Fire up the read-write thread!
 
     return vde;
 }
@@ -49,6 +49,7 @@
 #include <stdarg.h>
 #include <stdatomic.h>
 #include <stdint.h>
+#include <inttypes.h>
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
@@ -66,7 +67,11 @@
 #include <86box/thread.h>
 #include <86box/ui.h>
 #include <86box/timer.h>
+#include <86box/spsc.h>
 #include <86box/network.h>
+#include <86box/perf.h>
+#include <86box/replay.h>
+#include <minitrace/minitrace.h>
 #include <86box/net_ne2000.h>
 #include <86box/net_pcnet.h>
 #include <86box/net_wd8003.h>
@@ -126,6 +131,17 @@ uint16_t       net_card_current = 0;
 network_devmap_t network_devmap = {0};
 int  network_ndev;
 netdev_t network_devs[NET_HOST_INTF_MAX];
+int      net_stats_interval = 0;
+uint32_t network_stats_seq;
+
+/* Runs of the card timer without traffic before it is stopped. */
+#define NET_IDLE_POLLS 50
+
+/* Local variables. */
+static netcard_t *net_cards_attached[NET_CARD_MAX];
+static atomic_uint net_tx_errors[NET_CARD_MAX];
+static uint32_t    net_stats_ticks;
+static uint32_t    net_stats_log_ticks;
 
 /* Local variables. */
 #ifdef ENABLE_NETWORK_LOG
@@ -235,6 +251,11 @@ network_init(void)
         network_devmap.has_vde = 1;
 #endif
 
+#ifdef HAS_TAP
+    if (!net_tap_prepare())
+        network_devmap.has_tap = 1;
+#endif
+
 #ifdef ENABLE_NETWORK_LOG
     /* Start packet dump. */
     network_dump = fopen("network.pcap", "wb");
@@ -269,26 +290,58 @@ network_init(void)
 #endif
 }
 
-void
-network_queue_init(netqueue_t *queue)
+/*
+ * Each queue has one producer and one consumer thread:
+ *
+ * NET_QUEUE_TX_VM:    both ends on the CPU thread.
+ * NET_QUEUE_TX_HOST:  CPU thread to the host driver thread.
+ * NET_QUEUE_RX:       host driver thread to the CPU thread. Cards that loop
+ *                     frames back also produce from the CPU thread, so the
+ *                     producers serialize on rx_mutex.
+ * NET_QUEUE_RX_ON_TX: both ends on the host driver thread.
+ *
+ * Packets are handed over by swapping buffers with the slot, so nothing is
+ * copied on the way through.
+ *
+ * The rings that cross threads stamp each slot when it is filled, so the
+ * time packets wait for the other side can be told apart from the time
+ * spent in the card or the host driver.
+ */
+struct netqueue_t {
+    spsc_t      ring;
+    netpkt_t   *packets;
+    uint64_t   *stamps; /* NULL if not timed. */
+    atomic_uint drops;
+    atomic_uint max_used;
+    atomic_uint wait_us;
+    atomic_uint waited;
+};
+
+static netqueue_t *
+network_queue_init(uint32_t size, int timed)
 {
-    queue->head = queue->tail = 0;
-    for (int i = 0; i < NET_QUEUE_LEN; i++) {
+    netqueue_t *queue = (netqueue_t *) calloc(1, sizeof(netqueue_t));
+
+    spsc_init(&queue->ring, size, 0, NULL, NULL);
+    queue->packets = (netpkt_t *) calloc(size, sizeof(netpkt_t));
+    if (timed)
+        queue->stamps = (uint64_t *) calloc(size, sizeof(uint64_t));
+    for (uint32_t i = 0; i < size; i++)
         queue->packets[i].data = calloc(1, NET_MAX_FRAME);
-        queue->packets[i].len  = 0;
-    }
+
+    return queue;
 }
 
 static bool
 network_queue_full(netqueue_t *queue)
 {
-    return ((queue->head + 1) & NET_QUEUE_LEN_MASK) == queue->tail;
+    return spsc_entries(&queue->ring) >= queue->ring.size;
 }
 
 static bool
 network_queue_empty(netqueue_t *queue)
 {
-    return (queue->head == queue->tail);
+    return spsc_empty(&queue->ring);
 }
 
 static inline void
@@ -299,21 +352,53 @@ network_swap_packet(netpkt_t *pkt1, netpkt_t *pkt2)
     *pkt1        = tmp;
 }
 
-int
+/* Producer side, publishes the slot at the write position. */
+static void
+network_queue_push(netqueue_t *queue)
+{
+    uint32_t used;
+
+    if (queue->stamps)
+        queue->stamps[spsc_write_pos(&queue->ring)] = plat_get_ticks_us();
+    spsc_push(&queue->ring);
+
+    used = spsc_entries(&queue->ring);
+    if (used > atomic_load_explicit(&queue->max_used, memory_order_relaxed))
+        atomic_store_explicit(&queue->max_used, used, memory_order_relaxed);
+}
+
+/* Consumer side, frees the slot at the read position. */
+static void
+network_queue_pop(netqueue_t *queue)
+{
+    if (queue->stamps) {
+        uint32_t us = (uint32_t) (plat_get_ticks_us() - queue->stamps[spsc_read_pos(&queue->ring)]);
+
+        atomic_fetch_add_explicit(&queue->wait_us, us, memory_order_relaxed);
+        atomic_fetch_add_explicit(&queue->waited, 1, memory_order_relaxed);
+    }
+    spsc_pop(&queue->ring);
+}
+
+static int
 network_queue_put(netqueue_t *queue, uint8_t *data, int len)
 {
-    if (len == 0 || len > NET_MAX_FRAME || network_queue_full(queue)) {
+    if (len == 0 || len > NET_MAX_FRAME)
+        return 0;
+
+    if (network_queue_full(queue)) {
+        atomic_fetch_add_explicit(&queue->drops, 1, memory_order_relaxed);
         return 0;
     }
 
-    netpkt_t *pkt = &queue->packets[queue->head];
+    netpkt_t *pkt = &queue->packets[spsc_write_pos(&queue->ring)];
     memcpy(pkt->data, data, len);
-    pkt->len    = len;
-    queue->head = (queue->head + 1) & NET_QUEUE_LEN_MASK;
+    pkt->len = len;
+    network_queue_push(queue);
     return 1;
 }
 
-int
+static int
 network_queue_put_swap(netqueue_t *queue, netpkt_t *src_pkt)
 {
     if (src_pkt->len == 0 || src_pkt->len > NET_MAX_FRAME || network_queue_full(queue)) {
@@ -326,13 +411,15 @@ network_queue_put_swap(netqueue_t *queue, netpkt_t *src_pkt)
             network_log("Discarded %d bytes packet because the queue is full.\n", src_pkt->len);
         }
 #endif
+        if (src_pkt->len && (src_pkt->len <= NET_MAX_FRAME))
+            atomic_fetch_add_explicit(&queue->drops, 1, memory_order_relaxed);
         return 0;
     }
 
-    netpkt_t *dst_pkt = &queue->packets[queue->head];
+    netpkt_t *dst_pkt = &queue->packets[spsc_write_pos(&queue->ring)];
     network_swap_packet(src_pkt, dst_pkt);
 
-    queue->head = (queue->head + 1) & NET_QUEUE_LEN_MASK;
+    network_queue_push(queue);
     return 1;
 }
 
@@ -342,9 +429,9 @@ network_queue_get_swap(netqueue_t *queue, netpkt_t *dst_pkt)
     if (network_queue_empty(queue))
         return 0;
 
-    netpkt_t *src_pkt = &queue->packets[queue->tail];
+    netpkt_t *src_pkt = &queue->packets[spsc_read_pos(&queue->ring)];
     network_swap_packet(src_pkt, dst_pkt);
-    queue->tail = (queue->tail + 1) & NET_QUEUE_LEN_MASK;
+    network_queue_pop(queue);
     return 1;
 }
 
@@ -358,30 +445,85 @@ network_queue_move(netqueue_t *dst_q, netqueue_t *src_q)
         return 0;
     }
 
-    netpkt_t *src_pkt = &src_q->packets[src_q->tail];
-    netpkt_t *dst_pkt = &dst_q->packets[dst_q->head];
+    netpkt_t *src_pkt = &src_q->packets[spsc_read_pos(&src_q->ring)];
+    netpkt_t *dst_pkt = &dst_q->packets[spsc_write_pos(&dst_q->ring)];
 
     network_swap_packet(src_pkt, dst_pkt);
-    dst_q->head = (dst_q->head + 1) & NET_QUEUE_LEN_MASK;
-    src_q->tail = (src_q->tail + 1) & NET_QUEUE_LEN_MASK;
+    network_queue_push(dst_q);
+    network_queue_pop(src_q);
 
     return dst_pkt->len;
 }
 
-void
+static void
 network_queue_clear(netqueue_t *queue)
 {
-    for (int i = 0; i < NET_QUEUE_LEN; i++) {
+    for (uint32_t i = 0; i < queue->ring.size; i++)
         free(queue->packets[i].data);
-        queue->packets[i].len = 0;
+    free(queue->packets);
+    free(queue->stamps);
+    free(queue);
+}
+
+/* Swaps address from for to in the Ethernet header, and in the body of an
+   ARP packet, which names the hardware addresses again. */
+static void
+network_mac_translate(uint8_t *data, int len, const uint8_t *from, const uint8_t *to)
+{
+    if (len < 14)
+        return;
+
+    for (int off = 0; off <= 6; off += 6) {
+        if (!memcmp(&data[off], from, 6))
+            memcpy(&data[off], to, 6);
+    }
+
+    if ((len >= 42) && (data[12] == 0x08) && (data[13] == 0x06)) {
+        if (!memcmp(&data[22], from, 6))
+            memcpy(&data[22], to, 6);
+        if (!memcmp(&data[32], from, 6))
+            memcpy(&data[32], to, 6);
+    }
+}
+
+/*
+ * The card timer moves packets between the rings and the card, paced to
+ * the speed of the link. It only runs while there is traffic and for a
+ * short while after, so replies do not wait for network_poll(), and an
+ * idle card does not wake the emulator at all.
+ */
+/* Takes the next frame the host received, or the one a replay has in its place. */
+static int
+network_rx_next(netcard_t *card)
+{
+    netqueue_t *queue = card->queues[NET_QUEUE_RX];
+    int         len;
+
+    if (replay_mode == REPLAY_PLAY) {
+        /* None of what the host has was there when the recording was made. */
+        while (!network_queue_empty(queue))
+            network_queue_pop(queue);
+
+        len = replay_get(REPLAY_NET_RX + card->card_num, card->queued_pkt.data, NET_MAX_FRAME);
+        if ((len <= 0) || (len > NET_MAX_FRAME))
+            return 0;
+
+        card->queued_pkt.len = len;
+        return 1;
     }
-    queue->tail = queue->head = 0;
+
+    if (!network_queue_get_swap(queue, &card->queued_pkt))
+        return 0;
+
+    replay_put(REPLAY_NET_RX + card->card_num, card->queued_pkt.data, card->queued_pkt.len);
+    return 1;
 }
 
 static void
 network_rx_queue(void *priv)
 {
     netcard_t *card = (netcard_t *) priv;
+    int        prev = perf_enter(PERF_IO);
 
     uint32_t new_link_state = net_cards_conf[card->card_num].link_state;
     if (new_link_state != card->link_state) {
@@ -390,34 +532,43 @@ network_rx_queue(void *priv)
         card->link_state = new_link_state;
     }
 
-    uint32_t rx_bytes = 0;
-    for (int i = 0; i < NET_QUEUE_LEN; i++) {
-        if (card->queued_pkt.len == 0) {
-            thread_wait_mutex(card->rx_mutex);
-            int res = network_queue_get_swap(&card->queues[NET_QUEUE_RX], &card->queued_pkt);
-            thread_release_mutex(card->rx_mutex);
-            if (!res)
-                break;
-        }
+    uint32_t rx_bytes   = 0;
+    uint32_t rx_packets = 0;
+    MTR_BEGIN("network", "rx");
+    for (uint32_t i = 0; i < card->queue_len; i++) {
+        if ((card->queued_pkt.len == 0) && !network_rx_next(card))
+            break;
+
+        if (card->mac_translate)
+            network_mac_translate(card->queued_pkt.data, card->queued_pkt.len, card->host_mac, card->mac);
 
         network_dump_packet(&card->queued_pkt);
         int res = card->rx(card->card_drv, card->queued_pkt.data, card->queued_pkt.len);
         if (!res)
             break;
         rx_bytes += card->queued_pkt.len;
+        rx_packets++;
         card->queued_pkt.len = 0;
     }
+    MTR_END("network", "rx");
 
     /* Transmission. */
-    uint32_t tx_bytes = 0;
-    thread_wait_mutex(card->tx_mutex);
-    for (int i = 0; i < NET_QUEUE_LEN; i++) {
-        uint32_t bytes = network_queue_move(&card->queues[NET_QUEUE_TX_HOST], &card->queues[NET_QUEUE_TX_VM]);
+    uint32_t tx_bytes   = 0;
+    uint32_t tx_packets = 0;
+    MTR_BEGIN("network", "tx");
+    for (uint32_t i = 0; i < card->queue_len; i++) {
+        uint32_t bytes = network_queue_move(card->queues[NET_QUEUE_TX_HOST], card->queues[NET_QUEUE_TX_VM]);
         if (!bytes)
             break;
         tx_bytes += bytes;
+        tx_packets++;
     }
-    thread_release_mutex(card->tx_mutex);
+    MTR_END("network", "tx");
+
+    card->stats.rx_packets += rx_packets;
+    card->stats.rx_bytes += rx_bytes;
+    card->stats.tx_packets += tx_packets;
+    card->stats.tx_bytes += tx_bytes;
     if (tx_bytes) {
         /* Notify host that a packet is available in the TX queue */
         card->host_drv.notify_in(card->host_drv.priv);
@@ -427,16 +578,139 @@ network_rx_queue(void *priv)
     if (timer_period < 200)
         timer_period = 200;
 
-    timer_on_auto(&card->timer, timer_period);
+    /* The status bar clears the LED again once it has shown it. */
+    if (rx_bytes || tx_bytes) {
+        ui_sb_update_icon(SB_NETWORK | card->card_num, 1);
+        card->idle_polls = 0;
+    }
+
+    /* A packet the card refused is retried on the next run. */
+    if (rx_bytes || tx_bytes || card->queued_pkt.len || (++card->idle_polls < NET_IDLE_POLLS))
+        timer_on_auto(&card->timer, timer_period);
+
+    perf_leave(prev);
+}
+
+static void
+network_kick(netcard_t *card)
+{
+    if (timer_is_on(&card->timer))
+        return;
+
+    card->idle_polls = 0;
+    timer_on_auto(&card->timer, 1.0);
+}
+
+/* Average wait of the packets that left a ring since the last update. */
+static uint32_t
+network_stats_wait(netcard_t *card, int queue, int idx)
+{
+    netcard_stats_t *s = &card->stats;
+    netqueue_stats_t q;
+    uint32_t         waited;
+    uint32_t         wait_us;
+
+    network_queue_stats(card, queue, &q);
+    waited  = q.waited - s->last_waited[idx];
+    wait_us = q.wait_us - s->last_wait_us[idx];
+
+    s->last_waited[idx]  = q.waited;
+    s->last_wait_us[idx] = q.wait_us;
+
+    return waited ? (wait_us / waited) : 0;
+}
+
+static void
+network_stats_rate(netcard_t *card, uint32_t ms)
+{
+    netcard_stats_t *s = &card->stats;
+    netqueue_stats_t q;
+
+    s->drops = 0;
+    for (int i = 0; i < NET_QUEUE_COUNT; i++) {
+        network_queue_stats(card, i, &q);
+        s->drops += q.drops;
+    }
+    s->errors = atomic_load_explicit(&net_tx_errors[card->card_num], memory_order_relaxed);
+
+    s->rx_pps     = (uint32_t) (((s->rx_packets - s->last_rx_packets) * 1000) / ms);
+    s->tx_pps     = (uint32_t) (((s->tx_packets - s->last_tx_packets) * 1000) / ms);
+    s->rx_kbps    = (uint32_t) ((((s->rx_bytes - s->last_rx_bytes) >> 10) * 1000) / ms);
+    s->tx_kbps    = (uint32_t) ((((s->tx_bytes - s->last_tx_bytes) >> 10) * 1000) / ms);
+    s->rx_wait_us = network_stats_wait(card, NET_QUEUE_RX, 0);
+    s->tx_wait_us = network_stats_wait(card, NET_QUEUE_TX_HOST, 1);
+
+    s->last_rx_packets = s->rx_packets;
+    s->last_tx_packets = s->tx_packets;
+    s->last_rx_bytes   = s->rx_bytes;
+    s->last_tx_bytes   = s->tx_bytes;
+}
+
+/* Publishes the rates once a second of host time has passed, and logs them
+   every net_stats_interval seconds if asked to. */
+static void
+network_stats_update(void)
+{
+    uint32_t ticks = plat_get_ticks();
+    uint32_t ms    = ticks - net_stats_ticks;
+    int      log;
+
+    if (ms < 1000)
+        return;
+
+    log = (net_stats_interval > 0) && ((ticks - net_stats_log_ticks) >= ((uint32_t) net_stats_interval * 1000));
+
+    for (int i = 0; i < NET_CARD_MAX; i++) {
+        netcard_t       *card = net_cards_attached[i];
+        netcard_stats_t *s;
+
+        if (card == NULL)
+            continue;
 
-    bool activity = rx_bytes || tx_bytes;
-    bool led_on   = card->led_timer & 0x80000000;
-    if ((activity && !led_on) || (card->led_timer & 0x7fffffff) >= 150000) {
-        ui_sb_update_icon(SB_NETWORK | card->card_num, activity);
-        card->led_timer = 0 | (activity << 31);
+        network_stats_rate(card, ms);
+
+        if (log) {
+            s = &card->stats;
+            pclog("NETWORK: card %i: RX %u pkt/s %u kB/s, TX %u pkt/s %u kB/s, "
+                  "wait %u/%u us, %u dropped, %u send errors\n",
+                  i + 1, s->rx_pps, s->rx_kbps, s->tx_pps, s->tx_kbps,
+                  s->rx_wait_us, s->tx_wait_us, s->drops, s->errors);
+        }
     }
 
-    card->led_timer += timer_period;
+    if (log)
+        net_stats_log_ticks = ticks;
+    network_stats_seq++;
+    net_stats_ticks = ticks;
+}
+
+/*
+ * Called once per emulation slice, restarts the timer of idle cards that
+ * got traffic from their host driver or a link state change in the
+ * meantime. The host drivers run on their own threads and cannot touch
+ * the timers themselves.
+ */
+void
+network_poll(void)
+{
+    for (int i = 0; i < NET_CARD_MAX; i++) {
+        netcard_t *card = net_cards_attached[i];
+
+        if ((card == NULL) || timer_is_on(&card->timer))
+            continue;
+
+        if (replay_mode == REPLAY_PLAY) {
+            if (replay_get(REPLAY_NET_KICK + card->card_num, NULL, 0) >= 0)
+                network_kick(card);
+        } else if (!network_queue_empty(card->queues[NET_QUEUE_RX]) ||
+                   !network_queue_empty(card->queues[NET_QUEUE_TX_VM]) ||
+                   (net_cards_conf[card->card_num].link_state != card->link_state)) {
+            replay_put(REPLAY_NET_KICK + card->card_num, NULL, 0);
+            network_kick(card);
+        }
+    }
+
+    network_stats_update();
 }
 
 /*
@@ -446,6 +720,48 @@ network_rx_queue(void *priv)
  * finished initializing itself, to link itself to the platform support
  * modules.
  */
+/* Starts the host driver for net_type, NET_TYPE_NONE being the null driver.
+   The driver's priv is left NULL if it failed. */
+static void
+network_host_open(netcard_t *card, const uint8_t *mac, int net_type, char *net_drv_error)
+{
+    char *host_dev_name = net_cards_conf[card->card_num].host_dev_name;
+
+    card->net_type = net_type;
+
+    switch (net_type) {
+        case NET_TYPE_NONE:
+            card->host_drv      = net_null_drv;
+            card->host_drv.priv = card->host_drv.init(card, mac, NULL, net_drv_error);
+            break;
+
+        case NET_TYPE_SLIRP:
+            card->host_drv      = net_slirp_drv;
+            card->host_drv.priv = card->host_drv.init(card, mac, NULL, net_drv_error);
+            break;
+
+        case NET_TYPE_PCAP:
+            card->host_drv      = net_pcap_drv;
+            card->host_drv.priv = card->host_drv.init(card, mac, host_dev_name, net_drv_error);
+            break;
+#ifdef HAS_VDE
+        case NET_TYPE_VDE:
+            card->host_drv      = net_vde_drv;
+            card->host_drv.priv = card->host_drv.init(card, mac, host_dev_name, net_drv_error);
+            break;
+#endif
+#ifdef HAS_TAP
+        case NET_TYPE_TAP:
+            card->host_drv      = net_tap_drv;
+            card->host_drv.priv = card->host_drv.init(card, mac, host_dev_name, net_drv_error);
+            break;
+#endif
+        default:
+            card->host_drv.priv = NULL;
+            break;
+    }
+}
+
 netcard_t *
 network_attach(void *card_drv, uint8_t *mac, NETRXCB rx, NETSETLINKSTATE set_link_state)
 {
@@ -455,16 +771,24 @@ network_attach(void *card_drv, uint8_t *mac, NETRXCB rx, NETSETLINKSTATE set_lin
     card->card_drv        = card_drv;
     card->rx              = rx;
     card->set_link_state  = set_link_state;
-    card->tx_mutex        = thread_create_mutex();
     card->rx_mutex        = thread_create_mutex();
     card->card_num        = net_card_current;
     card->byte_period     = NET_PERIOD_10M;
+    card->queue_len       = NET_QUEUE_LEN_MIN;
+
+    /* Round the configured depth up to a power of 2. */
+    while ((card->queue_len < net_cards_conf[net_card_current].queue_len) &&
+           (card->queue_len < NET_QUEUE_LEN_MAX))
+        card->queue_len <<= 1;
 
     char net_drv_error[NET_DRV_ERRBUF_SIZE];
     wchar_t tempmsg[NET_DRV_ERRBUF_SIZE * 2];
 
+    atomic_store(&net_tx_errors[card->card_num], 0);
+    net_stats_ticks = plat_get_ticks();
+
     for (int i = 0; i < NET_QUEUE_COUNT; i++) {
-        network_queue_init(&card->queues[i]);
+        card->queues[i] = network_queue_init(card->queue_len, (i == NET_QUEUE_RX) || (i == NET_QUEUE_TX_HOST));
     }
 
     if ((!strcmp(network_card_get_internal_name(net_cards_conf[net_card_current].device_num), "modem") ||
@@ -473,26 +797,8 @@ network_attach(void *card_drv, uint8_t *mac, NETRXCB rx, NETSETLINKSTATE set_lin
         net_type = NET_TYPE_SLIRP;
     }
 
-    switch (net_type) {
-        case NET_TYPE_SLIRP:
-            card->host_drv      = net_slirp_drv;
-            card->host_drv.priv = card->host_drv.init(card, mac, NULL, net_drv_error);
-            break;
-
-        case NET_TYPE_PCAP:
-            card->host_drv      = net_pcap_drv;
-            card->host_drv.priv = card->host_drv.init(card, mac, net_cards_conf[net_card_current].host_dev_name, net_drv_error);
-            break;
-#ifdef HAS_VDE
-        case NET_TYPE_VDE:
-            card->host_drv      = net_vde_drv;
-            card->host_drv.priv = card->host_drv.init(card, mac, net_cards_conf[net_card_current].host_dev_name, net_drv_error);
-            break;
-#endif
-        default:
-            card->host_drv.priv = NULL;
-            break;
-    }
+    memcpy(card->mac, mac, sizeof(card->mac));
+    network_host_open(card, mac, net_type, net_drv_error);
 
     // Use null driver on:
     // * No specific driver selected (card->host_drv.priv is set to null above)
@@ -507,8 +813,7 @@ network_attach(void *card_drv, uint8_t *mac, NETRXCB rx, NETSETLINKSTATE set_lin
         }
 
         // Init null driver
-        card->host_drv      = net_null_drv;
-        card->host_drv.priv = card->host_drv.init(card, mac, NULL, net_drv_error);
+        network_host_open(card, mac, NET_TYPE_NONE, net_drv_error);
         // Set link state to disconnected by default
         network_connect(card->card_num, 0);
         ui_sb_update_icon_state(SB_NETWORK | card->card_num, 1);
@@ -516,10 +821,9 @@ network_attach(void *card_drv, uint8_t *mac, NETRXCB rx, NETSETLINKSTATE set_lin
         // If null fails, something is very wrong
         // Clean up and fatal
         if(!card->host_drv.priv) {
-            thread_close_mutex(card->tx_mutex);
             thread_close_mutex(card->rx_mutex);
             for (int i = 0; i < NET_QUEUE_COUNT; i++) {
-                network_queue_clear(&card->queues[i]);
+                network_queue_clear(card->queues[i]);
             }
 
             free(card->queued_pkt.data);
@@ -533,6 +837,7 @@ network_attach(void *card_drv, uint8_t *mac, NETRXCB rx, NETSETLINKSTATE set_lin
 
     timer_add(&card->timer, network_rx_queue, card, 0);
     timer_on_auto(&card->timer, 100);
+    net_cards_attached[card->card_num] = card;
 
     return card;
 }
@@ -540,13 +845,25 @@ network_attach(void *card_drv, uint8_t *mac, NETRXCB rx, NETSETLINKSTATE set_lin
 void
 netcard_close(netcard_t *card)
 {
+    if (net_cards_attached[card->card_num] == card)
+        net_cards_attached[card->card_num] = NULL;
+
     timer_stop(&card->timer);
     card->host_drv.close(card->host_drv.priv);
 
-    thread_close_mutex(card->tx_mutex);
+    for (int i = 0; i < NET_QUEUE_COUNT; i++) {
+        netqueue_stats_t stats;
+
+        network_queue_stats(card, i, &stats);
+        network_log("NETWORK: card %i queue %i: %u slots, %u used at most, %u dropped\n",
+                    card->card_num, i, stats.size, stats.max_used, stats.drops);
+    }
+    network_log("NETWORK: card %i: %" PRIu64 " packets received, %" PRIu64 " sent\n",
+                card->card_num, card->stats.rx_packets, card->stats.tx_packets);
+
     thread_close_mutex(card->rx_mutex);
     for (int i = 0; i < NET_QUEUE_COUNT; i++) {
-        network_queue_clear(&card->queues[i]);
+        network_queue_clear(card->queues[i]);
     }
 
     free(card->queued_pkt.data);
@@ -597,19 +914,61 @@ network_reset(void)
 void
 network_tx(netcard_t *card, uint8_t *bufp, int len)
 {
-    network_queue_put(&card->queues[NET_QUEUE_TX_VM], bufp, len);
+    if (card->mac_translate && (len <= NET_MAX_FRAME)) {
+        uint8_t frame[NET_MAX_FRAME];
+
+        /* The card's own buffer is left as the guest wrote it. */
+        memcpy(frame, bufp, len);
+        network_mac_translate(frame, len, card->mac, card->host_mac);
+        network_queue_put(card->queues[NET_QUEUE_TX_VM], frame, len);
+    } else
+        network_queue_put(card->queues[NET_QUEUE_TX_VM], bufp, len);
+    network_kick(card);
 }
 
-int
-network_tx_pop(netcard_t *card, netpkt_t *out_pkt)
+/*
+ * Runs in a fork()ed clone of the machine. The host drivers of the parent
+ * live on in threads that did not make it across, so every card gets a new
+ * one, leaving the old to be torn down with the parent's. Cards on a network
+ * shared with the parent also get a MAC address of their own on the host
+ * side, the guest keeps seeing the one it had.
+ */
+void
+network_clone_child(uint32_t seed)
 {
-    int ret = 0;
+    char net_drv_error[NET_DRV_ERRBUF_SIZE];
 
-    thread_wait_mutex(card->tx_mutex);
-    ret = network_queue_get_swap(&card->queues[NET_QUEUE_TX_HOST], out_pkt);
-    thread_release_mutex(card->tx_mutex);
+    for (int i = 0; i < NET_CARD_MAX; i++) {
+        netcard_t *card = net_cards_attached[i];
 
-    return ret;
+        if (card == NULL)
+            continue;
+
+        /* It may have been held by a thread of the parent. */
+        card->rx_mutex = thread_create_mutex();
+
+        if ((card->net_type != NET_TYPE_NONE) && (card->net_type != NET_TYPE_SLIRP)) {
+            memcpy(card->host_mac, card->mac, sizeof(card->host_mac));
+            card->host_mac[3] ^= (seed >> 16) & 0xff;
+            card->host_mac[4] ^= (seed >> 8) & 0xff;
+            card->host_mac[5] ^= seed & 0xff;
+            card->mac_translate = 1;
+        }
+
+        network_host_open(card, card->mac_translate ? card->host_mac : card->mac, card->net_type, net_drv_error);
+        if (card->host_drv.priv == NULL) {
+            network_log("NETWORK: card %i: Host driver failed in the clone: %s\n", i, net_drv_error);
+            card->mac_translate = 0;
+            network_host_open(card, card->mac, NET_TYPE_NONE, net_drv_error);
+            network_connect(i, 0);
+        }
+    }
+}
+
+int
+network_tx_pop(netcard_t *card, netpkt_t *out_pkt)
+{
+    return network_queue_get_swap(card->queues[NET_QUEUE_TX_HOST], out_pkt);
 }
 
 int
@@ -617,8 +976,7 @@ network_tx_popv(netcard_t *card, netpkt_t *pkt_vec, int vec_size)
 {
     int pkt_count = 0;
 
-    netqueue_t *queue = &card->queues[NET_QUEUE_TX_HOST];
-    thread_wait_mutex(card->tx_mutex);
+    netqueue_t *queue = card->queues[NET_QUEUE_TX_HOST];
     for (int i = 0; i < vec_size; i++) {
         if (!network_queue_get_swap(queue, pkt_vec))
             break;
@@ -626,7 +984,6 @@ network_tx_popv(netcard_t *card, netpkt_t *pkt_vec, int vec_size)
         pkt_count++;
         pkt_vec++;
     }
-    thread_release_mutex(card->tx_mutex);
 
     return pkt_count;
 }
@@ -637,7 +994,7 @@ network_rx_put(netcard_t *card, uint8_t *bufp, int len)
     int ret = 0;
 
     thread_wait_mutex(card->rx_mutex);
-    ret = network_queue_put(&card->queues[NET_QUEUE_RX], bufp, len);
+    ret = network_queue_put(card->queues[NET_QUEUE_RX], bufp, len);
     thread_release_mutex(card->rx_mutex);
 
     return ret;
@@ -648,7 +1005,7 @@ network_rx_on_tx_popv(netcard_t *card, netpkt_t *pkt_vec, int vec_size)
 {
     int pkt_count = 0;
 
-    netqueue_t *queue = &card->queues[NET_QUEUE_RX_ON_TX];
+    netqueue_t *queue = card->queues[NET_QUEUE_RX_ON_TX];
     for (int i = 0; i < vec_size; i++) {
         if (!network_queue_get_swap(queue, pkt_vec))
             break;
@@ -665,7 +1022,7 @@ network_rx_on_tx_put(netcard_t *card, uint8_t *bufp, int len)
 {
     int ret = 0;
 
-    ret = network_queue_put(&card->queues[NET_QUEUE_RX_ON_TX], bufp, len);
+    ret = network_queue_put(card->queues[NET_QUEUE_RX_ON_TX], bufp, len);
 
     return ret;
 }
@@ -675,7 +1032,7 @@ network_rx_on_tx_put_pkt(netcard_t *card, netpkt_t *pkt)
 {
     int ret = 0;
 
-    ret = network_queue_put_swap(&card->queues[NET_QUEUE_RX_ON_TX], pkt);
+    ret = network_queue_put_swap(card->queues[NET_QUEUE_RX_ON_TX], pkt);
 
     return ret;
 }
@@ -686,12 +1043,73 @@ network_rx_put_pkt(netcard_t *card, netpkt_t *pkt)
     int ret = 0;
 
     thread_wait_mutex(card->rx_mutex);
-    ret = network_queue_put_swap(&card->queues[NET_QUEUE_RX], pkt);
+    ret = network_queue_put_swap(card->queues[NET_QUEUE_RX], pkt);
     thread_release_mutex(card->rx_mutex);
 
     return ret;
 }
 
+netpkt_t *
+network_rx_reserve(netcard_t *card)
+{
+    netqueue_t *queue = card->queues[NET_QUEUE_RX];
+
+    thread_wait_mutex(card->rx_mutex);
+    if (network_queue_full(queue)) {
+        atomic_fetch_add_explicit(&queue->drops, 1, memory_order_relaxed);
+        thread_release_mutex(card->rx_mutex);
+        return NULL;
+    }
+
+    return &queue->packets[spsc_write_pos(&queue->ring)];
+}
+
+void
+network_rx_commit(netcard_t *card, int len)
+{
+    netqueue_t *queue = card->queues[NET_QUEUE_RX];
+
+    if ((len > 0) && (len <= NET_MAX_FRAME)) {
+        queue->packets[spsc_write_pos(&queue->ring)].len = len;
+        network_queue_push(queue);
+    }
+    thread_release_mutex(card->rx_mutex);
+}
+
+void
+network_queue_stats(const netcard_t *card, int queue, netqueue_stats_t *stats)
+{
+    netqueue_t *q = card->queues[queue];
+
+    stats->size     = q->ring.size;
+    stats->used     = spsc_entries(&q->ring);
+    stats->max_used = atomic_load(&q->max_used);
+    stats->drops    = atomic_load(&q->drops);
+    stats->wait_us  = atomic_load(&q->wait_us);
+    stats->waited   = atomic_load(&q->waited);
+}
+
+/* Called by the host drivers for packets they could not send. */
+void
+network_tx_failed(netcard_t *card, int packets)
+{
+    atomic_fetch_add_explicit(&net_tx_errors[card->card_num], packets, memory_order_relaxed);
+}
+
+/* Copies the statistics of a card for the user interface, 0 if nothing is
+   attached there. */
+int
+network_get_stats(int card_num, netcard_stats_t *stats)
+{
+    netcard_t *card = net_cards_attached[card_num];
+
+    if (card == NULL)
+        return 0;
+
+    *stats = card->stats;
+    return 1;
+}
+
 void
 network_connect(int id, int connect)
 {
@@ -59,12 +59,36 @@
 #include <86box/path.h>
 #include <86box/plat.h>
 #include <86box/nvr.h>
+#include <86box/replay.h>
+
+/* Dirty images are written once they have been left alone this long, but
+   no later than this long after they were first changed, so that the
+   bursts of small writes a BIOS makes while updating its ESCD or DMI data
+   end up as a single write. */
+#define NVR_SAVE_QUIET_MS 2000
+#define NVR_SAVE_LATE_MS  10000
+
+/* A flash or other image in the NVR area, written out when dirty. */
+struct nvr_image_t {
+    char     fn[1024];
+    void    *priv;
+    uint8_t  dirty;
+    uint32_t first_change;
+    uint32_t last_change;
+
+    void (*write)(void *priv, FILE *fp);
+
+    struct nvr_image_t *next;
+};
 
 int nvr_dosave; /* NVR is dirty, needs saved */
 
-static int8_t    days_in_month[12] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
-static struct tm intclk;
-static nvr_t    *saved_nvr = NULL;
+static int8_t       days_in_month[12] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+static struct tm    intclk;
+static nvr_t       *saved_nvr = NULL;
+static nvr_image_t *nvr_images = NULL;
+static int          nvr_images_dirty = 0;
+static uint32_t     nvr_dirty_since;
 
 #ifdef ENABLE_NVR_LOG
 int nvr_do_log = ENABLE_NVR_LOG;
@@ -179,7 +203,8 @@ nvr_init(nvr_t *nvr)
     timer_add(&nvr->onesec_time, onesec_timer, nvr, 1);
 
     /* It does not need saving yet. */
-    nvr_dosave = 0;
+    nvr_dosave      = 0;
+    nvr_dirty_since = 0;
 
     /* Save the NVR data pointer. */
     saved_nvr = nvr;
@@ -270,37 +295,179 @@ nvr_set_ven_save(void (*ven_save)(void))
     saved_nvr->ven_save = ven_save;
 }
 
+/*
+ * Write a file in the NVR area.
+ *
+ * The data goes to a temporary file first, which then replaces the
+ * old file, so that a crash half way through leaves the old contents
+ * in place rather than a truncated file.
+ */
+int
+nvr_write_file(const char *fn, void (*write)(void *priv, FILE *fp), void *priv)
+{
+    char  path[1024];
+    char  temp[1024 + 4];
+    FILE *fp;
+    int   ok;
+
+    snprintf(path, sizeof(path), "%s", nvr_path((char *) fn));
+    snprintf(temp, sizeof(temp), "%s.tmp", path);
+
+    nvr_log("NVR: saving to '%s'\n", path);
+    fp = plat_fopen(temp, "wb");
+    if (fp == NULL)
+        return 0;
+
+    write(priv, fp);
+
+    ok = !ferror(fp);
+    if (fclose(fp) != 0)
+        ok = 0;
+
+    if (!ok || (plat_rename(temp, path) != 0)) {
+        nvr_log("NVR: unable to save '%s'\n", path);
+        plat_remove(temp);
+        return 0;
+    }
+
+    return 1;
+}
+
+static void
+nvr_write_regs(void *priv, FILE *fp)
+{
+    const nvr_t *nvr = (nvr_t *) priv;
+
+    (void) fwrite(nvr->regs, nvr->size, 1, fp);
+}
+
+static void
+nvr_image_save(nvr_image_t *img)
+{
+    /* A clone shares its files with the machine it was cloned from. */
+    if (!is_clone)
+        (void) nvr_write_file(img->fn, img->write, img->priv);
+    img->dirty = 0;
+}
+
 /* Save the current NVR to a file. */
 int
 nvr_save(void)
 {
-    const char *path;
-    FILE       *fp;
+    /* Any dirty images go out along with it. */
+    for (nvr_image_t *img = nvr_images; img != NULL; img = img->next) {
+        if (img->dirty)
+            nvr_image_save(img);
+    }
+    nvr_images_dirty = 0;
 
     /* Make sure we have been initialized. */
     if (saved_nvr == NULL)
         return 0;
 
-    if (saved_nvr->size != 0) {
-        path = nvr_path(saved_nvr->fn);
-        nvr_log("NVR: saving to '%s'\n", path);
-        fp = plat_fopen(path, "wb");
-        if (fp != NULL) {
-            /* Save NVR contents to file. */
-            (void) fwrite(saved_nvr->regs, saved_nvr->size, 1, fp);
-            fclose(fp);
-        }
-    }
+    if (!is_clone) {
+        if (saved_nvr->size != 0)
+            (void) nvr_write_file(saved_nvr->fn, nvr_write_regs, saved_nvr);
 
-    if (saved_nvr->ven_save)
-        saved_nvr->ven_save();
+        if (saved_nvr->ven_save)
+            saved_nvr->ven_save();
+    }
 
     /* Device is clean again. */
-    nvr_dosave = 0;
+    nvr_dosave      = 0;
+    nvr_dirty_since = 0;
 
     return 1;
 }
 
+/* Called from the main loop, saves whatever has been dirty long enough. */
+void
+nvr_save_pending(void)
+{
+    uint32_t now;
+
+    if (!nvr_dosave && !nvr_images_dirty)
+        return;
+
+    now = plat_get_ticks();
+
+    /* The NVR itself is not timestamped on every write, so it is saved
+       once it has been dirty for a while. */
+    if (nvr_dosave) {
+        if (nvr_dirty_since == 0)
+            nvr_dirty_since = now | 1;
+        else if ((now - nvr_dirty_since) >= NVR_SAVE_QUIET_MS) {
+            (void) nvr_save();
+            return;
+        }
+    }
+
+    nvr_images_dirty = 0;
+    for (nvr_image_t *img = nvr_images; img != NULL; img = img->next) {
+        if (!img->dirty)
+            continue;
+
+        if (((now - img->last_change) >= NVR_SAVE_QUIET_MS) ||
+            ((now - img->first_change) >= NVR_SAVE_LATE_MS))
+            nvr_image_save(img);
+        else
+            nvr_images_dirty = 1;
+    }
+}
+
+/* Register an image to be saved to fn through write() when marked dirty. */
+nvr_image_t *
+nvr_image_add(const char *fn, void (*write)(void *priv, FILE *fp), void *priv)
+{
+    nvr_image_t *img = (nvr_image_t *) calloc(1, sizeof(nvr_image_t));
+
+    snprintf(img->fn, sizeof(img->fn), "%s", fn);
+    img->write = write;
+    img->priv  = priv;
+
+    img->next  = nvr_images;
+    nvr_images = img;
+
+    return img;
+}
+
+void
+nvr_image_dirty(nvr_image_t *img)
+{
+    uint32_t now = plat_get_ticks();
+
+    if (!img->dirty) {
+        img->dirty        = 1;
+        img->first_change = now;
+    }
+    img->last_change = now;
+
+    nvr_images_dirty = 1;
+}
+
+/* Unregister an image, saving it first if it is dirty. */
+void
+nvr_image_remove(nvr_image_t *img)
+{
+    nvr_image_t **prev = &nvr_images;
+
+    if (img == NULL)
+        return;
+
+    if (img->dirty)
+        nvr_image_save(img);
+
+    while (*prev != NULL) {
+        if (*prev == img) {
+            *prev = img->next;
+            break;
+        }
+        prev = &(*prev)->next;
+    }
+
+    free(img);
+}
+
 void
 nvr_close(void)
 {
@@ -315,6 +482,7 @@ nvr_time_sync(void)
 
     /* Get the current time of day, and convert to local time. */
     (void) time(&now);
+    now = (time_t) replay_clock((uint64_t) now);
     if (time_sync & TIME_SYNC_UTC)
         tm = gmtime(&now);
     else
@@ -218,6 +218,8 @@
  *   USA.
  */
 #include <inttypes.h>
+#include <math.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdint.h>
 #include <string.h>
@@ -236,6 +238,7 @@
 #include <86box/rom.h>
 #include <86box/device.h>
 #include <86box/nvr.h>
+#include <86box/snapshot.h>
 
 /* RTC registers and bit definitions. */
 #define RTC_SECONDS        0
@@ -297,6 +300,18 @@
 #define FLAG_PIIX4         0x20
 #define FLAG_MULTI_BANK    0x40
 
+/*
+ * The update cycle and the periodic flag only run from timers while their
+ * interrupts are enabled. Otherwise nothing happens until the guest looks
+ * at the RTC, at which point nvr_at_sync() plays the update cycles since
+ * the last look back in order, from a clock kept in emulated microseconds.
+ */
+enum {
+    UPD_IDLE = 0, /* Waiting for the next second. */
+    UPD_UIP,      /* UIP set, registers are about to be updated. */
+    UPD_DONE      /* Registers updated, waiting for update ended. */
+};
+
 typedef struct local_t {
     int8_t stat;
 
@@ -320,7 +335,15 @@ typedef struct local_t {
 
     int32_t smi_enable;
 
-    uint64_t   ecount;
+    uint8_t  upd_phase;
+    uint64_t clk_tsc;   /* tsc at clk_us. */
+    double   clk_us;
+    double   clk_rate;  /* CPU cycles per microsecond. */
+    double   sec_us;    /* Start of the current second. */
+    double   upd_us;    /* Next update cycle step. */
+    double   pf_us;     /* Next periodic flag. */
+    double   pf_period;
+
     uint64_t   rtc_time;
     pc_timer_t update_timer;
     pc_timer_t rtc_timer;
@@ -458,47 +481,116 @@ timer_update_irq(nvr_t *nvr)
     }
 }
 
-/* Update the NVR registers from the internal clock. */
+/* Get the emulated time in microseconds. */
+static double
+nvr_at_now(local_t *local)
+{
+    local->clk_us += (double) (tsc - local->clk_tsc) / local->clk_rate;
+    local->clk_tsc = tsc;
+
+    return local->clk_us;
+}
+
+/* Do the next step of the update cycle, at local->upd_us. */
 static void
-timer_update(void *priv)
+nvr_at_update_step(nvr_t *nvr, local_t *local)
 {
-    nvr_t    *nvr   = (nvr_t *) priv;
-    local_t  *local = (local_t *) nvr->data;
     struct tm tm;
 
-    if (local->ecount == (244ULL * TIMER_USEC)) {
-        rtc_tick();
+    switch (local->upd_phase) {
+        default:
+        case UPD_IDLE:
+            /* Another second has passed. Only update it there is no SET in progress.
+               Also avoid updating it is DV2-DV0 are not set to 0, 1, 0. */
+            local->sec_us = local->upd_us;
+            if (((nvr->regs[RTC_REGA] & 0x70) == 0x20) && !(nvr->regs[RTC_REGB] & REGB_SET)) {
+                /* Set the UIP bit, announcing the update. */
+                local->stat      = REGA_UIP;
+                local->upd_phase = UPD_UIP;
+                local->upd_us += 244.0;
+            } else
+                local->upd_us += 1000000.0;
+            break;
 
-        /* Get the current time from the internal clock. */
-        nvr_time_get(&tm);
+        case UPD_UIP:
+            rtc_tick();
 
-        /* Update registers with current time. */
-        time_set(nvr, &tm);
+            /* Get the current time from the internal clock. */
+            nvr_time_get(&tm);
+
+            /* Update registers with current time. */
+            time_set(nvr, &tm);
 
-        /* Check for any alarms we need to handle. */
-        if (check_alarm(nvr, RTC_SECONDS) && check_alarm(nvr, RTC_MINUTES) && check_alarm(nvr, RTC_HOURS) &&
-            check_alarm_via(nvr, RTC_DOM, RTC_ALDAY) && check_alarm_via(nvr, RTC_MONTH, RTC_ALMONTH) /* &&
-            check_alarm_via(nvr, RTC_DOM, RTC_ALDAY_SIS) && check_alarm_via(nvr, RTC_MONTH, RTC_ALMONT_SIS) */) {
-            nvr->regs[RTC_REGC] |= REGC_AF;
+            /* Check for any alarms we need to handle. */
+            if (check_alarm(nvr, RTC_SECONDS) && check_alarm(nvr, RTC_MINUTES) && check_alarm(nvr, RTC_HOURS) &&
+                check_alarm_via(nvr, RTC_DOM, RTC_ALDAY) && check_alarm_via(nvr, RTC_MONTH, RTC_ALMONTH) /* &&
+                check_alarm_via(nvr, RTC_DOM, RTC_ALDAY_SIS) && check_alarm_via(nvr, RTC_MONTH, RTC_ALMONT_SIS) */) {
+                nvr->regs[RTC_REGC] |= REGC_AF;
+                timer_update_irq(nvr);
+            }
+
+            /* On to the end of the update. */
+            local->upd_phase = UPD_DONE;
+            local->upd_us += 1984.0;
+            break;
+
+        case UPD_DONE:
+            /*
+             * The flag and interrupt should be issued
+             * on update ended, not started.
+             */
+            nvr->regs[RTC_REGC] |= REGC_UF;
             timer_update_irq(nvr);
-        }
 
-        /* Schedule the end of the update. */
-        local->ecount = 1984ULL * TIMER_USEC;
-        timer_set_delay_u64(&local->update_timer, local->ecount);
-    } else {
-        /*
-         * The flag and interrupt should be issued
-         * on update ended, not started.
-         */
-        nvr->regs[RTC_REGC] |= REGC_UF;
-        timer_update_irq(nvr);
+            /* Clear update status. */
+            local->stat      = 0x00;
+            local->upd_phase = UPD_IDLE;
+            local->upd_us    = local->sec_us + 1000000.0;
+            break;
+    }
+}
+
+/* Catch up with emulated time, slack is how far ahead of it an update cycle
+   step may be and still be done now. */
+static void
+nvr_at_sync_ex(nvr_t *nvr, double slack)
+{
+    local_t *local = (local_t *) nvr->data;
+    double   now   = nvr_at_now(local);
+    double   n;
 
-        /* Clear update status. */
-        local->stat = 0x00;
+    while (local->upd_us <= (now + slack))
+        nvr_at_update_step(nvr, local);
 
-        local->ecount = 0LL;
+    /* With its interrupt off, the periodic flag is not run from the timer. */
+    if ((local->state == 1) && !(nvr->regs[RTC_REGB] & REGB_PIE) && (local->pf_us <= now)) {
+        nvr->regs[RTC_REGC] |= REGC_PF;
+
+        n = floor((now - local->pf_us) / local->pf_period) + 1.0;
+        local->pf_us += n * local->pf_period;
     }
+
+    /* Only the interrupts need the exact moment of an update cycle step. */
+    if (nvr->regs[RTC_REGB] & (REGB_UIE | REGB_AIE))
+        timer_set_delay_u64(&local->update_timer, (local->upd_us > now) ?
+                            (uint64_t) ((local->upd_us - now) * (double) TIMER_USEC) : 0ULL);
+    else
+        timer_disable(&local->update_timer);
+}
+
+static void
+nvr_at_sync(nvr_t *nvr)
+{
+    nvr_at_sync_ex(nvr, 0.0);
+}
+
+/* Timer for the update cycle, only running while UIE or AIE are set. */
+static void
+timer_update(void *priv)
+{
+    nvr_t *nvr = (nvr_t *) priv;
+
+    nvr_at_sync_ex(nvr, 1.0);
 }
 
 static void
@@ -519,17 +611,21 @@ timer_load_count(nvr_t *nvr)
     switch (c) {
         case 0:
             local->state = 0;
-            break;
+            return;
         case 1:
         case 2:
             local->count = 1 << (c + 6);
-            timer_set_delay_u64(&local->rtc_timer, (local->count) * RTCCONST);
             break;
         default:
             local->count = 1 << (c - 1);
-            timer_set_delay_u64(&local->rtc_timer, (local->count) * RTCCONST);
             break;
     }
+
+    local->pf_period = ((double) local->count * 1000000.0) / 32768.0;
+    local->pf_us     = nvr_at_now(local) + local->pf_period;
+
+    if (nvr->regs[RTC_REGB] & REGB_PIE)
+        timer_set_delay_u64(&local->rtc_timer, (local->count) * RTCCONST);
 }
 
 static void
@@ -546,24 +642,6 @@ timer_intr(void *priv)
     }
 }
 
-/* Callback from internal clock, another second passed. */
-static void
-timer_tick(nvr_t *nvr)
-{
-    local_t *local = (local_t *) nvr->data;
-
-    /* Only update it there is no SET in progress.
-       Also avoid updating it is DV2-DV0 are not set to 0, 1, 0. */
-    if (((nvr->regs[RTC_REGA] & 0x70) == 0x20) && !(nvr->regs[RTC_REGB] & REGB_SET)) {
-        /* Set the UIP bit, announcing the update. */
-        local->stat = REGA_UIP;
-
-        /* Schedule the actual update. */
-        local->ecount = 244ULL * TIMER_USEC;
-        timer_set_delay_u64(&local->update_timer, local->ecount);
-    }
-}
-
 static void
 nvr_reg_common_write(uint16_t reg, uint8_t val, nvr_t *nvr, local_t *local)
 {
@@ -595,6 +673,9 @@ nvr_reg_write(uint16_t reg, uint8_t val, void *priv)
     struct tm tm;
     uint8_t   old;
 
+    if ((reg <= RTC_REGD) || ((local->cent != 0xff) && (reg == local->cent)))
+        nvr_at_sync(nvr);
+
     old = nvr->regs[reg];
     switch (reg) {
         case RTC_SECONDS: /* bit 7 of seconds is read-only */
@@ -617,6 +698,14 @@ nvr_reg_write(uint16_t reg, uint8_t val, void *priv)
 
             nvr->regs[RTC_REGB] = val;
             timer_update_irq(nvr);
+
+            /* Start or stop the timers the interrupts need. */
+            if ((old ^ val) & REGB_PIE) {
+                if ((val & REGB_PIE) && (local->state == 1) && !timer_is_enabled(&local->rtc_timer))
+                    timer_set_delay_u64(&local->rtc_timer, (local->pf_us > local->clk_us) ?
+                                        (uint64_t) ((local->pf_us - local->clk_us) * (double) TIMER_USEC) : 0ULL);
+            }
+            nvr_at_sync(nvr);
             break;
 
         case RTC_REGC: /* R/O */
@@ -713,6 +802,10 @@ nvr_read(uint16_t addr, void *priv)
 
     cycles -= ISA_CYCLES(8);
 
+    if ((addr & 1) && (local->bank[addr_id] != 0xff) &&
+        ((local->addr[addr_id] <= RTC_REGD) || ((local->cent != 0xff) && (local->addr[addr_id] == local->cent))))
+        nvr_at_sync(nvr);
+
     if (local->bank[addr_id] == 0xff)
         ret = 0xff;
     else if (addr & 1)
@@ -912,14 +1005,13 @@ nvr_at_speed_changed(void *priv)
     nvr_t   *nvr   = (nvr_t *) priv;
     local_t *local = (local_t *) nvr->data;
 
-    timer_load_count(nvr);
+    /* Account for the time so far at the old speed. */
+    nvr_at_now(local);
+    local->clk_rate = MAX((double) TIMER_USEC / 4294967296.0, 1.0);
 
-    timer_disable(&local->update_timer);
-    if (local->ecount > 0ULL)
-        timer_set_delay_u64(&local->update_timer, local->ecount);
+    timer_load_count(nvr);
 
-    timer_disable(&nvr->onesec_time);
-    timer_set_delay_u64(&nvr->onesec_time, (10000ULL * TIMER_USEC));
+    nvr_at_sync(nvr);
 }
 
 void
@@ -1051,6 +1143,54 @@ nvr_at_reset(void *priv)
     nvr->regs[RTC_REGC] &= ~(REGC_PF | REGC_AF | REGC_UF | REGC_IRQF);
 }
 
+/* The registers, the lock bits, and local_t but for the lock pointer and
+   the TSC the clock was last brought up to date at. */
+static void
+nvr_at_save(void *priv, snapshot_t *s)
+{
+    nvr_t   *nvr   = (nvr_t *) priv;
+    local_t *local = (local_t *) nvr->data;
+
+    nvr_at_now(local);
+
+    snapshot_write(s, nvr->regs, nvr->size);
+    snapshot_write(s, &nvr->onesec_cnt, sizeof(nvr->onesec_cnt));
+    snapshot_write(s, local->lock, nvr->size);
+    snapshot_write(s, local, offsetof(local_t, lock));
+    snapshot_write(s, &local->count, offsetof(local_t, clk_tsc) - offsetof(local_t, count));
+    snapshot_write(s, &local->clk_us, offsetof(local_t, update_timer) - offsetof(local_t, clk_us));
+    snapshot_write_timer(s, &local->update_timer);
+    snapshot_write_timer(s, &local->rtc_timer);
+}
+
+static int
+nvr_at_load(void *priv, snapshot_t *s)
+{
+    nvr_t    *nvr   = (nvr_t *) priv;
+    local_t  *local = (local_t *) nvr->data;
+    struct tm tm;
+
+    if (!snapshot_read(s, nvr->regs, nvr->size) ||
+        !snapshot_read(s, &nvr->onesec_cnt, sizeof(nvr->onesec_cnt)) ||
+        !snapshot_read(s, local->lock, nvr->size) ||
+        !snapshot_read(s, local, offsetof(local_t, lock)) ||
+        !snapshot_read(s, &local->count, offsetof(local_t, clk_tsc) - offsetof(local_t, count)) ||
+        !snapshot_read(s, &local->clk_us, offsetof(local_t, update_timer) - offsetof(local_t, clk_us)) ||
+        !snapshot_read_timer(s, &local->update_timer) ||
+        !snapshot_read_timer(s, &local->rtc_timer))
+        return 0;
+
+    /* The clock carries on from the moment it was saved. */
+    local->clk_tsc = tsc;
+
+    if (!(time_sync & TIME_SYNC_ENABLED)) {
+        time_get(nvr, &tm);
+        nvr_time_set(&tm);
+    }
+
+    return 1;
+}
+
 static void *
 nvr_at_init(const device_t *info)
 {
@@ -1155,11 +1295,19 @@ nvr_at_init(const device_t *info)
     /* Set up any local handlers here. */
     nvr->reset = nvr_reset;
     nvr->start = nvr_start;
-    nvr->tick  = timer_tick;
+    nvr->tick  = NULL;
+
+    local->clk_tsc   = tsc;
+    local->clk_rate  = MAX((double) TIMER_USEC / 4294967296.0, 1.0);
+    local->upd_us    = 1000000.0;
+    local->upd_phase = UPD_IDLE;
 
     /* Initialize the generic NVR. */
     nvr_init(nvr);
 
+    /* The update cycle keeps its own time. */
+    timer_disable(&nvr->onesec_time);
+
     if (nvr_at_inited == 0) {
         /* Start the timers. */
         timer_add(&local->update_timer, timer_update, nvr, 0);
@@ -1227,6 +1375,8 @@ const device_t at_nvr_old_device = {
     .available     = NULL,
     .speed_changed = nvr_at_speed_changed,
     .force_redraw  = NULL,
+    .save          = nvr_at_save,
+    .load          = nvr_at_load,
     .config        = NULL
 };
 
@@ -1241,6 +1391,8 @@ const device_t at_nvr_device = {
     .available     = NULL,
     .speed_changed = nvr_at_speed_changed,
     .force_redraw  = NULL,
+    .save          = nvr_at_save,
+    .load          = nvr_at_load,
     .config        = NULL
 };
 
@@ -1255,6 +1407,8 @@ const device_t at_mb_nvr_device = {
     .available     = NULL,
     .speed_changed = nvr_at_speed_changed,
     .force_redraw  = NULL,
+    .save          = nvr_at_save,
+    .load          = nvr_at_load,
     .config        = NULL
 };
 
@@ -1269,6 +1423,8 @@ const device_t ps_nvr_device = {
     .available     = NULL,
     .speed_changed = nvr_at_speed_changed,
     .force_redraw  = NULL,
+    .save          = nvr_at_save,
+    .load          = nvr_at_load,
     .config        = NULL
 };
 
@@ -1283,6 +1439,8 @@ const device_t amstrad_nvr_device = {
     .available     = NULL,
     .speed_changed = nvr_at_speed_changed,
     .force_redraw  = NULL,
+    .save          = nvr_at_save,
+    .load          = nvr_at_load,
     .config        = NULL
 };
 
@@ -1297,6 +1455,8 @@ const device_t ibmat_nvr_device = {
     .available     = NULL,
     .speed_changed = nvr_at_speed_changed,
     .force_redraw  = NULL,
+    .save          = nvr_at_save,
+    .load          = nvr_at_load,
     .config        = NULL
 };
 
@@ -1311,6 +1471,8 @@ const device_t piix4_nvr_device = {
     .available     = NULL,
     .speed_changed = nvr_at_speed_changed,
     .force_redraw  = NULL,
+    .save          = nvr_at_save,
+    .load          = nvr_at_load,
     .config        = NULL
 };
 
@@ -1325,6 +1487,8 @@ const device_t ps_no_nmi_nvr_device = {
     .available     = NULL,
     .speed_changed = nvr_at_speed_changed,
     .force_redraw  = NULL,
+    .save          = nvr_at_save,
+    .load          = nvr_at_load,
     .config        = NULL
 };
 
@@ -1339,6 +1503,8 @@ const device_t amstrad_no_nmi_nvr_device = {
     .available     = NULL,
     .speed_changed = nvr_at_speed_changed,
     .force_redraw  = NULL,
+    .save          = nvr_at_save,
+    .load          = nvr_at_load,
     .config        = NULL
 };
 
@@ -1353,6 +1519,8 @@ const device_t ami_1992_nvr_device = {
     .available     = NULL,
     .speed_changed = nvr_at_speed_changed,
     .force_redraw  = NULL,
+    .save          = nvr_at_save,
+    .load          = nvr_at_load,
     .config        = NULL
 };
 
@@ -1367,6 +1535,8 @@ const device_t ami_1994_nvr_device = {
     .available     = NULL,
     .speed_changed = nvr_at_speed_changed,
     .force_redraw  = NULL,
+    .save          = nvr_at_save,
+    .load          = nvr_at_load,
     .config        = NULL
 };
 
@@ -1381,6 +1551,8 @@ const device_t ami_1995_nvr_device = {
     .available     = NULL,
     .speed_changed = nvr_at_speed_changed,
     .force_redraw  = NULL,
+    .save          = nvr_at_save,
+    .load          = nvr_at_load,
     .config        = NULL
 };
 
@@ -1395,6 +1567,8 @@ const device_t via_nvr_device = {
     .available     = NULL,
     .speed_changed = nvr_at_speed_changed,
     .force_redraw  = NULL,
+    .save          = nvr_at_save,
+    .load          = nvr_at_load,
     .config        = NULL
 };
 
@@ -1409,6 +1583,8 @@ const device_t p6rp4_nvr_device = {
     .available     = NULL,
     .speed_changed = nvr_at_speed_changed,
     .force_redraw  = NULL,
+    .save          = nvr_at_save,
+    .load          = nvr_at_load,
     .config        = NULL
 };
 
@@ -1423,6 +1599,8 @@ const device_t amstrad_megapc_nvr_device = {
     .available     = NULL,
     .speed_changed = nvr_at_speed_changed,
     .force_redraw  = NULL,
+    .save          = nvr_at_save,
+    .load          = nvr_at_load,
     .config        = NULL
 };
 
@@ -1437,5 +1615,7 @@ const device_t elt_nvr_device = {
     .available     = NULL,
     .speed_changed = nvr_at_speed_changed,
     .force_redraw  = NULL,
+    .save          = nvr_at_save,
+    .load          = nvr_at_load,
     .config        = NULL
 };
@@ -44,6 +44,8 @@ typedef struct pci_card_t {
     void *      priv;
     void        (*write)(int func, int addr, uint8_t val, void *priv);
     uint8_t     (*read)(int func, int addr, void *priv);
+    void        (*writel)(int func, int addr, uint32_t val, void *priv);
+    uint32_t    (*readl)(int func, int addr, void *priv);
 } pci_card_t;
 
 typedef struct pci_card_desc_t {
@@ -51,9 +53,21 @@ typedef struct pci_card_desc_t {
     void *      priv;
     void        (*write)(int func, int addr, uint8_t val, void *priv);
     uint8_t     (*read)(int func, int addr, void *priv);
+    void        (*writel)(int func, int addr, uint32_t val, void *priv);
+    uint32_t    (*readl)(int func, int addr, void *priv);
     uint8_t     *slot;
 } pci_card_desc_t;
 
+/* Copies of the ID and the revision/class code dwords, which firmware and
+   operating systems read over and over while enumerating. An entry is valid
+   while its generation matches pci_shadow_gen, which any configuration write,
+   reset or slot change bumps, as a write to one card may hide or reveal
+   functions of another. */
+typedef struct pci_shadow_t {
+    uint32_t    regs[2];
+    uint32_t    gen[2];
+} pci_shadow_t;
+
 typedef struct pci_mirq_t {
     uint8_t     enabled;
     uint8_t     irq_line;
@@ -94,6 +108,8 @@ static int         pci_bus;
 static int         pci_key;
 static int         pci_trc_reg = 0;
 static uint32_t    pci_enable = 0x00000000;
+static pci_shadow_t pci_shadow[PCI_CARDS_NUM][8];
+static uint32_t    pci_shadow_gen = 1;
 
 static void        pci_reset_regs(void);
 
@@ -115,6 +131,15 @@ pci_log(const char *fmt, ...)
 #    define pci_log(fmt, ...)
 #endif
 
+static void
+pci_shadow_invalidate(void)
+{
+    if (++pci_shadow_gen == 0) {
+        memset(pci_shadow, 0x00, sizeof(pci_shadow));
+        pci_shadow_gen = 1;
+    }
+}
+
 void
 pci_set_irq_routing(int pci_int, int irq)
 {
@@ -258,9 +283,13 @@ pci_clear_slot(int card)
     for (uint8_t i = 0; i < 4; i++)
         pci_cards[card].irq_routing[i] = 0;
 
-    pci_cards[card].read  = NULL;
-    pci_cards[card].write = NULL;
-    pci_cards[card].priv  = NULL;
+    pci_cards[card].read   = NULL;
+    pci_cards[card].write  = NULL;
+    pci_cards[card].readl  = NULL;
+    pci_cards[card].writel = NULL;
+    pci_cards[card].priv   = NULL;
+
+    pci_shadow_invalidate();
 }
 
 /* Relocate a PCI device to a new slot, required for the configurable
@@ -292,6 +321,8 @@ pci_relocate_slot(int type, int new_slot)
 
     if (pci_card_to_slot_mapping[0][new_slot] == PCI_CARD_INVALID)
         pci_card_to_slot_mapping[0][new_slot] = card;
+
+    pci_shadow_invalidate();
 }
 
 /* Write PCI enable/disable key, split for the ALi M1435. */
@@ -357,6 +388,51 @@ pci_reg_write(uint16_t port, uint8_t val)
             (port >= 0xc000) ? 2 : 1, slot,
             (slot == PCI_CARD_INVALID) ? "non-existent" : (pci_cards[slot].write ? "used" : "unused"),
             pci_card, pci_bus, pci_func, pci_index | (port & 0x03), val);
+
+    pci_shadow_invalidate();
+}
+
+/* Aligned dword write, looks the card up once and hands the whole dword to
+   its writel handler if it has one. */
+static void
+pci_reg_writel(uint16_t port, uint32_t val)
+{
+    const pci_card_t *card;
+    uint8_t           slot = 0;
+
+    if (port >= 0xc000) {
+        pci_card  = (port >> 8) & 0xf;
+        pci_index = port & 0xfc;
+    }
+
+    slot = pci_card_to_slot_mapping[pci_bus_number_to_index_mapping[pci_bus]][pci_card];
+    if (slot != PCI_CARD_INVALID) {
+        card = &pci_cards[slot];
+        if (card->writel && !(pci_index & 0x03))
+            card->writel(pci_func, pci_index, val, card->priv);
+        else if (card->write) {
+            for (uint8_t i = 0; i < 4; i++)
+                card->write(pci_func, pci_index | i, (val >> (i << 3)) & 0xff, card->priv);
+        }
+    }
+    pci_log("PCI: [WL] Mechanism #%i, slot %02X, %s card %02X:%02X, function %02X, index %02X = %08X\n",
+            (port >= 0xc000) ? 2 : 1, slot,
+            (slot == PCI_CARD_INVALID) ? "non-existent" : (pci_cards[slot].write ? "used" : "unused"),
+            pci_card, pci_bus, pci_func, pci_index, val);
+
+    pci_shadow_invalidate();
+}
+
+/* Whether the configuration data port is currently open. */
+static int
+pci_reg_enabled(uint16_t port)
+{
+    if (port >= 0xc100)
+        return (pci_flags & FLAG_MECHANISM_2) && (pci_flags & FLAG_CONFIG_IO_ON);
+    else if (port >= 0xc000)
+        return (pci_flags & FLAG_MECHANISM_2) && (pci_flags & (FLAG_CONFIG_IO_ON | FLAG_CONFIG_DEV0_IO_ON));
+
+    return (pci_flags & FLAG_MECHANISM_1) && (pci_flags & FLAG_CONFIG_M1_IO_ON);
 }
 
 static void
@@ -379,6 +455,7 @@ static void
 pci_reset_hard(void)
 {
     pci_reset_regs();
+    pci_shadow_invalidate();
 
     for (uint8_t i = 0; i < PCI_IRQS_NUM; i++) {
         if (pci_irq_hold[i]) {
@@ -543,9 +620,9 @@ pci_writel(uint16_t port, uint32_t val, UNUSED(void *priv))
                 break;
             case 0xcfc:
             case 0xc000 ... 0xcffc:
-                /* Still split because we cheat. */
-                pci_writew(port, val & 0xffff, priv);
-                pci_writew(port + 2, val >> 16, priv);
+                pci_log("PCI: [WL] Mechanism #%i port %04X = %08X\n", (port == 0xcfc) ? 1 : 2, port, val);
+                if (pci_reg_enabled(port))
+                    pci_reg_writel(port, val);
                 break;
 
             default:
@@ -567,7 +644,11 @@ pci_reg_read(uint16_t port)
 
     slot = pci_card_to_slot_mapping[pci_bus_number_to_index_mapping[pci_bus]][pci_card];
     if (slot != PCI_CARD_INVALID) {
-        if (pci_cards[slot].read)
+        const pci_shadow_t *shadow = &pci_shadow[slot][pci_func];
+
+        if (((pci_index & 0xf7) == 0x00) && (shadow->gen[pci_index >> 3] == pci_shadow_gen))
+            ret = shadow->regs[pci_index >> 3] >> ((port & 0x03) << 3);
+        else if (pci_cards[slot].read)
             ret = pci_cards[slot].read(pci_func, pci_index | (port & 0x03), pci_cards[slot].priv);
     }
     pci_log("PCI: [RB] Mechanism #%i, slot %02X, %s card %02X:%02X, function %02X, index %02X = %02X\n",
@@ -578,6 +659,52 @@ pci_reg_read(uint16_t port)
     return ret;
 }
 
+/* Aligned dword read, looks the card up once, serves the ID and class code
+   dwords from the shadow and uses the readl handler of the card if it has
+   one. */
+static uint32_t
+pci_reg_readl(uint16_t port)
+{
+    const pci_card_t *card;
+    pci_shadow_t     *shadow;
+    uint8_t           slot = 0;
+    uint32_t          ret  = 0xffffffff;
+
+    if (port >= 0xc000) {
+        pci_card  = (port >> 8) & 0xf;
+        pci_index = port & 0xfc;
+    }
+
+    slot = pci_card_to_slot_mapping[pci_bus_number_to_index_mapping[pci_bus]][pci_card];
+    if (slot != PCI_CARD_INVALID) {
+        card   = &pci_cards[slot];
+        shadow = &pci_shadow[slot][pci_func];
+
+        if (((pci_index & 0xf7) == 0x00) && (shadow->gen[pci_index >> 3] == pci_shadow_gen))
+            ret = shadow->regs[pci_index >> 3];
+        else {
+            if (card->readl && !(pci_index & 0x03))
+                ret = card->readl(pci_func, pci_index, card->priv);
+            else if (card->read) {
+                ret = 0x00000000;
+                for (uint8_t i = 0; i < 4; i++)
+                    ret |= ((uint32_t) card->read(pci_func, pci_index | i, card->priv)) << (i << 3);
+            }
+
+            if ((pci_index & 0xf7) == 0x00) {
+                shadow->regs[pci_index >> 3] = ret;
+                shadow->gen[pci_index >> 3]  = pci_shadow_gen;
+            }
+        }
+    }
+    pci_log("PCI: [RL] Mechanism #%i, slot %02X, %s card %02X:%02X, function %02X, index %02X = %08X\n",
+            (port >= 0xc000) ? 2 : 1, slot,
+            (slot == PCI_CARD_INVALID) ? "non-existent" : (pci_cards[slot].read ? "used" : "unused"),
+            pci_card, pci_bus, pci_func, pci_index, ret);
+
+    return ret;
+}
+
 uint8_t
 pci_read(uint16_t port, UNUSED(void *priv))
 {
@@ -680,9 +807,9 @@ pci_readl(uint16_t port, UNUSED(void *priv))
                 break;
             case 0xcfc:
             case 0xc000 ... 0xcffc:
-                /* Still split because we cheat. */
-                ret = pci_readw(port, priv);
-                ret |= ((uint32_t) pci_readw(port + 2, priv)) << 16;
+                if (pci_reg_enabled(port))
+                    ret = pci_reg_readl(port);
+                pci_log("PCI: [RL] Mechanism #%i port %04X = %08X\n", (port == 0xcfc) ? 1 : 2, port, ret);
                 break;
         }
     }
@@ -723,6 +850,8 @@ pci_register_bus_slot(int bus, int card, int type, int inta, int intb, int intc,
     dev->irq_routing[3]                 = intd;
     dev->read                           = NULL;
     dev->write                          = NULL;
+    dev->readl                          = NULL;
+    dev->writel                         = NULL;
     dev->priv                           = NULL;
     pci_card_to_slot_mapping[bus][card] = last_pci_card;
 
@@ -778,10 +907,12 @@ pci_find_slot(uint8_t add_type, uint8_t ignore_slot)
     return ret;
 }
 
-/* Add a PCI card. */
+/* Add a PCI card with optional handlers for aligned dword accesses. */
 void
-pci_add_card(uint8_t add_type, uint8_t (*read)(int func, int addr, void *priv),
-             void (*write)(int func, int addr, uint8_t val, void *priv), void *priv, uint8_t *slot)
+pci_add_card_ex(uint8_t add_type, uint8_t (*read)(int func, int addr, void *priv),
+                void (*write)(int func, int addr, uint8_t val, void *priv),
+                uint32_t (*readl)(int func, int addr, void *priv),
+                void (*writel)(int func, int addr, uint32_t val, void *priv), void *priv, uint8_t *slot)
 {
     pci_card_desc_t *dev;
 
@@ -790,11 +921,13 @@ pci_add_card(uint8_t add_type, uint8_t (*read)(int func, int addr, void *priv),
     if (next_pci_card < PCI_CARDS_NUM) {
         dev = &pci_card_descs[next_pci_card];
 
-        dev->type  = add_type | PCI_ADD_STRICT;
-        dev->read  = read;
-        dev->write = write;
-        dev->priv  = priv;
-        dev->slot  = slot;
+        dev->type   = add_type | PCI_ADD_STRICT;
+        dev->read   = read;
+        dev->write  = write;
+        dev->readl  = readl;
+        dev->writel = writel;
+        dev->priv   = priv;
+        dev->slot   = slot;
 
         *(dev->slot) = PCI_CARD_INVALID;
 
@@ -804,6 +937,14 @@ pci_add_card(uint8_t add_type, uint8_t (*read)(int func, int addr, void *priv),
     }
 }
 
+/* Add a PCI card. */
+void
+pci_add_card(uint8_t add_type, uint8_t (*read)(int func, int addr, void *priv),
+             void (*write)(int func, int addr, uint8_t val, void *priv), void *priv, uint8_t *slot)
+{
+    pci_add_card_ex(add_type, read, write, NULL, NULL, priv, slot);
+}
+
 static void
 pci_clear_card(UNUSED(int pci_card))
 {
@@ -833,11 +974,15 @@ pci_register_card(int pci_card)
 
             if (i != PCI_CARD_INVALID) {
                 card = &pci_cards[i];
-                card->read  = dev->read;
-                card->write = dev->write;
-                card->priv  = dev->priv;
+                card->read   = dev->read;
+                card->write  = dev->write;
+                card->readl  = dev->readl;
+                card->writel = dev->writel;
+                card->priv   = dev->priv;
                 card->type |= (dev->type & PCI_CARD_VFIO);
 
+                pci_shadow_invalidate();
+
                 *(dev->slot) = i;
 
                 ret = i;
@@ -859,9 +1004,13 @@ pci_add_bridge(uint8_t agp, uint8_t (*read)(int func, int addr, void *priv), voi
 
     if (bridge_slot != PCI_CARD_INVALID) {
         card = &pci_cards[bridge_slot];
-        card->read  = read;
-        card->write = write;
-        card->priv  = priv;
+        card->read   = read;
+        card->write  = write;
+        card->readl  = NULL;
+        card->writel = NULL;
+        card->priv   = priv;
+
+        pci_shadow_invalidate();
     }
 
     *slot = bridge_slot;
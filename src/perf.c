@@ -0,0 +1,238 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Performance counters and host time accounting.
+ *
+ *          The rates are published through a sequence count, odd while
+ *          they are being written, so a reader that raced the update
+ *          simply copies them again.
+ */
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <wchar.h>
+#include <86box/86box.h>
+#include <86box/plat.h>
+#include <86box/thread.h>
+#include <86box/perf.h>
+#ifdef USE_DYNAREC
+#    include "codegen_public.h"
+#endif
+
+/* Longest input to present time that is still counted. */
+#define PERF_LATENCY_MAX_US 250000
+
+int perf_panel = 0;
+
+perf_counters_t  perf_counters;
+volatile uint8_t perf_subsys = PERF_IDLE;
+
+static atomic_uint   perf_samples[PERF_MAX];
+static atomic_uint   perf_presented;
+static atomic_uint   perf_dropped;
+static atomic_ullong perf_input_us; /* When the input not presented yet came in, 0 for none. */
+static atomic_ullong perf_latency_sum;
+static atomic_uint   perf_latency_count;
+static atomic_uint   perf_latency_max;
+static atomic_int    perf_sampler_run;
+static thread_t     *perf_sampler = NULL;
+static atomic_uint   perf_seq;
+static perf_stats_t  perf_stats;
+
+/* What the rates of the last update were worked out from. */
+static perf_counters_t perf_last;
+static uint32_t        perf_last_presented;
+static uint32_t        perf_last_dropped;
+static uint32_t        perf_last_samples[PERF_MAX];
+static uint32_t        perf_last_ticks;
+
+void
+perf_frame_presented(void)
+{
+    uint64_t input = atomic_exchange_explicit(&perf_input_us, 0, memory_order_relaxed);
+    uint64_t latency;
+
+    atomic_fetch_add_explicit(&perf_presented, 1, memory_order_relaxed);
+
+    if (!input)
+        return;
+
+    /* Input that did not change the picture is only presented with the idle
+       refresh, so the worst cases are left out. */
+    latency = plat_get_ticks_us() - input;
+    if (latency < PERF_LATENCY_MAX_US) {
+        uint32_t max = atomic_load_explicit(&perf_latency_max, memory_order_relaxed);
+
+        atomic_fetch_add_explicit(&perf_latency_sum, latency, memory_order_relaxed);
+        atomic_fetch_add_explicit(&perf_latency_count, 1, memory_order_relaxed);
+        while ((latency > max) && !atomic_compare_exchange_weak_explicit(&perf_latency_max, &max, (uint32_t) latency,
+                                                                         memory_order_relaxed, memory_order_relaxed))
+            ;
+    }
+}
+
+void
+perf_frame_dropped(void)
+{
+    atomic_fetch_add_explicit(&perf_dropped, 1, memory_order_relaxed);
+}
+
+void
+perf_input_event(void)
+{
+    unsigned long long none = 0;
+
+    if (perf_panel)
+        atomic_compare_exchange_strong_explicit(&perf_input_us, &none, plat_get_ticks_us(),
+                                                memory_order_relaxed, memory_order_relaxed);
+}
+
+uint32_t
+perf_frames_presented(void)
+{
+    return atomic_load_explicit(&perf_presented, memory_order_relaxed);
+}
+
+static void
+perf_sampler_thread(UNUSED(void *priv))
+{
+    while (atomic_load(&perf_sampler_run)) {
+        plat_delay_ms(1);
+        atomic_fetch_add_explicit(&perf_samples[perf_subsys % PERF_MAX], 1, memory_order_relaxed);
+    }
+}
+
+void
+perf_sampling(int on)
+{
+    if (on && (perf_sampler == NULL)) {
+        atomic_store(&perf_sampler_run, 1);
+        perf_sampler = thread_create(perf_sampler_thread, NULL);
+    } else if (!on && (perf_sampler != NULL)) {
+        atomic_store(&perf_sampler_run, 0);
+        thread_wait(perf_sampler);
+        perf_sampler = NULL;
+    }
+}
+
+static void
+perf_publish(const perf_stats_t *stats)
+{
+    atomic_fetch_add_explicit(&perf_seq, 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    memcpy(&perf_stats, stats, sizeof(perf_stats_t));
+    atomic_fetch_add_explicit(&perf_seq, 1, memory_order_release);
+}
+
+/* Called about once a second by the emulation thread. */
+void
+perf_tick(void)
+{
+    perf_stats_t stats;
+    uint32_t     ticks     = plat_get_ticks();
+    uint32_t     ms        = ticks - perf_last_ticks;
+    uint32_t     presented = atomic_load_explicit(&perf_presented, memory_order_relaxed);
+    uint32_t     dropped   = atomic_load_explicit(&perf_dropped, memory_order_relaxed);
+    uint32_t     samples[PERF_MAX];
+    uint32_t     total = 0;
+    uint64_t     latency_sum;
+    uint32_t     latency_count;
+
+    if (ms == 0)
+        return;
+
+    stats.speed_pct     = (int) (((perf_counters.emu_ms - perf_last.emu_ms) * 100) / ms);
+    stats.mips          = (perf_counters.ins - perf_last.ins) / (ms * 1000.0);
+    stats.fps_rendered  = (uint32_t) (((perf_counters.frames_rendered - perf_last.frames_rendered) * 1000) / ms);
+    stats.fps_presented = (uint32_t) (((uint64_t) (presented - perf_last_presented) * 1000) / ms);
+    stats.fps_dropped   = (uint32_t) (((uint64_t) (dropped - perf_last_dropped) * 1000) / ms);
+
+    latency_sum          = atomic_exchange_explicit(&perf_latency_sum, 0, memory_order_relaxed);
+    latency_count        = atomic_exchange_explicit(&perf_latency_count, 0, memory_order_relaxed);
+    stats.latency_max_us = (int) atomic_exchange_explicit(&perf_latency_max, 0, memory_order_relaxed);
+    if (latency_count)
+        stats.latency_us = (int) (latency_sum / latency_count);
+    else
+        stats.latency_us = stats.latency_max_us = -1;
+
+    for (int i = 0; i < PERF_MAX; i++) {
+        samples[i] = atomic_load_explicit(&perf_samples[i], memory_order_relaxed);
+        total += samples[i] - perf_last_samples[i];
+    }
+    for (int i = 0; i < PERF_MAX; i++) {
+        stats.host_pct[i]    = total ? (int) (((uint64_t) (samples[i] - perf_last_samples[i]) * 100) / total) : -1;
+        perf_last_samples[i] = samples[i];
+    }
+
+#if defined(USE_DYNAREC) && defined(USE_NEW_DYNAREC)
+    stats.cache_pct = codegen_cache_usage_pct();
+#else
+    stats.cache_pct = -1;
+#endif
+
+    perf_publish(&stats);
+
+    perf_last           = perf_counters;
+    perf_last_presented = presented;
+    perf_last_dropped   = dropped;
+    perf_last_ticks     = ticks;
+}
+
+uint32_t
+perf_get_stats(perf_stats_t *stats)
+{
+    uint32_t seq;
+
+    do {
+        while ((seq = atomic_load_explicit(&perf_seq, memory_order_acquire)) & 1)
+            ;
+        memcpy(stats, &perf_stats, sizeof(perf_stats_t));
+        atomic_thread_fence(memory_order_acquire);
+    } while (atomic_load_explicit(&perf_seq, memory_order_relaxed) != seq);
+
+    return seq >> 1;
+}
+
+void
+perf_init(void)
+{
+    perf_stats_t stats = { 0 };
+
+    for (int i = 0; i < PERF_MAX; i++)
+        stats.host_pct[i] = -1;
+    stats.cache_pct      = -1;
+    stats.latency_us     = -1;
+    stats.latency_max_us = -1;
+    perf_publish(&stats);
+
+    perf_last           = perf_counters;
+    perf_last_presented = atomic_load(&perf_presented);
+    perf_last_dropped   = atomic_load(&perf_dropped);
+    perf_last_ticks     = plat_get_ticks();
+    for (int i = 0; i < PERF_MAX; i++)
+        perf_last_samples[i] = atomic_load(&perf_samples[i]);
+
+    perf_sampling(perf_panel);
+}
+
+void
+perf_close(void)
+{
+    perf_sampling(0);
+}
+
+/* The sampler did not make it across the fork(). */
+void
+perf_clone_child(void)
+{
+    if (perf_sampler != NULL) {
+        perf_sampler = NULL;
+        perf_sampling(1);
+    }
+}
@@ -19,6 +19,7 @@
  */
 #include <inttypes.h>
 #include <stdarg.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -38,6 +39,7 @@
 #include <86box/apm.h>
 #include <86box/nvr.h>
 #include <86box/acpi.h>
+#include <86box/snapshot.h>
 #include <86box/plat_unused.h>
 
 enum {
@@ -66,6 +68,46 @@ static uint16_t latched_irqs   = 0x0000;
 
 static void (*update_pending)(void);
 
+/* The highest priority IRQ set in a mask, for each IRQ that can be the
+   highest priority one, 0xff if none is set. */
+static uint8_t pic_prio_tab[8][256];
+static int     pic_prio_tab_inited = 0;
+
+#ifdef USE_PIC_STATS
+/* Time from an IRQ being requested to it being acknowledged, in CPU cycles. */
+typedef struct pic_irq_stats_t {
+    uint32_t raises;
+    uint32_t acks;
+    uint64_t raised_at;
+    uint64_t latency;
+    uint64_t latency_max;
+} pic_irq_stats_t;
+
+static pic_irq_stats_t pic_irq_stats[16];
+
+static void
+pic_stats_raise(uint16_t raised)
+{
+    for (int i = 0; i < 16; i++) {
+        if (raised & (1 << i)) {
+            pic_irq_stats[i].raises++;
+            pic_irq_stats[i].raised_at = tsc;
+        }
+    }
+}
+
+static void
+pic_stats_ack(int irq)
+{
+    uint64_t latency = tsc - pic_irq_stats[irq].raised_at;
+
+    pic_irq_stats[irq].acks++;
+    pic_irq_stats[irq].latency += latency;
+    if (latency > pic_irq_stats[irq].latency_max)
+        pic_irq_stats[irq].latency_max = latency;
+}
+#endif
+
 #ifdef ENABLE_PIC_LOG
 int pic_do_log = ENABLE_PIC_LOG;
 
@@ -76,7 +118,7 @@ pic_log(const char *fmt, ...)
 
     if (pic_do_log) {
         va_start(ap, fmt);
-        pclog_ex(fmt, ap);
+        pclog_fast_ex(fmt, ap);
         va_end(ap);
     }
 }
@@ -187,24 +229,39 @@ pic_slave_on(pic_t *dev, int channel)
     return pic_cascade_mode(dev) && (dev->is_master || ((dev->icw4 & 0x0c) == 0x0c)) && (dev->icw3 & (1 << channel));
 }
 
+static void
+pic_prio_tab_init(void)
+{
+    for (uint8_t p = 0; p < 8; p++) {
+        for (uint16_t m = 0; m < 256; m++) {
+            pic_prio_tab[p][m] = 0xff;
+
+            for (uint8_t i = 0; i < 8; i++) {
+                if (m & (1 << ((i + p) & 7))) {
+                    pic_prio_tab[p][m] = (i + p) & 7;
+                    break;
+                }
+            }
+        }
+    }
+
+    pic_prio_tab_inited = 1;
+}
+
+/* The highest priority IRQ that is either in service or requested and not
+   masked wins, and is only delivered if it is not already in service. */
 static __inline int
 find_best_interrupt(pic_t *dev)
 {
-    uint8_t b;
     uint8_t intr;
     uint8_t j;
     int8_t  ret = -1;
 
-    for (uint8_t i = 0; i < 8; i++) {
-        j = (i + dev->priority) & 7;
-        b = 1 << j;
+    if (dev->state == 0) {
+        j = pic_prio_tab[dev->priority][dev->isr | (dev->irr & ~dev->imr)];
 
-        if (dev->isr & b)
-            break;
-        else if ((dev->state == 0) && ((dev->irr & ~dev->imr) & b)) {
+        if ((j != 0xff) && !(dev->isr & (1 << j)))
             ret = j;
-            break;
-        }
     }
 
     intr = dev->interrupt = (ret == -1) ? 0x17 : ret;
@@ -256,6 +313,9 @@ pic_reset(void)
     int is_at = IS_AT(machine);
     is_at     = is_at || !strcmp(machine_get_internal_name(), "xi8088");
 
+    if (!pic_prio_tab_inited)
+        pic_prio_tab_init();
+
     memset(&pic, 0, sizeof(pic_t));
     memset(&pic2, 0, sizeof(pic_t));
 
@@ -319,6 +379,12 @@ pic_acknowledge(pic_t *dev)
     int pic_int     = dev->interrupt & 7;
     int pic_int_num = 1 << pic_int;
 
+#ifdef USE_PIC_STATS
+    /* The cascade line is accounted for on the slave. */
+    if ((dev != &pic) || !(dev->icw3 & pic_int_num) || (dev->slaves[pic_int] == NULL))
+        pic_stats_ack(pic_int + ((dev == &pic2) ? 8 : 0));
+#endif
+
     dev->isr |= pic_int_num;
     if (!pic_level_triggered(dev, pic_int) || (dev->lines[pic_int] == 0))
         dev->irr &= ~pic_int_num;
@@ -329,21 +395,12 @@ pic_acknowledge(pic_t *dev)
 static uint8_t
 pic_non_specific_find(pic_t *dev)
 {
-    uint8_t j;
-    uint8_t b;
-    uint8_t irq = 0xff;
+    uint8_t isr = dev->isr;
 
-    for (uint8_t i = 0; i < 8; i++) {
-        j = (i + dev->priority) & 7;
-        b = (1 << j);
-
-        if ((dev->isr & b) && (!dev->special_mask_mode || !(dev->imr & b))) {
-            irq = j;
-            break;
-        }
-    }
+    if (dev->special_mask_mode)
+        isr &= ~dev->imr;
 
-    return irq;
+    return pic_prio_tab[dev->priority][isr];
 }
 
 /* Do the EOI and rotation, if either is requested, on the given IRQ. */
@@ -617,9 +674,82 @@ pic_mouse_latch(int enable)
         picintc(0x1000);
 }
 
+void
+pic_stats_dump(void)
+{
+#ifdef USE_PIC_STATS
+    double cycles_us = (double) cpu_s->rspeed / 1000000.0;
+    int    header    = 0;
+
+    for (int i = 0; i < 16; i++) {
+        pic_irq_stats_t *s = &pic_irq_stats[i];
+
+        if (!s->raises && !s->acks)
+            continue;
+
+        if (!header) {
+            pclog("PIC IRQ statistics:\n");
+            pclog("%-4s %12s %12s %12s %12s\n", "IRQ", "Raised", "Acked", "Avg us", "Max us");
+            header = 1;
+        }
+
+        pclog("%-4i %12u %12u %12.2f %12.2f\n", i, s->raises, s->acks,
+              s->acks ? ((double) s->latency / (double) s->acks) / cycles_us : 0.0,
+              (double) s->latency_max / cycles_us);
+    }
+
+    memset(pic_irq_stats, 0x00, sizeof(pic_irq_stats));
+#endif
+}
+
+static void
+pic_snapshot_write(snapshot_t *s, pic_t *dev)
+{
+    /* Everything but the slave pointers, which stay as wired up. */
+    snapshot_write(s, dev, offsetof(pic_t, slaves));
+}
+
+static int
+pic_snapshot_read(snapshot_t *s, pic_t *dev)
+{
+    return snapshot_read(s, dev, offsetof(pic_t, slaves));
+}
+
+void
+pic_snapshot_save(snapshot_t *s)
+{
+    pic_snapshot_write(s, &pic);
+    pic_snapshot_write(s, &pic2);
+    snapshot_write(s, &shadow, sizeof(shadow));
+    snapshot_write(s, &elcr_enabled, sizeof(elcr_enabled));
+    snapshot_write(s, &smi_irq_mask, sizeof(smi_irq_mask));
+    snapshot_write(s, &smi_irq_status, sizeof(smi_irq_status));
+    snapshot_write(s, &latched_irqs, sizeof(latched_irqs));
+    snapshot_write_timer(s, &pic_timer);
+}
+
+int
+pic_snapshot_load(snapshot_t *s)
+{
+    if (!pic_snapshot_read(s, &pic) || !pic_snapshot_read(s, &pic2) ||
+        !snapshot_read(s, &shadow, sizeof(shadow)) ||
+        !snapshot_read(s, &elcr_enabled, sizeof(elcr_enabled)) ||
+        !snapshot_read(s, &smi_irq_mask, sizeof(smi_irq_mask)) ||
+        !snapshot_read(s, &smi_irq_status, sizeof(smi_irq_status)) ||
+        !snapshot_read(s, &latched_irqs, sizeof(latched_irqs)) ||
+        !snapshot_read_timer(s, &pic_timer))
+        return 0;
+
+    update_pending();
+
+    return 1;
+}
+
 static void
 pic_reset_hard(void)
 {
+    pic_stats_dump();
+
     pic_reset();
 
     /* Explicitly reset the latches. */
@@ -666,30 +796,18 @@ pic2_init(void)
 void
 picint_common(uint16_t num, int level, int set, uint8_t *irq_state)
 {
-    int     raise;
     int     max = 16;
     uint8_t b;
-    uint8_t slaves = 0;
+    uint8_t slaves = pic.icw3;
     uint16_t w;
     uint16_t lines = level ? 0x0000 : num;
     pic_t   *dev;
 
     /* Make sure to ignore all slave IRQ's, and in case of AT+,
        translate IRQ 2 to IRQ 9. */
-    for (uint8_t i = 0; i < 8; i++) {
-        b     = (uint8_t) (1 << i);
-        raise = num & b;
-
-        if (pic.icw3 & b) {
-            slaves++;
-
-            if (raise) {
-                num &= ~b;
-                if (pic.at && (i == 2))
-                    num |= (1 << 9);
-            }
-        }
-    }
+    if (pic.at && (num & slaves & 0x0004))
+        num |= (1 << 9);
+    num &= ~((uint16_t) slaves);
 
     if (!slaves)
         max = 8;
@@ -738,6 +856,10 @@ picint_common(uint16_t num, int level, int set, uint8_t *irq_state)
                 smi_irq_status |= num;
             }
 
+#ifdef USE_PIC_STATS
+            pic_stats_raise(num & ~(((uint16_t) pic2.irr << 8) | pic.irr));
+#endif
+
             if (num & 0xff00) {
                 /* Latch IRQ 12 if the mouse latch is enabled. */
                 if ((num & 0x1000) && mouse_latch)
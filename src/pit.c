@@ -18,6 +18,7 @@
 #include <inttypes.h>
 #include <math.h>
 #include <stdarg.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
@@ -42,6 +43,7 @@
 #include <86box/snd_speaker.h>
 #include <86box/video.h>
 #include <86box/plat_unused.h>
+#include <86box/snapshot.h>
 
 pit_intf_t pit_devs[2];
 
@@ -72,6 +74,9 @@ uint64_t RTCCONST;
 uint64_t ACPICONST;
 
 int refresh_at_enable = 1;
+
+static int      refresh_at_active = 0;
+static uint32_t refresh_at_edges  = 0;
 int io_delay          = 5;
 
 int64_t firsttime = 1;
@@ -91,7 +96,7 @@ pit_log(const char *fmt, ...)
 
     if (pit_do_log) {
         va_start(ap, fmt);
-        pclog_ex(fmt, ap);
+        pclog_fast_ex(fmt, ap);
         va_end(ap);
     }
 }
@@ -110,6 +115,8 @@ ctr_set_out(ctr_t *ctr, int out, void *priv)
     if (ctr->out_func != NULL)
         ctr->out_func(out, ctr->out, pit);
 
+    if (out && !ctr->out)
+        ctr->edges++;
     ctr->out = out;
 }
 
@@ -436,6 +443,14 @@ pit_ctr_set_out_func(void *data, int counter_id, void (*func)(int new_out, int o
     ctr->out_func = func;
 }
 
+static uint32_t
+pit_ctr_get_edges(void *data, int counter_id)
+{
+    const pit_t *pit = (pit_t *) data;
+
+    return pit->counters[counter_id].edges;
+}
+
 void
 pit_ctr_set_gate(void *data, int counter_id, int gate)
 {
@@ -817,10 +832,27 @@ pit_refresh_timer_xt(int new_out, int old_out, UNUSED(void *priv))
 }
 
 void
-pit_refresh_timer_at(int new_out, int old_out, UNUSED(void *priv))
+pit_refresh_at_init(void)
+{
+    refresh_at_enable = 1;
+    refresh_at_active = 1;
+    refresh_at_edges  = pit_devs[0].get_edges(pit_devs[0].data, 1);
+}
+
+uint8_t
+pit_refresh_at_get(void)
 {
-    if (refresh_at_enable && new_out && !old_out)
-        ppi.pb ^= 0x10;
+    uint32_t edges;
+
+    if (refresh_at_active) {
+        edges = pit_devs[0].get_edges(pit_devs[0].data, 1);
+
+        if (refresh_at_enable && ((edges - refresh_at_edges) & 1))
+            ppi.pb ^= 0x10;
+        refresh_at_edges = edges;
+    }
+
+    return ppi.pb & 0x10;
 }
 
 void
@@ -927,6 +959,32 @@ pit_close(void *priv)
         free(dev);
 }
 
+/* The counters up to the callbacks, which are wired up by the machine. */
+static void
+pit_save(void *priv, snapshot_t *s)
+{
+    pit_t *dev = (pit_t *) priv;
+
+    for (int i = 0; i < NUM_COUNTERS; i++)
+        snapshot_write(s, &dev->counters[i], offsetof(ctr_t, load_func));
+    snapshot_write(s, &dev->ctrl, sizeof(dev->ctrl));
+    snapshot_write_timer(s, &dev->callback_timer);
+}
+
+static int
+pit_load(void *priv, snapshot_t *s)
+{
+    pit_t *dev = (pit_t *) priv;
+
+    for (int i = 0; i < NUM_COUNTERS; i++) {
+        if (!snapshot_read(s, &dev->counters[i], offsetof(ctr_t, load_func)))
+            return 0;
+    }
+
+    return snapshot_read(s, &dev->ctrl, sizeof(dev->ctrl)) &&
+           snapshot_read_timer(s, &dev->callback_timer);
+}
+
 static void *
 pit_init(const device_t *info)
 {
@@ -963,6 +1021,8 @@ const device_t i8253_device = {
     .available     = NULL,
     .speed_changed = pit_speed_changed,
     .force_redraw  = NULL,
+    .save          = pit_save,
+    .load          = pit_load,
     .config        = NULL
 };
 
@@ -977,6 +1037,8 @@ const device_t i8253_ext_io_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
+    .save          = pit_save,
+    .load          = pit_load,
     .config        = NULL
 };
 
@@ -991,6 +1053,8 @@ const device_t i8254_device = {
     .available     = NULL,
     .speed_changed = pit_speed_changed,
     .force_redraw  = NULL,
+    .save          = pit_save,
+    .load          = pit_load,
     .config        = NULL
 };
 
@@ -1005,6 +1069,8 @@ const device_t i8254_sec_device = {
     .available     = NULL,
     .speed_changed = pit_speed_changed,
     .force_redraw  = NULL,
+    .save          = pit_save,
+    .load          = pit_load,
     .config        = NULL
 };
 
@@ -1019,6 +1085,8 @@ const device_t i8254_ext_io_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
+    .save          = pit_save,
+    .load          = pit_load,
     .config        = NULL
 };
 
@@ -1033,6 +1101,8 @@ const device_t i8254_ps2_device = {
     .available     = NULL,
     .speed_changed = pit_speed_changed,
     .force_redraw  = NULL,
+    .save          = pit_save,
+    .load          = pit_load,
     .config        = NULL
 };
 
@@ -1065,6 +1135,8 @@ pit_common_init(int type, void (*out0)(int new_out, int old_out, void *priv), vo
 
     pit_intf->data = pit;
 
+    refresh_at_active = 0;
+
     for (uint8_t i = 0; i < 3; i++) {
         pit_intf->set_gate(pit_intf->data, i, 1);
         pit_intf->set_using_timer(pit_intf->data, i, 1);
@@ -1259,5 +1331,6 @@ const pit_intf_t pit_classic_intf = {
     .set_load_func   = &pit_ctr_set_load_func,
     .ctr_clock       = &ctr_clock,
     .set_pit_const   = &pit_set_pit_const,
+    .get_edges       = &pit_ctr_get_edges,
     .data            = NULL,
 };
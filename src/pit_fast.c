@@ -18,6 +18,7 @@
 #include <inttypes.h>
 #include <math.h>
 #include <stdarg.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
@@ -41,12 +42,19 @@
 #include <86box/sound.h>
 #include <86box/snd_speaker.h>
 #include <86box/video.h>
+#include <86box/snapshot.h>
 
 #define PIT_PS2          16  /* The PIT is the PS/2's second PIT. */
 #define PIT_EXT_IO       32  /* The PIT has externally specified port I/O. */
 #define PIT_CUSTOM_CLOCK 64  /* The PIT uses custom clock inputs provided by another provider. */
 #define PIT_SECONDARY    128 /* The PIT is secondary (ports 0048-004B). */
 
+/* A rate generator or square wave whose OUT has no handler is not run edge
+   by edge. Its timer only fires on the period boundary closest to every
+   this many counts, and the count, OUT and the rising edges in between are
+   worked out from the time left when someone asks. */
+#define PITF_LAZY_COUNTS 0x10000
+
 #ifdef ENABLE_PIT_FAST_LOG
 int pit_fast_do_log = ENABLE_PIT_FAST_LOG;
 
@@ -75,9 +83,128 @@ pitf_ctr_set_out(ctrf_t *ctr, int out, void *priv)
 
     if (ctr->out_func != NULL)
         ctr->out_func(out, ctr->out, pit);
+    if (out && !ctr->out)
+        ctr->edges++;
     ctr->out = out;
 }
 
+static __inline uint64_t
+pitf_lazy_period(const ctrf_t *ctr)
+{
+    return (uint64_t) ctr->lazy_l * ctr->pit_const;
+}
+
+/* Time to the end of the current period. */
+static uint64_t
+pitf_lazy_rem(ctrf_t *ctr)
+{
+    uint64_t period    = pitf_lazy_period(ctr);
+    uint64_t remaining = timer_get_remaining_u64(&ctr->timer);
+
+    if (remaining == 0)
+        return 0;
+
+    return remaining - (((remaining - 1) / period) * period);
+}
+
+/* Periods of the current batch that are over. */
+static uint32_t
+pitf_lazy_done(ctrf_t *ctr)
+{
+    uint64_t period    = pitf_lazy_period(ctr);
+    uint64_t remaining = timer_get_remaining_u64(&ctr->timer);
+
+    return ctr->lazy_n - (uint32_t) ((remaining + period - 1) / period);
+}
+
+static int
+pitf_lazy_out(ctrf_t *ctr)
+{
+    if (ctr->lazy_m == 3)
+        return pitf_lazy_rem(ctr) > ((uint64_t) (ctr->lazy_l >> 1) * ctr->pit_const);
+
+    return 1;
+}
+
+static void
+pitf_set_delay(ctrf_t *ctr, uint64_t delay)
+{
+    if (ctr->lazy) {
+        ctr->edges += pitf_lazy_done(ctr);
+        ctr->lazy = 0;
+    }
+
+    timer_set_delay_u64(&ctr->timer, delay);
+}
+
+static void
+pitf_lazy_arm(ctrf_t *ctr, uint64_t rem)
+{
+    int      l      = ctr->l ? ctr->l : 0x10000;
+    uint64_t period = (uint64_t) l * ctr->pit_const;
+
+    /* A new count normally takes effect at the end of the current period,
+       if it is shorter, it is applied right away instead. */
+    if (rem > period)
+        rem = period;
+
+    ctr->lazy   = 1;
+    ctr->lazy_m = ctr->m;
+    ctr->lazy_l = l;
+    ctr->lazy_n = MAX(1, PITF_LAZY_COUNTS / l);
+    timer_set_delay_u64(&ctr->timer, rem + ((ctr->lazy_n - 1) * period));
+}
+
+/* Switch a counter in or out of lazy mode to match its state, after
+   anything that can affect it. */
+static void
+pitf_lazy_sync(ctrf_t *ctr, void *priv)
+{
+    int      want = ctr->running && !ctr->disabled && (ctr->out_func == NULL) &&
+                    ((ctr->m == 2) || (ctr->m == 3));
+    uint64_t rem;
+    uint64_t half;
+    int      l;
+
+    if (ctr->lazy) {
+        rem  = pitf_lazy_rem(ctr);
+        half = (uint64_t) (ctr->lazy_l >> 1) * ctr->pit_const;
+
+        if (want) {
+            ctr->edges += pitf_lazy_done(ctr);
+            pitf_lazy_arm(ctr, rem);
+            return;
+        }
+
+        /* Back to an event on every edge, starting from where it is at. */
+        ctr->edges += pitf_lazy_done(ctr);
+        ctr->lazy = 0;
+        if ((ctr->lazy_m == 3) && (rem > half)) {
+            pitf_ctr_set_out(ctr, 1, priv);
+            rem -= half;
+        } else
+            pitf_ctr_set_out(ctr, ctr->lazy_m != 3, priv);
+        timer_set_delay_u64(&ctr->timer, rem);
+    } else if (want && timer_is_enabled(&ctr->timer)) {
+        l   = ctr->l ? ctr->l : 0x10000;
+        rem = timer_get_remaining_u64(&ctr->timer);
+        if ((ctr->m == 3) && ctr->out)
+            rem += (uint64_t) (l >> 1) * ctr->pit_const;
+        pitf_lazy_arm(ctr, rem);
+    }
+}
+
+static void
+pitf_lazy_over(ctrf_t *ctr)
+{
+    int l = ctr->l ? ctr->l : 0x10000;
+
+    ctr->edges += ctr->lazy_n;
+    ctr->lazy_l = l;
+    ctr->lazy_n = MAX(1, PITF_LAZY_COUNTS / l);
+    timer_advance_u64(&ctr->timer, (uint64_t) ctr->lazy_n * l * ctr->pit_const);
+}
+
 static void
 pitf_ctr_set_load_func(void *data, int counter_id, void (*func)(uint8_t new_m, int new_count))
 {
@@ -90,6 +217,15 @@ pitf_ctr_set_load_func(void *data, int counter_id, void (*func)(uint8_t new_m, i
     ctr->load_func = func;
 }
 
+static uint32_t
+pitf_ctr_get_edges(void *data, int counter_id)
+{
+    pitf_t *pit = (pitf_t *) data;
+    ctrf_t *ctr = &pit->counters[counter_id];
+
+    return ctr->edges + (ctr->lazy ? pitf_lazy_done(ctr) : 0);
+}
+
 static uint16_t
 pitf_ctr_get_count(void *data, int counter_id)
 {
@@ -109,6 +245,7 @@ pitf_ctr_set_out_func(void *data, int counter_id, void (*func)(int new_out, int
     ctrf_t *ctr = &pit->counters[counter_id];
 
     ctr->out_func = func;
+    pitf_lazy_sync(ctr, pit);
 }
 
 void
@@ -125,6 +262,20 @@ pitf_ctr_set_using_timer(void *data, int counter_id, int using_timer)
 static int
 pitf_read_timer(ctrf_t *ctr)
 {
+    if (ctr->lazy) {
+        uint64_t rem  = pitf_lazy_rem(ctr);
+        uint64_t half = (uint64_t) (ctr->lazy_l >> 1) * ctr->pit_const;
+        int      read;
+
+        if (ctr->lazy_m == 3) {
+            if (rem > half)
+                rem -= half;
+            read = ((int) (rem / ctr->pit_const)) << 1;
+        } else
+            read = ((int) (rem / ctr->pit_const)) + 1;
+
+        return MIN(read, 0x10000);
+    }
     if (ctr->using_timer && !(ctr->m == 3 && !ctr->gate) && timer_is_enabled(&ctr->timer)) {
         int read = (int) ((timer_get_remaining_u64(&ctr->timer)) / ctr->pit_const);
         if (ctr->m == 2)
@@ -151,6 +302,10 @@ pitf_dump_and_disable_timer(ctrf_t *ctr)
         ctr->count = pitf_read_timer(ctr);
         if (ctr->m == 2)
             ctr->count--; /* Don't store the offset from pitf_read_timer */
+        if (ctr->lazy) {
+            ctr->edges += pitf_lazy_done(ctr);
+            ctr->lazy = 0;
+        }
         timer_disable(&ctr->timer);
     }
 }
@@ -168,7 +323,7 @@ pitf_ctr_load(ctrf_t *ctr, void *priv)
         case 0: /*Interrupt on terminal count*/
             ctr->count = l;
             if (ctr->using_timer)
-                timer_set_delay_u64(&ctr->timer, (uint64_t) (l * ctr->pit_const));
+                pitf_set_delay(ctr, (uint64_t) (l * ctr->pit_const));
             pitf_ctr_set_out(ctr, 0, pit);
             ctr->thit    = 0;
             ctr->enabled = ctr->gate;
@@ -180,7 +335,7 @@ pitf_ctr_load(ctrf_t *ctr, void *priv)
             if (ctr->initial) {
                 ctr->count = l - 1;
                 if (ctr->using_timer)
-                    timer_set_delay_u64(&ctr->timer, (uint64_t) ((l - 1) * ctr->pit_const));
+                    pitf_set_delay(ctr, (uint64_t) ((l - 1) * ctr->pit_const));
                 pitf_ctr_set_out(ctr, 1, pit);
                 ctr->thit = 0;
             }
@@ -190,7 +345,7 @@ pitf_ctr_load(ctrf_t *ctr, void *priv)
             if (ctr->initial) {
                 ctr->count = l;
                 if (ctr->using_timer)
-                    timer_set_delay_u64(&ctr->timer, (uint64_t) (((l + 1) >> 1) * ctr->pit_const));
+                    pitf_set_delay(ctr, (uint64_t) (((l + 1) >> 1) * ctr->pit_const));
                 else
                     ctr->newcount = (l & 1);
                 pitf_ctr_set_out(ctr, 1, pit);
@@ -204,7 +359,7 @@ pitf_ctr_load(ctrf_t *ctr, void *priv)
             else {
                 ctr->count = l;
                 if (ctr->using_timer)
-                    timer_set_delay_u64(&ctr->timer, (uint64_t) (l * ctr->pit_const));
+                    pitf_set_delay(ctr, (uint64_t) (l * ctr->pit_const));
                 pitf_ctr_set_out(ctr, 0, pit);
                 ctr->thit = 0;
             }
@@ -223,6 +378,7 @@ pitf_ctr_load(ctrf_t *ctr, void *priv)
 
     ctr->initial = 0;
     ctr->running = ctr->enabled && ctr->using_timer && !ctr->disabled;
+    pitf_lazy_sync(ctr, pit);
     if (ctr->using_timer && !ctr->running)
         pitf_dump_and_disable_timer(ctr);
 }
@@ -242,7 +398,7 @@ pitf_set_gate_no_timer(ctrf_t *ctr, int gate, void *priv)
         case 0: /*Interrupt on terminal count*/
         case 4: /*Software triggered stobe*/
             if (ctr->using_timer && !ctr->running)
-                timer_set_delay_u64(&ctr->timer, (uint64_t) (l * ctr->pit_const));
+                pitf_set_delay(ctr, (uint64_t) (l * ctr->pit_const));
             ctr->enabled = gate;
             break;
         case 1: /*Hardware retriggerable one-shot*/
@@ -250,7 +406,7 @@ pitf_set_gate_no_timer(ctrf_t *ctr, int gate, void *priv)
             if (gate && !ctr->gate) {
                 ctr->count = l;
                 if (ctr->using_timer)
-                    timer_set_delay_u64(&ctr->timer, (uint64_t) (l * ctr->pit_const));
+                    pitf_set_delay(ctr, (uint64_t) (l * ctr->pit_const));
                 pitf_ctr_set_out(ctr, 0, pit);
                 ctr->thit    = 0;
                 ctr->enabled = 1;
@@ -260,7 +416,7 @@ pitf_set_gate_no_timer(ctrf_t *ctr, int gate, void *priv)
             if (gate && !ctr->gate) {
                 ctr->count = l - 1;
                 if (ctr->using_timer)
-                    timer_set_delay_u64(&ctr->timer, (uint64_t) (l * ctr->pit_const));
+                    pitf_set_delay(ctr, (uint64_t) (l * ctr->pit_const));
                 pitf_ctr_set_out(ctr, 1, pit);
                 ctr->thit = 0;
             }
@@ -270,7 +426,7 @@ pitf_set_gate_no_timer(ctrf_t *ctr, int gate, void *priv)
             if (gate && !ctr->gate) {
                 ctr->count = l;
                 if (ctr->using_timer)
-                    timer_set_delay_u64(&ctr->timer, (uint64_t) (((l + 1) >> 1) * ctr->pit_const));
+                    pitf_set_delay(ctr, (uint64_t) (((l + 1) >> 1) * ctr->pit_const));
                 else
                     ctr->newcount = (l & 1);
                 pitf_ctr_set_out(ctr, 1, pit);
@@ -284,6 +440,7 @@ pitf_set_gate_no_timer(ctrf_t *ctr, int gate, void *priv)
     }
     ctr->gate    = gate;
     ctr->running = ctr->enabled && ctr->using_timer && !ctr->disabled;
+    pitf_lazy_sync(ctr, pit);
     if (ctr->using_timer && !ctr->running)
         pitf_dump_and_disable_timer(ctr);
 }
@@ -409,7 +566,9 @@ pitf_ctr_latch_count(ctrf_t *ctr)
 static __inline void
 pitf_ctr_latch_status(ctrf_t *ctr)
 {
-    ctr->read_status    = (ctr->ctrl & 0x3f) | (ctr->out ? 0x80 : 0);
+    int out = ctr->lazy ? pitf_lazy_out(ctr) : ctr->out;
+
+    ctr->read_status    = (ctr->ctrl & 0x3f) | (out ? 0x80 : 0);
     ctr->do_read_status = 1;
 }
 
@@ -475,6 +634,7 @@ pitf_write(uint16_t addr, uint8_t val, void *priv)
                     else
                         pitf_ctr_set_out(ctr, 1, dev);
                     ctr->disabled = 1;
+                    pitf_lazy_sync(ctr, dev);
 
                     pit_fast_log("PIT %i: M = %i, RM/WM = %i, Out = %i\n", t, ctr->m, ctr->rm, ctr->out);
                 }
@@ -629,7 +789,11 @@ pitf_timer_over(void *priv)
 {
     ctrf_t *ctr = (ctrf_t *) priv;
     pit_t *pit = (pit_t *)ctr->priv;
-    pitf_over(ctr, pit);
+
+    if (ctr->lazy)
+        pitf_lazy_over(ctr);
+    else
+        pitf_over(ctr, pit);
 }
 
 void
@@ -685,7 +849,16 @@ pitf_set_pit_const(void *data, uint64_t pit_const)
 
     for (uint8_t i = 0; i < NUM_COUNTERS; i++) {
         ctr = &pit->counters[i];
-        ctr->pit_const = pit_const;
+
+        /* The batch is in the old time base, restart it from here. */
+        if (ctr->lazy) {
+            uint64_t rem = pitf_lazy_rem(ctr) / ctr->pit_const;
+
+            ctr->edges += pitf_lazy_done(ctr);
+            ctr->pit_const = pit_const;
+            pitf_lazy_arm(ctr, rem * pit_const);
+        } else
+            ctr->pit_const = pit_const;
     }
 }
 
@@ -716,6 +889,34 @@ pitf_handler(int set, uint16_t base, int size, void *priv)
     io_handler(set, base, size, pitf_read, NULL, NULL, pitf_write, NULL, NULL, priv);
 }
 
+/* The counters up to the PIT constant, which follows the CPU speed, and
+   their timers. The callbacks are wired up by the machine. */
+static void
+pitf_save(void *priv, snapshot_t *s)
+{
+    pitf_t *dev = (pitf_t *) priv;
+
+    for (int i = 0; i < NUM_COUNTERS; i++) {
+        snapshot_write(s, &dev->counters[i], offsetof(ctrf_t, pit_const));
+        snapshot_write_timer(s, &dev->counters[i].timer);
+    }
+    snapshot_write(s, &dev->ctrl, sizeof(dev->ctrl));
+}
+
+static int
+pitf_load(void *priv, snapshot_t *s)
+{
+    pitf_t *dev = (pitf_t *) priv;
+
+    for (int i = 0; i < NUM_COUNTERS; i++) {
+        if (!snapshot_read(s, &dev->counters[i], offsetof(ctrf_t, pit_const)) ||
+            !snapshot_read_timer(s, &dev->counters[i].timer))
+            return 0;
+    }
+
+    return snapshot_read(s, &dev->ctrl, sizeof(dev->ctrl));
+}
+
 static void *
 pitf_init(const device_t *info)
 {
@@ -754,6 +955,8 @@ const device_t i8253_fast_device = {
     .available     = NULL,
     .speed_changed = pitf_speed_changed,
     .force_redraw  = NULL,
+    .save          = pitf_save,
+    .load          = pitf_load,
     .config        = NULL
 };
 
@@ -768,6 +971,8 @@ const device_t i8254_fast_device = {
     .available     = NULL,
     .speed_changed = pitf_speed_changed,
     .force_redraw  = NULL,
+    .save          = pitf_save,
+    .load          = pitf_load,
     .config        = NULL
 };
 
@@ -782,6 +987,8 @@ const device_t i8254_sec_fast_device = {
     .available     = NULL,
     .speed_changed = pitf_speed_changed,
     .force_redraw  = NULL,
+    .save          = pitf_save,
+    .load          = pitf_load,
     .config        = NULL
 };
 
@@ -796,6 +1003,8 @@ const device_t i8254_ext_io_fast_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
+    .save          = pitf_save,
+    .load          = pitf_load,
     .config        = NULL
 };
 
@@ -810,6 +1019,8 @@ const device_t i8254_ps2_fast_device = {
     .available     = NULL,
     .speed_changed = pitf_speed_changed,
     .force_redraw  = NULL,
+    .save          = pitf_save,
+    .load          = pitf_load,
     .config        = NULL
 };
 
@@ -823,5 +1034,6 @@ const pit_intf_t pit_fast_intf = {
     .set_load_func   = &pitf_ctr_set_load_func,
     .ctr_clock       = &pitf_ctr_clock,
     .set_pit_const   = &pitf_set_pit_const,
+    .get_edges       = &pitf_ctr_get_edges,
     .data            = NULL,
 };
@@ -36,6 +36,7 @@
 #include <86box/ppi.h>
 #include <86box/video.h>
 #include <86box/port_6x.h>
+#include <86box/snapshot.h>
 #include <86box/plat_unused.h>
 #include <86box/random.h>
 
@@ -83,7 +84,7 @@ port_6x_write(uint16_t port, uint8_t val, void *priv)
 static uint8_t
 port_61_read_simple(UNUSED(uint16_t port), UNUSED(void *priv))
 {
-    uint8_t ret = ppi.pb & 0x1f;
+    uint8_t ret = (ppi.pb & 0x0f) | pit_refresh_at_get();
 
     cycles -= cycles_sub;
 
@@ -107,7 +108,7 @@ port_61_read(UNUSED(uint16_t port), void *priv)
         if (dev->refresh)
             ret |= 0x10;
     } else
-        ret = ppi.pb & 0x1f;
+        ret = (ppi.pb & 0x0f) | pit_refresh_at_get();
 
     if (ppispeakon)
         ret |= 0x20;
@@ -173,6 +174,45 @@ port_6x_close(void *priv)
     free(dev);
 }
 
+/* Port 61h is kept in the PPI and the speaker gates, which have no device of
+   their own. */
+static void
+port_6x_save(void *priv, snapshot_t *s)
+{
+    port_6x_t *dev = (port_6x_t *) priv;
+
+    snapshot_write(s, &ppi, sizeof(ppi));
+    snapshot_write(s, &ppispeakon, sizeof(ppispeakon));
+    snapshot_write(s, &speaker_gated, sizeof(speaker_gated));
+    snapshot_write(s, &speaker_enable, sizeof(speaker_enable));
+    snapshot_write(s, &was_speaker_enable, sizeof(was_speaker_enable));
+    snapshot_write(s, &dev->refresh, sizeof(dev->refresh));
+    if (dev->flags & PORT_6X_EXT_REF)
+        snapshot_write_timer(s, &dev->refresh_timer);
+}
+
+static int
+port_6x_load(void *priv, snapshot_t *s)
+{
+    port_6x_t *dev = (port_6x_t *) priv;
+
+    if (!snapshot_read(s, &ppi, sizeof(ppi)) ||
+        !snapshot_read(s, &ppispeakon, sizeof(ppispeakon)) ||
+        !snapshot_read(s, &speaker_gated, sizeof(speaker_gated)) ||
+        !snapshot_read(s, &speaker_enable, sizeof(speaker_enable)) ||
+        !snapshot_read(s, &was_speaker_enable, sizeof(was_speaker_enable)) ||
+        !snapshot_read(s, &dev->refresh, sizeof(dev->refresh)))
+        return 0;
+
+    if ((dev->flags & PORT_6X_EXT_REF) && !snapshot_read_timer(s, &dev->refresh_timer))
+        return 0;
+
+    if (dev->flags & PORT_6X_TURBO)
+        xi8088_turbo_set(!!(ppi.pb & 0x04));
+
+    return 1;
+}
+
 void *
 port_6x_init(const device_t *info)
 {
@@ -215,6 +255,8 @@ const device_t port_6x_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
+    .save          = port_6x_save,
+    .load          = port_6x_load,
     .config        = NULL
 };
 
@@ -229,6 +271,8 @@ const device_t port_6x_xi8088_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
+    .save          = port_6x_save,
+    .load          = port_6x_load,
     .config        = NULL
 };
 
@@ -243,6 +287,8 @@ const device_t port_6x_ps2_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
+    .save          = port_6x_save,
+    .load          = port_6x_load,
     .config        = NULL
 };
 
@@ -257,5 +303,7 @@ const device_t port_6x_olivetti_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
+    .save          = port_6x_save,
+    .load          = port_6x_load,
     .config        = NULL
 };
@@ -29,6 +29,7 @@
 #include <86box/mem.h>
 #include <86box/pit.h>
 #include <86box/port_92.h>
+#include <86box/snapshot.h>
 #include <86box/plat_unused.h>
 
 #define PORT_92_INV   1
@@ -200,6 +201,32 @@ port_92_close(void *priv)
     free(dev);
 }
 
+/* Whether the port is decoded at all is up to the chipset, which restores
+   that along with its own registers. */
+static void
+port_92_save(void *priv, snapshot_t *s)
+{
+    port_92_t *dev = (port_92_t *) priv;
+
+    snapshot_write(s, &dev->reg, sizeof(dev->reg));
+    snapshot_write(s, &dev->flags, sizeof(dev->flags));
+    snapshot_write(s, &dev->pulse_period, sizeof(dev->pulse_period));
+    snapshot_write(s, &cpu_alt_reset, sizeof(cpu_alt_reset));
+    snapshot_write_timer(s, &dev->pulse_timer);
+}
+
+static int
+port_92_load(void *priv, snapshot_t *s)
+{
+    port_92_t *dev = (port_92_t *) priv;
+
+    return snapshot_read(s, &dev->reg, sizeof(dev->reg)) &&
+           snapshot_read(s, &dev->flags, sizeof(dev->flags)) &&
+           snapshot_read(s, &dev->pulse_period, sizeof(dev->pulse_period)) &&
+           snapshot_read(s, &cpu_alt_reset, sizeof(cpu_alt_reset)) &&
+           snapshot_read_timer(s, &dev->pulse_timer);
+}
+
 void *
 port_92_init(const device_t *info)
 {
@@ -238,6 +265,8 @@ const device_t port_92_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
+    .save          = port_92_save,
+    .load          = port_92_load,
     .config        = NULL
 };
 
@@ -252,6 +281,8 @@ const device_t port_92_key_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
+    .save          = port_92_save,
+    .load          = port_92_load,
     .config        = NULL
 };
 
@@ -266,6 +297,8 @@ const device_t port_92_inv_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
+    .save          = port_92_save,
+    .load          = port_92_load,
     .config        = NULL
 };
 
@@ -280,6 +313,8 @@ const device_t port_92_word_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
+    .save          = port_92_save,
+    .load          = port_92_load,
     .config        = NULL
 };
 
@@ -294,5 +329,7 @@ const device_t port_92_pci_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
+    .save          = port_92_save,
+    .load          = port_92_load,
     .config        = NULL
 };
@@ -138,6 +138,27 @@ FT_Library ft_lib = NULL;
 #define TYPEFACE_SVBUSABA   30
 #define TYPEFACE_SVJITTRA   31
 
+/* Font files, one FreeType face is kept open for each one in use. */
+static const char *font_files[] = {
+    FONT_FILE_DOTMATRIX,
+    FONT_FILE_DOTMATRIX_ITALIC,
+    FONT_FILE_ROMAN,
+    FONT_FILE_SANSSERIF,
+    FONT_FILE_COURIER,
+    FONT_FILE_SCRIPT,
+    FONT_FILE_OCRA,
+    FONT_FILE_OCRB
+};
+#define FONT_FILES (sizeof(font_files) / sizeof(font_files[0]))
+
+/* Rendered glyphs are cached per font file, size and slant, for the few
+   most recently used combinations. */
+#define GLYPH_SETS  8
+#define GLYPH_SLOTS 256
+
+/* Finished pages waiting to be written out. */
+#define PAGE_QUEUE 4
+
 /* Some helper macros. */
 #define PARAM16(x) (dev->esc_parms[x + 1] * 256 + dev->esc_parms[x])
 #define PIXX       ((unsigned) floor(dev->curr_x * dev->dpi + 0.5))
@@ -154,6 +175,35 @@ typedef struct psurface_t {
     uint8_t *pixels; /* grayscale pixel data */
 } psurface_t;
 
+typedef struct glyph_t {
+    FT_UInt  index;
+    uint8_t  valid;
+    int      left;
+    int      top;
+    FT_Pos   advance;
+    unsigned width;
+    unsigned rows;
+    uint8_t *buffer; /* width * rows coverage values */
+} glyph_t;
+
+typedef struct glyph_set_t {
+    uint8_t  font;
+    uint8_t  italic;
+    uint16_t hsize;
+    uint16_t vsize;
+    uint32_t used; /* last use, 0 if the set is free */
+    glyph_t  glyphs[GLYPH_SLOTS];
+} glyph_set_t;
+
+typedef struct page_job_t {
+    char     path[1024];
+    uint8_t *pixels;
+    uint16_t w;
+    uint16_t h;
+    uint16_t pitch;
+    PALETTE  palcol;
+} page_job_t;
+
 typedef struct escp_t {
     const char *name;
 
@@ -219,8 +269,13 @@ typedef struct escp_t {
     psurface_t *page;
     double      curr_x; /* print head position (x, inch) */
     double      curr_y; /* print head position (y, inch) */
-    uint16_t    current_font;
-    FT_Face     fontface;
+    uint16_t     current_font;
+    FT_Face      fontface;
+    FT_Face      faces[FONT_FILES];
+    glyph_set_t *glyph_sets;
+    glyph_set_t *glyphs; /* the set for the current font */
+    uint32_t     glyph_stamp;
+    prt_queue_t *queue;
     int8_t      lq_typeface;
     uint16_t    font_style;
     uint8_t     print_quality;
@@ -256,7 +311,7 @@ typedef struct escp_t {
 static void
 update_font(escp_t *dev);
 static void
-blit_glyph(escp_t *dev, unsigned destx, unsigned desty, int8_t add);
+blit_glyph(escp_t *dev, const glyph_t *glyph, unsigned destx, unsigned desty, int8_t add);
 static void
 draw_hline(escp_t *dev, unsigned from_x, unsigned to_x, unsigned y, int8_t broken);
 static void
@@ -346,15 +401,35 @@ escp_log(const char *fmt, ...)
 #    define escp_log(fmt, ...)
 #endif
 
-/* Dump the current page into a formatted file. */
 static void
-dump_page(escp_t *dev)
+write_page(void *priv)
 {
-    char path[1024];
+    page_job_t *job = (page_job_t *) priv;
+
+    png_write_rgb(job->path, job->pixels, job->w, job->h, job->pitch, job->palcol);
 
-    strcpy(path, dev->pagepath);
-    strcat(path, dev->page_fn);
-    png_write_rgb(path, dev->page->pixels, dev->page->w, dev->page->h, dev->page->pitch, dev->palcol);
+    free(job->pixels);
+    free(job);
+}
+
+/* Dump the current page into a formatted file. The page buffer is handed
+   over to the output thread, which encodes and frees it; the next call to
+   new_page() gets a fresh one. */
+static void
+dump_page(escp_t *dev)
+{
+    page_job_t *job = (page_job_t *) malloc(sizeof(page_job_t));
+
+    strcpy(job->path, dev->pagepath);
+    strcat(job->path, dev->page_fn);
+    job->pixels = dev->page->pixels;
+    job->w      = dev->page->w;
+    job->h      = dev->page->h;
+    job->pitch  = dev->page->pitch;
+    memcpy(job->palcol, dev->palcol, sizeof(PALETTE));
+
+    dev->page->pixels = NULL;
+    prt_queue_push(dev->queue, write_page, job);
 }
 
 static void
@@ -370,7 +445,10 @@ new_page(escp_t *dev, int8_t save, int8_t resetx)
     dev->curr_y = dev->top_margin;
     if (dev->page) {
         dev->page->dirty = 0;
-        memset(dev->page->pixels, 0x00, (size_t) dev->page->pitch * dev->page->h);
+        if (dev->page->pixels == NULL)
+            dev->page->pixels = (uint8_t *) calloc((size_t) dev->page->pitch * dev->page->h, 1);
+        else
+            memset(dev->page->pixels, 0x00, (size_t) dev->page->pitch * dev->page->h);
     }
 
     /* Make the page's file name. */
@@ -492,64 +570,133 @@ init_codepage(escp_t *dev, uint16_t num)
     select_codepage(num, dev->curr_cpmap);
 }
 
+/* Make the glyph set for the given font current, recycling the least
+   recently used one if it is not cached yet. */
+static void
+select_glyphs(escp_t *dev, uint8_t font, uint16_t hsize, uint16_t vsize, uint8_t italic)
+{
+    glyph_set_t *set    = NULL;
+    glyph_set_t *oldest = &dev->glyph_sets[0];
+
+    for (int i = 0; i < GLYPH_SETS; i++) {
+        glyph_set_t *s = &dev->glyph_sets[i];
+
+        if (s->used && (s->font == font) && (s->hsize == hsize) && (s->vsize == vsize) && (s->italic == italic)) {
+            set = s;
+            break;
+        }
+        if (s->used < oldest->used)
+            oldest = s;
+    }
+
+    if (set == NULL) {
+        set = oldest;
+        for (int i = 0; i < GLYPH_SLOTS; i++)
+            set->glyphs[i].valid = 0;
+        set->font   = font;
+        set->hsize  = hsize;
+        set->vsize  = vsize;
+        set->italic = italic;
+    }
+
+    set->used   = ++dev->glyph_stamp;
+    dev->glyphs = set;
+}
+
+/* Return the rendered glyph, from the cache if it is there. */
+static const glyph_t *
+get_glyph(escp_t *dev, FT_UInt index)
+{
+    glyph_t            *glyph = &dev->glyphs->glyphs[index & (GLYPH_SLOTS - 1)];
+    const FT_GlyphSlot  slot  = dev->fontface->glyph;
+    const FT_Bitmap    *bitmap;
+    size_t              size;
+
+    if (glyph->valid && (glyph->index == index))
+        return glyph;
+
+    FT_Load_Glyph(dev->fontface, index, FT_LOAD_DEFAULT);
+    FT_Render_Glyph(slot, FT_RENDER_MODE_NORMAL);
+    bitmap = &slot->bitmap;
+
+    size = (size_t) bitmap->width * bitmap->rows;
+    if (size > ((size_t) glyph->width * glyph->rows) || (glyph->buffer == NULL))
+        glyph->buffer = (uint8_t *) realloc(glyph->buffer, size ? size : 1);
+    for (unsigned int y = 0; y < bitmap->rows; y++)
+        memcpy(glyph->buffer + y * bitmap->width, bitmap->buffer + y * bitmap->pitch, bitmap->width);
+
+    glyph->index   = index;
+    glyph->valid   = 1;
+    glyph->left    = slot->bitmap_left;
+    glyph->top     = slot->bitmap_top;
+    glyph->advance = slot->advance.x;
+    glyph->width   = bitmap->width;
+    glyph->rows    = bitmap->rows;
+
+    return glyph;
+}
+
 static void
 update_font(escp_t *dev)
 {
-    char        path[1024];
-    const char *fn;
-    FT_Matrix   matrix;
-    double      hpoints = 10.5;
-    double      vpoints = 10.5;
+    char      path[1024];
+    uint8_t   font; /* index into font_files[] */
+    uint8_t   italic;
+    uint16_t  hsize;
+    uint16_t  vsize;
+    FT_Matrix matrix;
+    double    hpoints = 10.5;
+    double    vpoints = 10.5;
 
     /* We need the FreeType library. */
     if (ft_lib == NULL)
         return;
 
-    /* Release current font if we have one. */
-    if (dev->fontface)
-        FT_Done_Face(dev->fontface);
-
     if (dev->print_quality == QUALITY_DRAFT) {
         if (dev->font_style & STYLE_ITALICS)
-            fn = FONT_FILE_DOTMATRIX_ITALIC;
+            font = 1; /* FONT_FILE_DOTMATRIX_ITALIC */
         else
-            fn = FONT_FILE_DOTMATRIX;
+            font = 0; /* FONT_FILE_DOTMATRIX */
     } else
         switch (dev->lq_typeface) {
             case TYPEFACE_ROMAN:
-                fn = FONT_FILE_ROMAN;
+                font = 2;
                 break;
             case TYPEFACE_SANSSERIF:
-                fn = FONT_FILE_SANSSERIF;
+                font = 3;
                 break;
             case TYPEFACE_COURIER:
-                fn = FONT_FILE_COURIER;
+                font = 4;
                 break;
             case TYPEFACE_SCRIPT:
-                fn = FONT_FILE_SCRIPT;
+                font = 5;
                 break;
             case TYPEFACE_OCRA:
-                fn = FONT_FILE_OCRA;
+                font = 6;
                 break;
             case TYPEFACE_OCRB:
-                fn = FONT_FILE_OCRB;
+                font = 7;
                 break;
             default:
-                fn = FONT_FILE_ROMAN;
+                font = 2;
         }
 
-    /* Create a full pathname for the ROM file. */
-    strcpy(path, dev->fontpath);
-    path_slash(path);
-    strcat(path, fn);
+    /* Faces stay open once loaded, switching fonts is common. */
+    if (dev->faces[font] == NULL) {
+        /* Create a full pathname for the ROM file. */
+        strcpy(path, dev->fontpath);
+        path_slash(path);
+        strcat(path, font_files[font]);
 
-    escp_log("Temp file=%s\n", path);
+        escp_log("Temp file=%s\n", path);
 
-    /* Load the new font. */
-    if (FT_New_Face(ft_lib, path, 0, &dev->fontface)) {
-        escp_log("ESC/P: unable to load font '%s'\n", path);
-        dev->fontface = NULL;
+        /* Load the new font. */
+        if (FT_New_Face(ft_lib, path, 0, &dev->faces[font])) {
+            escp_log("ESC/P: unable to load font '%s'\n", path);
+            dev->faces[font] = NULL;
+        }
     }
+    dev->fontface = dev->faces[font];
 
     if (!dev->multipoint_mode) {
         dev->actual_cpi = dev->cpi;
@@ -592,18 +739,25 @@ update_font(escp_t *dev)
         dev->actual_cpi /= 2.0 / 3.0;
     }
 
-    FT_Set_Char_Size(dev->fontface,
-                     (uint16_t) (hpoints * 64), (uint16_t) (vpoints * 64),
-                     dev->dpi, dev->dpi);
+    if (dev->fontface == NULL)
+        return;
+
+    hsize = (uint16_t) (hpoints * 64);
+    vsize = (uint16_t) (vpoints * 64);
+    FT_Set_Char_Size(dev->fontface, hsize, vsize, dev->dpi, dev->dpi);
 
-    if ((dev->print_quality != QUALITY_DRAFT) && ((dev->font_style & STYLE_ITALICS) || (dev->char_tables[dev->curr_char_table] == 0))) {
+    italic = (dev->print_quality != QUALITY_DRAFT) && ((dev->font_style & STYLE_ITALICS) || (dev->char_tables[dev->curr_char_table] == 0));
+    if (italic) {
         /* Italics transformation. */
         matrix.xx = 0x10000L;
         matrix.xy = (FT_Fixed) (0.20 * 0x10000L);
         matrix.yx = 0;
         matrix.yy = 0x10000L;
         FT_Set_Transform(dev->fontface, &matrix, 0);
-    }
+    } else
+        FT_Set_Transform(dev->fontface, NULL, NULL);
+
+    select_glyphs(dev, font, hsize, vsize, italic);
 }
 
 /* This is the actual ESC/P interpreter. */
@@ -1535,12 +1689,12 @@ process_char(escp_t *dev, uint8_t ch)
 static void
 handle_char(escp_t *dev, uint8_t ch)
 {
-    FT_UInt  char_index;
-    uint16_t pen_x;
-    uint16_t pen_y;
-    uint16_t line_start;
-    uint16_t line_y;
-    double   x_advance;
+    const glyph_t *glyph;
+    uint16_t       pen_x;
+    uint16_t       pen_y;
+    uint16_t       line_start;
+    uint16_t       line_y;
+    double         x_advance;
 
     if (dev->page == NULL)
         return;
@@ -1576,43 +1730,39 @@ handle_char(escp_t *dev, uint8_t ch)
         ch = 0x20;
 
     /* ok, so we need to print the character now */
-    if (ft_lib) {
-        char_index = FT_Get_Char_Index(dev->fontface, dev->curr_cpmap[ch]);
-        FT_Load_Glyph(dev->fontface, char_index, FT_LOAD_DEFAULT);
-        FT_Render_Glyph(dev->fontface->glyph, FT_RENDER_MODE_NORMAL);
-    }
+    glyph = get_glyph(dev, FT_Get_Char_Index(dev->fontface, dev->curr_cpmap[ch]));
 
-    pen_x = PIXX + fmax(0.0, dev->fontface->glyph->bitmap_left);
-    pen_y = (uint16_t) (PIXY + fmax(0.0, -dev->fontface->glyph->bitmap_top + dev->fontface->size->metrics.ascender / 64));
+    pen_x = PIXX + fmax(0.0, glyph->left);
+    pen_y = (uint16_t) (PIXY + fmax(0.0, -glyph->top + dev->fontface->size->metrics.ascender / 64));
 
     if (dev->font_style & STYLE_SUBSCRIPT)
-        pen_y += dev->fontface->glyph->bitmap.rows / 2;
+        pen_y += glyph->rows / 2;
 
     /* mark the page as dirty if anything is drawn */
     if ((ch != 0x20) || (dev->font_score != SCORE_NONE))
         dev->page->dirty = 1;
 
     /* draw the glyph */
-    blit_glyph(dev, pen_x, pen_y, 0);
-    blit_glyph(dev, pen_x + 1, pen_y, 1);
+    blit_glyph(dev, glyph, pen_x, pen_y, 0);
+    blit_glyph(dev, glyph, pen_x + 1, pen_y, 1);
 
     /* doublestrike -> draw glyph a second time, 1px below */
     if (dev->font_style & STYLE_DOUBLESTRIKE) {
-        blit_glyph(dev, pen_x, pen_y + 1, 1);
-        blit_glyph(dev, pen_x + 1, pen_y + 1, 1);
+        blit_glyph(dev, glyph, pen_x, pen_y + 1, 1);
+        blit_glyph(dev, glyph, pen_x + 1, pen_y + 1, 1);
     }
 
     /* bold -> draw glyph a second time, 1px to the right */
     if (dev->font_style & STYLE_BOLD) {
-        blit_glyph(dev, pen_x + 1, pen_y, 1);
-        blit_glyph(dev, pen_x + 2, pen_y, 1);
-        blit_glyph(dev, pen_x + 3, pen_y, 1);
+        blit_glyph(dev, glyph, pen_x + 1, pen_y, 1);
+        blit_glyph(dev, glyph, pen_x + 2, pen_y, 1);
+        blit_glyph(dev, glyph, pen_x + 3, pen_y, 1);
     }
 
     line_start = PIXX;
 
     if (dev->font_style & STYLE_PROP)
-        x_advance = dev->fontface->glyph->advance.x / (dev->dpi * 64.0);
+        x_advance = glyph->advance / (dev->dpi * 64.0);
     else {
         if (dev->hmi < 0)
             x_advance = 1.0 / dev->actual_cpi;
@@ -1649,24 +1799,29 @@ handle_char(escp_t *dev, uint8_t ch)
     }
 }
 
-/* TODO: This can be optimized quite a bit... I'm just too lazy right now ;-) */
 static void
-blit_glyph(escp_t *dev, unsigned destx, unsigned desty, int8_t add)
+blit_glyph(escp_t *dev, const glyph_t *glyph, unsigned destx, unsigned desty, int8_t add)
 {
-    const FT_Bitmap *bitmap = &dev->fontface->glyph->bitmap;
-    uint8_t          src;
-    uint8_t         *dst;
-
-    /* check if freetype is available */
-    if (ft_lib == NULL)
+    const uint8_t *row;
+    uint8_t        src;
+    uint8_t       *dst;
+    unsigned       w;
+    unsigned       h;
+
+    /* respect page size */
+    if ((destx >= (unsigned) dev->page->w) || (desty >= (unsigned) dev->page->h))
         return;
+    w = MIN(glyph->width, (unsigned) dev->page->w - destx);
+    h = MIN(glyph->rows, (unsigned) dev->page->h - desty);
+
+    for (unsigned int y = 0; y < h; y++) {
+        row = glyph->buffer + y * glyph->width;
+        dst = (uint8_t *) dev->page->pixels + destx + (y + desty) * dev->page->pitch;
 
-    for (unsigned int y = 0; y < bitmap->rows; y++) {
-        for (unsigned int x = 0; x < bitmap->width; x++) {
-            src = *(bitmap->buffer + x + y * bitmap->pitch);
-            /* ignore background, and respect page size */
-            if (src > 0 && (destx + x < (unsigned) dev->page->w) && (desty + y < (unsigned) dev->page->h)) {
-                dst = (uint8_t *) dev->page->pixels + (x + destx) + (y + desty) * dev->page->pitch;
+        for (unsigned int x = 0; x < w; x++, dst++) {
+            src = row[x];
+            /* ignore background */
+            if (src > 0) {
                 src >>= 3;
 
                 if (add) {
@@ -2024,6 +2179,9 @@ escp_init(void *lpt)
     dev->fontface = 0;
     dev->autofeed = 0;
 
+    dev->glyph_sets = (glyph_set_t *) calloc(GLYPH_SETS, sizeof(glyph_set_t));
+    dev->queue      = prt_queue_init(PAGE_QUEUE);
+
     reset_printer(dev);
 
     escp_log("ESC/P: created a virtual page of dimensions %d x %d pixels.\n",
@@ -2053,6 +2211,20 @@ escp_close(void *priv)
         free(dev->page);
     }
 
+    /* Wait for the pages still being written. */
+    prt_queue_close(dev->queue);
+
+    for (int i = 0; i < GLYPH_SETS; i++) {
+        for (int j = 0; j < GLYPH_SLOTS; j++)
+            free(dev->glyph_sets[i].glyphs[j].buffer);
+    }
+    free(dev->glyph_sets);
+
+    for (unsigned int i = 0; i < FONT_FILES; i++) {
+        if (dev->faces[i] != NULL)
+            FT_Done_Face(dev->faces[i]);
+    }
+
     free(dev);
 }
 
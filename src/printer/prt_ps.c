@@ -33,6 +33,7 @@
 #include <86box/plat.h>
 #include <86box/plat_dynld.h>
 #include <86box/ui.h>
+#include <86box/printer.h>
 #include <86box/prt_devs.h>
 
 #ifdef _WIN32
@@ -45,7 +46,7 @@
 #define gs_error_Quit        -101
 
 #ifdef _WIN32
-#    if (!(defined __amd64__ || defined _M_X64 || defined __aarch64__ || defined _M_ARM64))
+#    if (!(defined __amd64__ || defined _M_X64 || defined __aarch64__ || defined _M_ARM64 || (defined __riscv && __riscv_xlen == 64)))
 #        define PATH_GHOSTSCRIPT_DLL "gsdll32.dll"
 #        define PATH_GHOSTPCL_DLL    "gpcl6dll32.dll"
 #    else
@@ -66,6 +67,14 @@
 
 #define POSTSCRIPT_BUFFER_LENGTH 65536
 
+/* Finished jobs waiting for Ghostscript. */
+#define CONVERT_QUEUE 8
+
+typedef struct ps_job_t {
+    char input_fn[1024];
+    bool pcl;
+} ps_job_t;
+
 typedef struct ps_t {
     const char *name;
 
@@ -91,6 +100,8 @@ typedef struct ps_t {
 
     char   buffer[POSTSCRIPT_BUFFER_LENGTH];
     size_t buffer_pos;
+
+    prt_queue_t *queue;
 } ps_t;
 
 typedef struct gsapi_revision_s {
@@ -149,8 +160,9 @@ pulse_timer(void *priv)
     timer_disable(&dev->pulse_timer);
 }
 
+/* Runs on the output thread, Ghostscript can take a while. */
 static int
-convert_to_pdf(ps_t *dev)
+convert_to_pdf(const ps_job_t *job)
 {
     volatile int code, arg = 0;
     void        *instance = NULL;
@@ -158,19 +170,17 @@ convert_to_pdf(ps_t *dev)
     char         output_fn[1024];
     char        *gsargv[11];
 
-    strcpy(input_fn, dev->printer_path);
-    path_slash(input_fn);
-    strcat(input_fn, dev->filename);
+    strcpy(input_fn, job->input_fn);
 
     strcpy(output_fn, input_fn);
-    strcpy(output_fn + strlen(output_fn) - (dev->pcl ? 4 : 3), ".pdf");
+    strcpy(output_fn + strlen(output_fn) - (job->pcl ? 4 : 3), ".pdf");
 
     gsargv[arg++] = "";
     gsargv[arg++] = "-dNOPAUSE";
     gsargv[arg++] = "-dBATCH";
     gsargv[arg++] = "-dSAFER";
     gsargv[arg++] = "-sDEVICE=pdfwrite";
-    if (dev->pcl) {
+    if (job->pcl) {
         gsargv[arg++] = "-LPCL";
         gsargv[arg++] = "-lPCL5E";
     }
@@ -179,7 +189,7 @@ convert_to_pdf(ps_t *dev)
     gsargv[arg++] = output_fn;
     gsargv[arg++] = input_fn;
 
-    code = gsapi_new_instance(&instance, dev);
+    code = gsapi_new_instance(&instance, NULL);
     if (code < 0)
         return code;
 
@@ -203,6 +213,16 @@ convert_to_pdf(ps_t *dev)
     return code;
 }
 
+static void
+convert_job(void *priv)
+{
+    ps_job_t *job = (ps_job_t *) priv;
+
+    convert_to_pdf(job);
+
+    free(job);
+}
+
 static void
 write_buffer(ps_t *dev, bool finish)
 {
@@ -236,8 +256,13 @@ write_buffer(ps_t *dev, bool finish)
     dev->buffer_pos = 0;
 
     if (finish) {
-        if (ghostscript_handle != NULL)
-            convert_to_pdf(dev);
+        if (ghostscript_handle != NULL) {
+            ps_job_t *job = (ps_job_t *) malloc(sizeof(ps_job_t));
+
+            strcpy(job->input_fn, path);
+            job->pcl = dev->pcl;
+            prt_queue_push(dev->queue, convert_job, job);
+        }
 
         dev->filename[0] = 0;
     }
@@ -405,6 +430,8 @@ ps_init(void *lpt)
     timer_add(&dev->pulse_timer, pulse_timer, dev, 0);
     timer_add(&dev->timeout_timer, timeout_timer, dev, 0);
 
+    dev->queue = prt_queue_init(CONVERT_QUEUE);
+
     reset_ps(dev);
 
     return dev;
@@ -453,6 +480,8 @@ pcl_init(void *lpt)
     timer_add(&dev->pulse_timer, pulse_timer, dev, 0);
     timer_add(&dev->timeout_timer, timeout_timer, dev, 0);
 
+    dev->queue = prt_queue_init(CONVERT_QUEUE);
+
     reset_ps(dev);
 
     return dev;
@@ -470,6 +499,9 @@ ps_close(void *priv)
     if (dev->buffer[0] != 0)
         write_buffer(dev, true);
 
+    /* Let the pending conversions finish before unloading Ghostscript. */
+    prt_queue_close(dev->queue);
+
     if (ghostscript_handle != NULL) {
         dynld_close(ghostscript_handle);
         ghostscript_handle = NULL;
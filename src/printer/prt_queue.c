@@ -0,0 +1,70 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Printer output queue.
+ *
+ *          Encoding a finished page as PNG, or handing a job over to
+ *          Ghostscript, takes long enough to stall the guest, so the
+ *          printers queue that work to a channel of the device event
+ *          bus. Jobs run in the order they were queued. Once a queue
+ *          holds its limit of jobs, queueing another waits for the
+ *          oldest one to finish, which keeps the memory held by pending
+ *          pages bounded.
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <wchar.h>
+#include <86box/86box.h>
+#include <86box/evbus.h>
+#include <86box/printer.h>
+
+struct prt_queue_t {
+    evbus_chan_t *ch;
+    int           max_jobs;
+};
+
+prt_queue_t *
+prt_queue_init(int max_jobs)
+{
+    prt_queue_t *q = (prt_queue_t *) calloc(1, sizeof(prt_queue_t));
+
+    q->ch       = evbus_chan_create();
+    q->max_jobs = max_jobs;
+
+    return q;
+}
+
+/* Queues func(priv) to run on the bus. The job owns priv from now on,
+   func is expected to free it. Nothing of it is for the guest to see,
+   so there is no completion. */
+void
+prt_queue_push(prt_queue_t *q, void (*func)(void *priv), void *priv)
+{
+    evbus_chan_wait(q->ch, q->max_jobs - 1);
+    evbus_post(q->ch, func, NULL, priv, 0.0);
+}
+
+/* Waits for everything queued so far to finish. */
+void
+prt_queue_flush(prt_queue_t *q)
+{
+    if (q != NULL)
+        evbus_chan_wait(q->ch, 0);
+}
+
+void
+prt_queue_close(prt_queue_t *q)
+{
+    if (q == NULL)
+        return;
+
+    evbus_chan_destroy(q->ch);
+
+    free(q);
+}
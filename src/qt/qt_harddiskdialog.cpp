@@ -19,10 +19,15 @@
 #include "qt_harddiskdialog.hpp"
 #include "ui_qt_harddiskdialog.h"
 
-extern "C" {
-#ifdef __unix__
-#include <unistd.h>
+#ifdef Q_OS_WINDOWS
+#define BITMAP WINDOWS_BITMAP
+#include <windows.h>
+#include <winioctl.h>
+#include <io.h>
+#undef BITMAP
 #endif
+
+extern "C" {
 #include <86box/86box.h>
 #include <86box/hdd.h>
 #include "../disk/minivhd/minivhd.h"
@@ -458,36 +463,20 @@ HarddiskDialog::onCreateNewFile()
     }
 
     // formats 0, 1 and 2
-#ifndef __unix__
-    connect(this, &HarddiskDialog::fileProgress, this, [this](int value) { ui->progressBar->setValue(value); QApplication::processEvents(); });
-    ui->progressBar->setVisible(true);
-    [size, &file, this] {
-        QDataStream stream(&file);
-        stream.setByteOrder(QDataStream::LittleEndian);
-
-        QByteArray buf(1048576, 0);
-        uint64_t   mibBlocks = size >> 20;
-        uint64_t   restBlock = size & 0xfffff;
-
-        if (restBlock) {
-            stream.writeRawData(buf.data(), restBlock);
-        }
-
-        if (mibBlocks) {
-            for (uint64_t i = 0; i < mibBlocks; ++i) {
-                stream.writeRawData(buf.data(), buf.size());
-                emit fileProgress(static_cast<int>((i * 100) / mibBlocks));
-            }
-        }
-        emit fileProgress(100);
-    }();
-#else
-    int ret = ftruncate(file.handle(), (size_t) size);
-
-    if (ret) {
+    /* Extend the file past the header instead of writing zeroes, so the
+       image is created right away and left unallocated where possible. */
+    if (!file.flush()) {
         QMessageBox::critical(this, tr("Unable to write file"), tr("Make sure the file is being saved to a writable directory."));
+        return;
     }
+#ifdef Q_OS_WINDOWS
+    DWORD bytes;
+    (void) DeviceIoControl((HANDLE) _get_osfhandle(file.handle()), FSCTL_SET_SPARSE, NULL, 0, NULL, 0, &bytes, NULL);
 #endif
+    if (!file.resize(file.pos() + static_cast<qint64>(size))) {
+        QMessageBox::critical(this, tr("Unable to write file"), tr("Make sure the file is being saved to a writable directory."));
+        return;
+    }
 
     QMessageBox::information(this, tr("Disk image created"), tr("Remember to partition and format the newly-created drive."));
     setResult(QDialog::Accepted);
@@ -37,9 +37,12 @@ extern "C" {
 #include <86box/machine.h>
 #include <86box/thread.h>
 #include <86box/network.h>
+#include <86box/sound.h>
 #include <86box/ui.h>
 #include <86box/machine_status.h>
+#include <86box/io_stats.h>
 #include <86box/config.h>
+#include <86box/perf.h>
 };
 
 #include <QIcon>
@@ -61,6 +64,11 @@ extern MainWindow *main_window;
 
 static bool sbar_initialized = false;
 
+std::mutex       MachineStatus::pendingMutex;
+QString          MachineStatus::pendingMessage;
+std::atomic_bool MachineStatus::messagePending { false };
+std::atomic_bool MachineStatus::emptyIconsPending { false };
+
 namespace {
 struct PixmapSetActive {
     QPixmap normal;
@@ -251,6 +259,7 @@ struct MachineStatus::States {
     std::array<StateEmptyActive, NET_CARD_MAX> net;
     std::unique_ptr<ClickableLabel>            sound;
     std::unique_ptr<QLabel>                    text;
+    std::unique_ptr<QLabel>                    perf;
 };
 
 MachineStatus::MachineStatus(QObject *parent)
@@ -261,7 +270,7 @@ MachineStatus::MachineStatus(QObject *parent)
     muteUnmuteAction = nullptr;
     soundMenu = nullptr;
     connect(refreshTimer, &QTimer::timeout, this, &MachineStatus::refreshIcons);
-    refreshTimer->start(75);
+    refreshTimer->start(33);
 }
 
 MachineStatus::~MachineStatus() = default;
@@ -414,9 +423,193 @@ MachineStatus::refreshEmptyIcons()
         d->cartridge[i].setEmpty(machine_status.cartridge[i].empty);
 }
 
+void
+MachineStatus::refreshSoundTip()
+{
+    if (!d->sound || (sound_stats.seq == soundStatsSeq))
+        return;
+
+    soundStatsSeq = sound_stats.seq;
+
+    QString tip = tr("Sound");
+    tip += "\n" + tr("Buffers: %1/s, queued: %2").arg(sound_stats.buffers).arg(sound_stats.queued);
+    tip += "\n" + tr("Underruns: %1, overruns: %2").arg(sound_stats.underruns).arg(sound_stats.overruns);
+    for (int i = 0; i < sound_stats.handlers_num; i++)
+        tip += "\n" + tr("%1: %2 ms/s").arg(QString(sound_stats.handlers[i].name)).arg(sound_stats.handlers[i].us / 1000.0, 0, 'f', 1);
+
+    d->sound->setToolTip(tip);
+}
+
+QString
+MachineStatus::ioStatsText(const io_stats_t *stats)
+{
+    QString text = tr("%1 IOPS, %2 kB/s, %3 \u00b5s per transfer").arg(stats->iops).arg(stats->kbps).arg(stats->avg_us);
+
+    text += "\n" + tr("%1 MB read, %2 MB written").arg(stats->read_bytes >> 20).arg(stats->write_bytes >> 20);
+    if (stats->hit_pct >= 0)
+        text += "\n" + tr("Cache hits: %1%").arg(stats->hit_pct);
+    if (stats->queued_max)
+        text += "\n" + tr("Write queue: %1 kB, peak %2 kB").arg(stats->queued >> 10).arg(stats->queued_max >> 10);
+
+    return text;
+}
+
+void
+MachineStatus::refreshIoTips()
+{
+    /* In HDD_BUS_* order. */
+    static const char *bus_names[HDD_BUS_USB] = { "", "MFM/RLL", "XTA", "ESDI", "IDE", "ATAPI", "SCSI" };
+
+    io_stats_update();
+
+    if (!MediaMenu::ptr || (io_stats_seq == ioStatsSeq))
+        return;
+
+    ioStatsSeq = io_stats_seq;
+
+    for (int bus = HDD_BUS_MFM; bus < HDD_BUS_USB; bus++) {
+        if (!d->hdds[bus].label)
+            continue;
+
+        QString tip = tr("Hard disk (%1)").arg(bus_names[bus]);
+        for (int i = 0; i < HDD_NUM; i++) {
+            if ((hdd[i].bus_type == bus) && (hdd_io_stats[i].reads || hdd_io_stats[i].writes))
+                tip += "\n\n" + QString(hdd_io_stats[i].name) + "\n" + ioStatsText(&hdd_io_stats[i]);
+        }
+        d->hdds[bus].label->setToolTip(tip);
+    }
+
+    for (int i = 0; i < CDROM_NUM; i++) {
+        if (d->cdrom[i].label && MediaMenu::ptr->cdromMenus[i] && cdrom_io_stats[i].reads)
+            d->cdrom[i].label->setToolTip(MediaMenu::ptr->cdromMenus[i]->title() + "\n" + ioStatsText(&cdrom_io_stats[i]));
+    }
+    for (int i = 0; i < ZIP_NUM; i++) {
+        if (d->zip[i].label && MediaMenu::ptr->zipMenus[i] && (zip_io_stats[i].reads || zip_io_stats[i].writes))
+            d->zip[i].label->setToolTip(MediaMenu::ptr->zipMenus[i]->title() + "\n" + ioStatsText(&zip_io_stats[i]));
+    }
+    for (int i = 0; i < MO_NUM; i++) {
+        if (d->mo[i].label && MediaMenu::ptr->moMenus[i] && (mo_io_stats[i].reads || mo_io_stats[i].writes))
+            d->mo[i].label->setToolTip(MediaMenu::ptr->moMenus[i]->title() + "\n" + ioStatsText(&mo_io_stats[i]));
+    }
+}
+
+void
+MachineStatus::refreshNetTips()
+{
+    netcard_stats_t stats;
+
+    if (!MediaMenu::ptr || (network_stats_seq == netStatsSeq))
+        return;
+
+    netStatsSeq = network_stats_seq;
+
+    for (int i = 0; i < NET_CARD_MAX; i++) {
+        if (!d->net[i].label || !MediaMenu::ptr->netMenus[i] || !network_get_stats(i, &stats))
+            continue;
+
+        QString tip = MediaMenu::ptr->netMenus[i]->title();
+        tip += "\n" + tr("Received: %1 packets/s, %2 kB/s").arg(stats.rx_pps).arg(stats.rx_kbps);
+        tip += "\n" + tr("Sent: %1 packets/s, %2 kB/s").arg(stats.tx_pps).arg(stats.tx_kbps);
+        tip += "\n" + tr("%1 packets received, %2 sent").arg(stats.rx_packets).arg(stats.tx_packets);
+        tip += "\n" + tr("Queue wait: %1 \u00b5s in, %2 \u00b5s out").arg(stats.rx_wait_us).arg(stats.tx_wait_us);
+        if (stats.drops || stats.errors)
+            tip += "\n" + tr("%1 dropped, %2 send errors").arg(stats.drops).arg(stats.errors);
+        d->net[i].label->setToolTip(tip);
+    }
+}
+
+void
+MachineStatus::refreshPerf()
+{
+    perf_stats_t stats;
+    uint32_t     seq;
+
+    if (!d->perf)
+        return;
+
+    d->perf->setVisible(perf_panel);
+    if (!perf_panel)
+        return;
+
+    seq = perf_get_stats(&stats);
+    if (seq == perfStatsSeq)
+        return;
+
+    perfStatsSeq = seq;
+
+    d->perf->setText(tr("%1% | %2 MIPS | %3/%4 fps").arg(stats.speed_pct).arg(stats.mips, 0, 'f', 1).arg(stats.fps_rendered).arg(stats.fps_presented));
+
+    QString tip = tr("Emulated time: %1% of host time").arg(stats.speed_pct);
+    tip += "\n" + tr("Guest: %1 MIPS").arg(stats.mips, 0, 'f', 2);
+    tip += "\n" + tr("Frames: %1/s rendered, %2/s presented").arg(stats.fps_rendered).arg(stats.fps_presented);
+    if (stats.fps_dropped)
+        tip += "\n" + tr("Frames dropped by pacing: %1/s").arg(stats.fps_dropped);
+    if (stats.latency_us >= 0)
+        tip += "\n" + tr("Input to present: %1 ms average, %2 ms worst").arg(stats.latency_us / 1000.0, 0, 'f', 1).arg(stats.latency_max_us / 1000.0, 0, 'f', 1);
+    if (stats.host_pct[PERF_CPU] >= 0) {
+        tip += "\n\n" + tr("Emulation thread");
+        tip += "\n" + tr("CPU: %1%").arg(stats.host_pct[PERF_CPU]);
+        tip += "\n" + tr("Video: %1%").arg(stats.host_pct[PERF_VIDEO]);
+        tip += "\n" + tr("Sound: %1%").arg(stats.host_pct[PERF_SOUND]);
+        tip += "\n" + tr("Timers: %1%").arg(stats.host_pct[PERF_TIMERS]);
+        tip += "\n" + tr("I/O: %1%").arg(stats.host_pct[PERF_IO]);
+        tip += "\n" + tr("Idle: %1%").arg(stats.host_pct[PERF_IDLE]);
+    }
+    if (stats.cache_pct >= 0)
+        tip += "\n\n" + tr("Code cache: %1% in use").arg(stats.cache_pct);
+
+    d->perf->setToolTip(tip);
+}
+
+/*
+   The emulator posts status text and media changes as often as the guest
+   produces them, a POST card or an MT-32 display can do so thousands of
+   times per second. Only the latest state is kept, and the refresh timer
+   picks it up, so the emulated I/O never waits on the Qt event queue.
+ */
+void
+MachineStatus::postMessage(const QString &msg)
+{
+    {
+        std::lock_guard<std::mutex> lock(pendingMutex);
+        pendingMessage = msg;
+    }
+    messagePending = true;
+}
+
+void
+MachineStatus::postEmptyIconsRefresh()
+{
+    emptyIconsPending = true;
+}
+
+void
+MachineStatus::applyPending()
+{
+    if (messagePending.exchange(false)) {
+        QString msg;
+        {
+            std::lock_guard<std::mutex> lock(pendingMutex);
+            msg = pendingMessage;
+        }
+        if (msg != d->text->text())
+            message(msg);
+    }
+
+    if (emptyIconsPending.exchange(false))
+        refreshEmptyIcons();
+}
+
 void
 MachineStatus::refreshIcons()
 {
+    applyPending();
+
+    refreshSoundTip();
+    refreshIoTips();
+    refreshNetTips();
+    refreshPerf();
+
     /* Check if icons should show activity. */
     if (!update_icons)
         return;
@@ -445,8 +638,11 @@ MachineStatus::refreshIcons()
             ui_sb_update_icon(SB_HDD | i, 0);
     }
 
-    for (size_t i = 0; i < NET_CARD_MAX; i++)
+    for (size_t i = 0; i < NET_CARD_MAX; i++) {
         d->net[i].setActive(machine_status.net[i].active);
+        if (machine_status.net[i].active)
+            ui_sb_update_icon(SB_NETWORK | i, 0);
+    }
 }
 
 void
@@ -706,6 +902,10 @@ MachineStatus::refresh(QStatusBar *sbar)
     sbar->addWidget(d->sound.get());
     d->text = std::make_unique<QLabel>();
     sbar->addWidget(d->text.get());
+    d->perf = std::make_unique<QLabel>();
+    d->perf->setVisible(perf_panel);
+    sbar->addPermanentWidget(d->perf.get());
+    perfStatsSeq = 0;
 
     sbar_initialized = true;
 
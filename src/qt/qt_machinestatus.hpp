@@ -8,7 +8,9 @@
 #include <QMouseEvent>
 #include <QMimeData>
 
+#include <atomic>
 #include <memory>
+#include <mutex>
 
 class QStatusBar;
 
@@ -71,6 +73,10 @@ public:
     static void iterateMO(const std::function<void(int i)> &cb);
     static void iterateNIC(const std::function<void(int i)> &cb);
 
+    /* Safe from any thread, applied on the next refresh tick. */
+    static void postMessage(const QString &msg);
+    static void postEmptyIconsRefresh();
+
     QString getMessage();
     void    clearActivity();
     void    setSoundGainAction(QAction* action);
@@ -80,6 +86,7 @@ public slots:
     void updateTip(int tag);
     void refreshEmptyIcons();
     void refreshIcons();
+    void refreshPerf();
 
 private:
     struct States;
@@ -88,6 +95,21 @@ private:
     QAction                *soundGainAction;
     QAction                *muteUnmuteAction;
     QMenu                  *soundMenu;
+    uint32_t                soundStatsSeq = 0;
+    uint32_t                ioStatsSeq    = 0;
+    uint32_t                netStatsSeq   = 0;
+    uint32_t                perfStatsSeq  = 0;
+
+    static std::mutex       pendingMutex;
+    static QString          pendingMessage;
+    static std::atomic_bool messagePending;
+    static std::atomic_bool emptyIconsPending;
+
+    void    applyPending();
+    void    refreshSoundTip();
+    void    refreshIoTips();
+    void    refreshNetTips();
+    QString ioStatsText(const struct io_stats_t *stats);
 };
 
 #endif // QT_MACHINESTATUS_HPP
@@ -48,6 +48,7 @@ extern "C" {
 #include <86box/86box.h>
 #include <86box/config.h>
 #include <86box/plat.h>
+#include <86box/thread.h>
 #include <86box/ui.h>
 #include <86box/video.h>
 #ifdef DISCORD
@@ -89,7 +90,6 @@ extern "C" {
 #include "cpu.h"
 #include <86box/timer.h>
 #include <86box/nvr.h>
-extern int qt_nvr_save(void);
 
 bool cpu_thread_running = false;
 }
@@ -383,36 +383,32 @@ static HHOOK llhook  = NULL;
 void
 main_thread_fn()
 {
-    int      frames;
-
     QThread::currentThread()->setPriority(QThread::HighestPriority);
     plat_set_thread_name(nullptr, "main_thread_fn");
+    thread_role_apply(THREAD_ROLE_CPU);
     framecountx = 0;
     // title_update = 1;
     uint64_t old_time = elapsed_timer.elapsed();
-    int drawits = frames = 0;
+    int drawits = 0;
     is_cpu_thread = 1;
     while (!is_quit && cpu_thread_run) {
         /* See if it is time to run a frame of code. */
         const uint64_t new_time = elapsed_timer.elapsed();
 #ifdef USE_GDBSTUB
-        if (gdbstub_next_asap && (drawits <= 0))
+        if ((gdbstub_next_asap || turbo_mode) && (drawits <= 0))
             drawits = 10;
         else
 #endif
             drawits += static_cast<int>(new_time - old_time);
         old_time = new_time;
         if (drawits > 0 && !dopause) {
-            /* Yes, so do one frame now. */
-            drawits -= 10;
-            if (drawits > 50)
-                drawits = 0;
-
 #ifdef USE_INSTRUMENT
             uint64_t start_time = elapsed_timer.nsecsElapsed();
 #endif
-            /* Run a block of code. */
-            pc_run();
+            /* Yes, so run a block of code now. */
+            drawits -= pc_run(drawits);
+            if (drawits > 50)
+                drawits = 0;
 
 #ifdef USE_INSTRUMENT
             if (instru_enabled) {
@@ -423,12 +419,8 @@ main_thread_fn()
                     break;
             }
 #endif
-            /* Every 200 frames we save the machine status. */
-            if (++frames >= 200 && nvr_dosave) {
-                qt_nvr_save();
-                nvr_dosave = 0;
-                frames     = 0;
-            }
+            /* Save the NVR and flash images once they have settled. */
+            nvr_save_pending();
         } else {
             /* Just so we dont overload the host OS. */
 
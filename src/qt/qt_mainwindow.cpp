@@ -52,6 +52,7 @@ extern "C" {
 #include <86box/apm.h>
 #include <86box/nvr.h>
 #include <86box/acpi.h>
+#include <86box/perf.h>
 
 #ifdef USE_VNC
 #    include <86box/vnc.h>
@@ -59,10 +60,6 @@ extern "C" {
 
 extern int qt_nvr_save(void);
 
-#ifdef MTR_ENABLED
-#    include <minitrace/minitrace.h>
-#endif
-
 extern bool cpu_thread_running;
 };
 
@@ -338,7 +335,6 @@ MainWindow::MainWindow(QWidget *parent)
     });
     connect(this, &MainWindow::updateStatusBarPanes, this, &MainWindow::refreshMediaMenu);
     connect(this, &MainWindow::updateStatusBarTip, status.get(), &MachineStatus::updateTip);
-    connect(this, &MainWindow::statusBarMessage, status.get(), &MachineStatus::message, Qt::QueuedConnection);
 
     ui->actionKeyboard_requires_capture->setChecked(kbd_req_capture);
     ui->actionRight_CTRL_is_left_ALT->setChecked(rctrl_is_lalt);
@@ -348,6 +344,7 @@ MainWindow::MainWindow(QWidget *parent)
     ui->actionHiDPI_scaling->setChecked(dpi_scale);
     ui->actionHide_status_bar->setChecked(hide_status_bar);
     ui->actionHide_tool_bar->setChecked(hide_tool_bar);
+    ui->actionShow_performance_panel->setChecked(perf_panel);
     ui->actionShow_non_primary_monitors->setChecked(show_second_monitors);
     ui->actionUpdate_status_bar_icons->setChecked(update_icons);
     ui->actionEnable_Discord_integration->setChecked(enable_discord);
@@ -640,34 +637,22 @@ MainWindow::MainWindow(QWidget *parent)
         ui->actionBegin_trace->setShortcut(QKeySequence(Qt::Key_Control + Qt::Key_T));
         ui->actionEnd_trace->setShortcut(QKeySequence(Qt::Key_Control + Qt::Key_T));
         ui->actionEnd_trace->setDisabled(true);
-        static auto init_trace = [&] {
-            mtr_init("trace.json");
-            mtr_start();
-        };
-        static auto shutdown_trace = [&] {
-            mtr_stop();
-            mtr_shutdown();
-        };
 #    ifdef Q_OS_MACOS
         ui->actionBegin_trace->setShortcutVisibleInContextMenu(true);
         ui->actionEnd_trace->setShortcutVisibleInContextMenu(true);
 #    endif
-        static bool trace = false;
         connect(ui->actionBegin_trace, &QAction::triggered, this, [this] {
-            if (trace)
+            if (pc_trace_start("trace.json") < 0)
                 return;
             ui->actionBegin_trace->setDisabled(true);
             ui->actionEnd_trace->setDisabled(false);
-            init_trace();
-            trace = true;
         });
         connect(ui->actionEnd_trace, &QAction::triggered, this, [this] {
-            if (!trace)
+            if (!pc_trace_active())
                 return;
             ui->actionBegin_trace->setDisabled(false);
             ui->actionEnd_trace->setDisabled(true);
-            shutdown_trace();
-            trace = false;
+            pc_trace_stop();
         });
     }
 #endif
@@ -1894,6 +1879,18 @@ MainWindow::on_actionHide_tool_bar_triggered()
     }
 }
 
+void
+MainWindow::on_actionShow_performance_panel_triggered()
+{
+    perf_panel ^= 1;
+    ui->actionShow_performance_panel->setChecked(perf_panel);
+
+    /* The host time split is only sampled while it is shown. */
+    perf_sampling(perf_panel);
+    status->refreshPerf();
+    config_save();
+}
+
 void
 MainWindow::on_actionUpdate_status_bar_icons_triggered()
 {
@@ -1938,13 +1935,6 @@ MainWindow::updateUiPauseState()
     ui->actionPause->setToolTip(tooltip_text);
 }
 
-void
-MainWindow::updateStatusEmptyIcons()
-{
-    if (status != nullptr)
-        status->refreshEmptyIcons();
-}
-
 void
 MainWindow::on_actionPreferences_triggered()
 {
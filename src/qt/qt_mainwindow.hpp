@@ -39,7 +39,6 @@ signals:
     void paint(const QImage &image);
     void resizeContents(int w, int h);
     void resizeContentsMonitor(int w, int h, int monitor_index);
-    void statusBarMessage(const QString &msg);
     void updateStatusBarPanes();
     void updateStatusBarActivity(int tag, bool active);
     void updateStatusBarEmpty(int tag, bool empty);
@@ -64,7 +63,6 @@ public slots:
     void togglePause();
     void initRendererMonitorSlot(int monitor_index);
     void destroyRendererMonitorSlot(int monitor_index);
-    void updateStatusEmptyIcons();
     void updateUiPauseState();
 private slots:
     void on_actionFullscreen_triggered();
@@ -114,6 +112,7 @@ private slots:
     void on_actionSpecify_dimensions_triggered();
     void on_actionHiDPI_scaling_triggered();
     void on_actionHide_status_bar_triggered();
+    void on_actionShow_performance_panel_triggered();
     void on_actionHide_tool_bar_triggered();
     void on_actionUpdate_status_bar_icons_triggered();
     void on_actionTake_screenshot_triggered();
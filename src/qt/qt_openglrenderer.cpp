@@ -35,6 +35,9 @@ extern MainWindow* main_window;
 #include <QApplication>
 #include <QString>
 #include <QByteArray>
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
 
 #include <QOpenGLContext>
 #include <QOpenGLFunctions>
@@ -44,6 +47,7 @@ extern MainWindow* main_window;
 
 #include <QImage>
 
+#include <algorithm>
 #include <cmath>
 
 #include "qt_openglrenderer.hpp"
@@ -63,6 +67,18 @@ char gl3_shader_file[MAX_USER_SHADERS][512];
 extern bool cpu_thread_running;
 }
 
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#    define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#endif
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#    define GL_PROGRAM_BINARY_LENGTH 0x8741
+#endif
+#ifndef GL_NUM_PROGRAM_BINARY_FORMATS
+#    define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+
+#define SHADER_CACHE_PATH "shader_cache"
+
 #define SCALE_SOURCE   0
 #define SCALE_VIEWPORT 1
 #define SCALE_ABSOLUTE 2
@@ -145,6 +161,9 @@ OpenGLRenderer::create_program(struct shader_program *program)
     glw.glAttachShader(program->id, program->vertex_shader);
     glw.glAttachShader(program->id, program->fragment_shader);
 
+    if (programBinaryFormats > 0)
+        glw.glProgramParameteri(program->id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+
     glw.glLinkProgram(program->id);
 
     glw.glDeleteShader(program->vertex_shader);
@@ -169,6 +188,113 @@ OpenGLRenderer::create_program(struct shader_program *program)
     return 1;
 }
 
+/* The cache key covers everything that goes into the program: the driver,
+   the GLSL version used for the shaders and both sources. */
+QString
+OpenGLRenderer::program_cache_path(const char *vertex_prepend, const char *vertex_src,
+                                   const char *fragment_prepend, const char *fragment_src)
+{
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+
+    hash.addData(QByteArray(reinterpret_cast<const char *>(glw.glGetString(GL_VENDOR))));
+    hash.addData(QByteArray(reinterpret_cast<const char *>(glw.glGetString(GL_RENDERER))));
+    hash.addData(QByteArray(reinterpret_cast<const char *>(glw.glGetString(GL_VERSION))));
+    hash.addData(glslVersion.toLatin1());
+    for (const char *str : { vertex_prepend, vertex_src, fragment_prepend, fragment_src }) {
+        /* Keep the terminator, so that the boundaries between the strings count. */
+        if (str)
+            hash.addData(QByteArray(str, (int) strlen(str) + 1));
+        else
+            hash.addData(QByteArray(1, '\0'));
+    }
+
+    return QString(usr_path) + QString(SHADER_CACHE_PATH "/") + QString::fromLatin1(hash.result().toHex()) + QString(".bin");
+}
+
+int
+OpenGLRenderer::load_program_binary(struct shader_program *program, const QString &path)
+{
+    QFile  file(path);
+    GLenum binary_format;
+    GLint  status = 0;
+
+    if (!file.open(QIODevice::ReadOnly))
+        return 0;
+
+    QByteArray data = file.readAll();
+    file.close();
+    if (data.size() <= (int) sizeof(GLenum))
+        return 0;
+
+    memcpy(&binary_format, data.constData(), sizeof(GLenum));
+
+    program->id = glw.glCreateProgram();
+    glw.glProgramBinary(program->id, binary_format, data.constData() + sizeof(GLenum), data.size() - sizeof(GLenum));
+    glw.glGetProgramiv(program->id, GL_LINK_STATUS, &status);
+    if (!status) {
+        /* Stale binary, e.g. after a driver update changed the format. */
+        glw.glDeleteProgram(program->id);
+        program->id = 0;
+        QFile::remove(path);
+        return 0;
+    }
+
+    program->vertex_shader = program->fragment_shader = 0;
+
+    return 1;
+}
+
+void
+OpenGLRenderer::save_program_binary(struct shader_program *program, const QString &path)
+{
+    GLint  length = 0;
+    GLenum binary_format;
+
+    glw.glGetProgramiv(program->id, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+        return;
+
+    QByteArray data(sizeof(GLenum) + length, 0);
+    glw.glGetProgramBinary(program->id, length, &length, &binary_format, data.data() + sizeof(GLenum));
+    if (length <= 0)
+        return;
+    memcpy(data.data(), &binary_format, sizeof(GLenum));
+    data.resize(sizeof(GLenum) + length);
+
+    static_cast<void>(QDir(QString(usr_path) + QString(SHADER_CACHE_PATH)).mkpath("."));
+
+    QFile file(path);
+    if (file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        file.write(data);
+        file.close();
+    }
+}
+
+/* Compile and link a program, or load it from the program binary cache if
+   it was linked before with the same driver. */
+int
+OpenGLRenderer::build_program(struct shader_program *program, const char *vertex_prepend, const char *vertex_src,
+                              const char *fragment_prepend, const char *fragment_src)
+{
+    QString path;
+
+    if (programBinaryFormats > 0) {
+        path = program_cache_path(vertex_prepend, vertex_src, fragment_prepend, fragment_src);
+        if (load_program_binary(program, path))
+            return 1;
+    }
+
+    if (!compile_shader(GL_VERTEX_SHADER, vertex_prepend, vertex_src, &program->vertex_shader)
+        || !compile_shader(GL_FRAGMENT_SHADER, fragment_prepend, fragment_src, &program->fragment_shader)
+        || !create_program(program))
+        return 0;
+
+    if (programBinaryFormats > 0)
+        save_program_binary(program, path);
+
+    return 1;
+}
+
 int
 OpenGLRenderer::compile_shader(GLenum shader_type, const char *prepend, const char *program, int *dst)
 {
@@ -468,22 +594,51 @@ OpenGLRenderer::setup_fbo(struct shader *shader, struct shader_fbo *fbo)
     create_fbo(fbo);
 }
 
+static bool
+fbo_matches(const struct shader_texture *a, const struct shader_texture *b)
+{
+    return (a->width == b->width) && (a->height == b->height) && (a->type == b->type) && (a->internal_format == b->internal_format) && (a->format == b->format) && (a->min_filter == b->min_filter) && (a->mag_filter == b->mag_filter) && (a->wrap_mode == b->wrap_mode) && (a->mipmap == b->mipmap);
+}
+
 void
 OpenGLRenderer::recreate_fbo(struct shader_fbo *fbo, int width, int height)
 {
     if (width != fbo->texture.width || height != fbo->texture.height) {
-        glw.glDeleteFramebuffers(1, (GLuint *) &fbo->id);
-        glw.glDeleteTextures(1, (GLuint *) &fbo->texture.id);
+        struct shader_fbo old = *fbo;
+
         fbo->texture.width  = width;
         fbo->texture.height = height;
-        create_fbo(fbo);
+
+        auto it = std::find_if(fboPool.begin(), fboPool.end(),
+                               [fbo](const struct shader_fbo &pooled) { return fbo_matches(&pooled.texture, &fbo->texture); });
+        if (it != fboPool.end()) {
+            fbo->id         = it->id;
+            fbo->texture.id = it->texture.id;
+            fboPool.erase(it);
+        } else
+            create_fbo(fbo);
+
+        if (old.id >= 0)
+            fboPool.push_back(old);
+        if (fboPool.size() > fboPoolSize) {
+            delete_fbo(&fboPool.front());
+            fboPool.erase(fboPool.begin());
+        }
     }
 }
 
+void
+OpenGLRenderer::clear_fbo_pool()
+{
+    for (auto &pooled : fboPool)
+        delete_fbo(&pooled);
+    fboPool.clear();
+}
+
 int
 OpenGLRenderer::create_default_shader_tex(struct shader_pass *pass)
 {
-    if (!compile_shader(GL_VERTEX_SHADER, 0, vertex_shader_default_tex_src, &pass->program.vertex_shader) || !compile_shader(GL_FRAGMENT_SHADER, 0, fragment_shader_default_tex_src, &pass->program.fragment_shader) || !create_program(&pass->program))
+    if (!build_program(&pass->program, 0, vertex_shader_default_tex_src, 0, fragment_shader_default_tex_src))
         return 0;
     glw.glGenVertexArrays(1, (GLuint *) &pass->vertex_array);
 
@@ -503,7 +658,7 @@ OpenGLRenderer::create_default_shader_tex(struct shader_pass *pass)
 int
 OpenGLRenderer::create_default_shader_color(struct shader_pass *pass)
 {
-    if (!compile_shader(GL_VERTEX_SHADER, 0, vertex_shader_default_color_src, &pass->program.vertex_shader) || !compile_shader(GL_FRAGMENT_SHADER, 0, fragment_shader_default_color_src, &pass->program.fragment_shader) || !create_program(&pass->program))
+    if (!build_program(&pass->program, 0, vertex_shader_default_color_src, 0, fragment_shader_default_color_src))
         return 0;
     glw.glGenVertexArrays(1, (GLuint *) &pass->vertex_array);
 
@@ -536,6 +691,133 @@ OpenGLRenderer::create_scene_shader()
     setup_fbo(&scene_shader_conf, &active_shader->fs_color.fbo);
 }
 
+/* The cursor is applied to the scene in two passes, first multiplying it
+   by the AND mask and then inverting it where the XOR mask is set, which
+   is exact for the all-or-nothing masks cursor hardware works with. */
+void
+OpenGLRenderer::create_cursor_layer()
+{
+    GLfloat vertex[]     = { -1.0f, 1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 1.0f, -1.0f };
+    GLfloat tex_coords[] = { 0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 0.0f, 1.0f, 1.0f };
+
+    memset(&cursor_pass, 0, sizeof(struct shader_pass));
+    if (!create_default_shader_tex(&cursor_pass))
+        return;
+
+    glw.glBindVertexArray(cursor_pass.vertex_array);
+
+    struct shader_vbo *vbo = &cursor_pass.vbo;
+
+    vbo->color = -1;
+    glw.glGenBuffers(1, (GLuint *) &vbo->vertex_coord);
+    glw.glBindBuffer(GL_ARRAY_BUFFER, vbo->vertex_coord);
+    glw.glBufferData(GL_ARRAY_BUFFER, sizeof(vertex), vertex, GL_DYNAMIC_DRAW);
+    glw.glVertexAttribPointer(cursor_pass.uniforms.vertex_coord, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(GLfloat), (GLvoid *) 0);
+
+    glw.glGenBuffers(1, (GLuint *) &vbo->tex_coord);
+    glw.glBindBuffer(GL_ARRAY_BUFFER, vbo->tex_coord);
+    glw.glBufferData(GL_ARRAY_BUFFER, sizeof(tex_coords), tex_coords, GL_DYNAMIC_DRAW);
+    glw.glVertexAttribPointer(cursor_pass.uniforms.tex_coord, 2, GL_FLOAT, GL_TRUE, 2 * sizeof(GLfloat), (GLvoid *) 0);
+
+    glw.glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glw.glBindVertexArray(0);
+
+    for (auto &tex : cursor_textures) {
+        memset(&tex, 0, sizeof(struct shader_texture));
+        tex.width           = CURSOR_LAYER_MAX;
+        tex.height          = CURSOR_LAYER_MAX;
+        tex.internal_format = GL_RGBA8;
+        tex.format          = GL_BGRA;
+        tex.type            = GL_UNSIGNED_INT_8_8_8_8_REV;
+        tex.wrap_mode       = GL_CLAMP_TO_EDGE;
+        tex.min_filter = tex.mag_filter = GL_NEAREST;
+        create_texture(&tex);
+    }
+
+    cursorLayer      = (cursor_layer_t *) calloc(1, sizeof(cursor_layer_t));
+    cursorGeneration = 0;
+}
+
+void
+OpenGLRenderer::delete_cursor_layer()
+{
+    if (cursorLayer == nullptr)
+        return;
+
+    video_cursor_layer_presenter(r_monitor_index, 0);
+
+    for (auto &tex : cursor_textures)
+        delete_texture(&tex);
+    delete_pass(&cursor_pass);
+
+    free(cursorLayer);
+    cursorLayer = nullptr;
+}
+
+/* Draw the cursor layer into the scene framebuffer, which holds the frame
+   at its source resolution with the first line at the top. */
+void
+OpenGLRenderer::render_cursor_layer(int width, int height)
+{
+    if ((cursorLayer == nullptr) || (width <= 0) || (height <= 0))
+        return;
+
+    if (video_cursor_layer_get(r_monitor_index, cursorLayer, cursorGeneration)) {
+        cursorGeneration = cursorLayer->generation;
+
+        if (cursorLayer->w && cursorLayer->h) {
+            glw.glPixelStorei(GL_UNPACK_ROW_LENGTH, CURSOR_LAYER_MAX);
+            glw.glBindTexture(GL_TEXTURE_2D, cursor_textures[0].id);
+            glw.glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, cursorLayer->w, cursorLayer->h, GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV, cursorLayer->and_mask);
+            glw.glBindTexture(GL_TEXTURE_2D, cursor_textures[1].id);
+            glw.glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, cursorLayer->w, cursorLayer->h, GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV, cursorLayer->xor_mask);
+            glw.glBindTexture(GL_TEXTURE_2D, 0);
+            glw.glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+        }
+    }
+
+    if (!cursorLayer->w || !cursorLayer->h)
+        return;
+
+    GLfloat minx = -1.0f + (2.0f * (cursorLayer->x - source.x())) / width;
+    GLfloat maxx = -1.0f + (2.0f * (cursorLayer->x + cursorLayer->w - source.x())) / width;
+    GLfloat maxy = 1.0f - (2.0f * (cursorLayer->y - source.y())) / height;
+    GLfloat miny = 1.0f - (2.0f * (cursorLayer->y + cursorLayer->h - source.y())) / height;
+    GLfloat maxs = cursorLayer->w / (GLfloat) CURSOR_LAYER_MAX;
+    GLfloat maxt = cursorLayer->h / (GLfloat) CURSOR_LAYER_MAX;
+
+    GLfloat vertex[]     = { minx, maxy, minx, miny, maxx, maxy, maxx, miny };
+    GLfloat tex_coords[] = { 0.0f, 0.0f, 0.0f, maxt, maxs, 0.0f, maxs, maxt };
+
+    glw.glBindBuffer(GL_ARRAY_BUFFER, cursor_pass.vbo.vertex_coord);
+    glw.glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(vertex), vertex);
+    glw.glBindBuffer(GL_ARRAY_BUFFER, cursor_pass.vbo.tex_coord);
+    glw.glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(tex_coords), tex_coords);
+    glw.glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    struct render_data data;
+    GLfloat            output_size[] = { (GLfloat) width, (GLfloat) height };
+
+    memset(&data, 0, sizeof(struct render_data));
+    data.pass        = -1;
+    data.shader_pass = &cursor_pass;
+    data.output_size = output_size;
+
+    glw.glEnable(GL_BLEND);
+
+    /* The scene keeps its alpha, only the colour is changed. */
+    glw.glBlendFuncSeparate(GL_ZERO, GL_SRC_COLOR, GL_ZERO, GL_ONE);
+    data.texture = cursor_textures[0].id;
+    render_pass(&data);
+
+    glw.glBlendFuncSeparate(GL_ONE_MINUS_DST_COLOR, GL_ONE_MINUS_SRC_COLOR, GL_ZERO, GL_ONE);
+    data.texture = cursor_textures[1].id;
+    render_pass(&data);
+
+    glw.glBlendFunc(GL_ONE, GL_ZERO);
+    glw.glDisable(GL_BLEND);
+}
+
 static int
 load_texture(const char *f, struct shader_texture *tex)
 {
@@ -665,14 +947,8 @@ OpenGLRenderer::load_glslp(glsl_t *glsl, int num_shader, const char *f)
                     break;
                 } else
                     pclog("Shader %s loaded\n", shader->shader_fn);
-                failed = !compile_shader(GL_VERTEX_SHADER, "#define VERTEX\n#define PARAMETER_UNIFORM\n",
-                                         shader->shader_program, &pass->program.vertex_shader)
-                    || !compile_shader(GL_FRAGMENT_SHADER, "#define FRAGMENT\n#define PARAMETER_UNIFORM\n",
-                                       shader->shader_program, &pass->program.fragment_shader);
-                if (failed)
-                    break;
-
-                if (!create_program(&pass->program)) {
+                if (!build_program(&pass->program, "#define VERTEX\n#define PARAMETER_UNIFORM\n", shader->shader_program,
+                                   "#define FRAGMENT\n#define PARAMETER_UNIFORM\n", shader->shader_program)) {
                     failed = 1;
                     break;
                 }
@@ -782,9 +1058,9 @@ OpenGLRenderer::OpenGLRenderer(QWidget *parent)
     imagebufs[0] = std::unique_ptr<uint8_t>(new uint8_t[2048 * 2048 * 4]);
     imagebufs[1] = std::unique_ptr<uint8_t>(new uint8_t[2048 * 2048 * 4]);
 
-    buf_usage = std::vector<std::atomic_flag>(2);
-    buf_usage[0].clear();
-    buf_usage[1].clear();
+    buf_usage = std::vector<std::atomic_flag>(unpackBufferCount);
+    for (auto &flag : buf_usage)
+        flag.clear();
 
     QSurfaceFormat format;
 
@@ -813,6 +1089,49 @@ OpenGLRenderer::OpenGLRenderer(QWidget *parent)
 
 OpenGLRenderer::~OpenGLRenderer() { finalize(); }
 
+/* Try to let the emulator blit straight into memory the GPU can read from,
+   saving the driver's copy of every frame on upload. */
+void
+OpenGLRenderer::initializeBuffers()
+{
+#ifndef NO_BUFFER_STORAGE
+    typedef void (QOPENGLF_APIENTRYP buffer_storage_t)(GLenum target, GLsizeiptr size, const void *data, GLbitfield flags);
+#    ifndef GL_MAP_PERSISTENT_BIT
+#        define GL_MAP_PERSISTENT_BIT 0x0040
+#    endif
+#    ifndef GL_MAP_COHERENT_BIT
+#        define GL_MAP_COHERENT_BIT 0x0080
+#    endif
+
+    if (QOpenGLContext::openGLModuleType() == QOpenGLContext::LibGLES)
+        return;
+    if (((glsl_version[0] < 4) || ((glsl_version[0] == 4) && (glsl_version[1] < 4))) &&
+        !context->hasExtension(QByteArrayLiteral("GL_ARB_buffer_storage")))
+        return;
+
+    auto bufferStorage = reinterpret_cast<buffer_storage_t>(context->getProcAddress("glBufferStorage"));
+    if (bufferStorage == nullptr)
+        return;
+
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    const GLsizeiptr size  = (GLsizeiptr) unpackBufferSize * unpackBufferCount;
+
+    glw.glGenBuffers(1, &unpackBufferId);
+    glw.glBindBuffer(GL_PIXEL_UNPACK_BUFFER, unpackBufferId);
+    bufferStorage(GL_PIXEL_UNPACK_BUFFER, size, nullptr, flags);
+    unpackBuffer = glw.glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, flags);
+    glw.glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    if (unpackBuffer == nullptr) {
+        glw.glDeleteBuffers(1, &unpackBufferId);
+        unpackBufferId = 0;
+        return;
+    }
+
+    pclog("OpenGL: Using persistently mapped image buffers\n");
+#endif
+}
+
 void
 OpenGLRenderer::initialize()
 {
@@ -854,10 +1173,18 @@ OpenGLRenderer::initialize()
             glslVersion.append(" core");
 
         glw.glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_texture_size);
+
+        programBinaryFormats = 0;
+        if ((QOpenGLContext::openGLModuleType() == QOpenGLContext::LibGLES) || (version.first > 4) || ((version.first == 4) && (version.second >= 1)) || context->hasExtension(QByteArrayLiteral("GL_ARB_get_program_binary")))
+            glw.glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &programBinaryFormats);
+        if (programBinaryFormats > 0)
+            pclog("OpenGL: Caching linked shader programs\n");
         pclog("Max texture size: %dx%d\n", max_texture_size, max_texture_size);
 
         glw.glEnable(GL_TEXTURE_2D);
 
+        initializeBuffers();
+
         //renderTimer->start(75);
         if (video_framerate != -1) {
             renderTimer->start(ceilf(1000.f / (float)video_framerate));
@@ -1038,6 +1365,8 @@ OpenGLRenderer::initialize()
             glw.glBufferData(GL_ARRAY_BUFFER, sizeof(colors), colors, GL_DYNAMIC_DRAW);
             glw.glVertexAttribPointer(color_pass->uniforms.color, 4, GL_FLOAT, GL_TRUE, 4 * sizeof(GLfloat), (GLvoid *) 0);
         }
+        create_cursor_layer();
+
 #ifdef SDL2_SHADER_DEBUG
         struct shader_pass *debug_pass = &active_shader->debug;
         create_default_shader(debug_pass);
@@ -1063,6 +1392,9 @@ OpenGLRenderer::initialize()
         isInitialized = true;
         isFinalized   = false;
 
+        if (cursorLayer != nullptr)
+            video_cursor_layer_presenter(r_monitor_index, 1);
+
         emit initialized();
 
         glw.glClearColor(0, 0, 0, 1);
@@ -1095,6 +1427,19 @@ OpenGLRenderer::finalize()
 
     delete_texture(&scene_texture);
 
+    delete_cursor_layer();
+
+    clear_fbo_pool();
+
+    if (unpackBufferId) {
+        glw.glBindBuffer(GL_PIXEL_UNPACK_BUFFER, unpackBufferId);
+        glw.glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        glw.glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        glw.glDeleteBuffers(1, &unpackBufferId);
+        unpackBufferId = 0;
+        unpackBuffer   = nullptr;
+    }
+
     if (active_shader) {
         delete_glsl(active_shader);
         free(active_shader);
@@ -1111,8 +1456,13 @@ OpenGLRenderer::finalize()
 void
 OpenGLRenderer::onBlit(int buf_idx, int x, int y, int w, int h)
 {
-    if (notReady())
+    int y1 = y;
+    int y2 = y + h;
+
+    if (notReady()) {
+        uploadAll = true;
         return;
+    }
 
     context->makeCurrent(this);
 
@@ -1122,13 +1472,34 @@ OpenGLRenderer::onBlit(int buf_idx, int x, int y, int w, int h)
         glw.glBindTexture(GL_TEXTURE_2D, 0);
     }
 
+    /* Only upload the lines that changed since the previous blit. */
+    if (!uploadAll && (source == QRect(x, y, w, h))) {
+        y1 = std::max(blit_damage[buf_idx].first, y);
+        y2 = std::min(blit_damage[buf_idx].second, y + h);
+    }
+    uploadAll = false;
+
     source.setRect(x, y, w, h);
 
-    glw.glBindTexture(GL_TEXTURE_2D, scene_texture.id);
-    glw.glPixelStorei(GL_UNPACK_ROW_LENGTH, 2048);
-    glw.glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, w, h, (GLenum) QOpenGLTexture::BGRA, (GLenum) QOpenGLTexture::UInt32_RGBA8_Rev, (const void *) ((uintptr_t) imagebufs[buf_idx].get() + (uintptr_t) (2048 * 4 * y + x * 4)));
-    glw.glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
-    glw.glBindTexture(GL_TEXTURE_2D, 0);
+    if (y1 < y2) {
+        const uintptr_t offset = (uintptr_t) (2048 * 4 * y1 + x * 4);
+
+        glw.glBindTexture(GL_TEXTURE_2D, scene_texture.id);
+        glw.glPixelStorei(GL_UNPACK_ROW_LENGTH, 2048);
+        if (unpackBufferId) {
+            glw.glBindBuffer(GL_PIXEL_UNPACK_BUFFER, unpackBufferId);
+            glw.glTexSubImage2D(GL_TEXTURE_2D, 0, 0, y1 - y, w, y2 - y1, (GLenum) QOpenGLTexture::BGRA, (GLenum) QOpenGLTexture::UInt32_RGBA8_Rev, (const void *) ((uintptr_t) unpackBufferSize * buf_idx + offset));
+            glw.glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+            /* The buffer is written again as soon as it is released, wait for the GPU to have read it. */
+            GLsync fence = glw.glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            glw.glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 100000000);
+            glw.glDeleteSync(fence);
+        } else
+            glw.glTexSubImage2D(GL_TEXTURE_2D, 0, 0, y1 - y, w, y2 - y1, (GLenum) QOpenGLTexture::BGRA, (GLenum) QOpenGLTexture::UInt32_RGBA8_Rev, (const void *) ((uintptr_t) imagebufs[buf_idx].get() + offset));
+        glw.glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+        glw.glBindTexture(GL_TEXTURE_2D, 0);
+    }
 
     buf_usage[buf_idx].clear();
     source.setRect(x, y, w, h);
@@ -1151,6 +1522,13 @@ OpenGLRenderer::getBuffers()
 {
     std::vector<std::tuple<uint8_t *, std::atomic_flag *>> buffers;
 
+    if (unpackBuffer) {
+        for (int i = 0; i < unpackBufferCount; i++)
+            buffers.push_back(std::make_tuple((uint8_t *) unpackBuffer + ((uintptr_t) unpackBufferSize * i), &buf_usage[i]));
+
+        return buffers;
+    }
+
     buffers.push_back(std::make_tuple(imagebufs[0].get(), &buf_usage[0]));
     buffers.push_back(std::make_tuple(imagebufs[1].get(), &buf_usage[1]));
 
@@ -1443,6 +1821,9 @@ OpenGLRenderer::render()
         data.output_size = orig_output_size;
         render_pass(&data);
 
+        /* The cursor is part of the picture the shaders work on. */
+        render_cursor_layer(rect.w, rect.h);
+
         glw.glBindFramebuffer(GL_FRAMEBUFFER, 0);
     }
 
@@ -87,6 +87,10 @@ protected:
 private:
 
     std::array<std::unique_ptr<uint8_t>, 2> imagebufs;
+    /* Persistently mapped pixel unpack buffer backing the image buffers,
+       when buffer storage is available. */
+    GLuint unpackBufferId = 0;
+    bool   uploadAll      = true;
 
     QTimer        *renderTimer;
 
@@ -104,18 +108,41 @@ private:
 
     void *unpackBuffer = nullptr;
 
+    static constexpr int      unpackBufferCount = 3;
+    static constexpr uint32_t unpackBufferSize  = 2048 * 2048 * 4;
+
     int glsl_version[2] = { 0, 0 };
 
+    /* Hardware cursor layer, composited over the scene when the emulated
+       card hands its cursor over instead of drawing it into the frame. */
+    struct shader_pass     cursor_pass;
+    struct shader_texture  cursor_textures[2];
+    struct cursor_layer_t *cursorLayer      = nullptr;
+    uint32_t               cursorGeneration = 0;
+
+    /* Number of program binary formats the driver offers, 0 disables the
+       on-disk program cache. */
+    GLint programBinaryFormats = 0;
+
+    /* Framebuffers released on a size change, kept for when the guest
+       switches back to a mode it used before. */
+    std::vector<struct shader_fbo> fboPool;
+    static constexpr size_t        fboPoolSize = 8;
+
     void initialize();
     void initializeExtensions();
     void initializeBuffers();
     void applyOptions();
     
     void create_scene_shader();
+    void create_cursor_layer();
+    void delete_cursor_layer();
+    void render_cursor_layer(int width, int height);
     void create_texture(struct shader_texture *tex);
     void create_fbo(struct shader_fbo *fbo);
     void recreate_fbo(struct shader_fbo *fbo, int width, int height);
     void setup_fbo(struct shader *shader, struct shader_fbo *fbo);
+    void clear_fbo_pool();
 
     bool notReady() const { return !isInitialized || isFinalized; }
     glsl_t* load_glslp(glsl_t *glsl, int num_shader, const char *f);
@@ -124,6 +151,12 @@ private:
     int create_default_shader_tex(struct shader_pass *pass);
     int create_default_shader_color(struct shader_pass *pass);
     int create_program(struct shader_program *program);
+    int build_program(struct shader_program *program, const char *vertex_prepend, const char *vertex_src,
+                      const char *fragment_prepend, const char *fragment_src);
+    QString program_cache_path(const char *vertex_prepend, const char *vertex_src,
+                               const char *fragment_prepend, const char *fragment_src);
+    int load_program_binary(struct shader_program *program, const QString &path);
+    void save_program_binary(struct shader_program *program, const QString &path);
 
     GLuint get_uniform(GLuint program, const char *name);
     GLuint get_attrib(GLuint program, const char *name);
@@ -52,6 +52,8 @@
 #ifdef Q_OS_UNIX
 #    include <pthread.h>
 #    include <sys/mman.h>
+#    include <signal.h>
+#    include <unistd.h>
 #endif
 
 #ifdef Q_OS_OPENBSD
@@ -184,6 +186,12 @@ plat_get_ticks(void)
     return elapsed_timer.elapsed();
 }
 
+uint64_t
+plat_get_ticks_us(void)
+{
+    return elapsed_timer.nsecsElapsed() / 1000;
+}
+
 uint64_t
 plat_timer_read(void)
 {
@@ -358,6 +366,18 @@ plat_remove(char *path)
     QFile(path).remove();
 }
 
+/* Replaces an existing destination, returns 0 on success. */
+int
+plat_rename(const char *from, const char *to)
+{
+#ifdef Q_OS_WINDOWS
+    return MoveFileExW(QString::fromUtf8(from).toStdWString().c_str(), QString::fromUtf8(to).toStdWString().c_str(),
+                       MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) ? 0 : -1;
+#else
+    return rename(from, to);
+#endif
+}
+
 void *
 plat_mmap(size_t size, uint8_t executable)
 {
@@ -387,6 +407,145 @@ plat_munmap(void *ptr, size_t size)
 #endif
 }
 
+void
+plat_mmap_hint_huge(void *ptr, size_t size)
+{
+    /* Windows large pages need SeLockMemoryPrivilege and are committed up
+       front, which defeats demand paging of guest RAM, so only hint on hosts
+       with transparent huge pages. */
+#if defined Q_OS_UNIX && defined MADV_HUGEPAGE
+    (void) madvise(ptr, size, MADV_HUGEPAGE);
+#else
+    (void) ptr;
+    (void) size;
+#endif
+}
+
+void
+plat_mmap_hint_mergeable(void *ptr, size_t size)
+{
+    /* Only Linux merges pages of its own accord, through KSM. */
+#if defined Q_OS_UNIX && defined MADV_MERGEABLE
+    (void) madvise(ptr, size, MADV_MERGEABLE);
+#else
+    (void) ptr;
+    (void) size;
+#endif
+}
+
+/* Returns 1 if the pages now read back as zeroes, without any memory of their
+   own. Elsewhere, MADV_DONTNEED and MEM_RESET leave the old contents around. */
+int
+plat_mmap_discard(void *ptr, size_t size)
+{
+#if defined Q_OS_LINUX && defined MADV_DONTNEED
+    return madvise(ptr, size, MADV_DONTNEED) == 0;
+#else
+    (void) ptr;
+    (void) size;
+    return 0;
+#endif
+}
+
+size_t
+plat_mmap_page_size(void)
+{
+#if defined Q_OS_WINDOWS
+    SYSTEM_INFO si;
+
+    GetSystemInfo(&si);
+    return si.dwPageSize;
+#else
+    long ret = sysconf(_SC_PAGESIZE);
+
+    return (ret > 0) ? (size_t) ret : 4096;
+#endif
+}
+
+/* Returns 1 if the pages are now read-only, or writable again. */
+int
+plat_mmap_protect(void *ptr, size_t size, int writable)
+{
+#if defined Q_OS_WINDOWS
+    DWORD old;
+
+    return VirtualProtect(ptr, size, writable ? PAGE_READWRITE : PAGE_READONLY, &old) != 0;
+#else
+    return mprotect(ptr, size, PROT_READ | (writable ? PROT_WRITE : 0)) == 0;
+#endif
+}
+
+static int (*mmap_fault_handler)(void *addr);
+
+#if defined Q_OS_WINDOWS
+static LONG CALLBACK
+plat_mmap_fault(PEXCEPTION_POINTERS info)
+{
+    PEXCEPTION_RECORD rec = info->ExceptionRecord;
+
+    if ((rec->ExceptionCode == EXCEPTION_ACCESS_VIOLATION) && (rec->NumberParameters >= 2) &&
+        (rec->ExceptionInformation[0] == 1) && mmap_fault_handler((void *) rec->ExceptionInformation[1]))
+        return EXCEPTION_CONTINUE_EXECUTION;
+
+    return EXCEPTION_CONTINUE_SEARCH;
+}
+#else
+static struct sigaction mmap_fault_old_segv;
+static struct sigaction mmap_fault_old_bus;
+
+static void
+plat_mmap_fault(int sig, siginfo_t *info, void *ctx)
+{
+    struct sigaction *old = (sig == SIGBUS) ? &mmap_fault_old_bus : &mmap_fault_old_segv;
+
+    if (mmap_fault_handler(info->si_addr))
+        return;
+
+    /* Not a write to a page that was protected, so either hand it on, or
+       put the old action back in place and fault again. */
+    if (old->sa_flags & SA_SIGINFO)
+        old->sa_sigaction(sig, info, ctx);
+    else if ((old->sa_handler != SIG_DFL) && (old->sa_handler != SIG_IGN))
+        old->sa_handler(sig);
+    else
+        sigaction(sig, old, NULL);
+}
+#endif
+
+/* The handler gets the address of a write to a read-only page, and returns
+   1 if it made the page writable again for the write to be retried. */
+int
+plat_mmap_fault_handler(int (*handler)(void *addr))
+{
+    int installed = (mmap_fault_handler != NULL);
+
+    mmap_fault_handler = handler;
+    if (installed)
+        return 1;
+
+#if defined Q_OS_WINDOWS
+    if (AddVectoredExceptionHandler(1, plat_mmap_fault) == NULL) {
+        mmap_fault_handler = nullptr;
+        return 0;
+    }
+#else
+    struct sigaction sa;
+
+    memset(&sa, 0x00, sizeof(sa));
+    sa.sa_sigaction = plat_mmap_fault;
+    sa.sa_flags     = SA_SIGINFO;
+    sigemptyset(&sa.sa_mask);
+    if (sigaction(SIGSEGV, &sa, &mmap_fault_old_segv) < 0) {
+        mmap_fault_handler = nullptr;
+        return 0;
+    }
+    /* macOS raises SIGBUS for these. */
+    sigaction(SIGBUS, &sa, &mmap_fault_old_bus);
+#endif
+
+    return 1;
+}
+
 extern bool cpu_thread_running;
 void
 plat_pause(int p)
@@ -137,7 +137,6 @@ ProgSettings::accept()
     main_window->refreshMediaMenu();
     main_window->status->message(msg);
     connect(main_window, &MainWindow::updateStatusBarTip, main_window->status.get(), &MachineStatus::updateTip);
-    connect(main_window, &MainWindow::statusBarMessage, main_window->status.get(), &MachineStatus::message, Qt::QueuedConnection);
     mouse_sensitivity = mouseSensitivity;
     QDialog::accept();
 }
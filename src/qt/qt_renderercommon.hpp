@@ -6,9 +6,11 @@
 #include <QRect>
 #include <QWidget>
 
+#include <array>
 #include <atomic>
 #include <memory>
 #include <tuple>
+#include <utility>
 #include <vector>
 
 class QWidget;
@@ -41,6 +43,10 @@ public:
 
     int      r_monitor_index = 0;
 
+    /* Lines, first to last + 1, that changed since the previous blit, for
+       each image buffer; set by the renderer stack before every blit. */
+    std::array<std::pair<int, int>, 3> blit_damage {};
+
 protected:
     bool     eventDelegate(QEvent *event, bool &result);
     void      drawStatusBarIcons(QPainter* painter);
@@ -33,6 +33,7 @@
 
 #include "evdev_mouse.hpp"
 
+#include <algorithm>
 #include <atomic>
 #include <stdexcept>
 
@@ -172,7 +173,7 @@ RendererStack::mouseReleaseEvent(QMouseEvent *event)
         if ((m_monitor_index >= 1) && (mouse_input_mode >= 1) && mousedata.mouse_tablet_in_proximity)
 #endif
 #endif
-            mouse_set_buttons_ex(mouse_get_buttons_ex() & ~event->button());
+            mouse_release_buttons(event->button());
     }
     isMouseDown &= ~1;
 }
@@ -193,7 +194,7 @@ RendererStack::mousePressEvent(QMouseEvent *event)
         if ((m_monitor_index >= 1) && (mouse_input_mode >= 1) && mousedata.mouse_tablet_in_proximity)
 #endif
 #endif
-            mouse_set_buttons_ex(mouse_get_buttons_ex() | event->button());
+            mouse_press_buttons(event->button());
     }
     event->accept();
 }
@@ -442,10 +443,39 @@ RendererStack::createRenderer(Renderer renderer)
 void
 RendererStack::blit(int x, int y, int w, int h)
 {
+    int dy1;
+    int dy2;
+
     if ((x < 0) || (y < 0) || (w <= 0) || (h <= 0) ||
         (w > 2048) || (h > 2048) ||
-        (monitors[m_monitor_index].target_buffer == NULL) || imagebufs.empty() ||
-        std::get<std::atomic_flag *>(imagebufs[currentBuf])->test_and_set()) {
+        (monitors[m_monitor_index].target_buffer == NULL) || imagebufs.empty()) {
+        bufDamage.clear();
+        video_blit_complete_monitor(m_monitor_index);
+        return;
+    }
+
+    /* Every buffer needs the lines changed since it was last filled. A
+       new set of buffers, or a new blit area, starts out fully stale. */
+    video_blit_get_damage_monitor(m_monitor_index, &dy1, &dy2);
+    if ((bufDamage.size() != imagebufs.size()) || (bufDamageBase != std::get<uint8_t *>(imagebufs[0])) ||
+        (x != sx) || (y != sy) || (w != sw) || (h != sh)) {
+        bufDamage.assign(imagebufs.size(), std::make_pair(y, y + h));
+        bufDamageBase  = std::get<uint8_t *>(imagebufs[0]);
+        rendererDamage = std::make_pair(y, y + h);
+    } else if (dy1 < dy2) {
+        for (auto &damage : bufDamage) {
+            if (damage.first >= damage.second)
+                damage = std::make_pair(dy1, dy2);
+            else
+                damage = std::make_pair(std::min(damage.first, dy1), std::max(damage.second, dy2));
+        }
+        if (rendererDamage.first >= rendererDamage.second)
+            rendererDamage = std::make_pair(dy1, dy2);
+        else
+            rendererDamage = std::make_pair(std::min(rendererDamage.first, dy1), std::max(rendererDamage.second, dy2));
+    }
+
+    if (std::get<std::atomic_flag *>(imagebufs[currentBuf])->test_and_set()) {
         video_blit_complete_monitor(m_monitor_index);
         return;
     }
@@ -454,15 +484,30 @@ RendererStack::blit(int x, int y, int w, int h)
     sw = this->w = w;
     sh = this->h       = h;
     uint8_t *imagebits = std::get<uint8_t *>(imagebufs[currentBuf]);
-    for (int y1 = y; y1 < (y + h); y1++) {
+    /* Screenshots are taken from the image buffer, so it has to be complete. */
+    if (monitors[m_monitor_index].mon_screenshots && !rendererTakesScreenshots)
+        bufDamage[currentBuf] = std::make_pair(y, y + h);
+    for (int y1 = bufDamage[currentBuf].first; y1 < bufDamage[currentBuf].second; y1++) {
         auto scanline = imagebits + (y1 * rendererWindow->getBytesPerRow()) + (x * 4);
         video_copy(scanline, &(monitors[m_monitor_index].target_buffer->line[y1][x]), w * 4);
     }
+    bufDamage[currentBuf] = std::make_pair(0, 0);
 
     if (monitors[m_monitor_index].mon_screenshots && !rendererTakesScreenshots) {
         video_screenshot_monitor((uint32_t *) imagebits, x, y, 2048, m_monitor_index);
     }
     video_blit_complete_monitor(m_monitor_index);
+
+    /* With frame pacing, wait for the frame to be due. One that a newer frame
+       overtook is not handed over, its changes go out with the next one. */
+    if (!video_blit_pace_monitor(m_monitor_index)) {
+        std::get<std::atomic_flag *>(imagebufs[currentBuf])->clear();
+        return;
+    }
+
+    if (currentBuf < (int) rendererWindow->blit_damage.size())
+        rendererWindow->blit_damage[currentBuf] = rendererDamage;
+    rendererDamage = std::make_pair(0, 0);
     emit blitToRenderer(currentBuf, sx, sy, sw, sh);
     currentBuf = (currentBuf + 1) % imagebufs.size();
 }
@@ -11,6 +11,7 @@
 #include <atomic>
 #include <memory>
 #include <tuple>
+#include <utility>
 #include <vector>
 
 #include "qt_renderercommon.hpp"
@@ -110,6 +111,12 @@ private:
 
     std::vector<std::tuple<uint8_t *, std::atomic_flag *>> imagebufs;
 
+    /* Lines of each image buffer that are out of date, first to last + 1. */
+    std::vector<std::pair<int, int>> bufDamage;
+    uint8_t                         *bufDamageBase = nullptr;
+    /* Lines changed since the previous blit handed to the renderer. */
+    std::pair<int, int> rendererDamage;
+
     RendererCommon          *rendererWindow { nullptr };
     std::unique_ptr<QWidget> current;
 
@@ -43,6 +43,7 @@ SettingsNetwork::enableElements(Ui::SettingsNetwork *ui)
         bool adaptersEnabled =  netType == NET_TYPE_NONE
                             ||  netType == NET_TYPE_SLIRP
                             ||  netType == NET_TYPE_VDE
+                            ||  netType == NET_TYPE_TAP
                             || (netType == NET_TYPE_PCAP && intf_cbox->currentData().toInt() > 0);
 
         intf_cbox->setEnabled(net_type_cbox->currentData().toInt() == NET_TYPE_PCAP);
@@ -53,7 +54,9 @@ SettingsNetwork::enableElements(Ui::SettingsNetwork *ui)
                                  device_has_config(machine_get_net_device(machineId)));
         else
             conf_btn->setEnabled(adaptersEnabled && network_card_has_config(nic_cbox->currentData().toInt()));
-        socket_line->setEnabled(net_type_cbox->currentData().toInt() == NET_TYPE_VDE);
+        /* The same field holds the TAP interface name. */
+        socket_line->setEnabled((netType == NET_TYPE_VDE) || (netType == NET_TYPE_TAP));
+        socket_line->setPlaceholderText((netType == NET_TYPE_TAP) ? tr("TAP interface, e.g. tap0") : QString());
     }
 }
 
@@ -93,7 +96,7 @@ SettingsNetwork::save()
         memset(net_cards_conf[i].host_dev_name, '\0', sizeof(net_cards_conf[i].host_dev_name));
         if (net_cards_conf[i].net_type == NET_TYPE_PCAP) {
             strncpy(net_cards_conf[i].host_dev_name, network_devs[cbox->currentData().toInt()].device, sizeof(net_cards_conf[i].host_dev_name) - 1);
-        } else if (net_cards_conf[i].net_type == NET_TYPE_VDE) {
+        } else if ((net_cards_conf[i].net_type == NET_TYPE_VDE) || (net_cards_conf[i].net_type == NET_TYPE_TAP)) {
             strncpy(net_cards_conf[i].host_dev_name, socket_line->text().toUtf8().constData(), sizeof(net_cards_conf[i].host_dev_name));
         }
     }
@@ -152,9 +155,13 @@ SettingsNetwork::onCurrentMachineChanged(int machineId)
         if (network_devmap.has_vde) {
             Models::AddEntry(model, "VDE", NET_TYPE_VDE);
         }
+        if (network_devmap.has_tap) {
+            Models::AddEntry(model, "TAP", NET_TYPE_TAP);
+        }
         
         model->removeRows(0, removeRows);
-        cbox->setCurrentIndex(net_cards_conf[i].net_type);
+        /* Not every type is always listed, so the row is not the type. */
+        cbox->setCurrentIndex(cbox->findData(net_cards_conf[i].net_type));
 
         selectedRow = 0;
 
@@ -172,7 +179,7 @@ SettingsNetwork::onCurrentMachineChanged(int machineId)
             model->removeRows(0, removeRows);
             cbox->setCurrentIndex(selectedRow);
         }  
-        if (net_cards_conf[i].net_type == NET_TYPE_VDE) {
+        if ((net_cards_conf[i].net_type == NET_TYPE_VDE) || (net_cards_conf[i].net_type == NET_TYPE_TAP)) {
             QString currentVdeSocket = net_cards_conf[i].host_dev_name;
             auto editline = findChild<QLineEdit *>(QString("socketVDENIC%1").arg(i+1));
             editline->setText(currentVdeSocket);
@@ -42,11 +42,18 @@ SoftwareRenderer::SoftwareRenderer(QWidget *parent)
     buf_usage = std::vector<std::atomic_flag>(2);
     buf_usage[0].clear();
     buf_usage[1].clear();
+
+    scaler = video_scaler_init();
 #ifdef __HAIKU__
     this->setMouseTracking(true);
 #endif
 }
 
+SoftwareRenderer::~SoftwareRenderer()
+{
+    video_scaler_close(scaler);
+}
+
 void
 SoftwareRenderer::paintEvent(QPaintEvent *event)
 {
@@ -112,7 +119,29 @@ SoftwareRenderer::onPaint(QPaintDevice *device)
     painter.fillRect(0, 0, device->width(), device->height(), Qt::black);
 #endif
     painter.setCompositionMode(QPainter::CompositionMode_Plus);
-    painter.drawImage(destination, *images[cur_image], source);
+
+    const QImage *image = images[cur_image].get();
+    const qreal   dpr   = device->devicePixelRatioF();
+    const QSize   size(qRound(destination.width() * dpr), qRound(destination.height() * dpr));
+
+    if ((size == source.size()) || size.isEmpty() || source.isEmpty() || (scaler == nullptr)) {
+        painter.drawImage(destination, *image, source);
+        return;
+    }
+
+    /* QPainter's own scaling is slow at window sizes, so do it here, and
+       only for the rows that changed since the last frame. */
+    if (scaled.size() != size) {
+        scaled = QImage(size, QImage::Format_RGB32);
+        video_scaler_invalidate(scaler);
+    }
+    scaled.setDevicePixelRatio(dpr);
+
+    video_scale(scaler, reinterpret_cast<uint32_t *>(scaled.bits()), scaled.bytesPerLine() / 4, size.width(), size.height(),
+                reinterpret_cast<const uint32_t *>(image->constScanLine(source.y())) + source.x(), image->bytesPerLine() / 4,
+                source.width(), source.height(), (video_filter_method > 0) ? VIDEO_SCALE_LINEAR : VIDEO_SCALE_NEAREST);
+
+    painter.drawImage(destination.topLeft(), scaled);
 }
 
 std::vector<std::tuple<uint8_t *, std::atomic_flag *>>
@@ -8,6 +8,10 @@
 #include <atomic>
 #include "qt_renderercommon.hpp"
 
+extern "C" {
+#include <86box/vid_scale.h>
+}
+
 class SoftwareRenderer :
 #ifdef __HAIKU__
     public QWidget,
@@ -18,6 +22,7 @@ class SoftwareRenderer :
     Q_OBJECT
 public:
     explicit SoftwareRenderer(QWidget *parent = nullptr);
+    ~SoftwareRenderer();
 
     void paintEvent(QPaintEvent *event) override;
 
@@ -30,6 +35,10 @@ protected:
     std::array<std::unique_ptr<QImage>, 2> images;
     int                                    cur_image = -1;
 
+    /* The frame scaled to the window, in device pixels. */
+    QImage          scaled;
+    video_scaler_t *scaler = nullptr;
+
     void onPaint(QPaintDevice *device);
     void resizeEvent(QResizeEvent *event) override;
     bool event(QEvent *event) override;
@@ -17,6 +17,7 @@
  *          Copyright 2021-2022 Cacodemon345
  */
 #include <cstdint>
+#include <mutex>
 
 #include <QDebug>
 #include <QThread>
@@ -29,9 +30,10 @@
 
 MainWindow *main_window = nullptr;
 
-static QString sb_text;
-static QString sb_buguitext;
-static QString sb_mt32lcdtext;
+static QString    sb_text;
+static QString    sb_buguitext;
+static QString    sb_mt32lcdtext;
+static std::mutex sb_text_mutex;
 
 extern "C" {
 
@@ -175,32 +177,42 @@ ui_msgbox(int flags, void *message)
     return ui_msgbox_header(flags, nullptr, message);
 }
 
+static void
+sb_post_text()
+{
+    MachineStatus::postMessage(!sb_mt32lcdtext.isEmpty() ? sb_mt32lcdtext : sb_text.isEmpty() ? sb_buguitext
+                                                                                             : sb_text);
+}
+
 void
 ui_sb_update_text()
 {
-    emit main_window->statusBarMessage(!sb_mt32lcdtext.isEmpty() ? sb_mt32lcdtext : sb_text.isEmpty() ? sb_buguitext
-                                                                                                      : sb_text);
+    std::lock_guard<std::mutex> lock(sb_text_mutex);
+    sb_post_text();
 }
 
 void
 ui_sb_mt32lcd(char *str)
 {
+    std::lock_guard<std::mutex> lock(sb_text_mutex);
     sb_mt32lcdtext = QString(str);
-    ui_sb_update_text();
+    sb_post_text();
 }
 
 void
 ui_sb_set_text_w(wchar_t *wstr)
 {
+    std::lock_guard<std::mutex> lock(sb_text_mutex);
     sb_text = QString::fromWCharArray(wstr);
-    ui_sb_update_text();
+    sb_post_text();
 }
 
 void
 ui_sb_set_text(char *str)
 {
+    std::lock_guard<std::mutex> lock(sb_text_mutex);
     sb_text = str;
-    ui_sb_update_text();
+    sb_post_text();
 }
 
 void
@@ -218,8 +230,9 @@ ui_sb_update_panes()
 void
 ui_sb_bugui(char *str)
 {
+    std::lock_guard<std::mutex> lock(sb_text_mutex);
     sb_buguitext = str;
-    ui_sb_update_text();
+    sb_post_text();
 }
 
 void
@@ -269,8 +282,7 @@ ui_sb_update_icon_state(int tag, int state)
             break;
     }
 
-    if (main_window != nullptr)
-        main_window->updateStatusEmptyIcons();
+    MachineStatus::postEmptyIconsRefresh();
 }
 
 void
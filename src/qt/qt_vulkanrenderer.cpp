@@ -362,19 +362,27 @@ VulkanRenderer2::ensureTexture()
             }
 
             m_texStagingTransferLayout = true;
+            dirtyRect                  = QRect(QPoint(0, 0), m_texSize);
         }
 
-        VkImageCopy copyInfo;
-        memset(&copyInfo, 0, sizeof(copyInfo));
-        copyInfo.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-        copyInfo.srcSubresource.layerCount = 1;
-        copyInfo.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-        copyInfo.dstSubresource.layerCount = 1;
-        copyInfo.extent.width              = m_texSize.width();
-        copyInfo.extent.height             = m_texSize.height();
-        copyInfo.extent.depth              = 1;
-        m_devFuncs->vkCmdCopyImage(cb, m_texStaging, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-                                   m_texImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copyInfo);
+        // Only copy what the emulator wrote since the previous frame, the rest of the texture is still valid.
+        const QRect copyRect = dirtyRect & QRect(QPoint(0, 0), m_texSize);
+        dirtyRect            = QRect();
+        if (!copyRect.isEmpty()) {
+            VkImageCopy copyInfo;
+            memset(&copyInfo, 0, sizeof(copyInfo));
+            copyInfo.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            copyInfo.srcSubresource.layerCount = 1;
+            copyInfo.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            copyInfo.dstSubresource.layerCount = 1;
+            copyInfo.srcOffset.x               = copyInfo.dstOffset.x = copyRect.x();
+            copyInfo.srcOffset.y               = copyInfo.dstOffset.y = copyRect.y();
+            copyInfo.extent.width              = copyRect.width();
+            copyInfo.extent.height             = copyRect.height();
+            copyInfo.extent.depth              = 1;
+            m_devFuncs->vkCmdCopyImage(cb, m_texStaging, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                                       m_texImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copyInfo);
+        }
 
         barrier.oldLayout     = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
         barrier.newLayout     = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
@@ -478,12 +486,13 @@ VulkanRenderer2::initResources()
         return emit qobject_cast<VulkanWindowRenderer *>(m_window)->errorInitializing();
     }
 
-    quint8 *p;
-    err = m_devFuncs->vkMapMemory(dev, m_bufMem, 0, memReq.size, 0, reinterpret_cast<void **>(&p));
+    // Kept mapped for the lifetime of the buffer, the memory is host coherent.
+    err = m_devFuncs->vkMapMemory(dev, m_bufMem, 0, memReq.size, 0, reinterpret_cast<void **>(&m_bufPtr));
     if (err != VK_SUCCESS) {
         qWarning("Failed to map memory: %d", err);
         return emit qobject_cast<VulkanWindowRenderer *>(m_window)->errorInitializing();
     }
+    quint8 *p = m_bufPtr;
     memcpy(p, vertexData, sizeof(vertexData));
     QMatrix4x4 ident;
     memset(m_uniformBufInfo, 0, sizeof(m_uniformBufInfo));
@@ -494,7 +503,6 @@ VulkanRenderer2::initResources()
         m_uniformBufInfo[i].offset = offset;
         m_uniformBufInfo[i].range  = uniformAllocSize;
     }
-    m_devFuncs->vkUnmapMemory(dev, m_bufMem);
 
     VkVertexInputBindingDescription vertexBindingDesc = {
         0, // binding
@@ -896,6 +904,9 @@ VulkanRenderer2::releaseResources()
     }
 
     if (m_bufMem) {
+        if (m_bufPtr)
+            m_devFuncs->vkUnmapMemory(dev, m_bufMem);
+        m_bufPtr = nullptr;
         m_devFuncs->vkFreeMemory(dev, m_bufMem, nullptr);
         m_bufMem = VK_NULL_HANDLE;
     }
@@ -933,23 +944,11 @@ VulkanRenderer2::startNextFrame()
     VkCommandBuffer cmdBuf               = m_window->currentCommandBuffer();
     m_devFuncs->vkCmdBeginRenderPass(cmdBuf, &rpBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
 
-    quint8  *p;
-    VkResult err = m_devFuncs->vkMapMemory(dev, m_bufMem, m_uniformBufInfo[m_window->currentFrame()].offset,
-                                           UNIFORM_DATA_SIZE, 0, reinterpret_cast<void **>(&p));
-    if (err != VK_SUCCESS)
-        qFatal("Failed to map memory: %d", err);
     QMatrix4x4 m = m_proj;
-    memcpy(p, m.constData(), 16 * sizeof(float));
-    m_devFuncs->vkUnmapMemory(dev, m_bufMem);
-    p = nullptr;
+    memcpy(m_bufPtr + m_uniformBufInfo[m_window->currentFrame()].offset, m.constData(), 16 * sizeof(float));
 
     // Second pass for texture coordinates.
-    err = m_devFuncs->vkMapMemory(dev, m_bufMem, 0,
-                                  sizeof(vertexData), 0, reinterpret_cast<void **>(&p));
-    if (err != VK_SUCCESS)
-        qFatal("Failed to map memory: %d", err);
-
-    float *floatData   = (float *) p;
+    float *floatData   = (float *) m_bufPtr;
     auto   source      = qobject_cast<VulkanWindowRenderer *>(m_window)->source;
     auto   destination = qobject_cast<VulkanWindowRenderer *>(m_window)->destination;
     floatData[3]       = (float) source.x() / 2048.f;
@@ -961,8 +960,6 @@ VulkanRenderer2::startNextFrame()
     floatData[18]      = (float) (source.x() + source.width()) / 2048.f;
     floatData[14]      = (float) (source.y() + source.height()) / 2048.f;
 
-    m_devFuncs->vkUnmapMemory(dev, m_bufMem);
-
     m_devFuncs->vkCmdBindPipeline(cb, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline);
     m_devFuncs->vkCmdBindDescriptorSets(cb, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout, 0, 1,
                                         &m_descSet[m_window->currentFrame()], 0, nullptr);
@@ -1007,7 +1004,8 @@ VulkanRenderer2::startNextFrame()
         m_texStagingPending = true;
     }
 
+    // New frames are requested by VulkanWindowRenderer::onBlit, rendering continuously would keep
+    // the GUI thread waiting on the swapchain and delay the blits the emulator is waiting for.
     m_window->frameReady();
-    m_window->requestUpdate(); // render continuously, throttled by the presentation rate
 }
 #endif /* QT_CONFIG(vulkan) */
@@ -44,6 +44,9 @@ class VulkanRenderer2 : public QVulkanWindowRenderer {
 public:
     void  *mappedPtr  = nullptr;
     size_t imagePitch = 2048 * 4;
+    /* Area of the staging image written since the last copy to the
+       device-local texture. */
+    QRect  dirtyRect;
     VulkanRenderer2(QVulkanWindow *w);
 
     void initResources() override;
@@ -67,6 +70,7 @@ private:
 
     VkDeviceMemory         m_bufMem = VK_NULL_HANDLE;
     VkBuffer               m_buf    = VK_NULL_HANDLE;
+    quint8                *m_bufPtr = nullptr;
     VkDescriptorBufferInfo m_uniformBufInfo[QVulkanWindow::MAX_CONCURRENT_FRAME_COUNT];
 
     VkDescriptorPool      m_descPool      = VK_NULL_HANDLE;
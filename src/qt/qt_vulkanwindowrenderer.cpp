@@ -38,6 +38,7 @@
 #if QT_CONFIG(vulkan)
 #    include <QVulkanWindowRenderer>
 #    include <QVulkanDeviceFunctions>
+#    include <algorithm>
 #    include <array>
 #    include <stdexcept>
 
@@ -864,6 +865,17 @@ void
 VulkanWindowRenderer::onBlit(int buf_idx, int x, int y, int w, int h)
 {
     auto origSource = source;
+    int  y1         = y;
+    int  y2         = y + h;
+
+    /* Only the lines that changed since the previous blit need copying to the texture. */
+    if (origSource == QRect(x, y, w, h)) {
+        y1 = std::max(blit_damage[buf_idx].first, y);
+        y2 = std::min(blit_damage[buf_idx].second, y + h);
+    }
+    if (renderer && (y1 < y2))
+        renderer->dirtyRect |= QRect(x, y1, w, y2 - y1);
+
     source.setRect(x, y, w, h);
     if (isExposed())
         requestUpdate();
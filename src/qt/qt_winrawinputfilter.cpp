@@ -340,37 +340,33 @@ WindowsRawInputFilter::mouse_handle(PRAWINPUT raw)
     RAWMOUSE   state = raw->data.mouse;
     static int x, delta_x;
     static int y, delta_y;
-    static int b, delta_z;
-
-    b = mouse_get_buttons_ex();
+    static int delta_z;
 
     /* read mouse buttons and wheel */
     if (state.usButtonFlags & RI_MOUSE_LEFT_BUTTON_DOWN)
-        b |= 1;
+        mouse_press_buttons(1);
     else if (state.usButtonFlags & RI_MOUSE_LEFT_BUTTON_UP)
-        b &= ~1;
+        mouse_release_buttons(1);
 
     if (state.usButtonFlags & RI_MOUSE_MIDDLE_BUTTON_DOWN)
-        b |= 4;
+        mouse_press_buttons(4);
     else if (state.usButtonFlags & RI_MOUSE_MIDDLE_BUTTON_UP)
-        b &= ~4;
+        mouse_release_buttons(4);
 
     if (state.usButtonFlags & RI_MOUSE_RIGHT_BUTTON_DOWN)
-        b |= 2;
+        mouse_press_buttons(2);
     else if (state.usButtonFlags & RI_MOUSE_RIGHT_BUTTON_UP)
-        b &= ~2;
+        mouse_release_buttons(2);
 
     if (state.usButtonFlags & RI_MOUSE_BUTTON_4_DOWN)
-        b |= 8;
+        mouse_press_buttons(8);
     else if (state.usButtonFlags & RI_MOUSE_BUTTON_4_UP)
-        b &= ~8;
+        mouse_release_buttons(8);
 
     if (state.usButtonFlags & RI_MOUSE_BUTTON_5_DOWN)
-        b |= 16;
+        mouse_press_buttons(16);
     else if (state.usButtonFlags & RI_MOUSE_BUTTON_5_UP)
-        b &= ~16;
-
-    mouse_set_buttons_ex(b);
+        mouse_release_buttons(16);
 
     if (state.usButtonFlags & RI_MOUSE_WHEEL) {
         delta_z = (SHORT) state.usButtonData / 120;
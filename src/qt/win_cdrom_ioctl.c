@@ -37,6 +37,25 @@
 #include <86box/log.h>
 #include <86box/plat_cdrom_ioctl.h>
 #include <86box/scsi_device.h>
+#include <86box/thread.h>
+
+/*
+ * Sequential reads are served from chunks the read-ahead thread fetches
+ * from the host drive in the background, so the CPU thread does not wait
+ * for the physical drive on every sector. The CD chunks stay below the
+ * 64 kB many host adapters limit pass through transfers to.
+ */
+#define IOCTL_RA_CD_SECTORS  16
+#define IOCTL_RA_DVD_SECTORS 32
+#define IOCTL_RA_CD_SIZE     (RAW_SECTOR_SIZE + 16) /* Raw sector followed by the Q subchannel. */
+#define IOCTL_RA_BUF_SIZE    65536
+
+typedef struct ioctl_ra_slot_t {
+    uint32_t lba;
+    int      count; /* Valid sectors, 0 if the slot is empty. */
+    int      busy;  /* Being filled by the read-ahead thread. */
+    uint8_t *data;
+} ioctl_ra_slot_t;
 
 typedef struct ioctl_t {
     cdrom_t                *dev;
@@ -50,6 +69,16 @@ typedef struct ioctl_t {
     uint8_t                 cur_rti[65536];
     HANDLE                  handle;
     WCHAR                   path[256];
+
+    uint32_t                last_block;
+    ioctl_ra_slot_t         ra_slot[2];
+    int                     ra_gen;    /* Bumped when the medium changes. */
+    int                     ra_failed; /* The drive does not take chunked reads. */
+    volatile int            ra_quit;
+    thread_t               *ra_thread;
+    event_t                *ra_wake;
+    event_t                *ra_done;
+    mutex_t                *ra_mutex;
 } ioctl_t;
 
 static int ioctl_read_dvd_structure(const void *local, uint8_t layer, uint8_t format,
@@ -349,6 +378,222 @@ ioctl_is_track_pre(const void *local, const uint32_t sector)
     return ret;
 }
 
+/* Read up to a chunk of sectors starting from lba, returns how many were read. */
+static int
+ioctl_ra_fill(const ioctl_t *ioctl, uint32_t lba, uint8_t *data)
+{
+    typedef struct SCSI_PASS_THROUGH_DIRECT_BUF {
+        SCSI_PASS_THROUGH_DIRECT spt;
+        ULONG                    Filler;
+        UCHAR                    SenseBuf[64];
+    } SCSI_PASS_THROUGH_DIRECT_BUF;
+
+    const int                    max_count = ioctl->is_dvd ? IOCTL_RA_DVD_SECTORS : IOCTL_RA_CD_SECTORS;
+    const int                    size      = ioctl->is_dvd ? COOKED_SECTOR_SIZE : IOCTL_RA_CD_SIZE;
+    unsigned long int            unused    = 0;
+    int                          count     = max_count;
+    int                          ret       = 0;
+    HANDLE                       h;
+    SCSI_PASS_THROUGH_DIRECT_BUF req;
+
+    if (lba >= ioctl->last_block)
+        return 0;
+    if ((ioctl->last_block - lba) < (uint32_t) count)
+        count = (int) (ioctl->last_block - lba);
+
+    /* The CPU thread uses ioctl->handle, so this gets a handle of its own. */
+    h = CreateFileW((LPCWSTR) ioctl->path, GENERIC_READ | GENERIC_WRITE,
+                    FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+                    OPEN_EXISTING, 0, NULL);
+    if (h == INVALID_HANDLE_VALUE)
+        return 0;
+
+    if (ioctl->is_dvd) {
+        LARGE_INTEGER pos;
+        DWORD         got = 0;
+
+        pos.QuadPart = (LONGLONG) lba * COOKED_SECTOR_SIZE;
+        if (SetFilePointerEx(h, pos, NULL, FILE_BEGIN) &&
+            ReadFile(h, data, count * COOKED_SECTOR_SIZE, &got, NULL))
+            ret = (int) (got / COOKED_SECTOR_SIZE);
+    } else {
+        memset(&req, 0x00, sizeof(SCSI_PASS_THROUGH_DIRECT_BUF));
+        req.spt.Length                = sizeof(SCSI_PASS_THROUGH_DIRECT);
+        req.spt.PathId                = 0;
+        req.spt.TargetId              = 1;
+        req.spt.Lun                   = 0;
+        req.spt.CdbLength             = 12;
+        req.spt.DataIn                = SCSI_IOCTL_DATA_IN;
+        req.spt.SenseInfoLength       = sizeof(req.SenseBuf);
+        req.spt.DataTransferLength    = count * size;
+        req.spt.TimeOutValue          = 6;
+        req.spt.DataBuffer            = data;
+        req.spt.SenseInfoOffset       = offsetof(SCSI_PASS_THROUGH_DIRECT_BUF, SenseBuf);
+
+        /* Fill in the CDB. */
+        req.spt.Cdb[0]                 = 0xbe;             /* READ CD */
+        req.spt.Cdb[2]                 = (lba >> 24) & 0xff;
+        req.spt.Cdb[3]                 = (lba >> 16) & 0xff;
+        req.spt.Cdb[4]                 = (lba >> 8) & 0xff;
+        req.spt.Cdb[5]                 = lba & 0xff;       /* Starting Logical Block Address. */
+        req.spt.Cdb[8]                 = count;            /* Transfer Length. */
+        req.spt.Cdb[9]                 = 0xf8;
+        req.spt.Cdb[10]                = 0x02;
+        DWORD length                   = sizeof(SCSI_PASS_THROUGH_DIRECT_BUF);
+
+        /* Any sense at all, CIRC errors included, leaves the sectors to single reads. */
+        if (DeviceIoControl(h, IOCTL_SCSI_PASS_THROUGH_DIRECT,
+                            &req, length, &req, length, &unused, NULL) &&
+            (req.spt.SenseInfoLength < 16))
+            ret = (int) (req.spt.DataTransferLength / size);
+    }
+
+    CloseHandle(h);
+
+    ioctl_log(ioctl->log, "ioctl_ra_fill(%08X, %i): %i\n", lba, count, ret);
+
+    return ret;
+}
+
+static void
+ioctl_ra_thread(void *priv)
+{
+    ioctl_t *ioctl = (ioctl_t *) priv;
+
+    while (1) {
+        (void) thread_wait_event(ioctl->ra_wake, -1);
+        if (ioctl->ra_quit)
+            break;
+
+        for (int i = 0; i < 2; i++) {
+            ioctl_ra_slot_t *slot = &ioctl->ra_slot[i];
+            uint32_t         lba;
+            int              busy;
+            int              gen;
+            int              count;
+
+            thread_wait_mutex(ioctl->ra_mutex);
+            busy = slot->busy;
+            lba  = slot->lba;
+            gen  = ioctl->ra_gen;
+            thread_release_mutex(ioctl->ra_mutex);
+
+            if (!busy)
+                continue;
+
+            count = ioctl_ra_fill(ioctl, lba, slot->data);
+
+            thread_wait_mutex(ioctl->ra_mutex);
+            if (gen == ioctl->ra_gen) {
+                slot->count = count;
+                if (count == 0)
+                    ioctl->ra_failed = 1;
+            }
+            slot->busy = 0;
+            thread_release_mutex(ioctl->ra_mutex);
+
+            thread_set_event(ioctl->ra_done);
+        }
+    }
+}
+
+/* Hand the chunk from lba on to the read-ahead thread, with the mutex held. */
+static void
+ioctl_ra_queue(ioctl_t *ioctl, ioctl_ra_slot_t *slot, uint32_t lba)
+{
+    if (ioctl->ra_failed || slot->busy || (lba >= ioctl->last_block))
+        return;
+
+    slot->lba   = lba;
+    slot->count = 0;
+    slot->busy  = 1;
+
+    thread_set_event(ioctl->ra_wake);
+}
+
+/* Serve a sector from the read-ahead chunks, returns 0 if it has to be read from the drive. */
+static int
+ioctl_ra_read(ioctl_t *ioctl, uint8_t *buffer, const uint32_t sector)
+{
+    const int        size      = ioctl->is_dvd ? COOKED_SECTOR_SIZE : IOCTL_RA_CD_SIZE;
+    const uint32_t   max_count = ioctl->is_dvd ? IOCTL_RA_DVD_SECTORS : IOCTL_RA_CD_SECTORS;
+    ioctl_ra_slot_t *hit       = NULL;
+
+    if (ioctl->ra_thread == NULL)
+        return 0;
+
+    thread_wait_mutex(ioctl->ra_mutex);
+
+    while (1) {
+        ioctl_ra_slot_t *pending = NULL;
+
+        for (int i = 0; i < 2; i++) {
+            ioctl_ra_slot_t *slot = &ioctl->ra_slot[i];
+
+            if (slot->busy) {
+                if ((sector >= slot->lba) && ((sector - slot->lba) < max_count))
+                    pending = slot;
+            } else if (slot->count && (sector >= slot->lba) && ((sector - slot->lba) < (uint32_t) slot->count))
+                hit = slot;
+        }
+
+        /* The guest caught up with the read-ahead, wait for the chunk. */
+        if ((hit != NULL) || (pending == NULL))
+            break;
+
+        thread_release_mutex(ioctl->ra_mutex);
+        (void) thread_wait_event(ioctl->ra_done, -1);
+        thread_wait_mutex(ioctl->ra_mutex);
+    }
+
+    if (hit != NULL) {
+        ioctl_ra_slot_t *other = &ioctl->ra_slot[(hit == &ioctl->ra_slot[0]) ? 1 : 0];
+        const uint32_t   next  = hit->lba + hit->count;
+
+        if (ioctl->is_dvd)
+            memcpy(&(buffer[16]), &(hit->data[(sector - hit->lba) * size]), size);
+        else
+            memcpy(buffer, &(hit->data[(sector - hit->lba) * size]), size);
+
+        /* Past the middle of the chunk, fetch the one after it. */
+        if (((sector - hit->lba) >= (uint32_t) (hit->count >> 1)) &&
+            !(other->count && (other->lba == next)))
+            ioctl_ra_queue(ioctl, other, next);
+    } else {
+        ioctl_ra_slot_t *free_slot = NULL;
+
+        /* Out of sequence, start fetching from the sector after this one. */
+        for (int i = 0; i < 2; i++) {
+            if (!ioctl->ra_slot[i].busy) {
+                ioctl->ra_slot[i].count = 0;
+                if (free_slot == NULL)
+                    free_slot = &ioctl->ra_slot[i];
+            }
+        }
+        if (free_slot != NULL)
+            ioctl_ra_queue(ioctl, free_slot, sector + 1);
+    }
+
+    thread_release_mutex(ioctl->ra_mutex);
+
+    return (hit != NULL);
+}
+
+/* Drop the read-ahead chunks, once the medium may have changed. */
+static void
+ioctl_ra_flush(ioctl_t *ioctl)
+{
+    if (ioctl->ra_thread == NULL)
+        return;
+
+    thread_wait_mutex(ioctl->ra_mutex);
+    ioctl->ra_gen++;
+    ioctl->ra_failed = 0;
+    for (int i = 0; i < 2; i++)
+        ioctl->ra_slot[i].count = 0;
+    thread_release_mutex(ioctl->ra_mutex);
+}
+
 static int
 ioctl_read_sector(const void *local, uint8_t *buffer, uint32_t const sector)
 {
@@ -367,10 +612,13 @@ ioctl_read_sector(const void *local, uint8_t *buffer, uint32_t const sector)
     int                          s         = 0;
     int                          f         = 0;
     uint32_t                     lba       = sector;
+    const int                    cached    = (sector != 0xffffffff) &&
+                                             ioctl_ra_read((ioctl_t *) ioctl, buffer, sector);
     int                          ret;
     SCSI_PASS_THROUGH_DIRECT_BUF req;
 
-    ioctl_open_handle((ioctl_t *) ioctl);
+    if (!cached)
+        ioctl_open_handle((ioctl_t *) ioctl);
 
     if (ioctl->is_dvd) {
         int                          track;
@@ -390,7 +638,10 @@ ioctl_read_sector(const void *local, uint8_t *buffer, uint32_t const sector)
             len                           = COOKED_SECTOR_SIZE;
             track                         = ioctl_get_track(ioctl, lba);
 
-            if (track != -1) {
+            if (cached) {
+                req.spt.DataTransferLength    = len;
+                ret                           = (track != -1);
+            } else if (track != -1) {
                 DWORD newPos = SetFilePointer(ioctl->handle, (long) lba * COOKED_SECTOR_SIZE,
                                               0, FILE_BEGIN);
 
@@ -437,6 +688,10 @@ ioctl_read_sector(const void *local, uint8_t *buffer, uint32_t const sector)
             buffer[sc_offs + 8] = bin2bcd(s);
             buffer[sc_offs + 9] = bin2bcd(f);
         }
+    } else if (cached) {
+        memset(&req, 0x00, sizeof(SCSI_PASS_THROUGH_DIRECT_BUF));
+        req.spt.DataTransferLength    = len;
+        ret                           = 1;
     } else {
         memset(&req, 0x00, sizeof(SCSI_PASS_THROUGH_DIRECT_BUF));
         req.spt.Length                = sizeof(SCSI_PASS_THROUGH_DIRECT);
@@ -503,7 +758,8 @@ ioctl_read_sector(const void *local, uint8_t *buffer, uint32_t const sector)
              for (int j = 7; j >= 0; j--)
                   buffer[2352 + (i * 8) + j] = ((buffer[sc_offs + i] >> (7 - j)) & 0x01) << 6;
 
-    ioctl_close_handle((ioctl_t *) ioctl);
+    if (!cached)
+        ioctl_close_handle((ioctl_t *) ioctl);
 
     return ret;
 }
@@ -741,6 +997,21 @@ ioctl_close(void *local)
 {
     ioctl_t *ioctl = (ioctl_t *) local;
 
+    if (ioctl->ra_thread != NULL) {
+        ioctl->ra_quit = 1;
+        thread_set_event(ioctl->ra_wake);
+        thread_wait(ioctl->ra_thread);
+        ioctl->ra_thread = NULL;
+
+        thread_destroy_event(ioctl->ra_wake);
+        thread_destroy_event(ioctl->ra_done);
+        thread_close_mutex(ioctl->ra_mutex);
+    }
+    for (int i = 0; i < 2; i++) {
+        free(ioctl->ra_slot[i].data);
+        ioctl->ra_slot[i].data = NULL;
+    }
+
     ioctl_close_handle(ioctl);
     ioctl->handle = NULL;
 
@@ -763,6 +1034,8 @@ ioctl_load(const void *local)
         ioctl_close_handle((ioctl_t *) ioctl);
 
         ioctl_read_toc((ioctl_t *) ioctl);
+        ((ioctl_t *) ioctl)->last_block = ioctl_get_last_block(ioctl);
+        ioctl_ra_flush((ioctl_t *) ioctl);
     }
 }
 
@@ -778,7 +1051,8 @@ static const cdrom_ops_t ioctl_ops = {
     ioctl_has_audio,
     ioctl_is_empty,
     ioctl_close,
-    ioctl_load
+    ioctl_load,
+    NULL
 };
 
 /* Public functions. */
@@ -802,6 +1076,15 @@ ioctl_open(cdrom_t *dev, const char *drv)
 
         dev->ops            = &ioctl_ops;
 
+        ioctl->ra_slot[0].data = (uint8_t *) malloc(IOCTL_RA_BUF_SIZE);
+        ioctl->ra_slot[1].data = (uint8_t *) malloc(IOCTL_RA_BUF_SIZE);
+        if ((ioctl->ra_slot[0].data != NULL) && (ioctl->ra_slot[1].data != NULL)) {
+            ioctl->ra_wake   = thread_create_event();
+            ioctl->ra_done   = thread_create_event();
+            ioctl->ra_mutex  = thread_create_mutex();
+            ioctl->ra_thread = thread_create(ioctl_ra_thread, ioctl);
+        }
+
         ioctl_load(ioctl);
     }
 
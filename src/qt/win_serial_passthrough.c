@@ -56,7 +56,7 @@ plat_serpt_close(void *priv)
 }
 
 static void
-plat_serpt_write_vcon(serial_passthrough_t *dev, uint8_t data)
+plat_serpt_write_vcon(serial_passthrough_t *dev, const uint8_t *data, int len)
 {
 #if 0
     fd_set wrfds;
@@ -79,7 +79,7 @@ plat_serpt_write_vcon(serial_passthrough_t *dev, uint8_t data)
     fwrite(dev->master_fd, &data, 1);
 #endif
     DWORD bytesWritten = 0;
-    WriteFile((HANDLE) dev->master_fd, &data, 1, &bytesWritten, NULL);
+    WriteFile((HANDLE) dev->master_fd, data, len, &bytesWritten, NULL);
 }
 
 void
@@ -128,30 +128,34 @@ plat_serpt_set_params(void *priv)
 }
 
 void
-plat_serpt_write(void *priv, uint8_t data)
+plat_serpt_write(void *priv, const uint8_t *data, int len)
 {
     serial_passthrough_t *dev = (serial_passthrough_t *) priv;
 
     switch (dev->mode) {
         case SERPT_MODE_VCON:
         case SERPT_MODE_HOSTSER:
-            plat_serpt_write_vcon(dev, data);
+            plat_serpt_write_vcon(dev, data, len);
             break;
         default:
             break;
     }
 }
 
-uint8_t
-plat_serpt_read_vcon(serial_passthrough_t *dev, uint8_t *data)
+static int
+plat_serpt_read_vcon(serial_passthrough_t *dev, uint8_t *data, int len)
 {
     DWORD bytesRead = 0;
-    ReadFile((HANDLE) dev->master_fd, data, 1, &bytesRead, NULL);
-    return !!bytesRead;
+
+    /* The pipe is in PIPE_NOWAIT mode and the port has a zero read timeout,
+       so this returns at once with whatever is there. */
+    if (!ReadFile((HANDLE) dev->master_fd, data, len, &bytesRead, NULL))
+        return 0;
+    return (int) bytesRead;
 }
 
 int
-plat_serpt_read(void *priv, uint8_t *data)
+plat_serpt_read(void *priv, uint8_t *data, int len)
 {
     serial_passthrough_t *dev = (serial_passthrough_t *) priv;
     int                   res = 0;
@@ -159,7 +163,7 @@ plat_serpt_read(void *priv, uint8_t *data)
     switch (dev->mode) {
         case SERPT_MODE_VCON:
         case SERPT_MODE_HOSTSER:
-            res = plat_serpt_read_vcon(dev, data);
+            res = plat_serpt_read_vcon(dev, data, len);
             break;
         default:
             break;
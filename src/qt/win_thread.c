@@ -22,6 +22,7 @@
 #include <windowsx.h>
 #include <process.h>
 #undef BITMAP
+#include <stdarg.h>
 #include <stdio.h>
 #include <stdint.h>
 #include <string.h>
@@ -30,19 +31,48 @@
 #include <86box/86box.h>
 #include <86box/plat.h>
 #include <86box/thread.h>
+#include <86box/log.h>
 
 typedef struct {
     HANDLE handle;
 } win_event_t;
 
+typedef struct {
+    void (*func)(void *param);
+    void *param;
+    int   role;
+} win_thread_param_t;
+
+static void
+thread_run_wrapper(void *arg)
+{
+    win_thread_param_t p = *((win_thread_param_t *) arg);
+
+    free(arg);
+    thread_role_apply(p.role);
+    p.func(p.param);
+    log_thread_exit();
+}
+
 /* For compatibility with thread.h, but Win32 does not allow named threads. */
 thread_t *
-thread_create_named(void (*func)(void *param), void *param, UNUSED(const char *name))
+thread_create_named(void (*func)(void *param), void *param, UNUSED(const char *name), int role)
 {
-    uintptr_t bt = _beginthread(func, 0, param);
+    win_thread_param_t *p = malloc(sizeof(win_thread_param_t));
+    uintptr_t           bt;
+
+    p->func  = func;
+    p->param = param;
+    p->role  = role;
+
+    bt = _beginthread(thread_run_wrapper, 0, p);
+    if (bt == (uintptr_t) -1L)
+        free(p);
+
     return ((thread_t *) bt);
 }
 
+#ifndef USE_FAST_SYNC
 int
 thread_test_mutex(thread_t *arg)
 {
@@ -51,6 +81,7 @@ thread_test_mutex(thread_t *arg)
 
     return (WaitForSingleObject(arg, 0) == WAIT_OBJECT_0) ? 1 : 0;
 }
+#endif
 
 int
 thread_wait(thread_t *arg)
@@ -64,6 +95,7 @@ thread_wait(thread_t *arg)
     return (0);
 }
 
+#ifndef USE_FAST_SYNC
 event_t *
 thread_create_event(void)
 {
@@ -177,3 +209,4 @@ thread_close_mutex(mutex_t *mutex)
 
     free(critsec);
 }
+#endif
@@ -0,0 +1,453 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Deterministic record and replay.
+ *
+ *          The recording is a header, and then records in the order
+ *          they were made, all of them by the emulation thread. Playing
+ *          it back reads one record ahead, and every place that made a
+ *          record asks for it again when it gets there. If the machine
+ *          gets somewhere the recording has no record for, or is past
+ *          the time of the next one, the two have diverged, and the rest
+ *          of the run goes on with what the host has to offer.
+ */
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <wchar.h>
+#define HAVE_STDARG_H
+#include <86box/86box.h>
+#include "cpu.h"
+#include <86box/timer.h>
+#include <86box/machine.h>
+#include <86box/keyboard.h>
+#include <86box/mouse.h>
+#include <86box/plat.h>
+#include <86box/thread.h>
+#include <86box/video.h>
+#include <86box/replay.h>
+
+#define REPLAY_MAGIC        "86BoxRPL"
+#define REPLAY_VERSION      1
+#define REPLAY_KEYS         256 /* Keystrokes the UI can queue between two slices. */
+#define REPLAY_CHECK_SLICES 100
+
+typedef struct replay_header_t {
+    char     magic[8];
+    uint32_t version;
+    char     machine[64];
+} replay_header_t;
+
+typedef struct replay_rec_t {
+    uint64_t t; /* Emulated time, in TSC ticks since the machine was started. */
+    uint16_t type;
+    uint16_t len; /* Of the data that follows. */
+    uint32_t pad;
+} replay_rec_t;
+
+typedef struct replay_key_t {
+    uint16_t scan;
+    uint8_t  down;
+    uint8_t  captured;
+} replay_key_t;
+
+int replay_mode = REPLAY_OFF;
+
+static int      replay_req_mode = REPLAY_OFF;
+static char     replay_fn[1024];
+static FILE    *replay_fp    = NULL;
+static int64_t  replay_start = 0;  /* Of the first record. */
+static uint64_t replay_epoch = 0;  /* Emulated time before the last hard reset. */
+static int      replay_last_slice;
+static uint32_t replay_slices;
+
+static mouse_replay_t replay_mouse_last;
+
+/* The record read ahead while playing. */
+static replay_rec_t replay_next;
+static int          replay_have = 0;
+static uint8_t      replay_buf[65536];
+
+static mutex_t     *replay_key_lock = NULL;
+static replay_key_t replay_keys[REPLAY_KEYS];
+static int          replay_keys_num = 0;
+
+#ifdef ENABLE_REPLAY_LOG
+int replay_do_log = ENABLE_REPLAY_LOG;
+
+static void
+replay_log(const char *fmt, ...)
+{
+    va_list ap;
+
+    if (replay_do_log) {
+        va_start(ap, fmt);
+        pclog_ex(fmt, ap);
+        va_end(ap);
+    }
+}
+#else
+#    define replay_log(fmt, ...)
+#endif
+
+static uint64_t
+replay_now(void)
+{
+    return replay_epoch + tsc;
+}
+
+static double
+replay_ms(uint64_t t)
+{
+    return (cpuclock > 0.0) ? ((double) t * 1000.0 / cpuclock) : 0.0;
+}
+
+/* Ends the recording or playback, the machine goes on with the host's input. */
+static void
+replay_stop(const char *why)
+{
+    if (replay_mode == REPLAY_OFF)
+        return;
+
+    pclog("Replay: %s at %.3f ms of emulated time\n", why, replay_ms(replay_now()));
+
+    replay_mode = REPLAY_OFF;
+    replay_have = 0;
+    fclose(replay_fp);
+    replay_fp = NULL;
+}
+
+static void
+replay_read_next(void)
+{
+    replay_have = (fread(&replay_next, sizeof(replay_next), 1, replay_fp) == 1) &&
+                  (fread(replay_buf, 1, replay_next.len, replay_fp) == replay_next.len);
+}
+
+void
+replay_put(int type, const void *data, int len)
+{
+    replay_rec_t rec = { 0 };
+
+    if (replay_mode != REPLAY_RECORD)
+        return;
+
+    rec.t    = replay_now();
+    rec.type = (uint16_t) type;
+    rec.len  = (uint16_t) len;
+
+    if ((fwrite(&rec, sizeof(rec), 1, replay_fp) != 1) ||
+        (len && (fwrite(data, 1, len, replay_fp) != (size_t) len)))
+        replay_stop("could not write the recording, stopped");
+}
+
+int
+replay_get(int type, void *data, int len)
+{
+    uint64_t now = replay_now();
+
+    if (replay_mode != REPLAY_PLAY)
+        return -1;
+
+    if (!replay_have) {
+        replay_stop("reached the end of the recording");
+        return -1;
+    }
+
+    if (replay_next.t < now) {
+        replay_log("Replay: record %02X due at %" PRIu64 ", now %" PRIu64 "\n", replay_next.type, replay_next.t, now);
+        replay_stop("diverged from the recording");
+        return -1;
+    }
+
+    if ((replay_next.t != now) || (replay_next.type != type))
+        return -1;
+
+    len = (replay_next.len < len) ? replay_next.len : len;
+    if (len)
+        memcpy(data, replay_buf, len);
+    len = replay_next.len;
+
+    replay_read_next();
+
+    return len;
+}
+
+uint64_t
+replay_clock(uint64_t host)
+{
+    uint64_t val = host;
+
+    if (replay_mode == REPLAY_RECORD)
+        replay_put(REPLAY_CLOCK, &host, sizeof(host));
+    else if ((replay_mode == REPLAY_PLAY) && (replay_get(REPLAY_CLOCK, &val, sizeof(val)) < 0)) {
+        /* Diverged, so the host's it is. */
+        val = host;
+    }
+
+    return val;
+}
+
+/* Called by the UI thread. */
+void
+replay_key(int down, uint16_t scan, int captured)
+{
+    /* Playing back, the recorded ones are used instead. */
+    if (replay_mode != REPLAY_RECORD)
+        return;
+
+    thread_wait_mutex(replay_key_lock);
+    if (replay_keys_num < REPLAY_KEYS) {
+        replay_keys[replay_keys_num].scan     = scan;
+        replay_keys[replay_keys_num].down     = !!down;
+        replay_keys[replay_keys_num].captured = !!captured;
+        replay_keys_num++;
+    }
+    thread_release_mutex(replay_key_lock);
+}
+
+static void
+replay_key_apply(const replay_key_t *k)
+{
+    if (k->scan == REPLAY_KEY_ALL_UP)
+        keyboard_all_up_emu();
+    else
+        keyboard_input_emu(k->down, k->scan, k->captured);
+}
+
+static uint32_t
+replay_cpu_hash(void)
+{
+    uint32_t h = 2166136261U;
+
+#define REPLAY_HASH(v) h = (h ^ (uint32_t) (v)) * 16777619U
+    for (int i = 0; i < 8; i++)
+        REPLAY_HASH(cpu_state.regs[i].l);
+    REPLAY_HASH(cpu_state.pc);
+    REPLAY_HASH(cpu_state.flags);
+    REPLAY_HASH(cpu_state.eflags);
+    REPLAY_HASH(cpu_state.seg_cs.base);
+#undef REPLAY_HASH
+
+    return h;
+}
+
+static void
+replay_record_slice(int *slice)
+{
+    replay_key_t   keys[REPLAY_KEYS];
+    mouse_replay_t ev;
+    uint32_t       hash;
+    int            num;
+    int32_t        len = *slice;
+
+    if (len != replay_last_slice) {
+        replay_put(REPLAY_SLICE, &len, sizeof(len));
+        replay_last_slice = len;
+    }
+
+    if (hard_reset_pending)
+        replay_put(REPLAY_RESET, NULL, 0);
+
+    thread_wait_mutex(replay_key_lock);
+    num = replay_keys_num;
+    memcpy(keys, replay_keys, num * sizeof(replay_key_t));
+    replay_keys_num = 0;
+    thread_release_mutex(replay_key_lock);
+
+    for (int i = 0; i < num; i++) {
+        replay_put(REPLAY_KEY, &keys[i], sizeof(replay_key_t));
+        replay_key_apply(&keys[i]);
+    }
+
+    mouse_replay_take(&ev);
+    if ((ev.x != 0.0) || (ev.y != 0.0) || ev.z || ev.pressed ||
+        (ev.buttons != replay_mouse_last.buttons) ||
+        (ev.x_abs != replay_mouse_last.x_abs) || (ev.y_abs != replay_mouse_last.y_abs)) {
+        replay_put(REPLAY_MOUSE, &ev, sizeof(ev));
+        replay_mouse_last = ev;
+    }
+    mouse_replay_apply(&ev);
+
+    if ((++replay_slices % REPLAY_CHECK_SLICES) == 0) {
+        hash = replay_cpu_hash();
+        replay_put(REPLAY_CHECK, &hash, sizeof(hash));
+    }
+}
+
+static void
+replay_play_slice(int *slice)
+{
+    replay_key_t   k;
+    mouse_replay_t ev;
+    uint32_t       hash;
+    int32_t        len;
+
+    /* Leftover host input, none of it was there when the recording was made. */
+    thread_wait_mutex(replay_key_lock);
+    replay_keys_num = 0;
+    thread_release_mutex(replay_key_lock);
+    mouse_replay_take(&ev);
+
+    /* Not the snapshot the playback started from, if any. */
+    while (replay_get(REPLAY_MARK, NULL, 0) >= 0)
+        replay_slices = 0;
+
+    if (replay_get(REPLAY_SLICE, &len, sizeof(len)) == sizeof(len))
+        replay_last_slice = len;
+    if ((replay_mode == REPLAY_PLAY) && (replay_last_slice > 0))
+        *slice = replay_last_slice;
+
+    hard_reset_pending = (replay_get(REPLAY_RESET, NULL, 0) >= 0) ? 1 : 0;
+
+    while (replay_get(REPLAY_KEY, &k, sizeof(k)) == sizeof(k))
+        replay_key_apply(&k);
+
+    if (replay_get(REPLAY_MOUSE, &ev, sizeof(ev)) == sizeof(ev))
+        replay_mouse_last = ev;
+    else {
+        memset(&ev, 0x00, sizeof(ev));
+        ev.buttons = replay_mouse_last.buttons;
+        ev.x_abs   = replay_mouse_last.x_abs;
+        ev.y_abs   = replay_mouse_last.y_abs;
+    }
+    mouse_replay_apply(&ev);
+
+    if ((++replay_slices % REPLAY_CHECK_SLICES) == 0) {
+        if ((replay_get(REPLAY_CHECK, &hash, sizeof(hash)) != sizeof(hash)) || (hash != replay_cpu_hash()))
+            replay_stop("diverged from the recording");
+    }
+}
+
+void
+replay_slice(int *slice)
+{
+    if (replay_mode == REPLAY_RECORD)
+        replay_record_slice(slice);
+    else if (replay_mode == REPLAY_PLAY)
+        replay_play_slice(slice);
+}
+
+/* The TSC starts over, and the emulated time goes on from where it was. */
+void
+replay_reset(void)
+{
+    replay_epoch += tsc;
+}
+
+/* Looks for the mark of the snapshot, and continues playing from there. */
+static void
+replay_seek(uint64_t id)
+{
+    uint64_t mark;
+
+    fseeko64(replay_fp, replay_start, SEEK_SET);
+
+    while (1) {
+        replay_read_next();
+        if (!replay_have) {
+            replay_stop("found no mark of the snapshot in the recording, stopped");
+            return;
+        }
+
+        memcpy(&mark, replay_buf, sizeof(mark));
+        if ((replay_next.type == REPLAY_MARK) && (replay_next.len == sizeof(mark)) && (mark == id))
+            break;
+    }
+
+    /* The snapshot brought the TSC along relative to a machine reset since. */
+    replay_epoch = replay_next.t - tsc;
+
+    /* Where the records were counted from. */
+    replay_slices = 0;
+    replay_read_next();
+
+    pclog("Replay: continuing from the snapshot at %.3f ms of emulated time\n", replay_ms(replay_now()));
+}
+
+void
+replay_snapshot(uint64_t id, int load)
+{
+    if (replay_mode == REPLAY_RECORD) {
+        replay_put(REPLAY_MARK, &id, sizeof(id));
+        replay_slices = 0;
+    } else if ((replay_mode == REPLAY_PLAY) && load)
+        replay_seek(id);
+}
+
+void
+replay_request(const char *fn, int mode)
+{
+    strncpy(replay_fn, fn, sizeof(replay_fn) - 1);
+    replay_req_mode = mode;
+}
+
+void
+replay_init(void)
+{
+    replay_header_t hdr;
+    replay_header_t cur;
+
+    if (replay_req_mode == REPLAY_OFF)
+        return;
+
+    memset(&cur, 0x00, sizeof(cur));
+    memcpy(cur.magic, REPLAY_MAGIC, sizeof(cur.magic));
+    cur.version = REPLAY_VERSION;
+    strncpy(cur.machine, machine_get_internal_name(), sizeof(cur.machine) - 1);
+
+    replay_fp = plat_fopen64(replay_fn, (replay_req_mode == REPLAY_RECORD) ? "wb" : "rb");
+    if (replay_fp == NULL) {
+        pclog("Replay: could not open \"%s\"\n", replay_fn);
+        return;
+    }
+
+    if (replay_req_mode == REPLAY_RECORD) {
+        if (fwrite(&cur, sizeof(cur), 1, replay_fp) != 1) {
+            pclog("Replay: could not write \"%s\"\n", replay_fn);
+            fclose(replay_fp);
+            replay_fp = NULL;
+            return;
+        }
+    } else if ((fread(&hdr, sizeof(hdr), 1, replay_fp) != 1) ||
+               memcmp(hdr.magic, cur.magic, sizeof(cur.magic)) || (hdr.version != cur.version) ||
+               strncmp(hdr.machine, cur.machine, sizeof(cur.machine))) {
+        pclog("Replay: \"%s\" is not a recording of this machine\n", replay_fn);
+        fclose(replay_fp);
+        replay_fp = NULL;
+        return;
+    }
+
+    if (replay_key_lock == NULL)
+        replay_key_lock = thread_create_mutex();
+
+    replay_start      = ftello64(replay_fp);
+    replay_epoch      = 0;
+    replay_last_slice = 0;
+    replay_slices     = 0;
+    replay_keys_num   = 0;
+    memset(&replay_mouse_last, 0x00, sizeof(replay_mouse_last));
+
+    replay_mode = replay_req_mode;
+    if (replay_mode == REPLAY_PLAY)
+        replay_read_next();
+
+    pclog("Replay: %s \"%s\"\n", (replay_mode == REPLAY_RECORD) ? "recording to" : "playing back", replay_fn);
+}
+
+void
+replay_close(void)
+{
+    if (replay_mode == REPLAY_RECORD)
+        replay_stop("recording ended");
+    else if (replay_mode == REPLAY_PLAY)
+        replay_stop("playback ended");
+}
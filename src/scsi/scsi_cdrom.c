@@ -270,8 +270,11 @@ scsi_cdrom_log(void *priv, const char *format, ...)
 #endif
 
 static void
-scsi_cdrom_set_callback(const scsi_cdrom_t *dev)
+scsi_cdrom_set_callback(scsi_cdrom_t *dev)
 {
+    if (dev && dev->drv && dev->drv->instant && (dev->callback > SCSI_INSTANT_TIME))
+        dev->callback = SCSI_INSTANT_TIME;
+
     if (dev && dev->drv && (dev->drv->bus_type != CDROM_BUS_SCSI))
         ide_set_callback(ide_drives[dev->drv->ide_channel], dev->callback);
 }
@@ -1090,13 +1093,24 @@ scsi_cdrom_read_data(scsi_cdrom_t *dev, const int msf, const int type, const int
             ret = -1;
         } else {
             int      data_pos = 0;
+            int      i        = 0;
 
             dev->old_len = 0;
             *len         = 0;
 
             ret = 1;
 
-            for (int i = 0; i < dev->requested_blocks; i++) {
+            /* Plain Mode 1 data reads come from the media in one go. */
+            if (!msf && !vendor_type) {
+                i = cdrom_read_data_sectors(dev->drv, dev->buffer, dev->sector_pos,
+                                            dev->requested_blocks, type, flags);
+
+                data_pos     = i * COOKED_SECTOR_SIZE;
+                dev->old_len = data_pos;
+                *len         = data_pos;
+            }
+
+            for (; i < dev->requested_blocks; i++) {
                 ret = cdrom_readsector_raw(dev->drv, dev->buffer + data_pos,
                                            dev->sector_pos + i, msf, type,
                                            flags, &temp_len, vendor_type);
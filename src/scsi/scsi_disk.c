@@ -69,8 +69,10 @@ const uint8_t scsi_disk_command_flags[0x100] = {
     [0x2e]          = IMPLEMENTED | CHECK_READY,
     [0x2f]          = IMPLEMENTED | CHECK_READY | SCSI_ONLY,
     [0x41]          = IMPLEMENTED | CHECK_READY,
+    [0x42]          = IMPLEMENTED | CHECK_READY,
     [0x55]          = IMPLEMENTED,
     [0x5a]          = IMPLEMENTED,
+    [0x9e]          = IMPLEMENTED | CHECK_READY,
     [0xa8]          = IMPLEMENTED | CHECK_READY,
     [0xaa]          = IMPLEMENTED | CHECK_READY,
     [0xae]          = IMPLEMENTED | CHECK_READY,
@@ -106,6 +108,10 @@ static const mode_sense_pages_t scsi_disk_mode_sense_pages_changeable = {
 };
 // clang-format on
 
+/* Limits reported in the Block Limits VPD page. */
+#define SCSI_DISK_UNMAP_MAX_LBAS 0x00400000
+#define SCSI_DISK_UNMAP_MAX_DESC 32
+
 static void scsi_disk_command_complete(scsi_disk_t *dev);
 
 static void scsi_disk_mode_sense_load(scsi_disk_t *dev);
@@ -130,9 +136,23 @@ scsi_disk_log(void *priv, const char *fmt, ...)
 #    define scsi_disk_log(priv, fmt, ...)
 #endif
 
+static int
+scsi_disk_buf_is_zero(const uint8_t *buf, int len)
+{
+    for (int i = 0; i < len; i++) {
+        if (buf[i])
+            return 0;
+    }
+
+    return 1;
+}
+
 static void
-scsi_disk_set_callback(const scsi_disk_t *dev)
+scsi_disk_set_callback(scsi_disk_t *dev)
 {
+    if (dev->drv->instant && (dev->callback > SCSI_INSTANT_TIME))
+        dev->callback = SCSI_INSTANT_TIME;
+
     if (dev->drv->bus_type != HDD_BUS_SCSI)
         ide_set_callback(ide_drives[dev->drv->ide_channel], dev->callback);
 }
@@ -1209,6 +1229,31 @@ scsi_disk_command(scsi_common_t *sc, const uint8_t *cdb)
             }
             break;
 
+        case GPCMD_UNMAP:
+            if (!dev->drv->trim) {
+                scsi_disk_illegal_opcode(dev, cdb[0]);
+                break;
+            }
+
+            len = (cdb[7] << 8) | cdb[8];
+            if (len > (8 + (16 * SCSI_DISK_UNMAP_MAX_DESC)))
+                len = 8 + (16 * SCSI_DISK_UNMAP_MAX_DESC);
+
+            if (len < 8) {
+                scsi_disk_set_phase(dev, SCSI_PHASE_STATUS);
+                dev->packet_status = PHASE_COMPLETE;
+                dev->callback      = 20.0 * SCSI_TIME;
+                scsi_disk_set_callback(dev);
+                break;
+            }
+
+            scsi_disk_set_phase(dev, SCSI_PHASE_DATA_OUT);
+            scsi_disk_buf_alloc(dev, len);
+            scsi_disk_set_buf_len(dev, BufLen, &len);
+            dev->total_length = len;
+            scsi_disk_data_command_finish(dev, len, len, len, 1);
+            break;
+
         case GPCMD_WRITE_SAME_10:
             alloc_length = 512;
 
@@ -1346,6 +1391,34 @@ scsi_disk_command(scsi_common_t *sc, const uint8_t *cdb)
                     case 0x00:
                         dev->temp_buffer[idx++] = 0x00;
                         dev->temp_buffer[idx++] = 0x83;
+                        if (dev->drv->trim) {
+                            dev->temp_buffer[idx++] = 0xb0;
+                            dev->temp_buffer[idx++] = 0xb2;
+                        }
+                        break;
+                    case 0xb0:
+                        if (!dev->drv->trim)
+                            goto invalid_page;
+
+                        /* Block Limits, only the unmap fields are filled in. */
+                        memset(&dev->temp_buffer[idx], 0x00, 0x3c);
+                        dev->temp_buffer[idx + 16] = (SCSI_DISK_UNMAP_MAX_LBAS >> 24) & 0xff;
+                        dev->temp_buffer[idx + 17] = (SCSI_DISK_UNMAP_MAX_LBAS >> 16) & 0xff;
+                        dev->temp_buffer[idx + 18] = (SCSI_DISK_UNMAP_MAX_LBAS >> 8) & 0xff;
+                        dev->temp_buffer[idx + 19] = SCSI_DISK_UNMAP_MAX_LBAS & 0xff;
+                        dev->temp_buffer[idx + 23] = SCSI_DISK_UNMAP_MAX_DESC;
+                        idx += 0x3c;
+                        break;
+                    case 0xb2:
+                        if (!dev->drv->trim)
+                            goto invalid_page;
+
+                        /* Logical Block Provisioning: UNMAP and WRITE SAME (10) with
+                           the UNMAP bit, unmapped blocks read back as zeroes. */
+                        dev->temp_buffer[idx++] = 0x00;
+                        dev->temp_buffer[idx++] = 0xa4;
+                        dev->temp_buffer[idx++] = 0x00;
+                        dev->temp_buffer[idx++] = 0x00;
                         break;
                     case 0x83:
                         if (idx + 24 > max_len) {
@@ -1379,6 +1452,7 @@ scsi_disk_command(scsi_common_t *sc, const uint8_t *cdb)
                         idx += 20;
                         break;
                     default:
+invalid_page:
                         scsi_disk_log(dev->log, "INQUIRY: Invalid page: %02X\n", cdb[2]);
                         scsi_disk_invalid_field(dev, cdb[2]);
                         scsi_disk_buf_free(dev);
@@ -1394,12 +1468,21 @@ scsi_disk_command(scsi_common_t *sc, const uint8_t *cdb)
                 else
                     dev->temp_buffer[0] = 0;       /* SCSI HD */
                 dev->temp_buffer[1] = 0;           /* Fixed */
-                /* SCSI-2 compliant */
-                dev->temp_buffer[2] = (dev->drv->bus_type == HDD_BUS_SCSI) ? 0x02 : 0x00;
+                /* SCSI-2 compliant, SPC-3 when reporting UNMAP as guests only
+                   look for it on those. */
+                if (dev->drv->trim)
+                    dev->temp_buffer[2] = 0x05;
+                else
+                    dev->temp_buffer[2] = (dev->drv->bus_type == HDD_BUS_SCSI) ? 0x02 : 0x00;
                 dev->temp_buffer[3] = (dev->drv->bus_type == HDD_BUS_SCSI) ? 0x02 : 0x21;
                 dev->temp_buffer[4] = 31;
                 dev->temp_buffer[6] = 1;           /* 16-bit transfers supported */
                 dev->temp_buffer[7] = 0x20;        /* Wide bus supported */
+                /* Tagged queuing. Commands still run one at a time and to
+                   completion without disconnecting, which also keeps the
+                   order any tag type asks for. */
+                if ((dev->drv->bus_type == HDD_BUS_SCSI) && dev->drv->tcq)
+                    dev->temp_buffer[7] |= 0x02;
 
                 /* Vendor */
                 ide_padstr8(dev->temp_buffer + 8, 8, EMU_NAME);
@@ -1477,6 +1560,35 @@ atapi_out:
             scsi_disk_data_command_finish(dev, len, len, len, 0);
             break;
 
+        case GPCMD_SERVICE_ACTION_IN_16:
+            /* Only READ CAPACITY (16), for the provisioning bits. */
+            if (((cdb[1] & 0x1f) != 0x10) || !dev->drv->trim) {
+                scsi_disk_invalid_field(dev, cdb[1]);
+                break;
+            }
+
+            max_len = (cdb[10] << 24) | (cdb[11] << 16) | (cdb[12] << 8) | cdb[13];
+
+            scsi_disk_buf_alloc(dev, 32);
+
+            memset(dev->temp_buffer, 0, 32);
+            dev->temp_buffer[4]  = (last_sector >> 24) & 0xff;
+            dev->temp_buffer[5]  = (last_sector >> 16) & 0xff;
+            dev->temp_buffer[6]  = (last_sector >> 8) & 0xff;
+            dev->temp_buffer[7]  = last_sector & 0xff;
+            dev->temp_buffer[10] = 2;
+            dev->temp_buffer[14] = 0xc0; /* LBPME, LBPRZ */
+            len                  = 32;
+
+            if (len > max_len)
+                len = max_len;
+
+            scsi_disk_set_buf_len(dev, BufLen, &len);
+
+            scsi_disk_set_phase(dev, SCSI_PHASE_DATA_IN);
+            scsi_disk_data_command_finish(dev, len, len, len, 0);
+            break;
+
         default:
             scsi_disk_illegal_opcode(dev, cdb[0]);
             break;
@@ -1543,6 +1655,13 @@ scsi_disk_phase_data_out(scsi_common_t *sc)
             else
                 last_to_write = dev->sector_pos + dev->sector_len - 1;
 
+            /* A block of zeroes, with or without the UNMAP bit. */
+            if (!(dev->current_cdb[1] & 6) && scsi_disk_buf_is_zero(dev->temp_buffer, 512)) {
+                if (hdd_image_zero_ex(dev->id, dev->sector_pos, last_to_write - dev->sector_pos + 1) < 0)
+                    scsi_disk_write_error(dev);
+                break;
+            }
+
             for (i = dev->sector_pos; i <= (int) last_to_write; i++) {
                 if (dev->current_cdb[1] & 2) {
                     dev->temp_buffer[0] = (i >> 24) & 0xff;
@@ -1566,6 +1685,36 @@ scsi_disk_phase_data_out(scsi_common_t *sc)
                     scsi_disk_write_error(dev);
             }
             break;
+        case GPCMD_UNMAP:
+            /* 8-byte header, then 16-byte descriptors of a 64-bit LBA and a
+               32-bit block count. */
+            for (pos = 8; (pos + 16) <= dev->total_length; pos += 16) {
+                const uint8_t *d     = &dev->temp_buffer[pos];
+                uint64_t       lba   = 0;
+                uint32_t       count = (d[8] << 24) | (d[9] << 16) | (d[10] << 8) | d[11];
+
+                for (i = 0; i < 8; i++)
+                    lba = (lba << 8) | d[i];
+
+                if (!count)
+                    continue;
+
+                if ((lba > last_sector) || (count > (last_sector - lba + 1))) {
+                    scsi_disk_lba_out_of_range(dev);
+                    error |= 1;
+                    break;
+                }
+
+                if (hdd_image_zero(dev->id, (uint32_t) lba, count) < 0) {
+                    scsi_disk_write_error(dev);
+                    error |= 1;
+                    break;
+                }
+            }
+
+            if (error)
+                scsi_disk_buf_free(dev);
+            break;
         case GPCMD_MODE_SELECT_6:
         case GPCMD_MODE_SELECT_10:
             if (dev->current_cdb[0] == GPCMD_MODE_SELECT_10) {
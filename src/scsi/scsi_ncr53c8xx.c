@@ -939,17 +939,20 @@ ncr53c8xx_do_msgout(ncr53c8xx_t *dev, uint8_t id)
                         return;
                 }
                 break;
+            /* The target never disconnects, so every tagged command
+               is done before the next one is taken and all three
+               queue types end up in the order they ask for. */
             case 0x20: /* SIMPLE queue */
                 id |= ncr53c8xx_get_msgbyte(dev) | NCR_TAG_VALID;
                 ncr53c8xx_log("SIMPLE queue tag=0x%x\n", id & 0xff);
                 break;
             case 0x21: /* HEAD of queue */
-                ncr53c8xx_log("HEAD queue not implemented\n");
                 id |= ncr53c8xx_get_msgbyte(dev) | NCR_TAG_VALID;
+                ncr53c8xx_log("HEAD queue tag=0x%x\n", id & 0xff);
                 break;
             case 0x22: /* ORDERED queue */
-                ncr53c8xx_log("ORDERED queue not implemented\n");
                 id |= ncr53c8xx_get_msgbyte(dev) | NCR_TAG_VALID;
+                ncr53c8xx_log("ORDERED queue tag=0x%x\n", id & 0xff);
                 break;
             case 0x0d:
                 /* The ABORT TAG message clears the current I/O process only. */
@@ -2721,7 +2724,7 @@ const device_t ncr53c815_pci_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    ncr53c8xx_pci_config
+    .config        = ncr53c8xx_pci_config
 };
 
 const device_t ncr53c820_pci_device = {
@@ -0,0 +1,968 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Machine snapshots.
+ *
+ *          The file is a header followed by chunks, each a four letter
+ *          ID and a length, so a reader can skip over what it does not
+ *          know. The CPU, PIC and DMA chunks come first, then one device
+ *          chunk per attached device, in the order the devices were
+ *          added, then RAM and an end chunk.
+ *
+ *          Most chunks are the emulator's own structures written out as
+ *          they are, so a snapshot is only loaded by the same build of
+ *          the emulator that saved it.
+ *
+ *          RAM is stored as runs of 4 KB pages, deflated unless they are
+ *          all zeroes. An incremental snapshot only has the pages written
+ *          since the snapshot before it, which it names as its parent,
+ *          and loading it loads the RAM of its parents first.
+ *
+ *          Saving pauses the guest only for as long as it takes to copy
+ *          the pages out, along with the state of everything else. The
+ *          file is then compressed and written by a thread, one snapshot
+ *          at a time.
+ */
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <wchar.h>
+#include <zlib.h>
+#define HAVE_STDARG_H
+#include <86box/86box.h>
+#include "cpu.h"
+#include "x86.h"
+#include "x86seg_common.h"
+#include "x87_sf.h"
+#include <86box/device.h>
+#include <86box/timer.h>
+#include <86box/mem.h>
+#include <86box/machine.h>
+#include <86box/kvm.h>
+#include <86box/nmi.h>
+#include <86box/pic.h>
+#include <86box/dma.h>
+#include <86box/nvr.h>
+#include <86box/plat.h>
+#include <86box/thread.h>
+#include <86box/version.h>
+#include <86box/snapshot.h>
+#include <86box/replay.h>
+
+#define SNAPSHOT_PAGE      4096
+#define SNAPSHOT_RUN_PAGES 16         /* Pages deflated together. */
+#define SNAPSHOT_RUN_ZERO  0          /* Run of zeroes. */
+#define SNAPSHOT_RUN_RAW   0xffffffff /* Run stored as it is. */
+#define SNAPSHOT_MAX_CHAIN 256        /* Parents followed by an incremental load. */
+
+#define SNAPSHOT_RAM_INCREMENTAL 1
+
+enum {
+    SNAPSHOT_OP_NONE = 0,
+    SNAPSHOT_OP_SAVE,
+    SNAPSHOT_OP_SAVE_INCREMENTAL,
+    SNAPSHOT_OP_LOAD
+};
+
+typedef struct snapshot_header_t {
+    char     magic[8];
+    uint32_t version;
+    char     emu_version[32];
+    char     machine[64];
+    char     cpu_family[64];
+    uint32_t cpu;
+    uint32_t mem_size;
+    uint64_t id; /* Lets an incremental snapshot check it has the right parent. */
+} snapshot_header_t;
+
+struct snapshot_t {
+    /* Saving, everything but RAM is gathered in memory. */
+    uint8_t *buf;
+    size_t   size;
+    size_t   alloc;
+    size_t   chunk; /* Offset of the data of the current chunk. */
+
+    /* Loading. */
+    FILE    *fp;
+    int64_t  start; /* Offset of the data of the current chunk. */
+    uint32_t len;
+    uint32_t left;  /* Bytes not yet read from the current chunk. */
+
+    int error;
+};
+
+/* A snapshot on its way to the disk. */
+typedef struct snapshot_job_t {
+    char              fn[1024];
+    char              parent[1024]; /* Empty for a full snapshot. */
+    uint64_t          parent_id;
+    snapshot_header_t hdr;
+    snapshot_t        state;
+    uint32_t          ram_size;
+    uint32_t          npages;
+    uint32_t         *page; /* The pages copied, in ascending order. */
+    uint8_t          *data;
+} snapshot_job_t;
+
+static const struct {
+    void  *ptr;
+    size_t size;
+} snapshot_cpu_vars[] = {
+    { &cpu_state,             sizeof(cpu_state)             },
+    { &fpu_state,             sizeof(fpu_state)             },
+    { &cr2,                   sizeof(cr2)                   },
+    { &cr3,                   sizeof(cr3)                   },
+    { &cr4,                   sizeof(cr4)                   },
+    { dr,                     sizeof(dr)                    },
+    { &gdt,                   sizeof(gdt)                   },
+    { &ldt,                   sizeof(ldt)                   },
+    { &idt,                   sizeof(idt)                   },
+    { &tr,                    sizeof(tr)                    },
+    { &msr,                   sizeof(msr)                   },
+    { &cyrix,                 sizeof(cyrix)                 },
+    { &ccr0,                  sizeof(ccr0)                  },
+    { &ccr1,                  sizeof(ccr1)                  },
+    { &ccr2,                  sizeof(ccr2)                  },
+    { &ccr3,                  sizeof(ccr3)                  },
+    { &ccr4,                  sizeof(ccr4)                  },
+    { &ccr5,                  sizeof(ccr5)                  },
+    { &ccr6,                  sizeof(ccr6)                  },
+    { &ccr7,                  sizeof(ccr7)                  },
+    { &cpu_cur_status,        sizeof(cpu_cur_status)        },
+    { &use32,                 sizeof(use32)                 },
+    { &stack32,               sizeof(stack32)               },
+    { &cgate32,               sizeof(cgate32)               },
+    { &trap,                  sizeof(trap)                  },
+    { &new_ne,                sizeof(new_ne)                },
+    { &smi_latched,           sizeof(smi_latched)           },
+    { &smm_in_hlt,            sizeof(smm_in_hlt)            },
+    { &smi_block,             sizeof(smi_block)             },
+    { &cpu_cache_int_enabled, sizeof(cpu_cache_int_enabled) },
+    { &nmi,                   sizeof(nmi)                   },
+    { &nmi_mask,              sizeof(nmi_mask)              },
+    { &rammask,               sizeof(rammask)               },
+    { &mem_a20_key,           sizeof(mem_a20_key)           },
+    { &mem_a20_alt,           sizeof(mem_a20_alt)           },
+    { &mem_a20_state,         sizeof(mem_a20_state)         }
+};
+
+static char       snapshot_fn[1024];
+static atomic_int snapshot_op = SNAPSHOT_OP_NONE;
+
+static thread_t         *snapshot_thread = NULL;
+static atomic_int        snapshot_written = 1; /* The last snapshot made it to the disk. */
+static mem_dirty_t      *snapshot_dirty   = NULL; /* Pages written since snapshot_last. */
+static char              snapshot_last[1024];    /* Last snapshot saved or loaded, or empty. */
+static snapshot_header_t snapshot_last_hdr;
+static uint64_t          snapshot_seq = 0;
+
+#ifdef ENABLE_SNAPSHOT_LOG
+int snapshot_do_log = ENABLE_SNAPSHOT_LOG;
+
+static void
+snapshot_log(const char *fmt, ...)
+{
+    va_list ap;
+
+    if (snapshot_do_log) {
+        va_start(ap, fmt);
+        pclog_ex(fmt, ap);
+        va_end(ap);
+    }
+}
+#else
+#    define snapshot_log(fmt, ...)
+#endif
+
+void
+snapshot_write(snapshot_t *s, const void *data, uint32_t len)
+{
+    uint8_t *buf;
+    size_t   alloc;
+
+    if (s->error || !len)
+        return;
+
+    if ((s->size + len) > s->alloc) {
+        alloc = MAX(s->alloc * 2, s->size + len + 65536);
+        buf   = (uint8_t *) realloc(s->buf, alloc);
+        if (buf == NULL) {
+            s->error = 1;
+            return;
+        }
+        s->buf   = buf;
+        s->alloc = alloc;
+    }
+
+    memcpy(&s->buf[s->size], data, len);
+    s->size += len;
+}
+
+void
+snapshot_write_timer(snapshot_t *s, pc_timer_t *timer)
+{
+    uint8_t  enabled = !!timer_is_enabled(timer);
+    uint8_t  split   = !!(timer->flags & TIMER_SPLIT);
+    uint64_t left    = timer_get_remaining_u64(timer);
+
+    snapshot_write(s, &enabled, sizeof(enabled));
+    snapshot_write(s, &split, sizeof(split));
+    snapshot_write(s, &left, sizeof(left));
+    snapshot_write(s, &timer->period, sizeof(timer->period));
+}
+
+int
+snapshot_read(snapshot_t *s, void *data, uint32_t len)
+{
+    if (s->error || (len > s->left) || (fread(data, 1, len, s->fp) != len)) {
+        s->error = 1;
+        return 0;
+    }
+
+    s->left -= len;
+
+    return 1;
+}
+
+int
+snapshot_read_timer(snapshot_t *s, pc_timer_t *timer)
+{
+    uint8_t  enabled;
+    uint8_t  split;
+    uint64_t left;
+    double   period;
+
+    if (!snapshot_read(s, &enabled, sizeof(enabled)) || !snapshot_read(s, &split, sizeof(split)) ||
+        !snapshot_read(s, &left, sizeof(left)) || !snapshot_read(s, &period, sizeof(period)))
+        return 0;
+
+    timer->period = period;
+    if (split)
+        timer->flags |= TIMER_SPLIT;
+    else
+        timer->flags &= ~TIMER_SPLIT;
+
+    if (enabled)
+        timer_set_delay_u64(timer, left);
+    else
+        timer_disable(timer);
+
+    return 1;
+}
+
+static void
+snapshot_begin(snapshot_t *s, const char *id)
+{
+    uint32_t len = 0;
+
+    snapshot_write(s, id, 4);
+    snapshot_write(s, &len, sizeof(len));
+    s->chunk = s->size;
+}
+
+/* Goes back to fill in the length of the chunk. */
+static void
+snapshot_end(snapshot_t *s)
+{
+    uint32_t len = (uint32_t) (s->size - s->chunk);
+
+    if (!s->error)
+        memcpy(&s->buf[s->chunk - sizeof(len)], &len, sizeof(len));
+}
+
+/* Moves on to the next chunk, whatever it is. */
+static int
+snapshot_next_any(snapshot_t *s, char *id)
+{
+    uint32_t len;
+
+    if (s->error || fseeko64(s->fp, s->start + s->len, SEEK_SET)) {
+        s->error = 1;
+        return 0;
+    }
+
+    s->left = 8;
+    if (!snapshot_read(s, id, 4) || !snapshot_read(s, &len, sizeof(len)))
+        return 0;
+
+    s->start = ftello64(s->fp);
+    s->len   = len;
+    s->left  = len;
+
+    return 1;
+}
+
+/* Moves on to the next chunk, which has to be the one asked for. */
+static int
+snapshot_next(snapshot_t *s, const char *id)
+{
+    char got[4];
+
+    if (!snapshot_next_any(s, got))
+        return 0;
+
+    if (memcmp(got, id, 4)) {
+        pclog("Snapshot: expected chunk \"%.4s\", found \"%.4s\"\n", id, got);
+        s->error = 1;
+        return 0;
+    }
+
+    return 1;
+}
+
+static uint8_t *
+snapshot_ram_ptr(uint32_t addr)
+{
+    if ((ram2 != NULL) && (addr >= (1UL << 30)))
+        return &ram2[addr - (1UL << 30)];
+
+    return &ram[addr];
+}
+
+static uint32_t
+snapshot_page_len(uint32_t size, uint32_t page)
+{
+    return MIN(size - (page * SNAPSHOT_PAGE), SNAPSHOT_PAGE);
+}
+
+static int
+snapshot_is_zero(const uint8_t *p, uint32_t len)
+{
+    const uint64_t *q = (const uint64_t *) p;
+
+    for (uint32_t i = 0; i < (len >> 3); i++) {
+        if (q[i])
+            return 0;
+    }
+
+    return 1;
+}
+
+static void
+snapshot_fwrite(FILE *fp, const void *data, size_t len, int *err)
+{
+    if (!*err && len && (fwrite(data, 1, len, fp) != len))
+        *err = 1;
+}
+
+/* Writes the copied pages out, in runs of consecutive ones. */
+static void
+snapshot_write_ram(snapshot_job_t *job, FILE *fp, int *err)
+{
+    uLongf   clen;
+    uint32_t run[3];
+    uint32_t flags = job->parent[0] ? SNAPSHOT_RAM_INCREMENTAL : 0;
+    uint32_t len;
+    uint32_t n;
+    uint8_t *cbuf  = (uint8_t *) malloc(compressBound(SNAPSHOT_RUN_PAGES * SNAPSHOT_PAGE));
+
+    if (cbuf == NULL) {
+        *err = 1;
+        return;
+    }
+
+    snapshot_fwrite(fp, &job->ram_size, sizeof(job->ram_size), err);
+    snapshot_fwrite(fp, &flags, sizeof(flags), err);
+    if (flags & SNAPSHOT_RAM_INCREMENTAL) {
+        len = (uint32_t) strlen(job->parent);
+        snapshot_fwrite(fp, &job->parent_id, sizeof(job->parent_id), err);
+        snapshot_fwrite(fp, &len, sizeof(len), err);
+        snapshot_fwrite(fp, job->parent, len, err);
+    }
+
+    for (uint32_t i = 0; (i < job->npages) && !*err; i += n) {
+        const uint8_t *data = &job->data[(size_t) i * SNAPSHOT_PAGE];
+
+        for (n = 1; ((i + n) < job->npages) && (n < SNAPSHOT_RUN_PAGES); n++) {
+            if (job->page[i + n] != (job->page[i] + n))
+                break;
+        }
+        len = n * SNAPSHOT_PAGE;
+
+        run[0] = job->page[i];
+        run[1] = n;
+        clen   = compressBound(len);
+        if (snapshot_is_zero(data, len)) {
+            run[2] = SNAPSHOT_RUN_ZERO;
+            snapshot_fwrite(fp, run, sizeof(run), err);
+        } else if ((compress2(cbuf, &clen, data, len, Z_BEST_SPEED) == Z_OK) && (clen < len)) {
+            run[2] = (uint32_t) clen;
+            snapshot_fwrite(fp, run, sizeof(run), err);
+            snapshot_fwrite(fp, cbuf, clen, err);
+        } else {
+            run[2] = SNAPSHOT_RUN_RAW;
+            snapshot_fwrite(fp, run, sizeof(run), err);
+            snapshot_fwrite(fp, data, len, err);
+        }
+    }
+
+    /* An empty run ends the list. */
+    memset(run, 0x00, sizeof(run));
+    snapshot_fwrite(fp, run, sizeof(run), err);
+
+    free(cbuf);
+}
+
+static void
+snapshot_job_free(snapshot_job_t *job)
+{
+    free(job->state.buf);
+    free(job->page);
+    free(job->data);
+    free(job);
+}
+
+static void
+snapshot_thread_func(void *priv)
+{
+    snapshot_job_t *job = (snapshot_job_t *) priv;
+    char            temp[1040];
+    FILE           *fp;
+    int64_t         start;
+    int64_t         end;
+    uint32_t        len = 0;
+    int             err = 0;
+
+    snprintf(temp, sizeof(temp), "%s.tmp", job->fn);
+
+    fp = plat_fopen(temp, "wb");
+    if (fp == NULL) {
+        pclog("Snapshot: unable to create \"%s\"\n", temp);
+        atomic_store(&snapshot_written, 0);
+        snapshot_job_free(job);
+        return;
+    }
+
+    snapshot_fwrite(fp, &job->hdr, sizeof(job->hdr), &err);
+    snapshot_fwrite(fp, job->state.buf, job->state.size, &err);
+
+    snapshot_fwrite(fp, "RAM ", 4, &err);
+    snapshot_fwrite(fp, &len, sizeof(len), &err);
+    start = ftello64(fp);
+    snapshot_write_ram(job, fp, &err);
+    end = ftello64(fp);
+    len = (uint32_t) (end - start);
+    if (!err && (fseeko64(fp, start - sizeof(len), SEEK_SET) || (fwrite(&len, 1, sizeof(len), fp) != sizeof(len)) ||
+                 fseeko64(fp, end, SEEK_SET)))
+        err = 1;
+
+    len = 0;
+    snapshot_fwrite(fp, "END ", 4, &err);
+    snapshot_fwrite(fp, &len, sizeof(len), &err);
+
+    if (fclose(fp))
+        err = 1;
+
+    if (err)
+        pclog("Snapshot: unable to write \"%s\"\n", temp);
+    else if (plat_rename(temp, job->fn)) {
+        pclog("Snapshot: unable to replace \"%s\"\n", job->fn);
+        err = 1;
+    }
+
+    if (err)
+        plat_remove(temp);
+    else
+        pclog("Snapshot: saved %u pages to \"%s\"\n", job->npages, job->fn);
+
+    atomic_store(&snapshot_written, !err);
+    snapshot_job_free(job);
+}
+
+/* Waits for the snapshot being written, if any. */
+static void
+snapshot_wait(void)
+{
+    if (snapshot_thread != NULL) {
+        thread_wait(snapshot_thread);
+        snapshot_thread = NULL;
+    }
+
+    /* The pages since the one before are gone with it, start over. */
+    if (!atomic_load(&snapshot_written)) {
+        snapshot_last[0] = '\0';
+        atomic_store(&snapshot_written, 1);
+    }
+}
+
+static void
+snapshot_save_cpu(snapshot_t *s)
+{
+    for (size_t i = 0; i < (sizeof(snapshot_cpu_vars) / sizeof(snapshot_cpu_vars[0])); i++)
+        snapshot_write(s, snapshot_cpu_vars[i].ptr, snapshot_cpu_vars[i].size);
+}
+
+static int
+snapshot_load_cpu(snapshot_t *s)
+{
+    for (size_t i = 0; i < (sizeof(snapshot_cpu_vars) / sizeof(snapshot_cpu_vars[0])); i++) {
+        if (!snapshot_read(s, snapshot_cpu_vars[i].ptr, snapshot_cpu_vars[i].size))
+            return 0;
+    }
+
+    /* Snapshots are taken between instructions, so nothing is in flight. */
+    cpu_state.ea_seg = &cpu_state.seg_ds;
+    cpu_state.abrt   = 0;
+
+    mem_a20_recalc();
+    cpu_update_waitstates();
+    flushmmucache();
+#ifdef USE_KVM
+    kvm_state_changed();
+#endif
+
+    return 1;
+}
+
+static const char *
+snapshot_device_name(const device_t *dev)
+{
+    return dev->internal_name ? dev->internal_name : dev->name;
+}
+
+static void
+snapshot_header(snapshot_header_t *hdr)
+{
+    memset(hdr, 0x00, sizeof(snapshot_header_t));
+    memcpy(hdr->magic, "86BoxSNP", 8);
+    hdr->version = SNAPSHOT_VERSION;
+    strncpy(hdr->emu_version, EMU_VERSION_FULL, sizeof(hdr->emu_version) - 1);
+    strncpy(hdr->machine, machine_get_internal_name(), sizeof(hdr->machine) - 1);
+    strncpy(hdr->cpu_family, cpu_f->internal_name, sizeof(hdr->cpu_family) - 1);
+    hdr->cpu      = cpu;
+    hdr->mem_size = mem_size;
+}
+
+/* Whether a snapshot with this header fits the machine as configured. */
+static int
+snapshot_header_matches(const snapshot_header_t *hdr, const snapshot_header_t *cur)
+{
+    return !memcmp(hdr->machine, cur->machine, sizeof(hdr->machine)) &&
+           !memcmp(hdr->cpu_family, cur->cpu_family, sizeof(hdr->cpu_family)) &&
+           (hdr->cpu == cur->cpu) && (hdr->mem_size == cur->mem_size);
+}
+
+static FILE *
+snapshot_open(const char *fn, snapshot_header_t *hdr)
+{
+    snapshot_header_t cur;
+    FILE             *fp = plat_fopen(fn, "rb");
+
+    if (fp == NULL) {
+        pclog("Snapshot: unable to open \"%s\"\n", fn);
+        return NULL;
+    }
+
+    snapshot_header(&cur);
+    if ((fread(hdr, 1, sizeof(snapshot_header_t), fp) != sizeof(snapshot_header_t)) ||
+        memcmp(hdr->magic, cur.magic, 8) || (hdr->version != cur.version) ||
+        memcmp(hdr->emu_version, cur.emu_version, sizeof(hdr->emu_version))) {
+        pclog("Snapshot: \"%s\" was not saved by this build\n", fn);
+        fclose(fp);
+        return NULL;
+    }
+
+    if (!snapshot_header_matches(hdr, &cur)) {
+        pclog("Snapshot: \"%s\" is of a different machine (%.64s)\n", fn, hdr->machine);
+        fclose(fp);
+        return NULL;
+    }
+
+    return fp;
+}
+
+static int snapshot_load_parent(const char *fn, uint64_t id, int depth);
+
+static int
+snapshot_load_ram(snapshot_t *s, int depth)
+{
+    uLongf   out;
+    uint32_t size;
+    uint32_t flags;
+    uint32_t len;
+    uint32_t run[3];
+    uint64_t parent_id;
+    char     parent[1024];
+    uint8_t *cbuf;
+    uint8_t *dbuf;
+
+    if (!snapshot_read(s, &size, sizeof(size)) || !snapshot_read(s, &flags, sizeof(flags)))
+        return 0;
+
+    if (size != (mem_size * 1024)) {
+        pclog("Snapshot: saved with %u KB of RAM\n", size >> 10);
+        return 0;
+    }
+
+    if (flags & SNAPSHOT_RAM_INCREMENTAL) {
+        if (!snapshot_read(s, &parent_id, sizeof(parent_id)) || !snapshot_read(s, &len, sizeof(len)) ||
+            (len >= sizeof(parent)) || !snapshot_read(s, parent, len))
+            return 0;
+        parent[len] = '\0';
+
+        if (depth >= SNAPSHOT_MAX_CHAIN) {
+            pclog("Snapshot: too many incremental snapshots in a row\n");
+            return 0;
+        }
+
+        if (!snapshot_load_parent(parent, parent_id, depth + 1))
+            return 0;
+    }
+
+    cbuf = (uint8_t *) malloc(compressBound(SNAPSHOT_RUN_PAGES * SNAPSHOT_PAGE));
+    dbuf = (uint8_t *) malloc(SNAPSHOT_RUN_PAGES * SNAPSHOT_PAGE);
+    if ((cbuf == NULL) || (dbuf == NULL)) {
+        free(cbuf);
+        free(dbuf);
+        return 0;
+    }
+
+    while (snapshot_read(s, run, sizeof(run)) && run[1]) {
+        len = run[1] * SNAPSHOT_PAGE;
+
+        if ((run[1] > SNAPSHOT_RUN_PAGES) || (run[0] >= ((size + SNAPSHOT_PAGE - 1) / SNAPSHOT_PAGE)) ||
+            ((run[0] + run[1]) > ((size + SNAPSHOT_PAGE - 1) / SNAPSHOT_PAGE))) {
+            s->error = 1;
+            break;
+        }
+
+        if (run[2] == SNAPSHOT_RUN_ZERO)
+            memset(dbuf, 0x00, len);
+        else if (run[2] == SNAPSHOT_RUN_RAW) {
+            if (!snapshot_read(s, dbuf, len))
+                break;
+        } else {
+            out = len;
+            if ((run[2] > compressBound(len)) || !snapshot_read(s, cbuf, run[2]) ||
+                (uncompress(dbuf, &out, cbuf, run[2]) != Z_OK) || (out != len)) {
+                s->error = 1;
+                break;
+            }
+        }
+
+        for (uint32_t i = 0; i < run[1]; i++)
+            memcpy(snapshot_ram_ptr((run[0] + i) * SNAPSHOT_PAGE), &dbuf[i * SNAPSHOT_PAGE],
+                   snapshot_page_len(size, run[0] + i));
+    }
+
+    free(cbuf);
+    free(dbuf);
+
+    return !s->error;
+}
+
+/* Loads just the RAM of the snapshot an incremental one was based on. */
+static int
+snapshot_load_parent(const char *fn, uint64_t id, int depth)
+{
+    snapshot_header_t hdr;
+    snapshot_t        s;
+    char              got[4];
+    int               ret;
+
+    memset(&s, 0x00, sizeof(snapshot_t));
+    s.fp = snapshot_open(fn, &hdr);
+    if (s.fp == NULL)
+        return 0;
+
+    if (hdr.id != id) {
+        pclog("Snapshot: \"%s\" has been replaced since\n", fn);
+        fclose(s.fp);
+        return 0;
+    }
+
+    s.start = ftello64(s.fp);
+    do {
+        ret = snapshot_next_any(&s, got);
+    } while (ret && memcmp(got, "RAM ", 4) && memcmp(got, "END ", 4));
+
+    ret = ret && !memcmp(got, "RAM ", 4) && snapshot_load_ram(&s, depth);
+
+    fclose(s.fp);
+
+    return ret;
+}
+
+static int
+snapshot_load_device(snapshot_t *s, const device_t *dev, void *priv)
+{
+    const char *name = snapshot_device_name(dev);
+    char        got[128];
+    uint32_t    len;
+
+    if (!snapshot_next(s, "DEV ") || !snapshot_read(s, &len, sizeof(len)) ||
+        (len >= sizeof(got)) || !snapshot_read(s, got, len))
+        return 0;
+    got[len] = '\0';
+
+    if (strcmp(got, name)) {
+        pclog("Snapshot: expected device \"%s\", found \"%s\"\n", name, got);
+        return 0;
+    }
+
+    snapshot_log("Snapshot: loading \"%s\"\n", dev->name);
+
+    if ((dev->load == NULL) || !dev->load(priv, s)) {
+        pclog("Snapshot: device \"%s\" could not be loaded\n", dev->name);
+        return 0;
+    }
+
+    return !s->error;
+}
+
+/* Copies out the pages to be saved, every one of them for a full snapshot. */
+static int
+snapshot_copy_ram(snapshot_job_t *job, int incremental)
+{
+    const uint32_t *bits   = mem_dirty_get(snapshot_dirty);
+    const uint32_t  dirty  = mem_dirty_page_count();
+    const uint32_t  npages = (job->ram_size + SNAPSHOT_PAGE - 1) / SNAPSHOT_PAGE;
+    uint32_t        n      = 0;
+
+    /* Pages past the end of the map are taken as dirty. */
+#define SNAPSHOT_DIRTY(p) (!incremental || ((p) >= dirty) || (bits[(p) >> 5] & (1U << ((p) & 31))))
+
+    for (uint32_t p = 0; p < npages; p++) {
+        if (SNAPSHOT_DIRTY(p))
+            n++;
+    }
+
+    job->page = (uint32_t *) malloc(MAX(n, 1) * sizeof(uint32_t));
+    job->data = (uint8_t *) malloc(MAX((size_t) n, 1) * SNAPSHOT_PAGE);
+    if ((job->page == NULL) || (job->data == NULL))
+        return 0;
+
+    for (uint32_t p = 0; p < npages; p++) {
+        if (SNAPSHOT_DIRTY(p)) {
+            uint8_t       *data = &job->data[(size_t) job->npages * SNAPSHOT_PAGE];
+            const uint32_t len  = snapshot_page_len(job->ram_size, p);
+
+            memcpy(data, snapshot_ram_ptr(p * SNAPSHOT_PAGE), len);
+            memset(&data[len], 0x00, SNAPSHOT_PAGE - len);
+            job->page[job->npages++] = p;
+        }
+    }
+
+#undef SNAPSHOT_DIRTY
+
+    mem_dirty_clear(snapshot_dirty);
+
+    return 1;
+}
+
+int
+snapshot_save(const char *fn, int incremental)
+{
+    snapshot_job_t *job;
+    const device_t *dev;
+    void           *priv;
+    uint32_t        len;
+
+    /* Check first, rather than leave a snapshot that can not be loaded. */
+    for (int c = 0; device_get_attached(c, &dev, &priv); c++) {
+        if ((dev != NULL) && (dev->save == NULL)) {
+            pclog("Snapshot: device \"%s\" can not be saved\n", dev->name);
+            return 0;
+        }
+    }
+
+    /* One snapshot is written at a time. */
+    snapshot_wait();
+
+    job = (snapshot_job_t *) calloc(1, sizeof(snapshot_job_t));
+    if (job == NULL)
+        return 0;
+
+    strncpy(job->fn, fn, sizeof(job->fn) - 1);
+    snapshot_header(&job->hdr);
+    job->hdr.id   = ((uint64_t) time(NULL) << 32) ^ (tsc << 8) ^ ++snapshot_seq;
+    job->ram_size = mem_size * 1024;
+
+    /* Pages are only tracked from the first snapshot on, and an incremental
+       one needs a parent of the same machine. */
+    if (snapshot_dirty == NULL) {
+        snapshot_dirty = mem_dirty_register();
+        incremental    = 0;
+    }
+    if (!snapshot_last[0] || !snapshot_header_matches(&snapshot_last_hdr, &job->hdr))
+        incremental = 0;
+    if (incremental) {
+        strncpy(job->parent, snapshot_last, sizeof(job->parent) - 1);
+        job->parent_id = snapshot_last_hdr.id;
+    }
+
+    snapshot_begin(&job->state, "CPU ");
+    snapshot_save_cpu(&job->state);
+    snapshot_end(&job->state);
+
+    snapshot_begin(&job->state, "PIC ");
+    pic_snapshot_save(&job->state);
+    snapshot_end(&job->state);
+
+    snapshot_begin(&job->state, "DMA ");
+    dma_snapshot_save(&job->state);
+    snapshot_end(&job->state);
+
+    for (int c = 0; device_get_attached(c, &dev, &priv); c++) {
+        if (dev == NULL)
+            continue;
+
+        snapshot_log("Snapshot: saving \"%s\"\n", dev->name);
+
+        len = (uint32_t) strlen(snapshot_device_name(dev));
+        snapshot_begin(&job->state, "DEV ");
+        snapshot_write(&job->state, &len, sizeof(len));
+        snapshot_write(&job->state, snapshot_device_name(dev), len);
+        dev->save(priv, &job->state);
+        snapshot_end(&job->state);
+    }
+
+    if (job->state.error || !snapshot_copy_ram(job, incremental)) {
+        pclog("Snapshot: out of memory saving \"%s\"\n", fn);
+        snapshot_job_free(job);
+        return 0;
+    }
+
+    snapshot_log("Snapshot: %u pages copied for \"%s\"\n", job->npages, fn);
+
+    strncpy(snapshot_last, fn, sizeof(snapshot_last) - 1);
+    snapshot_last_hdr = job->hdr;
+
+    replay_snapshot(job->hdr.id, 0);
+
+    snapshot_thread = thread_create(snapshot_thread_func, job);
+
+    return 1;
+}
+
+int
+snapshot_load(const char *fn)
+{
+    snapshot_header_t hdr;
+    snapshot_t        s;
+    const device_t   *dev;
+    void             *priv;
+    int               ret = 0;
+
+    /* The file may be the one still being written. */
+    snapshot_wait();
+
+    memset(&s, 0x00, sizeof(snapshot_t));
+    s.fp = snapshot_open(fn, &hdr);
+    if (s.fp == NULL)
+        return 0;
+
+    /* From here on, a failure leaves the machine half loaded. */
+    s.start = ftello64(s.fp);
+
+    if (snapshot_next(&s, "CPU ") && snapshot_load_cpu(&s) &&
+        snapshot_next(&s, "PIC ") && pic_snapshot_load(&s) &&
+        snapshot_next(&s, "DMA ") && dma_snapshot_load(&s)) {
+        ret = 1;
+
+        for (int c = 0; ret && device_get_attached(c, &dev, &priv); c++) {
+            if (dev != NULL)
+                ret = snapshot_load_device(&s, dev, priv);
+        }
+
+        ret = ret && snapshot_next(&s, "RAM ") && snapshot_load_ram(&s, 0) && snapshot_next(&s, "END ");
+    }
+
+    fclose(s.fp);
+
+    /* Drop whatever the recompiler had made of the old contents. */
+    mem_invalidate_range(0, (mem_size * 1024) - 1);
+
+    if (!ret) {
+        pclog("Snapshot: \"%s\" could not be loaded, resetting\n", fn);
+        snapshot_last[0] = '\0';
+        pc_reset_hard();
+        return 0;
+    }
+
+    /* The next incremental snapshot is based on this one. */
+    if (snapshot_dirty == NULL)
+        snapshot_dirty = mem_dirty_register();
+    mem_dirty_clear(snapshot_dirty);
+    strncpy(snapshot_last, fn, sizeof(snapshot_last) - 1);
+    snapshot_last_hdr = hdr;
+
+    /* The guest clock is as old as the snapshot. A replay carries on with
+       the clock the recording had instead. */
+    if ((time_sync & TIME_SYNC_ENABLED) && (replay_mode == REPLAY_OFF))
+        nvr_time_sync();
+
+    replay_snapshot(hdr.id, 1);
+
+    pclog("Snapshot: loaded from \"%s\"\n", fn);
+
+    return 1;
+}
+
+/* Waits for the last snapshot to be written out. */
+void
+snapshot_close(void)
+{
+    snapshot_wait();
+
+    if (snapshot_dirty != NULL) {
+        mem_dirty_unregister(snapshot_dirty);
+        snapshot_dirty = NULL;
+    }
+    snapshot_last[0] = '\0';
+}
+
+static void
+snapshot_request(const char *fn, int op)
+{
+    if (atomic_load(&snapshot_op) != SNAPSHOT_OP_NONE)
+        return;
+
+    strncpy(snapshot_fn, fn, sizeof(snapshot_fn) - 1);
+    snapshot_fn[sizeof(snapshot_fn) - 1] = '\0';
+    atomic_store(&snapshot_op, op);
+}
+
+void
+snapshot_request_save(const char *fn, int incremental)
+{
+    snapshot_request(fn, incremental ? SNAPSHOT_OP_SAVE_INCREMENTAL : SNAPSHOT_OP_SAVE);
+}
+
+void
+snapshot_request_load(const char *fn)
+{
+    snapshot_request(fn, SNAPSHOT_OP_LOAD);
+}
+
+/* Called by pc_run() between slices, when the CPU is at an instruction
+   boundary and no device is in the middle of anything. */
+void
+snapshot_process(void)
+{
+    switch (atomic_exchange(&snapshot_op, SNAPSHOT_OP_NONE)) {
+        case SNAPSHOT_OP_SAVE:
+            snapshot_save(snapshot_fn, 0);
+            break;
+
+        case SNAPSHOT_OP_SAVE_INCREMENTAL:
+            snapshot_save(snapshot_fn, 1);
+            break;
+
+        case SNAPSHOT_OP_LOAD:
+            snapshot_load(snapshot_fn);
+            break;
+
+        default:
+            break;
+    }
+}
@@ -1,4 +1,5 @@
 /* some code borrowed from scummvm */
+#include <stdatomic.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -42,6 +43,8 @@ typedef struct fluidsynth {
     int16_t  *buffer_int16;
     int       midi_pos;
 
+    atomic_int pending; /* Segments signalled but not rendered yet. */
+
     int on;
 } fluidsynth_t;
 
@@ -60,16 +63,44 @@ fluidsynth_poll(void)
     data->midi_pos++;
     if (data->midi_pos == SOUND_FREQ / RENDER_RATE) {
         data->midi_pos = 0;
+        atomic_fetch_add(&data->pending, 1);
         thread_set_event(data->event);
     }
 }
 
+static void
+fluidsynth_render_segment(fluidsynth_t *data, int *buf_pos)
+{
+    int buf_size = data->buf_size / BUFFER_SEGMENTS;
+
+    if (sound_is_float) {
+        float *buf = (float *) ((uint8_t *) data->buffer + *buf_pos);
+        memset(buf, 0, buf_size);
+        if (data->synth)
+            fluid_synth_write_float(data->synth, buf_size / (2 * sizeof(float)), buf, 0, 2, buf, 1, 2);
+        *buf_pos += buf_size;
+        if (*buf_pos >= data->buf_size) {
+            givealbuffer_midi(data->buffer, data->buf_size / sizeof(float));
+            *buf_pos = 0;
+        }
+    } else {
+        int16_t *buf = (int16_t *) ((uint8_t *) data->buffer_int16 + *buf_pos);
+        memset(buf, 0, buf_size);
+        if (data->synth)
+            fluid_synth_write_s16(data->synth, buf_size / (2 * sizeof(int16_t)), buf, 0, 2, buf, 1, 2);
+        *buf_pos += buf_size;
+        if (*buf_pos >= data->buf_size) {
+            givealbuffer_midi(data->buffer_int16, data->buf_size / sizeof(int16_t));
+            *buf_pos = 0;
+        }
+    }
+}
+
 static void
 fluidsynth_thread(void *param)
 {
-    fluidsynth_t *data     = (fluidsynth_t *) param;
-    int           buf_pos  = 0;
-    int           buf_size = data->buf_size / BUFFER_SEGMENTS;
+    fluidsynth_t *data    = (fluidsynth_t *) param;
+    int           buf_pos = 0;
 
     thread_set_event(data->start_event);
 
@@ -77,27 +108,14 @@ fluidsynth_thread(void *param)
         thread_wait_event(data->event, -1);
         thread_reset_event(data->event);
 
-        if (sound_is_float) {
-            float *buf = (float *) ((uint8_t *) data->buffer + buf_pos);
-            memset(buf, 0, buf_size);
-            if (data->synth)
-                fluid_synth_write_float(data->synth, buf_size / (2 * sizeof(float)), buf, 0, 2, buf, 1, 2);
-            buf_pos += buf_size;
-            if (buf_pos >= data->buf_size) {
-                givealbuffer_midi(data->buffer, data->buf_size / sizeof(float));
-                buf_pos = 0;
-            }
-        } else {
-            int16_t *buf = (int16_t *) ((uint8_t *) data->buffer_int16 + buf_pos);
-            memset(buf, 0, buf_size);
-            if (data->synth)
-                fluid_synth_write_s16(data->synth, buf_size / (2 * sizeof(int16_t)), buf, 0, 2, buf, 1, 2);
-            buf_pos += buf_size;
-            if (buf_pos >= data->buf_size) {
-                givealbuffer_midi(data->buffer_int16, data->buf_size / sizeof(int16_t));
-                buf_pos = 0;
-            }
-        }
+        /* Render every segment signalled since the last wake-up, so a slow
+           one is caught up on rather than lost. */
+        int segments = atomic_exchange(&data->pending, 0);
+        if (segments > BUFFER_SEGMENTS)
+            segments = BUFFER_SEGMENTS;
+
+        while (data->on && (segments-- > 0))
+            fluidsynth_render_segment(data, &buf_pos);
     }
 }
 
@@ -271,11 +289,12 @@ fluidsynth_init(UNUSED(const device_t *info))
     midi_out_init(dev);
 
     data->on = 1;
+    atomic_store(&data->pending, 0);
 
     data->start_event = thread_create_event();
 
     data->event    = thread_create_event();
-    data->thread_h = thread_create(fluidsynth_thread, data);
+    data->thread_h = thread_create_role(fluidsynth_thread, data, THREAD_ROLE_AUDIO);
 
     thread_wait_event(data->start_event, -1);
     thread_reset_event(data->start_event);
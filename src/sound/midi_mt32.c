@@ -1,3 +1,4 @@
+#include <stdatomic.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -163,6 +164,7 @@ static int      buf_size     = 0;
 static float   *buffer       = NULL;
 static int16_t *buffer_int16 = NULL;
 static int      midi_pos     = 0;
+static atomic_int pending;
 
 static mt32emu_report_handler_version
 get_mt32_report_handler_version(UNUSED(mt32emu_report_handler_i i))
@@ -204,43 +206,67 @@ mt32_poll(void)
     midi_pos++;
     if (midi_pos == SOUND_FREQ / RENDER_RATE) {
         midi_pos = 0;
+        atomic_fetch_add(&pending, 1);
         thread_set_event(event);
     }
 }
 
-static void
-mt32_thread(UNUSED(void *param))
+/* Render up to count segments with one call into the synth, as many as fit
+   before the end of the buffer, and return how many were rendered. */
+static int
+mt32_render_segments(int *buf_pos, int count)
 {
-    int      buf_pos = 0;
-    int      bsize   = buf_size / BUFFER_SEGMENTS;
+    int      bsize = buf_size / BUFFER_SEGMENTS;
     float   *buf;
     int16_t *buf16;
 
+    if (count > ((buf_size - *buf_pos) / bsize))
+        count = (buf_size - *buf_pos) / bsize;
+    bsize *= count;
+
+    if (sound_is_float) {
+        buf = (float *) ((uint8_t *) buffer + *buf_pos);
+        memset(buf, 0, bsize);
+        mt32_stream(buf, bsize / (2 * sizeof(float)));
+        *buf_pos += bsize;
+        if (*buf_pos >= buf_size) {
+            givealbuffer_midi(buffer, buf_size / sizeof(float));
+            *buf_pos = 0;
+        }
+    } else {
+        buf16 = (int16_t *) ((uint8_t *) buffer_int16 + *buf_pos);
+        memset(buf16, 0, bsize);
+        mt32_stream_int16(buf16, bsize / (2 * sizeof(int16_t)));
+        *buf_pos += bsize;
+        if (*buf_pos >= buf_size) {
+            givealbuffer_midi(buffer_int16, buf_size / sizeof(int16_t));
+            *buf_pos = 0;
+        }
+    }
+
+    return count;
+}
+
+static void
+mt32_thread(UNUSED(void *param))
+{
+    int buf_pos = 0;
+
     thread_set_event(start_event);
 
     while (mt32_on) {
         thread_wait_event(event, -1);
         thread_reset_event(event);
 
-        if (sound_is_float) {
-            buf = (float *) ((uint8_t *) buffer + buf_pos);
-            memset(buf, 0, bsize);
-            mt32_stream(buf, bsize / (2 * sizeof(float)));
-            buf_pos += bsize;
-            if (buf_pos >= buf_size) {
-                givealbuffer_midi(buffer, buf_size / sizeof(float));
-                buf_pos = 0;
-            }
-        } else {
-            buf16 = (int16_t *) ((uint8_t *) buffer_int16 + buf_pos);
-            memset(buf16, 0, bsize);
-            mt32_stream_int16(buf16, bsize / (2 * sizeof(int16_t)));
-            buf_pos += bsize;
-            if (buf_pos >= buf_size) {
-                givealbuffer_midi(buffer_int16, buf_size / sizeof(int16_t));
-                buf_pos = 0;
-            }
-        }
+        /* Render every segment signalled since the last wake-up, so a slow
+           one (dense passages) is caught up on rather than lost. More than
+           a whole buffer behind can not be made up for anymore. */
+        int segments = atomic_exchange(&pending, 0);
+        if (segments > BUFFER_SEGMENTS)
+            segments = BUFFER_SEGMENTS;
+
+        while (mt32_on && (segments > 0))
+            segments -= mt32_render_segments(&buf_pos, segments);
     }
 }
 
@@ -308,10 +334,11 @@ mt32emu_init(char *control_rom, char *pcm_rom)
 
     mt32_on = 1;
 
+    atomic_store(&pending, 0);
     start_event = thread_create_event();
 
     event    = thread_create_event();
-    thread_h = thread_create(mt32_thread, 0);
+    thread_h = thread_create_role(mt32_thread, 0, THREAD_ROLE_AUDIO);
 
     thread_wait_event(start_event, -1);
     thread_reset_event(start_event);
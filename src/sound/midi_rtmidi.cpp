@@ -23,6 +23,7 @@
 #    endif
 #endif
 
+#include <atomic>
 #include <cstdint>
 #include <cstdio>
 #include <cstdlib>
@@ -35,6 +36,9 @@ extern "C" {
 #include <86box/midi_rtmidi.h>
 #include <86box/ini.h>
 #include <86box/config.h>
+#include <86box/plat.h>
+#include <86box/thread.h>
+#include <86box/timer.h>
 #include <86box/plat_unused.h>
 
 // Disable c99-designator to avoid the warnings in rtmidi_*_device
@@ -50,6 +54,117 @@ static RtMidiIn  *midiin      = nullptr;
 static int        midi_out_id = 0, midi_in_id = 0;
 static const int  midi_lengths[8] = { 3, 3, 3, 3, 2, 2, 3, 1 };
 
+/*
+ * Sending can block on some hosts, so output goes through a queue drained
+ * by its own thread. Every event is stamped with the host time it is due
+ * at, derived from the emulated time it was written at plus the configured
+ * latency, which smooths out the bursts the CPU thread writes them in.
+ */
+#define RTMIDI_QUEUE_SIZE 65536
+#define RTMIDI_QUEUE_MASK (RTMIDI_QUEUE_SIZE - 1)
+
+typedef struct rtmidi_event_t {
+    uint64_t due; /* Host time in microseconds. */
+    uint32_t len;
+} rtmidi_event_t;
+
+static uint8_t               out_queue[RTMIDI_QUEUE_SIZE];
+static uint8_t               out_buf[SYSEX_SIZE];
+static std::atomic<uint32_t> out_head;
+static std::atomic<uint32_t> out_tail;
+static std::atomic<int>      out_run;
+static thread_t             *out_thread = nullptr;
+static event_t              *out_wake   = nullptr;
+static event_t              *out_room   = nullptr;
+static int64_t               out_latency;
+static int64_t               out_offset;
+static int                   out_anchored;
+
+static void
+rtmidi_queue_copy_in(uint32_t pos, const void *src, uint32_t len)
+{
+    uint32_t off   = pos & RTMIDI_QUEUE_MASK;
+    uint32_t first = MIN(len, RTMIDI_QUEUE_SIZE - off);
+
+    memcpy(&out_queue[off], src, first);
+    memcpy(out_queue, ((const uint8_t *) src) + first, len - first);
+}
+
+static void
+rtmidi_queue_copy_out(uint32_t pos, void *dst, uint32_t len)
+{
+    uint32_t off   = pos & RTMIDI_QUEUE_MASK;
+    uint32_t first = MIN(len, RTMIDI_QUEUE_SIZE - off);
+
+    memcpy(dst, &out_queue[off], first);
+    memcpy(((uint8_t *) dst) + first, out_queue, len - first);
+}
+
+static void
+rtmidi_out_thread(UNUSED(void *priv))
+{
+    while (out_run.load()) {
+        uint32_t       tail = out_tail.load(std::memory_order_relaxed);
+        rtmidi_event_t ev;
+
+        if (out_head.load(std::memory_order_acquire) == tail) {
+            thread_reset_event(out_wake);
+            if (out_head.load(std::memory_order_acquire) == tail)
+                thread_wait_event(out_wake, -1);
+            continue;
+        }
+
+        rtmidi_queue_copy_out(tail, &ev, sizeof(rtmidi_event_t));
+
+        int64_t wait = (int64_t) ev.due - (int64_t) plat_get_ticks_us();
+        if (wait >= 1000) {
+            thread_reset_event(out_wake);
+            thread_wait_event(out_wake, (int) (wait / 1000));
+            continue;
+        }
+
+        rtmidi_queue_copy_out(tail + sizeof(rtmidi_event_t), out_buf, ev.len);
+        if (midiout)
+            midiout->sendMessage(out_buf, ev.len);
+
+        out_tail.store(tail + sizeof(rtmidi_event_t) + ev.len, std::memory_order_release);
+        thread_set_event(out_room);
+    }
+}
+
+static void
+rtmidi_queue_push(const uint8_t *data, uint32_t len)
+{
+    uint32_t       need = sizeof(rtmidi_event_t) + len;
+    uint32_t       head = out_head.load(std::memory_order_relaxed);
+    int64_t        now  = (int64_t) plat_get_ticks_us();
+    int64_t        emu  = (int64_t) (tsc / (TIMER_USEC >> 32));
+    rtmidi_event_t ev;
+
+    /* Re-anchor on the first event, and whenever emulation has drifted away
+       from the host clock, such as after a pause or in turbo mode. */
+    ev.due = emu + out_offset;
+    if (!out_anchored || ((int64_t) ev.due < now) || ((int64_t) ev.due > (now + (out_latency * 2)))) {
+        out_offset   = now + out_latency - emu;
+        out_anchored = 1;
+        ev.due       = now + out_latency;
+    }
+    ev.len = len;
+
+    /* Only hit when the host port cannot keep up, let the thread drain. */
+    while ((RTMIDI_QUEUE_SIZE - (head - out_tail.load(std::memory_order_acquire))) < need) {
+        thread_set_event(out_wake);
+        thread_wait_event(out_room, 1);
+        thread_reset_event(out_room);
+    }
+
+    rtmidi_queue_copy_in(head, &ev, sizeof(rtmidi_event_t));
+    rtmidi_queue_copy_in(head + sizeof(rtmidi_event_t), data, len);
+    out_head.store(head + need, std::memory_order_release);
+
+    thread_set_event(out_wake);
+}
+
 int
 rtmidi_write(UNUSED(uint8_t val))
 {
@@ -60,14 +175,14 @@ void
 rtmidi_play_msg(uint8_t *msg)
 {
     if (midiout)
-        midiout->sendMessage(msg, midi_lengths[(msg[0] >> 4) & 7]);
+        rtmidi_queue_push(msg, midi_lengths[(msg[0] >> 4) & 7]);
 }
 
 void
 rtmidi_play_sysex(uint8_t *sysex, unsigned int len)
 {
-    if (midiout)
-        midiout->sendMessage(sysex, len);
+    if (midiout && (len <= SYSEX_SIZE))
+        rtmidi_queue_push(sysex, len);
 }
 
 void *
@@ -104,6 +219,15 @@ rtmidi_output_init(UNUSED(const device_t *info))
         }
     }
 
+    out_latency  = device_get_config_int("latency") * 1000;
+    out_anchored = 0;
+    out_head.store(0);
+    out_tail.store(0);
+    out_run.store(1);
+    out_wake   = thread_create_event();
+    out_room   = thread_create_event();
+    out_thread = thread_create_role(rtmidi_out_thread, nullptr, THREAD_ROLE_AUDIO);
+
     midi_out_init(dev);
 
     return dev;
@@ -115,6 +239,17 @@ rtmidi_output_close(UNUSED(void *priv))
     if (!midiout)
         return;
 
+    if (out_thread) {
+        out_run.store(0);
+        thread_set_event(out_wake);
+        thread_wait(out_thread);
+        out_thread = nullptr;
+
+        thread_destroy_event(out_wake);
+        thread_destroy_event(out_room);
+        out_wake = out_room = nullptr;
+    }
+
     midiout->closePort();
 
     delete midiout;
@@ -241,6 +376,20 @@ static const device_config_t system_midi_config[] = {
         .selection      = { { 0 } },
         .bios           = { { 0 } }
     },
+    {
+        .name           = "latency",
+        .description    = "Output latency (ms)",
+        .type           = CONFIG_SPINNER,
+        .default_string = NULL,
+        .default_int    = 0,
+        .file_filter    = NULL,
+        .spinner        = {
+            .min =  0,
+            .max = 50
+        },
+        .selection      = { { 0 } },
+        .bios           = { { 0 } }
+    },
     { .name = "", .description = "", .type = CONFIG_END }
   // clang-format on
 };
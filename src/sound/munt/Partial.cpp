@@ -17,6 +17,14 @@
 
 #include <cstddef>
 
+#if defined(__x86_64__) || defined(_M_X64)
+#include <emmintrin.h>
+#define MT32EMU_MIX_SSE2 1
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define MT32EMU_MIX_NEON 1
+#endif
+
 #include "internals.h"
 
 #include "Partial.h"
@@ -332,9 +340,10 @@ bool Partial::generateNextSample(LA32PairImpl *la32PairImpl) {
 	return true;
 }
 
-void Partial::produceAndMixSample(IntSample *&leftBuf, IntSample *&rightBuf, LA32IntPartialPair *la32IntPair) {
-	IntSampleEx sample = la32IntPair->nextOutSample();
+// Samples generated ahead of mixing them into the output, in one go per chunk.
+static const Bit32u PARTIAL_MIX_CHUNK = 256;
 
+void Partial::mixSamples(IntSample *leftBuf, IntSample *rightBuf, const IntSample *samples, Bit32u length) {
 	// FIXME: LA32 may produce distorted sound in case if the absolute value of maximal amplitude of the input exceeds 8191
 	// when the panning value is non-zero. Most probably the distortion occurs in the same way it does with ring modulation,
 	// and it seems to be caused by limited precision of the common multiplication circuit.
@@ -342,18 +351,84 @@ void Partial::produceAndMixSample(IntSample *&leftBuf, IntSample *&rightBuf, LA3
 	// by subtraction of the left channel output from the input.
 	// Though, it is unknown whether this overflow is exploited somewhere.
 
-	IntSampleEx leftOut = ((sample * leftPanValue) >> 13) + IntSampleEx(*leftBuf);
-	IntSampleEx rightOut = ((sample * rightPanValue) >> 13) + IntSampleEx(*rightBuf);
-	*(leftBuf++) = Synth::clipSampleEx(leftOut);
-	*(rightBuf++) = Synth::clipSampleEx(rightOut);
+	// The pan factors are within +-8192, so the products of the 16-bit samples fit in 32 bits
+	// and the vector paths below produce exactly the same results as the scalar one.
+	Bit32u i = 0;
+#if defined(MT32EMU_MIX_SSE2)
+	const __m128i leftPan = _mm_set1_epi16(Bit16s(leftPanValue));
+	const __m128i rightPan = _mm_set1_epi16(Bit16s(rightPanValue));
+	for (; i + 8 <= length; i += 8) {
+		const __m128i sample = _mm_loadu_si128((const __m128i *)(samples + i));
+		const __m128i left = _mm_loadu_si128((const __m128i *)(leftBuf + i));
+		const __m128i right = _mm_loadu_si128((const __m128i *)(rightBuf + i));
+		const __m128i leftLo = _mm_mullo_epi16(sample, leftPan), leftHi = _mm_mulhi_epi16(sample, leftPan);
+		const __m128i rightLo = _mm_mullo_epi16(sample, rightPan), rightHi = _mm_mulhi_epi16(sample, rightPan);
+		__m128i l0 = _mm_srai_epi32(_mm_unpacklo_epi16(leftLo, leftHi), 13);
+		__m128i l1 = _mm_srai_epi32(_mm_unpackhi_epi16(leftLo, leftHi), 13);
+		__m128i r0 = _mm_srai_epi32(_mm_unpacklo_epi16(rightLo, rightHi), 13);
+		__m128i r1 = _mm_srai_epi32(_mm_unpackhi_epi16(rightLo, rightHi), 13);
+		l0 = _mm_add_epi32(l0, _mm_srai_epi32(_mm_unpacklo_epi16(left, left), 16));
+		l1 = _mm_add_epi32(l1, _mm_srai_epi32(_mm_unpackhi_epi16(left, left), 16));
+		r0 = _mm_add_epi32(r0, _mm_srai_epi32(_mm_unpacklo_epi16(right, right), 16));
+		r1 = _mm_add_epi32(r1, _mm_srai_epi32(_mm_unpackhi_epi16(right, right), 16));
+		_mm_storeu_si128((__m128i *)(leftBuf + i), _mm_packs_epi32(l0, l1));
+		_mm_storeu_si128((__m128i *)(rightBuf + i), _mm_packs_epi32(r0, r1));
+	}
+#elif defined(MT32EMU_MIX_NEON)
+	const int16x4_t leftPan = vdup_n_s16(Bit16s(leftPanValue));
+	const int16x4_t rightPan = vdup_n_s16(Bit16s(rightPanValue));
+	for (; i + 8 <= length; i += 8) {
+		const int16x8_t sample = vld1q_s16(samples + i);
+		const int16x8_t left = vld1q_s16(leftBuf + i);
+		const int16x8_t right = vld1q_s16(rightBuf + i);
+		int32x4_t l0 = vshrq_n_s32(vmull_s16(vget_low_s16(sample), leftPan), 13);
+		int32x4_t l1 = vshrq_n_s32(vmull_s16(vget_high_s16(sample), leftPan), 13);
+		int32x4_t r0 = vshrq_n_s32(vmull_s16(vget_low_s16(sample), rightPan), 13);
+		int32x4_t r1 = vshrq_n_s32(vmull_s16(vget_high_s16(sample), rightPan), 13);
+		l0 = vaddw_s16(l0, vget_low_s16(left));
+		l1 = vaddw_s16(l1, vget_high_s16(left));
+		r0 = vaddw_s16(r0, vget_low_s16(right));
+		r1 = vaddw_s16(r1, vget_high_s16(right));
+		vst1q_s16(leftBuf + i, vcombine_s16(vqmovn_s32(l0), vqmovn_s32(l1)));
+		vst1q_s16(rightBuf + i, vcombine_s16(vqmovn_s32(r0), vqmovn_s32(r1)));
+	}
+#endif
+	for (; i < length; i++) {
+		IntSampleEx sample = samples[i];
+		IntSampleEx leftOut = ((sample * leftPanValue) >> 13) + IntSampleEx(leftBuf[i]);
+		IntSampleEx rightOut = ((sample * rightPanValue) >> 13) + IntSampleEx(rightBuf[i]);
+		leftBuf[i] = Synth::clipSampleEx(leftOut);
+		rightBuf[i] = Synth::clipSampleEx(rightOut);
+	}
 }
 
-void Partial::produceAndMixSample(FloatSample *&leftBuf, FloatSample *&rightBuf, LA32FloatPartialPair *la32FloatPair) {
-	FloatSample sample = la32FloatPair->nextOutSample();
-	FloatSample leftOut = (sample * leftPanValue) / 14.0f;
-	FloatSample rightOut = (sample * rightPanValue) / 14.0f;
-	*(leftBuf++) += leftOut;
-	*(rightBuf++) += rightOut;
+void Partial::mixSamples(FloatSample *leftBuf, FloatSample *rightBuf, const FloatSample *samples, Bit32u length) {
+	Bit32u i = 0;
+#if defined(MT32EMU_MIX_SSE2)
+	const __m128 leftPan = _mm_set1_ps(FloatSample(leftPanValue));
+	const __m128 rightPan = _mm_set1_ps(FloatSample(rightPanValue));
+	const __m128 divisor = _mm_set1_ps(14.0f);
+	for (; i + 4 <= length; i += 4) {
+		const __m128 sample = _mm_loadu_ps(samples + i);
+		_mm_storeu_ps(leftBuf + i, _mm_add_ps(_mm_loadu_ps(leftBuf + i), _mm_div_ps(_mm_mul_ps(sample, leftPan), divisor)));
+		_mm_storeu_ps(rightBuf + i, _mm_add_ps(_mm_loadu_ps(rightBuf + i), _mm_div_ps(_mm_mul_ps(sample, rightPan), divisor)));
+	}
+#elif defined(MT32EMU_MIX_NEON)
+	const float32x4_t leftPan = vdupq_n_f32(FloatSample(leftPanValue));
+	const float32x4_t rightPan = vdupq_n_f32(FloatSample(rightPanValue));
+	const float32x4_t divisor = vdupq_n_f32(14.0f);
+	for (; i + 4 <= length; i += 4) {
+		const float32x4_t sample = vld1q_f32(samples + i);
+		vst1q_f32(leftBuf + i, vaddq_f32(vld1q_f32(leftBuf + i), vdivq_f32(vmulq_f32(sample, leftPan), divisor)));
+		vst1q_f32(rightBuf + i, vaddq_f32(vld1q_f32(rightBuf + i), vdivq_f32(vmulq_f32(sample, rightPan), divisor)));
+	}
+#endif
+	for (; i < length; i++) {
+		FloatSample leftOut = (samples[i] * leftPanValue) / 14.0f;
+		FloatSample rightOut = (samples[i] * rightPanValue) / 14.0f;
+		leftBuf[i] += leftOut;
+		rightBuf[i] += rightOut;
+	}
 }
 
 template <class Sample, class LA32PairImpl>
@@ -361,9 +436,25 @@ bool Partial::doProduceOutput(Sample *leftBuf, Sample *rightBuf, Bit32u length,
 	if (!canProduceOutput()) return false;
 	alreadyOutputed = true;
 
-	for (sampleNum = 0; sampleNum < length; sampleNum++) {
-		if (!generateNextSample(la32PairImpl)) break;
-		produceAndMixSample(leftBuf, rightBuf, la32PairImpl);
+	// The LA32 state advances sample by sample, so the wave is generated ahead in chunks
+	// and then panned and mixed into the output a whole chunk at a time.
+	Sample samples[PARTIAL_MIX_CHUNK];
+	bool playing = true;
+	for (sampleNum = 0; playing && (sampleNum < length);) {
+		Bit32u chunkLength = length - sampleNum;
+		if (chunkLength > PARTIAL_MIX_CHUNK) chunkLength = PARTIAL_MIX_CHUNK;
+		Bit32u generated = 0;
+		while (generated < chunkLength) {
+			if (!generateNextSample(la32PairImpl)) {
+				playing = false;
+				break;
+			}
+			samples[generated++] = la32PairImpl->nextOutSample();
+			sampleNum++;
+		}
+		mixSamples(leftBuf, rightBuf, samples, generated);
+		leftBuf += generated;
+		rightBuf += generated;
 	}
 	sampleNum = 0;
 	return true;
@@ -88,8 +88,8 @@ private:
 	bool canProduceOutput();
 	template <class LA32PairImpl>
 	bool generateNextSample(LA32PairImpl *la32PairImpl);
-	void produceAndMixSample(IntSample *&leftBuf, IntSample *&rightBuf, LA32IntPartialPair *la32IntPair);
-	void produceAndMixSample(FloatSample *&leftBuf, FloatSample *&rightBuf, LA32FloatPartialPair *la32FloatPair);
+	void mixSamples(IntSample *leftBuf, IntSample *rightBuf, const IntSample *samples, Bit32u length);
+	void mixSamples(FloatSample *leftBuf, FloatSample *rightBuf, const FloatSample *samples, Bit32u length);
 
 public:
 	bool alreadyOutputed;
@@ -35,7 +35,7 @@
 #include <86box/plat_unused.h>
 
 #define FREQ   SOUND_FREQ
-#define BUFLEN SOUNDBUFLEN
+#define BUFLEN sound_buf_len
 
 ALuint        buffers[4];       /* front and back buffers */
 ALuint        buffers_music[4]; /* front and back buffers */
@@ -110,6 +110,14 @@ closeal(void)
     initialized = 0;
 }
 
+/* Drops the output without touching it, for a process that shares the
+   device with another one, which still owns it. Nothing is played after. */
+void
+forgetal(void)
+{
+    initialized = 0;
+}
+
 void
 inital(void)
 {
@@ -140,15 +148,15 @@ inital(void)
 
     if (sound_is_float) {
         buf       = (float *) calloc((BUFLEN << 1), sizeof(float));
-        music_buf = (float *) calloc((MUSICBUFLEN << 1), sizeof(float));
-        wt_buf    = (float *) calloc((WTBUFLEN << 1), sizeof(float));
+        music_buf = (float *) calloc((BUFLEN << 1), sizeof(float));
+        wt_buf    = (float *) calloc((BUFLEN << 1), sizeof(float));
         cd_buf    = (float *) calloc((CD_BUFLEN << 1), sizeof(float));
         if (init_midi)
             midi_buf = (float *) calloc(midi_buf_size, sizeof(float));
     } else {
         buf_int16       = (int16_t *) calloc((BUFLEN << 1), sizeof(int16_t));
-        music_buf_int16 = (int16_t *) calloc((MUSICBUFLEN << 1), sizeof(int16_t));
-        wt_buf_int16    = (int16_t *) calloc((WTBUFLEN << 1), sizeof(int16_t));
+        music_buf_int16 = (int16_t *) calloc((BUFLEN << 1), sizeof(int16_t));
+        wt_buf_int16    = (int16_t *) calloc((BUFLEN << 1), sizeof(int16_t));
         cd_buf_int16    = (int16_t *) calloc((CD_BUFLEN << 1), sizeof(int16_t));
         if (init_midi)
             midi_buf_int16 = (int16_t *) calloc(midi_buf_size, sizeof(int16_t));
@@ -197,15 +205,15 @@ inital(void)
     if (sound_is_float) {
         memset(buf, 0, BUFLEN * 2 * sizeof(float));
         memset(cd_buf, 0, CD_BUFLEN * 2 * sizeof(float));
-        memset(music_buf, 0, MUSICBUFLEN * 2 * sizeof(float));
-        memset(wt_buf, 0, WTBUFLEN * 2 * sizeof(float));
+        memset(music_buf, 0, BUFLEN * 2 * sizeof(float));
+        memset(wt_buf, 0, BUFLEN * 2 * sizeof(float));
         if (init_midi)
             memset(midi_buf, 0, midi_buf_size * sizeof(float));
     } else {
         memset(buf_int16, 0, BUFLEN * 2 * sizeof(int16_t));
         memset(cd_buf_int16, 0, CD_BUFLEN * 2 * sizeof(int16_t));
-        memset(music_buf_int16, 0, MUSICBUFLEN * 2 * sizeof(int16_t));
-        memset(wt_buf_int16, 0, WTBUFLEN * 2 * sizeof(int16_t));
+        memset(music_buf_int16, 0, BUFLEN * 2 * sizeof(int16_t));
+        memset(wt_buf_int16, 0, BUFLEN * 2 * sizeof(int16_t));
         if (init_midi)
             memset(midi_buf_int16, 0, midi_buf_size * sizeof(int16_t));
     }
@@ -213,15 +221,15 @@ inital(void)
     for (uint8_t c = 0; c < 4; c++) {
         if (sound_is_float) {
             alBufferData(buffers[c], AL_FORMAT_STEREO_FLOAT32, buf, BUFLEN * 2 * sizeof(float), FREQ);
-            alBufferData(buffers_music[c], AL_FORMAT_STEREO_FLOAT32, music_buf, MUSICBUFLEN * 2 * sizeof(float), MUSIC_FREQ);
-            alBufferData(buffers_wt[c], AL_FORMAT_STEREO_FLOAT32, wt_buf, WTBUFLEN * 2 * sizeof(float), WT_FREQ);
+            alBufferData(buffers_music[c], AL_FORMAT_STEREO_FLOAT32, music_buf, BUFLEN * 2 * sizeof(float), FREQ);
+            alBufferData(buffers_wt[c], AL_FORMAT_STEREO_FLOAT32, wt_buf, BUFLEN * 2 * sizeof(float), FREQ);
             alBufferData(buffers_cd[c], AL_FORMAT_STEREO_FLOAT32, cd_buf, CD_BUFLEN * 2 * sizeof(float), CD_FREQ);
             if (init_midi)
                 alBufferData(buffers_midi[c], AL_FORMAT_STEREO_FLOAT32, midi_buf, midi_buf_size * (int) sizeof(float), midi_freq);
         } else {
             alBufferData(buffers[c], AL_FORMAT_STEREO16, buf_int16, BUFLEN * 2 * sizeof(int16_t), FREQ);
-            alBufferData(buffers_music[c], AL_FORMAT_STEREO16, music_buf_int16, MUSICBUFLEN * 2 * sizeof(int16_t), MUSIC_FREQ);
-            alBufferData(buffers_wt[c], AL_FORMAT_STEREO16, wt_buf_int16, WTBUFLEN * 2 * sizeof(int16_t), WT_FREQ);
+            alBufferData(buffers_music[c], AL_FORMAT_STEREO16, music_buf_int16, BUFLEN * 2 * sizeof(int16_t), FREQ);
+            alBufferData(buffers_wt[c], AL_FORMAT_STEREO16, wt_buf_int16, BUFLEN * 2 * sizeof(int16_t), FREQ);
             alBufferData(buffers_cd[c], AL_FORMAT_STEREO16, cd_buf_int16, CD_BUFLEN * 2 * sizeof(int16_t), CD_FREQ);
             if (init_midi)
                 alBufferData(buffers_midi[c], AL_FORMAT_STEREO16, midi_buf_int16, midi_buf_size * (int) sizeof(int16_t), midi_freq);
@@ -277,6 +285,13 @@ givealbuffer_common(const void *buf, const uint8_t src, const int size, const in
     }
 
     alGetSourcei(source[src], AL_BUFFERS_PROCESSED, &processed);
+    /* Only one of the four buffers left queued on the main output. */
+    if (src == 0) {
+        sound_buffers_low = (processed >= 3);
+        /* A stopped source played everything it had, with no free buffer
+           this one is dropped. */
+        sound_stats_backend(4 - processed, state == 0x1014, processed < 1);
+    }
     if (processed >= 1) {
         const double gain = sound_muted ? 0.0 : pow(10.0, (double) sound_gain / 20.0);
         alListenerf(AL_GAIN, (float) gain);
@@ -301,13 +316,13 @@ givealbuffer(const void *buf)
 void
 givealbuffer_music(const void *buf)
 {
-    givealbuffer_common(buf, 1, MUSICBUFLEN << 1, MUSIC_FREQ);
+    givealbuffer_common(buf, 1, BUFLEN << 1, FREQ);
 }
 
 void
 givealbuffer_wt(const void *buf)
 {
-    givealbuffer_common(buf, 2, WTBUFLEN << 1, WT_FREQ);
+    givealbuffer_common(buf, 2, BUFLEN << 1, FREQ);
 }
 
 void
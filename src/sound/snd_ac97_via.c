@@ -23,6 +23,7 @@
 
 #include <86box/86box.h>
 #include <86box/device.h>
+#include <86box/dma.h>
 #include <86box/io.h>
 #include <86box/mem.h>
 #include <86box/pci.h>
@@ -586,16 +587,23 @@ ac97_via_sgd_process(void *priv)
                          sgd->entry_ptr - 8, sgd->sample_ptr, sgd->sample_count, sgd->entry_flags);
         }
 
+        int bytes = 4;
         if (sgd->id & 0x10) {
             /* Write channel: read data from FIFO. */
             mem_writel_phys(sgd->sample_ptr, *((uint32_t *) &sgd->fifo[sgd->fifo_end & (sizeof(sgd->fifo) - 1)]));
-        } else {
-            /* Read channel: write data to FIFO. */
+        } else if (sgd->always_run) {
+            /* Read channel without FIFO: write data to FIFO one dword at a time. */
             *((uint32_t *) &sgd->fifo[sgd->fifo_end & (sizeof(sgd->fifo) - 1)]) = mem_readl_phys(sgd->sample_ptr);
+        } else {
+            /* Read channel: fill all the room in the FIFO with one bus master read,
+               stopping at the end of the block so its handling below is unchanged. */
+            bytes = (sizeof(sgd->fifo) - (sgd->fifo_end - sgd->fifo_pos)) & ~3;
+            bytes = MAX(MIN(bytes, (sgd->sample_count + 3) & ~3), 4);
+            dma_bm_read_ring(sgd->sample_ptr, sgd->fifo, sizeof(sgd->fifo), sgd->fifo_end, bytes, 4);
         }
-        sgd->fifo_end += 4;
-        sgd->sample_ptr += 4;
-        sgd->sample_count -= 4;
+        sgd->fifo_end += bytes;
+        sgd->sample_ptr += bytes;
+        sgd->sample_count -= bytes;
 
         /* Check if we've hit the end of this block. */
         if (sgd->sample_count <= 0) {
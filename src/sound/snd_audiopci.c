@@ -31,6 +31,7 @@
 
 #include <86box/86box.h>
 #include <86box/device.h>
+#include <86box/dma.h>
 #include <86box/gameport.h>
 #include <86box/io.h>
 #include <86box/mem.h>
@@ -2220,85 +2221,61 @@ es137x_fetch(es137x_t *dev, int dac_nr)
     if (dev->si_cr & (dac_nr ? SI_P2_PAUSE : SI_P1_PAUSE))
         return;
 
-    int format = dac_nr ? ((dev->si_cr >> 2) & 3) : (dev->si_cr & 3);
-    int pos    = dev->dac[dac_nr].buffer_pos & 63;
-    int c;
+    int     format = dac_nr ? ((dev->si_cr >> 2) & 3) : (dev->si_cr & 3);
+    int     pos    = dev->dac[dac_nr].buffer_pos & 63;
+    int     dwords = (format == FORMAT_STEREO_16) ? 4 : 8;
+    int     left   = dev->dac[dac_nr].size - dev->dac[dac_nr].count + 1;
+    uint8_t data[32];
+    int     c;
+
+    /* Fetch the whole burst with one bus master read, stopping at the end of
+       the buffer like the per-dword loop did. */
+    if (left < 1)
+        left = 1;
+    if (dwords > left)
+        dwords = left;
+
+    dma_bm_read(dev->dac[dac_nr].addr, data, dwords << 2, 4);
 
     switch (format) {
         case FORMAT_MONO_8:
-            for (c = 0; c < 32; c += 4) {
-                dev->dac[dac_nr].buffer_l[(pos + c) & 63] = dev->dac[dac_nr].buffer_r[(pos + c) & 63] = (mem_readb_phys(dev->dac[dac_nr].addr) ^ 0x80) << 8;
-                dev->dac[dac_nr].buffer_l[(pos + c + 1) & 63] = dev->dac[dac_nr].buffer_r[(pos + c + 1) & 63] = (mem_readb_phys(dev->dac[dac_nr].addr + 1) ^ 0x80) << 8;
-                dev->dac[dac_nr].buffer_l[(pos + c + 2) & 63] = dev->dac[dac_nr].buffer_r[(pos + c + 2) & 63] = (mem_readb_phys(dev->dac[dac_nr].addr + 2) ^ 0x80) << 8;
-                dev->dac[dac_nr].buffer_l[(pos + c + 3) & 63] = dev->dac[dac_nr].buffer_r[(pos + c + 3) & 63] = (mem_readb_phys(dev->dac[dac_nr].addr + 3) ^ 0x80) << 8;
-                dev->dac[dac_nr].addr += 4;
-
-                dev->dac[dac_nr].buffer_pos_end += 4;
-                dev->dac[dac_nr].count++;
-
-                if (dev->dac[dac_nr].count > dev->dac[dac_nr].size) {
-                    dev->dac[dac_nr].count = 0;
-                    dev->dac[dac_nr].addr  = dev->dac[dac_nr].addr_latch;
-                    break;
-                }
-            }
+            for (c = 0; c < (dwords << 2); c++)
+                dev->dac[dac_nr].buffer_l[(pos + c) & 63] = dev->dac[dac_nr].buffer_r[(pos + c) & 63] = (data[c] ^ 0x80) << 8;
+            dev->dac[dac_nr].buffer_pos_end += dwords << 2;
             break;
 
         case FORMAT_STEREO_8:
-            for (c = 0; c < 16; c += 2) {
-                dev->dac[dac_nr].buffer_l[(pos + c) & 63]     = (mem_readb_phys(dev->dac[dac_nr].addr) ^ 0x80) << 8;
-                dev->dac[dac_nr].buffer_r[(pos + c) & 63]     = (mem_readb_phys(dev->dac[dac_nr].addr + 1) ^ 0x80) << 8;
-                dev->dac[dac_nr].buffer_l[(pos + c + 1) & 63] = (mem_readb_phys(dev->dac[dac_nr].addr + 2) ^ 0x80) << 8;
-                dev->dac[dac_nr].buffer_r[(pos + c + 1) & 63] = (mem_readb_phys(dev->dac[dac_nr].addr + 3) ^ 0x80) << 8;
-                dev->dac[dac_nr].addr += 4;
-
-                dev->dac[dac_nr].buffer_pos_end += 2;
-                dev->dac[dac_nr].count++;
-
-                if (dev->dac[dac_nr].count > dev->dac[dac_nr].size) {
-                    dev->dac[dac_nr].count = 0;
-                    dev->dac[dac_nr].addr  = dev->dac[dac_nr].addr_latch;
-                    break;
-                }
+            for (c = 0; c < (dwords << 1); c++) {
+                dev->dac[dac_nr].buffer_l[(pos + c) & 63] = (data[c << 1] ^ 0x80) << 8;
+                dev->dac[dac_nr].buffer_r[(pos + c) & 63] = (data[(c << 1) + 1] ^ 0x80) << 8;
             }
+            dev->dac[dac_nr].buffer_pos_end += dwords << 1;
             break;
 
         case FORMAT_MONO_16:
-            for (c = 0; c < 16; c += 2) {
-                dev->dac[dac_nr].buffer_l[(pos + c) & 63] = dev->dac[dac_nr].buffer_r[(pos + c) & 63] = mem_readw_phys(dev->dac[dac_nr].addr);
-                dev->dac[dac_nr].buffer_l[(pos + c + 1) & 63] = dev->dac[dac_nr].buffer_r[(pos + c + 1) & 63] = mem_readw_phys(dev->dac[dac_nr].addr + 2);
-                dev->dac[dac_nr].addr += 4;
-
-                dev->dac[dac_nr].buffer_pos_end += 2;
-                dev->dac[dac_nr].count++;
-
-                if (dev->dac[dac_nr].count > dev->dac[dac_nr].size) {
-                    dev->dac[dac_nr].count = 0;
-                    dev->dac[dac_nr].addr  = dev->dac[dac_nr].addr_latch;
-                    break;
-                }
-            }
+            for (c = 0; c < (dwords << 1); c++)
+                dev->dac[dac_nr].buffer_l[(pos + c) & 63] = dev->dac[dac_nr].buffer_r[(pos + c) & 63] = data[c << 1] | (data[(c << 1) + 1] << 8);
+            dev->dac[dac_nr].buffer_pos_end += dwords << 1;
             break;
 
         case FORMAT_STEREO_16:
-            for (c = 0; c < 4; c++) {
-                dev->dac[dac_nr].buffer_l[(pos + c) & 63] = mem_readw_phys(dev->dac[dac_nr].addr);
-                dev->dac[dac_nr].buffer_r[(pos + c) & 63] = mem_readw_phys(dev->dac[dac_nr].addr + 2);
-                dev->dac[dac_nr].addr += 4;
-
-                dev->dac[dac_nr].buffer_pos_end++;
-                dev->dac[dac_nr].count++;
-
-                if (dev->dac[dac_nr].count > dev->dac[dac_nr].size) {
-                    dev->dac[dac_nr].count = 0;
-                    dev->dac[dac_nr].addr  = dev->dac[dac_nr].addr_latch;
-                    break;
-                }
+            for (c = 0; c < dwords; c++) {
+                dev->dac[dac_nr].buffer_l[(pos + c) & 63] = data[c << 2] | (data[(c << 2) + 1] << 8);
+                dev->dac[dac_nr].buffer_r[(pos + c) & 63] = data[(c << 2) + 2] | (data[(c << 2) + 3] << 8);
             }
+            dev->dac[dac_nr].buffer_pos_end += dwords;
             break;
 
         default:
-            break;
+            return;
+    }
+
+    dev->dac[dac_nr].addr += dwords << 2;
+    dev->dac[dac_nr].count += dwords;
+
+    if (dev->dac[dac_nr].count > dev->dac[dac_nr].size) {
+        dev->dac[dac_nr].count = 0;
+        dev->dac[dac_nr].addr  = dev->dac[dac_nr].addr_latch;
     }
 }
 
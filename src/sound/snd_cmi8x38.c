@@ -1081,15 +1081,25 @@ cmi8x38_dma_process(void *priv)
             cmi8x38_log("CMI8x38: Starting DMA %d at %08X (count %04X fragment %04X)\n", dma->id, dma->sample_ptr, dma->frame_count_dma, dma->frame_count_fragment);
         }
 
+        int frames = 1;
         if (dma_status & 0x01) {
             /* Write channel: read data from FIFO. */
             mem_writel_phys(dma->sample_ptr, *((uint32_t *) &dma->fifo[dma->fifo_end & (sizeof(dma->fifo) - 1)]));
-        } else {
-            /* Read channel: write data to FIFO. */
+        } else if (dma->always_run) {
+            /* Read channel without FIFO: write data to FIFO one frame at a time. */
             *((uint32_t *) &dma->fifo[dma->fifo_end & (sizeof(dma->fifo) - 1)]) = mem_readl_phys(dma->sample_ptr);
+        } else {
+            /* Read channel: fill all the room in the FIFO with one bus master read,
+               stopping at the fragment and buffer ends so their handling below is unchanged. */
+            frames = (sizeof(dma->fifo) - (dma->fifo_end - dma->fifo_pos)) >> 2;
+            frames = MIN(frames, dma->frame_count_fragment);
+            frames = MAX(MIN(frames, dma->frame_count_dma), 1);
+            dma_bm_read_ring(dma->sample_ptr, dma->fifo, sizeof(dma->fifo), dma->fifo_end, frames << 2, 4);
         }
-        dma->fifo_end += 4;
-        dma->sample_ptr += 4;
+        dma->fifo_end += frames << 2;
+        dma->sample_ptr += frames << 2;
+        dma->frame_count_fragment -= frames - 1;
+        dma->frame_count_dma -= frames - 1;
 
         /* Check if the fragment size was reached. */
         if (--dma->frame_count_fragment <= 0) {
@@ -1776,7 +1776,26 @@ emu8k_update(emu8k_t *emu8k)
         emu_voice = &emu8k->voice[c];
         buf       = &emu8k->buffer[emu8k->pos * 2];
 
-        for (pos = emu8k->pos; pos < wavetable_pos_global; pos++) {
+        /* A silent voice with its envelope engine off, which is how drivers
+           park unused voices, stays silent for the whole block: only its
+           oscillator address, which the guest can read back, moves. */
+        const int idle = !emu_voice->env_engine_on && !emu_voice->cvcf_curr_volume &&
+                         !emu_voice->vtft_vol_target && !emu_voice->volumeslide.last;
+
+        if (idle) {
+            for (pos = emu8k->pos; pos < wavetable_pos_global; pos++) {
+                emu_voice->addr.addr += ((uint64_t) emu_voice->cpf_curr_pitch) << 18;
+                if (emu_voice->addr.addr >= emu_voice->loop_end.addr) {
+                    emu_voice->addr.int_address -= (emu_voice->loop_end.int_address - emu_voice->loop_start.int_address);
+                    emu_voice->addr.int_address &= EMU8K_MEM_ADDRESS_MASK;
+                }
+
+                emu_voice->cpf_curr_pitch = emu_voice->ptrx_pit_target;
+            }
+            emu_voice->cvcf_curr_filt_ctoff = emu_voice->vtft_filter_target;
+        }
+
+        for (pos = idle ? wavetable_pos_global : emu8k->pos; pos < wavetable_pos_global; pos++) {
             int32_t dat;
 
             if (emu_voice->cvcf_curr_volume) {
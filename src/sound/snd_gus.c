@@ -1042,7 +1042,9 @@ gus_poll_wave(void *priv)
 
     if ((gus->reset & 3) != 3)
         return;
-    for (uint8_t d = 0; d < 32; d++) {
+    /* The GF1 only services the active voices, which is also what sets its
+       output rate, see samp_latch. */
+    for (int d = 0; d < gus->voices; d++) {
         if (!(gus->ctrl[d] & 3)) {
             if (gus->ctrl[d] & 4) {
                 addr = gus->cur[d] >> 9;
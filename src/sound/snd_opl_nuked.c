@@ -38,6 +38,7 @@
  *          Copyright 2013-2020 Alexey Khokholov (Nuke.YKT)
  */
 #include <stdarg.h>
+#include <stdatomic.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -49,6 +50,7 @@
 #include "cpu.h"
 #include <86box/timer.h>
 #include <86box/device.h>
+#include <86box/thread.h>
 #include <86box/snd_opl.h>
 #include <86box/snd_opl_nuked.h>
 
@@ -1460,6 +1462,167 @@ OPL3_GenerateStream(opl3_chip *chip, int32_t *sndptr, uint32_t numsamples)
     }
 }
 
+/*
+ * Threaded synthesis.
+ *
+ * Register writes are recorded together with the sample position they
+ * happened at, in a single producer, single consumer queue, and the
+ * synthesis thread replays them against the chip while generating the
+ * samples in between. This keeps the timers and the status register,
+ * which is all reads ever see, on the CPU thread.
+ *
+ * The synthesis thread is one music buffer behind - update() ends the
+ * current buffer and returns the previous one, which is complete by now
+ * in all but the most overloaded setups. Three buffers are needed, for
+ * the one being handed out, the one being finished and the next one.
+ */
+#define NUKED_QUEUE_SIZE 4096
+#define NUKED_QUEUE_MASK (NUKED_QUEUE_SIZE - 1)
+#define NUKED_QUEUE_END  0xffff
+
+typedef struct nuked_thread_t {
+    thread_t   *thread;
+    event_t    *wake;
+    event_t    *done;
+    atomic_int  run;
+
+    atomic_uint head;      /* Advanced by the CPU thread. */
+    atomic_uint tail;      /* Advanced by the synthesis thread. */
+    atomic_uint completed; /* Buffers finished by the synthesis thread. */
+    uint32_t    ended;     /* Buffers ended by the CPU thread. */
+
+    int           pos;
+    int32_t       buffers[3][MUSICBUFLEN * 2];
+    nuked_write_t queue[NUKED_QUEUE_SIZE];
+} nuked_thread_t;
+
+static void
+nuked_generate(opl3_chip *chip, int32_t *buf, int from, int to)
+{
+    OPL3_GenerateStream(chip, &buf[from * 2], to - from);
+
+    for (; from < to; from++) {
+        buf[from * 2] /= 2;
+        buf[(from * 2) + 1] /= 2;
+    }
+}
+
+/* Replay one queued write, exactly as an immediate write would have been. */
+static void
+nuked_replay_write(nuked_drv_t *dev, int32_t *buf, int *pos, const nuked_write_t *w)
+{
+    if (w->pos > *pos) {
+        nuked_generate(&dev->opl, buf, *pos, w->pos);
+        *pos = w->pos;
+    }
+    OPL3_WriteRegBuffered(&dev->opl, w->reg, w->val);
+    if (w->reg == 0x105)
+        dev->opl.newm = w->val & 0x01;
+}
+
+static void
+nuked_synth_thread(void *priv)
+{
+    nuked_drv_t    *dev = (nuked_drv_t *) priv;
+    nuked_thread_t *t   = dev->thread;
+
+    while (atomic_load(&t->run)) {
+        thread_wait_event(t->wake, -1);
+        thread_reset_event(t->wake);
+
+        uint32_t tail = atomic_load_explicit(&t->tail, memory_order_relaxed);
+        uint32_t head = atomic_load_explicit(&t->head, memory_order_acquire);
+
+        while (tail != head) {
+            const nuked_write_t *w   = &t->queue[tail & NUKED_QUEUE_MASK];
+            uint32_t             cur = atomic_load_explicit(&t->completed, memory_order_relaxed);
+            int32_t             *buf = t->buffers[cur % 3];
+
+            if (w->reg == NUKED_QUEUE_END) {
+                nuked_generate(&dev->opl, buf, t->pos, MUSICBUFLEN);
+                t->pos = 0;
+                atomic_store_explicit(&t->completed, cur + 1, memory_order_release);
+                thread_set_event(t->done);
+            } else
+                nuked_replay_write(dev, buf, &t->pos, w);
+
+            atomic_store_explicit(&t->tail, ++tail, memory_order_release);
+            if (tail == head)
+                head = atomic_load_explicit(&t->head, memory_order_acquire);
+        }
+    }
+}
+
+static void
+nuked_thread_push(nuked_thread_t *t, uint16_t reg, uint8_t val)
+{
+    uint32_t head = atomic_load_explicit(&t->head, memory_order_relaxed);
+
+    /* Only hit if a guest floods the chip with writes, let the thread catch up. */
+    while ((head - atomic_load_explicit(&t->tail, memory_order_acquire)) >= NUKED_QUEUE_SIZE) {
+        thread_set_event(t->wake);
+        thread_wait_event(t->done, 1);
+    }
+
+    t->queue[head & NUKED_QUEUE_MASK].pos = MIN(music_pos_global, MUSICBUFLEN);
+    t->queue[head & NUKED_QUEUE_MASK].reg = reg;
+    t->queue[head & NUKED_QUEUE_MASK].val = val;
+    atomic_store_explicit(&t->head, head + 1, memory_order_release);
+}
+
+static int32_t *
+nuked_thread_update(nuked_thread_t *t)
+{
+    uint32_t n = t->ended++;
+
+    nuked_thread_push(t, NUKED_QUEUE_END, 0x00);
+    thread_set_event(t->wake);
+
+    /* The first buffer handed out is the still silent third one. */
+    while (atomic_load_explicit(&t->completed, memory_order_acquire) < n) {
+        thread_reset_event(t->done);
+        if (atomic_load_explicit(&t->completed, memory_order_acquire) >= n)
+            break;
+        thread_wait_event(t->done, -1);
+    }
+
+    return t->buffers[(n + 2) % 3];
+}
+
+static void
+nuked_thread_start(nuked_drv_t *dev)
+{
+    nuked_thread_t *t = (nuked_thread_t *) calloc(1, sizeof(nuked_thread_t));
+
+    dev->thread = t;
+    dev->flags |= FLAG_THREAD;
+
+    atomic_init(&t->run, 1);
+    atomic_init(&t->head, 0);
+    atomic_init(&t->tail, 0);
+    atomic_init(&t->completed, 0);
+    t->wake   = thread_create_event();
+    t->done   = thread_create_event();
+    t->thread = thread_create_role(nuked_synth_thread, dev, THREAD_ROLE_AUDIO);
+}
+
+static void
+nuked_thread_stop(nuked_drv_t *dev)
+{
+    nuked_thread_t *t = dev->thread;
+
+    atomic_store(&t->run, 0);
+    thread_set_event(t->wake);
+    thread_wait(t->thread);
+
+    thread_destroy_event(t->wake);
+    thread_destroy_event(t->done);
+    free(t);
+
+    dev->thread = NULL;
+    dev->flags &= ~FLAG_THREAD;
+}
+
 static void
 nuked_timer_tick(nuked_drv_t *dev, int tmr)
 {
@@ -1541,6 +1704,9 @@ nuked_drv_init(const device_t *info)
     timer_add(&dev->timers[0], nuked_timer_1, dev, 0);
     timer_add(&dev->timers[1], nuked_timer_2, dev, 0);
 
+    if (fm_synth_thread)
+        nuked_thread_start(dev);
+
     return dev;
 }
 
@@ -1548,6 +1714,10 @@ static void
 nuked_drv_close(void *priv)
 {
     nuked_drv_t *dev = (nuked_drv_t *) priv;
+
+    if (dev->thread)
+        nuked_thread_stop(dev);
+
     free(dev);
 }
 
@@ -1556,17 +1726,20 @@ nuked_drv_update(void *priv)
 {
     nuked_drv_t *dev = (nuked_drv_t *) priv;
 
+    if (dev->flags & FLAG_THREAD)
+        return nuked_thread_update(dev->thread);
+
+    /* Writes are batched until the buffer is needed, then the whole run
+       between two writes is generated in one go. */
+    for (int i = 0; i < dev->queued; i++)
+        nuked_replay_write(dev, dev->buffer, &dev->pos, &dev->batch[i]);
+    dev->queued = 0;
+
     if (dev->pos >= music_pos_global)
         return dev->buffer;
 
-    OPL3_GenerateStream(&dev->opl,
-                          &dev->buffer[dev->pos * 2],
-                          music_pos_global - dev->pos);
-
-    for (; dev->pos < music_pos_global; dev->pos++) {
-        dev->buffer[dev->pos * 2] /= 2;
-        dev->buffer[(dev->pos * 2) + 1] /= 2;
-    }
+    nuked_generate(&dev->opl, dev->buffer, dev->pos, music_pos_global);
+    dev->pos = music_pos_global;
 
     return dev->buffer;
 }
@@ -1579,8 +1752,7 @@ nuked_drv_read(uint16_t port, void *priv)
     if (dev->flags & FLAG_CYCLES)
         cycles -= ((int) (isa_timing * 8));
 
-    nuked_drv_update(dev);
-
+    /* The status register does not depend on synthesis state. */
     uint8_t ret = 0xff;
 
     if ((port & 0x0003) == 0x0000) {
@@ -1598,10 +1770,19 @@ static void
 nuked_drv_write(uint16_t port, uint8_t val, void *priv)
 {
     nuked_drv_t *dev = (nuked_drv_t *) priv;
-    nuked_drv_update(dev);
 
     if ((port & 0x0001) == 0x0001) {
-        OPL3_WriteRegBuffered(&dev->opl, dev->port, val);
+        if (dev->flags & FLAG_THREAD)
+            nuked_thread_push(dev->thread, dev->port, val);
+        else {
+            if (dev->queued == NUKED_BATCH_SIZE)
+                nuked_drv_update(dev);
+
+            dev->batch[dev->queued].pos = MIN(music_pos_global, MUSICBUFLEN);
+            dev->batch[dev->queued].reg = dev->port;
+            dev->batch[dev->queued].val = val;
+            dev->queued++;
+        }
 
         switch (dev->port) {
             case 0x002: /* Timer 1 */
@@ -1627,14 +1808,17 @@ nuked_drv_write(uint16_t port, uint8_t val, void *priv)
                 break;
 
             case 0x105:
-                dev->opl.newm = val & 0x01;
+                /* The chip itself only sees the write once it is replayed. */
+                dev->newm = val & 0x01;
                 break;
 
             default:
                 break;
         }
     } else {
-        dev->port = nuked_write_addr(&dev->opl, port, val) & 0x01ff;
+        dev->port = val;
+        if ((port & 0x0002) && ((val == 0x05) || dev->newm))
+            dev->port |= 0x0100;
 
         if (!(dev->flags & FLAG_OPL3))
             dev->port &= 0x00ff;
@@ -18,6 +18,8 @@
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <unordered_map>
+#include <vector>
 #include "ymfm/ymfm_ssg.h"
 #include "ymfm/ymfm_misc.h"
 #include "ymfm/ymfm_opl.h"
@@ -116,6 +118,15 @@ public:
             if (rom_load_linear("roms/sound/yamaha/yrw801.rom", 0, 0x200000, 0, m_yrw801) == 0) {
                 fatal("YRW801 ROM image \"roms/sound/yamaha/yrw801.rom\" not found\n");
             }
+
+            /* Decode the waves of the built-in headers up front. */
+            for (uint32_t wavnum = 0; wavnum < 384; wavnum++) {
+                const uint8_t *header  = &m_yrw801[wavnum * 12];
+                const uint32_t endpos  = (0x10000 - ((header[5] << 8) | header[6])) & 0xffff;
+
+                (void) ymfm_external_pcm_decoded(((header[0] & 0x3f) << 16) | (header[1] << 8) | header[2],
+                                                 header[0] >> 6, endpos + 1);
+            }
         }
 
         timer_add(&m_timers[0], YMFMChip::timer1, this, 0);
@@ -270,7 +281,48 @@ public:
         return 0xFF;
     }
 
+    /* The YRW801 is read-only, so every wave only needs to be decoded once. */
+    virtual const int16_t *ymfm_external_pcm_decoded(uint32_t baseaddr, uint8_t format, uint32_t samples) override
+    {
+        if (m_type != FM_YMF278B)
+            return nullptr;
+
+        const uint64_t key = ((uint64_t) samples << 32) | (format << 24) | baseaddr;
+        auto           it  = m_decoded.find(key);
+
+        if (it != m_decoded.end())
+            return it->second.data();
+
+        std::vector<int16_t> &wave = m_decoded[key];
+
+        wave.resize(samples);
+        for (uint32_t pos = 0; pos < samples; pos++) {
+            uint32_t addr;
+
+            /* Same as pcm_channel::fetch_sample(). */
+            if (format == 0)
+                wave[pos] = yrw801_read(baseaddr + pos) << 8;
+            else if (format == 2) {
+                addr      = baseaddr + (pos * 2);
+                wave[pos] = (yrw801_read(addr) << 8) | yrw801_read(addr + 1);
+            } else {
+                addr = baseaddr + ((pos / 2) * 3);
+                if (pos & 1)
+                    wave[pos] = (yrw801_read(addr + 2) << 8) | (yrw801_read(addr + 1) & 0xf0);
+                else
+                    wave[pos] = (yrw801_read(addr) << 8) | ((yrw801_read(addr + 1) << 4) & 0xf0);
+            }
+        }
+
+        return wave.data();
+    }
+
 private:
+    uint8_t yrw801_read(uint32_t address) const
+    {
+        return (address < 0x200000) ? m_yrw801[address] : 0xFF;
+    }
+
     ChipType                       m_chip;
     uint32_t                       m_clock;
     double                         m_clock_us;
@@ -283,6 +335,9 @@ private:
     // YRW801-M wavetable ROM.
     uint8_t m_yrw801[0x200000];
 
+    // Its waves decoded to 16-bit, by length, format and base address.
+    std::unordered_map<uint64_t, std::vector<int16_t>> m_decoded;
+
     // Resampling
     int32_t m_rateratio;
     int32_t m_samplecnt;
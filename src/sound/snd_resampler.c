@@ -0,0 +1,264 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Shared windowed-sinc polyphase resampler.
+ *
+ *          The ratio between the two rates is reduced to out/in = L/M,
+ *          and one set of filter taps is precomputed for each of the L
+ *          output phases. Coefficient banks are shared between all
+ *          resamplers running at the same ratio.
+ */
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <86box/86box.h>
+#include <86box/snd_resampler.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#    define RESAMPLER_SSE2
+#    include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#    define RESAMPLER_NEON
+#    include <arm_neon.h>
+#endif
+
+#define RESAMPLER_TAPS       32
+#define RESAMPLER_HALF       (RESAMPLER_TAPS / 2)
+#define RESAMPLER_MAX_PHASES 8192
+#define RESAMPLER_BANKS      4
+
+/* Cutoff relative to the lower of the two Nyquist frequencies, leaving room
+   for the transition band of a 32 tap filter. */
+#define RESAMPLER_CUTOFF 0.92
+
+typedef struct resampler_bank_t {
+    int    phases;
+    int    step;
+    int    refs;
+    float *coef;
+} resampler_bank_t;
+
+struct resampler_t {
+    resampler_bank_t *bank;
+
+    int pos;
+    int phase;
+    int filled;
+    int size;
+
+    float *buf[2];
+};
+
+static resampler_bank_t banks[RESAMPLER_BANKS];
+
+static int
+resampler_gcd(int a, int b)
+{
+    while (b) {
+        int t = a % b;
+
+        a = b;
+        b = t;
+    }
+
+    return a;
+}
+
+static void
+resampler_bank_fill(resampler_bank_t *bank)
+{
+    double fc = RESAMPLER_CUTOFF * ((bank->phases < bank->step) ? ((double) bank->phases / (double) bank->step) : 1.0);
+
+    for (int p = 0; p < bank->phases; p++) {
+        float *h   = &bank->coef[p * RESAMPLER_TAPS];
+        double sum = 0.0;
+
+        for (int k = 0; k < RESAMPLER_TAPS; k++) {
+            /* Distance from the output position to tap k, in input samples. */
+            double d = (double) (k - (RESAMPLER_HALF - 1)) - ((double) p / (double) bank->phases);
+            double x = d / (double) RESAMPLER_HALF;
+            double w = 0.42 + (0.5 * cos(M_PI * x)) + (0.08 * cos(2.0 * M_PI * x));
+            double s = (d == 0.0) ? 1.0 : (sin(M_PI * fc * d) / (M_PI * fc * d));
+
+            h[k] = (float) (s * w);
+            sum += s * w;
+        }
+
+        /* Unity gain at DC for every phase. */
+        for (int k = 0; k < RESAMPLER_TAPS; k++)
+            h[k] = (float) (h[k] / sum);
+    }
+}
+
+static resampler_bank_t *
+resampler_bank_get(int phases, int step)
+{
+    resampler_bank_t *free_bank = NULL;
+
+    for (int i = 0; i < RESAMPLER_BANKS; i++) {
+        if (banks[i].refs && (banks[i].phases == phases) && (banks[i].step == step)) {
+            banks[i].refs++;
+            return &banks[i];
+        } else if (!banks[i].refs && (free_bank == NULL))
+            free_bank = &banks[i];
+    }
+
+    if (free_bank == NULL)
+        fatal("resampler: Too many sample rate ratios\n");
+
+    free_bank->coef = (float *) malloc(phases * RESAMPLER_TAPS * sizeof(float));
+    if (free_bank->coef == NULL)
+        fatal("resampler: Out of memory\n");
+
+    free_bank->phases = phases;
+    free_bank->step   = step;
+    free_bank->refs   = 1;
+    resampler_bank_fill(free_bank);
+
+    return free_bank;
+}
+
+static void
+resampler_bank_put(resampler_bank_t *bank)
+{
+    if (--bank->refs)
+        return;
+
+    free(bank->coef);
+    bank->coef = NULL;
+}
+
+static __inline float
+resampler_dot(const float *x, const float *h)
+{
+#if defined(RESAMPLER_SSE2)
+    __m128 acc = _mm_setzero_ps();
+
+    for (int k = 0; k < RESAMPLER_TAPS; k += 4)
+        acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(&x[k]), _mm_loadu_ps(&h[k])));
+    acc = _mm_add_ps(acc, _mm_movehl_ps(acc, acc));
+    acc = _mm_add_ss(acc, _mm_shuffle_ps(acc, acc, 1));
+
+    return _mm_cvtss_f32(acc);
+#elif defined(RESAMPLER_NEON)
+    float32x4_t acc = vdupq_n_f32(0.0f);
+    float32x2_t sum;
+
+    for (int k = 0; k < RESAMPLER_TAPS; k += 4)
+        acc = vmlaq_f32(acc, vld1q_f32(&x[k]), vld1q_f32(&h[k]));
+    sum = vadd_f32(vget_low_f32(acc), vget_high_f32(acc));
+
+    return vget_lane_f32(vpadd_f32(sum, sum), 0);
+#else
+    float acc = 0.0f;
+
+    for (int k = 0; k < RESAMPLER_TAPS; k++)
+        acc += x[k] * h[k];
+
+    return acc;
+#endif
+}
+
+resampler_t *
+resampler_init(int in_freq, int out_freq, int max_in)
+{
+    resampler_t *rs     = (resampler_t *) calloc(1, sizeof(resampler_t));
+    int          gcd    = resampler_gcd(in_freq, out_freq);
+    int          phases = out_freq / gcd;
+    int          step   = in_freq / gcd;
+
+    /* Ratios that do not reduce far enough are approximated. */
+    if (phases > RESAMPLER_MAX_PHASES) {
+        step   = (int) (((int64_t) in_freq * RESAMPLER_MAX_PHASES + (out_freq / 2)) / out_freq);
+        phases = RESAMPLER_MAX_PHASES;
+    }
+
+    rs->bank   = resampler_bank_get(phases, step);
+    rs->size   = RESAMPLER_TAPS + (max_in * 2);
+    rs->buf[0] = (float *) calloc(rs->size, sizeof(float));
+    rs->buf[1] = (float *) calloc(rs->size, sizeof(float));
+    resampler_reset(rs);
+
+    return rs;
+}
+
+void
+resampler_close(resampler_t *rs)
+{
+    if (rs == NULL)
+        return;
+
+    resampler_bank_put(rs->bank);
+    free(rs->buf[0]);
+    free(rs->buf[1]);
+    free(rs);
+}
+
+void
+resampler_reset(resampler_t *rs)
+{
+    memset(rs->buf[0], 0x00, rs->size * sizeof(float));
+    memset(rs->buf[1], 0x00, rs->size * sizeof(float));
+
+    /* Start with half a filter of silence so the first output has history. */
+    rs->pos    = RESAMPLER_HALF - 1;
+    rs->phase  = 0;
+    rs->filled = RESAMPLER_HALF - 1;
+}
+
+int
+resampler_max_out(const resampler_t *rs, int in_frames)
+{
+    return (int) (((int64_t) (in_frames + RESAMPLER_TAPS) * rs->bank->phases) / rs->bank->step) + 1;
+}
+
+int
+resampler_process(resampler_t *rs, const int32_t *in, int in_frames, int32_t *out)
+{
+    const resampler_bank_t *bank = rs->bank;
+    int                     n    = 0;
+    int                     keep;
+
+    if (in_frames > (rs->size - rs->filled))
+        in_frames = rs->size - rs->filled;
+
+    for (int c = 0; c < in_frames; c++) {
+        rs->buf[0][rs->filled + c] = (float) in[c * 2];
+        rs->buf[1][rs->filled + c] = (float) in[(c * 2) + 1];
+    }
+    rs->filled += in_frames;
+
+    while ((rs->pos + RESAMPLER_HALF) < rs->filled) {
+        const float *h     = &bank->coef[rs->phase * RESAMPLER_TAPS];
+        int          first = rs->pos - (RESAMPLER_HALF - 1);
+
+        out[n * 2]       = (int32_t) lrintf(resampler_dot(&rs->buf[0][first], h));
+        out[(n * 2) + 1] = (int32_t) lrintf(resampler_dot(&rs->buf[1][first], h));
+        n++;
+
+        rs->phase += bank->step;
+        rs->pos += rs->phase / bank->phases;
+        rs->phase %= bank->phases;
+    }
+
+    /* Keep the history the next output still needs. */
+    keep = rs->pos - (RESAMPLER_HALF - 1);
+    if (keep > 0) {
+        if (keep > rs->filled)
+            keep = rs->filled;
+        memmove(rs->buf[0], &rs->buf[0][keep], (rs->filled - keep) * sizeof(float));
+        memmove(rs->buf[1], &rs->buf[1][keep], (rs->filled - keep) * sizeof(float));
+        rs->filled -= keep;
+        rs->pos -= keep;
+    }
+
+    return n;
+}
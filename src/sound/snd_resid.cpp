@@ -1,39 +1,181 @@
+#include <atomic>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
 #include "resid-fp/sid.h"
+extern "C" {
+#include <86box/86box.h>
 #include <86box/plat.h>
+#include <86box/thread.h>
+#include <86box/sound.h>
+}
 #include <86box/snd_resid.h>
 
 #define RESID_FREQ 48000
 
+/*
+ * With its own thread, register writes are queued with the sample position
+ * they happened at and the thread replays them while clocking the SID in
+ * between, the same way the threaded Nuked OPL driver works. The thread is
+ * one sound buffer behind. Reads sync with the thread first, as the
+ * oscillator 3 and envelope 3 registers depend on the synthesis state.
+ */
+#define SID_QUEUE_SIZE 4096
+#define SID_QUEUE_MASK (SID_QUEUE_SIZE - 1)
+
+enum {
+    SID_EV_WRITE = 0,
+    SID_EV_RESET,
+    SID_EV_SYNC,
+    SID_EV_END
+};
+
 using reSIDfp::SID;
 
+typedef struct sid_event_t {
+    uint16_t pos;
+    uint8_t  type;
+    uint8_t  reg;
+    uint8_t  val;
+} sid_event_t;
+
 typedef struct psid_t {
     /* resid sid implementation */
     SID    *sid;
     int16_t last_sample;
+
+    /* Only used when running on its own thread. */
+    int                   threaded;
+    thread_t             *thread;
+    event_t              *wake;
+    event_t              *done;
+    std::atomic<int>      run;
+    std::atomic<uint32_t> head;      /* Advanced by the CPU thread. */
+    std::atomic<uint32_t> tail;      /* Advanced by the SID thread. */
+    std::atomic<uint32_t> completed; /* Buffers finished by the SID thread. */
+    uint32_t              ended;     /* Buffers ended by the CPU thread. */
+    int                   pos;
+    int16_t               buffers[3][SOUNDBUFLEN];
+    sid_event_t           queue[SID_QUEUE_SIZE];
 } psid_t;
 
-psid_t *psid;
+#define CLOCK_DELTA(n) (int) (((14318180.0 * n) / 16.0) / (float) RESID_FREQ)
+
+static void
+fillbuf2(psid_t *psid, int &count, int16_t *buf, UNUSED(int len))
+{
+    int c = psid->sid->clock(count, buf);
+
+    if (!c)
+        *buf = psid->last_sample;
+    psid->last_sample = *buf;
+}
+
+static void
+sid_generate(psid_t *psid, int16_t *buf, int len)
+{
+    int x = CLOCK_DELTA(len);
+
+    fillbuf2(psid, x, buf, len);
+}
+
+static void
+sid_thread(void *priv)
+{
+    psid_t *psid = (psid_t *) priv;
+
+    while (psid->run.load()) {
+        thread_wait_event(psid->wake, -1);
+        thread_reset_event(psid->wake);
+
+        uint32_t tail = psid->tail.load(std::memory_order_relaxed);
+        uint32_t head = psid->head.load(std::memory_order_acquire);
+
+        while (tail != head) {
+            const sid_event_t *ev  = &psid->queue[tail & SID_QUEUE_MASK];
+            uint32_t           cur = psid->completed.load(std::memory_order_relaxed);
+            int16_t           *buf = psid->buffers[cur % 3];
+            uint8_t            type = ev->type;
+
+            if (ev->pos > psid->pos) {
+                sid_generate(psid, &buf[psid->pos], ev->pos - psid->pos);
+                psid->pos = ev->pos;
+            }
+
+            if (type == SID_EV_WRITE)
+                psid->sid->write(ev->reg, ev->val);
+            else if (type == SID_EV_RESET) {
+                psid->sid->reset();
+                for (uint8_t c = 0; c < 32; c++)
+                    psid->sid->write(c, 0);
+            } else if (type == SID_EV_END) {
+                psid->pos = 0;
+                psid->completed.store(cur + 1, std::memory_order_release);
+            }
+
+            psid->tail.store(++tail, std::memory_order_release);
+            if (type >= SID_EV_SYNC)
+                thread_set_event(psid->done);
+            if (tail == head)
+                head = psid->head.load(std::memory_order_acquire);
+        }
+    }
+}
+
+static uint32_t
+sid_thread_push(psid_t *psid, uint8_t type, uint16_t pos, uint8_t reg, uint8_t val)
+{
+    uint32_t head = psid->head.load(std::memory_order_relaxed);
+
+    /* Only hit if a guest floods the chip with writes, let the thread catch up. */
+    while ((head - psid->tail.load(std::memory_order_acquire)) >= SID_QUEUE_SIZE) {
+        thread_set_event(psid->wake);
+        thread_wait_event(psid->done, 1);
+    }
+
+    psid->queue[head & SID_QUEUE_MASK].pos  = pos;
+    psid->queue[head & SID_QUEUE_MASK].type = type;
+    psid->queue[head & SID_QUEUE_MASK].reg  = reg;
+    psid->queue[head & SID_QUEUE_MASK].val  = val;
+    psid->head.store(head + 1, std::memory_order_release);
+
+    return head;
+}
+
+/* Wait until the thread has handled everything up to and including the
+   event at index idx. */
+static void
+sid_thread_wait(psid_t *psid, uint32_t idx)
+{
+    thread_set_event(psid->wake);
+
+    while ((int32_t) (psid->tail.load(std::memory_order_acquire) - idx) <= 0) {
+        thread_reset_event(psid->done);
+        if ((int32_t) (psid->tail.load(std::memory_order_acquire) - idx) > 0)
+            break;
+        thread_wait_event(psid->done, -1);
+    }
+}
 
 void *
-sid_init(uint8_t type)
+sid_init(uint8_t type, int decimate, int filter, int threaded)
 {
-    reSIDfp::SamplingMethod method         = reSIDfp::RESAMPLE;
+    reSIDfp::SamplingMethod method         = decimate ? reSIDfp::DECIMATE : reSIDfp::RESAMPLE;
     float                   cycles_per_sec = 14318180.0 / 16.0;
 
-    psid      = new psid_t;
-    psid->sid = new SID;
+    psid_t *psid = new psid_t();
+    psid->sid    = new SID;
 
     switch (type) {
         default:
         case 0:
             psid->sid->setChipModel(reSIDfp::MOS6581);
+            break;
         case 1:
             psid->sid->setChipModel(reSIDfp::MOS8580);
+            break;
     }
 
     psid->sid->reset();
@@ -49,23 +191,48 @@ sid_init(uint8_t type)
 #endif
     }
 
+    psid->sid->enableFilter(!!filter);
     psid->sid->input(0);
 
+    if (threaded) {
+        psid->threaded = 1;
+        psid->run.store(1);
+        psid->wake   = thread_create_event();
+        psid->done   = thread_create_event();
+        psid->thread = thread_create_role(sid_thread, psid, THREAD_ROLE_AUDIO);
+    }
+
     return (void *) psid;
 }
 
 void
-sid_close(UNUSED(void *priv))
+sid_close(void *priv)
 {
+    psid_t *psid = (psid_t *) priv;
+
+    if (psid->threaded) {
+        psid->run.store(0);
+        thread_set_event(psid->wake);
+        thread_wait(psid->thread);
+
+        thread_destroy_event(psid->wake);
+        thread_destroy_event(psid->done);
+    }
+
     delete psid->sid;
-#if 0
-    free(psid);
-#endif
+    delete psid;
 }
 
 void
-sid_reset(UNUSED(void *priv))
+sid_reset(void *priv)
 {
+    psid_t *psid = (psid_t *) priv;
+
+    if (psid->threaded) {
+        sid_thread_push(psid, SID_EV_RESET, MIN(sound_pos_global, SOUNDBUFLEN), 0, 0);
+        return;
+    }
+
     psid->sid->reset();
 
     for (uint8_t c = 0; c < 32; c++)
@@ -73,32 +240,59 @@ sid_reset(UNUSED(void *priv))
 }
 
 uint8_t
-sid_read(uint16_t addr, UNUSED(void *priv))
+sid_read(uint16_t addr, void *priv)
 {
+    psid_t *psid = (psid_t *) priv;
+
+    if (psid->threaded)
+        sid_thread_wait(psid, sid_thread_push(psid, SID_EV_SYNC, MIN(sound_pos_global, SOUNDBUFLEN), 0, 0));
+
     return psid->sid->read(addr & 0x1f);
 }
 
 void
-sid_write(uint16_t addr, uint8_t val, UNUSED(void *priv))
+sid_write(uint16_t addr, uint8_t val, void *priv)
 {
-    psid->sid->write(addr & 0x1f, val);
-}
+    psid_t *psid = (psid_t *) priv;
 
-#define CLOCK_DELTA(n) (int) (((14318180.0 * n) / 16.0) / (float) RESID_FREQ)
+    if (psid->threaded)
+        sid_thread_push(psid, SID_EV_WRITE, MIN(sound_pos_global, SOUNDBUFLEN), addr & 0x1f, val);
+    else
+        psid->sid->write(addr & 0x1f, val);
+}
 
-static void
-fillbuf2(int &count, int16_t *buf, UNUSED(int len))
+void
+sid_fillbuf(int16_t *buf, int len, void *priv)
 {
-    int c = psid->sid->clock(count, buf);
+    psid_t *psid = (psid_t *) priv;
 
-    if (!c)
-        *buf = psid->last_sample;
-    psid->last_sample = *buf;
+    /* The thread generates the samples itself. */
+    if (psid->threaded)
+        return;
+
+    sid_generate(psid, buf, len);
 }
+
 void
-sid_fillbuf(int16_t *buf, int len, UNUSED(void *priv))
+sid_end_buffer(int16_t *buf, int len, void *priv)
 {
-    int x = CLOCK_DELTA(len);
+    psid_t *psid = (psid_t *) priv;
+
+    if (!psid->threaded)
+        return;
+
+    uint32_t n = psid->ended++;
+
+    sid_thread_push(psid, SID_EV_END, len, 0, 0);
+    thread_set_event(psid->wake);
+
+    /* The first buffer handed out is the still silent third one. */
+    while (psid->completed.load(std::memory_order_acquire) < n) {
+        thread_reset_event(psid->done);
+        if (psid->completed.load(std::memory_order_acquire) >= n)
+            break;
+        thread_wait_event(psid->done, -1);
+    }
 
-    fillbuf2(x, buf, len);
+    memcpy(buf, psid->buffers[(n + 2) % 3], len * sizeof(int16_t));
 }
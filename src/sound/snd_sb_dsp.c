@@ -836,18 +836,16 @@ sb_16_read_dma(void *priv)
         } else
             /* High DMA channel disabled, always use the first 8-bit channel. */
             dma_ch = dsp->sb_8_dmanum;
-        int temp = dma_channel_read(dma_ch);
-        ret  = temp;
-        if ((temp != DMA_NODATA) && !(temp & DMA_OVER)) {
-            temp = dma_channel_read(dma_ch);
-            if (temp == DMA_NODATA)
-                ret = DMA_NODATA;
-            else {
-                const int dma_flags = temp & DMA_OVER;
-                temp &= ~DMA_OVER;
-                ret |= (temp << 8) | dma_flags;
-            }
-        }
+        uint16_t data[2];
+        int      temp = dma_channel_read_n(dma_ch, data, 2);
+
+        /* Terminal count on the low byte ends the transfer there. */
+        if (temp == DMA_NODATA)
+            ret = DMA_NODATA;
+        else if ((temp & 0xffff) == 1)
+            ret = data[0] | (temp & DMA_OVER);
+        else
+            ret = data[0] | (data[1] << 8) | (temp & DMA_OVER);
     }
 
     return ret;
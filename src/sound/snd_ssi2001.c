@@ -41,6 +41,7 @@ ssi2001_get_buffer(int32_t *buffer, int len, void *priv)
     ssi2001_t *ssi2001 = (ssi2001_t *) priv;
 
     ssi2001_update(ssi2001);
+    sid_end_buffer(ssi2001->buffer, len, ssi2001->psid);
 
     for (int c = 0; c < len * 2; c++)
         buffer[c] += ssi2001->buffer[c >> 1] / 2;
@@ -55,7 +56,7 @@ ssi2001_read(uint16_t addr, void *priv)
 
     ssi2001_update(ssi2001);
 
-    return sid_read(addr, priv);
+    return sid_read(addr, ssi2001->psid);
 }
 
 static void
@@ -64,7 +65,7 @@ ssi2001_write(uint16_t addr, uint8_t val, void *priv)
     ssi2001_t *ssi2001 = (ssi2001_t *) priv;
 
     ssi2001_update(ssi2001);
-    sid_write(addr, val, priv);
+    sid_write(addr, val, ssi2001->psid);
 }
 
 void *
@@ -72,7 +73,8 @@ ssi2001_init(UNUSED(const device_t *info))
 {
     ssi2001_t *ssi2001 = calloc(1, sizeof(ssi2001_t));
 
-    ssi2001->psid = sid_init(0);
+    ssi2001->psid = sid_init(0, device_get_config_int("sid_sampling"), device_get_config_int("sid_filter"),
+                             device_get_config_int("sid_thread"));
     sid_reset(ssi2001->psid);
     uint16_t addr             = device_get_config_hex16("base");
     ssi2001->gameport_enabled = device_get_config_int("gameport");
@@ -112,7 +114,8 @@ entertainer_init(UNUSED(const device_t *info))
     ssi2001_t     *ssi2001     = calloc(1, sizeof(ssi2001_t));
     entertainer_t *entertainer = calloc(1, sizeof(entertainer_t));
 
-    ssi2001->psid = sid_init(0);
+    ssi2001->psid = sid_init(0, device_get_config_int("sid_sampling"), device_get_config_int("sid_filter"),
+                             device_get_config_int("sid_thread"));
     sid_reset(ssi2001->psid);
     ssi2001->gameport_enabled = device_get_config_int("gameport");
     io_sethandler(0x200, 0x0001, entertainer_read, NULL, NULL, entertainer_write, NULL, NULL, entertainer);
@@ -163,6 +166,43 @@ static const device_config_t ssi2001_config[] = {
         .selection      = { { 0 } },
         .bios           = { { 0 } }
     },
+    {
+        .name           = "sid_sampling",
+        .description    = "SID sampling",
+        .type           = CONFIG_SELECTION,
+        .default_string = NULL,
+        .default_int    = 0,
+        .file_filter    = NULL,
+        .spinner        = { 0 },
+        .selection      = {
+            { .description = "Resample (accurate)", .value = 0 },
+            { .description = "Decimate (fast)",     .value = 1 },
+            { .description = ""                                }
+        },
+        .bios           = { { 0 } }
+    },
+    {
+        .name           = "sid_filter",
+        .description    = "Emulate SID filter",
+        .type           = CONFIG_BINARY,
+        .default_string = NULL,
+        .default_int    = 1,
+        .file_filter    = NULL,
+        .spinner        = { 0 },
+        .selection      = { { 0 } },
+        .bios           = { { 0 } }
+    },
+    {
+        .name           = "sid_thread",
+        .description    = "Run SID emulation on its own thread",
+        .type           = CONFIG_BINARY,
+        .default_string = NULL,
+        .default_int    = 0,
+        .file_filter    = NULL,
+        .spinner        = { 0 },
+        .selection      = { { 0 } },
+        .bios           = { { 0 } }
+    },
     { .name = "", .description = "", .type = CONFIG_END }
 // clang-format off
 };
@@ -180,6 +220,43 @@ static const device_config_t entertainer_config[] = {
         .selection      = { { 0 } },
         .bios           = { { 0 } }
     },
+    {
+        .name           = "sid_sampling",
+        .description    = "SID sampling",
+        .type           = CONFIG_SELECTION,
+        .default_string = NULL,
+        .default_int    = 0,
+        .file_filter    = NULL,
+        .spinner        = { 0 },
+        .selection      = {
+            { .description = "Resample (accurate)", .value = 0 },
+            { .description = "Decimate (fast)",     .value = 1 },
+            { .description = ""                                }
+        },
+        .bios           = { { 0 } }
+    },
+    {
+        .name           = "sid_filter",
+        .description    = "Emulate SID filter",
+        .type           = CONFIG_BINARY,
+        .default_string = NULL,
+        .default_int    = 1,
+        .file_filter    = NULL,
+        .spinner        = { 0 },
+        .selection      = { { 0 } },
+        .bios           = { { 0 } }
+    },
+    {
+        .name           = "sid_thread",
+        .description    = "Run SID emulation on its own thread",
+        .type           = CONFIG_BINARY,
+        .default_string = NULL,
+        .default_int    = 0,
+        .file_filter    = NULL,
+        .spinner        = { 0 },
+        .selection      = { { 0 } },
+        .bios           = { { 0 } }
+    },
     { .name = "", .description = "", .type = CONFIG_END }
 // clang-format off
 };
@@ -35,7 +35,19 @@
 #include <86box/snd_ac97.h>
 #include <86box/timer.h>
 #include <86box/snd_mpu401.h>
+#include <86box/snd_resampler.h>
 #include <86box/sound.h>
+#include <86box/bench.h>
+#include <86box/perf.h>
+#include <minitrace/minitrace.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#    define SOUND_SSE2
+#    include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#    define SOUND_NEON
+#    include <arm_neon.h>
+#endif
 
 typedef struct {
     const device_t *device;
@@ -44,6 +56,9 @@ typedef struct {
 typedef struct {
     void (*get_buffer)(int32_t *buffer, int len, void *priv);
     void *priv;
+
+    const char *name;
+    uint64_t    host_time;
 } sound_handler_t;
 
 int sound_card_current[SOUND_CARD_MAX] = { 0, 0, 0, 0 };
@@ -51,6 +66,10 @@ int sound_pos_global                   = 0;
 int music_pos_global                   = 0;
 int wavetable_pos_global               = 0;
 int sound_gain                         = 0;
+int sound_buffers_low                  = 0; /* set by the backend when output is about to run dry */
+int sound_buf_len                      = SOUNDBUFLEN;
+
+sound_stats_t sound_stats;
 
 static sound_handler_t sound_handlers[8];
 
@@ -71,6 +90,12 @@ static int16_t   *outbuffer_m_ex_int16;
 static int32_t   *outbuffer_w;
 static float     *outbuffer_w_ex;
 static int16_t   *outbuffer_w_ex_int16;
+static int32_t   *music_fifo;
+static int32_t   *wavetable_fifo;
+static int        music_fifo_pos;
+static int        wavetable_fifo_pos;
+static resampler_t *music_resampler;
+static resampler_t *wavetable_resampler;
 static int        sound_handlers_num;
 static int        music_handlers_num;
 static int        wavetable_handlers_num;
@@ -84,6 +109,10 @@ static uint64_t   wavetable_poll_latch;
 static int16_t      cd_buffer[CDROM_NUM][CD_BUFLEN * 2];
 static float        cd_out_buffer[CD_BUFLEN * 2];
 static int16_t      cd_out_buffer_int16[CD_BUFLEN * 2];
+static double       cd_buffer_temp[CD_BUFLEN * 2];
+static biquad_t     cd_deemph[CDROM_NUM];
+static uint32_t     sound_stats_ticks;
+static uint32_t     sound_stats_buffers;
 static unsigned int cd_vol_l;
 static unsigned int cd_vol_r;
 static int          cd_buf_update    = CD_BUFLEN / SOUNDBUFLEN;
@@ -254,11 +283,12 @@ sound_cd_clean_buffers(void)
 static void
 sound_cd_thread(UNUSED(void *param))
 {
-    int      temp_buffer[2];
     int      channel_select[2];
     double   audio_vol_l;
     double   audio_vol_r;
-    double   cd_buffer_temp[2] = { 0.0, 0.0 };
+
+    for (uint8_t i = 0; i < CDROM_NUM; i++)
+        deemph_biquad_init(&cd_deemph[i]);
 
     thread_set_event(sound_cd_start_event);
 
@@ -271,8 +301,6 @@ sound_cd_thread(UNUSED(void *param))
 
         sound_cd_clean_buffers();
 
-        temp_buffer[0] = temp_buffer[1] = 0;
-
         for (uint8_t i = 0; i < CDROM_NUM; i++) {
             if ((cdrom[i].bus_type == CDROM_BUS_DISABLED) || (cdrom[i].cd_status == CD_STATUS_EMPTY))
                 continue;
@@ -301,64 +329,62 @@ sound_cd_thread(UNUSED(void *param))
 
             for (int c = 0; c < CD_BUFLEN * 2; c += 2) {
                 /*Apply ATAPI channel select*/
-                cd_buffer_temp[0] = cd_buffer_temp[1] = 0.0;
+                cd_buffer_temp[c] = cd_buffer_temp[c + 1] = 0.0;
 
                 if ((audio_vol_l != 0.0) && (channel_select[0] != 0)) {
                     if (channel_select[0] & 1)
-                        cd_buffer_temp[0] += ((double) cd_buffer[i][c]); /* Channel 0 => Port 0 */
+                        cd_buffer_temp[c] += ((double) cd_buffer[i][c]); /* Channel 0 => Port 0 */
                     if (channel_select[0] & 2)
-                        cd_buffer_temp[0] += ((double) cd_buffer[i][c + 1]); /* Channel 1 => Port 0 */
-
-                    cd_buffer_temp[0] *= audio_vol_l; /* Multiply Port 0 by Port 0 volume */
+                        cd_buffer_temp[c] += ((double) cd_buffer[i][c + 1]); /* Channel 1 => Port 0 */
 
-                    if (pre)
-                        cd_buffer_temp[0] = deemph_iir(0, cd_buffer_temp[0]); /* De-emphasize if necessary */
+                    cd_buffer_temp[c] *= audio_vol_l; /* Multiply Port 0 by Port 0 volume */
                 }
 
                 if ((audio_vol_r != 0.0) && (channel_select[1] != 0)) {
                     if (channel_select[1] & 1)
-                        cd_buffer_temp[1] += ((double) cd_buffer[i][c]); /* Channel 0 => Port 1 */
+                        cd_buffer_temp[c + 1] += ((double) cd_buffer[i][c]); /* Channel 0 => Port 1 */
                     if (channel_select[1] & 2)
-                        cd_buffer_temp[1] += ((double) cd_buffer[i][c + 1]); /* Channel 1 => Port 1 */
+                        cd_buffer_temp[c + 1] += ((double) cd_buffer[i][c + 1]); /* Channel 1 => Port 1 */
 
-                    cd_buffer_temp[1] *= audio_vol_r; /* Multiply Port 1 by Port 1 volume */
-
-                    if (pre)
-                        cd_buffer_temp[1] = deemph_iir(1, cd_buffer_temp[1]); /* De-emphasize if necessary */
+                    cd_buffer_temp[c + 1] *= audio_vol_r; /* Multiply Port 1 by Port 1 volume */
                 }
+            }
+
+            /* De-emphasize if necessary */
+            if (pre)
+                biquad_process_stereo(&cd_deemph[i], cd_buffer_temp, CD_BUFLEN);
 
-                /* Apply sound card CD volume and filters */
-                if (filter_cd_audio != NULL) {
-                    filter_cd_audio(0, &(cd_buffer_temp[0]), filter_cd_audio_p);
-                    filter_cd_audio(1, &(cd_buffer_temp[1]), filter_cd_audio_p);
+            /* Apply sound card CD volume and filters */
+            if (filter_cd_audio != NULL) {
+                for (int c = 0; c < CD_BUFLEN * 2; c += 2) {
+                    filter_cd_audio(0, &(cd_buffer_temp[c]), filter_cd_audio_p);
+                    filter_cd_audio(1, &(cd_buffer_temp[c + 1]), filter_cd_audio_p);
                 }
+            }
+
+            if (sound_is_float) {
+                for (int c = 0; c < CD_BUFLEN * 2; c++)
+                    cd_out_buffer[c] += (float) (cd_buffer_temp[c] / 32768.0);
+            } else {
+                for (int c = 0; c < CD_BUFLEN * 2; c++) {
+                    int temp = cd_out_buffer_int16[c] + (int) trunc(cd_buffer_temp[c]);
 
-                if (sound_is_float) {
-                    cd_out_buffer[c] += (float) (cd_buffer_temp[0] / 32768.0);
-                    cd_out_buffer[c + 1] += (float) (cd_buffer_temp[1] / 32768.0);
-                } else {
-                    temp_buffer[0] += (int) trunc(cd_buffer_temp[0]);
-                    temp_buffer[1] += (int) trunc(cd_buffer_temp[1]);
-
-                    if (temp_buffer[0] > 32767)
-                        temp_buffer[0] = 32767;
-                    if (temp_buffer[0] < -32768)
-                        temp_buffer[0] = -32768;
-                    if (temp_buffer[1] > 32767)
-                        temp_buffer[1] = 32767;
-                    if (temp_buffer[1] < -32768)
-                        temp_buffer[1] = -32768;
-
-                    cd_out_buffer_int16[c]     = (int16_t) temp_buffer[0];
-                    cd_out_buffer_int16[c + 1] = (int16_t) temp_buffer[1];
+                    if (temp > 32767)
+                        temp = 32767;
+                    if (temp < -32768)
+                        temp = -32768;
+
+                    cd_out_buffer_int16[c] = (int16_t) temp;
                 }
             }
         }
 
-        if (sound_is_float)
-            givealbuffer_cd(cd_out_buffer);
-        else
-            givealbuffer_cd(cd_out_buffer_int16);
+        if (!turbo_mode) {
+            if (sound_is_float)
+                givealbuffer_cd(cd_out_buffer);
+            else
+                givealbuffer_cd(cd_out_buffer_int16);
+        }
     }
 }
 
@@ -398,11 +424,11 @@ music_realloc_buffers(void)
     }
 
     if (sound_is_float) {
-        outbuffer_m_ex = calloc(MUSICBUFLEN * 2, sizeof(float));
-        memset(outbuffer_m_ex, 0x00, MUSICBUFLEN * 2 * sizeof(float));
+        outbuffer_m_ex = calloc(SOUNDBUFLEN * 2, sizeof(float));
+        memset(outbuffer_m_ex, 0x00, SOUNDBUFLEN * 2 * sizeof(float));
     } else {
-        outbuffer_m_ex_int16 = calloc(MUSICBUFLEN * 2, sizeof(int16_t));
-        memset(outbuffer_m_ex_int16, 0x00, MUSICBUFLEN * 2 * sizeof(int16_t));
+        outbuffer_m_ex_int16 = calloc(SOUNDBUFLEN * 2, sizeof(int16_t));
+        memset(outbuffer_m_ex_int16, 0x00, SOUNDBUFLEN * 2 * sizeof(int16_t));
     }
 }
 
@@ -420,11 +446,11 @@ wavetable_realloc_buffers(void)
     }
 
     if (sound_is_float) {
-        outbuffer_w_ex = calloc(WTBUFLEN * 2, sizeof(float));
-        memset(outbuffer_w_ex, 0x00, WTBUFLEN * 2 * sizeof(float));
+        outbuffer_w_ex = calloc(SOUNDBUFLEN * 2, sizeof(float));
+        memset(outbuffer_w_ex, 0x00, SOUNDBUFLEN * 2 * sizeof(float));
     } else {
-        outbuffer_w_ex_int16 = calloc(WTBUFLEN * 2, sizeof(int16_t));
-        memset(outbuffer_w_ex_int16, 0x00, WTBUFLEN * 2 * sizeof(int16_t));
+        outbuffer_w_ex_int16 = calloc(SOUNDBUFLEN * 2, sizeof(int16_t));
+        memset(outbuffer_w_ex_int16, 0x00, SOUNDBUFLEN * 2 * sizeof(int16_t));
     }
 }
 
@@ -454,6 +480,14 @@ sound_init(void)
     outbuffer_w = calloc(WTBUFLEN * 2, sizeof(int32_t));
     memset(outbuffer_w, 0x00, WTBUFLEN * 2 * sizeof(int32_t));
 
+    /* The music and wavetable buses are resampled to the output rate here,
+       so every backend only ever sees SOUND_FREQ. */
+    music_resampler = resampler_init(MUSIC_FREQ, SOUND_FREQ, MUSICBUFLEN);
+    music_fifo      = calloc((SOUNDBUFLEN + resampler_max_out(music_resampler, MUSICBUFLEN)) * 2, sizeof(int32_t));
+
+    wavetable_resampler = resampler_init(WT_FREQ, SOUND_FREQ, WTBUFLEN);
+    wavetable_fifo      = calloc((SOUNDBUFLEN + resampler_max_out(wavetable_resampler, WTBUFLEN)) * 2, sizeof(int32_t));
+
     for (uint16_t i = 0; i < 256; i++) {
         double di = (double) i;
 
@@ -478,7 +512,7 @@ sound_init(void)
         sound_cd_start_event = thread_create_event();
 
         sound_cd_event    = thread_create_event();
-        sound_cd_thread_h = thread_create(sound_cd_thread, NULL);
+        sound_cd_thread_h = thread_create_role(sound_cd_thread, NULL, THREAD_ROLE_AUDIO);
 
         sound_log("Waiting for CD start event...\n");
         thread_wait_event(sound_cd_start_event, -1);
@@ -495,6 +529,7 @@ sound_add_handler(void (*get_buffer)(int32_t *buffer, int len, void *priv), void
 {
     sound_handlers[sound_handlers_num].get_buffer = get_buffer;
     sound_handlers[sound_handlers_num].priv       = priv;
+    sound_handlers[sound_handlers_num].name       = device_get_current_name();
     sound_handlers_num++;
 }
 
@@ -503,6 +538,7 @@ music_add_handler(void (*get_buffer)(int32_t *buffer, int len, void *priv), void
 {
     music_handlers[music_handlers_num].get_buffer = get_buffer;
     music_handlers[music_handlers_num].priv       = priv;
+    music_handlers[music_handlers_num].name       = device_get_current_name();
     music_handlers_num++;
 }
 
@@ -511,9 +547,76 @@ wavetable_add_handler(void (*get_buffer)(int32_t *buffer, int len, void *priv),
 {
     wavetable_handlers[wavetable_handlers_num].get_buffer = get_buffer;
     wavetable_handlers[wavetable_handlers_num].priv       = priv;
+    wavetable_handlers[wavetable_handlers_num].name       = device_get_current_name();
     wavetable_handlers_num++;
 }
 
+/* Runs one bus' handlers, accounting the host time each of them takes. */
+static void
+sound_run_handlers(sound_handler_t *handlers, int num, int32_t *buffer, int len)
+{
+    for (int c = 0; c < num; c++) {
+        uint64_t start = plat_get_ticks_us();
+
+        handlers[c].get_buffer(buffer, len, handlers[c].priv);
+        handlers[c].host_time += plat_get_ticks_us() - start;
+    }
+}
+
+static void
+sound_stats_add_handlers(sound_handler_t *handlers, int num)
+{
+    for (int c = 0; c < num; c++) {
+        int n = sound_stats.handlers_num;
+
+        if (n < SOUND_STATS_HANDLERS) {
+            sound_stats.handlers[n].name = handlers[c].name ? handlers[c].name : "(unnamed)";
+            sound_stats.handlers[n].us   = (uint32_t) handlers[c].host_time;
+            sound_stats.handlers_num++;
+
+            MTR_COUNTER("sound", sound_stats.handlers[n].name, sound_stats.handlers[n].us);
+        }
+
+        handlers[c].host_time = 0;
+    }
+}
+
+/* Publishes the counters once a second of host time has passed. */
+static void
+sound_stats_update(void)
+{
+    uint32_t ticks = plat_get_ticks();
+
+    sound_stats_buffers++;
+    if ((ticks - sound_stats_ticks) < 1000)
+        return;
+
+    sound_stats.buffers      = (uint32_t) (((uint64_t) sound_stats_buffers * 1000) / (ticks - sound_stats_ticks));
+    sound_stats.handlers_num = 0;
+    sound_stats_add_handlers(sound_handlers, sound_handlers_num);
+    sound_stats_add_handlers(music_handlers, music_handlers_num);
+    sound_stats_add_handlers(wavetable_handlers, wavetable_handlers_num);
+    sound_stats.seq++;
+
+    MTR_COUNTER("sound", "buffers", sound_stats.buffers);
+    MTR_COUNTER("sound", "queued", sound_stats.queued);
+    MTR_COUNTER("sound", "underruns", sound_stats.underruns);
+    MTR_COUNTER("sound", "overruns", sound_stats.overruns);
+
+    sound_stats_buffers = 0;
+    sound_stats_ticks   = ticks;
+}
+
+void
+sound_stats_backend(int queued, int underrun, int overrun)
+{
+    sound_stats.queued = queued;
+    if (underrun)
+        sound_stats.underruns++;
+    if (overrun)
+        sound_stats.overruns++;
+}
+
 void
 sound_set_cd_audio_filter(void (*filter)(int channel, double *buffer, void *priv), void *priv)
 {
@@ -532,6 +635,49 @@ sound_set_pc_speaker_filter(void (*filter)(int channel, double *buffer, void *pr
     }
 }
 
+/* Convert a mixed int32 buffer to the output format, either float scaled to
+   [-1.0, 1.0) or int16 clipped to the 16-bit range. */
+static void
+sound_convert_buffer(const int32_t *src, float *dst_f, int16_t *dst_i, int len)
+{
+    int c = 0;
+
+    if (sound_is_float) {
+#if defined(SOUND_SSE2)
+        const __m128 scale = _mm_set1_ps(1.0f / 32768.0f);
+
+        for (; (c + 4) <= len; c += 4)
+            _mm_storeu_ps(&dst_f[c], _mm_mul_ps(_mm_cvtepi32_ps(_mm_loadu_si128((const __m128i *) &src[c])), scale));
+#elif defined(SOUND_NEON)
+        for (; (c + 4) <= len; c += 4)
+            vst1q_f32(&dst_f[c], vmulq_n_f32(vcvtq_f32_s32(vld1q_s32(&src[c])), 1.0f / 32768.0f));
+#endif
+        for (; c < len; c++)
+            dst_f[c] = ((float) src[c]) / (float) 32768.0;
+    } else {
+        /* The saturating packs clip exactly like the scalar loop. */
+#if defined(SOUND_SSE2)
+        for (; (c + 8) <= len; c += 8) {
+            const __m128i lo = _mm_loadu_si128((const __m128i *) &src[c]);
+            const __m128i hi = _mm_loadu_si128((const __m128i *) &src[c + 4]);
+
+            _mm_storeu_si128((__m128i *) &dst_i[c], _mm_packs_epi32(lo, hi));
+        }
+#elif defined(SOUND_NEON)
+        for (; (c + 8) <= len; c += 8)
+            vst1q_s16(&dst_i[c], vcombine_s16(vqmovn_s32(vld1q_s32(&src[c])), vqmovn_s32(vld1q_s32(&src[c + 4]))));
+#endif
+        for (; c < len; c++) {
+            if (src[c] > 32767)
+                dst_i[c] = 32767;
+            else if (src[c] < -32768)
+                dst_i[c] = -32768;
+            else
+                dst_i[c] = (int16_t) src[c];
+        }
+    }
+}
+
 void
 sound_poll(UNUSED(void *priv))
 {
@@ -540,41 +686,57 @@ sound_poll(UNUSED(void *priv))
     midi_poll();
 
     sound_pos_global++;
-    if (sound_pos_global == SOUNDBUFLEN) {
-        int c;
+    if (sound_pos_global >= sound_buf_len) {
+        int prev = perf_enter(PERF_SOUND);
+
+        MTR_BEGIN("sound", "buffer");
+        memset(outbuffer, 0x00, sound_buf_len * 2 * sizeof(int32_t));
 
-        memset(outbuffer, 0x00, SOUNDBUFLEN * 2 * sizeof(int32_t));
+        sound_run_handlers(sound_handlers, sound_handlers_num, outbuffer, sound_buf_len);
 
-        for (c = 0; c < sound_handlers_num; c++)
-            sound_handlers[c].get_buffer(outbuffer, SOUNDBUFLEN, sound_handlers[c].priv);
+        sound_convert_buffer(outbuffer, outbuffer_ex, outbuffer_ex_int16, sound_buf_len * 2);
+        BENCH_COUNT(audio_buffers, 1);
 
-        for (c = 0; c < SOUNDBUFLEN * 2; c++) {
+        /* In turbo mode, audio is generated much faster than it can be played. */
+        if (!turbo_mode) {
             if (sound_is_float)
-                outbuffer_ex[c] = ((float) outbuffer[c]) / (float) 32768.0;
-            else {
-                if (outbuffer[c] > 32767)
-                    outbuffer[c] = 32767;
-                if (outbuffer[c] < -32768)
-                    outbuffer[c] = -32768;
-
-                outbuffer_ex_int16[c] = (int16_t) outbuffer[c];
-            }
+                givealbuffer(outbuffer_ex);
+            else
+                givealbuffer(outbuffer_ex_int16);
         }
 
-        if (sound_is_float)
-            givealbuffer(outbuffer_ex);
-        else
-            givealbuffer(outbuffer_ex_int16);
+        sound_stats_update();
 
         if (cd_thread_enable) {
             cd_buf_update--;
             if (!cd_buf_update) {
-                cd_buf_update = (SOUND_FREQ / SOUNDBUFLEN) / (CD_FREQ / CD_BUFLEN);
+                cd_buf_update = (SOUND_FREQ / sound_buf_len) / (CD_FREQ / CD_BUFLEN);
                 thread_set_event(sound_cd_event);
             }
         }
 
         sound_pos_global = 0;
+        MTR_END("sound", "buffer");
+        perf_leave(prev);
+    }
+}
+
+/* Resample one bus buffer and hand every complete output-rate buffer to
+   the backend. */
+static void
+sound_resample_bus(resampler_t *rs, const int32_t *in, int in_frames, int32_t *fifo, int *fifo_pos,
+                   float *out_f, int16_t *out_i, void (*give)(const void *buf))
+{
+    *fifo_pos += resampler_process(rs, in, in_frames, &fifo[*fifo_pos * 2]);
+
+    while (*fifo_pos >= sound_buf_len) {
+        sound_convert_buffer(fifo, out_f, out_i, sound_buf_len * 2);
+
+        if (!turbo_mode)
+            give(sound_is_float ? (const void *) out_f : (const void *) out_i);
+
+        *fifo_pos -= sound_buf_len;
+        memmove(fifo, &fifo[sound_buf_len * 2], *fifo_pos * 2 * sizeof(int32_t));
     }
 }
 
@@ -585,30 +747,12 @@ music_poll(UNUSED(void *priv))
 
     music_pos_global++;
     if (music_pos_global == MUSICBUFLEN) {
-        int c;
-
         memset(outbuffer_m, 0x00, MUSICBUFLEN * 2 * sizeof(int32_t));
 
-        for (c = 0; c < music_handlers_num; c++)
-            music_handlers[c].get_buffer(outbuffer_m, MUSICBUFLEN, music_handlers[c].priv);
-
-        for (c = 0; c < MUSICBUFLEN * 2; c++) {
-            if (sound_is_float)
-                outbuffer_m_ex[c] = ((float) outbuffer_m[c]) / (float) 32768.0;
-            else {
-                if (outbuffer_m[c] > 32767)
-                    outbuffer_m[c] = 32767;
-                if (outbuffer_m[c] < -32768)
-                    outbuffer_m[c] = -32768;
-
-                outbuffer_m_ex_int16[c] = (int16_t) outbuffer_m[c];
-            }
-        }
+        sound_run_handlers(music_handlers, music_handlers_num, outbuffer_m, MUSICBUFLEN);
 
-        if (sound_is_float)
-            givealbuffer_music(outbuffer_m_ex);
-        else
-            givealbuffer_music(outbuffer_m_ex_int16);
+        sound_resample_bus(music_resampler, outbuffer_m, MUSICBUFLEN, music_fifo, &music_fifo_pos,
+                           outbuffer_m_ex, outbuffer_m_ex_int16, givealbuffer_music);
 
         music_pos_global = 0;
     }
@@ -621,30 +765,12 @@ wavetable_poll(UNUSED(void *priv))
 
     wavetable_pos_global++;
     if (wavetable_pos_global == WTBUFLEN) {
-        int c;
-
         memset(outbuffer_w, 0x00, WTBUFLEN * 2 * sizeof(int32_t));
 
-        for (c = 0; c < wavetable_handlers_num; c++)
-            wavetable_handlers[c].get_buffer(outbuffer_w, WTBUFLEN, wavetable_handlers[c].priv);
-
-        for (c = 0; c < WTBUFLEN * 2; c++) {
-            if (sound_is_float)
-                outbuffer_w_ex[c] = ((float) outbuffer_w[c]) / (float) 32768.0;
-            else {
-                if (outbuffer_w[c] > 32767)
-                    outbuffer_w[c] = 32767;
-                if (outbuffer_w[c] < -32768)
-                    outbuffer_w[c] = -32768;
-
-                outbuffer_w_ex_int16[c] = (int16_t) outbuffer_w[c];
-            }
-        }
+        sound_run_handlers(wavetable_handlers, wavetable_handlers_num, outbuffer_w, WTBUFLEN);
 
-        if (sound_is_float)
-            givealbuffer_wt(outbuffer_w_ex);
-        else
-            givealbuffer_wt(outbuffer_w_ex_int16);
+        sound_resample_bus(wavetable_resampler, outbuffer_w, WTBUFLEN, wavetable_fifo, &wavetable_fifo_pos,
+                           outbuffer_w_ex, outbuffer_w_ex_int16, givealbuffer_wt);
 
         wavetable_pos_global = 0;
     }
@@ -663,12 +789,28 @@ sound_speed_changed(void)
 void
 sound_reset(void)
 {
+    /* Arrays are sized for SOUNDBUFLEN, shorter buffers only trade
+       overhead for latency. */
+    sound_buf_len = (SOUND_FREQ * sound_buffer_ms) / 1000;
+    if (sound_buf_len < SOUNDBUFLEN_MIN)
+        sound_buf_len = SOUNDBUFLEN_MIN;
+    else if (sound_buf_len > SOUNDBUFLEN)
+        sound_buf_len = SOUNDBUFLEN;
+    sound_pos_global = 0;
+    cd_buf_update    = (SOUND_FREQ / sound_buf_len) / (CD_FREQ / CD_BUFLEN);
+
     sound_realloc_buffers();
 
     music_realloc_buffers();
 
     wavetable_realloc_buffers();
 
+    resampler_reset(music_resampler);
+    music_fifo_pos = 0;
+
+    resampler_reset(wavetable_resampler);
+    wavetable_fifo_pos = 0;
+
     midi_out_device_init();
     midi_in_device_init();
 
@@ -689,6 +831,10 @@ sound_reset(void)
     wavetable_handlers_num = 0;
     memset(wavetable_handlers, 0x00, 8 * sizeof(sound_handler_t));
 
+    memset(&sound_stats, 0x00, sizeof(sound_stats_t));
+    sound_stats_buffers = 0;
+    sound_stats_ticks   = plat_get_ticks();
+
     filter_cd_audio   = NULL;
     filter_cd_audio_p = NULL;
 
@@ -735,6 +881,24 @@ sound_cd_thread_end(void)
     }
 }
 
+/* Runs in a fork()ed clone of the machine, which stays silent. The CD audio
+   thread did not make it across, so it is started again. */
+void
+sound_clone_child(void)
+{
+    forgetal();
+
+    if (cdaudioon) {
+        sound_cd_start_event = thread_create_event();
+
+        sound_cd_event    = thread_create_event();
+        sound_cd_thread_h = thread_create_role(sound_cd_thread, NULL, THREAD_ROLE_AUDIO);
+
+        thread_wait_event(sound_cd_start_event, -1);
+        thread_reset_event(sound_cd_start_event);
+    }
+}
+
 void
 sound_cd_thread_reset(void)
 {
@@ -753,7 +917,7 @@ sound_cd_thread_reset(void)
         sound_cd_start_event = thread_create_event();
 
         sound_cd_event    = thread_create_event();
-        sound_cd_thread_h = thread_create(sound_cd_thread, NULL);
+        sound_cd_thread_h = thread_create_role(sound_cd_thread, NULL, THREAD_ROLE_AUDIO);
 
         thread_wait_event(sound_cd_start_event, -1);
         thread_reset_event(sound_cd_start_event);
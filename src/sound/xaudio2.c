@@ -57,7 +57,9 @@ static IXAudio2SourceVoice    *srcvoicemidi  = NULL;
 static IXAudio2SourceVoice    *srcvoicecd    = NULL;
 
 #define FREQ   SOUND_FREQ
-#define BUFLEN SOUNDBUFLEN
+#define BUFLEN sound_buf_len
+/* Buffers queued per voice before new ones are dropped, as with OpenAL. */
+#define MAX_QUEUED 4
 
 static void WINAPI
 OnVoiceProcessingPassStart(UNUSED(IXAudio2VoiceCallback *callback), UNUSED(uint32_t bytesRequired))
@@ -166,16 +168,9 @@ inital(void)
         return;
     }
 
-    fmt.nSamplesPerSec  = MUSIC_FREQ;
-    fmt.nBlockAlign     = fmt.nChannels * fmt.wBitsPerSample / 8;
-    fmt.nAvgBytesPerSec = fmt.nSamplesPerSec * fmt.nBlockAlign;
-
+    /* The music and wavetable buses arrive already resampled to FREQ. */
     (void) IXAudio2_CreateSourceVoice(xaudio2, &srcvoicemusic, &fmt, 0, 2.0f, &callbacks, NULL, NULL);
 
-    fmt.nSamplesPerSec  = WT_FREQ;
-    fmt.nBlockAlign     = fmt.nChannels * fmt.wBitsPerSample / 8;
-    fmt.nAvgBytesPerSec = fmt.nSamplesPerSec * fmt.nBlockAlign;
-
     (void) IXAudio2_CreateSourceVoice(xaudio2, &srcvoicewt, &fmt, 0, 2.0f, &callbacks, NULL, NULL);
 
     fmt.nSamplesPerSec  = CD_FREQ;
@@ -204,6 +199,14 @@ inital(void)
     atexit(closeal);
 }
 
+/* Drops the output without touching it, for a process that shares the
+   device with another one, which still owns it. Nothing is played after. */
+void
+forgetal(void)
+{
+    initialized = 0;
+}
+
 void
 closeal(void)
 {
@@ -247,6 +250,21 @@ givealbuffer_common(const void *buf, IXAudio2SourceVoice *sourcevoice, const siz
 
     (void) IXAudio2MasteringVoice_SetVolume(mastervoice, sound_muted ? 0.0 : pow(10.0, (double) sound_gain / 20.0),
                                             XAUDIO2_COMMIT_NOW);
+
+    /* Keep the queue, and with it the latency, bounded when the host audio
+       clock runs slower than emulation; MIDI manages its own buffering. */
+    if (sourcevoice != srcvoicemidi) {
+        XAUDIO2_VOICE_STATE state;
+
+        IXAudio2SourceVoice_GetState(sourcevoice, &state, XAUDIO2_VOICE_NOSAMPLESPLAYED);
+        if (sourcevoice == srcvoice) {
+            sound_buffers_low = (state.BuffersQueued <= 1);
+            sound_stats_backend(state.BuffersQueued, state.BuffersQueued == 0, state.BuffersQueued >= MAX_QUEUED);
+        }
+        if (state.BuffersQueued >= MAX_QUEUED)
+            return;
+    }
+
     XAUDIO2_BUFFER buffer = { 0 };
     buffer.Flags          = 0;
     if (sound_is_float) {
@@ -275,13 +293,13 @@ givealbuffer(const void *buf)
 void
 givealbuffer_music(const void *buf)
 {
-    givealbuffer_common(buf, srcvoicemusic, MUSICBUFLEN << 1);
+    givealbuffer_common(buf, srcvoicemusic, BUFLEN << 1);
 }
 
 void
 givealbuffer_wt(const void *buf)
 {
-    givealbuffer_common(buf, srcvoicewt, WTBUFLEN << 1);
+    givealbuffer_common(buf, srcvoicewt, BUFLEN << 1);
 }
 
 void
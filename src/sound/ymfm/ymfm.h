@@ -557,6 +557,12 @@ public:
 	// of the chip; our responsibility is to pass the written data on to any consumers
 	virtual void ymfm_external_write(access_class type, uint32_t address, uint8_t data) { }
 
+	// the PCM engine calls this on key on to get the wave at the given base address
+	// in the given format already decoded to 16-bit samples; the returned data must
+	// hold at least the requested number of samples and stay valid until the interface
+	// is destroyed; memory that can change must not be returned and gets nullptr
+	virtual const int16_t *ymfm_external_pcm_decoded(uint32_t baseaddr, uint8_t format, uint32_t samples) { return nullptr; }
+
 protected:
 	// pointer to engine callbacks -- this is set directly by the engine at
 	// construction time
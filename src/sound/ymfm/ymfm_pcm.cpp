@@ -179,6 +179,8 @@ pcm_channel::pcm_channel(pcm_engine &owner, uint32_t choffs) :
 	m_total_level(0x7f << 10),
 	m_format(0),
 	m_key_state(0),
+	m_decoded(nullptr),
+	m_decoded_len(0),
 	m_regs(owner.regs()),
 	m_owner(owner)
 {
@@ -202,6 +204,8 @@ void pcm_channel::reset()
 	m_total_level = 0x7f << 10;
 	m_format = 0;
 	m_key_state = 0;
+	m_decoded = nullptr;
+	m_decoded_len = 0;
 }
 
 
@@ -222,6 +226,10 @@ void pcm_channel::save_restore(ymfm_saved_state &state)
 	state.save_restore(m_total_level);
 	state.save_restore(m_format);
 	state.save_restore(m_key_state);
+
+	// the decoded wave is looked up again on the next key on
+	m_decoded = nullptr;
+	m_decoded_len = 0;
 }
 
 
@@ -426,6 +434,12 @@ void pcm_channel::load_wavetable()
 	m_endpos |= read_pcm(wavheader + 6);
 	m_endpos = -int32_t(m_endpos) << 16;
 
+	// positions stay below the end position, unless the loop position is past it
+	m_decoded_len = (m_endpos >> 16) + 1;
+	m_decoded = m_owner.intf().ymfm_external_pcm_decoded(m_baseaddr, m_format, m_decoded_len);
+	if (m_decoded == nullptr)
+		m_decoded_len = 0;
+
 	// remaining data values set registers
 	m_owner.write(0x80 + m_choffs, read_pcm(wavheader + 7));
 	m_owner.write(0x98 + m_choffs, read_pcm(wavheader + 8));
@@ -548,6 +562,10 @@ int16_t pcm_channel::fetch_sample() const
 	uint32_t addr = m_baseaddr;
 	uint32_t pos = m_curpos >> 16;
 
+	// pre-decoded wave
+	if (pos < m_decoded_len)
+		return m_decoded[pos];
+
 	// 8-bit PCM: shift up by 8
 	if (m_format == 0)
 		return read_pcm(addr + pos) << 8;
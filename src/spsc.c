@@ -0,0 +1,83 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Single producer/single consumer ring buffer.
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <wchar.h>
+#include <86box/86box.h>
+#include <86box/thread.h>
+#include <86box/spsc.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#    include <emmintrin.h>
+#    define spsc_relax() _mm_pause()
+#elif (defined(__aarch64__) || defined(__arm__)) && defined(__GNUC__)
+#    define spsc_relax() __asm__ __volatile__("yield")
+#else
+#    define spsc_relax()
+#endif
+
+void
+spsc_init(spsc_t *q, uint32_t size, int spin, event_t *wake_event, event_t *not_full_event)
+{
+    memset(q, 0, sizeof(spsc_t));
+
+    q->size           = size;
+    q->spin           = spin;
+    q->wake_event     = wake_event;
+    q->not_full_event = not_full_event;
+}
+
+void
+spsc_clear(spsc_t *q)
+{
+    atomic_store(&q->write_idx, 0);
+    atomic_store(&q->read_idx, 0);
+    atomic_store(&q->producer_waiting, 0);
+}
+
+void
+spsc_wait_below(spsc_t *q, uint32_t limit)
+{
+    if (spsc_entries(q) < limit)
+        return;
+
+    /*The consumer is normally well into the queue at this point, so a short
+      spin usually avoids a round trip through the events*/
+    for (int c = 0; c < q->spin; c++) {
+        spsc_relax();
+        if (spsc_entries(q) < limit)
+            return;
+    }
+
+    while (spsc_entries(q) >= limit) {
+        thread_reset_event(q->not_full_event);
+        atomic_store(&q->producer_waiting, 1);
+        if (spsc_entries(q) >= limit) {
+            /*Wait for room in ringbuffer. The consumer must be running for the
+              queue to drain, so kick it if it is still full*/
+            thread_wait_event(q->not_full_event, 1);
+            if (spsc_entries(q) >= limit)
+                thread_set_event(q->wake_event);
+        }
+        atomic_store(&q->producer_waiting, 0);
+    }
+}
+
+void
+spsc_park(spsc_t *q)
+{
+    atomic_store(&q->consumer_parked, 1);
+    if (spsc_empty(q))
+        thread_wait_event(q->wake_event, -1);
+    thread_reset_event(q->wake_event);
+    atomic_store(&q->consumer_parked, 0);
+}
@@ -1,28 +1,57 @@
+#include <list>
 #include <mutex>
 #include <thread>
 #include <condition_variable>
+#include <cstdarg>
 
 #include <86box/plat.h>
 #include <86box/thread.h>
+#include <86box/log.h>
 
+#ifndef USE_FAST_SYNC
 struct event_cpp11_t {
     std::condition_variable cond;
     std::mutex              mutex;
     bool                    state = false;
 };
+#endif
+
+/* Names of the threads started by thread_create() that are still running. */
+static std::mutex              thread_list_lock;
+static std::list<const char *> thread_list;
 
 extern "C" {
 
 thread_t *
-thread_create_named(void (*thread_rout)(void *param), void *param, const char *name)
+thread_create_named(void (*thread_rout)(void *param), void *param, const char *name, int role)
 {
-    auto thread = new std::thread([thread_rout, param, name] {
+    auto thread = new std::thread([thread_rout, param, name, role] {
+        std::list<const char *>::iterator entry;
+
         plat_set_thread_name(NULL, name);
+        thread_role_apply(role);
+        {
+            std::lock_guard<std::mutex> guard(thread_list_lock);
+            entry = thread_list.insert(thread_list.end(), name);
+        }
         thread_rout(param);
+        log_thread_exit();
+        {
+            std::lock_guard<std::mutex> guard(thread_list_lock);
+            thread_list.erase(entry);
+        }
     });
     return thread;
 }
 
+void
+thread_enum(void (*func)(const char *name, void *priv), void *priv)
+{
+    std::lock_guard<std::mutex> guard(thread_list_lock);
+    for (auto name : thread_list)
+        func(name, priv);
+}
+
 int
 thread_wait(thread_t *arg)
 {
@@ -33,6 +62,7 @@ thread_wait(thread_t *arg)
     return 0;
 }
 
+#ifndef USE_FAST_SYNC
 mutex_t *
 thread_create_mutex(void)
 {
@@ -134,4 +164,5 @@ thread_destroy_event(event_t *handle)
     auto event = reinterpret_cast<event_cpp11_t *>(handle);
     delete event;
 }
+#endif
 }
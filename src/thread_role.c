@@ -0,0 +1,245 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          CPU affinity and priority of the emulator threads.
+ *
+ *          Threads are tagged with a role when they are created, and
+ *          move themselves to the CPUs and priority configured for it
+ *          before they start, so several machines can be packed onto
+ *          one host without their threads getting in each other's way.
+ *          Threads of no role, and roles left at the defaults, are not
+ *          touched at all.
+ */
+#ifdef __linux__
+#    define _GNU_SOURCE
+#endif
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <wchar.h>
+#ifdef _WIN32
+#    include <windows.h>
+#else
+#    include <pthread.h>
+#    include <sched.h>
+#    include <unistd.h>
+#    ifdef __linux__
+#        include <sys/resource.h>
+#        include <sys/syscall.h>
+#    endif
+#endif
+#define HAVE_STDARG_H
+#include <86box/86box.h>
+#include <86box/thread.h>
+
+#define THREAD_CPUS_MAX 1024
+
+char thread_role_cpus[THREAD_ROLE_MAX][THREAD_CPUS_LEN];
+int  thread_role_priority[THREAD_ROLE_MAX];
+
+static const char *thread_role_names[THREAD_ROLE_MAX] = {
+    "none", "cpu", "blit", "video", "audio", "network", "worker"
+};
+
+static const char *thread_priority_names[] = {
+    "default", "low", "high", "realtime", NULL
+};
+
+#ifdef ENABLE_THREAD_ROLE_LOG
+int thread_role_do_log = ENABLE_THREAD_ROLE_LOG;
+
+static void
+thread_role_log(const char *fmt, ...)
+{
+    va_list ap;
+
+    if (thread_role_do_log) {
+        va_start(ap, fmt);
+        pclog_ex(fmt, ap);
+        va_end(ap);
+    }
+}
+#else
+#    define thread_role_log(fmt, ...)
+#endif
+
+const char *
+thread_role_get_name(int role)
+{
+    if ((role < 0) || (role >= THREAD_ROLE_MAX))
+        return NULL;
+
+    return thread_role_names[role];
+}
+
+const char *
+thread_priority_get_name(int priority)
+{
+    if ((priority < THREAD_PRIO_DEFAULT) || (priority > THREAD_PRIO_REALTIME))
+        return NULL;
+
+    return thread_priority_names[priority];
+}
+
+int
+thread_priority_get_from_name(const char *s)
+{
+    for (int i = 0; thread_priority_names[i] != NULL; i++) {
+        if (!strcmp(s, thread_priority_names[i]))
+            return i;
+    }
+
+    return THREAD_PRIO_DEFAULT;
+}
+
+/* Parses a list of CPUs and ranges of them, as in "0-3,8". Returns the
+   highest CPU in it, or -1 if it is empty or invalid. */
+static int
+thread_parse_cpus(const char *s, uint8_t *cpus)
+{
+    int last = -1;
+
+    memset(cpus, 0x00, THREAD_CPUS_MAX / 8);
+
+    while (*s) {
+        char *end;
+        long  first = strtol(s, &end, 10);
+        long  to    = first;
+
+        if ((end == s) || (first < 0) || (first >= THREAD_CPUS_MAX))
+            return -1;
+        s = end;
+
+        if (*s == '-') {
+            to = strtol(++s, &end, 10);
+            if ((end == s) || (to < first) || (to >= THREAD_CPUS_MAX))
+                return -1;
+            s = end;
+        }
+
+        for (long i = first; i <= to; i++)
+            cpus[i >> 3] |= (1 << (i & 7));
+        if (to > last)
+            last = (int) to;
+
+        while ((*s == ',') || (*s == ' '))
+            s++;
+    }
+
+    return last;
+}
+
+static int
+thread_set_affinity(const uint8_t *cpus, int last)
+{
+#if defined(_WIN32)
+    DWORD_PTR mask = 0;
+
+    /* Only the first processor group can be used. */
+    for (int i = 0; (i <= last) && (i < (int) (sizeof(mask) * 8)); i++) {
+        if (cpus[i >> 3] & (1 << (i & 7)))
+            mask |= ((DWORD_PTR) 1) << i;
+    }
+
+    return (mask && SetThreadAffinityMask(GetCurrentThread(), mask)) ? 0 : -1;
+#elif defined(__linux__)
+    cpu_set_t set;
+
+    CPU_ZERO(&set);
+    for (int i = 0; (i <= last) && (i < CPU_SETSIZE); i++) {
+        if (cpus[i >> 3] & (1 << (i & 7)))
+            CPU_SET(i, &set);
+    }
+
+    errno = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+
+    return errno ? -1 : 0;
+#else
+    (void) cpus;
+    (void) last;
+    errno = ENOTSUP;
+
+    return -1;
+#endif
+}
+
+static int
+thread_set_priority(int role, int priority)
+{
+#if defined(_WIN32)
+    int level;
+
+    switch (priority) {
+        case THREAD_PRIO_LOW:
+            level = THREAD_PRIORITY_BELOW_NORMAL;
+            break;
+        case THREAD_PRIO_HIGH:
+            level = THREAD_PRIORITY_HIGHEST;
+            break;
+        default:
+            level = THREAD_PRIORITY_TIME_CRITICAL;
+            break;
+    }
+
+    return SetThreadPriority(GetCurrentThread(), level) ? 0 : -1;
+#else
+    if (priority == THREAD_PRIO_REALTIME) {
+        struct sched_param param = { 0 };
+
+        /* Audio goes above the CPU, which would otherwise starve it. */
+        param.sched_priority = sched_get_priority_min(SCHED_FIFO) + ((role == THREAD_ROLE_AUDIO) ? 2 : 1);
+
+        errno = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+
+        return errno ? -1 : 0;
+    }
+
+#    ifdef __linux__
+    /* The nice value of a Linux thread is its own. */
+    return setpriority(PRIO_PROCESS, (id_t) syscall(SYS_gettid), (priority == THREAD_PRIO_HIGH) ? -10 : 10) ? -1 : 0;
+#    else
+    errno = ENOTSUP;
+
+    return -1;
+#    endif
+#endif
+}
+
+void
+thread_role_apply(int role)
+{
+    uint8_t cpus[THREAD_CPUS_MAX / 8];
+    int     last;
+
+    if ((role <= THREAD_ROLE_NONE) || (role >= THREAD_ROLE_MAX))
+        return;
+
+    if (thread_role_cpus[role][0]) {
+        last = thread_parse_cpus(thread_role_cpus[role], cpus);
+
+        if (last < 0)
+            pclog("Thread: Invalid CPU list '%s' for the %s threads\n", thread_role_cpus[role], thread_role_names[role]);
+        else if (thread_set_affinity(cpus, last) < 0)
+            pclog("Thread: Unable to move a %s thread to CPUs %s (%s)\n", thread_role_names[role],
+                  thread_role_cpus[role], strerror(errno));
+        else
+            thread_role_log("Thread: %s thread moved to CPUs %s\n", thread_role_names[role], thread_role_cpus[role]);
+    }
+
+    if (thread_role_priority[role] != THREAD_PRIO_DEFAULT) {
+        if (thread_set_priority(role, thread_role_priority[role]) < 0)
+            pclog("Thread: Unable to set a %s thread to %s priority (%s)\n", thread_role_names[role],
+                  thread_priority_names[thread_role_priority[role]], strerror(errno));
+        else
+            thread_role_log("Thread: %s thread set to %s priority\n", thread_role_names[role],
+                            thread_priority_names[thread_role_priority[role]]);
+    }
+}
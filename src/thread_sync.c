@@ -0,0 +1,280 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Events and mutexes on top of the host's wait on address, that
+ *          is futex() on Linux, WaitOnAddress() on Windows and ulock on
+ *          macOS.
+ *
+ *          Both only go into the kernel when a thread actually has to
+ *          sleep, or has to wake one that sleeps. Setting an event that
+ *          nobody waits on, waiting on one that is already set, and
+ *          taking a free mutex are a few atomic operations. Waits spin
+ *          for a short while before sleeping, as the FIFO and blit
+ *          threads often get what they wait for within microseconds.
+ *
+ *          Events are manual reset: once set, they stay set until reset,
+ *          and every waiter wakes up.
+ */
+#ifdef _WIN32
+#    if !defined(_WIN32_WINNT) || (_WIN32_WINNT < 0x0602)
+#        undef _WIN32_WINNT
+#        define _WIN32_WINNT 0x0602 /* WaitOnAddress() */
+#    endif
+#    include <windows.h>
+#elif defined(__linux__)
+#    include <errno.h>
+#    include <time.h>
+#    include <unistd.h>
+#    include <linux/futex.h>
+#    include <sys/syscall.h>
+#elif defined(__APPLE__)
+#    include <errno.h>
+#else
+#    error "No wait on address for this host, build with FAST_SYNC off."
+#endif
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <wchar.h>
+#include <86box/86box.h>
+#include <86box/plat.h>
+#include <86box/thread.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#    include <emmintrin.h>
+#    define sync_relax() _mm_pause()
+#elif (defined(__aarch64__) || defined(__arm__)) && defined(__GNUC__)
+#    define sync_relax() __asm__ __volatile__("yield")
+#else
+#    define sync_relax()
+#endif
+
+#define SYNC_SPIN 128
+
+#ifdef __APPLE__
+/* Not in the SDK headers, but what libc++ itself uses for std::atomic::wait(). */
+#    define UL_COMPARE_AND_WAIT 1
+#    define ULF_WAKE_ALL        0x00000100
+#    define ULF_NO_ERRNO        0x01000000
+
+extern int __ulock_wait(uint32_t operation, void *addr, uint64_t value, uint32_t timeout_us);
+extern int __ulock_wake(uint32_t operation, void *addr, uint64_t wake_value);
+#endif
+
+typedef struct sync_event_t {
+    atomic_uint state; /* 1 while set. */
+    atomic_uint waiters;
+} sync_event_t;
+
+typedef struct sync_mutex_t {
+    atomic_uint state; /* 0 free, 1 taken, 2 taken with someone sleeping on it. */
+} sync_mutex_t;
+
+/* Sleeps while *addr is val, for at most timeout ms, or forever if it is
+   negative. Returns 1 on a timeout, 0 otherwise, which includes spurious
+   wake-ups. */
+static int
+sync_wait(atomic_uint *addr, unsigned int val, int timeout)
+{
+#if defined(_WIN32)
+    if (!WaitOnAddress((volatile VOID *) addr, &val, sizeof(val), (timeout < 0) ? INFINITE : (DWORD) timeout))
+        return GetLastError() == ERROR_TIMEOUT;
+
+    return 0;
+#elif defined(__linux__)
+    struct timespec ts;
+
+    if (timeout >= 0) {
+        ts.tv_sec  = timeout / 1000;
+        ts.tv_nsec = (timeout % 1000) * 1000000L;
+    }
+
+    if (syscall(SYS_futex, addr, FUTEX_WAIT_PRIVATE, val, (timeout >= 0) ? &ts : NULL, NULL, 0) < 0)
+        return errno == ETIMEDOUT;
+
+    return 0;
+#else
+    /* A timeout of 0 is forever to ulock. */
+    uint32_t us = (timeout < 0) ? 0 : ((timeout > 0) ? ((uint32_t) timeout * 1000) : 1);
+
+    return __ulock_wait(UL_COMPARE_AND_WAIT | ULF_NO_ERRNO, addr, val, us) == -ETIMEDOUT;
+#endif
+}
+
+static void
+sync_wake(atomic_uint *addr, int all)
+{
+#if defined(_WIN32)
+    if (all)
+        WakeByAddressAll((PVOID) addr);
+    else
+        WakeByAddressSingle((PVOID) addr);
+#elif defined(__linux__)
+    syscall(SYS_futex, addr, FUTEX_WAKE_PRIVATE, all ? INT32_MAX : 1, NULL, NULL, 0);
+#else
+    __ulock_wake(UL_COMPARE_AND_WAIT | ULF_NO_ERRNO | (all ? ULF_WAKE_ALL : 0), addr, 0);
+#endif
+}
+
+event_t *
+thread_create_event(void)
+{
+    sync_event_t *event = (sync_event_t *) calloc(1, sizeof(sync_event_t));
+
+    atomic_init(&event->state, 0);
+    atomic_init(&event->waiters, 0);
+
+    return (event_t *) event;
+}
+
+void
+thread_set_event(event_t *handle)
+{
+    sync_event_t *event = (sync_event_t *) handle;
+
+    if (event == NULL)
+        return;
+
+    /* A waiter counts itself in before it looks at the state, so one of
+       the two always sees the other. */
+    if (!atomic_exchange(&event->state, 1) && atomic_load(&event->waiters))
+        sync_wake(&event->state, 1);
+}
+
+void
+thread_reset_event(event_t *handle)
+{
+    sync_event_t *event = (sync_event_t *) handle;
+
+    if (event != NULL)
+        atomic_store(&event->state, 0);
+}
+
+/* Returns 1 if the event was not set within timeout ms. */
+int
+thread_wait_event(event_t *handle, int timeout)
+{
+    sync_event_t *event = (sync_event_t *) handle;
+    uint32_t      start;
+    int           ret = 0;
+
+    if (event == NULL)
+        return 0;
+
+    for (int c = 0; c < SYNC_SPIN; c++) {
+        if (atomic_load_explicit(&event->state, memory_order_acquire))
+            return 0;
+        sync_relax();
+    }
+
+    if (timeout == 0)
+        return !atomic_load(&event->state);
+
+    start = plat_get_ticks();
+    atomic_fetch_add(&event->waiters, 1);
+
+    while (!atomic_load(&event->state)) {
+        int left = -1;
+
+        if (timeout > 0) {
+            left = timeout - (int) (plat_get_ticks() - start);
+            if (left <= 0) {
+                ret = 1;
+                break;
+            }
+        }
+
+        if (sync_wait(&event->state, 0, left) && !atomic_load(&event->state)) {
+            ret = 1;
+            break;
+        }
+    }
+
+    atomic_fetch_sub(&event->waiters, 1);
+
+    return ret;
+}
+
+void
+thread_destroy_event(event_t *handle)
+{
+    free(handle);
+}
+
+mutex_t *
+thread_create_mutex(void)
+{
+    sync_mutex_t *mutex = (sync_mutex_t *) calloc(1, sizeof(sync_mutex_t));
+
+    atomic_init(&mutex->state, 0);
+
+    return (mutex_t *) mutex;
+}
+
+/* Returns 1 if the mutex was taken. */
+int
+thread_test_mutex(mutex_t *handle)
+{
+    sync_mutex_t *mutex = (sync_mutex_t *) handle;
+    unsigned int  c     = 0;
+
+    if (mutex == NULL)
+        return 0;
+
+    return atomic_compare_exchange_strong_explicit(&mutex->state, &c, 1, memory_order_acquire, memory_order_relaxed);
+}
+
+int
+thread_wait_mutex(mutex_t *handle)
+{
+    sync_mutex_t *mutex = (sync_mutex_t *) handle;
+    unsigned int  c;
+
+    if (mutex == NULL)
+        return 0;
+
+    if (thread_test_mutex(handle))
+        return 1;
+
+    for (int i = 0; i < SYNC_SPIN; i++) {
+        sync_relax();
+        if ((atomic_load_explicit(&mutex->state, memory_order_relaxed) == 0) && thread_test_mutex(handle))
+            return 1;
+    }
+
+    /* From here on the mutex is marked as having someone sleeping on it,
+       which makes the unlock wake one up. */
+    c = atomic_exchange_explicit(&mutex->state, 2, memory_order_acquire);
+    while (c != 0) {
+        sync_wait(&mutex->state, 2, -1);
+        c = atomic_exchange_explicit(&mutex->state, 2, memory_order_acquire);
+    }
+
+    return 1;
+}
+
+int
+thread_release_mutex(mutex_t *handle)
+{
+    sync_mutex_t *mutex = (sync_mutex_t *) handle;
+
+    if (mutex == NULL)
+        return 0;
+
+    if (atomic_exchange_explicit(&mutex->state, 0, memory_order_release) == 2)
+        sync_wake(&mutex->state, 0);
+
+    return 1;
+}
+
+void
+thread_close_mutex(mutex_t *handle)
+{
+    free(handle);
+}
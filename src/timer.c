@@ -1,90 +1,179 @@
+#include <inttypes.h>
 #include <stdio.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 #include <wchar.h>
 #include <86box/86box.h>
 #include "cpu.h"
 #include <86box/timer.h>
+#include <86box/device.h>
+#include <86box/plat.h>
+#include <86box/plat_unused.h>
+#include <86box/bench.h>
+#include <86box/perf.h>
 #include <86box/nv/vid_nv_rivatimer.h>
+#include <minitrace/minitrace.h>
 
 uint64_t TIMER_USEC;
 uint32_t timer_target;
 
-/*Enabled timers are stored in a linked list, with the first timer to expire at
-  the head.*/
-pc_timer_t *timer_head = NULL;
+/*Enabled timers are stored in a binary min-heap, with the first timer to
+  expire at the root. Timers with equal timestamps expire most recently enabled
+  first, as they did with the old sorted list.*/
+static pc_timer_t **timer_heap       = NULL;
+static int          timer_heap_size  = 0;
+static int          timer_heap_alloc = 0;
+static uint32_t     timer_seq        = 0;
 
 /* Are we initialized? */
 int timer_inited = 0;
 
+#ifdef USE_TIMER_STATS
+#    define TIMER_STATS_MAX 256
+
+/*Accounting is kept per name and callback rather than per pc_timer_t, as
+  timers live in device structs that may be freed at any time.*/
+typedef struct timer_stats_t {
+    const char *name;
+    void      (*callback)(void *priv);
+    uint64_t    fires;
+    uint64_t    rearms;
+    uint64_t    host_time;
+} timer_stats_t;
+
+static timer_stats_t timer_stats[TIMER_STATS_MAX];
+static int           timer_stats_num = 0;
+static uint64_t      timer_stats_tsc = 0;
+
+static timer_stats_t *
+timer_stats_get(const char *name, void (*callback)(void *priv))
+{
+    timer_stats_t *stats;
+
+    for (int c = 0; c < timer_stats_num; c++) {
+        if ((timer_stats[c].callback == callback) && (timer_stats[c].name == name))
+            return &timer_stats[c];
+    }
+
+    /* Table full - lump everything else together. */
+    if (timer_stats_num == TIMER_STATS_MAX)
+        return &timer_stats[TIMER_STATS_MAX - 1];
+
+    stats           = &timer_stats[timer_stats_num++];
+    stats->name     = name;
+    stats->callback = callback;
+
+    return stats;
+}
+#endif
+
 static void timer_advance_ex(pc_timer_t *timer, int start);
 
+/*True if timer a has to expire before timer b*/
+static __inline int
+timer_heap_before(const pc_timer_t *a, const pc_timer_t *b)
+{
+    int64_t diff = (int64_t) (a->ts.ts64 - b->ts.ts64);
+
+    if (diff)
+        return diff < 0;
+
+    return (int32_t) (a->seq - b->seq) > 0;
+}
+
+static __inline void
+timer_heap_set(int idx, pc_timer_t *timer)
+{
+    timer_heap[idx]  = timer;
+    timer->heap_idx  = idx;
+}
+
+static void
+timer_heap_up(int idx)
+{
+    pc_timer_t *timer = timer_heap[idx];
+
+    while (idx > 0) {
+        int parent = (idx - 1) >> 1;
+
+        if (!timer_heap_before(timer, timer_heap[parent]))
+            break;
+
+        timer_heap_set(idx, timer_heap[parent]);
+        idx = parent;
+    }
+
+    timer_heap_set(idx, timer);
+}
+
+static void
+timer_heap_down(int idx)
+{
+    pc_timer_t *timer = timer_heap[idx];
+
+    while (1) {
+        int child = (idx << 1) + 1;
+
+        if (child >= timer_heap_size)
+            break;
+        if (((child + 1) < timer_heap_size) && timer_heap_before(timer_heap[child + 1], timer_heap[child]))
+            child++;
+        if (!timer_heap_before(timer_heap[child], timer))
+            break;
+
+        timer_heap_set(idx, timer_heap[child]);
+        idx = child;
+    }
+
+    timer_heap_set(idx, timer);
+}
+
+static void
+timer_heap_remove(int idx)
+{
+    pc_timer_t *last = timer_heap[--timer_heap_size];
+
+    timer_heap[idx]->heap_idx = -1;
+
+    if (idx < timer_heap_size) {
+        timer_heap_set(idx, last);
+        if ((idx > 0) && timer_heap_before(last, timer_heap[(idx - 1) >> 1]))
+            timer_heap_up(idx);
+        else
+            timer_heap_down(idx);
+    }
+
+    timer_heap[timer_heap_size] = NULL;
+}
+
 void
 timer_enable(pc_timer_t *timer)
 {
-    pc_timer_t *timer_node = timer_head;
-    int ret = 0;
-
     if (!timer_inited || (timer == NULL))
         return;
 
     if (timer->flags & TIMER_ENABLED)
         timer_disable(timer);
 
-    if (timer->next || timer->prev)
-        fatal("timer_disable(): Attempting to enable a non-isolated "
-              "timer incorrectly marked as disabled\n");
-
-    /*List currently empty - add to head*/
-    if (!timer_head) {
-        timer_head  = timer;
-        timer->next = timer->prev = NULL;
-        timer_target              = timer_head->ts.ts32.integer;
-        ret = 1;
-    } else if (TIMER_LESS_THAN(timer, timer_head)) {
-        timer->next      = timer_head;
-        timer->prev      = NULL;
-        timer_head->prev = timer;
-        timer_head       = timer;
-        timer_target     = timer_head->ts.ts32.integer;
-        ret = 1;
-    } else if (!timer_head->next) {
-        timer_head->next = timer;
-        timer->prev      = timer_head;
-        ret = 1;
+    if (timer_heap_size == timer_heap_alloc) {
+        timer_heap_alloc = timer_heap_alloc ? (timer_heap_alloc << 1) : 64;
+        timer_heap       = (pc_timer_t **) realloc(timer_heap, timer_heap_alloc * sizeof(pc_timer_t *));
+        if (timer_heap == NULL)
+            fatal("timer_enable(): Unable to grow the timer heap\n");
     }
 
-    if (ret == 0) {
-        pc_timer_t *prev = timer_head;
-        timer_node       = timer_head->next;
-
-        while (1) {
-            /*Timer expires before timer_node. Add to list in front of timer_node*/
-            if (TIMER_LESS_THAN(timer, timer_node)) {
-                timer->next      = timer_node;
-                timer->prev      = prev;
-                timer_node->prev = timer;
-                prev->next       = timer;
-                ret = 1;
-                break;
-            }
-
-            /*timer_node is last in the list. Add timer to end of list*/
-            if (!timer_node->next) {
-                timer_node->next = timer;
-                timer->prev      = timer_node;
-                ret = 1;
-                break;
-            }
+#ifdef USE_TIMER_STATS
+    if (timer->stats)
+        timer->stats->rearms++;
+#endif
 
-            prev       = timer_node;
-            timer_node = timer_node->next;
-        }
-    }
+    timer->seq = ++timer_seq;
+    timer_heap_set(timer_heap_size++, timer);
+    timer_heap_up(timer->heap_idx);
 
-    /* Do not mark it as enabled if it has failed every single condition. */
-    if (ret == 1)
-        timer->flags |= TIMER_ENABLED;
+    timer->flags |= TIMER_ENABLED;
+    timer_target = timer_heap[0]->ts.ts32.integer;
 }
 
 void
@@ -93,41 +182,34 @@ timer_disable(pc_timer_t *timer)
     if (!timer_inited || (timer == NULL) || !(timer->flags & TIMER_ENABLED))
         return;
 
-    if (!timer->next && !timer->prev && timer != timer_head)
-        fatal("timer_disable(): Attempting to disable an isolated "
-              "non-head timer incorrectly marked as enabled\n");
+    if ((timer->heap_idx < 0) || (timer->heap_idx >= timer_heap_size) || (timer_heap[timer->heap_idx] != timer))
+        fatal("timer_disable(): Attempting to disable a timer that is "
+              "incorrectly marked as enabled\n");
 
     timer->flags &= ~TIMER_ENABLED;
     timer->in_callback = 0;
 
-    if (timer->prev)
-        timer->prev->next = timer->next;
-    else
-        timer_head = timer->next;
-    if (timer->next)
-        timer->next->prev = timer->prev;
-    timer->prev = timer->next = NULL;
+    timer_heap_remove(timer->heap_idx);
 }
 
 void
 timer_process(void)
 {
     pc_timer_t *timer;
+    int         prev;
 
-    if (!timer_head)
+    if (!timer_heap_size)
         return;
 
-    while (1) {
-        timer = timer_head;
+    prev = perf_enter(PERF_TIMERS);
+
+    while (timer_heap_size) {
+        timer = timer_heap[0];
 
         if (!TIMER_LESS_THAN_VAL(timer, (uint32_t) tsc))
             break;
 
-        timer_head = timer->next;
-        if (timer_head)
-            timer_head->prev = NULL;
-
-        timer->next = timer->prev = NULL;
+        timer_heap_remove(0);
         timer->flags &= ~TIMER_ENABLED;
 
         if (timer->flags & TIMER_SPLIT)
@@ -137,31 +219,51 @@ timer_process(void)
             /* Make sure it's not NULL, so that we can
                have a NULL callback when no operation
                is needed. */
+#ifdef USE_TIMER_STATS
+            timer_stats_t *stats      = timer->stats;
+            const char    *name       = (stats && stats->name) ? stats->name : "(unnamed)";
+            uint64_t       start_time = plat_timer_read();
+
+            MTR_BEGIN("timer", name);
+#endif
+            BENCH_COUNT(timer_events, 1);
             timer->in_callback = 1;
             timer->callback(timer->priv);
             timer->in_callback = 0;
+#ifdef USE_TIMER_STATS
+            MTR_END("timer", name);
+
+            /* The callback may have freed the timer, so use the saved stats. */
+            if (stats) {
+                stats->fires++;
+                stats->host_time += plat_timer_read() - start_time;
+            }
+#endif
         }
     }
 
-    timer_target = timer_head->ts.ts32.integer;
+    if (timer_heap_size)
+        timer_target = timer_heap[0]->ts.ts32.integer;
+
+    perf_leave(prev);
 }
 
 void
 timer_close(void)
 {
-    pc_timer_t *t = timer_head;
-    pc_timer_t *r;
-
-    /* Set all timers' prev and next to NULL so it is assured that
-       timers that are not in malloc'd structs don't keep pointing
-       to timers that may be in malloc'd structs. */
-    while (t != NULL) {
-        r       = t;
-        r->prev = r->next = NULL;
-        t                 = r->next;
+#ifdef USE_TIMER_STATS
+    timer_stats_dump();
+#endif
+
+    /* Drop all timers from the heap, so that the heap does not keep
+       pointing to timers that may be in malloc'd structs. */
+    for (int c = 0; c < timer_heap_size; c++) {
+        timer_heap[c]->flags &= ~TIMER_ENABLED;
+        timer_heap[c]->heap_idx = -1;
+        timer_heap[c]           = NULL;
     }
 
-    timer_head = NULL;
+    timer_heap_size = 0;
 
     timer_inited = 0;
 }
@@ -187,7 +289,10 @@ timer_add(pc_timer_t *timer, void (*callback)(void *priv), void *priv, int start
     timer->in_callback = 0;
     timer->priv        = priv;
     timer->flags       = 0;
-    timer->prev        = timer->next = NULL;
+    timer->heap_idx    = -1;
+#ifdef USE_TIMER_STATS
+    timer->stats       = timer_stats_get(device_get_current_name(), callback);
+#endif
     if (start_timer)
         timer_set_delay_u64(timer, 0);
 }
@@ -264,27 +369,65 @@ timer_on_auto(pc_timer_t *timer, double period)
 void
 timer_set_new_tsc(uint64_t new_tsc)
 {
-    pc_timer_t *timer = NULL;
     /* Run timers already expired. */
 #ifdef USE_DYNAREC
     if (cpu_use_dynarec)
         update_tsc();
 #endif
 
-    if (!timer_head) {
+    if (!timer_heap_size) {
         tsc = new_tsc;
         return;
     }
 
-    timer = timer_head;
-    timer_target = new_tsc + (int32_t)(timer_get_ts_int(timer_head) - (uint32_t)tsc);
+    timer_target = new_tsc + (int32_t)(timer_get_ts_int(timer_heap[0]) - (uint32_t)tsc);
 
-    while (timer) {
+    /* Every timer moves by the same amount, so the heap order still holds. */
+    for (int c = 0; c < timer_heap_size; c++) {
+        pc_timer_t *timer = timer_heap[c];
         int32_t offset_from_current_tsc = (int32_t)(timer_get_ts_int(timer) - (uint32_t)tsc);
         timer->ts.ts32.integer = new_tsc + offset_from_current_tsc;
-
-        timer = timer->next;
     }
 
     tsc = new_tsc;
 }
+
+void
+timer_set_name(UNUSED(pc_timer_t *timer), UNUSED(const char *name))
+{
+#ifdef USE_TIMER_STATS
+    if (timer != NULL)
+        timer->stats = timer_stats_get(name, timer->callback);
+#endif
+}
+
+void
+timer_stats_dump(void)
+{
+#ifdef USE_TIMER_STATS
+    uint64_t tsc_per_sec = (TIMER_USEC >> 32) * 1000000ULL;
+    double   secs        = tsc_per_sec ? ((double) (tsc - timer_stats_tsc) / (double) tsc_per_sec) : 0.0;
+
+    pclog("Timer statistics over %.3f emulated seconds:\n", secs);
+    pclog("%-32s %-18s %12s %12s %12s\n", "Name", "Callback", "Fires/s", "Re-arms/s", "Host time");
+
+    for (int c = 0; c < timer_stats_num; c++) {
+        timer_stats_t *stats = &timer_stats[c];
+
+        if (!stats->fires && !stats->rearms)
+            continue;
+
+        pclog("%-32s %-18p %12.1f %12.1f %12" PRIu64 "\n",
+              stats->name ? stats->name : "(unnamed)", (void *) stats->callback,
+              (secs > 0.0) ? ((double) stats->fires / secs) : 0.0,
+              (secs > 0.0) ? ((double) stats->rearms / secs) : 0.0,
+              stats->host_time);
+
+        MTR_COUNTER("timer", stats->name ? stats->name : "(unnamed)", stats->fires);
+
+        stats->fires = stats->rearms = stats->host_time = 0;
+    }
+
+    timer_stats_tsc = tsc;
+#endif
+}
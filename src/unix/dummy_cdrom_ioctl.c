@@ -213,7 +213,8 @@ static const cdrom_ops_t ioctl_ops = {
     ioctl_has_audio,
     ioctl_is_empty,
     ioctl_close,
-    ioctl_load
+    ioctl_load,
+    NULL
 };
 
 /* Public functions. */
@@ -13,6 +13,7 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/mman.h>
+#include <signal.h>
 #include <unistd.h>
 #include <errno.h>
 #include <inttypes.h>
@@ -45,6 +46,9 @@
 #include <86box/video.h>
 #include <86box/ui.h>
 #include <86box/gdbstub.h>
+#include <86box/snapshot.h>
+#include <86box/bench.h>
+#include <86box/perf.h>
 
 #define __USE_GNU 1 /* shouldn't be done, yet it is */
 #include <pthread.h>
@@ -424,6 +428,104 @@ plat_munmap(void *ptr, size_t size)
     munmap(ptr, size);
 }
 
+void
+plat_mmap_hint_huge(void *ptr, size_t size)
+{
+#ifdef MADV_HUGEPAGE
+    (void) madvise(ptr, size, MADV_HUGEPAGE);
+#else
+    (void) ptr;
+    (void) size;
+#endif
+}
+
+void
+plat_mmap_hint_mergeable(void *ptr, size_t size)
+{
+#ifdef MADV_MERGEABLE
+    (void) madvise(ptr, size, MADV_MERGEABLE);
+#else
+    (void) ptr;
+    (void) size;
+#endif
+}
+
+/* Returns 1 if the pages now read back as zeroes, without any memory of their own. */
+int
+plat_mmap_discard(void *ptr, size_t size)
+{
+#if defined __linux__ && defined MADV_DONTNEED
+    return madvise(ptr, size, MADV_DONTNEED) == 0;
+#else
+    (void) ptr;
+    (void) size;
+    return 0;
+#endif
+}
+
+size_t
+plat_mmap_page_size(void)
+{
+    long ret = sysconf(_SC_PAGESIZE);
+
+    return (ret > 0) ? (size_t) ret : 4096;
+}
+
+/* Returns 1 if the pages are now read-only, or writable again. */
+int
+plat_mmap_protect(void *ptr, size_t size, int writable)
+{
+    return mprotect(ptr, size, PROT_READ | (writable ? PROT_WRITE : 0)) == 0;
+}
+
+static int            (*mmap_fault_handler)(void *addr);
+static struct sigaction mmap_fault_old_segv;
+static struct sigaction mmap_fault_old_bus;
+
+static void
+plat_mmap_fault(int sig, siginfo_t *info, void *ctx)
+{
+    struct sigaction *old = (sig == SIGBUS) ? &mmap_fault_old_bus : &mmap_fault_old_segv;
+
+    if (mmap_fault_handler(info->si_addr))
+        return;
+
+    /* Not a write to a page that was protected, so either hand it on, or
+       put the old action back in place and fault again. */
+    if (old->sa_flags & SA_SIGINFO)
+        old->sa_sigaction(sig, info, ctx);
+    else if ((old->sa_handler != SIG_DFL) && (old->sa_handler != SIG_IGN))
+        old->sa_handler(sig);
+    else
+        sigaction(sig, old, NULL);
+}
+
+/* The handler gets the address of a write to a read-only page, and returns
+   1 if it made the page writable again for the write to be retried. */
+int
+plat_mmap_fault_handler(int (*handler)(void *addr))
+{
+    struct sigaction sa;
+    int              installed = (mmap_fault_handler != NULL);
+
+    mmap_fault_handler = handler;
+    if (installed)
+        return 1;
+
+    memset(&sa, 0x00, sizeof(sa));
+    sa.sa_sigaction = plat_mmap_fault;
+    sa.sa_flags     = SA_SIGINFO;
+    sigemptyset(&sa.sa_mask);
+    if (sigaction(SIGSEGV, &sa, &mmap_fault_old_segv) < 0) {
+        mmap_fault_handler = NULL;
+        return 0;
+    }
+    /* macOS raises SIGBUS for these. */
+    sigaction(SIGBUS, &sa, &mmap_fault_old_bus);
+
+    return 1;
+}
+
 uint64_t
 plat_timer_read(void)
 {
@@ -453,12 +555,24 @@ plat_get_ticks(void)
     return (uint32_t) (plat_get_ticks_common() / 1000);
 }
 
+uint64_t
+plat_get_ticks_us(void)
+{
+    return plat_get_ticks_common();
+}
+
 void
 plat_remove(char *path)
 {
     remove(path);
 }
 
+int
+plat_rename(const char *from, const char *to)
+{
+    return rename(from, to);
+}
+
 void
 ui_sb_update_icon_state(UNUSED(int tag), UNUSED(int state))
 {
@@ -540,38 +654,44 @@ main_thread(UNUSED(void *param))
     uint32_t old_time;
     uint32_t new_time;
     int      drawits;
-    int      frames;
+    int      slice;
 
-    SDL_SetThreadPriority(SDL_THREAD_PRIORITY_HIGH);
+    /* Unless configured otherwise. */
+    if (thread_role_priority[THREAD_ROLE_CPU] == THREAD_PRIO_DEFAULT)
+        SDL_SetThreadPriority(SDL_THREAD_PRIORITY_HIGH);
     framecountx = 0;
     // title_update = 1;
     old_time = SDL_GetTicks();
-    drawits = frames = 0;
+    drawits = 0;
+#ifdef USE_BENCH
+    bench_init();
+#endif
     while (!is_quit && cpu_thread_run) {
         /* See if it is time to run a frame of code. */
         new_time = SDL_GetTicks();
 #ifdef USE_GDBSTUB
-        if (gdbstub_next_asap && (drawits <= 0))
+        if ((gdbstub_next_asap || turbo_mode) && (drawits <= 0))
             drawits = 10;
         else
 #endif
             drawits += (new_time - old_time);
         old_time = new_time;
         if (drawits > 0 && !dopause) {
-            /* Yes, so do one frame now. */
-            drawits -= 10;
+            /* Yes, so run a block of code now. */
+            slice = pc_run(drawits);
+            drawits -= slice;
             if (drawits > 50)
                 drawits = 0;
 
-            /* Run a block of code. */
-            pc_run();
+#ifdef USE_BENCH
+            if (bench_slice(slice))
+                do_stop();
+#endif
+
+            /* Save the NVR and flash images once they have settled. */
+            nvr_save_pending();
 
-            /* Every 200 frames we save the machine status. */
-            if (++frames >= 200 && nvr_dosave) {
-                nvr_save();
-                nvr_dosave = 0;
-                frames     = 0;
-            }
+            unix_clone_process();
         } else /* Just so we dont overload the host OS. */
             SDL_Delay(1);
 
@@ -601,7 +721,7 @@ do_start(void)
     timer_freq = SDL_GetPerformanceFrequency();
 
     /* Start the emulator, really. */
-    thMain = thread_create(main_thread, NULL);
+    thMain = thread_create_role(main_thread, NULL, THREAD_ROLE_CPU);
 }
 
 void
@@ -975,10 +1095,18 @@ monitor_thread(UNUSED(void *param))
                         "carteject <id> - eject cartridge from drive <id>.\n"
                         "moeject <id> - eject image from MO drive <id>.\n\n"
                         "hardreset - hard reset the emulated system.\n"
+                        "savestate <filename> [incremental] - save a snapshot of the emulated system.\n"
+                        "loadstate <filename> - resume from a snapshot.\n"
+                        "clone [count] - start copies of the emulated system in the background.\n"
                         "pause - pause the the emulated system.\n"
+                        "turbo - toggle unthrottled emulation.\n"
+                        "perf - print performance statistics.\n"
                         "fullscreen - toggle fullscreen.\n"
                         "version - print version and license information.\n"
                         "exit - exit 86Box.\n");
+#    ifdef MTR_ENABLED
+                    printf("trace [filename] - start or stop capturing a trace, to trace.json by default.\n");
+#    endif
                 } else if (strncasecmp(xargv[0], "exit", 4) == 0) {
                     exit_event = 1;
                 } else if (strncasecmp(xargv[0], "version", 7) == 0) {
@@ -994,6 +1122,8 @@ monitor_thread(UNUSED(void *param))
 #        define ARCH_STR "i386"
 #    elif defined(__x86_64) || defined(__x86_64__) || defined(__amd64) || defined(_M_X64)
 #        define ARCH_STR "x86_64"
+#    elif defined(__riscv) && (__riscv_xlen == 64)
+#        define ARCH_STR "riscv64"
 #    else
 #        define ARCH_STR "unknown arch"
 #    endif
@@ -1023,8 +1153,45 @@ monitor_thread(UNUSED(void *param))
                 } else if (strncasecmp(xargv[0], "pause", 5) == 0) {
                     plat_pause(dopause ^ 1);
                     printf("%s", dopause ? "Paused.\n" : "Unpaused.\n");
+                } else if (strncasecmp(xargv[0], "turbo", 5) == 0) {
+                    pc_set_turbo(turbo_mode ^ 1);
+                    printf("%s", turbo_mode ? "Turbo on.\n" : "Turbo off.\n");
                 } else if (strncasecmp(xargv[0], "hardreset", 9) == 0) {
                     pc_reset_hard();
+                } else if (strncasecmp(xargv[0], "savestate", 9) == 0 && cmdargc >= 2) {
+                    snapshot_request_save(xargv[1], (cmdargc >= 3) && xargv[2] && !strncasecmp(xargv[2], "inc", 3));
+                } else if (strncasecmp(xargv[0], "loadstate", 9) == 0 && cmdargc >= 2) {
+                    snapshot_request_load(xargv[1]);
+                } else if (strncasecmp(xargv[0], "perf", 4) == 0) {
+                    perf_stats_t stats;
+
+                    perf_get_stats(&stats);
+                    printf("Speed %i%%, %.1f MIPS, %u/%u frames rendered/presented per second.\n",
+                           stats.speed_pct, stats.mips, stats.fps_rendered, stats.fps_presented);
+                    if (stats.host_pct[PERF_CPU] >= 0)
+                        printf("Emulation thread: CPU %i%%, video %i%%, sound %i%%, timers %i%%, I/O %i%%, idle %i%%.\n",
+                               stats.host_pct[PERF_CPU], stats.host_pct[PERF_VIDEO], stats.host_pct[PERF_SOUND],
+                               stats.host_pct[PERF_TIMERS], stats.host_pct[PERF_IO], stats.host_pct[PERF_IDLE]);
+                    else
+                        printf("Host time sampling started, see the next update for it.\n");
+                    if (stats.cache_pct >= 0)
+                        printf("Code cache: %i%% in use.\n", stats.cache_pct);
+                    if (stats.fps_dropped)
+                        printf("Frame pacing: %u frames dropped per second.\n", stats.fps_dropped);
+                    if (stats.latency_us >= 0)
+                        printf("Input to present: %.1f ms average, %.1f ms worst.\n",
+                               stats.latency_us / 1000.0, stats.latency_max_us / 1000.0);
+                    perf_sampling(1);
+                } else if (strncasecmp(xargv[0], "trace", 5) == 0) {
+                    if (pc_trace_active()) {
+                        pc_trace_stop();
+                        printf("Trace stopped.\n");
+                    } else if (pc_trace_start(((cmdargc >= 2) && xargv[1]) ? xargv[1] : "trace.json") == 0)
+                        printf("Tracing to %s.\n", ((cmdargc >= 2) && xargv[1]) ? xargv[1] : "trace.json");
+                    else
+                        printf("This build can not trace.\n");
+                } else if (strncasecmp(xargv[0], "clone", 5) == 0) {
+                    unix_clone_request(((cmdargc >= 2) && xargv[1]) ? atoi(xargv[1]) : 1);
                 } else if (strncasecmp(xargv[0], "cdload", 6) == 0 && cmdargc >= 3) {
                     uint8_t id;
                     bool    err = false;
@@ -1213,7 +1380,12 @@ main(int argc, char **argv)
     } else
         fprintf(stderr, "libedit not found, line editing will be limited.\n");
     mousemutex = SDL_CreateMutex();
+#ifdef USE_BENCH
+    sdl_initnull();
+    start_in_fullscreen = 0;
+#else
     sdl_initho();
+#endif
 
     if (start_in_fullscreen) {
         video_fullscreen = 1;
@@ -1222,16 +1394,29 @@ main(int argc, char **argv)
     /* Fire up the machine. */
     pc_reset_hard_init();
 
+#ifdef USE_BENCH
+    /* The micro-benchmarks are run instead of it, if asked for. */
+    if (bench_kernels_num) {
+        int ret = bench_kernels_run();
+
+        SDL_DestroyMutex(blitmtx);
+        SDL_DestroyMutex(mousemutex);
+        SDL_Quit();
+        return ret;
+    }
+#endif
+
     /* Set the PAUSE mode depending on the renderer. */
     plat_pause(0);
 
     /* Initialize the rendering window, or fullscreen. */
 
     do_start();
-#ifndef USE_CLI
+#if !defined(USE_CLI) && !defined(USE_BENCH)
     thread_create(monitor_thread, NULL);
 #endif
     SDL_AddTimer(1000, timer_onesec, NULL);
+    unix_clone_init();
     while (!is_quit) {
         static int mouse_inside = 0;
 
@@ -1298,9 +1483,9 @@ main(int argc, char **argv)
                             }
                             SDL_LockMutex(mousemutex);
                             if (event.button.state == SDL_PRESSED)
-                                mouse_set_buttons_ex(mouse_get_buttons_ex() | buttonmask);
+                                mouse_press_buttons(buttonmask);
                             else
-                                mouse_set_buttons_ex(mouse_get_buttons_ex() & ~buttonmask);
+                                mouse_release_buttons(buttonmask);
                             SDL_UnlockMutex(mousemutex);
                         }
                         break;
@@ -1361,6 +1546,10 @@ main(int argc, char **argv)
             do_stop();
             break;
         }
+#ifdef USE_BENCH
+        /* There is no window to serve, so stay out of the measurements. */
+        SDL_Delay(10);
+#endif
     }
     printf("\n");
     SDL_DestroyMutex(blitmtx);
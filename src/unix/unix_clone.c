@@ -0,0 +1,371 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Cloning of the running machine with fork().
+ *
+ *          The clone starts out with the memory of the machine it was
+ *          cloned from, shared copy-on-write by the host, so it takes no
+ *          longer than the fork() itself, plus copying the overlays of
+ *          the hard disks. Clones run headless and silent, and keep
+ *          going until they are killed, or their parent exits.
+ *
+ *          Only the emulation thread makes it across a fork(), so a
+ *          machine is only cloned if every other thread it has running
+ *          is one that can be started again in the clone. As the clone
+ *          shares the files of its parent, every hard disk needs to have
+ *          an overlay, which the clone gets a copy of, and no ZIP or MO
+ *          image may be writable. Floppies are write-protected in the
+ *          clone. A clone never saves the configuration or the NVR.
+ */
+#ifdef __linux__
+#    define _FILE_OFFSET_BITS   64
+#    define _LARGEFILE64_SOURCE 1
+#endif
+#include <SDL.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#ifdef __linux__
+#    include <sys/prctl.h>
+#endif
+#include <wchar.h>
+#include <86box/86box.h>
+#include <86box/plat.h>
+#include <86box/thread.h>
+#include <86box/timer.h>
+#include <86box/device.h>
+#include <86box/hdd.h>
+#include <86box/fdd.h>
+#include <86box/scsi_device.h>
+#include <86box/zip.h>
+#include <86box/mo.h>
+#include <86box/network.h>
+#include <86box/sound.h>
+#include <86box/video.h>
+#include <86box/perf.h>
+#include <86box/log.h>
+#include <86box/snapshot.h>
+#include <86box/unix_sdl.h>
+
+#define CLONE_MAX 64 /* Clones running at once. */
+
+extern SDL_mutex *blitmtx;
+extern SDL_mutex *mousemutex;
+
+static atomic_int clone_pending = 0;
+static pid_t      clone_pids[CLONE_MAX];
+static int        clone_count = 0;
+
+/* Threads that the clone starts again on its own. */
+static const char *clone_threads[] = {
+    "main_thread",
+    "monitor_thread",
+    "blit_thread",
+    "screenshot_thread_func",
+    "sound_cd_thread",
+    "net_slirp_thread",
+    "net_pcap_thread",
+    "net_vde_thread",
+    "net_tap_thread",
+    "net_null_thread",
+    NULL
+};
+
+static void
+clone_signal(UNUSED(int sig))
+{
+    atomic_fetch_add(&clone_pending, 1);
+}
+
+void
+unix_clone_init(void)
+{
+    struct sigaction sa;
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = clone_signal;
+    sa.sa_flags   = SA_RESTART;
+    sigemptyset(&sa.sa_mask);
+    (void) sigaction(SIGUSR1, &sa, NULL);
+}
+
+/* Clones the machine count times, at the end of the next slice. */
+void
+unix_clone_request(int count)
+{
+    if (count > 0)
+        atomic_fetch_add(&clone_pending, count);
+}
+
+#ifdef __linux__
+static void
+clone_check_thread(const char *name, void *priv)
+{
+    const char **bad = (const char **) priv;
+
+    for (int i = 0; clone_threads[i] != NULL; i++) {
+        if (!strcmp(name, clone_threads[i]))
+            return;
+    }
+
+    if (*bad == NULL)
+        *bad = name;
+}
+
+/* Returns 1 if the machine can be cloned, prints why not otherwise. */
+static int
+clone_check(void)
+{
+    const char *bad = NULL;
+
+    if (clone_count >= CLONE_MAX) {
+        printf("Clone: There are already %i clones running.\n", clone_count);
+        return 0;
+    }
+
+    thread_enum(clone_check_thread, &bad);
+    if (bad != NULL) {
+        printf("Clone: Thread '%s' can not be started again in a clone.\n", bad);
+        return 0;
+    }
+
+    for (int i = 0; i < HDD_NUM; i++) {
+        if (hdd_is_valid(i) && !hdd[i].overlay_fn[0]) {
+            printf("Clone: Hard disk %i has no overlay.\n", i);
+            return 0;
+        }
+    }
+
+    for (int i = 0; i < ZIP_NUM; i++) {
+        if (zip_drives[i].image_path[0] && !zip_drives[i].read_only) {
+            printf("Clone: ZIP image '%s' is writable.\n", zip_drives[i].image_path);
+            return 0;
+        }
+    }
+
+    for (int i = 0; i < MO_NUM; i++) {
+        if (mo_drives[i].image_path[0] && !mo_drives[i].read_only) {
+            printf("Clone: MO image '%s' is writable.\n", mo_drives[i].image_path);
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+/*
+ * A fork()ed file descriptor shares its offset with the parent, so every
+ * regular file is opened again through /proc to get one of its own. The
+ * sockets all belong to host drivers of the parent, and are closed.
+ */
+static void
+clone_reopen_files(int keep)
+{
+    DIR           *dir = opendir("/proc/self/fd");
+    struct dirent *ent;
+    int            dir_fd;
+
+    if (dir == NULL)
+        return;
+
+    dir_fd = dirfd(dir);
+
+    while ((ent = readdir(dir)) != NULL) {
+        char        path[64];
+        struct stat st;
+        int         fd = atoi(ent->d_name);
+        int         nfd;
+        int         flags;
+        int         fd_flags;
+        off_t       off;
+
+        if ((ent->d_name[0] < '0') || (ent->d_name[0] > '9') || (fd <= 2) || (fd == keep) || (fd == dir_fd))
+            continue;
+
+        if (fstat(fd, &st) < 0)
+            continue;
+
+        if (S_ISSOCK(st.st_mode)) {
+            close(fd);
+            continue;
+        }
+
+        if (!S_ISREG(st.st_mode))
+            continue;
+
+        flags    = fcntl(fd, F_GETFL);
+        fd_flags = fcntl(fd, F_GETFD);
+        off      = lseek(fd, 0, SEEK_CUR);
+        snprintf(path, sizeof(path), "/proc/self/fd/%i", fd);
+
+        nfd = open(path, flags & ~(O_CREAT | O_EXCL | O_TRUNC));
+        if (nfd < 0)
+            continue;
+
+        if (off >= 0)
+            (void) lseek(nfd, off, SEEK_SET);
+        if (dup2(nfd, fd) >= 0)
+            (void) fcntl(fd, F_SETFD, fd_flags);
+        close(nfd);
+    }
+
+    closedir(dir);
+}
+
+static void
+clone_child(int ready_fd)
+{
+    char fn[1024 + 32];
+
+    is_clone    = 1;
+    clone_count = 0;
+
+    /* Go along with the parent. */
+    (void) prctl(PR_SET_PDEATHSIG, SIGTERM);
+
+    clone_reopen_files(ready_fd);
+
+    blitmtx    = SDL_CreateMutex();
+    mousemutex = SDL_CreateMutex();
+
+    sdl_clone_child();
+    video_clone_child();
+    sound_clone_child();
+    network_clone_child((uint32_t) getpid());
+    perf_clone_child();
+    log_clone_child();
+
+    for (int i = 0; i < HDD_NUM; i++) {
+        if (!hdd_is_valid(i))
+            continue;
+
+        snprintf(fn, sizeof(fn), "%s.clone-%i", hdd[i].overlay_fn, (int) getpid());
+        if (hdd_image_overlay_clone(i, fn) < 0) {
+            fprintf(stderr, "Clone: Unable to copy the overlay of hard disk %i to '%s'\n", i, fn);
+            _exit(1);
+        }
+    }
+
+    for (int i = 0; i < FDD_NUM; i++) {
+        writeprot[i]  = 1;
+        fwriteprot[i] = 1;
+    }
+
+    /* The parent can go on writing to its overlays now. */
+    if (write(ready_fd, "1", 1) < 0)
+        _exit(1);
+    close(ready_fd);
+
+    pclog("Clone: Running as process %i\n", (int) getpid());
+}
+
+/* Returns 1 in the clone. */
+static int
+clone_one(void)
+{
+    int     fds[2];
+    pid_t   pid;
+    ssize_t n;
+    char    c;
+
+    if (pipe(fds) < 0) {
+        printf("Clone: Unable to create a pipe: %s\n", strerror(errno));
+        return 0;
+    }
+
+    /* Nothing may be left in a buffer shared with the clone. */
+    for (int i = 0; i < HDD_NUM; i++) {
+        if (hdd_is_valid(i))
+            hdd_image_flush(i);
+    }
+    fflush(NULL);
+
+    startblit();
+    pid = fork();
+
+    if (pid == 0) {
+        close(fds[0]);
+        clone_child(fds[1]);
+        return 1;
+    }
+
+    endblit();
+    close(fds[1]);
+
+    if (pid < 0) {
+        printf("Clone: fork() failed: %s\n", strerror(errno));
+        close(fds[0]);
+        return 0;
+    }
+
+    /* Wait for the clone to take its copy of the overlays. */
+    while (((n = read(fds[0], &c, 1)) < 0) && (errno == EINTR))
+        ;
+    close(fds[0]);
+
+    if (n != 1) {
+        printf("Clone: Process %i failed to start.\n", (int) pid);
+        (void) waitpid(pid, NULL, 0);
+        return 0;
+    }
+
+    clone_pids[clone_count++] = pid;
+    printf("Clone: Started process %i\n", (int) pid);
+
+    return 0;
+}
+
+static void
+clone_reap(void)
+{
+    for (int i = 0; i < clone_count; i++) {
+        if (waitpid(clone_pids[i], NULL, WNOHANG) == clone_pids[i])
+            clone_pids[i--] = clone_pids[--clone_count];
+    }
+}
+
+/* Called from the emulation thread, between slices. */
+void
+unix_clone_process(void)
+{
+    int count;
+
+    if (clone_count)
+        clone_reap();
+
+    count = atomic_exchange(&clone_pending, 0);
+    if (!count || !clone_check())
+        return;
+
+    /* A snapshot that is still being written is finished first. */
+    snapshot_close();
+
+    while (count-- && (clone_count < CLONE_MAX)) {
+        if (clone_one())
+            break;
+    }
+}
+#else
+void
+unix_clone_process(void)
+{
+    if (atomic_exchange(&clone_pending, 0))
+        printf("Clone: Only supported on Linux.\n");
+}
+#endif
@@ -14,6 +14,7 @@
 #include <86box/plat.h>
 #include <86box/plat_dynld.h>
 #include <86box/video.h>
+#include <86box/vid_scale.h>
 #include <86box/ui.h>
 #include <86box/version.h>
 #include <86box/unix_sdl.h>
@@ -46,6 +47,7 @@ static int          cur_ww      = 0;
 static int          cur_wh      = 0;
 static volatile int sdl_enabled = 1;
 static SDL_mutex   *sdl_mutex   = NULL;
+static int          sdl_headless = 0; /* A clone, with no window of its own. */
 int                 mouse_capture;
 int                 title_set         = 0;
 int                 resize_pending    = 0;
@@ -53,6 +55,14 @@ int                 resize_w          = 0;
 int                 resize_h          = 0;
 static void        *pixeldata;
 
+/* The software renderer scales the frame itself, SDL's own scaling is
+   far too slow at window sizes. */
+static video_scaler_t *sdl_scaler     = NULL;
+static SDL_Texture    *sdl_scaled_tex = NULL;
+static uint32_t       *sdl_scaled     = NULL;
+static int             sdl_scaled_w   = 0;
+static int             sdl_scaled_h   = 0;
+
 extern void RenderImGui(void);
 static void
 sdl_integer_scale(double *d, double *g)
@@ -157,35 +167,93 @@ sdl_blit_shim(int x, int y, int w, int h, int monitor_index)
 
     if (monitors[monitor_index].mon_screenshots)
         video_screenshot((uint32_t *) pixeldata, 0, 0, 2048);
-    blitreq = 1;
 
     video_blit_complete_monitor(monitor_index);
+
+    /* A frame overtaken while waiting for its turn is never shown. */
+    if (video_blit_pace_monitor(monitor_index))
+        blitreq = 1;
 }
 
 void ui_window_title_real(void);
 
-void
-sdl_real_blit(SDL_Rect *r_src)
+static void
+sdl_dest_rect(const SDL_Rect *r_src, SDL_Rect *r_dst)
 {
-    SDL_Rect r_dst;
-    int      ret;
-    int      winx;
-    int      winy;
+    int winx;
+    int winy;
 
     SDL_GL_GetDrawableSize(sdl_win, &winx, &winy);
-    SDL_RenderClear(sdl_render);
 
-    r_dst   = *r_src;
-    r_dst.x = r_dst.y = 0;
+    *r_dst   = *r_src;
+    r_dst->x = r_dst->y = 0;
 
     if (sdl_fs) {
-        sdl_stretch(&r_dst.w, &r_dst.h, &r_dst.x, &r_dst.y);
+        sdl_stretch(&r_dst->w, &r_dst->h, &r_dst->x, &r_dst->y);
     } else {
-        r_dst.w *= ((float) winx / (float) r_dst.w);
-        r_dst.h *= ((float) winy / (float) r_dst.h);
+        r_dst->w *= ((float) winx / (float) r_dst->w);
+        r_dst->h *= ((float) winy / (float) r_dst->h);
+    }
+}
+
+static int
+sdl_use_scaler(const SDL_Rect *r_src, const SDL_Rect *r_dst)
+{
+    if ((sdl_scaler == NULL) || (r_dst->w <= 0) || (r_dst->h <= 0) || (r_dst->w > 8192) || (r_dst->h > 8192))
+        return 0;
+
+    return (r_dst->w != r_src->w) || (r_dst->h != r_src->h);
+}
+
+/* Scales the frame in pixeldata to the size it is drawn at. */
+static void
+sdl_scale_frame(const SDL_Rect *r_src, const SDL_Rect *r_dst)
+{
+    uint32_t *buf;
+
+    if ((sdl_scaled_tex == NULL) || (sdl_scaled_w != r_dst->w) || (sdl_scaled_h != r_dst->h)) {
+        if (sdl_scaled_tex != NULL)
+            SDL_DestroyTexture(sdl_scaled_tex);
+        sdl_scaled_w = sdl_scaled_h = 0;
+
+        buf = realloc(sdl_scaled, (size_t) r_dst->w * r_dst->h * sizeof(uint32_t));
+        if (buf == NULL) {
+            sdl_scaled_tex = NULL;
+            return;
+        }
+        sdl_scaled     = buf;
+        sdl_scaled_tex = SDL_CreateTexture(sdl_render, SDL_PIXELFORMAT_ARGB8888,
+                                           SDL_TEXTUREACCESS_STREAMING, r_dst->w, r_dst->h);
+        if (sdl_scaled_tex == NULL)
+            return;
+        sdl_scaled_w = r_dst->w;
+        sdl_scaled_h = r_dst->h;
+        video_scaler_invalidate(sdl_scaler);
     }
 
-    ret = SDL_RenderCopy(sdl_render, sdl_tex, r_src, &r_dst);
+    if (video_scale(sdl_scaler, sdl_scaled, sdl_scaled_w, sdl_scaled_w, sdl_scaled_h,
+                    (const uint32_t *) pixeldata, 2048, r_src->w, r_src->h,
+                    video_filter_method ? VIDEO_SCALE_LINEAR : VIDEO_SCALE_NEAREST))
+        SDL_UpdateTexture(sdl_scaled_tex, NULL, sdl_scaled, sdl_scaled_w * sizeof(uint32_t));
+}
+
+void
+sdl_real_blit(SDL_Rect *r_src)
+{
+    SDL_Rect r_dst;
+    SDL_Rect r_scaled = { 0, 0, 0, 0 };
+    int      ret;
+
+    SDL_RenderClear(sdl_render);
+
+    sdl_dest_rect(r_src, &r_dst);
+
+    if (sdl_use_scaler(r_src, &r_dst) && (sdl_scaled_tex != NULL) && (sdl_scaled_w == r_dst.w) && (sdl_scaled_h == r_dst.h)) {
+        r_scaled.w = r_dst.w;
+        r_scaled.h = r_dst.h;
+        ret        = SDL_RenderCopy(sdl_render, sdl_scaled_tex, &r_scaled, &r_dst);
+    } else
+        ret = SDL_RenderCopy(sdl_render, sdl_tex, r_src, &r_dst);
     if (ret)
         fprintf(stderr, "SDL: unable to copy texture to renderer (%s)\n", SDL_GetError());
 
@@ -196,6 +264,7 @@ void
 sdl_blit(int x, int y, int w, int h)
 {
     SDL_Rect r_src;
+    SDL_Rect r_dst;
 
     if (!sdl_enabled || (x < 0) || (y < 0) || (w <= 0) || (h <= 0) || (w > 2048) || (h > 2048) || (buffer32 == NULL) || (sdl_render == NULL) || (sdl_tex == NULL)) {
         r_src.x = x;
@@ -218,7 +287,11 @@ sdl_blit(int x, int y, int w, int h)
     r_src.y = y;
     r_src.w = w;
     r_src.h = h;
-    SDL_UpdateTexture(sdl_tex, &r_src, pixeldata, 2048 * 4);
+    sdl_dest_rect(&r_src, &r_dst);
+    if (sdl_use_scaler(&r_src, &r_dst))
+        sdl_scale_frame(&r_src, &r_dst);
+    else
+        SDL_UpdateTexture(sdl_tex, &r_src, pixeldata, 2048 * 4);
     blitreq = 0;
 
     sdl_real_blit(&r_src);
@@ -248,6 +321,9 @@ sdl_destroy_texture(void)
         SDL_DestroyRenderer(sdl_render);
         sdl_render = NULL;
     }
+    sdl_scaled_tex = NULL;
+    sdl_scaled_w   = 0;
+    sdl_scaled_h   = 0;
 }
 
 void
@@ -275,6 +351,11 @@ sdl_close(void)
         pixeldata = NULL;
     }
 
+    video_scaler_close(sdl_scaler);
+    sdl_scaler = NULL;
+    free(sdl_scaled);
+    sdl_scaled = NULL;
+
     /* Quit. */
     SDL_Quit();
     sdl_flags = -1;
@@ -436,6 +517,8 @@ sdl_init_common(int flags)
     atexit(sdl_close);
 
     pixeldata = malloc(2048 * 2048 * 4);
+    if (!(flags & RENDERER_HARDWARE))
+        sdl_scaler = video_scaler_init();
 
     /* Register our renderer! */
     video_setblit(sdl_blit_shim);
@@ -463,6 +546,35 @@ sdl_initho(void)
     return sdl_init_common(RENDERER_HARDWARE | RENDERER_OPENGL);
 }
 
+static void
+sdl_blit_null(UNUSED(int x), UNUSED(int y), UNUSED(int w), UNUSED(int h), int monitor_index)
+{
+    video_blit_complete_monitor(monitor_index);
+}
+
+/* No window at all, frames are dropped as soon as they are finished. */
+int
+sdl_initnull(void)
+{
+    sdl_mutex    = SDL_CreateMutex();
+    sdl_enabled  = 0;
+    sdl_headless = 1;
+
+    video_setblit(sdl_blit_null);
+
+    return 1;
+}
+
+/* Runs in a fork()ed clone, where the window and the event loop stayed
+   behind with the parent. Frames are dropped from now on. */
+void
+sdl_clone_child(void)
+{
+    sdl_mutex    = SDL_CreateMutex();
+    sdl_enabled  = 0;
+    sdl_headless = 1;
+}
+
 int
 sdl_pause(void)
 {
@@ -495,6 +607,11 @@ void
 ui_window_title_real(void)
 {
     char *res;
+
+    if (sdl_headless) {
+        title_set = 0;
+        return;
+    }
     if (sizeof(wchar_t) == 1) {
         SDL_SetWindowTitle(sdl_win, (char *) sdl_win_title);
         return;
@@ -515,6 +632,11 @@ ui_window_title(wchar_t *str)
 {
     if (!str)
         return sdl_win_title;
+    if (sdl_headless) {
+        memset(sdl_win_title, 0, sizeof(sdl_win_title));
+        wcsncpy(sdl_win_title, str, 512);
+        return str;
+    }
 #ifdef __APPLE__
     if (eventthread == SDL_ThreadID())
 #endif
@@ -48,29 +48,19 @@
 #define LOG_PREFIX "serial_passthrough: "
 
 int
-plat_serpt_read(void *priv, uint8_t *data)
+plat_serpt_read(void *priv, uint8_t *data, int len)
 {
     serial_passthrough_t *dev = (serial_passthrough_t *) priv;
-    int                   res;
-    struct timeval        tv;
-    fd_set                rdfds;
+    ssize_t               res;
 
     switch (dev->mode) {
         case SERPT_MODE_VCON:
         case SERPT_MODE_HOSTSER:
-            FD_ZERO(&rdfds);
-            FD_SET(dev->master_fd, &rdfds);
-            tv.tv_sec  = 0;
-            tv.tv_usec = 0;
-
-            res = select(dev->master_fd + 1, &rdfds, NULL, NULL, &tv);
-            if (res <= 0 || !FD_ISSET(dev->master_fd, &rdfds)) {
-                return 0;
-            }
-
-            if (read(dev->master_fd, data, 1) > 0) {
-                return 1;
-            }
+            /* Both are opened non-blocking, so a plain read() returns
+               whatever is there without a select() first. */
+            res = read(dev->master_fd, data, len);
+            if (res > 0)
+                return (int) res;
             break;
         default:
             break;
@@ -91,13 +81,13 @@ plat_serpt_close(void *priv)
 }
 
 static void
-plat_serpt_write_vcon(serial_passthrough_t *dev, uint8_t data)
+plat_serpt_write_vcon(serial_passthrough_t *dev, const uint8_t *data, int len)
 {
 #if 0
     fd_set wrfds;
     int    res;
 #endif
-    size_t res;
+    ssize_t res;
 
     /* We cannot use select here, this would block the hypervisor! */
 #if 0
@@ -113,11 +103,16 @@ plat_serpt_write_vcon(serial_passthrough_t *dev, uint8_t data)
 
     /* just write it out */
     if (dev->mode == SERPT_MODE_HOSTSER) {
-        do {
-            res = write(dev->master_fd, &data, 1);
-        } while (res == 0 || (res == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)));
+        while (len > 0) {
+            res = write(dev->master_fd, data, len);
+            if (res > 0) {
+                data += res;
+                len -= res;
+            } else if ((res == -1) && (errno != EAGAIN) && (errno != EWOULDBLOCK))
+                break;
+        }
     } else
-        res = write(dev->master_fd, &data, 1);
+        res = write(dev->master_fd, data, len);
 }
 
 void
@@ -191,14 +186,14 @@ plat_serpt_set_params(void *priv)
 }
 
 void
-plat_serpt_write(void *priv, uint8_t data)
+plat_serpt_write(void *priv, const uint8_t *data, int len)
 {
     serial_passthrough_t *dev = (serial_passthrough_t *) priv;
 
     switch (dev->mode) {
         case SERPT_MODE_VCON:
         case SERPT_MODE_HOSTSER:
-            plat_serpt_write_vcon(dev, data);
+            plat_serpt_write_vcon(dev, data, len);
             break;
         default:
             break;
@@ -1,3 +1,4 @@
+#include <stdarg.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <time.h>
@@ -6,6 +7,7 @@
 #include <86box/86box.h>
 #include <86box/plat.h>
 #include <86box/thread.h>
+#include <86box/log.h>
 
 typedef struct event_pthread_t {
     pthread_cond_t  cond;
@@ -13,31 +15,115 @@ typedef struct event_pthread_t {
     int             state;
 } event_pthread_t;
 
+/* Every thread started by thread_create() and still running. */
+typedef struct thread_entry_t {
+    const char            *name;
+    pthread_t              id;
+    struct thread_entry_t *prev;
+    struct thread_entry_t *next;
+} thread_entry_t;
+
 typedef struct thread_param {
     void (*thread_rout)(void *);
-    void *param;
+    void          *param;
+    int            role;
+    thread_entry_t entry;
 } thread_param;
 
 typedef struct pt_mutex_t {
     pthread_mutex_t mutex;
 } pt_mutex_t;
 
+static pthread_mutex_t thread_list_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t  thread_list_once = PTHREAD_ONCE_INIT;
+static thread_entry_t *thread_list      = NULL;
+
+static void
+thread_list_add(thread_entry_t *entry)
+{
+    pthread_mutex_lock(&thread_list_lock);
+    entry->prev = NULL;
+    entry->next = thread_list;
+    if (thread_list != NULL)
+        thread_list->prev = entry;
+    thread_list = entry;
+    pthread_mutex_unlock(&thread_list_lock);
+}
+
+static void
+thread_list_remove(thread_entry_t *entry)
+{
+    pthread_mutex_lock(&thread_list_lock);
+    if (entry->prev != NULL)
+        entry->prev->next = entry->next;
+    else
+        thread_list = entry->next;
+    if (entry->next != NULL)
+        entry->next->prev = entry->prev;
+    pthread_mutex_unlock(&thread_list_lock);
+}
+
+static void
+thread_list_prepare(void)
+{
+    pthread_mutex_lock(&thread_list_lock);
+}
+
+static void
+thread_list_parent(void)
+{
+    pthread_mutex_unlock(&thread_list_lock);
+}
+
+/* Only the thread that forked lives on in the child. */
+static void
+thread_list_child(void)
+{
+    pthread_mutex_init(&thread_list_lock, NULL);
+
+    for (thread_entry_t *entry = thread_list; entry != NULL; entry = entry->next) {
+        if (pthread_equal(entry->id, pthread_self())) {
+            entry->prev = entry->next = NULL;
+            thread_list               = entry;
+            return;
+        }
+    }
+
+    thread_list = NULL;
+}
+
+static void
+thread_list_init(void)
+{
+    pthread_atfork(thread_list_prepare, thread_list_parent, thread_list_child);
+}
+
 void *
 thread_run_wrapper(thread_param *arg)
 {
-    thread_param localparam = *arg;
+    arg->entry.id = pthread_self();
+    thread_list_add(&arg->entry);
+    thread_role_apply(arg->role);
+
+    arg->thread_rout(arg->param);
+    log_thread_exit();
+
+    thread_list_remove(&arg->entry);
     free(arg);
-    localparam.thread_rout(localparam.param);
     return NULL;
 }
 
 thread_t *
-thread_create_named(void (*thread_rout)(void *param), void *param, const char *name)
+thread_create_named(void (*thread_rout)(void *param), void *param, const char *name, int role)
 {
     pthread_t    *thread   = malloc(sizeof(pthread_t));
     thread_param *thrparam = malloc(sizeof(thread_param));
     thrparam->thread_rout  = thread_rout;
     thrparam->param        = param;
+    thrparam->role         = role;
+    thrparam->entry.name   = name;
+
+    pthread_once(&thread_list_once, thread_list_init);
 
     pthread_create(thread, NULL, (void *(*) (void *) ) thread_run_wrapper, thrparam);
     plat_set_thread_name(thread, name);
@@ -45,12 +131,22 @@ thread_create_named(void (*thread_rout)(void *param), void *param, const char *n
     return thread;
 }
 
+void
+thread_enum(void (*func)(const char *name, void *priv), void *priv)
+{
+    pthread_mutex_lock(&thread_list_lock);
+    for (const thread_entry_t *entry = thread_list; entry != NULL; entry = entry->next)
+        func(entry->name, priv);
+    pthread_mutex_unlock(&thread_list_lock);
+}
+
 int
 thread_wait(thread_t *arg)
 {
     return pthread_join(*(pthread_t *) (arg), NULL);
 }
 
+#ifndef USE_FAST_SYNC
 event_t *
 thread_create_event(void)
 {
@@ -169,3 +265,4 @@ thread_close_mutex(mutex_t *_mutex)
 
     free(mutex);
 }
+#endif
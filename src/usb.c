@@ -26,6 +26,7 @@
 #include <86box/device.h>
 #include <86box/io.h>
 #include <86box/mem.h>
+#include <86box/timer.h>
 #include <86box/usb.h>
 #include "cpu.h"
 #include <86box/plat_unused.h>
@@ -48,15 +49,62 @@ usb_log(const char *fmt, ...)
 #    define usb_log(fmt, ...)
 #endif
 
+/*
+ * Nothing is ever attached to the root hubs, so there is no schedule to
+ * walk and no need for a frame timer. The frame counters only advance
+ * while the controllers run, and are brought up to date from the TSC
+ * whenever the guest looks at them.
+ */
+static double
+usb_frame_cycles(const usb_t *dev, uint32_t bit_times)
+{
+    /* Full speed USB runs at 12 Mbit/s. */
+    return ((double) bit_times / 12.0) * dev->cycles_us;
+}
+
+static uint64_t
+usb_frames_elapsed(uint64_t *frame_tsc, double frame_cycles)
+{
+    uint64_t frames = (uint64_t) ((double) (tsc - *frame_tsc) / frame_cycles);
+
+    *frame_tsc += (uint64_t) ((double) frames * frame_cycles);
+
+    return frames;
+}
+
+static int
+uhci_running(const usb_t *dev)
+{
+    return (dev->uhci_io[0x00] & 0x01) && !(dev->uhci_io[0x02] & 0x20);
+}
+
+static void
+uhci_frame_sync(usb_t *dev)
+{
+    uint16_t *regs = (uint16_t *) dev->uhci_io;
+    uint64_t  frames;
+
+    if (!uhci_running(dev))
+        return;
+
+    /* SOFMOD adjusts the frame length around 12000 bit times. */
+    frames = usb_frames_elapsed(&dev->uhci_frame_tsc, usb_frame_cycles(dev, 11936 + (dev->uhci_io[0x0c] & 0x7f)));
+    if (frames)
+        regs[0x03] = (regs[0x03] + frames) & 0x07ff;
+}
+
 static uint8_t
 uhci_reg_read(uint16_t addr, void *priv)
 {
-    const usb_t   *dev = (usb_t *) priv;
+    usb_t         *dev = (usb_t *) priv;
     uint8_t        ret;
     const uint8_t *regs = dev->uhci_io;
 
     addr &= 0x0000001f;
 
+    if ((addr == 0x06) || (addr == 0x07))
+        uhci_frame_sync(dev);
+
     ret = regs[addr];
 
     return ret;
@@ -85,6 +133,7 @@ uhci_reg_write(uint16_t addr, uint8_t val, void *priv)
             regs[addr] = val;
             break;
         case 0x0c:
+            uhci_frame_sync(dev);
             regs[0x0c] = (val & 0x7f);
             break;
 
@@ -103,14 +152,17 @@ uhci_reg_writew(uint16_t addr, uint16_t val, void *priv)
 
     switch (addr) {
         case 0x00:
-            if ((val & 0x0001) && !(regs[0x00] & 0x0001))
+            uhci_frame_sync(dev);
+            if ((val & 0x0001) && !(regs[0x00] & 0x0001)) {
                 regs[0x01] &= ~0x20;
-            else if (!(val & 0x0001))
+                dev->uhci_frame_tsc = tsc;
+            } else if (!(val & 0x0001))
                 regs[0x01] |= 0x20;
             regs[0x00] = (val & 0x00ff);
             break;
         case 0x06:
             regs[0x03] = (val & 0x07ff);
+            dev->uhci_frame_tsc = tsc;
             break;
         case 0x10:
         case 0x12:
@@ -136,14 +188,79 @@ uhci_update_io_mapping(usb_t *dev, uint8_t base_l, uint8_t base_h, int enable)
         io_sethandler(dev->uhci_io_base, 0x20, uhci_reg_read, NULL, NULL, uhci_reg_write, uhci_reg_writew, NULL, dev);
 }
 
+static int
+ohci_operational(const usb_t *dev)
+{
+    return (dev->ohci_mmio[0x04] & 0xc0) == 0x80;
+}
+
+static uint32_t
+ohci_frame_interval(const usb_t *dev)
+{
+    uint32_t fi = (dev->ohci_mmio[0x34] | (dev->ohci_mmio[0x35] << 8)) & 0x3fff;
+
+    /* Not programmed yet, use the nominal 1 ms. */
+    return fi ? (fi + 1) : 12000;
+}
+
+static void
+ohci_frame_sync(usb_t *dev)
+{
+    uint64_t frames;
+    uint16_t old_fn;
+    uint16_t fn;
+
+    if (!ohci_operational(dev))
+        return;
+
+    frames = usb_frames_elapsed(&dev->ohci_frame_tsc, usb_frame_cycles(dev, ohci_frame_interval(dev)));
+    if (!frames)
+        return;
+
+    old_fn = dev->ohci_mmio[0x3c] | (dev->ohci_mmio[0x3d] << 8);
+    fn     = old_fn + frames;
+    dev->ohci_mmio[0x3c] = fn & 0xff;
+    dev->ohci_mmio[0x3d] = fn >> 8;
+
+    /* StartofFrame, and FrameNumberOverflow whenever bit 15 has toggled. */
+    dev->ohci_mmio[0x0c] |= 0x04;
+    if ((frames >= 0x8000) || ((old_fn ^ fn) & 0x8000))
+        dev->ohci_mmio[0x0c] |= 0x20;
+}
+
 static uint8_t
 ohci_mmio_read(uint32_t addr, void *priv)
 {
-    const usb_t  *dev = (usb_t *) priv;
+    usb_t        *dev = (usb_t *) priv;
     uint8_t       ret = 0x00;
+    uint32_t      remaining;
 
     addr &= 0x00000fff;
 
+    switch (addr) {
+        case 0x0c:
+        case 0x3c:
+        case 0x3d:
+            ohci_frame_sync(dev);
+            break;
+        case 0x38:
+        case 0x39:
+            /* HcFmRemaining counts down the bit times left in the frame. */
+            ohci_frame_sync(dev);
+            if (ohci_operational(dev)) {
+                uint32_t fi   = ohci_frame_interval(dev);
+                uint32_t used = (uint32_t) ((double) (tsc - dev->ohci_frame_tsc) / usb_frame_cycles(dev, 1));
+
+                remaining = fi - 1 - MIN(used, fi - 1);
+                dev->ohci_mmio[0x38] = remaining & 0xff;
+                dev->ohci_mmio[0x39] = (remaining >> 8) & 0x3f;
+            }
+            break;
+
+        default:
+            break;
+    }
+
     ret = dev->ohci_mmio[addr];
 
     if (addr == 0x101)
@@ -162,10 +279,18 @@ ohci_mmio_write(uint32_t addr, uint8_t val, void *priv)
 
     switch (addr) {
         case 0x04:
+            ohci_frame_sync(dev);
             if ((val & 0xc0) == 0x00) {
                 /* UsbReset */
                 dev->ohci_mmio[0x56] = dev->ohci_mmio[0x5a] = 0x16;
             }
+            /* Entering UsbOperational starts a new frame. */
+            if (((val & 0xc0) == 0x80) && !ohci_operational(dev))
+                dev->ohci_frame_tsc = tsc;
+            break;
+        case 0x34:
+        case 0x35:
+            ohci_frame_sync(dev);
             break;
         case 0x08: /* HCCOMMANDSTATUS */
             /* bit OwnershipChangeRequest triggers an ownership change (SMM <-> OS) */
@@ -389,6 +514,18 @@ usb_reset(void *priv)
     dev->ohci_enable = 0;
 }
 
+static void
+usb_speed_changed(void *priv)
+{
+    usb_t *dev = (usb_t *) priv;
+
+    /* Account for the frames so far at the old speed. */
+    uhci_frame_sync(dev);
+    ohci_frame_sync(dev);
+
+    dev->cycles_us = MAX((double) TIMER_USEC / 4294967296.0, 1.0);
+}
+
 static void
 usb_close(void *priv)
 {
@@ -422,6 +559,8 @@ usb_init(UNUSED(const device_t *info))
                     NULL, MEM_MAPPING_EXTERNAL, dev);
     usb_reset(dev);
 
+    dev->cycles_us = MAX((double) TIMER_USEC / 4294967296.0, 1.0);
+
     return dev;
 }
 
@@ -434,7 +573,7 @@ const device_t usb_device = {
     .close         = usb_close,
     .reset         = usb_reset,
     .available     = NULL,
-    .speed_changed = NULL,
+    .speed_changed = usb_speed_changed,
     .force_redraw  = NULL,
     .config        = NULL
 };
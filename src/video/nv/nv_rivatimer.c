@@ -31,17 +31,130 @@ LARGE_INTEGER performance_frequency;
 rivatimer_t* rivatimer_head;        // The head of the rivatimer list. 
 rivatimer_t* rivatimer_tail;        // The tail of the rivatimer list.
 
+// The running rivatimers, as a min-heap on their deadline.
+static rivatimer_t** rivatimer_heap;
+static int rivatimer_heap_count;
+static int rivatimer_heap_size;
+
+// Host time in uS at the start of the current slice.
+static double rivatimer_slice_time;
+
 /* Functions only used in this translation unit */
 bool rivatimer_really_exists(rivatimer_t* rivatimer);   // Determine if a rivatimer really exists in the linked list.
 
+// Query the host performance counter, in uS.
+static double rivatimer_query_host_time(void)
+{
+    #ifdef _WIN32
+        LARGE_INTEGER current_time;
+
+        QueryPerformanceCounter(&current_time);
+
+        return ((double)current_time.QuadPart * 1000000.0) / (double)performance_frequency.QuadPart;
+    #else
+        struct timespec current_time; 
+
+        clock_gettime(CLOCK_MONOTONIC, &current_time);
+
+        return ((double)current_time.tv_sec * 1000000.0) + ((double)current_time.tv_nsec / 1000.0);
+    #endif
+}
+
+static void rivatimer_heap_swap(int a, int b)
+{
+    rivatimer_t* tmp = rivatimer_heap[a];
+
+    rivatimer_heap[a] = rivatimer_heap[b];
+    rivatimer_heap[b] = tmp;
+    rivatimer_heap[a]->heap_index = a;
+    rivatimer_heap[b]->heap_index = b;
+}
+
+static void rivatimer_heap_sift_up(int index)
+{
+    while (index > 0)
+    {
+        int parent = (index - 1) / 2;
+
+        if (rivatimer_heap[parent]->deadline <= rivatimer_heap[index]->deadline)
+            break;
+
+        rivatimer_heap_swap(parent, index);
+        index = parent;
+    }
+}
+
+static void rivatimer_heap_sift_down(int index)
+{
+    while (true)
+    {
+        int child = (index * 2) + 1;
+
+        if (child >= rivatimer_heap_count)
+            break;
+
+        if ((child + 1) < rivatimer_heap_count
+        && rivatimer_heap[child + 1]->deadline < rivatimer_heap[child]->deadline)
+            child++;
+
+        if (rivatimer_heap[index]->deadline <= rivatimer_heap[child]->deadline)
+            break;
+
+        rivatimer_heap_swap(index, child);
+        index = child;
+    }
+}
+
+// Add a running rivatimer to the heap, or move it after its deadline changed.
+static void rivatimer_heap_update(rivatimer_t* rivatimer_ptr)
+{
+    if (rivatimer_ptr->heap_index < 0)
+    {
+        if (rivatimer_heap_count == rivatimer_heap_size)
+        {
+            rivatimer_heap_size = rivatimer_heap_size ? (rivatimer_heap_size * 2) : 8;
+            rivatimer_heap = realloc(rivatimer_heap, rivatimer_heap_size * sizeof(rivatimer_t*));
+
+            if (!rivatimer_heap)
+                fatal("rivatimer_heap_update: Out of memory");
+        }
+
+        rivatimer_ptr->heap_index = rivatimer_heap_count;
+        rivatimer_heap[rivatimer_heap_count++] = rivatimer_ptr;
+    }
+
+    rivatimer_heap_sift_up(rivatimer_ptr->heap_index);
+    rivatimer_heap_sift_down(rivatimer_ptr->heap_index);
+}
+
+static void rivatimer_heap_remove(rivatimer_t* rivatimer_ptr)
+{
+    int index = rivatimer_ptr->heap_index;
+
+    if (index < 0)
+        return;
+
+    rivatimer_heap_count--;
+    if (index != rivatimer_heap_count)
+    {
+        rivatimer_heap_swap(index, rivatimer_heap_count);
+        rivatimer_heap_sift_up(index);
+        rivatimer_heap_sift_down(index);
+    }
+
+    rivatimer_ptr->heap_index = -1;
+}
+
 void rivatimer_init(void)
 {
+    #ifdef _WIN32
+    // Query the performance frequency.
+    QueryPerformanceFrequency(&performance_frequency);
+    #endif
+
     // Destroy all the rivatimers.
     rivatimer_t* rivatimer_ptr = rivatimer_head;
 
-    if (!rivatimer_ptr)
-        return;
-
     while (rivatimer_ptr)
     {
         // since we are destroing it
@@ -50,12 +163,8 @@ void rivatimer_init(void)
         
         rivatimer_ptr = old_next;
     }
-        
 
-    #ifdef _WIN32
-    // Query the performance frequency.
-    QueryPerformanceFrequency(&performance_frequency);
-    #endif
+    rivatimer_heap_count = 0;
 }
 
 // Creates a rivatimer.
@@ -81,6 +190,7 @@ rivatimer_t* rivatimer_create(double period, void (*callback)(double real_time))
     else // Otherwise add a new one to the list
     {
         rivatimer_tail->next = calloc(1, sizeof(rivatimer_t));
+        rivatimer_tail->next->prev = rivatimer_tail;
         rivatimer_tail = rivatimer_tail->next;
         new_rivatimer = rivatimer_tail;
     }
@@ -92,6 +202,7 @@ rivatimer_t* rivatimer_create(double period, void (*callback)(double real_time))
         new_rivatimer->period = period;
         new_rivatimer->next = NULL; // indicate this is the last in the list
         new_rivatimer->callback = callback;
+        new_rivatimer->heap_index = -1;
     }
 
     return new_rivatimer;
@@ -121,6 +232,8 @@ void rivatimer_destroy(rivatimer_t* rivatimer_ptr)
 {
     if (!rivatimer_really_exists(rivatimer_ptr))
         fatal("rivatimer_destroy: The timer was already destroyed, or never existed in the first place.");
+
+    rivatimer_heap_remove(rivatimer_ptr);
     
     // Case: We are destroying the head
     if (rivatimer_ptr == rivatimer_head)
@@ -162,60 +275,38 @@ void rivatimer_destroy(rivatimer_t* rivatimer_ptr)
     rivatimer_ptr = NULL; //explicitly set to null
 }
 
+// Fire the rivatimers that are due. Only the earliest deadline is looked at
+// when nothing is due, and nothing at all when no rivatimer is running.
 void rivatimer_update_all(void)
 {
-    rivatimer_t* rivatimer_ptr = rivatimer_head;
-
-    if (!rivatimer_ptr)
+    if (!rivatimer_heap_count)
         return;
 
-    while (rivatimer_ptr)
-    {
-        // if it's not running skip it
-        if (!rivatimer_ptr->running)
-        {
-            rivatimer_ptr = rivatimer_ptr->next;
-            continue;
-        }
-
-        #ifdef _WIN32
-            LARGE_INTEGER current_time;
+    rivatimer_slice_time = rivatimer_query_host_time();
 
-            QueryPerformanceCounter(&current_time);
-
-            double microseconds = ((double)current_time.QuadPart / 1000000.0) - (rivatimer_ptr->starting_time.QuadPart / 1000000.0);
-        #else
-            struct timespec current_time; 
-
-            clock_gettime(CLOCK_REALTIME, &current_time);
-
-            double microseconds = ((double)current_time.tv_sec * 1000000.0) + ((double)current_time.tv_nsec / 1000.0);
-        #endif
+    while (rivatimer_heap_count
+    && rivatimer_heap[0]->deadline <= rivatimer_slice_time)
+    {
+        rivatimer_t* rivatimer_ptr = rivatimer_heap[0];
+        double microseconds = rivatimer_slice_time - rivatimer_ptr->start_time;
 
-        rivatimer_ptr->time += microseconds; 
+        rivatimer_ptr->time += microseconds;
 
-        // Reset the current time so we can actually restart
-        #ifdef _WIN32
-            QueryPerformanceCounter(&rivatimer_ptr->starting_time);
-        #else
-            clock_gettime(CLOCK_REALTIME, &rivatimer_ptr->starting_time);
-        #endif 
+        // Reset the current time so we can actually restart. This is done
+        // before the callback, which may stop, restart or destroy the timer.
+        rivatimer_ptr->start_time = rivatimer_slice_time;
+        rivatimer_ptr->deadline = rivatimer_slice_time + rivatimer_ptr->period;
+        rivatimer_heap_sift_down(0);
 
-        // Time to fire
-        if (microseconds > rivatimer_ptr->period)
-        {
-            if (!rivatimer_ptr->callback)
-            {
-                pclog("Eh? No callback in RivaTimer?");
-                continue;
-            }
-                    
-            rivatimer_ptr->callback(microseconds);
-        }
-
-        rivatimer_ptr = rivatimer_ptr->next;
+        rivatimer_ptr->callback(microseconds);
     }
+}
 
+// Get the host time in uS at the start of the current slice, as used by the
+// rivatimers, without querying the performance counter again.
+double rivatimer_get_host_time(void)
+{
+    return rivatimer_slice_time;
 }
 
 void rivatimer_start(rivatimer_t* rivatimer_ptr)
@@ -228,12 +319,12 @@ void rivatimer_start(rivatimer_t* rivatimer_ptr)
 
     rivatimer_ptr->running = true;
 
-    // Start off so rivatimer_update_all can actually update.
-    #ifdef _WIN32
-        QueryPerformanceCounter(&rivatimer_ptr->starting_time);
-    #else
-        clock_gettime(CLOCK_REALTIME, &rivatimer_ptr->starting_time);
-    #endif 
+    // Start off so rivatimer_update_all can actually update. The slice time
+    // may be stale when no rivatimer was running, so query the host here.
+    rivatimer_slice_time = rivatimer_query_host_time();
+    rivatimer_ptr->start_time = rivatimer_slice_time;
+    rivatimer_ptr->deadline = rivatimer_slice_time + rivatimer_ptr->period;
+    rivatimer_heap_update(rivatimer_ptr);
 }
 
 void rivatimer_stop(rivatimer_t* rivatimer_ptr)
@@ -241,6 +332,8 @@ void rivatimer_stop(rivatimer_t* rivatimer_ptr)
     if (!rivatimer_really_exists(rivatimer_ptr))
         fatal("rivatimer_stop: The timer has been destroyed, or never existed in the first place.");
 
+    rivatimer_heap_remove(rivatimer_ptr);
+
     rivatimer_ptr->running = false;
     rivatimer_ptr->time = 0;
 }
@@ -271,4 +364,11 @@ void rivatimer_set_period(rivatimer_t* rivatimer_ptr, double period)
        fatal("rivatimer_set_period: The timer has been destroyed, or never existed in the first place.");
 
     rivatimer_ptr->period = period;
+
+    // Move a running timer to its new deadline.
+    if (rivatimer_ptr->running)
+    {
+        rivatimer_ptr->deadline = rivatimer_ptr->start_time + period;
+        rivatimer_heap_update(rivatimer_ptr);
+    }
 }
\ No newline at end of file
@@ -41,6 +41,7 @@
 #include <86box/vid_svga_render.h>
 #include <86box/vid_ati_eeprom.h>
 #include <86box/vid_ati_mach8.h>
+#include <86box/vid_blit.h>
 #include "cpu.h"
 
 #ifdef CLAMP
@@ -987,6 +988,149 @@ ibm8514_short_stroke_start(int count, int cpu_input, uint32_t mix_dat, uint32_t
     ibm8514_accel_start(count, cpu_input, mix_dat, cpu_dat, svga, len);
 }
 
+/*Fast paths for solid rectangle fills and screen to screen copies. They are
+  only used for plain source writes with no colour compare or write mask, when
+  the rectangle can not wrap around video memory, and give the same result as
+  the generic pixel loops below.*/
+static __inline uint32_t
+ibm8514_accel_row_base(ibm8514_t *dev, int16_t y)
+{
+    if ((dev->accel_bpp == 24) || (dev->accel_bpp <= 8))
+        return (dev->accel.ge_offset << 2) + (y * dev->pitch);
+    else if (dev->bpp)
+        return (dev->accel.ge_offset << 1) + (y * dev->pitch);
+
+    return (dev->accel.ge_offset << 2) + (y * dev->pitch);
+}
+
+static __inline int
+ibm8514_accel_fast_ok(ibm8514_t *dev, int count, uint32_t mix_dat, int pixcntl, int compare_mode, uint16_t wrt_mask)
+{
+    uint16_t pixel_mask = dev->bpp ? 0xffff : 0x00ff;
+
+    if ((count >= 0) || (mix_dat != 0xffffffff) || pixcntl || compare_mode)
+        return 0;
+    if ((wrt_mask & pixel_mask) != pixel_mask)
+        return 0;
+
+    return ((dev->accel.frgd_mix & 0x1f) == 0x07) && (dev->accel.cmd & 0x10) && !(dev->accel.cmd & 0x04) &&
+           (dev->accel.sy >= 0) && (dev->accel.sx == (dev->accel.maj_axis_pcnt & 0x7ff));
+}
+
+/*Returns non-zero if the pixels [start, end] of rows y_first to y_last lie
+  within video memory, without wrapping*/
+static int
+ibm8514_accel_range_ok(ibm8514_t *dev, int y_first, int y_last, int start, int end)
+{
+    int64_t limit = dev->bpp ? (dev->vram_mask >> 1) : dev->vram_mask;
+    int64_t base  = ibm8514_accel_row_base(dev, 0);
+    int64_t lo    = base + ((int64_t) MIN(y_first, y_last) * dev->pitch) + start;
+    int64_t hi    = base + ((int64_t) MAX(y_first, y_last) * dev->pitch) + end;
+
+    if ((y_first < INT16_MIN) || (y_first > INT16_MAX) || (y_last < INT16_MIN) || (y_last > INT16_MAX))
+        return 0;
+
+    return (dev->pitch >= 0) && (lo >= 0) && (hi <= limit);
+}
+
+/*Solid rectangle fill. Returns zero if the generic path has to be used instead*/
+static int
+ibm8514_accel_fast_rectfill(ibm8514_t *dev, int cmd, uint16_t color, int clip_t, int clip_l, int clip_b, int clip_r)
+{
+    int     pixel_bytes = dev->bpp ? 2 : 1;
+    int     w           = dev->accel.sx + 1;
+    int     h           = dev->accel.sy + 1;
+    int     ydir        = (dev->accel.cmd & 0x80) ? 1 : -1;
+    int     xl          = (dev->accel.cmd & 0x20) ? dev->accel.cx : (dev->accel.cx - (w - 1));
+    int     xr          = xl + w - 1;
+    int16_t cy          = dev->accel.cy;
+
+    if (!ibm8514_accel_range_ok(dev, cy, cy + ((h - 1) * ydir), xl, xr))
+        return 0;
+
+    for (int row = 0; row < h; row++) {
+        int l = MAX(xl, clip_l);
+        int r = MIN(xr, clip_r);
+
+        if ((cy >= clip_t) && (cy <= clip_b) && (l <= r)) {
+            uint32_t dest = (ibm8514_accel_row_base(dev, cy) + l) * pixel_bytes;
+            uint32_t len  = (r - l + 1) * pixel_bytes;
+
+            dev->subsys_stat |= 0x02;
+            video_blit_fill(&dev->vram[dest], color, pixel_bytes, len);
+            video_blit_mark_changed(dev->changedvram, dest, len, changeframecount);
+        }
+
+        cy += ydir;
+    }
+
+    dev->accel.fill_state = 0;
+    dev->accel.cy         = cy;
+    dev->accel.sx         = dev->accel.maj_axis_pcnt & 0x7ff;
+    dev->accel.sy         = -1;
+    dev->accel.dest       = ibm8514_accel_row_base(dev, cy);
+    if (cmd != 4) {
+        dev->accel.cur_x = dev->accel.cx;
+        dev->accel.cur_y = dev->accel.cy;
+    }
+    dev->accel.cmd_back = 1;
+
+    return 1;
+}
+
+/*Screen to screen BitBLT in either direction. Returns zero if the generic path
+  has to be used instead*/
+static int
+ibm8514_accel_fast_bitblt(ibm8514_t *dev, int clip_t, int clip_l, int clip_b, int clip_r)
+{
+    int     pixel_bytes = dev->bpp ? 2 : 1;
+    int     w           = dev->accel.sx + 1;
+    int     h           = dev->accel.sy + 1;
+    int     xdir        = (dev->accel.cmd & 0x20) ? 1 : -1;
+    int     ydir        = (dev->accel.cmd & 0x80) ? 1 : -1;
+    int     xl          = (xdir > 0) ? dev->accel.dx : (dev->accel.dx - (w - 1));
+    int     xr          = xl + w - 1;
+    int     src_x       = dev->accel.cx - dev->accel.dx;
+    int16_t cy          = dev->accel.cy;
+    int16_t dy          = dev->accel.dy;
+
+    if (!ibm8514_accel_range_ok(dev, cy, cy + ((h - 1) * ydir), xl + src_x, xr + src_x))
+        return 0;
+    if (!ibm8514_accel_range_ok(dev, dy, dy + ((h - 1) * ydir), xl, xr))
+        return 0;
+
+    for (int row = 0; row < h; row++) {
+        int l = MAX(xl, clip_l);
+        int r = MIN(xr, clip_r);
+
+        if ((dy >= clip_t) && (dy <= clip_b) && (l <= r)) {
+            uint32_t src  = (ibm8514_accel_row_base(dev, cy) + l + src_x) * pixel_bytes;
+            uint32_t dest = (ibm8514_accel_row_base(dev, dy) + l) * pixel_bytes;
+            uint32_t len  = (r - l + 1) * pixel_bytes;
+
+            dev->subsys_stat |= 0x02;
+            video_blit_copy(dev->vram, dest, src, len, pixel_bytes, xdir);
+            video_blit_mark_changed(dev->changedvram, dest, len, changeframecount);
+        }
+
+        cy += ydir;
+        dy += ydir;
+    }
+
+    dev->accel.fill_state = 0;
+    dev->accel.cy         = cy;
+    dev->accel.dy         = dy;
+    dev->accel.sx         = dev->accel.maj_axis_pcnt & 0x7ff;
+    dev->accel.sy         = -1;
+    dev->accel.src        = ibm8514_accel_row_base(dev, cy);
+    dev->accel.dest       = ibm8514_accel_row_base(dev, dy);
+    dev->accel.destx      = dev->accel.dx;
+    dev->accel.desty      = dev->accel.dy;
+    dev->accel.cmd_back   = 1;
+
+    return 1;
+}
+
 void
 ibm8514_accel_start(int count, int cpu_input, uint32_t mix_dat, uint32_t cpu_dat, svga_t *svga, UNUSED(int len))
 {
@@ -2420,6 +2564,11 @@ skip_nibble_rect_write:
                         }
                     } else {
                         ibm8514_log("Polygon Draw Type=%02x, CX=%d, CY=%d, SY=%d, CL=%d, CR=%d.\n", dev->accel.multifunc[0x0a] & 0x06, dev->accel.cx, dev->accel.cy, dev->accel.sy, clip_l, clip_r);
+                        if (!(dev->accel.multifunc[0x0a] & 0x06) && (frgd_mix == 1) &&
+                            ibm8514_accel_fast_ok(dev, count, mix_dat, pixcntl, compare_mode, wrt_mask) &&
+                            ibm8514_accel_fast_rectfill(dev, cmd, frgd_color, clip_t, clip_l, clip_b, clip_r))
+                            return;
+
                         while (count-- && (dev->accel.sy >= 0)) {
                             if ((dev->accel.cx >= clip_l) &&
                                 (dev->accel.cx <= clip_r) &&
@@ -3199,6 +3348,10 @@ skip_nibble_bitblt_write:
                             }
                         }
                     } else {
+                        if ((frgd_mix == 3) && ibm8514_accel_fast_ok(dev, count, mix_dat, pixcntl, compare_mode, wrt_mask) &&
+                            ibm8514_accel_fast_bitblt(dev, clip_t, clip_l, clip_b, clip_r))
+                            return;
+
                         while (count-- && dev->accel.sy >= 0) {
                             if ((dev->accel.dx >= clip_l) &&
                                 (dev->accel.dx <= clip_r) &&
@@ -34,11 +34,14 @@
 #include <86box/rom.h>
 #include <86box/plat.h>
 #include <86box/thread.h>
+#include <86box/spsc.h>
 #include <86box/video.h>
 #include <86box/i2c.h>
 #include <86box/vid_ddc.h>
 #include <86box/vid_svga.h>
 #include <86box/vid_svga_render.h>
+#include <86box/vid_blit.h>
+#include <86box/vid_overlay.h>
 #include <86box/vid_ati_eeprom.h>
 
 #ifdef CLAMP
@@ -54,9 +57,9 @@
 #define FIFO_MASK         (FIFO_SIZE - 1)
 #define FIFO_ENTRY_SIZE   (1 << 31)
 
-#define FIFO_ENTRIES      (mach64->fifo_write_idx - mach64->fifo_read_idx)
-#define FIFO_FULL         ((mach64->fifo_write_idx - mach64->fifo_read_idx) >= FIFO_SIZE)
-#define FIFO_EMPTY        (mach64->fifo_read_idx == mach64->fifo_write_idx)
+#define FIFO_ENTRIES      spsc_entries(&mach64->fifo_ring)
+#define FIFO_FULL         (spsc_entries(&mach64->fifo_ring) >= FIFO_SIZE)
+#define FIFO_EMPTY        spsc_empty(&mach64->fifo_ring)
 
 #define FIFO_TYPE         0xff000000
 #define FIFO_ADDR         0x00ffffff
@@ -247,8 +250,7 @@ typedef struct mach64_t {
     } accel;
 
     fifo_entry_t fifo[FIFO_SIZE];
-    atomic_int   fifo_read_idx;
-    atomic_int   fifo_write_idx;
+    spsc_t       fifo_ring;
     atomic_int   blitter_busy;
 
     thread_t *fifo_thread;
@@ -663,7 +665,7 @@ mach64_update_irqs(mach64_t *mach64)
 static __inline void
 wake_fifo_thread(mach64_t *mach64)
 {
-    thread_set_event(mach64->wake_fifo_thread); /*Wake up FIFO thread if moving from idle*/
+    spsc_wake(&mach64->fifo_ring); /*Wake up FIFO thread if moving from idle*/
 }
 
 static void
@@ -1180,13 +1182,12 @@ fifo_thread(void *param)
 
     while (mach64->thread_run) {
         thread_set_event(mach64->fifo_not_full_event);
-        thread_wait_event(mach64->wake_fifo_thread, -1);
-        thread_reset_event(mach64->wake_fifo_thread);
+        spsc_park(&mach64->fifo_ring);
         mach64->blitter_busy = 1;
         while (!FIFO_EMPTY) {
             uint64_t      start_time = plat_timer_read();
             uint64_t      end_time;
-            fifo_entry_t *fifo = &mach64->fifo[mach64->fifo_read_idx & FIFO_MASK];
+            fifo_entry_t *fifo = &mach64->fifo[spsc_read_pos(&mach64->fifo_ring)];
 
             switch (fifo->addr_type & FIFO_TYPE) {
                 case FIFO_WRITE_BYTE:
@@ -1203,11 +1204,8 @@ fifo_thread(void *param)
                     break;
             }
 
-            mach64->fifo_read_idx++;
             fifo->addr_type = FIFO_INVALID;
-
-            if (FIFO_ENTRIES > 0xe000)
-                thread_set_event(mach64->fifo_not_full_event);
+            spsc_pop(&mach64->fifo_ring);
 
             end_time = plat_timer_read();
             mach64->blitter_time += end_time - start_time;
@@ -1219,7 +1217,7 @@ fifo_thread(void *param)
 static void
 mach64_queue(mach64_t *mach64, uint32_t addr, uint32_t val, uint32_t type)
 {
-    fifo_entry_t *fifo = &mach64->fifo[mach64->fifo_write_idx & FIFO_MASK];
+    fifo_entry_t *fifo;
     int limit = 0;
 
     switch (type) {
@@ -1254,26 +1252,13 @@ mach64_queue(mach64_t *mach64, uint32_t addr, uint32_t val, uint32_t type)
             break;
     }
 
-    if (limit) {
-        if (FIFO_ENTRIES >= 16) {
-            thread_reset_event(mach64->fifo_not_full_event);
-            if (FIFO_ENTRIES >= 16) {
-                thread_wait_event(mach64->fifo_not_full_event, -1); /*Wait for room in ringbuffer*/
-            }
-        }
-    } else {
-        if (FIFO_FULL) {
-            thread_reset_event(mach64->fifo_not_full_event);
-            if (FIFO_FULL) {
-                thread_wait_event(mach64->fifo_not_full_event, -1); /*Wait for room in ringbuffer*/
-            }
-        }
-    }
+    spsc_wait_below(&mach64->fifo_ring, limit ? 16 : FIFO_SIZE);
 
+    fifo            = &mach64->fifo[spsc_write_pos(&mach64->fifo_ring)];
     fifo->val       = val;
     fifo->addr_type = (addr & FIFO_ADDR) | type;
 
-    mach64->fifo_write_idx++;
+    spsc_push(&mach64->fifo_ring);
 
     if (FIFO_ENTRIES > 0xe000 || FIFO_ENTRIES < 8)
         wake_fifo_thread(mach64);
@@ -1601,6 +1586,140 @@ mach64_start_line(mach64_t *mach64)
         svga->changedvram[(((addr) >> 3) & mach64->vram_mask) >> 12] = svga->monitor->mon_changeframecount; \
     }
 
+/*Rotate a 24-bit colour so that byte number phase comes first*/
+static __inline uint32_t
+mach64_rot24(uint32_t col, int phase)
+{
+    col &= 0xffffff;
+    col = (col >> (phase << 3)) | (col << ((3 - phase) << 3));
+
+    return col & 0xffffff;
+}
+
+/*Solid fills and plain SRCCOPY blits with MONO_SRC_1, optionally with a source
+  colour key, done a row at a time. Returns zero if the generic pixel loop has
+  to be used instead*/
+static int
+mach64_blit_rect_fast(mach64_t *mach64)
+{
+    svga_t  *svga     = &mach64->svga;
+    int      size     = mach64->accel.dst_size;
+    int      bytes_pp = 1 << size;
+    int      rot24    = !!(mach64->dst_cntl & DST_24_ROT_EN);
+    int      copy     = (mach64->accel.source_fg == SRC_BLITSRC);
+    int      keyed    = 0;
+    int      w        = (mach64->accel.dst_width > 0) ? mach64->accel.dst_width : 1;
+    int      h        = (mach64->accel.dst_height > 0) ? mach64->accel.dst_height : 1;
+    int      xinc     = mach64->accel.xinc;
+    int      yinc     = mach64->accel.yinc;
+    int      dx0      = mach64->accel.dst_x_start;
+    int      dy0      = mach64->accel.dst_y_start;
+    int      sx0      = mach64->accel.src_x_start;
+    int      sy0      = mach64->accel.src_y_start;
+    int      xl       = (xinc > 0) ? dx0 : (dx0 - (w - 1));
+    int      xr       = xl + w - 1;
+    uint32_t pix_mask = rot24 ? 0xffffff : (0xffffffff >> (32 - (bytes_pp << 3)));
+    int64_t  lo;
+    int64_t  hi;
+
+    if ((mach64->accel.source_mix != MONO_SRC_1) || (mach64->accel.mix_fg != 7) || (size == WIDTH_1BIT))
+        return 0;
+    if ((mach64->dst_cntl & DST_POLYGON_EN) || ((mach64->accel.write_mask & pix_mask) != pix_mask))
+        return 0;
+    if (rot24 && ((size != 0) || copy))
+        return 0;
+
+    switch (mach64->accel.clr_cmp_fn) {
+        case 1:
+            return 0;
+        case 4:
+        case 5:
+            if (!copy || !mach64->accel.clr_cmp_src)
+                return 0;
+            keyed = 1;
+            break;
+
+        default:
+            break;
+    }
+
+    if (copy) {
+        if ((mach64->accel.src_size != size) || (mach64->src_cntl & (SRC_LINEAR_EN | SRC_PATT_EN)) ||
+            (mach64->accel.src_width1 < w))
+            return 0;
+    } else if (mach64->accel.source_fg != SRC_FG)
+        return 0;
+
+    /*The coordinates must not wrap, and every row must stay inside video memory*/
+    if ((xl < 0) || (xr > 0xfff) || (dy0 < 0) || (dy0 > 0x3fff) || ((dy0 + (h - 1) * yinc) < 0) || ((dy0 + (h - 1) * yinc) > 0x3fff))
+        return 0;
+    lo = (int64_t) mach64->accel.dst_offset + (int64_t) ((yinc > 0) ? dy0 : (dy0 - (h - 1))) * mach64->accel.dst_pitch + xl;
+    hi = (int64_t) mach64->accel.dst_offset + (int64_t) ((yinc > 0) ? (dy0 + (h - 1)) : dy0) * mach64->accel.dst_pitch + xr;
+    if ((lo < 0) || (((hi + 1) << size) > ((int64_t) mach64->vram_mask + 1)))
+        return 0;
+    if (copy) {
+        int sxl = (xinc > 0) ? sx0 : (sx0 - (w - 1));
+
+        if ((sxl < 0) || ((sxl + w - 1) > 0xfff) || (sy0 < 0) || (sy0 > 0x3fff) || ((sy0 + (h - 1) * yinc) < 0) || ((sy0 + (h - 1) * yinc) > 0x3fff))
+            return 0;
+        lo = (int64_t) mach64->accel.src_offset + (int64_t) ((yinc > 0) ? sy0 : (sy0 - (h - 1))) * mach64->accel.src_pitch + sxl;
+        hi = (int64_t) mach64->accel.src_offset + (int64_t) ((yinc > 0) ? (sy0 + (h - 1)) : sy0) * mach64->accel.src_pitch + sxl + w - 1;
+        if ((lo < 0) || (((hi + 1) << size) > ((int64_t) mach64->vram_mask + 1)))
+            return 0;
+    }
+
+    for (int row = 0; row < h; row++) {
+        int dy = dy0 + row * yinc;
+        int l  = (xl > mach64->accel.sc_left) ? xl : mach64->accel.sc_left;
+        int r  = (xr < mach64->accel.sc_right) ? xr : mach64->accel.sc_right;
+
+        if ((dy >= mach64->accel.sc_top) && (dy <= mach64->accel.sc_bottom) && (l <= r)) {
+            uint32_t dest = (mach64->accel.dst_offset + dy * mach64->accel.dst_pitch + l) << size;
+            uint32_t len  = (r - l + 1) << size;
+
+            if (copy) {
+                int      sy  = sy0 + row * yinc;
+                uint32_t src = (mach64->accel.src_offset + sy * mach64->accel.src_pitch + sx0 + (l - dx0)) << size;
+
+                if (keyed)
+                    video_blit_copy_key(svga->vram, dest, src, len, bytes_pp, xinc, mach64->accel.clr_cmp_clr,
+                                        mach64->accel.clr_cmp_mask, mach64->accel.clr_cmp_fn == 5);
+                else
+                    video_blit_copy(svga->vram, dest, src, len, bytes_pp, xinc);
+            } else if (rot24) {
+                /*Each byte takes the next component of the colour, counting from
+                  the first byte the blitter writes on the row*/
+                int phase = (xinc > 0) ? ((l - xl) % 3) : (2 - ((xr - l) % 3));
+
+                video_blit_fill(&svga->vram[dest], mach64_rot24(mach64->accel.dp_frgd_clr, phase), 3, len);
+            } else
+                video_blit_fill(&svga->vram[dest], mach64->accel.dp_frgd_clr, bytes_pp, len);
+
+            video_blit_mark_changed(svga->changedvram, dest, len, svga->monitor->mon_changeframecount);
+        }
+    }
+
+    mach64->accel.x_count     = mach64->accel.dst_width;
+    mach64->accel.xx_count    = 0;
+    mach64->accel.dst_x       = 0;
+    mach64->accel.dst_y += h * yinc;
+    mach64->accel.src_x       = 0;
+    mach64->accel.src_y += h * yinc;
+    mach64->accel.src_x_start = (mach64->src_y_x >> 16) & 0xfff;
+    mach64->accel.src_x_count = mach64->accel.src_width1;
+    mach64->accel.dst_height  = 0;
+    mach64->accel.poly_draw   = 0;
+
+    mach64_log("mach64 fast blit finished\n");
+    mach64->accel.busy = 0;
+    if (mach64->dst_cntl & DST_X_TILE)
+        mach64->dst_y_x = (mach64->dst_y_x & 0xfff) | ((mach64->dst_y_x + (mach64->accel.dst_width << 16)) & 0xfff0000);
+    if (mach64->dst_cntl & DST_Y_TILE)
+        mach64->dst_y_x = (mach64->dst_y_x & 0xfff0000) | ((mach64->dst_y_x + (mach64->dst_height_width & 0x1fff)) & 0xfff);
+
+    return 1;
+}
+
 void
 mach64_blit(uint32_t cpu_dat, int count, mach64_t *mach64)
 {
@@ -1615,6 +1734,9 @@ mach64_blit(uint32_t cpu_dat, int count, mach64_t *mach64)
 
     switch (mach64->accel.op) {
         case OP_RECT:
+            if ((count == -1) && !mach64->accel.source_host && mach64_blit_rect_fast(mach64))
+                break;
+
             while (count) {
                 uint8_t  write_mask = 0;
                 uint32_t src_dat = 0;
@@ -3902,12 +4024,6 @@ mach64_readl(uint32_t addr, void *priv)
     return ret;
 }
 
-#define CLAMP(x)                      \
-    do {                              \
-        if ((x) & ~0xff)              \
-            x = ((x) < 0) ? 0 : 0xff; \
-    } while (0)
-
 #define DECODE_ARGB1555()                                            \
     do {                                                             \
         for (x = 0; x < mach64->svga.overlay_latch.cur_xsize; x++) { \
@@ -3954,78 +4070,6 @@ mach64_readl(uint32_t addr, void *priv)
         }                                                            \
     } while (0)
 
-#define DECODE_VYUY422()                                                \
-    do {                                                                \
-        for (x = 0; x < mach64->svga.overlay_latch.cur_xsize; x += 2) { \
-            uint8_t y1, y2;                                             \
-            int8_t  u, v;                                               \
-            int     dR, dG, dB;                                         \
-            int     r, g, b;                                            \
-                                                                        \
-            y1 = src[0];                                                \
-            u  = src[1] - 0x80;                                         \
-            y2 = src[2];                                                \
-            v  = src[3] - 0x80;                                         \
-            src += 4;                                                   \
-                                                                        \
-            dR = (359 * v) >> 8;                                        \
-            dG = (88 * u + 183 * v) >> 8;                               \
-            dB = (453 * u) >> 8;                                        \
-                                                                        \
-            r = y1 + dR;                                                \
-            CLAMP(r);                                                   \
-            g = y1 - dG;                                                \
-            CLAMP(g);                                                   \
-            b = y1 + dB;                                                \
-            CLAMP(b);                                                   \
-            mach64->overlay_dat[x] = (r << 16) | (g << 8) | b;          \
-                                                                        \
-            r = y2 + dR;                                                \
-            CLAMP(r);                                                   \
-            g = y2 - dG;                                                \
-            CLAMP(g);                                                   \
-            b = y2 + dB;                                                \
-            CLAMP(b);                                                   \
-            mach64->overlay_dat[x + 1] = (r << 16) | (g << 8) | b;      \
-        }                                                               \
-    } while (0)
-
-#define DECODE_YVYU422()                                                \
-    do {                                                                \
-        for (x = 0; x < mach64->svga.overlay_latch.cur_xsize; x += 2) { \
-            uint8_t y1, y2;                                             \
-            int8_t  u, v;                                               \
-            int     dR, dG, dB;                                         \
-            int     r, g, b;                                            \
-                                                                        \
-            u  = src[0] - 0x80;                                         \
-            y1 = src[1];                                                \
-            v  = src[2] - 0x80;                                         \
-            y2 = src[3];                                                \
-            src += 4;                                                   \
-                                                                        \
-            dR = (359 * v) >> 8;                                        \
-            dG = (88 * u + 183 * v) >> 8;                               \
-            dB = (453 * u) >> 8;                                        \
-                                                                        \
-            r = y1 + dR;                                                \
-            CLAMP(r);                                                   \
-            g = y1 - dG;                                                \
-            CLAMP(g);                                                   \
-            b = y1 + dB;                                                \
-            CLAMP(b);                                                   \
-            mach64->overlay_dat[x] = (r << 16) | (g << 8) | b;          \
-                                                                        \
-            r = y2 + dR;                                                \
-            CLAMP(r);                                                   \
-            g = y2 - dG;                                                \
-            CLAMP(g);                                                   \
-            b = y2 + dB;                                                \
-            CLAMP(b);                                                   \
-            mach64->overlay_dat[x + 1] = (r << 16) | (g << 8) | b;      \
-        }                                                               \
-    } while (0)
-
 void
 mach64_overlay_draw(svga_t *svga, int displine)
 {
@@ -4057,11 +4101,11 @@ mach64_overlay_draw(svga_t *svga, int displine)
             case 0x6:
                 DECODE_ARGB8888();
                 break;
-            case 0xb:
-                DECODE_VYUY422();
+            case 0xb: /*VYUY422*/
+                video_overlay_yuv422(mach64->overlay_dat, src, (mach64->svga.overlay_latch.cur_xsize + 1) / 2, 0);
                 break;
-            case 0xc:
-                DECODE_YVYU422();
+            case 0xc: /*YVYU422*/
+                video_overlay_yuv422(mach64->overlay_dat, src, (mach64->svga.overlay_latch.cur_xsize + 1) / 2, OVERLAY_YUV_Y_ODD);
                 break;
 
             default:
@@ -4073,17 +4117,9 @@ mach64_overlay_draw(svga_t *svga, int displine)
         }
     }
 
-    if (overlay_cmp_mix == 2) {
-        for (x = 0; x < mach64->svga.overlay_latch.cur_xsize; x++) {
-            int h = h_acc >> 12;
-
-            p[x] = mach64->overlay_dat[h];
-
-            h_acc += h_inc;
-            if (h_acc > (h_max << 12))
-                h_acc = (h_max << 12);
-        }
-    } else {
+    if (overlay_cmp_mix == 2)
+        video_overlay_scale(p, mach64->overlay_dat, mach64->svga.overlay_latch.cur_xsize, h_acc, h_inc, 12, h_max);
+    else {
         for (x = 0; x < mach64->svga.overlay_latch.cur_xsize; x++) {
             int h         = h_acc >> 12;
             int gr_cmp    = 0;
@@ -4583,7 +4619,8 @@ mach64_common_init(const device_t *info)
     mach64->thread_run = 1;
     mach64->wake_fifo_thread = thread_create_event();
     mach64->fifo_not_full_event = thread_create_event();
-    mach64->fifo_thread = thread_create(fifo_thread, mach64);
+    spsc_init(&mach64->fifo_ring, FIFO_SIZE, SPSC_SPIN, mach64->wake_fifo_thread, mach64->fifo_not_full_event);
+    mach64->fifo_thread = thread_create_role(fifo_thread, mach64, THREAD_ROLE_VIDEO);
 
     mach64->i2c = i2c_gpio_init("ddc_ati_mach64");
     mach64->ddc = ddc_init(i2c_gpio_get_bus(mach64->i2c));
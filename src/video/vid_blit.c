@@ -0,0 +1,191 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Shared span helpers for the 2D accelerators.
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <86box/vid_blit.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#    define VIDEO_BLIT_SSE2
+#    include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#    define VIDEO_BLIT_NEON
+#    include <arm_neon.h>
+#endif
+
+/*48 bytes holds a whole number of pixels at every supported depth, and a
+  whole number of 16 byte vectors*/
+#define FILL_PATTERN_SIZE 48
+
+void
+video_blit_fill(uint8_t *dst, uint32_t color, int bytes_pp, uint32_t len)
+{
+    uint8_t  pattern[FILL_PATTERN_SIZE];
+    uint32_t c = 0;
+
+    for (int d = 0; d < FILL_PATTERN_SIZE; d++)
+        pattern[d] = color >> ((d % bytes_pp) << 3);
+
+#if defined(VIDEO_BLIT_SSE2)
+    if (len >= FILL_PATTERN_SIZE) {
+        const __m128i p0 = _mm_loadu_si128((__m128i *) &pattern[0]);
+        const __m128i p1 = _mm_loadu_si128((__m128i *) &pattern[16]);
+        const __m128i p2 = _mm_loadu_si128((__m128i *) &pattern[32]);
+
+        for (; (c + FILL_PATTERN_SIZE) <= len; c += FILL_PATTERN_SIZE) {
+            _mm_storeu_si128((__m128i *) &dst[c], p0);
+            _mm_storeu_si128((__m128i *) &dst[c + 16], p1);
+            _mm_storeu_si128((__m128i *) &dst[c + 32], p2);
+        }
+    }
+#elif defined(VIDEO_BLIT_NEON)
+    if (len >= FILL_PATTERN_SIZE) {
+        const uint8x16_t p0 = vld1q_u8(&pattern[0]);
+        const uint8x16_t p1 = vld1q_u8(&pattern[16]);
+        const uint8x16_t p2 = vld1q_u8(&pattern[32]);
+
+        for (; (c + FILL_PATTERN_SIZE) <= len; c += FILL_PATTERN_SIZE) {
+            vst1q_u8(&dst[c], p0);
+            vst1q_u8(&dst[c + 16], p1);
+            vst1q_u8(&dst[c + 32], p2);
+        }
+    }
+#else
+    for (; (c + FILL_PATTERN_SIZE) <= len; c += FILL_PATTERN_SIZE)
+        memcpy(&dst[c], pattern, FILL_PATTERN_SIZE);
+#endif
+    if (c < len)
+        memcpy(&dst[c], pattern, len - c);
+}
+
+static __inline int
+copy_smears(uint32_t dst, uint32_t src, uint32_t len, int xdir)
+{
+    if (xdir > 0)
+        return (src < dst) && (dst < (src + len));
+
+    return (dst < src) && (src < (dst + len));
+}
+
+void
+video_blit_copy(uint8_t *vram, uint32_t dst, uint32_t src, uint32_t len, int bytes_pp, int xdir)
+{
+    if (copy_smears(dst, src, len, xdir)) {
+        if (xdir > 0) {
+            for (uint32_t c = 0; c < len; c += bytes_pp)
+                memcpy(&vram[dst + c], &vram[src + c], bytes_pp);
+        } else {
+            for (uint32_t c = len; c > 0; c -= bytes_pp)
+                memcpy(&vram[dst + c - bytes_pp], &vram[src + c - bytes_pp], bytes_pp);
+        }
+    } else
+        memmove(&vram[dst], &vram[src], len);
+}
+
+static __inline void
+copy_key_pixel(uint8_t *vram, uint32_t dst, uint32_t src, int bytes_pp, uint32_t key, uint32_t mask, int skip_match)
+{
+    uint32_t val = 0;
+
+    memcpy(&val, &vram[src], bytes_pp);
+    if (((val & mask) == key) != skip_match)
+        memcpy(&vram[dst], &val, bytes_pp);
+}
+
+void
+video_blit_copy_key(uint8_t *vram, uint32_t dst, uint32_t src, uint32_t len, int bytes_pp, int xdir,
+                    uint32_t key, uint32_t mask, int skip_match)
+{
+    skip_match = !!skip_match;
+
+    /*Pixels are always handled one at a time and in blitter order, since a
+      keyed copy can read back pixels it has already written*/
+    if (xdir > 0) {
+        for (uint32_t c = 0; c < len; c += bytes_pp)
+            copy_key_pixel(vram, dst + c, src + c, bytes_pp, key, mask, skip_match);
+    } else {
+        for (uint32_t c = len; c > 0; c -= bytes_pp)
+            copy_key_pixel(vram, dst + c - bytes_pp, src + c - bytes_pp, bytes_pp, key, mask, skip_match);
+    }
+}
+
+#ifdef VIDEO_BLIT_SSE2
+/*Expand one byte of monochrome data to eight pixels*/
+static __inline void
+mono_expand8_sse2(uint8_t *dst, uint8_t bits, int lsb_first, __m128i fg, __m128i bg, int transparent, int bytes_pp)
+{
+    if (bytes_pp == 4) {
+        const __m128i b0 = lsb_first ? _mm_set_epi32(0x08, 0x04, 0x02, 0x01) : _mm_set_epi32(0x10, 0x20, 0x40, 0x80);
+        const __m128i b1 = lsb_first ? _mm_set_epi32(0x80, 0x40, 0x20, 0x10) : _mm_set_epi32(0x01, 0x02, 0x04, 0x08);
+        const __m128i v  = _mm_set1_epi32(bits);
+        const __m128i m0 = _mm_cmpeq_epi32(_mm_and_si128(v, b0), b0);
+        const __m128i m1 = _mm_cmpeq_epi32(_mm_and_si128(v, b1), b1);
+        __m128i       bg0 = bg;
+        __m128i       bg1 = bg;
+
+        if (transparent) {
+            bg0 = _mm_loadu_si128((__m128i *) &dst[0]);
+            bg1 = _mm_loadu_si128((__m128i *) &dst[16]);
+        }
+        _mm_storeu_si128((__m128i *) &dst[0], _mm_or_si128(_mm_and_si128(m0, fg), _mm_andnot_si128(m0, bg0)));
+        _mm_storeu_si128((__m128i *) &dst[16], _mm_or_si128(_mm_and_si128(m1, fg), _mm_andnot_si128(m1, bg1)));
+    } else {
+        const __m128i b = lsb_first ? _mm_set_epi16(0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01) :
+                                      _mm_set_epi16(0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80);
+        const __m128i m = _mm_cmpeq_epi16(_mm_and_si128(_mm_set1_epi16(bits), b), b);
+
+        if (transparent)
+            bg = _mm_loadu_si128((__m128i *) dst);
+        _mm_storeu_si128((__m128i *) dst, _mm_or_si128(_mm_and_si128(m, fg), _mm_andnot_si128(m, bg)));
+    }
+}
+#endif
+
+void
+video_blit_mono(uint8_t *dst, const uint8_t *src, uint32_t bit, int lsb_first, uint32_t fg, uint32_t bg,
+                int transparent, int bytes_pp, int count)
+{
+    int c = 0;
+
+#ifdef VIDEO_BLIT_SSE2
+    if (!(bit & 7) && ((bytes_pp == 2) || (bytes_pp == 4))) {
+        const __m128i fgv = (bytes_pp == 4) ? _mm_set1_epi32(fg) : _mm_set1_epi16(fg);
+        const __m128i bgv = (bytes_pp == 4) ? _mm_set1_epi32(bg) : _mm_set1_epi16(bg);
+
+        for (; (c + 8) <= count; c += 8) {
+            uint8_t bits = src[(bit + c) >> 3];
+
+            if (!bits && transparent)
+                continue;
+            mono_expand8_sse2(&dst[c * bytes_pp], bits, lsb_first, fgv, bgv, transparent, bytes_pp);
+        }
+    }
+#endif
+    for (; c < count; c++) {
+        uint32_t b   = bit + c;
+        int      set = src[b >> 3] & (lsb_first ? (1 << (b & 7)) : (0x80 >> (b & 7)));
+
+        if (set)
+            memcpy(&dst[c * bytes_pp], &fg, bytes_pp);
+        else if (!transparent)
+            memcpy(&dst[c * bytes_pp], &bg, bytes_pp);
+    }
+}
+
+void
+video_blit_mark_changed(uint8_t *changedvram, uint32_t addr, uint32_t len, int frame)
+{
+    if (!len)
+        return;
+
+    for (uint32_t c = addr >> 12; c <= ((addr + len - 1) >> 12); c++)
+        changedvram[c] = frame;
+}
@@ -35,6 +35,8 @@
 #include <86box/video.h>
 #include <86box/vid_cga.h>
 #include <86box/vid_cga_comp.h>
+#include <86box/vid_glyph_cache.h>
+#include <86box/vid_line_cache.h>
 #include <86box/plat_unused.h>
 
 #define CGA_RGB       0
@@ -66,6 +68,8 @@ static uint8_t crtcmask[32] = {
 
 static uint8_t interp_lut[2][256][256];
 
+static glyph_row_t cga_glyph_cache[GLYPH_CACHE_SIZE];
+
 static video_timings_t timing_cga = { .type = VIDEO_ISA, .write_b = 8, .write_w = 16, .write_l = 32, .read_b = 8, .read_w = 16, .read_l = 32 };
 
 void cga_recalctimings(cga_t *cga);
@@ -252,7 +256,8 @@ cga_recalctimings(cga_t *cga)
 static void
 cga_render(cga_t *cga, int line)
 {
-    uint16_t ca  = (cga->crtc[15] | (cga->crtc[14] << 8)) & 0x3fff;
+    uint16_t  ca  = (cga->crtc[15] | (cga->crtc[14] << 8)) & 0x3fff;
+    uint32_t *pix;
     int      drawcursor;
     int      x;
     int      c;
@@ -295,16 +300,11 @@ cga_render(cga_t *cga, int line)
             } else
                 cols[0] = (attr >> 4) + 16;
             if (drawcursor) {
-                for (c = 0; c < 8; c++) {
-                    buffer32->line[line][(x << 3) + c + 8]
-                        = cols[(fontdat[chr + cga->fontbase][cga->sc & 7] & (1 << (c ^ 7))) ? 1 : 0] ^ 15;
-                }
-            } else {
-                for (c = 0; c < 8; c++) {
-                    buffer32->line[line][(x << 3) + c + 8]
-                        = cols[(fontdat[chr + cga->fontbase][cga->sc & 7] & (1 << (c ^ 7))) ? 1 : 0];
-                }
+                cols[0] ^= 15;
+                cols[1] ^= 15;
             }
+            pix = glyph_cache_lookup(cga_glyph_cache, fontdat[chr + cga->fontbase][cga->sc & 7] << 1, cols[1], cols[0]);
+            memcpy(&buffer32->line[line][(x << 3) + 8], pix, 8 * sizeof(uint32_t));
             cga->ma++;
         }
     } else if (!(cga->cgamode & 2)) {
@@ -324,17 +324,14 @@ cga_render(cga_t *cga, int line)
                 cols[0] = (attr >> 4) + 16;
             cga->ma++;
             if (drawcursor) {
-                for (c = 0; c < 8; c++) {
-                    buffer32->line[line][(x << 4) + (c << 1) + 8]
-                        = buffer32->line[line][(x << 4) + (c << 1) + 9]
-                        = cols[(fontdat[chr + cga->fontbase][cga->sc & 7] & (1 << (c ^ 7))) ? 1 : 0] ^ 15;
-                }
-            } else {
-                for (c = 0; c < 8; c++) {
-                    buffer32->line[line][(x << 4) + (c << 1) + 8]
-                        = buffer32->line[line][(x << 4) + (c << 1) + 9] 
-                        = cols[(fontdat[chr + cga->fontbase][cga->sc & 7] & (1 << (c ^ 7))) ? 1 : 0];
-                }
+                cols[0] ^= 15;
+                cols[1] ^= 15;
+            }
+            pix = glyph_cache_lookup(cga_glyph_cache, fontdat[chr + cga->fontbase][cga->sc & 7] << 1, cols[1], cols[0]);
+            for (c = 0; c < 8; c++) {
+                buffer32->line[line][(x << 4) + (c << 1) + 8]
+                    = buffer32->line[line][(x << 4) + (c << 1) + 9]
+                    = pix[c];
             }
         }
     } else if (!(cga->cgamode & 16)) {
@@ -385,6 +382,39 @@ cga_render(cga_t *cga, int line)
     }
 }
 
+/* Signature of everything the current line is drawn from, the border alone
+   when the display is disabled. */
+static uint64_t
+cga_line_sig(const cga_t *cga, int active)
+{
+    uint16_t ca  = (cga->crtc[15] | (cga->crtc[14] << 8)) & 0x3fff;
+    uint64_t sig = line_cache_seed(monitor_index_global);
+    uint32_t val;
+    uint16_t ma;
+
+    sig = line_cache_mix(sig, cga->cgamode | (cga->cgacol << 8) | (cga->crtc[1] << 16) | (cga->double_type << 24) |
+                              ((uint64_t) active << 32));
+    if (!active)
+        return sig;
+
+    sig = line_cache_mix(sig, cga->sc | ((cga->cgablink & 8) << 8) | (cga->drawcursor << 16) | ((uint64_t) cga->fontbase << 32));
+    for (int x = 0; x < cga->crtc[1]; x++) {
+        ma = cga->ma + x;
+        if (cga->cgamode & 1)
+            val = cga->charbuffer[x << 1] | (cga->charbuffer[(x << 1) + 1] << 8);
+        else if (!(cga->cgamode & 2))
+            val = cga->vram[(ma << 1) & 0x3fff] | (cga->vram[((ma << 1) + 1) & 0x3fff] << 8);
+        else
+            val = cga->vram[((ma << 1) & 0x1fff) + ((cga->sc & 1) * 0x2000)] |
+                  (cga->vram[((ma << 1) & 0x1fff) + ((cga->sc & 1) * 0x2000) + 1] << 8);
+        if ((ma == ca) && cga->con && cga->cursoron)
+            val |= 0x10000;
+        sig = line_cache_mix(sig, (uint64_t) val | ((uint64_t) x << 32));
+    }
+
+    return sig;
+}
+
 static void
 cga_render_blank(cga_t *cga, int line)
 {
@@ -518,6 +548,7 @@ cga_poll(void *priv)
     int      xs_temp;
     int      ys_temp;
     int      old_ma;
+    int      cached;
 
     if (!cga->linepos) {
         timer_advance_u64(&cga->timer, cga->dispofftime);
@@ -532,6 +563,18 @@ cga_poll(void *priv)
                 video_wait_for_buffer();
             }
             cga->lastline = cga->displine;
+        }
+
+        /* An unchanged line is still in the buffer from the previous frame. */
+        if (cga->double_type > DOUBLE_NONE)
+            cached = cga->line_cache && line_cache_hit(cga->line_cache, cga->displine << 1, 2, cga_line_sig(cga, cga->cgadispon));
+        else
+            cached = cga->line_cache && line_cache_hit(cga->line_cache, cga->displine, 1, cga_line_sig(cga, cga->cgadispon));
+
+        if (cached) {
+            if (cga->cgadispon)
+                cga->ma += cga->crtc[1];
+        } else if (cga->cgadispon) {
             switch (cga->double_type) {
                 default:
                     cga_render(cga, cga->displine << 1);
@@ -562,14 +605,16 @@ cga_poll(void *priv)
             }
         }
 
-        switch (cga->double_type) {
-            default:
-                cga_render_process(cga, cga->displine << 1);
-                cga_render_process(cga, (cga->displine << 1) + 1);
-                break;
-            case DOUBLE_NONE:
-                cga_render_process(cga, cga->displine);
-                break;
+        if (!cached) {
+            switch (cga->double_type) {
+                default:
+                    cga_render_process(cga, cga->displine << 1);
+                    cga_render_process(cga, (cga->displine << 1) + 1);
+                    break;
+                case DOUBLE_NONE:
+                    cga_render_process(cga, cga->displine);
+                    break;
+            }
         }
 
         cga->sc = oldsc;
@@ -668,8 +713,14 @@ cga_poll(void *priv)
 
                             if (video_force_resize_get())
                                 video_force_resize_set(0);
+
+                            if (cga->line_cache)
+                                cga->line_cache->full = 1;
                         }
 
+                        if (cga->line_cache)
+                            line_cache_blit(cga->line_cache, (cga->double_type > DOUBLE_SIMPLE) ? 1 : 0, monitor_index_global);
+
                         if (cga->double_type > DOUBLE_NONE) {
                             if (enable_overscan)
                                 cga_blit_memtoscreen(cga, 0, (cga->firstline - 4) << 1,
@@ -750,6 +801,12 @@ cga_standalone_init(UNUSED(const device_t *info))
 
     cga->vram = malloc(0x4000);
 
+    /* Composite output depends on more than the line itself. */
+    if (!cga->composite) {
+        cga->line_cache = malloc(sizeof(line_cache_t));
+        line_cache_invalidate(cga->line_cache);
+    }
+
     cga_comp_init(cga->revision);
     timer_add(&cga->timer, cga_poll, cga, 1);
     mem_mapping_add(&cga->mapping, 0xb8000, 0x08000, cga_read, NULL, NULL, cga_write, NULL, NULL, NULL /*cga->vram*/, MEM_MAPPING_EXTERNAL, cga);
@@ -794,6 +851,7 @@ cga_close(void *priv)
 {
     cga_t *cga = (cga_t *) priv;
 
+    free(cga->line_cache);
     free(cga->vram);
     free(cga);
 }
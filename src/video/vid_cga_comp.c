@@ -29,6 +29,14 @@
 #include <86box/vid_cga.h>
 #include <86box/vid_cga_comp.h>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#    define CGA_COMP_SSE2
+#    include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#    define CGA_COMP_NEON
+#    include <arm_neon.h>
+#endif
+
 int CGA_Composite_Table[1024];
 
 static double brightness = 0;
@@ -86,6 +94,10 @@ int    tandy_mode_control = 0;
 
 static bool new_cga = 0;
 
+/* The decode coefficients are whole numbers, so the filter runs on integer
+   copies of them, [0] = sharpness, then ri, rq, gi, gq, bi, bq. */
+static int comp_coef[7];
+
 void
 update_cga16_color(uint8_t cgamode)
 {
@@ -170,6 +182,14 @@ update_cga16_color(uint8_t cgamode)
     video_bi        = (int) (bi * iq_adjust_i + bq * iq_adjust_q);
     video_bq        = (int) (-bi * iq_adjust_q + bq * iq_adjust_i);
     video_sharpness = (int) (sharpness * 256 / 100);
+
+    comp_coef[0] = video_sharpness;
+    comp_coef[1] = (int) video_ri;
+    comp_coef[2] = (int) video_rq;
+    comp_coef[3] = (int) video_gi;
+    comp_coef[4] = (int) video_gq;
+    comp_coef[5] = (int) video_bi;
+    comp_coef[6] = (int) video_bq;
 }
 
 static uint8_t
@@ -186,39 +206,200 @@ static int temp[SCALER_MAXWIDTH + 10] = { 0 };
 static int atemp[SCALER_MAXWIDTH + 2] = { 0 };
 static int btemp[SCALER_MAXWIDTH + 2] = { 0 };
 
+#if defined(CGA_COMP_SSE2)
+/* SSE2 has no 32-bit multiply keeping the low half, build one from two
+   32x32->64 multiplies; the low 32 bits are the same for signed values. */
+static __inline __m128i
+comp_mullo_sse2(__m128i a, __m128i b)
+{
+    const __m128i even = _mm_mul_epu32(a, b);
+    const __m128i odd  = _mm_mul_epu32(_mm_srli_si128(a, 4), _mm_srli_si128(b, 4));
+
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+                              _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+/* byte_clamp() on four values each of R, G and B, packed to 0x00RRGGBB. */
+static __inline __m128i
+comp_pack_sse2(__m128i r, __m128i g, __m128i b)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i v    = _mm_packus_epi16(_mm_packs_epi32(_mm_srai_epi32(r, 13), _mm_srai_epi32(g, 13)),
+                                          _mm_packs_epi32(_mm_srai_epi32(b, 13), zero));
+    const __m128i bg   = _mm_unpacklo_epi8(_mm_srli_si128(v, 8), _mm_srli_si128(v, 4));
+
+    return _mm_unpacklo_epi16(bg, _mm_unpacklo_epi8(v, zero));
+}
+#endif
+
+/* Luma of the pixel at i[0]; c and d are the centre and side taps. */
+static __inline int
+comp_luma(int c, int d)
+{
+    return ((c + d) << 8) + comp_coef[0] * (c - d);
+}
+
+static void
+comp_decode_mono(const int *i, uint32_t *srgb, int w)
+{
+    int x = 0;
+
+#if defined(CGA_COMP_SSE2)
+    const __m128i sharp = _mm_set1_epi32(comp_coef[0]);
+
+    for (; (x + 4) <= w; x += 4) {
+        const __m128i c = _mm_slli_epi32(_mm_add_epi32(_mm_loadu_si128((const __m128i *) &i[x]),
+                                                       _mm_loadu_si128((const __m128i *) &i[x])), 3);
+        const __m128i d = _mm_slli_epi32(_mm_add_epi32(_mm_loadu_si128((const __m128i *) &i[x - 1]),
+                                                       _mm_loadu_si128((const __m128i *) &i[x + 1])), 3);
+        const __m128i y = _mm_add_epi32(_mm_slli_epi32(_mm_add_epi32(c, d), 8),
+                                        comp_mullo_sse2(sharp, _mm_sub_epi32(c, d)));
+        const __m128i v = _mm_packus_epi16(_mm_packs_epi32(_mm_srai_epi32(y, 13), _mm_setzero_si128()),
+                                           _mm_setzero_si128());
+
+        _mm_storeu_si128((__m128i *) &srgb[x],
+                         _mm_unpacklo_epi16(_mm_unpacklo_epi8(v, v), _mm_unpacklo_epi8(v, _mm_setzero_si128())));
+    }
+#elif defined(CGA_COMP_NEON)
+    const int32x4_t sharp = vdupq_n_s32(comp_coef[0]);
+
+    for (; (x + 4) <= w; x += 4) {
+        const int32x4_t c = vshlq_n_s32(vaddq_s32(vld1q_s32(&i[x]), vld1q_s32(&i[x])), 3);
+        const int32x4_t d = vshlq_n_s32(vaddq_s32(vld1q_s32(&i[x - 1]), vld1q_s32(&i[x + 1])), 3);
+        const int32x4_t y = vmlaq_s32(vshlq_n_s32(vaddq_s32(c, d), 8), sharp, vsubq_s32(c, d));
+        const uint8x8_t v = vqmovun_s16(vcombine_s16(vqmovn_s32(vshrq_n_s32(y, 13)), vdup_n_s16(0)));
+
+        vst1q_u32(&srgb[x], vmulq_n_u32(vmovl_u16(vget_low_u16(vmovl_u8(v))), 0x10101));
+    }
+#endif
+    for (; x < w; ++x) {
+        int c = (i[x] + i[x]) << 3;
+        int d = (i[x - 1] + i[x + 1]) << 3;
+
+        srgb[x] = byte_clamp(comp_luma(c, d)) * 0x10101;
+    }
+}
+
+/* i holds the composite signal already corrected for chroma, ap and bp the
+   chroma pair for each pixel. The pixels are decoded in groups of four,
+   since the colour carrier phase repeats every four pixels. */
+static void
+comp_decode_color(const int *i, const int *ap, const int *bp, uint32_t *srgb, int blocks)
+{
+    int x = 0;
+
+#if defined(CGA_COMP_SSE2)
+    const __m128i sharp  = _mm_set1_epi32(comp_coef[0]);
+    const __m128i ri     = _mm_set1_epi32(comp_coef[1]);
+    const __m128i rq     = _mm_set1_epi32(comp_coef[2]);
+    const __m128i gi     = _mm_set1_epi32(comp_coef[3]);
+    const __m128i gq     = _mm_set1_epi32(comp_coef[4]);
+    const __m128i bi     = _mm_set1_epi32(comp_coef[5]);
+    const __m128i bq     = _mm_set1_epi32(comp_coef[6]);
+    const __m128i even   = _mm_set_epi32(0, -1, 0, -1);
+    const __m128i i_sign = _mm_set_epi32(0, -1, -1, 0);
+    const __m128i q_sign = _mm_set_epi32(-1, -1, 0, 0);
+
+    for (; x < (blocks << 2); x += 4) {
+        const __m128i a  = _mm_loadu_si128((const __m128i *) &ap[x]);
+        const __m128i b  = _mm_loadu_si128((const __m128i *) &bp[x]);
+        const __m128i c  = _mm_slli_epi32(_mm_loadu_si128((const __m128i *) &i[x]), 1);
+        const __m128i d  = _mm_add_epi32(_mm_loadu_si128((const __m128i *) &i[x - 1]),
+                                         _mm_loadu_si128((const __m128i *) &i[x + 1]));
+        const __m128i y  = _mm_add_epi32(_mm_slli_epi32(_mm_add_epi32(c, d), 8),
+                                         comp_mullo_sse2(sharp, _mm_sub_epi32(c, d)));
+        /* (I, Q) is (a, b), (-b, a), (-a, -b), (b, -a) across the group */
+        __m128i       vi = _mm_or_si128(_mm_and_si128(even, a), _mm_andnot_si128(even, b));
+        __m128i       vq = _mm_or_si128(_mm_and_si128(even, b), _mm_andnot_si128(even, a));
+        __m128i       rr;
+        __m128i       gg;
+        __m128i       bb;
+
+        vi = _mm_sub_epi32(_mm_xor_si128(vi, i_sign), i_sign);
+        vq = _mm_sub_epi32(_mm_xor_si128(vq, q_sign), q_sign);
+
+        rr = _mm_add_epi32(y, _mm_add_epi32(comp_mullo_sse2(ri, vi), comp_mullo_sse2(rq, vq)));
+        gg = _mm_add_epi32(y, _mm_add_epi32(comp_mullo_sse2(gi, vi), comp_mullo_sse2(gq, vq)));
+        bb = _mm_add_epi32(y, _mm_add_epi32(comp_mullo_sse2(bi, vi), comp_mullo_sse2(bq, vq)));
+
+        _mm_storeu_si128((__m128i *) &srgb[x], comp_pack_sse2(rr, gg, bb));
+    }
+#elif defined(CGA_COMP_NEON)
+    static const int32_t i_sel[4]  = { -1, 0, -1, 0 };
+    static const int32_t i_mul[4]  = { 1, -1, -1, 1 };
+    static const int32_t q_mul[4]  = { 1, 1, -1, -1 };
+    const uint32x4_t     even      = vreinterpretq_u32_s32(vld1q_s32(i_sel));
+    const int32x4_t      i_sign    = vld1q_s32(i_mul);
+    const int32x4_t      q_sign    = vld1q_s32(q_mul);
+
+    for (; x < (blocks << 2); x += 4) {
+        const int32x4_t a  = vld1q_s32(&ap[x]);
+        const int32x4_t b  = vld1q_s32(&bp[x]);
+        const int32x4_t c  = vshlq_n_s32(vld1q_s32(&i[x]), 1);
+        const int32x4_t d  = vaddq_s32(vld1q_s32(&i[x - 1]), vld1q_s32(&i[x + 1]));
+        const int32x4_t y  = vmlaq_n_s32(vshlq_n_s32(vaddq_s32(c, d), 8), vsubq_s32(c, d), comp_coef[0]);
+        const int32x4_t vi = vmulq_s32(vbslq_s32(even, a, b), i_sign);
+        const int32x4_t vq = vmulq_s32(vbslq_s32(even, b, a), q_sign);
+        const int32x4_t rr = vmlaq_n_s32(vmlaq_n_s32(y, vi, comp_coef[1]), vq, comp_coef[2]);
+        const int32x4_t gg = vmlaq_n_s32(vmlaq_n_s32(y, vi, comp_coef[3]), vq, comp_coef[4]);
+        const int32x4_t bb = vmlaq_n_s32(vmlaq_n_s32(y, vi, comp_coef[5]), vq, comp_coef[6]);
+        uint8x8x4_t     px;
+        uint8_t         tmp[32];
+
+        px.val[0] = vqmovun_s16(vcombine_s16(vqmovn_s32(vshrq_n_s32(bb, 13)), vdup_n_s16(0)));
+        px.val[1] = vqmovun_s16(vcombine_s16(vqmovn_s32(vshrq_n_s32(gg, 13)), vdup_n_s16(0)));
+        px.val[2] = vqmovun_s16(vcombine_s16(vqmovn_s32(vshrq_n_s32(rr, 13)), vdup_n_s16(0)));
+        px.val[3] = vdup_n_u8(0);
+        vst4_u8(tmp, px);
+        memcpy(&srgb[x], tmp, 16);
+    }
+#endif
+    for (; x < (blocks << 2); ++x) {
+        int a = ap[x];
+        int b = bp[x];
+        int c = i[x] + i[x];
+        int d = i[x - 1] + i[x + 1];
+        int y = comp_luma(c, d);
+        int vi;
+        int vq;
+
+        switch (x & 3) {
+            default:
+                vi = a;
+                vq = b;
+                break;
+            case 1:
+                vi = -b;
+                vq = a;
+                break;
+            case 2:
+                vi = -a;
+                vq = -b;
+                break;
+            case 3:
+                vi = b;
+                vq = -a;
+                break;
+        }
+
+        srgb[x] = (byte_clamp(y + comp_coef[1] * vi + comp_coef[2] * vq) << 16) |
+                  (byte_clamp(y + comp_coef[3] * vi + comp_coef[4] * vq) << 8) |
+                  byte_clamp(y + comp_coef[5] * vi + comp_coef[6] * vq);
+    }
+}
+
 uint32_t *
 Composite_Process(uint8_t cgamode, uint8_t border, uint32_t blocks /*, bool doublewidth*/, uint32_t *TempLine)
 {
-    uint32_t x2;
-
     int w = blocks * 4;
 
     int            *o;
     const uint32_t *rgbi;
     const int      *b;
     int            *i;
-    uint32_t       *srgb;
     int            *ap;
     int            *bp;
 
-#define COMPOSITE_CONVERT(I, Q)                                                  \
-    do {                                                                         \
-        i[1] = (i[1] << 3) - ap[1];                                              \
-        a    = ap[0];                                                            \
-        b    = bp[0];                                                            \
-        c    = i[0] + i[0];                                                      \
-        d    = i[-1] + i[1];                                                     \
-        y    = ((c + d) << 8) + video_sharpness * (c - d);                       \
-        rr   = y + video_ri * (I) + video_rq * (Q);                              \
-        gg   = y + video_gi * (I) + video_gq * (Q);                              \
-        bb   = y + video_bi * (I) + video_bq * (Q);                              \
-        ++i;                                                                     \
-        ++ap;                                                                    \
-        ++bp;                                                                    \
-        *srgb = (byte_clamp(rr) << 16) | (byte_clamp(gg) << 8) | byte_clamp(bb); \
-        ++srgb;                                                                  \
-    } while (0)
-
 #define OUT(v)    \
     do {          \
         *o = (v); \
@@ -242,16 +423,7 @@ Composite_Process(uint8_t cgamode, uint8_t border, uint32_t blocks /*, bool doub
 
     if ((cgamode & 4) != 0) {
         /* Decode */
-        i    = temp + 5;
-        srgb = TempLine;
-        for (x2 = 0; x2 < blocks * 4; ++x2) {
-            int c = (i[0] + i[0]) << 3;
-            int d = (i[-1] + i[1]) << 3;
-            int y = ((c + d) << 8) + video_sharpness * (c - d);
-            ++i;
-            *srgb = byte_clamp(y) * 0x10101;
-            ++srgb;
-        }
+        comp_decode_mono(temp + 5, TempLine, w);
     } else {
         /* Store chroma */
         i  = temp + 4;
@@ -263,27 +435,15 @@ Composite_Process(uint8_t cgamode, uint8_t border, uint32_t blocks /*, bool doub
             ++i;
         }
 
+        /* Remove the chroma from the signal, before the decode since each
+           pixel needs its neighbours with the chroma removed */
+        i = temp + 5;
+        for (int x = -1; x < w + 1; ++x)
+            i[x] = (i[x] << 3) - ap[x];
+
         /* Decode */
-        i     = temp + 5;
-        i[-1] = (i[-1] << 3) - ap[-1];
-        i[0]  = (i[0] << 3) - ap[0];
-        srgb  = TempLine;
-        for (x2 = 0; x2 < blocks; ++x2) {
-            int y;
-            int a;
-            int b;
-            int c;
-            int d;
-            int rr;
-            int gg;
-            int bb;
-            COMPOSITE_CONVERT(a, b);
-            COMPOSITE_CONVERT(-b, a);
-            COMPOSITE_CONVERT(-a, -b);
-            COMPOSITE_CONVERT(b, -a);
-        }
+        comp_decode_color(i, ap, bp, TempLine, blocks);
     }
-#undef COMPOSITE_CONVERT
 #undef OUT
 
     return TempLine;
@@ -34,12 +34,15 @@
 #include <86box/rom.h>
 #include <86box/device.h>
 #include <86box/timer.h>
+#include <86box/thread.h>
+#include <86box/spsc.h>
 #include <86box/video.h>
 #include <86box/i2c.h>
 #include <86box/vid_ddc.h>
 #include <86box/vid_xga.h>
 #include <86box/vid_svga.h>
 #include <86box/vid_svga_render.h>
+#include <86box/vid_overlay.h>
 #include <86box/plat_fallthrough.h>
 #include <86box/plat_unused.h>
 
@@ -136,6 +139,25 @@
 #define CIRRUS_BLT_APERTURE2 0x40
 #define CIRRUS_BLT_AUTOSTART 0x80
 
+/* Blits that do not take data from or give it to the CPU run on the FIFO
+   thread. The CPU waits for them before it touches the blitter or VRAM
+   again, so one entry in flight is all the ring ever holds. */
+#define FIFO_SIZE  64
+#define FIFO_EMPTY spsc_empty(&gd54xx->fifo_ring)
+
+#define FIFO_TYPE  0xff000000
+#define FIFO_ADDR  0x00ffffff
+
+enum {
+    FIFO_INVALID    = (0x00 << 24),
+    FIFO_START_BLIT = (0x01 << 24)
+};
+
+typedef struct {
+    uint32_t addr_type;
+    uint32_t val;
+} fifo_entry_t;
+
 /* control 0x33 */
 #define CIRRUS_BLTMODEEXT_BACKGROUNDONLY   0x08
 #define CIRRUS_BLTMODEEXT_SOLIDFILL        0x04
@@ -270,6 +292,17 @@ typedef struct gd54xx_t {
 
     void *i2c;
     void *ddc;
+
+    fifo_entry_t fifo[FIFO_SIZE];
+    spsc_t       fifo_ring;
+
+    uint8_t fifo_thread_run;
+
+    thread_t *fifo_thread;
+    event_t  *wake_fifo_thread;
+    event_t  *fifo_not_full_event;
+
+    atomic_int blitter_busy;
 } gd54xx_t;
 
 static video_timings_t timing_gd54xx_isa = { .type = VIDEO_ISA,
@@ -308,207 +341,51 @@ gd54xx_reset_blit(gd54xx_t *gd54xx);
 static void
 gd54xx_start_blit(uint32_t cpu_dat, uint32_t count, gd54xx_t *gd54xx, svga_t *svga);
 
-#define CLAMP(x)                      \
-    do {                              \
-        if ((x) & ~0xff)              \
-            x = ((x) < 0) ? 0 : 0xff; \
-    } while (0)
-
-#define DECODE_YCbCr()                      \
-    do {                                    \
-        int c;                              \
-                                            \
-        for (c = 0; c < 2; c++) {           \
-            uint8_t y1, y2;                 \
-            int8_t  Cr, Cb;                 \
-            int     dR, dG, dB;             \
-                                            \
-            y1 = src[0];                    \
-            Cr = src[1] - 0x80;             \
-            y2 = src[2];                    \
-            Cb = src[3] - 0x80;             \
-            src += 4;                       \
-                                            \
-            dR = (359 * Cr) >> 8;           \
-            dG = (88 * Cb + 183 * Cr) >> 8; \
-            dB = (453 * Cb) >> 8;           \
-                                            \
-            r[x_write] = y1 + dR;           \
-            CLAMP(r[x_write]);              \
-            g[x_write] = y1 - dG;           \
-            CLAMP(g[x_write]);              \
-            b[x_write] = y1 + dB;           \
-            CLAMP(b[x_write]);              \
-                                            \
-            r[x_write + 1] = y2 + dR;       \
-            CLAMP(r[x_write + 1]);          \
-            g[x_write + 1] = y2 - dG;       \
-            CLAMP(g[x_write + 1]);          \
-            b[x_write + 1] = y2 + dB;       \
-            CLAMP(b[x_write + 1]);          \
-                                            \
-            x_write = (x_write + 2) & 7;    \
-        }                                   \
-    } while (0)
-
-/*Both YUV formats are untested*/
-#define DECODE_YUV211()                  \
-    do {                                 \
-        uint8_t y1, y2, y3, y4;          \
-        int8_t  U, V;                    \
-        int     dR, dG, dB;              \
-                                         \
-        U  = src[0] - 0x80;              \
-        y1 = (298 * (src[1] - 16)) >> 8; \
-        y2 = (298 * (src[2] - 16)) >> 8; \
-        V  = src[3] - 0x80;              \
-        y3 = (298 * (src[4] - 16)) >> 8; \
-        y4 = (298 * (src[5] - 16)) >> 8; \
-        src += 6;                        \
-                                         \
-        dR = (309 * V) >> 8;             \
-        dG = (100 * U + 208 * V) >> 8;   \
-        dB = (516 * U) >> 8;             \
-                                         \
-        r[x_write] = y1 + dR;            \
-        CLAMP(r[x_write]);               \
-        g[x_write] = y1 - dG;            \
-        CLAMP(g[x_write]);               \
-        b[x_write] = y1 + dB;            \
-        CLAMP(b[x_write]);               \
-                                         \
-        r[x_write + 1] = y2 + dR;        \
-        CLAMP(r[x_write + 1]);           \
-        g[x_write + 1] = y2 - dG;        \
-        CLAMP(g[x_write + 1]);           \
-        b[x_write + 1] = y2 + dB;        \
-        CLAMP(b[x_write + 1]);           \
-                                         \
-        r[x_write + 2] = y3 + dR;        \
-        CLAMP(r[x_write + 2]);           \
-        g[x_write + 2] = y3 - dG;        \
-        CLAMP(g[x_write + 2]);           \
-        b[x_write + 2] = y3 + dB;        \
-        CLAMP(b[x_write + 2]);           \
-                                         \
-        r[x_write + 3] = y4 + dR;        \
-        CLAMP(r[x_write + 3]);           \
-        g[x_write + 3] = y4 - dG;        \
-        CLAMP(g[x_write + 3]);           \
-        b[x_write + 3] = y4 + dB;        \
-        CLAMP(b[x_write + 3]);           \
-                                         \
-        x_write = (x_write + 4) & 7;     \
-    } while (0)
-
-#define DECODE_YUV422()                      \
-    do {                                     \
-        int c;                               \
-                                             \
-        for (c = 0; c < 2; c++) {            \
-            uint8_t y1, y2;                  \
-            int8_t  U, V;                    \
-            int     dR, dG, dB;              \
-                                             \
-            U  = src[0] - 0x80;              \
-            y1 = (298 * (src[1] - 16)) >> 8; \
-            V  = src[2] - 0x80;              \
-            y2 = (298 * (src[3] - 16)) >> 8; \
-            src += 4;                        \
-                                             \
-            dR = (309 * V) >> 8;             \
-            dG = (100 * U + 208 * V) >> 8;   \
-            dB = (516 * U) >> 8;             \
-                                             \
-            r[x_write] = y1 + dR;            \
-            CLAMP(r[x_write]);               \
-            g[x_write] = y1 - dG;            \
-            CLAMP(g[x_write]);               \
-            b[x_write] = y1 + dB;            \
-            CLAMP(b[x_write]);               \
-                                             \
-            r[x_write + 1] = y2 + dR;        \
-            CLAMP(r[x_write + 1]);           \
-            g[x_write + 1] = y2 - dG;        \
-            CLAMP(g[x_write + 1]);           \
-            b[x_write + 1] = y2 + dB;        \
-            CLAMP(b[x_write + 1]);           \
-                                             \
-            x_write = (x_write + 2) & 7;     \
-        }                                    \
-    } while (0)
-
-#define DECODE_RGB555()                                                      \
-    do {                                                                     \
-        int c;                                                               \
-                                                                             \
-        for (c = 0; c < 4; c++) {                                            \
-            uint16_t dat;                                                    \
-                                                                             \
-            dat = *(uint16_t *) src;                                         \
-            src += 2;                                                        \
-                                                                             \
-            r[x_write + c] = ((dat & 0x001f) << 3) | ((dat & 0x001f) >> 2);  \
-            g[x_write + c] = ((dat & 0x03e0) >> 2) | ((dat & 0x03e0) >> 7);  \
-            b[x_write + c] = ((dat & 0x7c00) >> 7) | ((dat & 0x7c00) >> 12); \
-        }                                                                    \
-        x_write = (x_write + 4) & 7;                                         \
-    } while (0)
-
-#define DECODE_RGB565()                                                      \
-    do {                                                                     \
-        int c;                                                               \
-                                                                             \
-        for (c = 0; c < 4; c++) {                                            \
-            uint16_t dat;                                                    \
-                                                                             \
-            dat = *(uint16_t *) src;                                         \
-            src += 2;                                                        \
-                                                                             \
-            r[x_write + c] = ((dat & 0x001f) << 3) | ((dat & 0x001f) >> 2);  \
-            g[x_write + c] = ((dat & 0x07e0) >> 3) | ((dat & 0x07e0) >> 9);  \
-            b[x_write + c] = ((dat & 0xf800) >> 8) | ((dat & 0xf800) >> 13); \
-        }                                                                    \
-        x_write = (x_write + 4) & 7;                                         \
-    } while (0)
-
-#define DECODE_CLUT()                                  \
-    do {                                               \
-        int c;                                         \
-                                                       \
-        for (c = 0; c < 4; c++) {                      \
-            uint8_t dat;                               \
-                                                       \
-            dat = *(uint8_t *) src;                    \
-            src++;                                     \
-                                                       \
-            r[x_write + c] = svga->pallook[dat] >> 0;  \
-            g[x_write + c] = svga->pallook[dat] >> 8;  \
-            b[x_write + c] = svga->pallook[dat] >> 16; \
-        }                                              \
-        x_write = (x_write + 4) & 7;                   \
-    } while (0)
-
-#define OVERLAY_SAMPLE()                \
-    do {                                \
-        switch (gd54xx->overlay.mode) { \
-            case 0:                     \
-                DECODE_YUV422();        \
-                break;                  \
-            case 2:                     \
-                DECODE_CLUT();          \
-                break;                  \
-            case 3:                     \
-                DECODE_YUV211();        \
-                break;                  \
-            case 4:                     \
-                DECODE_RGB555();        \
-                break;                  \
-            case 5:                     \
-                DECODE_RGB565();        \
-                break;                  \
-        }                               \
-    } while (0)
+/*Longest overlay line that is decoded, hdisp is at most 2048 here*/
+#define GD54XX_OVERLAY_LINE_MAX 2048
+
+static __inline void
+wake_fifo_thread(gd54xx_t *gd54xx)
+{
+    spsc_wake(&gd54xx->fifo_ring); /* Wake up FIFO thread if moving from idle. */
+}
+
+static void
+gd54xx_wait_fifo_idle(gd54xx_t *gd54xx)
+{
+    while (!FIFO_EMPTY) {
+        wake_fifo_thread(gd54xx);
+        thread_wait_event(gd54xx->fifo_not_full_event, 1);
+    }
+}
+
+static __inline void
+gd54xx_sync(gd54xx_t *gd54xx)
+{
+    if (!FIFO_EMPTY)
+        gd54xx_wait_fifo_idle(gd54xx);
+}
+
+static void
+gd54xx_queue_blit(gd54xx_t *gd54xx)
+{
+    fifo_entry_t *fifo;
+
+    if (gd54xx->blt.mode & (CIRRUS_BLTMODE_MEMSYSSRC | CIRRUS_BLTMODE_MEMSYSDEST)) {
+        gd54xx_start_blit(0, 0xffffffff, gd54xx, &gd54xx->svga);
+        return;
+    }
+
+    spsc_wait_below(&gd54xx->fifo_ring, FIFO_SIZE - 4);
+
+    fifo            = &gd54xx->fifo[spsc_write_pos(&gd54xx->fifo_ring)];
+    fifo->val       = 0;
+    fifo->addr_type = FIFO_START_BLIT;
+
+    spsc_push(&gd54xx->fifo_ring);
+
+    wake_fifo_thread(gd54xx);
+}
 
 static int
 gd54xx_interrupt_enabled(gd54xx_t *gd54xx)
@@ -557,17 +434,61 @@ gd54xx_is_5422(svga_t *svga)
         return 0;
 }
 
+/*Decodes groups of 4 source pixels, the unit the overlay fetches them in.
+  Both YUV formats are untested*/
+static void
+gd54xx_overlay_decode(const gd54xx_t *gd54xx, const svga_t *svga, uint32_t *line, const uint8_t *src, int groups)
+{
+    int x;
+
+    switch (gd54xx->overlay.mode) {
+        case 0: /*YUV422*/
+            video_overlay_yuv422(line, src, groups * 2, OVERLAY_YUV_Y_ODD | OVERLAY_YUV_STUDIO | OVERLAY_YUV_BGR);
+            break;
+        case 2: /*CLUT, the palette entry is passed through as is*/
+            for (x = 0; x < groups * 4; x++)
+                line[x] = svga->pallook[src[x]];
+            break;
+        case 3: /*YUV211*/
+            video_overlay_yuv211(line, src, groups, OVERLAY_YUV_STUDIO | OVERLAY_YUV_BGR);
+            break;
+        case 4: /*RGB555*/
+            for (x = 0; x < groups * 4; x++) {
+                uint16_t dat = ((const uint16_t *) src)[x];
+                int      r   = ((dat & 0x001f) << 3) | ((dat & 0x001f) >> 2);
+                int      g   = ((dat & 0x03e0) >> 2) | ((dat & 0x03e0) >> 7);
+                int      b   = ((dat & 0x7c00) >> 7) | ((dat & 0x7c00) >> 12);
+
+                line[x] = r | (g << 8) | (b << 16);
+            }
+            break;
+        case 5: /*RGB565*/
+            for (x = 0; x < groups * 4; x++) {
+                uint16_t dat = ((const uint16_t *) src)[x];
+                int      r   = ((dat & 0x001f) << 3) | ((dat & 0x001f) >> 2);
+                int      g   = ((dat & 0x07e0) >> 3) | ((dat & 0x07e0) >> 9);
+                int      b   = ((dat & 0xf800) >> 8) | ((dat & 0xf800) >> 13);
+
+                line[x] = r | (g << 8) | (b << 16);
+            }
+            break;
+        default:
+            memset(line, 0, groups * 4 * sizeof(uint32_t));
+            break;
+    }
+}
+
 static void
 gd54xx_overlay_draw(svga_t *svga, int displine)
 {
     const gd54xx_t *gd54xx = (gd54xx_t *) svga->priv;
     int             shift  = (svga->crtc[0x27] >= CIRRUS_ID_CLGD5446) ? 2 : 0;
     int             h_acc  = svga->overlay_latch.h_acc;
-    int             r[8];
-    int             g[8];
-    int             b[8];
-    int             x_read = 4;
-    int             x_write = 4;
+    uint32_t        line[GD54XX_OVERLAY_LINE_MAX + 4];
+    int             x_read = 0;
+    int             x_size = 0;
+    int             steps  = 0;
+    int             groups;
     uint32_t       *p;
     uint8_t        *src         = &svga->vram[(svga->overlay_latch.addr << shift) & svga->vram_mask];
     int             bpp         = svga->bpp;
@@ -579,10 +500,25 @@ gd54xx_overlay_draw(svga_t *svga, int displine)
     p = &(svga->monitor->target_buffer->line[displine])[gd54xx->overlay.region1size + svga->x_add];
     src2 += gd54xx->overlay.region1size * bytesperpix;
 
-    OVERLAY_SAMPLE();
+    /*The overlay fetches the next group of 4 pixels as the zoom steps into
+      it. Count the steps first, so that exactly the same groups are
+      decoded in one go*/
+    while ((x_size < gd54xx->overlay.region2size) && ((x_size + gd54xx->overlay.region1size) < svga->hdisp)) {
+        h_acc += gd54xx->overlay.hzoom;
+        if (h_acc >= 256) {
+            steps++;
+            h_acc -= 256;
+        }
+        x_size++;
+    }
+    groups = 1 + (steps >> 2);
+    if (groups > (GD54XX_OVERLAY_LINE_MAX / 4))
+        groups = GD54XX_OVERLAY_LINE_MAX / 4;
+
+    gd54xx_overlay_decode(gd54xx, svga, line, src, groups);
 
-    for (int x = 0; (x < gd54xx->overlay.region2size) &&
-                    ((x + gd54xx->overlay.region1size) < svga->hdisp); x++) {
+    h_acc = svga->overlay_latch.h_acc;
+    for (int x = 0; x < x_size; x++) {
         if (gd54xx->overlay.occlusion) {
             occl  = 1;
             ckval = gd54xx->overlay.ck;
@@ -595,16 +531,15 @@ gd54xx_overlay_draw(svga_t *svga, int displine)
             } else
                 occl = 0;
             if (!occl)
-                *p++ = r[x_read] | (g[x_read] << 8) | (b[x_read] << 16);
+                *p++ = line[x_read];
             src2 += bytesperpix;
         } else
-            *p++ = r[x_read] | (g[x_read] << 8) | (b[x_read] << 16);
+            *p++ = line[x_read];
 
         h_acc += gd54xx->overlay.hzoom;
         if (h_acc >= 256) {
-            if ((x_read ^ (x_read + 1)) & ~3)
-                OVERLAY_SAMPLE();
-            x_read = (x_read + 1) & 7;
+            if (x_read < (groups * 4) - 1)
+                x_read++;
 
             h_acc -= 256;
         }
@@ -2260,6 +2195,8 @@ gd54xx_write(uint32_t addr, uint8_t val, void *priv)
     gd54xx_t *gd54xx = (gd54xx_t *) priv;
     svga_t   *svga   = &gd54xx->svga;
 
+    gd54xx_sync(gd54xx);
+
     if (gd54xx->countminusone && !gd54xx->blt.ms_is_dest &&
         !(gd54xx->blt.status & CIRRUS_BLT_PAUSED)) {
         gd54xx_mem_sys_src_write(gd54xx, val, 0);
@@ -2279,6 +2216,8 @@ gd54xx_writew(uint32_t addr, uint16_t val, void *priv)
     gd54xx_t *gd54xx = (gd54xx_t *) priv;
     svga_t   *svga   = &gd54xx->svga;
 
+    gd54xx_sync(gd54xx);
+
     if (gd54xx->countminusone && !gd54xx->blt.ms_is_dest &&
         !(gd54xx->blt.status & CIRRUS_BLT_PAUSED)) {
         if ((gd54xx->blt.mode & CIRRUS_BLTMODE_COLOREXPAND) && (gd54xx->blt.modeext & CIRRUS_BLTMODEEXT_DWORDGRANULARITY))
@@ -2309,6 +2248,8 @@ gd54xx_writel(uint32_t addr, uint32_t val, void *priv)
     gd54xx_t *gd54xx = (gd54xx_t *) priv;
     svga_t   *svga   = &gd54xx->svga;
 
+    gd54xx_sync(gd54xx);
+
     if (gd54xx->countminusone && !gd54xx->blt.ms_is_dest &&
         !(gd54xx->blt.status & CIRRUS_BLT_PAUSED)) {
         if ((gd54xx->blt.mode & CIRRUS_BLTMODE_COLOREXPAND) && (gd54xx->blt.modeext & CIRRUS_BLTMODEEXT_DWORDGRANULARITY))
@@ -2426,6 +2367,8 @@ gd54xx_readb_linear(uint32_t addr, void *priv)
     uint8_t ap = gd54xx_get_aperture(gd54xx, addr);
     addr &= 0x003fffff; /* 4 MB mask */
 
+    gd54xx_sync(gd54xx);
+
     if (!(svga->seqregs[0x07] & CIRRUS_SR7_BPP_SVGA))
         return svga_read_linear(addr, svga);
 
@@ -2472,6 +2415,8 @@ gd54xx_readw_linear(uint32_t addr, void *priv)
     uint8_t  ap = gd54xx_get_aperture(gd54xx, addr);
     uint16_t temp;
 
+    gd54xx_sync(gd54xx);
+
     addr &= 0x003fffff; /* 4 MB mask */
 
     if (!(svga->seqregs[0x07] & CIRRUS_SR7_BPP_SVGA))
@@ -2526,6 +2471,8 @@ gd54xx_readl_linear(uint32_t addr, void *priv)
     uint8_t  ap = gd54xx_get_aperture(gd54xx, addr);
     uint32_t temp;
 
+    gd54xx_sync(gd54xx);
+
     addr &= 0x003fffff; /* 4 MB mask */
 
     if (!(svga->seqregs[0x07] & CIRRUS_SR7_BPP_SVGA))
@@ -2672,6 +2619,8 @@ gd54xx_writeb_linear(uint32_t addr, uint8_t val, void *priv)
 
     uint8_t ap       = gd54xx_get_aperture(gd54xx, addr);
 
+    gd54xx_sync(gd54xx);
+
     if (!(svga->seqregs[0x07] & CIRRUS_SR7_BPP_SVGA)) {
         svga_write_linear(addr, val, svga);
         return;
@@ -2724,6 +2673,8 @@ gd54xx_writew_linear(uint32_t addr, uint16_t val, void *priv)
     uint32_t  old_addr = addr;
     uint8_t ap         = gd54xx_get_aperture(gd54xx, addr);
 
+    gd54xx_sync(gd54xx);
+
     if (!(svga->seqregs[0x07] & CIRRUS_SR7_BPP_SVGA)) {
         svga_writew_linear(addr, val, svga);
         return;
@@ -2796,6 +2747,8 @@ gd54xx_writel_linear(uint32_t addr, uint32_t val, void *priv)
     uint32_t  old_addr = addr;
     uint8_t ap         = gd54xx_get_aperture(gd54xx, addr);
 
+    gd54xx_sync(gd54xx);
+
     if (!(svga->seqregs[0x07] & CIRRUS_SR7_BPP_SVGA)) {
         svga_writel_linear(addr, val, svga);
         return;
@@ -2878,6 +2831,8 @@ gd54xx_read(uint32_t addr, void *priv)
     gd54xx_t *gd54xx = (gd54xx_t *) priv;
     svga_t   *svga   = &gd54xx->svga;
 
+    gd54xx_sync(gd54xx);
+
     if (gd54xx->countminusone && gd54xx->blt.ms_is_dest &&
         !(gd54xx->blt.status & CIRRUS_BLT_PAUSED))
         return gd54xx_mem_sys_dest_read(gd54xx, 0);
@@ -2896,6 +2851,8 @@ gd54xx_readw(uint32_t addr, void *priv)
     svga_t   *svga   = &gd54xx->svga;
     uint16_t  ret;
 
+    gd54xx_sync(gd54xx);
+
     if (gd54xx->countminusone && gd54xx->blt.ms_is_dest &&
         !(gd54xx->blt.status & CIRRUS_BLT_PAUSED)) {
         ret = gd54xx_read(addr, priv);
@@ -2918,6 +2875,8 @@ gd54xx_readl(uint32_t addr, void *priv)
     svga_t   *svga   = &gd54xx->svga;
     uint32_t  ret;
 
+    gd54xx_sync(gd54xx);
+
     if (gd54xx->countminusone && gd54xx->blt.ms_is_dest &&
         !(gd54xx->blt.status & CIRRUS_BLT_PAUSED)) {
         ret = gd54xx_read(addr, priv);
@@ -2954,6 +2913,8 @@ gd543x_mmio_write(uint32_t addr, uint8_t val, void *priv)
     uint8_t   old;
 
     if (gd543x_do_mmio(svga, addr)) {
+        gd54xx_sync(gd54xx);
+
         switch (addr & 0xff) {
             case 0x00:
                 if (gd54xx_is_5434(svga))
@@ -3049,7 +3010,7 @@ gd543x_mmio_write(uint32_t addr, uint8_t val, void *priv)
                     (gd54xx->blt.status & CIRRUS_BLT_AUTOSTART) &&
                     !(gd54xx->blt.status & CIRRUS_BLT_BUSY)) {
                     gd54xx->blt.status |= CIRRUS_BLT_BUSY;
-                    gd54xx_start_blit(0, 0xffffffff, gd54xx, svga);
+                    gd54xx_queue_blit(gd54xx);
                 }
                 break;
 
@@ -3106,7 +3067,7 @@ gd543x_mmio_write(uint32_t addr, uint8_t val, void *priv)
                     gd54xx_reset_blit(gd54xx);
                 else if (!(old & CIRRUS_BLT_START) && (gd54xx->blt.status & CIRRUS_BLT_START)) {
                     gd54xx->blt.status |= CIRRUS_BLT_BUSY;
-                    gd54xx_start_blit(0, 0xffffffff, gd54xx, svga);
+                    gd54xx_queue_blit(gd54xx);
                 }
                 break;
 
@@ -3188,6 +3149,10 @@ gd543x_mmio_read(uint32_t addr, void *priv)
     uint8_t   ret    = 0xff;
 
     if (gd543x_do_mmio(svga, addr)) {
+        /* The status register shows a queued blit as busy. */
+        if ((addr & 0xff) != 0x40)
+            gd54xx_sync(gd54xx);
+
         switch (addr & 0xff) {
             case 0x00:
                 ret = gd54xx->blt.bg_col & 0xff;
@@ -3913,6 +3878,34 @@ gd54xx_start_blit(uint32_t cpu_dat, uint32_t count, gd54xx_t *gd54xx, svga_t *sv
         gd54xx_normal_blit(count, gd54xx, svga);
 }
 
+static void
+fifo_thread(void *param)
+{
+    gd54xx_t *gd54xx = (gd54xx_t *) param;
+
+    while (gd54xx->fifo_thread_run) {
+        thread_set_event(gd54xx->fifo_not_full_event);
+        spsc_park(&gd54xx->fifo_ring);
+        gd54xx->blitter_busy = 1;
+        while (!FIFO_EMPTY) {
+            fifo_entry_t *fifo = &gd54xx->fifo[spsc_read_pos(&gd54xx->fifo_ring)];
+
+            switch (fifo->addr_type & FIFO_TYPE) {
+                case FIFO_START_BLIT:
+                    gd54xx_start_blit(fifo->val, 0xffffffff, gd54xx, &gd54xx->svga);
+                    break;
+
+                default:
+                    break;
+            }
+
+            fifo->addr_type = FIFO_INVALID;
+            spsc_pop(&gd54xx->fifo_ring);
+        }
+        gd54xx->blitter_busy = 0;
+    }
+}
+
 static uint8_t
 cl_pci_read(UNUSED(int func), int addr, void *priv)
 {
@@ -4135,6 +4128,8 @@ gd54xx_reset(void *priv)
     gd54xx_t *gd54xx = (gd54xx_t *) priv;
     svga_t   *svga   = &gd54xx->svga;
 
+    gd54xx_sync(gd54xx);
+
     memset(svga->crtc, 0x00, sizeof(svga->crtc));
     memset(svga->seqregs, 0x00, sizeof(svga->seqregs));
     memset(svga->gdcreg, 0x00, sizeof(svga->gdcreg));
@@ -4526,6 +4521,12 @@ gd54xx_init(const device_t *info)
 
     gd54xx->overlay.colorkeycompare = 0xff;
 
+    gd54xx->wake_fifo_thread    = thread_create_event();
+    gd54xx->fifo_not_full_event = thread_create_event();
+    spsc_init(&gd54xx->fifo_ring, FIFO_SIZE, SPSC_SPIN, gd54xx->wake_fifo_thread, gd54xx->fifo_not_full_event);
+    gd54xx->fifo_thread_run     = 1;
+    gd54xx->fifo_thread         = thread_create_role(fifo_thread, gd54xx, THREAD_ROLE_VIDEO);
+
     return gd54xx;
 }
 
@@ -4672,6 +4673,12 @@ gd54xx_close(void *priv)
 {
     gd54xx_t *gd54xx = (gd54xx_t *) priv;
 
+    gd54xx->fifo_thread_run = 0;
+    thread_set_event(gd54xx->wake_fifo_thread);
+    thread_wait(gd54xx->fifo_thread);
+    thread_destroy_event(gd54xx->fifo_not_full_event);
+    thread_destroy_event(gd54xx->wake_fifo_thread);
+
     svga_close(&gd54xx->svga);
 
     if (gd54xx->i2c) {
@@ -29,6 +29,8 @@
 #include <86box/video.h>
 #include <86box/vid_ega.h>
 #include <86box/vid_ega_render_remap.h>
+#include <86box/vid_glyph_cache.h>
+#include <86box/vid_planar.h>
 
 int
 ega_display_line(ega_t *ega)
@@ -104,6 +106,8 @@ ega_render_overscan_right(ega_t *ega)
         buffer32->line[ega->displine + ega->y_add][ega->x_add + ega->hdisp + i] = ega->overscan_color;
 }
 
+static glyph_row_t ega_glyph_cache[GLYPH_CACHE_SIZE];
+
 void
 ega_render_text(ega_t *ega)
 {
@@ -174,8 +178,12 @@ ega_render_text(ega_t *ega)
             if ((chr & ~0x1F) == 0xC0 && attrlinechars)
                 dat |= (dat >> 1) & 1;
 
-            for (int xx = 0; xx < charwidth; xx++)
-                p[xx] = (dat & (0x100 >> (xx >> dwshift))) ? fg : bg;
+            const uint32_t *pix = glyph_cache_lookup(ega_glyph_cache, dat, fg, bg);
+            if (doublewidth) {
+                for (int xx = 0; xx < charwidth; xx++)
+                    p[xx] = pix[xx >> 1];
+            } else
+                memcpy(p, pix, charwidth * sizeof(uint32_t));
 
             ega->ma += 4;
             p += charwidth;
@@ -208,6 +216,14 @@ ega_render_graphics(ega_t *ega)
     const int     dotwidth    = 1 << dwshift;
     const int     charwidth   = dotwidth * 8;
     int           secondcclk  = 0;
+    uint32_t      pal[16];
+
+    // FIXME: Confirm blink behaviour is actually XOR on real hardware
+    for (uint32_t c = 0; c < 16; c++) {
+        uint32_t cc = ((c & ega->plane_mask & ~blinkmask) |
+                      ((c | ~ega->plane_mask) & blinkmask & blinkval)) ^ blinkmask;
+        pal[c] = ega->pallook[ega->egapal[cc]];
+    }
 
     /* Compensate for 8dot scroll */
     if (!seq9dot) {
@@ -248,27 +264,9 @@ ega_render_graphics(ega_t *ega)
             edat[3]      = dat3;
         }
 
-        if (!crtcreset) {
-            for (int i = 0; i < 8; i += 2) {
-                const int outoffs = i << dwshift;
-                const int inshift = 6 - i;
-                uint8_t   dat     = (edatlookup[(edat[0] >> inshift) & 3][(edat[1] >> inshift) & 3])
-                    | (edatlookup[(edat[2] >> inshift) & 3][(edat[3] >> inshift) & 3] << 2);
-                // FIXME: Confirm blink behaviour is actually XOR on real hardware
-                uint32_t c0 = (dat >> 4) & 0xF;
-                uint32_t c1 = dat & 0xF;
-                c0 = ((c0 & ega->plane_mask & ~blinkmask) |
-                     ((c0 | ~ega->plane_mask) & blinkmask & blinkval)) ^ blinkmask;
-                c1 = ((c1 & ega->plane_mask & ~blinkmask) |
-                     ((c1 | ~ega->plane_mask) & blinkmask & blinkval)) ^ blinkmask;
-                uint32_t p0 = ega->pallook[ega->egapal[c0]];
-                uint32_t p1 = ega->pallook[ega->egapal[c1]];
-                for (int subx = 0; subx < dotwidth; subx++)
-                    p[outoffs + subx] = p0;
-                for (int subx = 0; subx < dotwidth; subx++)
-                    p[outoffs + subx + dotwidth] = p1;
-            }
-        } else
+        if (!crtcreset)
+            planar_write8(p, planar_to_chunky(edat), pal, dotwidth);
+        else
             memset(p, 0x00, charwidth * sizeof(uint32_t));
 
         p += charwidth;
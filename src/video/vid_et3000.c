@@ -161,6 +161,7 @@ et3000_in(uint16_t addr, void *priv)
         case 0x3da:
             svga->attrff = 0;
 
+            svga_poll_sync(svga);
             if (svga->cgastat & 0x01)
                 svga->cgastat &= ~0x30;
             else
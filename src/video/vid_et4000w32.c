@@ -33,6 +33,8 @@
 #include <86box/device.h>
 #include <86box/timer.h>
 #include <86box/plat.h>
+#include <86box/thread.h>
+#include <86box/spsc.h>
 #include <86box/video.h>
 #include <86box/vid_svga.h>
 #include <86box/vid_svga_render.h>
@@ -51,6 +53,23 @@
 #define ACL_XYST                               4
 #define ACL_SSO                                8
 
+#define FIFO_SIZE                              65536
+#define FIFO_ENTRIES                           spsc_entries(&et4000->fifo_ring)
+#define FIFO_EMPTY                             spsc_empty(&et4000->fifo_ring)
+
+#define FIFO_TYPE                              0xff000000
+#define FIFO_ADDR                              0x00ffffff
+
+enum {
+    FIFO_INVALID    = (0x00 << 24),
+    FIFO_WRITE_BYTE = (0x01 << 24)
+};
+
+typedef struct {
+    uint32_t addr_type;
+    uint32_t val;
+} fifo_entry_t;
+
 enum {
     ET4000W32,
     ET4000W32I,
@@ -116,6 +135,18 @@ typedef struct et4000w32p_t {
     } mmu;
 
     volatile int busy;
+
+    /*Writes to the MMU window, replayed in order by the FIFO thread*/
+    fifo_entry_t fifo[FIFO_SIZE];
+    spsc_t       fifo_ring;
+
+    uint8_t fifo_thread_run;
+
+    thread_t *fifo_thread;
+    event_t  *wake_fifo_thread;
+    event_t  *fifo_not_full_event;
+
+    atomic_int blitter_busy;
 } et4000w32p_t;
 
 static int et4000w32_vbus[4] = { 1, 2, 4, 4 };
@@ -371,6 +402,7 @@ et4000w32p_in(uint16_t addr, void *priv)
 
             /*Bit 1 of the Input Status Register is required by the OS/2 and NT ET4000W32/I drivers to be set otherwise
               the guest will loop infinitely upon reaching the GUI*/
+            svga_poll_sync(svga);
             if (svga->cgastat & 0x01)
                 svga->cgastat &= ~0x32;
             else
@@ -909,10 +941,9 @@ et4000w32p_accel_write_mmu(et4000w32p_t *et4000, uint32_t addr, uint8_t val, uin
 }
 
 static void
-et4000w32p_mmu_write(uint32_t addr, uint8_t val, void *priv)
+et4000w32p_mmu_write_fifo(et4000w32p_t *et4000, uint32_t addr, uint8_t val)
 {
-    et4000w32p_t *et4000 = (et4000w32p_t *) priv;
-    svga_t       *svga   = &et4000->svga;
+    svga_t *svga = &et4000->svga;
 
     switch (addr & 0x6000) {
         case 0x0000: /* MMU 0 */
@@ -990,6 +1021,46 @@ et4000w32p_mmu_write(uint32_t addr, uint8_t val, void *priv)
     }
 }
 
+static __inline void
+wake_fifo_thread(et4000w32p_t *et4000)
+{
+    spsc_wake(&et4000->fifo_ring); /*Wake up FIFO thread if moving from idle*/
+}
+
+static void
+et4000w32p_wait_fifo_idle(et4000w32p_t *et4000)
+{
+    while (!FIFO_EMPTY) {
+        wake_fifo_thread(et4000);
+        thread_wait_event(et4000->fifo_not_full_event, 1);
+    }
+}
+
+static void
+et4000w32p_queue(et4000w32p_t *et4000, uint32_t addr, uint32_t val, uint32_t type)
+{
+    fifo_entry_t *fifo;
+
+    spsc_wait_below(&et4000->fifo_ring, FIFO_SIZE - 4);
+
+    fifo            = &et4000->fifo[spsc_write_pos(&et4000->fifo_ring)];
+    fifo->val       = val;
+    fifo->addr_type = (addr & FIFO_ADDR) | type;
+
+    spsc_push(&et4000->fifo_ring);
+
+    if (FIFO_ENTRIES > 0xe000 || FIFO_ENTRIES < 8)
+        wake_fifo_thread(et4000);
+}
+
+static void
+et4000w32p_mmu_write(uint32_t addr, uint8_t val, void *priv)
+{
+    et4000w32p_t *et4000 = (et4000w32p_t *) priv;
+
+    et4000w32p_queue(et4000, addr & 0x7fff, val, FIFO_WRITE_BYTE);
+}
+
 static uint8_t
 et4000w32p_mmu_read(uint32_t addr, void *priv)
 {
@@ -997,6 +1068,16 @@ et4000w32p_mmu_read(uint32_t addr, void *priv)
     const svga_t *svga   = &et4000->svga;
     uint8_t       temp;
 
+    /*The status register reports the queued writes as a busy accelerator
+      instead of waiting for them, everything else sees them completed*/
+    if ((addr & 0x60ff) == 0x6036) {
+        if (!FIFO_EMPTY || et4000->blitter_busy) {
+            wake_fifo_thread(et4000);
+            return et4000->acl.status | ACL_XYST | ACL_WRST;
+        }
+    } else if (!FIFO_EMPTY)
+        et4000w32p_wait_fifo_idle(et4000);
+
     switch (addr & 0x6000) {
         case 0x0000: /* MMU 0 */
         case 0x2000: /* MMU 1 */
@@ -1134,6 +1215,129 @@ et4000w32p_mmu_read(uint32_t addr, void *priv)
     return 0xff;
 }
 
+/*The blitter draws from the FIFO thread, so CPU accesses to the frame buffer
+  wait for the writes queued ahead of them to complete*/
+static __inline void
+et4000w32p_sync(svga_t *svga)
+{
+    et4000w32p_t *et4000 = (et4000w32p_t *) svga->priv;
+
+    if (!FIFO_EMPTY)
+        et4000w32p_wait_fifo_idle(et4000);
+}
+
+static uint8_t
+et4000w32p_read(uint32_t addr, void *priv)
+{
+    et4000w32p_sync((svga_t *) priv);
+    return svga_read(addr, priv);
+}
+
+static uint16_t
+et4000w32p_readw(uint32_t addr, void *priv)
+{
+    et4000w32p_sync((svga_t *) priv);
+    return svga_readw(addr, priv);
+}
+
+static uint32_t
+et4000w32p_readl(uint32_t addr, void *priv)
+{
+    et4000w32p_sync((svga_t *) priv);
+    return svga_readl(addr, priv);
+}
+
+static void
+et4000w32p_write(uint32_t addr, uint8_t val, void *priv)
+{
+    et4000w32p_sync((svga_t *) priv);
+    svga_write(addr, val, priv);
+}
+
+static void
+et4000w32p_writew(uint32_t addr, uint16_t val, void *priv)
+{
+    et4000w32p_sync((svga_t *) priv);
+    svga_writew(addr, val, priv);
+}
+
+static void
+et4000w32p_writel(uint32_t addr, uint32_t val, void *priv)
+{
+    et4000w32p_sync((svga_t *) priv);
+    svga_writel(addr, val, priv);
+}
+
+static uint8_t
+et4000w32p_read_linear(uint32_t addr, void *priv)
+{
+    et4000w32p_sync((svga_t *) priv);
+    return svga_read_linear(addr, priv);
+}
+
+static uint16_t
+et4000w32p_readw_linear(uint32_t addr, void *priv)
+{
+    et4000w32p_sync((svga_t *) priv);
+    return svga_readw_linear(addr, priv);
+}
+
+static uint32_t
+et4000w32p_readl_linear(uint32_t addr, void *priv)
+{
+    et4000w32p_sync((svga_t *) priv);
+    return svga_readl_linear(addr, priv);
+}
+
+static void
+et4000w32p_write_linear(uint32_t addr, uint8_t val, void *priv)
+{
+    et4000w32p_sync((svga_t *) priv);
+    svga_write_linear(addr, val, priv);
+}
+
+static void
+et4000w32p_writew_linear(uint32_t addr, uint16_t val, void *priv)
+{
+    et4000w32p_sync((svga_t *) priv);
+    svga_writew_linear(addr, val, priv);
+}
+
+static void
+et4000w32p_writel_linear(uint32_t addr, uint32_t val, void *priv)
+{
+    et4000w32p_sync((svga_t *) priv);
+    svga_writel_linear(addr, val, priv);
+}
+
+static void
+fifo_thread(void *param)
+{
+    et4000w32p_t *et4000 = (et4000w32p_t *) param;
+
+    while (et4000->fifo_thread_run) {
+        thread_set_event(et4000->fifo_not_full_event);
+        spsc_park(&et4000->fifo_ring);
+        et4000->blitter_busy = 1;
+        while (!FIFO_EMPTY) {
+            fifo_entry_t *fifo = &et4000->fifo[spsc_read_pos(&et4000->fifo_ring)];
+
+            switch (fifo->addr_type & FIFO_TYPE) {
+                case FIFO_WRITE_BYTE:
+                    et4000w32p_mmu_write_fifo(et4000, fifo->addr_type & FIFO_ADDR, fifo->val);
+                    break;
+
+                default:
+                    break;
+            }
+
+            fifo->addr_type = FIFO_INVALID;
+            spsc_pop(&et4000->fifo_ring);
+        }
+        et4000->blitter_busy = 0;
+    }
+}
+
 void
 et4000w32_blit_start(et4000w32p_t *et4000)
 {
@@ -2838,7 +3042,13 @@ et4000w32p_init(const device_t *info)
     if (info->flags & DEVICE_PCI)
         mem_mapping_disable(&et4000->bios_rom.mapping);
 
-    mem_mapping_add(&et4000->linear_mapping, 0, 0, svga_read_linear, svga_readw_linear, svga_readl_linear, svga_write_linear, svga_writew_linear, svga_writel_linear, NULL, MEM_MAPPING_EXTERNAL, &et4000->svga);
+    mem_mapping_set_handler(&et4000->svga.mapping, et4000w32p_read,
+                            et4000->svga.readw ? et4000w32p_readw : NULL,
+                            et4000->svga.readl ? et4000w32p_readl : NULL,
+                            et4000w32p_write,
+                            et4000->svga.writew ? et4000w32p_writew : NULL,
+                            et4000->svga.writel ? et4000w32p_writel : NULL);
+    mem_mapping_add(&et4000->linear_mapping, 0, 0, et4000w32p_read_linear, et4000w32p_readw_linear, et4000w32p_readl_linear, et4000w32p_write_linear, et4000w32p_writew_linear, et4000w32p_writel_linear, NULL, MEM_MAPPING_EXTERNAL, &et4000->svga);
     mem_mapping_add(&et4000->mmu_mapping, 0, 0, et4000w32p_mmu_read, NULL, NULL, et4000w32p_mmu_write, NULL, NULL, NULL, MEM_MAPPING_EXTERNAL, et4000);
 
     et4000w32p_io_set(et4000);
@@ -2863,6 +3073,12 @@ et4000w32p_init(const device_t *info)
 
     et4000->svga.packed_chain4 = 1;
 
+    et4000->wake_fifo_thread    = thread_create_event();
+    et4000->fifo_not_full_event = thread_create_event();
+    spsc_init(&et4000->fifo_ring, FIFO_SIZE, SPSC_SPIN, et4000->wake_fifo_thread, et4000->fifo_not_full_event);
+    et4000->fifo_thread_run     = 1;
+    et4000->fifo_thread         = thread_create_role(fifo_thread, et4000, THREAD_ROLE_VIDEO);
+
     return et4000;
 }
 
@@ -2919,6 +3135,12 @@ et4000w32p_close(void *priv)
 {
     et4000w32p_t *et4000 = (et4000w32p_t *) priv;
 
+    et4000->fifo_thread_run = 0;
+    thread_set_event(et4000->wake_fifo_thread);
+    thread_wait(et4000->fifo_thread);
+    thread_destroy_event(et4000->fifo_not_full_event);
+    thread_destroy_event(et4000->wake_fifo_thread);
+
     svga_close(&et4000->svga);
 
     free(et4000);
@@ -32,8 +32,12 @@
 #include <86box/device.h>
 #include <86box/video.h>
 #include <86box/vid_hercules.h>
+#include <86box/vid_glyph_cache.h>
+#include <86box/vid_line_cache.h>
 #include <86box/plat_unused.h>
 
+static glyph_row_t hercules_glyph_cache[GLYPH_CACHE_SIZE];
+
 static video_timings_t timing_hercules = { .type = VIDEO_ISA, .write_b = 8, .write_w = 16, .write_l = 32, .read_b = 8, .read_w = 16, .read_l = 32 };
 
 static void
@@ -275,24 +279,133 @@ hercules_render_overscan_right(hercules_t *dev)
         buffer32->line[dev->displine + 14][8 + width + i] = 0x00000000;
 }
 
+/* Signature of everything the current line is drawn from. */
+static uint64_t
+hercules_line_sig(const hercules_t *dev, uint16_t ca)
+{
+    uint64_t sig = line_cache_seed(dev->monitor_index);
+    uint32_t base;
+    uint32_t val;
+    uint16_t ma;
+
+    sig = line_cache_mix(sig, dev->crtc[1] | (dev->sc << 8) | (dev->ctrl << 16) | ((dev->blink & 16) << 24));
+    sig = line_cache_mix(sig, dev->ctrl2 | (herc_blend << 8));
+    if (dev->ctrl & 0x02) {
+        base = (dev->sc & 3) * 0x2000;
+        if (dev->ctrl & 0x80)
+            base += 0x8000;
+
+        for (int x = 0; x < dev->crtc[1]; x++) {
+            ma  = dev->ma + x;
+            val = (dev->vram[((ma << 1) & 0x1fff) + base] << 8) | dev->vram[((ma << 1) & 0x1fff) + base + 1];
+            sig = line_cache_mix(sig, (uint64_t) val | ((uint64_t) x << 32));
+        }
+    } else {
+        ma = dev->ma;
+        for (int x = 0; x < dev->crtc[1]; x++) {
+            val = dev->charbuffer[x << 1] | (dev->charbuffer[(x << 1) + 1] << 8);
+            if ((ma == ca) && dev->con && dev->cursoron)
+                val |= 0x10000;
+            sig = line_cache_mix(sig, (uint64_t) val | ((uint64_t) x << 32));
+            ma  = (ma + 1) & ((dev->ctrl2 & 0x01) ? 0x3fff : 0x7ff);
+        }
+    }
+
+    return sig;
+}
+
+static void
+hercules_render(hercules_t *dev, uint16_t ca)
+{
+    const uint32_t *pix;
+    uint8_t         chr;
+    uint8_t         attr;
+    uint8_t         font;
+    uint16_t        dat;
+    uint32_t        bits;
+    uint32_t        fg;
+    uint32_t        bg;
+    int             blink;
+    int             drawcursor;
+    int             x;
+    int             c;
+
+    hercules_render_overscan_left(dev);
+
+    if (dev->ctrl & 0x02) {
+        ca = (dev->sc & 3) * 0x2000;
+        if (dev->ctrl & 0x80)
+            ca += 0x8000;
+
+        for (x = 0; x < dev->crtc[1]; x++) {
+            if (dev->ctrl & 8)
+                dat = (dev->vram[((dev->ma << 1) & 0x1fff) + ca] << 8) | dev->vram[((dev->ma << 1) & 0x1fff) + ca + 1];
+            else
+                dat = 0;
+            dev->ma++;
+            for (c = 0; c < 16; c++)
+                buffer32->line[dev->displine + 14][(x << 4) + c + 8] = (dat & (32768 >> c)) ? 7 : 0;
+            for (c = 0; c < 16; c += 8)
+                video_blend((x << 4) + c + 8, dev->displine + 14);
+        }
+    } else {
+        for (x = 0; x < dev->crtc[1]; x++) {
+            if (dev->ctrl & 8) {
+                /* Undocumented behavior: page 1 in text mode means characters are read
+                   from page 1 and attributes from page 0. */
+                chr  = dev->charbuffer[x << 1];
+                attr = dev->charbuffer[(x << 1) + 1];
+            } else
+                chr = attr = 0;
+            drawcursor = ((dev->ma == ca) && dev->con && dev->cursoron);
+            blink      = ((dev->blink & 16) && (dev->ctrl & 0x20) && (attr & 0x80) && !drawcursor);
+
+            if (dev->sc == 12 && ((attr & 7) == 1))
+                bits = 0x1ff;
+            else {
+                font = fontdatm[chr][dev->sc];
+                bits = font << 1;
+                if ((chr & ~0x1f) == 0xc0)
+                    bits |= font & 1;
+            }
+            fg = dev->cols[attr][blink][1];
+            bg = dev->cols[attr][blink][0];
+            if (drawcursor) {
+                fg ^= dev->cols[attr][0][1];
+                bg ^= dev->cols[attr][0][1];
+            }
+            pix = glyph_cache_lookup(hercules_glyph_cache, bits, fg, bg);
+            memcpy(&buffer32->line[dev->displine + 14][(x * 9) + 8], pix, 9 * sizeof(uint32_t));
+
+            if (dev->ctrl2 & 0x01)
+                dev->ma = (dev->ma + 1) & 0x3fff;
+            else
+                dev->ma = (dev->ma + 1) & 0x7ff;
+        }
+    }
+
+    hercules_render_overscan_right(dev);
+
+    if (dev->ctrl & 0x02)
+        x = dev->crtc[1] << 4;
+    else
+        x = dev->crtc[1] * 9;
+
+    video_process_8(x + 16, dev->displine + 14);
+}
+
 static void
 hercules_poll(void *priv)
 {
     hercules_t *dev = (hercules_t *) priv;
-    uint8_t     chr;
-    uint8_t     attr;
     uint16_t    ca;
-    uint16_t    dat;
     uint16_t    pa;
     int         oldsc;
-    int         blink;
     int         x;
     int         xx;
     int         y;
     int         yy;
-    int         c;
     int         oldvc;
-    int         drawcursor;
     uint32_t   *p;
 
     VIDEO_MONITOR_PROLOGUE()
@@ -314,68 +427,14 @@ hercules_poll(void *priv)
             }
             dev->lastline = dev->displine;
 
-            hercules_render_overscan_left(dev);
-
-            if (dev->ctrl & 0x02) {
-                ca = (dev->sc & 3) * 0x2000;
-                if (dev->ctrl & 0x80)
-                    ca += 0x8000;
-
-                for (x = 0; x < dev->crtc[1]; x++) {
-                    if (dev->ctrl & 8)
-                        dat = (dev->vram[((dev->ma << 1) & 0x1fff) + ca] << 8) | dev->vram[((dev->ma << 1) & 0x1fff) + ca + 1];
-                    else
-                        dat = 0;
-                    dev->ma++;
-                    for (c = 0; c < 16; c++)
-                        buffer32->line[dev->displine + 14][(x << 4) + c + 8] = (dat & (32768 >> c)) ? 7 : 0;
-                    for (c = 0; c < 16; c += 8)
-                        video_blend((x << 4) + c + 8, dev->displine + 14);
-                }
-            } else {
-                for (x = 0; x < dev->crtc[1]; x++) {
-                    if (dev->ctrl & 8) {
-                        /* Undocumented behavior: page 1 in text mode means characters are read
-                           from page 1 and attributes from page 0. */
-                        chr  = dev->charbuffer[x << 1];
-                        attr = dev->charbuffer[(x << 1) + 1];
-                    } else
-                        chr = attr = 0;
-                    drawcursor = ((dev->ma == ca) && dev->con && dev->cursoron);
-                    blink      = ((dev->blink & 16) && (dev->ctrl & 0x20) && (attr & 0x80) && !drawcursor);
-
-                    if (dev->sc == 12 && ((attr & 7) == 1)) {
-                        for (c = 0; c < 9; c++)
-                            buffer32->line[dev->displine + 14][(x * 9) + c + 8] = dev->cols[attr][blink][1];
-                    } else {
-                        for (c = 0; c < 8; c++)
-                            buffer32->line[dev->displine + 14][(x * 9) + c + 8] = dev->cols[attr][blink][(fontdatm[chr][dev->sc] & (1 << (c ^ 7))) ? 1 : 0];
-
-                        if ((chr & ~0x1f) == 0xc0)
-                            buffer32->line[dev->displine + 14][(x * 9) + 8 + 8] = dev->cols[attr][blink][fontdatm[chr][dev->sc] & 1];
-                        else
-                            buffer32->line[dev->displine + 14][(x * 9) + 8 + 8] = dev->cols[attr][blink][0];
-                    }
-                    if (dev->ctrl2 & 0x01)
-                        dev->ma = (dev->ma + 1) & 0x3fff;
-                    else
-                        dev->ma = (dev->ma + 1) & 0x7ff;
-
-                    if (drawcursor) {
-                        for (c = 0; c < 9; c++)
-                            buffer32->line[dev->displine + 14][(x * 9) + c + 8] ^= dev->cols[attr][0][1];
-                    }
-                }
-            }
-
-            hercules_render_overscan_right(dev);
-
-            if (dev->ctrl & 0x02)
-                x = dev->crtc[1] << 4;
-            else
-                x = dev->crtc[1] * 9;
-
-            video_process_8(x + 16, dev->displine + 14);
+            /* An unchanged line is still in the buffer from the previous frame. */
+            if (dev->line_cache && line_cache_hit(dev->line_cache, dev->displine + 14, 1, hercules_line_sig(dev, ca))) {
+                if (dev->ctrl & 0x02)
+                    dev->ma += dev->crtc[1];
+                else
+                    dev->ma = (dev->ma + dev->crtc[1]) & ((dev->ctrl2 & 0x01) ? 0x3fff : 0x7ff);
+            } else
+                hercules_render(dev, ca);
         }
         dev->sc = oldsc;
 
@@ -470,6 +529,9 @@ hercules_poll(void *priv)
 
                         if (video_force_resize_get())
                             video_force_resize_set(0);
+
+                        if (dev->line_cache)
+                            dev->line_cache->full = 1;
                     }
 
                     if ((x >= 160) && ((y + 1) >= 120)) {
@@ -489,6 +551,8 @@ hercules_poll(void *priv)
                         }
                     }
 
+                    if (dev->line_cache)
+                        line_cache_blit(dev->line_cache, 0, dev->monitor_index);
                     if (enable_overscan)
                         video_blit_memtoscreen(0, dev->firstline, xsize + 16, ysize + 28);
                     else
@@ -543,6 +607,9 @@ hercules_init(UNUSED(const device_t *info))
 
     dev->vram = (uint8_t *) malloc(0x10000);
 
+    dev->line_cache = (line_cache_t *) malloc(sizeof(line_cache_t));
+    line_cache_invalidate(dev->line_cache);
+
     timer_add(&dev->timer, hercules_poll, dev, 1);
 
     mem_mapping_add(&dev->mapping, 0xb0000, 0x08000,
@@ -601,6 +668,7 @@ hercules_close(void *priv)
     if (dev->vram)
         free(dev->vram);
 
+    free(dev->line_cache);
     free(dev);
 }
 
@@ -31,10 +31,14 @@
 #include <86box/device.h>
 #include <86box/video.h>
 #include <86box/vid_mda.h>
+#include <86box/vid_glyph_cache.h>
+#include <86box/vid_line_cache.h>
 #include <86box/plat_unused.h>
 
 static int mdacols[256][2][2];
 
+static glyph_row_t mda_glyph_cache[GLYPH_CACHE_SIZE];
+
 static video_timings_t timing_mda = { .type = VIDEO_ISA, .write_b = 8, .write_w = 16, .write_l = 32, .read_b = 8, .read_w = 16, .read_l = 32 };
 
 void mda_recalctimings(mda_t *mda);
@@ -127,19 +131,74 @@ mda_recalctimings(mda_t *mda)
     mda->dispofftime = (uint64_t) (_dispofftime);
 }
 
+/* Signature of everything the current line is drawn from. */
+static uint64_t
+mda_line_sig(const mda_t *mda, uint16_t ca)
+{
+    uint64_t sig = line_cache_seed(mda->monitor_index);
+
+    sig = line_cache_mix(sig, mda->crtc[1] | (mda->sc << 8) | (mda->ctrl << 16) | ((mda->blink & 16) << 24));
+    sig = line_cache_mix(sig, mda->fontbase);
+    for (int x = 0; x < mda->crtc[1]; x++) {
+        uint16_t ma  = mda->ma + x;
+        uint32_t val = mda->vram[(ma << 1) & 0xfff] | (mda->vram[((ma << 1) + 1) & 0xfff] << 8);
+
+        if ((ma == ca) && mda->con && mda->cursoron)
+            val |= 0x10000;
+        sig = line_cache_mix(sig, (uint64_t) val | ((uint64_t) x << 32));
+    }
+
+    return sig;
+}
+
+static void
+mda_render(mda_t *mda, uint16_t ca)
+{
+    const uint32_t *pix;
+    int             drawcursor;
+    uint8_t         chr;
+    uint8_t         attr;
+    uint8_t         dat;
+    uint32_t        bits;
+    uint32_t        fg;
+    uint32_t        bg;
+    int             blink;
+
+    for (int x = 0; x < mda->crtc[1]; x++) {
+        chr        = mda->vram[(mda->ma << 1) & 0xfff];
+        attr       = mda->vram[((mda->ma << 1) + 1) & 0xfff];
+        drawcursor = ((mda->ma == ca) && mda->con && mda->cursoron);
+        blink      = ((mda->blink & 16) && (mda->ctrl & 0x20) && (attr & 0x80) && !drawcursor);
+        if (mda->sc == 12 && ((attr & 7) == 1))
+            bits = 0x1ff;
+        else {
+            dat  = fontdatm[chr + mda->fontbase][mda->sc];
+            bits = dat << 1;
+            if ((chr & ~0x1f) == 0xc0)
+                bits |= dat & 1;
+        }
+        fg = mdacols[attr][blink][1];
+        bg = mdacols[attr][blink][0];
+        if (drawcursor) {
+            fg ^= mdacols[attr][0][1];
+            bg ^= mdacols[attr][0][1];
+        }
+        pix = glyph_cache_lookup(mda_glyph_cache, bits, fg, bg);
+        memcpy(&buffer32->line[mda->displine][x * 9], pix, 9 * sizeof(uint32_t));
+        mda->ma++;
+    }
+
+    video_process_8(mda->crtc[1] * 9, mda->displine);
+}
+
 void
 mda_poll(void *priv)
 {
     mda_t   *mda = (mda_t *) priv;
     uint16_t ca  = (mda->crtc[15] | (mda->crtc[14] << 8)) & 0x3fff;
-    int      drawcursor;
     int      x;
-    int      c;
     int      oldvc;
-    uint8_t  chr;
-    uint8_t  attr;
     int      oldsc;
-    int      blink;
 
     VIDEO_MONITOR_PROLOGUE()
     if (!mda->linepos) {
@@ -155,30 +214,11 @@ mda_poll(void *priv)
                 video_wait_for_buffer();
             }
             mda->lastline = mda->displine;
-            for (x = 0; x < mda->crtc[1]; x++) {
-                chr        = mda->vram[(mda->ma << 1) & 0xfff];
-                attr       = mda->vram[((mda->ma << 1) + 1) & 0xfff];
-                drawcursor = ((mda->ma == ca) && mda->con && mda->cursoron);
-                blink      = ((mda->blink & 16) && (mda->ctrl & 0x20) && (attr & 0x80) && !drawcursor);
-                if (mda->sc == 12 && ((attr & 7) == 1)) {
-                    for (c = 0; c < 9; c++)
-                        buffer32->line[mda->displine][(x * 9) + c] = mdacols[attr][blink][1];
-                } else {
-                    for (c = 0; c < 8; c++)
-                        buffer32->line[mda->displine][(x * 9) + c] = mdacols[attr][blink][(fontdatm[chr + mda->fontbase][mda->sc] & (1 << (c ^ 7))) ? 1 : 0];
-                    if ((chr & ~0x1f) == 0xc0)
-                        buffer32->line[mda->displine][(x * 9) + 8] = mdacols[attr][blink][fontdatm[chr + mda->fontbase][mda->sc] & 1];
-                    else
-                        buffer32->line[mda->displine][(x * 9) + 8] = mdacols[attr][blink][0];
-                }
-                mda->ma++;
-                if (drawcursor) {
-                    for (c = 0; c < 9; c++)
-                        buffer32->line[mda->displine][(x * 9) + c] ^= mdacols[attr][0][1];
-                }
-            }
-
-            video_process_8(mda->crtc[1] * 9, mda->displine);
+            /* An unchanged line is still in the buffer from the previous frame. */
+            if (mda->line_cache && line_cache_hit(mda->line_cache, mda->displine, 1, mda_line_sig(mda, ca)))
+                mda->ma += mda->crtc[1];
+            else
+                mda_render(mda, ca);
         }
         mda->sc = oldsc;
         if (mda->vc == mda->crtc[7] && !mda->sc) {
@@ -250,7 +290,12 @@ mda_poll(void *priv)
 
                         if (video_force_resize_get())
                             video_force_resize_set(0);
+
+                        if (mda->line_cache)
+                            mda->line_cache->full = 1;
                     }
+                    if (mda->line_cache)
+                        line_cache_blit(mda->line_cache, 0, mda->monitor_index);
                     video_blit_memtoscreen(0, mda->firstline, xsize, ysize);
                     frames++;
                     video_res_x = mda->crtc[1];
@@ -317,6 +362,9 @@ mda_standalone_init(UNUSED(const device_t *info))
 
     mda->vram = malloc(0x1000);
 
+    mda->line_cache = malloc(sizeof(line_cache_t));
+    line_cache_invalidate(mda->line_cache);
+
     mem_mapping_add(&mda->mapping, 0xb0000, 0x08000, mda_read, NULL, NULL, mda_write, NULL, NULL, NULL, MEM_MAPPING_EXTERNAL, mda);
     io_sethandler(0x03b0, 0x0010, mda_in, NULL, NULL, mda_out, NULL, NULL, mda);
 
@@ -338,6 +386,7 @@ mda_close(void *priv)
 {
     mda_t *mda = (mda_t *) priv;
 
+    free(mda->line_cache);
     free(mda->vram);
     free(mda);
 }
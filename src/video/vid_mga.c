@@ -32,11 +32,13 @@
 #include <86box/dma.h>
 #include <86box/plat.h>
 #include <86box/thread.h>
+#include <86box/spsc.h>
 #include <86box/video.h>
 #include <86box/i2c.h>
 #include <86box/vid_ddc.h>
 #include <86box/vid_svga.h>
 #include <86box/vid_svga_render.h>
+#include <86box/vid_blit.h>
 
 #define ROM_IMPRESSION    "roms/video/matrox/matroxisathenar1.BIN"
 #define ROM_MILLENNIUM    "roms/video/matrox/matrox2064wr2.BIN"
@@ -52,9 +54,9 @@
 
 #define WAKE_DELAY       (100 * TIMER_USEC) /* 100us */
 
-#define FIFO_ENTRIES     (mystique->fifo_write_idx - mystique->fifo_read_idx)
-#define FIFO_FULL        ((mystique->fifo_write_idx - mystique->fifo_read_idx) >= (FIFO_SIZE - 1))
-#define FIFO_EMPTY       (mystique->fifo_read_idx == mystique->fifo_write_idx)
+#define FIFO_ENTRIES     spsc_entries(&mystique->fifo_ring)
+#define FIFO_FULL        (spsc_entries(&mystique->fifo_ring) >= (FIFO_SIZE - 1))
+#define FIFO_EMPTY       spsc_empty(&mystique->fifo_ring)
 
 #define FIFO_TYPE        0xff000000
 #define FIFO_ADDR        0x00ffffff
@@ -468,8 +470,7 @@ typedef struct mystique_t {
 
     atomic_int busy, blitter_submit_refcount,
         blitter_submit_dma_refcount, blitter_complete_refcount,
-        endprdmasts_pending, softrap_pending,
-        fifo_read_idx, fifo_write_idx;
+        endprdmasts_pending, softrap_pending;
 
     uint32_t vram_mask, vram_mask_w, vram_mask_l,
         lfb_base, ctrl_base, iload_base,
@@ -484,6 +485,7 @@ typedef struct mystique_t {
     pc_timer_t softrap_pending_timer, wake_timer;
 
     fifo_entry_t fifo[FIFO_SIZE];
+    spsc_t       fifo_ring;
 
     thread_t *fifo_thread;
 
@@ -1579,6 +1581,7 @@ mystique_ctrl_read_b(uint32_t addr, void *priv)
 
             case REG_STATUS:
                 ret = mystique->status & 0xff;
+                svga_poll_sync(svga);
                 if (svga->cgastat & 8)
                     ret |= REG_STATUS_VSYNCSTS;
                 if (ret & 1)
@@ -1647,6 +1650,7 @@ mystique_ctrl_read_b(uint32_t addr, void *priv)
             case REG_VCOUNT + 1:
             case REG_VCOUNT + 2:
             case REG_VCOUNT + 3:
+                svga_poll_sync(svga);
                 READ8(addr, svga->vc);
                 break;
 
@@ -3143,7 +3147,7 @@ fifo_thread(void *priv)
             int words_transferred = 0;
 
             while (!FIFO_EMPTY && words_transferred < 100) {
-                fifo_entry_t *fifo = &mystique->fifo[mystique->fifo_read_idx & FIFO_MASK];
+                fifo_entry_t *fifo = &mystique->fifo[spsc_read_pos(&mystique->fifo_ring)];
 
                 switch (fifo->addr_type & FIFO_TYPE) {
                     case FIFO_WRITE_CTRL_BYTE:
@@ -3161,10 +3165,7 @@ fifo_thread(void *priv)
                 }
 
                 fifo->addr_type = FIFO_INVALID;
-                mystique->fifo_read_idx++;
-
-                if (FIFO_ENTRIES > FIFO_THRESHOLD)
-                    thread_set_event(mystique->fifo_not_full_event);
+                spsc_pop(&mystique->fifo_ring);
 
                 words_transferred++;
             }
@@ -3243,18 +3244,15 @@ mystique_softrap_pending_timer(void *priv)
 static void
 mystique_queue(mystique_t *mystique, uint32_t addr, uint32_t val, uint32_t type)
 {
-    fifo_entry_t *fifo = &mystique->fifo[mystique->fifo_write_idx & FIFO_MASK];
+    fifo_entry_t *fifo;
 
-    if (FIFO_FULL) {
-        thread_reset_event(mystique->fifo_not_full_event);
-        if (FIFO_FULL)
-            thread_wait_event(mystique->fifo_not_full_event, -1); /* Wait for room in ringbuffer */
-    }
+    spsc_wait_below(&mystique->fifo_ring, FIFO_SIZE - 1);
 
+    fifo            = &mystique->fifo[spsc_write_pos(&mystique->fifo_ring)];
     fifo->val       = val;
     fifo->addr_type = (addr & FIFO_ADDR) | type;
 
-    mystique->fifo_write_idx++;
+    spsc_push(&mystique->fifo_ring);
 
     if (FIFO_ENTRIES > FIFO_THRESHOLD || FIFO_ENTRIES < 8)
         wake_fifo_thread(mystique);
@@ -3510,6 +3508,86 @@ blit_idump_read(mystique_t *mystique)
     return ret;
 }
 
+/*Helpers for the row at a time fast paths below. These are only used for
+  rows that can not wrap around video memory*/
+static int
+mystique_pixel_bytes(const mystique_t *mystique)
+{
+    switch (mystique->maccess_running & MACCESS_PWIDTH_MASK) {
+        case MACCESS_PWIDTH_8:
+            return 1;
+        case MACCESS_PWIDTH_16:
+            return 2;
+        case MACCESS_PWIDTH_24:
+            return 3;
+        case MACCESS_PWIDTH_32:
+            return 4;
+
+        default:
+            break;
+    }
+
+    return 0;
+}
+
+/*Clip the pixels [*l, *r] of the current destination line. Returns zero if
+  none of them are visible*/
+static int
+mystique_clip_span(const mystique_t *mystique, int *l, int *r)
+{
+    if ((mystique->dwgreg.ydst_lin < mystique->dwgreg.ytop) || (mystique->dwgreg.ydst_lin > mystique->dwgreg.ybot))
+        return 0;
+
+    if (*l < mystique->dwgreg.cxleft)
+        *l = mystique->dwgreg.cxleft;
+    if (*r > mystique->dwgreg.cxright)
+        *r = mystique->dwgreg.cxright;
+
+    return *l <= *r;
+}
+
+static int
+mystique_span_ok(const mystique_t *mystique, uint32_t start, uint32_t count, int bytes_pp)
+{
+    return (((uint64_t) start + count) * bytes_pp) <= ((uint64_t) mystique->vram_mask + 1);
+}
+
+static void
+mystique_span_changed(mystique_t *mystique, uint32_t start, uint32_t count, int bytes_pp)
+{
+    svga_t *svga = &mystique->svga;
+
+    video_blit_mark_changed(svga->changedvram, start * bytes_pp, count * bytes_pp, changeframecount);
+}
+
+/*Copy one line of a plain BITBLT in a single pass. This is only possible if
+  the source line ends on the same pixel as the destination line*/
+static int
+blit_fbitblt_line_fast(mystique_t *mystique, uint32_t src_addr, int x_start, int x_end, int x_dir)
+{
+    svga_t *svga     = &mystique->svga;
+    int     bytes_pp = mystique_pixel_bytes(mystique);
+    int     l        = (x_dir > 0) ? x_start : x_end;
+    int     r        = (x_dir > 0) ? x_end : x_start;
+
+    if (!bytes_pp || (((x_end - x_start) * x_dir) < 0) || (mystique->dwgreg.ar[0] != (src_addr + (x_end - x_start))))
+        return 0;
+
+    if (mystique_clip_span(mystique, &l, &r)) {
+        uint32_t dst   = mystique->dwgreg.ydst_lin + l;
+        uint32_t src   = src_addr + (l - x_start);
+        uint32_t count = r - l + 1;
+
+        if (!mystique_span_ok(mystique, dst, count, bytes_pp) || !mystique_span_ok(mystique, src, count, bytes_pp))
+            return 0;
+
+        video_blit_copy(svga->vram, dst * bytes_pp, src * bytes_pp, count * bytes_pp, bytes_pp, x_dir);
+        mystique_span_changed(mystique, dst, count, bytes_pp);
+    }
+
+    return 1;
+}
+
 static void
 blit_fbitblt(mystique_t *mystique)
 {
@@ -3523,58 +3601,65 @@ blit_fbitblt(mystique_t *mystique)
 
     for (uint16_t y = 0; y < mystique->dwgreg.length; y++) {
         int16_t x = x_start;
-        while (1) {
-            if (x >= mystique->dwgreg.cxleft && x <= mystique->dwgreg.cxright && mystique->dwgreg.ydst_lin >= mystique->dwgreg.ytop && mystique->dwgreg.ydst_lin <= mystique->dwgreg.ybot) {
-                uint32_t src;
-                uint32_t old_dst;
 
-                switch (mystique->maccess_running & MACCESS_PWIDTH_MASK) {
-                    case MACCESS_PWIDTH_8:
-                        src = svga->vram[src_addr & mystique->vram_mask];
+        if (blit_fbitblt_line_fast(mystique, src_addr, x_start, x_end, x_dir)) {
+            mystique->dwgreg.ar[0] += mystique->dwgreg.ar[5];
+            mystique->dwgreg.ar[3] += mystique->dwgreg.ar[5];
+            src_addr = mystique->dwgreg.ar[3];
+        } else {
+            while (1) {
+                if (x >= mystique->dwgreg.cxleft && x <= mystique->dwgreg.cxright && mystique->dwgreg.ydst_lin >= mystique->dwgreg.ytop && mystique->dwgreg.ydst_lin <= mystique->dwgreg.ybot) {
+                    uint32_t src;
+                    uint32_t old_dst;
 
-                        svga->vram[(mystique->dwgreg.ydst_lin + x) & mystique->vram_mask]                = src;
-                        svga->changedvram[((mystique->dwgreg.ydst_lin + x) & mystique->vram_mask) >> 12] = changeframecount;
-                        break;
+                    switch (mystique->maccess_running & MACCESS_PWIDTH_MASK) {
+                        case MACCESS_PWIDTH_8:
+                            src = svga->vram[src_addr & mystique->vram_mask];
 
-                    case MACCESS_PWIDTH_16:
-                        src = ((uint16_t *) svga->vram)[src_addr & mystique->vram_mask_w];
+                            svga->vram[(mystique->dwgreg.ydst_lin + x) & mystique->vram_mask]                = src;
+                            svga->changedvram[((mystique->dwgreg.ydst_lin + x) & mystique->vram_mask) >> 12] = changeframecount;
+                            break;
 
-                        ((uint16_t *) svga->vram)[(mystique->dwgreg.ydst_lin + x) & mystique->vram_mask_w] = src;
-                        svga->changedvram[((mystique->dwgreg.ydst_lin + x) & mystique->vram_mask_w) >> 11] = changeframecount;
-                        break;
+                        case MACCESS_PWIDTH_16:
+                            src = ((uint16_t *) svga->vram)[src_addr & mystique->vram_mask_w];
 
-                    case MACCESS_PWIDTH_24:
-                        src     = *(uint32_t *) &svga->vram[(src_addr * 3) & mystique->vram_mask];
-                        old_dst = *(uint32_t *) &svga->vram[((mystique->dwgreg.ydst_lin + x) * 3) & mystique->vram_mask];
+                            ((uint16_t *) svga->vram)[(mystique->dwgreg.ydst_lin + x) & mystique->vram_mask_w] = src;
+                            svga->changedvram[((mystique->dwgreg.ydst_lin + x) & mystique->vram_mask_w) >> 11] = changeframecount;
+                            break;
 
-                        *(uint32_t *) &svga->vram[((mystique->dwgreg.ydst_lin + x) * 3) & mystique->vram_mask] = (src & 0xffffff) | (old_dst & 0xff000000);
-                        svga->changedvram[(((mystique->dwgreg.ydst_lin + x) * 3) & mystique->vram_mask) >> 12] = changeframecount;
-                        break;
+                        case MACCESS_PWIDTH_24:
+                            src     = *(uint32_t *) &svga->vram[(src_addr * 3) & mystique->vram_mask];
+                            old_dst = *(uint32_t *) &svga->vram[((mystique->dwgreg.ydst_lin + x) * 3) & mystique->vram_mask];
 
-                    case MACCESS_PWIDTH_32:
-                        src = ((uint32_t *) svga->vram)[src_addr & mystique->vram_mask_l];
+                            *(uint32_t *) &svga->vram[((mystique->dwgreg.ydst_lin + x) * 3) & mystique->vram_mask] = (src & 0xffffff) | (old_dst & 0xff000000);
+                            svga->changedvram[(((mystique->dwgreg.ydst_lin + x) * 3) & mystique->vram_mask) >> 12] = changeframecount;
+                            break;
 
-                        ((uint32_t *) svga->vram)[(mystique->dwgreg.ydst_lin + x) & mystique->vram_mask_l] = src;
-                        svga->changedvram[((mystique->dwgreg.ydst_lin + x) & mystique->vram_mask_l) >> 10] = changeframecount;
-                        break;
+                        case MACCESS_PWIDTH_32:
+                            src = ((uint32_t *) svga->vram)[src_addr & mystique->vram_mask_l];
 
-                    default:
-                        fatal("BITBLT RPL BFCOL PWIDTH %x %08x\n", mystique->maccess_running & MACCESS_PWIDTH_MASK, mystique->dwgreg.dwgctrl_running);
+                            ((uint32_t *) svga->vram)[(mystique->dwgreg.ydst_lin + x) & mystique->vram_mask_l] = src;
+                            svga->changedvram[((mystique->dwgreg.ydst_lin + x) & mystique->vram_mask_l) >> 10] = changeframecount;
+                            break;
+
+                        default:
+                            fatal("BITBLT RPL BFCOL PWIDTH %x %08x\n", mystique->maccess_running & MACCESS_PWIDTH_MASK, mystique->dwgreg.dwgctrl_running);
+                    }
                 }
-            }
 
-            if (src_addr == mystique->dwgreg.ar[0]) {
-                mystique->dwgreg.ar[0] += mystique->dwgreg.ar[5];
-                mystique->dwgreg.ar[3] += mystique->dwgreg.ar[5];
-                src_addr = mystique->dwgreg.ar[3];
-                break;
-            } else
-                src_addr += x_dir;
+                if (src_addr == mystique->dwgreg.ar[0]) {
+                    mystique->dwgreg.ar[0] += mystique->dwgreg.ar[5];
+                    mystique->dwgreg.ar[3] += mystique->dwgreg.ar[5];
+                    src_addr = mystique->dwgreg.ar[3];
+                    break;
+                } else
+                    src_addr += x_dir;
 
-            if (x != x_end)
-                x += x_dir;
-            else
-                break;
+                if (x != x_end)
+                    x += x_dir;
+                else
+                    break;
+            }
         }
 
         if (mystique->dwgreg.sgn.sdy)
@@ -4670,6 +4755,46 @@ blit_line_start(mystique_t *mystique, int closed, int autoline)
     }
 }
 
+/*Returns non-zero if every pixel of the pattern is set, as it is for solid fills*/
+static int
+mystique_pattern_solid(const mystique_t *mystique)
+{
+    for (uint8_t y = 0; y < 8; y++) {
+        for (uint8_t x = 0; x < 16; x++) {
+            if (!mystique->dwgreg.pattern[y][x])
+                return 0;
+        }
+    }
+
+    return 1;
+}
+
+/*Fill one line of a solid BLK/RPL trapezoid with the foreground colour*/
+static int
+blit_trap_fill_line(mystique_t *mystique, int x_l, int len)
+{
+    svga_t *svga     = &mystique->svga;
+    int     bytes_pp = mystique_pixel_bytes(mystique);
+    int     l        = x_l;
+    int     r        = x_l + len - 1;
+
+    if (!bytes_pp)
+        return 0;
+
+    if (mystique_clip_span(mystique, &l, &r)) {
+        uint32_t dst   = mystique->dwgreg.ydst_lin + l;
+        uint32_t count = r - l + 1;
+
+        if (!mystique_span_ok(mystique, dst, count, bytes_pp))
+            return 0;
+
+        video_blit_fill(&svga->vram[dst * bytes_pp], mystique->dwgreg.fcol, bytes_pp, count * bytes_pp);
+        mystique_span_changed(mystique, dst, count, bytes_pp);
+    }
+
+    return 1;
+}
+
 static void
 blit_trap(mystique_t *mystique)
 {
@@ -4685,10 +4810,13 @@ blit_trap(mystique_t *mystique)
     int       err_r = (int32_t)mystique->dwgreg.ar[4];
     const int trans_sel = (mystique->dwgreg.dwgctrl_running & DWGCTRL_TRANS_MASK) >> DWGCTRL_TRANS_SHIFT;
     bool transc = !!(mystique->dwgreg.dwgctrl_running & DWGCTRL_TRANSC);
+    int  solid;
 
     switch (mystique->dwgreg.dwgctrl_running & DWGCTRL_ATYPE_MASK) {
         case DWGCTRL_ATYPE_BLK:
         case DWGCTRL_ATYPE_RPL:
+            solid = !trans_sel && mystique_pattern_solid(mystique);
+
             for (y = 0; y < mystique->dwgreg.length; y++) {
                 uint8_t const *const trans = &trans_masks[trans_sel][(mystique->dwgreg.selline & 3) * 4];
                 int16_t              x_l   = mystique->dwgreg.fxleft & 0xffff;
@@ -4701,6 +4829,9 @@ blit_trap(mystique_t *mystique)
                 else
                     len = x_r - x_l;
 
+                if ((len > 0) && solid && blit_trap_fill_line(mystique, x_l, len))
+                    len = 0;
+
                 while (len > 0) {
                     if (x_l >= mystique->dwgreg.cxleft && x_l <= mystique->dwgreg.cxright && mystique->dwgreg.ydst_lin >= mystique->dwgreg.ytop && mystique->dwgreg.ydst_lin <= mystique->dwgreg.ybot && trans[x_l & 3]) {
                         int      xoff    = (mystique->dwgreg.xoff + (x_l & 7)) & 15;
@@ -5474,6 +5605,39 @@ skip_pixel:
     mystique->blitter_complete_refcount++;
 }
 
+/*Expand one line of BLK monochrome BITBLT data left to right in a single pass.
+  As with blit_fbitblt_line_fast(), the source line has to end on the last
+  destination pixel*/
+static int
+blit_bitblt_mono_line_fast(mystique_t *mystique, uint32_t src_addr, int x_start, int x_end, int x_dir)
+{
+    svga_t *svga     = &mystique->svga;
+    int     bytes_pp = mystique_pixel_bytes(mystique);
+    int     l        = x_start;
+    int     r        = x_end;
+
+    if (!bytes_pp || (x_dir < 0) || (x_end < x_start) || (mystique->dwgreg.ar[0] != (src_addr + (x_end - x_start))))
+        return 0;
+
+    if (mystique_clip_span(mystique, &l, &r)) {
+        uint32_t dst   = mystique->dwgreg.ydst_lin + l;
+        uint32_t bit   = src_addr + (l - x_start);
+        uint32_t count = r - l + 1;
+
+        if (!mystique_span_ok(mystique, dst, count, bytes_pp) || (bit > (bit + count - 1)) ||
+            (((bit + count - 1) >> 3) > mystique->vram_mask))
+            return 0;
+
+        video_blit_mono(&svga->vram[dst * bytes_pp], svga->vram, bit,
+                        (mystique->dwgreg.dwgctrl_running & DWGCTRL_BLTMOD_MASK) != DWGCTRL_BLTMOD_BMONOWF,
+                        mystique->dwgreg.fcol, mystique->dwgreg.bcol,
+                        !!(mystique->dwgreg.dwgctrl_running & DWGCTRL_TRANSC), bytes_pp, count);
+        mystique_span_changed(mystique, dst, count, bytes_pp);
+    }
+
+    return 1;
+}
+
 static void
 blit_bitblt(mystique_t *mystique)
 {
@@ -5508,72 +5672,78 @@ blit_bitblt(mystique_t *mystique)
                     for (y = 0; y < mystique->dwgreg.length; y++) {
                         int16_t x = x_start;
 
-                        while (1) {
-                            if (x >= mystique->dwgreg.cxleft && x <= mystique->dwgreg.cxright && mystique->dwgreg.ydst_lin >= mystique->dwgreg.ytop && mystique->dwgreg.ydst_lin <= mystique->dwgreg.ybot) {
-                                uint32_t byte_addr  = (src_addr >> 3) & mystique->vram_mask;
-                                int      bit_offset = ((mystique->dwgreg.dwgctrl_running & DWGCTRL_BLTMOD_MASK) == DWGCTRL_BLTMOD_BMONOWF) ? (7 - (src_addr & 7)) : (src_addr & 7);
-                                uint32_t old_dst;
-
-                                switch (mystique->maccess_running & MACCESS_PWIDTH_MASK) {
-                                    case MACCESS_PWIDTH_8:
-                                        if (mystique->dwgreg.dwgctrl_running & DWGCTRL_TRANSC) {
-                                            if (svga->vram[byte_addr] & (1 << bit_offset))
-                                                svga->vram[(mystique->dwgreg.ydst_lin + x) & mystique->vram_mask] = mystique->dwgreg.fcol;
-                                        } else
-                                            svga->vram[(mystique->dwgreg.ydst_lin + x) & mystique->vram_mask] = (svga->vram[byte_addr] & (1 << bit_offset)) ? mystique->dwgreg.fcol : mystique->dwgreg.bcol;
-                                        svga->changedvram[((mystique->dwgreg.ydst_lin + x) & mystique->vram_mask) >> 12] = changeframecount;
-                                        break;
+                        if (blit_bitblt_mono_line_fast(mystique, src_addr, x_start, x_end, x_dir)) {
+                            mystique->dwgreg.ar[0] += mystique->dwgreg.ar[5];
+                            mystique->dwgreg.ar[3] += mystique->dwgreg.ar[5];
+                            src_addr = mystique->dwgreg.ar[3];
+                        } else {
+                            while (1) {
+                                if (x >= mystique->dwgreg.cxleft && x <= mystique->dwgreg.cxright && mystique->dwgreg.ydst_lin >= mystique->dwgreg.ytop && mystique->dwgreg.ydst_lin <= mystique->dwgreg.ybot) {
+                                    uint32_t byte_addr  = (src_addr >> 3) & mystique->vram_mask;
+                                    int      bit_offset = ((mystique->dwgreg.dwgctrl_running & DWGCTRL_BLTMOD_MASK) == DWGCTRL_BLTMOD_BMONOWF) ? (7 - (src_addr & 7)) : (src_addr & 7);
+                                    uint32_t old_dst;
+
+                                    switch (mystique->maccess_running & MACCESS_PWIDTH_MASK) {
+                                        case MACCESS_PWIDTH_8:
+                                            if (mystique->dwgreg.dwgctrl_running & DWGCTRL_TRANSC) {
+                                                if (svga->vram[byte_addr] & (1 << bit_offset))
+                                                    svga->vram[(mystique->dwgreg.ydst_lin + x) & mystique->vram_mask] = mystique->dwgreg.fcol;
+                                            } else
+                                                svga->vram[(mystique->dwgreg.ydst_lin + x) & mystique->vram_mask] = (svga->vram[byte_addr] & (1 << bit_offset)) ? mystique->dwgreg.fcol : mystique->dwgreg.bcol;
+                                            svga->changedvram[((mystique->dwgreg.ydst_lin + x) & mystique->vram_mask) >> 12] = changeframecount;
+                                            break;
 
-                                    case MACCESS_PWIDTH_16:
-                                        if (mystique->dwgreg.dwgctrl_running & DWGCTRL_TRANSC) {
-                                            if (svga->vram[byte_addr] & (1 << bit_offset))
-                                                ((uint16_t *) svga->vram)[(mystique->dwgreg.ydst_lin + x) & mystique->vram_mask_w] = mystique->dwgreg.fcol;
-                                        } else
-                                            ((uint16_t *) svga->vram)[(mystique->dwgreg.ydst_lin + x) & mystique->vram_mask_w] = (svga->vram[byte_addr] & (1 << bit_offset)) ? mystique->dwgreg.fcol : mystique->dwgreg.bcol;
-                                        svga->changedvram[((mystique->dwgreg.ydst_lin + x) & mystique->vram_mask_w) >> 11] = changeframecount;
-                                        break;
+                                        case MACCESS_PWIDTH_16:
+                                            if (mystique->dwgreg.dwgctrl_running & DWGCTRL_TRANSC) {
+                                                if (svga->vram[byte_addr] & (1 << bit_offset))
+                                                    ((uint16_t *) svga->vram)[(mystique->dwgreg.ydst_lin + x) & mystique->vram_mask_w] = mystique->dwgreg.fcol;
+                                            } else
+                                                ((uint16_t *) svga->vram)[(mystique->dwgreg.ydst_lin + x) & mystique->vram_mask_w] = (svga->vram[byte_addr] & (1 << bit_offset)) ? mystique->dwgreg.fcol : mystique->dwgreg.bcol;
+                                            svga->changedvram[((mystique->dwgreg.ydst_lin + x) & mystique->vram_mask_w) >> 11] = changeframecount;
+                                            break;
 
-                                    case MACCESS_PWIDTH_24:
-                                        old_dst = *(uint32_t *) &svga->vram[((mystique->dwgreg.ydst_lin + x) * 3) & mystique->vram_mask];
-                                        if (mystique->dwgreg.dwgctrl_running & DWGCTRL_TRANSC) {
-                                            if (svga->vram[byte_addr] & (1 << bit_offset))
-                                                *(uint32_t *) &svga->vram[((mystique->dwgreg.ydst_lin + x) * 3) & mystique->vram_mask] = (old_dst & 0xff000000) | (mystique->dwgreg.fcol & 0xffffff);
-                                        } else
-                                            *(uint32_t *) &svga->vram[((mystique->dwgreg.ydst_lin + x) * 3) & mystique->vram_mask] = (old_dst & 0xff000000) | (((svga->vram[byte_addr] & (1 << bit_offset)) ? mystique->dwgreg.fcol : mystique->dwgreg.bcol) & 0xffffff);
-                                        svga->changedvram[(((mystique->dwgreg.ydst_lin + x) * 3) & mystique->vram_mask) >> 12] = changeframecount;
-                                        break;
+                                        case MACCESS_PWIDTH_24:
+                                            old_dst = *(uint32_t *) &svga->vram[((mystique->dwgreg.ydst_lin + x) * 3) & mystique->vram_mask];
+                                            if (mystique->dwgreg.dwgctrl_running & DWGCTRL_TRANSC) {
+                                                if (svga->vram[byte_addr] & (1 << bit_offset))
+                                                    *(uint32_t *) &svga->vram[((mystique->dwgreg.ydst_lin + x) * 3) & mystique->vram_mask] = (old_dst & 0xff000000) | (mystique->dwgreg.fcol & 0xffffff);
+                                            } else
+                                                *(uint32_t *) &svga->vram[((mystique->dwgreg.ydst_lin + x) * 3) & mystique->vram_mask] = (old_dst & 0xff000000) | (((svga->vram[byte_addr] & (1 << bit_offset)) ? mystique->dwgreg.fcol : mystique->dwgreg.bcol) & 0xffffff);
+                                            svga->changedvram[(((mystique->dwgreg.ydst_lin + x) * 3) & mystique->vram_mask) >> 12] = changeframecount;
+                                            break;
 
-                                    case MACCESS_PWIDTH_32:
-                                        if (mystique->dwgreg.dwgctrl_running & DWGCTRL_TRANSC) {
-                                            if (svga->vram[byte_addr] & (1 << bit_offset))
-                                                ((uint32_t *) svga->vram)[(mystique->dwgreg.ydst_lin + x) & mystique->vram_mask_l] = mystique->dwgreg.fcol;
-                                        } else
-                                            ((uint32_t *) svga->vram)[(mystique->dwgreg.ydst_lin + x) & mystique->vram_mask_l] = (svga->vram[byte_addr] & (1 << bit_offset)) ? mystique->dwgreg.fcol : mystique->dwgreg.bcol;
-                                        svga->changedvram[((mystique->dwgreg.ydst_lin + x) & mystique->vram_mask_l) >> 11] = changeframecount;
-                                        break;
+                                        case MACCESS_PWIDTH_32:
+                                            if (mystique->dwgreg.dwgctrl_running & DWGCTRL_TRANSC) {
+                                                if (svga->vram[byte_addr] & (1 << bit_offset))
+                                                    ((uint32_t *) svga->vram)[(mystique->dwgreg.ydst_lin + x) & mystique->vram_mask_l] = mystique->dwgreg.fcol;
+                                            } else
+                                                ((uint32_t *) svga->vram)[(mystique->dwgreg.ydst_lin + x) & mystique->vram_mask_l] = (svga->vram[byte_addr] & (1 << bit_offset)) ? mystique->dwgreg.fcol : mystique->dwgreg.bcol;
+                                            svga->changedvram[((mystique->dwgreg.ydst_lin + x) & mystique->vram_mask_l) >> 11] = changeframecount;
+                                            break;
 
-                                    default:
-                                        fatal("BITBLT DWGCTRL_ATYPE_BLK unknown MACCESS %i\n", mystique->maccess_running & MACCESS_PWIDTH_MASK);
+                                        default:
+                                            fatal("BITBLT DWGCTRL_ATYPE_BLK unknown MACCESS %i\n", mystique->maccess_running & MACCESS_PWIDTH_MASK);
+                                    }
                                 }
-                            }
 
-                            if (src_addr == mystique->dwgreg.ar[0]) {
-                                mystique->dwgreg.ar[0] += mystique->dwgreg.ar[5];
-                                mystique->dwgreg.ar[3] += mystique->dwgreg.ar[5];
-                                src_addr = mystique->dwgreg.ar[3];
-                                break;
-                            } else
-                                src_addr += x_dir;
-
-                            if (x != x_end)  {
-                                if ((x > x_end) && (x_dir == 1))
-                                    x--;
-                                else if ((x < x_end) && (x_dir == -1))
-                                    x++;
-                                else
-                                    x += x_dir;
-                            } else
-                                break;
+                                if (src_addr == mystique->dwgreg.ar[0]) {
+                                    mystique->dwgreg.ar[0] += mystique->dwgreg.ar[5];
+                                    mystique->dwgreg.ar[3] += mystique->dwgreg.ar[5];
+                                    src_addr = mystique->dwgreg.ar[3];
+                                    break;
+                                } else
+                                    src_addr += x_dir;
+
+                                if (x != x_end)  {
+                                    if ((x > x_end) && (x_dir == 1))
+                                        x--;
+                                    else if ((x < x_end) && (x_dir == -1))
+                                        x++;
+                                    else
+                                        x += x_dir;
+                                } else
+                                    break;
+                            }
                         }
 
                         if (mystique->dwgreg.sgn.sdy)
@@ -6789,8 +6959,9 @@ mystique_init(const device_t *info)
 
     mystique->wake_fifo_thread    = thread_create_event();
     mystique->fifo_not_full_event = thread_create_event();
+    spsc_init(&mystique->fifo_ring, FIFO_SIZE, SPSC_SPIN, mystique->wake_fifo_thread, mystique->fifo_not_full_event);
     mystique->thread_run          = 1;
-    mystique->fifo_thread         = thread_create(fifo_thread, mystique);
+    mystique->fifo_thread         = thread_create_role(fifo_thread, mystique, THREAD_ROLE_VIDEO);
     mystique->dma.lock            = thread_create_mutex();
 
     timer_add(&mystique->wake_timer, mystique_wake_timer, (void *) mystique, 0);
@@ -273,6 +273,7 @@ oti_in(uint16_t addr, void *priv)
               and expects the diagnostic bits to equal the current border colour. As I understand
               it, the 0x3da active enable status does not include the border time, so this may be
               an area where OTI-037C is not entirely VGA compatible.*/
+            svga_poll_sync(svga);
             svga->cgastat &= ~0x30;
             /* copy color diagnostic info from the overscan color register */
             switch (svga->attrregs[0x12] & 0x30) {
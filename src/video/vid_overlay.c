@@ -0,0 +1,253 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Shared helpers for the video overlays.
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <86box/vid_overlay.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#    define VIDEO_OVERLAY_SSE2
+#    include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#    define VIDEO_OVERLAY_NEON
+#    include <arm_neon.h>
+#endif
+
+#define CLAMP(x)                      \
+    do {                              \
+        if ((x) & ~0xff)              \
+            x = ((x) < 0) ? 0 : 0xff; \
+    } while (0)
+
+static __inline int
+overlay_luma(int y, int flags)
+{
+    if (flags & OVERLAY_YUV_STUDIO)
+        return (uint8_t) ((298 * (y - 16)) >> 8);
+
+    return y;
+}
+
+static __inline uint32_t
+overlay_pixel(int y, int dR, int dG, int dB, int flags)
+{
+    int r = y + dR;
+    int g = y - dG;
+    int b = y + dB;
+
+    CLAMP(r);
+    CLAMP(g);
+    CLAMP(b);
+
+    if (flags & OVERLAY_YUV_BGR)
+        return r | (g << 8) | (b << 16);
+
+    return (r << 16) | (g << 8) | b;
+}
+
+static __inline void
+overlay_chroma(int u, int v, int flags, int *dR, int *dG, int *dB)
+{
+    if (flags & OVERLAY_YUV_STUDIO) {
+        *dR = (309 * v) >> 8;
+        *dG = (100 * u + 208 * v) >> 8;
+        *dB = (516 * u) >> 8;
+    } else {
+        *dR = (359 * v) >> 8;
+        *dG = (88 * u + 183 * v) >> 8;
+        *dB = (453 * u) >> 8;
+    }
+}
+
+/*The 16 bit vector versions split every coefficient into a multiple of 256,
+  which is exact, and a remainder small enough for the products not to
+  overflow. (k * 256 + m) * v >> 8 is k * v + (m * v >> 8)*/
+#if defined(VIDEO_OVERLAY_SSE2)
+static int
+overlay_yuv422_sse2(uint32_t *dst, const uint8_t *src, int pairs, int flags)
+{
+    const int     studio = flags & OVERLAY_YUV_STUDIO;
+    const __m128i mask   = _mm_set1_epi16(0x00ff);
+    const __m128i c128   = _mm_set1_epi16(128);
+    const __m128i zero   = _mm_setzero_si128();
+    int           p      = 0;
+
+    for (; p <= pairs - 4; p += 4) {
+        __m128i v = _mm_loadu_si128((const __m128i *) &src[p * 4]);
+        __m128i y;
+        __m128i c;
+        __m128i first;
+        __m128i second;
+        __m128i cu;
+        __m128i cv;
+        __m128i dR;
+        __m128i dG;
+        __m128i dB;
+        __m128i r;
+        __m128i g;
+        __m128i b;
+        __m128i lo;
+        __m128i hi;
+
+        if (flags & OVERLAY_YUV_Y_ODD) {
+            y = _mm_srli_epi16(v, 8);
+            c = _mm_and_si128(v, mask);
+        } else {
+            y = _mm_and_si128(v, mask);
+            c = _mm_srli_epi16(v, 8);
+        }
+        c = _mm_sub_epi16(c, c128);
+
+        /*Give both pixels of a pair its two chroma samples*/
+        first  = _mm_shufflehi_epi16(_mm_shufflelo_epi16(c, _MM_SHUFFLE(2, 2, 0, 0)), _MM_SHUFFLE(2, 2, 0, 0));
+        second = _mm_shufflehi_epi16(_mm_shufflelo_epi16(c, _MM_SHUFFLE(3, 3, 1, 1)), _MM_SHUFFLE(3, 3, 1, 1));
+        cu     = (flags & OVERLAY_YUV_V_FIRST) ? second : first;
+        cv     = (flags & OVERLAY_YUV_V_FIRST) ? first : second;
+
+        if (studio) {
+            /*298 = 256 + 42, 309 = 256 + 53, 208 = 256 - 48, 516 = 512 + 4*/
+            __m128i d = _mm_sub_epi16(y, _mm_set1_epi16(16));
+
+            y  = _mm_and_si128(_mm_add_epi16(d, _mm_srai_epi16(_mm_mullo_epi16(d, _mm_set1_epi16(42)), 8)), mask);
+            dR = _mm_add_epi16(cv, _mm_srai_epi16(_mm_mullo_epi16(cv, _mm_set1_epi16(53)), 8));
+            dG = _mm_add_epi16(cv, _mm_srai_epi16(_mm_sub_epi16(_mm_mullo_epi16(cu, _mm_set1_epi16(100)), _mm_mullo_epi16(cv, _mm_set1_epi16(48))), 8));
+            dB = _mm_add_epi16(_mm_add_epi16(cu, cu), _mm_srai_epi16(_mm_mullo_epi16(cu, _mm_set1_epi16(4)), 8));
+        } else {
+            /*359 = 256 + 103, 183 = 256 - 73, 453 = 512 - 59*/
+            dR = _mm_add_epi16(cv, _mm_srai_epi16(_mm_mullo_epi16(cv, _mm_set1_epi16(103)), 8));
+            dG = _mm_add_epi16(cv, _mm_srai_epi16(_mm_sub_epi16(_mm_mullo_epi16(cu, _mm_set1_epi16(88)), _mm_mullo_epi16(cv, _mm_set1_epi16(73))), 8));
+            dB = _mm_add_epi16(_mm_add_epi16(cu, cu), _mm_srai_epi16(_mm_mullo_epi16(cu, _mm_set1_epi16(-59)), 8));
+        }
+
+        /*Saturating packs do the clamping*/
+        r = _mm_packus_epi16(_mm_add_epi16(y, dR), zero);
+        g = _mm_packus_epi16(_mm_sub_epi16(y, dG), zero);
+        b = _mm_packus_epi16(_mm_add_epi16(y, dB), zero);
+
+        if (flags & OVERLAY_YUV_BGR) {
+            lo = _mm_unpacklo_epi8(r, g);
+            hi = _mm_unpacklo_epi8(b, zero);
+        } else {
+            lo = _mm_unpacklo_epi8(b, g);
+            hi = _mm_unpacklo_epi8(r, zero);
+        }
+        _mm_storeu_si128((__m128i *) &dst[p * 2], _mm_unpacklo_epi16(lo, hi));
+        _mm_storeu_si128((__m128i *) &dst[p * 2 + 4], _mm_unpackhi_epi16(lo, hi));
+    }
+
+    return p;
+}
+#elif defined(VIDEO_OVERLAY_NEON)
+static int
+overlay_yuv422_neon(uint32_t *dst, const uint8_t *src, int pairs, int flags)
+{
+    const int studio = flags & OVERLAY_YUV_STUDIO;
+    int       p      = 0;
+
+    for (; p <= pairs - 4; p += 4) {
+        uint8x8x2_t bytes = vld2_u8(&src[p * 4]);
+        int16x8_t   y     = vreinterpretq_s16_u16(vmovl_u8(bytes.val[(flags & OVERLAY_YUV_Y_ODD) ? 1 : 0]));
+        uint16x8_t  c     = vreinterpretq_u16_s16(vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(bytes.val[(flags & OVERLAY_YUV_Y_ODD) ? 0 : 1])), vdupq_n_s16(128)));
+        /*Give both pixels of a pair its two chroma samples*/
+        uint16x8x2_t dup = vtrnq_u16(c, c);
+        int16x8_t    cu  = vreinterpretq_s16_u16(dup.val[(flags & OVERLAY_YUV_V_FIRST) ? 1 : 0]);
+        int16x8_t    cv  = vreinterpretq_s16_u16(dup.val[(flags & OVERLAY_YUV_V_FIRST) ? 0 : 1]);
+        int16x8_t    dR;
+        int16x8_t    dG;
+        int16x8_t    dB;
+        uint8x8x4_t  out;
+
+        if (studio) {
+            /*298 = 256 + 42, 309 = 256 + 53, 208 = 256 - 48, 516 = 512 + 4*/
+            int16x8_t d = vsubq_s16(y, vdupq_n_s16(16));
+
+            y  = vandq_s16(vaddq_s16(d, vshrq_n_s16(vmulq_n_s16(d, 42), 8)), vdupq_n_s16(0xff));
+            dR = vaddq_s16(cv, vshrq_n_s16(vmulq_n_s16(cv, 53), 8));
+            dG = vaddq_s16(cv, vshrq_n_s16(vsubq_s16(vmulq_n_s16(cu, 100), vmulq_n_s16(cv, 48)), 8));
+            dB = vaddq_s16(vaddq_s16(cu, cu), vshrq_n_s16(vmulq_n_s16(cu, 4), 8));
+        } else {
+            /*359 = 256 + 103, 183 = 256 - 73, 453 = 512 - 59*/
+            dR = vaddq_s16(cv, vshrq_n_s16(vmulq_n_s16(cv, 103), 8));
+            dG = vaddq_s16(cv, vshrq_n_s16(vsubq_s16(vmulq_n_s16(cu, 88), vmulq_n_s16(cv, 73)), 8));
+            dB = vaddq_s16(vaddq_s16(cu, cu), vshrq_n_s16(vmulq_n_s16(cu, -59), 8));
+        }
+
+        /*Saturating narrows do the clamping*/
+        out.val[(flags & OVERLAY_YUV_BGR) ? 0 : 2] = vqmovun_s16(vaddq_s16(y, dR));
+        out.val[1]                                 = vqmovun_s16(vsubq_s16(y, dG));
+        out.val[(flags & OVERLAY_YUV_BGR) ? 2 : 0] = vqmovun_s16(vaddq_s16(y, dB));
+        out.val[3]                                 = vdup_n_u8(0);
+        vst4_u8((uint8_t *) &dst[p * 2], out);
+    }
+
+    return p;
+}
+#endif
+
+void
+video_overlay_yuv422(uint32_t *dst, const uint8_t *src, int pairs, int flags)
+{
+    const int y_off = (flags & OVERLAY_YUV_Y_ODD) ? 1 : 0;
+    const int c_off = y_off ^ 1;
+    int       p     = 0;
+
+#if defined(VIDEO_OVERLAY_SSE2)
+    p = overlay_yuv422_sse2(dst, src, pairs, flags);
+#elif defined(VIDEO_OVERLAY_NEON)
+    p = overlay_yuv422_neon(dst, src, pairs, flags);
+#endif
+
+    for (; p < pairs; p++) {
+        const uint8_t *s      = &src[p * 4];
+        int            first  = s[c_off] - 0x80;
+        int            second = s[c_off + 2] - 0x80;
+        int            dR;
+        int            dG;
+        int            dB;
+
+        if (flags & OVERLAY_YUV_V_FIRST)
+            overlay_chroma(second, first, flags, &dR, &dG, &dB);
+        else
+            overlay_chroma(first, second, flags, &dR, &dG, &dB);
+
+        dst[p * 2]     = overlay_pixel(overlay_luma(s[y_off], flags), dR, dG, dB, flags);
+        dst[p * 2 + 1] = overlay_pixel(overlay_luma(s[y_off + 2], flags), dR, dG, dB, flags);
+    }
+}
+
+void
+video_overlay_yuv211(uint32_t *dst, const uint8_t *src, int groups, int flags)
+{
+    for (int c = 0; c < groups; c++) {
+        const uint8_t *s = &src[c * 6];
+        int            dR;
+        int            dG;
+        int            dB;
+
+        overlay_chroma(s[0] - 0x80, s[3] - 0x80, flags, &dR, &dG, &dB);
+
+        dst[c * 4]     = overlay_pixel(overlay_luma(s[1], flags), dR, dG, dB, flags);
+        dst[c * 4 + 1] = overlay_pixel(overlay_luma(s[2], flags), dR, dG, dB, flags);
+        dst[c * 4 + 2] = overlay_pixel(overlay_luma(s[4], flags), dR, dG, dB, flags);
+        dst[c * 4 + 3] = overlay_pixel(overlay_luma(s[5], flags), dR, dG, dB, flags);
+    }
+}
+
+void
+video_overlay_scale(uint32_t *dst, const uint32_t *src, int count, uint32_t pos, uint32_t step, int shift, uint32_t max_idx)
+{
+    for (int x = 0; x < count; x++) {
+        uint32_t idx = pos >> shift;
+
+        dst[x] = src[(idx > max_idx) ? max_idx : idx];
+        pos += step;
+    }
+}
@@ -2711,7 +2711,7 @@ pgc_init(pgc_t *dev, int maxw, int maxh, int visw, int vish,
     dev->inputbyte = inpbyte;
     dev->master = dev->commands = pgc_commands;
     dev->pgc_wake_thread        = thread_create_event();
-    dev->pgc_thread             = thread_create(pgc_thread, dev);
+    dev->pgc_thread             = thread_create_role(pgc_thread, dev, THREAD_ROLE_VIDEO);
 
     timer_add(&dev->timer, pgc_poll, dev, 1);
 
@@ -44,6 +44,7 @@
 #include <86box/thread.h>
 #include <86box/video.h>
 #include <86box/vid_ps55da2.h>
+#include <86box/vid_glyph_cache.h>
 #include <86box/vid_svga.h>
 #include <86box/vid_svga_render.h>
 #include "cpu.h"
@@ -1833,6 +1834,50 @@ da2_render_blank(da2_t *da2)
             ((uint32_t *) buffer32->line[da2->displine])[(x * cwidth) + xx + 32] = 0;
     }
 }
+static glyph_row_wide_t da2_glyph_cache[GLYPH_CACHE_SIZE];
+
+/* Get the 13 dots of the character at the current line, bit 15 leftmost.
+   The DBCS code of a left half is kept in chr_dbcs for the right half. */
+static uint32_t
+da2_char_dots(da2_t *da2, uint8_t chr, int dbcs, int sbex, uint32_t next, int *chr_wide, uint32_t *chr_dbcs)
+{
+    uint32_t fontbase;
+    uint32_t font;
+
+    /* right half of DBCS */
+    if (*chr_wide) {
+        *chr_wide = 0;
+        return getfont_ps55dbcs(*chr_dbcs, da2->sc, da2) & 0xfff8;
+    }
+
+    /* Stay drawing if the char code is DBCS and not at last column. */
+    if (dbcs) {
+        *chr_wide = 1;
+        /* Get high DBCS code from the next video address */
+        *chr_dbcs = (next << 8) | chr;
+        return (getfont_ps55dbcs(*chr_dbcs, da2->sc, da2) >> 16) & 0xfff8;
+    }
+
+    /* the char code is SBCS (ANK) */
+    if (sbex) /* second map of SBCS font */
+        fontbase = DA2_GAIJIRAM_SBEX;
+    else
+        fontbase = DA2_GAIJIRAM_SBCS;
+    font = da2->mmio.ram[fontbase + chr * 0x40 + da2->sc * 2] << 8; /* w13xh29 font */
+    font |= da2->mmio.ram[fontbase + chr * 0x40 + da2->sc * 2 + 1];
+    return font & 0xfff8;
+}
+
+/* Draw 13 dots through the glyph cache, keyed by the dots and the resolved colours. */
+static __inline void
+da2_draw_char(da2_t *da2, uint32_t *p, uint32_t dots, int fg, int bg)
+{
+    const uint32_t *pix = glyph_cache_lookup_wide(da2_glyph_cache, dots,
+                                                  da2->pallook[da2->egapal[fg]], da2->pallook[da2->egapal[bg]]);
+
+    memcpy(p, pix, 13 * sizeof(uint32_t));
+}
+
 /* Display Adapter Mode 8, E Drawing */
 static void
 da2_render_text(da2_t *da2)
@@ -1883,54 +1928,7 @@ da2_render_text(da2_t *da2)
                 // if(chr!=0x20) da2_log("chr: %x, %x, %x, %x, %x    ", chr, attr, fg, da2->egapal[fg], da2->pallook[da2->egapal[fg]]);
             }
             /* Draw character */
-            for (uint32_t n = 0; n < 13; n++)
-                p[n] = da2->pallook[da2->egapal[bg]]; /* draw blank */
-            /*  SBCS or DBCS left half */
-            if (chr_wide == 0) {
-                if (attr & 0x01)
-                    chr_wide = 1;
-                // chr_wide = 0;
-                /* Stay drawing If the char code is DBCS and not at last column. */
-                if (chr_wide) {
-                    /* Get high DBCS code from the next video address */
-                    chr_dbcs = da2->cram[(da2->ma + 2) & DA2_MASK_CRAM];
-                    chr_dbcs <<= 8;
-                    chr_dbcs |= chr;
-                    /* Get the font pattern */
-                    uint32_t font = getfont_ps55dbcs(chr_dbcs, da2->sc, da2);
-                    /* Draw 13 dots */
-                    for (uint32_t n = 0; n < 13; n++) {
-                        p[n] = da2->pallook[da2->egapal[(font & 0x80000000) ? fg : bg]];
-                        font <<= 1;
-                    }
-                } else {
-                    /* the char code is SBCS (ANK) */
-                    uint32_t fontbase;
-                    if (attr & 0x02) /* second map of SBCS font */
-                        fontbase = DA2_GAIJIRAM_SBEX;
-                    else
-                        fontbase = DA2_GAIJIRAM_SBCS;
-                    uint16_t font = da2->mmio.ram[fontbase + chr * 0x40 + da2->sc * 2]; /* w13xh29 font */
-                    font <<= 8;
-                    font |= da2->mmio.ram[fontbase + chr * 0x40 + da2->sc * 2 + 1]; /* w13xh29 font */
-                    // if(chr!=0x20) da2_log("ma: %x, sc: %x, chr: %x, font: %x    ", da2->ma, da2->sc, chr, font);
-                    /* Draw 13 dots */
-                    for (uint32_t n = 0; n < 13; n++) {
-                        p[n] = da2->pallook[da2->egapal[(font & 0x8000) ? fg : bg]];
-                        font <<= 1;
-                    }
-                }
-            }
-            /* right half of DBCS */
-            else {
-                uint32_t font = getfont_ps55dbcs(chr_dbcs, da2->sc, da2);
-                /* Draw 13 dots */
-                for (uint32_t n = 0; n < 13; n++) {
-                    p[n] = da2->pallook[da2->egapal[(font & 0x8000) ? fg : bg]];
-                    font <<= 1;
-                }
-                chr_wide = 0;
-            }
+            da2_draw_char(da2, p, da2_char_dots(da2, chr, (attr & 0x01), (attr & 0x02), da2->cram[(da2->ma + 2) & DA2_MASK_CRAM], &chr_wide, &chr_dbcs), fg, bg);
             /* Line 28 (Underscore) Note: Draw this first to display blink + vertical + underline correctly. */
             if (da2->sc == 27 && attr & 0x40 && ~da2->attrc[LV_PAS_STATUS_CNTRL] & 0x80) { /* Underscore only in monochrome mode */
                 for (uint32_t n = 0; n < 13; n++)
@@ -1999,52 +1997,7 @@ da2_render_textm3(da2_t *da2)
             fg = IRGBtoBGRI(fg);
             bg = IRGBtoBGRI(bg);
             /* Draw character */
-            for (uint32_t n = 0; n < 13; n++)
-                p[n] = da2->pallook[da2->egapal[bg]]; /* draw blank */
-            /* BCS or DBCS left half */
-            if (chr_wide == 0) {
-                if (extattr & 0x01)
-                    chr_wide = 1;
-                /* Stay drawing if the char code is DBCS and not at last column. */
-                if (chr_wide) {
-                    /* Get high DBCS code from the next video address */
-                    chr_dbcs = DA2_vram_r(DA2_VM03_BASECHR + da2->ma + 2, da2);
-                    chr_dbcs <<= 8;
-                    chr_dbcs |= chr;
-                    /* Get the font pattern */
-                    uint32_t font = getfont_ps55dbcs(chr_dbcs, da2->sc, da2);
-                    /* Draw 13 dots */
-                    for (uint32_t n = 0; n < 13; n++) {
-                        p[n] = da2->pallook[da2->egapal[(font & 0x80000000) ? fg : bg]];
-                        font <<= 1;
-                    }
-                } else {
-                    /* the char code is SBCS (ANK) */
-                    uint32_t fontbase;
-                    if (extattr & 0x80) /* second map of SBCS font */
-                        fontbase = DA2_GAIJIRAM_SBEX;
-                    else
-                        fontbase = DA2_GAIJIRAM_SBCS;
-                    uint16_t font = da2->mmio.ram[fontbase+ chr * 0x40 + da2->sc * 2]; /* w13xh29 font */
-                    font <<= 8;
-                    font |= da2->mmio.ram[fontbase + chr * 0x40 + da2->sc * 2 + 1]; /* w13xh29 font */
-                    // if(chr!=0x20) da2_log("ma: %x, sc: %x, chr: %x, font: %x    ", da2->ma, da2->sc, chr, font);
-                    for (uint32_t n = 0; n < 13; n++) {
-                        p[n] = da2->pallook[da2->egapal[(font & 0x8000) ? fg : bg]];
-                        font <<= 1;
-                    }
-                }
-            }
-            /* right half of DBCS */
-            else {
-                uint32_t font = getfont_ps55dbcs(chr_dbcs, da2->sc, da2);
-                /* Draw 13 dots */
-                for (uint32_t n = 0; n < 13; n++) {
-                    p[n] = da2->pallook[da2->egapal[(font & 0x8000) ? fg : bg]];
-                    font <<= 1;
-                }
-                chr_wide = 0;
-            }
+            da2_draw_char(da2, p, da2_char_dots(da2, chr, (extattr & 0x01), (extattr & 0x80), DA2_vram_r(DA2_VM03_BASECHR + da2->ma + 2, da2), &chr_wide, &chr_dbcs), fg, bg);
             drawcursor = ((da2->ma == da2->ca) && da2->con && da2->cursoron);
             if (drawcursor && da2->sc >= da2->crtc[LC_CURSOR_ROW_START] && da2->sc <= da2->crtc[LC_CURSOR_ROW_END]) {
                 // int cursorwidth = (da2->crtc[0x1f] & 0x20 ? 26 : 13);
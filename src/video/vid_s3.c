@@ -34,11 +34,14 @@
 #include <86box/rom.h>
 #include <86box/plat.h>
 #include <86box/thread.h>
+#include <86box/spsc.h>
 #include <86box/video.h>
 #include <86box/i2c.h>
 #include <86box/vid_ddc.h>
 #include <86box/vid_svga.h>
 #include <86box/vid_svga_render.h>
+#include <86box/vid_blit.h>
+#include <86box/vid_overlay.h>
 #include "cpu.h"
 
 #define ROM_ORCHID_86C911              "roms/video/s3/BIOS.BIN"
@@ -168,9 +171,9 @@ enum {
 #define FIFO_MASK       (FIFO_SIZE - 1)
 #define FIFO_ENTRY_SIZE (1 << 31)
 
-#define FIFO_ENTRIES    (s3->fifo_write_idx - s3->fifo_read_idx)
-#define FIFO_FULL       ((s3->fifo_write_idx - s3->fifo_read_idx) >= (FIFO_SIZE - 4))
-#define FIFO_EMPTY      (s3->fifo_read_idx == s3->fifo_write_idx)
+#define FIFO_ENTRIES    spsc_entries(&s3->fifo_ring)
+#define FIFO_FULL       (spsc_entries(&s3->fifo_ring) >= (FIFO_SIZE - 4))
+#define FIFO_EMPTY      spsc_empty(&s3->fifo_ring)
 
 #define FIFO_TYPE       0xff000000
 #define FIFO_ADDR       0x00ffffff
@@ -353,7 +356,7 @@ typedef struct s3_t {
     } streams;
 
     fifo_entry_t fifo[FIFO_SIZE];
-    atomic_int   fifo_read_idx, fifo_write_idx;
+    spsc_t       fifo_ring;
 
     uint8_t fifo_thread_run;
 
@@ -466,7 +469,7 @@ dword_remap_l(svga_t *svga, uint32_t in_addr)
 static __inline void
 wake_fifo_thread(s3_t *s3)
 {
-    thread_set_event(s3->wake_fifo_thread); /*Wake up FIFO thread if moving from idle*/
+    spsc_wake(&s3->fifo_ring); /*Wake up FIFO thread if moving from idle*/
 }
 
 static void
@@ -481,19 +484,15 @@ s3_wait_fifo_idle(s3_t *s3)
 static void
 s3_queue(s3_t *s3, uint32_t addr, uint32_t val, uint32_t type)
 {
-    fifo_entry_t *fifo = &s3->fifo[s3->fifo_write_idx & FIFO_MASK];
+    fifo_entry_t *fifo;
 
-    if (FIFO_FULL) {
-        thread_reset_event(s3->fifo_not_full_event);
-        if (FIFO_FULL) {
-            thread_wait_event(s3->fifo_not_full_event, -1); /*Wait for room in ringbuffer*/
-        }
-    }
+    spsc_wait_below(&s3->fifo_ring, FIFO_SIZE - 4);
 
+    fifo            = &s3->fifo[spsc_write_pos(&s3->fifo_ring)];
     fifo->val       = val;
     fifo->addr_type = (addr & FIFO_ADDR) | type;
 
-    s3->fifo_write_idx++;
+    spsc_push(&s3->fifo_ring);
 
     if (FIFO_ENTRIES > 0xe000 || FIFO_ENTRIES < 8)
         wake_fifo_thread(s3);
@@ -2280,229 +2279,70 @@ s3_hwcursor_draw(svga_t *svga, int displine)
             x = ((x) < 0) ? 0 : 0xff; \
     } while (0)
 
-#define DECODE_YCbCr()                      \
-    do {                                    \
-        int c;                              \
-                                            \
-        for (c = 0; c < 2; c++) {           \
-            uint8_t y1, y2;                 \
-            int8_t  Cr, Cb;                 \
-            int     dR, dG, dB;             \
-                                            \
-            y1 = src[0];                    \
-            Cr = src[1] - 0x80;             \
-            y2 = src[2];                    \
-            Cb = src[3] - 0x80;             \
-            src += 4;                       \
-                                            \
-            dR = (359 * Cr) >> 8;           \
-            dG = (88 * Cb + 183 * Cr) >> 8; \
-            dB = (453 * Cb) >> 8;           \
-                                            \
-            r[x_write] = y1 + dR;           \
-            CLAMP(r[x_write]);              \
-            g[x_write] = y1 - dG;           \
-            CLAMP(g[x_write]);              \
-            b[x_write] = y1 + dB;           \
-            CLAMP(b[x_write]);              \
-                                            \
-            r[x_write + 1] = y2 + dR;       \
-            CLAMP(r[x_write + 1]);          \
-            g[x_write + 1] = y2 - dG;       \
-            CLAMP(g[x_write + 1]);          \
-            b[x_write + 1] = y2 + dB;       \
-            CLAMP(b[x_write + 1]);          \
-                                            \
-            x_write = (x_write + 2) & 7;    \
-        }                                   \
-    } while (0)
-
-/*Both YUV formats are untested*/
-#define DECODE_YUV211()                  \
-    do {                                 \
-        uint8_t y1, y2, y3, y4;          \
-        int8_t  U, V;                    \
-        int     dR, dG, dB;              \
-                                         \
-        U  = src[0] - 0x80;              \
-        y1 = (298 * (src[1] - 16)) >> 8; \
-        y2 = (298 * (src[2] - 16)) >> 8; \
-        V  = src[3] - 0x80;              \
-        y3 = (298 * (src[4] - 16)) >> 8; \
-        y4 = (298 * (src[5] - 16)) >> 8; \
-        src += 6;                        \
-                                         \
-        dR = (309 * V) >> 8;             \
-        dG = (100 * U + 208 * V) >> 8;   \
-        dB = (516 * U) >> 8;             \
-                                         \
-        r[x_write] = y1 + dR;            \
-        CLAMP(r[x_write]);               \
-        g[x_write] = y1 - dG;            \
-        CLAMP(g[x_write]);               \
-        b[x_write] = y1 + dB;            \
-        CLAMP(b[x_write]);               \
-                                         \
-        r[x_write + 1] = y2 + dR;        \
-        CLAMP(r[x_write + 1]);           \
-        g[x_write + 1] = y2 - dG;        \
-        CLAMP(g[x_write + 1]);           \
-        b[x_write + 1] = y2 + dB;        \
-        CLAMP(b[x_write + 1]);           \
-                                         \
-        r[x_write + 2] = y3 + dR;        \
-        CLAMP(r[x_write + 2]);           \
-        g[x_write + 2] = y3 - dG;        \
-        CLAMP(g[x_write + 2]);           \
-        b[x_write + 2] = y3 + dB;        \
-        CLAMP(b[x_write + 2]);           \
-                                         \
-        r[x_write + 3] = y4 + dR;        \
-        CLAMP(r[x_write + 3]);           \
-        g[x_write + 3] = y4 - dG;        \
-        CLAMP(g[x_write + 3]);           \
-        b[x_write + 3] = y4 + dB;        \
-        CLAMP(b[x_write + 3]);           \
-                                         \
-        x_write = (x_write + 4) & 7;     \
-    } while (0)
-
-#define DECODE_YUV422()                      \
-    do {                                     \
-        int c;                               \
-                                             \
-        for (c = 0; c < 2; c++) {            \
-            uint8_t y1, y2;                  \
-            int8_t  U, V;                    \
-            int     dR, dG, dB;              \
-                                             \
-            U  = src[0] - 0x80;              \
-            y1 = (298 * (src[1] - 16)) >> 8; \
-            V  = src[2] - 0x80;              \
-            y2 = (298 * (src[3] - 16)) >> 8; \
-            src += 4;                        \
-                                             \
-            dR = (309 * V) >> 8;             \
-            dG = (100 * U + 208 * V) >> 8;   \
-            dB = (516 * U) >> 8;             \
-                                             \
-            r[x_write] = y1 + dR;            \
-            CLAMP(r[x_write]);               \
-            g[x_write] = y1 - dG;            \
-            CLAMP(g[x_write]);               \
-            b[x_write] = y1 + dB;            \
-            CLAMP(b[x_write]);               \
-                                             \
-            r[x_write + 1] = y2 + dR;        \
-            CLAMP(r[x_write + 1]);           \
-            g[x_write + 1] = y2 - dG;        \
-            CLAMP(g[x_write + 1]);           \
-            b[x_write + 1] = y2 + dB;        \
-            CLAMP(b[x_write + 1]);           \
-                                             \
-            x_write = (x_write + 2) & 7;     \
-        }                                    \
-    } while (0)
-
-#define DECODE_RGB555()                                                      \
-    do {                                                                     \
-        int c;                                                               \
-                                                                             \
-        for (c = 0; c < 4; c++) {                                            \
-            uint16_t dat;                                                    \
-                                                                             \
-            dat = *(uint16_t *) src;                                         \
-            src += 2;                                                        \
-                                                                             \
-            r[x_write + c] = ((dat & 0x001f) << 3) | ((dat & 0x001f) >> 2);  \
-            g[x_write + c] = ((dat & 0x03e0) >> 2) | ((dat & 0x03e0) >> 7);  \
-            b[x_write + c] = ((dat & 0x7c00) >> 7) | ((dat & 0x7c00) >> 12); \
-        }                                                                    \
-        x_write = (x_write + 4) & 7;                                         \
-    } while (0)
+/*Largest number of source pixels the streams processor can read for one
+  line, sec_w and pri_w are 11 bits*/
+#define S3_OVERLAY_LINE_MAX 2048
 
-#define DECODE_RGB565()                                                      \
-    do {                                                                     \
-        int c;                                                               \
-                                                                             \
-        for (c = 0; c < 4; c++) {                                            \
-            uint16_t dat;                                                    \
-                                                                             \
-            dat = *(uint16_t *) src;                                         \
-            src += 2;                                                        \
-                                                                             \
-            r[x_write + c] = ((dat & 0x001f) << 3) | ((dat & 0x001f) >> 2);  \
-            g[x_write + c] = ((dat & 0x07e0) >> 3) | ((dat & 0x07e0) >> 9);  \
-            b[x_write + c] = ((dat & 0xf800) >> 8) | ((dat & 0xf800) >> 13); \
-        }                                                                    \
-        x_write = (x_write + 4) & 7;                                         \
-    } while (0)
+/*Decodes groups of 4 source pixels, the unit the streams processor fetches
+  them in. Both YUV formats are untested*/
+static void
+s3_overlay_decode(const s3_t *s3, uint32_t *line, const uint8_t *src, int groups)
+{
+    int x;
 
-#define DECODE_RGB888()              \
-    do {                             \
-        int c;                       \
-                                     \
-        for (c = 0; c < 4; c++) {    \
-            r[x_write + c] = src[0]; \
-            g[x_write + c] = src[1]; \
-            b[x_write + c] = src[2]; \
-            src += 3;                \
-        }                            \
-        x_write = (x_write + 4) & 7; \
-    } while (0)
+    switch (s3->streams.sdif) {
+        case 1: /*YCbCr*/
+            video_overlay_yuv422(line, src, groups * 2, OVERLAY_YUV_V_FIRST | OVERLAY_YUV_BGR);
+            break;
+        case 2: /*YUV422*/
+            video_overlay_yuv422(line, src, groups * 2, OVERLAY_YUV_Y_ODD | OVERLAY_YUV_STUDIO | OVERLAY_YUV_BGR);
+            break;
+        case 3: /*RGB555*/
+            for (x = 0; x < groups * 4; x++) {
+                uint16_t dat = ((const uint16_t *) src)[x];
+                int      r   = ((dat & 0x001f) << 3) | ((dat & 0x001f) >> 2);
+                int      g   = ((dat & 0x03e0) >> 2) | ((dat & 0x03e0) >> 7);
+                int      b   = ((dat & 0x7c00) >> 7) | ((dat & 0x7c00) >> 12);
 
-#define DECODE_XRGB8888()            \
-    do {                             \
-        int c;                       \
-                                     \
-        for (c = 0; c < 4; c++) {    \
-            r[x_write + c] = src[0]; \
-            g[x_write + c] = src[1]; \
-            b[x_write + c] = src[2]; \
-            src += 4;                \
-        }                            \
-        x_write = (x_write + 4) & 7; \
-    } while (0)
+                line[x] = r | (g << 8) | (b << 16);
+            }
+            break;
+        case 4: /*YUV211*/
+            video_overlay_yuv211(line, src, groups, OVERLAY_YUV_STUDIO | OVERLAY_YUV_BGR);
+            break;
+        case 5: /*RGB565*/
+            for (x = 0; x < groups * 4; x++) {
+                uint16_t dat = ((const uint16_t *) src)[x];
+                int      r   = ((dat & 0x001f) << 3) | ((dat & 0x001f) >> 2);
+                int      g   = ((dat & 0x07e0) >> 3) | ((dat & 0x07e0) >> 9);
+                int      b   = ((dat & 0xf800) >> 8) | ((dat & 0xf800) >> 13);
 
-#define OVERLAY_SAMPLE()            \
-    do {                            \
-        switch (s3->streams.sdif) { \
-            case 1:                 \
-                DECODE_YCbCr();     \
-                break;              \
-            case 2:                 \
-                DECODE_YUV422();    \
-                break;              \
-            case 3:                 \
-                DECODE_RGB555();    \
-                break;              \
-            case 4:                 \
-                DECODE_YUV211();    \
-                break;              \
-            case 5:                 \
-                DECODE_RGB565();    \
-                break;              \
-            case 6:                 \
-                DECODE_RGB888();    \
-                break;              \
-            case 7:                 \
-            default:                \
-                DECODE_XRGB8888();  \
-                break;              \
-        }                           \
-    } while (0)
+                line[x] = r | (g << 8) | (b << 16);
+            }
+            break;
+        case 6: /*RGB888*/
+            for (x = 0; x < groups * 4; x++, src += 3)
+                line[x] = src[0] | (src[1] << 8) | (src[2] << 16);
+            break;
+        case 7: /*XRGB8888*/
+        default:
+            for (x = 0; x < groups * 4; x++, src += 4)
+                line[x] = src[0] | (src[1] << 8) | (src[2] << 16);
+            break;
+    }
+}
 
 static void
 s3_trio64v_overlay_draw(svga_t *svga, int displine)
 {
     const s3_t *s3     = (s3_t *) svga->priv;
     int         offset = (s3->streams.sec_x - s3->streams.pri_x) + 1;
-    int         r[8];
-    int         g[8];
-    int         b[8];
+    uint32_t    line[S3_OVERLAY_LINE_MAX + 4];
     int         x_size;
-    int         x_read = 4;
-    int         x_write = 4;
+    int         x_read = 0;
+    int         h_acc  = svga->overlay_latch.h_acc;
+    int         steps  = 0;
+    int         groups;
     uint32_t   *p;
     uint8_t    *src = &svga->vram[svga->overlay_latch.addr];
 
@@ -2513,17 +2353,29 @@ s3_trio64v_overlay_draw(svga_t *svga, int displine)
     else
         x_size = s3->streams.sec_w + 1;
 
-    OVERLAY_SAMPLE();
+    /*The hardware fetches the next group of 4 pixels as the scaler steps
+      into it. Count the steps first, so that exactly the same groups are
+      decoded in one go*/
+    for (int x = 0; x < x_size; x++) {
+        h_acc += s3->streams.k1_horiz_scale;
+        if (h_acc >= 0) {
+            steps++;
+            h_acc += (s3->streams.k2_horiz_scale - s3->streams.k1_horiz_scale);
+        }
+    }
+    groups = 1 + (steps >> 2);
+    if (groups > (S3_OVERLAY_LINE_MAX / 4))
+        groups = S3_OVERLAY_LINE_MAX / 4;
+
+    s3_overlay_decode(s3, line, src, groups);
 
     for (int x = 0; x < x_size; x++) {
-        *p++ = r[x_read] | (g[x_read] << 8) | (b[x_read] << 16);
+        *p++ = line[x_read];
 
         svga->overlay_latch.h_acc += s3->streams.k1_horiz_scale;
         if (svga->overlay_latch.h_acc >= 0) {
-            if ((x_read ^ (x_read + 1)) & ~3)
-                OVERLAY_SAMPLE();
-
-            x_read = (x_read + 1) & 7;
+            if (x_read < (groups * 4) - 1)
+                x_read++;
 
             svga->overlay_latch.h_acc += (s3->streams.k2_horiz_scale - s3->streams.k1_horiz_scale);
         }
@@ -7442,6 +7294,196 @@ polygon_setup(s3_t *s3)
         svga->changedvram[(dword_remap_l(svga, addr) & (s3->vram_mask >> 2)) >> 10] = svga->monitor->mon_changeframecount; \
     }
 
+/*Fast paths for plain screen to screen copies, solid fills and monochrome
+  glyph expansion. They are only used when video memory is linearly mapped
+  and the operation can not wrap around, and give the same result as the
+  generic pixel loops below.*/
+static __inline int
+s3_accel_pixel_bytes(s3_t *s3)
+{
+    if (((s3->bpp == 0) && !s3->color_16bit) || (s3->bpp == 2))
+        return 1;
+    else if ((s3->bpp == 1) || s3->color_16bit)
+        return 2;
+
+    return 4;
+}
+
+static __inline int
+s3_accel_fast_ok(s3_t *s3, uint32_t wrt_mask)
+{
+    uint32_t pixel_mask = 0xffffffff >> (32 - (s3_accel_pixel_bytes(s3) << 3));
+
+    if (!s3->svga.packed_chain4 && !s3->svga.force_old_addr)
+        return 0;
+
+    return ((wrt_mask & pixel_mask) == pixel_mask) && (s3->accel.cmd & 0x10);
+}
+
+/*Returns non-zero if the pixels [start, end] of every row between the two given
+  row bases lie within video memory*/
+static int
+s3_accel_range_ok(s3_t *s3, int64_t row_first, int64_t row_last, int64_t start, int64_t end)
+{
+    int64_t pixel_bytes = s3_accel_pixel_bytes(s3);
+    int64_t lo          = ((row_first < row_last) ? row_first : row_last) + start;
+    int64_t hi          = ((row_first < row_last) ? row_last : row_first) + end;
+
+    return (lo >= 0) && (((hi + 1) * pixel_bytes) <= ((int64_t) s3->vram_mask + 1));
+}
+
+/*SRCCOPY screen to screen BitBLT in any direction. Returns zero if the generic
+  path has to be used instead*/
+static int
+s3_accel_fast_bitblt(s3_t *s3, uint32_t srcbase, uint32_t dstbase, int clip_t, int clip_l, int clip_b, int clip_r)
+{
+    svga_t *svga        = &s3->svga;
+    int     pixel_bytes = s3_accel_pixel_bytes(s3);
+    int     w           = (s3->accel.maj_axis_pcnt & 0xfff) + 1;
+    int     h           = s3->accel.sy + 1;
+    int     xdir        = (s3->accel.cmd & 0x20) ? 1 : -1;
+    int     ydir        = (s3->accel.cmd & 0x80) ? 1 : -1;
+    int     xl          = (xdir > 0) ? s3->accel.dx : (s3->accel.dx - (w - 1));
+    int     xr          = xl + w - 1;
+    int     src_x       = s3->accel.cx - s3->accel.dx - s3->accel.minus;
+    int     cy          = s3->accel.cy;
+    int     dy          = s3->accel.dy;
+
+    if ((xl < 0) || (xr > 0xfff))
+        return 0;
+    if (!s3_accel_range_ok(s3, (int64_t) srcbase + (int64_t) cy * s3->width,
+                           (int64_t) srcbase + (int64_t) (cy + (h - 1) * ydir) * s3->width, xl + src_x, xr + src_x))
+        return 0;
+    if (!s3_accel_range_ok(s3, (int64_t) dstbase + (int64_t) dy * s3->width,
+                           (int64_t) dstbase + (int64_t) (dy + (h - 1) * ydir) * s3->width, xl - s3->accel.minus, xr - s3->accel.minus))
+        return 0;
+
+    for (int row = 0; row < h; row++) {
+        int l = (xl > clip_l) ? xl : clip_l;
+        int r = (xr < clip_r) ? xr : clip_r;
+
+        if ((dy >= clip_t) && (dy <= clip_b) && (l <= r)) {
+            uint32_t src  = (srcbase + cy * s3->width + l + src_x) * pixel_bytes;
+            uint32_t dest = (dstbase + dy * s3->width + l - s3->accel.minus) * pixel_bytes;
+            uint32_t len  = (r - l + 1) * pixel_bytes;
+
+            video_blit_copy(svga->vram, dest, src, len, pixel_bytes, xdir);
+            video_blit_mark_changed(svga->changedvram, dest, len, svga->monitor->mon_changeframecount);
+        }
+
+        cy += ydir;
+        dy += ydir;
+    }
+
+    s3->accel.cy          = cy;
+    s3->accel.dy          = dy;
+    s3->accel.sx          = s3->accel.maj_axis_pcnt & 0xfff;
+    s3->accel.sy          = -1;
+    s3->accel.src         = srcbase + s3->accel.cy * s3->width;
+    s3->accel.dest        = dstbase + s3->accel.dy * s3->width;
+    s3->accel.destx_distp = s3->accel.dx;
+    s3->accel.desty_axstp = s3->accel.dy;
+
+    return 1;
+}
+
+/*Solid rectangle fill. Returns zero if the generic path has to be used instead*/
+static int
+s3_accel_fast_rectfill(s3_t *s3, uint32_t color, uint32_t dstbase, int clip_t, int clip_l, int clip_b, int clip_r)
+{
+    svga_t  *svga        = &s3->svga;
+    int      pixel_bytes = s3_accel_pixel_bytes(s3);
+    int      w           = (s3->accel.maj_axis_pcnt & 0xfff) + 1;
+    int      h           = s3->accel.sy + 1;
+    int      xdir        = (s3->accel.cmd & 0x20) ? 1 : -1;
+    int      ydir        = (s3->accel.cmd & 0x80) ? 1 : -1;
+    int      xl          = (xdir > 0) ? s3->accel.cx : (s3->accel.cx - (w - 1));
+    int      xr          = xl + w - 1;
+    int      cy          = s3->accel.cy;
+    int      cy_last     = cy + (h - 1) * ydir;
+
+    if ((xl < 0) || (xr > 0xfff) || (cy_last < 0) || (cy_last > 0xfff))
+        return 0;
+    if (!s3_accel_range_ok(s3, (int64_t) dstbase + (int64_t) cy * s3->width,
+                           (int64_t) dstbase + (int64_t) cy_last * s3->width, xl - s3->accel.minus, xr - s3->accel.minus))
+        return 0;
+
+    for (int row = 0; row < h; row++) {
+        int l = (xl > clip_l) ? xl : clip_l;
+        int r = (xr < clip_r) ? xr : clip_r;
+
+        if ((cy >= clip_t) && (cy <= clip_b) && (l <= r)) {
+            uint32_t dest = (dstbase + cy * s3->width + l - s3->accel.minus) * pixel_bytes;
+            uint32_t len  = (r - l + 1) * pixel_bytes;
+
+            video_blit_fill(&svga->vram[dest], color, pixel_bytes, len);
+            video_blit_mark_changed(svga->changedvram, dest, len, svga->monitor->mon_changeframecount);
+        }
+
+        cy += ydir;
+    }
+
+    s3->accel.cy    = cy & 0xfff;
+    s3->accel.sx    = s3->accel.maj_axis_pcnt & 0xfff;
+    s3->accel.sy    = -1;
+    s3->accel.dest  = dstbase + s3->accel.cy * s3->width;
+    s3->accel.cur_x = s3->accel.cx;
+    s3->accel.cur_y = s3->accel.cy;
+
+    return 1;
+}
+
+/*Rectangle fill with monochrome pixel data from the CPU, as used for text. Set
+  bits are drawn in the foreground colour, clear bits in the background colour
+  or not at all if transparent*/
+static void
+s3_accel_mono_expand(s3_t *s3, int count, uint32_t mix_dat, uint32_t mix_mask, uint32_t frgd_color, uint32_t bkgd_color,
+                     int transparent, uint32_t dstbase, int clip_t, int clip_l, int clip_b, int clip_r)
+{
+    svga_t   *svga   = &s3->svga;
+    uint16_t *vram_w = (uint16_t *) svga->vram;
+    uint32_t *vram_l = (uint32_t *) svga->vram;
+
+    while (count-- && (s3->accel.sy >= 0)) {
+        if ((s3->accel.cx >= clip_l) && (s3->accel.cx <= clip_r) && (s3->accel.cy >= clip_t) && (s3->accel.cy <= clip_b)) {
+            if (mix_dat & mix_mask) {
+                WRITE(s3->accel.dest + s3->accel.cx - s3->accel.minus, frgd_color);
+            } else if (!transparent) {
+                WRITE(s3->accel.dest + s3->accel.cx - s3->accel.minus, bkgd_color);
+            }
+        }
+
+        mix_dat <<= 1;
+        mix_dat |= 1;
+
+        if (s3->accel.cmd & 0x20)
+            s3->accel.cx++;
+        else
+            s3->accel.cx--;
+
+        s3->accel.cx &= 0xfff;
+        s3->accel.sx--;
+        if (s3->accel.sx < 0) {
+            s3->accel.sx = s3->accel.maj_axis_pcnt & 0xfff;
+
+            if (s3->accel.cmd & 0x20)
+                s3->accel.cx -= (s3->accel.sx + 1);
+            else
+                s3->accel.cx += (s3->accel.sx + 1);
+
+            if (s3->accel.cmd & 0x80)
+                s3->accel.cy++;
+            else
+                s3->accel.cy--;
+
+            s3->accel.cy &= 0xfff;
+            s3->accel.dest = dstbase + s3->accel.cy * s3->width;
+            s3->accel.sy--;
+            return;
+        }
+    }
+}
+
 static __inline void
 convert_to_rgb32(int idf, int is_yuv, uint32_t val, uint8_t *r, uint8_t *g, uint8_t *b, uint8_t *r2, uint8_t *g2, uint8_t *b2)
 {
@@ -8332,6 +8374,19 @@ s3_accel_start(int count, int cpu_input, uint32_t mix_dat, uint32_t cpu_dat, voi
                 s3->accel.temp_cnt = 16;
             }
 
+            if (!(s3->accel.multifunc[0xe] & 0x120) && s3_accel_fast_ok(s3, wrt_mask) && !((s3->bpp == 0) && s3->color_16bit)) {
+                if (!cpu_input && ((s3->accel.frgd_mix & 0xf) == 7) && (frgd_mix != 2)) {
+                    if (s3_accel_fast_rectfill(s3, (frgd_mix == 0) ? bkgd_color : ((frgd_mix == 1) ? frgd_color : 0), dstbase, clip_t, clip_l, clip_b, clip_r))
+                        return;
+                } else if (cpu_input && s3_cpu_src(s3) && !s3_cpu_dest(s3) && !s3->accel.b2e8_pix && ((s3->accel.multifunc[0xa] & 0xc0) == 0x80) &&
+                           (frgd_mix == 1) && ((s3->accel.frgd_mix & 0xf) == 7) &&
+                           (((s3->accel.bkgd_mix & 0xf) == 3) || ((bkgd_mix == 0) && ((s3->accel.bkgd_mix & 0xf) == 7)))) {
+                    s3_accel_mono_expand(s3, count, mix_dat, mix_mask, frgd_color, bkgd_color, (s3->accel.bkgd_mix & 0xf) == 3,
+                                         dstbase, clip_t, clip_l, clip_b, clip_r);
+                    break;
+                }
+            }
+
             while (count-- && (s3->accel.sy >= 0)) {
                 if (s3->accel.b2e8_pix && s3_cpu_src(s3) && !s3->accel.temp_cnt) {
                     mix_dat >>= 16;
@@ -8583,6 +8638,11 @@ s3_accel_start(int count, int cpu_input, uint32_t mix_dat, uint32_t cpu_dat, voi
             if ((s3->accel.cmd & 0x100) && !cpu_input)
                 return; /*Wait for data from CPU*/
 
+            if (!cpu_input && (frgd_mix == 3) && !vram_mask && !(s3->accel.multifunc[0xe] & 0x100) && ((s3->accel.frgd_mix & 0xf) == 7) &&
+                ((s3->accel.bkgd_mix & 0xf) == 7) && s3_accel_fast_ok(s3, wrt_mask) &&
+                s3_accel_fast_bitblt(s3, srcbase, dstbase, clip_t, clip_l, clip_b, clip_r))
+                return;
+
             if (!cpu_input && (frgd_mix == 3) && !vram_mask && !(s3->accel.multifunc[0xe] & 0x100) && ((s3->accel.cmd & 0xa0) == 0xa0) && ((s3->accel.frgd_mix & 0xf) == 7) && ((s3->accel.bkgd_mix & 0xf) == 7)) {
                 while (1) {
                     if ((s3->accel.dx >= clip_l) && (s3->accel.dx <= clip_r) && (s3->accel.dy >= clip_t) && (s3->accel.dy <= clip_b)) {
@@ -9444,12 +9504,11 @@ fifo_thread(void *param)
 
     while (s3->fifo_thread_run) {
         thread_set_event(s3->fifo_not_full_event);
-        thread_wait_event(s3->wake_fifo_thread, -1);
-        thread_reset_event(s3->wake_fifo_thread);
+        spsc_park(&s3->fifo_ring);
         s3->blitter_busy = 1;
         while (!FIFO_EMPTY) {
             start_time         = plat_timer_read();
-            fifo_entry_t *fifo = &s3->fifo[s3->fifo_read_idx & FIFO_MASK];
+            fifo_entry_t *fifo = &s3->fifo[spsc_read_pos(&s3->fifo_ring)];
 
             switch (fifo->addr_type & FIFO_TYPE) {
                 case FIFO_WRITE_BYTE:
@@ -9475,11 +9534,8 @@ fifo_thread(void *param)
                     break;
             }
 
-            s3->fifo_read_idx++;
             fifo->addr_type = FIFO_INVALID;
-
-            if (FIFO_ENTRIES > 0xe000)
-                thread_set_event(s3->fifo_not_full_event);
+            spsc_pop(&s3->fifo_ring);
 
             end_time = plat_timer_read();
             s3->blitter_time += (end_time - start_time);
@@ -9539,8 +9595,7 @@ s3_reset(void *priv)
         s3_disable_handlers(s3);
         s3->force_busy = 0;
         s3->blitter_busy = 0;
-        s3->fifo_read_idx = 0;
-        s3->fifo_write_idx = 0;
+        spsc_clear(&s3->fifo_ring);
         if (s3->pci)
             reset_state->pci_slot = s3->pci_slot;
 
@@ -10287,8 +10342,9 @@ s3_init(const device_t *info)
 
     s3->wake_fifo_thread    = thread_create_event();
     s3->fifo_not_full_event = thread_create_event();
+    spsc_init(&s3->fifo_ring, FIFO_SIZE, SPSC_SPIN, s3->wake_fifo_thread, s3->fifo_not_full_event);
     s3->fifo_thread_run     = 1;
-    s3->fifo_thread         = thread_create(fifo_thread, s3);
+    s3->fifo_thread         = thread_create_role(fifo_thread, s3, THREAD_ROLE_VIDEO);
 
     *reset_state = *s3;
 
@@ -34,6 +34,7 @@
 #include <86box/device.h>
 #include <86box/plat.h>
 #include <86box/thread.h>
+#include <86box/spsc.h>
 #include <86box/video.h>
 #include <86box/i2c.h>
 #include <86box/vid_ddc.h>
@@ -74,17 +75,22 @@ static int dither[4][4] = {
 #define RB_SIZE 256
 #define RB_MASK (RB_SIZE - 1)
 
-#define RB_ENTRIES (virge->s3d_write_idx - virge->s3d_read_idx)
+#define RB_ENTRIES (virge->s3d_write_idx - s3_virge_render_read_idx(virge))
 #define RB_FULL (RB_ENTRIES == RB_SIZE)
 #define RB_EMPTY (!RB_ENTRIES)
 
+#define VIRGE_MAX_RENDER_THREADS 4
+/*Each render thread draws the scanlines of every (1 << VIRGE_RENDER_BAND_SHIFT) line
+  band whose index matches its own, modulo the number of threads*/
+#define VIRGE_RENDER_BAND_SHIFT  3
+
 #define FIFO_SIZE 65536
 #define FIFO_MASK (FIFO_SIZE - 1)
 #define FIFO_ENTRY_SIZE (1 << 31)
 
-#define FIFO_ENTRIES (virge->fifo_write_idx - virge->fifo_read_idx)
-#define FIFO_FULL ((virge->fifo_write_idx - virge->fifo_read_idx) >= FIFO_SIZE)
-#define FIFO_EMPTY (virge->fifo_read_idx == virge->fifo_write_idx)
+#define FIFO_ENTRIES spsc_entries(&virge->fifo_ring)
+#define FIFO_FULL (spsc_entries(&virge->fifo_ring) >= FIFO_SIZE)
+#define FIFO_EMPTY spsc_empty(&virge->fifo_ring)
 
 #define FIFO_TYPE 0xff000000
 #define FIFO_ADDR 0x00ffffff
@@ -188,6 +194,20 @@ typedef struct s3d_t {
     uint8_t fog_b;
 } s3d_t;
 
+typedef struct virge_render_t {
+    struct virge_t *virge;
+    int             index;
+
+    thread_t *thread;
+    event_t  *wake_event;
+
+    atomic_int read_idx;
+    atomic_int busy;
+
+    int pixel_count;
+    int tri_count;
+} virge_render_t;
+
 typedef struct virge_t {
     mem_mapping_t linear_mapping;
     mem_mapping_t mmio_mapping;
@@ -217,11 +237,9 @@ typedef struct virge_t {
     int dithering_enabled;
     int memory_size;
 
-    int pixel_count;
-    int tri_count;
+    int            render_threads;
+    virge_render_t render[VIRGE_MAX_RENDER_THREADS];
 
-    thread_t *render_thread;
-    event_t  *wake_render_thread;
     event_t  *wake_main_thread;
     event_t  *not_full_event;
 
@@ -289,7 +307,6 @@ typedef struct virge_t {
     s3d_t s3d_tri;
 
     s3d_t      s3d_buffer[RB_SIZE];
-    atomic_int s3d_read_idx;
     atomic_int s3d_write_idx;
     atomic_int s3d_busy;
 
@@ -331,7 +348,7 @@ typedef struct virge_t {
     } streams;
 
     fifo_entry_t fifo[FIFO_SIZE];
-    atomic_int   fifo_read_idx, fifo_write_idx;
+    spsc_t       fifo_ring;
     atomic_int   fifo_thread_run, render_thread_run;
 
     thread_t *fifo_thread;
@@ -385,7 +402,7 @@ static __inline void
 wake_fifo_thread(virge_t *virge)
 {
     /* Wake up FIFO thread if moving from idle */
-    thread_set_event(virge->wake_fifo_thread);
+    spsc_wake(&virge->fifo_ring);
 }
 
 static virge_t *reset_state = NULL;
@@ -1768,13 +1785,12 @@ fifo_thread(void *param)
 
     while (virge->fifo_thread_run) {
         thread_set_event(virge->fifo_not_full_event);
-        thread_wait_event(virge->wake_fifo_thread, -1);
-        thread_reset_event(virge->wake_fifo_thread);
+        spsc_park(&virge->fifo_ring);
         virge->virge_busy = 1;
         while (!FIFO_EMPTY) {
             uint64_t      start_time = plat_timer_read();
             uint64_t      end_time;
-            fifo_entry_t *fifo = &virge->fifo[virge->fifo_read_idx & FIFO_MASK];
+            fifo_entry_t *fifo = &virge->fifo[spsc_read_pos(&virge->fifo_ring)];
             uint32_t      val  = fifo->val;
 
             switch (fifo->addr_type & FIFO_TYPE) {
@@ -1803,11 +1819,8 @@ fifo_thread(void *param)
                     break;
             }
 
-            virge->fifo_read_idx++;
             fifo->addr_type = FIFO_INVALID;
-
-            if (FIFO_ENTRIES > 0xe000)
-                thread_set_event(virge->fifo_not_full_event);
+            spsc_pop(&virge->fifo_ring);
 
             end_time = plat_timer_read();
             virge_time += end_time - start_time;
@@ -1824,7 +1837,7 @@ fifo_thread(void *param)
 static void
 s3_virge_queue(virge_t *virge, uint32_t addr, uint32_t val, uint32_t type)
 {
-    fifo_entry_t *fifo  = &virge->fifo[virge->fifo_write_idx & FIFO_MASK];
+    fifo_entry_t *fifo;
     int           limit = 0;
 
     if (type == FIFO_WRITE_DWORD) {
@@ -1838,24 +1851,13 @@ s3_virge_queue(virge_t *virge, uint32_t addr, uint32_t val, uint32_t type)
         }
     }
 
-    if (limit) {
-        if (FIFO_ENTRIES >= 16) {
-            thread_reset_event(virge->fifo_not_full_event);
-            if (FIFO_ENTRIES >= 16)
-                thread_wait_event(virge->fifo_not_full_event, -1); /*Wait for room in ringbuffer*/
-        }
-    } else {
-        if (FIFO_FULL) {
-            thread_reset_event(virge->fifo_not_full_event);
-            if (FIFO_FULL)
-                thread_wait_event(virge->fifo_not_full_event, -1); /*Wait for room in ringbuffer*/
-        }
-    }
+    spsc_wait_below(&virge->fifo_ring, limit ? 16 : FIFO_SIZE);
 
+    fifo            = &virge->fifo[spsc_write_pos(&virge->fifo_ring)];
     fifo->val       = val;
     fifo->addr_type = (addr & FIFO_ADDR) | type;
 
-    virge->fifo_write_idx++;
+    spsc_push(&virge->fifo_ring);
 
     if (FIFO_ENTRIES > 0xe000)
         wake_fifo_thread(virge);
@@ -3365,18 +3367,18 @@ skip_line:
         g = (val & 0xff00) >> 8;   \
         r = (val & 0xff0000) >> 16
 
-#define RGB15(r, g, b, dest)                        \
-        if (virge->dithering_enabled) {             \
-                int add = dither[_y & 3][_x & 3];   \
-                int _r = (r > 248) ? 248 : r + add; \
-                int _g = (g > 248) ? 248 : g + add; \
-                int _b = (b > 248) ? 248 : b + add; \
-                dest = ((_b >> 3) & 0x1f) |         \
-                       (((_g >> 3) & 0x1f) << 5) |  \
-                       (((_r >> 3) & 0x1f) << 10);  \
-        } else                                      \
-                dest = ((b >> 3) & 0x1f) |          \
-                       (((g >> 3) & 0x1f) << 5) |   \
+#define RGB15(r, g, b, dest)                           \
+        if (virge->dithering_enabled) {                \
+                int add = dither[state->y & 3][x & 3]; \
+                int _r = (r > 248) ? 248 : r + add;    \
+                int _g = (g > 248) ? 248 : g + add;    \
+                int _b = (b > 248) ? 248 : b + add;    \
+                dest = ((_b >> 3) & 0x1f) |            \
+                       (((_g >> 3) & 0x1f) << 5) |     \
+                       (((_r >> 3) & 0x1f) << 10);     \
+        } else                                         \
+                dest = ((b >> 3) & 0x1f) |             \
+                       (((g >> 3) & 0x1f) << 5) |      \
                        (((r >> 3) & 0x1f) << 10)
 
 #define RGB24(r, g, b) ((b) | ((g) << 8) | ((r) << 16))
@@ -3388,6 +3390,8 @@ typedef struct rgba_t {
     int a;
 } rgba_t;
 
+struct s3d_texture_state_t;
+
 typedef struct s3d_state_t {
     int32_t r;
     int32_t g;
@@ -3424,7 +3428,17 @@ typedef struct s3d_state_t {
 
     int y;
 
+    /*Scanline band owned by the render thread drawing this triangle*/
+    int band_index;
+    int band_mask;
+
+    int pixel_count;
+
     rgba_t dest_rgba;
+
+    void (*tex_read)(struct s3d_state_t *state, struct s3d_texture_state_t *texture_state, rgba_t *out);
+    void (*tex_sample)(struct s3d_state_t *state);
+    void (*dest_pixel)(struct s3d_state_t *state);
 } s3d_state_t;
 
 typedef struct s3d_texture_state_t {
@@ -3435,16 +3449,9 @@ typedef struct s3d_texture_state_t {
     int32_t v;
 } s3d_texture_state_t;
 
-static void (*tex_read)(s3d_state_t *state, s3d_texture_state_t *texture_state, rgba_t *out);
-static void (*tex_sample)(s3d_state_t *state);
-static void (*dest_pixel)(s3d_state_t *state);
-
 #define MAX(a, b) ((a) > (b) ? (a) : (b))
 #define MIN(a, b) ((a) < (b) ? (a) : (b))
 
-static int _x;
-static int _y;
-
 static void
 tex_ARGB1555(s3d_state_t *state, s3d_texture_state_t *texture_state, rgba_t *out)
 {
@@ -3542,7 +3549,7 @@ tex_sample_normal(s3d_state_t *state)
     texture_state.u             = state->u + state->tbu;
     texture_state.v             = state->v + state->tbv;
 
-    tex_read(state, &texture_state, &state->dest_rgba);
+    state->tex_read(state, &texture_state, &state->dest_rgba);
 }
 
 static void
@@ -3561,21 +3568,21 @@ tex_sample_normal_filter(s3d_state_t *state)
 
     texture_state.u = state->u + state->tbu;
     texture_state.v = state->v + state->tbv;
-    tex_read(state, &texture_state, &tex_samples[0]);
+    state->tex_read(state, &texture_state, &tex_samples[0]);
     du = (texture_state.u >> (texture_state.texture_shift - 8)) & 0xff;
     dv = (texture_state.v >> (texture_state.texture_shift - 8)) & 0xff;
 
     texture_state.u = state->u + state->tbu + tex_offset;
     texture_state.v = state->v + state->tbv;
-    tex_read(state, &texture_state, &tex_samples[1]);
+    state->tex_read(state, &texture_state, &tex_samples[1]);
 
     texture_state.u = state->u + state->tbu;
     texture_state.v = state->v + state->tbv + tex_offset;
-    tex_read(state, &texture_state, &tex_samples[2]);
+    state->tex_read(state, &texture_state, &tex_samples[2]);
 
     texture_state.u = state->u + state->tbu + tex_offset;
     texture_state.v = state->v + state->tbv + tex_offset;
-    tex_read(state, &texture_state, &tex_samples[3]);
+    state->tex_read(state, &texture_state, &tex_samples[3]);
 
     d[0] = (256 - du) * (256 - dv);
     d[1] = du * (256 - dv);
@@ -3604,7 +3611,7 @@ tex_sample_mipmap(s3d_state_t *state)
     texture_state.u             = state->u + state->tbu;
     texture_state.v             = state->v + state->tbv;
 
-    tex_read(state, &texture_state, &state->dest_rgba);
+    state->tex_read(state, &texture_state, &state->dest_rgba);
 }
 
 static void
@@ -3625,21 +3632,21 @@ tex_sample_mipmap_filter(s3d_state_t *state)
 
     texture_state.u = state->u + state->tbu;
     texture_state.v = state->v + state->tbv;
-    tex_read(state, &texture_state, &tex_samples[0]);
+    state->tex_read(state, &texture_state, &tex_samples[0]);
     du = (texture_state.u >> (texture_state.texture_shift - 8)) & 0xff;
     dv = (texture_state.v >> (texture_state.texture_shift - 8)) & 0xff;
 
     texture_state.u = state->u + state->tbu + tex_offset;
     texture_state.v = state->v + state->tbv;
-    tex_read(state, &texture_state, &tex_samples[1]);
+    state->tex_read(state, &texture_state, &tex_samples[1]);
 
     texture_state.u = state->u + state->tbu;
     texture_state.v = state->v + state->tbv + tex_offset;
-    tex_read(state, &texture_state, &tex_samples[2]);
+    state->tex_read(state, &texture_state, &tex_samples[2]);
 
     texture_state.u = state->u + state->tbu + tex_offset;
     texture_state.v = state->v + state->tbv + tex_offset;
-    tex_read(state, &texture_state, &tex_samples[3]);
+    state->tex_read(state, &texture_state, &tex_samples[3]);
 
     d[0] = (256 - du) * (256 - dv);
     d[1] = du * (256 - dv);
@@ -3670,7 +3677,7 @@ tex_sample_persp_normal(s3d_state_t *state)
     texture_state.u             = (int32_t) (((int64_t) state->u * (int64_t) w) >> (12 + state->max_d)) + state->tbu;
     texture_state.v             = (int32_t) (((int64_t) state->v * (int64_t) w) >> (12 + state->max_d)) + state->tbv;
 
-    tex_read(state, &texture_state, &state->dest_rgba);
+    state->tex_read(state, &texture_state, &state->dest_rgba);
 }
 
 static void
@@ -3698,21 +3705,21 @@ tex_sample_persp_normal_filter(s3d_state_t *state)
 
     texture_state.u = u;
     texture_state.v = v;
-    tex_read(state, &texture_state, &tex_samples[0]);
+    state->tex_read(state, &texture_state, &tex_samples[0]);
     du = (u >> (texture_state.texture_shift - 8)) & 0xff;
     dv = (v >> (texture_state.texture_shift - 8)) & 0xff;
 
     texture_state.u = u + tex_offset;
     texture_state.v = v;
-    tex_read(state, &texture_state, &tex_samples[1]);
+    state->tex_read(state, &texture_state, &tex_samples[1]);
 
     texture_state.u = u;
     texture_state.v = v + tex_offset;
-    tex_read(state, &texture_state, &tex_samples[2]);
+    state->tex_read(state, &texture_state, &tex_samples[2]);
 
     texture_state.u = u + tex_offset;
     texture_state.v = v + tex_offset;
-    tex_read(state, &texture_state, &tex_samples[3]);
+    state->tex_read(state, &texture_state, &tex_samples[3]);
 
     d[0] = (256 - du) * (256 - dv);
     d[1] = du * (256 - dv);
@@ -3743,7 +3750,7 @@ tex_sample_persp_normal_375(s3d_state_t *state)
     texture_state.u             = (int32_t) (((int64_t) state->u * (int64_t) w) >> (8 + state->max_d)) + state->tbu;
     texture_state.v             = (int32_t) (((int64_t) state->v * (int64_t) w) >> (8 + state->max_d)) + state->tbv;
 
-    tex_read(state, &texture_state, &state->dest_rgba);
+    state->tex_read(state, &texture_state, &state->dest_rgba);
 }
 
 static void
@@ -3771,21 +3778,21 @@ tex_sample_persp_normal_filter_375(s3d_state_t *state)
 
     texture_state.u = u;
     texture_state.v = v;
-    tex_read(state, &texture_state, &tex_samples[0]);
+    state->tex_read(state, &texture_state, &tex_samples[0]);
     du = (u >> (texture_state.texture_shift - 8)) & 0xff;
     dv = (v >> (texture_state.texture_shift - 8)) & 0xff;
 
     texture_state.u = u + tex_offset;
     texture_state.v = v;
-    tex_read(state, &texture_state, &tex_samples[1]);
+    state->tex_read(state, &texture_state, &tex_samples[1]);
 
     texture_state.u = u;
     texture_state.v = v + tex_offset;
-    tex_read(state, &texture_state, &tex_samples[2]);
+    state->tex_read(state, &texture_state, &tex_samples[2]);
 
     texture_state.u = u + tex_offset;
     texture_state.v = v + tex_offset;
-    tex_read(state, &texture_state, &tex_samples[3]);
+    state->tex_read(state, &texture_state, &tex_samples[3]);
 
     d[0] = (256 - du) * (256 - dv);
     d[1] = du * (256 - dv);
@@ -3818,7 +3825,7 @@ tex_sample_persp_mipmap(s3d_state_t *state)
     texture_state.u             = (int32_t) (((int64_t) state->u * (int64_t) w) >> (12 + state->max_d)) + state->tbu;
     texture_state.v             = (int32_t) (((int64_t) state->v * (int64_t) w) >> (12 + state->max_d)) + state->tbv;
 
-    tex_read(state, &texture_state, &state->dest_rgba);
+    state->tex_read(state, &texture_state, &state->dest_rgba);
 }
 
 static void
@@ -3848,21 +3855,21 @@ tex_sample_persp_mipmap_filter(s3d_state_t *state)
 
     texture_state.u = u;
     texture_state.v = v;
-    tex_read(state, &texture_state, &tex_samples[0]);
+    state->tex_read(state, &texture_state, &tex_samples[0]);
     du = (u >> (texture_state.texture_shift - 8)) & 0xff;
     dv = (v >> (texture_state.texture_shift - 8)) & 0xff;
 
     texture_state.u = u + tex_offset;
     texture_state.v = v;
-    tex_read(state, &texture_state, &tex_samples[1]);
+    state->tex_read(state, &texture_state, &tex_samples[1]);
 
     texture_state.u = u;
     texture_state.v = v + tex_offset;
-    tex_read(state, &texture_state, &tex_samples[2]);
+    state->tex_read(state, &texture_state, &tex_samples[2]);
 
     texture_state.u = u + tex_offset;
     texture_state.v = v + tex_offset;
-    tex_read(state, &texture_state, &tex_samples[3]);
+    state->tex_read(state, &texture_state, &tex_samples[3]);
 
     d[0] = (256 - du) * (256 - dv);
     d[1] = du * (256 - dv);
@@ -3895,7 +3902,7 @@ tex_sample_persp_mipmap_375(s3d_state_t *state)
     texture_state.u             = (int32_t) (((int64_t) state->u * (int64_t) w) >> (8 + state->max_d)) + state->tbu;
     texture_state.v             = (int32_t) (((int64_t) state->v * (int64_t) w) >> (8 + state->max_d)) + state->tbv;
 
-    tex_read(state, &texture_state, &state->dest_rgba);
+    state->tex_read(state, &texture_state, &state->dest_rgba);
 }
 
 static void
@@ -3925,21 +3932,21 @@ tex_sample_persp_mipmap_filter_375(s3d_state_t *state)
 
     texture_state.u = u;
     texture_state.v = v;
-    tex_read(state, &texture_state, &tex_samples[0]);
+    state->tex_read(state, &texture_state, &tex_samples[0]);
     du = (u >> (texture_state.texture_shift - 8)) & 0xff;
     dv = (v >> (texture_state.texture_shift - 8)) & 0xff;
 
     texture_state.u = u + tex_offset;
     texture_state.v = v;
-    tex_read(state, &texture_state, &tex_samples[1]);
+    state->tex_read(state, &texture_state, &tex_samples[1]);
 
     texture_state.u = u;
     texture_state.v = v + tex_offset;
-    tex_read(state, &texture_state, &tex_samples[2]);
+    state->tex_read(state, &texture_state, &tex_samples[2]);
 
     texture_state.u = u + tex_offset;
     texture_state.v = v + tex_offset;
-    tex_read(state, &texture_state, &tex_samples[3]);
+    state->tex_read(state, &texture_state, &tex_samples[3]);
 
     d[0] = (256 - du) * (256 - dv);
     d[1] = du * (256 - dv);
@@ -4007,7 +4014,7 @@ dest_pixel_gouraud_shaded_triangle(s3d_state_t *state)
 static void
 dest_pixel_unlit_texture_triangle(s3d_state_t *state)
 {
-    tex_sample(state);
+    state->tex_sample(state);
 
     if (state->cmd_set & CMD_SET_ABC_SRC)
         state->dest_rgba.a = state->a >> 7;
@@ -4016,7 +4023,7 @@ dest_pixel_unlit_texture_triangle(s3d_state_t *state)
 static void
 dest_pixel_lit_texture_decal(s3d_state_t *state)
 {
-    tex_sample(state);
+    state->tex_sample(state);
 
     if (state->cmd_set & CMD_SET_ABC_SRC)
         state->dest_rgba.a = state->a >> 7;
@@ -4025,7 +4032,7 @@ dest_pixel_lit_texture_decal(s3d_state_t *state)
 static void
 dest_pixel_lit_texture_reflection(s3d_state_t *state)
 {
-    tex_sample(state);
+    state->tex_sample(state);
 
     state->dest_rgba.r += (state->r >> 7);
     state->dest_rgba.g += (state->g >> 7);
@@ -4044,7 +4051,7 @@ dest_pixel_lit_texture_modulate(s3d_state_t *state)
     int b = state->b >> 7;
     int a = state->a >> 7;
 
-    tex_sample(state);
+    state->tex_sample(state);
 
     CLAMP_RGBA(r, g, b, a);
 
@@ -4104,6 +4111,9 @@ tri(virge_t *virge, s3d_t *s3d_tri, s3d_state_t *state, int yc, int32_t dx1, int
         int      xe = (state->x2 + ((1 << 20) - 1)) >> 20;
         uint32_t z  = (state->base_z > 0) ? (state->base_z << 1) : 0;
 
+        if (((state->y >> VIRGE_RENDER_BAND_SHIFT) & state->band_mask) != state->band_index)
+            goto tri_skip_line;
+
         if (x_dir < 0) {
             x--;
             xe--;
@@ -4189,9 +4199,6 @@ tri(virge_t *virge, s3d_t *s3d_tri, s3d_state_t *state, int yc, int32_t dx1, int
                 int      update = 1;
                 uint16_t src_z  = 0;
 
-                _x = x;
-                _y = state->y;
-
                 if (use_z) {
                     src_z = Z_READ(z_addr);
                     Z_CLIP(src_z, z >> 16);
@@ -4200,7 +4207,7 @@ tri(virge_t *virge, s3d_t *s3d_tri, s3d_state_t *state, int yc, int32_t dx1, int
                 if (update) {
                     uint32_t dest_col;
 
-                    dest_pixel(state);
+                    state->dest_pixel(state);
 
                     if (s3d_tri->cmd_set & CMD_SET_FE) {
                         int a              = state->a >> 7;
@@ -4265,7 +4272,7 @@ tri(virge_t *virge, s3d_t *s3d_tri, s3d_state_t *state, int yc, int32_t dx1, int
                 state->w += s3d_tri->TdWdX;
                 dest_addr += x_offset;
                 z_addr += xz_offset;
-                virge->pixel_count++;
+                state->pixel_count++;
             }
         }
 
@@ -4290,7 +4297,7 @@ tri_skip_line:
 static int tex_size[8] = { 4 * 2, 2 * 2, 2 * 2, 1 * 2, 2 / 1, 2 / 1, 1 * 2, 1 * 2 };
 
 static void
-s3_virge_triangle(virge_t *virge, s3d_t *s3d_tri)
+s3_virge_triangle(virge_t *virge, virge_render_t *render, s3d_t *s3d_tri)
 {
     s3d_state_t state;
 
@@ -4309,6 +4316,10 @@ s3_virge_triangle(virge_t *virge, s3d_t *s3d_tri)
 
     state.cmd_set = s3d_tri->cmd_set;
 
+    state.band_index  = render->index;
+    state.band_mask   = virge->render_threads - 1;
+    state.pixel_count = 0;
+
     state.base_u = s3d_tri->tus;
     state.base_v = s3d_tri->tvs;
     state.base_z = s3d_tri->tzs;
@@ -4328,19 +4339,19 @@ s3_virge_triangle(virge_t *virge, s3d_t *s3d_tri)
 
     switch ((s3d_tri->cmd_set >> 27) & 0xf) {
         case 0:
-            dest_pixel = dest_pixel_gouraud_shaded_triangle;
+            state.dest_pixel = dest_pixel_gouraud_shaded_triangle;
             break;
         case 1:
         case 5:
             switch ((s3d_tri->cmd_set >> 15) & 0x3) {
                 case 0:
-                    dest_pixel = dest_pixel_lit_texture_reflection;
+                    state.dest_pixel = dest_pixel_lit_texture_reflection;
                     break;
                 case 1:
-                    dest_pixel = dest_pixel_lit_texture_modulate;
+                    state.dest_pixel = dest_pixel_lit_texture_modulate;
                     break;
                 case 2:
-                    dest_pixel = dest_pixel_lit_texture_decal;
+                    state.dest_pixel = dest_pixel_lit_texture_decal;
                     break;
                 default:
                     return;
@@ -4348,7 +4359,7 @@ s3_virge_triangle(virge_t *virge, s3d_t *s3d_tri)
             break;
         case 2:
         case 6:
-            dest_pixel = dest_pixel_unlit_texture_triangle;
+            state.dest_pixel = dest_pixel_unlit_texture_triangle;
             break;
         default:
             return;
@@ -4357,66 +4368,66 @@ s3_virge_triangle(virge_t *virge, s3d_t *s3d_tri)
     switch (((s3d_tri->cmd_set >> 12) & 7) | ((s3d_tri->cmd_set & (1 << 29)) ? 8 : 0)) {
         case 0:
         case 1:
-            tex_sample = tex_sample_mipmap;
+            state.tex_sample = tex_sample_mipmap;
             break;
         case 2:
         case 3:
-            tex_sample = virge->bilinear_enabled ? tex_sample_mipmap_filter : tex_sample_mipmap;
+            state.tex_sample = virge->bilinear_enabled ? tex_sample_mipmap_filter : tex_sample_mipmap;
             break;
         case 4:
         case 5:
-            tex_sample = tex_sample_normal;
+            state.tex_sample = tex_sample_normal;
             break;
         case 6:
         case 7:
-            tex_sample = virge->bilinear_enabled ? tex_sample_normal_filter : tex_sample_normal;
+            state.tex_sample = virge->bilinear_enabled ? tex_sample_normal_filter : tex_sample_normal;
             break;
         case (0 | 8):
         case (1 | 8):
             if ((virge->chip == S3_VIRGEDX) || (virge->chip >= S3_VIRGEGX2))
-                tex_sample = tex_sample_persp_mipmap_375;
+                state.tex_sample = tex_sample_persp_mipmap_375;
             else
-                tex_sample = tex_sample_persp_mipmap;
+                state.tex_sample = tex_sample_persp_mipmap;
             break;
         case (2 | 8):
         case (3 | 8):
             if ((virge->chip == S3_VIRGEDX) || (virge->chip >= S3_VIRGEGX2))
-                tex_sample = virge->bilinear_enabled ? tex_sample_persp_mipmap_filter_375 :
+                state.tex_sample = virge->bilinear_enabled ? tex_sample_persp_mipmap_filter_375 :
                                                        tex_sample_persp_mipmap_375;
             else
-                tex_sample = virge->bilinear_enabled ? tex_sample_persp_mipmap_filter :
+                state.tex_sample = virge->bilinear_enabled ? tex_sample_persp_mipmap_filter :
                                                        tex_sample_persp_mipmap;
             break;
         case (4 | 8):
         case (5 | 8):
             if ((virge->chip == S3_VIRGEDX) || (virge->chip >= S3_VIRGEGX2))
-                tex_sample = tex_sample_persp_normal_375;
+                state.tex_sample = tex_sample_persp_normal_375;
             else
-                tex_sample = tex_sample_persp_normal;
+                state.tex_sample = tex_sample_persp_normal;
             break;
         case (6 | 8):
         case (7 | 8):
             if ((virge->chip == S3_VIRGEDX) || (virge->chip >= S3_VIRGEGX2))
-                tex_sample = virge->bilinear_enabled ? tex_sample_persp_normal_filter_375 :
+                state.tex_sample = virge->bilinear_enabled ? tex_sample_persp_normal_filter_375 :
                                                        tex_sample_persp_normal_375;
             else
-                tex_sample = virge->bilinear_enabled ? tex_sample_persp_normal_filter :
+                state.tex_sample = virge->bilinear_enabled ? tex_sample_persp_normal_filter :
                                                        tex_sample_persp_normal;
             break;
     }
 
     switch ((s3d_tri->cmd_set >> 5) & 7) {
         case 0:
-            tex_read = (s3d_tri->cmd_set & CMD_SET_TWE) ? tex_ARGB8888 : tex_ARGB8888_nowrap;
+            state.tex_read = (s3d_tri->cmd_set & CMD_SET_TWE) ? tex_ARGB8888 : tex_ARGB8888_nowrap;
             break;
         case 1:
-            tex_read = (s3d_tri->cmd_set & CMD_SET_TWE) ? tex_ARGB4444 : tex_ARGB4444_nowrap;
+            state.tex_read = (s3d_tri->cmd_set & CMD_SET_TWE) ? tex_ARGB4444 : tex_ARGB4444_nowrap;
             break;
         case 2:
-            tex_read = (s3d_tri->cmd_set & CMD_SET_TWE) ? tex_ARGB1555 : tex_ARGB1555_nowrap;
+            state.tex_read = (s3d_tri->cmd_set & CMD_SET_TWE) ? tex_ARGB1555 : tex_ARGB1555_nowrap;
             break;
         default:
-            tex_read = (s3d_tri->cmd_set & CMD_SET_TWE) ? tex_ARGB1555 : tex_ARGB1555_nowrap;
+            state.tex_read = (s3d_tri->cmd_set & CMD_SET_TWE) ? tex_ARGB1555 : tex_ARGB1555_nowrap;
             break;
     }
 
@@ -4427,32 +4438,55 @@ s3_virge_triangle(virge_t *virge, s3d_t *s3d_tri)
     state.x2 = s3d_tri->txend12;
     tri(virge, s3d_tri, &state, s3d_tri->ty12, s3d_tri->TdXdY02, s3d_tri->TdXdY12);
 
-    virge->tri_count++;
+    render->pixel_count += state.pixel_count;
+    render->tri_count++;
 
     end_time = plat_timer_read();
 
     virge_time += end_time - start_time;
 }
 
+/*Read index of the render thread furthest behind; ring buffer entries are only
+  free once every thread has drawn its bands of them*/
+static int
+s3_virge_render_read_idx(virge_t *virge)
+{
+    int read_idx = virge->render[0].read_idx;
+
+    for (int c = 1; c < virge->render_threads; c++) {
+        int idx = virge->render[c].read_idx;
+
+        if ((virge->s3d_write_idx - idx) > (virge->s3d_write_idx - read_idx))
+            read_idx = idx;
+    }
+
+    return read_idx;
+}
+
 static void
 render_thread(void *param)
 {
-    virge_t *virge = (virge_t *) param;
+    virge_render_t *render = (virge_render_t *) param;
+    virge_t        *virge  = render->virge;
 
     while (virge->render_thread_run) {
-        thread_wait_event(virge->wake_render_thread, -1);
-        thread_reset_event(virge->wake_render_thread);
-        virge->s3d_busy = 1;
-        while (!RB_EMPTY) {
-            s3_virge_triangle(virge, &virge->s3d_buffer[virge->s3d_read_idx & RB_MASK]);
-            virge->s3d_read_idx++;
+        thread_wait_event(render->wake_event, -1);
+        thread_reset_event(render->wake_event);
+        render->busy = 1;
+        virge->s3d_busy++;
+        while (render->read_idx != virge->s3d_write_idx) {
+            s3_virge_triangle(virge, render, &virge->s3d_buffer[render->read_idx & RB_MASK]);
+            render->read_idx++;
 
             if (RB_ENTRIES == RB_MASK)
                 thread_set_event(virge->not_full_event);
         }
-        virge->s3d_busy = 0;
-        virge->subsys_stat |= INT_S3D_DONE;
-        virge->irq_pending++;
+        render->busy = 0;
+        /*Only the last thread to go idle signals completion*/
+        if (atomic_fetch_sub(&virge->s3d_busy, 1) == 1) {
+            virge->subsys_stat |= INT_S3D_DONE;
+            virge->irq_pending++;
+        }
     }
 }
 
@@ -4466,8 +4500,10 @@ queue_triangle(virge_t *virge)
     }
     virge->s3d_buffer[virge->s3d_write_idx & RB_MASK] = virge->s3d_tri;
     virge->s3d_write_idx++;
-    if (!virge->s3d_busy)
-        thread_set_event(virge->wake_render_thread); /*Wake up render thread if moving from idle*/
+    for (int c = 0; c < virge->render_threads; c++) {
+        if (!virge->render[c].busy)
+            thread_set_event(virge->render[c].wake_event); /*Wake up render thread if moving from idle*/
+    }
 }
 
 static void
@@ -5121,11 +5157,11 @@ s3_virge_reset(void *priv)
     if (reset_state != NULL) {
         s3_virge_disable_handlers(dev);
         dev->virge_busy       = 0;
-        dev->fifo_write_idx   = 0;
-        dev->fifo_read_idx    = 0;
+        spsc_clear(&dev->fifo_ring);
         dev->s3d_busy         = 0;
         dev->s3d_write_idx    = 0;
-        dev->s3d_read_idx     = 0;
+        for (int c = 0; c < dev->render_threads; c++)
+            dev->render[c].read_idx = 0;
         reset_state->pci_slot = dev->pci_slot;
 
         *dev = *reset_state;
@@ -5141,6 +5177,9 @@ s3_virge_init(const device_t *info)
 
     virge->bilinear_enabled  = device_get_config_int("bilinear");
     virge->dithering_enabled = device_get_config_int("dithering");
+    virge->render_threads    = device_get_config_int("render_threads");
+    if ((virge->render_threads < 1) || (virge->render_threads > VIRGE_MAX_RENDER_THREADS) || (virge->render_threads & (virge->render_threads - 1)))
+        virge->render_threads = 1;
     if (info->local >= S3_VIRGE_GX2)
         virge->memory_size = 4;
     else
@@ -5372,16 +5411,21 @@ s3_virge_init(const device_t *info)
 
     virge->svga.force_old_addr = 1;
 
-    virge->render_thread_run  = 1;
-    virge->wake_render_thread = thread_create_event();
-    virge->wake_main_thread   = thread_create_event();
-    virge->not_full_event     = thread_create_event();
-    virge->render_thread      = thread_create(render_thread, virge);
+    virge->render_thread_run = 1;
+    virge->wake_main_thread  = thread_create_event();
+    virge->not_full_event    = thread_create_event();
+    for (int c = 0; c < virge->render_threads; c++) {
+        virge->render[c].virge      = virge;
+        virge->render[c].index      = c;
+        virge->render[c].wake_event = thread_create_event();
+        virge->render[c].thread     = thread_create_role(render_thread, &virge->render[c], THREAD_ROLE_VIDEO);
+    }
 
     virge->fifo_thread_run     = 1;
     virge->wake_fifo_thread    = thread_create_event();
     virge->fifo_not_full_event = thread_create_event();
-    virge->fifo_thread         = thread_create(fifo_thread, virge);
+    spsc_init(&virge->fifo_ring, FIFO_SIZE, SPSC_SPIN, virge->wake_fifo_thread, virge->fifo_not_full_event);
+    virge->fifo_thread         = thread_create_role(fifo_thread, virge, THREAD_ROLE_VIDEO);
 
     timer_add(&virge->irq_timer, s3_virge_update_irq_timer, virge, 1);
 
@@ -5398,11 +5442,13 @@ s3_virge_close(void *priv)
     virge_t *virge = (virge_t *) priv;
 
     virge->render_thread_run = 0;
-    thread_set_event(virge->wake_render_thread);
-    thread_wait(virge->render_thread);
+    for (int c = 0; c < virge->render_threads; c++) {
+        thread_set_event(virge->render[c].wake_event);
+        thread_wait(virge->render[c].thread);
+        thread_destroy_event(virge->render[c].wake_event);
+    }
     thread_destroy_event(virge->not_full_event);
     thread_destroy_event(virge->wake_main_thread);
-    thread_destroy_event(virge->wake_render_thread);
 
     virge->fifo_thread_run = 0;
     thread_set_event(virge->wake_fifo_thread);
@@ -5539,6 +5585,21 @@ static const device_config_t s3_virge_config[] = {
         .selection      = { { 0 } },
         .bios           = { { 0 } }
     },
+    {
+        .name           = "render_threads",
+        .description    = "Render threads",
+        .type           = CONFIG_SELECTION,
+        .default_int    = 2,
+        .file_filter    = NULL,
+        .spinner        = { 0 },
+        .selection      = {
+            { .description = "1", .value = 1 },
+            { .description = "2", .value = 2 },
+            { .description = "4", .value = 4 },
+            { .description = ""              }
+        },
+        .bios           = { { 0 } }
+    },
     { .name = "", .description = "", .type = CONFIG_END }
     // clang-format on
 };
@@ -5580,6 +5641,21 @@ static const device_config_t s3_virge_stb_config[] = {
         .selection      = { { 0 } },
         .bios           = { { 0 } }
     },
+    {
+        .name           = "render_threads",
+        .description    = "Render threads",
+        .type           = CONFIG_SELECTION,
+        .default_int    = 2,
+        .file_filter    = NULL,
+        .spinner        = { 0 },
+        .selection      = {
+            { .description = "1", .value = 1 },
+            { .description = "2", .value = 2 },
+            { .description = "4", .value = 4 },
+            { .description = ""              }
+        },
+        .bios           = { { 0 } }
+    },
     { .name = "", .description = "", .type = CONFIG_END }
     // clang-format on
 };
@@ -5606,6 +5682,21 @@ static const device_config_t s3_virge_357_config[] = {
         .selection      = { { 0 } },
         .bios           = { { 0 } }
     },
+    {
+        .name           = "render_threads",
+        .description    = "Render threads",
+        .type           = CONFIG_SELECTION,
+        .default_int    = 2,
+        .file_filter    = NULL,
+        .spinner        = { 0 },
+        .selection      = {
+            { .description = "1", .value = 1 },
+            { .description = "2", .value = 2 },
+            { .description = "4", .value = 4 },
+            { .description = ""              }
+        },
+        .bios           = { { 0 } }
+    },
     { .name = "", .description = "", .type = CONFIG_END }
     // clang-format on
 };
@@ -5649,6 +5740,21 @@ static const device_config_t s3_trio3d2x_config[] = {
         .selection      = { { 0 } },
         .bios           = { { 0 } }
     },
+    {
+        .name           = "render_threads",
+        .description    = "Render threads",
+        .type           = CONFIG_SELECTION,
+        .default_int    = 2,
+        .file_filter    = NULL,
+        .spinner        = { 0 },
+        .selection      = {
+            { .description = "1", .value = 1 },
+            { .description = "2", .value = 2 },
+            { .description = "4", .value = 4 },
+            { .description = ""              }
+        },
+        .bios           = { { 0 } }
+    },
     { .name = "", .description = "", .type = CONFIG_END }
     // clang-format on
 };
@@ -0,0 +1,337 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Software scaler for the renderers without a GPU.
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <86box/vid_scale.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#    define VIDEO_SCALE_SSE2
+#    include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#    define VIDEO_SCALE_NEON
+#    include <arm_neon.h>
+#endif
+
+struct video_scaler_t {
+    /* Geometry the tables were built for. */
+    int sw;
+    int sh;
+    int dw;
+    int dh;
+    int method;
+    int full;
+
+    uint32_t *x_idx;  /* Source column for each output column. */
+    uint8_t  *x_frac; /* Weight of the column after it, bilinear only. */
+    uint32_t *y_idx;
+    uint8_t  *y_frac;
+
+    uint32_t *row;   /* Vertically filtered source row, plus a spare pixel. */
+    uint32_t *prev;  /* The last frame, sw x sh. */
+    uint8_t  *dirty; /* Per source row, changed since the last frame. */
+};
+
+/*Blend two pixels, f/256 of the way from a to b. Red and blue, then
+  alpha and green, are done two at a time*/
+static inline uint32_t
+scale_lerp(uint32_t a, uint32_t b, uint32_t f)
+{
+    const uint32_t rb = ((((a & 0x00ff00ff) * (256 - f)) + ((b & 0x00ff00ff) * f)) >> 8) & 0x00ff00ff;
+    const uint32_t ag = ((((a >> 8) & 0x00ff00ff) * (256 - f)) + (((b >> 8) & 0x00ff00ff) * f)) & 0xff00ff00;
+
+    return rb | ag;
+}
+
+static void
+scale_build_axis(uint32_t *idx, uint8_t *frac, int src, int dst, int method)
+{
+    for (int d = 0; d < dst; d++) {
+        if (method == VIDEO_SCALE_LINEAR) {
+            /* Sample at the pixel centres, in 8.8 fixed point. */
+            int64_t pos = ((((int64_t) (2 * d + 1)) * src * 256) / (2 * dst)) - 128;
+
+            if (pos < 0)
+                pos = 0;
+            idx[d]  = (uint32_t) (pos >> 8);
+            frac[d] = pos & 0xff;
+            if (idx[d] >= (uint32_t) (src - 1)) {
+                idx[d]  = src - 1;
+                frac[d] = 0;
+            }
+        } else {
+            idx[d]  = (uint32_t) ((((int64_t) (2 * d + 1)) * src) / (2 * dst));
+            frac[d] = 0;
+        }
+    }
+}
+
+static int
+scale_setup(video_scaler_t *s, int dw, int dh, int sw, int sh, int method)
+{
+    void *p[7];
+
+    if ((s->sw == sw) && (s->sh == sh) && (s->dw == dw) && (s->dh == dh) && (s->method == method))
+        return 1;
+
+    p[0] = realloc(s->x_idx, dw * sizeof(uint32_t));
+    p[1] = realloc(s->x_frac, dw);
+    p[2] = realloc(s->y_idx, dh * sizeof(uint32_t));
+    p[3] = realloc(s->y_frac, dh);
+    p[4] = realloc(s->row, (sw + 1) * sizeof(uint32_t));
+    p[5] = realloc(s->prev, (size_t) sw * sh * sizeof(uint32_t));
+    p[6] = realloc(s->dirty, sh);
+
+    /* Whatever did get reallocated is still owned by the scaler. */
+    s->x_idx  = p[0] ? p[0] : s->x_idx;
+    s->x_frac = p[1] ? p[1] : s->x_frac;
+    s->y_idx  = p[2] ? p[2] : s->y_idx;
+    s->y_frac = p[3] ? p[3] : s->y_frac;
+    s->row    = p[4] ? p[4] : s->row;
+    s->prev   = p[5] ? p[5] : s->prev;
+    s->dirty  = p[6] ? p[6] : s->dirty;
+
+    for (int i = 0; i < 7; i++) {
+        if (p[i] == NULL) {
+            s->sw = 0;
+            return 0;
+        }
+    }
+
+    scale_build_axis(s->x_idx, s->x_frac, sw, dw, method);
+    scale_build_axis(s->y_idx, s->y_frac, sh, dh, method);
+
+    s->sw     = sw;
+    s->sh     = sh;
+    s->dw     = dw;
+    s->dh     = dh;
+    s->method = method;
+    s->full   = 1;
+
+    return 1;
+}
+
+/*Mark the source rows that differ from the last frame, and keep a copy*/
+static void
+scale_find_damage(video_scaler_t *s, const uint32_t *src, int src_pitch)
+{
+    const size_t len = s->sw * sizeof(uint32_t);
+
+    for (int y = 0; y < s->sh; y++) {
+        const uint32_t *line = &src[(size_t) y * src_pitch];
+        uint32_t       *prev = &s->prev[(size_t) y * s->sw];
+
+        s->dirty[y] = s->full || memcmp(line, prev, len);
+        if (s->dirty[y])
+            memcpy(prev, line, len);
+    }
+
+    s->full = 0;
+}
+
+/*Repeat each of len pixels factor times*/
+static void
+scale_row_repeat(uint32_t *dst, const uint32_t *src, int len, int factor)
+{
+    int x = 0;
+
+    if (factor == 1) {
+        memcpy(dst, src, len * sizeof(uint32_t));
+        return;
+    }
+
+#if defined(VIDEO_SCALE_SSE2)
+    if (factor == 2) {
+        for (; (x + 4) <= len; x += 4, dst += 8) {
+            const __m128i v = _mm_loadu_si128((const __m128i *) &src[x]);
+
+            _mm_storeu_si128((__m128i *) &dst[0], _mm_unpacklo_epi32(v, v));
+            _mm_storeu_si128((__m128i *) &dst[4], _mm_unpackhi_epi32(v, v));
+        }
+    } else if (!(factor & 3)) {
+        for (; x < len; x++) {
+            const __m128i v = _mm_set1_epi32(src[x]);
+
+            for (int i = 0; i < factor; i += 4, dst += 4)
+                _mm_storeu_si128((__m128i *) dst, v);
+        }
+    }
+#elif defined(VIDEO_SCALE_NEON)
+    if (factor == 2) {
+        for (; (x + 4) <= len; x += 4, dst += 8) {
+            const uint32x4_t   v = vld1q_u32(&src[x]);
+            const uint32x4x2_t z = vzipq_u32(v, v);
+
+            vst1q_u32(&dst[0], z.val[0]);
+            vst1q_u32(&dst[4], z.val[1]);
+        }
+    } else if (!(factor & 3)) {
+        for (; x < len; x++) {
+            const uint32x4_t v = vdupq_n_u32(src[x]);
+
+            for (int i = 0; i < factor; i += 4, dst += 4)
+                vst1q_u32(dst, v);
+        }
+    }
+#endif
+
+    for (; x < len; x++) {
+        for (int i = 0; i < factor; i++)
+            *dst++ = src[x];
+    }
+}
+
+static void
+scale_row_nearest(const video_scaler_t *s, uint32_t *dst, const uint32_t *src)
+{
+    const int factor = s->dw / s->sw;
+
+    if ((factor * s->sw) == s->dw) {
+        scale_row_repeat(dst, src, s->sw, factor);
+        return;
+    }
+
+    for (int x = 0; x < s->dw; x++)
+        dst[x] = src[s->x_idx[x]];
+}
+
+/*Blend len pixels of row a with row b, f/256 of the way to b*/
+static void
+scale_blend_rows(uint32_t *dst, const uint32_t *a, const uint32_t *b, uint32_t f, int len)
+{
+    int x = 0;
+
+    if (f == 0) {
+        memcpy(dst, a, len * sizeof(uint32_t));
+        return;
+    }
+
+#if defined(VIDEO_SCALE_SSE2)
+    const __m128i wa   = _mm_set1_epi16(256 - f);
+    const __m128i wb   = _mm_set1_epi16(f);
+    const __m128i zero = _mm_setzero_si128();
+
+    /* The weights add up to 256, so the sums fit in 16 bits. */
+    for (; (x + 4) <= len; x += 4) {
+        const __m128i va = _mm_loadu_si128((const __m128i *) &a[x]);
+        const __m128i vb = _mm_loadu_si128((const __m128i *) &b[x]);
+        __m128i       lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(va, zero), wa),
+                                         _mm_mullo_epi16(_mm_unpacklo_epi8(vb, zero), wb));
+        __m128i       hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(va, zero), wa),
+                                         _mm_mullo_epi16(_mm_unpackhi_epi8(vb, zero), wb));
+
+        lo = _mm_srli_epi16(lo, 8);
+        hi = _mm_srli_epi16(hi, 8);
+        _mm_storeu_si128((__m128i *) &dst[x], _mm_packus_epi16(lo, hi));
+    }
+#elif defined(VIDEO_SCALE_NEON)
+    /* f is not 0 here, so both weights fit in a byte. */
+    const uint8x8_t wa = vdup_n_u8(256 - f);
+    const uint8x8_t wb = vdup_n_u8(f);
+
+    for (; (x + 4) <= len; x += 4) {
+        const uint8x16_t va = vld1q_u8((const uint8_t *) &a[x]);
+        const uint8x16_t vb = vld1q_u8((const uint8_t *) &b[x]);
+        const uint16x8_t lo = vmlal_u8(vmull_u8(vget_low_u8(va), wa), vget_low_u8(vb), wb);
+        const uint16x8_t hi = vmlal_u8(vmull_u8(vget_high_u8(va), wa), vget_high_u8(vb), wb);
+
+        vst1q_u8((uint8_t *) &dst[x], vcombine_u8(vshrn_n_u16(lo, 8), vshrn_n_u16(hi, 8)));
+    }
+#endif
+
+    for (; x < len; x++)
+        dst[x] = scale_lerp(a[x], b[x], f);
+}
+
+static void
+scale_row_linear(const video_scaler_t *s, uint32_t *dst, const uint32_t *src)
+{
+    for (int x = 0; x < s->dw; x++) {
+        const uint32_t i = s->x_idx[x];
+        const uint32_t f = s->x_frac[x];
+
+        dst[x] = f ? scale_lerp(src[i], src[i + 1], f) : src[i];
+    }
+}
+
+int
+video_scale(video_scaler_t *s, uint32_t *dst, int dst_pitch, int dw, int dh,
+            const uint32_t *src, int src_pitch, int sw, int sh, int method)
+{
+    int drawn = 0;
+    int last  = -1;
+
+    if ((sw <= 0) || (sh <= 0) || (dw <= 0) || (dh <= 0))
+        return 0;
+
+    if (!scale_setup(s, dw, dh, sw, sh, method))
+        return 0;
+
+    scale_find_damage(s, src, src_pitch);
+
+    for (int y = 0; y < dh; y++) {
+        const uint32_t y0  = s->y_idx[y];
+        const uint32_t f   = s->y_frac[y];
+        const uint32_t y1  = f ? (y0 + 1) : y0;
+        uint32_t      *out = &dst[(size_t) y * dst_pitch];
+
+        if (!s->dirty[y0] && !s->dirty[y1])
+            continue;
+
+        /* Rows sampled from the same place as the one above are copies. */
+        if ((last >= 0) && (s->y_idx[last] == y0) && (s->y_frac[last] == f))
+            memcpy(out, &dst[(size_t) last * dst_pitch], dw * sizeof(uint32_t));
+        else if (method == VIDEO_SCALE_LINEAR) {
+            scale_blend_rows(s->row, &s->prev[(size_t) y0 * sw], &s->prev[(size_t) y1 * sw], f, sw);
+            s->row[sw] = s->row[sw - 1];
+            scale_row_linear(s, out, s->row);
+        } else
+            scale_row_nearest(s, out, &s->prev[(size_t) y0 * sw]);
+
+        last = y;
+        drawn++;
+    }
+
+    return drawn;
+}
+
+void
+video_scaler_invalidate(video_scaler_t *s)
+{
+    s->full = 1;
+}
+
+video_scaler_t *
+video_scaler_init(void)
+{
+    video_scaler_t *s = (video_scaler_t *) calloc(1, sizeof(video_scaler_t));
+
+    s->full = 1;
+
+    return s;
+}
+
+void
+video_scaler_close(video_scaler_t *s)
+{
+    if (s == NULL)
+        return;
+
+    free(s->x_idx);
+    free(s->x_frac);
+    free(s->y_idx);
+    free(s->y_frac);
+    free(s->row);
+    free(s->prev);
+    free(s->dirty);
+    free(s);
+}
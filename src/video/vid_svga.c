@@ -21,6 +21,7 @@
  */
 #include <inttypes.h>
 #include <stdarg.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
@@ -38,15 +39,27 @@
 #include <86box/rom.h>
 #include <86box/plat.h>
 #include <86box/ui.h>
+#include <86box/thread.h>
+#include <86box/spsc.h>
 #include <86box/video.h>
 #include <86box/vid_8514a.h>
 #include <86box/vid_xga.h>
 #include <86box/vid_svga.h>
 #include <86box/vid_svga_render.h>
+#include <86box/vid_glyph_cache.h>
 #include <86box/vid_xga_device.h>
+#include <86box/perf.h>
+#include <86box/snapshot.h>
+#include <minitrace/minitrace.h>
 
 void svga_doblit(int wx, int wy, svga_t *svga);
 void svga_poll(void *priv);
+static void svga_poll_write(svga_t *svga);
+
+/* Batching never runs more phases at once than this. */
+#define SVGA_BATCH_MAX_PHASES 4096
+/* Shorter runs of quiet lines run from the timer as before. */
+#define SVGA_BATCH_MIN_LINES  4
 
 svga_t *svga_8514;
 
@@ -88,7 +101,12 @@ svga_set_poll(svga_t *svga)
 {
     svga_log("SVGA Timer activated, enabled?=%x.\n", timer_is_enabled(&svga->timer));
     timer_set_callback(&svga->timer, svga_poll);
-    if (!timer_is_enabled(&svga->timer))
+    if (svga->poll_batch && !svga->poll_running) {
+        /* Coming back from another poll, the batched lines are stale. */
+        svga->poll_batch    = 0;
+        svga->timer.ts.ts64 = svga->poll_ts;
+        timer_enable(&svga->timer);
+    } else if (!timer_is_enabled(&svga->timer))
         timer_enable(&svga->timer);
 }
 
@@ -172,6 +190,32 @@ svga_set_override(svga_t *svga, int val)
 #endif
 }
 
+static void
+svga_set_memory_map(svga_t *svga, uint8_t val)
+{
+    switch (val & 0xc) {
+        case 0x0: /*128k at A0000*/
+            mem_mapping_set_addr(&svga->mapping, 0xa0000, 0x20000);
+            svga->banked_mask = 0xffff;
+            break;
+        case 0x4: /*64k at A0000*/
+            mem_mapping_set_addr(&svga->mapping, 0xa0000, 0x10000);
+            svga->banked_mask = 0xffff;
+            break;
+        case 0x8: /*32k at B0000*/
+            mem_mapping_set_addr(&svga->mapping, 0xb0000, 0x08000);
+            svga->banked_mask = 0x7fff;
+            break;
+        case 0xC: /*32k at B8000*/
+            mem_mapping_set_addr(&svga->mapping, 0xb8000, 0x08000);
+            svga->banked_mask = 0x7fff;
+            break;
+
+        default:
+            break;
+    }
+}
+
 void
 svga_out(uint16_t addr, uint8_t val, void *priv)
 {
@@ -182,6 +226,9 @@ svga_out(uint16_t addr, uint8_t val, void *priv)
     uint8_t    index;
     uint8_t    pal4to16[16] = { 0, 7, 0x38, 0x3f, 0, 3, 4, 0x3f, 0, 2, 4, 0x3e, 0, 3, 5, 0x3f };
 
+    svga_poll_sync(svga);
+    svga_poll_write(svga);
+
     if ((addr >= 0x2ea) && (addr <= 0x2ed)) {
         if (!dev)
             return;
@@ -393,29 +440,8 @@ svga_out(uint16_t addr, uint8_t val, void *priv)
                     svga->chain2_read = val & 0x10;
                     break;
                 case 6:
-                    if ((svga->gdcreg[6] & 0xc) != (val & 0xc)) {
-                        switch (val & 0xc) {
-                            case 0x0: /*128k at A0000*/
-                                mem_mapping_set_addr(&svga->mapping, 0xa0000, 0x20000);
-                                svga->banked_mask = 0xffff;
-                                break;
-                            case 0x4: /*64k at A0000*/
-                                mem_mapping_set_addr(&svga->mapping, 0xa0000, 0x10000);
-                                svga->banked_mask = 0xffff;
-                                break;
-                            case 0x8: /*32k at B0000*/
-                                mem_mapping_set_addr(&svga->mapping, 0xb0000, 0x08000);
-                                svga->banked_mask = 0x7fff;
-                                break;
-                            case 0xC: /*32k at B8000*/
-                                mem_mapping_set_addr(&svga->mapping, 0xb8000, 0x08000);
-                                svga->banked_mask = 0x7fff;
-                                break;
-
-                            default:
-                                break;
-                        }
-                    }
+                    if ((svga->gdcreg[6] & 0xc) != (val & 0xc))
+                        svga_set_memory_map(svga, val);
                     break;
                 case 7:
                     svga->colournocare = val;
@@ -449,6 +475,8 @@ svga_in(uint16_t addr, void *priv)
     uint8_t    index;
     uint8_t    ret = 0xff;
 
+    svga_poll_sync(svga);
+
     if ((addr >= 0x2ea) && (addr <= 0x2ed)) {
         if (!dev)
             return ret;
@@ -702,6 +730,9 @@ svga_recalctimings(svga_t *svga)
     int              old_monitor_overscan_x = svga->monitor->mon_overscan_x;
     int              old_monitor_overscan_y = svga->monitor->mon_overscan_y;
 
+    svga_poll_sync(svga);
+    svga_poll_write(svga);
+
     svga->vtotal      = svga->crtc[6];
     svga->dispend     = svga->crtc[0x12];
     svga->vsyncstart  = svga->crtc[0x10];
@@ -1164,9 +1195,352 @@ svga_recalctimings(svga_t *svga)
         video_force_resize_set_monitor(1, svga->monitor_index);
 }
 
+/*
+   With video_render_thread set, each monitor gets a worker thread that
+   renders its scanlines. For every line the CPU thread only queues a copy
+   of the svga_t, which holds the CRTC, attribute and palette state the
+   renderers read, and moves on. Lines needing a hardware cursor, overlay
+   or an override renderer are drawn inline after the worker has caught
+   up, as those callbacks update card state of their own.
+ */
+#define SVGA_RENDER_QUEUE_SIZE 32
+
+typedef struct svga_render_queue_t {
+    svga_t lines[SVGA_RENDER_QUEUE_SIZE];
+    spsc_t ring;
+
+    /* Owned by the worker until svga_render_flush() merges them. */
+    int firstline_draw;
+    int lastline_draw;
+
+    volatile int thread_run;
+    event_t     *wake_event;
+    event_t     *not_full_event;
+    thread_t    *thread;
+} svga_render_queue_t;
+
+static void
+svga_render_thread(void *priv)
+{
+    svga_render_queue_t *queue = (svga_render_queue_t *) priv;
+
+    while (queue->thread_run) {
+        spsc_park(&queue->ring);
+
+        while (!spsc_empty(&queue->ring)) {
+            svga_t *line = &queue->lines[spsc_read_pos(&queue->ring)];
+
+            line->firstline_draw = queue->firstline_draw;
+            line->lastline_draw  = queue->lastline_draw;
+
+            line->render(line);
+
+            line->x_add = (line->monitor->mon_overscan_x >> 1);
+            svga_render_overscan_left(line);
+            svga_render_overscan_right(line);
+
+            queue->firstline_draw = line->firstline_draw;
+            queue->lastline_draw  = line->lastline_draw;
+
+            spsc_pop(&queue->ring);
+        }
+    }
+}
+
+/* Wait for the worker to render every queued line. */
+static void
+svga_render_flush(svga_t *svga)
+{
+    svga_render_queue_t *queue = svga->render_queue;
+
+    if (queue == NULL)
+        return;
+
+    spsc_wait_below(&queue->ring, 1);
+
+    if (queue->firstline_draw != 2000) {
+        if (queue->firstline_draw < svga->firstline_draw)
+            svga->firstline_draw = queue->firstline_draw;
+        if (queue->lastline_draw > svga->lastline_draw)
+            svga->lastline_draw = queue->lastline_draw;
+
+        queue->firstline_draw = 2000;
+        queue->lastline_draw  = 0;
+    }
+}
+
+static void
+svga_render_queue_line(svga_t *svga)
+{
+    svga_render_queue_t *queue = svga->render_queue;
+    svga_t              *line;
+
+    spsc_wait_below(&queue->ring, SVGA_RENDER_QUEUE_SIZE);
+
+    line = &queue->lines[spsc_write_pos(&queue->ring)];
+    memcpy(line, svga, sizeof(svga_t));
+    if (svga->map8 == svga->pallook)
+        line->map8 = line->pallook;
+
+    spsc_push(&queue->ring);
+    spsc_wake(&queue->ring);
+}
+
+static void
+svga_render_queue_init(svga_t *svga)
+{
+    svga_render_queue_t *queue = calloc(1, sizeof(svga_render_queue_t));
+
+    queue->firstline_draw = 2000;
+    queue->lastline_draw  = 0;
+    queue->thread_run     = 1;
+    queue->wake_event     = thread_create_event();
+    queue->not_full_event = thread_create_event();
+    spsc_init(&queue->ring, SVGA_RENDER_QUEUE_SIZE, SPSC_SPIN, queue->wake_event, queue->not_full_event);
+    queue->thread = thread_create_role(svga_render_thread, queue, THREAD_ROLE_VIDEO);
+
+    svga->render_queue = queue;
+}
+
+static void
+svga_render_queue_close(svga_t *svga)
+{
+    svga_render_queue_t *queue = svga->render_queue;
+
+    if (queue == NULL)
+        return;
+
+    queue->thread_run = 0;
+    thread_set_event(queue->wake_event);
+    thread_wait(queue->thread);
+
+    thread_destroy_event(queue->not_full_event);
+    thread_destroy_event(queue->wake_event);
+    free(queue);
+
+    svga->render_queue = NULL;
+}
+
+/* Pick whether this frame's hardware cursors go to the presenter or into the
+   frame, and allocate the capture buffers the first time. While the cursors
+   are not drawn into the frame the lines under them are not redrawn either,
+   so switching either way redraws the whole frame once. */
+static void
+svga_cursor_layer_select(svga_t *svga)
+{
+    int on = !svga->cursor_layer_overflow && video_cursor_layer_active(svga->monitor_index);
+
+    if (on && (svga->cursor_layer == NULL)) {
+        svga->cursor_layer = calloc(1, sizeof(cursor_layer_t));
+        svga->cursor_lines = malloc(2 * 2048 * sizeof(uint32_t));
+        if ((svga->cursor_layer == NULL) || (svga->cursor_lines == NULL)) {
+            free(svga->cursor_layer);
+            free(svga->cursor_lines);
+            svga->cursor_layer = NULL;
+            svga->cursor_lines = NULL;
+            on                 = 0;
+        } else {
+            for (int i = 0; i < (CURSOR_LAYER_MAX * CURSOR_LAYER_MAX); i++)
+                svga->cursor_layer->and_mask[i] = 0x00ffffff;
+        }
+    }
+
+    if (on != svga->cursor_layer_on) {
+        svga->cursor_layer_on = on;
+        svga->fullchange      = svga->monitor->mon_changeframecount;
+
+        /* Take the old layer off the screen. */
+        if (!on && (svga->cursor_layer != NULL))
+            video_cursor_layer_update(svga->monitor_index, svga->cursor_layer);
+    }
+}
+
+/* Hand the frame's cursor layer to the presenter and start an empty one. */
+static void
+svga_cursor_layer_publish(svga_t *svga)
+{
+    cursor_layer_t *layer = svga->cursor_layer;
+
+    video_cursor_layer_update(svga->monitor_index, layer);
+
+    for (int y = 0; y < layer->h; y++) {
+        for (int x = 0; x < layer->w; x++) {
+            layer->and_mask[(y * CURSOR_LAYER_MAX) + x] = 0x00ffffff;
+            layer->xor_mask[(y * CURSOR_LAYER_MAX) + x] = 0x00000000;
+        }
+    }
+    layer->x = layer->y = layer->w = layer->h = 0;
+}
+
+/* A cursor too large for the layer, or one that wrapped around, falls back
+   to being drawn into the frame from the next frame on. */
+static void
+svga_cursor_layer_overflow(svga_t *svga)
+{
+    if (!svga->cursor_layer_overflow)
+        svga_log("SVGA: Hardware cursor does not fit the cursor layer, drawing it into the frame.\n");
+
+    svga->cursor_layer_overflow = 1;
+}
+
+/* Merge one captured line into the layer. Pixels the cursor left alone on
+   both backgrounds are transparent, for the rest the bits that differ
+   between the two runs are the ones taken from the frame. */
+static void
+svga_cursor_layer_merge(svga_t *svga, const uint32_t *black, const uint32_t *white, int w, int line)
+{
+    cursor_layer_t *layer = svga->cursor_layer;
+    int             x0    = -1;
+    int             x1    = 0;
+    int             shift;
+    int             row;
+    uint32_t       *and_mask;
+    uint32_t       *xor_mask;
+
+    for (int x = 0; x < w; x++) {
+        if (((black[x] & 0x00ffffff) != 0x00000000) || ((white[x] & 0x00ffffff) != 0x00ffffff)) {
+            if (x0 < 0)
+                x0 = x;
+            x1 = x + 1;
+        }
+    }
+    if (x0 < 0)
+        return;
+
+    if (!layer->w) {
+        layer->x = x0;
+        layer->y = line;
+    } else if (x0 < layer->x) {
+        /* Cursor rows rarely start at different columns, move the rows
+           captured so far over when one does. */
+        shift = layer->x - x0;
+        if ((layer->w + shift) > CURSOR_LAYER_MAX) {
+            svga_cursor_layer_overflow(svga);
+            return;
+        }
+        for (int y = 0; y < layer->h; y++) {
+            and_mask = &layer->and_mask[y * CURSOR_LAYER_MAX];
+            xor_mask = &layer->xor_mask[y * CURSOR_LAYER_MAX];
+            memmove(&and_mask[shift], and_mask, layer->w * sizeof(uint32_t));
+            memmove(&xor_mask[shift], xor_mask, layer->w * sizeof(uint32_t));
+            for (int x = 0; x < shift; x++) {
+                and_mask[x] = 0x00ffffff;
+                xor_mask[x] = 0x00000000;
+            }
+        }
+        layer->x = x0;
+        layer->w += shift;
+    }
+
+    row = line - layer->y;
+    if ((row < 0) || (row >= CURSOR_LAYER_MAX) || ((x1 - layer->x) > CURSOR_LAYER_MAX)) {
+        svga_cursor_layer_overflow(svga);
+        return;
+    }
+
+    and_mask = &layer->and_mask[(row * CURSOR_LAYER_MAX) - layer->x];
+    xor_mask = &layer->xor_mask[(row * CURSOR_LAYER_MAX) - layer->x];
+    for (int x = x0; x < x1; x++) {
+        const uint32_t a = (black[x] ^ white[x]) & 0x00ffffff;
+
+        /* A later cursor on the same line is applied over the earlier one. */
+        and_mask[x] &= a;
+        xor_mask[x] = (xor_mask[x] & a) ^ (black[x] & 0x00ffffff);
+    }
+
+    layer->w = MAX(layer->w, x1 - layer->x);
+    layer->h = MAX(layer->h, row + 1);
+}
+
+/* Run a cursor draw handler over a black and over a white line rather than
+   over the frame, so the presenter can composite the result. The handlers
+   advance their latch on every call, so it is put back for the second run.
+   The line itself is left as it was. */
+static void
+svga_cursor_capture(svga_t *svga, void (*draw)(struct svga_t *svga, int displine), hwcursor_t *latch, int line)
+{
+    const bitmap_t  *target = svga->monitor->target_buffer;
+    uint32_t        *p      = target->line[line];
+    uint32_t        *save   = svga->cursor_lines;
+    uint32_t        *black  = &svga->cursor_lines[2048];
+    const hwcursor_t start  = *latch;
+    int              w      = MIN(svga->monitor->mon_xsize + svga->monitor->mon_overscan_x, target->w);
+
+    if (w > 2048)
+        w = 2048;
+
+    memcpy(save, p, w * sizeof(uint32_t));
+
+    memset(p, 0x00, w * sizeof(uint32_t));
+    draw(svga, line);
+    memcpy(black, p, w * sizeof(uint32_t));
+
+    *latch = start;
+    for (int x = 0; x < w; x++)
+        p[x] = 0x00ffffff;
+    draw(svga, line);
+
+    /* Lines past the bottom of the frame belong to a cursor hanging off the
+       top of the screen and are never shown. */
+    if (line < (svga->monitor->mon_ysize + svga->monitor->mon_overscan_y))
+        svga_cursor_layer_merge(svga, black, p, w, line);
+
+    memcpy(p, save, w * sizeof(uint32_t));
+}
+
+/* Counterpart of the cursor drawing in svga_do_render() while the cursors go
+   to the presenter, it runs before the line is rendered so that the line
+   can still be queued. */
+static void
+svga_cursor_layer_line(svga_t *svga)
+{
+    if (svga->dpms)
+        return;
+
+    /* A cursor hanging off the top of the screen is drawn on earlier lines,
+       which the render thread may still be working on. */
+    if (svga->render_queue && ((svga->dac_hwcursor_on && (svga->dac_hwcursor_latch.y < 0)) ||
+                               (svga->hwcursor_on && (svga->hwcursor_latch.y < 0))))
+        svga_render_flush(svga);
+
+    svga->x_add = (svga->monitor->mon_overscan_x >> 1) - svga->scrollcache;
+
+    if (svga->dac_hwcursor_on) {
+        if (!svga->override && svga->dac_hwcursor_draw)
+            svga_cursor_capture(svga, svga->dac_hwcursor_draw, &svga->dac_hwcursor_latch,
+                                (svga->displine + svga->y_add + ((svga->dac_hwcursor_latch.y >= 0) ? 0 : svga->dac_hwcursor_latch.y)) & 2047);
+        svga->dac_hwcursor_on--;
+        if (svga->dac_hwcursor_on && svga->interlace)
+            svga->dac_hwcursor_on--;
+    }
+
+    if (svga->hwcursor_on) {
+        if (!svga->override && svga->hwcursor_draw)
+            svga_cursor_capture(svga, svga->hwcursor_draw, &svga->hwcursor_latch,
+                                (svga->displine + svga->y_add + ((svga->hwcursor_latch.y >= 0) ? 0 : svga->hwcursor_latch.y)) & 2047);
+        svga->hwcursor_on--;
+        if (svga->hwcursor_on && svga->interlace)
+            svga->hwcursor_on--;
+    }
+}
+
 static void
 svga_do_render(svga_t *svga)
 {
+    if (svga->cursor_layer_on)
+        svga_cursor_layer_line(svga);
+
+    if (svga->render_queue) {
+        if (!svga->dpms && !svga->override && !svga->overlay_on &&
+            (svga->cursor_layer_on || (!svga->dac_hwcursor_on && !svga->hwcursor_on))) {
+            svga_render_queue_line(svga);
+            svga->x_add = (svga->monitor->mon_overscan_x >> 1) - svga->scrollcache;
+            return;
+        }
+
+        svga_render_flush(svga);
+    }
+
     /* Always render a blank screen and nothing else while in DPMS mode. */
     if (svga->dpms) {
         svga_render_blank(svga);
@@ -1190,6 +1564,9 @@ svga_do_render(svga_t *svga)
             svga->overlay_on--;
     }
 
+    if (svga->cursor_layer_on)
+        return;
+
     if (svga->dac_hwcursor_on) {
         if (!svga->override && svga->dac_hwcursor_draw)
             svga->dac_hwcursor_draw(svga, (svga->displine + svga->y_add + ((svga->dac_hwcursor_latch.y >= 0) ? 0 : svga->dac_hwcursor_latch.y)) & 2047);
@@ -1208,16 +1585,18 @@ svga_do_render(svga_t *svga)
     }
 }
 
-void
-svga_poll(void *priv)
+/* One half of a scanline of the CRTC state machine, due at poll_ts. */
+static void
+svga_poll_phase(svga_t *svga)
 {
-    svga_t    *svga = (svga_t *) priv;
     uint32_t   x;
     uint32_t   blink_delay;
     int        wx;
     int        wy;
     int        ret;
     int        old_ma;
+    int        y_off;
+    int        prev = perf_enter(PERF_VIDEO);
 
     svga_log("SVGA Poll.\n");
     if (!svga->linepos) {
@@ -1251,7 +1630,7 @@ svga_poll(void *priv)
             svga->overlay_oddeven = 1;
         }
 
-        timer_advance_u64(&svga->timer, svga->dispofftime);
+        svga->poll_ts += svga->dispofftime;
         svga->cgastat |= 1;
         svga->linepos = 1;
 
@@ -1264,7 +1643,8 @@ svga_poll(void *priv)
                 video_wait_for_buffer_monitor(svga->monitor_index);
             }
 
-            if (svga->hwcursor_on || svga->dac_hwcursor_on || svga->overlay_on)
+            /* Cursors in the presenter's layer leave the lines below alone. */
+            if (svga->overlay_on || (!svga->cursor_layer_on && (svga->hwcursor_on || svga->dac_hwcursor_on)))
                 svga->changedvram[svga->ma >> 12] = svga->changedvram[(svga->ma >> 12) + 1] = svga->interlace ? 3 : 2;
 
             if (svga->vertical_linedbl) {
@@ -1299,7 +1679,7 @@ svga_poll(void *priv)
         if (svga->displine > 2000)
             svga->displine = 0;
     } else {
-        timer_advance_u64(&svga->timer, svga->dispontime);
+        svga->poll_ts += svga->dispontime;
 
         if (svga->dispon)
             svga->cgastat &= ~1;
@@ -1334,8 +1714,10 @@ svga_poll(void *priv)
 
         svga->hsync_divisor ^= 1;
 
-        if (svga->hsync_divisor && (svga->crtc[0x17] & 4))
+        if (svga->hsync_divisor && (svga->crtc[0x17] & 4)) {
+            perf_leave(prev);
             return;
+        }
 
         svga->vc++;
         svga->vc &= 0x7ff;
@@ -1363,6 +1745,8 @@ svga_poll(void *priv)
             }
         }
         if (svga->vc == svga->dispend) {
+            svga_render_flush(svga);
+
             if (svga->vblank_start)
                 svga->vblank_start(svga);
 
@@ -1389,6 +1773,9 @@ svga_poll(void *priv)
                 svga->fullchange--;
         }
         if (svga->vc == svga->vsyncstart) {
+            MTR_BEGIN("video", "svga_frame");
+            svga_render_flush(svga);
+
             svga->dispon = 0;
             svga->cgastat |= 8;
             x = svga->hdisp;
@@ -1400,7 +1787,19 @@ svga_poll(void *priv)
 
             wx = x;
 
+            if (svga->cursor_layer_on)
+                svga_cursor_layer_publish(svga);
+
             if (!svga->override) {
+                /* Only the rendered lines changed, unless the border had to be redrawn as well. */
+                if (!svga->fullchange && !svga->dpms) {
+                    y_off = svga->y_add << (svga->vertical_linedbl ? 1 : 0);
+                    if (svga->firstline_draw == 2000)
+                        video_blit_damage_monitor(0, 0, svga->monitor_index);
+                    else
+                        video_blit_damage_monitor(svga->firstline_draw + y_off, svga->lastline_draw + y_off + 1, svga->monitor_index);
+                }
+
                 if (svga->vertical_linedbl) {
                     wy = (svga->lastline - svga->firstline) << 1;
                     svga->vdisp = wy + 1;
@@ -1437,6 +1836,7 @@ svga_poll(void *priv)
 
             if (svga->vsync_callback)
                 svga->vsync_callback(svga);
+            MTR_END("video", "svga_frame");
         }
 #if 0
         if (svga->vc == lines_num) {
@@ -1476,10 +1876,160 @@ svga_poll(void *priv)
 
             svga->overlay_on    = 0;
             svga->overlay_latch = svga->overlay;
+
+            svga_cursor_layer_select(svga);
+
+            if (svga->poll_quiet < 2)
+                svga->poll_quiet++;
         }
         if (svga->sc == (svga->crtc[10] & 31))
             svga->con = 1;
     }
+
+    perf_leave(prev);
+}
+
+/* Run every phase due by the given time, returns how many ran. */
+static int
+svga_poll_run(svga_t *svga, uint64_t until)
+{
+    int n = 0;
+
+    svga->poll_running = 1;
+    while (((int64_t) (svga->poll_ts - until) <= 0) && (n < SVGA_BATCH_MAX_PHASES)) {
+        svga_poll_phase(svga);
+        n++;
+    }
+    svga->poll_running = 0;
+
+    return n;
+}
+
+/* Whole lines the phases after the next one can be left to run late. The
+   lines where the vertical counter reaches the split, display end, vertical
+   sync or total do things other devices see, so they always run from the
+   timer, as does everything after a frame that had register writes. */
+static int
+svga_poll_batch_lines(svga_t *svga)
+{
+    const int targets[4] = { svga->split, svga->dispend, svga->vsyncstart, svga->vtotal };
+    int       lines      = 0x800;
+
+    if (!video_batch_lines || (svga->poll_quiet < 2) || (svga->crtc[0x17] & 4) ||
+        (svga->timer.callback != svga_poll))
+        return 0;
+
+    for (uint8_t i = 0; i < 4; i++) {
+        if (targets[i] > svga->vc)
+            lines = MIN(lines, targets[i] - svga->vc);
+    }
+    if (lines == 0x800)
+        return 0;
+
+    /* The line that reaches the target is the one the timer runs. */
+    lines--;
+
+    return (lines >= SVGA_BATCH_MIN_LINES) ? lines : 0;
+}
+
+/* Arm the timer for the next phase, or for the end of a batch of lines
+   whose phases then run all at once, or earlier through svga_poll_sync(). */
+static void
+svga_poll_schedule(svga_t *svga)
+{
+    const int lines = svga_poll_batch_lines(svga);
+    uint64_t  ts    = svga->poll_ts;
+
+    svga->poll_batch = (lines > 0);
+    if (svga->poll_batch)
+        ts += (svga->linepos ? 0 : svga->dispofftime) + (lines * (svga->dispontime + svga->dispofftime));
+
+    svga->timer.ts.ts64 = ts;
+    timer_enable(&svga->timer);
+}
+
+/* Catch the CRTC state up with the current time while lines are batched,
+   for anything that is about to look at it. */
+void
+svga_poll_sync(svga_t *svga)
+{
+    if (!svga->poll_batch || svga->poll_running || (svga->timer.callback != svga_poll))
+        return;
+
+    if (svga_poll_run(svga, (uint64_t) tsc << 32))
+        svga_poll_schedule(svga);
+}
+
+/* A register write ends batching until a frame goes by without one, as the
+   guest may be doing raster effects. */
+static void
+svga_poll_write(svga_t *svga)
+{
+    svga->poll_quiet = 0;
+
+    if (svga->poll_batch && !svga->poll_running && (svga->timer.callback == svga_poll)) {
+        svga->poll_batch    = 0;
+        svga->timer.ts.ts64 = svga->poll_ts;
+        timer_enable(&svga->timer);
+    }
+}
+
+void
+svga_poll(void *priv)
+{
+    svga_t        *svga = (svga_t *) priv;
+    const uint64_t now  = svga->timer.ts.ts64;
+
+    if (!svga->poll_batch)
+        svga->poll_ts = now;
+
+    svga_poll_run(svga, now);
+    svga_poll_schedule(svga);
+}
+
+/* The generic state of the card: the CRTC, sequencer, GDC, attribute and DAC
+   registers, the latches and the video memory. Cards that extend svga_t, or
+   have their own RAMDAC or clock chip, put their state after this. */
+void
+svga_save(svga_t *svga, snapshot_t *s)
+{
+    /* Run the batched lines and unbatch, so the timer is due at poll_ts. */
+    svga_poll_sync(svga);
+    svga_poll_write(svga);
+
+    snapshot_write(s, &svga->fast, offsetof(svga_t, map8) - offsetof(svga_t, fast));
+    snapshot_write(s, svga->pallook, offsetof(svga_t, timer) - offsetof(svga_t, pallook));
+    snapshot_write_timer(s, &svga->timer);
+    snapshot_write(s, &svga->clock, sizeof(svga->clock));
+    snapshot_write(s, &svga->hwcursor, offsetof(svga_t, render) - offsetof(svga_t, hwcursor));
+    snapshot_write(s, svga->crtc, offsetof(svga_t, vram) - offsetof(svga_t, crtc));
+    snapshot_write(s, &svga->crtcreg, offsetof(svga_t, remap_required) - offsetof(svga_t, crtcreg));
+    snapshot_write(s, svga->vram, svga->vram_max);
+}
+
+int
+svga_load(svga_t *svga, snapshot_t *s)
+{
+    if (!snapshot_read(s, &svga->fast, offsetof(svga_t, map8) - offsetof(svga_t, fast)) ||
+        !snapshot_read(s, svga->pallook, offsetof(svga_t, timer) - offsetof(svga_t, pallook)) ||
+        !snapshot_read_timer(s, &svga->timer) ||
+        !snapshot_read(s, &svga->clock, sizeof(svga->clock)) ||
+        !snapshot_read(s, &svga->hwcursor, offsetof(svga_t, render) - offsetof(svga_t, hwcursor)) ||
+        !snapshot_read(s, svga->crtc, offsetof(svga_t, vram) - offsetof(svga_t, crtc)) ||
+        !snapshot_read(s, &svga->crtcreg, offsetof(svga_t, remap_required) - offsetof(svga_t, crtcreg)) ||
+        !snapshot_read(s, svga->vram, svga->vram_max))
+        return 0;
+
+    svga->poll_batch = 0;
+    svga->poll_quiet = 0;
+
+    svga_set_memory_map(svga, svga->gdcreg[6]);
+    svga_recalctimings(svga);
+
+    memset(svga->changedvram, svga->monitor->mon_changeframecount, (svga->vram_max >> 12) + 1);
+    svga->fullchange = svga->monitor->mon_changeframecount;
+
+    return 1;
 }
 
 uint32_t
@@ -1529,6 +2079,7 @@ svga_init(const device_t *info, svga_t *svga, void *priv, int memsize,
     svga->vram_display_mask = svga->vram_mask = memsize - 1;
     svga->decode_mask                         = 0x7fffff;
     svga->changedvram                         = calloc((memsize >> 12) + 1, 1);
+    svga->glyph_cache                         = calloc(GLYPH_CACHE_SIZE, sizeof(glyph_row_t));
     svga->recalctimings_ex                    = recalctimings_ex;
     svga->video_in                            = video_in;
     svga->video_out                           = video_out;
@@ -1594,12 +2145,26 @@ svga_init(const device_t *info, svga_t *svga, void *priv, int memsize,
 
     svga->map8            = svga->pallook;
 
+    if (video_render_thread)
+        svga_render_queue_init(svga);
+
     return 0;
 }
 
 void
 svga_close(svga_t *svga)
 {
+    svga_render_queue_close(svga);
+
+    /* Do not leave the presenter showing this card's cursor. */
+    if (svga->cursor_layer_on) {
+        svga->cursor_layer->x = svga->cursor_layer->y = svga->cursor_layer->w = svga->cursor_layer->h = 0;
+        video_cursor_layer_update(svga->monitor_index, svga->cursor_layer);
+    }
+    free(svga->cursor_layer);
+    free(svga->cursor_lines);
+
+    free(svga->glyph_cache);
     free(svga->changedvram);
     free(svga->vram);
 
@@ -29,6 +29,28 @@
 #include <86box/vid_svga.h>
 #include <86box/vid_svga_render.h>
 #include <86box/vid_svga_render_remap.h>
+#include <86box/vid_glyph_cache.h>
+#include <86box/vid_planar.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#    define SVGA_RENDER_SSE2
+#    include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#    define SVGA_RENDER_NEON
+#    include <arm_neon.h>
+#endif
+
+/* Renderer templates, instantiated with constant mode arguments. */
+#define SVGA_INLINE __attribute__((always_inline)) static inline
+
+static __inline uint32_t
+svga_lut_ram_map(const svga_t *svga, uint32_t val)
+{
+    uint8_t r = getcolr(svga->pallook[getcolr(val)]);
+    uint8_t g = getcolg(svga->pallook[getcolg(val)]);
+    uint8_t b = getcolb(svga->pallook[getcolb(val)]);
+    return makecol32(r, g, b) | (val & 0xFF000000);
+}
 
 uint32_t
 svga_lookup_lut_ram(svga_t* svga, uint32_t val)
@@ -36,13 +58,98 @@ svga_lookup_lut_ram(svga_t* svga, uint32_t val)
     if (!svga->lut_map)
         return val;
 
-    uint8_t r = getcolr(svga->pallook[getcolr(val)]);
-    uint8_t g = getcolg(svga->pallook[getcolg(val)]);
-    uint8_t b = getcolb(svga->pallook[getcolb(val)]);
-    return makecol32(r, g, b) | (val & 0xFF000000);
+    return svga_lut_ram_map(svga, val);
+}
+
+/*
+ * The direct colour renderers that can go through the LUT RAM are built
+ * twice, the lut argument of their template is constant in each.
+ */
+#define lookup_lut(val) (lut ? svga_lut_ram_map(svga, val) : (val))
+
+#define SVGA_LUT_VARIANTS(name)      \
+    void                             \
+    name(svga_t *svga)               \
+    {                                \
+        if (svga->lut_map)           \
+            name##_tpl(svga, true);  \
+        else                         \
+            name##_tpl(svga, false); \
+    }
+
+/*
+ * Whole line converters for the direct colour modes, used when the line
+ * can be read from VRAM without wrapping, no remapping is needed and
+ * the RAMDAC does not do anything special. They give the same results
+ * as the per-pixel loops in the renderers, which remain the reference
+ * and handle every other case.
+ */
+static __inline int
+svga_line_fits(const svga_t *svga, uint32_t bytes)
+{
+    return ((svga->ma & svga->vram_display_mask) + bytes) <= (svga->vram_display_mask + 1);
+}
+
+/* Number of pixels the unrolled loops below render for a line. */
+static __inline int
+svga_line_pixels(const svga_t *svga, int unroll)
+{
+    return (((svga->hdisp + svga->scrollcache) / unroll) + 1) * unroll;
+}
+
+/*
+ * The 15/16bpp conversion is a table lookup, which does not vectorise
+ * without gathers, but doing it here saves the indirect conv_16to32()
+ * call per pixel.
+ */
+static void
+svga_line_16to32(uint32_t *p, const uint8_t *src, int count, const uint32_t *table)
+{
+    for (int x = 0; x < count; x++, src += 2)
+        p[x] = table[src[0] | (src[1] << 8)];
 }
 
-#define lookup_lut(val) svga_lookup_lut_ram(svga, val)
+static void
+svga_line_24to32(uint32_t *p, const uint8_t *src, int count)
+{
+    int x = 0;
+
+#if defined(SVGA_RENDER_SSE2)
+    /* Shift pixel n left by n bytes, into its own dword. */
+    const __m128i m0 = _mm_set_epi32(0, 0, 0, 0x00ffffff);
+    const __m128i m1 = _mm_set_epi32(0, 0, 0x00ffffff, 0);
+    const __m128i m2 = _mm_set_epi32(0, 0x00ffffff, 0, 0);
+    const __m128i m3 = _mm_set_epi32(0x00ffffff, 0, 0, 0);
+
+    for (; (x + 4) <= count; x += 4, src += 12) {
+        uint32_t hi;
+        __m128i  v;
+        __m128i  r;
+
+        memcpy(&hi, &src[8], 4);
+        v = _mm_or_si128(_mm_loadl_epi64((const __m128i *) src), _mm_slli_si128(_mm_cvtsi32_si128((int) hi), 8));
+        r = _mm_and_si128(v, m0);
+        r = _mm_or_si128(r, _mm_and_si128(_mm_slli_si128(v, 1), m1));
+        r = _mm_or_si128(r, _mm_and_si128(_mm_slli_si128(v, 2), m2));
+        r = _mm_or_si128(r, _mm_and_si128(_mm_slli_si128(v, 3), m3));
+        _mm_storeu_si128((__m128i *) &p[x], r);
+    }
+#elif defined(SVGA_RENDER_NEON)
+    for (; (x + 16) <= count; x += 16, src += 48) {
+        const uint8x16x3_t v = vld3q_u8(src);
+        uint8x16x4_t       o;
+
+        o.val[0] = v.val[0];
+        o.val[1] = v.val[1];
+        o.val[2] = v.val[2];
+        o.val[3] = vdupq_n_u8(0x00);
+        vst4q_u8((uint8_t *) &p[x], o);
+    }
+#endif
+
+    for (; x < count; x++, src += 3)
+        p[x] = src[0] | (src[1] << 8) | (src[2] << 16);
+}
 
 void
 svga_render_null(svga_t *svga)
@@ -132,10 +239,24 @@ svga_render_overscan_right(svga_t *svga)
         *line_ptr++ = svga->overscan_color;
 }
 
+/*Nine dot pattern of a character row, the ninth column repeats the last font
+  bit for the line graphics characters*/
+static __inline uint32_t
+svga_glyph_bits(svga_t *svga, uint8_t chr, uint8_t dat)
+{
+    uint32_t bits = dat << 1;
+
+    if (((chr & ~0x1f) == 0xc0) && (svga->attrregs[0x10] & 4))
+        bits |= dat & 1;
+
+    return bits;
+}
+
 void
 svga_render_text_40(svga_t *svga)
 {
     uint32_t *p;
+    uint32_t *pix;
     int       xx;
     int       drawcursor;
     int       xinc;
@@ -150,11 +271,11 @@ svga_render_text_40(svga_t *svga)
     if ((svga->displine + svga->y_add) < 0)
         return;
 
-    if (svga->firstline_draw == 2000)
-        svga->firstline_draw = svga->displine;
-    svga->lastline_draw = svga->displine;
-
     if (svga->fullchange) {
+        if (svga->firstline_draw == 2000)
+            svga->firstline_draw = svga->displine;
+        svga->lastline_draw = svga->displine;
+
         p    = &svga->monitor->target_buffer->line[svga->displine + svga->y_add][svga->x_add];
         xinc = (svga->seqregs[1] & 1) ? 16 : 18;
 
@@ -192,17 +313,9 @@ svga_render_text_40(svga_t *svga)
             }
 
             dat = svga->vram[charaddr + (svga->sc << 2)];
-            if (svga->seqregs[1] & 1) {
-                for (xx = 0; xx < 16; xx += 2)
-                    p[xx] = p[xx + 1] = (dat & (0x80 >> (xx >> 1))) ? fg : bg;
-            } else {
-                for (xx = 0; xx < 16; xx += 2)
-                    p[xx] = p[xx + 1] = (dat & (0x80 >> (xx >> 1))) ? fg : bg;
-                if ((chr & ~0x1f) != 0xc0 || !(svga->attrregs[0x10] & 4))
-                    p[16] = p[17] = bg;
-                else
-                    p[16] = p[17] = (dat & 1) ? fg : bg;
-            }
+            pix = glyph_cache_lookup(svga->glyph_cache, svga_glyph_bits(svga, chr, dat), fg, bg);
+            for (xx = 0; xx < xinc; xx += 2)
+                p[xx] = p[xx + 1] = pix[xx >> 1];
             svga->ma += 4;
             p += xinc;
         }
@@ -214,7 +327,7 @@ void
 svga_render_text_80(svga_t *svga)
 {
     uint32_t *p;
-    int       xx;
+    uint32_t *pix;
     int       drawcursor;
     int       xinc;
     uint8_t   chr;
@@ -228,11 +341,11 @@ svga_render_text_80(svga_t *svga)
     if ((svga->displine + svga->y_add) < 0)
         return;
 
-    if (svga->firstline_draw == 2000)
-        svga->firstline_draw = svga->displine;
-    svga->lastline_draw = svga->displine;
-
     if (svga->fullchange) {
+        if (svga->firstline_draw == 2000)
+            svga->firstline_draw = svga->displine;
+        svga->lastline_draw = svga->displine;
+
         p    = &svga->monitor->target_buffer->line[svga->displine + svga->y_add][svga->x_add];
         xinc = (svga->seqregs[1] & 1) ? 8 : 9;
 
@@ -269,17 +382,8 @@ svga_render_text_80(svga_t *svga)
             }
 
             dat = svga->vram[charaddr + (svga->sc << 2)];
-            if (svga->seqregs[1] & 1) {
-                for (xx = 0; xx < 8; xx++)
-                    p[xx] = (dat & (0x80 >> xx)) ? fg : bg;
-            } else {
-                for (xx = 0; xx < 8; xx++)
-                    p[xx] = (dat & (0x80 >> xx)) ? fg : bg;
-                if ((chr & ~0x1F) != 0xC0 || !(svga->attrregs[0x10] & 4))
-                    p[8] = bg;
-                else
-                    p[8] = (dat & 1) ? fg : bg;
-            }
+            pix = glyph_cache_lookup(svga->glyph_cache, svga_glyph_bits(svga, chr, dat), fg, bg);
+            memcpy(p, pix, xinc * sizeof(uint32_t));
             svga->ma += 4;
             p += xinc;
         }
@@ -306,11 +410,11 @@ svga_render_text_80_ksc5601(svga_t *svga)
     if ((svga->displine + svga->y_add) < 0)
         return;
 
-    if (svga->firstline_draw == 2000)
-        svga->firstline_draw = svga->displine;
-    svga->lastline_draw = svga->displine;
-
     if (svga->fullchange) {
+        if (svga->firstline_draw == 2000)
+            svga->firstline_draw = svga->displine;
+        svga->lastline_draw = svga->displine;
+
         p = &svga->monitor->target_buffer->line[svga->displine + svga->y_add][svga->x_add];
 
         xinc = (svga->seqregs[1] & 1) ? 8 : 9;
@@ -669,10 +773,29 @@ svga_render_2bpp_headland_highres(svga_t *svga)
     }
 }
 
-static void
-svga_render_indexed_gfx(svga_t *svga, bool highres, bool combine8bits)
+/*
+ * The paletted renderer is instantiated once for every combination of
+ * pixel format, dot doubling and address generation below, so that the
+ * per character and per pixel work does not keep testing mode bits that
+ * only change between lines.
+ */
+enum {
+    SVGA_PIX_PLANAR = 0, /* 16 colours, plain planar data */
+    SVGA_PIX_PAL4,       /* 16 colours, shifted or chained loads */
+    SVGA_PIX_ATI,        /* ATI 4 colour */
+    SVGA_PIX_ATI8,       /* ATI 4 colour, 8bpp addressing */
+    SVGA_PIX_PACKED4,    /* ATI packed 4bpp */
+    SVGA_PIX_PAL8,       /* 256 colours */
+    SVGA_PIX_COUNT
+};
+
+SVGA_INLINE void
+svga_render_indexed_tpl(svga_t *svga, const bool highres, const int kind, const bool linear)
 {
-    int       x;
+    const bool combine8bits = (kind == SVGA_PIX_ATI8) || (kind == SVGA_PIX_PACKED4) || (kind == SVGA_PIX_PAL8);
+    const bool ati_4color   = (kind == SVGA_PIX_ATI) || (kind == SVGA_PIX_ATI8);
+    const bool planar       = (kind == SVGA_PIX_PLANAR);
+    int        x;
     uint32_t  addr;
     uint32_t *p;
     uint32_t  changed_offset;
@@ -747,13 +870,22 @@ svga_render_indexed_gfx(svga_t *svga, bool highres, bool combine8bits)
         svga->firstline_draw = svga->displine;
     svga->lastline_draw = svga->displine;
 
+    /* The 16 colour palette only changes between lines, so resolve it once. */
+    uint32_t pal[16];
+    if (!combine8bits && !ati_4color) {
+        for (int c = 0; c < 16; c++)
+            pal[c] = svga->pallook[svga->egapal[c] & svga->dac_mask];
+    }
+
     uint32_t incr_counter = 0;
     uint32_t load_counter = 0;
     uint32_t edat         = 0;
     for (x = 0; x <= (svga->hdisp + svga->scrollcache); x += charwidth) {
         if (load_counter == 0) {
             /* Find our address */
-            if (svga->force_old_addr) {
+            if (linear)
+                addr = svga->ma;
+            else if (svga->force_old_addr) {
                 addr = ((svga->ma & ~0x3) << incbypow2);
 
                 if (incbypow2 == 2) {
@@ -785,15 +917,18 @@ svga_render_indexed_gfx(svga_t *svga, bool highres, bool combine8bits)
             addr &= svga->vram_display_mask;
 
             /* Load VRAM */
-            edat = *(uint32_t *) &svga->vram[addr];
+            if (planar)
+                edat = planar_to_chunky(&svga->vram[addr]);
+            else
+                edat = *(uint32_t *) &svga->vram[addr];
 
             /*
                EGA and VGA actually use 4bpp planar as its native format.
                But 4bpp chunky is generally easier to deal with on a modern CPU.
                shift4bit is the native format for this renderer (4bpp chunky).
              */
-            if (svga->ati_4color || !shift4bit) {
-                if (shift2bit && !svga->ati_4color) {
+            if (!planar && (ati_4color || !shift4bit)) {
+                if (shift2bit && !ati_4color) {
                     /* Group 2x 2bpp values into 4bpp values */
                     edat = (edat & 0xCCCC3333) | ((edat << 14) & 0x33330000) | ((edat >> 14) & 0x0000CCCC);
                 } else {
@@ -844,7 +979,13 @@ svga_render_indexed_gfx(svga_t *svga, bool highres, bool combine8bits)
          */
         out_edat = ((out_edat & planemask & ~blinkmask) | ((out_edat | ~planemask) & blinkmask & blinkval)) ^ blinkmask;
 
-        for (int i = 0; i < (8 + (svga->ati_4color ? 8 : 0)); i += (svga->ati_4color ? 4 : 2)) {
+        if (planar) {
+            planar_write8(p, out_edat, pal, dotwidth);
+            p += charwidth;
+            continue;
+        }
+
+        for (int i = 0; i < (8 + (ati_4color ? 8 : 0)); i += (ati_4color ? 4 : 2)) {
             /*
                c0 denotes the first 4bpp pixel shifted, while c1 denotes the second.
                For 8bpp modes, the first 4bpp pixel is the upper 4 bits.
@@ -854,7 +995,7 @@ svga_render_indexed_gfx(svga_t *svga, bool highres, bool combine8bits)
             uint32_t c1 = (out_edat >> (current_shift & 0x1C)) & 0xF;
             current_shift >>= 3;
 
-            if (svga->ati_4color) {
+            if (ati_4color) {
                 uint32_t  q[4];
                 q[0]      = svga->pallook[svga->egapal[(c0 & 0x0c) >> 2]];
                 q[1]      = svga->pallook[svga->egapal[c0 & 0x03]];
@@ -867,7 +1008,7 @@ svga_render_indexed_gfx(svga_t *svga, bool highres, bool combine8bits)
                         p[outoffs + subx + (dotwidth * ch)] = q[ch];
                 }
             } else if (combine8bits) {
-                if (svga->packed_4bpp) {
+                if (kind == SVGA_PIX_PACKED4) {
                     uint32_t  p0      = svga->map8[c0 & svga->dac_mask];
                     uint32_t  p1      = svga->map8[c1 & svga->dac_mask];
                     const int outoffs = i << dwshift;
@@ -883,8 +1024,8 @@ svga_render_indexed_gfx(svga_t *svga, bool highres, bool combine8bits)
                         p[outoffs + subx] = p0;
                 }
             } else {
-                uint32_t  p0      = svga->pallook[svga->egapal[c0] & svga->dac_mask];
-                uint32_t  p1      = svga->pallook[svga->egapal[c1] & svga->dac_mask];
+                uint32_t  p0      = pal[c0];
+                uint32_t  p1      = pal[c1];
                 const int outoffs = i << dwshift;
                 for (int subx = 0; subx < dotwidth; subx++)
                     p[outoffs + subx] = p0;
@@ -893,7 +1034,7 @@ svga_render_indexed_gfx(svga_t *svga, bool highres, bool combine8bits)
             }
         }
 
-        if (svga->ati_4color)
+        if (ati_4color)
             p += (charwidth << 1);
             // p += charwidth;
         else
@@ -901,6 +1042,70 @@ svga_render_indexed_gfx(svga_t *svga, bool highres, bool combine8bits)
     }
 }
 
+#define SVGA_INDEXED_VARIANT(name, kind)                                   \
+    static void svga_render_indexed_##name##_lo(svga_t *svga)              \
+    {                                                                      \
+        svga_render_indexed_tpl(svga, false, kind, false);                 \
+    }                                                                      \
+    static void svga_render_indexed_##name##_hi(svga_t *svga)              \
+    {                                                                      \
+        svga_render_indexed_tpl(svga, true, kind, false);                  \
+    }                                                                      \
+    static void svga_render_indexed_##name##_lo_linear(svga_t *svga)       \
+    {                                                                      \
+        svga_render_indexed_tpl(svga, false, kind, true);                  \
+    }                                                                      \
+    static void svga_render_indexed_##name##_hi_linear(svga_t *svga)       \
+    {                                                                      \
+        svga_render_indexed_tpl(svga, true, kind, true);                   \
+    }
+
+SVGA_INDEXED_VARIANT(planar, SVGA_PIX_PLANAR)
+SVGA_INDEXED_VARIANT(pal4, SVGA_PIX_PAL4)
+SVGA_INDEXED_VARIANT(ati, SVGA_PIX_ATI)
+SVGA_INDEXED_VARIANT(ati8, SVGA_PIX_ATI8)
+SVGA_INDEXED_VARIANT(packed4, SVGA_PIX_PACKED4)
+SVGA_INDEXED_VARIANT(pal8, SVGA_PIX_PAL8)
+
+#define SVGA_INDEXED_ENTRY(name)                                                        \
+    {                                                                                   \
+        { svga_render_indexed_##name##_lo, svga_render_indexed_##name##_lo_linear },    \
+        { svga_render_indexed_##name##_hi, svga_render_indexed_##name##_hi_linear }     \
+    }
+
+/* [kind][highres][linear] */
+static void (*const svga_indexed_variants[SVGA_PIX_COUNT][2][2])(svga_t *svga) = {
+    SVGA_INDEXED_ENTRY(planar),
+    SVGA_INDEXED_ENTRY(pal4),
+    SVGA_INDEXED_ENTRY(ati),
+    SVGA_INDEXED_ENTRY(ati8),
+    SVGA_INDEXED_ENTRY(packed4),
+    SVGA_INDEXED_ENTRY(pal8)
+};
+
+/* Pick the instance for the mode the line is drawn in. */
+static void
+svga_render_indexed_gfx(svga_t *svga, bool highres, bool combine8bits)
+{
+    const bool linear = !svga->force_old_addr && !svga->remap_required;
+    int        kind;
+
+    if (svga->ati_4color)
+        kind = combine8bits ? SVGA_PIX_ATI8 : SVGA_PIX_ATI;
+    else if (combine8bits)
+        kind = svga->packed_4bpp ? SVGA_PIX_PACKED4 : SVGA_PIX_PAL8;
+    else if (!(svga->gdcreg[0x05] & 0x60) && !(svga->seqregs[0x01] & 0x14)) {
+        /*
+           Plain 16 colour planar data, loaded fresh every character clock,
+           is converted in pixel order with planar_to_chunky().
+         */
+        kind = SVGA_PIX_PLANAR;
+    } else
+        kind = SVGA_PIX_PAL4;
+
+    svga_indexed_variants[kind][highres][linear](svga);
+}
+
 /*
    Remap these to the paletted renderer
    (*, highres, combine8bits)
@@ -1374,7 +1579,12 @@ svga_render_15bpp_highres(svga_t *svga)
                 svga->firstline_draw = svga->displine;
             svga->lastline_draw = svga->displine;
 
-            if (!svga->remap_required) {
+            x = svga_line_pixels(svga, 8);
+
+            if (!svga->remap_required && (svga->conv_16to32 == svga_conv_16to32) && svga_line_fits(svga, x << 1)) {
+                svga_line_16to32(p, &svga->vram[svga->ma & svga->vram_display_mask], x, video_15to32);
+                svga->ma += x << 1;
+            } else if (!svga->remap_required) {
                 for (x = 0; x <= (svga->hdisp + svga->scrollcache); x += 8) {
                     dat  = *(uint32_t *) (&svga->vram[(svga->ma + (x << 1)) & svga->vram_display_mask]);
                     *p++ = svga->conv_16to32(svga, dat & 0xffff, 15);
@@ -1606,7 +1816,12 @@ svga_render_16bpp_highres(svga_t *svga)
                 svga->firstline_draw = svga->displine;
             svga->lastline_draw = svga->displine;
 
-            if (!svga->remap_required) {
+            x = svga_line_pixels(svga, 8);
+
+            if (!svga->remap_required && (svga->conv_16to32 == svga_conv_16to32) && svga_line_fits(svga, x << 1)) {
+                svga_line_16to32(p, &svga->vram[svga->ma & svga->vram_display_mask], x, video_16to32);
+                svga->ma += x << 1;
+            } else if (!svga->remap_required) {
                 for (x = 0; x <= (svga->hdisp + svga->scrollcache); x += 8) {
                     dat  = *(uint32_t *) (&svga->vram[(svga->ma + (x << 1)) & svga->vram_display_mask]);
                     *p++ = svga->conv_16to32(svga, dat & 0xffff, 16);
@@ -1641,8 +1856,8 @@ svga_render_16bpp_highres(svga_t *svga)
     }
 }
 
-void
-svga_render_24bpp_lowres(svga_t *svga)
+SVGA_INLINE void
+svga_render_24bpp_lowres_tpl(svga_t *svga, const bool lut)
 {
     int       x;
     uint32_t *p;
@@ -1717,8 +1932,10 @@ svga_render_24bpp_lowres(svga_t *svga)
     }
 }
 
-void
-svga_render_24bpp_highres(svga_t *svga)
+SVGA_LUT_VARIANTS(svga_render_24bpp_lowres)
+
+SVGA_INLINE void
+svga_render_24bpp_highres_tpl(svga_t *svga, const bool lut)
 {
     int       x;
     uint32_t *p;
@@ -1767,7 +1984,12 @@ svga_render_24bpp_highres(svga_t *svga)
                 svga->firstline_draw = svga->displine;
             svga->lastline_draw = svga->displine;
 
-            if (!svga->remap_required) {
+            x = svga_line_pixels(svga, 4);
+
+            if (!svga->remap_required && !lut && svga_line_fits(svga, x * 3)) {
+                svga_line_24to32(p, &svga->vram[svga->ma & svga->vram_display_mask], x);
+                svga->ma += x * 3;
+            } else if (!svga->remap_required) {
                 for (x = 0; x <= (svga->hdisp + svga->scrollcache); x += 4) {
                     dat0 = *(uint32_t *) (&svga->vram[svga->ma & svga->vram_display_mask]);
                     dat1 = *(uint32_t *) (&svga->vram[(svga->ma + 4) & svga->vram_display_mask]);
@@ -1802,8 +2024,10 @@ svga_render_24bpp_highres(svga_t *svga)
     }
 }
 
-void
-svga_render_32bpp_lowres(svga_t *svga)
+SVGA_LUT_VARIANTS(svga_render_24bpp_highres)
+
+SVGA_INLINE void
+svga_render_32bpp_lowres_tpl(svga_t *svga, const bool lut)
 {
     int       x;
     uint32_t *p;
@@ -1858,8 +2082,10 @@ svga_render_32bpp_lowres(svga_t *svga)
     }
 }
 
-void
-svga_render_32bpp_highres(svga_t *svga)
+SVGA_LUT_VARIANTS(svga_render_32bpp_lowres)
+
+SVGA_INLINE void
+svga_render_32bpp_highres_tpl(svga_t *svga, const bool lut)
 {
     int       x;
     uint32_t *p;
@@ -1915,8 +2141,10 @@ svga_render_32bpp_highres(svga_t *svga)
     }
 }
 
-void
-svga_render_ABGR8888_highres(svga_t *svga)
+SVGA_LUT_VARIANTS(svga_render_32bpp_highres)
+
+SVGA_INLINE void
+svga_render_ABGR8888_highres_tpl(svga_t *svga, const bool lut)
 {
     int       x;
     uint32_t *p;
@@ -1955,8 +2183,10 @@ svga_render_ABGR8888_highres(svga_t *svga)
     }
 }
 
-void
-svga_render_RGBA8888_highres(svga_t *svga)
+SVGA_LUT_VARIANTS(svga_render_ABGR8888_highres)
+
+SVGA_INLINE void
+svga_render_RGBA8888_highres_tpl(svga_t *svga, const bool lut)
 {
     int       x;
     uint32_t *p;
@@ -1994,3 +2224,5 @@ svga_render_RGBA8888_highres(svga_t *svga)
         svga->ma &= svga->vram_display_mask;
     }
 }
+
+SVGA_LUT_VARIANTS(svga_render_RGBA8888_highres)
@@ -37,6 +37,7 @@
 #include <86box/vid_colorplus.h>
 #include <86box/vid_mda.h>
 #include <86box/vid_xga_device.h>
+#include <86box/name_index.h>
 
 typedef struct video_card_t {
     const device_t *device;
@@ -287,10 +288,7 @@ static void
 video_prepare(void)
 {
     /* Reset (deallocate) the video font arrays. */
-    if (fontdatksc5601) {
-        free(fontdatksc5601);
-        fontdatksc5601 = NULL;
-    }
+    video_free_ksc5601();
 
     /* Reset the blend. */
     herc_blend = 0;
@@ -421,18 +419,20 @@ video_get_internal_name(int card)
     return device_get_internal_name(video_cards[card].device);
 }
 
+static const char *
+video_index_name(int card)
+{
+    return (video_cards[card].device != NULL) ? video_cards[card].device->internal_name : NULL;
+}
+
+static name_index_t video_index = NAME_INDEX_INIT(video_index_name);
+
 int
 video_get_video_from_internal_name(char *s)
 {
-    int c = 0;
-
-    while (video_cards[c].device != NULL) {
-        if (!strcmp(video_cards[c].device->internal_name, s))
-            return c;
-        c++;
-    }
+    int c = name_index_find(&video_index, s);
 
-    return 0;
+    return (c >= 0) ? c : 0;
 }
 
 int
@@ -69,6 +69,8 @@
 #include <86box/device.h>
 #include "cpu.h"
 #include <86box/plat.h>
+#include <86box/thread.h>
+#include <86box/spsc.h>
 #include <86box/video.h>
 #include <86box/i2c.h>
 #include <86box/vid_ddc.h>
@@ -85,6 +87,33 @@
 #define EXT_CTRL_MONO_TRANSPARENT 0x04
 #define EXT_CTRL_LATCH_COPY       0x08
 
+#define GER_STATUS_BUSY           0x80
+
+#define FIFO_SIZE                 65536
+#define FIFO_ENTRIES              spsc_entries(&tgui->fifo_ring)
+#define FIFO_EMPTY                spsc_empty(&tgui->fifo_ring)
+
+#define FIFO_TYPE                 0xff000000
+#define FIFO_ADDR                 0x00ffffff
+
+enum {
+    FIFO_INVALID        = (0x00 << 24),
+    FIFO_WRITE_BYTE     = (0x01 << 24),
+    FIFO_WRITE_WORD     = (0x02 << 24),
+    FIFO_WRITE_DWORD    = (0x03 << 24),
+    FIFO_OUT_BYTE       = (0x04 << 24),
+    FIFO_OUT_WORD       = (0x05 << 24),
+    FIFO_OUT_DWORD      = (0x06 << 24),
+    FIFO_WRITE_FB_BYTE  = (0x07 << 24),
+    FIFO_WRITE_FB_WORD  = (0x08 << 24),
+    FIFO_WRITE_FB_DWORD = (0x09 << 24)
+};
+
+typedef struct {
+    uint32_t addr_type;
+    uint32_t val;
+} fifo_entry_t;
+
 enum {
     TGUI_9400CXI = 0,
     TGUI_9440,
@@ -168,6 +197,17 @@ typedef struct tgui_t {
     void        *i2c, *ddc;
 
     int has_bios;
+
+    fifo_entry_t fifo[FIFO_SIZE];
+    spsc_t       fifo_ring;
+
+    uint8_t fifo_thread_run;
+
+    thread_t *fifo_thread;
+    event_t  *wake_fifo_thread;
+    event_t  *fifo_not_full_event;
+
+    atomic_int blitter_busy;
 } tgui_t;
 
 video_timings_t timing_tgui_vlb = { .type = VIDEO_BUS, .write_b = 4, .write_w = 8, .write_l = 16, .read_b = 4, .read_w = 8, .read_l = 16 };
@@ -197,6 +237,20 @@ static void tgui_accel_write_fb_b(uint32_t addr, uint8_t val, void *priv);
 static void tgui_accel_write_fb_w(uint32_t addr, uint16_t val, void *priv);
 static void tgui_accel_write_fb_l(uint32_t addr, uint32_t val, void *priv);
 
+static uint8_t  tgui_read(uint32_t addr, void *priv);
+static uint16_t tgui_readw(uint32_t addr, void *priv);
+static uint32_t tgui_readl(uint32_t addr, void *priv);
+static void     tgui_write(uint32_t addr, uint8_t val, void *priv);
+static void     tgui_writew(uint32_t addr, uint16_t val, void *priv);
+static void     tgui_writel(uint32_t addr, uint32_t val, void *priv);
+
+static uint8_t  tgui_read_linear(uint32_t addr, void *priv);
+static uint16_t tgui_readw_linear(uint32_t addr, void *priv);
+static uint32_t tgui_readl_linear(uint32_t addr, void *priv);
+static void     tgui_write_linear(uint32_t addr, uint8_t val, void *priv);
+static void     tgui_writew_linear(uint32_t addr, uint16_t val, void *priv);
+static void     tgui_writel_linear(uint32_t addr, uint32_t val, void *priv);
+
 static uint8_t tgui_ext_linear_read(uint32_t addr, void *priv);
 static void    tgui_ext_linear_write(uint32_t addr, uint8_t val, void *priv);
 static void    tgui_ext_linear_writew(uint32_t addr, uint16_t val, void *priv);
@@ -214,6 +268,47 @@ dword_remap(UNUSED(svga_t *svga), uint32_t in_addr)
     return ((in_addr << 2) & 0x3fff0) | ((in_addr >> 14) & 0xc) | (in_addr & ~0x3fffc);
 }
 
+static __inline void
+wake_fifo_thread(tgui_t *tgui)
+{
+    spsc_wake(&tgui->fifo_ring); /*Wake up FIFO thread if moving from idle*/
+}
+
+static void
+tgui_wait_fifo_idle(tgui_t *tgui)
+{
+    while (!FIFO_EMPTY) {
+        wake_fifo_thread(tgui);
+        thread_wait_event(tgui->fifo_not_full_event, 1);
+    }
+}
+
+/*The drawing engine runs on the FIFO thread, so everything that looks at
+  its state or at VRAM first waits for the queued writes to complete*/
+static __inline void
+tgui_sync(tgui_t *tgui)
+{
+    if (!FIFO_EMPTY)
+        tgui_wait_fifo_idle(tgui);
+}
+
+static void
+tgui_queue(tgui_t *tgui, uint32_t addr, uint32_t val, uint32_t type)
+{
+    fifo_entry_t *fifo;
+
+    spsc_wait_below(&tgui->fifo_ring, FIFO_SIZE - 4);
+
+    fifo            = &tgui->fifo[spsc_write_pos(&tgui->fifo_ring)];
+    fifo->val       = val;
+    fifo->addr_type = (addr & FIFO_ADDR) | type;
+
+    spsc_push(&tgui->fifo_ring);
+
+    if (FIFO_ENTRIES > 0xe000 || FIFO_ENTRIES < 8)
+        wake_fifo_thread(tgui);
+}
+
 static void
 tgui_update_irqs(tgui_t *tgui)
 {
@@ -920,18 +1015,18 @@ tgui_recalcmapping(tgui_t *tgui)
                                     tgui_ext_write, tgui_ext_writew, tgui_ext_writel);
         } else if (svga->gdcreg[0x10] & EXT_CTRL_MONO_EXPANSION) {
             mem_mapping_set_handler(&tgui->linear_mapping,
-                                    svga_read_linear, svga_readw_linear, svga_readl_linear,
+                                    tgui_read_linear, tgui_readw_linear, tgui_readl_linear,
                                     tgui_ext_linear_write, tgui_ext_linear_writew, tgui_ext_linear_writel);
             mem_mapping_set_handler(&svga->mapping,
-                                    svga_read, svga_readw, svga_readl,
+                                    tgui_read, tgui_readw, tgui_readl,
                                     tgui_ext_write, tgui_ext_writew, tgui_ext_writel);
         } else {
             mem_mapping_set_handler(&tgui->linear_mapping,
-                                    svga_read_linear, svga_readw_linear, svga_readl_linear,
-                                    svga_write_linear, svga_writew_linear, svga_writel_linear);
+                                    tgui_read_linear, tgui_readw_linear, tgui_readl_linear,
+                                    tgui_write_linear, tgui_writew_linear, tgui_writel_linear);
             mem_mapping_set_handler(&svga->mapping,
-                                    svga_read, svga_readw, svga_readl,
-                                    svga_write, svga_writew, svga_writel);
+                                    tgui_read, tgui_readw, tgui_readl,
+                                    tgui_write, tgui_writew, tgui_writel);
         }
     }
 
@@ -1207,6 +1302,8 @@ tgui_ext_linear_read(uint32_t addr, void *priv)
     svga_t *svga = (svga_t *) priv;
     tgui_t *tgui = (tgui_t *) svga->priv;
 
+    tgui_sync(tgui);
+
     cycles -= svga->monitor->mon_video_timing_read_b;
 
     addr &= svga->decode_mask;
@@ -1246,6 +1343,8 @@ tgui_ext_linear_write(uint32_t addr, uint8_t val, void *priv)
     uint8_t       fg[2] = { svga->gdcreg[0x14], svga->gdcreg[0x15] };
     uint8_t       bg[2] = { svga->gdcreg[0x11], svga->gdcreg[0x12] };
 
+    tgui_sync((tgui_t *) svga->priv);
+
     cycles -= svga->monitor->mon_video_timing_write_b;
 
     addr &= svga->decode_mask;
@@ -1325,6 +1424,8 @@ tgui_ext_linear_writew(uint32_t addr, uint16_t val, void *priv)
     uint8_t       bg[2] = { svga->gdcreg[0x11], svga->gdcreg[0x12] };
     uint16_t      mask  = svga->gdcreg[0x18] | (svga->gdcreg[0x17] << 8);
 
+    tgui_sync((tgui_t *) svga->priv);
+
     cycles -= svga->monitor->mon_video_timing_write_w;
 
     addr &= svga->decode_mask;
@@ -2854,7 +2955,7 @@ tgui_accel_command(int count, uint32_t cpu_dat, tgui_t *tgui)
 }
 
 static void
-tgui_accel_out(uint16_t addr, uint8_t val, void *priv)
+tgui_accel_out_fifo(uint16_t addr, uint8_t val, void *priv)
 {
     tgui_t *tgui = (tgui_t *) priv;
     svga_t *svga = &tgui->svga;
@@ -3200,15 +3301,15 @@ tgui_accel_out(uint16_t addr, uint8_t val, void *priv)
 }
 
 static void
-tgui_accel_out_w(uint16_t addr, uint16_t val, void *priv)
+tgui_accel_out_fifo_w(uint16_t addr, uint16_t val, void *priv)
 {
     tgui_t *tgui = (tgui_t *) priv;
-    tgui_accel_out(addr, val, tgui);
-    tgui_accel_out(addr + 1, val >> 8, tgui);
+    tgui_accel_out_fifo(addr, val, tgui);
+    tgui_accel_out_fifo(addr + 1, val >> 8, tgui);
 }
 
 static void
-tgui_accel_out_l(uint16_t addr, uint32_t val, void *priv)
+tgui_accel_out_fifo_l(uint16_t addr, uint32_t val, void *priv)
 {
     tgui_t *tgui = (tgui_t *) priv;
 
@@ -3221,21 +3322,52 @@ tgui_accel_out_l(uint16_t addr, uint32_t val, void *priv)
             break;
 
         default:
-            tgui_accel_out(addr, val, tgui);
-            tgui_accel_out(addr + 1, val >> 8, tgui);
-            tgui_accel_out(addr + 2, val >> 16, tgui);
-            tgui_accel_out(addr + 3, val >> 24, tgui);
+            tgui_accel_out_fifo(addr, val, tgui);
+            tgui_accel_out_fifo(addr + 1, val >> 8, tgui);
+            tgui_accel_out_fifo(addr + 2, val >> 16, tgui);
+            tgui_accel_out_fifo(addr + 3, val >> 24, tgui);
             break;
     }
 }
 
+static void
+tgui_accel_out(uint16_t addr, uint8_t val, void *priv)
+{
+    tgui_t *tgui = (tgui_t *) priv;
+
+    tgui_queue(tgui, addr, val, FIFO_OUT_BYTE);
+}
+
+static void
+tgui_accel_out_w(uint16_t addr, uint16_t val, void *priv)
+{
+    tgui_t *tgui = (tgui_t *) priv;
+
+    tgui_queue(tgui, addr, val, FIFO_OUT_WORD);
+}
+
+static void
+tgui_accel_out_l(uint16_t addr, uint32_t val, void *priv)
+{
+    tgui_t *tgui = (tgui_t *) priv;
+
+    tgui_queue(tgui, addr, val, FIFO_OUT_DWORD);
+}
+
 static uint8_t
 tgui_accel_in(uint16_t addr, void *priv)
 {
-    const tgui_t *tgui = (tgui_t *) priv;
+    tgui_t *tgui = (tgui_t *) priv;
+
+    if (addr != 0x2120)
+        tgui_sync(tgui);
 
     switch (addr) {
         case 0x2120: /*Status*/
+            if (!FIFO_EMPTY) {
+                wake_fifo_thread(tgui);
+                return GER_STATUS_BUSY;
+            }
             return 0;
 
         case 0x2122:
@@ -3500,7 +3632,7 @@ tgui_accel_in_l(uint16_t addr, void *priv)
 }
 
 static void
-tgui_accel_write(uint32_t addr, uint8_t val, void *priv)
+tgui_accel_write_fifo(uint32_t addr, uint8_t val, void *priv)
 {
     tgui_t *tgui = (tgui_t *) priv;
     svga_t *svga = &tgui->svga;
@@ -3513,20 +3645,20 @@ tgui_accel_write(uint32_t addr, uint8_t val, void *priv)
             return;
     }
 
-    tgui_accel_out((addr & 0xff) + 0x2100, val, tgui);
+    tgui_accel_out_fifo((addr & 0xff) + 0x2100, val, tgui);
 }
 
 static void
-tgui_accel_write_w(uint32_t addr, uint16_t val, void *priv)
+tgui_accel_write_fifo_w(uint32_t addr, uint16_t val, void *priv)
 {
     tgui_t *tgui = (tgui_t *) priv;
 
-    tgui_accel_write(addr, val, tgui);
-    tgui_accel_write(addr + 1, val >> 8, tgui);
+    tgui_accel_write_fifo(addr, val, tgui);
+    tgui_accel_write_fifo(addr + 1, val >> 8, tgui);
 }
 
 static void
-tgui_accel_write_l(uint32_t addr, uint32_t val, void *priv)
+tgui_accel_write_fifo_l(uint32_t addr, uint32_t val, void *priv)
 {
     tgui_t       *tgui = (tgui_t *) priv;
     const svga_t *svga = &tgui->svga;
@@ -3547,16 +3679,40 @@ tgui_accel_write_l(uint32_t addr, uint32_t val, void *priv)
             break;
 
         default:
-            tgui_accel_write_w(addr, val, tgui);
-            tgui_accel_write_w(addr + 2, val >> 16, tgui);
+            tgui_accel_write_fifo_w(addr, val, tgui);
+            tgui_accel_write_fifo_w(addr + 2, val >> 16, tgui);
             break;
     }
 }
 
+static void
+tgui_accel_write(uint32_t addr, uint8_t val, void *priv)
+{
+    tgui_t *tgui = (tgui_t *) priv;
+
+    tgui_queue(tgui, addr, val, FIFO_WRITE_BYTE);
+}
+
+static void
+tgui_accel_write_w(uint32_t addr, uint16_t val, void *priv)
+{
+    tgui_t *tgui = (tgui_t *) priv;
+
+    tgui_queue(tgui, addr, val, FIFO_WRITE_WORD);
+}
+
+static void
+tgui_accel_write_l(uint32_t addr, uint32_t val, void *priv)
+{
+    tgui_t *tgui = (tgui_t *) priv;
+
+    tgui_queue(tgui, addr, val, FIFO_WRITE_DWORD);
+}
+
 static uint8_t
 tgui_accel_read(uint32_t addr, void *priv)
 {
-    const tgui_t *tgui = (tgui_t *) priv;
+    tgui_t       *tgui = (tgui_t *) priv;
     const svga_t *svga = &tgui->svga;
 
     if ((svga->crtc[0x36] & 0x03) == 0x02) {
@@ -3567,8 +3723,15 @@ tgui_accel_read(uint32_t addr, void *priv)
             return 0xff;
     }
 
+    if ((addr & 0xff) != 0x20)
+        tgui_sync(tgui);
+
     switch (addr & 0xff) {
         case 0x20: /*Status*/
+            if (!FIFO_EMPTY) {
+                wake_fifo_thread(tgui);
+                return GER_STATUS_BUSY;
+            }
             return 0;
 
         case 0x22:
@@ -3835,7 +3998,7 @@ tgui_accel_read_l(uint32_t addr, void *priv)
 }
 
 static void
-tgui_accel_write_fb_b(uint32_t addr, uint8_t val, void *priv)
+tgui_accel_write_fb_fifo_b(uint32_t addr, uint8_t val, void *priv)
 {
     svga_t *svga = (svga_t *) priv;
     tgui_t *tgui = (tgui_t *) svga->priv;
@@ -3847,7 +4010,7 @@ tgui_accel_write_fb_b(uint32_t addr, uint8_t val, void *priv)
 }
 
 static void
-tgui_accel_write_fb_w(uint32_t addr, uint16_t val, void *priv)
+tgui_accel_write_fb_fifo_w(uint32_t addr, uint16_t val, void *priv)
 {
     svga_t *svga = (svga_t *) priv;
     tgui_t *tgui = (tgui_t *) svga->priv;
@@ -3859,7 +4022,7 @@ tgui_accel_write_fb_w(uint32_t addr, uint16_t val, void *priv)
 }
 
 static void
-tgui_accel_write_fb_l(uint32_t addr, uint32_t val, void *priv)
+tgui_accel_write_fb_fifo_l(uint32_t addr, uint32_t val, void *priv)
 {
     svga_t *svga = (svga_t *) priv;
     tgui_t *tgui = (tgui_t *) svga->priv;
@@ -3870,6 +4033,152 @@ tgui_accel_write_fb_l(uint32_t addr, uint32_t val, void *priv)
         svga_writel_linear(addr, val, svga);
 }
 
+/*Writes to the frame buffer feed a blit from the CPU or have to land after
+  the queued ones, so they join the queue unless the engine is idle*/
+static void
+tgui_accel_write_fb_b(uint32_t addr, uint8_t val, void *priv)
+{
+    svga_t *svga = (svga_t *) priv;
+    tgui_t *tgui = (tgui_t *) svga->priv;
+
+    if (FIFO_EMPTY && !tgui->write_blitter)
+        svga_write_linear(addr, val, svga);
+    else
+        tgui_queue(tgui, addr, val, FIFO_WRITE_FB_BYTE);
+}
+
+static void
+tgui_accel_write_fb_w(uint32_t addr, uint16_t val, void *priv)
+{
+    svga_t *svga = (svga_t *) priv;
+    tgui_t *tgui = (tgui_t *) svga->priv;
+
+    if (FIFO_EMPTY && !tgui->write_blitter)
+        svga_writew_linear(addr, val, svga);
+    else
+        tgui_queue(tgui, addr, val, FIFO_WRITE_FB_WORD);
+}
+
+static void
+tgui_accel_write_fb_l(uint32_t addr, uint32_t val, void *priv)
+{
+    svga_t *svga = (svga_t *) priv;
+    tgui_t *tgui = (tgui_t *) svga->priv;
+
+    if (FIFO_EMPTY && !tgui->write_blitter)
+        svga_writel_linear(addr, val, svga);
+    else
+        tgui_queue(tgui, addr, val, FIFO_WRITE_FB_DWORD);
+}
+
+static uint8_t
+tgui_read(uint32_t addr, void *priv)
+{
+    svga_t *svga = (svga_t *) priv;
+
+    tgui_sync((tgui_t *) svga->priv);
+    return svga_read(addr, svga);
+}
+
+static uint16_t
+tgui_readw(uint32_t addr, void *priv)
+{
+    svga_t *svga = (svga_t *) priv;
+
+    tgui_sync((tgui_t *) svga->priv);
+    return svga_readw(addr, svga);
+}
+
+static uint32_t
+tgui_readl(uint32_t addr, void *priv)
+{
+    svga_t *svga = (svga_t *) priv;
+
+    tgui_sync((tgui_t *) svga->priv);
+    return svga_readl(addr, svga);
+}
+
+static void
+tgui_write(uint32_t addr, uint8_t val, void *priv)
+{
+    svga_t *svga = (svga_t *) priv;
+
+    tgui_sync((tgui_t *) svga->priv);
+    svga_write(addr, val, svga);
+}
+
+static void
+tgui_writew(uint32_t addr, uint16_t val, void *priv)
+{
+    svga_t *svga = (svga_t *) priv;
+
+    tgui_sync((tgui_t *) svga->priv);
+    svga_writew(addr, val, svga);
+}
+
+static void
+tgui_writel(uint32_t addr, uint32_t val, void *priv)
+{
+    svga_t *svga = (svga_t *) priv;
+
+    tgui_sync((tgui_t *) svga->priv);
+    svga_writel(addr, val, svga);
+}
+
+static void
+tgui_write_linear(uint32_t addr, uint8_t val, void *priv)
+{
+    svga_t *svga = (svga_t *) priv;
+
+    tgui_sync((tgui_t *) svga->priv);
+    svga_write_linear(addr, val, svga);
+}
+
+static void
+tgui_writew_linear(uint32_t addr, uint16_t val, void *priv)
+{
+    svga_t *svga = (svga_t *) priv;
+
+    tgui_sync((tgui_t *) svga->priv);
+    svga_writew_linear(addr, val, svga);
+}
+
+static void
+tgui_writel_linear(uint32_t addr, uint32_t val, void *priv)
+{
+    svga_t *svga = (svga_t *) priv;
+
+    tgui_sync((tgui_t *) svga->priv);
+    svga_writel_linear(addr, val, svga);
+}
+
+static uint8_t
+tgui_read_linear(uint32_t addr, void *priv)
+{
+    svga_t *svga = (svga_t *) priv;
+
+    tgui_sync((tgui_t *) svga->priv);
+    return svga_read_linear(addr, svga);
+}
+
+static uint16_t
+tgui_readw_linear(uint32_t addr, void *priv)
+{
+    svga_t *svga = (svga_t *) priv;
+
+    tgui_sync((tgui_t *) svga->priv);
+    return svga_readw_linear(addr, svga);
+}
+
+static uint32_t
+tgui_readl_linear(uint32_t addr, void *priv)
+{
+    svga_t *svga = (svga_t *) priv;
+
+    tgui_sync((tgui_t *) svga->priv);
+    return svga_readl_linear(addr, svga);
+}
+
 static void
 tgui_mmio_write(uint32_t addr, uint8_t val, void *priv)
 {
@@ -3982,6 +4291,58 @@ tgui_mmio_read_l(uint32_t addr, void *priv)
     return ret;
 }
 
+static void
+fifo_thread(void *param)
+{
+    tgui_t *tgui = (tgui_t *) param;
+
+    while (tgui->fifo_thread_run) {
+        thread_set_event(tgui->fifo_not_full_event);
+        spsc_park(&tgui->fifo_ring);
+        tgui->blitter_busy = 1;
+        while (!FIFO_EMPTY) {
+            fifo_entry_t *fifo = &tgui->fifo[spsc_read_pos(&tgui->fifo_ring)];
+
+            switch (fifo->addr_type & FIFO_TYPE) {
+                case FIFO_WRITE_BYTE:
+                    tgui_accel_write_fifo(fifo->addr_type & FIFO_ADDR, fifo->val, tgui);
+                    break;
+                case FIFO_WRITE_WORD:
+                    tgui_accel_write_fifo_w(fifo->addr_type & FIFO_ADDR, fifo->val, tgui);
+                    break;
+                case FIFO_WRITE_DWORD:
+                    tgui_accel_write_fifo_l(fifo->addr_type & FIFO_ADDR, fifo->val, tgui);
+                    break;
+                case FIFO_OUT_BYTE:
+                    tgui_accel_out_fifo(fifo->addr_type & FIFO_ADDR, fifo->val, tgui);
+                    break;
+                case FIFO_OUT_WORD:
+                    tgui_accel_out_fifo_w(fifo->addr_type & FIFO_ADDR, fifo->val, tgui);
+                    break;
+                case FIFO_OUT_DWORD:
+                    tgui_accel_out_fifo_l(fifo->addr_type & FIFO_ADDR, fifo->val, tgui);
+                    break;
+                case FIFO_WRITE_FB_BYTE:
+                    tgui_accel_write_fb_fifo_b(fifo->addr_type & FIFO_ADDR, fifo->val, &tgui->svga);
+                    break;
+                case FIFO_WRITE_FB_WORD:
+                    tgui_accel_write_fb_fifo_w(fifo->addr_type & FIFO_ADDR, fifo->val, &tgui->svga);
+                    break;
+                case FIFO_WRITE_FB_DWORD:
+                    tgui_accel_write_fb_fifo_l(fifo->addr_type & FIFO_ADDR, fifo->val, &tgui->svga);
+                    break;
+
+                default:
+                    break;
+            }
+
+            fifo->addr_type = FIFO_INVALID;
+            spsc_pop(&tgui->fifo_ring);
+        }
+        tgui->blitter_busy = 0;
+    }
+}
+
 static void *
 tgui_init(const device_t *info)
 {
@@ -4039,7 +4400,8 @@ tgui_init(const device_t *info)
     if (tgui->type == TGUI_9400CXI)
         svga->ramdac = device_add(&tkd8001_ramdac_device);
 
-    mem_mapping_add(&tgui->linear_mapping, 0, 0, svga_read_linear, svga_readw_linear, svga_readl_linear, tgui_accel_write_fb_b, tgui_accel_write_fb_w, tgui_accel_write_fb_l, NULL, MEM_MAPPING_EXTERNAL, svga);
+    mem_mapping_set_handler(&svga->mapping, tgui_read, tgui_readw, tgui_readl, tgui_write, tgui_writew, tgui_writel);
+    mem_mapping_add(&tgui->linear_mapping, 0, 0, tgui_read_linear, tgui_readw_linear, tgui_readl_linear, tgui_accel_write_fb_b, tgui_accel_write_fb_w, tgui_accel_write_fb_l, NULL, MEM_MAPPING_EXTERNAL, svga);
     mem_mapping_add(&tgui->accel_mapping, 0, 0, tgui_accel_read, tgui_accel_read_w, tgui_accel_read_l, tgui_accel_write, tgui_accel_write_w, tgui_accel_write_l, NULL, MEM_MAPPING_EXTERNAL, tgui);
     if (tgui->type >= TGUI_9440)
         mem_mapping_add(&tgui->mmio_mapping, 0, 0, tgui_mmio_read, tgui_mmio_read_w, tgui_mmio_read_l, tgui_mmio_write, tgui_mmio_write_w, tgui_mmio_write_l, NULL, MEM_MAPPING_EXTERNAL, tgui);
@@ -4072,6 +4434,12 @@ tgui_init(const device_t *info)
         tgui->ddc = ddc_init(i2c_gpio_get_bus(tgui->i2c));
     }
 
+    tgui->wake_fifo_thread    = thread_create_event();
+    tgui->fifo_not_full_event = thread_create_event();
+    spsc_init(&tgui->fifo_ring, FIFO_SIZE, SPSC_SPIN, tgui->wake_fifo_thread, tgui->fifo_not_full_event);
+    tgui->fifo_thread_run     = 1;
+    tgui->fifo_thread         = thread_create_role(fifo_thread, tgui, THREAD_ROLE_VIDEO);
+
     return tgui;
 }
 
@@ -4104,6 +4472,12 @@ tgui_close(void *priv)
 {
     tgui_t *tgui = (tgui_t *) priv;
 
+    tgui->fifo_thread_run = 0;
+    thread_set_event(tgui->wake_fifo_thread);
+    thread_wait(tgui->fifo_thread);
+    thread_destroy_event(tgui->fifo_not_full_event);
+    thread_destroy_event(tgui->wake_fifo_thread);
+
     svga_close(&tgui->svga);
 
     if (tgui->type >= TGUI_9440) {
@@ -30,6 +30,7 @@
 #include <86box/video.h>
 #include <86box/vid_svga.h>
 #include <86box/vid_vga.h>
+#include <86box/snapshot.h>
 
 static video_timings_t timing_vga = { .type = VIDEO_ISA, .write_b = 8, .write_w = 16, .write_l = 32, .read_b = 8, .read_w = 16, .read_l = 32 };
 static video_timings_t timing_ps1_svga_isa = { .type = VIDEO_ISA, .write_b = 6, .write_w = 8, .write_l = 16, .read_b = 6, .read_w = 8, .read_l = 16 };
@@ -218,6 +219,22 @@ vga_force_redraw(void *priv)
     vga->svga.fullchange = changeframecount;
 }
 
+static void
+vga_save(void *priv, snapshot_t *s)
+{
+    vga_t *vga = (vga_t *) priv;
+
+    svga_save(&vga->svga, s);
+}
+
+static int
+vga_load(void *priv, snapshot_t *s)
+{
+    vga_t *vga = (vga_t *) priv;
+
+    return svga_load(&vga->svga, s);
+}
+
 const device_t vga_device = {
     .name          = "IBM VGA",
     .internal_name = "vga",
@@ -229,6 +246,8 @@ const device_t vga_device = {
     .available     = vga_available,
     .speed_changed = vga_speed_changed,
     .force_redraw  = vga_force_redraw,
+    .save          = vga_save,
+    .load          = vga_load,
     .config        = NULL
 };
 
@@ -243,6 +262,8 @@ const device_t ps1vga_device = {
     .available     = NULL,
     .speed_changed = vga_speed_changed,
     .force_redraw  = vga_force_redraw,
+    .save          = vga_save,
+    .load          = vga_load,
     .config        = NULL
 };
 
@@ -257,5 +278,7 @@ const device_t ps1vga_mca_device = {
     .available     = NULL,
     .speed_changed = vga_speed_changed,
     .force_redraw  = vga_force_redraw,
+    .save          = vga_save,
+    .load          = vga_load,
     .config        = NULL
 };
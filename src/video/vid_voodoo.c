@@ -231,8 +231,8 @@ voodoo_readl(uint32_t addr, void *priv)
 
                         if (voodoo_other->swap_count > swap_count)
                             swap_count = voodoo_other->swap_count;
-                        if ((voodoo_other->fifo_write_idx - voodoo_other->fifo_read_idx) > fifo_entries)
-                            fifo_entries = voodoo_other->fifo_write_idx - voodoo_other->fifo_read_idx;
+                        if (spsc_entries(&voodoo_other->fifo_ring) > fifo_entries)
+                            fifo_entries = spsc_entries(&voodoo_other->fifo_ring);
                         if ((other_written - voodoo_other->cmd_read) || (voodoo_other->cmdfifo_depth_rd != voodoo_other->cmdfifo_depth_wr))
                             busy = 1;
                         if (!voodoo_other->voodoo_busy)
@@ -922,7 +922,9 @@ voodoo_card_init(void)
     voodoo->fb_size           = device_get_config_int("framebuffer_memory");
     voodoo->fb_mask           = (voodoo->fb_size << 20) - 1;
     voodoo->render_threads    = device_get_config_int("render_threads");
-    voodoo->odd_even_mask     = voodoo->render_threads - 1;
+    if ((voodoo->render_threads < 1) || (voodoo->render_threads > VOODOO_MAX_RENDER_THREADS) || (voodoo->render_threads & (voodoo->render_threads - 1)))
+        voodoo->render_threads = 2;
+    voodoo->odd_even_mask = voodoo->render_threads - 1;
 #ifndef NO_CODEGEN
     voodoo->use_recompiler = device_get_config_int("recompiler");
 #endif
@@ -958,46 +960,26 @@ voodoo_card_init(void)
     voodoo->tex_mem_w[0] = (uint16_t *) voodoo->tex_mem[0];
     voodoo->tex_mem_w[1] = (uint16_t *) voodoo->tex_mem[1];
 
-    for (c = 0; c < TEX_CACHE_MAX; c++) {
-        voodoo->texture_cache[0][c].data     = malloc((256 * 256 + 256 * 256 + 128 * 128 + 64 * 64 + 32 * 32 + 16 * 16 + 8 * 8 + 4 * 4 + 2 * 2) * 4);
-        voodoo->texture_cache[0][c].base     = -1; /*invalid*/
-        voodoo->texture_cache[0][c].refcount = 0;
-        if (voodoo->dual_tmus) {
-            voodoo->texture_cache[1][c].data     = malloc((256 * 256 + 256 * 256 + 128 * 128 + 64 * 64 + 32 * 32 + 16 * 16 + 8 * 8 + 4 * 4 + 2 * 2) * 4);
-            voodoo->texture_cache[1][c].base     = -1; /*invalid*/
-            voodoo->texture_cache[1][c].refcount = 0;
-        }
-    }
+    voodoo_texture_cache_init(voodoo);
 
     timer_add(&voodoo->timer, voodoo_callback, voodoo, 1);
 
     voodoo->svga     = svga_get_pri();
     voodoo->fbiInit0 = 0;
 
-    voodoo->wake_fifo_thread         = thread_create_event();
-    voodoo->wake_render_thread[0]    = thread_create_event();
-    voodoo->wake_render_thread[1]    = thread_create_event();
-    voodoo->wake_render_thread[2]    = thread_create_event();
-    voodoo->wake_render_thread[3]    = thread_create_event();
-    voodoo->wake_main_thread         = thread_create_event();
-    voodoo->fifo_not_full_event      = thread_create_event();
-    voodoo->render_not_full_event[0] = thread_create_event();
-    voodoo->render_not_full_event[1] = thread_create_event();
-    voodoo->render_not_full_event[2] = thread_create_event();
-    voodoo->render_not_full_event[3] = thread_create_event();
-    voodoo->fifo_thread_run          = 1;
-    voodoo->fifo_thread              = thread_create(voodoo_fifo_thread, voodoo);
-    voodoo->render_thread_run[0]     = 1;
-    voodoo->render_thread[0]         = thread_create(voodoo_render_thread_1, voodoo);
-    if (voodoo->render_threads >= 2) {
-        voodoo->render_thread_run[1] = 1;
-        voodoo->render_thread[1]     = thread_create(voodoo_render_thread_2, voodoo);
-    }
-    if (voodoo->render_threads == 4) {
-        voodoo->render_thread_run[2] = 1;
-        voodoo->render_thread[2]     = thread_create(voodoo_render_thread_3, voodoo);
-        voodoo->render_thread_run[3] = 1;
-        voodoo->render_thread[3]     = thread_create(voodoo_render_thread_4, voodoo);
+    voodoo->wake_fifo_thread    = thread_create_event();
+    voodoo->wake_main_thread    = thread_create_event();
+    voodoo->fifo_not_full_event = thread_create_event();
+    spsc_init(&voodoo->fifo_ring, FIFO_SIZE, SPSC_SPIN, voodoo->wake_fifo_thread, voodoo->fifo_not_full_event);
+    voodoo->fifo_thread_run     = 1;
+    voodoo->fifo_thread         = thread_create_role(voodoo_fifo_thread, voodoo, THREAD_ROLE_VIDEO);
+    for (c = 0; c < voodoo->render_threads; c++) {
+        voodoo->wake_render_thread[c]    = thread_create_event();
+        voodoo->render_not_full_event[c] = thread_create_event();
+        voodoo->render_param[c].voodoo   = voodoo;
+        voodoo->render_param[c].odd_even = c;
+        voodoo->render_thread_run[c]     = 1;
+        voodoo->render_thread[c]         = thread_create_role(voodoo_render_thread, &voodoo->render_param[c], THREAD_ROLE_VIDEO);
     }
     voodoo->swap_mutex = thread_create_mutex();
     timer_add(&voodoo->wake_timer, voodoo_wake_timer, (void *) voodoo, 0);
@@ -1073,7 +1055,9 @@ voodoo_2d3d_card_init(int type)
     voodoo->dithersub_enabled = device_get_config_int("dithersub");
     voodoo->scrfilter         = device_get_config_int("dacfilter");
     voodoo->render_threads    = device_get_config_int("render_threads");
-    voodoo->odd_even_mask     = voodoo->render_threads - 1;
+    if ((voodoo->render_threads < 1) || (voodoo->render_threads > VOODOO_MAX_RENDER_THREADS) || (voodoo->render_threads & (voodoo->render_threads - 1)))
+        voodoo->render_threads = 2;
+    voodoo->odd_even_mask = voodoo->render_threads - 1;
 #ifndef NO_CODEGEN
     voodoo->use_recompiler = device_get_config_int("recompiler");
 #endif
@@ -1083,45 +1067,25 @@ voodoo_2d3d_card_init(int type)
     /*generate filter lookup tables*/
     voodoo_generate_filter_v2(voodoo);
 
-    for (c = 0; c < TEX_CACHE_MAX; c++) {
-        voodoo->texture_cache[0][c].data     = malloc((256 * 256 + 256 * 256 + 128 * 128 + 64 * 64 + 32 * 32 + 16 * 16 + 8 * 8 + 4 * 4 + 2 * 2) * 4);
-        voodoo->texture_cache[0][c].base     = -1; /*invalid*/
-        voodoo->texture_cache[0][c].refcount = 0;
-        if (voodoo->dual_tmus) {
-            voodoo->texture_cache[1][c].data     = malloc((256 * 256 + 256 * 256 + 128 * 128 + 64 * 64 + 32 * 32 + 16 * 16 + 8 * 8 + 4 * 4 + 2 * 2) * 4);
-            voodoo->texture_cache[1][c].base     = -1; /*invalid*/
-            voodoo->texture_cache[1][c].refcount = 0;
-        }
-    }
+    voodoo_texture_cache_init(voodoo);
 
     timer_add(&voodoo->timer, voodoo_callback, voodoo, 1);
 
     voodoo->fbiInit0 = 0;
 
-    voodoo->wake_fifo_thread         = thread_create_event();
-    voodoo->wake_render_thread[0]    = thread_create_event();
-    voodoo->wake_render_thread[1]    = thread_create_event();
-    voodoo->wake_render_thread[2]    = thread_create_event();
-    voodoo->wake_render_thread[3]    = thread_create_event();
-    voodoo->wake_main_thread         = thread_create_event();
-    voodoo->fifo_not_full_event      = thread_create_event();
-    voodoo->render_not_full_event[0] = thread_create_event();
-    voodoo->render_not_full_event[1] = thread_create_event();
-    voodoo->render_not_full_event[2] = thread_create_event();
-    voodoo->render_not_full_event[3] = thread_create_event();
-    voodoo->fifo_thread_run          = 1;
-    voodoo->fifo_thread              = thread_create(voodoo_fifo_thread, voodoo);
-    voodoo->render_thread_run[0]     = 1;
-    voodoo->render_thread[0]         = thread_create(voodoo_render_thread_1, voodoo);
-    if (voodoo->render_threads >= 2) {
-        voodoo->render_thread_run[1] = 1;
-        voodoo->render_thread[1]     = thread_create(voodoo_render_thread_2, voodoo);
-    }
-    if (voodoo->render_threads == 4) {
-        voodoo->render_thread_run[2] = 1;
-        voodoo->render_thread[2]     = thread_create(voodoo_render_thread_3, voodoo);
-        voodoo->render_thread_run[3] = 1;
-        voodoo->render_thread[3]     = thread_create(voodoo_render_thread_4, voodoo);
+    voodoo->wake_fifo_thread    = thread_create_event();
+    voodoo->wake_main_thread    = thread_create_event();
+    voodoo->fifo_not_full_event = thread_create_event();
+    spsc_init(&voodoo->fifo_ring, FIFO_SIZE, SPSC_SPIN, voodoo->wake_fifo_thread, voodoo->fifo_not_full_event);
+    voodoo->fifo_thread_run     = 1;
+    voodoo->fifo_thread         = thread_create_role(voodoo_fifo_thread, voodoo, THREAD_ROLE_VIDEO);
+    for (c = 0; c < voodoo->render_threads; c++) {
+        voodoo->wake_render_thread[c]    = thread_create_event();
+        voodoo->render_not_full_event[c] = thread_create_event();
+        voodoo->render_param[c].voodoo   = voodoo;
+        voodoo->render_param[c].odd_even = c;
+        voodoo->render_thread_run[c]     = 1;
+        voodoo->render_thread[c]         = thread_create_role(voodoo_render_thread, &voodoo->render_param[c], THREAD_ROLE_VIDEO);
     }
     voodoo->swap_mutex = thread_create_mutex();
     timer_add(&voodoo->wake_timer, voodoo_wake_timer, (void *) voodoo, 0);
@@ -1249,29 +1213,18 @@ voodoo_card_close(voodoo_t *voodoo)
     voodoo->fifo_thread_run = 0;
     thread_set_event(voodoo->wake_fifo_thread);
     thread_wait(voodoo->fifo_thread);
-    voodoo->render_thread_run[0] = 0;
-    thread_set_event(voodoo->wake_render_thread[0]);
-    thread_wait(voodoo->render_thread[0]);
-    if (voodoo->render_threads >= 2) {
-        voodoo->render_thread_run[1] = 0;
-        thread_set_event(voodoo->wake_render_thread[1]);
-        thread_wait(voodoo->render_thread[1]);
-    }
-    if (voodoo->render_threads == 4) {
-        voodoo->render_thread_run[2] = 0;
-        thread_set_event(voodoo->wake_render_thread[2]);
-        thread_wait(voodoo->render_thread[2]);
-        voodoo->render_thread_run[3] = 0;
-        thread_set_event(voodoo->wake_render_thread[3]);
-        thread_wait(voodoo->render_thread[3]);
+    for (int c = 0; c < voodoo->render_threads; c++) {
+        voodoo->render_thread_run[c] = 0;
+        thread_set_event(voodoo->wake_render_thread[c]);
+        thread_wait(voodoo->render_thread[c]);
     }
     thread_destroy_event(voodoo->fifo_not_full_event);
     thread_destroy_event(voodoo->wake_main_thread);
     thread_destroy_event(voodoo->wake_fifo_thread);
-    thread_destroy_event(voodoo->wake_render_thread[0]);
-    thread_destroy_event(voodoo->wake_render_thread[1]);
-    thread_destroy_event(voodoo->render_not_full_event[0]);
-    thread_destroy_event(voodoo->render_not_full_event[1]);
+    for (int c = 0; c < voodoo->render_threads; c++) {
+        thread_destroy_event(voodoo->wake_render_thread[c]);
+        thread_destroy_event(voodoo->render_not_full_event[c]);
+    }
 
     for (uint8_t c = 0; c < TEX_CACHE_MAX; c++) {
         if (voodoo->dual_tmus)
@@ -1397,6 +1350,8 @@ static const device_config_t voodoo_config[] = {
             { .description = "1", .value = 1 },
             { .description = "2", .value = 2 },
             { .description = "4", .value = 4 },
+            { .description = "8", .value = 8 },
+            { .description = "16", .value = 16 },
             { .description = ""              }
         },
         .bios           = { { 0 } }
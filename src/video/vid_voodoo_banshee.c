@@ -42,6 +42,7 @@
 #include <86box/vid_ddc.h>
 #include <86box/vid_svga.h>
 #include <86box/vid_svga_render.h>
+#include <86box/vid_overlay.h>
 #include <86box/vid_voodoo_common.h>
 #include <86box/vid_voodoo_display.h>
 #include <86box/vid_voodoo_fb.h>
@@ -1099,11 +1100,11 @@ static uint32_t
 banshee_status(banshee_t *banshee)
 {
     voodoo_t     *voodoo       = banshee->voodoo;
-    const svga_t *svga         = &banshee->svga;
+    svga_t       *svga         = &banshee->svga;
     int           fifo_entries = FIFO_ENTRIES;
     int           swap_count   = voodoo->swap_count;
     int           written      = voodoo->cmd_written + voodoo->cmd_written_fifo;
-    int           busy         = (written - voodoo->cmd_read) || (voodoo->cmdfifo_depth_rd != voodoo->cmdfifo_depth_wr) || (voodoo->cmdfifo_depth_rd_2 != voodoo->cmdfifo_depth_wr_2) || voodoo->render_voodoo_busy[0] || voodoo->render_voodoo_busy[1] || voodoo->render_voodoo_busy[2] || voodoo->render_voodoo_busy[3] || voodoo->voodoo_busy;
+    int           busy         = (written - voodoo->cmd_read) || (voodoo->cmdfifo_depth_rd != voodoo->cmdfifo_depth_wr) || (voodoo->cmdfifo_depth_rd_2 != voodoo->cmdfifo_depth_wr_2) || voodoo_render_threads_busy(voodoo) || voodoo->voodoo_busy;
     uint32_t      ret          = 0;
 
     if (fifo_entries < 0x20)
@@ -1116,6 +1117,7 @@ banshee_status(banshee_t *banshee)
         ret |= (swap_count << 28);
     else
         ret |= (7 << 28);
+    svga_poll_sync(svga);
     if (!(svga->cgastat & 8))
         ret |= 0x40;
 
@@ -2345,12 +2347,6 @@ banshee_hwcursor_draw(svga_t *svga, int displine)
     }
 }
 
-#define CLAMP(x)                      \
-    do {                              \
-        if ((x) & ~0xff)              \
-            x = ((x) < 0) ? 0 : 0xff; \
-    } while (0)
-
 #define DECODE_RGB565(buf)                                                                                     \
     do {                                                                                                       \
         int c;                                                                                                 \
@@ -2389,109 +2385,31 @@ banshee_hwcursor_draw(svga_t *svga, int displine)
         }                                                                                                               \
     } while (0)
 
-#define DECODE_YUYV422(buf)                                      \
-    do {                                                         \
-        int c;                                                   \
-        int wp = 0;                                              \
-                                                                 \
-        for (c = 0; c < voodoo->overlay.overlay_bytes; c += 4) { \
-            uint8_t y1, y2;                                      \
-            int8_t  Cr, Cb;                                      \
-            int     dR, dG, dB;                                  \
-            int     r, g, b;                                     \
-                                                                 \
-            y1 = src[0];                                         \
-            Cr = src[1] - 0x80;                                  \
-            y2 = src[2];                                         \
-            Cb = src[3] - 0x80;                                  \
-            src += 4;                                            \
-                                                                 \
-            dR = (359 * Cr) >> 8;                                \
-            dG = (88 * Cb + 183 * Cr) >> 8;                      \
-            dB = (453 * Cb) >> 8;                                \
-                                                                 \
-            r = y1 + dR;                                         \
-            CLAMP(r);                                            \
-            g = y1 - dG;                                         \
-            CLAMP(g);                                            \
-            b = y1 + dB;                                         \
-            CLAMP(b);                                            \
-            buf[wp++] = r | (g << 8) | (b << 16);                \
-                                                                 \
-            r = y2 + dR;                                         \
-            CLAMP(r);                                            \
-            g = y2 - dG;                                         \
-            CLAMP(g);                                            \
-            b = y2 + dB;                                         \
-            CLAMP(b);                                            \
-            buf[wp++] = r | (g << 8) | (b << 16);                \
-        }                                                        \
-    } while (0)
-
-#define DECODE_UYUV422(buf)                                      \
-    do {                                                         \
-        int c;                                                   \
-        int wp = 0;                                              \
-                                                                 \
-        for (c = 0; c < voodoo->overlay.overlay_bytes; c += 4) { \
-            uint8_t y1, y2;                                      \
-            int8_t  Cr, Cb;                                      \
-            int     dR, dG, dB;                                  \
-            int     r, g, b;                                     \
-                                                                 \
-            Cr = src[0] - 0x80;                                  \
-            y1 = src[1];                                         \
-            Cb = src[2] - 0x80;                                  \
-            y2 = src[3];                                         \
-            src += 4;                                            \
-                                                                 \
-            dR = (359 * Cr) >> 8;                                \
-            dG = (88 * Cb + 183 * Cr) >> 8;                      \
-            dB = (453 * Cb) >> 8;                                \
-                                                                 \
-            r = y1 + dR;                                         \
-            CLAMP(r);                                            \
-            g = y1 - dG;                                         \
-            CLAMP(g);                                            \
-            b = y1 + dB;                                         \
-            CLAMP(b);                                            \
-            buf[wp++] = r | (g << 8) | (b << 16);                \
-                                                                 \
-            r = y2 + dR;                                         \
-            CLAMP(r);                                            \
-            g = y2 - dG;                                         \
-            CLAMP(g);                                            \
-            b = y2 + dB;                                         \
-            CLAMP(b);                                            \
-            buf[wp++] = r | (g << 8) | (b << 16);                \
-        }                                                        \
-    } while (0)
-
-#define OVERLAY_SAMPLE(buf)                                                      \
-    do {                                                                         \
-        switch (banshee->overlay_pix_fmt) {                                      \
-            case 0:                                                              \
-                break;                                                           \
-                                                                                 \
-            case OVERLAY_FMT_YUYV422:                                            \
-                DECODE_YUYV422(buf);                                             \
-                break;                                                           \
-                                                                                 \
-            case OVERLAY_FMT_UYVY422:                                            \
-                DECODE_UYUV422(buf);                                             \
-                break;                                                           \
-                                                                                 \
-            case OVERLAY_FMT_565:                                                \
-            case OVERLAY_FMT_565_DITHER:                                         \
-                if (banshee->vidProcCfg & VIDPROCCFG_OVERLAY_TILE)               \
-                    DECODE_RGB565_TILED(buf);                                    \
-                else                                                             \
-                    DECODE_RGB565(buf);                                          \
-                break;                                                           \
-                                                                                 \
-            default:                                                             \
-                fatal("Unknown overlay pix fmt %i\n", banshee->overlay_pix_fmt); \
-        }                                                                        \
+#define OVERLAY_SAMPLE(buf)                                                                                                                         \
+    do {                                                                                                                                            \
+        switch (banshee->overlay_pix_fmt) {                                                                                                         \
+            case 0:                                                                                                                                 \
+                break;                                                                                                                              \
+                                                                                                                                                    \
+            case OVERLAY_FMT_YUYV422:                                                                                                               \
+                video_overlay_yuv422(buf, src, (voodoo->overlay.overlay_bytes + 3) / 4, OVERLAY_YUV_V_FIRST | OVERLAY_YUV_BGR);                     \
+                break;                                                                                                                              \
+                                                                                                                                                    \
+            case OVERLAY_FMT_UYVY422:                                                                                                               \
+                video_overlay_yuv422(buf, src, (voodoo->overlay.overlay_bytes + 3) / 4, OVERLAY_YUV_Y_ODD | OVERLAY_YUV_V_FIRST | OVERLAY_YUV_BGR); \
+                break;                                                                                                                              \
+                                                                                                                                                    \
+            case OVERLAY_FMT_565:                                                                                                                   \
+            case OVERLAY_FMT_565_DITHER:                                                                                                            \
+                if (banshee->vidProcCfg & VIDPROCCFG_OVERLAY_TILE)                                                                                  \
+                    DECODE_RGB565_TILED(buf);                                                                                                       \
+                else                                                                                                                                \
+                    DECODE_RGB565(buf);                                                                                                             \
+                break;                                                                                                                              \
+                                                                                                                                                    \
+            default:                                                                                                                                \
+                fatal("Unknown overlay pix fmt %i\n", banshee->overlay_pix_fmt);                                                                    \
+        }                                                                                                                                           \
     } while (0)
 
 /* generate both filters for the static table here */
@@ -2767,10 +2685,7 @@ banshee_overlay_draw(svga_t *svga, int displine)
                 } else /* filter disabled by emulator option */
                 {
                     if (banshee->vidProcCfg & VIDPROCCFG_H_SCALE_ENABLE) {
-                        for (x = 0; x < svga->overlay_latch.cur_xsize; x++) {
-                            p[x] = banshee->overlay_buffer[0][src_x >> 20];
-                            src_x += voodoo->overlay.vidOverlayDudx;
-                        }
+                        video_overlay_scale(p, banshee->overlay_buffer[0], svga->overlay_latch.cur_xsize, src_x, voodoo->overlay.vidOverlayDudx, 20, UINT32_MAX);
                     } else {
                         for (x = 0; x < svga->overlay_latch.cur_xsize; x++)
                             p[x] = banshee->overlay_buffer[0][x];
@@ -2839,11 +2754,7 @@ banshee_overlay_draw(svga_t *svga, int displine)
                 } else /* filter disabled by emulator option */
                 {
                     if (banshee->vidProcCfg & VIDPROCCFG_H_SCALE_ENABLE) {
-                        for (x = 0; x < svga->overlay_latch.cur_xsize; x++) {
-                            p[x] = banshee->overlay_buffer[0][src_x >> 20];
-
-                            src_x += voodoo->overlay.vidOverlayDudx;
-                        }
+                        video_overlay_scale(p, banshee->overlay_buffer[0], svga->overlay_latch.cur_xsize, src_x, voodoo->overlay.vidOverlayDudx, 20, UINT32_MAX);
                     } else {
                         for (x = 0; x < svga->overlay_latch.cur_xsize; x++)
                             p[x] = banshee->overlay_buffer[0][x];
@@ -2854,11 +2765,7 @@ banshee_overlay_draw(svga_t *svga, int displine)
             case VIDPROCCFG_FILTER_MODE_POINT:
             default:
                 if (banshee->vidProcCfg & VIDPROCCFG_H_SCALE_ENABLE) {
-                    for (x = 0; x < svga->overlay_latch.cur_xsize; x++) {
-                        p[x] = banshee->overlay_buffer[0][src_x >> 20];
-
-                        src_x += voodoo->overlay.vidOverlayDudx;
-                    }
+                    video_overlay_scale(p, banshee->overlay_buffer[0], svga->overlay_latch.cur_xsize, src_x, voodoo->overlay.vidOverlayDudx, 20, UINT32_MAX);
                 } else {
                     for (x = 0; x < svga->overlay_latch.cur_xsize; x++)
                         p[x] = banshee->overlay_buffer[0][x];
@@ -3702,6 +3609,8 @@ static const device_config_t banshee_sgram_config[] = {
             { .description = "1", .value = 1 },
             { .description = "2", .value = 2 },
             { .description = "4", .value = 4 },
+            { .description = "8", .value = 8 },
+            { .description = "16", .value = 16 },
             { .description = ""              }
         },
         .bios           = { { 0 } }
@@ -3768,6 +3677,8 @@ static const device_config_t banshee_sgram_16mbonly_config[] = {
             { .description = "1", .value = 1 },
             { .description = "2", .value = 2 },
             { .description = "4", .value = 4 },
+            { .description = "8", .value = 8 },
+            { .description = "16", .value = 16 },
             { .description = ""              }
         },
         .bios           = { { 0 } }
@@ -3834,6 +3745,8 @@ static const device_config_t banshee_sdram_config[] = {
             { .description = "1", .value = 1 },
             { .description = "2", .value = 2 },
             { .description = "4", .value = 4 },
+            { .description = "8", .value = 8 },
+            { .description = "16", .value = 16 },
             { .description = ""              }
         },
         .bios           = { { 0 } }
@@ -29,6 +29,7 @@
 #include <86box/thread.h>
 #include <86box/video.h>
 #include <86box/vid_svga.h>
+#include <86box/vid_blit.h>
 #include <86box/vid_voodoo_common.h>
 #include <86box/vid_voodoo_banshee_blitter.h>
 #include <86box/vid_voodoo_render.h>
@@ -416,6 +417,206 @@ end_command(voodoo_t *voodoo)
     }
 }
 
+/*Row at a time fast paths for fills, copies and monochrome expansion. These
+  only handle linear destinations with no colour keying, where the ROP reduces
+  to writing the source (or a constant) to every visible pixel*/
+static int
+banshee_dst_bytes_pp(voodoo_t *voodoo)
+{
+    switch (voodoo->banshee_blt.dstFormat & DST_FORMAT_COL_MASK) {
+        case DST_FORMAT_COL_8_BPP:
+            return 1;
+        case DST_FORMAT_COL_16_BPP:
+            return 2;
+        case DST_FORMAT_COL_24_BPP:
+            return 3;
+        case DST_FORMAT_COL_32_BPP:
+            return 4;
+
+        default:
+            break;
+    }
+
+    return 0;
+}
+
+static int
+banshee_fast_ok(voodoo_t *voodoo)
+{
+    int use_pattern_trans = (voodoo->banshee_blt.command & (COMMAND_PATTERN_MONO | COMMAND_TRANS_MONO)) == (COMMAND_PATTERN_MONO | COMMAND_TRANS_MONO);
+
+    return !(voodoo->banshee_blt.commandExtra & (CMDEXTRA_SRC_COLORKEY | CMDEXTRA_DST_COLORKEY)) &&
+           !voodoo->banshee_blt.dstBaseAddr_tiled && !use_pattern_trans && banshee_dst_bytes_pp(voodoo);
+}
+
+/*Clip destination pixels [xl, xr] of line dst_y. Returns zero if the visible
+  part runs outside video memory, otherwise *count is the number of visible
+  pixels and *addr the address of the leftmost one*/
+static int
+banshee_fast_span(voodoo_t *voodoo, const clip_t *clip, int dst_y, int xl, int xr, int *l, uint32_t *addr, uint32_t *count)
+{
+    int     bytes_pp = banshee_dst_bytes_pp(voodoo);
+    int     r        = (xr < (clip->x_max - 1)) ? xr : (clip->x_max - 1);
+    int64_t start;
+
+    *count = 0;
+    *l     = (xl > clip->x_min) ? xl : clip->x_min;
+    if ((dst_y < clip->y_min) || (dst_y >= clip->y_max) || (*l > r))
+        return 1;
+
+    start = (int64_t) voodoo->banshee_blt.dstBaseAddr + (int64_t) *l * bytes_pp + (int64_t) dst_y * voodoo->banshee_blt.dst_stride;
+    if ((start < 0) || ((start + (int64_t) (r - *l + 1) * bytes_pp) > ((int64_t) voodoo->fb_mask + 1)))
+        return 0;
+
+    *addr  = start;
+    *count = r - *l + 1;
+    return 1;
+}
+
+static int
+banshee_do_rectfill_fast(voodoo_t *voodoo, const clip_t *clip)
+{
+    const uint8_t *pattern_mono = (uint8_t *) voodoo->banshee_blt.colorPattern;
+    int            bytes_pp     = banshee_dst_bytes_pp(voodoo);
+    int            xdir         = (voodoo->banshee_blt.command & COMMAND_DX) ? -1 : 1;
+    int            ydir         = (voodoo->banshee_blt.command & COMMAND_DY) ? -1 : 1;
+    int            w            = voodoo->banshee_blt.dstSizeX;
+    int            h            = voodoo->banshee_blt.dstSizeY;
+    int            xl           = (xdir > 0) ? voodoo->banshee_blt.dstX : (voodoo->banshee_blt.dstX - (w - 1));
+    int            dst_y        = voodoo->banshee_blt.dstY;
+    int            solid        = 0;
+    uint32_t       color;
+
+    if (!banshee_fast_ok(voodoo) || (w <= 0) || (h <= 0))
+        return 0;
+
+    if (voodoo->banshee_blt.command & COMMAND_PATTERN_MONO) {
+        solid = 1;
+        for (uint8_t c = 0; c < 8; c++) {
+            if (pattern_mono[c] != 0xff)
+                solid = 0;
+        }
+    }
+
+    switch (voodoo->banshee_blt.rops[0]) {
+        case 0x00: /*BLACKNESS*/
+            color = 0;
+            break;
+        case 0xcc: /*SRCCOPY*/
+            color = voodoo->banshee_blt.colorFore;
+            break;
+        case 0xf0: /*PATCOPY*/
+            if (!solid)
+                return 0;
+            color = voodoo->banshee_blt.colorFore;
+            break;
+        case 0xff: /*WHITENESS*/
+            color = 0xffffffff;
+            break;
+
+        default:
+            return 0;
+    }
+
+    /*Check every line before drawing anything, so that the generic path can
+      still take over*/
+    for (int y = 0; y < h; y++) {
+        int      l;
+        uint32_t addr;
+        uint32_t count;
+
+        if (!banshee_fast_span(voodoo, clip, dst_y + y * ydir, xl, xl + w - 1, &l, &addr, &count))
+            return 0;
+    }
+
+    for (voodoo->banshee_blt.cur_y = 0; voodoo->banshee_blt.cur_y < h; voodoo->banshee_blt.cur_y++) {
+        int      l;
+        uint32_t addr;
+        uint32_t count;
+
+        (void) banshee_fast_span(voodoo, clip, dst_y, xl, xl + w - 1, &l, &addr, &count);
+        if ((dst_y >= clip->y_min) && (dst_y < clip->y_max))
+            voodoo->banshee_blt.cur_x = w;
+        if (count) {
+            video_blit_fill(&voodoo->vram[addr], color, bytes_pp, count * bytes_pp);
+            video_blit_mark_changed(voodoo->changedvram, addr, count * bytes_pp, changeframecount);
+        }
+        dst_y += ydir;
+    }
+
+    return 1;
+}
+
+/*Plain SRCCOPY of one line from video memory, with matching source and
+  destination formats*/
+static int
+banshee_copy_line_fast(voodoo_t *voodoo, const clip_t *clip, const uint8_t *src_p, int src_x)
+{
+    int      bytes_pp = banshee_dst_bytes_pp(voodoo);
+    int      xdir     = (voodoo->banshee_blt.command & COMMAND_DX) ? -1 : 1;
+    int      w        = voodoo->banshee_blt.dstSizeX;
+    int      xl       = (xdir > 0) ? voodoo->banshee_blt.dstX : (voodoo->banshee_blt.dstX - (w - 1));
+    int      l;
+    uint32_t addr;
+    uint32_t count;
+
+    if (!banshee_fast_ok(voodoo) || (voodoo->banshee_blt.rops[0] != 0xcc) || (w <= 0))
+        return 0;
+    if (!banshee_fast_span(voodoo, clip, voodoo->banshee_blt.dstY, xl, xl + w - 1, &l, &addr, &count))
+        return 0;
+
+    if (count) {
+        int64_t src = (int64_t) (src_p - voodoo->vram) + (int64_t) (src_x + (l - voodoo->banshee_blt.dstX)) * bytes_pp;
+
+        if ((src < 0) || ((src + (int64_t) count * bytes_pp) > ((int64_t) voodoo->fb_mask + 1)))
+            return 0;
+
+        video_blit_copy(voodoo->vram, addr, src, count * bytes_pp, bytes_pp, xdir);
+        video_blit_mark_changed(voodoo->changedvram, addr, count * bytes_pp, changeframecount);
+    }
+
+    if ((voodoo->banshee_blt.dstY >= clip->y_min) && (voodoo->banshee_blt.dstY < clip->y_max))
+        voodoo->banshee_blt.cur_x = w;
+
+    return 1;
+}
+
+/*SRCCOPY of one line of 1 bpp source data, from either video memory or the
+  host, left to right*/
+static int
+banshee_mono_line_fast(voodoo_t *voodoo, const clip_t *clip, const uint8_t *src_p, int use_x_dir, int src_x)
+{
+    int      bytes_pp = banshee_dst_bytes_pp(voodoo);
+    int      w        = voodoo->banshee_blt.dstSizeX;
+    int      l;
+    uint32_t addr;
+    uint32_t count;
+
+    if (((voodoo->banshee_blt.srcFormat & SRC_FORMAT_COL_MASK) != SRC_FORMAT_COL_1_BPP) || !banshee_fast_ok(voodoo) ||
+        (voodoo->banshee_blt.rops[0] != 0xcc) || (use_x_dir && (voodoo->banshee_blt.command & COMMAND_DX)) || (w <= 0))
+        return 0;
+    if (!banshee_fast_span(voodoo, clip, voodoo->banshee_blt.dstY, voodoo->banshee_blt.dstX, voodoo->banshee_blt.dstX + w - 1, &l, &addr, &count))
+        return 0;
+
+    if (count) {
+        int bit = src_x + (l - voodoo->banshee_blt.dstX);
+
+        if (bit < 0)
+            return 0;
+        if (use_x_dir && (((int64_t) (src_p - voodoo->vram) + ((bit + count - 1) >> 3)) > voodoo->fb_mask))
+            return 0;
+
+        video_blit_mono(&voodoo->vram[addr], src_p, bit, 0, voodoo->banshee_blt.colorFore, voodoo->banshee_blt.colorBack,
+                        !!(voodoo->banshee_blt.command & COMMAND_TRANS_MONO), bytes_pp, count);
+        video_blit_mark_changed(voodoo->changedvram, addr, count * bytes_pp, changeframecount);
+    }
+
+    if ((voodoo->banshee_blt.dstY >= clip->y_min) && (voodoo->banshee_blt.dstY < clip->y_max))
+        voodoo->banshee_blt.cur_x = w;
+
+    return 1;
+}
+
 static void
 banshee_do_rectfill(voodoo_t *voodoo)
 {
@@ -431,6 +632,11 @@ banshee_do_rectfill(voodoo_t *voodoo)
     bansheeblt_log("clipping: %i,%i -> %i,%i\n", clip->x_min, clip->y_min, clip->x_max, clip->y_max);
     bansheeblt_log("colorFore=%08x\n", voodoo->banshee_blt.colorFore);
 #endif
+    if (banshee_do_rectfill_fast(voodoo, clip)) {
+        end_command(voodoo);
+        return;
+    }
+
     for (voodoo->banshee_blt.cur_y = 0; voodoo->banshee_blt.cur_y < voodoo->banshee_blt.dstSizeY; voodoo->banshee_blt.cur_y++) {
         int dst_x = voodoo->banshee_blt.dstX;
 
@@ -577,7 +783,7 @@ do_screen_to_screen_line(voodoo_t *voodoo, uint8_t *src_p, int use_x_dir, int sr
 #endif
     if ((voodoo->banshee_blt.srcFormat & SRC_FORMAT_COL_MASK) == (voodoo->banshee_blt.dstFormat & DST_FORMAT_COL_MASK)) {
         /*No conversion required*/
-        if (dst_y >= clip->y_min && dst_y < clip->y_max) {
+        if (!(use_x_dir && !src_tiled && banshee_copy_line_fast(voodoo, clip, src_p, src_x)) && dst_y >= clip->y_min && dst_y < clip->y_max) {
             int     dst_x        = voodoo->banshee_blt.dstX;
             int     pat_x        = voodoo->banshee_blt.patoff_x + voodoo->banshee_blt.dstX;
             uint8_t pattern_mask = pattern_mono[pat_y & 7];
@@ -667,7 +873,7 @@ do_screen_to_screen_line(voodoo_t *voodoo, uint8_t *src_p, int use_x_dir, int sr
         voodoo->banshee_blt.dstY += (voodoo->banshee_blt.command & COMMAND_DY) ? -1 : 1;
     } else {
         /*Conversion required*/
-        if (dst_y >= clip->y_min && dst_y < clip->y_max) {
+        if ((src_tiled || !banshee_mono_line_fast(voodoo, clip, src_p, use_x_dir, src_x)) && dst_y >= clip->y_min && dst_y < clip->y_max) {
 #if 0
             int src_x = voodoo->banshee_blt.srcX;
 #endif
@@ -58,46 +58,45 @@ voodoodisp_log(const char *fmt, ...)
 #    define voodoodisp_log(fmt, ...)
 #endif
 
+static __inline int
+ncc_component(uint32_t val, int shift)
+{
+    int c = (val >> shift) & 0x1ff;
+
+    if (c & 0x100)
+        c |= 0xfffffe00;
+
+    return c;
+}
+
 void
 voodoo_update_ncc(voodoo_t *voodoo, int tmu)
 {
     for (uint8_t tbl = 0; tbl < 2; tbl++) {
+        int i_rgb[4][3];
+        int q_rgb[4][3];
+
+        /*The I and Q entries only have 4 values each, sign extend them once
+          rather than for every colour*/
+        for (uint8_t c = 0; c < 4; c++) {
+            i_rgb[c][0] = ncc_component(voodoo->nccTable[tmu][tbl].i[c], 18);
+            i_rgb[c][1] = ncc_component(voodoo->nccTable[tmu][tbl].i[c], 9);
+            i_rgb[c][2] = ncc_component(voodoo->nccTable[tmu][tbl].i[c], 0);
+            q_rgb[c][0] = ncc_component(voodoo->nccTable[tmu][tbl].q[c], 18);
+            q_rgb[c][1] = ncc_component(voodoo->nccTable[tmu][tbl].q[c], 9);
+            q_rgb[c][2] = ncc_component(voodoo->nccTable[tmu][tbl].q[c], 0);
+        }
+
         for (uint16_t col = 0; col < 256; col++) {
-            int y = (col >> 4);
-            int i = (col >> 2) & 3;
-            int q = col & 3;
-            int i_r;
-            int i_g;
-            int i_b;
-            int q_r;
-            int q_g;
-            int q_b;
+            int        y  = (col >> 4);
+            const int *iv = i_rgb[(col >> 2) & 3];
+            const int *qv = q_rgb[col & 3];
 
             y = (voodoo->nccTable[tmu][tbl].y[y >> 2] >> ((y & 3) * 8)) & 0xff;
 
-            i_r = (voodoo->nccTable[tmu][tbl].i[i] >> 18) & 0x1ff;
-            if (i_r & 0x100)
-                i_r |= 0xfffffe00;
-            i_g = (voodoo->nccTable[tmu][tbl].i[i] >> 9) & 0x1ff;
-            if (i_g & 0x100)
-                i_g |= 0xfffffe00;
-            i_b = voodoo->nccTable[tmu][tbl].i[i] & 0x1ff;
-            if (i_b & 0x100)
-                i_b |= 0xfffffe00;
-
-            q_r = (voodoo->nccTable[tmu][tbl].q[q] >> 18) & 0x1ff;
-            if (q_r & 0x100)
-                q_r |= 0xfffffe00;
-            q_g = (voodoo->nccTable[tmu][tbl].q[q] >> 9) & 0x1ff;
-            if (q_g & 0x100)
-                q_g |= 0xfffffe00;
-            q_b = voodoo->nccTable[tmu][tbl].q[q] & 0x1ff;
-            if (q_b & 0x100)
-                q_b |= 0xfffffe00;
-
-            voodoo->ncc_lookup[tmu][tbl][col].rgba.r = CLAMP(y + i_r + q_r);
-            voodoo->ncc_lookup[tmu][tbl][col].rgba.g = CLAMP(y + i_g + q_g);
-            voodoo->ncc_lookup[tmu][tbl][col].rgba.b = CLAMP(y + i_b + q_b);
+            voodoo->ncc_lookup[tmu][tbl][col].rgba.r = CLAMP(y + iv[0] + qv[0]);
+            voodoo->ncc_lookup[tmu][tbl][col].rgba.g = CLAMP(y + iv[1] + qv[1]);
+            voodoo->ncc_lookup[tmu][tbl][col].rgba.b = CLAMP(y + iv[2] + qv[2]);
             voodoo->ncc_lookup[tmu][tbl][col].rgba.a = 0xff;
         }
     }
@@ -242,6 +241,10 @@ voodoo_generate_filter_v1(voodoo_t *voodoo)
             lined = 255;
         voodoo->purpleline[g][1] = lined;
     }
+
+    voodoo->filter_cap[0] = FILTCAPB;
+    voodoo->filter_cap[1] = FILTCAPG;
+    voodoo->filter_cap[2] = FILTCAP;
 }
 
 void
@@ -350,6 +353,10 @@ voodoo_generate_filter_v2(voodoo_t *voodoo)
             // voodoodisp_log("Voodoofilter: %ix%i - %f difference, %f average difference, R=%f, G=%f, B=%f\n", g, h, difference, avgdiff, thiscol, thiscolg, thiscolb);
         }
     }
+
+    voodoo->filter_cap[0] = FILTCAPB;
+    voodoo->filter_cap[1] = FILTCAPG;
+    voodoo->filter_cap[2] = FILTCAP;
 }
 
 void
@@ -506,6 +513,260 @@ voodoo_filterline_v2(voodoo_t *voodoo, uint8_t *fil, int column, uint16_t *src,
     fil3[(column - 1) * 3 + 2] = voodoo->thefilter[fil[(column - 1) * 3 + 2]][((src[column] >> 11) & 31) << 3];
 }
 
+/* Vectorised screen filter. The filter tables built above are equivalent to
+   short integer formulas, which are evaluated on whole groups of 8 pixels
+   of one colour channel instead of being looked up pixel by pixel. The
+   channels are kept in separate planes while filtering. */
+#if defined(__ARM_NEON) || defined(_M_ARM64)
+#    define VOODOO_DISPLAY_SIMD
+#    include <arm_neon.h>
+
+typedef int16x8_t filt_vec_t;
+
+#    define filt_vec_load(p)         vreinterpretq_s16_u16(vld1q_u16(p))
+#    define filt_vec_store(p, a)     vst1q_u16(p, vreinterpretq_u16_s16(a))
+#    define filt_vec_const(c)        vdupq_n_s16(c)
+#    define filt_vec_add(a, b)       vaddq_s16(a, b)
+#    define filt_vec_sub(a, b)       vsubq_s16(a, b)
+#    define filt_vec_min(a, b)       vminq_s16(a, b)
+#    define filt_vec_max(a, b)       vmaxq_s16(a, b)
+#    define filt_vec_shl(a, n)       vshlq_n_s16(a, n)
+#    define filt_vec_shr(a, n)       vreinterpretq_s16_u16(vshrq_n_u16(vreinterpretq_u16_s16(a), n))
+#    define filt_vec_gt(a, b)        vreinterpretq_s16_u16(vcgtq_s16(a, b))
+#    define filt_vec_and(a, b)       vandq_s16(a, b)
+#    define filt_vec_select(m, a, b) vbslq_s16(vreinterpretq_u16_s16(m), a, b)
+
+/*Divides values of up to 1275 by 5*/
+static __inline filt_vec_t
+filt_vec_div5(filt_vec_t a)
+{
+    uint16x8_t u  = vreinterpretq_u16_s16(a);
+    uint32x4_t lo = vmull_n_u16(vget_low_u16(u), 13108);
+    uint32x4_t hi = vmull_n_u16(vget_high_u16(u), 13108);
+
+    return vreinterpretq_s16_u16(vcombine_u16(vshrn_n_u32(lo, 16), vshrn_n_u32(hi, 16)));
+}
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#    define VOODOO_DISPLAY_SIMD
+#    include <emmintrin.h>
+
+typedef __m128i filt_vec_t;
+
+#    define filt_vec_load(p)         _mm_loadu_si128((const __m128i *) (p))
+#    define filt_vec_store(p, a)     _mm_storeu_si128((__m128i *) (p), a)
+#    define filt_vec_const(c)        _mm_set1_epi16(c)
+#    define filt_vec_add(a, b)       _mm_add_epi16(a, b)
+#    define filt_vec_sub(a, b)       _mm_sub_epi16(a, b)
+#    define filt_vec_min(a, b)       _mm_min_epi16(a, b)
+#    define filt_vec_max(a, b)       _mm_max_epi16(a, b)
+#    define filt_vec_shl(a, n)       _mm_slli_epi16(a, n)
+#    define filt_vec_shr(a, n)       _mm_srli_epi16(a, n)
+#    define filt_vec_gt(a, b)        _mm_cmpgt_epi16(a, b)
+#    define filt_vec_and(a, b)       _mm_and_si128(a, b)
+#    define filt_vec_select(m, a, b) _mm_or_si128(_mm_and_si128(m, a), _mm_andnot_si128(m, b))
+#    define filt_vec_div5(a)         _mm_mulhi_epu16(a, _mm_set1_epi16(13108))
+#endif
+
+#ifdef VOODOO_DISPLAY_SIMD
+/*Longest line the filter handles, plus room for a vector's overrun*/
+#    define FILT_PLANE_SIZE (4096 + 8)
+
+/*voodoo_generate_filter_v1() - moves a pixel half way towards its neighbour,
+  by at most cap*/
+static __inline int
+filt_v1(int g, int h, int cap)
+{
+    int d = h - g;
+
+    if (d > cap)
+        d = cap;
+    if (d < -cap)
+        d = -cap;
+    return (g + g + d) >> 1;
+}
+
+/*voodoo_generate_filter_v2() - only lightens a pixel, and only towards
+  neighbours within cap of it*/
+static __inline int
+filt_v2(int g, int h, int cap)
+{
+    int d;
+
+    if (h <= g || (h - g) > cap)
+        return g;
+
+    d = ((g * 4 + h) / 5) - ((g + h * 4) / 5);
+    if (d < 0)
+        d = -d;
+    if (d > cap)
+        d = cap;
+    if (d > 32)
+        d = 32;
+    return (g + d) > 255 ? 255 : (g + d);
+}
+
+/*dst[x] = filter(g[x], h[x]) for a whole run. dst may be g or h*/
+static void
+filt_pass_v1(uint16_t *dst, const uint16_t *g, const uint16_t *h, int n, int cap)
+{
+    const filt_vec_t cap_pos = filt_vec_const(cap);
+    const filt_vec_t cap_neg = filt_vec_const(-cap);
+    int              x       = 0;
+
+    for (; x <= n - 8; x += 8) {
+        filt_vec_t vg = filt_vec_load(&g[x]);
+        filt_vec_t d  = filt_vec_sub(filt_vec_load(&h[x]), vg);
+
+        d = filt_vec_min(filt_vec_max(d, cap_neg), cap_pos);
+        filt_vec_store(&dst[x], filt_vec_shr(filt_vec_add(filt_vec_add(vg, vg), d), 1));
+    }
+    for (; x < n; x++)
+        dst[x] = filt_v1(g[x], h[x], cap);
+}
+
+static void
+filt_pass_v2(uint16_t *dst, const uint16_t *g, const uint16_t *h, int n, int cap)
+{
+    const filt_vec_t cap_plus1 = filt_vec_const(cap + 1);
+    const filt_vec_t max_d     = filt_vec_const((cap > 32) ? 32 : cap);
+    const filt_vec_t c255      = filt_vec_const(255);
+    int              x         = 0;
+
+    for (; x <= n - 8; x += 8) {
+        filt_vec_t vg = filt_vec_load(&g[x]);
+        filt_vec_t vh = filt_vec_load(&h[x]);
+        filt_vec_t a  = filt_vec_div5(filt_vec_add(filt_vec_shl(vg, 2), vh));
+        filt_vec_t b  = filt_vec_div5(filt_vec_add(vg, filt_vec_shl(vh, 2)));
+        filt_vec_t d  = filt_vec_max(filt_vec_sub(a, b), filt_vec_sub(b, a));
+        filt_vec_t lit;
+        filt_vec_t mask;
+
+        d    = filt_vec_min(d, max_d);
+        lit  = filt_vec_min(filt_vec_add(vg, d), c255);
+        mask = filt_vec_and(filt_vec_gt(vh, vg), filt_vec_gt(cap_plus1, filt_vec_sub(vh, vg)));
+        filt_vec_store(&dst[x], filt_vec_select(mask, lit, vg));
+    }
+    for (; x < n; x++)
+        dst[x] = filt_v2(g[x], h[x], cap);
+}
+
+/*Splits a line of RGB565 into 8-bit blue, green and red planes*/
+static void
+filt_unpack(uint16_t planes[3][FILT_PLANE_SIZE], const uint16_t *src, int n)
+{
+    int x = 0;
+
+    for (; x <= n - 8; x += 8) {
+        filt_vec_t s = filt_vec_load(&src[x]);
+
+        filt_vec_store(&planes[0][x], filt_vec_shr(filt_vec_shl(s, 11), 8));
+        filt_vec_store(&planes[1][x], filt_vec_shl(filt_vec_shr(filt_vec_shl(s, 5), 10), 2));
+        filt_vec_store(&planes[2][x], filt_vec_shl(filt_vec_shr(s, 11), 3));
+    }
+    for (; x < n; x++) {
+        planes[0][x] = (src[x] & 31) << 3;
+        planes[1][x] = ((src[x] >> 5) & 63) << 2;
+        planes[2][x] = ((src[x] >> 11) & 31) << 3;
+    }
+}
+
+/*Same result as voodoo_filterline_v1(). Each table pass only reads the
+  output of the previous one, so they become whole-line passes*/
+static void
+filt_line_v1(const voodoo_t *voodoo, uint16_t out[3][FILT_PLANE_SIZE], int column, const uint16_t *src, int line)
+{
+    uint16_t tmp[3][FILT_PLANE_SIZE];
+
+    filt_unpack(out, src, column);
+
+    for (int c = 0; c < 3; c++) {
+        uint16_t *fil  = out[c];
+        uint16_t *fil3 = tmp[c];
+        int       cap  = voodoo->filter_cap[c];
+
+        fil3[0] = fil[0];
+
+        /*Scanlines - brighten red and blue on odd lines*/
+        if ((line & 1) && c != 1) {
+            int x = 0;
+
+            for (; x <= column - 8; x += 8)
+                filt_vec_store(&fil[x], filt_vec_min(filt_vec_add(filt_vec_load(&fil[x]), filt_vec_const(4)), filt_vec_const(255)));
+            for (; x < column; x++)
+                fil[x] = (fil[x] + 4 > 255) ? 255 : (fil[x] + 4);
+        }
+
+        filt_pass_v1(&fil3[1], &fil[1], &fil[0], column - 1, cap);
+        filt_pass_v1(&fil[1], &fil3[1], &fil3[0], column - 1, cap);
+        filt_pass_v1(&fil3[1], &fil[1], &fil[0], column - 1, cap);
+        filt_pass_v1(&fil[0], &fil3[0], &fil3[1], column - 1, cap);
+    }
+}
+
+/*Same result as voodoo_filterline_v2(). Its sliding loop rewrites every
+  pixel twice in each buffer, and each write only depends on the previous
+  write to the other buffer and on the source line, so it is done as four
+  whole-line passes plus the edge cases. Like the original this reads
+  src[column]*/
+static void
+filt_line_v2(const voodoo_t *voodoo, uint16_t out[3][FILT_PLANE_SIZE], int column, const uint16_t *src)
+{
+    uint16_t s[3][FILT_PLANE_SIZE];
+    uint16_t tmp[3][FILT_PLANE_SIZE];
+
+    filt_unpack(s, src, column + 1);
+
+    for (int c = 0; c < 3; c++) {
+        const uint16_t *orig = s[c];
+        uint16_t       *fil  = out[c];
+        uint16_t       *fil3 = tmp[c];
+        int             cap  = voodoo->filter_cap[c];
+
+        memcpy(fil, orig, column * sizeof(uint16_t));
+        memcpy(fil3, orig, column * sizeof(uint16_t));
+
+        filt_pass_v2(&fil3[4], &orig[4], &orig[1], column - 4, cap);
+        filt_pass_v2(&fil[3], &fil3[3], &orig[1], column - 4, cap);
+        filt_pass_v2(&fil3[2], &fil[2], &orig[1], column - 4, cap);
+        filt_pass_v2(&fil[0], &fil3[0], &orig[1], column - 4, cap);
+
+        fil[column - 2] = filt_v2(filt_v2(orig[column - 2], orig[column], cap), orig[column], cap);
+        fil[column - 1] = filt_v2(filt_v2(orig[column - 1], orig[column], cap), orig[column], cap);
+    }
+}
+#endif
+
+/*Filters a displayed line and maps it through the CLUT straight into the
+  output bitmap*/
+static void
+voodoo_filterline_clut(voodoo_t *voodoo, uint32_t *p, int column, uint16_t *src, int line)
+{
+    uint8_t fil[4096 * 3]; /* interleaved 24-bit RGB */
+
+#ifdef VOODOO_DISPLAY_SIMD
+    if (column >= 8) {
+        uint16_t planes[3][FILT_PLANE_SIZE];
+
+        if (voodoo->type == VOODOO_2)
+            filt_line_v2(voodoo, planes, column, src);
+        else
+            filt_line_v1(voodoo, planes, column, src, line);
+
+        for (int x = 0; x < column; x++)
+            p[x] = (voodoo->clutData256[planes[0][x]].b << 0 | voodoo->clutData256[planes[1][x]].g << 8 | voodoo->clutData256[planes[2][x]].r << 16);
+        return;
+    }
+#endif
+
+    if (voodoo->type == VOODOO_2)
+        voodoo_filterline_v2(voodoo, fil, column, src, line);
+    else
+        voodoo_filterline_v1(voodoo, fil, column, src, line);
+
+    for (int x = 0; x < column; x++)
+        p[x] = (voodoo->clutData256[fil[x * 3]].b << 0 | voodoo->clutData256[fil[x * 3 + 1]].g << 8 | voodoo->clutData256[fil[x * 3 + 2]].r << 16);
+}
+
 void
 voodoo_callback(void *priv)
 {
@@ -554,17 +815,8 @@ voodoo_callback(void *priv)
                     monitor->target_buffer->line[voodoo->line + v_y_add][x] = 0x00000000;
 
                 if (voodoo->scrfilter && voodoo->scrfilterEnabled) {
-                    uint8_t fil[4096 * 3]; /* interleaved 24-bit RGB */
-
                     assert(voodoo->h_disp <= 4096);
-                    if (voodoo->type == VOODOO_2)
-                        voodoo_filterline_v2(voodoo, fil, voodoo->h_disp, src, voodoo->line);
-                    else
-                        voodoo_filterline_v1(voodoo, fil, voodoo->h_disp, src, voodoo->line);
-
-                    for (x = 0; x < voodoo->h_disp; x++) {
-                        p[x] = (voodoo->clutData256[fil[x * 3]].b << 0 | voodoo->clutData256[fil[x * 3 + 1]].g << 8 | voodoo->clutData256[fil[x * 3 + 2]].r << 16);
-                    }
+                    voodoo_filterline_clut(voodoo, p, voodoo->h_disp, src, voodoo->line);
                 } else {
                     for (x = 0; x < voodoo->h_disp; x++) {
                         p[x] = draw_voodoo->video_16to32[src[x]];
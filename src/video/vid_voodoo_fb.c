@@ -142,7 +142,7 @@ voodoo_fb_readl(uint32_t addr, void *priv)
 }
 
 static inline uint16_t
-do_dither(voodoo_params_t *params, rgba8_t col, int x, int y)
+do_dither(const voodoo_params_t *params, rgba8_t col, int x, int y)
 {
     int r;
     int g;
@@ -167,24 +167,22 @@ do_dither(voodoo_params_t *params, rgba8_t col, int x, int y)
     return b | (g << 5) | (r << 11);
 }
 
-void
-voodoo_fb_writew(uint32_t addr, uint16_t val, void *priv)
+static void
+fb_writew(voodoo_t *voodoo, const voodoo_params_t *params, const voodoo_lfb_state_t *lfb, uint32_t addr, uint16_t val)
 {
-    voodoo_t              *voodoo = (voodoo_t *) priv;
-    const voodoo_params_t *params = &voodoo->params;
-    int                    x;
-    int                    y;
-    uint32_t               write_addr;
-    uint32_t               write_addr_aux;
-    rgba8_t                colour_data;
-    uint16_t               depth_data;
-    uint8_t                alpha_data;
-    int                    write_mask = 0;
+    int      x;
+    int      y;
+    uint32_t write_addr;
+    uint32_t write_addr_aux;
+    rgba8_t  colour_data;
+    uint16_t depth_data;
+    uint8_t  alpha_data;
+    int      write_mask = 0;
 
     colour_data.r = colour_data.g = colour_data.b = colour_data.a = 0;
 
-    depth_data = voodoo->params.zaColor & 0xffff;
-    alpha_data = voodoo->params.zaColor >> 24;
+    depth_data = params->zaColor & 0xffff;
+    alpha_data = params->zaColor >> 24;
 
 #if 0
     while (!RB_EMPTY)
@@ -195,7 +193,7 @@ voodoo_fb_writew(uint32_t addr, uint16_t val, void *priv)
     voodoo_fb_log("voodoo_fb_writew : %08X %04X\n", addr, val);
 #endif
 
-    switch (voodoo->lfbMode & LFB_FORMAT_MASK) {
+    switch (lfb->lfbMode & LFB_FORMAT_MASK) {
         case LFB_FORMAT_RGB565:
             colour_data = rgb565[val];
             alpha_data  = 0xff;
@@ -217,7 +215,7 @@ voodoo_fb_writew(uint32_t addr, uint16_t val, void *priv)
             break;
 
         default:
-            fatal("voodoo_fb_writew : bad LFB format %08X\n", voodoo->lfbMode);
+            fatal("voodoo_fb_writew : bad LFB format %08X\n", lfb->lfbMode);
     }
 
     if (voodoo->type >= VOODOO_BANSHEE) {
@@ -234,21 +232,21 @@ voodoo_fb_writew(uint32_t addr, uint16_t val, void *priv)
         y >>= 1;
     }
 
-    if (voodoo->fb_write_offset == voodoo->params.front_offset && y < 2048)
+    if (lfb->fb_write_offset == params->front_offset && y < 2048)
         voodoo->dirty_line[y] = 1;
 
-    if (voodoo->col_tiled)
-        write_addr = voodoo->fb_write_offset + (x & 127) + (x >> 7) * 128 * 32 + (y & 31) * 128 + (y >> 5) * voodoo->row_width;
+    if (lfb->col_tiled)
+        write_addr = lfb->fb_write_offset + (x & 127) + (x >> 7) * 128 * 32 + (y & 31) * 128 + (y >> 5) * lfb->row_width;
     else
-        write_addr = voodoo->fb_write_offset + x + (y * voodoo->row_width);
-    if (voodoo->aux_tiled)
-        write_addr_aux = voodoo->params.aux_offset + (x & 127) + (x >> 7) * 128 * 32 + (y & 31) * 128 + (y >> 5) * voodoo->row_width;
+        write_addr = lfb->fb_write_offset + x + (y * lfb->row_width);
+    if (lfb->aux_tiled)
+        write_addr_aux = params->aux_offset + (x & 127) + (x >> 7) * 128 * 32 + (y & 31) * 128 + (y >> 5) * lfb->row_width;
     else
-        write_addr_aux = voodoo->params.aux_offset + x + (y * voodoo->row_width);
+        write_addr_aux = params->aux_offset + x + (y * lfb->row_width);
 
-    //        voodoo_fb_log("fb_writew %08x %i %i %i %08x\n", addr, x, y, voodoo->row_width, write_addr);
+    //        voodoo_fb_log("fb_writew %08x %i %i %i %08x\n", addr, x, y, lfb->row_width, write_addr);
 
-    if (voodoo->lfbMode & 0x100) {
+    if (lfb->lfbMode & 0x100) {
         {
             rgba8_t  write_data = colour_data;
             uint16_t new_depth  = depth_data;
@@ -299,7 +297,7 @@ voodoo_fb_writew(uint32_t addr, uint16_t val, void *priv)
             }
 
             if (params->fbzMode & FBZ_RGB_WMASK)
-                *(uint16_t *) (&voodoo->fb_mem[write_addr & voodoo->fb_mask]) = do_dither(&voodoo->params, write_data, x >> 1, y);
+                *(uint16_t *) (&voodoo->fb_mem[write_addr & voodoo->fb_mask]) = do_dither(params, write_data, x >> 1, y);
             if (params->fbzMode & FBZ_DEPTH_WMASK)
                 *(uint16_t *) (&voodoo->fb_mem[write_addr_aux & voodoo->fb_mask]) = new_depth;
 
@@ -308,29 +306,27 @@ skip_pixel:
         }
     } else {
         if (write_mask & LFB_WRITE_COLOUR)
-            *(uint16_t *) (&voodoo->fb_mem[write_addr & voodoo->fb_mask]) = do_dither(&voodoo->params, colour_data, x >> 1, y);
+            *(uint16_t *) (&voodoo->fb_mem[write_addr & voodoo->fb_mask]) = do_dither(params, colour_data, x >> 1, y);
         if (write_mask & LFB_WRITE_DEPTH)
             *(uint16_t *) (&voodoo->fb_mem[write_addr_aux & voodoo->fb_mask]) = depth_data;
     }
 }
 
-void
-voodoo_fb_writel(uint32_t addr, uint32_t val, void *priv)
+static void
+fb_writel(voodoo_t *voodoo, const voodoo_params_t *params, const voodoo_lfb_state_t *lfb, uint32_t addr, uint32_t val)
 {
-    voodoo_t              *voodoo = (voodoo_t *) priv;
-    const voodoo_params_t *params = &voodoo->params;
-    int                    x;
-    int                    y;
-    uint32_t               write_addr;
-    uint32_t               write_addr_aux;
-    rgba8_t                colour_data[2];
-    uint16_t               depth_data[2];
-    uint8_t                alpha_data[2];
-    int                    write_mask = 0;
-    int                    count = 1;
-
-    depth_data[0] = depth_data[1] = voodoo->params.zaColor & 0xffff;
-    alpha_data[0] = alpha_data[1] = voodoo->params.zaColor >> 24;
+    int      x;
+    int      y;
+    uint32_t write_addr;
+    uint32_t write_addr_aux;
+    rgba8_t  colour_data[2];
+    uint16_t depth_data[2];
+    uint8_t  alpha_data[2];
+    int      write_mask = 0;
+    int      count      = 1;
+
+    depth_data[0] = depth_data[1] = params->zaColor & 0xffff;
+    alpha_data[0] = alpha_data[1] = params->zaColor >> 24;
 #if 0
     while (!RB_EMPTY)
         thread_reset_event(voodoo->not_full_event);
@@ -340,7 +336,7 @@ voodoo_fb_writel(uint32_t addr, uint32_t val, void *priv)
     voodoo_fb_log("voodoo_fb_writel : %08X %08X\n", addr, val);
 #endif
 
-    switch (voodoo->lfbMode & LFB_FORMAT_MASK) {
+    switch (lfb->lfbMode & LFB_FORMAT_MASK) {
         case LFB_FORMAT_RGB565:
             colour_data[0] = rgb565[val & 0xffff];
             colour_data[1] = rgb565[val >> 16];
@@ -408,7 +404,7 @@ voodoo_fb_writel(uint32_t addr, uint32_t val, void *priv)
             break;
 
         default:
-            fatal("voodoo_fb_writel : bad LFB format %08X\n", voodoo->lfbMode);
+            fatal("voodoo_fb_writel : bad LFB format %08X\n", lfb->lfbMode);
     }
 
     if (voodoo->type >= VOODOO_BANSHEE) {
@@ -425,23 +421,23 @@ voodoo_fb_writel(uint32_t addr, uint32_t val, void *priv)
         y >>= 1;
     }
 
-    if (voodoo->fb_write_offset == voodoo->params.front_offset && y < 2048)
+    if (lfb->fb_write_offset == params->front_offset && y < 2048)
         voodoo->dirty_line[y] = 1;
 
-    if (voodoo->col_tiled)
-        write_addr = voodoo->fb_write_offset + (x & 127) + (x >> 7) * 128 * 32 + (y & 31) * 128 + (y >> 5) * voodoo->row_width;
+    if (lfb->col_tiled)
+        write_addr = lfb->fb_write_offset + (x & 127) + (x >> 7) * 128 * 32 + (y & 31) * 128 + (y >> 5) * lfb->row_width;
     else
-        write_addr = voodoo->fb_write_offset + x + (y * voodoo->row_width);
-    if (voodoo->aux_tiled)
-        write_addr_aux = voodoo->params.aux_offset + (x & 127) + (x >> 7) * 128 * 32 + (y & 31) * 128 + (y >> 5) * voodoo->row_width;
+        write_addr = lfb->fb_write_offset + x + (y * lfb->row_width);
+    if (lfb->aux_tiled)
+        write_addr_aux = params->aux_offset + (x & 127) + (x >> 7) * 128 * 32 + (y & 31) * 128 + (y >> 5) * lfb->row_width;
     else
-        write_addr_aux = voodoo->params.aux_offset + x + (y * voodoo->row_width);
+        write_addr_aux = params->aux_offset + x + (y * lfb->row_width);
 
 #if 0
-    voodoo_fb_log("fb_writel %08x x=%i y=%i rw=%i %08x wo=%08x\n", addr, x, y, voodoo->row_width, write_addr, voodoo->fb_write_offset);
+    voodoo_fb_log("fb_writel %08x x=%i y=%i rw=%i %08x wo=%08x\n", addr, x, y, lfb->row_width, write_addr, lfb->fb_write_offset);
 #endif
 
-    if (voodoo->lfbMode & 0x100) {
+    if (lfb->lfbMode & 0x100) {
         for (int c = 0; c < count; c++) {
             rgba8_t  write_data = colour_data[c];
             uint16_t new_depth  = depth_data[c];
@@ -492,7 +488,7 @@ voodoo_fb_writel(uint32_t addr, uint32_t val, void *priv)
             }
 
             if (params->fbzMode & FBZ_RGB_WMASK)
-                *(uint16_t *) (&voodoo->fb_mem[write_addr & voodoo->fb_mask]) = do_dither(&voodoo->params, write_data, (x >> 1) + c, y);
+                *(uint16_t *) (&voodoo->fb_mem[write_addr & voodoo->fb_mask]) = do_dither(params, write_data, (x >> 1) + c, y);
             if (params->fbzMode & FBZ_DEPTH_WMASK)
                 *(uint16_t *) (&voodoo->fb_mem[write_addr_aux & voodoo->fb_mask]) = new_depth;
 
@@ -504,12 +500,12 @@ skip_pixel:
         for (int c = 0; c < count; c++) {
             if (write_mask & LFB_WRITE_COLOUR)
                 *(uint16_t *) (&voodoo->fb_mem[write_addr & voodoo->fb_mask]) =
-                              do_dither(&voodoo->params, colour_data[c], (x >> 1) + c, y);
+                              do_dither(params, colour_data[c], (x >> 1) + c, y);
             if (write_mask & LFB_WRITE_DEPTH)
                 *(uint16_t *) (&voodoo->fb_mem[write_addr_aux & voodoo->fb_mask]) = depth_data[c];
             if (write_mask & LFB_WRITE_BOTH) {
                 *(uint16_t *) (&voodoo->fb_mem[write_addr & voodoo->fb_mask]) =
-                              do_dither(&voodoo->params, colour_data[c], (x >> 1) + c, y);
+                              do_dither(params, colour_data[c], (x >> 1) + c, y);
                 *(uint16_t *) (&voodoo->fb_mem[write_addr_aux & voodoo->fb_mask]) = depth_data[c];
             }
 
@@ -518,3 +514,112 @@ skip_pixel:
         }
     }
 }
+
+static void
+fb_lfb_state(const voodoo_t *voodoo, voodoo_lfb_state_t *lfb)
+{
+    lfb->lfbMode         = voodoo->lfbMode;
+    lfb->fb_write_offset = voodoo->fb_write_offset;
+    lfb->row_width       = voodoo->row_width;
+    lfb->col_tiled       = voodoo->col_tiled;
+    lfb->aux_tiled       = voodoo->aux_tiled;
+}
+
+void
+voodoo_fb_writew(uint32_t addr, uint16_t val, void *priv)
+{
+    voodoo_t          *voodoo = (voodoo_t *) priv;
+    voodoo_lfb_state_t lfb;
+
+    fb_lfb_state(voodoo, &lfb);
+    fb_writew(voodoo, &voodoo->params, &lfb, addr, val);
+}
+
+void
+voodoo_fb_writel(uint32_t addr, uint32_t val, void *priv)
+{
+    voodoo_t          *voodoo = (voodoo_t *) priv;
+    voodoo_lfb_state_t lfb;
+
+    fb_lfb_state(voodoo, &lfb);
+    fb_writel(voodoo, &voodoo->params, &lfb, addr, val);
+}
+
+/*Line of this card's framebuffer written by an LFB access, decoded the same
+  way as in fb_writew()/fb_writel(). Returns -1 for lines that belong to the
+  other card of an SLI pair*/
+static int
+fb_write_line(const voodoo_t *voodoo, uint32_t addr, int writel)
+{
+    int y;
+
+    if (writel && ((voodoo->lfbMode & LFB_FORMAT_MASK) == LFB_FORMAT_ARGB8888 || (voodoo->lfbMode & LFB_FORMAT_MASK) == LFB_FORMAT_XRGB8888))
+        addr >>= 1;
+
+    if (voodoo->type >= VOODOO_BANSHEE)
+        y = (addr >> 12) & 0x3ff;
+    else
+        y = (addr >> 11) & 0x3ff;
+
+    if (SLI_ENABLED) {
+        if ((!(voodoo->initEnable & INITENABLE_SLI_MASTER_SLAVE) && (y & 1)) || ((voodoo->initEnable & INITENABLE_SLI_MASTER_SLAVE) && !(y & 1)))
+            return -1;
+        y >>= 1;
+    }
+
+    return y;
+}
+
+void
+voodoo_fb_span_init(voodoo_lfb_span_t *span, int writel)
+{
+    span->writel = writel;
+    span->count  = 0;
+}
+
+/*Adds a write to the span. The span is queued first if the write does not
+  directly follow it, or if the LFB state it was started with has changed*/
+void
+voodoo_fb_span_write(voodoo_t *voodoo, voodoo_lfb_span_t *span, uint32_t addr, uint32_t val)
+{
+    if (span->count) {
+        uint32_t next = span->addr + span->count * (span->writel ? 4 : 2);
+
+        if (addr != next || span->count == VOODOO_LFB_SPAN_MAX || span->state.lfbMode != voodoo->lfbMode || span->state.fb_write_offset != voodoo->fb_write_offset || fb_write_line(voodoo, addr, span->writel) != span->y)
+            voodoo_fb_span_flush(voodoo, span);
+    }
+
+    if (!span->count) {
+        span->y = fb_write_line(voodoo, addr, span->writel);
+        if (span->y < 0)
+            return;
+
+        fb_lfb_state(voodoo, &span->state);
+        span->addr = addr;
+    }
+
+    span->data[span->count++] = val;
+}
+
+void
+voodoo_fb_span_flush(voodoo_t *voodoo, voodoo_lfb_span_t *span)
+{
+    if (span->count)
+        voodoo_queue_lfb_span(voodoo, span);
+    span->count = 0;
+}
+
+/*Executes a queued span, called from the render thread that owns its line*/
+void
+voodoo_fb_span(voodoo_t *voodoo, const voodoo_params_t *params, const voodoo_lfb_span_t *span)
+{
+    uint32_t addr = span->addr;
+
+    if (span->writel) {
+        for (int c = 0; c < span->count; c++, addr += 4)
+            fb_writel(voodoo, params, &span->state, addr, span->data[c]);
+    } else {
+        for (int c = 0; c < span->count; c++, addr += 2)
+            fb_writew(voodoo, params, &span->state, addr, span->data[c]);
+    }
+}
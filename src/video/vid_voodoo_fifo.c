@@ -43,6 +43,7 @@
 #include <86box/vid_voodoo_regs.h>
 #include <86box/vid_voodoo_render.h>
 #include <86box/vid_voodoo_texture.h>
+#include <minitrace/minitrace.h>
 
 #ifdef ENABLE_VOODOO_FIFO_LOG
 int voodoo_fifo_do_log = ENABLE_VOODOO_FIFO_LOG;
@@ -92,21 +93,15 @@ voodoo_wake_timer(void *priv)
 void
 voodoo_queue_command(voodoo_t *voodoo, uint32_t addr_type, uint32_t val)
 {
-    fifo_entry_t *fifo = &voodoo->fifo[voodoo->fifo_write_idx & FIFO_MASK];
-
-    while (FIFO_FULL) {
-        thread_reset_event(voodoo->fifo_not_full_event);
-        if (FIFO_FULL) {
-            thread_wait_event(voodoo->fifo_not_full_event, 1); /*Wait for room in ringbuffer*/
-            if (FIFO_FULL)
-                voodoo_wake_fifo_thread_now(voodoo);
-        }
-    }
+    fifo_entry_t *fifo;
 
+    spsc_wait_below(&voodoo->fifo_ring, FIFO_SIZE - 4);
+
+    fifo            = &voodoo->fifo[spsc_write_pos(&voodoo->fifo_ring)];
     fifo->val       = val;
     fifo->addr_type = addr_type;
 
-    voodoo->fifo_write_idx++;
+    spsc_push(&voodoo->fifo_ring);
     voodoo->cmd_status &= ~(1 << 24);
 
     if (FIFO_ENTRIES > 0xe000)
@@ -175,6 +170,7 @@ cmdfifo_get(voodoo_t *voodoo)
     if (!voodoo->cmdfifo_in_sub)
         voodoo->cmdfifo_depth_rd++;
     voodoo->cmdfifo_rp += 4;
+    voodoo->cmdfifo_words++;
 
     //        voodoo_fifo_log("  CMDFIFO get %08x\n", val);
     return val;
@@ -212,6 +208,7 @@ cmdfifo_get_2(voodoo_t *voodoo)
     if (!voodoo->cmdfifo_in_sub_2)
         voodoo->cmdfifo_depth_rd_2++;
     voodoo->cmdfifo_rp_2 += 4;
+    voodoo->cmdfifo_words++;
 
     //        voodoo_fifo_log("  CMDFIFO get %08x\n", val);
     return val;
@@ -229,6 +226,92 @@ cmdfifo_get_f_2(voodoo_t *voodoo)
     return tempif.f;
 }
 
+/*Returns the count words of a packet body in place if they are all in the
+  local frame buffer and already written, and moves the read pointer past
+  them. The words are only handed back to the writer once the packet has
+  been processed, through *held. Otherwise returns NULL, and the body is
+  read with cmdfifo_get()*/
+static const uint32_t *
+cmdfifo_get_span(voodoo_t *voodoo, int count, int *held)
+{
+    uint32_t start = voodoo->cmdfifo_rp & voodoo->fb_mask;
+
+    if ((count <= 0) || voodoo->cmdfifo_in_agp || (voodoo->cmdfifo_rp & 3) || ((start + (count * 4) - 1) > voodoo->fb_mask))
+        return NULL;
+    if (!voodoo->cmdfifo_in_sub && ((voodoo->cmdfifo_depth_wr - voodoo->cmdfifo_depth_rd) < count))
+        return NULL;
+
+    *held = voodoo->cmdfifo_in_sub ? 0 : count;
+    voodoo->cmdfifo_rp += count * 4;
+    voodoo->cmdfifo_words += count;
+
+    return (const uint32_t *) &voodoo->fb_mem[start];
+}
+
+static inline uint32_t
+cmdfifo_next(voodoo_t *voodoo, const uint32_t **span)
+{
+    if (*span)
+        return *(*span)++;
+
+    return cmdfifo_get(voodoo);
+}
+
+static inline float
+cmdfifo_next_f(voodoo_t *voodoo, const uint32_t **span)
+{
+    union {
+        uint32_t i;
+        float    f;
+    } tempif;
+
+    tempif.i = cmdfifo_next(voodoo, span);
+    return tempif.f;
+}
+
+/*Returns the count words of a packet body in place if they are all in the
+  local frame buffer and already written, and moves the read pointer past
+  them. The words are only handed back to the writer once the packet has
+  been processed, through *held. Otherwise returns NULL, and the body is
+  read with cmdfifo_get_2()*/
+static const uint32_t *
+cmdfifo_get_span_2(voodoo_t *voodoo, int count, int *held)
+{
+    uint32_t start = voodoo->cmdfifo_rp_2 & voodoo->fb_mask;
+
+    if ((count <= 0) || voodoo->cmdfifo_in_agp_2 || (voodoo->cmdfifo_rp_2 & 3) || ((start + (count * 4) - 1) > voodoo->fb_mask))
+        return NULL;
+    if (!voodoo->cmdfifo_in_sub_2 && ((voodoo->cmdfifo_depth_wr_2 - voodoo->cmdfifo_depth_rd_2) < count))
+        return NULL;
+
+    *held = voodoo->cmdfifo_in_sub_2 ? 0 : count;
+    voodoo->cmdfifo_rp_2 += count * 4;
+    voodoo->cmdfifo_words += count;
+
+    return (const uint32_t *) &voodoo->fb_mem[start];
+}
+
+static inline uint32_t
+cmdfifo_next_2(voodoo_t *voodoo, const uint32_t **span)
+{
+    if (*span)
+        return *(*span)++;
+
+    return cmdfifo_get_2(voodoo);
+}
+
+static inline float
+cmdfifo_next_f_2(voodoo_t *voodoo, const uint32_t **span)
+{
+    union {
+        uint32_t i;
+        float    f;
+    } tempif;
+
+    tempif.i = cmdfifo_next_2(voodoo, span);
+    return tempif.f;
+}
+
 enum {
     CMDFIFO3_PC_MASK_RGB   = (1 << 10),
     CMDFIFO3_PC_MASK_ALPHA = (1 << 11),
@@ -242,6 +325,45 @@ enum {
     CMDFIFO3_PC = (1 << 28)
 };
 
+static inline int
+cmdfifo_popcount(uint32_t val)
+{
+    int count = 0;
+
+    while (val) {
+        val &= val - 1;
+        count++;
+    }
+
+    return count;
+}
+
+/*Number of words every vertex of a packet 3 takes*/
+static int
+cmdfifo3_vertex_words(uint32_t header)
+{
+    int words = 2;
+
+    if (header & CMDFIFO3_PC_MASK_RGB)
+        words += (header & CMDFIFO3_PC) ? 1 : 3;
+    if ((header & CMDFIFO3_PC_MASK_ALPHA) && !(header & CMDFIFO3_PC))
+        words++;
+    if (header & CMDFIFO3_PC_MASK_Z)
+        words++;
+    if (header & CMDFIFO3_PC_MASK_Wb)
+        words++;
+    if (header & CMDFIFO3_PC_MASK_W0)
+        words++;
+    if (header & CMDFIFO3_PC_MASK_S0_T0)
+        words += 2;
+    if (header & CMDFIFO3_PC_MASK_W1)
+        words++;
+    if (header & CMDFIFO3_PC_MASK_S1_T1)
+        words += 2;
+
+    return words;
+}
+
 void
 voodoo_fifo_thread(void *param)
 {
@@ -252,63 +374,66 @@ voodoo_fifo_thread(void *param)
         thread_wait_event(voodoo->wake_fifo_thread, -1);
         thread_reset_event(voodoo->wake_fifo_thread);
         voodoo->voodoo_busy = 1;
+        MTR_BEGIN("voodoo", "fifo");
         while (!FIFO_EMPTY) {
             uint64_t      start_time = plat_timer_read();
             uint64_t      end_time;
-            fifo_entry_t *fifo = &voodoo->fifo[voodoo->fifo_read_idx & FIFO_MASK];
+            fifo_entry_t *fifo = &voodoo->fifo[spsc_read_pos(&voodoo->fifo_ring)];
 
             switch (fifo->addr_type & FIFO_TYPE) {
                 case FIFO_WRITEL_REG:
                     while ((fifo->addr_type & FIFO_TYPE) == FIFO_WRITEL_REG) {
                         voodoo_reg_writel(fifo->addr_type & FIFO_ADDR, fifo->val, voodoo);
                         fifo->addr_type = FIFO_INVALID;
-                        voodoo->fifo_read_idx++;
+                        spsc_pop(&voodoo->fifo_ring);
                         if (FIFO_EMPTY)
                             break;
-                        fifo = &voodoo->fifo[voodoo->fifo_read_idx & FIFO_MASK];
+                        fifo = &voodoo->fifo[spsc_read_pos(&voodoo->fifo_ring)];
                     }
                     break;
                 case FIFO_WRITEW_FB:
-                    voodoo_wait_for_render_thread_idle(voodoo);
+                    voodoo_fb_span_init(&voodoo->fifo_lfb_span, 0);
                     while ((fifo->addr_type & FIFO_TYPE) == FIFO_WRITEW_FB) {
-                        voodoo_fb_writew(fifo->addr_type & FIFO_ADDR, fifo->val, voodoo);
+                        voodoo_fb_span_write(voodoo, &voodoo->fifo_lfb_span, fifo->addr_type & FIFO_ADDR, fifo->val);
                         fifo->addr_type = FIFO_INVALID;
-                        voodoo->fifo_read_idx++;
+                        spsc_pop(&voodoo->fifo_ring);
                         if (FIFO_EMPTY)
                             break;
-                        fifo = &voodoo->fifo[voodoo->fifo_read_idx & FIFO_MASK];
+                        fifo = &voodoo->fifo[spsc_read_pos(&voodoo->fifo_ring)];
                     }
+                    voodoo_fb_span_flush(voodoo, &voodoo->fifo_lfb_span);
                     break;
                 case FIFO_WRITEL_FB:
-                    voodoo_wait_for_render_thread_idle(voodoo);
+                    voodoo_fb_span_init(&voodoo->fifo_lfb_span, 1);
                     while ((fifo->addr_type & FIFO_TYPE) == FIFO_WRITEL_FB) {
-                        voodoo_fb_writel(fifo->addr_type & FIFO_ADDR, fifo->val, voodoo);
+                        voodoo_fb_span_write(voodoo, &voodoo->fifo_lfb_span, fifo->addr_type & FIFO_ADDR, fifo->val);
                         fifo->addr_type = FIFO_INVALID;
-                        voodoo->fifo_read_idx++;
+                        spsc_pop(&voodoo->fifo_ring);
                         if (FIFO_EMPTY)
                             break;
-                        fifo = &voodoo->fifo[voodoo->fifo_read_idx & FIFO_MASK];
+                        fifo = &voodoo->fifo[spsc_read_pos(&voodoo->fifo_ring)];
                     }
+                    voodoo_fb_span_flush(voodoo, &voodoo->fifo_lfb_span);
                     break;
                 case FIFO_WRITEL_TEX:
                     while ((fifo->addr_type & FIFO_TYPE) == FIFO_WRITEL_TEX) {
                         if (!(fifo->addr_type & 0x400000))
                             voodoo_tex_writel(fifo->addr_type & FIFO_ADDR, fifo->val, voodoo);
                         fifo->addr_type = FIFO_INVALID;
-                        voodoo->fifo_read_idx++;
+                        spsc_pop(&voodoo->fifo_ring);
                         if (FIFO_EMPTY)
                             break;
-                        fifo = &voodoo->fifo[voodoo->fifo_read_idx & FIFO_MASK];
+                        fifo = &voodoo->fifo[spsc_read_pos(&voodoo->fifo_ring)];
                     }
                     break;
                 case FIFO_WRITEL_2DREG:
                     while ((fifo->addr_type & FIFO_TYPE) == FIFO_WRITEL_2DREG) {
                         voodoo_2d_reg_writel(voodoo, fifo->addr_type & FIFO_ADDR, fifo->val);
                         fifo->addr_type = FIFO_INVALID;
-                        voodoo->fifo_read_idx++;
+                        spsc_pop(&voodoo->fifo_ring);
                         if (FIFO_EMPTY)
                             break;
-                        fifo = &voodoo->fifo[voodoo->fifo_read_idx & FIFO_MASK];
+                        fifo = &voodoo->fifo[spsc_read_pos(&voodoo->fifo_ring)];
                     }
                     break;
 
@@ -316,9 +441,6 @@ voodoo_fifo_thread(void *param)
                     fatal("Unknown fifo entry %08x\n", fifo->addr_type);
             }
 
-            if (FIFO_ENTRIES > 0xe000)
-                thread_set_event(voodoo->fifo_not_full_event);
-
             end_time = plat_timer_read();
             voodoo->time += end_time - start_time;
         }
@@ -336,6 +458,8 @@ voodoo_fifo_thread(void *param)
             int      num;
             int      num_verticies;
             int      v_num;
+            const uint32_t *span = NULL;
+            int             held = 0;
 
 #if 0
             voodoo_fifo_log(" CMDFIFO header %08x at %08x\n", header, voodoo->cmdfifo_rp);
@@ -344,6 +468,7 @@ voodoo_fifo_thread(void *param)
             voodoo->cmd_status &= ~7;
             voodoo->cmd_status |= (header & 7);
             voodoo->cmd_status |= (1 << 11);
+            voodoo->cmdfifo_packets++;
             switch (header & 7) {
                 case 0:
 #if 0
@@ -396,11 +521,12 @@ voodoo_fifo_thread(void *param)
                 case 1:
                     num  = header >> 16;
                     addr = (header & 0x7ff8) >> 1;
+                    span = cmdfifo_get_span(voodoo, num, &held);
 #if 0
                     voodoo_fifo_log("CMDFIFO1 addr=%08x\n",addr);
 #endif
                     while (num--) {
-                        uint32_t val = cmdfifo_get(voodoo);
+                        uint32_t val = cmdfifo_next(voodoo, &span);
                         if ((addr & (1 << 13)) && voodoo->type >= VOODOO_BANSHEE) {
 #if 0
                             if (voodoo->type != VOODOO_BANSHEE)
@@ -430,9 +556,10 @@ voodoo_fifo_thread(void *param)
                         fatal("CMDFIFO2: Not Voodoo 2\n");
                     mask = (header >> 3);
                     addr = 8;
+                    span = cmdfifo_get_span(voodoo, cmdfifo_popcount(mask), &held);
                     while (mask) {
                         if (mask & 1) {
-                            uint32_t val = cmdfifo_get(voodoo);
+                            uint32_t val = cmdfifo_next(voodoo, &span);
 
                             voodoo_2d_reg_writel(voodoo, addr, val);
                         }
@@ -451,44 +578,45 @@ voodoo_fifo_thread(void *param)
                     v_num         = 0;
                     if (((header >> 3) & 7) == 2)
                         v_num = 1;
+                    span = cmdfifo_get_span(voodoo, (num_verticies * cmdfifo3_vertex_words(header)) + num, &held);
 #if 0
                     voodoo_fifo_log("CMDFIFO3: num=%i verts=%i mask=%02x\n", num, num_verticies, (header >> 10) & 0xff);
                     voodoo_fifo_log("CMDFIFO3 %02x %i\n", (header >> 10), (header >> 3) & 7);
 #endif
 
                     while (num_verticies--) {
-                        voodoo->verts[3].sVx = cmdfifo_get_f(voodoo);
-                        voodoo->verts[3].sVy = cmdfifo_get_f(voodoo);
+                        voodoo->verts[3].sVx = cmdfifo_next_f(voodoo, &span);
+                        voodoo->verts[3].sVy = cmdfifo_next_f(voodoo, &span);
                         if (mask & CMDFIFO3_PC_MASK_RGB) {
                             if (header & CMDFIFO3_PC) {
-                                uint32_t val            = cmdfifo_get(voodoo);
+                                uint32_t val            = cmdfifo_next(voodoo, &span);
                                 voodoo->verts[3].sBlue  = (float) (val & 0xff);
                                 voodoo->verts[3].sGreen = (float) ((val >> 8) & 0xff);
                                 voodoo->verts[3].sRed   = (float) ((val >> 16) & 0xff);
                                 voodoo->verts[3].sAlpha = (float) ((val >> 24) & 0xff);
                             } else {
-                                voodoo->verts[3].sRed   = cmdfifo_get_f(voodoo);
-                                voodoo->verts[3].sGreen = cmdfifo_get_f(voodoo);
-                                voodoo->verts[3].sBlue  = cmdfifo_get_f(voodoo);
+                                voodoo->verts[3].sRed   = cmdfifo_next_f(voodoo, &span);
+                                voodoo->verts[3].sGreen = cmdfifo_next_f(voodoo, &span);
+                                voodoo->verts[3].sBlue  = cmdfifo_next_f(voodoo, &span);
                             }
                         }
                         if ((mask & CMDFIFO3_PC_MASK_ALPHA) && !(header & CMDFIFO3_PC))
-                            voodoo->verts[3].sAlpha = cmdfifo_get_f(voodoo);
+                            voodoo->verts[3].sAlpha = cmdfifo_next_f(voodoo, &span);
                         if (mask & CMDFIFO3_PC_MASK_Z)
-                            voodoo->verts[3].sVz = cmdfifo_get_f(voodoo);
+                            voodoo->verts[3].sVz = cmdfifo_next_f(voodoo, &span);
                         if (mask & CMDFIFO3_PC_MASK_Wb)
-                            voodoo->verts[3].sWb = cmdfifo_get_f(voodoo);
+                            voodoo->verts[3].sWb = cmdfifo_next_f(voodoo, &span);
                         if (mask & CMDFIFO3_PC_MASK_W0)
-                            voodoo->verts[3].sW0 = cmdfifo_get_f(voodoo);
+                            voodoo->verts[3].sW0 = cmdfifo_next_f(voodoo, &span);
                         if (mask & CMDFIFO3_PC_MASK_S0_T0) {
-                            voodoo->verts[3].sS0 = cmdfifo_get_f(voodoo);
-                            voodoo->verts[3].sT0 = cmdfifo_get_f(voodoo);
+                            voodoo->verts[3].sS0 = cmdfifo_next_f(voodoo, &span);
+                            voodoo->verts[3].sT0 = cmdfifo_next_f(voodoo, &span);
                         }
                         if (mask & CMDFIFO3_PC_MASK_W1)
-                            voodoo->verts[3].sW1 = cmdfifo_get_f(voodoo);
+                            voodoo->verts[3].sW1 = cmdfifo_next_f(voodoo, &span);
                         if (mask & CMDFIFO3_PC_MASK_S1_T1) {
-                            voodoo->verts[3].sS1 = cmdfifo_get_f(voodoo);
-                            voodoo->verts[3].sT1 = cmdfifo_get_f(voodoo);
+                            voodoo->verts[3].sS1 = cmdfifo_next_f(voodoo, &span);
+                            voodoo->verts[3].sT1 = cmdfifo_next_f(voodoo, &span);
                         }
                         if (v_num)
                             voodoo_reg_writel(SST_sDrawTriCMD, 0, voodoo);
@@ -499,19 +627,20 @@ voodoo_fifo_thread(void *param)
                             v_num = 0;
                     }
                     while (num--)
-                        cmdfifo_get(voodoo);
+                        cmdfifo_next(voodoo, &span);
                     break;
 
                 case 4:
                     num  = (header >> 29) & 7;
                     mask = (header >> 15) & 0x3fff;
                     addr = (header & 0x7ff8) >> 1;
+                    span = cmdfifo_get_span(voodoo, cmdfifo_popcount(mask) + num, &held);
 #if 0
                     voodoo_fifo_log("CMDFIFO4 addr=%08x\n",addr);
 #endif
                     while (mask) {
                         if (mask & 1) {
-                            uint32_t val = cmdfifo_get(voodoo);
+                            uint32_t val = cmdfifo_next(voodoo, &span);
 
                             if ((addr & (1 << 13)) && voodoo->type >= VOODOO_BANSHEE) {
                                 if (voodoo->type < VOODOO_BANSHEE)
@@ -535,7 +664,7 @@ voodoo_fifo_thread(void *param)
                         mask >>= 1;
                     }
                     while (num--)
-                        cmdfifo_get(voodoo);
+                        cmdfifo_next(voodoo, &span);
                     break;
 
                 case 5:
@@ -547,6 +676,7 @@ voodoo_fifo_thread(void *param)
                     addr = cmdfifo_get(voodoo) & 0xffffff;
                     if (!num)
                         num = 1;
+                    span = cmdfifo_get_span(voodoo, num, &held);
 #if 0
                     voodoo_fifo_log("CMDFIFO5 addr=%08x num=%i\n", addr, num);
 #endif
@@ -566,22 +696,24 @@ voodoo_fifo_thread(void *param)
                                 flush_texture_cache(voodoo, addr & voodoo->texture_mask, 1);
                             }
                             while (num--) {
-                                uint32_t val = cmdfifo_get(voodoo);
+                                uint32_t val = cmdfifo_next(voodoo, &span);
                                 if (addr <= voodoo->fb_mask)
                                     *(uint32_t *) &voodoo->fb_mem[addr] = val;
                                 addr += 4;
                             }
                             break;
                         case 2: /*Framebuffer*/
+                            voodoo_fb_span_init(&voodoo->fifo_lfb_span, 1);
                             while (num--) {
-                                uint32_t val = cmdfifo_get(voodoo);
-                                voodoo_fb_writel(addr, val, voodoo);
+                                uint32_t val = cmdfifo_next(voodoo, &span);
+                                voodoo_fb_span_write(voodoo, &voodoo->fifo_lfb_span, addr, val);
                                 addr += 4;
                             }
+                            voodoo_fb_span_flush(voodoo, &voodoo->fifo_lfb_span);
                             break;
                         case 3: /*Texture*/
                             while (num--) {
-                                uint32_t val = cmdfifo_get(voodoo);
+                                uint32_t val = cmdfifo_next(voodoo, &span);
                                 voodoo_tex_writel(addr, val, voodoo);
                                 addr += 4;
                             }
@@ -613,6 +745,9 @@ voodoo_fifo_thread(void *param)
                     fatal("Bad CMDFIFO packet %08x %08x\n", header, voodoo->cmdfifo_rp);
             }
 
+            if (held)
+                voodoo->cmdfifo_depth_rd += held;
+
             end_time = plat_timer_read();
             voodoo->time += end_time - start_time;
         }
@@ -627,6 +762,8 @@ voodoo_fifo_thread(void *param)
             int      num;
             int      num_verticies;
             int      v_num;
+            const uint32_t *span = NULL;
+            int             held = 0;
 
 #if 0
             voodoo_fifo_log(" CMDFIFO header %08x at %08x\n", header, voodoo->cmdfifo_rp);
@@ -635,6 +772,7 @@ voodoo_fifo_thread(void *param)
             voodoo->cmd_status_2 &= ~7;
             voodoo->cmd_status_2 |= (header & 7);
             voodoo->cmd_status_2 |= (1 << 11);
+            voodoo->cmdfifo_packets++;
             switch (header & 7) {
                 case 0:
 #if 0
@@ -687,11 +825,12 @@ voodoo_fifo_thread(void *param)
                 case 1:
                     num  = header >> 16;
                     addr = (header & 0x7ff8) >> 1;
+                    span = cmdfifo_get_span_2(voodoo, num, &held);
 #if 0
                     voodoo_fifo_log("CMDFIFO1 addr=%08x\n",addr);
 #endif
                     while (num--) {
-                        uint32_t val = cmdfifo_get_2(voodoo);
+                        uint32_t val = cmdfifo_next_2(voodoo, &span);
                         if ((addr & (1 << 13)) && voodoo->type >= VOODOO_BANSHEE) {
 #if 0
                             if (voodoo->type != VOODOO_BANSHEE)
@@ -721,9 +860,10 @@ voodoo_fifo_thread(void *param)
                         fatal("CMDFIFO2: Not Voodoo 2\n");
                     mask = (header >> 3);
                     addr = 8;
+                    span = cmdfifo_get_span_2(voodoo, cmdfifo_popcount(mask), &held);
                     while (mask) {
                         if (mask & 1) {
-                            uint32_t val = cmdfifo_get_2(voodoo);
+                            uint32_t val = cmdfifo_next_2(voodoo, &span);
 
                             voodoo_2d_reg_writel(voodoo, addr, val);
                         }
@@ -742,44 +882,45 @@ voodoo_fifo_thread(void *param)
                     v_num         = 0;
                     if (((header >> 3) & 7) == 2)
                         v_num = 1;
+                    span = cmdfifo_get_span_2(voodoo, (num_verticies * cmdfifo3_vertex_words(header)) + num, &held);
 #if 0
                     voodoo_fifo_log("CMDFIFO3: num=%i verts=%i mask=%02x\n", num, num_verticies, (header >> 10) & 0xff);
                     voodoo_fifo_log("CMDFIFO3 %02x %i\n", (header >> 10), (header >> 3) & 7);
 #endif
 
                     while (num_verticies--) {
-                        voodoo->verts[3].sVx = cmdfifo_get_f_2(voodoo);
-                        voodoo->verts[3].sVy = cmdfifo_get_f_2(voodoo);
+                        voodoo->verts[3].sVx = cmdfifo_next_f_2(voodoo, &span);
+                        voodoo->verts[3].sVy = cmdfifo_next_f_2(voodoo, &span);
                         if (mask & CMDFIFO3_PC_MASK_RGB) {
                             if (header & CMDFIFO3_PC) {
-                                uint32_t val            = cmdfifo_get_2(voodoo);
+                                uint32_t val            = cmdfifo_next_2(voodoo, &span);
                                 voodoo->verts[3].sBlue  = (float) (val & 0xff);
                                 voodoo->verts[3].sGreen = (float) ((val >> 8) & 0xff);
                                 voodoo->verts[3].sRed   = (float) ((val >> 16) & 0xff);
                                 voodoo->verts[3].sAlpha = (float) ((val >> 24) & 0xff);
                             } else {
-                                voodoo->verts[3].sRed   = cmdfifo_get_f_2(voodoo);
-                                voodoo->verts[3].sGreen = cmdfifo_get_f_2(voodoo);
-                                voodoo->verts[3].sBlue  = cmdfifo_get_f_2(voodoo);
+                                voodoo->verts[3].sRed   = cmdfifo_next_f_2(voodoo, &span);
+                                voodoo->verts[3].sGreen = cmdfifo_next_f_2(voodoo, &span);
+                                voodoo->verts[3].sBlue  = cmdfifo_next_f_2(voodoo, &span);
                             }
                         }
                         if ((mask & CMDFIFO3_PC_MASK_ALPHA) && !(header & CMDFIFO3_PC))
-                            voodoo->verts[3].sAlpha = cmdfifo_get_f_2(voodoo);
+                            voodoo->verts[3].sAlpha = cmdfifo_next_f_2(voodoo, &span);
                         if (mask & CMDFIFO3_PC_MASK_Z)
-                            voodoo->verts[3].sVz = cmdfifo_get_f_2(voodoo);
+                            voodoo->verts[3].sVz = cmdfifo_next_f_2(voodoo, &span);
                         if (mask & CMDFIFO3_PC_MASK_Wb)
-                            voodoo->verts[3].sWb = cmdfifo_get_f_2(voodoo);
+                            voodoo->verts[3].sWb = cmdfifo_next_f_2(voodoo, &span);
                         if (mask & CMDFIFO3_PC_MASK_W0)
-                            voodoo->verts[3].sW0 = cmdfifo_get_f_2(voodoo);
+                            voodoo->verts[3].sW0 = cmdfifo_next_f_2(voodoo, &span);
                         if (mask & CMDFIFO3_PC_MASK_S0_T0) {
-                            voodoo->verts[3].sS0 = cmdfifo_get_f_2(voodoo);
-                            voodoo->verts[3].sT0 = cmdfifo_get_f_2(voodoo);
+                            voodoo->verts[3].sS0 = cmdfifo_next_f_2(voodoo, &span);
+                            voodoo->verts[3].sT0 = cmdfifo_next_f_2(voodoo, &span);
                         }
                         if (mask & CMDFIFO3_PC_MASK_W1)
-                            voodoo->verts[3].sW1 = cmdfifo_get_f_2(voodoo);
+                            voodoo->verts[3].sW1 = cmdfifo_next_f_2(voodoo, &span);
                         if (mask & CMDFIFO3_PC_MASK_S1_T1) {
-                            voodoo->verts[3].sS1 = cmdfifo_get_f_2(voodoo);
-                            voodoo->verts[3].sT1 = cmdfifo_get_f_2(voodoo);
+                            voodoo->verts[3].sS1 = cmdfifo_next_f_2(voodoo, &span);
+                            voodoo->verts[3].sT1 = cmdfifo_next_f_2(voodoo, &span);
                         }
                         if (v_num)
                             voodoo_reg_writel(SST_sDrawTriCMD, 0, voodoo);
@@ -790,19 +931,20 @@ voodoo_fifo_thread(void *param)
                             v_num = 0;
                     }
                     while (num--)
-                        cmdfifo_get_2(voodoo);
+                        cmdfifo_next_2(voodoo, &span);
                     break;
 
                 case 4:
                     num  = (header >> 29) & 7;
                     mask = (header >> 15) & 0x3fff;
                     addr = (header & 0x7ff8) >> 1;
+                    span = cmdfifo_get_span_2(voodoo, cmdfifo_popcount(mask) + num, &held);
 #if 0
                     voodoo_fifo_log("CMDFIFO4 addr=%08x\n",addr);
 #endif
                     while (mask) {
                         if (mask & 1) {
-                            uint32_t val = cmdfifo_get_2(voodoo);
+                            uint32_t val = cmdfifo_next_2(voodoo, &span);
 
                             if ((addr & (1 << 13)) && voodoo->type >= VOODOO_BANSHEE) {
                                 if (voodoo->type < VOODOO_BANSHEE)
@@ -826,7 +968,7 @@ voodoo_fifo_thread(void *param)
                         mask >>= 1;
                     }
                     while (num--)
-                        cmdfifo_get_2(voodoo);
+                        cmdfifo_next_2(voodoo, &span);
                     break;
 
                 case 5:
@@ -838,6 +980,7 @@ voodoo_fifo_thread(void *param)
                     addr = cmdfifo_get_2(voodoo) & 0xffffff;
                     if (!num)
                         num = 1;
+                    span = cmdfifo_get_span_2(voodoo, num, &held);
 #if 0
                     voodoo_fifo_log("CMDFIFO5 addr=%08x num=%i\n", addr, num);
 #endif
@@ -857,22 +1000,24 @@ voodoo_fifo_thread(void *param)
                                 flush_texture_cache(voodoo, addr & voodoo->texture_mask, 1);
                             }
                             while (num--) {
-                                uint32_t val = cmdfifo_get_2(voodoo);
+                                uint32_t val = cmdfifo_next_2(voodoo, &span);
                                 if (addr <= voodoo->fb_mask)
                                     *(uint32_t *) &voodoo->fb_mem[addr] = val;
                                 addr += 4;
                             }
                             break;
                         case 2: /*Framebuffer*/
+                            voodoo_fb_span_init(&voodoo->fifo_lfb_span, 1);
                             while (num--) {
-                                uint32_t val = cmdfifo_get_2(voodoo);
-                                voodoo_fb_writel(addr, val, voodoo);
+                                uint32_t val = cmdfifo_next_2(voodoo, &span);
+                                voodoo_fb_span_write(voodoo, &voodoo->fifo_lfb_span, addr, val);
                                 addr += 4;
                             }
+                            voodoo_fb_span_flush(voodoo, &voodoo->fifo_lfb_span);
                             break;
                         case 3: /*Texture*/
                             while (num--) {
-                                uint32_t val = cmdfifo_get_2(voodoo);
+                                uint32_t val = cmdfifo_next_2(voodoo, &span);
                                 voodoo_tex_writel(addr, val, voodoo);
                                 addr += 4;
                             }
@@ -904,10 +1049,22 @@ voodoo_fifo_thread(void *param)
                     fatal("Bad CMDFIFO packet %08x %08x\n", header, voodoo->cmdfifo_rp);
             }
 
+            if (held)
+                voodoo->cmdfifo_depth_rd_2 += held;
+
             end_time = plat_timer_read();
             voodoo->time += end_time - start_time;
         }
 
+        if ((plat_get_ticks() - voodoo->cmdfifo_stats_time) >= 1000) {
+            if (voodoo->cmdfifo_packets)
+                voodoo_fifo_log("CMDFIFO: %u packets, %u words in the last second\n", voodoo->cmdfifo_packets, voodoo->cmdfifo_words);
+            voodoo->cmdfifo_packets    = 0;
+            voodoo->cmdfifo_words      = 0;
+            voodoo->cmdfifo_stats_time = plat_get_ticks();
+        }
+
+        MTR_END("voodoo", "fifo");
         voodoo->voodoo_busy = 0;
     }
 }
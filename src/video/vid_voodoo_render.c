@@ -38,7 +38,19 @@
 #include <86box/vid_voodoo_dither.h>
 #include <86box/vid_voodoo_regs.h>
 #include <86box/vid_voodoo_render.h>
+#include <86box/vid_voodoo_fb.h>
 #include <86box/vid_voodoo_texture.h>
+#include <minitrace/minitrace.h>
+
+/* There is no recompiler for ARM hosts, so the interpreted pipeline at
+   least filters texels with NEON. */
+#if defined(__ARM_NEON) || defined(_M_ARM64)
+#    define VOODOO_RENDER_NEON
+#    include <arm_neon.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#    define VOODOO_RENDER_SSE2
+#    include <emmintrin.h>
+#endif
 
 typedef struct voodoo_state_t {
     int      xstart, xend, xdir;
@@ -280,10 +292,30 @@ tex_read_4(voodoo_state_t *state, voodoo_texture_state_t *texture_state, int s,
         dat[3].u = state->tex[tmu][state->lod][s + 1 + ((t + 1) << texture_state->tex_shift)];
     }
 
+#ifdef VOODOO_RENDER_NEON
+    /* The weights add up to 256, so every sum fits in 16 bits. */
+    {
+        const uint8x16_t texels = vreinterpretq_u8_u32(vld1q_u32((const uint32_t *) dat));
+        const uint16x8_t w01    = vcombine_u16(vdup_n_u16(d[0]), vdup_n_u16(d[1]));
+        const uint16x8_t w23    = vcombine_u16(vdup_n_u16(d[2]), vdup_n_u16(d[3]));
+        uint16x8_t       sum;
+        uint16x4_t       res;
+
+        sum = vmulq_u16(vmovl_u8(vget_low_u8(texels)), w01);
+        sum = vmlaq_u16(sum, vmovl_u8(vget_high_u8(texels)), w23);
+        res = vshr_n_u16(vadd_u16(vget_low_u16(sum), vget_high_u16(sum)), 8);
+
+        state->tex_b[tmu] = vget_lane_u16(res, 0);
+        state->tex_g[tmu] = vget_lane_u16(res, 1);
+        state->tex_r[tmu] = vget_lane_u16(res, 2);
+        state->tex_a[tmu] = vget_lane_u16(res, 3);
+    }
+#else
     state->tex_r[tmu] = (dat[0].rgba.r * d[0] + dat[1].rgba.r * d[1] + dat[2].rgba.r * d[2] + dat[3].rgba.r * d[3]) >> 8;
     state->tex_g[tmu] = (dat[0].rgba.g * d[0] + dat[1].rgba.g * d[1] + dat[2].rgba.g * d[2] + dat[3].rgba.g * d[3]) >> 8;
     state->tex_b[tmu] = (dat[0].rgba.b * d[0] + dat[1].rgba.b * d[1] + dat[2].rgba.b * d[2] + dat[3].rgba.b * d[3]) >> 8;
     state->tex_a[tmu] = (dat[0].rgba.a * d[0] + dat[1].rgba.a * d[1] + dat[2].rgba.a * d[2] + dat[3].rgba.a * d[3]) >> 8;
+#endif
 }
 
 static inline void
@@ -663,6 +695,166 @@ voodoo_tmu_fetch_and_blend(voodoo_t *voodoo, voodoo_params_t *params, voodoo_sta
 int voodoo_recomp = 0;
 #endif
 
+/* Depth test four neighbouring pixels of a span at once. z is the iterated Z
+   of the leftmost pixel in memory order. Returns non-zero if all four pixels
+   fail, in which case the interpreted pipeline can skip them as a group. */
+static int
+voodoo_span_depth_fail4(const uint16_t *aux_mem, uint32_t z, uint32_t dz, int bias, int op)
+{
+#if defined(VOODOO_RENDER_SSE2)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i max  = _mm_set1_epi32(0xffff);
+    __m128i       depth;
+    __m128i       old_depth;
+    __m128i       mask;
+    __m128i       pass;
+
+    depth = _mm_set_epi32(z + dz * 3, z + dz * 2, z + dz, z);
+    depth = _mm_srai_epi32(depth, 12);
+    depth = _mm_andnot_si128(_mm_cmplt_epi32(depth, zero), depth);
+    mask  = _mm_cmpgt_epi32(depth, max);
+    depth = _mm_or_si128(_mm_and_si128(mask, max), _mm_andnot_si128(mask, depth));
+    if (bias) {
+        depth = _mm_add_epi32(depth, _mm_set1_epi32(bias));
+        depth = _mm_andnot_si128(_mm_cmplt_epi32(depth, zero), depth);
+        mask  = _mm_cmpgt_epi32(depth, max);
+        depth = _mm_or_si128(_mm_and_si128(mask, max), _mm_andnot_si128(mask, depth));
+    }
+
+    old_depth = _mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i *) aux_mem), zero);
+
+    switch (op) {
+        case DEPTHOP_LESSTHAN:
+            pass = _mm_cmplt_epi32(depth, old_depth);
+            break;
+        case DEPTHOP_EQUAL:
+            pass = _mm_cmpeq_epi32(depth, old_depth);
+            break;
+        case DEPTHOP_LESSTHANEQUAL:
+            pass = _mm_xor_si128(_mm_cmpgt_epi32(depth, old_depth), _mm_set1_epi32(-1));
+            break;
+        case DEPTHOP_GREATERTHAN:
+            pass = _mm_cmpgt_epi32(depth, old_depth);
+            break;
+        case DEPTHOP_NOTEQUAL:
+            pass = _mm_xor_si128(_mm_cmpeq_epi32(depth, old_depth), _mm_set1_epi32(-1));
+            break;
+        case DEPTHOP_GREATERTHANEQUAL:
+            pass = _mm_xor_si128(_mm_cmplt_epi32(depth, old_depth), _mm_set1_epi32(-1));
+            break;
+        case DEPTHOP_NEVER:
+            return 1;
+        default:
+            return 0;
+    }
+
+    return !_mm_movemask_epi8(pass);
+#elif defined(VOODOO_RENDER_NEON)
+    const int32_t lanes[4] = { z, z + dz, z + dz * 2, z + dz * 3 };
+    int32x4_t     depth;
+    int32x4_t     old_depth;
+    uint32x4_t    pass;
+    uint32x2_t    any;
+
+    depth = vshrq_n_s32(vld1q_s32(lanes), 12);
+    depth = vminq_s32(vmaxq_s32(depth, vdupq_n_s32(0)), vdupq_n_s32(0xffff));
+    if (bias)
+        depth = vminq_s32(vmaxq_s32(vaddq_s32(depth, vdupq_n_s32(bias)), vdupq_n_s32(0)), vdupq_n_s32(0xffff));
+
+    old_depth = vreinterpretq_s32_u32(vmovl_u16(vld1_u16(aux_mem)));
+
+    switch (op) {
+        case DEPTHOP_LESSTHAN:
+            pass = vcltq_s32(depth, old_depth);
+            break;
+        case DEPTHOP_EQUAL:
+            pass = vceqq_s32(depth, old_depth);
+            break;
+        case DEPTHOP_LESSTHANEQUAL:
+            pass = vcleq_s32(depth, old_depth);
+            break;
+        case DEPTHOP_GREATERTHAN:
+            pass = vcgtq_s32(depth, old_depth);
+            break;
+        case DEPTHOP_NOTEQUAL:
+            pass = vmvnq_u32(vceqq_s32(depth, old_depth));
+            break;
+        case DEPTHOP_GREATERTHANEQUAL:
+            pass = vcgeq_s32(depth, old_depth);
+            break;
+        case DEPTHOP_NEVER:
+            return 1;
+        default:
+            return 0;
+    }
+
+    any = vorr_u32(vget_low_u32(pass), vget_high_u32(pass));
+    return !(vget_lane_u32(any, 0) | vget_lane_u32(any, 1));
+#else
+    for (int c = 0; c < 4; c++) {
+        int32_t new_depth = CLAMP16((int32_t) (z + dz * c) >> 12);
+        int     old_depth = aux_mem[c];
+
+        if (bias)
+            new_depth = CLAMP16(new_depth + bias);
+
+        switch (op) {
+            case DEPTHOP_LESSTHAN:
+                if (new_depth < old_depth)
+                    return 0;
+                break;
+            case DEPTHOP_EQUAL:
+                if (new_depth == old_depth)
+                    return 0;
+                break;
+            case DEPTHOP_LESSTHANEQUAL:
+                if (new_depth <= old_depth)
+                    return 0;
+                break;
+            case DEPTHOP_GREATERTHAN:
+                if (new_depth > old_depth)
+                    return 0;
+                break;
+            case DEPTHOP_NOTEQUAL:
+                if (new_depth != old_depth)
+                    return 0;
+                break;
+            case DEPTHOP_GREATERTHANEQUAL:
+                if (new_depth >= old_depth)
+                    return 0;
+                break;
+            case DEPTHOP_NEVER:
+                break;
+            default:
+                return 0;
+        }
+    }
+
+    return 1;
+#endif
+}
+
+/* Step the span iterators over count pixels that were rejected as a group. */
+static void
+voodoo_span_skip(const voodoo_params_t *params, voodoo_state_t *state, int count)
+{
+    if (state->xdir < 0)
+        count = -count;
+
+    state->ir += params->dRdX * count;
+    state->ig += params->dGdX * count;
+    state->ib += params->dBdX * count;
+    state->ia += params->dAdX * count;
+    state->z += params->dZdX * count;
+    state->tmu0_s += params->tmu[0].dSdX * count;
+    state->tmu0_t += params->tmu[0].dTdX * count;
+    state->tmu0_w += params->tmu[0].dWdX * count;
+    state->tmu1_s += params->tmu[1].dSdX * count;
+    state->tmu1_t += params->tmu[1].dTdX * count;
+    state->tmu1_w += params->tmu[1].dWdX * count;
+    state->w += params->dWdX * count;
+}
+
 static void
 voodoo_half_triangle(voodoo_t *voodoo, voodoo_params_t *params, voodoo_state_t *state, int ystart, int yend, int odd_even)
 {
@@ -698,6 +890,10 @@ voodoo_half_triangle(voodoo_t *voodoo, voodoo_params_t *params, voodoo_state_t *
 #endif
     int y_diff   = SLI_ENABLED ? 2 : 1;
     int y_origin = (voodoo->type >= VOODOO_BANSHEE) ? voodoo->y_origin_swap : (voodoo->v_disp - 1);
+    /*Occluded groups of pixels can be rejected before running the rest of
+      the pipeline when the depth test only depends on iterated Z*/
+    int span_depth = (params->fbzMode & FBZ_DEPTH_ENABLE) && !(params->fbzMode & (FBZ_W_BUFFER | FBZ_DEPTH_SOURCE)) && (depth_op != DEPTHOP_ALWAYS) && !voodoo->params.aux_tiled;
+    int span_bias  = (params->fbzMode & FBZ_DEPTH_BIAS) ? (int16_t) params->zaColor : 0;
 
     if ((params->textureMode[0] & TEXTUREMODE_MASK) == TEXTUREMODE_PASSTHROUGH || (params->textureMode[0] & TEXTUREMODE_LOCAL_MASK) == TEXTUREMODE_LOCAL)
         texels = 1;
@@ -830,10 +1026,10 @@ voodoo_half_triangle(voodoo_t *voodoo, voodoo_params_t *params, voodoo_state_t *
             real_y >>= 4;
 
         if (SLI_ENABLED) {
-            if (((real_y >> 1) & voodoo->odd_even_mask) != odd_even)
+            if ((((real_y >> 1) >> VOODOO_RENDER_BAND_SHIFT) & voodoo->odd_even_mask) != odd_even)
                 goto next_line;
         } else {
-            if ((real_y & voodoo->odd_even_mask) != odd_even)
+            if (((real_y >> VOODOO_RENDER_BAND_SHIFT) & voodoo->odd_even_mask) != odd_even)
                 goto next_line;
         }
 
@@ -942,6 +1138,23 @@ voodoo_half_triangle(voodoo_t *voodoo, voodoo_params_t *params, voodoo_state_t *
 #endif
             do {
                 int x_tiled = (x & 63) | ((x >> 6) * 128 * 32 / 2);
+
+                if (span_depth && (((x2 - x) * state->xdir) >= 3)) {
+                    const uint16_t *aux = (state->xdir > 0) ? &aux_mem[x] : &aux_mem[x - 3];
+                    uint32_t        z   = (state->xdir > 0) ? (uint32_t) state->z : ((uint32_t) state->z - (uint32_t) params->dZdX * 3);
+
+                    if (voodoo_span_depth_fail4(aux, z, params->dZdX, span_bias, depth_op)) {
+                        voodoo->pixel_count[odd_even] += 4;
+                        voodoo->texel_count[odd_even] += texels * 4;
+                        voodoo->fbiPixelsIn += 4;
+                        voodoo->fbiZFuncFail += 4;
+                        voodoo_span_skip(params, state, 4);
+                        x += state->xdir * 4;
+                        start_x = x - state->xdir;
+                        continue;
+                    }
+                }
+
                 start_x     = x;
                 state->x    = x;
                 voodoo->pixel_count[odd_even]++;
@@ -1558,13 +1771,23 @@ render_thread(void *param, int odd_even)
         thread_wait_event(voodoo->wake_render_thread[odd_even], -1);
         thread_reset_event(voodoo->wake_render_thread[odd_even]);
         voodoo->render_voodoo_busy[odd_even] = 1;
+        MTR_BEGIN("voodoo", "render");
 
         while (!PARAM_EMPTY(odd_even)) {
             uint64_t         start_time = plat_timer_read();
             uint64_t         end_time;
             voodoo_params_t *params = &voodoo->params_buffer[voodoo->params_read_idx[odd_even] & PARAM_MASK];
 
-            voodoo_triangle(voodoo, params, odd_even);
+            if (params->command == PARAMS_LFB_SPAN) {
+                if (params->render_mask & (1 << odd_even))
+                    voodoo_fb_span(voodoo, params, &voodoo->lfb_spans[voodoo->params_read_idx[odd_even] & PARAM_MASK]);
+            } else if (params->render_mask & (1 << odd_even))
+                voodoo_triangle(voodoo, params, odd_even);
+            else {
+                /*No lines in this thread's bands, only release the textures*/
+                voodoo->texture_cache[0][params->tex_entry[0]].refcount_r[odd_even]++;
+                voodoo->texture_cache[1][params->tex_entry[1]].refcount_r[odd_even]++;
+            }
 
             voodoo->params_read_idx[odd_even]++;
 
@@ -1575,29 +1798,94 @@ render_thread(void *param, int odd_even)
             voodoo->render_time[odd_even] += end_time - start_time;
         }
 
+        MTR_END("voodoo", "render");
         voodoo->render_voodoo_busy[odd_even] = 0;
     }
 }
 
 void
-voodoo_render_thread_1(void *param)
+voodoo_render_thread(void *param)
 {
-    render_thread(param, 0);
+    const voodoo_render_param_t *render_param = (voodoo_render_param_t *) param;
+
+    render_thread(render_param->voodoo, render_param->odd_even);
 }
-void
-voodoo_render_thread_2(void *param)
+
+/*Work out which render threads own at least one line of the triangle, so that
+  the others can skip the triangle setup entirely. This is conservative - any
+  case that can not be cheaply bounded is sent to every thread*/
+static uint32_t
+voodoo_triangle_render_mask(voodoo_t *voodoo, const voodoo_params_t *params)
 {
-    render_thread(param, 1);
+    uint32_t all_mask = (1u << voodoo->render_threads) - 1;
+    uint32_t mask     = 0;
+    int      ystart;
+    int      yend;
+
+    if (voodoo->render_threads == 1)
+        return all_mask;
+    /*Flipped Y origin - the origin register may be changed while the triangle is queued*/
+    if (params->fbzMode & (1 << 17))
+        return all_mask;
+
+    ystart = (int16_t) (params->vertexAy & 0xffff);
+    yend   = (int16_t) (params->vertexCy & 0xffff);
+    ystart = (ystart + 7) >> 4;
+    yend   = (yend + 7) >> 4;
+
+    if (params->fbzMode & 1) {
+        if (ystart < params->clipLowY)
+            ystart = params->clipLowY;
+        if (yend >= params->clipHighY)
+            yend = params->clipHighY;
+    }
+    if (yend <= ystart)
+        return 0;
+    yend--;
+
+    if (SLI_ENABLED) {
+        ystart >>= 1;
+        yend >>= 1;
+    }
+
+    for (int band = ystart >> VOODOO_RENDER_BAND_SHIFT; band <= (yend >> VOODOO_RENDER_BAND_SHIFT); band++) {
+        mask |= 1u << (band & voodoo->odd_even_mask);
+        if (mask == all_mask)
+            break;
+    }
+
+    return mask;
 }
-void
-voodoo_render_thread_3(void *param)
+
+static void
+voodoo_wait_for_params_space(voodoo_t *voodoo)
 {
-    render_thread(param, 2);
+    int full;
+
+    do {
+        full = 0;
+        for (int c = 0; c < voodoo->render_threads; c++) {
+            if (PARAM_FULL(c)) {
+                thread_reset_event(voodoo->render_not_full_event[c]);
+                if (PARAM_FULL(c))
+                    thread_wait_event(voodoo->render_not_full_event[c], -1); /*Wait for room in ringbuffer*/
+                full = 1;
+            }
+        }
+    } while (full);
 }
-void
-voodoo_render_thread_4(void *param)
+
+static void
+voodoo_params_queued(voodoo_t *voodoo)
 {
-    render_thread(param, 3);
+    voodoo->params_write_idx++;
+
+    for (int c = 0; c < voodoo->render_threads; c++) {
+        if (PARAM_ENTRIES(c) < 4) {
+            voodoo_wake_render_thread(voodoo);
+            break;
+        }
+    }
 }
 
 void
@@ -1605,32 +1893,34 @@ voodoo_queue_triangle(voodoo_t *voodoo, voodoo_params_t *params)
 {
     voodoo_params_t *params_new = &voodoo->params_buffer[voodoo->params_write_idx & PARAM_MASK];
 
-    while (PARAM_FULL(0) || (voodoo->render_threads >= 2 && PARAM_FULL(1)) || (voodoo->render_threads == 4 && (PARAM_FULL(2) || PARAM_FULL(3)))) {
-        thread_reset_event(voodoo->render_not_full_event[0]);
-        if (voodoo->render_threads >= 2)
-            thread_reset_event(voodoo->render_not_full_event[1]);
-        if (voodoo->render_threads == 4) {
-            thread_reset_event(voodoo->render_not_full_event[2]);
-            thread_reset_event(voodoo->render_not_full_event[3]);
-        }
-        if (PARAM_FULL(0))
-            thread_wait_event(voodoo->render_not_full_event[0], -1); /*Wait for room in ringbuffer*/
-        if (voodoo->render_threads >= 2 && PARAM_FULL(1))
-            thread_wait_event(voodoo->render_not_full_event[1], -1); /*Wait for room in ringbuffer*/
-        if (voodoo->render_threads == 4 && PARAM_FULL(2))
-            thread_wait_event(voodoo->render_not_full_event[2], -1); /*Wait for room in ringbuffer*/
-        if (voodoo->render_threads == 4 && PARAM_FULL(3))
-            thread_wait_event(voodoo->render_not_full_event[3], -1); /*Wait for room in ringbuffer*/
-    }
+    voodoo_wait_for_params_space(voodoo);
 
     voodoo_use_texture(voodoo, params, 0);
     if (voodoo->dual_tmus)
         voodoo_use_texture(voodoo, params, 1);
 
     memcpy(params_new, params, sizeof(voodoo_params_t));
+    params_new->command     = PARAMS_TRIANGLE;
+    params_new->render_mask = voodoo_triangle_render_mask(voodoo, params_new);
 
-    voodoo->params_write_idx++;
+    voodoo_params_queued(voodoo);
+}
+
+/*Queues a run of LFB writes behind the triangles already in the ring, so that
+  the FIFO thread no longer has to wait for the render threads to go idle
+  before each batch of writes. Only the thread owning the span's line runs it*/
+void
+voodoo_queue_lfb_span(voodoo_t *voodoo, const voodoo_lfb_span_t *span)
+{
+    int              idx        = voodoo->params_write_idx & PARAM_MASK;
+    voodoo_params_t *params_new = &voodoo->params_buffer[idx];
+
+    voodoo_wait_for_params_space(voodoo);
+
+    memcpy(params_new, &voodoo->params, sizeof(voodoo_params_t));
+    memcpy(&voodoo->lfb_spans[idx], span, offsetof(voodoo_lfb_span_t, data) + span->count * sizeof(span->data[0]));
+    params_new->command     = PARAMS_LFB_SPAN;
+    params_new->render_mask = 1u << ((span->y >> VOODOO_RENDER_BAND_SHIFT) & voodoo->odd_even_mask);
 
-    if (PARAM_ENTRIES(0) < 4 || (voodoo->render_threads >= 2 && PARAM_ENTRIES(1) < 4) || (voodoo->render_threads == 4 && (PARAM_ENTRIES(2) < 4 || PARAM_ENTRIES(3) < 4)))
-        voodoo_wake_render_thread(voodoo);
+    voodoo_params_queued(voodoo);
 }
@@ -58,6 +58,185 @@ voodoo_texture_log(const char *fmt, ...)
 #    define voodoo_texture_log(fmt, ...)
 #endif
 
+/* Row converters for the formats that are computed rather than looked up.
+   They handle whole groups of 8 texels and return how many they did, the
+   scalar loop finishes the row. Rows that wrap around the end of texture
+   memory are left to the scalar loop as well. */
+#if defined(__ARM_NEON) || defined(_M_ARM64)
+#    define VOODOO_TEXTURE_SIMD
+#    include <arm_neon.h>
+
+typedef uint16x8_t tex_vec_t;
+
+#    define tex_vec_load8(p)   vmovl_u8(vld1_u8(p))
+#    define tex_vec_load16(p)  vld1q_u16((const uint16_t *) (p))
+#    define tex_vec_const(c)   vdupq_n_u16(c)
+#    define tex_vec_and(a, c)  vandq_u16(a, vdupq_n_u16(c))
+#    define tex_vec_or(a, b)   vorrq_u16(a, b)
+#    define tex_vec_shl(a, n)  vshlq_n_u16(a, n)
+#    define tex_vec_shr(a, n)  vshrq_n_u16(a, n)
+#    define tex_vec_sar(a, n)  vreinterpretq_u16_s16(vshrq_n_s16(vreinterpretq_s16_u16(a), n))
+
+/*Interleaves the blue/green and red/alpha halves into 8 ARGB texels*/
+static __inline void
+tex_vec_store(uint32_t *dst, tex_vec_t bg, tex_vec_t ra)
+{
+    uint16x8x2_t texels;
+
+    texels.val[0] = bg;
+    texels.val[1] = ra;
+    vst2q_u16((uint16_t *) dst, texels);
+}
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#    define VOODOO_TEXTURE_SIMD
+#    include <emmintrin.h>
+
+typedef __m128i tex_vec_t;
+
+#    define tex_vec_load8(p)   _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *) (p)), _mm_setzero_si128())
+#    define tex_vec_load16(p)  _mm_loadu_si128((const __m128i *) (p))
+#    define tex_vec_const(c)   _mm_set1_epi16(c)
+#    define tex_vec_and(a, c)  _mm_and_si128(a, _mm_set1_epi16(c))
+#    define tex_vec_or(a, b)   _mm_or_si128(a, b)
+#    define tex_vec_shl(a, n)  _mm_slli_epi16(a, n)
+#    define tex_vec_shr(a, n)  _mm_srli_epi16(a, n)
+#    define tex_vec_sar(a, n)  _mm_srai_epi16(a, n)
+
+/*Interleaves the blue/green and red/alpha halves into 8 ARGB texels*/
+static __inline void
+tex_vec_store(uint32_t *dst, tex_vec_t bg, tex_vec_t ra)
+{
+    _mm_storeu_si128((__m128i *) dst, _mm_unpacklo_epi16(bg, ra));
+    _mm_storeu_si128((__m128i *) &dst[4], _mm_unpackhi_epi16(bg, ra));
+}
+#endif
+
+#ifdef VOODOO_TEXTURE_SIMD
+/*Widen 5 and 6 bit channels the same way as the lookup tables in vid_voodoo.c*/
+#    define tex_vec_expand5(a) tex_vec_or(tex_vec_shl(a, 3), tex_vec_shr(a, 2))
+#    define tex_vec_expand6(a) tex_vec_or(tex_vec_shl(a, 2), tex_vec_shr(a, 4))
+#    define tex_vec_expand4(a) tex_vec_or(tex_vec_shl(a, 4), a)
+
+static int
+texture_row_a8(uint32_t *dst, const uint8_t *src, int w)
+{
+    int x;
+
+    for (x = 0; x + 8 <= w; x += 8) {
+        tex_vec_t i = tex_vec_load8(&src[x]);
+
+        i = tex_vec_or(i, tex_vec_shl(i, 8));
+        tex_vec_store(&dst[x], i, i);
+    }
+
+    return x;
+}
+
+static int
+texture_row_i8(uint32_t *dst, const uint8_t *src, int w)
+{
+    int x;
+
+    for (x = 0; x + 8 <= w; x += 8) {
+        tex_vec_t i = tex_vec_load8(&src[x]);
+
+        tex_vec_store(&dst[x], tex_vec_or(i, tex_vec_shl(i, 8)), tex_vec_or(i, tex_vec_const(0xff00)));
+    }
+
+    return x;
+}
+
+static int
+texture_row_ai44(uint32_t *dst, const uint8_t *src, int w)
+{
+    int x;
+
+    for (x = 0; x + 8 <= w; x += 8) {
+        tex_vec_t dat = tex_vec_load8(&src[x]);
+        tex_vec_t i   = tex_vec_expand4(tex_vec_and(dat, 0x0f));
+        tex_vec_t a   = tex_vec_expand4(tex_vec_shr(dat, 4));
+
+        tex_vec_store(&dst[x], tex_vec_or(i, tex_vec_shl(i, 8)), tex_vec_or(i, tex_vec_shl(a, 8)));
+    }
+
+    return x;
+}
+
+static int
+texture_row_r5g6b5(uint32_t *dst, const uint8_t *src, int w)
+{
+    int x;
+
+    for (x = 0; x + 8 <= w; x += 8) {
+        tex_vec_t dat = tex_vec_load16(&src[x * 2]);
+        tex_vec_t r   = tex_vec_expand5(tex_vec_shr(dat, 11));
+        tex_vec_t g   = tex_vec_expand6(tex_vec_and(tex_vec_shr(dat, 5), 0x3f));
+        tex_vec_t b   = tex_vec_expand5(tex_vec_and(dat, 0x1f));
+
+        tex_vec_store(&dst[x], tex_vec_or(b, tex_vec_shl(g, 8)), tex_vec_or(r, tex_vec_const(0xff00)));
+    }
+
+    return x;
+}
+
+static int
+texture_row_argb1555(uint32_t *dst, const uint8_t *src, int w)
+{
+    int x;
+
+    for (x = 0; x + 8 <= w; x += 8) {
+        tex_vec_t dat = tex_vec_load16(&src[x * 2]);
+        tex_vec_t r   = tex_vec_expand5(tex_vec_and(tex_vec_shr(dat, 10), 0x1f));
+        tex_vec_t g   = tex_vec_expand5(tex_vec_and(tex_vec_shr(dat, 5), 0x1f));
+        tex_vec_t b   = tex_vec_expand5(tex_vec_and(dat, 0x1f));
+        tex_vec_t a   = tex_vec_and(tex_vec_sar(dat, 15), 0xff00);
+
+        tex_vec_store(&dst[x], tex_vec_or(b, tex_vec_shl(g, 8)), tex_vec_or(r, a));
+    }
+
+    return x;
+}
+
+static int
+texture_row_argb4444(uint32_t *dst, const uint8_t *src, int w)
+{
+    int x;
+
+    for (x = 0; x + 8 <= w; x += 8) {
+        tex_vec_t dat = tex_vec_load16(&src[x * 2]);
+        tex_vec_t a   = tex_vec_expand4(tex_vec_shr(dat, 12));
+        tex_vec_t r   = tex_vec_expand4(tex_vec_and(tex_vec_shr(dat, 8), 0x0f));
+        tex_vec_t g   = tex_vec_expand4(tex_vec_and(tex_vec_shr(dat, 4), 0x0f));
+        tex_vec_t b   = tex_vec_expand4(tex_vec_and(dat, 0x0f));
+
+        tex_vec_store(&dst[x], tex_vec_or(b, tex_vec_shl(g, 8)), tex_vec_or(r, tex_vec_shl(a, 8)));
+    }
+
+    return x;
+}
+
+static int
+texture_row_a8i8(uint32_t *dst, const uint8_t *src, int w)
+{
+    int x;
+
+    for (x = 0; x + 8 <= w; x += 8) {
+        tex_vec_t dat = tex_vec_load16(&src[x * 2]);
+        tex_vec_t i   = tex_vec_and(dat, 0xff);
+
+        tex_vec_store(&dst[x], tex_vec_or(i, tex_vec_shl(i, 8)), dat);
+    }
+
+    return x;
+}
+
+#    define TEX_ROW_SIMD(decode, bytes)                                                      \
+        if (((tex_addr & voodoo->texture_mask) + w * (bytes)) <= (voodoo->texture_mask + 1)) \
+            x = decode(base, &voodoo->tex_mem[tmu][tex_addr & voodoo->texture_mask], w)
+#else
+#    define TEX_ROW_SIMD(decode, bytes)
+#endif
+
 void
 voodoo_recalc_tex12(voodoo_t *voodoo, int tmu)
 {
@@ -239,272 +418,517 @@ voodoo_recalc_tex3(voodoo_t *voodoo, int tmu)
 
 #define makergba(r, g, b, a) ((b) | ((g) << 8) | ((r) << 16) | ((a) << 24))
 
-void
-voodoo_use_texture(voodoo_t *voodoo, voodoo_params_t *params, int tmu)
+/*Returns non-zero once every render thread has finished with the texture*/
+static int
+voodoo_texture_idle(voodoo_t *voodoo, texture_t *texture)
 {
-    int      c;
-    int      lod_min;
-    int      lod_max;
-    uint32_t addr = 0;
-    uint32_t addr_end;
-    uint32_t palette_checksum;
-
-    lod_min = (params->tLOD[tmu] >> 2) & 15;
-    lod_max = (params->tLOD[tmu] >> 8) & 15;
+    for (int c = 0; c < voodoo->render_threads; c++) {
+        if (texture->refcount != texture->refcount_r[c])
+            return 0;
+    }
 
-    if (params->tformat[tmu] == TEX_PAL8 || params->tformat[tmu] == TEX_APAL8 || params->tformat[tmu] == TEX_APAL88) {
-        if (voodoo->palette_dirty[tmu]) {
-            palette_checksum = 0;
+    return 1;
+}
 
-            for (c = 0; c < 256; c++)
-                palette_checksum ^= voodoo->palette[tmu][c].u;
+static __inline int
+texture_hash(uint32_t base, uint32_t tLOD, uint32_t palette_checksum)
+{
+    uint32_t h = (base >> 3) ^ (tLOD * 0x9e3779b1) ^ palette_checksum;
 
-            voodoo->palette_checksum[tmu] = palette_checksum;
-            voodoo->palette_dirty[tmu]    = 0;
-        } else
-            palette_checksum = voodoo->palette_checksum[tmu];
-    } else
-        palette_checksum = 0;
+    return (h ^ (h >> 8) ^ (h >> 16)) & (TEX_HASH_SIZE - 1);
+}
 
-    if ((voodoo->params.tLOD[tmu] & LOD_SPLIT) && (voodoo->params.tLOD[tmu] & LOD_ODD) && (voodoo->params.tLOD[tmu] & LOD_TMULTIBASEADDR))
-        addr = params->texBaseAddr1[tmu];
-    else
-        addr = params->texBaseAddr[tmu];
+static void
+texture_hash_remove(voodoo_t *voodoo, int tmu, int entry)
+{
+    texture_t *texture = &voodoo->texture_cache[tmu][entry];
+    int       *prev    = &voodoo->texture_hash[tmu][texture_hash(texture->base, texture->tLOD, texture->palette_checksum)];
 
-    /*Try to find texture in cache*/
-    for (c = 0; c < TEX_CACHE_MAX; c++) {
-        if (voodoo->texture_cache[tmu][c].base == addr && voodoo->texture_cache[tmu][c].tLOD == (params->tLOD[tmu] & 0xf00fff) && voodoo->texture_cache[tmu][c].palette_checksum == palette_checksum) {
-            params->tex_entry[tmu] = c;
-            voodoo->texture_cache[tmu][c].refcount++;
-            return;
+    while (*prev != -1) {
+        if (*prev == entry) {
+            *prev = texture->hash_next;
+            break;
         }
+        prev = &voodoo->texture_cache[tmu][*prev].hash_next;
     }
+    texture->hash_next = -1;
+}
+
+static void
+texture_hash_insert(voodoo_t *voodoo, int tmu, int entry)
+{
+    texture_t *texture = &voodoo->texture_cache[tmu][entry];
+    int        h       = texture_hash(texture->base, texture->tLOD, texture->palette_checksum);
+
+    texture->hash_next           = voodoo->texture_hash[tmu][h];
+    voodoo->texture_hash[tmu][h] = entry;
+}
+
+/*Add or remove a cache entry from the page reverse index. texture_present is
+  kept as a quick per-page summary for the texture write paths*/
+static void
+texture_pages_update(voodoo_t *voodoo, int tmu, int entry, int add)
+{
+    const texture_t *texture   = &voodoo->texture_cache[tmu][entry];
+    int              page_mask = voodoo->texture_mask >> TEX_DIRTY_SHIFT;
+    uint64_t         bit       = (uint64_t) 1 << (entry & 63);
+
+    for (uint8_t d = 0; d < 4; d++) {
+        int page;
+        int last;
+
+        if (texture->addr_end[d] == 0)
+            continue;
 
-    /*Texture not found, search for unused texture*/
-    do {
-        for (c = 0; c < TEX_CACHE_MAX; c++) {
-            voodoo->texture_last_removed++;
-            voodoo->texture_last_removed &= (TEX_CACHE_MAX - 1);
-            if (voodoo->texture_cache[tmu][voodoo->texture_last_removed].refcount == voodoo->texture_cache[tmu][voodoo->texture_last_removed].refcount_r[0] && (voodoo->render_threads == 1 || voodoo->texture_cache[tmu][voodoo->texture_last_removed].refcount == voodoo->texture_cache[tmu][voodoo->texture_last_removed].refcount_r[1]))
+        page = (texture->addr_start[d] & voodoo->texture_mask) >> TEX_DIRTY_SHIFT;
+        last = (texture->addr_end[d] & voodoo->texture_mask) >> TEX_DIRTY_SHIFT;
+        while (1) {
+            uint64_t *entries = voodoo->texture_pages[tmu][page];
+
+            if (add)
+                entries[entry >> 6] |= bit;
+            else
+                entries[entry >> 6] &= ~bit;
+
+            voodoo->texture_present[tmu][page] = 0;
+            for (int c = 0; c < (TEX_CACHE_MAX / 64); c++) {
+                if (entries[c])
+                    voodoo->texture_present[tmu][page] = 1;
+            }
+
+            if (page == last)
                 break;
+            page = (page + 1) & page_mask;
         }
-        if (c == TEX_CACHE_MAX)
-            voodoo_wait_for_render_thread_idle(voodoo);
-    } while (c == TEX_CACHE_MAX);
-    if (c == TEX_CACHE_MAX)
-        fatal("Texture cache full!\n");
+    }
+}
 
-    c = voodoo->texture_last_removed;
+static void
+texture_evict(voodoo_t *voodoo, int tmu, int entry)
+{
+    texture_t *texture = &voodoo->texture_cache[tmu][entry];
 
-    if ((voodoo->params.tLOD[tmu] & LOD_SPLIT) && (voodoo->params.tLOD[tmu] & LOD_ODD) && (voodoo->params.tLOD[tmu] & LOD_TMULTIBASEADDR))
-        voodoo->texture_cache[tmu][c].base = params->texBaseAddr1[tmu];
-    else
-        voodoo->texture_cache[tmu][c].base = params->texBaseAddr[tmu];
-    voodoo->texture_cache[tmu][c].tLOD = params->tLOD[tmu] & 0xf00fff;
+    if (texture->base == -1)
+        return;
 
-    lod_min = (params->tLOD[tmu] >> 2) & 15;
-    lod_max = (params->tLOD[tmu] >> 8) & 15;
-#if 0
-    voodoo_texture_log("  add new texture to %i tformat=%i %08x LOD=%i-%i tmu=%i\n", c, voodoo->params.tformat[tmu], params->texBaseAddr[tmu], lod_min, lod_max, tmu);
-#endif
-    lod_min = MIN(lod_min, 8);
-    lod_max = MIN(lod_max, 8);
-    for (int lod = lod_min; lod <= lod_max; lod++) {
-        uint32_t     *base     = &voodoo->texture_cache[tmu][c].data[texture_offset[lod]];
-        uint32_t      tex_addr = params->tex_base[tmu][lod] & voodoo->texture_mask;
-        int           x;
-        int           y;
-        int           shift = 8 - params->tex_lod[tmu][lod];
-        const rgba_u *pal;
+    texture_hash_remove(voodoo, tmu, entry);
+    texture_pages_update(voodoo, tmu, entry, 0);
+    texture->base = -1;
+}
+
+void
+voodoo_texture_cache_init(voodoo_t *voodoo)
+{
+    for (uint8_t tmu = 0; tmu < 2; tmu++) {
+        for (int c = 0; c < TEX_HASH_SIZE; c++)
+            voodoo->texture_hash[tmu][c] = -1;
+
+        /*Entry data is allocated on first use*/
+        for (int c = 0; c < TEX_CACHE_MAX; c++) {
+            voodoo->texture_cache[tmu][c].data      = NULL;
+            voodoo->texture_cache[tmu][c].base      = -1; /*invalid*/
+            voodoo->texture_cache[tmu][c].refcount  = 0;
+            voodoo->texture_cache[tmu][c].hash_next = -1;
+        }
+    }
+}
+
+/*Converts one mipmap level to the 32-bit cache format*/
+static void
+texture_decode_lod(voodoo_t *voodoo, voodoo_params_t *params, int tmu, uint32_t *data, int lod)
+{
+    uint32_t     *base     = &data[texture_offset[lod]];
+    uint32_t      tex_addr = params->tex_base[tmu][lod] & voodoo->texture_mask;
+    int           x;
+    int           y;
+    int           w     = voodoo->params.tex_w_mask[tmu][lod] + 1;
+    int           shift = 8 - params->tex_lod[tmu][lod];
+    const rgba_u *pal;
 
 #if 0
-        voodoo_texture_log("  LOD %i : %08x - %08x %i %i,%i\n", lod, params->tex_base[tmu][lod] & voodoo->texture_mask, addr, voodoo->params.tformat[tmu], voodoo->params.tex_w_mask[tmu][lod],voodoo->params.tex_h_mask[tmu][lod]);
+    voodoo_texture_log("  LOD %i : %08x - %08x %i %i,%i\n", lod, params->tex_base[tmu][lod] & voodoo->texture_mask, addr, voodoo->params.tformat[tmu], voodoo->params.tex_w_mask[tmu][lod],voodoo->params.tex_h_mask[tmu][lod]);
 #endif
 
-        switch (params->tformat[tmu]) {
-            case TEX_RGB332:
-                for (y = 0; y < voodoo->params.tex_h_mask[tmu][lod] + 1; y++) {
-                    for (x = 0; x < voodoo->params.tex_w_mask[tmu][lod] + 1; x++) {
-                        uint8_t dat = voodoo->tex_mem[tmu][(tex_addr + x) & voodoo->texture_mask];
+    switch (params->tformat[tmu]) {
+        case TEX_RGB332:
+            for (y = 0; y < voodoo->params.tex_h_mask[tmu][lod] + 1; y++) {
+                for (x = 0; x < w; x++) {
+                    uint8_t dat = voodoo->tex_mem[tmu][(tex_addr + x) & voodoo->texture_mask];
 
-                        base[x] = makergba(rgb332[dat].r, rgb332[dat].g, rgb332[dat].b, 0xff);
-                    }
-                    tex_addr += (1 << voodoo->params.tex_shift[tmu][lod]);
-                    base += (1 << shift);
+                    base[x] = makergba(rgb332[dat].r, rgb332[dat].g, rgb332[dat].b, 0xff);
                 }
-                break;
+                tex_addr += (1 << voodoo->params.tex_shift[tmu][lod]);
+                base += (1 << shift);
+            }
+            break;
 
-            case TEX_Y4I2Q2:
-                pal = voodoo->ncc_lookup[tmu][(voodoo->params.textureMode[tmu] & TEXTUREMODE_NCC_SEL) ? 1 : 0];
-                for (y = 0; y < voodoo->params.tex_h_mask[tmu][lod] + 1; y++) {
-                    for (x = 0; x < voodoo->params.tex_w_mask[tmu][lod] + 1; x++) {
-                        uint8_t dat = voodoo->tex_mem[tmu][(tex_addr + x) & voodoo->texture_mask];
+        case TEX_Y4I2Q2:
+            pal = voodoo->ncc_lookup[tmu][(voodoo->params.textureMode[tmu] & TEXTUREMODE_NCC_SEL) ? 1 : 0];
+            for (y = 0; y < voodoo->params.tex_h_mask[tmu][lod] + 1; y++) {
+                for (x = 0; x < w; x++) {
+                    uint8_t dat = voodoo->tex_mem[tmu][(tex_addr + x) & voodoo->texture_mask];
 
-                        base[x] = makergba(pal[dat].rgba.r, pal[dat].rgba.g, pal[dat].rgba.b, 0xff);
-                    }
-                    tex_addr += (1 << voodoo->params.tex_shift[tmu][lod]);
-                    base += (1 << shift);
+                    base[x] = makergba(pal[dat].rgba.r, pal[dat].rgba.g, pal[dat].rgba.b, 0xff);
                 }
-                break;
+                tex_addr += (1 << voodoo->params.tex_shift[tmu][lod]);
+                base += (1 << shift);
+            }
+            break;
 
-            case TEX_A8:
-                for (y = 0; y < voodoo->params.tex_h_mask[tmu][lod] + 1; y++) {
-                    for (x = 0; x < voodoo->params.tex_w_mask[tmu][lod] + 1; x++) {
-                        uint8_t dat = voodoo->tex_mem[tmu][(tex_addr + x) & voodoo->texture_mask];
+        case TEX_A8:
+            for (y = 0; y < voodoo->params.tex_h_mask[tmu][lod] + 1; y++) {
+                x = 0;
+                TEX_ROW_SIMD(texture_row_a8, 1);
+                for (; x < w; x++) {
+                    uint8_t dat = voodoo->tex_mem[tmu][(tex_addr + x) & voodoo->texture_mask];
 
-                        base[x] = makergba(dat, dat, dat, dat);
-                    }
-                    tex_addr += (1 << voodoo->params.tex_shift[tmu][lod]);
-                    base += (1 << shift);
+                    base[x] = makergba(dat, dat, dat, dat);
                 }
-                break;
+                tex_addr += (1 << voodoo->params.tex_shift[tmu][lod]);
+                base += (1 << shift);
+            }
+            break;
 
-            case TEX_I8:
-                for (y = 0; y < voodoo->params.tex_h_mask[tmu][lod] + 1; y++) {
-                    for (x = 0; x < voodoo->params.tex_w_mask[tmu][lod] + 1; x++) {
-                        uint8_t dat = voodoo->tex_mem[tmu][(tex_addr + x) & voodoo->texture_mask];
+        case TEX_I8:
+            for (y = 0; y < voodoo->params.tex_h_mask[tmu][lod] + 1; y++) {
+                x = 0;
+                TEX_ROW_SIMD(texture_row_i8, 1);
+                for (; x < w; x++) {
+                    uint8_t dat = voodoo->tex_mem[tmu][(tex_addr + x) & voodoo->texture_mask];
 
-                        base[x] = makergba(dat, dat, dat, 0xff);
-                    }
-                    tex_addr += (1 << voodoo->params.tex_shift[tmu][lod]);
-                    base += (1 << shift);
+                    base[x] = makergba(dat, dat, dat, 0xff);
                 }
-                break;
+                tex_addr += (1 << voodoo->params.tex_shift[tmu][lod]);
+                base += (1 << shift);
+            }
+            break;
 
-            case TEX_AI8:
-                for (y = 0; y < voodoo->params.tex_h_mask[tmu][lod] + 1; y++) {
-                    for (x = 0; x < voodoo->params.tex_w_mask[tmu][lod] + 1; x++) {
-                        uint8_t dat = voodoo->tex_mem[tmu][(tex_addr + x) & voodoo->texture_mask];
+        case TEX_AI8:
+            for (y = 0; y < voodoo->params.tex_h_mask[tmu][lod] + 1; y++) {
+                x = 0;
+                TEX_ROW_SIMD(texture_row_ai44, 1);
+                for (; x < w; x++) {
+                    uint8_t dat = voodoo->tex_mem[tmu][(tex_addr + x) & voodoo->texture_mask];
 
-                        base[x] = makergba((dat & 0x0f) | ((dat << 4) & 0xf0), (dat & 0x0f) | ((dat << 4) & 0xf0), (dat & 0x0f) | ((dat << 4) & 0xf0), (dat & 0xf0) | ((dat >> 4) & 0x0f));
-                    }
-                    tex_addr += (1 << voodoo->params.tex_shift[tmu][lod]);
-                    base += (1 << shift);
+                    base[x] = makergba((dat & 0x0f) | ((dat << 4) & 0xf0), (dat & 0x0f) | ((dat << 4) & 0xf0), (dat & 0x0f) | ((dat << 4) & 0xf0), (dat & 0xf0) | ((dat >> 4) & 0x0f));
                 }
-                break;
+                tex_addr += (1 << voodoo->params.tex_shift[tmu][lod]);
+                base += (1 << shift);
+            }
+            break;
 
-            case TEX_PAL8:
-                pal = voodoo->palette[tmu];
-                for (y = 0; y < voodoo->params.tex_h_mask[tmu][lod] + 1; y++) {
-                    for (x = 0; x < voodoo->params.tex_w_mask[tmu][lod] + 1; x++) {
-                        uint8_t dat = voodoo->tex_mem[tmu][(tex_addr + x) & voodoo->texture_mask];
+        case TEX_PAL8:
+            pal = voodoo->palette[tmu];
+            for (y = 0; y < voodoo->params.tex_h_mask[tmu][lod] + 1; y++) {
+                for (x = 0; x < w; x++) {
+                    uint8_t dat = voodoo->tex_mem[tmu][(tex_addr + x) & voodoo->texture_mask];
 
-                        base[x] = makergba(pal[dat].rgba.r, pal[dat].rgba.g, pal[dat].rgba.b, 0xff);
-                    }
-                    tex_addr += (1 << voodoo->params.tex_shift[tmu][lod]);
-                    base += (1 << shift);
+                    base[x] = makergba(pal[dat].rgba.r, pal[dat].rgba.g, pal[dat].rgba.b, 0xff);
                 }
-                break;
+                tex_addr += (1 << voodoo->params.tex_shift[tmu][lod]);
+                base += (1 << shift);
+            }
+            break;
 
-            case TEX_APAL8:
-                pal = voodoo->palette[tmu];
-                for (y = 0; y < voodoo->params.tex_h_mask[tmu][lod] + 1; y++) {
-                    for (x = 0; x < voodoo->params.tex_w_mask[tmu][lod] + 1; x++) {
-                        uint8_t dat = voodoo->tex_mem[tmu][(tex_addr + x) & voodoo->texture_mask];
+        case TEX_APAL8:
+            pal = voodoo->palette[tmu];
+            for (y = 0; y < voodoo->params.tex_h_mask[tmu][lod] + 1; y++) {
+                for (x = 0; x < w; x++) {
+                    uint8_t dat = voodoo->tex_mem[tmu][(tex_addr + x) & voodoo->texture_mask];
 
-                        int r = ((pal[dat].rgba.r & 3) << 6) | ((pal[dat].rgba.g & 0xf0) >> 2) | (pal[dat].rgba.r & 3);
-                        int g = ((pal[dat].rgba.g & 0xf) << 4) | ((pal[dat].rgba.b & 0xc0) >> 4) | ((pal[dat].rgba.g & 0xf) >> 2);
-                        int b = ((pal[dat].rgba.b & 0x3f) << 2) | ((pal[dat].rgba.b & 0x30) >> 4);
-                        int a = (pal[dat].rgba.r & 0xfc) | ((pal[dat].rgba.r & 0xc0) >> 6);
+                    int r = ((pal[dat].rgba.r & 3) << 6) | ((pal[dat].rgba.g & 0xf0) >> 2) | (pal[dat].rgba.r & 3);
+                    int g = ((pal[dat].rgba.g & 0xf) << 4) | ((pal[dat].rgba.b & 0xc0) >> 4) | ((pal[dat].rgba.g & 0xf) >> 2);
+                    int b = ((pal[dat].rgba.b & 0x3f) << 2) | ((pal[dat].rgba.b & 0x30) >> 4);
+                    int a = (pal[dat].rgba.r & 0xfc) | ((pal[dat].rgba.r & 0xc0) >> 6);
 
-                        base[x] = makergba(r, g, b, a);
-                    }
-                    tex_addr += (1 << voodoo->params.tex_shift[tmu][lod]);
-                    base += (1 << shift);
+                    base[x] = makergba(r, g, b, a);
                 }
-                break;
+                tex_addr += (1 << voodoo->params.tex_shift[tmu][lod]);
+                base += (1 << shift);
+            }
+            break;
 
-            case TEX_ARGB8332:
-                for (y = 0; y < voodoo->params.tex_h_mask[tmu][lod] + 1; y++) {
-                    for (x = 0; x < voodoo->params.tex_w_mask[tmu][lod] + 1; x++) {
-                        uint16_t dat = *(uint16_t *) &voodoo->tex_mem[tmu][(tex_addr + x * 2) & voodoo->texture_mask];
+        case TEX_ARGB8332:
+            for (y = 0; y < voodoo->params.tex_h_mask[tmu][lod] + 1; y++) {
+                for (x = 0; x < w; x++) {
+                    uint16_t dat = *(uint16_t *) &voodoo->tex_mem[tmu][(tex_addr + x * 2) & voodoo->texture_mask];
 
-                        base[x] = makergba(rgb332[dat & 0xff].r, rgb332[dat & 0xff].g, rgb332[dat & 0xff].b, dat >> 8);
-                    }
-                    tex_addr += (1 << (voodoo->params.tex_shift[tmu][lod] + 1));
-                    base += (1 << shift);
+                    base[x] = makergba(rgb332[dat & 0xff].r, rgb332[dat & 0xff].g, rgb332[dat & 0xff].b, dat >> 8);
                 }
-                break;
+                tex_addr += (1 << (voodoo->params.tex_shift[tmu][lod] + 1));
+                base += (1 << shift);
+            }
+            break;
 
-            case TEX_A8Y4I2Q2:
-                pal = voodoo->ncc_lookup[tmu][(voodoo->params.textureMode[tmu] & TEXTUREMODE_NCC_SEL) ? 1 : 0];
-                for (y = 0; y < voodoo->params.tex_h_mask[tmu][lod] + 1; y++) {
-                    for (x = 0; x < voodoo->params.tex_w_mask[tmu][lod] + 1; x++) {
-                        uint16_t dat = *(uint16_t *) &voodoo->tex_mem[tmu][(tex_addr + x * 2) & voodoo->texture_mask];
+        case TEX_A8Y4I2Q2:
+            pal = voodoo->ncc_lookup[tmu][(voodoo->params.textureMode[tmu] & TEXTUREMODE_NCC_SEL) ? 1 : 0];
+            for (y = 0; y < voodoo->params.tex_h_mask[tmu][lod] + 1; y++) {
+                for (x = 0; x < w; x++) {
+                    uint16_t dat = *(uint16_t *) &voodoo->tex_mem[tmu][(tex_addr + x * 2) & voodoo->texture_mask];
 
-                        base[x] = makergba(pal[dat & 0xff].rgba.r, pal[dat & 0xff].rgba.g, pal[dat & 0xff].rgba.b, dat >> 8);
-                    }
-                    tex_addr += (1 << (voodoo->params.tex_shift[tmu][lod] + 1));
-                    base += (1 << shift);
+                    base[x] = makergba(pal[dat & 0xff].rgba.r, pal[dat & 0xff].rgba.g, pal[dat & 0xff].rgba.b, dat >> 8);
                 }
-                break;
+                tex_addr += (1 << (voodoo->params.tex_shift[tmu][lod] + 1));
+                base += (1 << shift);
+            }
+            break;
 
-            case TEX_R5G6B5:
-                for (y = 0; y < voodoo->params.tex_h_mask[tmu][lod] + 1; y++) {
-                    for (x = 0; x < voodoo->params.tex_w_mask[tmu][lod] + 1; x++) {
-                        uint16_t dat = *(uint16_t *) &voodoo->tex_mem[tmu][(tex_addr + x * 2) & voodoo->texture_mask];
+        case TEX_R5G6B5:
+            for (y = 0; y < voodoo->params.tex_h_mask[tmu][lod] + 1; y++) {
+                x = 0;
+                TEX_ROW_SIMD(texture_row_r5g6b5, 2);
+                for (; x < w; x++) {
+                    uint16_t dat = *(uint16_t *) &voodoo->tex_mem[tmu][(tex_addr + x * 2) & voodoo->texture_mask];
 
-                        base[x] = makergba(rgb565[dat].r, rgb565[dat].g, rgb565[dat].b, 0xff);
-                    }
-                    tex_addr += (1 << (voodoo->params.tex_shift[tmu][lod] + 1));
-                    base += (1 << shift);
+                    base[x] = makergba(rgb565[dat].r, rgb565[dat].g, rgb565[dat].b, 0xff);
                 }
-                break;
+                tex_addr += (1 << (voodoo->params.tex_shift[tmu][lod] + 1));
+                base += (1 << shift);
+            }
+            break;
 
-            case TEX_ARGB1555:
-                for (y = 0; y < voodoo->params.tex_h_mask[tmu][lod] + 1; y++) {
-                    for (x = 0; x < voodoo->params.tex_w_mask[tmu][lod] + 1; x++) {
-                        uint16_t dat = *(uint16_t *) &voodoo->tex_mem[tmu][(tex_addr + x * 2) & voodoo->texture_mask];
+        case TEX_ARGB1555:
+            for (y = 0; y < voodoo->params.tex_h_mask[tmu][lod] + 1; y++) {
+                x = 0;
+                TEX_ROW_SIMD(texture_row_argb1555, 2);
+                for (; x < w; x++) {
+                    uint16_t dat = *(uint16_t *) &voodoo->tex_mem[tmu][(tex_addr + x * 2) & voodoo->texture_mask];
 
-                        base[x] = makergba(argb1555[dat].r, argb1555[dat].g, argb1555[dat].b, argb1555[dat].a);
-                    }
-                    tex_addr += (1 << (voodoo->params.tex_shift[tmu][lod] + 1));
-                    base += (1 << shift);
+                    base[x] = makergba(argb1555[dat].r, argb1555[dat].g, argb1555[dat].b, argb1555[dat].a);
                 }
-                break;
+                tex_addr += (1 << (voodoo->params.tex_shift[tmu][lod] + 1));
+                base += (1 << shift);
+            }
+            break;
 
-            case TEX_ARGB4444:
-                for (y = 0; y < voodoo->params.tex_h_mask[tmu][lod] + 1; y++) {
-                    for (x = 0; x < voodoo->params.tex_w_mask[tmu][lod] + 1; x++) {
-                        uint16_t dat = *(uint16_t *) &voodoo->tex_mem[tmu][(tex_addr + x * 2) & voodoo->texture_mask];
+        case TEX_ARGB4444:
+            for (y = 0; y < voodoo->params.tex_h_mask[tmu][lod] + 1; y++) {
+                x = 0;
+                TEX_ROW_SIMD(texture_row_argb4444, 2);
+                for (; x < w; x++) {
+                    uint16_t dat = *(uint16_t *) &voodoo->tex_mem[tmu][(tex_addr + x * 2) & voodoo->texture_mask];
 
-                        base[x] = makergba(argb4444[dat].r, argb4444[dat].g, argb4444[dat].b, argb4444[dat].a);
-                    }
-                    tex_addr += (1 << (voodoo->params.tex_shift[tmu][lod] + 1));
-                    base += (1 << shift);
+                    base[x] = makergba(argb4444[dat].r, argb4444[dat].g, argb4444[dat].b, argb4444[dat].a);
                 }
-                break;
+                tex_addr += (1 << (voodoo->params.tex_shift[tmu][lod] + 1));
+                base += (1 << shift);
+            }
+            break;
 
-            case TEX_A8I8:
-                for (y = 0; y < voodoo->params.tex_h_mask[tmu][lod] + 1; y++) {
-                    for (x = 0; x < voodoo->params.tex_w_mask[tmu][lod] + 1; x++) {
-                        uint16_t dat = *(uint16_t *) &voodoo->tex_mem[tmu][(tex_addr + x * 2) & voodoo->texture_mask];
+        case TEX_A8I8:
+            for (y = 0; y < voodoo->params.tex_h_mask[tmu][lod] + 1; y++) {
+                x = 0;
+                TEX_ROW_SIMD(texture_row_a8i8, 2);
+                for (; x < w; x++) {
+                    uint16_t dat = *(uint16_t *) &voodoo->tex_mem[tmu][(tex_addr + x * 2) & voodoo->texture_mask];
 
-                        base[x] = makergba(dat & 0xff, dat & 0xff, dat & 0xff, dat >> 8);
-                    }
-                    tex_addr += (1 << (voodoo->params.tex_shift[tmu][lod] + 1));
-                    base += (1 << shift);
+                    base[x] = makergba(dat & 0xff, dat & 0xff, dat & 0xff, dat >> 8);
                 }
-                break;
+                tex_addr += (1 << (voodoo->params.tex_shift[tmu][lod] + 1));
+                base += (1 << shift);
+            }
+            break;
 
-            case TEX_APAL88:
-                pal = voodoo->palette[tmu];
-                for (y = 0; y < voodoo->params.tex_h_mask[tmu][lod] + 1; y++) {
-                    for (x = 0; x < voodoo->params.tex_w_mask[tmu][lod] + 1; x++) {
-                        uint16_t dat = *(uint16_t *) &voodoo->tex_mem[tmu][(tex_addr + x * 2) & voodoo->texture_mask];
+        case TEX_APAL88:
+            pal = voodoo->palette[tmu];
+            for (y = 0; y < voodoo->params.tex_h_mask[tmu][lod] + 1; y++) {
+                for (x = 0; x < w; x++) {
+                    uint16_t dat = *(uint16_t *) &voodoo->tex_mem[tmu][(tex_addr + x * 2) & voodoo->texture_mask];
 
-                        base[x] = makergba(pal[dat & 0xff].rgba.r, pal[dat & 0xff].rgba.g, pal[dat & 0xff].rgba.b, dat >> 8);
-                    }
-                    tex_addr += (1 << (voodoo->params.tex_shift[tmu][lod] + 1));
-                    base += (1 << shift);
+                    base[x] = makergba(pal[dat & 0xff].rgba.r, pal[dat & 0xff].rgba.g, pal[dat & 0xff].rgba.b, dat >> 8);
                 }
-                break;
+                tex_addr += (1 << (voodoo->params.tex_shift[tmu][lod] + 1));
+                base += (1 << shift);
+            }
+            break;
+
+        default:
+            fatal("Unknown texture format %i\n", params->tformat[tmu]);
+    }
+}
+
+/*Bitmask of the mipmap levels a triangle can sample. voodoo_tmu_fetch() picks
+  the level from the LOD voodoo_triangle() works out for the whole triangle,
+  plus log2(1/W) at each pixel when perspective correction is on. W is linear
+  across the triangle, so its extremes are at the vertices; one level either
+  side covers pixel centres and fastlog() rounding*/
+static int
+texture_lod_mask(const voodoo_params_t *params, int tmu)
+{
+    int      lod_min = (params->tLOD[tmu] & 0x3f) << 6;
+    int      lod_max = MIN(((params->tLOD[tmu] >> 6) & 0x3f) << 6, 0x800);
+    uint64_t tempdx;
+    uint64_t tempdy;
+    uint64_t tempLOD;
+    int      lodbias;
+    int      lo;
+    int      hi;
+
+    tempdx = (params->tmu[tmu].dSdX >> 14) * (params->tmu[tmu].dSdX >> 14) + (params->tmu[tmu].dTdX >> 14) * (params->tmu[tmu].dTdX >> 14);
+    tempdy = (params->tmu[tmu].dSdY >> 14) * (params->tmu[tmu].dSdY >> 14) + (params->tmu[tmu].dTdY >> 14) * (params->tmu[tmu].dTdY >> 14);
+    tempLOD = (tempdx > tempdy) ? tempdx : tempdy;
+    if (!tempLOD)
+        return -1;
+
+    lodbias = (params->tLOD[tmu] >> 12) & 0x3f;
+    if (lodbias & 0x20)
+        lodbias |= ~0x3f;
+    lo = hi = ((int) (log2((double) tempLOD / (double) (1ULL << 36)) * 256) >> 2) + (lodbias << 6);
+
+    if (params->textureMode[tmu] & 1) {
+        double dx[3] = { 0.0, ((int16_t) params->vertexBx - (int16_t) params->vertexAx) / 16.0, ((int16_t) params->vertexCx - (int16_t) params->vertexAx) / 16.0 };
+        double dy[3] = { 0.0, ((int16_t) params->vertexBy - (int16_t) params->vertexAy) / 16.0, ((int16_t) params->vertexCy - (int16_t) params->vertexAy) / 16.0 };
+        double w_min = 0.0;
+        double w_max = 0.0;
+
+        for (uint8_t c = 0; c < 3; c++) {
+            double w = params->tmu[tmu].startW + params->tmu[tmu].dWdX * dx[c] + params->tmu[tmu].dWdY * dy[c];
+
+            if (!c || w < w_min)
+                w_min = w;
+            if (!c || w > w_max)
+                w_max = w;
+        }
+        if (w_min <= 0.0)
+            return -1;
+
+        lo += (int) (log2(281474976710656.0 / w_max) * 256) - (19 << 8) - 256;
+        hi += (int) (log2(281474976710656.0 / w_min) * 256) - (19 << 8) + 256;
+    }
+
+    lo = (lo < lod_min) ? lod_min : ((lo > lod_max) ? lod_max : lo);
+    hi = (hi < lod_min) ? lod_min : ((hi > lod_max) ? lod_max : hi);
+    lo >>= 8;
+    hi >>= 8;
+    if (lo > hi) {
+        int temp = lo;
+
+        lo = hi;
+        hi = temp;
+    }
+
+    return ((2 << hi) - 1) & ~((1 << lo) - 1);
+}
+
+/*Decodes the levels in lods that the entry does not hold yet*/
+static void
+texture_decode(voodoo_t *voodoo, voodoo_params_t *params, int tmu, int entry, int lods)
+{
+    texture_t *texture = &voodoo->texture_cache[tmu][entry];
+
+    lods &= ~texture->lod_valid;
+    if (!lods)
+        return;
+
+    for (uint8_t lod = 0; lod <= LOD_MAX; lod++) {
+        if (lods & (1 << lod))
+            texture_decode_lod(voodoo, params, tmu, texture->data, lod);
+    }
+    texture->lod_valid |= lods;
+}
+
+void
+voodoo_use_texture(voodoo_t *voodoo, voodoo_params_t *params, int tmu)
+{
+    int      c;
+    int      lod_min;
+    int      lod_max;
+    int      lods;
+    uint32_t addr = 0;
+    uint32_t palette_checksum;
+    uint32_t tLOD = params->tLOD[tmu] & 0xf00fff;
+
+    lod_min = (params->tLOD[tmu] >> 2) & 15;
+    lod_max = (params->tLOD[tmu] >> 8) & 15;
+
+    if (params->tformat[tmu] == TEX_PAL8 || params->tformat[tmu] == TEX_APAL8 || params->tformat[tmu] == TEX_APAL88) {
+        if (voodoo->palette_dirty[tmu]) {
+            palette_checksum = 0;
+
+            for (c = 0; c < 256; c++)
+                palette_checksum ^= voodoo->palette[tmu][c].u;
+
+            voodoo->palette_checksum[tmu] = palette_checksum;
+            voodoo->palette_dirty[tmu]    = 0;
+        } else
+            palette_checksum = voodoo->palette_checksum[tmu];
+    } else
+        palette_checksum = 0;
+
+    if ((voodoo->params.tLOD[tmu] & LOD_SPLIT) && (voodoo->params.tLOD[tmu] & LOD_ODD) && (voodoo->params.tLOD[tmu] & LOD_TMULTIBASEADDR))
+        addr = params->texBaseAddr1[tmu];
+    else
+        addr = params->texBaseAddr[tmu];
+
+    /*Try to find texture in cache*/
+    for (c = voodoo->texture_hash[tmu][texture_hash(addr, tLOD, palette_checksum)]; c != -1; c = voodoo->texture_cache[tmu][c].hash_next) {
+        if (voodoo->texture_cache[tmu][c].base == addr && voodoo->texture_cache[tmu][c].tLOD == tLOD && voodoo->texture_cache[tmu][c].palette_checksum == palette_checksum) {
+            lods = ((2 << MIN(lod_max, 8)) - 1) & ~((1 << MIN(lod_min, 8)) - 1);
+            texture_decode(voodoo, params, tmu, c, lods & texture_lod_mask(params, tmu));
+
+            params->tex_entry[tmu] = c;
+            voodoo->texture_cache[tmu][c].refcount++;
+            voodoo->texture_cache[tmu][c].lru = ++voodoo->texture_lru;
+            voodoo->tex_cache_hits[tmu]++;
+            return;
+        }
+    }
+
+    voodoo->tex_cache_misses[tmu]++;
+    if (!(voodoo->tex_cache_misses[tmu] & 0xfff))
+        voodoo_texture_log("Texture cache TMU%i: %i hits, %i misses\n", tmu, voodoo->tex_cache_hits[tmu], voodoo->tex_cache_misses[tmu]);
+
+    /*Texture not found, replace the least recently used entry that the render threads are done with*/
+    while (1) {
+        uint32_t oldest = 0;
+
+        c = -1;
+        for (int d = 0; d < TEX_CACHE_MAX; d++) {
+            const texture_t *texture = &voodoo->texture_cache[tmu][d];
+            uint32_t         age     = voodoo->texture_lru - texture->lru;
 
-            default:
-                fatal("Unknown texture format %i\n", params->tformat[tmu]);
+            if (!voodoo_texture_idle(voodoo, &voodoo->texture_cache[tmu][d]))
+                continue;
+            if (texture->base == -1) {
+                c = d;
+                break;
+            }
+            if ((c == -1) || (age > oldest)) {
+                c      = d;
+                oldest = age;
+            }
         }
+        if (c != -1)
+            break;
+        voodoo_wait_for_render_thread_idle(voodoo);
     }
 
+    texture_evict(voodoo, tmu, c);
+    if (voodoo->texture_cache[tmu][c].data == NULL)
+        voodoo->texture_cache[tmu][c].data = malloc(TEX_CACHE_ENTRY_SIZE);
+
+    if ((voodoo->params.tLOD[tmu] & LOD_SPLIT) && (voodoo->params.tLOD[tmu] & LOD_ODD) && (voodoo->params.tLOD[tmu] & LOD_TMULTIBASEADDR))
+        voodoo->texture_cache[tmu][c].base = params->texBaseAddr1[tmu];
+    else
+        voodoo->texture_cache[tmu][c].base = params->texBaseAddr[tmu];
+    voodoo->texture_cache[tmu][c].tLOD = tLOD;
+
+    lod_min = (params->tLOD[tmu] >> 2) & 15;
+    lod_max = (params->tLOD[tmu] >> 8) & 15;
+#if 0
+    voodoo_texture_log("  add new texture to %i tformat=%i %08x LOD=%i-%i tmu=%i\n", c, voodoo->params.tformat[tmu], params->texBaseAddr[tmu], lod_min, lod_max, tmu);
+#endif
+    lod_min = MIN(lod_min, 8);
+    lod_max = MIN(lod_max, 8);
+    /*NCC tables are not part of the cache key, so decode every level before
+      they can change. Other formats only decode what this triangle needs,
+      later triangles fill in the rest*/
+    voodoo->texture_cache[tmu][c].lod_valid = 0;
+    lods = ((2 << lod_max) - 1) & ~((1 << lod_min) - 1);
+    if (params->tformat[tmu] != TEX_Y4I2Q2 && params->tformat[tmu] != TEX_A8Y4I2Q2)
+        lods &= texture_lod_mask(params, tmu);
+    texture_decode(voodoo, params, tmu, c, lods);
+
     voodoo->texture_cache[tmu][c].is16 = voodoo->params.tformat[tmu] & 8;
 
     if (params->tformat[tmu] == TEX_PAL8 || params->tformat[tmu] == TEX_APAL8 || params->tformat[tmu] == TEX_APAL88)
@@ -536,56 +960,41 @@ voodoo_use_texture(voodoo_t *voodoo, voodoo_params_t *params, int tmu)
     } else
         voodoo->texture_cache[tmu][c].addr_start[3] = voodoo->texture_cache[tmu][c].addr_end[3] = 0;
 
-    for (uint8_t d = 0; d < 4; d++) {
-        addr     = voodoo->texture_cache[tmu][c].addr_start[d];
-        addr_end = voodoo->texture_cache[tmu][c].addr_end[d];
-
-        if (addr_end != 0) {
-            for (; addr <= addr_end; addr += (1 << TEX_DIRTY_SHIFT))
-                voodoo->texture_present[tmu][(addr & voodoo->texture_mask) >> TEX_DIRTY_SHIFT] = 1;
-        }
-    }
+    texture_hash_insert(voodoo, tmu, c);
+    texture_pages_update(voodoo, tmu, c, 1);
 
     params->tex_entry[tmu] = c;
     voodoo->texture_cache[tmu][c].refcount++;
+    voodoo->texture_cache[tmu][c].lru = ++voodoo->texture_lru;
 }
 
 void
 flush_texture_cache(voodoo_t *voodoo, uint32_t dirty_addr, int tmu)
 {
-    int wait_for_idle = 0;
+    const uint64_t *entries       = voodoo->texture_pages[tmu][(dirty_addr & voodoo->texture_mask) >> TEX_DIRTY_SHIFT];
+    int             wait_for_idle = 0;
 
-    memset(voodoo->texture_present[tmu], 0, sizeof(voodoo->texture_present[0]));
 #if 0
-    voodoo_texture_log("Evict %08x %i\n", dirty_addr, sizeof(voodoo->texture_present));
+    voodoo_texture_log("Evict %08x\n", dirty_addr);
 #endif
-    for (uint8_t c = 0; c < TEX_CACHE_MAX; c++) {
-        if (voodoo->texture_cache[tmu][c].base != -1) {
-            for (uint8_t d = 0; d < 4; d++) {
-                int addr_start = voodoo->texture_cache[tmu][c].addr_start[d];
-                int addr_end   = voodoo->texture_cache[tmu][c].addr_end[d];
-
-                if (addr_end != 0) {
-                    int addr_start_masked = addr_start & voodoo->texture_mask & ~0x3ff;
-                    int addr_end_masked   = ((addr_end & voodoo->texture_mask) + 0x3ff) & ~0x3ff;
-
-                    if (addr_end_masked < addr_start_masked)
-                        addr_end_masked = voodoo->texture_mask + 1;
-                    if (dirty_addr >= addr_start_masked && dirty_addr < addr_end_masked) {
+    for (int c = 0; c < (TEX_CACHE_MAX / 64); c++) {
+        /*Evicting updates the page entry, so work from a copy*/
+        uint64_t mask = entries[c];
+
+        while (mask) {
+            int entry = (c << 6);
+
+            for (uint64_t m = mask; !(m & 1); m >>= 1)
+                entry++;
+            mask &= mask - 1;
+
 #if 0
-                        voodoo_texture_log("  Evict texture %i %08x\n", c, voodoo->texture_cache[tmu][c].base);
+            voodoo_texture_log("  Evict texture %i %08x\n", entry, voodoo->texture_cache[tmu][entry].base);
 #endif
+            if (!voodoo_texture_idle(voodoo, &voodoo->texture_cache[tmu][entry]))
+                wait_for_idle = 1;
 
-                        if (voodoo->texture_cache[tmu][c].refcount != voodoo->texture_cache[tmu][c].refcount_r[0] || (voodoo->render_threads == 2 && voodoo->texture_cache[tmu][c].refcount != voodoo->texture_cache[tmu][c].refcount_r[1]))
-                            wait_for_idle = 1;
-
-                        voodoo->texture_cache[tmu][c].base = -1;
-                    } else {
-                        for (; addr_start <= addr_end; addr_start += (1 << TEX_DIRTY_SHIFT))
-                            voodoo->texture_present[tmu][(addr_start & voodoo->texture_mask) >> TEX_DIRTY_SHIFT] = 1;
-                    }
-                }
-            }
+            texture_evict(voodoo, tmu, entry);
         }
     }
     if (wait_for_idle)
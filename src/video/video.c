@@ -73,12 +73,22 @@
 #include <86box/thread.h>
 #include <86box/video.h>
 #include <86box/vid_svga.h>
+#include <86box/perf.h>
 
 #include <minitrace/minitrace.h>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#    define VIDEO_TRANSFORM_SSE2
+#    include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#    define VIDEO_TRANSFORM_NEON
+#    include <arm_neon.h>
+#endif
+
 volatile int screenshots = 0;
 uint8_t      edatlookup[4][4];
 uint8_t      egaremap2bpp[256];
+uint32_t     planar_spread[256];
 uint8_t      fontdat[2048][8];            /* IBM CGA font */
 uint8_t      fontdatm[2048][16];          /* IBM MDA font */
 uint8_t      fontdat2[2048][8];           /* IBM CGA 2nd instance font */
@@ -87,6 +97,7 @@ uint8_t      fontdatw[512][32];           /* Wyse700 font */
 uint8_t      fontdat8x12[256][16];        /* MDSI Genius font */
 uint8_t      fontdat12x18[256][36];       /* IM1024 font */
 dbcs_font_t *fontdatksc5601       = NULL; /* Korean KSC-5601 font */
+static int   fontdatksc5601_mapped = 0;    /* It is a view of the font file. */
 dbcs_font_t *fontdatksc5601_user  = NULL; /* Korean KSC-5601 user defined font */
 int          herc_blend           = 0;
 int          frames               = 0;
@@ -234,8 +245,26 @@ const uint32_t shade[5][256] = {
     }
 };
 
+/* Unchanged frames are not passed on to the blit function, but one is still let
+   through every IDLE_BLIT_INTERVAL frames, so that a newly created renderer or
+   a window that lost its contents gets a picture again. */
+#define IDLE_BLIT_INTERVAL 50
+
+/* With frame pacing, a frame is presented at the host time that is as far
+   from the guest time it was finished at as for the latest frame so far,
+   so frames that came out of the emulation in a burst are spread out like
+   the guest's retraces were. That distance falls by PACE_CREEP_US every
+   frame, so one late frame does not delay all of the following ones, and
+   it starts over when a frame is off by more than PACE_RESYNC_US. */
+#define PACE_CREEP_US  100
+#define PACE_RESYNC_US 50000
+
 typedef struct blit_data_struct {
     int x, y, w, h;
+    int damage_y1, damage_y2;
+    int pending_y1, pending_y2;
+    int pending_valid;
+    int idle_frames;
     int busy;
     int buffer_in_use;
     int thread_run;
@@ -245,6 +274,21 @@ typedef struct blit_data_struct {
     event_t  *wake_blit_thread;
     event_t  *blit_complete;
     event_t  *buffer_not_in_use;
+
+    /* Hardware cursor layer for the presenter, guarded by cursor_mutex. */
+    cursor_layer_t *cursor;
+    mutex_t        *cursor_mutex;
+    atomic_int      cursor_presenter;
+    atomic_uint     cursor_generation;
+    uint32_t        cursor_blit_generation;
+
+    /* Frame pacing, see video_blit_pace_monitor(). */
+    uint64_t frame_guest_us; /* Guest time the frame was finished at. */
+    uint64_t frame_host_us;  /* Host time it was handed to the blit thread at. */
+    int64_t  pace_offset;    /* Host minus guest time frames are presented at. */
+    int      pace_synced;
+    int      frame_dropped;
+    event_t *pace_cancel;    /* A newer frame is waiting for the blit thread. */
 } blit_data_t;
 
 static uint32_t cga_2_table[16];
@@ -284,6 +328,88 @@ video_blit_complete_monitor(int monitor_index)
     thread_set_event(blit_data_ptr->buffer_not_in_use);
 }
 
+/*
+ * Report that only lines y1 to y2 - 1 of the target buffer changed since
+ * the previous blit, y1 >= y2 meaning that nothing did. Must be called
+ * before the video_blit_memtoscreen_monitor() it applies to; without a
+ * call, the whole blitted area counts as changed. Reports for blits that
+ * are not carried out are merged into the next one.
+ */
+void
+video_blit_damage_monitor(int y1, int y2, int monitor_index)
+{
+    blit_data_t *blit_data_ptr = monitors[monitor_index].mon_blit_data_ptr;
+
+    if (!blit_data_ptr->pending_valid) {
+        blit_data_ptr->pending_y1    = y1;
+        blit_data_ptr->pending_y2    = y2;
+        blit_data_ptr->pending_valid = 1;
+    } else if (y1 < y2) {
+        if (blit_data_ptr->pending_y1 >= blit_data_ptr->pending_y2) {
+            blit_data_ptr->pending_y1 = y1;
+            blit_data_ptr->pending_y2 = y2;
+        } else {
+            blit_data_ptr->pending_y1 = MIN(blit_data_ptr->pending_y1, y1);
+            blit_data_ptr->pending_y2 = MAX(blit_data_ptr->pending_y2, y2);
+        }
+    }
+}
+
+/* For use by the blit function, returns the changed lines of the current blit. */
+void
+video_blit_get_damage_monitor(int monitor_index, int *y1, int *y2)
+{
+    const blit_data_t *blit_data_ptr = monitors[monitor_index].mon_blit_data_ptr;
+
+    *y1 = blit_data_ptr->damage_y1;
+    *y2 = blit_data_ptr->damage_y2;
+}
+
+/* Emulated time, for the pacing of the frames. */
+static uint64_t
+video_guest_us(void)
+{
+    if (TIMER_USEC == 0)
+        return 0;
+
+    return (uint64_t) (((double) tsc * 4294967296.0) / (double) TIMER_USEC);
+}
+
+/*
+ * For use by the blit function, once it is done with the target buffer and
+ * before it hands the frame over to be presented. Waits until the frame is
+ * due with frame pacing enabled. Returns 0 if a newer frame came in while
+ * waiting, in which case this one is not to be presented.
+ */
+int
+video_blit_pace_monitor(int monitor_index)
+{
+    blit_data_t *blit_data_ptr = monitors[monitor_index].mon_blit_data_ptr;
+    int64_t      offset;
+    int64_t      wait;
+
+    if (!video_frame_pacing || turbo_mode || !blit_data_ptr->frame_host_us)
+        return 1;
+
+    offset = (int64_t) (blit_data_ptr->frame_host_us - blit_data_ptr->frame_guest_us);
+    if (!blit_data_ptr->pace_synced || (offset > (blit_data_ptr->pace_offset + PACE_RESYNC_US)) ||
+        (offset < (blit_data_ptr->pace_offset - PACE_RESYNC_US))) {
+        blit_data_ptr->pace_offset = offset;
+        blit_data_ptr->pace_synced = 1;
+        return 1;
+    }
+
+    blit_data_ptr->pace_offset = MAX(blit_data_ptr->pace_offset - PACE_CREEP_US, offset);
+
+    wait = (int64_t) (blit_data_ptr->frame_guest_us + blit_data_ptr->pace_offset - plat_get_ticks_us());
+    if ((wait >= 1000) && !thread_wait_event(blit_data_ptr->pace_cancel, (int) (wait / 1000))) {
+        blit_data_ptr->frame_dropped = 1;
+        return 0;
+    }
+
+    return 1;
+}
+
 void
 video_wait_for_blit_monitor(int monitor_index)
 {
@@ -294,6 +420,103 @@ video_wait_for_blit_monitor(int monitor_index)
     thread_reset_event(blit_data_ptr->blit_complete);
 }
 
+/* Whether hardware cursors go to the presenter as a separate layer, which
+   needs both the option and a renderer that composites the layer. */
+int
+video_cursor_layer_active(int monitor_index)
+{
+    blit_data_t *blit_data_ptr = monitors[monitor_index].mon_blit_data_ptr;
+
+    return video_cursor_layer && (blit_data_ptr != NULL) && atomic_load(&blit_data_ptr->cursor_presenter);
+}
+
+void
+video_cursor_layer_presenter(int monitor_index, int supported)
+{
+    blit_data_t *blit_data_ptr = monitors[monitor_index].mon_blit_data_ptr;
+
+    if (blit_data_ptr != NULL)
+        atomic_store(&blit_data_ptr->cursor_presenter, supported);
+}
+
+/* Publish the cursor layer of a frame. The generation only moves when the
+   image or its position changed, so an unchanged cursor costs the presenter
+   nothing. */
+void
+video_cursor_layer_update(int monitor_index, const cursor_layer_t *layer)
+{
+    blit_data_t    *blit_data_ptr = monitors[monitor_index].mon_blit_data_ptr;
+    cursor_layer_t *cur;
+    int             changed;
+
+    if (blit_data_ptr == NULL)
+        return;
+
+    thread_wait_mutex(blit_data_ptr->cursor_mutex);
+
+    cur = blit_data_ptr->cursor;
+    if (cur == NULL) {
+        if (!layer->w) {
+            thread_release_mutex(blit_data_ptr->cursor_mutex);
+            return;
+        }
+        cur = blit_data_ptr->cursor = calloc(1, sizeof(cursor_layer_t));
+    }
+
+    changed = (cur->x != layer->x) || (cur->y != layer->y) || (cur->w != layer->w) || (cur->h != layer->h);
+    for (int y = 0; !changed && (y < layer->h); y++)
+        changed = memcmp(&cur->and_mask[y * CURSOR_LAYER_MAX], &layer->and_mask[y * CURSOR_LAYER_MAX], layer->w * 4) ||
+                  memcmp(&cur->xor_mask[y * CURSOR_LAYER_MAX], &layer->xor_mask[y * CURSOR_LAYER_MAX], layer->w * 4);
+
+    if (changed) {
+        cur->x = layer->x;
+        cur->y = layer->y;
+        cur->w = layer->w;
+        cur->h = layer->h;
+        for (int y = 0; y < layer->h; y++) {
+            memcpy(&cur->and_mask[y * CURSOR_LAYER_MAX], &layer->and_mask[y * CURSOR_LAYER_MAX], layer->w * 4);
+            memcpy(&cur->xor_mask[y * CURSOR_LAYER_MAX], &layer->xor_mask[y * CURSOR_LAYER_MAX], layer->w * 4);
+        }
+        cur->generation = atomic_fetch_add(&blit_data_ptr->cursor_generation, 1) + 1;
+    }
+
+    thread_release_mutex(blit_data_ptr->cursor_mutex);
+}
+
+/* Copy the cursor layer if its generation differs from the one given,
+   returns whether it did. */
+int
+video_cursor_layer_get(int monitor_index, cursor_layer_t *layer, uint32_t generation)
+{
+    blit_data_t          *blit_data_ptr = monitors[monitor_index].mon_blit_data_ptr;
+    const cursor_layer_t *cur;
+
+    if (blit_data_ptr == NULL)
+        return 0;
+
+    thread_wait_mutex(blit_data_ptr->cursor_mutex);
+
+    cur = blit_data_ptr->cursor;
+    if ((cur == NULL) || (cur->generation == generation)) {
+        thread_release_mutex(blit_data_ptr->cursor_mutex);
+        return 0;
+    }
+
+    layer->x          = cur->x;
+    layer->y          = cur->y;
+    layer->w          = cur->w;
+    layer->h          = cur->h;
+    layer->generation = cur->generation;
+    for (int y = 0; y < cur->h; y++) {
+        memcpy(&layer->and_mask[y * CURSOR_LAYER_MAX], &cur->and_mask[y * CURSOR_LAYER_MAX], cur->w * 4);
+        memcpy(&layer->xor_mask[y * CURSOR_LAYER_MAX], &cur->xor_mask[y * CURSOR_LAYER_MAX], cur->w * 4);
+    }
+
+    thread_release_mutex(blit_data_ptr->cursor_mutex);
+
+    return 1;
+}
+
 void
 video_wait_for_buffer_monitor(int monitor_index)
 {
@@ -304,94 +527,197 @@ video_wait_for_buffer_monitor(int monitor_index)
     thread_reset_event(blit_data_ptr->buffer_not_in_use);
 }
 
-static png_structp png_ptr[MONITORS_NUM];
-static png_infop   info_ptr[MONITORS_NUM];
+/* Screenshots and frame dumps are copied once into one of a small pool of
+   buffers, and the PNG compression runs on a worker thread. The pool bounds
+   the memory used when the encoder falls behind. */
+#define SCREENSHOT_POOL_SIZE 4
+
+typedef struct screenshot_job_t {
+    uint8_t *rgb;
+    size_t   size;
+    int      w;
+    int      h;
+    char     path[1024];
+} screenshot_job_t;
+
+static screenshot_job_t screenshot_pool[SCREENSHOT_POOL_SIZE];
+static int              screenshot_head;
+static int              screenshot_count;
+static volatile int     screenshot_thread_run;
+static mutex_t         *screenshot_mutex;
+static event_t         *screenshot_wake;
+static event_t         *screenshot_slot_free;
+static thread_t        *screenshot_thread;
+static uint32_t         frame_dump_frames[MONITORS_NUM];
+static uint32_t         frame_dump_count[MONITORS_NUM];
 
 static void
-video_take_screenshot_monitor(const char *fn, uint32_t *buf, int start_x, int start_y, int row_len, int monitor_index)
+video_write_png(const screenshot_job_t *job)
 {
-    png_bytep         *b_rgb         = NULL;
-    FILE              *fp            = NULL;
-    uint32_t           temp          = 0x00000000;
-    const blit_data_t *blit_data_ptr = monitors[monitor_index].mon_blit_data_ptr;
+    png_structp png_ptr;
+    png_infop   info_ptr;
+    FILE       *fp;
 
     /* create file */
-    fp = plat_fopen(fn, (const char *) "wb");
+    fp = plat_fopen(job->path, (const char *) "wb");
     if (!fp) {
-        video_log("[video_take_screenshot] File %s could not be opened for writing", fn);
+        video_log("[video_write_png] File %s could not be opened for writing", job->path);
         return;
     }
 
     /* initialize stuff */
-    png_ptr[monitor_index] = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
-
-    if (!png_ptr[monitor_index]) {
-        video_log("[video_take_screenshot] png_create_write_struct failed");
+    png_ptr = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+    if (!png_ptr) {
+        video_log("[video_write_png] png_create_write_struct failed");
         fclose(fp);
         return;
     }
 
-    info_ptr[monitor_index] = png_create_info_struct(png_ptr[monitor_index]);
-    if (!info_ptr[monitor_index]) {
-        video_log("[video_take_screenshot] png_create_info_struct failed");
+    info_ptr = png_create_info_struct(png_ptr);
+    if (!info_ptr) {
+        video_log("[video_write_png] png_create_info_struct failed");
+        png_destroy_write_struct(&png_ptr, NULL);
         fclose(fp);
         return;
     }
 
-    png_init_io(png_ptr[monitor_index], fp);
+    png_init_io(png_ptr, fp);
 
-    png_set_IHDR(png_ptr[monitor_index], info_ptr[monitor_index], blit_data_ptr->w, blit_data_ptr->h,
+    png_set_IHDR(png_ptr, info_ptr, job->w, job->h,
                  8, PNG_COLOR_TYPE_RGB, PNG_INTERLACE_NONE,
                  PNG_COMPRESSION_TYPE_BASE, PNG_FILTER_TYPE_BASE);
 
-    b_rgb = (png_bytep *) malloc(sizeof(png_bytep) * blit_data_ptr->h);
-    if (b_rgb == NULL) {
-        video_log("[video_take_screenshot] Unable to Allocate RGB Bitmap Memory");
-        fclose(fp);
-        return;
-    }
+    png_write_info(png_ptr, info_ptr);
 
-    for (int y = 0; y < blit_data_ptr->h; ++y) {
-        b_rgb[y] = (png_byte *) malloc(png_get_rowbytes(png_ptr[monitor_index], info_ptr[monitor_index]));
-        for (int x = 0; x < blit_data_ptr->w; ++x) {
-            if (buf == NULL)
-                memset(&(b_rgb[y][x * 3]), 0x00, 3);
-            else {
-                temp                  = buf[((start_y + y) * row_len) + start_x + x];
-                b_rgb[y][x * 3]       = (temp >> 16) & 0xff;
-                b_rgb[y][(x * 3) + 1] = (temp >> 8) & 0xff;
-                b_rgb[y][(x * 3) + 2] = temp & 0xff;
-            }
+    for (int y = 0; y < job->h; y++)
+        png_write_row(png_ptr, &job->rgb[y * job->w * 3]);
+
+    png_write_end(png_ptr, NULL);
+
+    png_destroy_write_struct(&png_ptr, &info_ptr);
+    fclose(fp);
+}
+
+static void
+screenshot_thread_func(UNUSED(void *param))
+{
+    screenshot_job_t *job;
+
+    while (1) {
+        thread_wait_mutex(screenshot_mutex);
+        if (!screenshot_count) {
+            thread_release_mutex(screenshot_mutex);
+            /* Queued jobs are always written out before the thread exits. */
+            if (!screenshot_thread_run)
+                break;
+            thread_wait_event(screenshot_wake, -1);
+            thread_reset_event(screenshot_wake);
+            continue;
         }
+        job = &screenshot_pool[screenshot_head];
+        thread_release_mutex(screenshot_mutex);
+
+        video_log("writing screenshot to: %s\n", job->path);
+        video_write_png(job);
+
+        thread_wait_mutex(screenshot_mutex);
+        screenshot_head = (screenshot_head + 1) % SCREENSHOT_POOL_SIZE;
+        screenshot_count--;
+        thread_release_mutex(screenshot_mutex);
+        thread_set_event(screenshot_slot_free);
     }
+}
 
-    png_write_info(png_ptr[monitor_index], info_ptr[monitor_index]);
+/* Returns a free pool buffer with the mutex held, or NULL if the pool is full
+   and the caller does not want to wait. */
+static screenshot_job_t *
+screenshot_get_job(int wait)
+{
+    thread_wait_mutex(screenshot_mutex);
+    while (screenshot_count == SCREENSHOT_POOL_SIZE) {
+        thread_release_mutex(screenshot_mutex);
+        if (!wait)
+            return NULL;
+        thread_wait_event(screenshot_slot_free, 100);
+        thread_reset_event(screenshot_slot_free);
+        thread_wait_mutex(screenshot_mutex);
+    }
 
-    png_write_image(png_ptr[monitor_index], b_rgb);
+    return &screenshot_pool[(screenshot_head + screenshot_count) % SCREENSHOT_POOL_SIZE];
+}
 
-    png_write_end(png_ptr[monitor_index], NULL);
+static void
+screenshot_queue_job(screenshot_job_t *job, const uint32_t *buf, int start_x, int start_y, int row_len, int w, int h,
+                     const cursor_layer_t *cursor)
+{
+    size_t   size = (size_t) w * h * 3;
+    uint8_t *rgb;
+
+    if (job->size < size) {
+        rgb = realloc(job->rgb, size);
+        if (rgb == NULL) {
+            video_log("[screenshot_queue_job] Unable to Allocate RGB Bitmap Memory");
+            thread_release_mutex(screenshot_mutex);
+            return;
+        }
+        job->rgb  = rgb;
+        job->size = size;
+    }
+    job->w = w;
+    job->h = h;
+
+    rgb = job->rgb;
+    for (int y = 0; y < h; y++) {
+        if (buf == NULL) {
+            memset(rgb, 0x00, w * 3);
+            rgb += w * 3;
+            continue;
+        }
+        for (int x = 0; x < w; x++) {
+            uint32_t temp = buf[((start_y + y) * row_len) + start_x + x];
 
-    /* cleanup heap allocation */
-    for (int i = 0; i < blit_data_ptr->h; i++)
-        if (b_rgb[i])
-            free(b_rgb[i]);
+            /* The presenter composites the cursor, screenshots do it here. */
+            if (cursor != NULL) {
+                const int cx = start_x + x - cursor->x;
+                const int cy = start_y + y - cursor->y;
 
-    if (b_rgb)
-        free(b_rgb);
+                if ((cx >= 0) && (cx < cursor->w) && (cy >= 0) && (cy < cursor->h))
+                    temp = (temp & cursor->and_mask[(cy * CURSOR_LAYER_MAX) + cx]) ^ cursor->xor_mask[(cy * CURSOR_LAYER_MAX) + cx];
+            }
 
-    if (fp)
-        fclose(fp);
+            *rgb++ = (temp >> 16) & 0xff;
+            *rgb++ = (temp >> 8) & 0xff;
+            *rgb++ = temp & 0xff;
+        }
+    }
+
+    screenshot_count++;
+    thread_release_mutex(screenshot_mutex);
+    thread_set_event(screenshot_wake);
 }
 
-void
-video_screenshot_monitor(uint32_t *buf, int start_x, int start_y, int row_len, int monitor_index)
+/* Snapshot of the cursor layer to composite into a screenshot, NULL while
+   the cursor is drawn into the frame. */
+static cursor_layer_t *
+screenshot_cursor(int monitor_index)
 {
-    char path[1024];
-    char fn[256];
+    cursor_layer_t *cursor;
 
-    memset(fn, 0, sizeof(fn));
-    memset(path, 0, sizeof(path));
+    if (!video_cursor_layer_active(monitor_index))
+        return NULL;
 
+    cursor = malloc(sizeof(cursor_layer_t));
+    if ((cursor != NULL) && !video_cursor_layer_get(monitor_index, cursor, 0)) {
+        free(cursor);
+        cursor = NULL;
+    }
+
+    return cursor;
+}
+
+static void
+screenshot_path(char *path, int monitor_index)
+{
     path_append_filename(path, usr_path, SCREENSHOT_PATH);
 
     if (!plat_dir_check(path))
@@ -400,24 +726,180 @@ video_screenshot_monitor(uint32_t *buf, int start_x, int start_y, int row_len, i
     path_slash(path);
     strcat(path, "Monitor_");
     snprintf(&path[strlen(path)], 42, "%d_", monitor_index + 1);
+}
+
+void
+video_screenshot_monitor(uint32_t *buf, int start_x, int start_y, int row_len, int monitor_index)
+{
+    const blit_data_t *blit_data_ptr = monitors[monitor_index].mon_blit_data_ptr;
+    screenshot_job_t  *job;
+    cursor_layer_t    *cursor;
+    char               path[1024];
+    char               fn[256];
+
+    memset(fn, 0, sizeof(fn));
+    memset(path, 0, sizeof(path));
+
+    screenshot_path(path, monitor_index);
 
     plat_tempfile(fn, NULL, ".png");
     strcat(path, fn);
 
     video_log("taking screenshot to: %s\n", path);
 
-    video_take_screenshot_monitor((const char *) path, buf, start_x, start_y, row_len, monitor_index);
-    png_destroy_write_struct(&png_ptr[monitor_index], &info_ptr[monitor_index]);
+    cursor = screenshot_cursor(monitor_index);
+
+    /* Screenshots are never dropped, wait for a buffer if needed. */
+    job = screenshot_get_job(1);
+    snprintf(job->path, sizeof(job->path), "%s", path);
+    screenshot_queue_job(job, buf, start_x, start_y, row_len, blit_data_ptr->w, blit_data_ptr->h, cursor);
+    free(cursor);
 
     atomic_fetch_sub(&monitors[monitor_index].mon_screenshots, 1);
 }
 
+/* Dump the frame from the emulated target buffer, before it is handed to the
+   renderer. */
+static void
+video_frame_dump_monitor(int x, int y, int w, int h, int monitor_index)
+{
+    const bitmap_t   *target = monitors[monitor_index].target_buffer;
+    screenshot_job_t *job;
+    cursor_layer_t   *cursor;
+    char              path[1024];
+
+    cursor = screenshot_cursor(monitor_index);
+
+    /* Frames are dropped instead of stalling emulation when the encoder
+       falls behind. */
+    job = screenshot_get_job(0);
+    if (job == NULL) {
+        video_log("frame dump: encoder busy, dropping frame %u\n", frame_dump_frames[monitor_index]);
+        free(cursor);
+        return;
+    }
+
+    memset(path, 0, sizeof(path));
+    screenshot_path(path, monitor_index);
+    snprintf(job->path, sizeof(job->path), "%sframe_%08u.png", path, frame_dump_count[monitor_index]++);
+    screenshot_queue_job(job, target->dat, x, y, target->w, w, h, cursor);
+    free(cursor);
+}
+
 void
 video_screenshot(uint32_t *buf, int start_x, int start_y, int row_len)
 {
     video_screenshot_monitor(buf, start_x, start_y, row_len, 0);
 }
 
+/* Greyscale luma weights (red, green, blue) per video_graytype, each set adds
+   up to 255 so that every type shares the same divide. */
+static const uint8_t gray_weights[3][3] = {
+    { 76, 150, 29 },
+    { 54, 183, 18 },
+    { 85,  85, 85 }
+};
+
+#define GRAY_WEIGHTS gray_weights[(video_graytype == 1) ? 1 : (video_graytype ? 2 : 0)]
+#define GRAY_SHADED  ((video_grayscale >= 2) && (video_grayscale <= 4))
+
+#if defined(VIDEO_TRANSFORM_SSE2)
+/* Greyscale level of four pixels, one per 32-bit lane. */
+static __inline __m128i
+video_transform_luma_sse2(__m128i px, __m128i w)
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i       lo   = _mm_madd_epi16(_mm_unpacklo_epi8(px, zero), w);
+    __m128i       hi   = _mm_madd_epi16(_mm_unpackhi_epi8(px, zero), w);
+    __m128i       sum;
+
+    /* Each pixel now has b * wb + g * wg and r * wr in adjacent lanes. */
+    lo  = _mm_add_epi32(lo, _mm_srli_epi64(lo, 32));
+    hi  = _mm_add_epi32(hi, _mm_srli_epi64(hi, 32));
+    sum = _mm_unpacklo_epi64(_mm_shuffle_epi32(lo, _MM_SHUFFLE(3, 1, 2, 0)),
+                             _mm_shuffle_epi32(hi, _MM_SHUFFLE(3, 1, 2, 0)));
+
+    /* Exact division by 255 for sums up to 255 * 255. */
+    sum = _mm_add_epi32(sum, _mm_set1_epi32(1));
+    return _mm_srli_epi32(_mm_add_epi32(sum, _mm_srli_epi32(sum, 8)), 8);
+}
+
+static size_t
+video_transform_line_sse2(uint32_t *dst, const uint32_t *src, size_t count)
+{
+    const uint8_t *w      = GRAY_WEIGHTS;
+    const __m128i  wv     = _mm_set_epi16(0, w[0], w[1], w[2], 0, w[0], w[1], w[2]);
+    const __m128i  invert = _mm_set1_epi32(invert_display ? 0x00ffffff : 0x00000000);
+    size_t         i      = 0;
+
+    for (; (i + 4) <= count; i += 4) {
+        __m128i px = _mm_loadu_si128((const __m128i *) &src[i]);
+
+        if (video_grayscale) {
+            px = video_transform_luma_sse2(px, wv);
+            if (GRAY_SHADED) {
+                uint32_t l[4];
+
+                _mm_storeu_si128((__m128i *) l, px);
+                px = _mm_set_epi32(shade[video_grayscale][l[3]], shade[video_grayscale][l[2]],
+                                   shade[video_grayscale][l[1]], shade[video_grayscale][l[0]]);
+            } else
+                px = _mm_or_si128(px, _mm_or_si128(_mm_slli_epi32(px, 8), _mm_slli_epi32(px, 16)));
+        }
+
+        _mm_storeu_si128((__m128i *) &dst[i], _mm_xor_si128(px, invert));
+    }
+
+    return i;
+}
+#elif defined(VIDEO_TRANSFORM_NEON)
+static size_t
+video_transform_line_neon(uint32_t *dst, const uint32_t *src, size_t count)
+{
+    const uint8_t  *w      = GRAY_WEIGHTS;
+    const uint8x8_t wr     = vdup_n_u8(w[0]);
+    const uint8x8_t wg     = vdup_n_u8(w[1]);
+    const uint8x8_t wb     = vdup_n_u8(w[2]);
+    const uint8x8_t invert = vdup_n_u8(invert_display ? 0xff : 0x00);
+    size_t          i      = 0;
+
+    for (; (i + 8) <= count; i += 8) {
+        uint8x8x4_t px = vld4_u8((const uint8_t *) &src[i]);
+
+        if (video_grayscale) {
+            uint16x8_t sum = vmull_u8(px.val[2], wr);
+            uint8x8_t  l;
+
+            sum = vmlal_u8(sum, px.val[1], wg);
+            sum = vmlal_u8(sum, px.val[0], wb);
+
+            /* Exact division by 255 for sums up to 255 * 255. */
+            sum = vaddq_u16(sum, vdupq_n_u16(1));
+            l   = vshrn_n_u16(vaddq_u16(sum, vshrq_n_u16(sum, 8)), 8);
+
+            if (GRAY_SHADED) {
+                uint8_t ls[8];
+
+                vst1_u8(ls, l);
+                for (int c = 0; c < 8; c++)
+                    dst[i + c] = shade[video_grayscale][ls[c]] ^ (invert_display ? 0x00ffffff : 0x00000000);
+                continue;
+            }
+
+            px.val[0] = px.val[1] = px.val[2] = l;
+            px.val[3] = vdup_n_u8(0);
+        }
+
+        px.val[0] = veor_u8(px.val[0], invert);
+        px.val[1] = veor_u8(px.val[1], invert);
+        px.val[2] = veor_u8(px.val[2], invert);
+        vst4_u8((uint8_t *) &dst[i], px);
+    }
+
+    return i;
+}
+#endif
+
 #ifdef _WIN32
 void *__cdecl video_transform_copy(void *_Dst, const void *_Src, size_t _Size)
 #else
@@ -427,20 +909,28 @@ video_transform_copy(void *__restrict _Dst, const void *__restrict _Src, size_t
 {
     uint32_t       *dest_ex = (uint32_t *) _Dst;
     const uint32_t *src_ex  = (const uint32_t *) _Src;
+    size_t          i       = 0;
 
     _Size /= sizeof(uint32_t);
 
-    if ((dest_ex != NULL) && (src_ex != NULL)) {
-        for (size_t i = 0; i < _Size; i++) {
-            *dest_ex = video_color_transform(*src_ex);
-            dest_ex++;
-            src_ex++;
-        }
-    }
+    if ((dest_ex == NULL) || (src_ex == NULL))
+        return _Dst;
+
+#if defined(VIDEO_TRANSFORM_SSE2)
+    i = video_transform_line_sse2(dest_ex, src_ex, _Size);
+#elif defined(VIDEO_TRANSFORM_NEON)
+    i = video_transform_line_neon(dest_ex, src_ex, _Size);
+#endif
+    for (; i < _Size; i++)
+        dest_ex[i] = video_color_transform(src_ex[i]);
 
     return _Dst;
 }
 
+#define TURBO_FRAMESKIP 8
+
+static uint32_t turbo_frames[MONITORS_NUM];
+
 static void
 blit_thread(void *param)
 {
@@ -450,8 +940,13 @@ blit_thread(void *param)
         thread_reset_event(data->wake_blit_thread);
         MTR_BEGIN("video", "blit_thread");
 
+        data->frame_dropped = 0;
         if (blit_func)
             blit_func(data->x, data->y, data->w, data->h, data->monitor_index);
+        if (data->frame_dropped)
+            perf_frame_dropped();
+        else
+            perf_frame_presented();
 
         data->busy = 0;
 
@@ -463,12 +958,49 @@ blit_thread(void *param)
 void
 video_blit_memtoscreen_monitor(int x, int y, int w, int h, int monitor_index)
 {
+    blit_data_t *blit_data_ptr = monitors[monitor_index].mon_blit_data_ptr;
+    uint32_t     cursor_generation;
+
     MTR_BEGIN("video", "video_blit_memtoscreen");
 
     if ((w <= 0) || (h <= 0))
         return;
 
+    PERF_COUNT(frames_rendered, 1);
+
+    /* In turbo mode, only every few frames are shown. */
+    if (turbo_mode && (++turbo_frames[monitor_index] % TURBO_FRAMESKIP)) {
+        MTR_END("video", "video_blit_memtoscreen");
+        return;
+    }
+
+    if ((video_frame_dump > 0) && (w > 0) && (h > 0) &&
+        !(++frame_dump_frames[monitor_index] % video_frame_dump))
+        video_frame_dump_monitor(x, y, w, h, monitor_index);
+
+    /* Nothing changed since the previous blit of the same area, so the
+       presenter can keep showing what it has. A cursor layer that moved
+       still needs a blit, though one without any damaged lines. */
+    cursor_generation = atomic_load(&blit_data_ptr->cursor_generation);
+    if (blit_data_ptr->pending_valid && (blit_data_ptr->pending_y1 >= blit_data_ptr->pending_y2) &&
+        (x == blit_data_ptr->x) && (y == blit_data_ptr->y) && (w == blit_data_ptr->w) && (h == blit_data_ptr->h) &&
+        (cursor_generation == blit_data_ptr->cursor_blit_generation) &&
+        !monitors[monitor_index].mon_screenshots && (++blit_data_ptr->idle_frames < IDLE_BLIT_INTERVAL)) {
+        blit_data_ptr->pending_valid = 0;
+        MTR_END("video", "video_blit_memtoscreen");
+        return;
+    }
+    blit_data_ptr->idle_frames            = 0;
+    blit_data_ptr->cursor_blit_generation = cursor_generation;
+
+    /* A frame still waiting for its turn is dropped for this one. */
+    if (video_frame_pacing)
+        thread_set_event(blit_data_ptr->pace_cancel);
     video_wait_for_blit_monitor(monitor_index);
+    thread_reset_event(blit_data_ptr->pace_cancel);
+
+    blit_data_ptr->frame_guest_us = video_guest_us();
+    blit_data_ptr->frame_host_us  = plat_get_ticks_us();
 
     monitors[monitor_index].mon_blit_data_ptr->busy          = 1;
     monitors[monitor_index].mon_blit_data_ptr->buffer_in_use = 1;
@@ -477,6 +1009,15 @@ video_blit_memtoscreen_monitor(int x, int y, int w, int h, int monitor_index)
     monitors[monitor_index].mon_blit_data_ptr->w             = w;
     monitors[monitor_index].mon_blit_data_ptr->h             = h;
 
+    if (monitors[monitor_index].mon_blit_data_ptr->pending_valid) {
+        monitors[monitor_index].mon_blit_data_ptr->damage_y1     = MAX(monitors[monitor_index].mon_blit_data_ptr->pending_y1, y);
+        monitors[monitor_index].mon_blit_data_ptr->damage_y2     = MIN(monitors[monitor_index].mon_blit_data_ptr->pending_y2, y + h);
+        monitors[monitor_index].mon_blit_data_ptr->pending_valid = 0;
+    } else {
+        monitors[monitor_index].mon_blit_data_ptr->damage_y1 = y;
+        monitors[monitor_index].mon_blit_data_ptr->damage_y2 = y + h;
+    }
+
     thread_set_event(monitors[monitor_index].mon_blit_data_ptr->wake_blit_thread);
     MTR_END("video", "video_blit_memtoscreen");
 }
@@ -560,6 +1101,7 @@ cgapal_rebuild_monitor(int monitor_index)
         return;
 
     cga_palette_monitor = *monitors[monitor_index].mon_cga_palette;
+    monitors[monitor_index].mon_pal_generation++;
 
     for (c = 0; c < 256; c++) {
         palette_lookup[c] = makecol(video_6to8[cgapal[c].r],
@@ -862,8 +1404,10 @@ video_monitor_init(int index)
     monitors[index].mon_blit_data_ptr->wake_blit_thread  = thread_create_event();
     monitors[index].mon_blit_data_ptr->blit_complete     = thread_create_event();
     monitors[index].mon_blit_data_ptr->buffer_not_in_use = thread_create_event();
+    monitors[index].mon_blit_data_ptr->pace_cancel       = thread_create_event();
     monitors[index].mon_blit_data_ptr->thread_run        = 1;
     monitors[index].mon_blit_data_ptr->monitor_index     = index;
+    monitors[index].mon_blit_data_ptr->cursor_mutex      = thread_create_mutex();
     monitors[index].mon_pal_lookup                       = calloc(sizeof(uint32_t), 256);
     monitors[index].mon_cga_palette                      = calloc(1, sizeof(int));
     monitors[index].mon_force_resize                     = 1;
@@ -872,7 +1416,7 @@ video_monitor_init(int index)
     atomic_init(&monitors[index].mon_screenshots, 0);
     if (index >= 1)
         ui_init_monitor(index);
-    monitors[index].mon_blit_data_ptr->blit_thread = thread_create(blit_thread, monitors[index].mon_blit_data_ptr);
+    monitors[index].mon_blit_data_ptr->blit_thread = thread_create_role(blit_thread, monitors[index].mon_blit_data_ptr, THREAD_ROLE_BLIT);
 }
 
 void
@@ -882,13 +1426,17 @@ video_monitor_close(int monitor_index)
         return;
     }
     monitors[monitor_index].mon_blit_data_ptr->thread_run = 0;
+    thread_set_event(monitors[monitor_index].mon_blit_data_ptr->pace_cancel);
     thread_set_event(monitors[monitor_index].mon_blit_data_ptr->wake_blit_thread);
     thread_wait(monitors[monitor_index].mon_blit_data_ptr->blit_thread);
     if (monitor_index >= 1)
         ui_deinit_monitor(monitor_index);
+    thread_destroy_event(monitors[monitor_index].mon_blit_data_ptr->pace_cancel);
     thread_destroy_event(monitors[monitor_index].mon_blit_data_ptr->buffer_not_in_use);
     thread_destroy_event(monitors[monitor_index].mon_blit_data_ptr->blit_complete);
     thread_destroy_event(monitors[monitor_index].mon_blit_data_ptr->wake_blit_thread);
+    thread_close_mutex(monitors[monitor_index].mon_blit_data_ptr->cursor_mutex);
+    free(monitors[monitor_index].mon_blit_data_ptr->cursor);
     free(monitors[monitor_index].mon_blit_data_ptr);
     if (!monitors[monitor_index].mon_pal_lookup_static)
         free(monitors[monitor_index].mon_pal_lookup);
@@ -947,6 +1495,14 @@ video_init(void)
             egaremap2bpp[c] |= 0x08;
     }
 
+    for (uint16_t c = 0; c < 256; c++) {
+        planar_spread[c] = 0;
+        for (uint8_t x = 0; x < 8; x++) {
+            if (c & (0x80 >> x))
+                planar_spread[c] |= 1 << (x << 2);
+        }
+    }
+
     video_6to8 = malloc(4 * 256);
     for (uint16_t c = 0; c < 256; c++)
         video_6to8[c] = calc_6to8(c);
@@ -969,11 +1525,63 @@ video_init(void)
 
     memset(monitors, 0, sizeof(monitors));
     video_monitor_init(0);
+
+    memset(frame_dump_frames, 0, sizeof(frame_dump_frames));
+    memset(frame_dump_count, 0, sizeof(frame_dump_count));
+    screenshot_head       = 0;
+    screenshot_count      = 0;
+    screenshot_thread_run = 1;
+    screenshot_mutex      = thread_create_mutex();
+    screenshot_wake       = thread_create_event();
+    screenshot_slot_free  = thread_create_event();
+    screenshot_thread     = thread_create(screenshot_thread_func, NULL);
+}
+
+/* Runs in a fork()ed clone of the machine, where only the emulation thread
+   is left. The old events and mutexes may have been held by threads that are
+   gone, so they are left behind rather than destroyed. */
+void
+video_clone_child(void)
+{
+    for (int i = 0; i < MONITORS_NUM; i++) {
+        blit_data_t *data = monitors[i].mon_blit_data_ptr;
+
+        if ((monitors[i].target_buffer == NULL) || (data == NULL))
+            continue;
+
+        data->wake_blit_thread  = thread_create_event();
+        data->blit_complete     = thread_create_event();
+        data->buffer_not_in_use = thread_create_event();
+        data->pace_cancel       = thread_create_event();
+        data->cursor_mutex      = thread_create_mutex();
+        data->busy              = 0;
+        data->buffer_in_use     = 0;
+        data->blit_thread       = thread_create_role(blit_thread, data, THREAD_ROLE_BLIT);
+    }
+
+    screenshot_head      = 0;
+    screenshot_count     = 0;
+    screenshot_mutex     = thread_create_mutex();
+    screenshot_wake      = thread_create_event();
+    screenshot_slot_free = thread_create_event();
+    screenshot_thread    = thread_create(screenshot_thread_func, NULL);
 }
 
 void
 video_close(void)
 {
+    screenshot_thread_run = 0;
+    thread_set_event(screenshot_wake);
+    thread_wait(screenshot_thread);
+    thread_destroy_event(screenshot_slot_free);
+    thread_destroy_event(screenshot_wake);
+    thread_close_mutex(screenshot_mutex);
+    for (int i = 0; i < SCREENSHOT_POOL_SIZE; i++) {
+        free(screenshot_pool[i].rgb);
+        screenshot_pool[i].rgb  = NULL;
+        screenshot_pool[i].size = 0;
+    }
+
     video_monitor_close(0);
 
     free(video_16to32);
@@ -982,10 +1590,7 @@ video_close(void)
     free(video_8togs);
     free(video_6to8);
 
-    if (fontdatksc5601) {
-        free(fontdatksc5601);
-        fontdatksc5601 = NULL;
-    }
+    video_free_ksc5601();
 
     if (fontdatksc5601_user) {
         free(fontdatksc5601_user);
@@ -1005,6 +1610,21 @@ video_force_resize_set_monitor(uint8_t res, int monitor_index)
     monitors[monitor_index].mon_force_resize = res;
 }
 
+void
+video_free_ksc5601(void)
+{
+    if (fontdatksc5601 == NULL)
+        return;
+
+    if (fontdatksc5601_mapped)
+        rom_unmap((uint8_t *) fontdatksc5601, 16384 * sizeof(dbcs_font_t));
+    else
+        free(fontdatksc5601);
+
+    fontdatksc5601        = NULL;
+    fontdatksc5601_mapped = 0;
+}
+
 void
 loadfont_common(FILE *f, int format)
 {
@@ -1143,7 +1763,21 @@ loadfont_common(FILE *f, int format)
 void
 loadfont_ex(char *s, int format, int offset)
 {
-    FILE *fp;
+    FILE    *fp;
+    uint8_t *map;
+
+    /* The KSC-5601 font is half a megabyte laid out the way it is used, so
+       map it in and have every instance share the one copy. */
+    if ((format == 6) && (fontdatksc5601 == NULL)) {
+        map = rom_map(s, offset, 16384 * sizeof(dbcs_font_t));
+        if (map != NULL) {
+            fontdatksc5601        = (dbcs_font_t *) map;
+            fontdatksc5601_mapped = 1;
+            if (!fontdatksc5601_user)
+                fontdatksc5601_user = malloc(192 * sizeof(dbcs_font_t));
+            return;
+        }
+    }
 
     fp = rom_fopen(s, "rb");
     if (fp == NULL)
@@ -36,15 +36,28 @@
 #define VNC_MAX_X 2048
 #define VNC_MIN_Y 200
 #define VNC_MAX_Y 2048
+#define VNC_RECTS 32
+
+typedef struct vnc_rect_t {
+    int x1;
+    int y1;
+    int x2;
+    int y2;
+} vnc_rect_t;
 
 static rfbScreenInfoPtr rfb = NULL;
 static int              clients;
 static int              updatingSize;
+static int              full_update = 1;
+static int              blit_w;
+static int              blit_h;
 static int              allowedX;
 static int              allowedY;
 static int              ptr_x;
 static int              ptr_y;
 static int              ptr_but;
+static vnc_rect_t       rects[VNC_RECTS];
+static int              nr_rects;
 
 #ifdef ENABLE_VNC_LOG
 int vnc_do_log = ENABLE_VNC_LOG;
@@ -173,24 +186,125 @@ vnc_display(rfbClientPtr cl)
     }
 }
 
+/* Find the columns of a row that differ from what the clients were sent. */
+static int
+vnc_row_changed(const uint32_t *old, const uint32_t *new, int w, int *x1, int *x2)
+{
+    int l = 0;
+    int r = w;
+
+    if (!memcmp(old, new, w * sizeof(uint32_t)))
+        return 0;
+
+    while (old[l] == new[l])
+        l++;
+    while (old[r - 1] == new[r - 1])
+        r--;
+
+    *x1 = l;
+    *x2 = r;
+    return 1;
+}
+
+static void
+vnc_add_rect(int x1, int y1, int x2, int y2)
+{
+    vnc_rect_t *r;
+
+    /* Past the limit, grow the last rectangle instead. */
+    if (nr_rects == VNC_RECTS) {
+        r     = &rects[VNC_RECTS - 1];
+        r->x1 = MIN(r->x1, x1);
+        r->x2 = MAX(r->x2, x2);
+        r->y2 = y2;
+        return;
+    }
+
+    r     = &rects[nr_rects++];
+    r->x1 = x1;
+    r->y1 = y1;
+    r->x2 = x2;
+    r->y2 = y2;
+}
+
 static void
 vnc_blit(int x, int y, int w, int h, int monitor_index)
 {
+    uint32_t *fb;
+    uint32_t *src;
+    int       y1;
+    int       y2;
+    int       x1;
+    int       x2;
+    int       full;
+    int       rx1 = 0;
+    int       rx2 = 0;
+    int       ry1 = -1;
+
     if (monitor_index || (x < 0) || (y < 0) || (w < VNC_MIN_X) || (h < VNC_MIN_Y) || (w > VNC_MAX_X) || (h > VNC_MAX_Y) || (buffer32 == NULL)) {
+        full_update = 1;
         video_blit_complete_monitor(monitor_index);
         return;
     }
 
-    for (int row = 0; row < h; ++row)
-        video_copy(&(((uint8_t *) rfb->frameBuffer)[row * 2048 * sizeof(uint32_t)]), &(buffer32->line[y + row][x]), w * sizeof(uint32_t));
+    /* Only look at the lines that changed since the last frame. */
+    video_blit_get_damage_monitor(monitor_index, &y1, &y2);
+    full = full_update || (w != blit_w) || (h != blit_h);
+    if (full) {
+        y1          = y;
+        y2          = y + h;
+        full_update = 0;
+        blit_w      = w;
+        blit_h      = h;
+    }
+
+    /* Within those, compare against the frame the clients already have, so
+       libvncserver only encodes the rectangles that really changed. */
+    nr_rects = 0;
+    for (int row = y1 - y; row < (y2 - y); ++row) {
+        fb  = &((uint32_t *) rfb->frameBuffer)[row * VNC_MAX_X];
+        src = &(buffer32->line[y + row][x]);
+
+        if (full) {
+            video_copy(fb, src, w * sizeof(uint32_t));
+            continue;
+        }
+
+        if (vnc_row_changed(fb, src, w, &x1, &x2)) {
+            video_copy(&fb[x1], &src[x1], (x2 - x1) * sizeof(uint32_t));
+            if (ry1 < 0) {
+                ry1 = row;
+                rx1 = x1;
+                rx2 = x2;
+            } else {
+                rx1 = MIN(rx1, x1);
+                rx2 = MAX(rx2, x2);
+            }
+        } else if (ry1 >= 0) {
+            vnc_add_rect(rx1, ry1, rx2, row);
+            ry1 = -1;
+        }
+    }
+    if (ry1 >= 0)
+        vnc_add_rect(rx1, ry1, rx2, y2 - y);
 
     if (screenshots)
         video_screenshot((uint32_t *) rfb->frameBuffer, 0, 0, VNC_MAX_X);
 
     video_blit_complete_monitor(monitor_index);
 
-    if (!updatingSize)
-        rfbMarkRectAsModified(rfb, 0, 0, allowedX, allowedY);
+    if (updatingSize)
+        full_update = 1;
+    else if (full) {
+        if (y1 < y2)
+            rfbMarkRectAsModified(rfb, 0, y1 - y, allowedX, MIN(y2 - y, allowedY));
+    } else {
+        for (int i = 0; i < nr_rects; i++) {
+            if ((rects[i].x1 < allowedX) && (rects[i].y1 < allowedY))
+                rfbMarkRectAsModified(rfb, rects[i].x1, rects[i].y1,
+                                      MIN(rects[i].x2, allowedX), MIN(rects[i].y2, allowedY));
+        }
+    }
 }
 
 /* Initialize VNC for operation. */
@@ -282,6 +396,8 @@ vnc_resize(int x, int y)
     if ((x != rfb->width || y != rfb->height) && x > 160 && y > 0) {
         vnc_log("VNC: updating resolution: %dx%d\n", x, y);
 
+        full_update = 1;
+
         allowedX = (rfb->width < x) ? rfb->width : x;
         allowedY = (rfb->width < y) ? rfb->width : y;
 